@@ -28,6 +28,7 @@
 
 #include <sstream>
 #include <cmath>
+#include <exception>
 
 namespace sigrok
 {
@@ -401,6 +402,13 @@ shared_ptr<Trigger> Context::create_trigger(string name)
 		default_delete<Trigger>{}};
 }
 
+shared_ptr<LogicEdges> Context::create_logic_edges(unsigned int num_channels)
+{
+	return shared_ptr<LogicEdges>{
+		new LogicEdges{num_channels},
+		default_delete<LogicEdges>{}};
+}
+
 shared_ptr<Input> Context::open_file(string filename)
 {
 	const struct sr_input *input;
@@ -896,8 +904,9 @@ float TriggerMatch::value() const
 }
 
 DatafeedCallbackData::DatafeedCallbackData(Session *session,
-		DatafeedCallbackFunction callback) :
+		DatafeedCallbackFunction callback, SessionExecutor executor) :
 	_callback(move(callback)),
+	_executor(move(executor)),
 	_session(session)
 {
 }
@@ -906,8 +915,35 @@ void DatafeedCallbackData::run(const struct sr_dev_inst *sdi,
 	const struct sr_datafeed_packet *pkt)
 {
 	auto device = _session->get_device(sdi);
-	shared_ptr<Packet> packet {new Packet{device, pkt}, default_delete<Packet>{}};
-	_callback(move(device), move(packet));
+
+	if (_executor) {
+		/* The executor may run the callback after pkt is gone. */
+		struct sr_datafeed_packet *copy;
+		if (sr_packet_copy(pkt, &copy) != SR_OK)
+			return;
+		shared_ptr<Packet> packet{new Packet{device, copy},
+			default_delete<Packet>{}};
+		packet->_copy = copy;
+		auto callback = _callback;
+		_executor([callback, device, packet]() {
+			callback(device, packet);
+		});
+		return;
+	}
+
+	/* Reuse the previous packet wrapper, unless the callback kept it. */
+	if (_packet && _packet.use_count() == 1)
+		_packet->rebind(device, pkt);
+	else
+		_packet.reset(new Packet{device, pkt}, default_delete<Packet>{});
+
+	_callback(move(device), _packet);
+
+	/* Don't let an idle wrapper keep the device and its session alive. */
+	if (_packet.use_count() == 1)
+		_packet->_device.reset();
+	else
+		_packet.reset();
 }
 
 SessionDevice::SessionDevice(struct sr_dev_inst *structure) :
@@ -924,6 +960,57 @@ shared_ptr<Device> SessionDevice::get_shared_from_this()
 	return static_pointer_cast<Device>(shared_from_this());
 }
 
+uint64_t SessionDevice::num_samples(shared_ptr<Channel> channel)
+{
+	uint64_t samples;
+	check(sr_session_file_samples(_structure,
+		channel ? channel->_structure : nullptr, &samples));
+	return samples;
+}
+
+uint64_t SessionDevice::read_samples(shared_ptr<Channel> channel,
+	uint64_t offset, uint64_t count, void *buf)
+{
+	check(sr_session_file_read(_structure,
+		channel ? channel->_structure : nullptr, offset, &count, buf));
+	return count;
+}
+
+unsigned int SessionDevice::summary_levels(shared_ptr<Channel> channel,
+	unsigned int *shift)
+{
+	unsigned int levels, level_shift;
+	int ret = sr_session_file_summary_levels(_structure,
+		channel ? channel->_structure : nullptr, &levels, &level_shift);
+	if (ret == SR_ERR_NA)
+		return 0;
+	check(ret);
+	if (shift)
+		*shift = level_shift;
+	return levels;
+}
+
+uint64_t SessionDevice::read_summary(shared_ptr<Channel> channel,
+	unsigned int level, uint64_t offset, uint64_t count, void *buf)
+{
+	check(sr_session_file_summary_read(_structure,
+		channel ? channel->_structure : nullptr, level, offset,
+		&count, buf));
+	return count;
+}
+
+int64_t SessionDevice::next_edge(shared_ptr<Channel> channel, uint64_t from,
+	const TriggerMatchType *type)
+{
+	uint64_t pos;
+	int ret = sr_session_file_edge_next(_structure, channel->_structure,
+		from, type->id(), &pos);
+	if (ret == SR_ERR_NA)
+		return -1;
+	check(ret);
+	return pos;
+}
+
 Session::Session(shared_ptr<Context> context) :
 	_structure(nullptr),
 	_context(move(context))
@@ -1006,6 +1093,36 @@ void Session::stop()
 	check(sr_session_stop(_structure));
 }
 
+void Session::stop_async()
+{
+	check(sr_session_stop_async(_structure));
+}
+
+int Session::poll_prepare(vector<GPollFD> &fds)
+{
+	int timeout;
+	int count = static_cast<int>(fds.capacity());
+
+	/* Grow the array until all descriptors fit. */
+	while (true) {
+		fds.resize(count);
+		check(sr_session_poll_prepare(_structure, fds.data(),
+			&count, &timeout));
+		if (static_cast<size_t>(count) <= fds.size())
+			break;
+	}
+	fds.resize(count);
+
+	return timeout;
+}
+
+bool Session::poll_dispatch(vector<GPollFD> &fds)
+{
+	check(sr_session_poll_dispatch(_structure, fds.data(),
+		static_cast<int>(fds.size())));
+	return is_running();
+}
+
 bool Session::is_running() const
 {
 	const int ret = sr_session_is_running(_structure);
@@ -1014,6 +1131,32 @@ bool Session::is_running() const
 	return (ret != 0);
 }
 
+map<string, uint64_t> Session::stats() const
+{
+	struct sr_session_stats stats;
+	check(sr_session_stats_get(_structure, &stats));
+
+	map<string, uint64_t> result{
+		{"elapsed_us", stats.elapsed_us},
+		{"packets", stats.packets},
+		{"logic_samples", stats.logic_samples},
+		{"logic_bytes", stats.logic_bytes},
+		{"analog_samples", stats.analog_samples},
+		{"analog_bytes", stats.analog_bytes},
+		{"packets_dropped", stats.packets_dropped},
+		{"bytes_dropped", stats.bytes_dropped},
+		{"transform_us", stats.transform_us},
+		{"callback_us", stats.callback_us},
+		{"output_us", stats.output_us},
+		{"queue_fill", stats.queue_fill},
+		{"queue_capacity", stats.queue_capacity},
+	};
+	for (unsigned int i = 0; i < SR_SESSION_STATS_BUCKETS; i++)
+		result["callback_hist_" + to_string(i)] = stats.callback_hist[i];
+
+	return result;
+}
+
 static void session_stopped_callback(void *data) noexcept
 {
 	auto *const callback = static_cast<SessionStoppedCallback*>(data);
@@ -1047,6 +1190,18 @@ void Session::add_datafeed_callback(DatafeedCallbackFunction callback)
 	_datafeed_callbacks.push_back(move(cb_data));
 }
 
+void Session::add_datafeed_callback(DatafeedCallbackFunction callback,
+	SessionExecutor executor)
+{
+	if (!executor)
+		throw Error(SR_ERR_ARG);
+	unique_ptr<DatafeedCallbackData> cb_data
+		{new DatafeedCallbackData{this, move(callback), move(executor)}};
+	check(sr_session_datafeed_callback_add(_structure,
+			&datafeed_callback, cb_data.get()));
+	_datafeed_callbacks.push_back(move(cb_data));
+}
+
 void Session::remove_datafeed_callbacks()
 {
 	check(sr_session_datafeed_callback_remove_all(_structure));
@@ -1080,36 +1235,62 @@ shared_ptr<Context> Session::context()
 
 Packet::Packet(shared_ptr<Device> device,
 	const struct sr_datafeed_packet *structure) :
-	_structure(structure),
-	_device(move(device))
+	_structure(nullptr),
+	_copy(nullptr)
+{
+	rebind(move(device), structure);
+}
+
+/* Point the payload at new data, reusing the wrapper of the same type. */
+template <class Payload, class Structure>
+void Packet::rebind_payload(const void *structure)
+{
+	auto payload = dynamic_cast<Payload *>(_payload.get());
+
+	if (payload)
+		payload->_structure = static_cast<const Structure *>(structure);
+	else
+		_payload.reset(new Payload{
+			static_cast<const Structure *>(structure)});
+}
+
+void Packet::rebind(shared_ptr<Device> device,
+	const struct sr_datafeed_packet *structure)
 {
+	_structure = structure;
+	_device = move(device);
+
 	switch (structure->type)
 	{
 		case SR_DF_HEADER:
-			_payload.reset(new Header{
-				static_cast<const struct sr_datafeed_header *>(
-					structure->payload)});
+			rebind_payload<Header, struct sr_datafeed_header>(
+				structure->payload);
 			break;
 		case SR_DF_META:
-			_payload.reset(new Meta{
-				static_cast<const struct sr_datafeed_meta *>(
-					structure->payload)});
+			rebind_payload<Meta, struct sr_datafeed_meta>(
+				structure->payload);
 			break;
 		case SR_DF_LOGIC:
-			_payload.reset(new Logic{
-				static_cast<const struct sr_datafeed_logic *>(
-					structure->payload)});
+			rebind_payload<Logic, struct sr_datafeed_logic>(
+				structure->payload);
+			break;
+		case SR_DF_LOGIC_RLE:
+			rebind_payload<LogicRLE, struct sr_datafeed_logic_rle>(
+				structure->payload);
 			break;
 		case SR_DF_ANALOG:
-			_payload.reset(new Analog{
-				static_cast<const struct sr_datafeed_analog *>(
-					structure->payload)});
+			rebind_payload<Analog, struct sr_datafeed_analog>(
+				structure->payload);
+			break;
+		default:
+			_payload.reset();
 			break;
 	}
 }
 
 Packet::~Packet()
 {
+	sr_packet_unref(_copy);
 }
 
 const PacketType *Packet::type() const
@@ -1218,6 +1399,169 @@ unsigned int Logic::unit_size() const
 	return _structure->unitsize;
 }
 
+Span<const uint8_t> Logic::data() const
+{
+	return Span<const uint8_t>(
+		static_cast<const uint8_t *>(_structure->data), _structure->length);
+}
+
+LogicChannelView Logic::channel_samples(unsigned int index) const
+{
+	if (index >= 8 * _structure->unitsize)
+		throw Error(SR_ERR_ARG);
+	return LogicChannelView(
+		static_cast<const uint8_t *>(_structure->data) + index / 8,
+		_structure->length / _structure->unitsize, _structure->unitsize,
+		1 << (index % 8));
+}
+
+vector<vector<uint64_t>> Logic::bit_planes() const
+{
+	size_t num_samples = _structure->length / _structure->unitsize;
+	size_t plane_size = sr_logic_plane_size(num_samples);
+	size_t num_planes = 8 * _structure->unitsize;
+	vector<uint8_t> data(num_planes * plane_size);
+	check(sr_logic_to_planes(_structure, data.data(), plane_size));
+
+	vector<vector<uint64_t>> result(num_planes);
+	for (size_t i = 0; i < num_planes; i++) {
+		const uint8_t *p = &data[i * plane_size];
+		result[i].resize(plane_size / sizeof(uint64_t));
+		for (auto &word : result[i]) {
+			word = 0;
+			for (size_t b = 0; b < sizeof(uint64_t); b++)
+				word |= uint64_t{*p++} << (8 * b);
+		}
+	}
+	return result;
+}
+
+void Logic::set_bit_planes(const vector<vector<uint64_t>> &planes)
+{
+	size_t num_samples = _structure->length / _structure->unitsize;
+	size_t plane_size = sr_logic_plane_size(num_samples);
+	size_t num_planes = 8 * _structure->unitsize;
+	if (planes.size() != num_planes)
+		throw Error(SR_ERR_ARG);
+
+	vector<uint8_t> data(num_planes * plane_size);
+	for (size_t i = 0; i < num_planes; i++) {
+		if (planes[i].size() < plane_size / sizeof(uint64_t))
+			throw Error(SR_ERR_ARG);
+		uint8_t *p = &data[i * plane_size];
+		for (size_t w = 0; w < plane_size / sizeof(uint64_t); w++) {
+			for (size_t b = 0; b < sizeof(uint64_t); b++)
+				*p++ = planes[i][w] >> (8 * b);
+		}
+	}
+	check(sr_logic_from_planes(data.data(), plane_size,
+		const_cast<struct sr_datafeed_logic *>(_structure)));
+}
+
+LogicRLE::LogicRLE(const struct sr_datafeed_logic_rle *structure) :
+	PacketPayload(),
+	_structure(structure)
+{
+}
+
+LogicRLE::~LogicRLE()
+{
+}
+
+shared_ptr<PacketPayload> LogicRLE::share_owned_by(shared_ptr<Packet> _parent)
+{
+	return static_pointer_cast<PacketPayload>(
+		ParentOwned::share_owned_by(_parent));
+}
+
+uint64_t LogicRLE::num_samples() const
+{
+	return _structure->num_samples;
+}
+
+unsigned int LogicRLE::unit_size() const
+{
+	return _structure->unitsize;
+}
+
+Span<const uint64_t> LogicRLE::offsets() const
+{
+	return Span<const uint64_t>(_structure->offsets,
+		_structure->num_changes);
+}
+
+Span<const uint8_t> LogicRLE::values() const
+{
+	return Span<const uint8_t>(
+		static_cast<const uint8_t *>(_structure->values),
+		_structure->num_changes * _structure->unitsize);
+}
+
+vector<uint8_t> LogicRLE::expand() const
+{
+	vector<uint8_t> data(_structure->num_samples * _structure->unitsize);
+	check(sr_logic_rle_expand(_structure, data.data()));
+	return data;
+}
+
+LogicEdges::LogicEdges(unsigned int num_channels)
+{
+	check(sr_logic_edges_new(&_structure, num_channels));
+}
+
+LogicEdges::~LogicEdges()
+{
+	sr_logic_edges_free(_structure);
+}
+
+void LogicEdges::feed(shared_ptr<Packet> packet)
+{
+	check(sr_logic_edges_feed(_structure, packet->_structure));
+}
+
+vector<uint64_t> LogicEdges::edges(unsigned int channel) const
+{
+	const uint64_t *positions;
+	size_t count;
+	check(sr_logic_edges_get(_structure, channel, &positions, &count,
+		nullptr));
+	return vector<uint64_t>(positions, positions + count);
+}
+
+bool LogicEdges::first_edge_rising(unsigned int channel) const
+{
+	const uint64_t *positions;
+	size_t count;
+	gboolean rising;
+	check(sr_logic_edges_get(_structure, channel, &positions, &count,
+		&rising));
+	return rising;
+}
+
+void LogicEdges::clear(size_t keep)
+{
+	check(sr_logic_edges_clear(_structure, keep));
+}
+
+map<string, double> LogicEdges::timing(unsigned int channel) const
+{
+	struct sr_logic_timing timing;
+	int ret = sr_logic_edges_timing(_structure, channel, &timing);
+	if (ret == SR_ERR_NA)
+		return {};
+	check(ret);
+
+	return {
+		{"edges", static_cast<double>(timing.edges)},
+		{"periods", static_cast<double>(timing.periods)},
+		{"period", timing.period},
+		{"period_min", static_cast<double>(timing.period_min)},
+		{"period_max", static_cast<double>(timing.period_max)},
+		{"high", timing.high},
+		{"duty_cycle", timing.duty_cycle},
+	};
+}
+
 Analog::Analog(const struct sr_datafeed_analog *structure) :
 	PacketPayload(),
 	_structure(structure)
@@ -1244,6 +1588,76 @@ void Analog::get_data_as_float(float *dest)
 	check(sr_analog_to_float(_structure, dest));
 }
 
+void Analog::get_data_as_float(float *dest, unsigned int channel,
+	size_t stride)
+{
+	check(sr_analog_channel_to_float(_structure, channel, dest, stride));
+}
+
+void Analog::get_data_as_double(double *dest)
+{
+	check(sr_analog_to_double(_structure, dest));
+}
+
+void Analog::get_data_as_double(double *dest, unsigned int channel,
+	size_t stride)
+{
+	check(sr_analog_channel_to_double(_structure, channel, dest, stride));
+}
+
+Span<const uint8_t> Analog::data() const
+{
+	return Span<const uint8_t>(static_cast<const uint8_t *>(_structure->data),
+		sr_analog_data_size(_structure));
+}
+
+AnalogFloatRange Analog::channel_values(unsigned int channel) const
+{
+	if (channel >= g_slist_length(_structure->meaning->channels))
+		throw Error(SR_ERR_ARG);
+	return AnalogFloatRange(_structure, channel);
+}
+
+const size_t AnalogFloatRange::block_size;
+
+AnalogFloatRange::AnalogFloatRange(const struct sr_datafeed_analog *structure,
+		unsigned int channel) :
+	_structure(structure),
+	_channel(channel),
+	_start(0),
+	_count(0)
+{
+}
+
+size_t AnalogFloatRange::size() const
+{
+	return _structure->num_samples;
+}
+
+Span<const float> AnalogFloatRange::block(size_t start)
+{
+	if (start % block_size || start >= size())
+		throw Error(SR_ERR_ARG);
+	if (start != _start || !_count)
+		convert(start);
+	return Span<const float>(_values, _count);
+}
+
+void AnalogFloatRange::convert(size_t start)
+{
+	const struct sr_analog_encoding *encoding = _structure->encoding;
+	size_t frame = encoding->stride ? encoding->stride :
+		encoding->unitsize * g_slist_length(_structure->meaning->channels);
+
+	/* Convert a window of the packet, in the packet's own layout. */
+	struct sr_datafeed_analog window = *_structure;
+	window.data = static_cast<uint8_t *>(_structure->data) + start * frame;
+	window.num_samples = min(block_size, size() - start);
+	check(sr_analog_channel_to_float(&window, _channel, _values, 1));
+	_start = start;
+	_count = window.num_samples;
+}
+
 unsigned int Analog::num_samples() const
 {
 	return _structure->num_samples;
@@ -1478,6 +1892,11 @@ void Input::send(void *data, size_t length)
 	check(ret);
 }
 
+void Input::send_in_place(void *data, size_t length)
+{
+	check(sr_input_send_data(_structure, data, length));
+}
+
 void Input::end()
 {
 	check(sr_input_end(_structure));
@@ -1681,6 +2100,44 @@ string Output::receive(shared_ptr<Packet> packet)
 	}
 }
 
+/* Pass the output of a callback sink to the caller's write function. */
+struct OutputWriteData
+{
+	OutputWriteFunction *write;
+	exception_ptr error;
+};
+
+static int output_sink_write(const uint8_t *data, size_t length, void *cb_data)
+{
+	auto *const write_data = static_cast<OutputWriteData *>(cb_data);
+	try {
+		(*write_data->write)(data, length);
+	} catch (...) {
+		write_data->error = current_exception();
+		return SR_ERR;
+	}
+	return SR_OK;
+}
+
+void Output::receive(shared_ptr<Packet> packet, OutputWriteFunction write)
+{
+	OutputWriteData write_data{&write, nullptr};
+	auto *const sink = sr_output_sink_callback_new(output_sink_write,
+		&write_data);
+	auto ret = sr_output_send_sink(_structure, packet->_structure, sink);
+	sr_output_sink_free(sink);
+	if (write_data.error)
+		rethrow_exception(write_data.error);
+	check(ret);
+}
+
+void Output::receive(shared_ptr<Packet> packet, string &buffer)
+{
+	receive(move(packet), [&buffer](const void *data, size_t length) {
+		buffer.append(static_cast<const char *>(data), length);
+	});
+}
+
 #include <enums.cpp>
 
 }
@@ -78,7 +78,9 @@ G_GNUC_BEGIN_IGNORE_DEPRECATIONS
 #include <glibmm.h>
 G_GNUC_END_IGNORE_DEPRECATIONS
 
+#include <cstddef>
 #include <functional>
+#include <iterator>
 #include <stdexcept>
 #include <memory>
 #include <vector>
@@ -121,6 +123,9 @@ class SR_API Output;
 class SR_API DataType;
 class SR_API Option;
 class SR_API UserDevice;
+class SR_API LogicRLE;
+class SR_API LogicEdges;
+class SR_API AnalogFloatRange;
 
 /** Exception thrown when an error code is returned by any libsigrok call. */
 class SR_API Error: public std::exception
@@ -294,6 +299,9 @@ public:
 	/** Create a new trigger.
 	 * @param name Name string for new trigger. */
 	std::shared_ptr<Trigger> create_trigger(std::string name);
+	/** Create a new collector of logic edges.
+	 * @param num_channels Number of channels, the low bits of the samples. */
+	std::shared_ptr<LogicEdges> create_logic_edges(unsigned int num_channels);
 	/** Open an input file.
 	 * @param filename File name string. */
 	std::shared_ptr<Input> open_file(std::string filename);
@@ -480,6 +488,7 @@ private:
 	friend class UserDevice;
 	friend class ChannelGroup;
 	friend class Session;
+	friend class SessionDevice;
 	friend class TriggerStage;
 	friend class Context;
 	friend struct std::default_delete<Channel>;
@@ -578,6 +587,10 @@ typedef std::function<void()> SessionStoppedCallback;
 typedef std::function<void(std::shared_ptr<Device>, std::shared_ptr<Packet>)>
 	DatafeedCallbackFunction;
 
+/** Type of executor, which runs the function passed to it at some later
+ * point, e.g. by posting it to an event loop or a thread pool */
+typedef std::function<void(std::function<void()>)> SessionExecutor;
+
 /* Data required for C callback function to call a C++ datafeed callback */
 class SR_PRIV DatafeedCallbackData
 {
@@ -586,9 +599,13 @@ public:
 		const struct sr_datafeed_packet *pkt);
 private:
 	DatafeedCallbackFunction _callback;
+	SessionExecutor _executor;
 	DatafeedCallbackData(Session *session,
-		DatafeedCallbackFunction callback);
+		DatafeedCallbackFunction callback,
+		SessionExecutor executor = SessionExecutor());
 	Session *_session;
+	/* Packet wrapper for reuse by the next callback, unless kept. */
+	std::shared_ptr<Packet> _packet;
 	friend class Session;
 };
 
@@ -597,6 +614,45 @@ class SR_API SessionDevice :
 	public ParentOwned<SessionDevice, Session>,
 	public Device
 {
+public:
+	/** Number of samples in the session file.
+	 * @param channel An analog channel, or nullptr for the logic data. */
+	uint64_t num_samples(std::shared_ptr<Channel> channel = nullptr);
+	/** Read samples straight from the session file, without running the
+	 * session. Logic samples are unit size bytes wide, analog samples
+	 * are floats. Chunks of the file get read in parallel.
+	 * @param channel An analog channel, or nullptr for the logic data.
+	 * @param offset Number of the first sample to read.
+	 * @param count Number of samples to read, which buf has room for.
+	 * @param buf Buffer to read into.
+	 * @return Number of samples read, fewer at the end of the data. */
+	uint64_t read_samples(std::shared_ptr<Channel> channel,
+		uint64_t offset, uint64_t count, void *buf);
+	/** Number of levels of the summary in the session file, 0 without
+	 * one. An entry of level 0 covers 2^shift samples, an entry of each
+	 * following level twice as many.
+	 * @param channel An analog channel, or nullptr for the logic data.
+	 * @param shift Receives the shift, unless nullptr. */
+	unsigned int summary_levels(std::shared_ptr<Channel> channel = nullptr,
+		unsigned int *shift = nullptr);
+	/** Read entries of a level of the summary in the session file.
+	 * @param channel A logic or analog channel.
+	 * @param level The summary level.
+	 * @param offset Number of the first entry to read.
+	 * @param count Number of entries to read, which buf has room for.
+	 * @param buf Buffer of struct sr_logic_summary entries for a logic
+	 * channel, struct sr_analog_summary entries for an analog one.
+	 * @return Number of entries read, fewer at the end of the level. */
+	uint64_t read_summary(std::shared_ptr<Channel> channel,
+		unsigned int level, uint64_t offset, uint64_t count, void *buf);
+	/** Find the next edge of a logic channel after a sample, skipping
+	 * the blocks of samples where the channel does not change.
+	 * @param channel A logic channel.
+	 * @param from Edges after this sample are searched for.
+	 * @param type TriggerMatchType::RISING, FALLING, or EDGE for either.
+	 * @return Position of the edge, or -1 if there is none. */
+	int64_t next_edge(std::shared_ptr<Channel> channel, uint64_t from,
+		const TriggerMatchType *type);
 private:
 	explicit SessionDevice(struct sr_dev_inst *sdi);
 	~SessionDevice();
@@ -620,6 +676,13 @@ public:
 	/** Add a datafeed callback to this session.
 	 * @param callback Callback of the form callback(Device, Packet). */
 	void add_datafeed_callback(DatafeedCallbackFunction callback);
+	/** Add a datafeed callback which runs on an executor, instead of in
+	 * the session event loop. Each packet gets copied, so that the
+	 * callback may run after the session moved on.
+	 * @param callback Callback of the form callback(Device, Packet).
+	 * @param executor Executor which runs the calls of the callback. */
+	void add_datafeed_callback(DatafeedCallbackFunction callback,
+		SessionExecutor executor);
 	/** Remove all datafeed callbacks from this session. */
 	void remove_datafeed_callbacks();
 	/** Start the session. */
@@ -628,8 +691,25 @@ public:
 	void run();
 	/** Stop the session. */
 	void stop();
+	/** Request the session to stop, without waiting for the devices.
+	 * The stop happens in the next iteration of the event loop. */
+	void stop_async();
+	/** Get the descriptors which an external event loop has to wait for
+	 * before calling poll_dispatch(), instead of using run().
+	 * @param fds Receives the descriptors.
+	 * @return Timeout in milliseconds, 0 if events are pending already,
+	 * or -1 for none. */
+	int poll_prepare(std::vector<GPollFD> &fds);
+	/** Dispatch the events which the descriptors report.
+	 * @param fds The descriptors from poll_prepare(), with the revents
+	 * filled in.
+	 * @return Whether the session is still running. */
+	bool poll_dispatch(std::vector<GPollFD> &fds);
 	/** Return whether the session is running. */
 	bool is_running() const;
+	/** Get throughput and latency statistics of the current or most
+	 * recent run, by counter name (e.g. "logic_samples"). */
+	std::map<std::string, uint64_t> stats() const;
 	/** Set callback to be invoked on session stop. */
 	void set_stopped_callback(SessionStoppedCallback callback);
 	/** Get current trigger setting. */
@@ -673,7 +753,13 @@ private:
 	Packet(std::shared_ptr<Device> device,
 		const struct sr_datafeed_packet *structure);
 	~Packet();
+	void rebind(std::shared_ptr<Device> device,
+		const struct sr_datafeed_packet *structure);
+	template <class Payload, class Structure>
+	void rebind_payload(const void *structure);
 	const struct sr_datafeed_packet *_structure;
+	/* The packet copy which this wrapper holds a reference to, if any. */
+	struct sr_datafeed_packet *_copy;
 	std::shared_ptr<Device> _device;
 	std::unique_ptr<PacketPayload> _payload;
 
@@ -683,8 +769,10 @@ private:
 	friend class Header;
 	friend class Meta;
 	friend class Logic;
+	friend class LogicRLE;
 	friend class Analog;
 	friend class Context;
+	friend class LogicEdges;
 	friend struct std::default_delete<Packet>;
 };
 
@@ -741,6 +829,74 @@ private:
 	friend class Packet;
 };
 
+/** Non-owning view of contiguous elements, in the way of std::span. */
+template <class T>
+class Span
+{
+public:
+	typedef T value_type;
+	typedef T *iterator;
+	Span() : _data(nullptr), _size(0) {}
+	Span(T *data, size_t size) : _data(data), _size(size) {}
+	/** Pointer to the first element. */
+	T *data() const { return _data; }
+	/** Number of elements. */
+	size_t size() const { return _size; }
+	bool empty() const { return _size == 0; }
+	T *begin() const { return _data; }
+	T *end() const { return _data + _size; }
+	T &operator[](size_t index) const { return _data[index]; }
+private:
+	T *_data;
+	size_t _size;
+};
+
+/** Non-owning view of the samples of one logic channel, as bools. */
+class SR_API LogicChannelView
+{
+public:
+	class iterator
+	{
+	public:
+		typedef std::input_iterator_tag iterator_category;
+		typedef bool value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const bool *pointer;
+		typedef bool reference;
+		iterator(const uint8_t *p, size_t stride, uint8_t mask) :
+			_p(p), _stride(stride), _mask(mask) {}
+		bool operator*() const { return (*_p & _mask) != 0; }
+		iterator &operator++() { _p += _stride; return *this; }
+		iterator operator++(int) { iterator old(*this); ++*this; return old; }
+		bool operator==(const iterator &other) const { return _p == other._p; }
+		bool operator!=(const iterator &other) const { return _p != other._p; }
+	private:
+		const uint8_t *_p;
+		size_t _stride;
+		uint8_t _mask;
+	};
+	LogicChannelView(const uint8_t *data, size_t size, size_t stride,
+			uint8_t mask) :
+		_data(data), _size(size), _stride(stride), _mask(mask) {}
+	/** Number of samples. */
+	size_t size() const { return _size; }
+	bool empty() const { return _size == 0; }
+	iterator begin() const { return iterator(_data, _stride, _mask); }
+	iterator end() const
+	{
+		return iterator(_data + _size * _stride, _stride, _mask);
+	}
+	bool operator[](size_t index) const
+	{
+		return (_data[index * _stride] & _mask) != 0;
+	}
+private:
+	const uint8_t *_data;
+	size_t _size;
+	size_t _stride;
+	uint8_t _mask;
+};
+
 /** Payload of a datafeed packet with logic data */
 class SR_API Logic :
 	public ParentOwned<Logic, Packet>,
@@ -753,6 +909,18 @@ public:
 	size_t data_length() const;
 	/* Size of each sample in bytes. */
 	unsigned int unit_size() const;
+	/** The sample data, valid as long as the packet. */
+	Span<const uint8_t> data() const;
+	/** The samples of one channel, valid as long as the packet.
+	 * @param index Bit position of the channel in the samples. */
+	LogicChannelView channel_samples(unsigned int index) const;
+	/** The samples of each channel as a bit plane, sample i in bit
+	 * (i % 64) of word (i / 64). One plane per bit of the unit size. */
+	std::vector<std::vector<uint64_t> > bit_planes() const;
+	/** Set the samples from bit planes, see bit_planes().
+	 * @param planes One plane per bit of the unit size, each with at
+	 * least one bit per sample. */
+	void set_bit_planes(const std::vector<std::vector<uint64_t> > &planes);
 private:
 	explicit Logic(const struct sr_datafeed_logic *structure);
 	~Logic();
@@ -765,6 +933,123 @@ private:
 	friend struct std::default_delete<Logic>;
 };
 
+/** Payload of a datafeed packet with run-length encoded logic data */
+class SR_API LogicRLE :
+	public ParentOwned<LogicRLE, Packet>,
+	public PacketPayload
+{
+public:
+	/* Number of samples. */
+	uint64_t num_samples() const;
+	/* Size of each sample in bytes. */
+	unsigned int unit_size() const;
+	/** Sample offsets of the value changes, valid as long as the packet. */
+	Span<const uint64_t> offsets() const;
+	/** Values of the changes, unit size bytes each, valid as long as
+	 * the packet. */
+	Span<const uint8_t> values() const;
+	/** The samples, expanded to one unit per sample. */
+	std::vector<uint8_t> expand() const;
+private:
+	explicit LogicRLE(const struct sr_datafeed_logic_rle *structure);
+	~LogicRLE();
+	std::shared_ptr<PacketPayload> share_owned_by(std::shared_ptr<Packet> parent);
+
+	const struct sr_datafeed_logic_rle *_structure;
+
+	friend class Packet;
+	friend struct std::default_delete<LogicRLE>;
+};
+
+/** Collector of the edges of logic channels */
+class SR_API LogicEdges : public UserOwned<LogicEdges>
+{
+public:
+	/** Collect the edges in a logic packet.
+	 * @param packet Logic packet, packets of a stream in order. */
+	void feed(std::shared_ptr<Packet> packet);
+	/** Sample numbers of the collected edges of a channel.
+	 * @param channel Bit position of the channel. */
+	std::vector<uint64_t> edges(unsigned int channel) const;
+	/** Whether the first collected edge of a channel is a rising one.
+	 * @param channel Bit position of the channel. */
+	bool first_edge_rising(unsigned int channel) const;
+	/** Drop the collected edges, but for the most recent ones.
+	 * @param keep Number of edges to keep per channel. */
+	void clear(size_t keep = 0);
+	/** Pulse timing of a channel, in samples, by name. Empty without a
+	 * complete period.
+	 * @param channel Bit position of the channel. */
+	std::map<std::string, double> timing(unsigned int channel) const;
+private:
+	explicit LogicEdges(unsigned int num_channels);
+	~LogicEdges();
+	struct sr_logic_edges *_structure;
+	friend class Context;
+	friend struct std::default_delete<LogicEdges>;
+};
+
+/**
+ * Values of one analog channel, converted to float when iterated.
+ *
+ * The values get converted a block at a time, into a buffer of the range,
+ * so no allocation is needed whatever the size of the packet. The range
+ * is valid as long as the packet. Iterators share the range's buffer.
+ */
+class SR_API AnalogFloatRange
+{
+public:
+	/** Number of values converted at a time. */
+	static const size_t block_size = 1024;
+	class iterator
+	{
+	public:
+		typedef std::input_iterator_tag iterator_category;
+		typedef float value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const float *pointer;
+		typedef float reference;
+		iterator(AnalogFloatRange *range, size_t index) :
+			_range(range), _index(index) {}
+		float operator*() const { return _range->value(_index); }
+		iterator &operator++() { _index++; return *this; }
+		iterator operator++(int) { iterator old(*this); ++*this; return old; }
+		bool operator==(const iterator &other) const { return _index == other._index; }
+		bool operator!=(const iterator &other) const { return _index != other._index; }
+	private:
+		AnalogFloatRange *_range;
+		size_t _index;
+	};
+	/** Number of values. */
+	size_t size() const;
+	bool empty() const { return size() == 0; }
+	iterator begin() { return iterator(this, 0); }
+	iterator end() { return iterator(this, size()); }
+	/** Convert the values of a block, for algorithms which work on
+	 * arrays. Valid until the next use of the range.
+	 * @param start Index of the first value, a multiple of block_size.
+	 * @return Up to block_size values. */
+	Span<const float> block(size_t start);
+private:
+	AnalogFloatRange(const struct sr_datafeed_analog *structure,
+		unsigned int channel);
+	float value(size_t index)
+	{
+		if (index - _start >= _count)
+			convert(index - index % block_size);
+		return _values[index - _start];
+	}
+	void convert(size_t start);
+
+	const struct sr_datafeed_analog *_structure;
+	unsigned int _channel;
+	size_t _start;
+	size_t _count;
+	float _values[block_size];
+
+	friend class Analog;
+};
+
 /** Payload of a datafeed packet with analog data */
 class SR_API Analog :
 	public ParentOwned<Analog, Packet>,
@@ -778,6 +1063,39 @@ public:
 	 * The pointer must have space for num_samples() floats.
 	 */
 	void get_data_as_float(float *dest);
+	/**
+	 * Fills dest pointer with the data of a single channel, converted
+	 * to float. The pointer must have space for num_samples() floats,
+	 * which are stride floats apart.
+	 * @param dest Destination buffer.
+	 * @param channel Index of the channel in channels().
+	 * @param stride Distance between values in dest, in floats.
+	 */
+	void get_data_as_float(float *dest, unsigned int channel,
+		size_t stride = 1);
+	/**
+	 * Fills dest pointer with the analog data converted to double.
+	 * The pointer must have space for num_samples() doubles.
+	 */
+	void get_data_as_double(double *dest);
+	/**
+	 * Fills dest pointer with the data of a single channel, converted
+	 * to double. The pointer must have space for num_samples() doubles,
+	 * which are stride doubles apart.
+	 * @param dest Destination buffer.
+	 * @param channel Index of the channel in channels().
+	 * @param stride Distance between values in dest, in doubles.
+	 */
+	void get_data_as_double(double *dest, unsigned int channel,
+		size_t stride = 1);
+	/** The raw sample data, valid as long as the packet. */
+	Span<const uint8_t> data() const;
+	/**
+	 * The values of a single channel, converted to float in blocks
+	 * while iterating.
+	 * @param channel Index of the channel in channels().
+	 */
+	AnalogFloatRange channel_values(unsigned int channel) const;
 	/** Number of samples in this packet. */
 	unsigned int num_samples() const;
 	/** Channels for which this packet contains data. */
@@ -907,6 +1225,12 @@ public:
 	 * @param data Next stream data.
 	 * @param length Length of data. */
 	void send(void *data, size_t length);
+	/** Send next stream data without copying it. Packets may point into
+	 * the data, and their consumers may modify it in place.
+	 * @param data Next stream data, which only needs to stay valid
+	 * until this returns.
+	 * @param length Length of data. */
+	void send_in_place(void *data, size_t length);
 	/** Signal end of input data. */
 	void end();
 	void reset();
@@ -1009,12 +1333,27 @@ private:
 };
 
 /** An output instance (an output format applied to a device) */
+/** Type of output write callback */
+typedef std::function<void(const void *data, size_t length)>
+	OutputWriteFunction;
+
 class SR_API Output : public UserOwned<Output>
 {
 public:
 	/** Update output with data from the given packet.
 	 * @param packet Packet to handle. */
 	std::string receive(std::shared_ptr<Packet> packet);
+	/** Update output with data from the given packet, passing the output
+	 * on as it gets written, without copies of sample data.
+	 * @param packet Packet to handle.
+	 * @param write Callback of the form write(data, length). The data is
+	 * only valid during the call. */
+	void receive(std::shared_ptr<Packet> packet, OutputWriteFunction write);
+	/** Update output with data from the given packet, appending the output
+	 * to a buffer which the caller can re-use.
+	 * @param packet Packet to handle.
+	 * @param buffer Buffer to append the output to. */
+	void receive(std::shared_ptr<Packet> packet, std::string &buffer);
 	/** Output format in use for this output */
 	std::shared_ptr<OutputFormat> format();
 private:
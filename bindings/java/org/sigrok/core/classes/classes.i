@@ -36,6 +36,7 @@
 
 import org.sigrok.core.interfaces.LogCallback;
 import org.sigrok.core.interfaces.DatafeedCallback;
+import org.sigrok.core.interfaces.DatafeedBatchCallback;
 %}
 
 /* Map Glib::VariantBase to a Variant class in Java */
@@ -322,7 +323,8 @@ typedef jobject jlogcallback;
 /* Support Java datafeed callbacks. */
 
 %typemap(javaimports) sigrok::Session
-  "import org.sigrok.core.interfaces.DatafeedCallback;"
+  "import org.sigrok.core.interfaces.DatafeedCallback;
+import org.sigrok.core.interfaces.DatafeedBatchCallback;"
 
 %inline {
 typedef jobject jdatafeedcallback;
@@ -372,6 +374,256 @@ typedef jobject jdatafeedcallback;
   }
 }
 
+/* Support batched Java datafeed callbacks. */
+
+%inline {
+typedef jobject jdatafeedbatchcallback;
+}
+
+%typemap(jni) jdatafeedbatchcallback "jdatafeedbatchcallback"
+%typemap(jtype) jdatafeedbatchcallback "DatafeedBatchCallback"
+%typemap(jstype) jdatafeedbatchcallback "DatafeedBatchCallback"
+%typemap(javain) jdatafeedbatchcallback "$javainput"
+
+%{
+namespace {
+  /* Packets collected for one call of a batched datafeed callback. */
+  class DatafeedBatch
+  {
+    public:
+      DatafeedBatch(JavaVM *jvm, jobject obj, size_t max_packets,
+          unsigned int max_latency_ms);
+      void add(std::shared_ptr<sigrok::Device> device,
+          std::shared_ptr<sigrok::Packet> packet);
+    private:
+      void flush();
+      JavaVM *jvm;
+      GlobalRef<jobject> obj_ref;
+      jmethodID method;
+      GlobalRef<jclass> Device;
+      jmethodID Device_init;
+      GlobalRef<jclass> Packet;
+      jmethodID Packet_init;
+      size_t max_packets;
+      gint64 max_latency_us;
+      gint64 since_us;
+      std::vector<std::shared_ptr<sigrok::Device> > devices;
+      std::vector<std::shared_ptr<sigrok::Packet> > packets;
+  };
+  DatafeedBatch::DatafeedBatch(JavaVM *jvm, jobject obj, size_t max_packets,
+      unsigned int max_latency_ms) :
+    jvm(jvm), obj_ref(jvm, obj),
+    Device(jvm, ScopedEnv(jvm)->FindClass("org/sigrok/core/classes/Device")),
+    Packet(jvm, ScopedEnv(jvm)->FindClass("org/sigrok/core/classes/Packet")),
+    max_packets(max_packets ? max_packets : 1),
+    max_latency_us(max_latency_ms * (gint64)1000), since_us(0)
+  {
+    ScopedEnv env(jvm);
+    method = env->GetMethodID(env->GetObjectClass(obj), "run",
+      "([Lorg/sigrok/core/classes/Device;[Lorg/sigrok/core/classes/Packet;)V");
+    Device_init = env->GetMethodID(Device, "<init>", "(JZ)V");
+    Packet_init = env->GetMethodID(Packet, "<init>", "(JZ)V");
+  }
+  void DatafeedBatch::add(std::shared_ptr<sigrok::Device> device,
+      std::shared_ptr<sigrok::Packet> packet)
+  {
+    bool end = (packet->type() == sigrok::PacketType::END);
+    if (packets.empty())
+      since_us = g_get_monotonic_time();
+    devices.push_back(device);
+    packets.push_back(packet);
+    if (end || packets.size() >= max_packets
+        || g_get_monotonic_time() - since_us >= max_latency_us)
+      flush();
+  }
+  void DatafeedBatch::flush()
+  {
+    ScopedEnv env(jvm);
+    if (!env)
+      throw sigrok::Error(SR_ERR);
+    jsize count = packets.size();
+    jobjectArray device_objs = env->NewObjectArray(count, Device, NULL);
+    jobjectArray packet_objs = env->NewObjectArray(count, Packet, NULL);
+    for (jsize i = 0; i < count; i++)
+    {
+      jlong device_addr = 0;
+      jlong packet_addr = 0;
+      *(std::shared_ptr<sigrok::Device> **) &device_addr =
+        new std::shared_ptr<sigrok::Device>(devices[i]);
+      *(std::shared_ptr<sigrok::Packet> **) &packet_addr =
+        new std::shared_ptr<sigrok::Packet>(packets[i]);
+      /* Don't run out of local references on large batches. */
+      jobject device_obj = env->NewObject(
+        Device, Device_init, device_addr, true);
+      jobject packet_obj = env->NewObject(
+        Packet, Packet_init, packet_addr, true);
+      env->SetObjectArrayElement(device_objs, i, device_obj);
+      env->SetObjectArrayElement(packet_objs, i, packet_obj);
+      env->DeleteLocalRef(device_obj);
+      env->DeleteLocalRef(packet_obj);
+    }
+    devices.clear();
+    packets.clear();
+    env->CallVoidMethod(obj_ref, method, device_objs, packet_objs);
+    env->DeleteLocalRef(device_objs);
+    env->DeleteLocalRef(packet_objs);
+    if (env->ExceptionCheck())
+      throw sigrok::Error(SR_ERR);
+  }
+}
+%}
+
+%extend sigrok::Session
+{
+  /* Call obj with arrays of devices and packets, once per batch. A batch
+   * is full at max_packets packets, when a packet arrives after the
+   * first one waited max_latency_ms, or at the end of the acquisition.
+   * The packets are copies which stay valid after the call. */
+  void add_datafeed_batch_callback(JNIEnv *env, jdatafeedbatchcallback obj,
+    unsigned int max_packets, unsigned int max_latency_ms)
+  {
+    JavaVM *jvm = NULL;
+    env->GetJavaVM(&jvm);
+    auto batch = std::make_shared<DatafeedBatch>(jvm, obj,
+      max_packets, max_latency_ms);
+
+    $self->add_datafeed_callback([=] (
+      std::shared_ptr<sigrok::Device> device,
+      std::shared_ptr<sigrok::Packet> packet)
+    {
+      batch->add(device, packet);
+    },
+    [] (std::function<void()> call) { call(); });
+  }
+}
+
+/*
+ * Direct buffers over packet memory, without copying. A buffer keeps
+ * its payload, and with it the packet, alive while it is reachable.
+ * The data of packets passed to a plain datafeed callback is only
+ * valid until the callback returns, batched callbacks get copies.
+ */
+
+%inline {
+typedef jobject jdirectbuffer;
+}
+
+%typemap(jni) jdirectbuffer "jobject"
+%typemap(jtype) jdirectbuffer "java.nio.ByteBuffer"
+%typemap(jstype) jdirectbuffer "java.nio.ByteBuffer"
+%typemap(javain) jdirectbuffer "$javainput"
+%typemap(out) jdirectbuffer %{ $result = $1; %}
+%typemap(javaout) jdirectbuffer {
+    return $jnicall;
+  }
+
+%typemap(javacode) sigrok::Packet %{
+  /* Payloads kept by the buffers which view their memory. */
+  private static final java.lang.ref.ReferenceQueue<java.nio.Buffer>
+    viewQueue = new java.lang.ref.ReferenceQueue<java.nio.Buffer>();
+  private static final java.util.Set<ViewReference> views =
+    java.util.Collections.synchronizedSet(
+      new java.util.HashSet<ViewReference>());
+
+  private static final class ViewReference
+    extends java.lang.ref.PhantomReference<java.nio.Buffer>
+  {
+    private final Object owner;
+    ViewReference(java.nio.Buffer view, Object owner)
+    {
+      super(view, viewQueue);
+      this.owner = owner;
+    }
+  }
+
+  static <T extends java.nio.Buffer> T keepAlive(T view, Object owner)
+  {
+    java.lang.ref.Reference<? extends java.nio.Buffer> ref;
+    while ((ref = viewQueue.poll()) != null)
+      views.remove(ref);
+    views.add(new ViewReference(view, owner));
+    return view;
+  }
+%}
+
+%extend sigrok::Logic
+{
+  jdirectbuffer _data_buffer(JNIEnv *env)
+  {
+    auto data = $self->data();
+    return env->NewDirectByteBuffer(
+      const_cast<uint8_t *>(data.data()), data.size());
+  }
+}
+
+%typemap(javacode) sigrok::Logic %{
+  /** Direct view of the samples, unit size bytes each. */
+  public java.nio.ByteBuffer getDataBuffer()
+  {
+    return Packet.keepAlive(_data_buffer(), this);
+  }
+%}
+
+%extend sigrok::Analog
+{
+  jdirectbuffer _data_buffer(JNIEnv *env)
+  {
+    auto data = $self->data();
+    return env->NewDirectByteBuffer(
+      const_cast<uint8_t *>(data.data()), data.size());
+  }
+
+  bool _is_native_float()
+  {
+%#ifdef WORDS_BIGENDIAN
+    bool host_be = true;
+%#else
+    bool host_be = false;
+%#endif
+    auto scale = $self->scale();
+    auto offset = $self->offset();
+    return $self->is_float() && $self->unitsize() == sizeof(float)
+      && $self->is_bigendian() == host_be
+      && scale->numerator() == (int64_t)scale->denominator()
+      && offset->numerator() == 0;
+  }
+
+  /* Convert the values to float into a direct buffer. */
+  void _data_into(JNIEnv *env, jdirectbuffer buffer)
+  {
+    auto dest = static_cast<float *>(env->GetDirectBufferAddress(buffer));
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (!dest || capacity < (jlong)($self->num_samples()
+        * $self->channels().size() * sizeof(float)))
+      throw sigrok::Error(SR_ERR_ARG);
+    $self->get_data_as_float(dest);
+  }
+}
+
+%typemap(javacode) sigrok::Analog %{
+  /** Direct view of the raw sample data, as encoded by the device. */
+  public java.nio.ByteBuffer getDataBuffer()
+  {
+    return Packet.keepAlive(_data_buffer(), this);
+  }
+
+  /**
+   * The values of all channels as floats, interleaved. A direct view
+   * if the data is native floats already, else converted into a new
+   * direct buffer.
+   */
+  public java.nio.FloatBuffer getFloatBuffer()
+  {
+    if (_is_native_float())
+      return Packet.keepAlive(_data_buffer()
+        .order(java.nio.ByteOrder.nativeOrder()).asFloatBuffer(), this);
+    java.nio.ByteBuffer buffer = java.nio.ByteBuffer.allocateDirect(
+      getNum_samples() * getChannels().size() * 4);
+    _data_into(buffer);
+    return buffer.order(java.nio.ByteOrder.nativeOrder()).asFloatBuffer();
+  }
+%}
+
 %include "doc.i"
 
 %define %enumextras(Class)
@@ -48,6 +48,7 @@ which provides access to the error code and description."
 #include "config.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <pygobject.h>
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #include <numpy/arrayobject.h>
@@ -273,6 +274,10 @@ typedef guint pyg_flags_type;
     {
         return dynamic_pointer_cast<sigrok::Logic>($self->payload());
     }
+    std::shared_ptr<sigrok::LogicRLE> _payload_logic_rle()
+    {
+        return dynamic_pointer_cast<sigrok::LogicRLE>($self->payload());
+    }
 }
 
 %extend sigrok::Packet
@@ -286,6 +291,8 @@ typedef guint pyg_flags_type;
             return self._payload_meta()
         elif self.type == PacketType.LOGIC:
             return self._payload_logic()
+        elif self.type == PacketType.LOGIC_RLE:
+            return self._payload_logic_rle()
         elif self.type == PacketType.ANALOG:
             return self._payload_analog()
         else:
@@ -396,8 +403,121 @@ std::map<std::string, Glib::VariantBase> dict_to_map_options(PyObject *dict,
     return output;
 }
 
+/*
+ * Packets collected for a batched datafeed callback, which gets called
+ * with a list of (device, packet) tuples. That takes the GIL once per
+ * batch instead of once per packet.
+ */
+class DatafeedBatch
+{
+public:
+    DatafeedBatch(PyObject *callback, size_t max_packets,
+            unsigned int max_latency_ms) :
+        _callback(callback),
+        _max_packets(max_packets ? max_packets : 1),
+        _max_latency_us(max_latency_ms * (gint64)1000),
+        _since_us(0)
+    {
+    }
+
+    void add(std::shared_ptr<sigrok::Device> device,
+        std::shared_ptr<sigrok::Packet> packet)
+    {
+        bool end = (packet->type() == sigrok::PacketType::END);
+
+        if (_pending.empty())
+            _since_us = g_get_monotonic_time();
+        _pending.emplace_back(move(device), move(packet));
+
+        if (end || _pending.size() >= _max_packets
+                || g_get_monotonic_time() - _since_us >= _max_latency_us)
+            flush();
+    }
+
+private:
+    void flush()
+    {
+        std::vector<std::pair<std::shared_ptr<sigrok::Device>,
+            std::shared_ptr<sigrok::Packet> > > batch;
+        batch.swap(_pending);
+
+        auto gstate = PyGILState_Ensure();
+
+        auto list = PyList_New(batch.size());
+        for (size_t i = 0; list && i < batch.size(); i++) {
+            auto device_obj = SWIG_NewPointerObj(
+                SWIG_as_voidptr(new std::shared_ptr<sigrok::Device>(
+                    batch[i].first)),
+                SWIGTYPE_p_std__shared_ptrT_sigrok__Device_t,
+                SWIG_POINTER_OWN);
+            auto packet_obj = SWIG_NewPointerObj(
+                SWIG_as_voidptr(new std::shared_ptr<sigrok::Packet>(
+                    batch[i].second)),
+                SWIGTYPE_p_std__shared_ptrT_sigrok__Packet_t,
+                SWIG_POINTER_OWN);
+            PyList_SET_ITEM(list, i, Py_BuildValue("(NN)",
+                device_obj, packet_obj));
+        }
+
+        PyObject *result = nullptr;
+        if (list)
+            result = PyObject_CallFunctionObjArgs(_callback, list, nullptr);
+        Py_XDECREF(list);
+
+        bool completed = !PyErr_Occurred();
+
+        if (!completed)
+            PyErr_Print();
+
+        bool valid_result = (completed && result == Py_None);
+
+        Py_XDECREF(result);
+
+        if (completed && !valid_result)
+        {
+            PyErr_SetString(PyExc_TypeError,
+                "Datafeed callback did not return None");
+            PyErr_Print();
+        }
+
+        PyGILState_Release(gstate);
+
+        if (!valid_result)
+            throw sigrok::Error(SR_ERR);
+    }
+
+    PyObject *_callback;
+    size_t _max_packets;
+    gint64 _max_latency_us;
+    gint64 _since_us;
+    std::vector<std::pair<std::shared_ptr<sigrok::Device>,
+        std::shared_ptr<sigrok::Packet> > > _pending;
+};
+
 %}
 
+/*
+ * Release the GIL while the session runs, so that other Python threads
+ * keep going. Callbacks take it back while they run.
+ */
+%define %nogil(Method)
+%exception Method {
+    PyThreadState *save = PyEval_SaveThread();
+    try {
+        $action
+    } catch (sigrok::Error &e) {
+        PyEval_RestoreThread(save);
+        SWIG_exception(swig_exception_code(e.result),
+            const_cast<char*>(e.what()));
+    }
+    PyEval_RestoreThread(save);
+}
+%enddef
+
+%nogil(sigrok::Session::start);
+%nogil(sigrok::Session::run);
+%nogil(sigrok::Session::stop);
+
 /* Ignore these methods, we will override them below. */
 %ignore sigrok::Analog::data;
 %ignore sigrok::Logic::data;
@@ -539,37 +659,203 @@ std::map<std::string, Glib::VariantBase> dict_to_map_options(PyObject *dict,
     }
 }
 
-/* Return NumPy array from Analog::data(). */
+%{
+
+/* Destructor of the capsules which keep packets alive. */
+static void packet_capsule_destroy(PyObject *capsule)
+{
+    delete static_cast<std::shared_ptr<sigrok::Packet> *>(
+        PyCapsule_GetPointer(capsule, nullptr));
+}
+
+/*
+ * Wrap packet data in a NumPy array without copying it. The array's base
+ * object holds a reference to the packet, so the packet lives as long
+ * as the array does.
+ */
+static PyObject *packet_array(std::shared_ptr<sigrok::Packet> packet,
+    PyArray_Descr *descr, int nd, npy_intp *dims, npy_intp *strides,
+    void *data)
+{
+    auto array = PyArray_NewFromDescr(&PyArray_Type, descr, nd, dims,
+        strides, data, NPY_ARRAY_WRITEABLE, nullptr);
+    if (!array)
+        return nullptr;
+
+    auto capsule = PyCapsule_New(new std::shared_ptr<sigrok::Packet>(packet),
+        nullptr, packet_capsule_destroy);
+    if (!capsule || PyArray_SetBaseObject((PyArrayObject *)array, capsule) < 0)
+    {
+        Py_XDECREF(capsule);
+        Py_DECREF(array);
+        return nullptr;
+    }
+
+    return array;
+}
+
+/* NumPy type of the raw values of an analog packet, or NPY_NOTYPE. */
+static int analog_raw_typenum(sigrok::Analog *analog)
+{
+    if (analog->is_float())
+        switch (analog->unitsize())
+        {
+            case 4: return NPY_FLOAT32;
+            case 8: return NPY_FLOAT64;
+            default: return NPY_NOTYPE;
+        }
+
+    switch (analog->unitsize())
+    {
+        case 1: return analog->is_signed() ? NPY_INT8 : NPY_UINT8;
+        case 2: return analog->is_signed() ? NPY_INT16 : NPY_UINT16;
+        case 4: return analog->is_signed() ? NPY_INT32 : NPY_UINT32;
+        case 8: return analog->is_signed() ? NPY_INT64 : NPY_UINT64;
+        default: return NPY_NOTYPE;
+    }
+}
+
+/* Check whether the raw values of an analog packet are the float values. */
+static bool analog_is_native_float(sigrok::Analog *analog)
+{
+#ifdef WORDS_BIGENDIAN
+    bool host_be = true;
+#else
+    bool host_be = false;
+#endif
+    auto scale = analog->scale();
+    auto offset = analog->offset();
+
+    return analog->is_float() && analog->unitsize() == sizeof(float)
+        && analog->is_bigendian() == host_be
+        && scale->numerator() == (int64_t)scale->denominator()
+        && offset->numerator() == 0;
+}
+
+%}
+
+/*
+ * Return NumPy arrays from Analog and Logic data.
+ *
+ * Arrays which share memory with the packet keep the packet alive. Note
+ * that the data of packets received by a datafeed callback is only valid
+ * until the callback returns, use numpy.copy() to keep it for longer.
+ */
 %extend sigrok::Analog
 {
+    /* Raw values, shaped (channels, samples), without copying. */
+    PyObject * _raw_data()
+    {
+        int typenum = analog_raw_typenum($self);
+        if (typenum == NPY_NOTYPE)
+        {
+            PyErr_SetString(PyExc_TypeError, "Unsupported analog encoding");
+            return nullptr;
+        }
+        auto native = PyArray_DescrFromType(typenum);
+        auto descr = PyArray_DescrNewByteorder(native,
+            $self->is_bigendian() ? NPY_BIG : NPY_LITTLE);
+        Py_DECREF(native);
+        if (!descr)
+            return nullptr;
+
+        npy_intp dims[2], strides[2];
+        dims[0] = $self->channels().size();
+        dims[1] = $self->num_samples();
+        strides[0] = $self->unitsize();
+        strides[1] = $self->unitsize() * dims[0];
+        return packet_array($self->parent(), descr, 2, dims, strides,
+            $self->data_pointer());
+    }
+
+    /*
+     * Float values, shaped (channels, samples). Shares memory with the
+     * packet when its values need no conversion, else is a new array.
+     */
     PyObject * _data()
     {
-        int nd = 2;
         npy_intp dims[2];
         dims[0] = $self->channels().size();
         dims[1] = $self->num_samples();
-        int typenum = NPY_FLOAT;
-        void *data = $self->data_pointer();
-        return PyArray_SimpleNewFromData(nd, dims, typenum, data);
+
+        if (analog_is_native_float($self))
+        {
+            npy_intp strides[2];
+            strides[0] = sizeof(float);
+            strides[1] = sizeof(float) * dims[0];
+            return packet_array($self->parent(),
+                PyArray_DescrFromType(NPY_FLOAT32), 2, dims, strides,
+                $self->data_pointer());
+        }
+
+        auto array = PyArray_SimpleNew(2, dims, NPY_FLOAT32);
+        if (!array)
+            return nullptr;
+        auto dest = static_cast<float *>(
+            PyArray_DATA((PyArrayObject *)array));
+        try {
+            for (npy_intp c = 0; c < dims[0]; c++)
+                $self->get_data_as_float(dest + c * dims[1], c);
+        } catch (...) {
+            Py_DECREF(array);
+            throw;
+        }
+        return array;
+    }
+
+    /*
+     * Convert the values to float into a pre-allocated, writable buffer
+     * of at least channels * samples floats, laid out like data.
+     */
+    PyObject * data_into(PyObject *buf)
+    {
+        Py_buffer view;
+        if (PyObject_GetBuffer(buf, &view,
+                PyBUF_WRITABLE | PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) < 0)
+            return nullptr;
+
+        size_t num_channels = $self->channels().size();
+        size_t num_samples = $self->num_samples();
+        if (view.itemsize != sizeof(float) || !view.format
+            || strcmp(view.format, "f") != 0
+            || (size_t)view.len < num_channels * num_samples * sizeof(float))
+        {
+            PyBuffer_Release(&view);
+            PyErr_SetString(PyExc_ValueError,
+                "Expected a writable float32 buffer of channels * samples items");
+            return nullptr;
+        }
+
+        auto dest = static_cast<float *>(view.buf);
+        try {
+            for (size_t c = 0; c < num_channels; c++)
+                $self->get_data_as_float(dest + c * num_samples, c);
+        } catch (...) {
+            PyBuffer_Release(&view);
+            throw;
+        }
+        PyBuffer_Release(&view);
+
+        Py_RETURN_NONE;
     }
 
 %pythoncode
 {
     data = property(_data)
+    raw_data = property(_raw_data)
 }
 }
 
-/* Return NumPy array from Logic::data(). */
 %extend sigrok::Logic
 {
+    /* Samples, shaped (samples, unit size), without copying. */
     PyObject * _data()
     {
         npy_intp dims[2];
         dims[0] = $self->data_length() / $self->unit_size();
         dims[1] = $self->unit_size();
-        int typenum = NPY_UINT8;
-        void *data = $self->data_pointer();
-        return PyArray_SimpleNewFromData(2, dims, typenum, data);
+        return packet_array($self->parent(), PyArray_DescrFromType(NPY_UINT8),
+            2, dims, nullptr, $self->data_pointer());
     }
 
 %pythoncode
@@ -578,6 +864,228 @@ std::map<std::string, Glib::VariantBase> dict_to_map_options(PyObject *dict,
 }
 }
 
+/* Deliver packets to Python in batches. */
+%extend sigrok::Session
+{
+    void _add_datafeed_batch_callback(PyObject *callback,
+        unsigned int max_packets, unsigned int max_latency_ms)
+    {
+        if (!PyCallable_Check(callback))
+            throw sigrok::Error(SR_ERR_ARG);
+        Py_INCREF(callback);
+
+        auto batch = std::make_shared<DatafeedBatch>(callback,
+            max_packets, max_latency_ms);
+        /* Packets get copied so that they outlive the session callback. */
+        $self->add_datafeed_callback(
+            [batch] (std::shared_ptr<sigrok::Device> device,
+                    std::shared_ptr<sigrok::Packet> packet) {
+                batch->add(move(device), move(packet));
+            },
+            [] (std::function<void()> call) { call(); });
+    }
+
+%pythoncode
+{
+    def add_datafeed_batch_callback(self, callback, max_packets=64,
+            max_latency_ms=100):
+        """Add a datafeed callback which gets called with a list of
+        (device, packet) tuples.
+
+        A batch gets delivered when it holds max_packets packets, when a
+        packet arrives after the first one of the batch waited at least
+        max_latency_ms, and at the end of the acquisition. Unlike with
+        add_datafeed_callback(), the packets and their data arrays stay
+        valid after the callback returned."""
+        self._add_datafeed_batch_callback(callback, max_packets,
+            max_latency_ms)
+}
+}
+
+/* Read the samples of a loaded session file straight into NumPy arrays. */
+%extend sigrok::Session
+{
+    PyObject * _load_samples(std::shared_ptr<sigrok::Device> device,
+        std::shared_ptr<sigrok::Channel> channel, uint64_t offset,
+        int64_t count, bool planes)
+    {
+        auto file_device = dynamic_pointer_cast<sigrok::SessionDevice>(device);
+        if (!file_device)
+            throw sigrok::Error(SR_ERR_ARG);
+        bool analog = channel
+            && channel->type() == sigrok::ChannelType::ANALOG;
+        if (!analog)
+            channel = nullptr;
+
+        uint64_t total = file_device->num_samples(channel);
+        uint64_t num_samples = offset < total ? total - offset : 0;
+        if (count >= 0 && (uint64_t)count < num_samples)
+            num_samples = count;
+
+        size_t unitsize = sizeof(float);
+        if (!analog)
+            unitsize = Glib::VariantBase::cast_dynamic<Glib::Variant<guint64> >(
+                file_device->config_get(sigrok::ConfigKey::CAPTURE_UNITSIZE)).get();
+
+        /* Analog values shape (samples,), logic words (samples, unit size). */
+        npy_intp dims[2];
+        dims[0] = num_samples;
+        dims[1] = unitsize;
+        auto array = analog ? PyArray_SimpleNew(1, dims, NPY_FLOAT32)
+            : PyArray_SimpleNew(2, dims, NPY_UINT8);
+        if (!array)
+            return nullptr;
+        void *buf = PyArray_DATA((PyArrayObject *)array);
+
+        int ret = SR_OK;
+        PyThreadState *save = PyEval_SaveThread();
+        try {
+            file_device->read_samples(channel, offset, num_samples, buf);
+        } catch (sigrok::Error &e) {
+            ret = e.result;
+        }
+        PyEval_RestoreThread(save);
+        if (ret != SR_OK) {
+            Py_DECREF(array);
+            throw sigrok::Error(ret);
+        }
+        if (analog || !planes)
+            return array;
+
+        /* One plane per channel, samples packed 8 per byte (LSB first). */
+        struct sr_datafeed_logic logic;
+        logic.length = num_samples * unitsize;
+        logic.unitsize = unitsize;
+        logic.data = buf;
+        dims[0] = 8 * unitsize;
+        dims[1] = sr_logic_plane_size(num_samples);
+        auto plane_array = PyArray_SimpleNew(2, dims, NPY_UINT8);
+        if (plane_array)
+            ret = sr_logic_to_planes(&logic, static_cast<uint8_t *>(
+                PyArray_DATA((PyArrayObject *)plane_array)), dims[1]);
+        Py_DECREF(array);
+        if (plane_array && ret != SR_OK) {
+            Py_DECREF(plane_array);
+            throw sigrok::Error(ret);
+        }
+        return plane_array;
+    }
+
+    PyObject * _summary_levels(std::shared_ptr<sigrok::Device> device,
+        std::shared_ptr<sigrok::Channel> channel)
+    {
+        auto file_device = dynamic_pointer_cast<sigrok::SessionDevice>(device);
+        if (!file_device)
+            throw sigrok::Error(SR_ERR_ARG);
+        if (channel && channel->type() != sigrok::ChannelType::ANALOG)
+            channel = nullptr;
+        unsigned int shift = 0;
+        unsigned int levels = file_device->summary_levels(channel, &shift);
+        return Py_BuildValue("(II)", levels, shift);
+    }
+
+    /* Analog entries shape (entries, 2) of min and max, logic entries
+     * shape (entries, 3) of high, low and transitions. */
+    PyObject * _load_summary(std::shared_ptr<sigrok::Device> device,
+        std::shared_ptr<sigrok::Channel> channel, unsigned int level)
+    {
+        auto file_device = dynamic_pointer_cast<sigrok::SessionDevice>(device);
+        if (!file_device || !channel)
+            throw sigrok::Error(SR_ERR_ARG);
+        bool analog = channel->type() == sigrok::ChannelType::ANALOG;
+        unsigned int shift = 0;
+        unsigned int levels = file_device->summary_levels(
+            analog ? channel : nullptr, &shift);
+        if (level >= levels)
+            throw sigrok::Error(SR_ERR_NA);
+        uint64_t total = file_device->num_samples(analog ? channel : nullptr);
+        uint64_t block = UINT64_C(1) << (shift + level);
+        uint64_t count = (total + block - 1) / block;
+
+        std::vector<struct sr_logic_summary> logic(analog ? 0 : count);
+        std::vector<struct sr_analog_summary> values(analog ? count : 0);
+        int ret = SR_OK;
+        PyThreadState *save = PyEval_SaveThread();
+        try {
+            count = file_device->read_summary(channel, level, 0, count,
+                analog ? (void *)values.data() : (void *)logic.data());
+        } catch (sigrok::Error &e) {
+            ret = e.result;
+        }
+        PyEval_RestoreThread(save);
+        if (ret != SR_OK)
+            throw sigrok::Error(ret);
+
+        npy_intp dims[2];
+        dims[0] = count;
+        dims[1] = analog ? 2 : 3;
+        auto array = PyArray_SimpleNew(2, dims,
+            analog ? NPY_FLOAT32 : NPY_UINT32);
+        if (!array)
+            return nullptr;
+        if (analog) {
+            auto dest = static_cast<float *>(
+                PyArray_DATA((PyArrayObject *)array));
+            for (uint64_t i = 0; i < count; i++) {
+                dest[2 * i] = values[i].min;
+                dest[2 * i + 1] = values[i].max;
+            }
+        } else {
+            auto dest = static_cast<uint32_t *>(
+                PyArray_DATA((PyArrayObject *)array));
+            for (uint64_t i = 0; i < count; i++) {
+                dest[3 * i] = logic[i].high;
+                dest[3 * i + 1] = logic[i].low;
+                dest[3 * i + 2] = logic[i].transitions;
+            }
+        }
+        return array;
+    }
+
+%pythoncode
+{
+    def _file_device(self, device):
+        if device is None:
+            devices = self.devices
+            if len(devices) != 1:
+                raise ValueError("Session has more than one device")
+            device = devices[0]
+        return device
+
+    def load_logic(self, offset=0, count=None, planes=False, device=None):
+        """Read the logic data of a loaded session file into a NumPy
+        array, without running the session.
+
+        Returns an array of unit size wide samples shaped (samples, unit
+        size), or with planes=True one bit plane per channel shaped
+        (channels, bytes), see numpy.unpackbits(bitorder='little'). The
+        chunks of the file get read in parallel."""
+        return self._load_samples(self._file_device(device), None, offset,
+            -1 if count is None else count, planes)
+
+    def load_analog(self, channel, offset=0, count=None, device=None):
+        """Read the samples of an analog channel of a loaded session
+        file into a float32 NumPy array, without running the session."""
+        return self._load_samples(self._file_device(device), channel,
+            offset, -1 if count is None else count, False)
+
+    def summary_levels(self, channel=None, device=None):
+        """Get the number of levels of the summary which a loaded
+        session file carries, and the samples per entry of level 0 as a
+        power of two. (0, 0) if the file has no summary."""
+        return self._summary_levels(self._file_device(device), channel)
+
+    def load_summary(self, channel, level, device=None):
+        """Read a level of the summary of a logic or analog channel of a
+        loaded session file into a NumPy array, for overviews which do
+        not read all of the samples.
+
+        Analog entries are float32 rows of (min, max), logic entries are
+        uint32 rows of (high, low, transitions)."""
+        return self._load_summary(self._file_device(device), channel, level)
+}
+}
+
 /* Create logic packet from Python buffer. */
 %extend sigrok::Context
 {
@@ -205,6 +205,10 @@ static VALUE variant_to_ruby(Glib::VariantBase variant)
             return SWIG_NewPointerObj(
                 SWIG_as_voidptr(new std::shared_ptr<sigrok::Logic>(dynamic_pointer_cast<sigrok::Logic>($self->payload()))),
                 SWIGTYPE_p_std__shared_ptrT_sigrok__Logic_t, SWIG_POINTER_OWN);
+        } else if ($self->type() == sigrok::PacketType::LOGIC_RLE) {
+            return SWIG_NewPointerObj(
+                SWIG_as_voidptr(new std::shared_ptr<sigrok::LogicRLE>(dynamic_pointer_cast<sigrok::LogicRLE>($self->payload()))),
+                SWIGTYPE_p_std__shared_ptrT_sigrok__LogicRLE_t, SWIG_POINTER_OWN);
         } else {
             return Qnil;
         }
@@ -65,6 +65,7 @@ template< class T > class enable_shared_from_this;
 %shared_ptr(sigrok::Meta);
 %shared_ptr(sigrok::Analog);
 %shared_ptr(sigrok::Logic);
+%shared_ptr(sigrok::LogicRLE);
 %shared_ptr(sigrok::InputFormat);
 %shared_ptr(sigrok::Input);
 %shared_ptr(sigrok::InputDevice);
@@ -75,11 +76,32 @@ template< class T > class enable_shared_from_this;
 %shared_ptr(sigrok::TriggerStage);
 %shared_ptr(sigrok::TriggerMatch);
 %shared_ptr(sigrok::UserDevice);
+%shared_ptr(sigrok::LogicEdges);
 
 #define SR_API
 #define SR_PRIV
 
 %ignore sigrok::DatafeedCallbackData;
+%ignore sigrok::Output::receive(std::shared_ptr<sigrok::Packet>,
+    sigrok::OutputWriteFunction);
+%ignore sigrok::Output::receive(std::shared_ptr<sigrok::Packet>,
+    std::string &);
+%ignore sigrok::Span;
+%ignore sigrok::LogicChannelView;
+%ignore sigrok::AnalogFloatRange;
+%ignore sigrok::Logic::data;
+%ignore sigrok::Logic::channel_samples;
+%ignore sigrok::LogicRLE::offsets;
+%ignore sigrok::LogicRLE::values;
+%ignore sigrok::Analog::data;
+%ignore sigrok::Analog::channel_values;
+%ignore sigrok::Session::add_datafeed_callback(sigrok::DatafeedCallbackFunction,
+    sigrok::SessionExecutor);
+%ignore sigrok::Session::poll_prepare;
+%ignore sigrok::Session::poll_dispatch;
+%ignore sigrok::SessionDevice::read_samples;
+%ignore sigrok::SessionDevice::summary_levels;
+%ignore sigrok::SessionDevice::read_summary;
 
 #ifndef SWIGJAVA
 
@@ -26,6 +26,7 @@ using namespace std;
 %include "std_shared_ptr.i"
 %include "std_vector.i"
 %include "std_map.i"
+%include "stdint.i"
 #ifdef SWIGJAVA
 namespace std {
   template <class _Key> class set {};
@@ -35,6 +36,10 @@ namespace std {
 #endif
 
 %template(StringMap) std::map<std::string, std::string>;
+%template(StatsMap) std::map<std::string, uint64_t>;
+%template(TimingMap) std::map<std::string, double>;
+%template(EdgeVector) std::vector<uint64_t>;
+%template(BitPlaneVector) std::vector<std::vector<uint64_t> >;
 
 %template(DriverMap)
     std::map<std::string, std::shared_ptr<sigrok::Driver> >;
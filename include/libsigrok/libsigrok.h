@@ -175,6 +175,8 @@ enum sr_packettype {
 	SR_DF_FRAME_END,
 	/** Payload is struct sr_datafeed_analog. */
 	SR_DF_ANALOG,
+	/** Payload is struct sr_datafeed_logic_rle. */
+	SR_DF_LOGIC_RLE,
 
 	/* Update datafeed_dump() (session.c) upon changes! */
 };
@@ -458,7 +460,8 @@ struct sr_trigger_match {
 	 */
 	int match;
 	/** If the trigger match is one of SR_TRIGGER_OVER or SR_TRIGGER_UNDER,
-	 * this contains the value to compare against. */
+	 * this contains the value to compare against. For edges on analog
+	 * channels, this is the level which the value crosses. */
 	float value;
 };
 
@@ -482,6 +485,311 @@ struct sr_context;
  */
 struct sr_session;
 
+/**
+ * @struct sr_a2l_converter
+ * Opaque structure converting multi-channel analog data to logic data.
+ *
+ * None of the fields of this structure are meant to be accessed directly.
+ *
+ * @see sr_a2l_converter_new(), sr_a2l_converter_free().
+ */
+struct sr_a2l_converter;
+
+/**
+ * @struct sr_recorder
+ * Opaque structure holding the most recent data of a session.
+ *
+ * None of the fields of this structure are meant to be accessed directly.
+ *
+ * @see sr_recorder_new(), sr_recorder_free().
+ */
+struct sr_recorder;
+
+/**
+ * @struct sr_logic_store
+ * Opaque structure holding compressed logic data.
+ *
+ * None of the fields of this structure are meant to be accessed directly.
+ *
+ * @see sr_logic_store_new(), sr_logic_store_free().
+ */
+struct sr_logic_store;
+
+/**
+ * @struct sr_remote_server
+ * Opaque structure serving a session's datafeed over the network.
+ *
+ * None of the fields of this structure are meant to be accessed directly.
+ *
+ * @see sr_remote_server_new(), sr_remote_server_free().
+ */
+struct sr_remote_server;
+
+/**
+ * @struct sr_shm_ring
+ * Opaque structure sharing a session's datafeed through shared memory.
+ *
+ * None of the fields of this structure are meant to be accessed directly.
+ *
+ * @see sr_shm_ring_new(), sr_shm_ring_free().
+ */
+struct sr_shm_ring;
+
+/**
+ * @struct sr_logic_merge
+ * Opaque structure merging the logic data of several devices.
+ *
+ * None of the fields of this structure are meant to be accessed directly.
+ *
+ * @see sr_logic_merge_new(), sr_logic_merge_free().
+ */
+struct sr_logic_merge;
+
+/**
+ * @struct sr_logic_edges
+ * Opaque structure collecting the edges of logic channels.
+ *
+ * None of the fields of this structure are meant to be accessed directly.
+ *
+ * @see sr_logic_edges_new(), sr_logic_edges_free().
+ */
+struct sr_logic_edges;
+
+/** Packet queue statistics of a session in threaded mode.
+ *
+ * @see sr_session_threaded_set(), sr_session_queue_stats_get().
+ */
+struct sr_session_queue_stats {
+	/** Number of packets which were handed to the consumer thread. */
+	uint64_t packets_queued;
+	/** Number of data packets which were dropped, queue was full. */
+	uint64_t packets_dropped;
+	/** Number of times the acquisition had to wait for queue room. */
+	uint64_t producer_stalls;
+	/** Queue capacity in packets. */
+	uint32_t capacity;
+	/** Highest number of packets which were queued at the same time. */
+	uint32_t high_water;
+};
+
+/** Scheduling policies of the acquisition thread, see sr_session_sched_set(). */
+enum sr_session_sched_policy {
+	/** Leave the policy of the thread as it is. */
+	SR_SESSION_SCHED_DEFAULT,
+	/** Real-time, first in first out (SCHED_FIFO). */
+	SR_SESSION_SCHED_FIFO,
+	/** Real-time, round robin (SCHED_RR). */
+	SR_SESSION_SCHED_RR,
+};
+
+/** Scheduling of the acquisition thread, see sr_session_sched_set(). */
+struct sr_session_sched {
+	/**
+	 * CPUs which the thread may run on, bit n for CPU n. 0 leaves
+	 * the affinity of the thread as it is.
+	 */
+	uint64_t cpu_mask;
+	/** Scheduling policy. */
+	enum sr_session_sched_policy policy;
+	/** Priority for the real-time policies, 1 to 99 on Linux. */
+	int priority;
+	/** Lock all memory of the process into RAM while the session runs. */
+	gboolean lock_memory;
+};
+
+/** Number of buckets in the callback time histogram of a session. */
+#define SR_SESSION_STATS_BUCKETS 16
+
+/** Throughput and latency statistics of a session.
+ *
+ * The statistics cover the current (or most recent) session run.
+ *
+ * @see sr_session_stats_get(), sr_session_stats_channel_get().
+ */
+struct sr_session_stats {
+	/**
+	 * Time since the session run started in microseconds, up to the
+	 * last processed packet when the session is not running.
+	 */
+	uint64_t elapsed_us;
+	/** Number of packets which were passed to the datafeed callbacks. */
+	uint64_t packets;
+	/** Number of logic samples. */
+	uint64_t logic_samples;
+	/** Size of the logic samples in bytes. */
+	uint64_t logic_bytes;
+	/** Number of analog samples, summed over all channels. */
+	uint64_t analog_samples;
+	/** Size of the analog samples in bytes. */
+	uint64_t analog_bytes;
+	/** Number of data packets which were dropped, queue was full. */
+	uint64_t packets_dropped;
+	/** Size of the sample data of the dropped packets in bytes. */
+	uint64_t bytes_dropped;
+	/** Time spent in transform modules, in microseconds. */
+	uint64_t transform_us;
+	/** Time spent in datafeed callbacks, in microseconds. */
+	uint64_t callback_us;
+	/** Part of callback_us which was spent in sr_output_send(). */
+	uint64_t output_us;
+	/**
+	 * Histogram of the time all datafeed callbacks took for a packet.
+	 * Bucket 0 counts packets which took less than 1 us, bucket i
+	 * those which took at least 2^(i-1) and less than 2^i us. The last
+	 * bucket also counts all packets which took longer.
+	 */
+	uint64_t callback_hist[SR_SESSION_STATS_BUCKETS];
+	/** Number of packets in the queue of the threaded mode. */
+	uint32_t queue_fill;
+	/** Capacity of the queue of the threaded mode, in packets. */
+	uint32_t queue_capacity;
+	/**
+	 * CPUs which the acquisition thread got pinned to, 0 when it was
+	 * not. See sr_session_sched_set().
+	 */
+	uint64_t sched_cpu_mask;
+	/** Scheduling policy which the acquisition thread got. */
+	enum sr_session_sched_policy sched_policy;
+	/** Its priority, for the real-time policies. */
+	int sched_priority;
+	/** Whether the memory of the process got locked. */
+	gboolean memory_locked;
+};
+
+/** Subsystems which allocations are accounted to, see sr_mem_stats_get(). */
+enum sr_mem_tag {
+	/** Allocations outside of the other subsystems. */
+	SR_MEM_OTHER,
+	/** Hardware drivers, while acquisitions start and data arrives. */
+	SR_MEM_DRIVER,
+	/** Input modules. */
+	SR_MEM_INPUT,
+	/** Output modules. */
+	SR_MEM_OUTPUT,
+	/** Transform modules, and their output buffers. */
+	SR_MEM_TRANSFORM,
+	/** The session, for queued packet copies and expanded data. */
+	SR_MEM_SESSION,
+};
+
+/** Number of subsystems in enum sr_mem_tag. */
+#define SR_MEM_TAGS (SR_MEM_SESSION + 1)
+
+/** Allocation counters of a subsystem.
+ *
+ * @see sr_mem_stats_get().
+ */
+struct sr_mem_stats {
+	/** Size of the allocations which were not released yet, in bytes. */
+	uint64_t live_bytes;
+	/** Highest value of live_bytes. */
+	uint64_t peak_bytes;
+	/** Number of allocations. */
+	uint64_t allocations;
+	/** Number of releases. */
+	uint64_t frees;
+	/** Size of all allocations in bytes. */
+	uint64_t bytes_allocated;
+	/** Time covered by the counters in microseconds. */
+	uint64_t elapsed_us;
+	/** Allocated bytes per second, over elapsed_us. */
+	double alloc_rate;
+};
+
+/**
+ * Position of a data packet within an acquisition.
+ *
+ * The session counts the samples which it passes to the datafeed
+ * callbacks, for each device. Callbacks can get the position of the
+ * packet they were passed instead of counting samples themselves.
+ *
+ * @see sr_session_packet_position().
+ */
+struct sr_datafeed_position {
+	/**
+	 * Index of the packet's first sample, counted from the device's
+	 * SR_DF_HEADER on. Analog channels are counted separately.
+	 */
+	uint64_t sample_index;
+	/** Number of samples in the packet. */
+	uint64_t num_samples;
+	/** Sample rate of the device, 0 if unknown. */
+	uint64_t samplerate;
+	/** Start time of the acquisition, as sent in the SR_DF_HEADER. */
+	struct timeval starttime;
+	/** Sample index of the most recent SR_DF_TRIGGER, or -1. */
+	int64_t trigger_index;
+	/** Number of SR_DF_FRAME_BEGIN packets since the header. */
+	uint64_t frame;
+};
+
+/** Flags for sr_session_load_files(). */
+enum sr_session_load_flags {
+	/** Merge the logic data of all files into one device. */
+	SR_SESSION_LOAD_MERGE_LOGIC = 1 << 0,
+};
+
+/** Flags for sr_session_file_info_get(). */
+enum sr_session_file_info_flags {
+	/**
+	 * Use the "<file>.info" index next to the session file if it is
+	 * current, and write it otherwise.
+	 */
+	SR_SESSION_FILE_INFO_INDEX = 1 << 0,
+};
+
+/**
+ * Summary of a session file, for listing captures without loading them.
+ *
+ * The duration of the capture in seconds is samples / samplerate.
+ *
+ * @see sr_session_file_info_get().
+ */
+struct sr_session_file_info {
+	/** Number of logic channels, enabled or not. */
+	int num_logic_channels;
+	/** Number of analog channels. */
+	int num_analog_channels;
+	/** Size of a logic sample in bytes, 0 without logic data. */
+	int unitsize;
+	/** Sample rate in Hz, 0 if unknown. */
+	uint64_t samplerate;
+	/**
+	 * Number of logic samples, or the number of samples of the first
+	 * analog channel for files without logic data.
+	 */
+	uint64_t samples;
+};
+
+/**
+ * Summary of a block of samples of a logic channel.
+ *
+ * @see sr_session_file_summary_read().
+ */
+struct sr_logic_summary {
+	/** Whether any sample of the block is high. */
+	gboolean high;
+	/** Whether any sample of the block is low. */
+	gboolean low;
+	/**
+	 * Number of transitions in the block, including the one from the
+	 * last sample of the previous block.
+	 */
+	uint32_t transitions;
+};
+
+/**
+ * Summary of a block of samples of an analog channel.
+ *
+ * @see sr_session_file_summary_read().
+ */
+struct sr_analog_summary {
+	/** Minimum of the samples, NaN if all of them are. */
+	float min;
+	/** Maximum of the samples, NaN if all of them are. */
+	float max;
+};
+
 struct sr_rational {
 	/** Numerator of the rational number. */
 	int64_t p;
@@ -489,6 +797,12 @@ struct sr_rational {
 	uint64_t q;
 };
 
+/**
+ * Alignment in bytes of sample data which sr_datafeed_data_aligned()
+ * reports as aligned.
+ */
+#define SR_DATAFEED_ALIGN 64
+
 /** Packet in a sigrok data feed. */
 struct sr_datafeed_packet {
 	uint16_t type;
@@ -513,7 +827,30 @@ struct sr_datafeed_logic {
 	void *data;
 };
 
-/** Analog datafeed payload for type SR_DF_ANALOG. */
+/**
+ * Run-length encoded logic datafeed payload for type SR_DF_LOGIC_RLE.
+ *
+ * Carries num_samples samples as a list of changes. Change i sets the
+ * value of samples offsets[i] and later to the unitsize bytes at
+ * values + i * unitsize, until the next change. Offsets are relative
+ * to the start of the packet, strictly increasing, and the first
+ * offset is 0, so that each packet is self-contained.
+ */
+struct sr_datafeed_logic_rle {
+	uint64_t num_samples;
+	uint16_t unitsize;
+	uint64_t num_changes;
+	uint64_t *offsets;
+	void *values;
+};
+
+/**
+ * Analog datafeed payload for type SR_DF_ANALOG.
+ *
+ * With several channels in meaning->channels, the data holds one value
+ * per channel for each sample, in the order of the channel list. See
+ * sr_analog_encoding for the layout of the values.
+ */
 struct sr_datafeed_analog {
 	void *data;
 	uint32_t num_samples;
@@ -536,6 +873,22 @@ struct sr_analog_encoding {
 	gboolean is_digits_decimal;
 	struct sr_rational scale;
 	struct sr_rational offset;
+	/**
+	 * Distance in bytes from the first value of one sample to that of
+	 * the next. The value of channel n is n * unitsize bytes into the
+	 * sample. 0 means the values are packed, i.e. unitsize times the
+	 * number of channels. A larger stride lets a packet refer to
+	 * interleaved device data in place, even if it contains values
+	 * which are not part of the packet.
+	 */
+	uint32_t stride;
+	/**
+	 * Optional per-channel scale and offset, one entry for each channel
+	 * in meaning->channels, or NULL. A channel's value is
+	 * (raw * channel_scale[n] + channel_offset[n]) * scale + offset.
+	 */
+	const struct sr_rational *channel_scale;
+	const struct sr_rational *channel_offset;
 };
 
 struct sr_analog_meaning {
@@ -592,15 +945,81 @@ struct sr_resource {
 enum sr_output_flag {
 	/** If set, this output module writes the output itself. */
 	SR_OUTPUT_INTERNAL_IO_HANDLING = 0x01,
+	/**
+	 * If set, this output module accepts SR_DF_LOGIC_RLE packets.
+	 * Otherwise they get expanded into SR_DF_LOGIC packets.
+	 */
+	SR_OUTPUT_LOGIC_RLE = 0x02,
+};
+
+/** When a disk sink synchronizes its file with the disk. */
+enum sr_disk_sync {
+	/** Leave it to the operating system. */
+	SR_DISK_SYNC_NONE,
+	/** When the file gets closed. */
+	SR_DISK_SYNC_CLOSE,
+	/** After every block which gets written. */
+	SR_DISK_SYNC_BLOCK,
+};
+
+/**
+ * Write statistics of a disk sink.
+ *
+ * @see sr_output_sink_disk_new().
+ */
+struct sr_disk_stats {
+	/** Number of bytes written to the file. */
+	uint64_t bytes;
+	/** Number of write operations, of one block each. */
+	uint64_t writes;
+	/** Sum of the write latencies in microseconds. */
+	uint64_t write_us_total;
+	/** Largest write latency in microseconds. */
+	uint64_t write_us_max;
+	/** Number of times the caller had to wait for a block's write. */
+	uint64_t stalls;
 };
 
 struct sr_input;
 struct sr_input_module;
 struct sr_output;
 struct sr_output_module;
+struct sr_output_sink;
 struct sr_transform;
 struct sr_transform_module;
 
+/**
+ * A conversion of a file from one format to another.
+ *
+ * The throughput of a conversion is bytes_in / time_us in MB/s.
+ *
+ * @see sr_batch_convert().
+ */
+struct sr_convert_job {
+	/** The file to convert. */
+	const char *input_filename;
+	/** The input module, NULL to detect the format of the file. */
+	const struct sr_input_module *input;
+	/** Options of the input module, as for sr_input_new(), or NULL. */
+	GHashTable *input_options;
+	/** The output module. */
+	const struct sr_output_module *output;
+	/** Options of the output module, as for sr_output_new(), or NULL. */
+	GHashTable *output_options;
+	/** The file to write. */
+	const char *output_filename;
+	/** Result of the conversion, SR_OK or an error code. */
+	int result;
+	/** Size of the input file in bytes. */
+	uint64_t bytes_in;
+	/** Size of the written file in bytes. */
+	uint64_t bytes_out;
+	/** Number of logic and analog samples converted. */
+	uint64_t samples;
+	/** Duration of the conversion in microseconds. */
+	int64_t time_us;
+};
+
 /** Constants for channel type. */
 enum sr_channeltype {
 	/** Channel type is logic channel. */
@@ -1139,6 +1558,46 @@ enum sr_configkey {
 	/** Number of powerline cycles for ADC integration time. */
 	SR_CONF_ADC_POWERLINE_CYCLES,
 
+	/**
+	 * Sample position at which the replay of a capture file starts.
+	 * Combined with SR_CONF_LIMIT_SAMPLES, only a window of the
+	 * capture gets sent.
+	 */
+	SR_CONF_CAPTURE_OFFSET,
+
+	/**
+	 * Size of USB transfers for data acquisition, in bytes.
+	 * @arg type: uint64_t
+	 * @arg get: get the configured size, 0 for automatic sizing
+	 * @arg set: change the size, 0 selects automatic sizing
+	 */
+	SR_CONF_USB_TRANSFER_SIZE,
+
+	/**
+	 * Number of concurrently submitted USB transfers.
+	 * @arg type: uint64_t
+	 * @arg get: get the configured depth, 0 for automatic sizing
+	 * @arg set: change the depth, 0 selects automatic sizing
+	 */
+	SR_CONF_USB_QUEUE_DEPTH,
+
+	/**
+	 * Number of USB transfers in the current or last acquisition
+	 * which returned with less data than was requested.
+	 * @arg type: uint64_t
+	 * @arg get: get the count
+	 */
+	SR_CONF_USB_UNDERRUNS,
+
+	/**
+	 * Number of USB transfer completions in the current or last
+	 * acquisition when no other transfer was queued (the device may
+	 * have lost data).
+	 * @arg type: uint64_t
+	 * @arg get: get the count
+	 */
+	SR_CONF_USB_OVERRUNS,
+
 	/* Update sr_key_info_config[] (hwdriver.c) upon changes! */
 
 	/*--- Acquisition modes, sample limiting ----------------------------*/
@@ -1216,6 +1675,58 @@ enum sr_dev_inst_status {
 	SR_ST_STOPPING,
 };
 
+/** Flags for sr_init_flags(). */
+enum sr_init_flag {
+	/**
+	 * Set up the subsystems of the context on first use, and skip
+	 * the sanity checks of the driver and module tables.
+	 */
+	SR_INIT_LAZY = 0x01,
+};
+
+/** Flags for sr_driver_scan_all(). */
+enum sr_scan_flag {
+	/**
+	 * Remember the connections where a driver found no device, and
+	 * skip them in later scans. See sr_driver_scan_cache_clear().
+	 */
+	SR_SCAN_CACHE_NEGATIVE = 0x01,
+};
+
+/** How the main loop of a session polls descriptors. */
+enum sr_session_poll_backend {
+	/** GLib's poll function. */
+	SR_SESSION_POLL_GLIB,
+	/** Descriptors stay registered with an epoll instance (Linux). */
+	SR_SESSION_POLL_EPOLL,
+};
+
+/** How a logic merge aligns the captures of devices. */
+enum sr_logic_merge_align {
+	/** Align the first samples, for devices with a common timebase. */
+	SR_LOGIC_MERGE_ALIGN_START,
+	/** Align the first trigger of each device. */
+	SR_LOGIC_MERGE_ALIGN_TRIGGER,
+};
+
+/** Pulse timing of a logic channel, see sr_logic_edges_timing(). */
+struct sr_logic_timing {
+	/** The number of collected edges. */
+	uint64_t edges;
+	/** The number of complete periods, rising edge to rising edge. */
+	uint64_t periods;
+	/** The mean period, in samples. */
+	double period;
+	/** The shortest period, in samples. */
+	uint64_t period_min;
+	/** The longest period, in samples. */
+	uint64_t period_max;
+	/** The mean high time, in samples. */
+	double high;
+	/** The ratio of the high time to the period, 0 to 1. */
+	double duty_cycle;
+};
+
 /** Device driver data. See also http://sigrok.org/wiki/Hardware_driver_API . */
 struct sr_dev_driver {
 	/* Driver-specific */
@@ -1268,6 +1779,20 @@ struct sr_dev_driver {
 	int (*config_list) (uint32_t key, GVariant **data,
 			const struct sr_dev_inst *sdi,
 			const struct sr_channel_group *cg);
+	/** Optional: query an integer (SR_T_UINT64) key without a GVariant.
+	 *  Returns SR_ERR_NA for keys left to config_get().
+	 *  @see sr_config_get_u64().
+	 */
+	int (*config_get_u64) (uint32_t key, uint64_t *value,
+			const struct sr_dev_inst *sdi,
+			const struct sr_channel_group *cg);
+	/** Optional: set an integer (SR_T_UINT64) key without a GVariant.
+	 *  Returns SR_ERR_NA for keys left to config_set().
+	 *  @see sr_config_set_u64().
+	 */
+	int (*config_set_u64) (uint32_t key, uint64_t value,
+			const struct sr_dev_inst *sdi,
+			const struct sr_channel_group *cg);
 
 	/* Device-specific */
 	/** Open device */
@@ -30,6 +30,13 @@
 
 SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 		float *buf);
+SR_API int sr_analog_to_double(const struct sr_datafeed_analog *analog,
+		double *buf);
+SR_API int sr_analog_channel_to_float(const struct sr_datafeed_analog *analog,
+		unsigned int channel, float *buf, size_t stride);
+SR_API int sr_analog_channel_to_double(const struct sr_datafeed_analog *analog,
+		unsigned int channel, double *buf, size_t stride);
+SR_API size_t sr_analog_data_size(const struct sr_datafeed_analog *analog);
 SR_API const char *sr_analog_si_prefix(float *value, int *digits);
 SR_API gboolean sr_analog_si_prefix_friendly(enum sr_unit unit);
 SR_API int sr_analog_unit_to_string(const struct sr_datafeed_analog *analog,
@@ -44,6 +51,7 @@ SR_API int sr_rational_div(struct sr_rational *res, const struct sr_rational *nu
 /*--- backend.c -------------------------------------------------------------*/
 
 SR_API int sr_init(struct sr_context **ctx);
+SR_API int sr_init_flags(struct sr_context **ctx, int flags);
 SR_API int sr_exit(struct sr_context *ctx);
 
 SR_API GSList *sr_buildinfo_libs_get(void);
@@ -54,9 +62,41 @@ SR_API char *sr_buildinfo_scpi_backends_get(void);
 
 SR_API int sr_a2l_threshold(const struct sr_datafeed_analog *analog,
 		float threshold, uint8_t *output, uint64_t count);
+SR_API int sr_a2l_threshold_packed(const struct sr_datafeed_analog *analog,
+		float threshold, uint8_t *output, uint64_t count);
 SR_API int sr_a2l_schmitt_trigger(const struct sr_datafeed_analog *analog,
 		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
 		uint64_t count);
+SR_API int sr_a2l_schmitt_trigger_packed(const struct sr_datafeed_analog *analog,
+		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
+		uint64_t count);
+SR_API int sr_a2l_converter_new(struct sr_a2l_converter **conv,
+		unsigned int num_channels);
+SR_API void sr_a2l_converter_free(struct sr_a2l_converter *conv);
+SR_API int sr_a2l_converter_threshold_set(struct sr_a2l_converter *conv,
+		unsigned int channel, float threshold);
+SR_API int sr_a2l_converter_schmitt_set(struct sr_a2l_converter *conv,
+		unsigned int channel, float lo_thr, float hi_thr, uint8_t state);
+SR_API int sr_a2l_converter_run(struct sr_a2l_converter *conv,
+		const struct sr_datafeed_analog *analog,
+		struct sr_datafeed_logic *logic);
+
+typedef int (*sr_logic_change_callback)(uint64_t offset,
+		const uint8_t *value, void *cb_data);
+
+SR_API int sr_logic_rle_expand(const struct sr_datafeed_logic_rle *rle,
+		uint8_t *data);
+SR_API int sr_logic_changes_foreach(const struct sr_datafeed_packet *packet,
+		uint8_t *last, gboolean initial, sr_logic_change_callback cb,
+		void *cb_data);
+
+/*--- transpose.c -----------------------------------------------------------*/
+
+SR_API size_t sr_logic_plane_size(uint64_t num_samples);
+SR_API int sr_logic_to_planes(const struct sr_datafeed_logic *logic,
+		uint8_t *planes, size_t plane_size);
+SR_API int sr_logic_from_planes(const uint8_t *planes, size_t plane_size,
+		struct sr_datafeed_logic *logic);
 
 /*--- log.c -----------------------------------------------------------------*/
 
@@ -65,9 +105,24 @@ typedef int (*sr_log_callback)(void *cb_data, int loglevel,
 
 SR_API int sr_log_loglevel_set(int loglevel);
 SR_API int sr_log_loglevel_get(void);
+SR_API int sr_log_loglevel_set_module(const char *module, int loglevel);
+SR_API int sr_log_loglevel_get_module(const char *module);
 SR_API int sr_log_callback_set(sr_log_callback cb, void *cb_data);
 SR_API int sr_log_callback_set_default(void);
 SR_API int sr_log_callback_get(sr_log_callback *cb, void **cb_data);
+SR_API int sr_log_async_set(gboolean enable);
+
+/*--- trace.c ---------------------------------------------------------------*/
+
+SR_API int sr_trace_start(void);
+SR_API int sr_trace_stop(void);
+SR_API int sr_trace_export(const char *filename);
+
+/*--- mem_stats.c -----------------------------------------------------------*/
+
+SR_API const char *sr_mem_tag_name(int tag);
+SR_API int sr_mem_stats_get(int tag, struct sr_mem_stats *stats);
+SR_API int sr_mem_stats_reset(void);
 
 /*--- device.c --------------------------------------------------------------*/
 
@@ -96,6 +151,7 @@ SR_API GSList *sr_dev_inst_channel_groups_get(const struct sr_dev_inst *sdi);
 
 SR_API struct sr_dev_inst *sr_dev_inst_user_new(const char *vendor,
 		const char *model, const char *version);
+SR_API int sr_dev_inst_user_free(struct sr_dev_inst *sdi);
 SR_API int sr_dev_inst_channel_add(struct sr_dev_inst *sdi, int index, int type, const char *name);
 
 /*--- hwdriver.c ------------------------------------------------------------*/
@@ -105,6 +161,10 @@ SR_API int sr_driver_init(struct sr_context *ctx,
 		struct sr_dev_driver *driver);
 SR_API GArray *sr_driver_scan_options_list(const struct sr_dev_driver *driver);
 SR_API GSList *sr_driver_scan(struct sr_dev_driver *driver, GSList *options);
+SR_API GSList *sr_driver_scan_all(struct sr_context *ctx,
+		struct sr_dev_driver **drivers, GSList *options,
+		int timeout_ms, int flags);
+SR_API void sr_driver_scan_cache_clear(struct sr_context *ctx);
 SR_API int sr_config_get(const struct sr_dev_driver *driver,
 		const struct sr_dev_inst *sdi,
 		const struct sr_channel_group *cg,
@@ -112,7 +172,29 @@ SR_API int sr_config_get(const struct sr_dev_driver *driver,
 SR_API int sr_config_set(const struct sr_dev_inst *sdi,
 		const struct sr_channel_group *cg,
 		uint32_t key, GVariant *data);
+SR_API int sr_config_get_u64(const struct sr_dev_driver *driver,
+		const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg,
+		uint32_t key, uint64_t *value);
+SR_API int sr_config_get_bool(const struct sr_dev_driver *driver,
+		const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg,
+		uint32_t key, gboolean *value);
+SR_API int sr_config_get_double(const struct sr_dev_driver *driver,
+		const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg,
+		uint32_t key, double *value);
+SR_API int sr_config_set_u64(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg,
+		uint32_t key, uint64_t value);
+SR_API int sr_config_set_bool(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg,
+		uint32_t key, gboolean value);
+SR_API int sr_config_set_double(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg,
+		uint32_t key, double value);
 SR_API int sr_config_commit(const struct sr_dev_inst *sdi);
+SR_API int sr_config_cache_enable(struct sr_dev_inst *sdi, gboolean enable);
 SR_API int sr_config_list(const struct sr_dev_driver *driver,
 		const struct sr_dev_inst *sdi,
 		const struct sr_channel_group *cg,
@@ -131,6 +213,9 @@ SR_API struct sr_trigger *sr_session_trigger_get(struct sr_session *session);
 /* Session setup */
 SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
 	struct sr_session **session);
+SR_API int sr_session_load_files(struct sr_context *ctx,
+	const char *const *filenames, const int64_t *start_ns,
+	int flags, struct sr_session **session);
 SR_API int sr_session_new(struct sr_context *ctx, struct sr_session **session);
 SR_API int sr_session_destroy(struct sr_session *session);
 SR_API int sr_session_dev_remove_all(struct sr_session *session);
@@ -150,14 +235,141 @@ SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 SR_API int sr_session_start(struct sr_session *session);
 SR_API int sr_session_run(struct sr_session *session);
 SR_API int sr_session_stop(struct sr_session *session);
+SR_API int sr_session_stop_async(struct sr_session *session);
+SR_API int sr_session_poll_prepare(struct sr_session *session,
+		GPollFD *fds, int *n_fds, int *timeout_ms);
+SR_API int sr_session_poll_dispatch(struct sr_session *session,
+		GPollFD *fds, int n_fds);
 SR_API int sr_session_is_running(struct sr_session *session);
 SR_API int sr_session_stopped_callback_set(struct sr_session *session,
 		sr_session_stopped_callback cb, void *cb_data);
+SR_API int sr_session_threaded_set(struct sr_session *session,
+		gboolean threaded, uint32_t queue_depth,
+		gboolean drop_on_overflow);
+SR_API int sr_session_queue_stats_get(struct sr_session *session,
+		struct sr_session_queue_stats *stats);
+SR_API int sr_session_stats_get(struct sr_session *session,
+		struct sr_session_stats *stats);
+SR_API int sr_session_stats_channel_get(struct sr_session *session,
+		const struct sr_channel *ch, uint64_t *samples, uint64_t *bytes);
+SR_API int sr_session_packet_position(struct sr_session *session,
+		const struct sr_datafeed_packet *packet,
+		struct sr_datafeed_position *pos);
+SR_API int sr_session_logic_rle_set(struct sr_session *session,
+		gboolean accept);
+SR_API int sr_session_poll_backend_set(struct sr_session *session,
+		enum sr_session_poll_backend backend);
+SR_API int sr_session_rearm_set(struct sr_session *session, gboolean rearm);
+SR_API int sr_session_coalesce_set(struct sr_session *session,
+		uint64_t max_bytes, uint32_t max_latency_ms);
+SR_API int sr_session_sched_set(struct sr_session *session,
+		const struct sr_session_sched *sched);
 
 SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		struct sr_datafeed_packet **copy);
+SR_API struct sr_datafeed_packet *sr_packet_ref(
+		struct sr_datafeed_packet *packet);
+SR_API void sr_packet_unref(struct sr_datafeed_packet *packet);
 SR_API void sr_packet_free(struct sr_datafeed_packet *packet);
 
+/*--- buffer.c --------------------------------------------------------------*/
+
+SR_API gboolean sr_datafeed_data_aligned(const void *data, size_t size);
+
+/*--- session_file.c --------------------------------------------------------*/
+
+SR_API int sr_session_file_samples(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch, uint64_t *samples);
+SR_API int sr_session_file_read(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch, uint64_t offset, uint64_t *count,
+		void *buf);
+SR_API int sr_session_file_info_get(const char *filename, int flags,
+		struct sr_session_file_info *info);
+SR_API int sr_session_file_summary_levels(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch, unsigned int *levels,
+		unsigned int *shift);
+SR_API int sr_session_file_summary_read(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch, unsigned int level, uint64_t offset,
+		uint64_t *count, void *buf);
+SR_API int sr_session_file_edge_next(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch, uint64_t from, int match,
+		uint64_t *pos);
+
+/*--- recorder.c ------------------------------------------------------------*/
+
+typedef void (*sr_recorder_callback)(struct sr_recorder *rec, void *cb_data);
+
+SR_API int sr_recorder_new(struct sr_recorder **rec, uint64_t max_size,
+		gboolean compress);
+SR_API void sr_recorder_free(struct sr_recorder *rec);
+SR_API int sr_recorder_attach(struct sr_recorder *rec,
+		struct sr_session *session);
+SR_API int sr_recorder_trigger_set(struct sr_recorder *rec,
+		struct sr_trigger *trigger, uint64_t post_trigger_samples,
+		sr_recorder_callback cb, void *cb_data);
+SR_API int sr_recorder_snapshot(struct sr_recorder *rec,
+		const struct sr_output *o, GString **out);
+
+/*--- remote.c --------------------------------------------------------------*/
+
+SR_API int sr_remote_server_new(struct sr_remote_server **server,
+		const char *address, const char *port, gboolean compress);
+SR_API int sr_remote_server_attach(struct sr_remote_server *server,
+		struct sr_session *session);
+SR_API unsigned int sr_remote_server_clients(struct sr_remote_server *server);
+SR_API void sr_remote_server_free(struct sr_remote_server *server);
+
+/*--- shm_ring.c ------------------------------------------------------------*/
+
+SR_API int sr_shm_ring_new(struct sr_shm_ring **ring, const char *path,
+		uint64_t size);
+SR_API int sr_shm_ring_attach(struct sr_shm_ring *ring,
+		struct sr_session *session);
+SR_API int sr_shm_ring_reader_lag(struct sr_shm_ring *ring,
+		unsigned int *readers, uint64_t *max_lag);
+SR_API void sr_shm_ring_free(struct sr_shm_ring *ring);
+
+/*--- logic_store.c ---------------------------------------------------------*/
+
+SR_API int sr_logic_store_new(struct sr_logic_store **store,
+		uint16_t unitsize);
+SR_API void sr_logic_store_free(struct sr_logic_store *store);
+SR_API int sr_logic_store_append(struct sr_logic_store *store,
+		const void *data, uint64_t length, uint16_t unitsize);
+SR_API int sr_logic_store_append_packet(struct sr_logic_store *store,
+		const struct sr_datafeed_packet *packet);
+SR_API int sr_logic_store_attach(struct sr_logic_store *store,
+		struct sr_session *session);
+SR_API int sr_logic_store_read(struct sr_logic_store *store,
+		uint64_t start, uint64_t count, void *buf);
+SR_API uint64_t sr_logic_store_samples(struct sr_logic_store *store);
+SR_API uint16_t sr_logic_store_unitsize(struct sr_logic_store *store);
+SR_API uint64_t sr_logic_store_size(struct sr_logic_store *store);
+
+/*--- logic_merge.c ---------------------------------------------------------*/
+
+SR_API int sr_logic_merge_new(struct sr_logic_merge **merge,
+		enum sr_logic_merge_align align);
+SR_API int sr_logic_merge_attach(struct sr_logic_merge *merge,
+		struct sr_session *session, sr_datafeed_callback cb, void *cb_data);
+SR_API struct sr_dev_inst *sr_logic_merge_dev_inst_get(
+		struct sr_logic_merge *merge);
+SR_API void sr_logic_merge_free(struct sr_logic_merge *merge);
+
+/*--- logic_edges.c ---------------------------------------------------------*/
+
+SR_API int sr_logic_edges_new(struct sr_logic_edges **edges,
+		unsigned int num_channels);
+SR_API void sr_logic_edges_free(struct sr_logic_edges *edges);
+SR_API int sr_logic_edges_feed(struct sr_logic_edges *edges,
+		const struct sr_datafeed_packet *packet);
+SR_API int sr_logic_edges_get(const struct sr_logic_edges *edges,
+		unsigned int channel, const uint64_t **positions, size_t *count,
+		gboolean *first_rising);
+SR_API int sr_logic_edges_clear(struct sr_logic_edges *edges, size_t keep);
+SR_API int sr_logic_edges_timing(const struct sr_logic_edges *edges,
+		unsigned int channel, struct sr_logic_timing *timing);
+
 /*--- input/input.c ---------------------------------------------------------*/
 
 SR_API const struct sr_input_module **sr_input_list(void);
@@ -172,16 +384,27 @@ SR_API void sr_input_options_free(const struct sr_option **options);
 SR_API struct sr_input *sr_input_new(const struct sr_input_module *imod,
 		GHashTable *options);
 SR_API int sr_input_scan_buffer(GString *buf, const struct sr_input **in);
+SR_API int sr_input_scan_buffer_ext(GString *buf, const char *const *exts,
+		const struct sr_input **in);
 SR_API int sr_input_scan_file(const char *filename, const struct sr_input **in);
+SR_API int sr_input_scan_file_ext(const char *filename,
+		const char *const *exts, const struct sr_input **in);
 SR_API const struct sr_input_module *sr_input_module_get(const struct sr_input *in);
 SR_API struct sr_dev_inst *sr_input_dev_inst_get(const struct sr_input *in);
 SR_API int sr_input_send(const struct sr_input *in, GString *buf);
+SR_API int sr_input_send_data(const struct sr_input *in, void *data,
+		size_t length);
+SR_API int sr_input_map_file(const struct sr_input *in, const char *filename);
+SR_API int sr_input_send_mapped(const struct sr_input *in);
 SR_API int sr_input_end(const struct sr_input *in);
 SR_API int sr_input_reset(const struct sr_input *in);
 SR_API void sr_input_free(const struct sr_input *in);
 
 /*--- output/output.c -------------------------------------------------------*/
 
+typedef int (*sr_output_sink_callback)(const uint8_t *data, size_t length,
+		void *cb_data);
+
 SR_API const struct sr_output_module **sr_output_list(void);
 SR_API const char *sr_output_id_get(const struct sr_output_module *omod);
 SR_API const char *sr_output_name_get(const struct sr_output_module *omod);
@@ -198,8 +421,30 @@ SR_API gboolean sr_output_test_flag(const struct sr_output_module *omod,
 		uint64_t flag);
 SR_API int sr_output_send(const struct sr_output *o,
 		const struct sr_datafeed_packet *packet, GString **out);
+SR_API struct sr_output_sink *sr_output_sink_fd_new(int fd);
+SR_API struct sr_output_sink *sr_output_sink_buffer_new(void);
+SR_API struct sr_output_sink *sr_output_sink_disk_new(const char *filename,
+		gboolean direct, enum sr_disk_sync sync);
+SR_API int sr_output_sink_disk_stats(const struct sr_output_sink *sink,
+		struct sr_disk_stats *stats);
+SR_API struct sr_output_sink *sr_output_sink_callback_new(
+		sr_output_sink_callback cb, void *cb_data);
+SR_API const uint8_t *sr_output_sink_buffer_get(
+		const struct sr_output_sink *sink, size_t *length);
+SR_API void sr_output_sink_buffer_clear(struct sr_output_sink *sink);
+SR_API uint64_t sr_output_sink_bytes(const struct sr_output_sink *sink);
+SR_API void sr_output_sink_free(struct sr_output_sink *sink);
+SR_API int sr_output_send_sink(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet,
+		struct sr_output_sink *sink);
 SR_API int sr_output_free(const struct sr_output *o);
 
+/*--- batch.c ---------------------------------------------------------------*/
+
+SR_API int sr_batch_convert(struct sr_context *ctx,
+		struct sr_convert_job *jobs, size_t num_jobs,
+		unsigned int num_threads);
+
 /*--- transform/transform.c -------------------------------------------------*/
 
 SR_API const struct sr_transform_module **sr_transform_list(void);
@@ -212,6 +457,8 @@ SR_API void sr_transform_options_free(const struct sr_option **opts);
 SR_API const struct sr_transform *sr_transform_new(const struct sr_transform_module *tmod,
 		GHashTable *params, const struct sr_dev_inst *sdi);
 SR_API int sr_transform_free(const struct sr_transform *t);
+SR_API int sr_transform_threaded_set(const struct sr_transform *t,
+		gboolean threaded);
 
 /*--- trigger.c -------------------------------------------------------------*/
 
@@ -225,6 +472,8 @@ SR_API int sr_trigger_match_add(struct sr_trigger_stage *stage,
 
 SR_API GSList *sr_serial_list(const struct sr_dev_driver *driver);
 SR_API void sr_serial_free(struct sr_serial_port *serial);
+SR_API void sr_serial_list_set_timeout(int timeout_ms);
+SR_API void sr_serial_list_cache_clear(void);
 
 /*--- resource.c ------------------------------------------------------------*/
 
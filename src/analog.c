@@ -18,6 +18,19 @@
  */
 
 #include <config.h>
+
+/*
+ * The vectorized kernels must produce the very same results as the
+ * scalar code, which rounds after the multiplication and again after
+ * the addition. Keep the compiler from contracting them into fused
+ * multiply-add instructions, which round once.
+ */
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
@@ -30,6 +43,22 @@
 #define LOG_PREFIX "analog"
 /** @endcond */
 
+/*
+ * Vectorized conversion kernels are only used for little endian input
+ * on little endian hosts, and where the compiler provides intrinsics.
+ * The NEON kernels only get built on request (--enable-neon), until
+ * they run in regular testing.
+ */
+#if !defined(WORDS_BIGENDIAN) && defined(__GNUC__)
+#if defined(__x86_64__)
+#define ANALOG_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON) && defined(HAVE_ANALOG_NEON)
+#define ANALOG_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
 /**
  * @file
  *
@@ -157,6 +186,382 @@ SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
 	return SR_OK;
 }
 
+/**
+ * Make an analog meaning refer to a single channel, without allocating
+ * a list for it.
+ *
+ * The list node is the caller's, typically on the stack next to the
+ * meaning, and must stay valid while the meaning is in use. The list
+ * must not be passed to g_slist_free().
+ *
+ * @private
+ */
+SR_PRIV void sr_analog_meaning_channel_set(struct sr_analog_meaning *meaning,
+		GSList *node, struct sr_channel *ch)
+{
+	node->data = ch;
+	node->next = NULL;
+	meaning->channels = node;
+}
+
+/** @cond PRIVATE */
+enum analog_simd_type {
+	SIMD_I8,
+	SIMD_U8,
+	SIMD_I16LE,
+	SIMD_U16LE,
+	SIMD_F32,
+};
+/** @endcond */
+
+/*
+ * The vectorized kernels below compute exactly what the scalar code in
+ * sr_analog_to_float() does: integer input gets converted to double
+ * precision (which is exact), multiplied by the scale and the offset
+ * gets added, each step rounding like the scalar code does. The result
+ * then gets rounded to single precision. No fused multiply-add is used,
+ * so results are bit identical to the scalar path. Each kernel returns
+ * the number of values it converted, the caller handles the remainder.
+ */
+
+#ifdef ANALOG_SIMD_X86
+
+/* Convert four 32-bit integers, using two double precision lanes each. */
+static inline __m128 simd_sse2_scale_i32(__m128i v, __m128d scale,
+		__m128d offset)
+{
+	__m128d lo, hi;
+
+	lo = _mm_cvtepi32_pd(v);
+	hi = _mm_cvtepi32_pd(_mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+	lo = _mm_add_pd(_mm_mul_pd(lo, scale), offset);
+	hi = _mm_add_pd(_mm_mul_pd(hi, scale), offset);
+
+	return _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+}
+
+/* Scale two floats with intermediate rounding, like `*f *= s; *f += o`. */
+static inline __m128 simd_sse2_scale_f32(__m128 v, __m128d scale,
+		__m128d offset)
+{
+	__m128d d;
+
+	d = _mm_mul_pd(_mm_cvtps_pd(v), scale);
+	d = _mm_cvtps_pd(_mm_cvtpd_ps(d));
+	d = _mm_add_pd(d, offset);
+
+	return _mm_cvtpd_ps(d);
+}
+
+static size_t simd_convert_sse2(enum analog_simd_type type,
+		const uint8_t *in, float *out, size_t count,
+		double scale, double offset)
+{
+	__m128d vscale, voffset;
+	__m128i zero, v, lo, hi;
+	__m128 f;
+	size_t i;
+
+	vscale = _mm_set1_pd(scale);
+	voffset = _mm_set1_pd(offset);
+	zero = _mm_setzero_si128();
+
+	if (type == SIMD_F32) {
+		for (i = 0; i + 4 <= count; i += 4) {
+			f = _mm_loadu_ps((const float *)(in + i * sizeof(float)));
+			_mm_storeu_ps(out + i, _mm_movelh_ps(
+				simd_sse2_scale_f32(f, vscale, voffset),
+				simd_sse2_scale_f32(_mm_movehl_ps(f, f),
+					vscale, voffset)));
+		}
+		return i;
+	}
+
+	for (i = 0; i + 8 <= count; i += 8) {
+		/* Widen eight values to 16 bits, then to 32 bits. */
+		switch (type) {
+		case SIMD_I8:
+			v = _mm_loadl_epi64((const __m128i *)(in + i));
+			v = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+			break;
+		case SIMD_U8:
+			v = _mm_loadl_epi64((const __m128i *)(in + i));
+			v = _mm_unpacklo_epi8(v, zero);
+			break;
+		default:
+			v = _mm_loadu_si128((const __m128i *)(in + i * 2));
+			break;
+		}
+		if (type == SIMD_U16LE) {
+			lo = _mm_unpacklo_epi16(v, zero);
+			hi = _mm_unpackhi_epi16(v, zero);
+		} else {
+			lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+			hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+		}
+		_mm_storeu_ps(out + i, simd_sse2_scale_i32(lo, vscale, voffset));
+		_mm_storeu_ps(out + i + 4, simd_sse2_scale_i32(hi, vscale, voffset));
+	}
+
+	return i;
+}
+
+/* Convert the eight 32-bit integers in v, using four double lanes each. */
+__attribute__((target("avx2")))
+static inline void simd_avx2_store_i32(float *out, __m256i v,
+		__m256d scale, __m256d offset)
+{
+	__m256d lo, hi;
+
+	lo = _mm256_cvtepi32_pd(_mm256_castsi256_si128(v));
+	hi = _mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1));
+	lo = _mm256_add_pd(_mm256_mul_pd(lo, scale), offset);
+	hi = _mm256_add_pd(_mm256_mul_pd(hi, scale), offset);
+	_mm_storeu_ps(out, _mm256_cvtpd_ps(lo));
+	_mm_storeu_ps(out + 4, _mm256_cvtpd_ps(hi));
+}
+
+__attribute__((target("avx2")))
+static size_t simd_convert_avx2(enum analog_simd_type type,
+		const uint8_t *in, float *out, size_t count,
+		double scale, double offset)
+{
+	__m256d vscale, voffset, d;
+	__m256i v;
+	size_t i;
+
+	vscale = _mm256_set1_pd(scale);
+	voffset = _mm256_set1_pd(offset);
+
+	if (type == SIMD_F32) {
+		for (i = 0; i + 4 <= count; i += 4) {
+			d = _mm256_cvtps_pd(_mm_loadu_ps(
+				(const float *)(in + i * sizeof(float))));
+			d = _mm256_mul_pd(d, vscale);
+			d = _mm256_cvtps_pd(_mm256_cvtpd_ps(d));
+			d = _mm256_add_pd(d, voffset);
+			_mm_storeu_ps(out + i, _mm256_cvtpd_ps(d));
+		}
+		return i;
+	}
+
+	for (i = 0; i + 8 <= count; i += 8) {
+		switch (type) {
+		case SIMD_I8:
+			v = _mm256_cvtepi8_epi32(_mm_loadl_epi64(
+				(const __m128i *)(in + i)));
+			break;
+		case SIMD_U8:
+			v = _mm256_cvtepu8_epi32(_mm_loadl_epi64(
+				(const __m128i *)(in + i)));
+			break;
+		case SIMD_I16LE:
+			v = _mm256_cvtepi16_epi32(_mm_loadu_si128(
+				(const __m128i *)(in + i * 2)));
+			break;
+		default:
+			v = _mm256_cvtepu16_epi32(_mm_loadu_si128(
+				(const __m128i *)(in + i * 2)));
+			break;
+		}
+		simd_avx2_store_i32(out + i, v, vscale, voffset);
+	}
+
+	return i;
+}
+
+static size_t analog_convert_simd(enum analog_simd_type type,
+		const uint8_t *in, float *out, size_t count,
+		double scale, double offset)
+{
+	if (__builtin_cpu_supports("avx2"))
+		return simd_convert_avx2(type, in, out, count, scale, offset);
+
+	return simd_convert_sse2(type, in, out, count, scale, offset);
+}
+
+#elif defined(ANALOG_SIMD_NEON)
+
+/* Convert two 32-bit integers, with double precision math. */
+static inline float32x2_t simd_neon_scale_i32(int32x2_t v,
+		float64x2_t scale, float64x2_t offset)
+{
+	float64x2_t d;
+
+	d = vcvtq_f64_s64(vmovl_s32(v));
+	d = vaddq_f64(vmulq_f64(d, scale), offset);
+
+	return vcvt_f32_f64(d);
+}
+
+static size_t analog_convert_simd(enum analog_simd_type type,
+		const uint8_t *in, float *out, size_t count,
+		double scale, double offset)
+{
+	float64x2_t vscale, voffset, d;
+	int16x8_t v;
+	int32x4_t lo, hi;
+	float32x4_t f;
+	size_t i;
+
+	vscale = vdupq_n_f64(scale);
+	voffset = vdupq_n_f64(offset);
+
+	if (type == SIMD_F32) {
+		for (i = 0; i + 2 <= count; i += 2) {
+			d = vcvt_f64_f32(vld1_f32((const float *)(in + i * sizeof(float))));
+			d = vcvt_f64_f32(vcvt_f32_f64(vmulq_f64(d, vscale)));
+			vst1_f32(out + i, vcvt_f32_f64(vaddq_f64(d, voffset)));
+		}
+		return i;
+	}
+
+	for (i = 0; i + 8 <= count; i += 8) {
+		switch (type) {
+		case SIMD_I8:
+			v = vmovl_s8(vld1_s8((const int8_t *)(in + i)));
+			break;
+		case SIMD_U8:
+			v = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(in + i)));
+			break;
+		case SIMD_I16LE:
+			v = vld1q_s16((const int16_t *)(in + i * 2));
+			break;
+		default:
+			v = vreinterpretq_s16_u16(vld1q_u16((const uint16_t *)(in + i * 2)));
+			break;
+		}
+		if (type == SIMD_U16LE) {
+			lo = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(vreinterpretq_u16_s16(v))));
+			hi = vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(vreinterpretq_u16_s16(v))));
+		} else {
+			lo = vmovl_s16(vget_low_s16(v));
+			hi = vmovl_s16(vget_high_s16(v));
+		}
+		f = vcombine_f32(simd_neon_scale_i32(vget_low_s32(lo), vscale, voffset),
+			simd_neon_scale_i32(vget_high_s32(lo), vscale, voffset));
+		vst1q_f32(out + i, f);
+		f = vcombine_f32(simd_neon_scale_i32(vget_low_s32(hi), vscale, voffset),
+			simd_neon_scale_i32(vget_high_s32(hi), vscale, voffset));
+		vst1q_f32(out + i + 4, f);
+	}
+
+	return i;
+}
+
+#else
+
+static size_t analog_convert_simd(enum analog_simd_type type,
+		const uint8_t *in, float *out, size_t count,
+		double scale, double offset)
+{
+	(void)type;
+	(void)in;
+	(void)out;
+	(void)count;
+	(void)scale;
+	(void)offset;
+
+	return 0;
+}
+
+#endif
+
+static int analog_convert(const struct sr_datafeed_analog *analog,
+		int channel, float *fout, double *dout, size_t stride);
+
+static size_t analog_num_channels(const struct sr_datafeed_analog *analog)
+{
+	return MAX(g_slist_length(analog->meaning->channels), 1);
+}
+
+/**
+ * Get the distance in bytes from one sample of a payload to the next.
+ *
+ * @private
+ */
+SR_PRIV size_t sr_analog_frame_size(const struct sr_datafeed_analog *analog)
+{
+	if (analog->encoding->stride)
+		return analog->encoding->stride;
+
+	return analog->encoding->unitsize * analog_num_channels(analog);
+}
+
+/**
+ * Check whether the values of the payload are packed, and the same
+ * scale and offset apply to all of them.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_analog_is_packed(const struct sr_datafeed_analog *analog)
+{
+	const struct sr_analog_encoding *enc;
+
+	enc = analog->encoding;
+	if (enc->channel_scale || enc->channel_offset)
+		return FALSE;
+
+	return !enc->stride
+		|| enc->stride == enc->unitsize * analog_num_channels(analog);
+}
+
+/**
+ * Get the scale and offset which apply to one channel of a payload.
+ *
+ * @private
+ */
+SR_PRIV void sr_analog_channel_scaling(const struct sr_datafeed_analog *analog,
+		unsigned int channel, double *scale, double *offset)
+{
+	const struct sr_analog_encoding *enc;
+	double s, o;
+
+	enc = analog->encoding;
+	*scale = enc->scale.p;
+	*scale /= enc->scale.q;
+	*offset = enc->offset.p;
+	*offset /= enc->offset.q;
+
+	s = 1.0;
+	o = 0.0;
+	if (enc->channel_scale) {
+		s = enc->channel_scale[channel].p;
+		s /= enc->channel_scale[channel].q;
+	}
+	if (enc->channel_offset) {
+		o = enc->channel_offset[channel].p;
+		o /= enc->channel_offset[channel].q;
+	}
+	*offset += o * *scale;
+	*scale *= s;
+}
+
+/**
+ * Get the number of bytes which the sample data of a payload spans.
+ *
+ * For packed values this is the number of samples times the number of
+ * channels times the unit size. Data with a larger stride ends with the
+ * last channel's value of the last sample.
+ *
+ * @param[in] analog The analog payload. Must not be NULL.
+ *                   analog->meaning and analog->encoding must not be NULL.
+ *
+ * @return The size in bytes, 0 for an invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API size_t sr_analog_data_size(const struct sr_datafeed_analog *analog)
+{
+	if (!analog || !analog->meaning || !analog->encoding)
+		return 0;
+	if (!analog->num_samples)
+		return 0;
+
+	return (analog->num_samples - 1) * sr_analog_frame_size(analog)
+		+ analog->encoding->unitsize * analog_num_channels(analog);
+}
+
 /**
  * Convert an analog datafeed payload to an array of floats.
  *
@@ -184,6 +589,7 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 	double scale, offset, value;
 	const uint8_t *data8;
 	gboolean input_is_native;
+	size_t done;
 	char type_text[10];
 
 	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
@@ -193,6 +599,10 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 
 	count = analog->num_samples * g_slist_length(analog->meaning->channels);
 
+	/* Strided data and per-channel scaling take one pass per channel. */
+	if (!sr_analog_is_packed(analog))
+		return analog_convert(analog, -1, outbuf, NULL, 1);
+
 	/*
 	 * Determine properties of the input data's and the host's
 	 * native formats, to simplify test conditions below.
@@ -232,6 +642,13 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 		input_unitsize == sizeof(outbuf[0]) &&
 		input_bigendian == host_bigendian;
 	if (input_is_native) {
+		if (scale != 1.0 || offset != 0.0) {
+			done = analog_convert_simd(SIMD_F32, data8, outbuf,
+				count, scale, offset);
+			data8 += done * sizeof(outbuf[0]);
+			outbuf += done;
+			count -= done;
+		}
 		memcpy(outbuf, data8, count * sizeof(outbuf[0]));
 		if (scale != 1.0 || offset != 0.0) {
 			while (count--) {
@@ -252,9 +669,8 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 	 * Do most internal calculations on double precision values.
 	 * Only trim the result data to single precision, since that's
 	 * the routine's result data type in its public API which needs
-	 * to be kept for compatibility. It remains an option for later
-	 * to add another public routine which returns double precision
-	 * result data, call sites could migrate at their own pace.
+	 * to be kept for compatibility. See sr_analog_to_double() for
+	 * double precision result data.
 	 */
 	if (input_float && input_unitsize == sizeof(float)) {
 		float (*reader)(const uint8_t **p);
@@ -295,6 +711,11 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 	if (input_unitsize == sizeof(uint8_t) && input_signed) {
 		int8_t (*reader)(const uint8_t **p);
 		reader = read_i8_inc;
+		done = analog_convert_simd(SIMD_I8, data8, outbuf,
+			count, scale, offset);
+		data8 += done;
+		outbuf += done;
+		count -= done;
 		while (count--) {
 			value = reader(&data8);
 			value *= scale;
@@ -306,6 +727,11 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 	if (input_unitsize == sizeof(uint8_t)) {
 		uint8_t (*reader)(const uint8_t **p);
 		reader = read_u8_inc;
+		done = analog_convert_simd(SIMD_U8, data8, outbuf,
+			count, scale, offset);
+		data8 += done;
+		outbuf += done;
+		count -= done;
 		while (count--) {
 			value = reader(&data8);
 			value *= scale;
@@ -316,10 +742,16 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 	}
 	if (input_unitsize == sizeof(uint16_t) && input_signed) {
 		int16_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
+		if (input_bigendian) {
 			reader = read_i16be_inc;
-		else
+		} else {
 			reader = read_i16le_inc;
+			done = analog_convert_simd(SIMD_I16LE, data8, outbuf,
+				count, scale, offset);
+			data8 += done * sizeof(int16_t);
+			outbuf += done;
+			count -= done;
+		}
 		while (count--) {
 			value = reader(&data8);
 			value *= scale;
@@ -330,10 +762,16 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 	}
 	if (input_unitsize == sizeof(uint16_t)) {
 		uint16_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
+		if (input_bigendian) {
 			reader = read_u16be_inc;
-		else
+		} else {
 			reader = read_u16le_inc;
+			done = analog_convert_simd(SIMD_U16LE, data8, outbuf,
+				count, scale, offset);
+			data8 += done * sizeof(uint16_t);
+			outbuf += done;
+			count -= done;
+		}
 		while (count--) {
 			value = reader(&data8);
 			value *= scale;
@@ -378,6 +816,233 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 	return SR_ERR;
 }
 
+/*
+ * Readers which return any supported sample format as a double
+ * precision value, the common type for all conversion math.
+ */
+static double value_read_i8(const uint8_t *p) { return read_i8(p); }
+static double value_read_u8(const uint8_t *p) { return read_u8(p); }
+static double value_read_i16le(const uint8_t *p) { return read_i16le(p); }
+static double value_read_i16be(const uint8_t *p) { return read_i16be(p); }
+static double value_read_u16le(const uint8_t *p) { return read_u16le(p); }
+static double value_read_u16be(const uint8_t *p) { return read_u16be(p); }
+static double value_read_i32le(const uint8_t *p) { return read_i32le(p); }
+static double value_read_i32be(const uint8_t *p) { return read_i32be(p); }
+static double value_read_u32le(const uint8_t *p) { return read_u32le(p); }
+static double value_read_u32be(const uint8_t *p) { return read_u32be(p); }
+static double value_read_fltle(const uint8_t *p) { return read_fltle(p); }
+static double value_read_fltbe(const uint8_t *p) { return read_fltbe(p); }
+static double value_read_dblle(const uint8_t *p) { return read_dblle(p); }
+static double value_read_dblbe(const uint8_t *p) { return read_dblbe(p); }
+
+typedef double (*analog_value_reader)(const uint8_t *p);
+
+static analog_value_reader value_reader_get(
+		const struct sr_analog_encoding *encoding)
+{
+	gboolean is_be;
+	char type_text[10];
+
+	is_be = encoding->is_bigendian;
+	if (encoding->is_float) {
+		if (encoding->unitsize == sizeof(float))
+			return is_be ? value_read_fltbe : value_read_fltle;
+		if (encoding->unitsize == sizeof(double))
+			return is_be ? value_read_dblbe : value_read_dblle;
+	} else if (encoding->is_signed) {
+		if (encoding->unitsize == sizeof(int8_t))
+			return value_read_i8;
+		if (encoding->unitsize == sizeof(int16_t))
+			return is_be ? value_read_i16be : value_read_i16le;
+		if (encoding->unitsize == sizeof(int32_t))
+			return is_be ? value_read_i32be : value_read_i32le;
+	} else {
+		if (encoding->unitsize == sizeof(uint8_t))
+			return value_read_u8;
+		if (encoding->unitsize == sizeof(uint16_t))
+			return is_be ? value_read_u16be : value_read_u16le;
+		if (encoding->unitsize == sizeof(uint32_t))
+			return is_be ? value_read_u32be : value_read_u32le;
+	}
+
+	snprintf(type_text, sizeof(type_text), "%c%u%s",
+		encoding->is_float ? 'f' : encoding->is_signed ? 'i' : 'u',
+		encoding->unitsize * 8, is_be ? "be" : "le");
+	sr_err("Unsupported type for analog conversion: %s.", type_text);
+
+	return NULL;
+}
+
+/*
+ * Convert the values of either all channels (channel < 0) or a single
+ * channel of interleaved sample data. Results go to either the float
+ * or the double output buffer, 'stride' values apart. Float results are
+ * identical to those of sr_analog_to_float(), which scales native float
+ * input in single precision (the product gets rounded to float before
+ * the offset is added).
+ */
+static int analog_convert(const struct sr_datafeed_analog *analog,
+		int channel, float *fout, double *dout, size_t stride)
+{
+	analog_value_reader reader;
+	size_t num_channels, count, step, i;
+	double scale, offset, value;
+	const uint8_t *data8;
+	gboolean host_bigendian, round_product;
+	unsigned int ch;
+	int ret;
+
+	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
+		return SR_ERR_ARG;
+	if ((!fout && !dout) || !stride)
+		return SR_ERR_ARG;
+
+	num_channels = g_slist_length(analog->meaning->channels);
+	if (channel >= 0 && (size_t)channel >= num_channels)
+		return SR_ERR_ARG;
+	if (!(reader = value_reader_get(analog->encoding)))
+		return SR_ERR;
+
+	/* Take the channels one at a time, unless they all look alike. */
+	if (channel < 0 && !sr_analog_is_packed(analog)) {
+		for (ch = 0; ch < num_channels; ch++) {
+			ret = analog_convert(analog, ch,
+				fout ? fout + ch * stride : NULL,
+				dout ? dout + ch * stride : NULL,
+				stride * num_channels);
+			if (ret != SR_OK)
+				return ret;
+		}
+		return SR_OK;
+	}
+
+	sr_analog_channel_scaling(analog, MAX(channel, 0), &scale, &offset);
+
+	data8 = analog->data;
+	if (channel < 0) {
+		count = analog->num_samples * num_channels;
+		step = analog->encoding->unitsize;
+	} else {
+		count = analog->num_samples;
+		step = sr_analog_frame_size(analog);
+		data8 += analog->encoding->unitsize * channel;
+	}
+
+#ifdef WORDS_BIGENDIAN
+	host_bigendian = TRUE;
+#else
+	host_bigendian = FALSE;
+#endif
+	round_product = fout && analog->encoding->is_float &&
+		analog->encoding->unitsize == sizeof(float) &&
+		analog->encoding->is_bigendian == host_bigendian;
+
+	for (i = 0; i < count; i++) {
+		value = reader(data8);
+		value *= scale;
+		if (round_product)
+			value = (float)value;
+		value += offset;
+		if (dout)
+			dout[i * stride] = value;
+		else
+			fout[i * stride] = value;
+		data8 += step;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Convert an analog datafeed payload to an array of doubles.
+ *
+ * Like sr_analog_to_float(), but without trimming the results to single
+ * precision. Scale and offset always get applied in double precision,
+ * also for single precision input.
+ *
+ * @param[in] analog The analog payload to convert. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[out] outbuf Memory where to store the result. Must not be NULL.
+ *
+ * Sufficient memory for outbuf must have been pre-allocated by the caller,
+ * who is also responsible for freeing it when no longer needed.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_analog_to_double(const struct sr_datafeed_analog *analog,
+		double *outbuf)
+{
+	return analog_convert(analog, -1, NULL, outbuf, 1);
+}
+
+/**
+ * Convert a single channel of an analog datafeed payload to floats.
+ *
+ * The payload's values are interleaved, one value per channel for each
+ * sample. This extracts the values of one channel and converts them in
+ * a single pass. The results are identical to the channel's values from
+ * sr_analog_to_float().
+ *
+ * @param[in] analog The analog payload to convert. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[in] channel Index of the channel in analog->meaning->channels.
+ * @param[out] outbuf Memory where to store the result. Must not be NULL.
+ * @param[in] stride Distance between result values in outbuf, in floats.
+ *                   Must not be 0.
+ *
+ * The caller must provide room for analog->num_samples values, which are
+ * stride floats apart.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_analog_channel_to_float(const struct sr_datafeed_analog *analog,
+		unsigned int channel, float *outbuf, size_t stride)
+{
+	if (!outbuf || channel > G_MAXINT)
+		return SR_ERR_ARG;
+
+	return analog_convert(analog, channel, outbuf, NULL, stride);
+}
+
+/**
+ * Convert a single channel of an analog datafeed payload to doubles.
+ *
+ * Like sr_analog_channel_to_float(), but without trimming the results
+ * to single precision.
+ *
+ * @param[in] analog The analog payload to convert. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[in] channel Index of the channel in analog->meaning->channels.
+ * @param[out] outbuf Memory where to store the result. Must not be NULL.
+ * @param[in] stride Distance between result values in outbuf, in doubles.
+ *                   Must not be 0.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_analog_channel_to_double(const struct sr_datafeed_analog *analog,
+		unsigned int channel, double *outbuf, size_t stride)
+{
+	if (!outbuf || channel > G_MAXINT)
+		return SR_ERR_ARG;
+
+	return analog_convert(analog, channel, NULL, outbuf, stride);
+}
+
 /**
  * Scale a float value to the appropriate SI prefix.
  *
@@ -595,12 +1260,56 @@ SR_API int sr_rational_eq(const struct sr_rational *a, const struct sr_rational
 #endif
 }
 
+static uint64_t gcd_u64(uint64_t a, uint64_t b)
+{
+	uint64_t t;
+
+	while (b) {
+		t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+/* Divide a numerator by a common factor, g > 1. */
+static int64_t div_p(int64_t p, uint64_t g)
+{
+	uint64_t v;
+
+	v = p < 0 ? -(uint64_t)p : (uint64_t)p;
+	v /= g;
+
+	return p < 0 ? -(int64_t)v : (int64_t)v;
+}
+
+/**
+ * Reduce a rational to lowest terms.
+ *
+ * @param[in,out] r The value to reduce.
+ *
+ * @private
+ */
+SR_PRIV void sr_rational_reduce(struct sr_rational *r)
+{
+	uint64_t g;
+
+	g = gcd_u64(r->p < 0 ? -(uint64_t)r->p : (uint64_t)r->p, r->q);
+	if (g > 1) {
+		r->p = div_p(r->p, g);
+		r->q /= g;
+	}
+}
+
 /**
  * Multiply two sr_rational.
  *
- * The resulting nominator/denominator are reduced if the result would not fit
- * otherwise. If the resulting nominator/denominator are relatively prime,
- * this may not be possible.
+ * Common factors of a numerator and the other value's denominator get
+ * cancelled before the multiplication, so the result of reduced values
+ * is reduced too. The resulting nominator/denominator are reduced
+ * further if the result would not fit otherwise. If the resulting
+ * nominator/denominator are relatively prime, this may not be possible.
  *
  * It is safe to use the same variable for result and input values.
  *
@@ -616,9 +1325,33 @@ SR_API int sr_rational_eq(const struct sr_rational *a, const struct sr_rational
 SR_API int sr_rational_mult(struct sr_rational *res, const struct sr_rational *a,
 	const struct sr_rational *b)
 {
+	struct sr_rational x, y;
+	uint64_t g;
 #ifdef HAVE___INT128_T
 	__int128_t p;
 	__uint128_t q;
+#else
+	struct sr_int128_t p;
+	struct sr_uint128_t q;
+#endif
+
+	/* Cancel common factors crosswise, res may alias a or b. */
+	x = *a;
+	y = *b;
+	g = gcd_u64(x.p < 0 ? -(uint64_t)x.p : (uint64_t)x.p, y.q);
+	if (g > 1) {
+		x.p = div_p(x.p, g);
+		y.q /= g;
+	}
+	g = gcd_u64(y.p < 0 ? -(uint64_t)y.p : (uint64_t)y.p, x.q);
+	if (g > 1) {
+		y.p = div_p(y.p, g);
+		x.q /= g;
+	}
+	a = &x;
+	b = &y;
+
+#ifdef HAVE___INT128_T
 
 	p = (__int128_t)(a->p) * (__int128_t)(b->p);
 	q = (__uint128_t)(a->q) * (__uint128_t)(b->q);
@@ -630,10 +1363,8 @@ SR_API int sr_rational_mult(struct sr_rational *res, const struct sr_rational *a
 		}
 	}
 
-	if ((p > INT64_MAX) || (p < INT64_MIN) || (q > UINT64_MAX)) {
-		// TODO: determine gcd to do further reduction
+	if ((p > INT64_MAX) || (p < INT64_MIN) || (q > UINT64_MAX))
 		return SR_ERR_ARG;
-	}
 
 	res->p = (int64_t)p;
 	res->q = (uint64_t)q;
@@ -641,9 +1372,6 @@ SR_API int sr_rational_mult(struct sr_rational *res, const struct sr_rational *a
 	return SR_OK;
 
 #else
-	struct sr_int128_t p;
-	struct sr_uint128_t q;
-
 	mult_int64(&p, a->p, b->p);
 	mult_uint64(&q, a->q, b->q);
 
@@ -712,4 +1440,36 @@ SR_API int sr_rational_div(struct sr_rational *res, const struct sr_rational *nu
 	return sr_rational_mult(res, num, &t);
 }
 
+/**
+ * Approximate a floating point value by an sr_rational.
+ *
+ * The denominator is the largest power of ten (up to 10^18) for which
+ * the numerator still is exactly representable in a double, so small
+ * scale factors keep their full float precision.
+ *
+ * @param[out] r Result.
+ * @param[in] value The value to convert.
+ *
+ * @private
+ */
+SR_PRIV void sr_rational_from_double(struct sr_rational *r, double value)
+{
+	const double limit = (double)(UINT64_C(1) << 53);
+	int64_t p;
+	uint64_t q;
+
+	q = 1;
+	while (q < UINT64_C(1000000000000000000) && fabs(value) * q * 10 < limit)
+		q *= 10;
+	p = llround(value * q);
+
+	/* Drop the trailing zeros, e.g. 0.5 is 5/10 rather than 5e17/1e18. */
+	while (q > 1 && p % 10 == 0) {
+		p /= 10;
+		q /= 10;
+	}
+
+	sr_rational_set(r, p, q);
+}
+
 /** @} */
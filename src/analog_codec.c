@@ -0,0 +1,262 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Lossless compression of float sample streams which vary slowly, like
+ * the readings of multimeters and power supplies.
+ *
+ * Each value gets XORed with its predecessor. Repeated values take a
+ * single bit, values which differ in a few mantissa bits take a few
+ * more, in the way of the Gorilla time series database:
+ *
+ * - "0": The value equals its predecessor.
+ * - "10" and the meaningful bits: The XOR's set bits fit into the
+ *   window of the previous XOR, which gets reused.
+ * - "11", 5 bits of leading zeros, 5 bits of the meaningful length
+ *   minus one, and the meaningful bits: A new window.
+ *
+ * An encoded block starts with the number of values (32 bits, little
+ * endian), followed by the first value's 32 bits, and the above codes
+ * for the remaining values. Bits get packed MSB first, the last byte
+ * is padded with zeros.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "analog-codec"
+/** @endcond */
+
+#define XOR_HEADER_LEN 4
+
+struct bit_writer {
+	GByteArray *out;
+	uint64_t acc;
+	unsigned int bits;
+};
+
+struct bit_reader {
+	const uint8_t *data;
+	size_t len, pos;
+	uint64_t acc;
+	unsigned int bits;
+};
+
+static void bits_put(struct bit_writer *w, uint32_t value, unsigned int count)
+{
+	uint8_t byte;
+
+	if (!count)
+		return;
+	if (count < 32)
+		value &= (1UL << count) - 1;
+	w->acc = (w->acc << count) | value;
+	w->bits += count;
+	while (w->bits >= 8) {
+		w->bits -= 8;
+		byte = w->acc >> w->bits;
+		g_byte_array_append(w->out, &byte, 1);
+	}
+}
+
+static void bits_flush(struct bit_writer *w)
+{
+	if (w->bits)
+		bits_put(w, 0, 8 - w->bits);
+}
+
+static gboolean bits_get(struct bit_reader *r, unsigned int count,
+		uint32_t *value)
+{
+	if (!count) {
+		*value = 0;
+		return TRUE;
+	}
+	while (r->bits < count) {
+		if (r->pos >= r->len)
+			return FALSE;
+		r->acc = (r->acc << 8) | r->data[r->pos++];
+		r->bits += 8;
+	}
+	r->bits -= count;
+	*value = r->acc >> r->bits;
+	if (count < 32)
+		*value &= (1UL << count) - 1;
+
+	return TRUE;
+}
+
+static uint32_t float_bits(float value)
+{
+	uint32_t bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+
+	return bits;
+}
+
+/**
+ * Encode float values with the XOR codec.
+ *
+ * @param[in] values The values.
+ * @param[in] count The number of values, below 2^32.
+ * @param[out] out Receives the encoded block, appended to its content.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid arguments.
+ */
+SR_PRIV int sr_analog_xor_encode(const float *values, size_t count,
+		GByteArray *out)
+{
+	struct bit_writer w;
+	uint8_t header[XOR_HEADER_LEN];
+	uint32_t prev, cur, x;
+	unsigned int lead, trail, prev_lead, prev_trail, len;
+	size_t i;
+
+	if (!out || (count && !values) || count > UINT32_MAX)
+		return SR_ERR_ARG;
+
+	write_u32le(header, count);
+	g_byte_array_append(out, header, sizeof(header));
+	if (!count)
+		return SR_OK;
+
+	memset(&w, 0, sizeof(w));
+	w.out = out;
+	prev = float_bits(values[0]);
+	bits_put(&w, prev, 32);
+	/* No window to reuse yet. */
+	prev_lead = 32;
+	prev_trail = 0;
+	for (i = 1; i < count; i++) {
+		cur = float_bits(values[i]);
+		x = cur ^ prev;
+		prev = cur;
+		if (!x) {
+			bits_put(&w, 0, 1);
+			continue;
+		}
+		lead = __builtin_clz(x);
+		trail = __builtin_ctz(x);
+		if (lead >= prev_lead && trail >= prev_trail) {
+			bits_put(&w, 2, 2);
+			bits_put(&w, x >> prev_trail, 32 - prev_lead - prev_trail);
+			continue;
+		}
+		len = 32 - lead - trail;
+		bits_put(&w, 3, 2);
+		bits_put(&w, lead, 5);
+		bits_put(&w, len - 1, 5);
+		bits_put(&w, x >> trail, len);
+		prev_lead = lead;
+		prev_trail = trail;
+	}
+	bits_flush(&w);
+
+	return SR_OK;
+}
+
+/**
+ * Get the number of values in a block of the XOR codec.
+ *
+ * @param[in] data The start of the encoded block.
+ * @param[in] len The number of bytes in data.
+ * @param[out] count Receives the number of values.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_DATA The data is too short.
+ */
+SR_PRIV int sr_analog_xor_count(const uint8_t *data, size_t len,
+		size_t *count)
+{
+	if (len < XOR_HEADER_LEN)
+		return SR_ERR_DATA;
+	*count = read_u32le(data);
+
+	return SR_OK;
+}
+
+/**
+ * Decode a block of the XOR codec.
+ *
+ * @param[in] data The encoded block.
+ * @param[in] len The number of bytes in data.
+ * @param[out] values Receives the values, see sr_analog_xor_count()
+ *                    for the number of values.
+ * @param[in] count The number of values which fit into values.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG The values do not fit.
+ * @retval SR_ERR_DATA The data is corrupt.
+ */
+SR_PRIV int sr_analog_xor_decode(const uint8_t *data, size_t len,
+		float *values, size_t count)
+{
+	struct bit_reader r;
+	uint32_t prev, code, x, lead, meaningful;
+	unsigned int prev_lead, prev_trail;
+	size_t num, i;
+
+	if (sr_analog_xor_count(data, len, &num) != SR_OK)
+		return SR_ERR_DATA;
+	if (num > count)
+		return SR_ERR_ARG;
+	if (!num)
+		return SR_OK;
+
+	memset(&r, 0, sizeof(r));
+	r.data = data + XOR_HEADER_LEN;
+	r.len = len - XOR_HEADER_LEN;
+	if (!bits_get(&r, 32, &prev))
+		return SR_ERR_DATA;
+	memcpy(&values[0], &prev, sizeof(prev));
+	prev_lead = 32;
+	prev_trail = 0;
+	for (i = 1; i < num; i++) {
+		if (!bits_get(&r, 1, &code))
+			return SR_ERR_DATA;
+		if (!code) {
+			memcpy(&values[i], &prev, sizeof(prev));
+			continue;
+		}
+		if (!bits_get(&r, 1, &code))
+			return SR_ERR_DATA;
+		if (code) {
+			if (!bits_get(&r, 5, &lead) || !bits_get(&r, 5, &meaningful))
+				return SR_ERR_DATA;
+			meaningful++;
+			if (lead + meaningful > 32)
+				return SR_ERR_DATA;
+			prev_lead = lead;
+			prev_trail = 32 - lead - meaningful;
+		} else if (prev_lead == 32) {
+			return SR_ERR_DATA;
+		}
+		if (!bits_get(&r, 32 - prev_lead - prev_trail, &x))
+			return SR_ERR_DATA;
+		prev ^= x << prev_trail;
+		memcpy(&values[i], &prev, sizeof(prev));
+	}
+
+	return SR_OK;
+}
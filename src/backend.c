@@ -26,6 +26,9 @@
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 #include "minilzo/minilzo.h"
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
 
 /** @cond PRIVATE */
 #define LOG_PREFIX "backend"
@@ -149,6 +152,12 @@ SR_API GSList *sr_buildinfo_libs_get(void)
 	m = g_slist_append(m, g_strdup_printf("%s", lzo_version_string()));
 	l = g_slist_append(l, m);
 
+#ifdef HAVE_LIBZSTD
+	m = g_slist_append(NULL, g_strdup("libzstd"));
+	m = g_slist_append(m, g_strdup_printf("%s (rt: %s)",
+		ZSTD_VERSION_STRING, ZSTD_versionString()));
+	l = g_slist_append(l, m);
+#endif
 #ifdef HAVE_LIBSERIALPORT
 	m = g_slist_append(NULL, g_strdup("libserialport"));
 	m = g_slist_append(m, g_strdup_printf("%s/%s (rt: %s/%s)",
@@ -538,6 +547,90 @@ static int sanity_check_all_transform_modules(void)
 	return ret;
 }
 
+/* Values of sr_context.hw_state, behind g_once_init_enter(). */
+enum {
+	HW_STATE_READY = 1,
+	HW_STATE_FAILED,
+};
+
+static int hw_init(struct sr_context *ctx)
+{
+#ifdef HAVE_LIBUSB_1_0
+	int ret;
+
+	ret = libusb_init(&ctx->libusb_ctx);
+	if (LIBUSB_SUCCESS != ret) {
+		sr_err("libusb_init() returned %s.", libusb_error_name(ret));
+		ctx->libusb_ctx = NULL;
+		return SR_ERR;
+	}
+	sr_usb_registry_init(ctx->libusb_ctx);
+#else
+	(void)ctx;
+#endif
+#ifdef HAVE_LIBHIDAPI
+	/*
+	 * According to <hidapi.h>, the hid_init() routine just returns
+	 * zero or non-zero, and hid_error() appears to relate to calls
+	 * for a specific device after hid_open(). Which means that there
+	 * is no more detailled information available beyond success/fail
+	 * at this point in time.
+	 */
+	if (hid_init() != 0) {
+		sr_err("HIDAPI hid_init() failed.");
+		return SR_ERR;
+	}
+#endif
+
+	return SR_OK;
+}
+
+/**
+ * Initialize the hardware access libraries of a context (libusb, HIDAPI),
+ * if that has not happened yet.
+ *
+ * @param[in] ctx Pointer to a libsigrok context struct. Must not be NULL.
+ *
+ * @retval SR_OK The libraries are ready.
+ * @retval SR_ERR Their initialization failed, now or before.
+ *
+ * @private
+ */
+SR_PRIV int sr_context_hw_init(struct sr_context *ctx)
+{
+	if (g_once_init_enter(&ctx->hw_state)) {
+		g_once_init_leave(&ctx->hw_state, hw_init(ctx) == SR_OK ?
+			HW_STATE_READY : HW_STATE_FAILED);
+	}
+
+	return ctx->hw_state == HW_STATE_READY ? SR_OK : SR_ERR;
+}
+
+/**
+ * Run the self test of the LZO compression code, once per process.
+ *
+ * @retval SR_OK LZO is usable.
+ * @retval SR_ERR The self test failed.
+ *
+ * @private
+ */
+SR_PRIV int sr_lzo_init(void)
+{
+	static gsize state;
+	int ret;
+
+	if (g_once_init_enter(&state)) {
+		if ((ret = lzo_init()) != LZO_E_OK) {
+			sr_err("lzo_init() failed with return code %d.", ret);
+			sr_err("This usually indicates a compiler bug. Recompile without");
+			sr_err("optimizations, and enable '-DLZO_DEBUG' for diagnostics.");
+		}
+		g_once_init_leave(&state, ret == LZO_E_OK ? 1 : 2);
+	}
+
+	return state == 1 ? SR_OK : SR_ERR;
+}
+
 /**
  * Initialize libsigrok.
  *
@@ -555,6 +648,32 @@ static int sanity_check_all_transform_modules(void)
  * @since 0.2.0
  */
 SR_API int sr_init(struct sr_context **ctx)
+{
+	return sr_init_flags(ctx, 0);
+}
+
+/**
+ * Initialize libsigrok, with options.
+ *
+ * With SR_INIT_LAZY, the context gets created without further work. The
+ * driver list gets set up on the first sr_driver_list() call, libusb and
+ * HIDAPI on the first sr_driver_init() call, the LZO code on first use.
+ * Initialization errors of those get reported there. The sanity checks
+ * of the driver and module tables get skipped, sr_init() runs them.
+ *
+ * @param ctx Pointer to a libsigrok context struct pointer. Must not be NULL.
+ *            This will be a pointer to a newly allocated libsigrok context
+ *            object upon success, and is undefined upon errors.
+ * @param flags Flags from enum sr_init_flag.
+ *
+ * @return SR_OK upon success, a (negative) error code otherwise. Upon errors
+ *         the 'ctx' pointer is undefined and should not be used. Upon success,
+ *         the context will be free'd by sr_exit() as part of the libsigrok
+ *         shutdown.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_init_flags(struct sr_context **ctx, int flags)
 {
 	int ret = SR_ERR;
 	struct sr_context *context;
@@ -562,9 +681,10 @@ SR_API int sr_init(struct sr_context **ctx)
 	WSADATA wsadata;
 #endif
 
-	print_versions();
-
-	print_resourcepaths();
+	if (sr_log_enabled(SR_LOG_DBG)) {
+		print_versions();
+		print_resourcepaths();
+	}
 
 	if (!ctx) {
 		sr_err("%s(): libsigrok context was NULL.", __func__);
@@ -572,27 +692,32 @@ SR_API int sr_init(struct sr_context **ctx)
 	}
 
 	context = g_malloc0(sizeof(struct sr_context));
+	g_mutex_init(&context->scan_mutex);
+	g_mutex_init(&context->resource_mutex);
+	context->fpga_bitstreams = g_hash_table_new_full(g_str_hash,
+		g_str_equal, g_free, g_free);
+	g_cond_init(&context->scan_cond);
+
+	if (!(flags & SR_INIT_LAZY)) {
+		if (sanity_check_all_drivers(context) < 0) {
+			sr_err("Internal driver error(s), aborting.");
+			goto done;
+		}
 
-	sr_drivers_init(context);
-
-	if (sanity_check_all_drivers(context) < 0) {
-		sr_err("Internal driver error(s), aborting.");
-		goto done;
-	}
-
-	if (sanity_check_all_input_modules() < 0) {
-		sr_err("Internal input module error(s), aborting.");
-		goto done;
-	}
+		if (sanity_check_all_input_modules() < 0) {
+			sr_err("Internal input module error(s), aborting.");
+			goto done;
+		}
 
-	if (sanity_check_all_output_modules() < 0) {
-		sr_err("Internal output module error(s), aborting.");
-		goto done;
-	}
+		if (sanity_check_all_output_modules() < 0) {
+			sr_err("Internal output module error(s), aborting.");
+			goto done;
+		}
 
-	if (sanity_check_all_transform_modules() < 0) {
-		sr_err("Internal transform module error(s), aborting.");
-		goto done;
+		if (sanity_check_all_transform_modules() < 0) {
+			sr_err("Internal transform module error(s), aborting.");
+			goto done;
+		}
 	}
 
 #ifdef _WIN32
@@ -603,36 +728,16 @@ SR_API int sr_init(struct sr_context **ctx)
 	}
 #endif
 
-	if ((ret = lzo_init()) != LZO_E_OK) {
-		sr_err("lzo_init() failed with return code %d.", ret);
-		sr_err("This usually indicates a compiler bug. Recompile without");
-		sr_err("optimizations, and enable '-DLZO_DEBUG' for diagnostics.");
-		ret = SR_ERR;
-		goto done;
-	}
-
-#ifdef HAVE_LIBUSB_1_0
-	ret = libusb_init(&context->libusb_ctx);
-	if (LIBUSB_SUCCESS != ret) {
-		sr_err("libusb_init() returned %s.", libusb_error_name(ret));
-		ret = SR_ERR;
-		goto done;
-	}
-#endif
-#ifdef HAVE_LIBHIDAPI
-	/*
-	 * According to <hidapi.h>, the hid_init() routine just returns
-	 * zero or non-zero, and hid_error() appears to relate to calls
-	 * for a specific device after hid_open(). Which means that there
-	 * is no more detailled information available beyond success/fail
-	 * at this point in time.
-	 */
-	if (hid_init() != 0) {
-		sr_err("HIDAPI hid_init() failed.");
-		ret = SR_ERR;
-		goto done;
+	if (!(flags & SR_INIT_LAZY)) {
+		if (sr_lzo_init() != SR_OK) {
+			ret = SR_ERR;
+			goto done;
+		}
+		if (sr_context_hw_init(context) != SR_OK) {
+			ret = SR_ERR;
+			goto done;
+		}
 	}
-#endif
 	sr_resource_set_hooks(context, NULL, NULL, NULL, NULL);
 
 	*ctx = context;
@@ -640,7 +745,11 @@ SR_API int sr_init(struct sr_context **ctx)
 	ret = SR_OK;
 
 done:
-	g_free(context);
+	if (context) {
+		g_hash_table_destroy(context->fpga_bitstreams);
+		g_free(context->driver_list);
+		g_free(context);
+	}
 	return ret;
 }
 
@@ -661,7 +770,12 @@ SR_API int sr_exit(struct sr_context *ctx)
 		return SR_ERR;
 	}
 
+	sr_driver_scan_cleanup(ctx);
 	sr_hw_cleanup_all(ctx);
+	sr_resource_cache_free(ctx);
+	g_hash_table_destroy(ctx->fpga_bitstreams);
+	g_mutex_clear(&ctx->resource_mutex);
+	sr_traffic_record_close();
 
 #ifdef _WIN32
 	WSACleanup();
@@ -671,10 +785,13 @@ SR_API int sr_exit(struct sr_context *ctx)
 	hid_exit();
 #endif
 #ifdef HAVE_LIBUSB_1_0
-	libusb_exit(ctx->libusb_ctx);
+	if (ctx->libusb_ctx) {
+		sr_usb_registry_free(ctx->libusb_ctx);
+		libusb_exit(ctx->libusb_ctx);
+	}
 #endif
 
-	g_free(sr_driver_list(ctx));
+	g_free(ctx->driver_list);
 	g_free(ctx);
 
 	return SR_OK;
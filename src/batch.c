@@ -0,0 +1,284 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "batch"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Converting files between formats in parallel.
+ */
+
+/**
+ * @defgroup grp_batch Batch conversion
+ *
+ * Converting files between formats in parallel.
+ *
+ * @{
+ */
+
+/*
+ * Modules set up the defaults of their options when these are first
+ * asked for, which must not happen in several threads at once. Creating
+ * instances is serialized, they run side by side once created.
+ */
+static GMutex instance_mutex;
+
+/* The state of a conversion while it runs. */
+struct convert_state {
+	struct sr_convert_job *job;
+	const struct sr_output *out;
+	struct sr_output_sink *sink;
+	int fd;
+	int ret;
+};
+
+static void convert_feed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct convert_state *state;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	int ret;
+
+	state = cb_data;
+	if (state->ret != SR_OK)
+		return;
+
+	if (!state->out) {
+		g_mutex_lock(&instance_mutex);
+		state->out = sr_output_new(state->job->output,
+			state->job->output_options, sdi,
+			state->job->output_filename);
+		g_mutex_unlock(&instance_mutex);
+		if (!state->out) {
+			state->ret = SR_ERR_ARG;
+			return;
+		}
+	}
+
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		if (logic->unitsize)
+			state->job->samples += logic->length / logic->unitsize;
+	} else if (packet->type == SR_DF_ANALOG) {
+		analog = packet->payload;
+		state->job->samples += analog->num_samples;
+	}
+
+	ret = sr_output_send_sink(state->out, packet, state->sink);
+	if (ret != SR_OK) {
+		sr_err("Failed to write %s: %s.", state->job->output_filename,
+			sr_strerror(ret));
+		state->ret = ret;
+	}
+}
+
+/* Create the input instance of a conversion. */
+static const struct sr_input *convert_input(struct sr_convert_job *job)
+{
+	const struct sr_input *in;
+
+	in = NULL;
+	g_mutex_lock(&instance_mutex);
+	if (job->input)
+		in = sr_input_new(job->input, job->input_options);
+	else if (sr_input_scan_file(job->input_filename, &in) != SR_OK)
+		sr_err("Unknown format of %s.", job->input_filename);
+	g_mutex_unlock(&instance_mutex);
+
+	return in;
+}
+
+/* Feed the input file through the input module. */
+static int convert_run(struct sr_context *ctx, const struct sr_input *in,
+		struct convert_state *state)
+{
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	int ret;
+
+	if ((ret = sr_input_map_file(in, state->job->input_filename)) != SR_OK)
+		return ret;
+	/*
+	 * Some modules need data to set up the device instance. No data
+	 * gets sent before it is ready, and has been added to the session.
+	 */
+	if (!sr_input_dev_inst_get(in)
+			&& (ret = sr_input_send_mapped(in)) != SR_OK)
+		return ret;
+	if (!(sdi = sr_input_dev_inst_get(in))) {
+		sr_err("Not enough data in %s.", state->job->input_filename);
+		return SR_ERR_DATA;
+	}
+
+	sr_session_new(ctx, &session);
+	sr_session_datafeed_callback_add(session, convert_feed, state);
+	ret = sr_session_dev_add(session, sdi);
+	if (ret == SR_OK)
+		ret = sr_input_send_mapped(in);
+	if (ret == SR_OK)
+		ret = sr_input_end(in);
+	if (ret == SR_OK)
+		ret = state->ret;
+	sr_session_destroy(session);
+
+	return ret;
+}
+
+static void convert_job(struct sr_context *ctx, struct sr_convert_job *job)
+{
+	struct convert_state state;
+	const struct sr_input *in;
+	GStatBuf st;
+	int64_t start_us;
+	int ret;
+
+	start_us = g_get_monotonic_time();
+	memset(&state, 0, sizeof(state));
+	state.job = job;
+	state.fd = -1;
+	job->samples = 0;
+	job->bytes_in = job->bytes_out = 0;
+
+	if (g_stat(job->input_filename, &st) == 0)
+		job->bytes_in = st.st_size;
+
+	/* Modules which write the file themselves get no output to write. */
+	if (sr_output_test_flag(job->output, SR_OUTPUT_INTERNAL_IO_HANDLING)) {
+		state.sink = sr_output_sink_buffer_new();
+	} else if ((state.fd = g_open(job->output_filename,
+			O_WRONLY | O_CREAT | O_TRUNC, 0666)) >= 0) {
+		state.sink = sr_output_sink_fd_new(state.fd);
+	} else {
+		sr_err("Cannot create %s: %s.", job->output_filename,
+			g_strerror(errno));
+	}
+
+	ret = SR_ERR_IO;
+	if (state.sink) {
+		ret = SR_ERR;
+		if ((in = convert_input(job))) {
+			ret = convert_run(ctx, in, &state);
+			sr_input_free(in);
+		}
+	}
+	if (state.out)
+		sr_output_free(state.out);
+	sr_output_sink_free(state.sink);
+	if (state.fd >= 0 && close(state.fd) < 0 && ret == SR_OK)
+		ret = SR_ERR_IO;
+
+	if (g_stat(job->output_filename, &st) == 0)
+		job->bytes_out = st.st_size;
+	job->time_us = g_get_monotonic_time() - start_us;
+	job->result = ret;
+
+	if (ret == SR_OK) {
+		sr_info("Converted %s in %.3f s, %.1f MB/s.",
+			job->input_filename, job->time_us / 1e6,
+			job->bytes_in / (double)MAX(job->time_us, 1));
+	} else {
+		sr_err("Failed to convert %s: %s.", job->input_filename,
+			sr_strerror(ret));
+	}
+}
+
+static void batch_worker(gpointer data, gpointer user_data)
+{
+	convert_job(user_data, data);
+}
+
+/**
+ * Convert files between formats, several at a time.
+ *
+ * Each job feeds its input file through an input module instance, and
+ * the resulting data feed through an output module instance, in a
+ * session of its own. The jobs run in a pool of worker threads, saving
+ * the start-up of a process per file. Output modules which write files
+ * themselves (such as "srzip") get the output file name, the output of
+ * all others is written to the file.
+ *
+ * Failing jobs do not stop the others. The result, the sizes of the
+ * files, the number of samples and the duration of each job are stored
+ * in the job.
+ *
+ * @param ctx The libsigrok context. Must not be NULL.
+ * @param jobs The conversions to run.
+ * @param num_jobs The number of conversions.
+ * @param num_threads The number of conversions to run at once, 0 for
+ *                    the number of processors.
+ *
+ * @retval SR_OK All conversions succeeded.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval other The result of the first job which failed.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_batch_convert(struct sr_context *ctx,
+		struct sr_convert_job *jobs, size_t num_jobs,
+		unsigned int num_threads)
+{
+	GThreadPool *pool;
+	size_t i;
+
+	if (!ctx || (!jobs && num_jobs))
+		return SR_ERR_ARG;
+	for (i = 0; i < num_jobs; i++) {
+		if (!jobs[i].input_filename || !jobs[i].output
+				|| !jobs[i].output_filename)
+			return SR_ERR_ARG;
+	}
+
+	if (!num_threads)
+		num_threads = g_get_num_processors();
+	num_threads = MIN(num_threads, MAX(num_jobs, 1));
+
+	if (num_threads > 1) {
+		pool = g_thread_pool_new(batch_worker, ctx, num_threads,
+			TRUE, NULL);
+		for (i = 0; i < num_jobs; i++)
+			g_thread_pool_push(pool, &jobs[i], NULL);
+		/* Wait for all of the jobs to complete. */
+		g_thread_pool_free(pool, FALSE, TRUE);
+	} else {
+		for (i = 0; i < num_jobs; i++)
+			convert_job(ctx, &jobs[i]);
+	}
+
+	for (i = 0; i < num_jobs; i++) {
+		if (jobs[i].result != SR_OK)
+			return jobs[i].result;
+	}
+
+	return SR_OK;
+}
+
+/** @} */
@@ -96,6 +96,15 @@
 #define CONNECT_RFCOMM_TRIES	3
 #define CONNECT_RFCOMM_RETRY_MS	100
 
+#define ATT_MTU_DEFAULT		23	/* The minimum, without an exchange. */
+#define ATT_MTU_MAX		517
+#define MTU_EXCHANGE_TIMEOUT_MS	1000
+#define CONN_UPDATE_TIMEOUT_MS	1000
+#define CONN_SUPERVISION_10MS	500	/* Supervision timeout, 5s. */
+
+/* Messages which one sr_bt_check_notify() call handles at most. */
+#define NOTIFY_BATCH_SIZE	32
+
 /* Silence warning about (currently) unused routine. */
 #define WITH_WRITE_TYPE_HANDLE	0
 
@@ -239,9 +248,12 @@ struct sr_bt_desc {
 	uint16_t write_handle;
 	uint16_t cccd_handle;
 	uint16_t cccd_value;
+	unsigned int conn_interval_min;
+	unsigned int conn_interval_max;
 	/* Internal state. */
 	int devid;
 	int fd;
+	uint16_t mtu;
 	struct hci_filter orig_filter;
 };
 
@@ -268,6 +280,7 @@ SR_PRIV struct sr_bt_desc *sr_bt_desc_new(void)
 
 	desc->devid = -1;
 	desc->fd = -1;
+	desc->mtu = ATT_MTU_DEFAULT;
 
 	return desc;
 }
@@ -379,6 +392,25 @@ SR_PRIV int sr_bt_config_notify(struct sr_bt_desc *desc,
 	return 0;
 }
 
+/*
+ * Request LE connection parameters, the interval range in microseconds.
+ * Short intervals let the peer send more notifications per second. The
+ * request is optional, zero keeps what the stack and the peer agree on.
+ */
+SR_PRIV int sr_bt_config_conn_interval(struct sr_bt_desc *desc,
+	unsigned int min_us, unsigned int max_us)
+{
+	if (!desc)
+		return -1;
+	if (max_us && (min_us < 7500 || min_us > max_us || max_us > 4000000))
+		return -1;
+
+	desc->conn_interval_min = max_us ? min_us : 0;
+	desc->conn_interval_max = max_us;
+
+	return 0;
+}
+
 static int sr_bt_desc_open(struct sr_bt_desc *desc, int *id_ref)
 {
 	int id, sock;
@@ -657,6 +689,128 @@ SR_PRIV int sr_bt_scan_bt(struct sr_bt_desc *desc, int duration)
 /* }}} scan */
 /* {{{ connect/disconnect */
 
+/*
+ * Exchange the ATT MTU with the peer. A larger MTU gets more payload
+ * into each notification, peers which don't support the exchange keep
+ * the default. The ATT protocol allows one request at a time, so wait
+ * for the response before other requests get sent.
+ */
+static void sr_bt_exchange_mtu(struct sr_bt_desc *desc)
+{
+	uint8_t buf[ATT_MTU_MAX];
+	uint16_t local_mtu, peer_mtu;
+	struct pollfd fds[1];
+	gint64 deadline, now;
+	ssize_t rdlen;
+	int ret;
+
+	local_mtu = ATT_MTU_MAX;
+#ifdef BT_RCVMTU
+	{
+		uint16_t rcvmtu;
+		socklen_t len;
+
+		len = sizeof(rcvmtu);
+		if (getsockopt(desc->fd, SOL_BLUETOOTH, BT_RCVMTU,
+				&rcvmtu, &len) == 0 && rcvmtu >= ATT_MTU_DEFAULT)
+			local_mtu = MIN(rcvmtu, ATT_MTU_MAX);
+	}
+#endif
+
+	buf[0] = BLE_ATT_EXCHANGE_MTU_REQ;
+	write_u16le(&buf[1], local_mtu);
+	if (write(desc->fd, buf, 3) != 3)
+		return;
+
+	deadline = g_get_monotonic_time() + MTU_EXCHANGE_TIMEOUT_MS * 1000;
+	while ((now = g_get_monotonic_time()) < deadline) {
+		memset(fds, 0, sizeof(fds));
+		fds[0].fd = desc->fd;
+		fds[0].events = POLLIN;
+		ret = poll(fds, ARRAY_SIZE(fds), (deadline - now) / 1000 + 1);
+		if (ret <= 0)
+			break;
+		rdlen = read(desc->fd, buf, sizeof(buf));
+		if (rdlen <= 0)
+			break;
+		switch (buf[0]) {
+		case BLE_ATT_EXCHANGE_MTU_RESP:
+			if (rdlen < 3)
+				return;
+			peer_mtu = bt_get_le16(&buf[1]);
+			desc->mtu = MAX(MIN(local_mtu, peer_mtu), ATT_MTU_DEFAULT);
+			sr_dbg("ATT MTU %u (peer %u).", desc->mtu, peer_mtu);
+			return;
+		case BLE_ATT_EXCHANGE_MTU_REQ:
+			/* The peer starts an exchange of its own. */
+			buf[0] = BLE_ATT_EXCHANGE_MTU_RESP;
+			write_u16le(&buf[1], local_mtu);
+			if (write(desc->fd, buf, 3) != 3)
+				return;
+			break;
+		case BLE_ATT_ERROR_RESP:
+			if (rdlen >= 2 && buf[1] == BLE_ATT_EXCHANGE_MTU_REQ) {
+				sr_dbg("Peer does not support an MTU exchange.");
+				return;
+			}
+			break;
+		default:
+			/* Nothing else was requested yet. */
+			break;
+		}
+	}
+	sr_dbg("No response to the ATT MTU exchange.");
+}
+
+/*
+ * Ask the controller to update the connection parameters. This needs
+ * the privileges to send HCI commands, and the peer may reject (or not
+ * support) the parameters. Neither is fatal, the connection then keeps
+ * its parameters.
+ */
+static void sr_bt_update_conn_params(struct sr_bt_desc *desc)
+{
+	struct l2cap_conninfo info;
+	socklen_t len;
+	int devid, dd, ret;
+	uint16_t min, max;
+
+	if (!desc->conn_interval_max)
+		return;
+
+	len = sizeof(info);
+	memset(&info, 0, sizeof(info));
+	if (getsockopt(desc->fd, SOL_L2CAP, L2CAP_CONNINFO, &info, &len) < 0) {
+		sr_dbg("Cannot get the connection handle: %s.",
+			g_strerror(errno));
+		return;
+	}
+
+	if (desc->local_addr[0])
+		devid = hci_devid(desc->local_addr);
+	else
+		devid = hci_get_route(NULL);
+	dd = devid < 0 ? -1 : hci_open_dev(devid);
+	if (dd < 0) {
+		sr_dbg("Cannot open the HCI device: %s.", g_strerror(errno));
+		return;
+	}
+
+	/* The controller's units are 1.25ms. */
+	min = desc->conn_interval_min / 1250;
+	max = (desc->conn_interval_max + 1249) / 1250;
+	ret = hci_le_conn_update(dd, htobs(info.hci_handle),
+		htobs(min), htobs(max), htobs(0), htobs(CONN_SUPERVISION_10MS),
+		CONN_UPDATE_TIMEOUT_MS);
+	if (ret < 0)
+		sr_dbg("Connection parameter update failed: %s.",
+			g_strerror(errno));
+	else
+		sr_dbg("Connection interval %u..%u us requested.",
+			desc->conn_interval_min, desc->conn_interval_max);
+	hci_close_dev(dd);
+}
+
 SR_PRIV int sr_bt_connect_ble(struct sr_bt_desc *desc)
 {
 	struct sockaddr_l2 sl2;
@@ -773,17 +927,17 @@ SR_PRIV int sr_bt_connect_ble(struct sr_bt_desc *desc)
 			perror("connect(PROGRESS)");
 			return soerror;
 		}
-
-		/*
-		 * TODO Get the receive MTU here?
-		 * getsockopt(SOL_BLUETOOTH, BT_RCVMTU, u16);
-		 */
+		ret = 0;
 	}
 	if (ret < 0) {
 		perror("connect");
 		return ret;
 	}
 
+	desc->mtu = ATT_MTU_DEFAULT;
+	sr_bt_exchange_mtu(desc);
+	sr_bt_update_conn_params(desc);
+
 	return 0;
 }
 
@@ -898,28 +1052,15 @@ SR_PRIV int sr_bt_start_notify(struct sr_bt_desc *desc)
 	return 0;
 }
 
-SR_PRIV int sr_bt_check_notify(struct sr_bt_desc *desc)
+/* Dispatch one message which was received from the Bluetooth socket. */
+static int sr_bt_handle_message(struct sr_bt_desc *desc,
+	uint8_t *buf, ssize_t rdlen)
 {
-	uint8_t buf[1024];
-	ssize_t rdlen;
 	uint8_t packet_type;
 	uint16_t packet_handle;
 	uint8_t *packet_data;
 	size_t packet_dlen;
 
-	if (!desc)
-		return -1;
-
-	if (sr_bt_check_socket_usable(desc) < 0)
-		return -2;
-
-	/* Get another message from the Bluetooth socket. */
-	rdlen = sr_bt_read(desc, buf, sizeof(buf));
-	if (rdlen < 0)
-		return -2;
-	if (!rdlen)
-		return 0;
-
 	/* Get header fields and references to the payload data. */
 	packet_type = 0x00;
 	packet_handle = 0x0000;
@@ -943,6 +1084,13 @@ SR_PRIV int sr_bt_check_notify(struct sr_bt_desc *desc)
 		sr_spew("read() len %zd, type 0x%02x (%s)", rdlen, buf[0], "write response");
 		/* EMPTY */
 		break;
+	case BLE_ATT_EXCHANGE_MTU_REQ:
+		sr_spew("read() len %zd, type 0x%02x (%s)", rdlen, buf[0], "MTU request");
+		buf[0] = BLE_ATT_EXCHANGE_MTU_RESP;
+		write_u16le(&buf[1], desc->mtu);
+		if (write(desc->fd, buf, 3) != 3)
+			return -2;
+		break;
 	case BLE_ATT_HANDLE_INDICATION:
 		sr_spew("read() len %zd, type 0x%02x (%s)", rdlen, buf[0], "handle indication");
 		sr_bt_write_type(desc, BLE_ATT_HANDLE_CONFIRMATION);
@@ -970,6 +1118,45 @@ SR_PRIV int sr_bt_check_notify(struct sr_bt_desc *desc)
 	return 0;
 }
 
+/*
+ * Handle the messages which the Bluetooth socket has pending. Several
+ * notifications get handled per call, after the first one the socket
+ * gets read without polling it again. Returns the number of handled
+ * messages, or a negative value upon errors.
+ */
+SR_PRIV int sr_bt_check_notify(struct sr_bt_desc *desc)
+{
+	uint8_t buf[1024];
+	ssize_t rdlen;
+	int count, ret;
+
+	if (!desc)
+		return -1;
+
+	if (sr_bt_check_socket_usable(desc) < 0)
+		return -2;
+
+	/* Get another message from the Bluetooth socket. */
+	rdlen = sr_bt_read(desc, buf, sizeof(buf));
+	if (rdlen < 0)
+		return -2;
+	if (!rdlen)
+		return 0;
+
+	count = 0;
+	do {
+		ret = sr_bt_handle_message(desc, buf, rdlen);
+		if (ret < 0)
+			return ret;
+		count++;
+		if (count >= NOTIFY_BATCH_SIZE)
+			break;
+		rdlen = recv(desc->fd, buf, sizeof(buf), MSG_DONTWAIT);
+	} while (rdlen > 0);
+
+	return count;
+}
+
 /* }}} indication/notification */
 /* {{{ read/write */
 
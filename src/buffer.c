@@ -0,0 +1,305 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Reference counted sample data buffers, and pools which recycle them.
+ *
+ * Producers which send sample data from a pool buffer "lend" it to the
+ * session while the packet gets dispatched. Consumers which keep the
+ * data (sr_packet_copy()) take a reference instead of copying it. The
+ * producer continues in a fresh buffer when the previous one is still
+ * referenced after the send call, and buffers return to their pool
+ * when the last reference is gone.
+ *
+ * Buffer data starts on an SR_DATAFEED_ALIGN boundary and is padded to a
+ * multiple of it, so that consumers can use aligned full-width vector
+ * loads on it, see sr_datafeed_data_aligned().
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "buffer"
+
+struct sr_buffer_pool {
+	gint refcount;
+	size_t size;
+	size_t max_idle;
+	GMutex mutex;
+	GSList *idle;
+	size_t idle_count;
+};
+
+/* The buffer which the current thread has lent to the session. */
+static GPrivate lent_buffer = G_PRIVATE_INIT(NULL);
+
+#define ALIGN_UP(n)	(((n) + SR_DATAFEED_ALIGN - 1) \
+			& ~(size_t)(SR_DATAFEED_ALIGN - 1))
+
+/**
+ * Allocate memory which starts on an SR_DATAFEED_ALIGN boundary, and is
+ * padded to a multiple of it.
+ *
+ * @param[in] size The size in bytes.
+ *
+ * @returns The memory, or NULL when it cannot get allocated. Release it
+ *          with sr_aligned_free().
+ */
+SR_PRIV void *sr_aligned_alloc(size_t size)
+{
+	uint8_t *mem, *data;
+
+	/* Keep the start of the allocation right before the data. */
+	mem = g_try_malloc(ALIGN_UP(MAX(size, 1)) + SR_DATAFEED_ALIGN
+		+ sizeof(void *));
+	if (!mem)
+		return NULL;
+	data = (uint8_t *)ALIGN_UP((uintptr_t)(mem + sizeof(void *)));
+	memcpy(data - sizeof(void *), &mem, sizeof(void *));
+
+	return data;
+}
+
+/** Release memory from sr_aligned_alloc(). */
+SR_PRIV void sr_aligned_free(void *data)
+{
+	void *mem;
+
+	if (!data)
+		return;
+
+	memcpy(&mem, (uint8_t *)data - sizeof(void *), sizeof(void *));
+	g_free(mem);
+}
+
+/* Buffer header and data are one allocation, the data gets aligned. */
+static struct sr_buffer *buffer_alloc(size_t size)
+{
+	struct sr_buffer *buf;
+	uintptr_t data;
+
+	buf = g_malloc(sizeof(*buf) + SR_DATAFEED_ALIGN + ALIGN_UP(size));
+	data = ALIGN_UP((uintptr_t)&buf[1]);
+	buf->data = (uint8_t *)data;
+	buf->size = size;
+	buf->tag = sr_mem_tag_current();
+	sr_mem_alloc_add(buf->tag, buf->size);
+
+	return buf;
+}
+
+static void buffer_free(struct sr_buffer *buf)
+{
+	sr_mem_free_add(buf->tag, buf->size);
+	g_free(buf);
+}
+
+static void pool_unref(struct sr_buffer_pool *pool)
+{
+	if (!g_atomic_int_dec_and_test(&pool->refcount))
+		return;
+
+	g_slist_free_full(pool->idle, (GDestroyNotify)buffer_free);
+	g_mutex_clear(&pool->mutex);
+	g_free(pool);
+}
+
+/**
+ * Create a pool of buffers of the given size.
+ *
+ * @param[in] size The size of a buffer in bytes.
+ * @param[in] max_idle The number of released buffers to keep for re-use.
+ *
+ * @returns The new pool. Release it with sr_buffer_pool_free().
+ */
+SR_PRIV struct sr_buffer_pool *sr_buffer_pool_new(size_t size, size_t max_idle)
+{
+	struct sr_buffer_pool *pool;
+
+	pool = g_malloc0(sizeof(*pool));
+	pool->refcount = 1;
+	pool->size = size;
+	pool->max_idle = max_idle;
+	g_mutex_init(&pool->mutex);
+
+	return pool;
+}
+
+/**
+ * Release a pool. Buffers which are still referenced stay valid, the
+ * pool's memory gets released after the last of them.
+ */
+SR_PRIV void sr_buffer_pool_free(struct sr_buffer_pool *pool)
+{
+	if (!pool)
+		return;
+
+	pool_unref(pool);
+}
+
+/**
+ * Get a buffer from a pool, with a reference count of one.
+ */
+SR_PRIV struct sr_buffer *sr_buffer_pool_get(struct sr_buffer_pool *pool)
+{
+	struct sr_buffer *buf;
+	GSList *l;
+
+	buf = NULL;
+	g_mutex_lock(&pool->mutex);
+	if ((l = pool->idle)) {
+		pool->idle = l->next;
+		pool->idle_count--;
+		buf = l->data;
+		g_slist_free_1(l);
+	}
+	g_mutex_unlock(&pool->mutex);
+
+	if (!buf)
+		buf = buffer_alloc(pool->size);
+	buf->refcount = 1;
+	buf->pool = pool;
+	g_atomic_int_inc(&pool->refcount);
+
+	return buf;
+}
+
+/**
+ * Allocate a buffer outside of any pool, with a reference count of one.
+ * It gets freed when the last reference is gone.
+ */
+SR_PRIV struct sr_buffer *sr_buffer_new(size_t size)
+{
+	struct sr_buffer *buf;
+
+	buf = buffer_alloc(size);
+	buf->refcount = 1;
+	buf->pool = NULL;
+
+	return buf;
+}
+
+SR_PRIV struct sr_buffer *sr_buffer_ref(struct sr_buffer *buf)
+{
+	g_atomic_int_inc(&buf->refcount);
+
+	return buf;
+}
+
+SR_PRIV void sr_buffer_unref(struct sr_buffer *buf)
+{
+	struct sr_buffer_pool *pool;
+
+	if (!buf || !g_atomic_int_dec_and_test(&buf->refcount))
+		return;
+
+	if (!(pool = buf->pool)) {
+		buffer_free(buf);
+		return;
+	}
+	g_mutex_lock(&pool->mutex);
+	if (pool->idle_count < pool->max_idle &&
+			g_atomic_int_get(&pool->refcount) > 1) {
+		pool->idle = g_slist_prepend(pool->idle, buf);
+		pool->idle_count++;
+		buf = NULL;
+	}
+	g_mutex_unlock(&pool->mutex);
+	if (buf)
+		buffer_free(buf);
+	pool_unref(pool);
+}
+
+/**
+ * Check whether a buffer has other users than the caller.
+ */
+SR_PRIV gboolean sr_buffer_is_shared(struct sr_buffer *buf)
+{
+	return g_atomic_int_get(&buf->refcount) > 1;
+}
+
+/**
+ * Lend a buffer to the session, for the current thread. Returns the
+ * previously lent buffer, which the caller restores after dispatch.
+ */
+SR_PRIV struct sr_buffer *sr_buffer_lend(struct sr_buffer *buf)
+{
+	struct sr_buffer *prev;
+
+	prev = g_private_get(&lent_buffer);
+	g_private_set(&lent_buffer, buf);
+
+	return prev;
+}
+
+/**
+ * Get a reference to the lent buffer which holds the given data range,
+ * or NULL when the data is not in a lent buffer.
+ */
+SR_PRIV struct sr_buffer *sr_buffer_lent_ref(const void *data, size_t size)
+{
+	struct sr_buffer *buf;
+	const uint8_t *p;
+
+	buf = g_private_get(&lent_buffer);
+	if (!buf || !data)
+		return NULL;
+	p = data;
+	if (p < buf->data || p + size > buf->data + buf->size)
+		return NULL;
+
+	return sr_buffer_ref(buf);
+}
+
+/**
+ * Check whether the sample data of the packet which is being dispatched
+ * can be read with aligned full-width vector loads.
+ *
+ * This is the case when the data starts on an SR_DATAFEED_ALIGN boundary,
+ * and the memory is readable up to the size rounded up to a multiple of
+ * SR_DATAFEED_ALIGN. Bytes past the size have unspecified values. Data
+ * which the session's buffers hold qualifies, see feed_queue.c and the
+ * session file driver. Other data may be aligned by chance, consumers
+ * must not rely on that.
+ *
+ * Only valid within datafeed callbacks, for the packet which they get.
+ *
+ * @param[in] data The packet's data, e.g. sr_datafeed_logic.data.
+ * @param[in] size The size of the data in bytes.
+ *
+ * @returns TRUE when the guarantees hold.
+ *
+ * @since 0.6.0
+ */
+SR_API gboolean sr_datafeed_data_aligned(const void *data, size_t size)
+{
+	struct sr_buffer *buf;
+	const uint8_t *p;
+
+	buf = g_private_get(&lent_buffer);
+	if (!buf || !data || ((uintptr_t)data & (SR_DATAFEED_ALIGN - 1)))
+		return FALSE;
+	p = data;
+	if (p < buf->data || p + ALIGN_UP(size) > buf->data + ALIGN_UP(buf->size))
+		return FALSE;
+
+	return TRUE;
+}
@@ -23,6 +23,8 @@
  * Conversion helper functions.
  */
 
+#include <config.h>
+#include <string.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -30,9 +32,518 @@
 #define LOG_PREFIX "conv"
 /** @endcond */
 
+#if !defined(WORDS_BIGENDIAN) && defined(__GNUC__) && defined(__x86_64__)
+#define A2L_SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/* Samples are classified in blocks, one bit per sample. */
+#define A2L_BLOCK 64
+
+/** @cond PRIVATE */
+enum a2l_compare {
+	A2L_GE,
+	A2L_LT,
+	A2L_GT,
+};
+
+/*
+ * Integer input gets compared in the raw domain. Each threshold
+ * comparison is turned into an interval of raw values, which yield
+ * a true result.
+ */
+struct a2l_int {
+	size_t unitsize;
+	gboolean is_signed;
+	gboolean is_bigendian;
+	int64_t min, max;
+	double scale, offset;
+};
+
+struct a2l_input {
+	const struct sr_datafeed_analog *analog;
+	/* First value of the channel, and the distance between its values. */
+	const uint8_t *data;
+	size_t step;
+	unsigned int channel;
+	unsigned int num_channels;
+	gboolean is_int;
+	struct a2l_int ai;
+	/* Float input which needs neither conversion nor scaling. */
+	gboolean is_native;
+};
+
+/*
+ * The conversion of one channel: a threshold, or the "below low" and
+ * "above high" comparisons of a Schmitt-trigger, each with its raw
+ * value intervals for integer input.
+ */
+struct a2l_chan {
+	struct a2l_input in;
+	gboolean schmitt;
+	float thr[2];
+	int64_t lo[2], hi[2];
+};
+
+struct a2l_conv_channel {
+	gboolean schmitt;
+	float lo_thr, hi_thr;
+	uint8_t state;
+};
+
+struct sr_a2l_converter {
+	unsigned int num_channels;
+	struct a2l_conv_channel *channels;
+	uint8_t *buf;
+	size_t buf_size;
+};
+/** @endcond */
+
+/*
+ * Setup reading one channel of the input. With num_channels of 0, the
+ * data is taken as a single channel, whatever the channel list says.
+ */
+static int a2l_input_setup(struct a2l_input *in,
+		const struct sr_datafeed_analog *analog,
+		unsigned int channel, unsigned int num_channels)
+{
+	const struct sr_analog_encoding *enc;
+	struct a2l_int *ai;
+	size_t bits;
+
+	if (!analog || !analog->data || !analog->encoding)
+		return SR_ERR_ARG;
+
+	enc = analog->encoding;
+	memset(in, 0, sizeof(*in));
+	in->analog = analog;
+	in->channel = channel;
+	in->num_channels = num_channels ? num_channels : 1;
+	in->data = (const uint8_t *)analog->data + channel * enc->unitsize;
+	in->step = enc->stride ? enc->stride : enc->unitsize * in->num_channels;
+	if (num_channels && !analog->meaning)
+		return SR_ERR_ARG;
+
+	if (enc->is_float) {
+#ifdef WORDS_BIGENDIAN
+		in->is_native = enc->is_bigendian;
+#else
+		in->is_native = !enc->is_bigendian;
+#endif
+		in->is_native = in->is_native && enc->unitsize == sizeof(float)
+			&& enc->scale.p == (int64_t)enc->scale.q
+			&& enc->offset.p == 0 && in->num_channels == 1
+			&& in->step == enc->unitsize
+			&& !enc->channel_scale && !enc->channel_offset;
+		if (!in->is_native && !analog->meaning)
+			return SR_ERR_ARG;
+		return SR_OK;
+	}
+	if (enc->unitsize != 1 && enc->unitsize != 2 && enc->unitsize != 4) {
+		sr_err("Unsupported unit size %u for analog-to-logic conversion.",
+			enc->unitsize);
+		return SR_ERR;
+	}
+
+	in->is_int = TRUE;
+	ai = &in->ai;
+	ai->unitsize = enc->unitsize;
+	ai->is_signed = enc->is_signed;
+	ai->is_bigendian = enc->is_bigendian;
+	bits = enc->unitsize * 8;
+	if (enc->is_signed) {
+		ai->min = -((int64_t)1 << (bits - 1));
+		ai->max = ((int64_t)1 << (bits - 1)) - 1;
+	} else {
+		ai->min = 0;
+		ai->max = ((int64_t)1 << bits) - 1;
+	}
+	sr_analog_channel_scaling(analog, channel, &ai->scale, &ai->offset);
+
+	return SR_OK;
+}
+
+static int64_t a2l_int_read(const struct a2l_int *ai, const uint8_t *p)
+{
+	switch (ai->unitsize) {
+	case 1:
+		return ai->is_signed ? read_i8(p) : read_u8(p);
+	case 2:
+		if (ai->is_bigendian)
+			return ai->is_signed ? read_i16be(p) : read_u16be(p);
+		return ai->is_signed ? read_i16le(p) : read_u16le(p);
+	default:
+		/* Not using ?: here, which would make signed values unsigned. */
+		if (ai->is_signed) {
+			if (ai->is_bigendian)
+				return read_i32be(p);
+			return read_i32le(p);
+		}
+		if (ai->is_bigendian)
+			return read_u32be(p);
+		return read_u32le(p);
+	}
+}
+
+/* Compare a raw value like it would be after sr_analog_to_float(). */
+static gboolean a2l_int_compare(const struct a2l_int *ai, int64_t raw,
+		enum a2l_compare cmp, float thr)
+{
+	double value;
+	float f;
+
+	value = raw;
+	value *= ai->scale;
+	value += ai->offset;
+	f = value;
+
+	switch (cmp) {
+	case A2L_GE:
+		return f >= thr;
+	case A2L_LT:
+		return f < thr;
+	default:
+		return f > thr;
+	}
+}
+
+/*
+ * Find the raw values [lo, hi] for which the comparison is true. The
+ * conversion is monotonic, so they form a prefix or a suffix of the
+ * raw range, and the boundary is found by binary search. The interval
+ * is empty if lo > hi.
+ */
+static void a2l_int_range(const struct a2l_int *ai, enum a2l_compare cmp,
+		float thr, int64_t *lo, int64_t *hi)
+{
+	gboolean at_min, at_max;
+	int64_t l, h, mid;
+
+	at_min = a2l_int_compare(ai, ai->min, cmp, thr);
+	at_max = a2l_int_compare(ai, ai->max, cmp, thr);
+	if (at_min == at_max) {
+		*lo = at_min ? ai->min : ai->max;
+		*hi = at_min ? ai->max : ai->min - 1;
+		return;
+	}
+
+	/* Invariant: l has the result at_min, h has the other one. */
+	l = ai->min;
+	h = ai->max;
+	while (h - l > 1) {
+		mid = l + (h - l) / 2;
+		if (a2l_int_compare(ai, mid, cmp, thr) == at_min)
+			l = mid;
+		else
+			h = mid;
+	}
+	if (at_min) {
+		*lo = ai->min;
+		*hi = l;
+	} else {
+		*lo = h;
+		*hi = ai->max;
+	}
+}
+
+#ifdef A2L_SIMD_SSE2
+/* Classify 16 samples of 8 or 16 bits little endian, one bit each. */
+static uint16_t a2l_match16_sse2(const struct a2l_int *ai, const uint8_t *p,
+		__m128i vlo, __m128i vhi)
+{
+	__m128i v, w, bias, out;
+
+	if (ai->unitsize == 1) {
+		v = _mm_loadu_si128((const __m128i *)p);
+		if (!ai->is_signed)
+			v = _mm_xor_si128(v, _mm_set1_epi8((char)0x80));
+		out = _mm_or_si128(_mm_cmpgt_epi8(vlo, v), _mm_cmpgt_epi8(v, vhi));
+		return ~_mm_movemask_epi8(out);
+	}
+
+	bias = _mm_set1_epi16(ai->is_signed ? 0 : (short)0x8000);
+	v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)p), bias);
+	w = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(p + 16)), bias);
+	v = _mm_or_si128(_mm_cmpgt_epi16(vlo, v), _mm_cmpgt_epi16(v, vhi));
+	w = _mm_or_si128(_mm_cmpgt_epi16(vlo, w), _mm_cmpgt_epi16(w, vhi));
+
+	return ~_mm_movemask_epi8(_mm_packs_epi16(v, w));
+}
+#endif
+
+/* Classify up to A2L_BLOCK integer samples against a raw interval. */
+static uint64_t a2l_int_match(const struct a2l_int *ai, const uint8_t *p,
+		size_t step, size_t count, int64_t lo, int64_t hi)
+{
+	uint64_t mask;
+	int64_t raw;
+	size_t i;
+
+	if (lo > hi)
+		return 0;
+	if (lo <= ai->min && hi >= ai->max)
+		return count == 64 ? ~(uint64_t)0 : ((uint64_t)1 << count) - 1;
+
+	mask = 0;
+	i = 0;
+#ifdef A2L_SIMD_SSE2
+	if (ai->unitsize <= 2 && !ai->is_bigendian && step == ai->unitsize) {
+		__m128i vlo, vhi;
+		int64_t bias;
+
+		/* Compare in the signed domain, unsigned values get biased. */
+		bias = ai->is_signed ? 0 : (ai->max + 1) / 2;
+		if (ai->unitsize == 1) {
+			vlo = _mm_set1_epi8((char)(MAX(lo, ai->min) - bias));
+			vhi = _mm_set1_epi8((char)(MIN(hi, ai->max) - bias));
+		} else {
+			vlo = _mm_set1_epi16((short)(MAX(lo, ai->min) - bias));
+			vhi = _mm_set1_epi16((short)(MIN(hi, ai->max) - bias));
+		}
+		for (; i + 16 <= count; i += 16)
+			mask |= (uint64_t)a2l_match16_sse2(ai,
+				p + i * ai->unitsize, vlo, vhi) << i;
+	}
+#endif
+	for (; i < count; i++) {
+		raw = a2l_int_read(ai, p + i * step);
+		if (raw >= lo && raw <= hi)
+			mask |= (uint64_t)1 << i;
+	}
+
+	return mask;
+}
+
+/* Classify up to A2L_BLOCK float values. */
+static uint64_t a2l_float_match(const float *v, size_t count,
+		enum a2l_compare cmp, float thr)
+{
+	uint64_t mask;
+	size_t i;
+
+	mask = 0;
+	i = 0;
+#ifdef A2L_SIMD_SSE2
+	{
+		__m128 vthr, f, res;
+
+		vthr = _mm_set1_ps(thr);
+		for (; i + 4 <= count; i += 4) {
+			f = _mm_loadu_ps(v + i);
+			if (cmp == A2L_GE)
+				res = _mm_cmpge_ps(f, vthr);
+			else if (cmp == A2L_LT)
+				res = _mm_cmplt_ps(f, vthr);
+			else
+				res = _mm_cmpgt_ps(f, vthr);
+			mask |= (uint64_t)_mm_movemask_ps(res) << i;
+		}
+	}
+#endif
+	for (; i < count; i++) {
+		if (cmp == A2L_GE ? v[i] >= thr : cmp == A2L_LT ? v[i] < thr : v[i] > thr)
+			mask |= (uint64_t)1 << i;
+	}
+
+	return mask;
+}
+
+/*
+ * Get the float values of a block of samples. Native data is used in
+ * place, other encodings get converted into the caller's buffer.
+ */
+static const float *a2l_float_block(const struct a2l_input *in,
+		uint64_t pos, size_t count, float *buf)
+{
+	struct sr_datafeed_analog analog;
+	struct sr_analog_meaning meaning;
+	GSList channel;
+
+	if (in->is_native)
+		return (const float *)(in->data + pos * in->step);
+
+	/* Convert just this block. */
+	analog = *in->analog;
+	analog.data = (uint8_t *)in->analog->data + pos * in->step;
+	analog.num_samples = count;
+	if (in->num_channels > 1) {
+		if (sr_analog_channel_to_float(&analog, in->channel, buf, 1) != SR_OK)
+			return NULL;
+		return buf;
+	}
+
+	meaning = *in->analog->meaning;
+	channel.data = NULL;
+	channel.next = NULL;
+	meaning.channels = &channel;
+	analog.meaning = &meaning;
+	if (sr_analog_to_float(&analog, buf) != SR_OK)
+		return NULL;
+
+	return buf;
+}
+
+/* Spread the 8 bits of a byte to the low bits of 8 bytes (LSB first). */
+static inline uint64_t a2l_bits_to_bytes(uint8_t m)
+{
+	uint64_t x;
+
+	x = m;
+	x = (x | x << 28) & 0x0000000f0000000fULL;
+	x = (x | x << 14) & 0x0003000300030003ULL;
+	x = (x | x << 7) & 0x0101010101010101ULL;
+
+	return x;
+}
+
+/*
+ * Write a block of results, either one byte per sample or packed with
+ * 8 samples per byte (LSB first). Blocks start at multiples of 64.
+ */
+static void a2l_emit(uint8_t *output, uint64_t pos, size_t count,
+		uint64_t mask, gboolean packed)
+{
+	uint8_t bytes[8];
+	size_t i;
+
+	if (packed) {
+		output += pos / 8;
+		for (i = 0; i < (count + 7) / 8; i++)
+			output[i] = mask >> (i * 8);
+		return;
+	}
+
+	output += pos;
+	for (i = 0; i + 8 <= count; i += 8)
+		write_u64le(output + i, a2l_bits_to_bytes(mask >> i));
+	if (i < count) {
+		write_u64le(bytes, a2l_bits_to_bytes(mask >> i));
+		memcpy(output + i, bytes, count - i);
+	}
+}
+
+/*
+ * Run the Schmitt-trigger over a block's "below low" and "above high"
+ * masks. Blocks without any crossing keep the state, in one go.
+ */
+static uint64_t a2l_schmitt_block(uint64_t below, uint64_t above,
+		size_t count, uint8_t *state)
+{
+	uint64_t mask, bit;
+	size_t i;
+
+	if (!(below | above)) {
+		if (!*state)
+			return 0;
+		return count == 64 ? ~(uint64_t)0 : ((uint64_t)1 << count) - 1;
+	}
+
+	mask = 0;
+	for (i = 0; i < count; i++) {
+		bit = (uint64_t)1 << i;
+		if (below & bit)
+			*state = 0;
+		else if (above & bit)
+			*state = 1;
+		if (*state)
+			mask |= bit;
+	}
+
+	return mask;
+}
+
+static int a2l_chan_setup(struct a2l_chan *ch,
+		const struct sr_datafeed_analog *analog,
+		unsigned int channel, unsigned int num_channels,
+		gboolean schmitt, float lo_thr, float hi_thr)
+{
+	int ret;
+
+	if ((ret = a2l_input_setup(&ch->in, analog, channel, num_channels)) != SR_OK)
+		return ret;
+
+	ch->schmitt = schmitt;
+	ch->thr[0] = lo_thr;
+	ch->thr[1] = hi_thr;
+	if (!ch->in.is_int)
+		return SR_OK;
+	if (schmitt) {
+		a2l_int_range(&ch->in.ai, A2L_LT, lo_thr, &ch->lo[0], &ch->hi[0]);
+		a2l_int_range(&ch->in.ai, A2L_GT, hi_thr, &ch->lo[1], &ch->hi[1]);
+	} else {
+		a2l_int_range(&ch->in.ai, A2L_GE, lo_thr, &ch->lo[0], &ch->hi[0]);
+	}
+
+	return SR_OK;
+}
+
+/* Classify a block of up to A2L_BLOCK samples, one bit per sample. */
+static int a2l_chan_block(const struct a2l_chan *ch, uint64_t pos, size_t n,
+		uint8_t *state, uint64_t *mask)
+{
+	const struct a2l_input *in;
+	float buf[A2L_BLOCK];
+	const float *values;
+	const uint8_t *p;
+	uint64_t below, above;
+
+	in = &ch->in;
+	if (in->is_int) {
+		p = in->data + pos * in->step;
+		if (!ch->schmitt) {
+			*mask = a2l_int_match(&in->ai, p, in->step, n,
+				ch->lo[0], ch->hi[0]);
+			return SR_OK;
+		}
+		below = a2l_int_match(&in->ai, p, in->step, n,
+			ch->lo[0], ch->hi[0]);
+		above = a2l_int_match(&in->ai, p, in->step, n,
+			ch->lo[1], ch->hi[1]);
+	} else {
+		if (!(values = a2l_float_block(in, pos, n, buf)))
+			return SR_ERR;
+		if (!ch->schmitt) {
+			*mask = a2l_float_match(values, n, A2L_GE, ch->thr[0]);
+			return SR_OK;
+		}
+		below = a2l_float_match(values, n, A2L_LT, ch->thr[0]);
+		above = a2l_float_match(values, n, A2L_GT, ch->thr[1]);
+	}
+	*mask = a2l_schmitt_block(below, above, n, state);
+
+	return SR_OK;
+}
+
+static int a2l_convert(const struct sr_datafeed_analog *analog,
+		gboolean schmitt, float lo_thr, float hi_thr, uint8_t *state,
+		uint8_t *output, uint64_t count, gboolean packed)
+{
+	struct a2l_chan ch;
+	uint64_t pos, mask;
+	size_t n;
+	int ret;
+
+	if (!output || (schmitt && !state))
+		return SR_ERR_ARG;
+	if ((ret = a2l_chan_setup(&ch, analog, 0, 0, schmitt, lo_thr, hi_thr)) != SR_OK)
+		return ret;
+
+	for (pos = 0; pos < count; pos += n) {
+		n = MIN(count - pos, A2L_BLOCK);
+		if ((ret = a2l_chan_block(&ch, pos, n, state, &mask)) != SR_OK)
+			return ret;
+		a2l_emit(output, pos, n, mask, packed);
+	}
+
+	return SR_OK;
+}
+
 /**
  * Convert analog values to logic values by using a fixed threshold.
  *
+ * Integer input gets compared in its raw encoding, against a threshold
+ * which gets pre-scaled, without converting samples to float.
+ *
  * @param[in] analog The analog input values.
  * @param[in] threshold The threshold to use.
  * @param[out] output The converted output values; either 0 or 1. Must provide
@@ -44,24 +555,30 @@
 SR_API int sr_a2l_threshold(const struct sr_datafeed_analog *analog,
 		float threshold, uint8_t *output, uint64_t count)
 {
-	float *input;
-
-	if (!analog->encoding->is_float) {
-		input = g_try_malloc(sizeof(float) * count);
-		if (!input)
-			return SR_ERR;
-
-		sr_analog_to_float(analog, input);
-	} else
-		input = analog->data;
-
-	for (uint64_t i = 0; i < count; i++)
-		output[i] = (input[i] >= threshold) ? 1 : 0;
-
-	if (!analog->encoding->is_float)
-		g_free(input);
+	return a2l_convert(analog, FALSE, threshold, 0, NULL, output, count, FALSE);
+}
 
-	return SR_OK;
+/**
+ * Convert analog values to packed logic values by using a fixed threshold.
+ *
+ * Like sr_a2l_threshold(), but the results are packed with 8 samples
+ * per byte, the first sample in the least significant bit. Unused bits
+ * of the last byte are cleared.
+ *
+ * @param[in] analog The analog input values.
+ * @param[in] threshold The threshold to use.
+ * @param[out] output The converted output values. Must provide space for
+ *                    (count + 7) / 8 bytes.
+ * @param[in] count The number of samples to process.
+ *
+ * @return SR_OK on success or SR_ERR on failure.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_a2l_threshold_packed(const struct sr_datafeed_analog *analog,
+		float threshold, uint8_t *output, uint64_t count)
+{
+	return a2l_convert(analog, FALSE, threshold, 0, NULL, output, count, TRUE);
 }
 
 /**
@@ -82,28 +599,365 @@ SR_API int sr_a2l_schmitt_trigger(const struct sr_datafeed_analog *analog,
 		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
 		uint64_t count)
 {
-	float *input;
+	return a2l_convert(analog, TRUE, lo_thr, hi_thr, state, output,
+		count, FALSE);
+}
 
-	if (!analog->encoding->is_float) {
-		input = g_try_malloc(sizeof(float) * count);
-		if (!input)
-			return SR_ERR;
+/**
+ * Convert analog values to packed logic values by using a Schmitt-trigger
+ * algorithm.
+ *
+ * Like sr_a2l_schmitt_trigger(), but the results are packed with 8
+ * samples per byte, the first sample in the least significant bit.
+ * Unused bits of the last byte are cleared.
+ *
+ * @param analog The analog input values.
+ * @param lo_thr The low threshold - result becomes 0 below it.
+ * @param hi_thr The high threshold - result becomes 1 above it.
+ * @param state The internal converter state. Must contain the state of logic
+ *        sample n-1, will contain the state of logic sample n+count upon exit.
+ * @param output The converted output values. Must provide space for
+ *        (count + 7) / 8 bytes.
+ * @param count The number of samples to process.
+ *
+ * @return SR_OK on success or SR_ERR on failure.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_a2l_schmitt_trigger_packed(const struct sr_datafeed_analog *analog,
+		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
+		uint64_t count)
+{
+	return a2l_convert(analog, TRUE, lo_thr, hi_thr, state, output,
+		count, TRUE);
+}
 
-		sr_analog_to_float(analog, input);
-	} else
-		input = analog->data;
+/**
+ * Create a converter from multi-channel analog data to packed logic data.
+ *
+ * Each channel of the analog data becomes one bit of the logic data.
+ * Channels use a threshold of 0.0 until configured otherwise. The
+ * Schmitt-trigger state of channels persists from packet to packet.
+ *
+ * @param[out] conv Pointer where to store the new converter.
+ * @param[in] num_channels The number of analog channels, at least 1.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_a2l_converter_new(struct sr_a2l_converter **conv,
+		unsigned int num_channels)
+{
+	if (!conv || !num_channels)
+		return SR_ERR_ARG;
 
-	for (uint64_t i = 0; i < count; i++) {
-		if (input[i] < lo_thr)
-			*state = 0;
-		else if (input[i] > hi_thr)
-			*state = 1;
+	*conv = g_malloc0(sizeof(**conv));
+	(*conv)->num_channels = num_channels;
+	(*conv)->channels = g_malloc0_n(num_channels,
+		sizeof((*conv)->channels[0]));
 
-		output[i] = *state;
+	return SR_OK;
+}
+
+/**
+ * Free a converter from analog to logic data.
+ *
+ * @param[in] conv The converter to free. May be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_a2l_converter_free(struct sr_a2l_converter *conv)
+{
+	if (!conv)
+		return;
+
+	g_free(conv->channels);
+	g_free(conv->buf);
+	g_free(conv);
+}
+
+/**
+ * Convert a channel by using a fixed threshold.
+ *
+ * @param[in] conv The converter.
+ * @param[in] channel The channel's index within the analog data.
+ * @param[in] threshold The threshold to use.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_a2l_converter_threshold_set(struct sr_a2l_converter *conv,
+		unsigned int channel, float threshold)
+{
+	if (!conv || channel >= conv->num_channels)
+		return SR_ERR_ARG;
+
+	conv->channels[channel].schmitt = FALSE;
+	conv->channels[channel].lo_thr = threshold;
+
+	return SR_OK;
+}
+
+/**
+ * Convert a channel by using a Schmitt-trigger algorithm.
+ *
+ * @param[in] conv The converter.
+ * @param[in] channel The channel's index within the analog data.
+ * @param[in] lo_thr The low threshold - result becomes 0 below it.
+ * @param[in] hi_thr The high threshold - result becomes 1 above it.
+ * @param[in] state The state to start with, either 0 or 1.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_a2l_converter_schmitt_set(struct sr_a2l_converter *conv,
+		unsigned int channel, float lo_thr, float hi_thr, uint8_t state)
+{
+	if (!conv || channel >= conv->num_channels)
+		return SR_ERR_ARG;
+
+	conv->channels[channel].schmitt = TRUE;
+	conv->channels[channel].lo_thr = lo_thr;
+	conv->channels[channel].hi_thr = hi_thr;
+	conv->channels[channel].state = state ? 1 : 0;
+
+	return SR_OK;
+}
+
+/**
+ * Convert an interleaved multi-channel analog packet to logic data.
+ *
+ * Channel n of the analog data becomes bit n of each logic sample. The
+ * logic data's unit size is the number of channels, rounded up to whole
+ * bytes.
+ *
+ * @param[in] conv The converter.
+ * @param[in] analog The analog input values. Must have as many channels
+ *                   as the converter.
+ * @param[out] logic The logic packet to fill in. Its data is owned by
+ *                   the converter, and remains valid until the next
+ *                   conversion, or until the converter gets freed.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_MALLOC Memory allocation error.
+ * @retval SR_ERR Unsupported encoding.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_a2l_converter_run(struct sr_a2l_converter *conv,
+		const struct sr_datafeed_analog *analog,
+		struct sr_datafeed_logic *logic)
+{
+	struct a2l_conv_channel *cc;
+	struct a2l_chan ch;
+	unsigned int c;
+	size_t unitsize, size, n, i;
+	uint64_t pos, mask;
+	uint8_t *p, bit;
+	void *buf;
+	int ret;
+
+	if (!conv || !analog || !analog->meaning || !logic)
+		return SR_ERR_ARG;
+	if (g_slist_length(analog->meaning->channels) != conv->num_channels)
+		return SR_ERR_ARG;
+
+	unitsize = (conv->num_channels + 7) / 8;
+	size = analog->num_samples * unitsize;
+	if (size > conv->buf_size) {
+		if (!(buf = g_try_realloc(conv->buf, size)))
+			return SR_ERR_MALLOC;
+		conv->buf = buf;
+		conv->buf_size = size;
+	}
+	if (size)
+		memset(conv->buf, 0, size);
+
+	for (c = 0; c < conv->num_channels; c++) {
+		cc = &conv->channels[c];
+		ret = a2l_chan_setup(&ch, analog, c, conv->num_channels,
+			cc->schmitt, cc->lo_thr, cc->hi_thr);
+		if (ret != SR_OK)
+			return ret;
+		p = conv->buf + c / 8;
+		bit = 1 << (c % 8);
+		for (pos = 0; pos < analog->num_samples; pos += n) {
+			n = MIN(analog->num_samples - pos, A2L_BLOCK);
+			ret = a2l_chan_block(&ch, pos, n, &cc->state, &mask);
+			if (ret != SR_OK)
+				return ret;
+			for (i = 0; mask; i++, mask >>= 1) {
+				if (mask & 1)
+					p[(pos + i) * unitsize] |= bit;
+			}
+		}
 	}
 
-	if (!analog->encoding->is_float)
-		g_free(input);
+	logic->length = size;
+	logic->unitsize = unitsize;
+	logic->data = conv->buf;
+
+	return SR_OK;
+}
+
+/* Check that the changes of RLE logic data are in order. */
+static int logic_rle_check(const struct sr_datafeed_logic_rle *rle)
+{
+	uint64_t i;
+
+	if (!rle->unitsize)
+		return SR_ERR_ARG;
+	if (!rle->num_samples)
+		return SR_OK;
+	if (!rle->num_changes || !rle->offsets || !rle->values)
+		return SR_ERR_ARG;
+	if (rle->offsets[0] != 0)
+		return SR_ERR_ARG;
+	for (i = 1; i < rle->num_changes; i++) {
+		if (rle->offsets[i] <= rle->offsets[i - 1])
+			return SR_ERR_ARG;
+	}
+	if (rle->offsets[rle->num_changes - 1] >= rle->num_samples)
+		return SR_ERR_ARG;
+
+	return SR_OK;
+}
+
+/**
+ * Expand run-length encoded logic data into one unit per sample.
+ *
+ * @param[in] rle The run-length encoded logic data.
+ * @param[out] data Buffer of rle->num_samples * rle->unitsize bytes,
+ *                  where the samples are stored.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or invalid list of changes.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_rle_expand(const struct sr_datafeed_logic_rle *rle,
+		uint8_t *data)
+{
+	const uint8_t *value;
+	uint64_t i, end, run;
+	size_t unitsize, done, size, n;
+	uint8_t *p;
+	int ret;
+
+	if (!rle || !data)
+		return SR_ERR_ARG;
+	if ((ret = logic_rle_check(rle)) != SR_OK)
+		return ret;
+
+	unitsize = rle->unitsize;
+	for (i = 0; i < rle->num_changes; i++) {
+		end = (i + 1 < rle->num_changes) ?
+			rle->offsets[i + 1] : rle->num_samples;
+		run = end - rle->offsets[i];
+		value = (const uint8_t *)rle->values + i * unitsize;
+		p = data + rle->offsets[i] * unitsize;
+		if (unitsize == 1) {
+			memset(p, *value, run);
+			continue;
+		}
+		/* Replicate the value, doubling the copied block each time. */
+		size = run * unitsize;
+		memcpy(p, value, unitsize);
+		for (done = unitsize; done < size; done += n) {
+			n = MIN(done, size - done);
+			memcpy(p + done, p, n);
+		}
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Iterate the value changes of logic data.
+ *
+ * Works for both SR_DF_LOGIC and SR_DF_LOGIC_RLE packets, so that
+ * consumers which are only interested in value changes need not scan
+ * samples themselves.
+ *
+ * @param[in] packet The logic packet.
+ * @param[in,out] last The unitsize bytes of the previous sample, which
+ *                     get updated to the packet's last sample.
+ * @param[in] initial Report the packet's first sample as a change, even
+ *                    if it matches the previous sample.
+ * @param[in] cb The routine to invoke for every change, with the sample
+ *               offset in the packet and the new value. A return value
+ *               other than SR_OK stops the iteration.
+ * @param[in] cb_data Opaque pointer passed to the callback.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @return The callback's return value, if it stopped the iteration.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_changes_foreach(const struct sr_datafeed_packet *packet,
+		uint8_t *last, gboolean initial, sr_logic_change_callback cb,
+		void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
+	const uint8_t *sample;
+	uint64_t i, count;
+	size_t unitsize;
+	int ret;
+
+	if (!packet || !packet->payload || !last || !cb)
+		return SR_ERR_ARG;
+
+	if (packet->type == SR_DF_LOGIC_RLE) {
+		rle = packet->payload;
+		if ((ret = logic_rle_check(rle)) != SR_OK)
+			return ret;
+		if (!rle->num_samples)
+			return SR_OK;
+		unitsize = rle->unitsize;
+		for (i = 0; i < rle->num_changes; i++) {
+			sample = (const uint8_t *)rle->values + i * unitsize;
+			if (!(i == 0 && initial) && !memcmp(last, sample, unitsize))
+				continue;
+			memcpy(last, sample, unitsize);
+			if ((ret = cb(rle->offsets[i], sample, cb_data)) != SR_OK)
+				return ret;
+		}
+		return SR_OK;
+	}
+
+	if (packet->type != SR_DF_LOGIC)
+		return SR_ERR_ARG;
+	logic = packet->payload;
+	unitsize = logic->unitsize;
+	if (!unitsize)
+		return SR_ERR_ARG;
+	count = logic->length / unitsize;
+	if (!count)
+		return SR_OK;
+	sample = logic->data;
+	if (initial || memcmp(last, sample, unitsize)) {
+		memcpy(last, sample, unitsize);
+		if ((ret = cb(0, sample, cb_data)) != SR_OK)
+			return ret;
+	}
+	/* Runs of identical samples are skipped, last keeps matching. */
+	i = 0;
+	while ((i = sr_logic_next_change(logic->data, unitsize, i, count,
+			NULL)) < count) {
+		sample = (const uint8_t *)logic->data + i * unitsize;
+		memcpy(last, sample, unitsize);
+		if ((ret = cb(i, sample, cb_data)) != SR_OK)
+			return ret;
+	}
 
 	return SR_OK;
 }
@@ -71,6 +71,7 @@ SR_PRIV struct sr_channel *sr_channel_new(struct sr_dev_inst *sdi,
 		ch->name = g_strdup(name);
 
 	sdi->channels = g_slist_append(sdi->channels, ch);
+	sr_dev_channels_changed(sdi);
 
 	return ch;
 }
@@ -153,6 +154,12 @@ SR_API int sr_dev_channel_enable(struct sr_channel *channel, gboolean state)
 	sdi = channel->sdi;
 	was_enabled = channel->enabled;
 	channel->enabled = state;
+	/* Samplerates and such can depend on the enabled channels. */
+	if (!state != !was_enabled) {
+		sr_config_cache_invalidate(sdi);
+		sdi->config_committed = FALSE;
+		sr_dev_channels_changed(sdi);
+	}
 	if (!state != !was_enabled && sdi->driver
 			&& sdi->driver->config_channel_set) {
 		ret = sdi->driver->config_channel_set(
@@ -194,6 +201,201 @@ SR_PRIV struct sr_channel *sr_next_enabled_channel(const struct sr_dev_inst *sdi
 	return next_channel;
 }
 
+/*
+ * Index over the channels list of a device instance. It is built on
+ * first use, and rebuilt when the list was replaced or a channel was
+ * added, enabled or disabled.
+ */
+struct sr_channel_index {
+	/** The sdi->channels list the index was built from. */
+	GSList *list;
+	/** Channels by position in the list. */
+	GPtrArray *channels;
+	/** Channel counts, all and enabled, by type (0: any type). */
+	unsigned int count[3], enabled_count[3];
+	/** Bit n set: the channel of that type with index n is enabled. */
+	uint64_t *enabled[3];
+	size_t enabled_words[3];
+};
+
+static unsigned int channel_type_slot(int type)
+{
+	switch (type) {
+	case SR_CHANNEL_LOGIC:
+		return 1;
+	case SR_CHANNEL_ANALOG:
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+static void channel_index_free(struct sr_channel_index *idx)
+{
+	unsigned int i;
+
+	if (!idx)
+		return;
+	g_ptr_array_free(idx->channels, TRUE);
+	for (i = 0; i < G_N_ELEMENTS(idx->enabled); i++)
+		g_free(idx->enabled[i]);
+	g_free(idx);
+}
+
+static const struct sr_channel_index *channel_index_get(
+		const struct sr_dev_inst *sdi)
+{
+	struct sr_dev_inst *inst;
+	struct sr_channel_index *idx;
+	struct sr_channel *ch;
+	unsigned int slots[2], i, j;
+	int max_index[3];
+	GSList *l;
+
+	if (sdi->channel_index && sdi->channel_index->list == sdi->channels)
+		return sdi->channel_index;
+
+	/* The index is no part of the device's visible state. */
+	inst = (struct sr_dev_inst *)sdi;
+	channel_index_free(inst->channel_index);
+
+	idx = g_malloc0(sizeof(*idx));
+	idx->list = sdi->channels;
+	idx->channels = g_ptr_array_sized_new(g_slist_length(sdi->channels));
+	for (i = 0; i < G_N_ELEMENTS(max_index); i++)
+		max_index[i] = -1;
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		g_ptr_array_add(idx->channels, ch);
+		slots[0] = 0;
+		slots[1] = channel_type_slot(ch->type);
+		for (j = 0; j < (slots[1] ? 2 : 1); j++)
+			max_index[slots[j]] = MAX(max_index[slots[j]], ch->index);
+	}
+	for (i = 0; i < G_N_ELEMENTS(idx->enabled); i++) {
+		idx->enabled_words[i] = (max_index[i] + 64) / 64;
+		idx->enabled[i] = g_malloc0(MAX(idx->enabled_words[i], 1) *
+			sizeof(uint64_t));
+	}
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		slots[0] = 0;
+		slots[1] = channel_type_slot(ch->type);
+		for (j = 0; j < (slots[1] ? 2 : 1); j++) {
+			idx->count[slots[j]]++;
+			if (!ch->enabled)
+				continue;
+			idx->enabled_count[slots[j]]++;
+			if (ch->index >= 0)
+				idx->enabled[slots[j]][ch->index / 64] |=
+					UINT64_C(1) << (ch->index % 64);
+		}
+	}
+
+	inst->channel_index = idx;
+
+	return idx;
+}
+
+/**
+ * Drop the channel index of a device instance.
+ *
+ * Channel creation and sr_dev_channel_enable() do this. Code which
+ * changes the enabled state of channels directly (drivers following
+ * the instrument's front panel) must call it afterwards.
+ *
+ * @param[in] sdi The device instance. Can be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_dev_channels_changed(const struct sr_dev_inst *sdi)
+{
+	struct sr_dev_inst *inst;
+
+	if (!sdi || !sdi->channel_index)
+		return;
+
+	inst = (struct sr_dev_inst *)sdi;
+	channel_index_free(inst->channel_index);
+	inst->channel_index = NULL;
+}
+
+/**
+ * Get a device instance's channel by position, in constant time.
+ *
+ * @param[in] sdi The device instance. Must not be NULL.
+ * @param[in] pos The position of the channel in sdi->channels.
+ *
+ * @return The channel, or NULL if there are not that many channels.
+ *
+ * @private
+ */
+SR_PRIV struct sr_channel *sr_dev_channel_nth(const struct sr_dev_inst *sdi,
+		unsigned int pos)
+{
+	const struct sr_channel_index *idx;
+
+	idx = channel_index_get(sdi);
+	if (pos >= idx->channels->len)
+		return NULL;
+
+	return g_ptr_array_index(idx->channels, pos);
+}
+
+/**
+ * Get the number of channels of a device instance.
+ *
+ * @param[in] sdi The device instance. Must not be NULL.
+ * @param[in] type SR_CHANNEL_LOGIC, SR_CHANNEL_ANALOG, or 0 for all.
+ * @param[in] enabled_only Only count enabled channels.
+ *
+ * @return The number of channels.
+ *
+ * @private
+ */
+SR_PRIV unsigned int sr_dev_channel_count(const struct sr_dev_inst *sdi,
+		int type, gboolean enabled_only)
+{
+	const struct sr_channel_index *idx;
+	unsigned int slot;
+
+	idx = channel_index_get(sdi);
+	slot = channel_type_slot(type);
+	if (type && !slot)
+		return 0;
+
+	return enabled_only ? idx->enabled_count[slot] : idx->count[slot];
+}
+
+/**
+ * Get a bitmap of the enabled channels of a device instance.
+ *
+ * Bit n of the bitmap (bit n % 64 of word n / 64) is set when the channel
+ * of the given type with index n is enabled. For logic channels that is
+ * the mask of the enabled bits in SR_DF_LOGIC samples.
+ *
+ * @param[in] sdi The device instance. Must not be NULL.
+ * @param[in] type SR_CHANNEL_LOGIC, SR_CHANNEL_ANALOG, or 0 for all.
+ * @param[out] num_words The number of 64-bit words in the bitmap.
+ *
+ * @return The bitmap, valid until the channels change.
+ *
+ * @private
+ */
+SR_PRIV const uint64_t *sr_dev_enabled_channels(const struct sr_dev_inst *sdi,
+		int type, size_t *num_words)
+{
+	const struct sr_channel_index *idx;
+	unsigned int slot;
+
+	idx = channel_index_get(sdi);
+	slot = channel_type_slot(type);
+	if (num_words)
+		*num_words = idx->enabled_words[slot];
+
+	return idx->enabled[slot];
+}
+
 /**
  * Compare two channels, return whether they differ.
  *
@@ -458,7 +660,7 @@ SR_API int sr_dev_config_capabilities_list(const struct sr_dev_inst *sdi,
  * @param version Device version.
  *
  * @retval struct sr_dev_inst *. Dynamically allocated, free using
- *         sr_dev_inst_free().
+ *         sr_dev_inst_user_free().
  */
 SR_API struct sr_dev_inst *sr_dev_inst_user_new(const char *vendor,
 		const char *model, const char *version)
@@ -475,6 +677,26 @@ SR_API struct sr_dev_inst *sr_dev_inst_user_new(const char *vendor,
 	return sdi;
 }
 
+/**
+ * Free a user-generated device instance, and its channels.
+ *
+ * @param[in] sdi Device instance from sr_dev_inst_user_new().
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_dev_inst_user_free(struct sr_dev_inst *sdi)
+{
+	if (!sdi || sdi->inst_type != SR_INST_USER)
+		return SR_ERR_ARG;
+
+	sr_dev_inst_free(sdi);
+
+	return SR_OK;
+}
+
 /**
  * Add a new channel to the specified device instance.
  *
@@ -522,6 +744,9 @@ SR_PRIV void sr_dev_inst_free(struct sr_dev_inst *sdi)
 	if (sdi->session)
 		sr_session_dev_remove(sdi->session, sdi);
 
+	if (sdi->config_cache)
+		g_hash_table_destroy(sdi->config_cache);
+	channel_index_free(sdi->channel_index);
 	g_free(sdi->vendor);
 	g_free(sdi->model);
 	g_free(sdi->version);
@@ -667,6 +892,7 @@ SR_PRIV void sr_usbtmc_dev_inst_free(struct sr_usbtmc_dev_inst *usbtmc)
  */
 SR_API GSList *sr_dev_list(const struct sr_dev_driver *driver)
 {
+	sr_driver_scan_wait(driver);
 	if (driver && driver->dev_list)
 		return driver->dev_list(driver);
 	else
@@ -703,6 +929,7 @@ SR_API int sr_dev_clear(const struct sr_dev_driver *driver)
 
 	/* No log message here, too verbose and not very useful. */
 
+	sr_driver_scan_wait(driver);
 	return driver->dev_clear(driver);
 }
 
@@ -739,6 +966,10 @@ SR_API int sr_dev_open(struct sr_dev_inst *sdi)
 	sr_dbg("%s: Opening device instance.", sdi->driver->name);
 
 	ret = sdi->driver->dev_open(sdi);
+	sr_config_cache_invalidate(sdi);
+	sdi->config_committed = FALSE;
+	/* Drivers may have taken the enabled channels from the device. */
+	sr_dev_channels_changed(sdi);
 
 	if (ret == SR_OK)
 		sdi->status = SR_ST_ACTIVE;
@@ -777,6 +1008,8 @@ SR_API int sr_dev_close(struct sr_dev_inst *sdi)
 	}
 
 	sdi->status = SR_ST_INACTIVE;
+	sr_config_cache_invalidate(sdi);
+	sdi->config_committed = FALSE;
 
 	sr_dbg("%s: Closing device instance.", sdi->driver->name);
 
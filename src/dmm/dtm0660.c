@@ -39,33 +39,18 @@
 
 #define LOG_PREFIX "dtm0660"
 
+/* Segments a to g of a digit. */
+static const uint8_t digit_table[256] = SEG7_DIGIT_TABLE(0x80, 0x08, 0x02, 0x01, 0x20, 0x40, 0x04);
+
 static int parse_digit(uint8_t b)
 {
-	switch (b) {
-	case 0xeb:
-		return 0;
-	case 0x0a:
-		return 1;
-	case 0xad:
-		return 2;
-	case 0x8f:
-		return 3;
-	case 0x4e:
-		return 4;
-	case 0xc7:
-		return 5;
-	case 0xe7:
-		return 6;
-	case 0x8a:
-		return 7;
-	case 0xef:
-		return 8;
-	case 0xcf:
-		return 9;
-	default:
+	int digit;
+
+	digit = seg7_digit(digit_table, b);
+	if (digit < 0)
 		sr_dbg("Invalid digit byte: 0x%02x.", b);
-		return -1;
-	}
+
+	return digit;
 }
 
 static gboolean sync_nibbles_valid(const uint8_t *buf)
@@ -40,33 +40,18 @@
 
 #define LOG_PREFIX "fs9721"
 
+/* Segments a to g of a digit. */
+static const uint8_t digit_table[256] = SEG7_DIGIT_TABLE(0x10, 0x01, 0x04, 0x08, 0x40, 0x20, 0x02);
+
 static int parse_digit(uint8_t b)
 {
-	switch (b) {
-	case 0x7d:
-		return 0;
-	case 0x05:
-		return 1;
-	case 0x5b:
-		return 2;
-	case 0x1f:
-		return 3;
-	case 0x27:
-		return 4;
-	case 0x3e:
-		return 5;
-	case 0x7e:
-		return 6;
-	case 0x15:
-		return 7;
-	case 0x7f:
-		return 8;
-	case 0x3f:
-		return 9;
-	default:
+	int digit;
+
+	digit = seg7_digit(digit_table, b);
+	if (digit < 0)
 		sr_dbg("Invalid digit byte: 0x%02x.", b);
-		return -1;
-	}
+
+	return digit;
 }
 
 static gboolean sync_nibbles_valid(const uint8_t *buf)
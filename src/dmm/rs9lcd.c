@@ -70,17 +70,9 @@
 /* Mask to remove the decimal point from a digit */
 #define DP_MASK		(1 << 3)
 
-/* What the LCD values represent */
-#define LCD_0		0xd7
-#define LCD_1		0x50
-#define LCD_2		0xb5
-#define LCD_3		0xf1
-#define LCD_4		0x72
-#define LCD_5		0xe3
-#define LCD_6		0xe7
-#define LCD_7		0x51
-#define LCD_8		0xf7
-#define LCD_9		0xf3
+/* What the LCD values represent, digits are from the segments a to g */
+static const uint8_t digit_table[256] =
+	SEG7_DIGIT_TABLE(0x01, 0x10, 0x40, 0x80, 0x04, 0x02, 0x20);
 
 #define LCD_C		0x87
 #define LCD_E
@@ -223,35 +215,22 @@ SR_PRIV gboolean sr_rs9lcd_packet_valid(const uint8_t *buf)
 
 static uint8_t decode_digit(uint8_t raw_digit)
 {
-	/* Take out the decimal point, so we can use a simple switch(). */
+	int digit;
+
+	/* Take out the decimal point, so we can use a lookup table. */
 	raw_digit &= ~DP_MASK;
 
-	switch (raw_digit) {
-	case 0x00:
-	case LCD_0:
+	/* A blank digit reads as zero. */
+	if (!raw_digit)
 		return 0;
-	case LCD_1:
-		return 1;
-	case LCD_2:
-		return 2;
-	case LCD_3:
-		return 3;
-	case LCD_4:
-		return 4;
-	case LCD_5:
-		return 5;
-	case LCD_6:
-		return 6;
-	case LCD_7:
-		return 7;
-	case LCD_8:
-		return 8;
-	case LCD_9:
-		return 9;
-	default:
+
+	digit = seg7_digit(digit_table, raw_digit);
+	if (digit < 0) {
 		sr_dbg("Invalid digit byte: 0x%02x.", raw_digit);
 		return 0xff;
 	}
+
+	return digit;
 }
 
 static double lcd_to_double(const struct rs9lcd_packet *rs_packet, int type,
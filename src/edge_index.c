@@ -0,0 +1,387 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Transition indexes of logic data, which let edge searches in session
+ * files skip the blocks of samples where a channel does not change.
+ *
+ * An entry covers a block of 2^shift samples, the last one may cover
+ * fewer. It holds a bitmap of the channels which have an edge within the
+ * block (unitsize bytes), followed by the offsets of the first and of the
+ * last edge of each channel within the block as 16-bit little endian
+ * values, 0xffff for none. An edge is at the sample which differs from
+ * the one before it.
+ *
+ * The srzip output keeps the entries in archive members "edges-logic-1-N"
+ * in order, and the parameters in the "edges" member. For other session
+ * files the index gets built on the first search, and is kept in a
+ * "<sessionfile>.edges" file next to it: a header of the magic, the size
+ * and modification time of the session file as 64-bit, and the unitsize
+ * and shift as 32-bit little endian values, followed by the entries.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "edge-index"
+/** @endcond */
+
+#define EDGES_VERSION 1
+
+/* Bytes of entries an archive member holds. */
+#define EDGES_CHUNK_SIZE (4 * 1024 * 1024)
+
+#define SIDECAR_MAGIC "sredges1"
+#define SIDECAR_HEADER_SIZE 32
+
+#define NO_EDGE 0xffff
+
+struct sr_edge_index {
+	size_t unitsize;
+	/* Samples fed so far. */
+	uint64_t samples;
+	gboolean have_prev;
+	uint8_t *prev;
+	/* The block of the entry being collected. */
+	uint64_t block;
+	uint8_t *entry;
+	/* Completed entries, not yet written. */
+	GByteArray *entries;
+	unsigned int chunk_num;
+};
+
+/** @private */
+SR_PRIV size_t sr_edge_index_entry_size(size_t unitsize)
+{
+	return unitsize + 2 * 8 * unitsize * sizeof(uint16_t);
+}
+
+static void entry_reset(struct sr_edge_index *ei)
+{
+	memset(ei->entry, 0, ei->unitsize);
+	memset(ei->entry + ei->unitsize, 0xff,
+		sr_edge_index_entry_size(ei->unitsize) - ei->unitsize);
+}
+
+/**
+ * Start collecting the transition index of logic data.
+ *
+ * @private
+ */
+SR_PRIV struct sr_edge_index *sr_edge_index_new(size_t unitsize)
+{
+	struct sr_edge_index *ei;
+
+	ei = g_malloc0(sizeof(*ei));
+	ei->unitsize = unitsize;
+	ei->prev = g_malloc0(unitsize);
+	ei->entry = g_malloc(sr_edge_index_entry_size(unitsize));
+	entry_reset(ei);
+	ei->entries = g_byte_array_new();
+
+	return ei;
+}
+
+/** @private */
+SR_PRIV void sr_edge_index_free(struct sr_edge_index *ei)
+{
+	if (!ei)
+		return;
+	g_free(ei->prev);
+	g_free(ei->entry);
+	g_byte_array_free(ei->entries, TRUE);
+	g_free(ei);
+}
+
+static void entry_end(struct sr_edge_index *ei)
+{
+	g_byte_array_append(ei->entries, ei->entry,
+		sr_edge_index_entry_size(ei->unitsize));
+	entry_reset(ei);
+	ei->block++;
+}
+
+/* Note the edges of the sample at a position against the previous one. */
+static void edge_add(struct sr_edge_index *ei, uint64_t pos,
+		const uint8_t *sample)
+{
+	uint8_t *first, *last;
+	unsigned int ch;
+	uint16_t offset;
+	size_t i;
+	uint8_t x;
+
+	while ((pos >> SR_EDGE_INDEX_SHIFT) > ei->block)
+		entry_end(ei);
+
+	offset = pos & ((UINT64_C(1) << SR_EDGE_INDEX_SHIFT) - 1);
+	first = ei->entry + ei->unitsize;
+	last = first + 8 * ei->unitsize * sizeof(uint16_t);
+	for (i = 0; i < ei->unitsize; i++) {
+		x = sample[i] ^ ei->prev[i];
+		ei->entry[i] |= x;
+		while (x) {
+			ch = 8 * i + __builtin_ctz(x);
+			if (read_u16le(first + 2 * ch) == NO_EDGE)
+				write_u16le(first + 2 * ch, offset);
+			write_u16le(last + 2 * ch, offset);
+			x &= x - 1;
+		}
+	}
+}
+
+/**
+ * Add logic samples to the transition index.
+ *
+ * @private
+ */
+SR_PRIV void sr_edge_index_feed(struct sr_edge_index *ei,
+		const uint8_t *data, uint64_t count)
+{
+	const uint8_t *sample;
+	uint64_t i, next;
+
+	/* Only the samples where the data changes need to be looked at. */
+	for (i = 0; i < count; i = next) {
+		sample = data + i * ei->unitsize;
+		if (ei->have_prev && memcmp(sample, ei->prev, ei->unitsize))
+			edge_add(ei, ei->samples + i, sample);
+		memcpy(ei->prev, sample, ei->unitsize);
+		ei->have_prev = TRUE;
+		next = sr_logic_next_change(data, ei->unitsize, i, count, NULL);
+	}
+	ei->samples += count;
+
+	while (((ei->block + 1) << SR_EDGE_INDEX_SHIFT) <= ei->samples)
+		entry_end(ei);
+}
+
+/**
+ * Complete the transition index, and take its entries.
+ *
+ * @private
+ */
+SR_PRIV GBytes *sr_edge_index_finish(struct sr_edge_index *ei)
+{
+	GByteArray *entries;
+
+	if (ei->samples > (ei->block << SR_EDGE_INDEX_SHIFT))
+		entry_end(ei);
+	entries = ei->entries;
+	ei->entries = g_byte_array_new();
+
+	return g_byte_array_free_to_bytes(entries);
+}
+
+/* Write the completed entries as the next archive member. */
+static int chunk_write(struct sr_edge_index *ei, struct sr_zip_writer *zw)
+{
+	char *name;
+	int ret;
+
+	if (!ei->entries->len)
+		return SR_OK;
+	name = g_strdup_printf("edges-logic-1-%u", ++ei->chunk_num);
+	ret = sr_zip_writer_add(zw, name, ei->entries->data, ei->entries->len);
+	g_free(name);
+	g_byte_array_set_size(ei->entries, 0);
+
+	return ret;
+}
+
+/**
+ * Add the completed entries of the transition index to a session file,
+ * once they fill an archive member. With finish set, complete the index.
+ *
+ * @private
+ */
+SR_PRIV int sr_edge_index_write(struct sr_edge_index *ei,
+		struct sr_zip_writer *zw, gboolean finish)
+{
+	GKeyFile *kf;
+	char *data;
+	gsize len;
+	int ret;
+
+	if (!finish) {
+		if (ei->entries->len < EDGES_CHUNK_SIZE)
+			return SR_OK;
+		return chunk_write(ei, zw);
+	}
+
+	if (ei->samples > (ei->block << SR_EDGE_INDEX_SHIFT))
+		entry_end(ei);
+	if ((ret = chunk_write(ei, zw)) != SR_OK)
+		return ret;
+
+	kf = g_key_file_new();
+	g_key_file_set_integer(kf, "edges", "version", EDGES_VERSION);
+	g_key_file_set_integer(kf, "edges", "shift", SR_EDGE_INDEX_SHIFT);
+	data = g_key_file_to_data(kf, &len, NULL);
+	g_key_file_free(kf);
+	ret = sr_zip_writer_add(zw, "edges", data, len);
+	g_free(data);
+
+	return ret;
+}
+
+/**
+ * Get the samples per entry of the transition index in a session file,
+ * as a power of two, from its "edges" member. Returns 0 if the
+ * parameters are not supported.
+ *
+ * @private
+ */
+SR_PRIV unsigned int sr_edge_index_shift(GKeyFile *kf)
+{
+	int shift;
+
+	if (g_key_file_get_integer(kf, "edges", "version", NULL) != EDGES_VERSION)
+		return 0;
+	shift = g_key_file_get_integer(kf, "edges", "shift", NULL);
+	if (shift <= 0 || shift > 15)
+		return 0;
+
+	return shift;
+}
+
+static void sidecar_header(uint8_t *header, uint64_t file_size,
+		int64_t mtime, size_t unitsize)
+{
+	memcpy(header, SIDECAR_MAGIC, 8);
+	write_u64le(header + 8, file_size);
+	write_u64le(header + 16, mtime);
+	write_u32le(header + 24, unitsize);
+	write_u32le(header + 28, SR_EDGE_INDEX_SHIFT);
+}
+
+/**
+ * Load a transition index kept next to a session file, if it is of the
+ * file as it is now, and has the expected number of entries.
+ *
+ * @private
+ */
+SR_PRIV GBytes *sr_edge_index_load(const char *path, uint64_t file_size,
+		int64_t mtime, size_t unitsize, uint64_t num_entries)
+{
+	GMappedFile *mapped;
+	uint8_t header[SIDECAR_HEADER_SIZE];
+	const char *data;
+	gsize len;
+
+	if (!(mapped = g_mapped_file_new(path, FALSE, NULL)))
+		return NULL;
+	data = g_mapped_file_get_contents(mapped);
+	len = g_mapped_file_get_length(mapped);
+	sidecar_header(header, file_size, mtime, unitsize);
+	if (len < SIDECAR_HEADER_SIZE || memcmp(data, header, sizeof(header))
+			|| (len - SIDECAR_HEADER_SIZE)
+			!= num_entries * sr_edge_index_entry_size(unitsize)) {
+		sr_dbg("Ignoring outdated %s.", path);
+		g_mapped_file_unref(mapped);
+		return NULL;
+	}
+
+	return g_bytes_new_with_free_func(data + SIDECAR_HEADER_SIZE,
+		len - SIDECAR_HEADER_SIZE,
+		(GDestroyNotify)g_mapped_file_unref, mapped);
+}
+
+/**
+ * Keep a transition index next to a session file. Failing to is fine,
+ * e.g. in read-only directories.
+ *
+ * @private
+ */
+SR_PRIV void sr_edge_index_save(const char *path, uint64_t file_size,
+		int64_t mtime, size_t unitsize, GBytes *entries)
+{
+	uint8_t header[SIDECAR_HEADER_SIZE];
+	const void *data;
+	char *tmp;
+	gsize len;
+	FILE *f;
+	gboolean ok;
+
+	/* Write to a temporary file, so readers never see a partial one. */
+	tmp = g_strconcat(path, ".tmp", NULL);
+	if (!(f = g_fopen(tmp, "wb"))) {
+		sr_dbg("Cannot write %s: %s.", tmp, g_strerror(errno));
+		g_free(tmp);
+		return;
+	}
+	sidecar_header(header, file_size, mtime, unitsize);
+	data = g_bytes_get_data(entries, &len);
+	ok = fwrite(header, sizeof(header), 1, f) == 1
+		&& (!len || fwrite(data, len, 1, f) == 1);
+	ok = !fclose(f) && ok;
+	if (!ok || g_rename(tmp, path) < 0) {
+		sr_dbg("Cannot write %s.", path);
+		g_unlink(tmp);
+	}
+	g_free(tmp);
+}
+
+/**
+ * Find the first entry from a block on, in which a channel has edges.
+ *
+ * @param entries The entries of the index.
+ * @param num_entries The number of entries.
+ * @param unitsize The size of a logic sample.
+ * @param index The index of the channel.
+ * @param block The block to start at, receives the block found.
+ * @param first Receives the offset of the channel's first edge within
+ *              that block.
+ * @param last Receives the offset of its last edge.
+ *
+ * @return TRUE if an entry was found.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_edge_index_find(const uint8_t *entries,
+		uint64_t num_entries, size_t unitsize, unsigned int index,
+		uint64_t *block, unsigned int *first, unsigned int *last)
+{
+	const uint8_t *entry;
+	size_t entry_size, byte;
+	uint64_t i;
+	uint8_t bit;
+
+	entry_size = sr_edge_index_entry_size(unitsize);
+	byte = index / 8;
+	bit = 1 << (index % 8);
+	for (i = *block; i < num_entries; i++) {
+		entry = entries + i * entry_size;
+		if (!(entry[byte] & bit))
+			continue;
+		*block = i;
+		*first = read_u16le(entry + unitsize + 2 * index);
+		*last = read_u16le(entry + unitsize
+			+ 8 * unitsize * sizeof(uint16_t) + 2 * index);
+		return TRUE;
+	}
+
+	return FALSE;
+}
@@ -33,7 +33,19 @@
 
 #define LOG_PREFIX "ezusb"
 
+/*
+ * Firmware gets sent in chunks of up to FW_MAX_CHUNKSIZE. Platforms
+ * which limit the size of control transfers (older Linux usbfs allows
+ * a page) reject those, the upload then continues in FW_CHUNKSIZE.
+ */
 #define FW_CHUNKSIZE (4 * 1024)
+#define FW_MAX_CHUNKSIZE (16 * 1024)
+/* Timeout for each FW_CHUNKSIZE worth of data. */
+#define FW_CHUNK_TIMEOUT_MS 100
+
+/* The FX2 takes >= 300ms to be gone from the USB bus after the upload. */
+#define RENUM_MIN_DELAY_MS 300
+#define RENUM_POLL_MS 100
 
 SR_PRIV int ezusb_reset(struct libusb_device_handle *hdl, int set_clear)
 {
@@ -56,43 +68,54 @@ SR_PRIV int ezusb_install_firmware(struct sr_context *ctx,
 				   libusb_device_handle *hdl,
 				   const char *name)
 {
-	unsigned char *firmware;
-	size_t length, offset, chunksize;
-	int ret, result;
+	GBytes *bytes;
+	const unsigned char *firmware;
+	size_t length, offset, chunksize, maxchunk;
+	unsigned int timeout;
+	int ret;
 
 	/* Max size is 64 kiB since the value field of the setup packet,
 	 * which holds the firmware offset, is only 16 bit wide.
 	 */
-	firmware = sr_resource_load(ctx, SR_RESOURCE_FIRMWARE,
-			name, &length, 1 << 16);
-	if (!firmware)
+	bytes = sr_resource_get(ctx, SR_RESOURCE_FIRMWARE, name, 1 << 16);
+	if (!bytes)
 		return SR_ERR;
+	firmware = g_bytes_get_data(bytes, &length);
 
 	sr_info("Uploading firmware '%s'.", name);
 
-	result = SR_OK;
 	offset = 0;
+	maxchunk = FW_MAX_CHUNKSIZE;
 	while (offset < length) {
-		chunksize = MIN(length - offset, FW_CHUNKSIZE);
+		chunksize = MIN(length - offset, maxchunk);
+		timeout = FW_CHUNK_TIMEOUT_MS
+			* ((chunksize + FW_CHUNKSIZE - 1) / FW_CHUNKSIZE);
 
 		ret = libusb_control_transfer(hdl, LIBUSB_REQUEST_TYPE_VENDOR |
 					      LIBUSB_ENDPOINT_OUT, 0xa0, offset,
-					      0x0000, firmware + offset,
-					      chunksize, 100);
+					      0x0000, (unsigned char *)firmware + offset,
+					      chunksize, timeout);
+		if (ret == LIBUSB_ERROR_INVALID_PARAM
+				&& chunksize > FW_CHUNKSIZE) {
+			sr_dbg("Large control transfers not supported, "
+				"using %d bytes.", FW_CHUNKSIZE);
+			maxchunk = FW_CHUNKSIZE;
+			continue;
+		}
 		if (ret < 0) {
 			sr_err("Unable to send firmware to device: %s.",
 					libusb_error_name(ret));
-			g_free(firmware);
+			g_bytes_unref(bytes);
 			return SR_ERR;
 		}
 		sr_info("Uploaded %zu bytes.", chunksize);
 		offset += chunksize;
 	}
-	g_free(firmware);
+	g_bytes_unref(bytes);
 
 	sr_info("Firmware upload done.");
 
-	return result;
+	return SR_OK;
 }
 
 SR_PRIV int ezusb_upload_firmware(struct sr_context *ctx, libusb_device *dev,
@@ -142,3 +165,107 @@ SR_PRIV int ezusb_upload_firmware(struct sr_context *ctx, libusb_device *dev,
 
 	return SR_OK;
 }
+
+static int LIBUSB_CALL renum_arrived(libusb_context *usb_ctx,
+		libusb_device *dev, libusb_hotplug_event event, void *user_data)
+{
+	(void)usb_ctx;
+	(void)dev;
+	(void)event;
+
+	*(int *)user_data = 1;
+
+	/* Stay registered, the caller deregisters. */
+	return 0;
+}
+
+/* Wait until the 'until' time, or until a device arrived. */
+static void renum_sleep(struct sr_context *ctx, gboolean hotplug,
+		int *arrived, int64_t until)
+{
+	struct timeval tv;
+	int64_t now;
+
+	if (!hotplug) {
+		now = g_get_monotonic_time();
+		if (until > now)
+			g_usleep(until - now);
+		return;
+	}
+
+	while (!*arrived && (now = g_get_monotonic_time()) < until) {
+		tv.tv_sec = (until - now) / G_USEC_PER_SEC;
+		tv.tv_usec = (until - now) % G_USEC_PER_SEC;
+		if (libusb_handle_events_timeout_completed(ctx->libusb_ctx,
+				&tv, arrived) < 0)
+			break;
+	}
+}
+
+/**
+ * Wait for a device to renumerate after its firmware upload, and open it.
+ *
+ * Open attempts start RENUM_MIN_DELAY_MS after the upload, and repeat
+ * until @a max_delay_ms after the upload. Where libusb supports hotplug
+ * events, the arrival of a USB device triggers the next attempt right
+ * away, otherwise attempts are RENUM_POLL_MS apart.
+ *
+ * @param sdi The device instance. Must not be NULL.
+ * @param fw_updated The monotonic time of the upload, in microseconds.
+ * @param max_delay_ms The time to give up after, since the upload.
+ * @param open_cb The driver's open routine.
+ *
+ * @return The result of the last open attempt.
+ */
+SR_PRIV int ezusb_wait_renumeration(struct sr_dev_inst *sdi,
+		int64_t fw_updated, int max_delay_ms,
+		int (*open_cb)(struct sr_dev_inst *sdi))
+{
+	struct drv_context *drvc;
+	struct sr_context *ctx;
+	libusb_hotplug_callback_handle handle;
+	gboolean hotplug;
+	int64_t first, deadline, now;
+	int arrived, ret;
+
+	drvc = sdi->driver->context;
+	ctx = drvc->sr_ctx;
+
+	sr_info("Waiting for device to reset.");
+
+	arrived = 0;
+	hotplug = libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)
+		&& libusb_hotplug_register_callback(ctx->libusb_ctx,
+			LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED, 0,
+			LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+			LIBUSB_HOTPLUG_MATCH_ANY, renum_arrived, &arrived,
+			&handle) == LIBUSB_SUCCESS;
+
+	first = fw_updated + RENUM_MIN_DELAY_MS * (int64_t)1000;
+	deadline = fw_updated + max_delay_ms * (int64_t)1000;
+	ret = SR_ERR;
+	for (;;) {
+		now = g_get_monotonic_time();
+		if (arrived || now >= first) {
+			arrived = 0;
+			if ((ret = open_cb(sdi)) == SR_OK)
+				break;
+		}
+		if (now >= deadline)
+			break;
+		sr_spew("Waited %" PRIi64 "ms.", (now - fw_updated) / 1000);
+		renum_sleep(ctx, hotplug, &arrived, MIN(deadline,
+			MAX(first, now + RENUM_POLL_MS * (int64_t)1000)));
+	}
+
+	if (hotplug)
+		libusb_hotplug_deregister_callback(ctx->libusb_ctx, handle);
+
+	if (ret == SR_OK)
+		sr_info("Device came back after %" PRIi64 "ms.",
+			(g_get_monotonic_time() - fw_updated) / 1000);
+	else
+		sr_err("Device failed to renumerate.");
+
+	return ret;
+}
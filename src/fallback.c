@@ -36,4 +36,13 @@ SR_API void sr_serial_free(struct sr_serial_port *serial)
 	(void)serial;
 }
 
+SR_API void sr_serial_list_set_timeout(int timeout_ms)
+{
+	(void)timeout_ms;
+}
+
+SR_API void sr_serial_list_cache_clear(void)
+{
+}
+
 #endif
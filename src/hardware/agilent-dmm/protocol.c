@@ -446,6 +446,7 @@ static int recv_fetc(const struct sr_dev_inst *sdi, GMatchInfo *match)
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
+	GSList ch_node;
 	struct sr_analog_spec spec;
 	struct sr_channel *prev_chan;
 	float fvalue;
@@ -496,14 +497,13 @@ static int recv_fetc(const struct sr_dev_inst *sdi, GMatchInfo *match)
 	analog.meaning->mq = devc->cur_mq[i];
 	analog.meaning->unit = devc->cur_unit[i];
 	analog.meaning->mqflags = devc->cur_mqflags[i];
-	analog.meaning->channels = g_slist_append(NULL, devc->cur_channel);
+	sr_analog_meaning_channel_set(analog.meaning, &ch_node, devc->cur_channel);
 	analog.num_samples = 1;
 	analog.data = &fvalue;
 	encoding.digits = devc->cur_encoding[i] - devc->cur_exponent[i];
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &analog;
 	sr_session_send(sdi, &packet);
-	g_slist_free(analog.meaning->channels);
 
 	sr_sw_limits_update_samples_read(&devc->limits, 1);
 
@@ -853,6 +853,7 @@ static int recv_log(const struct sr_dev_inst *sdi, GMatchInfo *match,
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
+	GSList ch_node;
 	struct sr_analog_spec spec;
 	char *mstr;
 	unsigned function;
@@ -919,13 +920,12 @@ static int recv_log(const struct sr_dev_inst *sdi, GMatchInfo *match,
 	analog.meaning->mq = mq;
 	analog.meaning->unit = unit;
 	analog.meaning->mqflags = mqflags;
-	analog.meaning->channels = g_slist_append(NULL, devc->cur_channel);
+	sr_analog_meaning_channel_set(analog.meaning, &ch_node, devc->cur_channel);
 	analog.num_samples = 1;
 	analog.data = &fvalue;
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &analog;
 	sr_session_send(sdi, &packet);
-	g_slist_free(analog.meaning->channels);
 
 	sr_sw_limits_update_samples_read(&devc->limits, 1);
 	devc->cur_sample++;
@@ -175,9 +175,9 @@ static int omega_rtm_cli_process_rawdata(const struct sr_dev_inst *sdi)
 	static const size_t chunk_size = 3 * sizeof(uint16_t);
 
 	struct dev_context *devc;
-	const uint8_t *rdptr;
+	const uint8_t *rdptr, *samples;
 	size_t avail, taken, count;
-	uint16_t stamp, sample1, sample2;
+	uint16_t stamp, sample2;
 	int ret;
 
 	devc = sdi->priv;
@@ -193,7 +193,8 @@ static int omega_rtm_cli_process_rawdata(const struct sr_dev_inst *sdi)
 	/* Process those chunks whose reception has completed. */
 	while (ret == SR_OK && avail >= chunk_size) {
 		stamp = read_u16le_inc(&rdptr);
-		sample1 = read_u16le_inc(&rdptr);
+		samples = rdptr;
+		(void)read_u16le_inc(&rdptr);
 		sample2 = read_u16le_inc(&rdptr);
 		avail -= chunk_size;
 		taken += chunk_size;
@@ -225,20 +226,16 @@ static int omega_rtm_cli_process_rawdata(const struct sr_dev_inst *sdi)
 			break;
 
 		/*
-		 * Also send the current samples. Keep the last value at
-		 * hand because future chunks might repeat it.
+		 * Also send the current samples. These are adjacent in
+		 * the chunk, and in the session feed's format already.
+		 * Keep the last value at hand because future chunks might
+		 * repeat it.
 		 */
-		write_u16le(devc->samples.last_sample, sample1);
-		ret = feed_queue_logic_submit(devc->samples.queue,
-			devc->samples.last_sample, 1);
+		ret = feed_queue_logic_submit_many(devc->samples.queue,
+			samples, 2);
 		if (ret != SR_OK)
 			break;
-
 		write_u16le(devc->samples.last_sample, sample2);
-		ret = feed_queue_logic_submit(devc->samples.queue,
-			devc->samples.last_sample, 1);
-		if (ret != SR_OK)
-			break;
 
 		count = 2;
 		sr_sw_limits_update_samples_read(&devc->limits, count);
@@ -155,7 +155,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 	/* Find all ASIX logic analyzers (which match the connection spec). */
 	devices = NULL;
-	libusb_get_device_list(usbctx, &devlist);
+	sr_usb_get_device_list(usbctx, &devlist);
 	for (devidx = 0; devlist[devidx]; devidx++) {
 		devitem = devlist[devidx];
 
@@ -261,7 +261,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		/* Get current hardware configuration (or use defaults). */
 		(void)sigma_fetch_hw_config(sdi);
 	}
-	libusb_free_device_list(devlist, 1);
+	sr_usb_free_device_list(devlist);
 	g_slist_free_full(conn_devices, (GDestroyNotify)sr_usb_dev_inst_free);
 
 	return std_scan_complete(di, devices);
@@ -643,6 +643,7 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 	if (devc->state == SIGMA_CAPTURE) {
 		devc->state = SIGMA_STOPPING;
 	} else {
+		sigma_abort_download(devc);
 		devc->state = SIGMA_IDLE;
 		(void)sr_session_source_remove(sdi->session, -1);
 	}
@@ -747,35 +747,20 @@ static int sigma_fpga_init_la(struct dev_context *devc)
 }
 
 /*
- * Read the firmware from a file and transform it into a series of bitbang
- * pulses used to program the FPGA. Note that the *bb_cmd must be free()'d
- * by the caller of this function.
+ * Transform the firmware file content into a series of bitbang pulses
+ * used to program the FPGA. The resource cache keeps the result, so
+ * that reopening devices need not repeat the conversion.
  */
-static int sigma_fw_2_bitbang(struct sr_context *ctx, const char *name,
-	uint8_t **bb_cmd, size_t *bb_cmd_size)
+static GBytes *sigma_fw_2_bitbang(GBytes *data, const char *name)
 {
-	uint8_t *firmware;
+	const uint8_t *firmware, *p;
 	size_t file_size;
-	uint8_t *p;
 	size_t l;
 	uint32_t imm;
 	size_t bb_size;
 	uint8_t *bb_stream, *bbs, byte, mask, v;
 
-	/* Retrieve the on-disk firmware file content. */
-	firmware = sr_resource_load(ctx, SR_RESOURCE_FIRMWARE, name,
-		&file_size, SIGMA_FIRMWARE_SIZE_LIMIT);
-	if (!firmware)
-		return SR_ERR_IO;
-
-	/* Unscramble the file content (XOR with "random" sequence). */
-	p = firmware;
-	l = file_size;
-	imm = 0x3f6df2ab;
-	while (l--) {
-		imm = (imm + 0xa853753) % 177 + (imm * 0x8034052);
-		*p++ ^= imm & 0xff;
-	}
+	firmware = g_bytes_get_data(data, &file_size);
 
 	/*
 	 * Generate a sequence of bitbang samples. With two samples per
@@ -789,21 +774,23 @@ static int sigma_fw_2_bitbang(struct sr_context *ctx, const char *name,
 	 * data gets sampled at the rising CCLK edge, and the signals'
 	 * setup time constraint will be met.
 	 *
-	 * The caller will put the FPGA into download mode, will send
-	 * the bitbang samples, and release the allocated memory.
+	 * The file content is unscrambled on the fly (XOR with "random"
+	 * sequence). The caller will put the FPGA into download mode,
+	 * and will send the bitbang samples.
 	 */
 	bb_size = file_size * 8 * 2;
 	bb_stream = g_try_malloc(bb_size);
 	if (!bb_stream) {
 		sr_err("Memory allocation failed during firmware upload.");
-		g_free(firmware);
-		return SR_ERR_MALLOC;
+		return NULL;
 	}
 	bbs = bb_stream;
 	p = firmware;
 	l = file_size;
+	imm = 0x3f6df2ab;
 	while (l--) {
-		byte = *p++;
+		imm = (imm + 0xa853753) % 177 + (imm * 0x8034052);
+		byte = *p++ ^ (imm & 0xff);
 		mask = 0x80;
 		while (mask) {
 			v = (byte & mask) ? BB_PIN_DIN : 0;
@@ -812,20 +799,18 @@ static int sigma_fw_2_bitbang(struct sr_context *ctx, const char *name,
 			*bbs++ = v;
 		}
 	}
-	g_free(firmware);
-
-	/* The transformation completed successfully, return the result. */
-	*bb_cmd = bb_stream;
-	*bb_cmd_size = bb_size;
+	sr_dbg("Converted firmware '%s' to %zu bitbang samples.",
+		name, bb_size);
 
-	return SR_OK;
+	return g_bytes_new_take(bb_stream, bb_size);
 }
 
 static int upload_firmware(struct sr_context *ctx, struct dev_context *devc,
 	enum sigma_firmware_idx firmware_idx)
 {
 	int ret;
-	uint8_t *buf;
+	GBytes *bitbang;
+	const uint8_t *buf;
 	uint8_t pins;
 	size_t buf_size;
 	const char *firmware;
@@ -867,16 +852,19 @@ static int upload_firmware(struct sr_context *ctx, struct dev_context *devc,
 	}
 
 	/* Prepare wire format of the firmware image. */
-	ret = sigma_fw_2_bitbang(ctx, firmware, &buf, &buf_size);
-	if (ret != SR_OK) {
+	bitbang = sr_resource_get_converted(ctx, SR_RESOURCE_FIRMWARE,
+		firmware, SIGMA_FIRMWARE_SIZE_LIMIT, "bitbang",
+		sigma_fw_2_bitbang);
+	if (!bitbang) {
 		sr_err("Could not prepare file %s for upload.", firmware);
-		return ret;
+		return SR_ERR_IO;
 	}
 
 	/* Write the FPGA netlist to the cable. */
 	sr_info("Uploading firmware file '%s'.", firmware);
+	buf = g_bytes_get_data(bitbang, &buf_size);
 	ret = sigma_write_sr(devc, buf, buf_size);
-	g_free(buf);
+	g_bytes_unref(bitbang);
 	if (ret != SR_OK) {
 		sr_err("Could not upload firmware file '%s'.", firmware);
 		return ret;
@@ -1146,46 +1134,22 @@ SR_PRIV int sigma_set_samplerate(const struct sr_dev_inst *sdi)
 
 #define CHUNK_SIZE	(4 * 1024 * 1024)
 
-struct submit_buffer {
-	size_t unit_size;
-	size_t max_samples, curr_samples;
-	uint8_t *sample_data;
-	uint8_t *write_pointer;
-	struct sr_dev_inst *sdi;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
-};
-
 static int alloc_submit_buffer(struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
-	struct submit_buffer *buffer;
-	size_t size;
+	size_t unit_size;
 
 	devc = sdi->priv;
 
-	buffer = g_malloc0(sizeof(*buffer));
-	devc->buffer = buffer;
-
-	buffer->unit_size = sizeof(uint16_t);
-	size = CHUNK_SIZE;
-	size /= buffer->unit_size;
-	buffer->max_samples = size;
-	size *= buffer->unit_size;
-	buffer->sample_data = g_try_malloc0(size);
-	if (!buffer->sample_data)
+	unit_size = sizeof(uint16_t);
+	devc->buffer = feed_queue_logic_alloc(sdi,
+		CHUNK_SIZE / unit_size, unit_size);
+	if (!devc->buffer)
 		return SR_ERR_MALLOC;
-	buffer->write_pointer = buffer->sample_data;
+	/* Let consumers keep sample data without a copy. */
+	(void)feed_queue_logic_use_pool(devc->buffer, 4);
 	sr_sw_limits_init(&devc->limit.submit);
 
-	buffer->sdi = sdi;
-	memset(&buffer->logic, 0, sizeof(buffer->logic));
-	buffer->logic.unitsize = buffer->unit_size;
-	buffer->logic.data = buffer->sample_data;
-	memset(&buffer->packet, 0, sizeof(buffer->packet));
-	buffer->packet.type = SR_DF_LOGIC;
-	buffer->packet.payload = &buffer->logic;
-
 	return SR_OK;
 }
 
@@ -1222,73 +1186,51 @@ static int setup_submit_limit(struct dev_context *devc)
 
 static void free_submit_buffer(struct dev_context *devc)
 {
-	struct submit_buffer *buffer;
-
 	if (!devc)
 		return;
 
-	buffer = devc->buffer;
-	if (!buffer)
-		return;
+	feed_queue_logic_free(devc->buffer);
 	devc->buffer = NULL;
-
-	g_free(buffer->sample_data);
-	g_free(buffer);
 }
 
 static int flush_submit_buffer(struct dev_context *devc)
 {
-	struct submit_buffer *buffer;
-	int ret;
-
-	buffer = devc->buffer;
-
-	/* Is queued sample data available? */
-	if (!buffer->curr_samples)
-		return SR_OK;
-
-	/* Submit to the session feed. */
-	buffer->logic.length = buffer->curr_samples * buffer->unit_size;
-	ret = sr_session_send(buffer->sdi, &buffer->packet);
-	if (ret != SR_OK)
-		return ret;
-
-	/* Rewind queue position. */
-	buffer->curr_samples = 0;
-	buffer->write_pointer = buffer->sample_data;
-
-	return SR_OK;
+	return feed_queue_logic_flush(devc->buffer);
 }
 
 static int addto_submit_buffer(struct dev_context *devc,
 	uint16_t sample, size_t count)
 {
-	struct submit_buffer *buffer;
 	struct sr_sw_limits *limits;
+	uint64_t remain;
+	gboolean exceeded;
+	uint8_t unit_buffer[sizeof(sample)];
 	int ret;
 
-	buffer = devc->buffer;
-	limits = &devc->limit.submit;
-	if (!devc->use_triggers && sr_sw_limits_check(limits))
-		count = 0;
-
 	/*
-	 * Individually accumulate and check each sample, such that
-	 * accumulation between flushes won't exceed local storage, and
-	 * enforcement of user specified limits is exact.
+	 * Cap the run at the remaining sample count, such that the
+	 * enforcement of user specified limits is exact. Acquisitions
+	 * with triggers are not limited here.
 	 */
-	while (count--) {
-		write_u16le_inc(&buffer->write_pointer, sample);
-		buffer->curr_samples++;
-		if (buffer->curr_samples == buffer->max_samples) {
-			ret = flush_submit_buffer(devc);
-			if (ret != SR_OK)
-				return ret;
-		}
-		sr_sw_limits_update_samples_read(limits, 1);
-		if (!devc->use_triggers && sr_sw_limits_check(limits))
-			break;
+	limits = &devc->limit.submit;
+	if (!devc->use_triggers) {
+		ret = sr_sw_limits_get_remain(limits, &remain,
+			NULL, NULL, &exceeded);
+		if (ret != SR_OK)
+			return ret;
+		if (exceeded)
+			count = 0;
+		else if (remain && count > remain)
+			count = remain;
 	}
+	if (!count)
+		return SR_OK;
+
+	write_u16le(unit_buffer, sample);
+	ret = feed_queue_logic_submit(devc->buffer, unit_buffer, count);
+	if (ret != SR_OK)
+		return ret;
+	sr_sw_limits_update_samples_read(limits, count);
 
 	return SR_OK;
 }
@@ -1390,12 +1332,66 @@ static void rewind_trig_arm_pos(struct dev_context *devc, size_t count)
 	}
 }
 
+/*
+ * Deinterlace sample data that was retrieved at 100MHz and 200MHz
+ * samplerates. One 16bit item contains two samples of 8bits each, or
+ * four samples of 4bits each. The bits of multiple samples are
+ * interleaved: item bit (N * k + i) is bit k of sample i.
+ *
+ * Look-up tables translate each byte of the item, and return all of
+ * the item's samples packed in one 16bit value: sample i in bits
+ * [8 * i .. 8 * i + 7] for 2x8, and in bits [4 * i .. 4 * i + 3] for
+ * 4x4 layouts.
+ */
+static uint16_t deinterlace_lut_2x8[2][256];
+static uint16_t deinterlace_lut_4x4[2][256];
+
+static void sigma_deinterlace_init(void)
+{
+	static gsize done;
+	size_t pos, value, bit, inbit;
+	uint16_t out2, out4;
+
+	if (!g_once_init_enter(&done))
+		return;
+
+	for (pos = 0; pos < 2; pos++) {
+		for (value = 0; value < 256; value++) {
+			out2 = out4 = 0;
+			for (bit = 0; bit < 8; bit++) {
+				if (!(value & BIT(bit)))
+					continue;
+				inbit = 8 * pos + bit;
+				out2 |= BIT(8 * (inbit % 2) + inbit / 2);
+				out4 |= BIT(4 * (inbit % 4) + inbit / 4);
+			}
+			deinterlace_lut_2x8[pos][value] = out2;
+			deinterlace_lut_4x4[pos][value] = out4;
+		}
+	}
+
+	g_once_init_leave(&done, 1);
+}
+
+static inline uint16_t sigma_deinterlace_data_2x8(uint16_t indata)
+{
+	return deinterlace_lut_2x8[0][indata & 0xff] |
+		deinterlace_lut_2x8[1][indata >> 8];
+}
+
+static inline uint16_t sigma_deinterlace_data_4x4(uint16_t indata)
+{
+	return deinterlace_lut_4x4[0][indata & 0xff] |
+		deinterlace_lut_4x4[1][indata >> 8];
+}
+
 static int alloc_sample_buffer(struct dev_context *devc,
 	size_t stop_pos, size_t trig_pos, uint8_t mode)
 {
 	struct sigma_sample_interp *interp;
 	gboolean wrapped;
-	size_t alloc_size;
+	size_t alloc_size, idx;
+	struct sigma_dram_batch *batch;
 
 	interp = &devc->interp;
 
@@ -1440,6 +1436,7 @@ static int alloc_sample_buffer(struct dev_context *devc,
 	memset(&interp->trig_chk, 0, sizeof(interp->trig_chk));
 
 	/* Determine which DRAM lines to fetch from the device. */
+	sigma_deinterlace_init();
 	memset(&interp->fetch, 0, sizeof(interp->fetch));
 	interp->fetch.lines_total = interp->stop.line + 1;
 	interp->fetch.lines_total -= interp->start.line;
@@ -1449,23 +1446,83 @@ static int alloc_sample_buffer(struct dev_context *devc,
 
 	/* Arrange for chunked download, N lines per USB request. */
 	interp->fetch.lines_per_read = 32;
-	alloc_size = sizeof(devc->interp.fetch.rcvd_lines[0]);
-	alloc_size *= devc->interp.fetch.lines_per_read;
-	devc->interp.fetch.rcvd_lines = g_try_malloc0(alloc_size);
-	if (!devc->interp.fetch.rcvd_lines)
-		return SR_ERR_MALLOC;
+	alloc_size = sizeof(interp->fetch.batches[0].lines[0]);
+	alloc_size *= interp->fetch.lines_per_read;
+	interp->fetch.idle = g_async_queue_new();
+	interp->fetch.filled = g_async_queue_new();
+	for (idx = 0; idx < ARRAY_SIZE(interp->fetch.batches); idx++) {
+		batch = &interp->fetch.batches[idx];
+		batch->lines = g_try_malloc0(alloc_size);
+		if (!batch->lines)
+			return SR_ERR_MALLOC;
+		g_async_queue_push(interp->fetch.idle, batch);
+	}
 
 	return SR_OK;
 }
 
-static uint16_t sigma_deinterlace_data_4x4(uint16_t indata, int idx);
-static uint16_t sigma_deinterlace_data_2x8(uint16_t indata, int idx);
+/*
+ * Read DRAM lines in a separate thread while the previously received
+ * lines get interpreted. The fetch thread is the only user of the FTDI
+ * connection for the duration of the download. Batches of lines cycle
+ * between the 'idle' and the 'filled' queues. The fetch thread stops
+ * after the last line, after read errors, or when aborted.
+ */
+static gpointer fetch_thread(gpointer data)
+{
+	struct dev_context *devc;
+	struct sigma_sample_interp *interp;
+	struct sigma_dram_batch *batch;
+	size_t line, remain, count;
+
+	devc = data;
+	interp = &devc->interp;
+
+	line = interp->start.line;
+	remain = interp->fetch.lines_total;
+	while (remain) {
+		batch = g_async_queue_pop(interp->fetch.idle);
+		if (g_atomic_int_get(&interp->fetch.abort))
+			break;
+		count = MIN(remain, interp->fetch.lines_per_read);
+		batch->count = count;
+		batch->ret = sigma_read_dram(devc, line, count,
+			(uint8_t *)batch->lines);
+		g_async_queue_push(interp->fetch.filled, batch);
+		if (batch->ret != SR_OK)
+			break;
+		line += count;
+		line %= ROW_COUNT;
+		remain -= count;
+	}
+
+	return NULL;
+}
+
+static int start_sample_fetch(struct dev_context *devc)
+{
+	struct sigma_sample_interp *interp;
+	GError *error;
+
+	interp = &devc->interp;
+
+	error = NULL;
+	interp->fetch.abort = FALSE;
+	interp->fetch.thread = g_thread_try_new("sigma-fetch",
+		fetch_thread, devc, &error);
+	if (!interp->fetch.thread) {
+		sr_err("Cannot start DRAM fetch thread: %s.", error->message);
+		g_error_free(error);
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
 
 static int fetch_sample_buffer(struct dev_context *devc)
 {
 	struct sigma_sample_interp *interp;
-	size_t count;
-	int ret;
+	struct sigma_dram_batch *batch;
 	const uint8_t *rdptr;
 	uint16_t ts, data;
 
@@ -1476,16 +1533,15 @@ static int fetch_sample_buffer(struct dev_context *devc)
 		interp->iter = interp->start;
 	}
 
-	/* Get another set of DRAM lines in one read call. */
-	count = interp->fetch.lines_total - interp->fetch.lines_done;
-	if (count > interp->fetch.lines_per_read)
-		count = interp->fetch.lines_per_read;
-	ret = sigma_read_dram(devc, interp->iter.line, count,
-		(uint8_t *)interp->fetch.rcvd_lines);
-	if (ret != SR_OK)
-		return ret;
-	interp->fetch.lines_rcvd = count;
-	interp->fetch.curr_line = &interp->fetch.rcvd_lines[0];
+	/* Hand the previous batch back, get the next one. */
+	if (interp->fetch.batch)
+		g_async_queue_push(interp->fetch.idle, interp->fetch.batch);
+	batch = g_async_queue_pop(interp->fetch.filled);
+	interp->fetch.batch = batch;
+	if (batch->ret != SR_OK)
+		return batch->ret;
+	interp->fetch.lines_rcvd = batch->count;
+	interp->fetch.curr_line = &batch->lines[0];
 
 	/* First invocation? Get initial timestamp and sample data. */
 	if (!interp->fetch.lines_done) {
@@ -1493,9 +1549,9 @@ static int fetch_sample_buffer(struct dev_context *devc)
 		ts = read_u16le_inc(&rdptr);
 		data = read_u16le_inc(&rdptr);
 		if (interp->samples_per_event == 4) {
-			data = sigma_deinterlace_data_4x4(data, 0);
+			data = sigma_deinterlace_data_4x4(data) & 0xf;
 		} else if (interp->samples_per_event == 2) {
-			data = sigma_deinterlace_data_2x8(data, 0);
+			data = sigma_deinterlace_data_2x8(data) & 0xff;
 		}
 		interp->last.ts = ts;
 		interp->last.sample = data;
@@ -1506,9 +1562,41 @@ static int fetch_sample_buffer(struct dev_context *devc)
 
 static void free_sample_buffer(struct dev_context *devc)
 {
-	g_free(devc->interp.fetch.rcvd_lines);
-	devc->interp.fetch.rcvd_lines = NULL;
-	devc->interp.fetch.lines_per_read = 0;
+	struct sigma_sample_interp *interp;
+	size_t idx;
+
+	interp = &devc->interp;
+
+	/* Have the fetch thread terminate, wake it up when it waits. */
+	if (interp->fetch.thread) {
+		g_atomic_int_set(&interp->fetch.abort, TRUE);
+		g_async_queue_push(interp->fetch.idle, &interp->fetch.batches[0]);
+		g_thread_join(interp->fetch.thread);
+		interp->fetch.thread = NULL;
+	}
+	if (interp->fetch.idle)
+		g_async_queue_unref(interp->fetch.idle);
+	interp->fetch.idle = NULL;
+	if (interp->fetch.filled)
+		g_async_queue_unref(interp->fetch.filled);
+	interp->fetch.filled = NULL;
+	for (idx = 0; idx < ARRAY_SIZE(interp->fetch.batches); idx++) {
+		g_free(interp->fetch.batches[idx].lines);
+		interp->fetch.batches[idx].lines = NULL;
+	}
+	interp->fetch.batch = NULL;
+	interp->fetch.curr_line = NULL;
+	interp->fetch.lines_per_read = 0;
+}
+
+/* Stop a sample memory download which has not completed. */
+SR_PRIV void sigma_abort_download(struct dev_context *devc)
+{
+	if (!devc || !devc->interp.fetch.lines_per_read)
+		return;
+
+	free_submit_buffer(devc);
+	free_sample_buffer(devc);
 }
 
 /*
@@ -1721,16 +1809,7 @@ static gboolean sample_matches_trigger(struct dev_context *devc, uint16_t sample
 
 static int send_trigger_marker(struct dev_context *devc)
 {
-	int ret;
-
-	ret = flush_submit_buffer(devc);
-	if (ret != SR_OK)
-		return ret;
-	ret = std_session_send_df_trigger(devc->buffer->sdi);
-	if (ret != SR_OK)
-		return ret;
-
-	return SR_OK;
+	return feed_queue_logic_send_trigger(devc->buffer);
 }
 
 static int check_and_submit_sample(struct dev_context *devc,
@@ -1808,53 +1887,13 @@ static uint16_t sigma_dram_cluster_data(struct sigma_dram_cluster *cl, int idx)
 	return read_u16le((const uint8_t *)&cl->samples[idx]);
 }
 
-/*
- * Deinterlace sample data that was retrieved at 100MHz samplerate.
- * One 16bit item contains two samples of 8bits each. The bits of
- * multiple samples are interleaved.
- */
-static uint16_t sigma_deinterlace_data_2x8(uint16_t indata, int idx)
-{
-	uint16_t outdata;
-
-	indata >>= idx;
-	outdata = 0;
-	outdata |= (indata >> (0 * 2 - 0)) & (1 << 0);
-	outdata |= (indata >> (1 * 2 - 1)) & (1 << 1);
-	outdata |= (indata >> (2 * 2 - 2)) & (1 << 2);
-	outdata |= (indata >> (3 * 2 - 3)) & (1 << 3);
-	outdata |= (indata >> (4 * 2 - 4)) & (1 << 4);
-	outdata |= (indata >> (5 * 2 - 5)) & (1 << 5);
-	outdata |= (indata >> (6 * 2 - 6)) & (1 << 6);
-	outdata |= (indata >> (7 * 2 - 7)) & (1 << 7);
-	return outdata;
-}
-
-/*
- * Deinterlace sample data that was retrieved at 200MHz samplerate.
- * One 16bit item contains four samples of 4bits each. The bits of
- * multiple samples are interleaved.
- */
-static uint16_t sigma_deinterlace_data_4x4(uint16_t indata, int idx)
-{
-	uint16_t outdata;
-
-	indata >>= idx;
-	outdata = 0;
-	outdata |= (indata >> (0 * 4 - 0)) & (1 << 0);
-	outdata |= (indata >> (1 * 4 - 1)) & (1 << 1);
-	outdata |= (indata >> (2 * 4 - 2)) & (1 << 2);
-	outdata |= (indata >> (3 * 4 - 3)) & (1 << 3);
-	return outdata;
-}
-
 static void sigma_decode_dram_cluster(struct dev_context *devc,
 	struct sigma_dram_cluster *dram_cluster,
 	size_t events_in_cluster)
 {
 	uint16_t tsdiff, ts, sample, item16;
 	size_t count;
-	size_t evt;
+	size_t evt, idx;
 
 	/*
 	 * If this cluster is not adjacent to the previously received
@@ -1886,25 +1925,21 @@ static void sigma_decode_dram_cluster(struct dev_context *devc,
 	for (evt = 0; evt < events_in_cluster; evt++) {
 		item16 = sigma_dram_cluster_data(dram_cluster, evt);
 		if (devc->interp.samples_per_event == 4) {
-			sample = sigma_deinterlace_data_4x4(item16, 0);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_4x4(item16, 1);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_4x4(item16, 2);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_4x4(item16, 3);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
+			item16 = sigma_deinterlace_data_4x4(item16);
+			for (idx = 0; idx < 4; idx++) {
+				sample = item16 & 0xf;
+				item16 >>= 4;
+				check_and_submit_sample(devc, sample, 1);
+				devc->interp.last.sample = sample;
+			}
 		} else if (devc->interp.samples_per_event == 2) {
-			sample = sigma_deinterlace_data_2x8(item16, 0);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_2x8(item16, 1);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
+			item16 = sigma_deinterlace_data_2x8(item16);
+			for (idx = 0; idx < 2; idx++) {
+				sample = item16 & 0xff;
+				item16 >>= 8;
+				check_and_submit_sample(devc, sample, 1);
+				devc->interp.last.sample = sample;
+			}
 		} else {
 			sample = item16;
 			check_and_submit_sample(devc, sample, 1);
@@ -1978,11 +2013,17 @@ static int download_capture(struct sr_dev_inst *sdi)
 	 * FORCESTOP request makes the hardware "disable RLE" (store
 	 * clusters to DRAM regardless of whether pin state changes) and
 	 * raise the POSTTRIGGERED flag.
+	 *
+	 * The FTDI connection belongs to the fetch thread while sample
+	 * memory gets downloaded, don't access the device then.
 	 */
-	ret = sigma_get_register(devc, READ_MODE, &modestatus);
-	if (ret != SR_OK) {
-		sr_err("Could not determine current device state.");
-		return FALSE;
+	modestatus = RMR_POSTTRIGGERED;
+	if (!interp->fetch.lines_per_read) {
+		ret = sigma_get_register(devc, READ_MODE, &modestatus);
+		if (ret != SR_OK) {
+			sr_err("Could not determine current device state.");
+			return FALSE;
+		}
 	}
 	if (!(modestatus & RMR_POSTTRIGGERED)) {
 		sr_info("Downloading sample data.");
@@ -2038,6 +2079,10 @@ static int download_capture(struct sr_dev_inst *sdi)
 		ret = setup_submit_limit(devc);
 		if (ret != SR_OK)
 			return FALSE;
+
+		ret = start_sample_fetch(devc);
+		if (ret != SR_OK)
+			return FALSE;
 	}
 
 	/*
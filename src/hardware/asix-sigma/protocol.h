@@ -321,8 +321,6 @@ enum ext_clock_edge_t {
 	SIGMA_CLOCK_EDGE_EITHER,
 };
 
-struct submit_buffer;
-
 struct dev_context {
 	struct {
 		uint16_t vid, pid;
@@ -367,8 +365,16 @@ struct dev_context {
 			size_t lines_total, lines_done;
 			size_t lines_per_read; /* USB transfer limit */
 			size_t lines_rcvd;
-			struct sigma_dram_line *rcvd_lines;
 			struct sigma_dram_line *curr_line;
+			/* DRAM reads run in a thread, ahead of decoding. */
+			GThread *thread;
+			GAsyncQueue *idle, *filled;
+			struct sigma_dram_batch {
+				struct sigma_dram_line *lines;
+				size_t count;
+				int ret;
+			} batches[4], *batch;
+			gint abort;
 		} fetch;
 		struct {
 			gboolean armed;
@@ -388,7 +394,7 @@ struct dev_context {
 		SIGMA_STOPPING,
 		SIGMA_DOWNLOAD,
 	} state;
-	struct submit_buffer *buffer;
+	struct feed_queue_logic *buffer;
 };
 
 /* "Automatic" and forced USB connection open/close support. */
@@ -422,5 +428,6 @@ SR_PRIV int sigma_build_basic_trigger(struct dev_context *devc,
 
 /* Callback to periodically drive acuisition progress. */
 SR_PRIV int sigma_receive_data(int fd, int revents, void *cb_data);
+SR_PRIV void sigma_abort_download(struct dev_context *devc);
 
 #endif
@@ -52,6 +52,7 @@ struct channel_priv {
 	int ch_type;
 	int fd;
 	int digits;
+	float scale;
 	float val;
 	struct channel_group_priv *probe;
 };
@@ -634,23 +635,22 @@ static float read_sample(struct sr_channel *ch)
 	struct channel_priv *chp;
 	char buf[16];
 	ssize_t len;
-	int fd;
 
 	chp = ch->priv;
-	fd = chp->fd;
-
-	lseek(fd, 0, SEEK_SET);
 
-	len = read(fd, buf, sizeof(buf));
+	/* Positional reads regenerate the attribute, no lseek() needed. */
+	len = pread(chp->fd, buf, sizeof(buf) - 1, 0);
 	if (len < 0) {
 		sr_err("Error reading from channel %s (hwmon: %d): %s",
 			ch->name, chp->probe->hwmon_num, g_strerror(errno));
 		ch->enabled = FALSE;
+		sr_dev_channels_changed(ch->sdi);
 		return -1.0;
 	}
 
-	chp->digits = type_digits(chp->ch_type);
-	return strtol(buf, NULL, 10) * powf(10, -chp->digits);
+	buf[len] = '\0';
+
+	return strtol(buf, NULL, 10) * chp->scale;
 }
 
 SR_PRIV int bl_acme_open_channel(struct sr_channel *ch)
@@ -680,10 +680,13 @@ SR_PRIV int bl_acme_open_channel(struct sr_channel *ch)
 	if (fd < 0) {
 		sr_err("Error opening %s: %s", path, g_strerror(errno));
 		ch->enabled = FALSE;
+		sr_dev_channels_changed(ch->sdi);
 		return SR_ERR;
 	}
 
 	chp->fd = fd;
+	chp->digits = type_digits(chp->ch_type);
+	chp->scale = powf(10, -chp->digits);
 
 	return 0;
 }
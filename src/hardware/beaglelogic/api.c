@@ -18,6 +18,8 @@
  */
 
 #include <config.h>
+#include <errno.h>
+#include <sys/mman.h>
 #include "protocol.h"
 #include "beaglelogic.h"
 
@@ -186,8 +188,18 @@ static int dev_open(struct sr_dev_inst *sdi)
 			devc->beaglelogic->close(devc);
 			return SR_ERR;
 		}
-	} else {
-		devc->tcp_buffer = g_malloc(TCP_BUFFER_SIZE);
+	} else if (!devc->tcp_buffer) {
+		/* Anonymous mapping, so the receive buffer is page aligned. */
+		devc->tcp_buffer = mmap(NULL, TCP_BUFFER_SIZE,
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+			-1, 0);
+		if (devc->tcp_buffer == MAP_FAILED) {
+			sr_err("Unable to allocate receive buffer: %s",
+				g_strerror(errno));
+			devc->tcp_buffer = NULL;
+			devc->beaglelogic->close(devc);
+			return SR_ERR;
+		}
 	}
 
 	return SR_OK;
@@ -202,12 +214,16 @@ static int dev_close(struct sr_dev_inst *sdi)
 		devc->beaglelogic->munmap(devc);
 	devc->beaglelogic->close(devc);
 
+	if (devc->tcp_buffer) {
+		munmap(devc->tcp_buffer, TCP_BUFFER_SIZE);
+		devc->tcp_buffer = NULL;
+	}
+
 	return SR_OK;
 }
 
 static void clear_helper(struct dev_context *devc)
 {
-	g_free(devc->tcp_buffer);
 	g_free(devc->address);
 	g_free(devc->port);
 }
@@ -46,7 +46,7 @@ static int beaglelogic_tcp_open(struct dev_context *devc)
 {
 	struct addrinfo hints;
 	struct addrinfo *results, *res;
-	int err;
+	int err, rcvbuf;
 
 	memset(&hints, 0, sizeof(hints));
 	hints.ai_family = AF_UNSPEC;
@@ -65,6 +65,16 @@ static int beaglelogic_tcp_open(struct dev_context *devc)
 		if ((devc->socket = socket(res->ai_family, res->ai_socktype,
 						res->ai_protocol)) < 0)
 			continue;
+		/*
+		 * Ask for a large receive buffer before connecting, so
+		 * that the window scale negotiated with the sender allows
+		 * it to stream at line rate. The kernel may clamp this.
+		 */
+		rcvbuf = TCP_SOCKET_BUFFER_SIZE;
+		if (setsockopt(devc->socket, SOL_SOCKET, SO_RCVBUF,
+				(const void *)&rcvbuf, sizeof(rcvbuf)) != 0)
+			sr_dbg("Cannot set receive buffer size: %s",
+				g_strerror(errno));
 		if (connect(devc->socket, res->ai_addr, res->ai_addrlen) != 0) {
 			close(devc->socket);
 			devc->socket = -1;
@@ -140,27 +150,41 @@ static int beaglelogic_tcp_read_data(struct dev_context *devc, char *buf,
 
 SR_PRIV int beaglelogic_tcp_drain(struct dev_context *devc)
 {
-	char *buf = g_malloc(1024);
+	char *buf;
 	fd_set rset;
-	int ret, len = 0;
+	int ret, len = 0, maxlen;
 	struct timeval tv;
 
-	FD_ZERO(&rset);
-	FD_SET(devc->socket, &rset);
-
-	/* 25ms timeout */
-	tv.tv_sec = 0;
-	tv.tv_usec = 25 * 1000;
+	/* Drain into the sample buffer when there is one, it is large. */
+	if (devc->tcp_buffer) {
+		buf = (char *)devc->tcp_buffer;
+		maxlen = TCP_BUFFER_SIZE;
+	} else {
+		maxlen = 64 * 1024;
+		buf = g_malloc(maxlen);
+	}
+	devc->tcp_fill = 0;
 
 	do {
+		FD_ZERO(&rset);
+		FD_SET(devc->socket, &rset);
+
+		/* 25ms timeout */
+		tv.tv_sec = 0;
+		tv.tv_usec = 25 * 1000;
+
 		ret = select(devc->socket + 1, &rset, NULL, NULL, &tv);
-		if (ret > 0)
-			len += beaglelogic_tcp_read_data(devc, buf, 1024);
+		if (ret > 0) {
+			ret = beaglelogic_tcp_read_data(devc, buf, maxlen);
+			if (ret > 0)
+				len += ret;
+		}
 	} while (ret > 0);
 
 	sr_spew("Drained %d bytes of data.", len);
 
-	g_free(buf);
+	if (buf != (char *)devc->tcp_buffer)
+		g_free(buf);
 
 	return SR_OK;
 }
@@ -117,6 +117,40 @@ SR_PRIV int beaglelogic_native_receive_data(int fd, int revents, void *cb_data)
 	return TRUE;
 }
 
+/*
+ * Fill the receive buffer with whatever the socket holds right now, up to
+ * the buffer size. This never blocks the session, but at high data rates
+ * the socket buffer has plenty queued, and a whole buffer is handed to the
+ * session with one packet. Returns the number of bytes received, 0 on EOF
+ * or a negative value on errors.
+ */
+static int beaglelogic_tcp_fill(int fd, struct dev_context *devc)
+{
+	ssize_t len;
+	size_t total;
+
+	total = 0;
+	while (devc->tcp_fill + total < TCP_BUFFER_SIZE) {
+		len = recv(fd, (char *)devc->tcp_buffer + devc->tcp_fill + total,
+			TCP_BUFFER_SIZE - devc->tcp_fill - total,
+			total ? MSG_DONTWAIT : 0);
+		if (len > 0) {
+			total += len;
+			continue;
+		}
+		if (len == 0 && !total)
+			return 0;
+		if (len < 0 && !total) {
+			sr_err("Receive error: %s", g_strerror(errno));
+			return -1;
+		}
+		/* EAGAIN or EOF after some data, send what we have. */
+		break;
+	}
+
+	return total;
+}
+
 SR_PRIV int beaglelogic_tcp_receive_data(int fd, int revents, void *cb_data)
 {
 	const struct sr_dev_inst *sdi;
@@ -127,7 +161,7 @@ SR_PRIV int beaglelogic_tcp_receive_data(int fd, int revents, void *cb_data)
 	int len;
 	int pre_trigger_samples;
 	int trigger_offset;
-	uint32_t packetsize;
+	uint32_t packetsize, partial;
 	uint64_t bytes_remaining;
 
 	if (!(sdi = cb_data) || !(devc = sdi->priv))
@@ -137,20 +171,25 @@ SR_PRIV int beaglelogic_tcp_receive_data(int fd, int revents, void *cb_data)
 	logic.unitsize = SAMPLEUNIT_TO_BYTES(devc->sampleunit);
 
 	if (revents == G_IO_IN) {
-		sr_info("In callback G_IO_IN");
-
-		len = recv(fd, devc->tcp_buffer, TCP_BUFFER_SIZE, 0);
-		if (len < 0) {
-			sr_err("Receive error: %s", g_strerror(errno));
+		len = beaglelogic_tcp_fill(fd, devc);
+		if (len < 0)
 			return SR_ERR;
-		}
 
-		packetsize = len;
+		/* Only whole samples are sent, keep the rest for later. */
+		packetsize = devc->tcp_fill + len;
+		partial = packetsize % logic.unitsize;
+		packetsize -= partial;
+		if (len > 0 && !packetsize) {
+			devc->tcp_fill += len;
+			return TRUE;
+		}
+		if (len == 0)
+			packetsize = 0;
 
 		bytes_remaining = (devc->limit_samples * logic.unitsize) -
 				devc->bytes_read;
 
-		/* Configure data packet */
+		/* Configure data packet, it points into the receive buffer. */
 		packet.type = SR_DF_LOGIC;
 		packet.payload = &logic;
 		logic.data = devc->tcp_buffer;
@@ -176,6 +215,12 @@ SR_PRIV int beaglelogic_tcp_receive_data(int fd, int revents, void *cb_data)
 			}
 		}
 
+		/* The session is done with the buffer, move the partial sample. */
+		if (partial)
+			memmove(devc->tcp_buffer, devc->tcp_buffer + packetsize,
+				partial);
+		devc->tcp_fill = partial;
+
 		/* Update byte count and offset (roll over if needed) */
 		devc->bytes_read += logic.length;
 		if ((devc->offset += packetsize) >= devc->buffersize) {
@@ -32,7 +32,14 @@
 
 #define SAMPLEUNIT_TO_BYTES(x)	((x) == 1 ? 1 : 2)
 
-#define TCP_BUFFER_SIZE         (128 * 1024)
+/*
+ * Sample data from the TCP backend is received straight into this buffer
+ * and sent from there, it is filled as far as the socket allows on each
+ * poll. The socket receive buffer should hold a few of these so the
+ * sender keeps streaming while the session processes the previous one.
+ */
+#define TCP_BUFFER_SIZE         (1024 * 1024)
+#define TCP_SOCKET_BUFFER_SIZE  (4 * TCP_BUFFER_SIZE)
 
 /** Private, per-device-instance driver context. */
 struct dev_context {
@@ -47,7 +54,8 @@ struct dev_context {
 	char *port;
 	int socket;
 	unsigned int read_timeout;
-	unsigned char *tcp_buffer;
+	unsigned char *tcp_buffer;	/* Page aligned, TCP_BUFFER_SIZE */
+	uint32_t tcp_fill;	/* Partial sample kept from the last read */
 
 	/* Acquisition settings: see beaglelogic.h */
 	uint64_t cur_samplerate;
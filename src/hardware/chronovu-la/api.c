@@ -73,14 +73,12 @@ static int add_device(int model, struct libusb_device_descriptor *des,
 	devc->cur_samplerate = 0; /* Set later (different for LA8/LA16). */
 	devc->limit_msec = 0;
 	devc->limit_samples = 0;
-	memset(devc->mangled_buf, 0, BS);
 	devc->final_buf = NULL;
 	devc->trigger_pattern = 0x0000; /* Irrelevant, see trigger_mask. */
 	devc->trigger_mask = 0x0000; /* All channels: "don't care". */
 	devc->trigger_edgemask = 0x0000; /* All channels: "state triggered". */
 	devc->trigger_found = 0;
 	devc->done = 0;
-	devc->block_counter = 0;
 	devc->divcount = 0;
 	devc->usb_vid = des->idVendor;
 	devc->usb_pid = des->idProduct;
@@ -151,7 +149,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		conn_devices = NULL;
 
 	devices = NULL;
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
@@ -215,7 +213,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		}
 	}
 
-	libusb_free_device_list(devlist, 1);
+	sr_usb_free_device_list(devlist);
 	g_slist_free_full(conn_devices, (GDestroyNotify)sr_usb_dev_inst_free);
 
 	return std_scan_complete(di, devices);
@@ -275,6 +273,7 @@ static int dev_close(struct sr_dev_inst *sdi)
 	if (!devc->ftdic)
 		return SR_ERR_BUG;
 
+	sr_usb_stream_free(&devc->stream);
 	if ((ret = ftdi_usb_close(devc->ftdic)) < 0)
 		sr_err("Failed to close FTDI device (%d): %s.",
 		       ret, ftdi_get_error_string(devc->ftdic));
@@ -370,7 +369,7 @@ static int config_list(uint32_t key, GVariant **data,
 
 static int receive_data(int fd, int revents, void *cb_data)
 {
-	int i, ret;
+	int i;
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 
@@ -392,18 +391,15 @@ static int receive_data(int fd, int revents, void *cb_data)
 		return FALSE;
 	}
 
-	/* Get one block of data. */
-	if ((ret = cv_read_block(devc)) < 0) {
-		sr_err("Failed to read data block: %d.", ret);
+	if (cv_stream_check(sdi) != SR_OK) {
+		sr_err("Failed to read sample data.");
 		sr_dev_acquisition_stop(sdi);
 		return FALSE;
 	}
 
 	/* We need to get exactly NUM_BLOCKS blocks (i.e. 8MB) of data. */
-	if (devc->block_counter != (NUM_BLOCKS - 1)) {
-		devc->block_counter++;
+	if (devc->bytes_read < SDRAM_SIZE || devc->stream.submitted)
 		return TRUE;
-	}
 
 	sr_dbg("Sampling finished, sending data to session bus now.");
 
@@ -479,17 +475,22 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	/* Time when we should be done (for detecting trigger timeouts). */
 	devc->done = (devc->divcount + 1) * devc->prof->trigger_constant +
 			g_get_monotonic_time() + (10 * G_TIME_SPAN_SECOND);
-	devc->block_counter = 0;
 	devc->trigger_found = 0;
 
-	/* Hook up a dummy handler to receive data from the device. */
-	sr_session_source_add(sdi->session, -1, 0, 0, receive_data, (void *)sdi);
+	if (cv_stream_start(sdi) != SR_OK) {
+		std_session_send_df_end(sdi);
+		return SR_ERR;
+	}
+
+	/* Handle the events of libftdi's USB context. */
+	sr_session_source_add(sdi->session, -1, 0, 10, receive_data, (void *)sdi);
 
 	return SR_OK;
 }
 
 static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 {
+	cv_stream_stop(sdi);
 	sr_session_source_remove(sdi->session, -1);
 	std_session_send_df_end(sdi);
 
@@ -193,6 +193,8 @@ static int close_usb_reset_sequencer(struct dev_context *devc)
 	/* Note: Caller checked that devc and devc->ftdic != NULL. */
 
 	if (devc->ftdic->usb_dev) {
+		sr_usb_stream_free(&devc->stream);
+
 		/* Reset the sequencer logic, then wait 100ms. */
 		sr_dbg("Resetting sequencer logic.");
 		(void) cv_write(devc, buf, 8); /* Ignore errors. */
@@ -347,64 +349,141 @@ SR_PRIV int cv_set_samplerate(const struct sr_dev_inst *sdi, uint64_t samplerate
 	return SR_OK;
 }
 
+/* De-mangle received data into the final buffer. */
+static void demangle(struct dev_context *devc, const uint8_t *buf, size_t len)
+{
+	size_t i;
+	uint64_t byte_offset;
+	int m, mi, p, q, index;
+
+	for (i = 0; i < len; i++) {
+		byte_offset = devc->bytes_read + i;
+		m = byte_offset / (1024 * 1024);
+		mi = m * (1024 * 1024);
+		if (devc->prof->model == CHRONOVU_LA8) {
+			p = byte_offset & (1 << 0);
+			index = m * 2 + ((byte_offset - mi) / 2) * 16;
+			index += (devc->divcount == 0) ? p : (1 - p);
+		} else {
+			p = byte_offset & (1 << 0);
+			q = byte_offset & (1 << 1);
+			index = m * 4 + ((byte_offset - mi) / 4) * 32;
+			index += q + (1 - p);
+		}
+		devc->final_buf[index] = buf[i];
+	}
+	devc->bytes_read += len;
+}
+
+static gboolean stream_receive(struct libusb_transfer *transfer,
+	void *cb_data)
+{
+	struct dev_context *devc;
+	size_t len;
+
+	devc = cb_data;
+
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED &&
+			transfer->status != LIBUSB_TRANSFER_TIMED_OUT) {
+		sr_err("Failed to read data: %s.",
+		       libusb_error_name(transfer->status));
+		devc->read_error = TRUE;
+		return FALSE;
+	}
+
+	len = sr_usb_ftdi_payload(transfer->buffer, transfer->actual_length,
+		devc->ftdic->max_packet_size);
+	len = MIN(len, SDRAM_SIZE - devc->bytes_read);
+	sr_spew("Demangling %zu bytes at offset %" PRIu64 ".",
+		len, devc->bytes_read);
+	demangle(devc, transfer->buffer, len);
+
+	/* We need to get exactly NUM_BLOCKS blocks (i.e. 8MB) of data. */
+	return devc->bytes_read < SDRAM_SIZE;
+}
+
 /**
- * Get a block of data from the device.
+ * Start reading the sample data from the device.
  *
- * @param devc The struct containing private per-device-instance data. Must not
- *             be NULL. devc->ftdic must not be NULL either.
+ * The device sends the content of its SDRAM once the trigger matched.
+ * A queue of USB transfers receives it while the host tends to other
+ * things, rather than a blocking read per block.
+ *
+ * @param sdi The device instance. devc->ftdic must not be NULL.
  *
  * @return SR_OK upon success, or SR_ERR upon errors.
  */
-SR_PRIV int cv_read_block(struct dev_context *devc)
+SR_PRIV int cv_stream_start(const struct sr_dev_inst *sdi)
 {
-	int i, byte_offset, m, mi, p, q, index, bytes_read;
-	gint64 now;
-
-	/* Note: Caller checked that devc and devc->ftdic != NULL. */
-
-	sr_spew("Reading block %d.", devc->block_counter);
+	struct dev_context *devc;
+	size_t packet_size;
 
-	bytes_read = cv_read(devc, devc->mangled_buf, BS);
+	devc = sdi->priv;
+	devc->bytes_read = 0;
+	devc->read_error = FALSE;
 
-	/* If first block read got 0 bytes, retry until success or timeout. */
-	if ((bytes_read == 0) && (devc->block_counter == 0)) {
-		do {
-			sr_spew("Reading block 0 (again).");
-			/* Note: If bytes_read < 0 cv_read() will log errors. */
-			bytes_read = cv_read(devc, devc->mangled_buf, BS);
-			now = g_get_monotonic_time();
-		} while ((devc->done > now) && (bytes_read == 0));
-	}
+	packet_size = devc->ftdic->max_packet_size;
+	sr_usb_stream_start(&devc->stream, STREAM_RATE, packet_size,
+		0, STREAM_MAX_DEPTH);
 
-	/* Check if block read was successful or a timeout occurred. */
-	if (bytes_read != BS) {
-		sr_err("Trigger timed out. Bytes read: %d.", bytes_read);
-		(void) reset_device(devc); /* Ignore errors. */
+	if (sr_usb_stream_submit(&devc->stream, devc->ftdic->usb_dev,
+			devc->ftdic->out_ep, stream_receive, NULL, devc) != SR_OK) {
+		sr_err("Failed to start reading data.");
 		return SR_ERR;
 	}
 
-	/* De-mangle the data. */
-	sr_spew("Demangling block %d.", devc->block_counter);
-	byte_offset = devc->block_counter * BS;
-	m = byte_offset / (1024 * 1024);
-	mi = m * (1024 * 1024);
-	for (i = 0; i < BS; i++) {
-		if (devc->prof->model == CHRONOVU_LA8) {
-			p = i & (1 << 0);
-			index = m * 2 + (((byte_offset + i) - mi) / 2) * 16;
-			index += (devc->divcount == 0) ? p : (1 - p);
-		} else {
-			p = i & (1 << 0);
-			q = i & (1 << 1);
-			index = m * 4 + (((byte_offset + i) - mi) / 4) * 32;
-			index += q + (1 - p);
-		}
-		devc->final_buf[index] = devc->mangled_buf[i];
-	}
-
 	return SR_OK;
 }
 
+/**
+ * Handle the events of the data readout.
+ *
+ * Resets the device upon errors, and when the trigger did not match in
+ * time.
+ *
+ * @param sdi The device instance. devc->ftdic must not be NULL.
+ *
+ * @return SR_OK while reading, or after all data was read. SR_ERR upon
+ *         errors or timeouts.
+ */
+SR_PRIV int cv_stream_check(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct timeval tv;
+
+	devc = sdi->priv;
+
+	/* libftdi has a libusb context of its own, no source handles it. */
+	tv.tv_sec = tv.tv_usec = 0;
+	libusb_handle_events_timeout_completed(devc->ftdic->usb_ctx, &tv, NULL);
+
+	if (!devc->read_error && (devc->bytes_read ||
+			g_get_monotonic_time() < devc->done))
+		return SR_OK;
+
+	if (!devc->read_error)
+		sr_err("Trigger timed out. Bytes read: %" PRIu64 ".",
+			devc->bytes_read);
+	cv_stream_stop(sdi);
+	(void) reset_device(devc); /* Ignore errors. */
+
+	return SR_ERR;
+}
+
+/**
+ * Stop reading data from the device.
+ *
+ * @param sdi The device instance.
+ */
+SR_PRIV void cv_stream_stop(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+	if (devc->ftdic)
+		sr_usb_stream_drain(&devc->stream, devc->ftdic->usb_ctx, 1000);
+}
+
 SR_PRIV void cv_send_block_to_session_bus(const struct sr_dev_inst *sdi, int block)
 {
 	int i, idx;
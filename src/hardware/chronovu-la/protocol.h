@@ -36,6 +36,10 @@
 #define BS				4096 /* Block size */
 #define NUM_BLOCKS			2048 /* Number of blocks */
 
+/* Rate of the SDRAM readout, most transfers in flight. */
+#define STREAM_RATE			(1024 * 1024)
+#define STREAM_MAX_DEPTH		16
+
 enum {
 	CHRONOVU_LA8,
 	CHRONOVU_LA16,
@@ -58,12 +62,6 @@ struct dev_context {
 	uint64_t limit_msec;
 	uint64_t limit_samples;
 
-	/**
-	 * A buffer containing some (mangled) samples from the device.
-	 * Format: Pretty mangled-up (due to hardware reasons), see code.
-	 */
-	uint8_t mangled_buf[BS];
-
 	/**
 	 * An 8MB buffer where we'll store the de-mangled samples.
 	 * LA8: Each sample is 1 byte, MSB is channel 7, LSB is channel 0.
@@ -100,8 +98,17 @@ struct dev_context {
 	/** Used for keeping track how much time has passed. */
 	gint64 done;
 
-	/** Counter/index for the data block to be read. */
-	int block_counter;
+	/**
+	 * Transfers which read the (mangled) samples from the device.
+	 * Format: Pretty mangled-up (due to hardware reasons), see code.
+	 */
+	struct sr_usb_stream stream;
+
+	/** Number of bytes read from the device's SDRAM. */
+	uint64_t bytes_read;
+
+	/** The SDRAM readout failed. */
+	gboolean read_error;
 
 	/** The divcount value (determines the sample period). */
 	uint8_t divcount;
@@ -122,7 +129,9 @@ SR_PRIV uint8_t cv_samplerate_to_divcount(const struct sr_dev_inst *sdi,
 SR_PRIV int cv_write(struct dev_context *devc, uint8_t *buf, int size);
 SR_PRIV int cv_convert_trigger(const struct sr_dev_inst *sdi);
 SR_PRIV int cv_set_samplerate(const struct sr_dev_inst *sdi, uint64_t samplerate);
-SR_PRIV int cv_read_block(struct dev_context *devc);
+SR_PRIV int cv_stream_start(const struct sr_dev_inst *sdi);
+SR_PRIV int cv_stream_check(const struct sr_dev_inst *sdi);
+SR_PRIV void cv_stream_stop(const struct sr_dev_inst *sdi);
 SR_PRIV void cv_send_block_to_session_bus(const struct sr_dev_inst *sdi, int block);
 
 #endif
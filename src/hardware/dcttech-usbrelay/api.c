@@ -97,7 +97,7 @@ static struct sr_dev_inst *probe_device_common(const char *path,
 	report[0] = REPORT_NUMBER;
 	ret = hid_get_feature_report(hid, report, sizeof(report));
 	hid_close(hid);
-	if (sr_log_loglevel_get() >= SR_LOG_SPEW) {
+	if (sr_log_enabled(SR_LOG_SPEW)) {
 		txt = sr_hexdump_new(report, sizeof(report));
 		sr_spew("Got report bytes: %s, rc %d.", txt->str, ret);
 		sr_hexdump_free(txt);
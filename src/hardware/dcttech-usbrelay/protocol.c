@@ -38,7 +38,7 @@ SR_PRIV int dcttech_usbrelay_update_state(const struct sr_dev_inst *sdi)
 	ret = hid_get_feature_report(devc->hid_dev, report, sizeof(report));
 	if (ret != sizeof(report))
 		return SR_ERR_IO;
-	if (sr_log_loglevel_get() >= SR_LOG_SPEW) {
+	if (sr_log_enabled(SR_LOG_SPEW)) {
 		txt = sr_hexdump_new(report, sizeof(report));
 		sr_spew("Got report bytes: %s.", txt->str);
 		sr_hexdump_free(txt);
@@ -98,7 +98,7 @@ SR_PRIV int dcttech_usbrelay_switch_cg(const struct sr_dev_inst *sdi,
 			report[2] = relay_idx;
 		}
 	}
-	if (sr_log_loglevel_get() >= SR_LOG_SPEW) {
+	if (sr_log_enabled(SR_LOG_SPEW)) {
 		txt = sr_hexdump_new(report, sizeof(report));
 		sr_spew("Sending report bytes: %s", txt->str);
 		sr_hexdump_free(txt);
@@ -47,6 +47,12 @@ static const char *logic_pattern_str[] = {
 	"graycode",
 };
 
+/* Pacing of the samples, "max-rate" is free running. */
+static const char *test_mode_str[] = {
+	"paced",
+	"max-rate",
+};
+
 static const uint32_t scanopts[] = {
 	SR_CONF_NUM_LOGIC_CHANNELS,
 	SR_CONF_NUM_ANALOG_CHANNELS,
@@ -69,6 +75,8 @@ static const uint32_t devopts[] = {
 	SR_CONF_AVG_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_TRIGGER_MATCH | SR_CONF_LIST,
 	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_BUFFERSIZE | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_TEST_MODE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 };
 
 static const uint32_t devopts_cg_logic[] = {
@@ -93,6 +101,8 @@ static const int32_t trigger_matches[] = {
 	SR_TRIGGER_RISING,
 	SR_TRIGGER_FALLING,
 	SR_TRIGGER_EDGE,
+	SR_TRIGGER_OVER,
+	SR_TRIGGER_UNDER,
 };
 
 static const uint64_t samplerates[] = {
@@ -140,9 +150,13 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	devc->cur_samplerate = SR_KHZ(200);
 	devc->num_logic_channels = num_logic_channels;
 	devc->logic_unitsize = (devc->num_logic_channels + 7) / 8;
-	devc->all_logic_channels_mask = 1UL << 0;
-	devc->all_logic_channels_mask <<= devc->num_logic_channels;
-	devc->all_logic_channels_mask--;
+	if (devc->num_logic_channels >= 64)
+		devc->all_logic_channels_mask = UINT64_MAX;
+	else
+		devc->all_logic_channels_mask =
+			(UINT64_C(1) << devc->num_logic_channels) - 1;
+	devc->logic_bufsize = LOGIC_BUFSIZE;
+	devc->logic_data = g_malloc0(devc->logic_bufsize);
 	devc->logic_pattern = DEFAULT_LOGIC_PATTERN;
 	devc->num_analog_channels = num_analog_channels;
 	devc->limit_frames = limit_frames;
@@ -220,6 +234,8 @@ static void clear_helper(struct dev_context *devc)
 	void *value;
 
 	demo_free_analog_pattern(devc);
+	g_free(devc->logic_data);
+	g_free(devc->logic_tile);
 
 	/* Analog generators. */
 	g_hash_table_iter_init(&iter, devc->ch_ag);
@@ -233,38 +249,99 @@ static int dev_clear(const struct sr_dev_driver *di)
 	return std_dev_clear_with_callback(di, (std_dev_clear_callback)clear_helper);
 }
 
-static int config_get(uint32_t key, GVariant **data,
+static int config_get_u64(uint32_t key, uint64_t *value,
 	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
 {
 	struct dev_context *devc;
-	struct sr_channel *ch;
-	struct analog_gen *ag;
-	GVariant *mq_arr[2];
-	int pattern;
+
+	(void)cg;
 
 	if (!sdi)
-		return SR_ERR_ARG;
+		return SR_ERR_NA;
 
 	devc = sdi->priv;
 	switch (key) {
 	case SR_CONF_SAMPLERATE:
-		*data = g_variant_new_uint64(devc->cur_samplerate);
+		*value = devc->cur_samplerate;
 		break;
 	case SR_CONF_LIMIT_SAMPLES:
-		*data = g_variant_new_uint64(devc->limit_samples);
+		*value = devc->limit_samples;
 		break;
 	case SR_CONF_LIMIT_MSEC:
-		*data = g_variant_new_uint64(devc->limit_msec);
+		*value = devc->limit_msec;
 		break;
 	case SR_CONF_LIMIT_FRAMES:
-		*data = g_variant_new_uint64(devc->limit_frames);
+		*value = devc->limit_frames;
 		break;
+	default:
+		return SR_ERR_NA;
+	}
+
+	return SR_OK;
+}
+
+static int config_set_u64(uint32_t key, uint64_t value,
+	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
+{
+	struct dev_context *devc;
+
+	(void)cg;
+
+	devc = sdi->priv;
+	switch (key) {
+	case SR_CONF_SAMPLERATE:
+		devc->cur_samplerate = value;
+		break;
+	case SR_CONF_LIMIT_SAMPLES:
+		devc->limit_msec = 0;
+		devc->limit_samples = value;
+		break;
+	case SR_CONF_LIMIT_MSEC:
+		devc->limit_msec = value;
+		devc->limit_samples = 0;
+		break;
+	case SR_CONF_LIMIT_FRAMES:
+		devc->limit_frames = value;
+		break;
+	default:
+		return SR_ERR_NA;
+	}
+
+	return SR_OK;
+}
+
+static int config_get(uint32_t key, GVariant **data,
+	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
+{
+	struct dev_context *devc;
+	struct sr_channel *ch;
+	struct analog_gen *ag;
+	GVariant *mq_arr[2];
+	uint64_t value;
+	int pattern;
+
+	if (!sdi)
+		return SR_ERR_ARG;
+
+	if (config_get_u64(key, &value, sdi, cg) == SR_OK) {
+		*data = g_variant_new_uint64(value);
+		return SR_OK;
+	}
+
+	devc = sdi->priv;
+	switch (key) {
 	case SR_CONF_AVERAGING:
 		*data = g_variant_new_boolean(devc->avg);
 		break;
 	case SR_CONF_AVG_SAMPLES:
 		*data = g_variant_new_uint64(devc->avg_samples);
 		break;
+	case SR_CONF_BUFFERSIZE:
+		*data = g_variant_new_uint64(devc->logic_bufsize);
+		break;
+	case SR_CONF_TEST_MODE:
+		*data = g_variant_new_string(test_mode_str[devc->max_rate]);
+		break;
 	case SR_CONF_MEASURED_QUANTITY:
 		if (!cg)
 			return SR_ERR_CHANNEL_GROUP;
@@ -330,25 +407,17 @@ static int config_set(uint32_t key, GVariant *data,
 	struct sr_channel *ch;
 	GVariant *mq_tuple_child;
 	GSList *l;
-	int logic_pattern, analog_pattern;
+	int logic_pattern, analog_pattern, idx;
+	uint64_t bufsize;
+
+	if (g_variant_is_of_type(data, G_VARIANT_TYPE_UINT64) &&
+			config_set_u64(key, g_variant_get_uint64(data),
+				sdi, cg) == SR_OK)
+		return SR_OK;
 
 	devc = sdi->priv;
 
 	switch (key) {
-	case SR_CONF_SAMPLERATE:
-		devc->cur_samplerate = g_variant_get_uint64(data);
-		break;
-	case SR_CONF_LIMIT_SAMPLES:
-		devc->limit_msec = 0;
-		devc->limit_samples = g_variant_get_uint64(data);
-		break;
-	case SR_CONF_LIMIT_MSEC:
-		devc->limit_msec = g_variant_get_uint64(data);
-		devc->limit_samples = 0;
-		break;
-	case SR_CONF_LIMIT_FRAMES:
-		devc->limit_frames = g_variant_get_uint64(data);
-		break;
 	case SR_CONF_AVERAGING:
 		devc->avg = g_variant_get_boolean(data);
 		sr_dbg("%s averaging", devc->avg ? "Enabling" : "Disabling");
@@ -357,6 +426,21 @@ static int config_set(uint32_t key, GVariant *data,
 		devc->avg_samples = g_variant_get_uint64(data);
 		sr_dbg("Setting averaging rate to %" PRIu64, devc->avg_samples);
 		break;
+	case SR_CONF_BUFFERSIZE:
+		/* Chunk size in bytes, whole samples of all logic channels. */
+		bufsize = g_variant_get_uint64(data);
+		if (devc->logic_unitsize)
+			bufsize -= bufsize % devc->logic_unitsize;
+		if (!bufsize || bufsize > LOGIC_BUFSIZE_MAX)
+			return SR_ERR_ARG;
+		devc->logic_bufsize = bufsize;
+		devc->logic_data = g_realloc(devc->logic_data, bufsize);
+		break;
+	case SR_CONF_TEST_MODE:
+		if ((idx = std_str_idx(data, ARRAY_AND_SIZE(test_mode_str))) < 0)
+			return SR_ERR_ARG;
+		devc->max_rate = idx == 1;
+		break;
 	case SR_CONF_MEASURED_QUANTITY:
 		if (!cg)
 			return SR_ERR_CHANNEL_GROUP;
@@ -387,11 +471,6 @@ static int config_set(uint32_t key, GVariant *data,
 				sr_dbg("Setting logic pattern to %s",
 						logic_pattern_str[logic_pattern]);
 				devc->logic_pattern = logic_pattern;
-				/* Might as well do this now, these are static. */
-				if (logic_pattern == PATTERN_ALL_LOW)
-					memset(devc->logic_data, 0x00, LOGIC_BUFSIZE);
-				else if (logic_pattern == PATTERN_ALL_HIGH)
-					memset(devc->logic_data, 0xff, LOGIC_BUFSIZE);
 			} else if (ch->type == SR_CHANNEL_ANALOG) {
 				if (analog_pattern == -1)
 					return SR_ERR_ARG;
@@ -451,6 +530,9 @@ static int config_list(uint32_t key, GVariant **data,
 		case SR_CONF_TRIGGER_MATCH:
 			*data = std_gvar_array_i32(ARRAY_AND_SIZE(trigger_matches));
 			break;
+		case SR_CONF_TEST_MODE:
+			*data = g_variant_new_strv(ARRAY_AND_SIZE(test_mode_str));
+			break;
 		default:
 			return SR_ERR_NA;
 		}
@@ -489,6 +571,24 @@ static int config_list(uint32_t key, GVariant **data,
 	return SR_OK;
 }
 
+static gboolean trigger_on_analog(const struct sr_trigger *trigger)
+{
+	struct sr_trigger_stage *stage;
+	struct sr_trigger_match *match;
+	GSList *l, *m;
+
+	for (l = trigger->stages; l; l = l->next) {
+		stage = l->data;
+		for (m = stage->matches; m; m = m->next) {
+			match = m->data;
+			if (match->channel->type == SR_CHANNEL_ANALOG)
+				return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
 static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
@@ -501,15 +601,57 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	devc = sdi->priv;
 	devc->sent_samples = 0;
 	devc->sent_frame_samples = 0;
+	devc->segmented = FALSE;
 
 	/* Setup triggers */
-	if ((trigger = sr_session_trigger_get(sdi->session))) {
+	if ((trigger = sr_session_trigger_get(sdi->session))
+			&& trigger_on_analog(trigger)) {
+		int pre_trigger_samples = 0;
+		if (devc->avg) {
+			sr_err("Analog triggers do not work with averaging.");
+			return SR_ERR_NA;
+		}
+		if (devc->limit_samples > 0)
+			pre_trigger_samples = (devc->capture_ratio * devc->limit_samples) / 100;
+		devc->sta = soft_trigger_analog_new(sdi, trigger,
+			pre_trigger_samples, 0);
+		if (!devc->sta)
+			return SR_ERR_ARG;
+
+		/* The analog trigger only keeps pre-trigger analog data. */
+		for (l = sdi->channels; l; l = l->next) {
+			ch = l->data;
+			if (ch->type == SR_CHANNEL_LOGIC)
+				ch->enabled = FALSE;
+		}
+		sr_dev_channels_changed(sdi);
+	} else if (trigger) {
 		int pre_trigger_samples = 0;
 		if (devc->limit_samples > 0)
 			pre_trigger_samples = (devc->capture_ratio * devc->limit_samples) / 100;
-		devc->stl = soft_trigger_logic_new(sdi, trigger, pre_trigger_samples);
+		/*
+		 * With a frame limit, capture that many segments of
+		 * limit_samples samples around trigger matches.
+		 */
+		devc->segmented = devc->limit_frames > 0 && devc->limit_samples > 0;
+
+		/*
+		 * Samples of periodic patterns come from the pattern's tile,
+		 * which doesn't change during the acquisition. Pre-trigger
+		 * data can refer to it instead of getting copied.
+		 */
+		if (devc->segmented)
+			devc->stl = soft_trigger_logic_new(sdi, trigger,
+				pre_trigger_samples);
+		else
+			devc->stl = soft_trigger_logic_new_zerocopy(sdi, trigger,
+				pre_trigger_samples);
 		if (!devc->stl)
 			return SR_ERR_MALLOC;
+		if (devc->segmented)
+			soft_trigger_logic_segments_set(devc->stl,
+				devc->limit_samples - pre_trigger_samples,
+				devc->limit_frames);
 
 		/* Disable all analog channels since using them when there are logic
 		 * triggers set up would require having pre-trigger sample buffers
@@ -520,6 +662,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 			if (ch->type == SR_CHANNEL_ANALOG)
 				ch->enabled = FALSE;
 		}
+		sr_dev_channels_changed(sdi);
 	}
 	devc->trigger_fired = FALSE;
 
@@ -561,18 +704,19 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		devc->first_partial_logic_index,
 		devc->first_partial_logic_mask);
 
-	sr_session_source_add(sdi->session, -1, 0, 100,
+	sr_session_source_add(sdi->session, -1, 0, devc->max_rate ? 0 : 100,
 			demo_prepare_data, (struct sr_dev_inst *)sdi);
 
 	std_session_send_df_header(sdi);
 
-	if (devc->limit_frames > 0)
+	if (devc->limit_frames > 0 && !devc->segmented)
 		std_session_send_df_frame_begin(sdi);
 
 	/* We use this timestamp to decide how many more samples to send. */
 	devc->start_us = g_get_monotonic_time();
 	devc->spent_us = 0;
 	devc->step = 0;
+	demo_prepare_logic_pattern(devc);
 
 	return SR_OK;
 }
@@ -584,7 +728,7 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 	sr_session_source_remove(sdi->session, -1);
 
 	devc = sdi->priv;
-	if (devc->limit_frames > 0)
+	if (devc->segmented ? devc->stl->in_segment : devc->limit_frames > 0)
 		std_session_send_df_frame_end(sdi);
 
 	std_session_send_df_end(sdi);
@@ -593,6 +737,8 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 		soft_trigger_logic_free(devc->stl);
 		devc->stl = NULL;
 	}
+	soft_trigger_analog_free(devc->sta);
+	devc->sta = NULL;
 
 	return SR_OK;
 }
@@ -609,6 +755,8 @@ static struct sr_dev_driver demo_driver_info = {
 	.config_get = config_get,
 	.config_set = config_set,
 	.config_list = config_list,
+	.config_get_u64 = config_get_u64,
+	.config_set_u64 = config_set_u64,
 	.dev_open = std_dummy_dev_open,
 	.dev_close = std_dummy_dev_close,
 	.dev_acquisition_start = dev_acquisition_start,
@@ -274,9 +274,9 @@ static void set_logic_data(uint64_t bits, uint8_t *data, size_t len)
 	}
 }
 
-static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
+static void logic_generator(struct dev_context *devc, uint8_t *data,
+		uint64_t size)
 {
-	struct dev_context *devc;
 	uint64_t i, j;
 	uint8_t pat;
 	uint8_t *sample;
@@ -284,35 +284,33 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 	size_t col_count, col_height;
 	uint64_t gray;
 
-	devc = sdi->priv;
-
 	switch (devc->logic_pattern) {
 	case PATTERN_SIGROK:
-		memset(devc->logic_data, 0x00, size);
+		memset(data, 0x00, size);
 		for (i = 0; i < size; i += devc->logic_unitsize) {
 			for (j = 0; j < devc->logic_unitsize; j++) {
 				pat = pattern_sigrok[(devc->step + j) % sizeof(pattern_sigrok)] >> 1;
-				devc->logic_data[i + j] = ~pat;
+				data[i + j] = ~pat;
 			}
 			devc->step++;
 		}
 		break;
 	case PATTERN_RANDOM:
 		for (i = 0; i < size; i++)
-			devc->logic_data[i] = (uint8_t)(rand() & 0xff);
+			data[i] = (uint8_t)(rand() & 0xff);
 		break;
 	case PATTERN_INC:
-		for (i = 0; i < size; i++) {
+		for (i = 0; i < size; i += devc->logic_unitsize) {
 			for (j = 0; j < devc->logic_unitsize; j++)
-				devc->logic_data[i + j] = devc->step;
+				data[i + j] = devc->step;
 			devc->step++;
 		}
 		break;
 	case PATTERN_WALKING_ONE:
 		/* j contains the value of the highest bit */
-		j = 1 << (devc->num_logic_channels - 1);
+		j = UINT64_C(1) << (devc->num_logic_channels - 1);
 		for (i = 0; i < size; i++) {
-			devc->logic_data[i] = devc->step;
+			data[i] = devc->step;
 			if (devc->step == 0)
 				devc->step = 1;
 			else
@@ -325,9 +323,9 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 	case PATTERN_WALKING_ZERO:
 		/* Same as walking one, only with inverted output */
 		/* j contains the value of the highest bit */
-		j = 1 << (devc->num_logic_channels - 1);
+		j = UINT64_C(1) << (devc->num_logic_channels - 1);
 		for (i = 0; i < size; i++) {
-			devc->logic_data[i] = ~devc->step;
+			data[i] = ~devc->step;
 			if (devc->step == 0)
 				devc->step = 1;
 			else
@@ -338,15 +336,17 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 		}
 		break;
 	case PATTERN_ALL_LOW:
+		memset(data, 0x00, size);
+		break;
 	case PATTERN_ALL_HIGH:
-		/* These were set when the pattern mode was selected. */
+		memset(data, 0xff, size);
 		break;
 	case PATTERN_SQUID:
-		memset(devc->logic_data, 0x00, size);
+		memset(data, 0x00, size);
 		col_count = ARRAY_SIZE(pattern_squid);
 		col_height = ARRAY_SIZE(pattern_squid[0]);
 		for (i = 0; i < size; i += devc->logic_unitsize) {
-			sample = &devc->logic_data[i];
+			sample = &data[i];
 			image_col = pattern_squid[devc->step];
 			for (j = 0; j < devc->logic_unitsize; j++) {
 				pat = image_col[j % col_height];
@@ -362,7 +362,7 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 			devc->step &= devc->all_logic_channels_mask;
 			gray = encode_number_to_gray(devc->step);
 			gray &= devc->all_logic_channels_mask;
-			set_logic_data(gray, &devc->logic_data[i], devc->logic_unitsize);
+			set_logic_data(gray, &data[i], devc->logic_unitsize);
 		}
 		break;
 	default:
@@ -399,6 +399,126 @@ static void logic_fixup_feed(struct dev_context *devc,
 	}
 }
 
+/* The number of samples after which the pattern repeats, 0 for none. */
+static uint64_t logic_pattern_period(const struct dev_context *devc)
+{
+	uint64_t period;
+
+	switch (devc->logic_pattern) {
+	case PATTERN_SIGROK:
+		period = sizeof(pattern_sigrok);
+		break;
+	case PATTERN_INC:
+		period = 256;
+		break;
+	case PATTERN_ALL_LOW:
+	case PATTERN_ALL_HIGH:
+		period = 1;
+		break;
+	case PATTERN_SQUID:
+		period = ARRAY_SIZE(pattern_squid);
+		break;
+	case PATTERN_GRAYCODE:
+		period = devc->num_logic_channels < 32
+			? UINT64_C(1) << devc->num_logic_channels : 0;
+		break;
+	default:
+		period = 0;
+		break;
+	}
+	if (period * devc->logic_unitsize > LOGIC_TILE_MAX)
+		period = 0;
+
+	return period;
+}
+
+/* Precompute the tile of a periodic logic pattern, before acquisition. */
+SR_PRIV void demo_prepare_logic_pattern(struct dev_context *devc)
+{
+	struct sr_datafeed_logic logic;
+	uint64_t period, step;
+	size_t size, off, len;
+
+	g_free(devc->logic_tile);
+	devc->logic_tile = NULL;
+	devc->logic_tile_pos = 0;
+	devc->logic_tile_period = period = logic_pattern_period(devc);
+	if (!period || !devc->logic_unitsize)
+		return;
+
+	size = (period + devc->logic_bufsize / devc->logic_unitsize)
+		* devc->logic_unitsize;
+	devc->logic_tile = g_malloc(size);
+	step = devc->step;
+	devc->step = 0;
+	logic_generator(devc, devc->logic_tile, period * devc->logic_unitsize);
+	devc->step = step;
+	for (off = period * devc->logic_unitsize; off < size; off += len) {
+		len = MIN(off, size - off);
+		memcpy(devc->logic_tile + off, devc->logic_tile, len);
+	}
+
+	logic.data = devc->logic_tile;
+	logic.length = size;
+	logic.unitsize = devc->logic_unitsize;
+	logic_fixup_feed(devc, &logic);
+}
+
+/* Get the next samples to send, from the pattern's tile if it has one. */
+static uint8_t *logic_next(struct dev_context *devc, uint64_t samples)
+{
+	struct sr_datafeed_logic logic;
+	uint8_t *data;
+
+	if (devc->logic_tile) {
+		data = devc->logic_tile
+			+ devc->logic_tile_pos * devc->logic_unitsize;
+		devc->logic_tile_pos += samples;
+		devc->logic_tile_pos %= devc->logic_tile_period;
+		return data;
+	}
+
+	logic.data = devc->logic_data;
+	logic.length = samples * devc->logic_unitsize;
+	logic.unitsize = devc->logic_unitsize;
+	logic_generator(devc, logic.data, logic.length);
+	logic_fixup_feed(devc, &logic);
+
+	return logic.data;
+}
+
+/*
+ * Analog data only gets sent once the analog trigger fired. Pre-trigger
+ * data is kept for the packets of the channel which the trigger looks
+ * for an edge or level on.
+ */
+static void send_analog_triggered(struct dev_context *devc,
+		struct sr_dev_inst *sdi, struct sr_datafeed_packet *packet)
+{
+	struct sr_datafeed_analog *analog;
+	void *data;
+	int offset;
+
+	if (!devc->sta || devc->trigger_fired) {
+		sr_session_send(sdi, packet);
+		return;
+	}
+
+	analog = (struct sr_datafeed_analog *)packet->payload;
+	offset = soft_trigger_analog_check(devc->sta, analog, NULL);
+	if (offset < 0)
+		return;
+	devc->trigger_fired = TRUE;
+	sr_dbg("Analog trigger fired.");
+
+	data = analog->data;
+	analog->data = (float *)data + offset;
+	analog->num_samples -= offset;
+	if (analog->num_samples)
+		sr_session_send(sdi, packet);
+	analog->data = data;
+}
+
 static void send_analog_packet(struct analog_gen *ag,
 		struct sr_dev_inst *sdi, uint64_t *analog_sent,
 		uint64_t analog_pos, uint64_t analog_todo)
@@ -524,7 +644,7 @@ static void send_analog_packet(struct analog_gen *ag,
 			ag->packet.data = pattern->data + ag_pattern_pos;
 		}
 		ag->packet.num_samples = sending_now;
-		sr_session_send(sdi, &packet);
+		send_analog_triggered(devc, sdi, &packet);
 
 		/* Whichever channel group gets there first. */
 		*analog_sent = MAX(*analog_sent, sending_now);
@@ -584,6 +704,7 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 	void *value;
 	uint64_t samples_todo, logic_done, analog_done, analog_sent, sending_now;
 	int64_t elapsed_us, limit_us, todo_us;
+	uint8_t *logic_data;
 	int64_t trigger_offset;
 	int pre_trigger_samples;
 
@@ -602,18 +723,29 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 	}
 
 	/* What time span should we send samples for? */
-	elapsed_us = g_get_monotonic_time() - devc->start_us;
 	limit_us = 1000 * devc->limit_msec;
-	if (limit_us > 0 && limit_us < elapsed_us)
-		todo_us = MAX(0, limit_us - devc->spent_us);
-	else
-		todo_us = MAX(0, elapsed_us - devc->spent_us);
+	if (devc->max_rate) {
+		/* Free running, the time limit is in sample time. */
+		samples_todo = MAX_RATE_PACKETS * (devc->logic_unitsize
+			? devc->logic_bufsize / devc->logic_unitsize
+			: ANALOG_BUFSIZE);
+		todo_us = limit_us > 0 ? MAX(0, limit_us - devc->spent_us) : -1;
+	} else {
+		elapsed_us = g_get_monotonic_time() - devc->start_us;
+		if (limit_us > 0 && limit_us < elapsed_us)
+			todo_us = MAX(0, limit_us - devc->spent_us);
+		else
+			todo_us = MAX(0, elapsed_us - devc->spent_us);
+		samples_todo = UINT64_MAX;
+	}
 
 	/* How many samples are outstanding since the last round? */
-	samples_todo = (todo_us * devc->cur_samplerate + G_USEC_PER_SEC - 1)
-			/ G_USEC_PER_SEC;
+	if (todo_us >= 0)
+		samples_todo = MIN(samples_todo,
+			(todo_us * devc->cur_samplerate + G_USEC_PER_SEC - 1)
+			/ G_USEC_PER_SEC);
 
-	if (devc->limit_samples > 0) {
+	if (devc->limit_samples > 0 && !devc->segmented) {
 		if (devc->limit_samples < devc->sent_samples)
 			samples_todo = 0;
 		else if (devc->limit_samples - devc->sent_samples < samples_todo)
@@ -623,7 +755,7 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 	if (samples_todo == 0)
 		return G_SOURCE_CONTINUE;
 
-	if (devc->limit_frames) {
+	if (devc->limit_frames && !devc->segmented) {
 		/* Never send more samples than a frame can fit... */
 		samples_todo = MIN(samples_todo, SAMPLES_PER_FRAME);
 		/* ...or than we need to finish the current frame. */
@@ -649,12 +781,31 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 		/* Logic */
 		if (logic_done < samples_todo) {
 			sending_now = MIN(samples_todo - logic_done,
-					LOGIC_BUFSIZE / devc->logic_unitsize);
-			logic_generator(sdi, sending_now * devc->logic_unitsize);
+					devc->logic_bufsize / devc->logic_unitsize);
+			logic_data = logic_next(devc, sending_now);
+			if (devc->segmented) {
+				/* The soft trigger sends the segments. */
+				soft_trigger_logic_segmented_send(devc->stl,
+					logic_data, sending_now * devc->logic_unitsize);
+				logic_done += sending_now;
+				if (soft_trigger_logic_segments_done(devc->stl)) {
+					sr_dbg("Requested number of segments reached.");
+					sr_dev_acquisition_stop(sdi);
+					return G_SOURCE_CONTINUE;
+				}
+				continue;
+			}
 			/* Check for trigger and send pre-trigger data if needed */
 			if (devc->stl && (!devc->trigger_fired)) {
-				trigger_offset = soft_trigger_logic_check(devc->stl,
-						devc->logic_data, sending_now * devc->logic_unitsize,
+				if (devc->logic_tile)
+					/* The tile outlives the soft trigger. */
+					trigger_offset = soft_trigger_logic_check_lent(
+						devc->stl, logic_data,
+						sending_now * devc->logic_unitsize,
+						&pre_trigger_samples, NULL, NULL);
+				else
+					trigger_offset = soft_trigger_logic_check(devc->stl,
+						logic_data, sending_now * devc->logic_unitsize,
 						&pre_trigger_samples);
 				if (trigger_offset > -1) {
 					devc->trigger_fired = TRUE;
@@ -672,8 +823,7 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 				if (devc->trigger_fired && (trigger_offset < (int)sending_now)) {
 					/* Send after-trigger data */
 					logic.length = (sending_now - trigger_offset) * devc->logic_unitsize;
-					logic.data = devc->logic_data + trigger_offset * devc->logic_unitsize;
-					logic_fixup_feed(devc, &logic);
+					logic.data = logic_data + trigger_offset * devc->logic_unitsize;
 					sr_session_send(sdi, &packet);
 					logic_done += sending_now - trigger_offset;
 					/* End acquisition */
@@ -687,8 +837,7 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 			} else if (!devc->stl) {
 				/* No trigger defined, send logic samples */
 				logic.length = sending_now * devc->logic_unitsize;
-				logic.data = devc->logic_data;
-				logic_fixup_feed(devc, &logic);
+				logic.data = logic_data;
 				sr_session_send(sdi, &packet);
 				logic_done += sending_now;
 			}
@@ -713,7 +862,8 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 	devc->sent_frame_samples += min;
 	devc->spent_us += todo_us;
 
-	if (devc->limit_frames && devc->sent_frame_samples >= SAMPLES_PER_FRAME) {
+	if (devc->limit_frames && !devc->segmented
+			&& devc->sent_frame_samples >= SAMPLES_PER_FRAME) {
 		std_session_send_df_frame_end(sdi);
 		devc->sent_frame_samples = 0;
 		devc->limit_frames--;
@@ -723,7 +873,8 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 		}
 	}
 
-	if ((devc->limit_samples > 0 && devc->sent_samples >= devc->limit_samples)
+	if ((devc->limit_samples > 0 && !devc->segmented
+			&& devc->sent_samples >= devc->limit_samples)
 			|| (limit_us > 0 && devc->spent_us >= limit_us)) {
 
 		/* If we're averaging everything - now is the time to send data */
@@ -740,7 +891,7 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 		}
 		sr_dbg("Requested number of samples reached.");
 		sr_dev_acquisition_stop(sdi);
-	} else if (devc->limit_frames) {
+	} else if (devc->limit_frames && !devc->segmented) {
 		if (devc->sent_frame_samples == 0)
 			std_session_send_df_frame_begin(sdi);
 	}
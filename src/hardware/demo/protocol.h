@@ -30,8 +30,14 @@
 
 #define LOG_PREFIX "demo"
 
-/* The size in bytes of chunks to send through the session bus. */
+/* The default size in bytes of chunks to send through the session bus. */
 #define LOGIC_BUFSIZE			4096
+/* The largest configurable chunk size in bytes. */
+#define LOGIC_BUFSIZE_MAX		(16 * 1024 * 1024)
+/* The largest period in bytes of a logic pattern that gets precomputed. */
+#define LOGIC_TILE_MAX			(1024 * 1024)
+/* Chunks sent per round when free running at the maximum rate. */
+#define MAX_RATE_PACKETS		64
 /* Size of the analog pattern space per channel. */
 #define ANALOG_BUFSIZE			4096
 /* This is a development feature: it starts a new frame every n samples. */
@@ -127,7 +133,16 @@ struct dev_context {
 	uint64_t all_logic_channels_mask;
 	/* There is only ever one logic channel group, so its pattern goes here. */
 	enum logic_pattern_type logic_pattern;
-	uint8_t logic_data[LOGIC_BUFSIZE];
+	uint8_t *logic_data;
+	size_t logic_bufsize;
+	/*
+	 * Periodic patterns are precomputed, a period plus a chunk of
+	 * samples, so chunks can get sent straight from any position.
+	 */
+	uint8_t *logic_tile;
+	uint64_t logic_tile_period;
+	uint64_t logic_tile_pos;
+	gboolean max_rate; /* Send samples as fast as possible, unpaced. */
 	/* Analog */
 	struct analog_pattern *analog_patterns[ARRAY_SIZE(analog_pattern_str)];
 	int32_t num_analog_channels;
@@ -142,6 +157,8 @@ struct dev_context {
 	uint64_t capture_ratio;
 	gboolean trigger_fired;
 	struct soft_trigger_logic *stl;
+	struct soft_trigger_analog *sta;
+	gboolean segmented; /* Segments of limit_samples around triggers */
 };
 
 struct analog_gen {
@@ -162,6 +179,7 @@ struct analog_gen {
 
 SR_PRIV void demo_generate_analog_pattern(struct dev_context *devc);
 SR_PRIV void demo_free_analog_pattern(struct dev_context *devc);
+SR_PRIV void demo_prepare_logic_pattern(struct dev_context *devc);
 SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data);
 
 #endif
@@ -224,11 +224,12 @@ SR_PRIV int dslogic_fpga_firmware_upload(const struct sr_dev_inst *sdi)
 {
 	const char *name = NULL;
 	uint64_t sum;
-	struct sr_resource bitstream;
+	GBytes *bitstream;
 	struct drv_context *drvc;
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
-	unsigned char *buf;
+	const unsigned char *buf;
+	size_t size;
 	ssize_t chunksize;
 	int transferred;
 	int result, ret;
@@ -256,46 +257,48 @@ SR_PRIV int dslogic_fpga_firmware_upload(const struct sr_dev_inst *sdi)
 		return SR_ERR;
 	}
 
-	sr_dbg("Uploading FPGA firmware '%s'.", name);
+	bitstream = sr_resource_get(drvc->sr_ctx, SR_RESOURCE_FIRMWARE,
+			name, G_MAXSSIZE);
+	if (!bitstream)
+		return SR_ERR;
 
-	result = sr_resource_open(drvc->sr_ctx, &bitstream,
-			SR_RESOURCE_FIRMWARE, name);
-	if (result != SR_OK)
-		return result;
+	/* Skip the upload when the device runs the bitstream. */
+	if (sr_usb_fpga_bitstream_loaded(sdi, bitstream)) {
+		sr_dbg("FPGA firmware '%s' is loaded already.", name);
+		g_bytes_unref(bitstream);
+		return SR_OK;
+	}
+	sr_usb_fpga_bitstream_set(sdi, NULL);
+
+	sr_dbg("Uploading FPGA firmware '%s'.", name);
+	buf = g_bytes_get_data(bitstream, &size);
 
 	/* Tell the device firmware is coming. */
 	if ((ret = libusb_control_transfer(usb->devhdl, LIBUSB_REQUEST_TYPE_VENDOR |
 			LIBUSB_ENDPOINT_OUT, DS_CMD_CONFIG, 0x0000, 0x0000,
 			(unsigned char *)&cmd, sizeof(cmd), USB_TIMEOUT)) < 0) {
 		sr_err("Failed to upload FPGA firmware: %s.", libusb_error_name(ret));
-		sr_resource_close(drvc->sr_ctx, &bitstream);
+		g_bytes_unref(bitstream);
 		return SR_ERR;
 	}
 
 	/* Give the FX2 time to get ready for FPGA firmware upload. */
 	g_usleep(FPGA_UPLOAD_DELAY);
 
-	buf = g_malloc(FW_BUFSIZE);
 	sum = 0;
 	result = SR_OK;
-	while (1) {
-		chunksize = sr_resource_read(drvc->sr_ctx, &bitstream,
-				buf, FW_BUFSIZE);
-		if (chunksize < 0)
-			result = SR_ERR;
-		if (chunksize <= 0)
-			break;
-
+	while (sum < size) {
+		chunksize = MIN(size - sum, FW_BUFSIZE);
 		if ((ret = libusb_bulk_transfer(usb->devhdl, 2 | LIBUSB_ENDPOINT_OUT,
-				buf, chunksize, &transferred, USB_TIMEOUT)) < 0) {
+				(unsigned char *)buf + sum, chunksize,
+				&transferred, USB_TIMEOUT)) < 0) {
 			sr_err("Unable to configure FPGA firmware: %s.",
 					libusb_error_name(ret));
 			result = SR_ERR;
 			break;
 		}
 		sum += transferred;
-		sr_spew("Uploaded %" PRIu64 "/%" PRIu64 " bytes.",
-			sum, bitstream.size);
+		sr_spew("Uploaded %" PRIu64 "/%zu bytes.", sum, size);
 
 		if (transferred != chunksize) {
 			sr_err("Short transfer while uploading FPGA firmware.");
@@ -303,11 +306,11 @@ SR_PRIV int dslogic_fpga_firmware_upload(const struct sr_dev_inst *sdi)
 			break;
 		}
 	}
-	g_free(buf);
-	sr_resource_close(drvc->sr_ctx, &bitstream);
-
-	if (result == SR_OK)
+	if (result == SR_OK) {
+		sr_usb_fpga_bitstream_set(sdi, bitstream);
 		sr_dbg("FPGA firmware upload done.");
+	}
+	g_bytes_unref(bitstream);
 
 	return result;
 }
@@ -662,90 +665,27 @@ SR_PRIV struct dev_context *dslogic_dev_new(void)
 
 static void abort_acquisition(struct dev_context *devc)
 {
-	int i;
-
 	devc->acq_aborted = TRUE;
 
-	for (i = devc->num_transfers - 1; i >= 0; i--) {
-		if (devc->transfers[i])
-			libusb_cancel_transfer(devc->transfers[i]);
-	}
+	if (devc->trigger_transfer)
+		libusb_cancel_transfer(devc->trigger_transfer);
+	sr_usb_stream_cancel(&devc->stream);
 }
 
-static void finish_acquisition(struct sr_dev_inst *sdi)
+static void finish_acquisition(void *cb_data)
 {
+	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 
+	sdi = cb_data;
 	devc = sdi->priv;
 
 	std_session_send_df_end(sdi);
 
 	usb_source_remove(sdi->session, devc->ctx);
 
-	devc->num_transfers = 0;
-	g_free(devc->transfers);
 	g_free(devc->deinterleave_buffer);
-}
-
-static void free_transfer(struct libusb_transfer *transfer)
-{
-	struct sr_dev_inst *sdi;
-	struct dev_context *devc;
-	unsigned int i;
-
-	sdi = transfer->user_data;
-	devc = sdi->priv;
-
-	g_free(transfer->buffer);
-	transfer->buffer = NULL;
-	libusb_free_transfer(transfer);
-
-	for (i = 0; i < devc->num_transfers; i++) {
-		if (devc->transfers[i] == transfer) {
-			devc->transfers[i] = NULL;
-			break;
-		}
-	}
-
-	devc->submitted_transfers--;
-	if (devc->submitted_transfers == 0)
-		finish_acquisition(sdi);
-}
-
-static void resubmit_transfer(struct libusb_transfer *transfer)
-{
-	int ret;
-
-	if ((ret = libusb_submit_transfer(transfer)) == LIBUSB_SUCCESS)
-		return;
-
-	sr_err("%s: %s", __func__, libusb_error_name(ret));
-	free_transfer(transfer);
-
-}
-
-static void deinterleave_buffer(const uint8_t *src, size_t length,
-	uint16_t *dst_ptr, size_t channel_count, uint16_t channel_mask)
-{
-	uint16_t sample;
-
-	for (const uint64_t *src_ptr = (uint64_t*)src;
-		src_ptr < (uint64_t*)(src + length);
-		src_ptr += channel_count) {
-		for (int bit = 0; bit != 64; bit++) {
-			const uint64_t *word_ptr = src_ptr;
-			sample = 0;
-			for (unsigned int channel = 0; channel != 16;
-				channel++) {
-				const uint16_t m = channel_mask >> channel;
-				if (!m)
-					break;
-				if ((m & 1) && ((*word_ptr++ >> bit) & UINT64_C(1)))
-					sample |= 1 << channel;
-			}
-			*dst_ptr++ = sample;
-		}
-	}
+	devc->deinterleave_buffer = NULL;
 }
 
 static void send_data(struct sr_dev_inst *sdi,
@@ -765,12 +705,12 @@ static void send_data(struct sr_dev_inst *sdi,
 	sr_session_send(sdi, &packet);
 }
 
-static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
+static gboolean receive_transfer(struct libusb_transfer *transfer,
+	void *cb_data)
 {
-	struct sr_dev_inst *const sdi = transfer->user_data;
+	struct sr_dev_inst *const sdi = cb_data;
 	struct dev_context *const devc = sdi->priv;
 	const size_t channel_count = enabled_channel_count(sdi);
-	const uint16_t channel_mask = enabled_channel_mask(sdi);
 	const unsigned int cur_sample_count = DSLOGIC_ATOMIC_SAMPLES *
 		transfer->actual_length /
 		(DSLOGIC_ATOMIC_BYTES * channel_count);
@@ -779,25 +719,16 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 	unsigned int num_samples;
 	int trigger_offset;
 
-	/*
-	 * If acquisition has already ended, just free any queued up
-	 * transfer that come in.
-	 */
-	if (devc->acq_aborted) {
-		free_transfer(transfer);
-		return;
-	}
+	if (devc->acq_aborted)
+		return FALSE;
 
 	sr_dbg("receive_transfer(): status %s received %d bytes.",
 		libusb_error_name(transfer->status), transfer->actual_length);
 
-	/* Save incoming transfer before reusing the transfer struct. */
-
 	switch (transfer->status) {
 	case LIBUSB_TRANSFER_NO_DEVICE:
-		abort_acquisition(devc);
-		free_transfer(transfer);
-		return;
+		devc->acq_aborted = TRUE;
+		return FALSE;
 	case LIBUSB_TRANSFER_COMPLETED:
 	case LIBUSB_TRANSFER_TIMED_OUT: /* We may have received some data though. */
 		break;
@@ -813,12 +744,10 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 			 * The FX2 gave up. End the acquisition, the frontend
 			 * will work out that the samplecount is short.
 			 */
-			abort_acquisition(devc);
-			free_transfer(transfer);
-		} else {
-			resubmit_transfer(transfer);
+			devc->acq_aborted = TRUE;
+			return FALSE;
 		}
-		return;
+		return TRUE;
 	} else {
 		devc->empty_transfer_count = 0;
 	}
@@ -842,8 +771,8 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 		 */
 		if (transfer->actual_length % (DSLOGIC_ATOMIC_BYTES * channel_count) != 0)
 			sr_err("Invalid transfer length!");
-		deinterleave_buffer(transfer->buffer, transfer->actual_length,
-			devc->deinterleave_buffer, channel_count, channel_mask);
+		sr_transpose_blocks(&devc->transpose, transfer->buffer,
+			transfer->actual_length, devc->deinterleave_buffer);
 
 		/* Send the incoming transfer to the session bus. */
 		if (devc->trigger_pos > devc->sent_samples
@@ -868,10 +797,11 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 	}
 
 	if (devc->limit_samples && devc->sent_samples >= devc->limit_samples) {
-		abort_acquisition(devc);
-		free_transfer(transfer);
-	} else
-		resubmit_transfer(transfer);
+		devc->acq_aborted = TRUE;
+		return FALSE;
+	}
+
+	return TRUE;
 }
 
 static int receive_data(int fd, int revents, void *cb_data)
@@ -890,77 +820,43 @@ static int receive_data(int fd, int revents, void *cb_data)
 	return TRUE;
 }
 
-static size_t to_bytes_per_ms(const struct sr_dev_inst *sdi)
+static uint64_t to_bytes_per_second(const struct sr_dev_inst *sdi)
 {
 	const struct dev_context *const devc = sdi->priv;
 	const size_t ch_count = enabled_channel_count(sdi);
 
 	if (devc->continuous_mode)
-		return (devc->cur_samplerate * ch_count) / (1000 * 8);
+		return (devc->cur_samplerate * ch_count) / 8;
 
 
 	/* If we're in buffered mode, the transfer rate is not so important,
 	 * but we expect to get at least 10% of the high-speed USB bandwidth.
 	 */
-	return 35000000 / (1000 * 10);
-}
-
-static size_t get_buffer_size(const struct sr_dev_inst *sdi)
-{
-	/*
-	 * The buffer should be large enough to hold 10ms of data and
-	 * a multiple of the size of a data atom.
-	 */
-	const size_t block_size = enabled_channel_count(sdi) * 512;
-	const size_t s = 10 * to_bytes_per_ms(sdi);
-	if (!block_size)
-		return s;
-	return ((s + block_size - 1) / block_size) * block_size;
-}
-
-static unsigned int get_number_of_transfers(const struct sr_dev_inst *sdi)
-{
-	/* Total buffer size should be able to hold about 100ms of data. */
-	const unsigned int s = get_buffer_size(sdi);
-	const unsigned int n = (100 * to_bytes_per_ms(sdi) + s - 1) / s;
-	return (n > NUM_SIMUL_TRANSFERS) ? NUM_SIMUL_TRANSFERS : n;
-}
-
-static unsigned int get_timeout(const struct sr_dev_inst *sdi)
-{
-	const size_t total_size = get_buffer_size(sdi) *
-		get_number_of_transfers(sdi);
-	const unsigned int timeout = total_size / to_bytes_per_ms(sdi);
-	return timeout + timeout / 4; /* Leave a headroom of 25% percent. */
+	return 35000000 / 10;
 }
 
 static int start_transfers(const struct sr_dev_inst *sdi)
 {
 	const size_t channel_count = enabled_channel_count(sdi);
-	const size_t size = get_buffer_size(sdi);
-	const unsigned int num_transfers = get_number_of_transfers(sdi);
-	const unsigned int timeout = get_timeout(sdi);
 
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
-	struct libusb_transfer *transfer;
-	unsigned int i;
+	size_t size;
 	int ret;
-	unsigned char *buf;
 
 	devc = sdi->priv;
 	usb = sdi->conn;
+	size = devc->stream.size;
 
 	devc->sent_samples = 0;
 	devc->acq_aborted = FALSE;
 	devc->empty_transfer_count = 0;
-	devc->submitted_transfers = 0;
 
-	g_free(devc->transfers);
-	devc->transfers = g_try_malloc0(sizeof(*devc->transfers) * num_transfers);
-	if (!devc->transfers) {
-		sr_err("USB transfers malloc failed.");
-		return SR_ERR_MALLOC;
+	ret = sr_transpose_init(&devc->transpose, enabled_channel_mask(sdi),
+		DSLOGIC_ATOMIC_BYTES, FALSE);
+	if (ret != SR_OK) {
+		sr_err("Cannot setup sample data conversion.");
+		return ret;
 	}
 
 	devc->deinterleave_buffer = g_try_malloc(DSLOGIC_ATOMIC_SAMPLES *
@@ -971,27 +867,12 @@ static int start_transfers(const struct sr_dev_inst *sdi)
 		return SR_ERR_MALLOC;
 	}
 
-	devc->num_transfers = num_transfers;
-	for (i = 0; i < num_transfers; i++) {
-		if (!(buf = g_try_malloc(size))) {
-			sr_err("USB transfer buffer malloc failed.");
-			return SR_ERR_MALLOC;
-		}
-		transfer = libusb_alloc_transfer(0);
-		libusb_fill_bulk_transfer(transfer, usb->devhdl,
-				6 | LIBUSB_ENDPOINT_IN, buf, size,
-				receive_transfer, (void *)sdi, timeout);
-		sr_info("submitting transfer: %d", i);
-		if ((ret = libusb_submit_transfer(transfer)) != 0) {
-			sr_err("Failed to submit transfer: %s.",
-			       libusb_error_name(ret));
-			libusb_free_transfer(transfer);
-			g_free(buf);
-			abort_acquisition(devc);
-			return SR_ERR;
-		}
-		devc->transfers[i] = transfer;
-		devc->submitted_transfers++;
+	ret = sr_usb_stream_submit(&devc->stream, usb->devhdl,
+		6 | LIBUSB_ENDPOINT_IN, receive_transfer, finish_acquisition,
+		(void *)sdi);
+	if (ret != SR_OK) {
+		devc->acq_aborted = TRUE;
+		return ret;
 	}
 
 	std_session_send_df_header(sdi);
@@ -1007,29 +888,26 @@ static void LIBUSB_CALL trigger_receive(struct libusb_transfer *transfer)
 
 	sdi = transfer->user_data;
 	devc = sdi->priv;
+	devc->trigger_transfer = NULL;
+	tpos = (struct dslogic_trigger_pos *)transfer->buffer;
 	if (transfer->status == LIBUSB_TRANSFER_CANCELLED) {
 		sr_dbg("Trigger transfer canceled.");
 		/* Terminate session. */
 		std_session_send_df_end(sdi);
 		usb_source_remove(sdi->session, devc->ctx);
-		devc->num_transfers = 0;
-		g_free(devc->transfers);
 	} else if (transfer->status == LIBUSB_TRANSFER_COMPLETED
 			&& transfer->actual_length == sizeof(struct dslogic_trigger_pos)) {
-		tpos = (struct dslogic_trigger_pos *)transfer->buffer;
 		sr_info("tpos real_pos %d ram_saddr %d cnt_h %d cnt_l %d", tpos->real_pos,
 			tpos->ram_saddr, tpos->remain_cnt_h, tpos->remain_cnt_l);
 		devc->trigger_pos = tpos->real_pos;
-		g_free(tpos);
 		start_transfers(sdi);
 	}
+	g_free(tpos);
 	libusb_free_transfer(transfer);
 }
 
 SR_PRIV int dslogic_acquisition_start(const struct sr_dev_inst *sdi)
 {
-	const unsigned int timeout = get_timeout(sdi);
-
 	struct sr_dev_driver *di;
 	struct drv_context *drvc;
 	struct dev_context *devc;
@@ -1048,7 +926,14 @@ SR_PRIV int dslogic_acquisition_start(const struct sr_dev_inst *sdi)
 	devc->empty_transfer_count = 0;
 	devc->acq_aborted = FALSE;
 
-	usb_source_add(sdi->session, devc->ctx, timeout, receive_data, drvc);
+	/*
+	 * Queue about 100ms of data. Transfer sizes are a multiple of
+	 * the size of a data atom.
+	 */
+	sr_usb_stream_start(&devc->stream, to_bytes_per_second(sdi),
+		enabled_channel_count(sdi) * 512, 100, NUM_SIMUL_TRANSFERS);
+	usb_source_add(sdi->session, devc->ctx, devc->stream.timeout,
+		receive_data, drvc);
 
 	if ((ret = command_stop_acquisition(sdi)) != SR_OK)
 		return ret;
@@ -1071,15 +956,7 @@ SR_PRIV int dslogic_acquisition_start(const struct sr_dev_inst *sdi)
 		g_free(tpos);
 		return SR_ERR;
 	}
-
-	devc->transfers = g_try_malloc0(sizeof(*devc->transfers));
-	if (!devc->transfers) {
-		sr_err("USB trigger_pos transfer malloc failed.");
-		return SR_ERR_MALLOC;
-	}
-	devc->num_transfers = 1;
-	devc->submitted_transfers++;
-	devc->transfers[0] = transfer;
+	devc->trigger_transfer = transfer;
 
 	return ret;
 }
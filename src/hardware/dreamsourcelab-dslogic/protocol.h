@@ -125,14 +125,14 @@ struct dev_context {
 	gboolean acq_aborted;
 
 	unsigned int sent_samples;
-	int submitted_transfers;
 	int empty_transfer_count;
 
-	unsigned int num_transfers;
-	struct libusb_transfer **transfers;
+	struct libusb_transfer *trigger_transfer;
+	struct sr_usb_stream stream;
 	struct sr_context *ctx;
 
 	uint16_t *deinterleave_buffer;
+	struct sr_transpose transpose;
 
 	uint16_t mode;
 	uint32_t trigger_pos;
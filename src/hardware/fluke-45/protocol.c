@@ -218,6 +218,7 @@ SR_PRIV int fl45_scpi_receive_data(int fd, int revents, void *cb_data)
 	struct sr_analog_encoding encoding[2];
 	struct sr_analog_meaning meaning[2];
 	struct sr_analog_spec spec[2];
+	GSList ch_node[2];
 	struct sr_channel *channel;
 	char *reading;
 	float fv;
@@ -295,14 +296,13 @@ SR_PRIV int fl45_scpi_receive_data(int fd, int revents, void *cb_data)
 			/* Set up analog object. */
 			analog[i].num_samples = 1;
 			analog[i].data = &fv;
-			analog[i].meaning->channels = g_slist_append(NULL, channel);
+			sr_analog_meaning_channel_set(analog[i].meaning,
+				&ch_node[i], channel);
 
 			packet.type = SR_DF_ANALOG;
 			packet.payload = &analog[i];
 
 			sr_session_send(sdi, &packet);
-
-			g_slist_free(analog[i].meaning->channels);
 		}
 	}
 
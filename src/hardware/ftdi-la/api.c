@@ -140,9 +140,6 @@ static void scan_device(struct ftdi_context *ftdic,
 
 	devc = g_malloc0(sizeof(struct dev_context));
 
-	/* Allocate memory for the incoming data. */
-	devc->data_buf = g_malloc0(DATA_BUF_SIZE);
-
 	devc->desc = desc;
 
 	vendor = g_malloc(usb_str_maxlen);
@@ -212,7 +209,6 @@ err_free_strings:
 	g_free(vendor);
 	g_free(model);
 	g_free(serial_num);
-	g_free(devc->data_buf);
 	g_free(devc);
 }
 
@@ -275,7 +271,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 	if (conn) {
 		devices = NULL;
-		libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+		sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 		for (i = 0; devlist[i]; i++) {
 			conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
 			for (l = conn_devices; l; l = l->next) {
@@ -286,7 +282,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 				}
 			}
 		}
-		libusb_free_device_list(devlist, 1);
+		sr_usb_free_device_list(devlist);
 	} else
 		devices = scan_all(ftdic, options);
 
@@ -295,16 +291,6 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	return std_scan_complete(di, devices);
 }
 
-static void clear_helper(struct dev_context *devc)
-{
-	g_free(devc->data_buf);
-}
-
-static int dev_clear(const struct sr_dev_driver *di)
-{
-	return std_dev_clear_with_callback(di, (std_dev_clear_callback)clear_helper);
-}
-
 static int dev_open(struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
@@ -366,6 +352,7 @@ static int dev_close(struct sr_dev_inst *sdi)
 	if (!devc->ftdic)
 		return SR_ERR_BUG;
 
+	sr_usb_stream_free(&devc->stream);
 	ftdi_usb_close(devc->ftdic);
 	ftdi_free(devc->ftdic);
 	devc->ftdic = NULL;
@@ -452,6 +439,7 @@ static int config_list(uint32_t key, GVariant **data,
 static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
+	int ret;
 
 	devc = sdi->priv;
 
@@ -462,12 +450,16 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 	/* Properly reset internal variables before every new acquisition. */
 	devc->samples_sent = 0;
-	devc->bytes_received = 0;
 
 	std_session_send_df_header(sdi);
 
-	/* Hook up a dummy handler to receive data from the device. */
-	sr_session_source_add(sdi->session, -1, G_IO_IN, 0,
+	if ((ret = ftdi_la_stream_start(sdi)) != SR_OK) {
+		std_session_send_df_end(sdi);
+		return ret;
+	}
+
+	/* Handle the events of libftdi's USB context. */
+	sr_session_source_add(sdi->session, -1, 0, 10,
 			      ftdi_la_receive_data, (void *)sdi);
 
 	return SR_OK;
@@ -475,6 +467,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 {
+	ftdi_la_stream_stop(sdi);
 	sr_session_source_remove(sdi->session, -1);
 
 	std_session_send_df_end(sdi);
@@ -490,7 +483,7 @@ static struct sr_dev_driver ftdi_la_driver_info = {
 	.cleanup = std_cleanup,
 	.scan = scan,
 	.dev_list = std_dev_list,
-	.dev_clear = dev_clear,
+	.dev_clear = std_dev_clear,
 	.config_get = config_get,
 	.config_set = config_set,
 	.config_list = config_list,
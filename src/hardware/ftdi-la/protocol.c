@@ -21,7 +21,8 @@
 #include <ftdi.h>
 #include "protocol.h"
 
-static void send_samples(struct sr_dev_inst *sdi, uint64_t samples_to_send)
+static void send_samples(const struct sr_dev_inst *sdi, uint8_t *data,
+	uint64_t samples_to_send)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
@@ -35,11 +36,10 @@ static void send_samples(struct sr_dev_inst *sdi, uint64_t samples_to_send)
 	packet.payload = &logic;
 	logic.length = samples_to_send;
 	logic.unitsize = 1;
-	logic.data = devc->data_buf;
+	logic.data = data;
 	sr_session_send(sdi, &packet);
 
 	devc->samples_sent += samples_to_send;
-	devc->bytes_received -= samples_to_send;
 }
 
 SR_PRIV int ftdi_la_set_samplerate(struct dev_context *devc)
@@ -56,12 +56,79 @@ SR_PRIV int ftdi_la_set_samplerate(struct dev_context *devc)
 	return SR_OK;
 }
 
+static gboolean stream_receive(struct libusb_transfer *transfer,
+	void *cb_data)
+{
+	const struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	uint64_t n;
+
+	sdi = cb_data;
+	devc = sdi->priv;
+
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED &&
+			transfer->status != LIBUSB_TRANSFER_TIMED_OUT) {
+		sr_err("Failed to read FTDI data: %s.",
+		       libusb_error_name(transfer->status));
+		return FALSE;
+	}
+
+	n = sr_usb_ftdi_payload(transfer->buffer, transfer->actual_length,
+		devc->ftdic->max_packet_size);
+	if (!n)
+		return TRUE;
+
+	if (devc->limit_samples)
+		n = MIN(n, devc->limit_samples - devc->samples_sent);
+	send_samples(sdi, transfer->buffer, n);
+
+	if (devc->limit_samples && devc->samples_sent >= devc->limit_samples) {
+		sr_info("Requested number of samples reached.");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/*
+ * Read the samples with a queue of USB transfers, rather than with
+ * blocking reads of libftdi, which leave the chip's buffer to overflow
+ * while the host is busy.
+ */
+SR_PRIV int ftdi_la_stream_start(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	uint64_t rate;
+	size_t packet_size;
+
+	devc = sdi->priv;
+
+	/* One byte per sample, plus the status bytes of each packet. */
+	packet_size = devc->ftdic->max_packet_size;
+	rate = devc->cur_samplerate;
+	if (packet_size > 2)
+		rate = rate * packet_size / (packet_size - 2);
+
+	sr_usb_stream_start(&devc->stream, rate, packet_size,
+		STREAM_QUEUE_MS, STREAM_MAX_DEPTH);
+
+	return sr_usb_stream_submit(&devc->stream, devc->ftdic->usb_dev,
+		devc->ftdic->out_ep, stream_receive, NULL, (void *)sdi);
+}
+
+SR_PRIV void ftdi_la_stream_stop(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+	sr_usb_stream_drain(&devc->stream, devc->ftdic->usb_ctx, 1000);
+}
+
 SR_PRIV int ftdi_la_receive_data(int fd, int revents, void *cb_data)
 {
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
-	int bytes_read;
-	uint64_t n;
+	struct timeval tv;
 
 	(void)fd;
 	(void)revents;
@@ -70,36 +137,16 @@ SR_PRIV int ftdi_la_receive_data(int fd, int revents, void *cb_data)
 		return TRUE;
 	if (!(devc = sdi->priv))
 		return TRUE;
-	if (!(revents == G_IO_IN || revents == 0))
-		return TRUE;
 	if (!devc->ftdic)
 		return TRUE;
 
-	/* Get a block of data. */
-	bytes_read = ftdi_read_data(devc->ftdic, devc->data_buf, DATA_BUF_SIZE);
-	if (bytes_read < 0) {
-		sr_err("Failed to read FTDI data (%d): %s.",
-		       bytes_read, ftdi_get_error_string(devc->ftdic));
-		sr_dev_acquisition_stop(sdi);
-		return FALSE;
-	}
-	if (bytes_read == 0) {
-		sr_spew("Received 0 bytes, nothing to do.");
-		return TRUE;
-	}
-	sr_spew("Got some data.");
-	devc->bytes_received += bytes_read;
-
-	n = devc->samples_sent + devc->bytes_received;
+	/* libftdi has a libusb context of its own, no source handles it. */
+	tv.tv_sec = tv.tv_usec = 0;
+	libusb_handle_events_timeout_completed(devc->ftdic->usb_ctx, &tv, NULL);
 
-	if (devc->limit_samples && (n >= devc->limit_samples)) {
-		send_samples(sdi, devc->limit_samples - devc->samples_sent);
-		sr_info("Requested number of samples reached.");
+	/* All transfers have returned after the end of reception. */
+	if (!devc->stream.submitted)
 		sr_dev_acquisition_stop(sdi);
-		return TRUE;
-	} else {
-		send_samples(sdi, devc->bytes_received);
-	}
 
 	return TRUE;
 }
@@ -27,7 +27,9 @@
 
 #define LOG_PREFIX "ftdi-la"
 
-#define DATA_BUF_SIZE (16 * 1024)
+/* Smallest amount of data to keep queued, and most transfers in flight. */
+#define STREAM_QUEUE_MS 100
+#define STREAM_MAX_DEPTH 32
 
 struct ftdi_chip_desc {
 	uint16_t vendor;
@@ -43,12 +45,13 @@ struct dev_context {
 	uint64_t limit_samples;
 	uint32_t cur_samplerate;
 
-	unsigned char *data_buf;
+	struct sr_usb_stream stream;
 	uint64_t samples_sent;
-	uint64_t bytes_received;
 };
 
 SR_PRIV int ftdi_la_set_samplerate(struct dev_context *devc);
+SR_PRIV int ftdi_la_stream_start(const struct sr_dev_inst *sdi);
+SR_PRIV void ftdi_la_stream_stop(const struct sr_dev_inst *sdi);
 SR_PRIV int ftdi_la_receive_data(int fd, int revents, void *cb_data);
 
 #endif
@@ -132,6 +132,10 @@ static const uint32_t devopts[] = {
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 	SR_CONF_TRIGGER_MATCH | SR_CONF_LIST,
 	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_TRANSFER_SIZE | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_QUEUE_DEPTH | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_UNDERRUNS | SR_CONF_GET,
+	SR_CONF_USB_OVERRUNS | SR_CONF_GET,
 };
 
 static const int32_t trigger_matches[] = {
@@ -230,7 +234,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 	/* Find all fx2lafw compatible devices and upload firmware to them. */
 	devices = NULL;
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
@@ -396,7 +400,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 					0xff, NULL);
 		}
 	}
-	libusb_free_device_list(devlist, 1);
+	sr_usb_free_device_list(devlist);
 	g_slist_free_full(conn_devices, (GDestroyNotify)sr_usb_dev_inst_free);
 
 	return std_scan_complete(di, devices);
@@ -412,13 +416,17 @@ static int dev_clear(const struct sr_dev_driver *di)
 	return std_dev_clear_with_callback(di, (std_dev_clear_callback)clear_helper);
 }
 
+static int dev_open_renumerated(struct sr_dev_inst *sdi)
+{
+	return fx2lafw_dev_open(sdi, sdi->driver);
+}
+
 static int dev_open(struct sr_dev_inst *sdi)
 {
 	struct sr_dev_driver *di = sdi->driver;
 	struct sr_usb_dev_inst *usb;
 	struct dev_context *devc;
 	int ret;
-	int64_t timediff_us, timediff_ms;
 
 	devc = sdi->priv;
 	usb = sdi->conn;
@@ -427,26 +435,9 @@ static int dev_open(struct sr_dev_inst *sdi)
 	 * If the firmware was recently uploaded, wait up to MAX_RENUM_DELAY_MS
 	 * milliseconds for the FX2 to renumerate.
 	 */
-	ret = SR_ERR;
 	if (devc->fw_updated > 0) {
-		sr_info("Waiting for device to reset.");
-		/* Takes >= 300ms for the FX2 to be gone from the USB bus. */
-		g_usleep(300 * 1000);
-		timediff_ms = 0;
-		while (timediff_ms < MAX_RENUM_DELAY_MS) {
-			if ((ret = fx2lafw_dev_open(sdi, di)) == SR_OK)
-				break;
-			g_usleep(100 * 1000);
-
-			timediff_us = g_get_monotonic_time() - devc->fw_updated;
-			timediff_ms = timediff_us / 1000;
-			sr_spew("Waited %" PRIi64 "ms.", timediff_ms);
-		}
-		if (ret != SR_OK) {
-			sr_err("Device failed to renumerate.");
-			return SR_ERR;
-		}
-		sr_info("Device came back after %" PRIi64 "ms.", timediff_ms);
+		ret = ezusb_wait_renumeration(sdi, devc->fw_updated,
+			MAX_RENUM_DELAY_MS, dev_open_renumerated);
 	} else {
 		sr_info("Firmware upload was not needed.");
 		ret = fx2lafw_dev_open(sdi, di);
@@ -487,14 +478,17 @@ static int dev_open(struct sr_dev_inst *sdi)
 static int dev_close(struct sr_dev_inst *sdi)
 {
 	struct sr_usb_dev_inst *usb;
+	struct dev_context *devc;
 
 	usb = sdi->conn;
+	devc = sdi->priv;
 
 	if (!usb->devhdl)
 		return SR_ERR_BUG;
 
 	sr_info("Closing device on %d.%d (logical) / %s (physical) interface %d.",
 		usb->bus, usb->address, sdi->connection_id, USB_INTERFACE);
+	sr_usb_stream_free(&devc->stream);
 	libusb_release_interface(usb->devhdl, USB_INTERFACE);
 	libusb_close(usb->devhdl);
 	usb->devhdl = NULL;
@@ -538,6 +532,18 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_CAPTURE_RATIO:
 		*data = g_variant_new_uint64(devc->capture_ratio);
 		break;
+	case SR_CONF_USB_TRANSFER_SIZE:
+		*data = g_variant_new_uint64(devc->stream.transfer_size);
+		break;
+	case SR_CONF_USB_QUEUE_DEPTH:
+		*data = g_variant_new_uint64(devc->stream.queue_depth);
+		break;
+	case SR_CONF_USB_UNDERRUNS:
+		*data = g_variant_new_uint64(devc->stream.underruns);
+		break;
+	case SR_CONF_USB_OVERRUNS:
+		*data = g_variant_new_uint64(devc->stream.overruns);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -573,6 +579,14 @@ static int config_set(uint32_t key, GVariant *data,
 	case SR_CONF_CAPTURE_RATIO:
 		devc->capture_ratio = g_variant_get_uint64(data);
 		break;
+	case SR_CONF_USB_TRANSFER_SIZE:
+		devc->stream.transfer_size = g_variant_get_uint64(data);
+		break;
+	case SR_CONF_USB_QUEUE_DEPTH:
+		if (g_variant_get_uint64(data) > NUM_SIMUL_TRANSFERS)
+			return SR_ERR_ARG;
+		devc->stream.queue_depth = g_variant_get_uint64(data);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -270,33 +270,38 @@ SR_PRIV struct dev_context *fx2lafw_dev_new(void)
 
 SR_PRIV void fx2lafw_abort_acquisition(struct dev_context *devc)
 {
-	int i;
-
 	devc->acq_aborted = TRUE;
+	sr_usb_stream_cancel(&devc->stream);
+}
 
-	for (i = devc->num_transfers - 1; i >= 0; i--) {
-		if (devc->transfers[i])
-			libusb_cancel_transfer(devc->transfers[i]);
-	}
+/* Send the logic packets which were collected from held transfers. */
+static void batch_flush(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+	if (!devc->batch_count)
+		return;
+	sr_session_send_batch(sdi, devc->batch, devc->batch_count);
+	devc->batch_count = 0;
 }
 
-static void finish_acquisition(struct sr_dev_inst *sdi)
+static void finish_acquisition(void *cb_data)
 {
+	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 
+	sdi = cb_data;
 	devc = sdi->priv;
 
 	std_session_send_df_end(sdi);
 
 	usb_source_remove(sdi->session, devc->ctx);
 
-	devc->num_transfers = 0;
-	g_free(devc->transfers);
-
-	/* Free the deinterlace buffers if we had them. */
+	/* Free the deinterlace buffer if we had it. */
 	if (g_slist_length(devc->enabled_analog_channels) > 0) {
 		g_free(devc->logic_buffer);
-		g_free(devc->analog_buffer);
+		devc->logic_buffer = NULL;
 	}
 
 	if (devc->stl) {
@@ -305,47 +310,9 @@ static void finish_acquisition(struct sr_dev_inst *sdi)
 	}
 }
 
-static void free_transfer(struct libusb_transfer *transfer)
-{
-	struct sr_dev_inst *sdi;
-	struct dev_context *devc;
-	unsigned int i;
-
-	sdi = transfer->user_data;
-	devc = sdi->priv;
-
-	g_free(transfer->buffer);
-	transfer->buffer = NULL;
-	libusb_free_transfer(transfer);
-
-	for (i = 0; i < devc->num_transfers; i++) {
-		if (devc->transfers[i] == transfer) {
-			devc->transfers[i] = NULL;
-			break;
-		}
-	}
-
-	devc->submitted_transfers--;
-	if (devc->submitted_transfers == 0)
-		finish_acquisition(sdi);
-}
-
-static void resubmit_transfer(struct libusb_transfer *transfer)
-{
-	int ret;
-
-	if ((ret = libusb_submit_transfer(transfer)) == LIBUSB_SUCCESS)
-		return;
-
-	sr_err("%s: %s", __func__, libusb_error_name(ret));
-	free_transfer(transfer);
-
-}
-
 static void mso_send_data_proc(struct sr_dev_inst *sdi,
 	uint8_t *data, size_t length, size_t sample_width)
 {
-	size_t i;
 	struct dev_context *devc;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
@@ -358,12 +325,8 @@ static void mso_send_data_proc(struct sr_dev_inst *sdi,
 
 	length /= 2;
 
-	/* Send the logic */
-	for (i = 0; i < length; i++) {
-		devc->logic_buffer[i] = data[i * 2];
-		/* Rescale to -10V - +10V from 0-255. */
-		devc->analog_buffer[i] = (data[i * 2 + 1] - 128.0f) / 12.8f;
-	};
+	/* Send the logic, the even bytes of the logic/analog pairs. */
+	sr_logic_bytes_extract(data, 2, length, devc->logic_buffer);
 
 	const struct sr_datafeed_logic logic = {
 		.length = length,
@@ -378,13 +341,24 @@ static void mso_send_data_proc(struct sr_dev_inst *sdi,
 
 	sr_session_send(sdi, &logic_packet);
 
+	/*
+	 * The analog values are the odd bytes, sent in place. Rescale
+	 * to -10V - +10V from 0-255, i.e. (raw - 128) / 12.8.
+	 */
 	sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
 	analog.meaning->channels = devc->enabled_analog_channels;
 	analog.meaning->mq = SR_MQ_VOLTAGE;
 	analog.meaning->unit = SR_UNIT_VOLT;
 	analog.meaning->mqflags = 0 /* SR_MQFLAG_DC */;
+	analog.encoding->unitsize = sizeof(uint8_t);
+	analog.encoding->is_signed = FALSE;
+	analog.encoding->is_float = FALSE;
+	analog.encoding->is_bigendian = FALSE;
+	analog.encoding->stride = 2;
+	sr_rational_set(&analog.encoding->scale, 5, 64);
+	sr_rational_set(&analog.encoding->offset, -10, 1);
 	analog.num_samples = length;
-	analog.data = devc->analog_buffer;
+	analog.data = data + 1;
 
 	const struct sr_datafeed_packet analog_packet = {
 		.type = SR_DF_ANALOG,
@@ -394,24 +368,32 @@ static void mso_send_data_proc(struct sr_dev_inst *sdi,
 	sr_session_send(sdi, &analog_packet);
 }
 
+/*
+ * The stream holds the completed transfers until receive_data() is done
+ * with them, so their data can be sent in one batch. Transfers which
+ * complete in the same round of event handling get coalesced.
+ */
 static void la_send_data_proc(struct sr_dev_inst *sdi,
 	uint8_t *data, size_t length, size_t sample_width)
 {
-	const struct sr_datafeed_logic logic = {
-		.length = length,
-		.unitsize = sample_width,
-		.data = data
-	};
-
-	const struct sr_datafeed_packet packet = {
-		.type = SR_DF_LOGIC,
-		.payload = &logic
-	};
+	struct dev_context *devc;
+	struct sr_datafeed_logic *logic;
 
-	sr_session_send(sdi, &packet);
+	devc = sdi->priv;
+	if (devc->batch_count == ARRAY_SIZE(devc->batch))
+		batch_flush(sdi);
+
+	logic = &devc->batch_logic[devc->batch_count];
+	logic->length = length;
+	logic->unitsize = sample_width;
+	logic->data = data;
+	devc->batch[devc->batch_count].type = SR_DF_LOGIC;
+	devc->batch[devc->batch_count].payload = logic;
+	devc->batch_count++;
 }
 
-static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
+static gboolean receive_transfer_data(struct libusb_transfer *transfer,
+	void *cb_data)
 {
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
@@ -420,17 +402,11 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 	int trigger_offset, cur_sample_count, unitsize, processed_samples;
 	int pre_trigger_samples;
 
-	sdi = transfer->user_data;
+	sdi = cb_data;
 	devc = sdi->priv;
 
-	/*
-	 * If acquisition has already ended, just free any queued up
-	 * transfer that come in.
-	 */
-	if (devc->acq_aborted) {
-		free_transfer(transfer);
-		return;
-	}
+	if (devc->acq_aborted)
+		return FALSE;
 
 	sr_dbg("receive_transfer(): status %s received %d bytes.",
 		libusb_error_name(transfer->status), transfer->actual_length);
@@ -442,9 +418,8 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 
 	switch (transfer->status) {
 	case LIBUSB_TRANSFER_NO_DEVICE:
-		fx2lafw_abort_acquisition(devc);
-		free_transfer(transfer);
-		return;
+		devc->acq_aborted = TRUE;
+		return FALSE;
 	case LIBUSB_TRANSFER_COMPLETED:
 	case LIBUSB_TRANSFER_TIMED_OUT: /* We may have received some data though. */
 		break;
@@ -460,12 +435,10 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 			 * The FX2 gave up. End the acquisition, the frontend
 			 * will work out that the samplecount is short.
 			 */
-			fx2lafw_abort_acquisition(devc);
-			free_transfer(transfer);
-		} else {
-			resubmit_transfer(transfer);
+			devc->acq_aborted = TRUE;
+			return FALSE;
 		}
-		return;
+		return TRUE;
 	} else {
 		devc->empty_transfer_count = 0;
 	}
@@ -484,11 +457,13 @@ check_trigger:
 			processed_samples += num_samples;
 		}
 	} else {
+		batch_flush(sdi);
 		trigger_offset = soft_trigger_logic_check(devc->stl,
 			transfer->buffer + processed_samples * unitsize,
 			transfer->actual_length - processed_samples * unitsize,
 			&pre_trigger_samples);
 		if (trigger_offset > -1) {
+			batch_flush(sdi);
 			std_session_send_df_frame_begin(sdi);
 			devc->sent_samples += pre_trigger_samples;
 			num_samples = cur_sample_count - processed_samples - trigger_offset;
@@ -514,6 +489,7 @@ check_trigger:
 		devc->num_frames++;
 		devc->sent_samples = 0;
 		devc->trigger_fired = FALSE;
+		batch_flush(sdi);
 		std_session_send_df_frame_end(sdi);
 
 		/* There may be another trigger in the remaining data, go back and check for it */
@@ -530,10 +506,24 @@ check_trigger:
 		}
 	}
 	if (frame_ended && final_frame) {
-		fx2lafw_abort_acquisition(devc);
-		free_transfer(transfer);
-	} else
-		resubmit_transfer(transfer);
+		devc->acq_aborted = TRUE;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean receive_transfer(struct libusb_transfer *transfer,
+	void *cb_data)
+{
+	gboolean keep;
+
+	/* The stream releases the transfer, send its data before. */
+	keep = receive_transfer_data(transfer, cb_data);
+	if (!keep)
+		batch_flush(cb_data);
+
+	return keep;
 }
 
 static int configure_channels(const struct sr_dev_inst *sdi)
@@ -570,52 +560,13 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
-static unsigned int to_bytes_per_ms(unsigned int samplerate)
-{
-	return samplerate / 1000;
-}
-
-static size_t get_buffer_size(struct dev_context *devc)
-{
-	size_t s;
-
-	/*
-	 * The buffer should be large enough to hold 10ms of data and
-	 * a multiple of 512.
-	 */
-	s = 10 * to_bytes_per_ms(devc->cur_samplerate);
-	return (s + 511) & ~511;
-}
-
-static unsigned int get_number_of_transfers(struct dev_context *devc)
-{
-	unsigned int n;
-
-	/* Total buffer size should be able to hold about 500ms of data. */
-	n = (500 * to_bytes_per_ms(devc->cur_samplerate) /
-		get_buffer_size(devc));
-
-	if (n > NUM_SIMUL_TRANSFERS)
-		return NUM_SIMUL_TRANSFERS;
-
-	return n;
-}
-
-static unsigned int get_timeout(struct dev_context *devc)
-{
-	size_t total_size;
-	unsigned int timeout;
-
-	total_size = get_buffer_size(devc) *
-			get_number_of_transfers(devc);
-	timeout = total_size / to_bytes_per_ms(devc->cur_samplerate);
-	return timeout + timeout / 4; /* Leave a headroom of 25% percent. */
-}
-
 static int receive_data(int fd, int revents, void *cb_data)
 {
 	struct timeval tv;
 	struct drv_context *drvc;
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	GSList *l;
 
 	(void)fd;
 	(void)revents;
@@ -625,6 +576,14 @@ static int receive_data(int fd, int revents, void *cb_data)
 	tv.tv_sec = tv.tv_usec = 0;
 	libusb_handle_events_timeout(drvc->sr_ctx->libusb_ctx, &tv);
 
+	/* Send the data of the held transfers, and resubmit them. */
+	for (l = drvc->instances; l; l = l->next) {
+		sdi = l->data;
+		devc = sdi->priv;
+		batch_flush(sdi);
+		sr_usb_stream_resubmit(&devc->stream);
+	}
+
 	return TRUE;
 }
 
@@ -633,11 +592,7 @@ static int start_transfers(const struct sr_dev_inst *sdi)
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
 	struct sr_trigger *trigger;
-	struct libusb_transfer *transfer;
-	unsigned int i, num_transfers;
-	int timeout, ret;
-	unsigned char *buf;
-	size_t size;
+	int ret;
 
 	devc = sdi->priv;
 	usb = sdi->conn;
@@ -659,39 +614,16 @@ static int start_transfers(const struct sr_dev_inst *sdi)
 		devc->trigger_fired = TRUE;
 	}
 
-	num_transfers = get_number_of_transfers(devc);
+	/* Logic only data gets sent in batches, see la_send_data_proc(). */
+	devc->batch_count = 0;
+	devc->stream.hold = g_slist_length(devc->enabled_analog_channels) == 0;
 
-	size = get_buffer_size(devc);
-	devc->submitted_transfers = 0;
-
-	devc->transfers = g_try_malloc0(sizeof(*devc->transfers) * num_transfers);
-	if (!devc->transfers) {
-		sr_err("USB transfers malloc failed.");
-		return SR_ERR_MALLOC;
-	}
-
-	timeout = get_timeout(devc);
-	devc->num_transfers = num_transfers;
-	for (i = 0; i < num_transfers; i++) {
-		if (!(buf = g_try_malloc(size))) {
-			sr_err("USB transfer buffer malloc failed.");
-			return SR_ERR_MALLOC;
-		}
-		transfer = libusb_alloc_transfer(0);
-		libusb_fill_bulk_transfer(transfer, usb->devhdl,
-				2 | LIBUSB_ENDPOINT_IN, buf, size,
-				receive_transfer, (void *)sdi, timeout);
-		sr_info("submitting transfer: %d", i);
-		if ((ret = libusb_submit_transfer(transfer)) != 0) {
-			sr_err("Failed to submit transfer: %s.",
-			       libusb_error_name(ret));
-			libusb_free_transfer(transfer);
-			g_free(buf);
-			fx2lafw_abort_acquisition(devc);
-			return SR_ERR;
-		}
-		devc->transfers[i] = transfer;
-		devc->submitted_transfers++;
+	ret = sr_usb_stream_submit(&devc->stream, usb->devhdl,
+		2 | LIBUSB_ENDPOINT_IN, receive_transfer, finish_acquisition,
+		(void *)sdi);
+	if (ret != SR_OK) {
+		devc->acq_aborted = TRUE;
+		return ret;
 	}
 
 	/*
@@ -714,8 +646,8 @@ SR_PRIV int fx2lafw_start_acquisition(const struct sr_dev_inst *sdi)
 	struct sr_dev_driver *di;
 	struct drv_context *drvc;
 	struct dev_context *devc;
-	int timeout, ret;
-	size_t size;
+	int ret;
+	size_t size, unitsize;
 
 	di = sdi->driver;
 	drvc = di->context;
@@ -732,16 +664,20 @@ SR_PRIV int fx2lafw_start_acquisition(const struct sr_dev_inst *sdi)
 		return SR_ERR;
 	}
 
-	timeout = get_timeout(devc);
-	usb_source_add(sdi->session, devc->ctx, timeout, receive_data, drvc);
+	unitsize = devc->sample_wide ? 2 : 1;
+	sr_usb_stream_start(&devc->stream, devc->cur_samplerate * unitsize,
+		512, 500, NUM_SIMUL_TRANSFERS);
+	usb_source_add(sdi->session, devc->ctx, devc->stream.timeout,
+		receive_data, drvc);
 
-	size = get_buffer_size(devc);
+	size = devc->stream.size;
 	/* Prepare for analog sampling. */
 	if (g_slist_length(devc->enabled_analog_channels) > 0) {
-		/* We need a buffer half the size of a transfer. */
+		/*
+		 * We need a logic buffer half the size of a transfer, the
+		 * analog data gets sent in place.
+		 */
 		devc->logic_buffer = g_try_malloc(size / 2);
-		devc->analog_buffer = g_try_malloc(
-			sizeof(float) * size / 2);
 	}
 	start_transfers(sdi);
 	if ((ret = command_start_acquisition(sdi)) != SR_OK) {
@@ -114,16 +114,17 @@ struct dev_context {
 
 	uint64_t num_frames;
 	uint64_t sent_samples;
-	int submitted_transfers;
 	int empty_transfer_count;
 
-	unsigned int num_transfers;
-	struct libusb_transfer **transfers;
+	struct sr_usb_stream stream;
 	struct sr_context *ctx;
 	void (*send_data_proc)(struct sr_dev_inst *sdi,
 		uint8_t *data, size_t length, size_t sample_width);
 	uint8_t *logic_buffer;
-	float *analog_buffer;
+	/* Logic packets from held transfers, see la_send_data_proc(). */
+	struct sr_datafeed_packet batch[NUM_SIMUL_TRANSFERS];
+	struct sr_datafeed_logic batch_logic[NUM_SIMUL_TRANSFERS];
+	size_t batch_count;
 };
 
 SR_PRIV int fx2lafw_dev_open(struct sr_dev_inst *sdi, struct sr_dev_driver *di);
@@ -70,6 +70,7 @@ SR_PRIV int gwinstek_gds_800_receive_data(int fd, int revents, void *cb_data)
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
+	GSList ch_node;
 	struct sr_analog_spec spec;
 	char command[32];
 	char *response;
@@ -114,7 +115,7 @@ SR_PRIV int gwinstek_gds_800_receive_data(int fd, int revents, void *cb_data)
 		devc->state = START_TRANSFER_OF_CHANNEL_DATA;
 		break;
 	case START_TRANSFER_OF_CHANNEL_DATA:
-		if (((struct sr_channel *)g_slist_nth_data(sdi->channels, devc->cur_acq_channel))->enabled) {
+		if (sr_dev_channel_nth(sdi, devc->cur_acq_channel)->enabled) {
 			if (sr_scpi_send(scpi, ":ACQ%d:MEM?", devc->cur_acq_channel+1) != SR_OK) {
 				sr_err("Failed to acquire memory.");
 				sr_dev_acquisition_stop(sdi);
@@ -242,7 +243,8 @@ SR_PRIV int gwinstek_gds_800_receive_data(int fd, int revents, void *cb_data)
 
 		/* Fill frame. */
 		sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
-		analog.meaning->channels = g_slist_append(NULL, g_slist_nth_data(sdi->channels, devc->cur_acq_channel));
+		sr_analog_meaning_channel_set(analog.meaning, &ch_node,
+			sr_dev_channel_nth(sdi, devc->cur_acq_channel));
 		analog.num_samples = num_samples;
 		analog.data = samples;
 		analog.meaning->mq = SR_MQ_VOLTAGE;
@@ -251,7 +253,6 @@ SR_PRIV int gwinstek_gds_800_receive_data(int fd, int revents, void *cb_data)
 		packet.type = SR_DF_ANALOG;
 		packet.payload = &analog;
 		sr_session_send(sdi, &packet);
-		g_slist_free(analog.meaning->channels);
 
 		/* All channels acquired. */
 		if (devc->cur_acq_channel == ANALOG_CHANNELS - 1) {
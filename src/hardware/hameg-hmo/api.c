@@ -104,6 +104,8 @@ static void clear_helper(struct dev_context *devc)
 	hmo_scope_state_free(devc->model_state);
 	g_free(devc->analog_groups);
 	g_free(devc->digital_groups);
+	if (devc->block)
+		g_byte_array_free(devc->block, TRUE);
 }
 
 static int dev_clear(const struct sr_dev_driver *di)
@@ -896,8 +896,10 @@ static int analog_channel_state_get(struct sr_dev_inst *sdi,
 			return SR_ERR;
 
 		ch = get_channel_by_index_and_type(sdi->channels, i, SR_CHANNEL_ANALOG);
-		if (ch)
+		if (ch) {
 			ch->enabled = state->analog_channels[i].state;
+			sr_dev_channels_changed(sdi);
+		}
 
 		g_snprintf(command, sizeof(command),
 			   (*config->scpi_dialect)[SCPI_CMD_GET_VERTICAL_SCALE],
@@ -970,8 +972,10 @@ static int digital_channel_state_get(struct sr_dev_inst *sdi,
 			return SR_ERR;
 
 		ch = get_channel_by_index_and_type(sdi->channels, i, SR_CHANNEL_LOGIC);
-		if (ch)
+		if (ch) {
 			ch->enabled = state->digital_channels[i];
+			sr_dev_channels_changed(sdi);
+		}
 	}
 
 	/* According to the SCPI standard, on models that support multiple
@@ -1380,6 +1384,7 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 	struct sr_analog_spec spec;
 	struct sr_datafeed_logic logic;
 	size_t group;
+	GSList *next_channel;
 
 	(void)fd;
 	(void)revents;
@@ -1412,13 +1417,31 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 	 */
 	switch (ch->type) {
 	case SR_CHANNEL_ANALOG:
-		data = NULL;
-		if (sr_scpi_get_block(sdi->conn, NULL, &data) != SR_OK) {
-			if (data)
-				g_byte_array_free(data, TRUE);
+	case SR_CHANNEL_LOGIC:
+		if (!devc->block)
+			devc->block = g_byte_array_new();
+		data = devc->block;
+		if (sr_scpi_read_block(sdi->conn, NULL, data) != SR_OK)
 			return TRUE;
-		}
+		break;
+	default:
+		sr_err("Invalid channel type.");
+		return TRUE;
+	}
+
+	/*
+	 * Request the next enabled channel's data before processing the
+	 * current channel's data. The device prepares its response while
+	 * the host is busy, which saves a round trip per channel.
+	 */
+	next_channel = devc->current_channel->next;
+	if (next_channel) {
+		devc->current_channel = next_channel;
+		hmo_request_data(sdi);
+	}
 
+	switch (ch->type) {
+	case SR_CHANNEL_ANALOG:
 		packet.type = SR_DF_ANALOG;
 
 		analog.data = data->data;
@@ -1441,17 +1464,8 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 		sr_session_send(sdi, &packet);
 		devc->num_samples = data->len / sizeof(float);
 		g_slist_free(meaning.channels);
-		g_byte_array_free(data, TRUE);
-		data = NULL;
 		break;
 	case SR_CHANNEL_LOGIC:
-		data = NULL;
-		if (sr_scpi_get_block(sdi->conn, NULL, &data) != SR_OK) {
-			if (data)
-				g_byte_array_free(data, TRUE);
-			return TRUE;
-		}
-
 		/*
 		 * If only data from the first pod is involved in the
 		 * acquisition, then the raw input bytes can get passed
@@ -1481,24 +1495,18 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 		}
 
 		devc->num_samples = data->len / devc->pod_count;
-		g_byte_array_free(data, TRUE);
-		data = NULL;
 		break;
 	default:
-		sr_err("Invalid channel type.");
 		break;
 	}
 
 	/*
-	 * Advance to the next enabled channel. When data for all enabled
-	 * channels was received, then flush potentially queued logic data,
-	 * and send the "frame end" packet.
+	 * The next enabled channel's data was already requested. When
+	 * data for all enabled channels was received, then flush
+	 * potentially queued logic data, and send the "frame end" packet.
 	 */
-	if (devc->current_channel->next) {
-		devc->current_channel = devc->current_channel->next;
-		hmo_request_data(sdi);
+	if (next_channel)
 		return TRUE;
-	}
 	hmo_send_logic_packet(sdi, devc);
 
 	/*
@@ -200,7 +200,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	else
 		conn_devices = NULL;
 
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			struct sr_usb_dev_inst *usb = NULL;
@@ -279,7 +279,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	}
 
 	g_slist_free_full(conn_devices, (GDestroyNotify)sr_usb_dev_inst_free);
-	libusb_free_device_list(devlist, 1);
+	sr_usb_free_device_list(devlist);
 
 	return std_scan_complete(di, devices);
 }
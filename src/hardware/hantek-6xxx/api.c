@@ -40,6 +40,11 @@ static const uint32_t devopts[] = {
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 	SR_CONF_NUM_VDIV | SR_CONF_GET,
+	SR_CONF_CONTINUOUS | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_TRANSFER_SIZE | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_QUEUE_DEPTH | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_UNDERRUNS | SR_CONF_GET,
+	SR_CONF_USB_OVERRUNS | SR_CONF_GET,
 };
 
 static const uint32_t devopts_cg[] = {
@@ -124,6 +129,7 @@ static const struct hantek_6xxx_profile dev_profiles[] = {
 
 
 static int read_channel(const struct sr_dev_inst *sdi, uint32_t amount);
+static int start_stream(struct sr_dev_inst *sdi);
 
 static struct sr_dev_inst *hantek_6xxx_dev_new(const struct hantek_6xxx_profile *prof)
 {
@@ -182,7 +188,8 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 		ch = l->data;
 		if (p < NUM_CHANNELS) {
 			devc->ch_enabled[p] = ch->enabled;
-			devc->enabled_channels = g_slist_append(devc->enabled_channels, ch);
+			if (ch->enabled)
+				devc->enabled_channels = g_slist_append(devc->enabled_channels, ch);
 		}
 	}
 
@@ -232,7 +239,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		conn_devices = NULL;
 
 	/* Find all Hantek 60xx devices and upload firmware to all of them. */
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
@@ -296,7 +303,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 			/* Not a supported VID/PID. */
 			continue;
 	}
-	libusb_free_device_list(devlist, 1);
+	sr_usb_free_device_list(devlist);
 
 	return std_scan_complete(di, devices);
 }
@@ -305,7 +312,6 @@ static int dev_open(struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
-	int64_t timediff_us, timediff_ms;
 	int err;
 
 	devc = sdi->priv;
@@ -315,22 +321,9 @@ static int dev_open(struct sr_dev_inst *sdi)
 	 * If the firmware was recently uploaded, wait up to MAX_RENUM_DELAY_MS
 	 * for the FX2 to renumerate.
 	 */
-	err = SR_ERR;
 	if (devc->fw_updated > 0) {
-		sr_info("Waiting for device to reset.");
-		/* Takes >= 300ms for the FX2 to be gone from the USB bus. */
-		g_usleep(300 * 1000);
-		timediff_ms = 0;
-		while (timediff_ms < MAX_RENUM_DELAY_MS) {
-			if ((err = hantek_6xxx_open(sdi)) == SR_OK)
-				break;
-			g_usleep(100 * 1000);
-			timediff_us = g_get_monotonic_time() - devc->fw_updated;
-			timediff_ms = timediff_us / 1000;
-			sr_spew("Waited %" PRIi64 " ms.", timediff_ms);
-		}
-		if (timediff_ms < MAX_RENUM_DELAY_MS)
-			sr_info("Device came back after %"PRIu64" ms.", timediff_ms);
+		err = ezusb_wait_renumeration(sdi, devc->fw_updated,
+			MAX_RENUM_DELAY_MS, hantek_6xxx_open);
 	} else {
 		err = hantek_6xxx_open(sdi);
 	}
@@ -352,6 +345,11 @@ static int dev_open(struct sr_dev_inst *sdi)
 
 static int dev_close(struct sr_dev_inst *sdi)
 {
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+
+	sr_usb_stream_free(&devc->stream);
 	hantek_6xxx_close(sdi);
 
 	return SR_OK;
@@ -397,6 +395,21 @@ static int config_get(uint32_t key, GVariant **data,
 				return SR_ERR;
 			*data = g_variant_new_printf("%d.%d", usb->bus, usb->address);
 			break;
+		case SR_CONF_CONTINUOUS:
+			*data = g_variant_new_boolean(devc->continuous);
+			break;
+		case SR_CONF_USB_TRANSFER_SIZE:
+			*data = g_variant_new_uint64(devc->stream.transfer_size);
+			break;
+		case SR_CONF_USB_QUEUE_DEPTH:
+			*data = g_variant_new_uint64(devc->stream.queue_depth);
+			break;
+		case SR_CONF_USB_UNDERRUNS:
+			*data = g_variant_new_uint64(devc->stream.underruns);
+			break;
+		case SR_CONF_USB_OVERRUNS:
+			*data = g_variant_new_uint64(devc->stream.overruns);
+			break;
 		default:
 			return SR_ERR_NA;
 		}
@@ -441,6 +454,17 @@ static int config_set(uint32_t key, GVariant *data,
 		case SR_CONF_LIMIT_SAMPLES:
 			devc->limit_samples = g_variant_get_uint64(data);
 			break;
+		case SR_CONF_CONTINUOUS:
+			devc->continuous = g_variant_get_boolean(data);
+			break;
+		case SR_CONF_USB_TRANSFER_SIZE:
+			devc->stream.transfer_size = g_variant_get_uint64(data);
+			break;
+		case SR_CONF_USB_QUEUE_DEPTH:
+			if (g_variant_get_uint64(data) > MAX_STREAM_TRANSFERS)
+				return SR_ERR_ARG;
+			devc->stream.queue_depth = g_variant_get_uint64(data);
+			break;
 		default:
 			return SR_ERR_NA;
 		}
@@ -549,59 +573,65 @@ static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
 	struct dev_context *devc = sdi->priv;
-	GSList *channels = devc->enabled_channels;
+	struct sr_rational scale[NUM_CHANNELS], offset[NUM_CHANNELS];
+	const uint64_t *vdiv;
+	int first, num_channels, digits;
 
-	const float ch_bit[] = { RANGE(0) / 255, RANGE(1) / 255 };
-	const float ch_center[] = { RANGE(0) / 2, RANGE(1) / 2 };
+	/*
+	 * The device always sends data for both channels. If a channel
+	 * is disabled, it contains a copy of the enabled channel's
+	 * data. However, we only send the requested channels to
+	 * the bus.
+	 *
+	 * Voltage values are encoded as a value 0-255, where the
+	 * value is a point in the range represented by the vdiv
+	 * setting. There are 10 vertical divs, so e.g. 500mV/div
+	 * represents 5V peak-to-peak where 0 = -2.5V and 255 = +2.5V.
+	 *
+	 * One packet refers to the interleaved transfer data in place,
+	 * the per-channel scale and offset describe this conversion.
+	 */
+	first = -1;
+	num_channels = 0;
+	digits = 0;
+	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+		if (!devc->ch_enabled[ch])
+			continue;
+		if (first < 0)
+			first = ch;
+
+		float vdivlog = log10f(RANGE(ch) / 255);
+		digits = MAX(digits, -(int)vdivlog + (vdivlog < 0.0));
+
+		vdiv = devc->vdivs[devc->voltage[ch]];
+		sr_rational_set(&scale[num_channels],
+			vdiv[0] * VDIV_MULTIPLIER, vdiv[1] * 255);
+		sr_rational_set(&offset[num_channels],
+			-(int64_t)(vdiv[0] * VDIV_MULTIPLIER), vdiv[1] * 2);
+		num_channels++;
+	}
+	if (!num_channels)
+		return;
 
-	sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
+	sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
 
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &analog;
 
 	analog.num_samples = num_samples;
+	analog.data = buf + first;
 	analog.meaning->mq = SR_MQ_VOLTAGE;
 	analog.meaning->unit = SR_UNIT_VOLT;
 	analog.meaning->mqflags = 0;
-
-	analog.data = g_try_malloc(num_samples * sizeof(float));
-	if (!analog.data) {
-		sr_err("Analog data buffer malloc failed.");
-		devc->dev_state = STOPPING;
-		return;
-	}
-
-	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
-		if (!devc->ch_enabled[ch])
-			continue;
-
-		float vdivlog = log10f(ch_bit[ch]);
-		int digits = -(int)vdivlog + (vdivlog < 0.0);
-		analog.encoding->digits = digits;
-		analog.spec->spec_digits = digits;
-		analog.meaning->channels = g_slist_append(NULL, channels->data);
-
-		for (int i = 0; i < num_samples; i++) {
-			/*
-			 * The device always sends data for both channels. If a channel
-			 * is disabled, it contains a copy of the enabled channel's
-			 * data. However, we only send the requested channels to
-			 * the bus.
-			 *
-			 * Voltage values are encoded as a value 0-255, where the
-			 * value is a point in the range represented by the vdiv
-			 * setting. There are 10 vertical divs, so e.g. 500mV/div
-			 * represents 5V peak-to-peak where 0 = -2.5V and 255 = +2.5V.
-			 */
-			((float *)analog.data)[i] = ch_bit[ch] * *(buf + i * 2 + ch) - ch_center[ch];
-		}
-
-		sr_session_send(sdi, &packet);
-		g_slist_free(analog.meaning->channels);
-
-		channels = channels->next;
-	}
-	g_free(analog.data);
+	analog.meaning->channels = devc->enabled_channels;
+	analog.encoding->unitsize = sizeof(uint8_t);
+	analog.encoding->is_float = FALSE;
+	analog.encoding->is_bigendian = FALSE;
+	analog.encoding->stride = NUM_CHANNELS;
+	analog.encoding->channel_scale = scale;
+	analog.encoding->channel_offset = offset;
+
+	sr_session_send(sdi, &packet);
 }
 
 /*
@@ -623,7 +653,10 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 		libusb_free_transfer(transfer);
 		devc->dev_state = CAPTURE;
 		devc->aq_started = g_get_monotonic_time();
-		read_channel(sdi, data_amount(sdi));
+		if (devc->continuous)
+			start_stream(sdi);
+		else
+			read_channel(sdi, data_amount(sdi));
 		return;
 	}
 
@@ -665,6 +698,77 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 	}
 }
 
+/*
+ * Streaming mode: called by the USB stream for each completed transfer,
+ * which gets resubmitted right away. Samples beyond the limit get
+ * dropped, the end of reception is left to handle_event().
+ */
+static gboolean stream_receive(struct libusb_transfer *transfer, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	uint64_t samples;
+
+	sdi = cb_data;
+	devc = sdi->priv;
+
+	if (devc->dev_state != CAPTURE)
+		return FALSE;
+
+	switch (transfer->status) {
+	case LIBUSB_TRANSFER_COMPLETED:
+	case LIBUSB_TRANSFER_TIMED_OUT:
+		break;
+	default:
+		sr_err("USB transfer failed: %s.",
+			libusb_error_name(transfer->status));
+		devc->dev_state = STOPPING;
+		return FALSE;
+	}
+
+	samples = transfer->actual_length / NUM_CHANNELS;
+	if (devc->limit_samples)
+		samples = MIN(samples, devc->limit_samples - devc->samp_received);
+	if (samples)
+		send_chunk(sdi, transfer->buffer, samples);
+	devc->samp_received += samples;
+
+	if (devc->limit_samples && devc->samp_received >= devc->limit_samples) {
+		sr_info("Requested number of samples reached, stopping.");
+		devc->dev_state = STOPPING;
+		return FALSE;
+	}
+	if (devc->limit_msec && (g_get_monotonic_time() -
+			devc->aq_started) / 1000 >= devc->limit_msec) {
+		sr_info("Requested time limit reached, stopping.");
+		devc->dev_state = STOPPING;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static int start_stream(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+	int ret;
+
+	devc = sdi->priv;
+	usb = sdi->conn;
+
+	sr_usb_stream_start(&devc->stream, devc->samplerate * NUM_CHANNELS,
+		MIN_PACKET_SIZE, MIN_STREAM_QUEUE_MS, MAX_STREAM_TRANSFERS);
+	ret = sr_usb_stream_submit(&devc->stream, usb->devhdl, HANTEK_EP_IN,
+		stream_receive, NULL, sdi);
+	if (ret != SR_OK) {
+		sr_err("Failed to start the USB stream.");
+		devc->dev_state = STOPPING;
+	}
+
+	return ret;
+}
+
 static int read_channel(const struct sr_dev_inst *sdi, uint32_t amount)
 {
 	int ret;
@@ -700,6 +804,13 @@ static int handle_event(int fd, int revents, void *cb_data)
 	libusb_handle_events_timeout(drvc->sr_ctx->libusb_ctx, &tv);
 
 	if (devc->dev_state == STOPPING) {
+		/* Wait for the streaming transfers to return. */
+		if (devc->stream.submitted) {
+			if (!devc->stream.stopping)
+				sr_usb_stream_cancel(&devc->stream);
+			return TRUE;
+		}
+
 		/* We've been told to wind up the acquisition. */
 		sr_dbg("Stopping acquisition.");
 
@@ -74,6 +74,10 @@
 #define MAX_PACKET_SIZE		(12 * 1024 * 1024)
 #endif
 
+/* Streaming mode: the most transfers to keep in flight, queued data. */
+#define MAX_STREAM_TRANSFERS	32
+#define MIN_STREAM_QUEUE_MS	500
+
 #define HANTEK_EP_IN		0x86
 #define USB_INTERFACE		0
 #define USB_CONFIGURATION	1
@@ -145,6 +149,10 @@ struct dev_context {
 
 	uint64_t limit_msec;
 	uint64_t limit_samples;
+
+	/* Gapless acquisition from a queue of bulk transfers. */
+	gboolean continuous;
+	struct sr_usb_stream stream;
 };
 
 SR_PRIV int hantek_6xxx_open(struct sr_dev_inst *sdi);
@@ -244,8 +244,12 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 			devc->ch_enabled[0] = ch->enabled;
 		else
 			devc->ch_enabled[1] = ch->enabled;
+		/*
+		 * The device sends the second channel's value first, keep
+		 * the list in that order to match the analog packets.
+		 */
 		if (ch->enabled)
-			devc->enabled_channels = g_slist_append(devc->enabled_channels, ch);
+			devc->enabled_channels = g_slist_prepend(devc->enabled_channels, ch);
 	}
 
 	return SR_OK;
@@ -295,7 +299,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		conn_devices = NULL;
 
 	/* Find all Hantek DSO devices and upload firmware to all of them. */
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
@@ -358,7 +362,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 			/* not a supported VID/PID */
 			continue;
 	}
-	libusb_free_device_list(devlist, 1);
+	sr_usb_free_device_list(devlist);
 
 	return std_scan_complete(di, devices);
 }
@@ -367,7 +371,6 @@ static int dev_open(struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
-	int64_t timediff_us, timediff_ms;
 	int err;
 
 	devc = sdi->priv;
@@ -377,21 +380,9 @@ static int dev_open(struct sr_dev_inst *sdi)
 	 * If the firmware was recently uploaded, wait up to MAX_RENUM_DELAY_MS
 	 * for the FX2 to renumerate.
 	 */
-	err = SR_ERR;
 	if (devc->fw_updated > 0) {
-		sr_info("Waiting for device to reset.");
-		/* Takes >= 300ms for the FX2 to be gone from the USB bus. */
-		g_usleep(300 * 1000);
-		timediff_ms = 0;
-		while (timediff_ms < MAX_RENUM_DELAY_MS) {
-			if ((err = dso_open(sdi)) == SR_OK)
-				break;
-			g_usleep(100 * 1000);
-			timediff_us = g_get_monotonic_time() - devc->fw_updated;
-			timediff_ms = timediff_us / 1000;
-			sr_spew("Waited %" PRIi64 " ms.", timediff_ms);
-		}
-		sr_info("Device came back after %" PRIi64 " ms.", timediff_ms);
+		err = ezusb_wait_renumeration(sdi, devc->fw_updated,
+			MAX_RENUM_DELAY_MS, dso_open);
 	} else {
 		err = dso_open(sdi);
 	}
@@ -649,52 +640,65 @@ static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
 	struct dev_context *devc = sdi->priv;
-	GSList *channels = devc->enabled_channels;
-
-	packet.type = SR_DF_ANALOG;
-	packet.payload = &analog;
-	/* TODO: support for 5xxx series 9-bit samples */
-	sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
-	analog.num_samples = num_samples;
-	analog.meaning->mq = SR_MQ_VOLTAGE;
-	analog.meaning->unit = SR_UNIT_VOLT;
-	analog.meaning->mqflags = 0;
-	/* TODO: Check malloc return value. */
-	analog.data = g_try_malloc(num_samples * sizeof(float));
+	struct sr_rational scale[NUM_CHANNELS], offset[NUM_CHANNELS];
+	const uint64_t *vdiv;
+	int first, num_channels, digits;
 
-	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+	/*
+	 * The device always sends data for both channels. If a channel
+	 * is disabled, it contains a copy of the enabled channel's
+	 * data. However, we only send the requested channels to
+	 * the bus.
+	 *
+	 * Voltage values are encoded as a value 0-255 (0-512 on the
+	 * DSO-5200*), where the value is a point in the range
+	 * represented by the vdiv setting. There are 8 vertical divs,
+	 * so e.g. 500mV/div represents 4V peak-to-peak where 0 = -2V
+	 * and 255 = +2V.
+	 *
+	 * One packet refers to the interleaved data in place, the
+	 * per-channel scale and offset describe this conversion. The
+	 * second channel comes first in each sample.
+	 */
+	/* TODO: Support for DSO-5xxx series 9-bit samples. */
+	first = -1;
+	num_channels = 0;
+	digits = 0;
+	for (int ch = NUM_CHANNELS - 1; ch >= 0; ch--) {
 		if (!devc->ch_enabled[ch])
 			continue;
+		if (first < 0)
+			first = 1 - ch;
 
-		float range = ((float)vdivs[devc->voltage[ch]][0] / vdivs[devc->voltage[ch]][1]) * 8;
+		vdiv = vdivs[devc->voltage[ch]];
+		float range = ((float)vdiv[0] / vdiv[1]) * 8;
 		float vdivlog = log10f(range / 255);
-		int digits = -(int)vdivlog + (vdivlog < 0.0);
-		analog.encoding->digits = digits;
-		analog.spec->spec_digits = digits;
-		analog.meaning->channels = g_slist_append(NULL, channels->data);
+		digits = MAX(digits, -(int)vdivlog + (vdivlog < 0.0));
 
-		for (int i = 0; i < num_samples; i++) {
-			/*
-			 * The device always sends data for both channels. If a channel
-			 * is disabled, it contains a copy of the enabled channel's
-			 * data. However, we only send the requested channels to
-			 * the bus.
-			 *
-			 * Voltage values are encoded as a value 0-255 (0-512 on the
-			 * DSO-5200*), where the value is a point in the range
-			 * represented by the vdiv setting. There are 8 vertical divs,
-			 * so e.g. 500mV/div represents 4V peak-to-peak where 0 = -2V
-			 * and 255 = +2V.
-			 */
-			/* TODO: Support for DSO-5xxx series 9-bit samples. */
-			((float *)analog.data)[i] = range / 255 * *(buf + i * 2 + 1 - ch) - range / 2;
-		}
-		sr_session_send(sdi, &packet);
-		g_slist_free(analog.meaning->channels);
-
-		channels = channels->next;
+		sr_rational_set(&scale[num_channels], vdiv[0] * 8, vdiv[1] * 255);
+		sr_rational_set(&offset[num_channels],
+			-(int64_t)(vdiv[0] * 4), vdiv[1]);
+		num_channels++;
 	}
-	g_free(analog.data);
+	if (!num_channels)
+		return;
+
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
+	analog.num_samples = num_samples;
+	analog.data = buf + first;
+	analog.meaning->mq = SR_MQ_VOLTAGE;
+	analog.meaning->unit = SR_UNIT_VOLT;
+	analog.meaning->mqflags = 0;
+	analog.meaning->channels = devc->enabled_channels;
+	analog.encoding->unitsize = sizeof(uint8_t);
+	analog.encoding->is_float = FALSE;
+	analog.encoding->is_bigendian = FALSE;
+	analog.encoding->stride = NUM_CHANNELS;
+	analog.encoding->channel_scale = scale;
+	analog.encoding->channel_offset = offset;
+	sr_session_send(sdi, &packet);
 }
 
 /*
@@ -225,7 +225,7 @@ static int get_channel_offsets(const struct sr_dev_inst *sdi)
 		}
 	}
 
-	if (sr_log_loglevel_get() >= SR_LOG_DBG) {
+	if (sr_log_enabled(SR_LOG_DBG)) {
 		gs = g_string_sized_new(128);
 		for (chan = 0; chan < NUM_CHANNELS; chan++) {
 			g_string_printf(gs, "CH%d:", chan + 1);
@@ -671,7 +671,7 @@ static int dso_set_relays(const struct sr_dev_inst *sdi)
 	if (!strcmp(devc->triggersource, "EXT"))
 		relays[7] = ~relays[7];
 
-	if (sr_log_loglevel_get() >= SR_LOG_DBG) {
+	if (sr_log_enabled(SR_LOG_DBG)) {
 		gs = g_string_sized_new(128);
 		g_string_printf(gs, "Relays:");
 		for (i = 0; i < 17; i++)
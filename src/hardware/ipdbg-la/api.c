@@ -241,8 +241,20 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 {
 	struct ipdbg_la_tcp *tcp = sdi->conn;
 	struct dev_context *devc = sdi->priv;
+	int ret;
+
+	if ((ret = ipdbg_la_convert_trigger(sdi)) != SR_OK)
+		return ret;
+
+	/* The whole sample memory is received here, in bulk. */
+	g_free(devc->raw_sample_buf);
+	devc->raw_sample_buf = g_try_malloc(devc->limit_samples_max *
+		devc->data_width_bytes);
+	if (!devc->raw_sample_buf) {
+		sr_err("Sample buffer malloc failed.");
+		return SR_ERR_MALLOC;
+	}
 
-	ipdbg_la_convert_trigger(sdi);
 	ipdbg_la_send_trigger(devc, tcp);
 	ipdbg_la_send_delay(devc, tcp);
 
@@ -262,13 +274,13 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 	struct ipdbg_la_tcp *tcp = sdi->conn;
 	struct dev_context *devc = sdi->priv;
 
-	const size_t bufsize = 1024;
-	uint8_t buffer[bufsize];
+	const uint64_t total = devc->limit_samples_max * devc->data_width_bytes;
 
-	if (devc->num_transfers > 0) {
-		while (devc->num_transfers <
-			(devc->limit_samples_max * devc->data_width_bytes)) {
-			int recd = ipdbg_la_tcp_receive(tcp, buffer, bufsize);
+	if (devc->num_transfers > 0 && devc->raw_sample_buf) {
+		while (devc->num_transfers < total) {
+			int recd = ipdbg_la_tcp_receive(tcp,
+				devc->raw_sample_buf + devc->num_transfers,
+				total - devc->num_transfers);
 			if (recd > 0)
 				devc->num_transfers += recd;
 		}
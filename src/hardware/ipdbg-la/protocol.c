@@ -63,7 +63,7 @@
 /* LA subfunction command opcodes */
 #define CMD_LA_DELAY               0x1F
 
-static gboolean data_available(struct ipdbg_la_tcp *tcp)
+static size_t bytes_available(struct ipdbg_la_tcp *tcp)
 {
 #ifdef _WIN32
 	u_long bytes_available;
@@ -73,9 +73,9 @@ static gboolean data_available(struct ipdbg_la_tcp *tcp)
 	if (ioctl(tcp->socket, FIONREAD, &bytes_available) < 0) { /* TIOCMGET */
 #endif
 		sr_err("FIONREAD failed: %s\n", g_strerror(errno));
-		return FALSE;
+		return 0;
 	}
-	return (bytes_available > 0);
+	return (bytes_available > 0) ? (size_t)bytes_available : 0;
 }
 
 SR_PRIV struct ipdbg_la_tcp *ipdbg_la_tcp_new(void)
@@ -161,19 +161,46 @@ SR_PRIV int ipdbg_la_tcp_close(struct ipdbg_la_tcp *tcp)
 static int tcp_send(struct ipdbg_la_tcp *tcp, const uint8_t *buf, size_t len)
 {
 	int out;
-	out = send(tcp->socket, (const char *)buf, len, 0);
 
-	if (out < 0) {
-		sr_err("Send error: %s", g_strerror(errno));
-		return SR_ERR;
+	while (len > 0) {
+		out = send(tcp->socket, (const char *)buf, len, 0);
+		if (out < 0) {
+			sr_err("Send error: %s", g_strerror(errno));
+			return SR_ERR;
+		}
+		buf += out;
+		len -= out;
 	}
 
-	if (out < (int)len)
-		sr_dbg("Only sent %d/%d bytes of data.", out, (int)len);
-
 	return SR_OK;
 }
 
+/*
+ * Receive everything the socket holds right now, but at most bufsize
+ * bytes, without blocking. Returns the number of bytes read, or -1.
+ */
+SR_PRIV int ipdbg_la_tcp_receive(struct ipdbg_la_tcp *tcp,
+	uint8_t *buf, size_t bufsize)
+{
+	size_t received, avail;
+	int recd;
+
+	received = 0;
+	while (received < bufsize && (avail = bytes_available(tcp)) > 0) {
+		avail = MIN(avail, bufsize - received);
+		recd = recv(tcp->socket, (char *)buf + received, avail, 0);
+		if (recd < 0) {
+			sr_err("Receive error: %s", g_strerror(errno));
+			return -1;
+		}
+		if (recd == 0)
+			break;
+		received += recd;
+	}
+
+	return received;
+}
+
 static int tcp_receive_blocking(struct ipdbg_la_tcp *tcp,
 	uint8_t *buf, int bufsize)
 {
@@ -196,32 +223,33 @@ static int tcp_receive_blocking(struct ipdbg_la_tcp *tcp,
 	return received;
 }
 
-SR_PRIV int ipdbg_la_tcp_receive(struct ipdbg_la_tcp *tcp,
-	uint8_t *buf, size_t bufsize)
-{
-	int received = 0;
-	if (data_available(tcp))
-		received = recv(tcp->socket, (char *)buf, bufsize, 0);
-	if (received < 0) {
-		sr_err("Receive error: %s", g_strerror(errno));
-		return -1;
-	} else
-		return received;
-}
+/* The device evaluates one stage, of level and edge matches. */
+static const struct sr_trigger_caps trigger_caps = {
+	.matches = (1 << SR_TRIGGER_ZERO) | (1 << SR_TRIGGER_ONE) |
+		(1 << SR_TRIGGER_RISING) | (1 << SR_TRIGGER_FALLING) |
+		(1 << SR_TRIGGER_EDGE),
+	.max_stages = 1,
+	.max_edges = -1,
+};
 
 SR_PRIV int ipdbg_la_convert_trigger(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
-	struct sr_trigger *trigger;
+	struct sr_trigger *trigger, *hw;
 	struct sr_trigger_stage *stage;
 	struct sr_trigger_match *match;
 	const GSList *l, *m;
+	gboolean sw;
+	int ret;
 
 	devc = sdi->priv;
 
 	devc->num_stages = 0;
 	devc->num_transfers = 0;
-	devc->raw_sample_buf = NULL;
+	if (devc->soft_trigger)
+		soft_trigger_logic_free(devc->soft_trigger);
+	devc->soft_trigger = NULL;
+	devc->hw_stages = 0;
 
 	for (uint64_t i = 0; i < devc->data_width_bytes; i++) {
 		devc->trigger_mask[i] = 0;
@@ -234,7 +262,20 @@ SR_PRIV int ipdbg_la_convert_trigger(const struct sr_dev_inst *sdi)
 	if (!(trigger = sr_session_trigger_get(sdi->session)))
 		return SR_OK;
 
-	for (l = trigger->stages; l; l = l->next) {
+	/* Stages which the device can't evaluate get checked in software. */
+	ret = sr_trigger_plan(trigger, &trigger_caps, &hw, &sw);
+	if (ret != SR_OK)
+		return ret;
+	if (sw) {
+		devc->soft_trigger = soft_trigger_logic_new(sdi, trigger, 0);
+		if (!devc->soft_trigger) {
+			sr_trigger_free(hw);
+			return SR_ERR;
+		}
+	}
+	devc->hw_stages = hw ? g_slist_length(hw->stages) : 0;
+
+	for (l = hw ? hw->stages : NULL; l; l = l->next) {
 		stage = l->data;
 		for (m = stage->matches; m; m = m->next) {
 			match = m->data;
@@ -275,10 +316,64 @@ SR_PRIV int ipdbg_la_convert_trigger(const struct sr_dev_inst *sdi)
 			}
 		}
 	}
+	sr_trigger_free(hw);
 
 	return SR_OK;
 }
 
+/*
+ * Send the acquired window of the sample memory. The hardware trigger
+ * matched at delay_value. When stages of the trigger remain for the soft
+ * trigger, it checks the whole trigger from the hardware match on (and
+ * the sample before it, for edges), and the window moves to its match.
+ */
+static void send_capture(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint64_t trigger_pos, first, count;
+	size_t unitsize;
+	int offset;
+
+	devc = sdi->priv;
+	unitsize = devc->data_width_bytes;
+
+	trigger_pos = devc->delay_value;
+	if (devc->soft_trigger) {
+		first = devc->delay_value - MIN(devc->delay_value,
+			(uint64_t)devc->hw_stages);
+		offset = soft_trigger_logic_scan(devc->soft_trigger,
+			devc->raw_sample_buf + first * unitsize,
+			(devc->limit_samples_max - first) * unitsize);
+		if (offset < 0) {
+			sr_info("Trigger did not match in the sample memory.");
+			return;
+		}
+		trigger_pos = first + offset;
+	}
+	first = trigger_pos - MIN(trigger_pos, devc->delay_value);
+	count = MIN(devc->limit_samples, devc->limit_samples_max - first);
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = unitsize;
+	if (trigger_pos > first) {
+		/* There are pre-trigger samples, send those first. */
+		logic.length = (trigger_pos - first) * unitsize;
+		logic.data = devc->raw_sample_buf + first * unitsize;
+		sr_session_send(sdi, &packet);
+	}
+
+	/* Send the trigger. */
+	std_session_send_df_trigger(sdi);
+
+	/* Send post-trigger samples. */
+	logic.length = (first + count - trigger_pos) * unitsize;
+	logic.data = devc->raw_sample_buf + trigger_pos * unitsize;
+	sr_session_send(sdi, &packet);
+}
+
 SR_PRIV int ipdbg_la_receive_data(int fd, int revents, void *cb_data)
 {
 	const struct sr_dev_inst *sdi;
@@ -295,91 +390,78 @@ SR_PRIV int ipdbg_la_receive_data(int fd, int revents, void *cb_data)
 		return FALSE;
 
 	struct ipdbg_la_tcp *tcp = sdi->conn;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
+	uint64_t total;
+	int recd;
 
-	if (!devc->raw_sample_buf) {
-		devc->raw_sample_buf =
-			g_try_malloc(devc->limit_samples * devc->data_width_bytes);
-		if (!devc->raw_sample_buf) {
-			sr_err("Sample buffer malloc failed.");
-			return FALSE;
-		}
-	}
+	if (!devc->raw_sample_buf)
+		return FALSE;
 
-	if (devc->num_transfers <
-		(devc->limit_samples_max * devc->data_width_bytes)) {
-		const size_t bufsize = 1024;
-		uint8_t buffer[bufsize];
-
-		const int recd = ipdbg_la_tcp_receive(tcp, buffer, bufsize);
-		if ( recd > 0) {
-			int num_move = (((devc->num_transfers + recd) <=
-							 (devc->limit_samples * devc->data_width_bytes))
-			?
-				recd
-			:
-				(int)((devc->limit_samples * devc->data_width_bytes) -
-						devc->num_transfers));
-			if ( num_move > 0 )
-				memcpy(&(devc->raw_sample_buf[devc->num_transfers]),
-						buffer, num_move);
+	/*
+	 * The device always sends its whole sample memory. Receive all of
+	 * it straight into the sample buffer, only the first limit_samples
+	 * are sent to the session.
+	 */
+	total = devc->limit_samples_max * devc->data_width_bytes;
+	if (devc->num_transfers < total) {
+		recd = ipdbg_la_tcp_receive(tcp,
+			devc->raw_sample_buf + devc->num_transfers,
+			total - devc->num_transfers);
+		if (recd > 0)
 			devc->num_transfers += recd;
-		}
-	} else {
-		if (devc->delay_value > 0) {
-			/* There are pre-trigger samples, send those first. */
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-			logic.length = devc->delay_value * devc->data_width_bytes;
-			logic.unitsize = devc->data_width_bytes;
-			logic.data = devc->raw_sample_buf;
-			sr_session_send(cb_data, &packet);
-		}
-
-		/* Send the trigger. */
-		std_session_send_df_trigger(cb_data);
-
-		/* Send post-trigger samples. */
-		packet.type = SR_DF_LOGIC;
-		packet.payload = &logic;
-		logic.length = (devc->limit_samples - devc->delay_value) *
-			devc->data_width_bytes;
-		logic.unitsize = devc->data_width_bytes;
-		logic.data = devc->raw_sample_buf +
-			(devc->delay_value * devc->data_width_bytes);
-		sr_session_send(cb_data, &packet);
-
-		g_free(devc->raw_sample_buf);
-		devc->raw_sample_buf = NULL;
+	}
 
+	if (devc->num_transfers >= total) {
+		send_capture(sdi);
 		ipdbg_la_abort_acquisition(sdi);
 	}
 
 	return TRUE;
 }
 
-static int send_escaping(struct ipdbg_la_tcp *tcp, uint8_t *data_to_send,
-	uint32_t length)
+/*
+ * Append the value of len bytes to the command in buf, most significant
+ * byte first as the device expects it, and escape the bytes which would
+ * be taken for commands. buf must have room for 2 * len bytes at pos.
+ * Returns the new command length.
+ */
+static size_t append_escaped(uint8_t *buf, size_t pos,
+	const uint8_t *value, size_t len)
 {
-	uint8_t escape = CMD_ESCAPE;
+	uint8_t payload;
 
-	while (length--) {
-		uint8_t payload = *data_to_send++;
+	while (len--) {
+		payload = value[len];
+		if (payload == CMD_RESET || payload == CMD_ESCAPE)
+			buf[pos++] = CMD_ESCAPE;
+		buf[pos++] = payload;
+	}
+
+	return pos;
+}
 
-		if (payload == CMD_RESET)
-			if (tcp_send(tcp, &escape, 1) != SR_OK)
-				sr_warn("Couldn't send escape");
+/*
+ * Send one configuration command, its opcodes followed by the escaped
+ * value, with a single write to the socket.
+ */
+static int send_command(struct ipdbg_la_tcp *tcp, uint8_t cmd,
+	uint8_t subcmd, uint8_t subsubcmd, const uint8_t *value, size_t len)
+{
+	uint8_t *buf;
+	size_t pos;
+	int ret;
 
-		if (payload == CMD_ESCAPE)
-			if (tcp_send(tcp, &escape, 1) != SR_OK)
-				sr_warn("Couldn't send escape");
+	buf = g_malloc(3 + 2 * len);
+	pos = 0;
+	buf[pos++] = cmd;
+	buf[pos++] = subcmd;
+	if (subsubcmd)
+		buf[pos++] = subsubcmd;
+	pos = append_escaped(buf, pos, value, len);
 
-		if (tcp_send(tcp, &payload, 1) != SR_OK)
-			sr_warn("Couldn't send data");
-	}
+	ret = tcp_send(tcp, buf, pos);
+	g_free(buf);
 
-	return SR_OK;
+	return ret;
 }
 
 SR_PRIV int ipdbg_la_send_delay(struct dev_context *devc,
@@ -387,20 +469,13 @@ SR_PRIV int ipdbg_la_send_delay(struct dev_context *devc,
 {
 	devc->delay_value = ((devc->limit_samples - 1) / 100.0) * devc->capture_ratio;
 
-	uint8_t buf;
-	buf = CMD_CFG_LA;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_LA_DELAY;
-	tcp_send(tcp, &buf, 1);
-
-	uint8_t delay_buf[4] = { devc->delay_value & 0x000000ff,
-		(devc->delay_value >> 8) & 0x000000ff,
-		(devc->delay_value >> 16) & 0x000000ff,
-		(devc->delay_value >> 24) & 0x000000ff
-	};
+	uint8_t delay_buf[8];
+	for (size_t i = 0; i < sizeof(delay_buf); i++)
+		delay_buf[i] = (devc->delay_value >> (8 * i)) & 0xff;
 
-	for (uint64_t i = 0; i < devc->addr_width_bytes; i++)
-		send_escaping(tcp, &(delay_buf[devc->addr_width_bytes - 1 - i]), 1);
+	if (send_command(tcp, CMD_CFG_LA, CMD_LA_DELAY, 0, delay_buf,
+			MIN(devc->addr_width_bytes, sizeof(delay_buf))) != SR_OK)
+		sr_warn("Couldn't send delay");
 
 	return SR_OK;
 }
@@ -408,67 +483,26 @@ SR_PRIV int ipdbg_la_send_delay(struct dev_context *devc,
 SR_PRIV int ipdbg_la_send_trigger(struct dev_context *devc,
 	struct ipdbg_la_tcp *tcp)
 {
-	uint8_t buf;
-
-	/* Mask */
-	buf = CMD_CFG_TRIGGER;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_TRIG_MASKS;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_TRIG_MASK;
-	tcp_send(tcp, &buf, 1);
-
-	for (size_t i = 0; i < devc->data_width_bytes; i++)
-		send_escaping(tcp,
-			devc->trigger_mask + devc->data_width_bytes - 1 - i, 1);
-
-	/* Value */
-	buf = CMD_CFG_TRIGGER;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_TRIG_MASKS;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_TRIG_VALUE;
-	tcp_send(tcp, &buf, 1);
-
-	for (size_t i = 0; i < devc->data_width_bytes; i++)
-		send_escaping(tcp,
-			devc->trigger_value + devc->data_width_bytes - 1 - i, 1);
-
-	/* Mask_last */
-	buf = CMD_CFG_TRIGGER;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_TRIG_MASKS_LAST;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_TRIG_MASK_LAST;
-	tcp_send(tcp, &buf, 1);
-
-	for (size_t i = 0; i < devc->data_width_bytes; i++)
-		send_escaping(tcp,
-			devc->trigger_mask_last + devc->data_width_bytes - 1 - i, 1);
-
-	/* Value_last */
-	buf = CMD_CFG_TRIGGER;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_TRIG_MASKS_LAST;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_TRIG_VALUE_LAST;
-	tcp_send(tcp, &buf, 1);
-
-	for (size_t i = 0; i < devc->data_width_bytes; i++)
-		send_escaping(tcp,
-			devc->trigger_value_last + devc->data_width_bytes - 1 - i, 1);
-
-	/* Edge_mask */
-	buf = CMD_CFG_TRIGGER;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_TRIG_SELECT_EDGE_MASK;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_TRIG_SET_EDGE_MASK;
-	tcp_send(tcp, &buf, 1);
-
-	for (size_t i = 0; i < devc->data_width_bytes; i++)
-		send_escaping(tcp,
-			devc->trigger_edge_mask + devc->data_width_bytes - 1 - i, 1);
+	const size_t len = devc->data_width_bytes;
+	int ret;
+
+	ret = send_command(tcp, CMD_CFG_TRIGGER, CMD_TRIG_MASKS,
+		CMD_TRIG_MASK, devc->trigger_mask, len);
+	if (ret == SR_OK)
+		ret = send_command(tcp, CMD_CFG_TRIGGER, CMD_TRIG_MASKS,
+			CMD_TRIG_VALUE, devc->trigger_value, len);
+	if (ret == SR_OK)
+		ret = send_command(tcp, CMD_CFG_TRIGGER, CMD_TRIG_MASKS_LAST,
+			CMD_TRIG_MASK_LAST, devc->trigger_mask_last, len);
+	if (ret == SR_OK)
+		ret = send_command(tcp, CMD_CFG_TRIGGER, CMD_TRIG_MASKS_LAST,
+			CMD_TRIG_VALUE_LAST, devc->trigger_value_last, len);
+	if (ret == SR_OK)
+		ret = send_command(tcp, CMD_CFG_TRIGGER,
+			CMD_TRIG_SELECT_EDGE_MASK, CMD_TRIG_SET_EDGE_MASK,
+			devc->trigger_edge_mask, len);
+	if (ret != SR_OK)
+		sr_warn("Couldn't send trigger");
 
 	return SR_OK;
 }
@@ -555,9 +589,16 @@ SR_PRIV int ipdbg_la_request_id(struct ipdbg_la_tcp *tcp)
 SR_PRIV void ipdbg_la_abort_acquisition(const struct sr_dev_inst *sdi)
 {
 	struct ipdbg_la_tcp *tcp = sdi->conn;
+	struct dev_context *devc = sdi->priv;
 
 	sr_session_source_remove(sdi->session, tcp->socket);
 
+	g_free(devc->raw_sample_buf);
+	devc->raw_sample_buf = NULL;
+	if (devc->soft_trigger)
+		soft_trigger_logic_free(devc->soft_trigger);
+	devc->soft_trigger = NULL;
+
 	std_session_send_df_end(sdi);
 }
 
@@ -52,6 +52,9 @@ struct dev_context {
 	int num_stages;
 	uint64_t num_transfers;
 	uint8_t *raw_sample_buf;
+	/* Checks the trigger stages which the device can't evaluate. */
+	struct soft_trigger_logic *soft_trigger;
+	int hw_stages;
 };
 
 SR_PRIV struct ipdbg_la_tcp *ipdbg_la_tcp_new(void);
@@ -199,33 +199,33 @@ SR_PRIV void itech_it8500_status_change(const struct sr_dev_inst *sdi,
 	old_bit = old_os & OS_OUT_FLAG;
 	new_bit = new_os & OS_OUT_FLAG;
 	if (old_bit != new_bit)
-		sr_session_send_meta(sdi,
+		sr_session_send_meta_bool(sdi,
 			SR_CONF_ENABLED,
-			g_variant_new_boolean(new_bit));
+			new_bit);
 
 	/* Check if OVP status has changed. */
 	old_bit = old_ds & DS_OV_FLAG;
 	new_bit = new_ds & DS_OV_FLAG;
 	if (old_bit != new_bit)
-		sr_session_send_meta(sdi,
+		sr_session_send_meta_bool(sdi,
 			SR_CONF_OVER_VOLTAGE_PROTECTION_ACTIVE,
-			g_variant_new_boolean(new_bit));
+			new_bit);
 
 	/* Check if OCP status has changed. */
 	old_bit = old_ds & DS_OC_FLAG;
 	new_bit = new_ds & DS_OC_FLAG;
 	if (old_bit != new_bit)
-		sr_session_send_meta(sdi,
+		sr_session_send_meta_bool(sdi,
 			SR_CONF_OVER_CURRENT_PROTECTION_ACTIVE,
-			g_variant_new_boolean(new_bit));
+			new_bit);
 
 	/* Check if OTP status has changed. */
 	old_bit = old_ds & DS_OT_FLAG;
 	new_bit = new_ds & DS_OT_FLAG;
 	if (old_bit != new_bit)
-		sr_session_send_meta(sdi,
+		sr_session_send_meta_bool(sdi,
 			SR_CONF_OVER_TEMPERATURE_PROTECTION_ACTIVE,
-			g_variant_new_boolean(new_bit));
+			new_bit);
 
 	/* Check if operating mode has changed. */
 	if (old_m != new_m) {
@@ -347,12 +347,13 @@ SR_PRIV void itech_it8500_channel_send_value(const struct sr_dev_inst *sdi,
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
+	GSList ch_node;
 	struct sr_analog_spec spec;
 	double val;
 
 	val = value;
 	sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
-	analog.meaning->channels = g_slist_append(NULL, ch);
+	sr_analog_meaning_channel_set(analog.meaning, &ch_node, ch);
 	analog.num_samples = 1;
 	analog.data = &val;
 	analog.encoding->unitsize = sizeof(val);
@@ -364,7 +365,6 @@ SR_PRIV void itech_it8500_channel_send_value(const struct sr_dev_inst *sdi,
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &analog;
 	sr_session_send(sdi, &packet);
-	g_slist_free(analog.meaning->channels);
 }
 
 SR_PRIV int itech_it8500_receive_data(int fd, int revents, void *cb_data)
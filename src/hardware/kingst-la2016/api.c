@@ -473,7 +473,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	devices = NULL;
 	found_devices = NULL;
 	renum_devices = NULL;
-	ret = libusb_get_device_list(ctx->libusb_ctx, &devlist);
+	ret = sr_usb_get_device_list(ctx->libusb_ctx, &devlist);
 	if (ret < 0) {
 		sr_err("Cannot get device list: %s.", libusb_error_name(ret));
 		return devices;
@@ -562,7 +562,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		}
 		found_devices = g_slist_append(found_devices, sdi);
 	}
-	libusb_free_device_list(devlist, 1);
+	sr_usb_free_device_list(devlist);
 	g_slist_free_full(conn_devices, sr_usb_dev_inst_free_cb);
 
 	/*
@@ -685,19 +685,20 @@ static int dev_open(struct sr_dev_inst *sdi)
 static int dev_close(struct sr_dev_inst *sdi)
 {
 	struct sr_usb_dev_inst *usb;
+	struct dev_context *devc;
 
 	usb = sdi->conn;
+	devc = sdi->priv;
 
 	if (!usb->devhdl)
 		return SR_ERR_BUG;
 
-	la2016_release_resources(sdi);
-
 	if (WITH_DEINIT_IN_CLOSE)
 		la2016_deinit_hardware(sdi);
 
 	sr_info("Closing device on %d.%d (logical) / %s (physical) interface %d.",
 		usb->bus, usb->address, sdi->connection_id, USB_INTERFACE);
+	sr_usb_stream_free(&devc->usb_stream);
 	la2016_close_usb(sdi->conn);
 
 	return SR_OK;
@@ -1069,12 +1070,16 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 			sr_err("Cannot allocate buffer for session feed.");
 			return SR_ERR_MALLOC;
 		}
+		/* Let consumers keep sample data without a copy. */
+		(void)feed_queue_logic_use_pool(devc->feed_queue, 4);
 		devc->transfer_size = xfersize;
 		devc->sequence_size = seqsize;
 		devc->packets_per_chunk = xfersize;
 		devc->packets_per_chunk -= seqsize;
 		devc->packets_per_chunk /= unitsize + repsize;
+		devc->rle.unitsize = unitsize;
 	}
+	devc->rle.active = sr_session_logic_rle_accepted(sdi->session);
 
 	sr_sw_limits_acquisition_start(&devc->sw_limits);
 
@@ -174,7 +174,7 @@ static void la2016_dump_fpga_registers(const struct sr_dev_inst *sdi,
 	size_t dump_addr, indent, dump_len;
 	GString *txt;
 
-	if (sr_log_loglevel_get() < SR_LOG_SPEW)
+	if (!sr_log_enabled(SR_LOG_SPEW))
 		return;
 
 	if (!reg_lower && !reg_upper) {
@@ -288,7 +288,9 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 {
 	struct drv_context *drvc;
 	struct sr_usb_dev_inst *usb;
-	struct sr_resource bitstream;
+	GBytes *bitstream;
+	const uint8_t *bitstream_data;
+	size_t bitstream_len;
 	uint32_t bitstream_size;
 	uint8_t buffer[sizeof(uint32_t)];
 	uint8_t *wrptr;
@@ -303,20 +305,21 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 
 	sr_info("Uploading FPGA bitstream '%s'.", bitstream_fname);
 
-	ret = sr_resource_open(drvc->sr_ctx, &bitstream,
-		SR_RESOURCE_FIRMWARE, bitstream_fname);
-	if (ret != SR_OK) {
+	bitstream = sr_resource_get(drvc->sr_ctx, SR_RESOURCE_FIRMWARE,
+		bitstream_fname, G_MAXUINT32);
+	if (!bitstream) {
 		sr_err("Cannot find FPGA bitstream %s.", bitstream_fname);
-		return ret;
+		return SR_ERR;
 	}
+	bitstream_data = g_bytes_get_data(bitstream, &bitstream_len);
 
-	bitstream_size = (uint32_t)bitstream.size;
+	bitstream_size = (uint32_t)bitstream_len;
 	wrptr = buffer;
 	write_u32le_inc(&wrptr, bitstream_size);
 	ret = ctrl_out(sdi, CMD_FPGA_INIT, 0x00, 0, buffer, wrptr - buffer);
 	if (ret != SR_OK) {
 		sr_err("Cannot initiate FPGA bitstream upload.");
-		sr_resource_close(drvc->sr_ctx, &bitstream);
+		g_bytes_unref(bitstream);
 		return ret;
 	}
 	zero_pad_to = bitstream_size;
@@ -326,14 +329,11 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 
 	pos = 0;
 	while (1) {
-		if (pos < bitstream.size) {
-			len = (int)sr_resource_read(drvc->sr_ctx, &bitstream,
-				block, sizeof(block));
-			if (len < 0) {
-				sr_err("Cannot read FPGA bitstream.");
-				sr_resource_close(drvc->sr_ctx, &bitstream);
-				return SR_ERR_IO;
-			}
+		if (pos < bitstream_size) {
+			len = bitstream_size - pos;
+			if ((unsigned)len > sizeof(block))
+				len = sizeof(block);
+			memcpy(&block, &bitstream_data[pos], len);
 		} else {
 			/*  Zero-pad until 'zero_pad_to'. */
 			len = zero_pad_to - pos;
@@ -360,11 +360,11 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 		}
 		pos += len;
 	}
-	sr_resource_close(drvc->sr_ctx, &bitstream);
+	g_bytes_unref(bitstream);
 	if (ret != SR_OK)
 		return ret;
-	sr_info("FPGA bitstream upload (%" PRIu64 " bytes) done.",
-		bitstream.size);
+	sr_info("FPGA bitstream upload (%" PRIu32 " bytes) done.",
+		bitstream_size);
 
 	return SR_OK;
 }
@@ -1025,152 +1025,20 @@ SR_PRIV int la2016_upload_firmware(const struct sr_dev_inst *sdi,
 	return SR_OK;
 }
 
-static void LIBUSB_CALL receive_transfer(struct libusb_transfer *xfer);
-
-static void la2016_usbxfer_release_cb(gpointer p)
-{
-	struct libusb_transfer *xfer;
-
-	xfer = p;
-	g_free(xfer->buffer);
-	libusb_free_transfer(xfer);
-}
+static gboolean receive_transfer(struct libusb_transfer *transfer,
+	void *cb_data);
 
-static int la2016_usbxfer_release(const struct sr_dev_inst *sdi)
-{
-	struct dev_context *devc;
-
-	devc = sdi ? sdi->priv : NULL;
-	if (!devc)
-		return SR_ERR_ARG;
-
-	/* Release all USB transfers. */
-	g_slist_free_full(devc->transfers, la2016_usbxfer_release_cb);
-	devc->transfers = NULL;
-
-	return SR_OK;
-}
-
-static int la2016_usbxfer_allocate(const struct sr_dev_inst *sdi)
-{
-	struct dev_context *devc;
-	size_t bufsize, xfercount;
-	uint8_t *buffer;
-	struct libusb_transfer *xfer;
-
-	devc = sdi ? sdi->priv : NULL;
-	if (!devc)
-		return SR_ERR_ARG;
-
-	/* Transfers were already allocated before? */
-	if (devc->transfers)
-		return SR_OK;
-
-	/*
-	 * Allocate all USB transfers and their buffers. Arrange for a
-	 * buffer size which is within the device's capabilities, and
-	 * is a multiple of the USB endpoint's size, to make use of the
-	 * RAW_IO performance feature.
-	 *
-	 * Implementation detail: The LA2016_USB_BUFSZ value happens
-	 * to match all those constraints. No additional arithmetics is
-	 * required in this location.
-	 */
-	bufsize = LA2016_USB_BUFSZ;
-	xfercount = LA2016_USB_XFER_COUNT;
-	while (xfercount--) {
-		buffer = g_try_malloc(bufsize);
-		if (!buffer) {
-			sr_err("Cannot allocate USB transfer buffer.");
-			return SR_ERR_MALLOC;
-		}
-		xfer = libusb_alloc_transfer(0);
-		if (!xfer) {
-			sr_err("Cannot allocate USB transfer.");
-			g_free(buffer);
-			return SR_ERR_MALLOC;
-		}
-		xfer->buffer = buffer;
-		devc->transfers = g_slist_append(devc->transfers, xfer);
-	}
-	devc->transfer_bufsize = bufsize;
-
-	return SR_OK;
-}
-
-static int la2016_usbxfer_cancel_all(const struct sr_dev_inst *sdi)
-{
-	struct dev_context *devc;
-	GSList *l;
-	struct libusb_transfer *xfer;
-
-	devc = sdi ? sdi->priv : NULL;
-	if (!devc)
-		return SR_ERR_ARG;
-
-	/* Unconditionally cancel the transfer. Ignore errors. */
-	for (l = devc->transfers; l; l = l->next) {
-		xfer = l->data;
-		if (!xfer)
-			continue;
-		libusb_cancel_transfer(xfer);
-	}
-
-	return SR_OK;
-}
-
-static int la2016_usbxfer_resubmit(const struct sr_dev_inst *sdi,
-	struct libusb_transfer *xfer)
+static int la2016_usbxfer_submit(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
-	libusb_transfer_cb_fn cb;
-	int ret;
 
-	devc = sdi ? sdi->priv : NULL;
-	usb = sdi ? sdi->conn : NULL;
-	if (!devc || !usb)
-		return SR_ERR_ARG;
-
-	if (!xfer)
-		return SR_ERR_ARG;
+	devc = sdi->priv;
+	usb = sdi->conn;
 
-	cb = receive_transfer;
-	libusb_fill_bulk_transfer(xfer, usb->devhdl,
+	return sr_usb_stream_submit(&devc->usb_stream, usb->devhdl,
 		USB_EP_CAPTURE_DATA | LIBUSB_ENDPOINT_IN,
-		xfer->buffer, devc->transfer_bufsize,
-		cb, (void *)sdi, CAPTURE_TIMEOUT_MS);
-	ret = libusb_submit_transfer(xfer);
-	if (ret != 0) {
-		sr_err("Cannot submit USB transfer: %s.",
-			libusb_error_name(ret));
-		return SR_ERR_IO;
-	}
-
-	return SR_OK;
-}
-
-static int la2016_usbxfer_submit_all(const struct sr_dev_inst *sdi)
-{
-	struct dev_context *devc;
-	GSList *l;
-	struct libusb_transfer *xfer;
-	int ret;
-
-	devc = sdi ? sdi->priv : NULL;
-	if (!devc)
-		return SR_ERR_ARG;
-
-	for (l = devc->transfers; l; l = l->next) {
-		xfer = l->data;
-		if (!xfer)
-			return SR_ERR_ARG;
-		ret = la2016_usbxfer_resubmit(sdi, xfer);
-		if (ret != SR_OK)
-			return ret;
-	}
-
-	return SR_OK;
+		receive_transfer, NULL, (void *)sdi);
 }
 
 SR_PRIV int la2016_setup_acquisition(const struct sr_dev_inst *sdi,
@@ -1211,16 +1079,28 @@ SR_PRIV int la2016_start_acquisition(const struct sr_dev_inst *sdi)
 
 	devc = sdi->priv;
 
-	ret = la2016_usbxfer_allocate(sdi);
-	if (ret != SR_OK)
-		return ret;
+	/*
+	 * Use a fixed pool of USB transfers. Arrange for a buffer size
+	 * which is within the device's capabilities, and is a multiple
+	 * of the USB endpoint's size, to make use of the RAW_IO
+	 * performance feature.
+	 *
+	 * Implementation detail: The LA2016_USB_BUFSZ value happens
+	 * to match all those constraints. The data rate does not
+	 * matter for a fixed pool, the timeout is not rate dependent.
+	 */
+	devc->usb_stream.transfer_size = LA2016_USB_BUFSZ;
+	devc->usb_stream.queue_depth = LA2016_USB_XFER_COUNT;
+	sr_usb_stream_start(&devc->usb_stream, 0, LA2016_EP6_PKTSZ,
+		0, LA2016_USB_XFER_COUNT);
+	devc->usb_stream.timeout = CAPTURE_TIMEOUT_MS;
 
 	if (devc->continuous) {
 		ret = ctrl_out(sdi, CMD_BULK_RESET, 0x00, 0, NULL, 0);
 		if (ret != SR_OK)
 			return ret;
 
-		ret = la2016_usbxfer_submit_all(sdi);
+		ret = la2016_usbxfer_submit(sdi);
 		if (ret != SR_OK)
 			return ret;
 
@@ -1256,13 +1136,15 @@ static int la2016_stop_acquisition(const struct sr_dev_inst *sdi)
 
 SR_PRIV int la2016_abort_acquisition(const struct sr_dev_inst *sdi)
 {
+	struct dev_context *devc;
 	int ret;
 
 	ret = la2016_stop_acquisition(sdi);
 	if (ret != SR_OK)
 		return ret;
 
-	(void)la2016_usbxfer_cancel_all(sdi);
+	devc = sdi->priv;
+	sr_usb_stream_cancel(&devc->usb_stream);
 
 	return SR_OK;
 }
@@ -1306,7 +1188,7 @@ static int la2016_start_download(const struct sr_dev_inst *sdi)
 		return ret;
 	}
 
-	ret = la2016_usbxfer_submit_all(sdi);
+	ret = la2016_usbxfer_submit(sdi);
 	if (ret != SR_OK) {
 		sr_err("Cannot submit USB bulk transfers.");
 		return ret;
@@ -1342,15 +1224,73 @@ static int la2016_start_download(const struct sr_dev_inst *sdi)
  *
  * This implementation silently ignores the (weak) sequence number.
  */
+/* Send the runs which were collected in run length encoded form. */
+static void send_runs(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic_rle rle;
+
+	devc = sdi->priv;
+	if (!devc->rle.num_changes)
+		return;
+
+	rle.num_samples = devc->rle.num_samples;
+	rle.unitsize = devc->rle.unitsize;
+	rle.num_changes = devc->rle.num_changes;
+	rle.offsets = devc->rle.offsets;
+	rle.values = devc->rle.values;
+	packet.type = SR_DF_LOGIC_RLE;
+	packet.payload = &rle;
+	sr_session_send(sdi, &packet);
+
+	devc->rle.num_samples = 0;
+	devc->rle.num_changes = 0;
+}
+
+/*
+ * Submit a run of samples of the same value. The run becomes one change
+ * of a run length encoded packet when the session's consumers take them,
+ * else the feed queue expands it.
+ */
+static void submit_run(struct sr_dev_inst *sdi, uint32_t value, size_t count)
+{
+	struct dev_context *devc;
+	uint8_t sample_buff[sizeof(value)];
+	uint64_t idx;
+
+	devc = sdi->priv;
+	write_u32le(sample_buff, value);
+	if (!devc->rle.active) {
+		feed_queue_logic_submit(devc->feed_queue, sample_buff, count);
+		return;
+	}
+	if (!count)
+		return;
+
+	if (devc->rle.num_changes == devc->rle.size) {
+		devc->rle.size = MAX(1024, 2 * devc->rle.size);
+		devc->rle.offsets = g_realloc_n(devc->rle.offsets,
+			devc->rle.size, sizeof(devc->rle.offsets[0]));
+		devc->rle.values = g_realloc_n(devc->rle.values,
+			devc->rle.size, devc->rle.unitsize);
+	}
+	idx = devc->rle.num_changes++;
+	devc->rle.offsets[idx] = devc->rle.num_samples;
+	memcpy(&devc->rle.values[idx * devc->rle.unitsize], sample_buff,
+		devc->rle.unitsize);
+	devc->rle.num_samples += count;
+}
+
 static void send_chunk(struct sr_dev_inst *sdi,
 	const uint8_t *data_buffer, size_t data_length)
 {
 	struct dev_context *devc;
-	size_t num_xfers, num_pkts, num_seqs;
+	size_t num_xfers, num_pkts;
 	const uint8_t *rp;
-	uint32_t sample_value;
-	size_t repetitions;
-	uint8_t sample_buff[sizeof(sample_value)];
+	gboolean wide;
+	uint32_t sample_value, run_value;
+	size_t repetitions, run_count, chunk_samples;
 
 	devc = sdi->priv;
 
@@ -1373,43 +1313,59 @@ static void send_chunk(struct sr_dev_inst *sdi,
 	else
 		devc->n_bytes_to_read -= data_length;
 
-	/* Process the received chunk of capture data. */
+	/*
+	 * Process the received chunk of capture data. Runs of a value
+	 * frequently span several packets (a packet holds at most 255
+	 * repetitions). Merge them, and submit each run to the session
+	 * feed at once. Consumers which accept run length encoded logic
+	 * get one packet per chunk, with a change per run.
+	 */
+	wide = devc->model->channel_count == 32;
 	sample_value = 0;
+	run_value = 0;
+	run_count = 0;
+	chunk_samples = 0;
 	rp = data_buffer;
 	num_xfers = data_length / devc->transfer_size;
 	while (num_xfers--) {
 		num_pkts = devc->packets_per_chunk;
 		while (num_pkts--) {
-
-			if (devc->model->channel_count == 32)
+			if (wide)
 				sample_value = read_u32le_inc(&rp);
-			else if (devc->model->channel_count == 16)
+			else
 				sample_value = read_u16le_inc(&rp);
 			repetitions = read_u8_inc(&rp);
 
-			devc->total_samples += repetitions;
-
-			write_u32le(sample_buff, sample_value);
-			feed_queue_logic_submit(devc->feed_queue,
-				sample_buff, repetitions);
-			sr_sw_limits_update_samples_read(&devc->sw_limits,
-				repetitions);
+			if (sample_value != run_value && run_count) {
+				submit_run(sdi, run_value, run_count);
+				run_count = 0;
+			}
+			run_value = sample_value;
+			run_count += repetitions;
+			chunk_samples += repetitions;
 
 			if (devc->trigger_involved && !devc->trigger_marked) {
 				if (!--devc->n_reps_until_trigger) {
+					submit_run(sdi, run_value, run_count);
+					run_count = 0;
+					send_runs(sdi);
 					feed_queue_logic_send_trigger(devc->feed_queue);
 					devc->trigger_marked = TRUE;
 					sr_dbg("Trigger position after %" PRIu64 " samples, %.6fms.",
-						devc->total_samples,
-						(double)devc->total_samples / devc->samplerate * 1e3);
+						devc->total_samples + chunk_samples,
+						(double)(devc->total_samples + chunk_samples) /
+						devc->samplerate * 1e3);
 				}
 			}
 		}
 		/* Skip the sequence number bytes. */
-		num_seqs = devc->sequence_size;
-		while (num_seqs--)
-			(void)read_u8_inc(&rp);
+		rp += devc->sequence_size;
 	}
+	if (run_count)
+		submit_run(sdi, run_value, run_count);
+	send_runs(sdi);
+	devc->total_samples += chunk_samples;
+	sr_sw_limits_update_samples_read(&devc->sw_limits, chunk_samples);
 
 	/*
 	 * Check for several conditions which shall terminate the
@@ -1465,12 +1421,14 @@ static void stream_data(struct sr_dev_inst *sdi,
 	size_t bit_count;
 	const uint8_t *rp;
 	uint32_t sample_value;
-	uint8_t sample_buff[sizeof(sample_value)];
+	uint8_t sample_block[16 * sizeof(sample_value)], *wrptr;
 	size_t bit_idx;
 	uint32_t ch_mask;
+	gboolean wide;
 
 	devc = sdi->priv;
 	stream = &devc->stream;
+	wide = devc->model->channel_count == 32;
 
 	/* Ignore incoming USB data after complete sample data download. */
 	if (devc->download_finished)
@@ -1504,11 +1462,16 @@ static void stream_data(struct sr_dev_inst *sdi,
 		stream->channel_index++;
 		if (stream->channel_index != stream->enabled_count)
 			continue;
+		wrptr = sample_block;
 		for (bit_idx = 0; bit_idx < bit_count; bit_idx++) {
 			sample_value = stream->sample_data[bit_idx];
-			write_u32le(sample_buff, sample_value);
-			feed_queue_logic_submit(devc->feed_queue, sample_buff, 1);
+			if (wide)
+				write_u32le_inc(&wrptr, sample_value);
+			else
+				write_u16le_inc(&wrptr, sample_value);
 		}
+		feed_queue_logic_submit_many(devc->feed_queue,
+			sample_block, bit_count);
 		sr_sw_limits_update_samples_read(&devc->sw_limits, bit_count);
 		devc->total_samples += bit_count;
 		memset(stream->sample_data, 0, sizeof(stream->sample_data));
@@ -1538,24 +1501,21 @@ static void stream_data(struct sr_dev_inst *sdi,
 	sr_dbg("Total samples after chunk: %" PRIu64 ".", devc->total_samples);
 }
 
-static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
+static gboolean receive_transfer(struct libusb_transfer *transfer,
+	void *cb_data)
 {
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
-	gboolean was_cancelled, device_gone;
-	int ret;
 
-	sdi = transfer->user_data;
+	sdi = cb_data;
 	devc = sdi->priv;
 
-	was_cancelled = transfer->status == LIBUSB_TRANSFER_CANCELLED;
-	device_gone = transfer->status == LIBUSB_TRANSFER_NO_DEVICE;
 	sr_dbg("receive_transfer(): status %s received %d bytes.",
 		libusb_error_name(transfer->status), transfer->actual_length);
-	if (device_gone) {
+	if (transfer->status == LIBUSB_TRANSFER_NO_DEVICE) {
 		sr_warn("Lost communication to USB device.");
 		devc->download_finished = TRUE;
-		return;
+		return FALSE;
 	}
 
 	/*
@@ -1572,15 +1532,10 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 
 	/*
 	 * Re-submit completed transfers (regardless of timeout or
-	 * data reception), unless the transfer was cancelled when
-	 * the acquisition was terminated or has completed.
+	 * data reception), unless the acquisition has completed.
+	 * Cancelled transfers don't get here.
 	 */
-	if (!was_cancelled && !devc->download_finished) {
-		ret = la2016_usbxfer_resubmit(sdi, transfer);
-		if (ret == SR_OK)
-			return;
-		devc->download_finished = TRUE;
-	}
+	return !devc->download_finished;
 }
 
 SR_PRIV int la2016_receive_data(int fd, int revents, void *cb_data)
@@ -1589,6 +1544,7 @@ SR_PRIV int la2016_receive_data(int fd, int revents, void *cb_data)
 	struct dev_context *devc;
 	struct drv_context *drvc;
 	struct timeval tv;
+	unsigned int tries;
 	int ret;
 
 	(void)fd;
@@ -1688,13 +1644,23 @@ SR_PRIV int la2016_receive_data(int fd, int revents, void *cb_data)
 		la2016_stop_acquisition(sdi);
 		usb_source_remove(sdi->session, drvc->sr_ctx);
 
-		la2016_usbxfer_cancel_all(sdi);
+		/* Wait for cancelled transfers to return. */
+		sr_usb_stream_cancel(&devc->usb_stream);
 		memset(&tv, 0, sizeof(tv));
-		libusb_handle_events_timeout(drvc->sr_ctx->libusb_ctx, &tv);
+		tv.tv_usec = 10 * 1000;
+		tries = CAPTURE_TIMEOUT_MS / 10;
+		do {
+			libusb_handle_events_timeout(drvc->sr_ctx->libusb_ctx, &tv);
+		} while (devc->usb_stream.submitted && tries--);
 
 		feed_queue_logic_flush(devc->feed_queue);
 		feed_queue_logic_free(devc->feed_queue);
 		devc->feed_queue = NULL;
+		g_free(devc->rle.offsets);
+		g_free(devc->rle.values);
+		devc->rle.offsets = NULL;
+		devc->rle.values = NULL;
+		devc->rle.size = 0;
 		if (devc->frame_begin_sent) {
 			std_session_send_df_frame_end(sdi);
 			devc->frame_begin_sent = FALSE;
@@ -1741,7 +1707,7 @@ SR_PRIV int la2016_identify_device(const struct sr_dev_inst *sdi,
 		/* Failed attempt in regular use. Non-fatal. Worth logging. */
 		sr_err("Cannot read manufacture date in EEPROM.");
 	} else {
-		if (sr_log_loglevel_get() >= SR_LOG_SPEW) {
+		if (sr_log_enabled(SR_LOG_SPEW)) {
 			GString *txt;
 			txt = sr_hexdump_new(buf, rdlen);
 			sr_spew("Manufacture date bytes %s.", txt->str);
@@ -1803,7 +1769,7 @@ SR_PRIV int la2016_identify_device(const struct sr_dev_inst *sdi,
 		sr_err("Cannot read EEPROM device identifier bytes.");
 		return ret;
 	}
-	if (sr_log_loglevel_get() >= SR_LOG_SPEW) {
+	if (sr_log_enabled(SR_LOG_SPEW)) {
 		GString *txt;
 		txt = sr_hexdump_new(buf, rdlen);
 		sr_spew("EEPROM magic bytes %s.", txt->str);
@@ -1916,11 +1882,6 @@ SR_PRIV int la2016_deinit_hardware(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
-SR_PRIV void la2016_release_resources(const struct sr_dev_inst *sdi)
-{
-	(void)la2016_usbxfer_release(sdi);
-}
-
 SR_PRIV int la2016_write_pwm_config(const struct sr_dev_inst *sdi, size_t idx)
 {
 	return set_pwm_config(sdi, idx);
@@ -157,8 +157,17 @@ struct dev_context {
 	uint32_t read_pos;
 
 	struct feed_queue_logic *feed_queue;
-	GSList *transfers;
-	size_t transfer_bufsize;
+	/* Merged runs, sent as SR_DF_LOGIC_RLE when consumers accept it. */
+	struct {
+		gboolean active;
+		uint16_t unitsize;
+		uint64_t num_samples;
+		uint64_t num_changes;
+		uint64_t size;
+		uint64_t *offsets;
+		uint8_t *values;
+	} rle;
+	struct sr_usb_stream usb_stream;
 	struct stream_state_t {
 		size_t enabled_count;
 		uint32_t enabled_mask;
@@ -182,6 +191,5 @@ SR_PRIV int la2016_setup_acquisition(const struct sr_dev_inst *sdi,
 SR_PRIV int la2016_start_acquisition(const struct sr_dev_inst *sdi);
 SR_PRIV int la2016_abort_acquisition(const struct sr_dev_inst *sdi);
 SR_PRIV int la2016_receive_data(int fd, int revents, void *cb_data);
-SR_PRIV void la2016_release_resources(const struct sr_dev_inst *sdi);
 
 #endif
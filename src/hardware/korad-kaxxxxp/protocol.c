@@ -475,18 +475,18 @@ SR_PRIV int korad_kaxxxxp_receive_data(int fd, int revents, void *cb_data)
 			devc->cc_mode_2_changed = FALSE;
 		}
 		if (devc->output_enabled_changed) {
-			sr_session_send_meta(sdi, SR_CONF_ENABLED,
-				g_variant_new_boolean(devc->output_enabled));
+			sr_session_send_meta_bool(sdi, SR_CONF_ENABLED,
+				devc->output_enabled);
 			devc->output_enabled_changed = FALSE;
 		}
 		if (devc->ocp_enabled_changed) {
-			sr_session_send_meta(sdi, SR_CONF_OVER_CURRENT_PROTECTION_ENABLED,
-				g_variant_new_boolean(devc->ocp_enabled));
+			sr_session_send_meta_bool(sdi, SR_CONF_OVER_CURRENT_PROTECTION_ENABLED,
+				devc->ocp_enabled);
 			devc->ocp_enabled_changed = FALSE;
 		}
 		if (devc->ovp_enabled_changed) {
-			sr_session_send_meta(sdi, SR_CONF_OVER_VOLTAGE_PROTECTION_ENABLED,
-				g_variant_new_boolean(devc->ovp_enabled));
+			sr_session_send_meta_bool(sdi, SR_CONF_OVER_VOLTAGE_PROTECTION_ENABLED,
+				devc->ovp_enabled);
 			devc->ovp_enabled_changed = FALSE;
 		}
 	}
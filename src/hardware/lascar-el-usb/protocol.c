@@ -392,6 +392,7 @@ static void lascar_el_usb_dispatch(struct sr_dev_inst *sdi, unsigned char *buf,
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
+	GSList ch_node;
 	struct sr_analog_spec spec;
 	struct sr_channel *ch;
 	float *temp, *rh;
@@ -438,7 +439,7 @@ static void lascar_el_usb_dispatch(struct sr_dev_inst *sdi, unsigned char *buf,
 
 		ch = sdi->channels->data;
 		if (ch->enabled) {
-			analog.meaning->channels = g_slist_append(NULL, ch);
+			sr_analog_meaning_channel_set(analog.meaning, &ch_node, ch);
 			analog.meaning->mq = SR_MQ_TEMPERATURE;
 			if (devc->temp_unit == 1) {
 				analog.meaning->unit = SR_UNIT_FAHRENHEIT;
@@ -451,19 +452,17 @@ static void lascar_el_usb_dispatch(struct sr_dev_inst *sdi, unsigned char *buf,
 			}
 			analog.data = (void *)temp;
 			sr_session_send(sdi, &packet);
-			g_slist_free(analog.meaning->channels);
 		}
 
 		ch = sdi->channels->next->data;
 		if (ch->enabled) {
-			analog.meaning->channels = g_slist_append(NULL, ch);
+			sr_analog_meaning_channel_set(analog.meaning, &ch_node, ch);
 			analog.meaning->mq = SR_MQ_RELATIVE_HUMIDITY;
 			analog.meaning->unit = SR_UNIT_PERCENTAGE;
 			analog.encoding->digits = 1;
 			analog.spec->spec_digits = 1;
 			analog.data = (void *)rh;
 			sr_session_send(sdi, &packet);
-			g_slist_free(analog.meaning->channels);
 		}
 
 		g_free(temp);
@@ -477,7 +476,8 @@ static void lascar_el_usb_dispatch(struct sr_dev_inst *sdi, unsigned char *buf,
 		analog.meaning->mq = SR_MQ_CARBON_MONOXIDE;
 		analog.meaning->unit = SR_UNIT_CONCENTRATION;
 		analog.meaning->mqflags = 0;
-		if (!(analog.data = g_try_malloc(sizeof(float) * samples)))
+		if (!(analog.data = sr_session_scratch_get(sdi,
+				sizeof(float) * samples)))
 			break;
 		for (i = 0; i < samples; i++) {
 			s = (buf[i * 2] << 8) | buf[i * 2 + 1];
@@ -486,7 +486,6 @@ static void lascar_el_usb_dispatch(struct sr_dev_inst *sdi, unsigned char *buf,
 				((float *)analog.data)[i] = 0.0;
 		}
 		sr_session_send(sdi, &packet);
-		g_free(analog.data);
 		break;
 	default:
 		/* How did we even get this far? */
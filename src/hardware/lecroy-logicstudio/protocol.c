@@ -241,14 +241,17 @@ static void prep_regw(struct regval *regval, uint8_t reg, uint16_t val)
 	regval->val = val;
 }
 
+static void plan_send_segments(struct dev_context *devc);
+static gboolean submit_bulk_transfer(const struct sr_dev_inst *sdi,
+	struct libusb_transfer *xfer);
+
 static void LIBUSB_CALL handle_fetch_samples_done(struct libusb_transfer *xfer)
 {
 	const struct sr_dev_inst *sdi;
-	struct sr_usb_dev_inst *usb;
 	struct dev_context *devc;
+	int i;
 
 	sdi = xfer->user_data;
-	usb = sdi->conn;
 	devc = sdi->priv;
 
 	g_free(xfer->buffer);
@@ -256,11 +259,15 @@ static void LIBUSB_CALL handle_fetch_samples_done(struct libusb_transfer *xfer)
 
 	libusb_free_transfer(xfer);
 
-	libusb_fill_bulk_transfer(devc->bulk_xfer, usb->devhdl, EP_BULK,
-		devc->fetched_samples, 17 << 10,
-		recv_bulk_transfer, (void *)sdi, USB_TIMEOUT_MS);
+	plan_send_segments(devc);
 
-	libusb_submit_transfer(devc->bulk_xfer);
+	/* Keep several bulk transfers queued. */
+	devc->num_bulk_pending = 0;
+	devc->bulk_pending_bytes = 0;
+	for (i = 0; i < NUM_BULK_XFERS; i++) {
+		if (!submit_bulk_transfer(sdi, devc->bulk_xfers[i]))
+			break;
+	}
 }
 
 static void calc_unk0(uint32_t *a, uint32_t *b)
@@ -421,28 +428,35 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 {
 	struct drv_context *drvc;
 	struct sr_usb_dev_inst *usb;
-	struct sr_resource firmware;
-	uint8_t firmware_chunk[FPGA_FIRMWARE_CHUNK_SIZE];
+	GBytes *firmware;
+	const uint8_t *data;
 	uint8_t upload_succeeded;
-	ssize_t chunk_size;
+	size_t size, pos, chunk_size;
 	int i, r, ret, actual_length;
 
 	drvc = sdi->driver->context;
 	usb = sdi->conn;
 
-	ret = sr_resource_open(drvc->sr_ctx, &firmware,
-			SR_RESOURCE_FIRMWARE, firmware_name);
-
-	if (ret != SR_OK)
-		return ret;
+	firmware = sr_resource_get(drvc->sr_ctx, SR_RESOURCE_FIRMWARE,
+		firmware_name, FPGA_FIRMWARE_SIZE);
+	if (!firmware)
+		return SR_ERR;
 
 	ret = SR_ERR;
+	data = g_bytes_get_data(firmware, &size);
+
+	if (size != FPGA_FIRMWARE_SIZE) {
+		sr_err("Invalid FPGA firmware file size: %zu bytes.", size);
+		goto out;
+	}
 
-	if (firmware.size != FPGA_FIRMWARE_SIZE) {
-		sr_err("Invalid FPGA firmware file size: %" PRIu64 " bytes.",
-			firmware.size);
+	/* Skip the upload when the device runs the bitstream. */
+	if (sr_usb_fpga_bitstream_loaded(sdi, firmware)) {
+		sr_dbg("FPGA firmware '%s' is loaded already.", firmware_name);
+		ret = SR_OK;
 		goto out;
 	}
+	sr_usb_fpga_bitstream_set(sdi, NULL);
 
 	/* Initiate upload. */
 	r = libusb_control_transfer(usb->devhdl, CTRL_OUT,
@@ -455,22 +469,15 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 		goto out;
 	}
 
-	for (;;) {
-		chunk_size = sr_resource_read(drvc->sr_ctx, &firmware,
-			firmware_chunk, sizeof(firmware_chunk));
-
-		if (chunk_size < 0)
-			goto out;
-
-		if (chunk_size == 0)
-			break;
-
+	for (pos = 0; pos < size; pos += chunk_size) {
+		chunk_size = MIN(size - pos, FPGA_FIRMWARE_CHUNK_SIZE);
 		actual_length = chunk_size;
 
 		r = libusb_bulk_transfer(usb->devhdl, EP_BITSTREAM,
-			firmware_chunk, chunk_size, &actual_length, USB_TIMEOUT_MS);
+			(unsigned char *)&data[pos], chunk_size,
+			&actual_length, USB_TIMEOUT_MS);
 
-		if (r != 0 || (ssize_t)actual_length != chunk_size) {
+		if (r != 0 || (size_t)actual_length != chunk_size) {
 			sr_err("FPGA firmware upload failed.");
 			goto out;
 		}
@@ -489,17 +496,18 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 
 		if (r != sizeof(upload_succeeded)) {
 			sr_err("CTRL_IN failed: %i.", r);
-			return SR_ERR;
+			goto out;
 		}
 
 		if (upload_succeeded == 0x01) {
+			sr_usb_fpga_bitstream_set(sdi, firmware);
 			ret = SR_OK;
 			break;
 		}
 	}
 
 out:
-	sr_resource_close(drvc->sr_ctx, &firmware);
+	g_bytes_unref(firmware);
 
 	return ret;
 }
@@ -998,36 +1006,33 @@ static uint16_t sample_to_byte_offset(struct dev_context *devc, uint64_t o)
 	return o * devc->num_enabled_channel_groups;
 }
 
-static void LIBUSB_CALL recv_bulk_transfer(struct libusb_transfer *xfer)
+static void add_send_segment(struct dev_context *devc,
+	uint32_t start, uint32_t length)
 {
-	const struct sr_dev_inst *sdi;
-	struct dev_context *devc;
-	struct drv_context *drvc;
-	uint32_t bytes_left, length;
-	uint16_t read_offset, trigger_offset;
+	struct send_segment *seg;
 
-	sdi = xfer->user_data;
-
-	if (!sdi)
+	if (!length)
 		return;
 
-	drvc = sdi->driver->context;
-	devc = sdi->priv;
-
-	devc->total_received_sample_bytes += xfer->actual_length;
-
-	if (devc->total_received_sample_bytes < SAMPLE_BUF_SIZE) {
-		xfer->buffer = devc->fetched_samples
-			+ devc->total_received_sample_bytes;
-
-		xfer->length = MIN(16 << 10,
-			SAMPLE_BUF_SIZE - devc->total_received_sample_bytes);
+	seg = &devc->send_segments[devc->num_send_segments++];
+	seg->start = start;
+	seg->length = length;
+}
 
-		libusb_submit_transfer(xfer);
-		return;
-	}
+/*
+ * Determine the pieces of the sample buffer in the order they get sent,
+ * from the earliest sample across the trigger position. Doesn't wrap
+ * more than once, so three segments cover all samples.
+ */
+static void plan_send_segments(struct dev_context *devc)
+{
+	uint32_t bytes_left, length;
+	uint16_t read_offset, trigger_offset;
 
-	usb_source_remove(sdi->session, drvc->sr_ctx);
+	devc->num_send_segments = 0;
+	devc->send_segment = 0;
+	devc->send_done = 0;
+	devc->trigger_sent = FALSE;
 
 	read_offset = sample_to_byte_offset(devc, devc->earliest_sample);
 	trigger_offset = sample_to_byte_offset(devc, devc->trigger_sample);
@@ -1043,47 +1048,153 @@ static void LIBUSB_CALL recv_bulk_transfer(struct libusb_transfer *xfer)
 
 	if (trigger_offset < read_offset) {
 		length = MIN(bytes_left, SAMPLE_BUF_SIZE - read_offset);
+		add_send_segment(devc, read_offset, length);
+		bytes_left -= length;
+		read_offset = 0;
+	}
 
-		sr_spew("Sending %u pre-trigger bytes starting at 0x%04hx.",
-			length, read_offset);
+	length = MIN(bytes_left, (uint32_t)(trigger_offset - read_offset));
+	add_send_segment(devc, read_offset, length);
+	bytes_left -= length;
+	read_offset += length;
+	read_offset %= SAMPLE_BUF_SIZE;
 
-		send_samples(sdi, &devc->fetched_samples[read_offset], length);
+	/* Here comes the trigger. */
+	devc->trigger_segment = devc->num_send_segments;
 
+	while (bytes_left > 0) {
+		length = MIN(bytes_left, SAMPLE_BUF_SIZE - read_offset);
+		add_send_segment(devc, read_offset, length);
 		bytes_left -= length;
-		read_offset = 0;
+		read_offset += length;
+		read_offset %= SAMPLE_BUF_SIZE;
 	}
+}
 
-	{
-		length = MIN(bytes_left, (uint32_t)(trigger_offset - read_offset));
+/*
+ * Send what was received of the planned segments. Partially received
+ * segments get sent in whole samples.
+ */
+static void send_received_samples(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct send_segment *seg;
+	uint32_t pos, avail, length;
 
-		sr_spew("Sending %u pre-trigger bytes starting at 0x%04hx.",
-			length, read_offset);
+	devc = sdi->priv;
 
-		send_samples(sdi, &devc->fetched_samples[read_offset], length);
+	while (1) {
+		if (devc->send_segment == devc->trigger_segment &&
+				!devc->trigger_sent) {
+			std_session_send_df_trigger(sdi);
+			devc->trigger_sent = TRUE;
+		}
+		if (devc->send_segment == devc->num_send_segments)
+			break;
 
-		bytes_left -= length;
+		seg = &devc->send_segments[devc->send_segment];
+		pos = seg->start + devc->send_done;
+		avail = MIN(seg->start + seg->length,
+			devc->total_received_sample_bytes);
+		if (avail <= pos)
+			break;
+		length = avail - pos;
+		if (devc->send_done + length < seg->length)
+			length -= length % devc->num_enabled_channel_groups;
+		if (!length)
+			break;
 
-		read_offset += length;
-		read_offset %= SAMPLE_BUF_SIZE;
+		sr_spew("Sending %u %s-trigger bytes starting at 0x%04x.",
+			length, devc->trigger_sent ? "post" : "pre", pos);
+
+		send_samples(sdi, &devc->fetched_samples[pos], length);
+
+		devc->send_done += length;
+		if (devc->send_done == seg->length) {
+			devc->send_segment++;
+			devc->send_done = 0;
+		}
 	}
+}
 
-	/* Here comes the trigger. */
-	std_session_send_df_trigger(sdi);
+/*
+ * (Re-)Submit a bulk transfer for the next part of the sample buffer,
+ * if the transfers in flight don't cover the remainder yet.
+ */
+static gboolean submit_bulk_transfer(const struct sr_dev_inst *sdi,
+	struct libusb_transfer *xfer)
+{
+	struct sr_usb_dev_inst *usb;
+	struct dev_context *devc;
+	uint32_t requested, length;
+	int i;
 
-	/* Send post-trigger samples. */
-	while (bytes_left > 0) {
-		length = MIN(bytes_left, SAMPLE_BUF_SIZE - read_offset);
+	usb = sdi->conn;
+	devc = sdi->priv;
 
-		sr_spew("Sending %u post-trigger bytes starting at 0x%04hx.",
-			length, read_offset);
+	requested = devc->total_received_sample_bytes + devc->bulk_pending_bytes;
+	if (requested >= SAMPLE_BUF_SIZE)
+		return FALSE;
+	length = MIN(BULK_XFER_SIZE, SAMPLE_BUF_SIZE - requested);
 
-		send_samples(sdi, &devc->fetched_samples[read_offset], length);
+	for (i = 0; i < NUM_BULK_XFERS; i++) {
+		if (devc->bulk_xfers[i] == xfer)
+			break;
+	}
 
-		bytes_left -= length;
+	libusb_fill_bulk_transfer(xfer, usb->devhdl, EP_BULK,
+		&devc->bulk_buf[i * BULK_XFER_SIZE], length,
+		recv_bulk_transfer, (void *)sdi, USB_TIMEOUT_MS);
 
-		read_offset += length;
-		read_offset %= SAMPLE_BUF_SIZE;
+	if (libusb_submit_transfer(xfer) < 0) {
+		sr_err("Failed to submit bulk transfer.");
+		return FALSE;
 	}
+	devc->num_bulk_pending++;
+	devc->bulk_pending_bytes += length;
+
+	return TRUE;
+}
+
+static void LIBUSB_CALL recv_bulk_transfer(struct libusb_transfer *xfer)
+{
+	const struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	struct drv_context *drvc;
+	uint32_t length;
+
+	sdi = xfer->user_data;
+
+	if (!sdi)
+		return;
+
+	drvc = sdi->driver->context;
+	devc = sdi->priv;
+
+	devc->num_bulk_pending--;
+	devc->bulk_pending_bytes -= xfer->length;
+
+	/*
+	 * Transfers complete in the order of their submission. Collect
+	 * the data in the sample buffer, and send what can be sent while
+	 * the other transfers are in flight.
+	 */
+	length = MIN((uint32_t)xfer->actual_length,
+		SAMPLE_BUF_SIZE - devc->total_received_sample_bytes);
+	memcpy(&devc->fetched_samples[devc->total_received_sample_bytes],
+		xfer->buffer, length);
+	devc->total_received_sample_bytes += length;
+
+	send_received_samples(sdi);
+
+	if (devc->total_received_sample_bytes < SAMPLE_BUF_SIZE) {
+		submit_bulk_transfer(sdi, xfer);
+		return;
+	}
+	if (devc->num_bulk_pending)
+		return;
+
+	usb_source_remove(sdi->session, drvc->sr_ctx);
 
 	std_session_send_df_end(sdi);
 }
@@ -31,11 +31,31 @@
 #define CONV_8TO16_BUF_SIZE 8192
 #define INTR_BUF_SIZE 32
 
+/*
+ * The sample buffer gets fetched with several bulk transfers in flight,
+ * samples are sent while later transfers are still pending.
+ */
+#define NUM_BULK_XFERS 4
+#define BULK_XFER_SIZE (8 << 10)
+
+/* Pieces of the sample buffer in the order they get sent. */
+#define MAX_SEND_SEGMENTS 4
+
 struct samplerate_info;
 
+struct send_segment {
+	uint32_t start;
+	uint32_t length;
+};
+
 struct dev_context {
 	struct libusb_transfer *intr_xfer;
-	struct libusb_transfer *bulk_xfer;
+	struct libusb_transfer *bulk_xfers[NUM_BULK_XFERS];
+
+	/** Holds NUM_BULK_XFERS buffers of BULK_XFER_SIZE bytes. */
+	uint8_t *bulk_buf;
+	int num_bulk_pending;
+	uint32_t bulk_pending_bytes;
 
 	const struct samplerate_info *samplerate_info;
 
@@ -72,6 +92,18 @@ struct dev_context {
 
 	uint32_t total_received_sample_bytes;
 
+	/**
+	 * The sample buffer is a ring, which starts at the earliest sample.
+	 * The segments get sent as soon as their bytes were received. The
+	 * trigger gets sent before segment trigger_segment.
+	 */
+	struct send_segment send_segments[MAX_SEND_SEGMENTS];
+	size_t num_send_segments;
+	size_t trigger_segment;
+	size_t send_segment;
+	uint32_t send_done;
+	gboolean trigger_sent;
+
 	/** Mask of enabled channels. */
 	uint16_t channel_mask;
 
@@ -213,6 +213,9 @@ static int config_set(uint32_t key, GVariant *data,
 	model = devc->model_config;
 	state = devc->model_state;
 
+	/* Settings may change the waveform's scaling. */
+	lecroy_xstream_wave_cache_reset(devc);
+
 	switch (key) {
 	case SR_CONF_LIMIT_FRAMES:
 		devc->frame_limit = g_variant_get_uint64(data);
@@ -429,6 +432,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	devc->enabled_channels = NULL;
 	state = devc->model_state;
 	state->sample_rate = 0;
+	lecroy_xstream_wave_cache_reset(devc);
 
 	/* Contruct the list of enabled channels. */
 	for (l = sdi->channels; l; l = l->next) {
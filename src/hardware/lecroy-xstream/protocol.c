@@ -23,57 +23,6 @@
 #include "scpi.h"
 #include "protocol.h"
 
-struct lecroy_wavedesc_2_x {
-	uint16_t comm_type;
-	uint16_t comm_order; /* 1 - little endian */
-	uint32_t wave_descriptor_length;
-	uint32_t user_text_len;
-	uint32_t res_desc1;
-	uint32_t trigtime_array_length;
-	uint32_t ris_time1_array_length;
-	uint32_t res_array1;
-	uint32_t wave_array1_length;
-	uint32_t wave_array2_length;
-	uint32_t wave_array3_length;
-	uint32_t wave_array4_length;
-	char instrument_name[16];
-	uint32_t instrument_number;
-	char trace_label[16];
-	uint32_t reserved;
-	uint32_t wave_array_count;
-	uint32_t points_per_screen;
-	uint32_t first_valid_point;
-	uint32_t last_valid_point;
-	uint32_t first_point;
-	uint32_t sparsing_factor;
-	uint32_t segment_index;
-	uint32_t subarray_count;
-	uint32_t sweeps_per_acq;
-	uint16_t points_per_pair;
-	uint16_t pair_offset;
-	float vertical_gain;
-	float vertical_offset;
-	float max_value;
-	float min_value;
-	uint16_t nominal_bits;
-	uint16_t nom_subarray_count;
-	float horiz_interval;
-	double horiz_offset;
-	double pixel_offset;
-	char vertunit[48];
-	char horunit[48];
-	uint32_t reserved1;
-	double trigger_time;
-} __attribute__((packed));
-
-struct lecroy_wavedesc {
-	char descriptor_name[16];
-	char template_name[16];
-	union {
-		struct lecroy_wavedesc_2_x version_2_x;
-	};
-} __attribute__((packed));
-
 static const char *coupling_options[] = {
 	"A1M", ///< AC with 1 MOhm termination
 	"D50", ///< DC with 50 Ohm termination
@@ -350,6 +299,7 @@ SR_PRIV int lecroy_xstream_channel_state_set(const struct sr_dev_inst *sdi,
 				}
 
 				ch->enabled = ch_state;
+				sr_dev_channels_changed(sdi);
 				state->analog_channels[ch->index].state = ch_state;
 				chan_found = TRUE;
 				break;
@@ -539,75 +489,131 @@ SR_PRIV int lecroy_xstream_init_device(struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
-static int lecroy_waveform_2_x_to_analog(GByteArray *data,
-		struct lecroy_wavedesc *desc, struct sr_datafeed_analog *analog)
+/** Invalidate the waveform conversions, after configuration changes. */
+SR_PRIV void lecroy_xstream_wave_cache_reset(struct dev_context *devc)
 {
-	struct sr_analog_encoding *encoding = analog->encoding;
-	struct sr_analog_meaning *meaning = analog->meaning;
-	struct sr_analog_spec *spec = analog->spec;
-	float *data_float;
-	int16_t *waveform_data;
-	unsigned int i, num_samples;
-
-	data_float = g_malloc(desc->version_2_x.wave_array_count * sizeof(float));
-	num_samples = desc->version_2_x.wave_array_count;
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(devc->wave_cache); i++)
+		devc->wave_cache[i].valid = FALSE;
+}
+
+/*
+ * Check a frame's descriptor against the cached one. Only the fields
+ * which the conversion depends on get compared, the sample count and
+ * timing details differ between frames.
+ */
+static gboolean lecroy_wave_cache_match(const struct lecroy_wave_cache *cache,
+		const struct lecroy_wavedesc *desc)
+{
+	const struct lecroy_wavedesc_2_x *a, *b;
+
+	if (!cache->valid)
+		return FALSE;
+
+	a = &cache->desc.version_2_x;
+	b = &desc->version_2_x;
+
+	return !memcmp(cache->desc.template_name, desc->template_name,
+			sizeof(desc->template_name)) &&
+		a->comm_type == b->comm_type &&
+		a->comm_order == b->comm_order &&
+		a->wave_descriptor_length == b->wave_descriptor_length &&
+		a->user_text_len == b->user_text_len &&
+		a->vertical_gain == b->vertical_gain &&
+		a->vertical_offset == b->vertical_offset &&
+		!memcmp(a->vertunit, b->vertunit, sizeof(a->vertunit));
+}
 
-	waveform_data = (int16_t*)(data->data +
-		+ desc->version_2_x.wave_descriptor_length
-		+ desc->version_2_x.user_text_len);
+static int lecroy_wave_cache_update(struct lecroy_wave_cache *cache,
+		const struct lecroy_wavedesc *desc)
+{
+	const struct lecroy_wavedesc_2_x *d;
 
-	for (i = 0; i < num_samples; i++)
-		data_float[i] = (float)waveform_data[i]
-			* desc->version_2_x.vertical_gain
-			+ desc->version_2_x.vertical_offset;
+	cache->valid = FALSE;
 
-	analog->data = data_float;
-	analog->num_samples = num_samples;
+	if (strncmp(desc->template_name, "LECROY_2_2", 16) &&
+	    strncmp(desc->template_name, "LECROY_2_3", 16)) {
+		sr_err("Waveformat template '%.16s' not supported.",
+			desc->template_name);
+		return SR_ERR;
+	}
+	d = &desc->version_2_x;
+
+	/* COMM_TYPE 0 is BYTE, 1 is WORD. */
+	if (d->comm_type > 1) {
+		sr_err("Waveform sample type %u not supported.", d->comm_type);
+		return SR_ERR;
+	}
+	cache->unitsize = d->comm_type ? sizeof(int16_t) : sizeof(int8_t);
+	cache->is_bigendian = d->comm_order == 0;
+
+	/* Samples convert to values with: raw * gain + offset. */
+	sr_rational_from_double(&cache->scale, d->vertical_gain);
+	sr_rational_from_double(&cache->offset, d->vertical_offset);
 
-	encoding->unitsize = sizeof(float);
-	encoding->is_signed = TRUE;
-	encoding->is_float = TRUE;
-	encoding->is_bigendian = FALSE;
-	encoding->scale.p = 1;
-	encoding->scale.q = 1;
-	encoding->offset.p = 0;
-	encoding->offset.q = 1;
-
-	encoding->digits = 6;
-	encoding->is_digits_decimal = FALSE;
-
-	if (strcmp(desc->version_2_x.vertunit, "A")) {
-		meaning->mq = SR_MQ_CURRENT;
-		meaning->unit = SR_UNIT_AMPERE;
+	if (!strncmp(d->vertunit, "A", sizeof(d->vertunit))) {
+		cache->mq = SR_MQ_CURRENT;
+		cache->unit = SR_UNIT_AMPERE;
 	} else {
 		/* Default to voltage. */
-		meaning->mq = SR_MQ_VOLTAGE;
-		meaning->unit = SR_UNIT_VOLT;
+		cache->mq = SR_MQ_VOLTAGE;
+		cache->unit = SR_UNIT_VOLT;
 	}
 
-	meaning->mqflags = 0;
-	spec->spec_digits = 3;
+	cache->desc = *desc;
+	cache->valid = TRUE;
+	sr_dbg("Waveform: %u bit samples, gain %g, offset %g, unit '%.48s'.",
+		cache->unitsize * 8, d->vertical_gain, d->vertical_offset,
+		d->vertunit);
 
 	return SR_OK;
 }
 
+/*
+ * Have the analog packet reference the raw samples in the received
+ * block. The cached descriptor provides the encoding.
+ */
 static int lecroy_waveform_to_analog(GByteArray *data,
-		struct sr_datafeed_analog *analog)
+		struct lecroy_wave_cache *cache, struct sr_datafeed_analog *analog)
 {
-	struct lecroy_wavedesc *desc;
+	const struct lecroy_wavedesc *desc;
+	size_t start, num_samples;
 
 	if (data->len < sizeof(struct lecroy_wavedesc))
 		return SR_ERR;
 
-	desc = (struct lecroy_wavedesc*)data->data;
+	desc = (const struct lecroy_wavedesc *)data->data;
+	if (!lecroy_wave_cache_match(cache, desc)) {
+		if (lecroy_wave_cache_update(cache, desc) != SR_OK)
+			return SR_ERR;
+	}
 
-	if (!strncmp(desc->template_name, "LECROY_2_2", 16) ||
-	    !strncmp(desc->template_name, "LECROY_2_3", 16)) {
-		return lecroy_waveform_2_x_to_analog(data, desc, analog);
+	start = (size_t)desc->version_2_x.wave_descriptor_length
+		+ desc->version_2_x.user_text_len;
+	num_samples = desc->version_2_x.wave_array_count;
+	if (start > data->len ||
+	    num_samples > (data->len - start) / cache->unitsize) {
+		sr_err("Waveform block too short for %zu samples.", num_samples);
+		return SR_ERR;
 	}
 
-	sr_err("Waveformat template '%.16s' not supported.", desc->template_name);
-	return SR_ERR;
+	analog->data = data->data + start;
+	analog->num_samples = num_samples;
+
+	analog->encoding->unitsize = cache->unitsize;
+	analog->encoding->is_signed = TRUE;
+	analog->encoding->is_float = FALSE;
+	analog->encoding->is_bigendian = cache->is_bigendian;
+	analog->encoding->scale = cache->scale;
+	analog->encoding->offset = cache->offset;
+
+	analog->meaning->mq = cache->mq;
+	analog->meaning->unit = cache->unit;
+	analog->meaning->mqflags = 0;
+	analog->spec->spec_digits = 3;
+
+	return SR_OK;
 }
 
 SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
@@ -646,15 +652,15 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 		return TRUE;
 	}
 
-	analog.encoding = &encoding;
-	analog.meaning = &meaning;
-	analog.spec = &spec;
+	sr_analog_init(&analog, &encoding, &meaning, &spec, 6);
 
-	if (lecroy_waveform_to_analog(data, &analog) != SR_OK)
+	if (lecroy_waveform_to_analog(data, &devc->wave_cache[ch->index],
+			&analog) != SR_OK) {
+		g_byte_array_free(data, TRUE);
 		return SR_ERR;
+	}
 
 	if (analog.num_samples == 0) {
-		g_free(analog.data);
 		g_byte_array_free(data, TRUE);
 
 		/* No data available, we have to acquire data first. */
@@ -667,7 +673,6 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 		/* Update sample rate if needed. */
 		if (state->sample_rate == 0)
 			if (lecroy_xstream_update_sample_rate(sdi, analog.num_samples) != SR_OK) {
-				g_free(analog.data);
 				g_byte_array_free(data, TRUE);
 				return SR_ERR;
 			}
@@ -689,7 +694,6 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 	data = NULL;
 
 	g_slist_free(meaning.channels);
-	g_free(analog.data);
 
 	/*
 	 * Advance to the next enabled channel. When data for all enabled
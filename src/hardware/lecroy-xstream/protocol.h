@@ -32,6 +32,57 @@
 #define MAX_COMMAND_SIZE 48
 #define MAX_ANALOG_CHANNEL_COUNT 4
 
+struct lecroy_wavedesc_2_x {
+	uint16_t comm_type;
+	uint16_t comm_order; /* 1 - little endian */
+	uint32_t wave_descriptor_length;
+	uint32_t user_text_len;
+	uint32_t res_desc1;
+	uint32_t trigtime_array_length;
+	uint32_t ris_time1_array_length;
+	uint32_t res_array1;
+	uint32_t wave_array1_length;
+	uint32_t wave_array2_length;
+	uint32_t wave_array3_length;
+	uint32_t wave_array4_length;
+	char instrument_name[16];
+	uint32_t instrument_number;
+	char trace_label[16];
+	uint32_t reserved;
+	uint32_t wave_array_count;
+	uint32_t points_per_screen;
+	uint32_t first_valid_point;
+	uint32_t last_valid_point;
+	uint32_t first_point;
+	uint32_t sparsing_factor;
+	uint32_t segment_index;
+	uint32_t subarray_count;
+	uint32_t sweeps_per_acq;
+	uint16_t points_per_pair;
+	uint16_t pair_offset;
+	float vertical_gain;
+	float vertical_offset;
+	float max_value;
+	float min_value;
+	uint16_t nominal_bits;
+	uint16_t nom_subarray_count;
+	float horiz_interval;
+	double horiz_offset;
+	double pixel_offset;
+	char vertunit[48];
+	char horunit[48];
+	uint32_t reserved1;
+	double trigger_time;
+} __attribute__((packed));
+
+struct lecroy_wavedesc {
+	char descriptor_name[16];
+	char template_name[16];
+	union {
+		struct lecroy_wavedesc_2_x version_2_x;
+	};
+} __attribute__((packed));
+
 struct scope_config {
 	const char *name[MAX_INSTRUMENT_VERSIONS];
 	const uint8_t analog_channels;
@@ -77,9 +128,26 @@ struct scope_state {
 	uint64_t sample_rate;
 };
 
+/*
+ * A channel's waveform conversion, derived from its WAVEDESC block. It
+ * stays valid until the configuration changes, or a descriptor does not
+ * match the cached one.
+ */
+struct lecroy_wave_cache {
+	gboolean valid;
+	struct lecroy_wavedesc desc;
+	uint8_t unitsize;
+	gboolean is_bigendian;
+	struct sr_rational scale;
+	struct sr_rational offset;
+	enum sr_mq mq;
+	enum sr_unit unit;
+};
+
 struct dev_context {
 	const void *model_config;
 	void *model_state;
+	struct lecroy_wave_cache wave_cache[MAX_ANALOG_CHANNEL_COUNT];
 
 	struct sr_channel_group **analog_groups;
 
@@ -93,6 +161,7 @@ struct dev_context {
 SR_PRIV int lecroy_xstream_init_device(struct sr_dev_inst *sdi);
 SR_PRIV int lecroy_xstream_request_data(const struct sr_dev_inst *sdi);
 SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data);
+SR_PRIV void lecroy_xstream_wave_cache_reset(struct dev_context *devc);
 
 SR_PRIV void lecroy_xstream_state_free(struct scope_state *state);
 SR_PRIV int lecroy_xstream_state_get(struct sr_dev_inst *sdi);
@@ -146,6 +146,7 @@ static void mastech_ms6514_data(struct sr_dev_inst *sdi, const uint8_t *buf)
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
+	GSList ch_node;
 	struct sr_analog_spec spec;
 	struct sr_channel *ch;
 	float value;
@@ -172,14 +173,13 @@ static void mastech_ms6514_data(struct sr_dev_inst *sdi, const uint8_t *buf)
 		analog.meaning->unit = mastech_ms6514_unit(buf);
 		analog.meaning->mqflags = mastech_ms6514_flags(buf, i);
 		
-		analog.meaning->channels = g_slist_append(NULL,
+		sr_analog_meaning_channel_set(analog.meaning, &ch_node,
 			g_slist_nth_data(sdi->channels,
 			mastech_ms6514_channel_assignment(buf, i)));
 
 		packet.type = SR_DF_ANALOG;
 		packet.payload = &analog;
 		sr_session_send(sdi, &packet);
-		g_slist_free(analog.meaning->channels);
 	}
 
 	sr_sw_limits_update_samples_read(&devc->limits, 1);
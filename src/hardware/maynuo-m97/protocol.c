@@ -131,10 +131,11 @@ static void maynuo_m97_session_send_value(const struct sr_dev_inst *sdi, struct
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
+	GSList ch_node;
 	struct sr_analog_spec spec;
 
 	sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
-	analog.meaning->channels = g_slist_append(NULL, ch);
+	sr_analog_meaning_channel_set(analog.meaning, &ch_node, ch);
 	analog.num_samples = 1;
 	analog.data = &value;
 	analog.meaning->mq = mq;
@@ -144,7 +145,6 @@ static void maynuo_m97_session_send_value(const struct sr_dev_inst *sdi, struct
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &analog;
 	sr_session_send(sdi, &packet);
-	g_slist_free(analog.meaning->channels);
 }
 
 SR_PRIV int maynuo_m97_capture_start(const struct sr_dev_inst *sdi)
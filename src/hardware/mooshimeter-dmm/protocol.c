@@ -18,7 +18,9 @@
  */
 
 #include <config.h>
+#include <errno.h>
 #include <gio/gio.h>
+#include <stdio.h>
 #include <math.h>
 #include <string.h>
 #include "protocol.h"
@@ -125,6 +127,10 @@
  * data back to ADMIN:CRC32 (which the meter will echo back). Only after
  * that is done will the meter accept access to the rest of the tree.
  *
+ * Reading ADMIN:CRC32 first gets the CRC of the meter's tree. When a copy
+ * of that tree is cached on disk, it need not be read over the (slow) BLE
+ * link again, the handshake then only writes the CRC back.
+ *
  * After zlib decompression the tree serialization is as follows:
  *
  * | Type         | Description                         |
@@ -696,7 +702,9 @@ static void chX_buffer_update(struct config_tree_node *node,
 
 	sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
 
-	values = g_new0(float, number_of_samples);
+	values = sr_session_scratch_get(sdi, number_of_samples * sizeof(float));
+	if (!values)
+		return;
 	output_value = values;
 
 	memcpy(analog.meaning, &devc->channel_meaning[channel],
@@ -741,8 +749,6 @@ static void chX_buffer_update(struct config_tree_node *node,
 
 	sr_session_send(sdi, &packet);
 
-	g_free(values);
-
 	if (devc->channel_autorange[channel])
 		(*devc->channel_autorange[channel])(sdi, maximum_value);
 
@@ -1135,26 +1141,71 @@ static void startup_send_tree_crc(struct startup_context *ctx)
 	set_tree_integer(ctx->sdi, target, ctx->crc);
 }
 
-static uint32_t crc32(const uint8_t *ptr, size_t size)
+/*
+ * The config tree only changes with the meter's firmware. Keep the
+ * compressed tree on disk, named after its CRC, which the meter reports
+ * before sending the tree. The contents are checked against the name,
+ * a stale or damaged file gets ignored.
+ */
+static char *tree_cache_path(uint32_t crc)
 {
-	uint32_t result = 0xFFFFFFFF;
-	uint32_t t;
-	for (; size; size--, ptr++) {
-		result ^= *ptr;
-		for (int i = 0; i < 8; i++) {
-			t = result & 1;
-			result >>= 1;
-			if (t)
-				result ^= 0xEDB88320;
-		}
+	char name[16];
+
+	snprintf(name, sizeof(name), "%08X.tree", crc);
+
+	return g_build_filename(g_get_user_cache_dir(), "libsigrok",
+		"mooshimeter-dmm", name, NULL);
+}
+
+static GByteArray *tree_cache_load(uint32_t crc)
+{
+	char *path, *contents;
+	gsize length;
+	GByteArray *tree;
+
+	path = tree_cache_path(crc);
+	if (!g_file_get_contents(path, &contents, &length, NULL)) {
+		g_free(path);
+		return NULL;
 	}
+	if (sr_crc32(0, (const uint8_t *)contents, length) != crc) {
+		sr_dbg("Ignoring damaged tree cache %s.", path);
+		g_free(contents);
+		g_free(path);
+		return NULL;
+	}
+	g_free(path);
+	tree = g_byte_array_new_take((guint8 *)contents, length);
 
-	return ~result;
+	return tree;
 }
 
-static void startup_tree_updated(struct config_tree_node *node, void *param)
+static void tree_cache_store(uint32_t crc, const GByteArray *tree)
+{
+	char *path, *dir;
+	GError *err;
+
+	path = tree_cache_path(crc);
+	dir = g_path_get_dirname(path);
+	err = NULL;
+	if (g_mkdir_with_parents(dir, 0700) != 0 ||
+			!g_file_set_contents(path, (const char *)tree->data,
+			tree->len, &err))
+		sr_dbg("Cannot store tree cache %s: %s.", path,
+			err ? err->message : g_strerror(errno));
+	if (err)
+		g_error_free(err);
+	g_free(dir);
+	g_free(path);
+}
+
+/*
+ * Decompress and deserialize a config tree, which replaces the current
+ * tree. The data must not be part of the current tree.
+ */
+static int startup_load_tree(struct startup_context *ctx,
+	const uint8_t *tree, size_t len)
 {
-	struct startup_context *ctx = param;
 	struct dev_context *devc = ctx->sdi->priv;
 
 	GConverter *decompressor;
@@ -1169,7 +1220,7 @@ static void startup_tree_updated(struct config_tree_node *node, void *param)
 	size_t size;
 	struct config_tree_node *target;
 
-	ctx->crc = crc32(node->value.b->data, node->value.b->len);
+	ctx->crc = sr_crc32(0, tree, len);
 
 	tree_data = g_byte_array_new();
 	g_byte_array_set_size(tree_data, 4096);
@@ -1178,8 +1229,8 @@ static void startup_tree_updated(struct config_tree_node *node, void *param)
 	for (;;) {
 		g_converter_reset(decompressor);
 		decompress_result = g_converter_convert(decompressor,
-			node->value.b->data,
-			node->value.b->len,
+			tree,
+			len,
 			tree_data->data,
 			tree_data->len,
 			G_CONVERTER_INPUT_AT_END,
@@ -1193,20 +1244,23 @@ static void startup_tree_updated(struct config_tree_node *node, void *param)
 				tree_data->len < 1024 * 1024) {
 				g_byte_array_set_size(tree_data,
 					tree_data->len * 2);
+				g_clear_error(&err);
 				continue;
 			}
 			sr_err("Tree decompression failed: %s.", err->message);
+			g_error_free(err);
 		} else {
 			sr_err("Tree decompression error %d.",
 				(int)decompress_result);
 		}
-		startup_failed(ctx, SR_ERR_DATA);
-		return;
+		g_object_unref(decompressor);
+		g_byte_array_free(tree_data, TRUE);
+		return SR_ERR_DATA;
 	}
 	g_object_unref(decompressor);
 
-	sr_dbg("Config tree received (%d -> %d bytes) with CRC %08X.",
-		node->value.b->len, (int)output_size,
+	sr_dbg("Config tree loaded (%d -> %d bytes) with CRC %08X.",
+		(int)len, (int)output_size,
 		ctx->crc);
 
 	release_tree_node(&devc->tree_root);
@@ -1221,8 +1275,7 @@ static void startup_tree_updated(struct config_tree_node *node, void *param)
 
 	if (res != SR_OK) {
 		sr_err("Tree deserialization failed.");
-		startup_failed(ctx, res);
-		return;
+		return res;
 	}
 
 	if ((target = lookup_tree_path(devc, "ADMIN:DIAGNOSTIC"))) {
@@ -1230,9 +1283,77 @@ static void startup_tree_updated(struct config_tree_node *node, void *param)
 		target->on_update_param = ctx->sdi;
 	}
 
+	return SR_OK;
+}
+
+static void startup_tree_updated(struct config_tree_node *node, void *param)
+{
+	struct startup_context *ctx = param;
+	GByteArray *tree;
+	int res;
+
+	/* Loading releases the node, and its data. */
+	tree = g_byte_array_sized_new(node->value.b->len);
+	g_byte_array_append(tree, node->value.b->data, node->value.b->len);
+	res = startup_load_tree(ctx, tree->data, tree->len);
+	if (res != SR_OK) {
+		g_byte_array_free(tree, TRUE);
+		startup_failed(ctx, res);
+		return;
+	}
+	tree_cache_store(ctx->crc, tree);
+	g_byte_array_free(tree, TRUE);
+
 	startup_send_tree_crc(ctx);
 }
 
+static void startup_request_tree(struct startup_context *ctx)
+{
+	struct dev_context *devc = ctx->sdi->priv;
+
+	release_tree_node(&devc->tree_root);
+	memset(&devc->tree_root, 0, sizeof(struct config_tree_node));
+	memset(devc->tree_id_lookup, 0, sizeof(devc->tree_id_lookup));
+
+	allocate_startup_tree(devc);
+	devc->tree_id_lookup[1]->on_update = startup_tree_updated;
+	devc->tree_id_lookup[1]->on_update_param = ctx;
+	devc->tree_id_lookup[2]->on_update = tree_diagnostic_updated;
+	devc->tree_id_lookup[2]->on_update_param = ctx->sdi;
+
+	if (poll_tree_value(ctx->sdi, devc->tree_id_lookup[1]) != SR_OK)
+		startup_failed(ctx, SR_ERR_IO);
+}
+
+/*
+ * The meter reports the CRC of its tree. A cached copy of the tree
+ * saves downloading it, otherwise request the tree.
+ */
+static void startup_tree_crc_received(struct config_tree_node *node,
+	void *param)
+{
+	struct startup_context *ctx = param;
+	GByteArray *tree;
+	uint32_t crc;
+	int res;
+
+	node->on_update = NULL;
+
+	crc = (uint32_t)get_tree_integer(node);
+	tree = crc ? tree_cache_load(crc) : NULL;
+	if (tree) {
+		sr_dbg("Using cached config tree with CRC %08X.", crc);
+		res = startup_load_tree(ctx, tree->data, tree->len);
+		g_byte_array_free(tree, TRUE);
+		if (res == SR_OK) {
+			startup_send_tree_crc(ctx);
+			return;
+		}
+	}
+
+	startup_request_tree(ctx);
+}
+
 static void release_rx_buffer(void *data)
 {
 	GByteArray *ba = data;
@@ -1265,6 +1386,9 @@ SR_PRIV int mooshimeter_dmm_open(const struct sr_dev_inst *sdi)
 	if (ret < 0)
 		return SR_ERR;
 
+	/* Short intervals, for the buffered high rate modes. */
+	sr_bt_config_conn_interval(desc, 7500, 15000);
+
 	ret = sr_bt_connect_ble(desc);
 	if (ret < 0)
 		return SR_ERR;
@@ -1277,6 +1401,8 @@ SR_PRIV int mooshimeter_dmm_open(const struct sr_dev_inst *sdi)
 	ctx.sdi = (struct sr_dev_inst *)sdi;
 
 	allocate_startup_tree(devc);
+	devc->tree_id_lookup[0]->on_update = startup_tree_crc_received;
+	devc->tree_id_lookup[0]->on_update_param = &ctx;
 	devc->tree_id_lookup[1]->on_update = startup_tree_updated;
 	devc->tree_id_lookup[1]->on_update_param = &ctx;
 	devc->tree_id_lookup[2]->on_update = tree_diagnostic_updated;
@@ -1284,7 +1410,7 @@ SR_PRIV int mooshimeter_dmm_open(const struct sr_dev_inst *sdi)
 
 	sr_spew("Initiating startup handshake.");
 
-	ret = poll_tree_value(sdi, devc->tree_id_lookup[1]);
+	ret = poll_tree_value(sdi, devc->tree_id_lookup[0]);
 	if (ret != SR_OK)
 		return ret;
 
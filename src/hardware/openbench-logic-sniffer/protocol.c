@@ -341,27 +341,199 @@ SR_PRIV int ols_set_samplerate(const struct sr_dev_inst *sdi,
 
 SR_PRIV void abort_acquisition(const struct sr_dev_inst *sdi)
 {
+	struct dev_context *devc;
 	struct sr_serial_dev_inst *serial;
 
+	devc = sdi->priv;
 	serial = sdi->conn;
 	ols_send_reset(serial);
 
+	if (devc->raw_data) {
+		g_byte_array_free(devc->raw_data, TRUE);
+		devc->raw_data = NULL;
+	}
+
 	serial_source_remove(sdi->session, serial);
 
 	std_session_send_df_end(sdi);
 }
 
+/*
+ * Determine the layout of received sample words. Only enabled channel
+ * groups get transferred, in ascending order, and the most significant
+ * bit of the last received byte marks RLE count words.
+ */
+static void ols_setup_words(struct dev_context *devc)
+{
+	size_t i;
+
+	devc->num_changroups = 0;
+	for (i = 0; i < 4; i++) {
+		if (devc->capture_flags & (CAPTURE_FLAG_DISABLE_CHANGROUP_1 << i))
+			continue;
+		devc->changroup_shift[devc->num_changroups++] = i * 8;
+	}
+
+	devc->rle_flag = 0;
+	if (devc->num_changroups && (devc->capture_flags & CAPTURE_FLAG_RLE))
+		devc->rle_flag = 0x80U << ((devc->num_changroups - 1) * 8);
+}
+
+/* Get a (little endian) word of the enabled channel groups. */
+static uint32_t ols_read_word(const uint8_t *p, size_t num_changroups)
+{
+	uint32_t word;
+
+	if (num_changroups == 4)
+		return RL32(p);
+
+	word = 0;
+	while (num_changroups--)
+		word = (word << 8) | p[num_changroups];
+
+	return word;
+}
+
+/*
+ * Some channel groups may have been turned off, to speed up transfer
+ * between the hardware and the PC. Expand the received word before
+ * submitting it over the session bus -- whatever is listening on the
+ * bus will be expecting a full 32-bit sample.
+ */
+static uint32_t ols_expand_word(const struct dev_context *devc, uint32_t word)
+{
+	uint32_t sample;
+	size_t i;
+
+	if (devc->num_changroups == 4)
+		return word;
+
+	sample = 0;
+	for (i = 0; i < devc->num_changroups; i++, word >>= 8)
+		sample |= (word & 0xff) << devc->changroup_shift[i];
+
+	return sample;
+}
+
+/*
+ * Account for the complete words which were received so far. Count
+ * words only get inspected here, the data is kept in wire format until
+ * the acquisition completes. Data beyond the sample limit is dropped.
+ */
+static void ols_scan_words(struct dev_context *devc)
+{
+	const uint8_t *p;
+	size_t n;
+	uint32_t word;
+
+	n = devc->num_changroups;
+	while (devc->raw_used + n <= devc->raw_data->len) {
+		if (devc->num_samples >= devc->limit_samples)
+			break;
+		p = &devc->raw_data->data[devc->raw_used];
+		word = ols_read_word(p, n);
+		devc->raw_used += n;
+		devc->cnt_samples++;
+		devc->cnt_samples_rle++;
+		if (word & devc->rle_flag) {
+			/*
+			 * In RLE mode the high bit of the sample is the
+			 * "count" flag, meaning this sample is the number
+			 * of times the previous sample occurred.
+			 */
+			devc->rle_count = word & ~devc->rle_flag;
+			devc->cnt_samples_rle += devc->rle_count;
+			continue;
+		}
+		devc->num_samples += devc->rle_count + 1;
+		devc->rle_count = 0;
+		if (devc->num_samples > devc->limit_samples) {
+			/* Only part of the oldest sample's run gets sent. */
+			devc->rle_skip = devc->num_samples - devc->limit_samples;
+			devc->num_samples = devc->limit_samples;
+		}
+	}
+
+	if (devc->num_samples >= devc->limit_samples)
+		g_byte_array_set_size(devc->raw_data, devc->raw_used);
+}
+
+/*
+ * The OLS sends its sample buffer backwards. Walk the received words
+ * from the end, and send the samples in chronological order. A count
+ * word precedes the sample which it repeats, runs are expanded by the
+ * feed queue's fill.
+ */
+static int ols_send_samples(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct feed_queue_logic *q;
+	const uint8_t *data;
+	uint8_t sample[4];
+	size_t n, pos;
+	uint32_t word, prev;
+	uint64_t count, chunk, sent, trigger_pos;
+	unsigned int skip;
+	gboolean trigger_pending;
+	int ret;
+
+	devc = sdi->priv;
+	q = feed_queue_logic_alloc(sdi, FEED_CHUNK_SAMPLES, sizeof(sample));
+	if (!q)
+		return SR_ERR_MALLOC;
+
+	trigger_pending = devc->trigger_at_smpl != OLS_NO_TRIGGER;
+	trigger_pos = MAX(devc->trigger_at_smpl, 0);
+	skip = devc->rle_skip;
+	n = devc->num_changroups;
+	data = devc->raw_data->data;
+	pos = devc->raw_used;
+	sent = 0;
+	ret = SR_OK;
+	while (ret == SR_OK && pos >= n) {
+		pos -= n;
+		word = ols_read_word(&data[pos], n);
+		if (word & devc->rle_flag)
+			continue;
+		count = 1;
+		if (pos >= n) {
+			prev = ols_read_word(&data[pos - n], n);
+			if (prev & devc->rle_flag)
+				count += prev & ~devc->rle_flag;
+		}
+		count -= MIN(count, skip);
+		skip = 0;
+		WL32(sample, ols_expand_word(devc, word));
+		while (ret == SR_OK && count) {
+			if (trigger_pending && sent == trigger_pos) {
+				ret = feed_queue_logic_send_trigger(q);
+				trigger_pending = FALSE;
+				continue;
+			}
+			chunk = count;
+			if (trigger_pending)
+				chunk = MIN(chunk, trigger_pos - sent);
+			ret = feed_queue_logic_submit(q, sample, chunk);
+			sent += chunk;
+			count -= chunk;
+		}
+	}
+	if (ret == SR_OK && trigger_pending)
+		ret = feed_queue_logic_send_trigger(q);
+	if (ret == SR_OK)
+		ret = feed_queue_logic_flush(q);
+	feed_queue_logic_free(q);
+
+	return ret;
+}
+
 SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 {
 	struct dev_context *devc;
 	struct sr_dev_inst *sdi;
 	struct sr_serial_dev_inst *serial;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
-	uint32_t sample;
-	int num_changroups, offset, j;
-	unsigned int i;
-	unsigned char byte;
+	size_t len;
+	int ret;
 
 	(void)fd;
 
@@ -375,164 +547,41 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 	}
 
 	if (devc->num_transfers++ == 0) {
-		devc->raw_sample_buf = g_try_malloc(devc->limit_samples * 4);
-		if (!devc->raw_sample_buf) {
-			sr_err("Sample buffer malloc failed.");
+		ols_setup_words(devc);
+		if (!devc->num_changroups) {
+			sr_err("No channel groups enabled.");
 			return FALSE;
 		}
-		/* fill with 1010... for debugging */
-		memset(devc->raw_sample_buf, 0x82, devc->limit_samples * 4);
-	}
-
-	num_changroups = 0;
-	for (i = 0x20; i > 0x02; i >>= 1) {
-		if ((devc->capture_flags & i) == 0) {
-			num_changroups++;
-		}
+		devc->raw_data = g_byte_array_new();
+		devc->raw_used = 0;
 	}
 
 	if (revents == G_IO_IN && devc->num_samples < devc->limit_samples) {
-		if (serial_read_nonblocking(serial, &byte, 1) != 1)
+		/* Append what is available to the received data. */
+		len = devc->raw_data->len;
+		g_byte_array_set_size(devc->raw_data, len + RECEIVE_CHUNK_SIZE);
+		ret = serial_read_nonblocking(serial, &devc->raw_data->data[len],
+			RECEIVE_CHUNK_SIZE);
+		g_byte_array_set_size(devc->raw_data, len + MAX(ret, 0));
+		if (ret < 0)
 			return FALSE;
-		devc->cnt_bytes++;
-
-		/* Ignore it if we've read enough. */
-		if (devc->num_samples >= devc->limit_samples)
-			return TRUE;
-
-		devc->sample[devc->num_bytes++] = byte;
-		sr_spew("Received byte 0x%.2x.", byte);
-		if (devc->num_bytes == num_changroups) {
-			devc->cnt_samples++;
-			devc->cnt_samples_rle++;
-			/*
-			 * Got a full sample. Convert from the OLS's little-endian
-			 * sample to the local format.
-			 */
-			sample = devc->sample[0] | (devc->sample[1] << 8) |
-				 (devc->sample[2] << 16) |
-				 (devc->sample[3] << 24);
-			sr_dbg("Received sample 0x%.*x.", devc->num_bytes * 2,
-			       sample);
-			if (devc->capture_flags & CAPTURE_FLAG_RLE) {
-				/*
-				 * In RLE mode the high bit of the sample is the
-				 * "count" flag, meaning this sample is the number
-				 * of times the previous sample occurred.
-				 */
-				if (devc->sample[devc->num_bytes - 1] & 0x80) {
-					/* Clear the high bit. */
-					sample &= ~(0x80 << (devc->num_bytes -
-							     1) * 8);
-					devc->rle_count = sample;
-					devc->cnt_samples_rle +=
-						devc->rle_count;
-					sr_dbg("RLE count: %u.",
-					       devc->rle_count);
-					devc->num_bytes = 0;
-					return TRUE;
-				}
-			}
-			devc->num_samples += devc->rle_count + 1;
-			if (devc->num_samples > devc->limit_samples) {
-				/* Save us from overrunning the buffer. */
-				devc->rle_count -=
-					devc->num_samples - devc->limit_samples;
-				devc->num_samples = devc->limit_samples;
-			}
-
-			if (num_changroups < 4) {
-				/*
-				 * Some channel groups may have been turned
-				 * off, to speed up transfer between the
-				 * hardware and the PC. Expand that here before
-				 * submitting it over the session bus --
-				 * whatever is listening on the bus will be
-				 * expecting a full 32-bit sample, based on
-				 * the number of channels.
-				 */
-				j = 0;
-				uint8_t tmp_sample[4] = { 0, 0, 0, 0 };
-				for (i = 0; i < 4; i++) {
-					if (((devc->capture_flags >> 2) &
-					     (1 << i)) == 0) {
-						/*
-						 * This channel group was
-						 * enabled, copy from received
-						 * sample.
-						 */
-						tmp_sample[i] =
-							devc->sample[j++];
-					}
-				}
-				memcpy(devc->sample, tmp_sample, 4);
-				sr_spew("Expanded sample: 0x%.2hhx%.2hhx%.2hhx%.2hhx ",
-					devc->sample[3], devc->sample[2],
-					devc->sample[1], devc->sample[0]);
-			}
-
-			/*
-			 * the OLS sends its sample buffer backwards.
-			 * store it in reverse order here, so we can dump
-			 * this on the session bus later.
-			 */
-			offset = (devc->limit_samples - devc->num_samples) * 4;
-			for (i = 0; i <= devc->rle_count; i++) {
-				memcpy(devc->raw_sample_buf + offset + (i * 4),
-				       devc->sample, 4);
-			}
-			memset(devc->sample, 0, 4);
-			devc->num_bytes = 0;
-			devc->rle_count = 0;
-		}
+		devc->cnt_bytes += ret;
+		sr_spew("Received %d bytes.", ret);
+		ols_scan_words(devc);
 	} else {
 		/*
 		 * This is the main loop telling us a timeout was reached, or
 		 * we've acquired all the samples we asked for -- we're done.
-		 * Send the (properly-ordered) buffer to the frontend.
+		 * Send the (properly-ordered) samples to the frontend.
 		 */
 		sr_dbg("Received %d bytes, %d samples, %d decompressed samples.",
 		       devc->cnt_bytes, devc->cnt_samples,
 		       devc->cnt_samples_rle);
-		if (devc->trigger_at_smpl != OLS_NO_TRIGGER) {
-			/*
-			 * A trigger was set up, so we need to tell the frontend
-			 * about it.
-			 */
-			if (devc->trigger_at_smpl > 0) {
-				/* There are pre-trigger samples, send those first. */
-				packet.type = SR_DF_LOGIC;
-				packet.payload = &logic;
-				logic.length = devc->trigger_at_smpl * 4;
-				logic.unitsize = 4;
-				logic.data = devc->raw_sample_buf +
-					     (devc->limit_samples -
-					      devc->num_samples) *
-						     4;
-				sr_session_send(sdi, &packet);
-			}
-
-			/* Send the trigger. */
-			std_session_send_df_trigger(sdi);
-		}
-
-		/* Send post-trigger / all captured samples. */
-		int num_pre_trigger_samples = devc->trigger_at_smpl ==
-							      OLS_NO_TRIGGER ?
-							    0 :
-							    devc->trigger_at_smpl;
-		packet.type = SR_DF_LOGIC;
-		packet.payload = &logic;
-		logic.length =
-			(devc->num_samples - num_pre_trigger_samples) * 4;
-		logic.unitsize = 4;
-		logic.data = devc->raw_sample_buf +
-			     (num_pre_trigger_samples + devc->limit_samples -
-			      devc->num_samples) *
-				     4;
-		sr_session_send(sdi, &packet);
-
-		g_free(devc->raw_sample_buf);
+		ret = ols_send_samples(sdi);
+		if (ret != SR_OK)
+			sr_err("Cannot send sample data: %s.", sr_strerror(ret));
+		g_byte_array_free(devc->raw_data, TRUE);
+		devc->raw_data = NULL;
 
 		serial_flush(serial);
 		abort_acquisition(sdi);
@@ -32,6 +32,8 @@
 #define CLOCK_RATE                   SR_MHZ(100)
 #define MIN_NUM_SAMPLES              4
 #define DEFAULT_SAMPLERATE           SR_KHZ(200)
+#define RECEIVE_CHUNK_SIZE           (16 * 1024)
+#define FEED_CHUNK_SAMPLES           (64 * 1024)
 
 /* Command opcodes */
 #define CMD_RESET                     0x00
@@ -118,14 +120,20 @@ struct dev_context {
 
 	unsigned int num_transfers;
 	unsigned int num_samples;
-	int num_bytes;
 	int cnt_bytes;
 	int cnt_samples;
 	int cnt_samples_rle;
 
+	/* Layout of the received sample words. */
+	size_t num_changroups;
+	uint32_t rle_flag;
+	int changroup_shift[4];
+
+	/* Received data in wire format, newest sample first. */
+	GByteArray *raw_data;
+	size_t raw_used;
 	unsigned int rle_count;
-	unsigned char sample[4];
-	unsigned char *raw_sample_buf;
+	unsigned int rle_skip;
 };
 
 SR_PRIV extern const char *ols_channel_names[];
@@ -115,6 +115,48 @@ SR_PRIV int send_serial_w_ack(struct sr_serial_dev_inst *serial, char *str)
 	}
 }
 
+//Byte classes of the D4 stream: rle only, a sample (with a 3 bit rle), or anything else which ends parsing
+enum d4_kind {
+	D4_RLE,
+	D4_SAMPLE,
+	D4_END,
+};
+
+struct d4_code {
+	uint16_t rle;
+	uint8_t kind;
+	uint8_t value;
+};
+
+static struct d4_code d4_codes[256];
+
+static void d4_codes_init(void)
+{
+	static gsize done = 0;
+	unsigned int b;
+
+	if (!g_once_init_enter(&done))
+		return;
+	for (b = 0; b < 256; b++) {
+		if (b >= 48 && b <= 127) {
+			d4_codes[b].kind = D4_RLE;
+			d4_codes[b].rle = (b - 47) * 8;
+		} else if (b >= 0x80) {
+			d4_codes[b].kind = D4_SAMPLE;
+			d4_codes[b].rle = (b & 0x70) >> 4;
+			d4_codes[b].value = b & 0xF;
+		} else {
+			d4_codes[b].kind = D4_END;
+		}
+	}
+	g_once_init_leave(&done, 1);
+}
+
+//Sample bytes without rle have the pattern 0x80-0x8F, this checks 8 of them at once
+#define D4_PLAIN_MASK	UINT64_C(0xF0F0F0F0F0F0F0F0)
+#define D4_PLAIN_BITS	UINT64_C(0x8080808080808080)
+#define D4_VALUE_MASK	UINT64_C(0x0F0F0F0F0F0F0F0F)
+
 //Process incoming data stream assuming it is optimized packing of 4 channels or less
 //Each byte is 4 channels of data and a 3 bit rle value, or a larger rle value, or a control signal.
 //This also checks for aborts and ends.
@@ -124,41 +166,57 @@ SR_PRIV int send_serial_w_ack(struct sr_serial_dev_inst *serial, char *str)
 //Since we can get huge rle values we chop them up for processing into smaller groups
 //In this mode we can always consume all bytes because there are no cases where the processing of one 
 //byte requires the one after it.
+//Bytes get classified by a lookup table, and with one sample byte per slice runs of samples without rle
+//get decoded 8 bytes at a time.
 void process_D4(struct sr_dev_inst *sdi, struct dev_context *d)
 {
-	uint32_t j;
+	const struct d4_code *code;
+	uint32_t didx;
+	uint64_t word;
 	uint8_t cbyte;
-	uint8_t cval;
 	uint32_t rlecnt = 0;
+
+	d4_codes_init();
+	//Only the low byte carries data, the session even wants disabled channels reported
+	memset(&d->d_last[1], 0, sizeof(d->d_last) - 1);
 	while (d->ser_rdptr < d->bytes_avail) {
+		if (d->dig_sample_bytes == 1
+		    && d->ser_rdptr + 8 <= d->bytes_avail) {
+			memcpy(&word, &d->buffer[d->ser_rdptr], sizeof(word));
+			if ((word & D4_PLAIN_MASK) == D4_PLAIN_BITS) {
+				if (rlecnt) {
+					rle_memset(d, rlecnt);
+					rlecnt = 0;
+				}
+				word &= D4_VALUE_MASK;
+				memcpy(&d->d_data_buf[d->cbuf_wrptr], &word, sizeof(word));
+				d->cbuf_wrptr += 8;
+				d->ser_rdptr += 8;
+				d->byte_cnt += 8;
+				d->d_last[0] = d->d_data_buf[d->cbuf_wrptr - 1];
+				goto check_room;
+			}
+		}
 		cbyte = d->buffer[(d->ser_rdptr)];
-		//RLE only byte
-		if (cbyte >= 48 && cbyte <= 127) {
-			rlecnt += (cbyte - 47) * 8;
+		code = &d4_codes[cbyte];
+		if (code->kind == D4_RLE) {
+			rlecnt += code->rle;
 			d->byte_cnt++;
-		} else if (cbyte >= 0x80) {	//sample with possible rle
-			rlecnt += (cbyte & 0x70) >> 4;
+		} else if (code->kind == D4_SAMPLE) {
+			rlecnt += code->rle;
 			if (rlecnt) {
 				//On a value change, duplicate the previous values first.
 				rle_memset(d, rlecnt);
 				rlecnt = 0;
 			}
 			//Finally add in the new values
-			cval = cbyte & 0xF;
-                        uint32_t didx=(d->cbuf_wrptr) * (d->dig_sample_bytes);
-			d->d_data_buf[didx] = cval;
+			didx = d->cbuf_wrptr * d->dig_sample_bytes;
+			d->d_data_buf[didx] = code->value;
 			//pad in all other bytes since the sessions even wants disabled channels reported
-			for (j = 1; j < d->dig_sample_bytes; j++) {
-				d->d_data_buf[didx+j] = 0;
-			}
+			memset(&d->d_data_buf[didx + 1], 0, d->dig_sample_bytes - 1);
 			d->byte_cnt++;
-			sr_spew
-			    ("Dchan4 rdptr %d wrptr %d bytein 0x%X rle %d cval 0x%X didx %d\n",
-			     (d->ser_rdptr) - 1, d->cbuf_wrptr, cbyte,
-			     rlecnt, cval,didx);
-                        d->cbuf_wrptr++;
-			rlecnt = 0;
-			d->d_last[0] = cval;
+			d->cbuf_wrptr++;
+			d->d_last[0] = code->value;
 		}
 		//Any other character ends parsing - it could be a frame error or a start of the final byte cnt
 		else {
@@ -178,20 +236,21 @@ void process_D4(struct sr_dev_inst *sdi, struct dev_context *d)
 			break;	//break from while loop
 		}
 		(d->ser_rdptr)++;
+check_room:
 		//To ensure we don't overflow the sample buffer, but still send it large chunks of data 
 		//(to make the packet sends to the session efficient) only call process group after
 		//a large number of samples have been seen.
-                //cbuf_wrptr counts slices, so shift right by 2 to create a worst case x4 multiple ratio of
-                //cbuf_wrptr value to the depth of the sample buffer.
+		//cbuf_wrptr counts slices, so shift right by 2 to create a worst case x4 multiple ratio of
+		//cbuf_wrptr value to the depth of the sample buffer.
 		//Likely we could use the max rle value of 640 but 1024 gives some extra room.
-                //Also do a simple check of rlecnt>2000 since that is a reasonable minimal value to send to the session
-		if ((rlecnt>=2000)
-                     ||((rlecnt + ((d->cbuf_wrptr)<<2))) > (d->sample_buf_size - 1024)) {
-                         sr_spew("D4 preoverflow wrptr %d bufsize %d rlecnt %d\n\r",d->cbuf_wrptr,d->sample_buf_size,rlecnt);
- 			 rle_memset(d, rlecnt);
- 			 process_group(sdi, d, d->cbuf_wrptr);
-                         rlecnt=0;
-		     }
+		//Also do a simple check of rlecnt>2000 since that is a reasonable minimal value to send to the session
+		if ((rlecnt >= 2000)
+		    || ((rlecnt + ((d->cbuf_wrptr) << 2))) > (d->sample_buf_size - 1024)) {
+			sr_spew("D4 preoverflow wrptr %d bufsize %d rlecnt %d\n\r", d->cbuf_wrptr, d->sample_buf_size, rlecnt);
+			rle_memset(d, rlecnt);
+			process_group(sdi, d, d->cbuf_wrptr);
+			rlecnt = 0;
+		}
 
 	}//while rdptr < wrptr
 	sr_spew("D4 while done rdptr %d", d->ser_rdptr);
@@ -254,7 +313,6 @@ void process_slice(struct sr_dev_inst *sdi, struct dev_context *devc)
              }else{ 
 	       rlecnt=(devc->buffer[devc->ser_rdptr]-78)*32;
 	     }
-             sr_info("RLEcnt of %d in %d",rlecnt,devc->buffer[devc->ser_rdptr]);
              if((rlecnt < 1)||(rlecnt>1568)){
                 sr_err("Bad rlecnt val %d in %d",rlecnt,devc->buffer[devc->ser_rdptr]);
              }else{
@@ -664,24 +722,31 @@ int process_group(struct sr_dev_inst *sdi, struct dev_context *devc,
 
 //Duplicate previous sample values
 //This function relies on the caller to ensure d_data_buf has samples to handle the full value of the rle
+//The run is filled with memset for single byte samples, else by doubling copies of the first sample.
 void rle_memset(struct dev_context *devc, uint32_t num_slices)
 {
-	uint32_t j, k,didx;
-	sr_spew("rle_memset vals 0x%X, 0x%X, 0x%X slices %d dsb %d\n", devc->d_last[0],devc->d_last[1],devc->d_last[2],
-		num_slices, devc->dig_sample_bytes);
+	uint8_t *p;
+	size_t dsb, done, total, n;
+
+	dsb = devc->dig_sample_bytes;
 	//Even if a channel is disabled, PV expects the same location and size for the enabled
 	// channels as if the channel were enabled.
-	for (j = 0; j < num_slices; j++) {
-                didx=devc->cbuf_wrptr*devc->dig_sample_bytes;
-		for (k = 0; k < devc->dig_sample_bytes; k++) {
-			devc->d_data_buf[didx + k] =  devc->d_last[k];
-			//	sr_spew("k %d j %d v 0x%X p %d didx %d",k,j,devc->d_data_buf[(devc->cbuf_wrptr)+k],(devc->cbuf_wrptr)+k,didx);
+	if (num_slices && dsb) {
+		p = &devc->d_data_buf[devc->cbuf_wrptr * dsb];
+		if (dsb == 1) {
+			memset(p, devc->d_last[0], num_slices);
+		} else {
+			memcpy(p, devc->d_last, dsb);
+			total = (size_t)num_slices * dsb;
+			for (done = dsb; done < total; done += n) {
+				n = MIN(done, total - done);
+				memcpy(p + done, p, n);
+			}
 		}
-		// cbuf_wrptr always counts slices/samples (and not the bytes in the buffer)
-                // regardless of mode
-                devc->cbuf_wrptr++;
 	}
-        
+	// cbuf_wrptr always counts slices/samples (and not the bytes in the buffer)
+	// regardless of mode
+	devc->cbuf_wrptr += num_slices;
 }
 
 //This callback function is mapped from api.c with serial_source_add and is created after a capture
@@ -118,6 +118,30 @@ static int rdtech_dps_read_holding_registers(struct sr_modbus_dev_inst *modbus,
 	return ret;
 }
 
+/*
+ * Registers between two ranges which are cheaper to transfer than the
+ * overhead and the turnaround time of another request.
+ */
+#define READ_RANGES_MAX_GAP 8
+
+/* Retries failed modbus read attempts, see above. */
+static int rdtech_dps_read_holding_ranges(struct sr_modbus_dev_inst *modbus,
+	struct sr_modbus_read_range *ranges, size_t count)
+{
+	size_t retries;
+	int ret;
+
+	retries = 3;
+	while (retries--) {
+		ret = sr_modbus_read_holding_ranges(modbus,
+			ranges, count, READ_RANGES_MAX_GAP);
+		if (ret == SR_OK)
+			return ret;
+	}
+
+	return ret;
+}
+
 /* Set one 16bit register. LE format for DPS devices. */
 static int rdtech_dps_set_reg(const struct sr_dev_inst *sdi,
 	uint16_t address, uint16_t value)
@@ -223,11 +247,12 @@ static int send_value(const struct sr_dev_inst *sdi,
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
+	GSList ch_node;
 	struct sr_analog_spec spec;
 	int ret;
 
 	sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
-	analog.meaning->channels = g_slist_append(NULL, ch);
+	sr_analog_meaning_channel_set(analog.meaning, &ch_node, ch);
 	analog.num_samples = 1;
 	analog.data = &value;
 	analog.meaning->mq = mq;
@@ -238,7 +263,6 @@ static int send_value(const struct sr_dev_inst *sdi,
 	packet.payload = &analog;
 	ret = sr_session_send(sdi, &packet);
 
-	g_slist_free(analog.meaning->channels);
 
 	return ret;
 }
@@ -249,9 +273,8 @@ static int send_value(const struct sr_dev_inst *sdi,
  * register layout interpretation, and potential model dependency in
  * this central spot, to simplify maintenance.
  *
- * TODO Optionally limit the transfer volume depending on caller's spec
- * which detail level is desired? Is 10 registers each 16bits an issue
- * when the UART bitrate is only 9600bps?
+ * The protection thresholds are only read when the caller asks for
+ * the configuration, which saves a request in each acquisition poll.
  */
 SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 	struct rdtech_dps_state *state, enum rdtech_dps_state_context reason)
@@ -259,7 +282,9 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 	struct dev_context *devc;
 	struct sr_modbus_dev_inst *modbus;
 	gboolean get_config, get_init_state, get_curr_meas;
-	uint16_t registers[12];
+	uint16_t registers[12], thresholds[2];
+	struct sr_modbus_read_range ranges[2];
+	size_t range_count;
 	int ret;
 	const uint8_t *rdptr;
 	uint16_t uset_raw, iset_raw, uout_raw, iout_raw, power_raw;
@@ -299,14 +324,14 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 		break;
 	}
 	/*
-	 * TODO Make use of this information to reduce the transfer
-	 * volume, especially on low bitrate serial connections. Though
-	 * the device firmware's samplerate is probably more limiting
-	 * than communication bandwidth is.
+	 * TODO Make use of the remaining information to reduce the
+	 * transfer volume, especially on low bitrate serial connections.
+	 * Though the device firmware's samplerate is probably more
+	 * limiting than communication bandwidth is.
 	 */
-	(void)get_config;
 	(void)get_init_state;
 	(void)get_curr_meas;
+	memset(thresholds, 0, sizeof(thresholds));
 
 	switch (devc->model->model_type) {
 	case MODEL_DPS:
@@ -318,9 +343,16 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 		 * their bit fields. But then this is not too unusual for
 		 * a hardware specific device driver ...
 		 */
+		ranges[0].address = REG_DPS_USET;
+		ranges[0].nb_registers = 10;
+		ranges[0].registers = registers;
+		ranges[1].address = PRE_DPS_OVPSET;
+		ranges[1].nb_registers = 2;
+		ranges[1].registers = thresholds;
+		range_count = get_config ? 2 : 1;
 		g_mutex_lock(&devc->rw_mutex);
-		ret = rdtech_dps_read_holding_registers(modbus,
-			REG_DPS_USET, 10, registers);
+		ret = rdtech_dps_read_holding_ranges(modbus,
+			ranges, range_count);
 		g_mutex_unlock(&devc->rw_mutex);
 		if (ret != SR_OK)
 			return ret;
@@ -348,16 +380,8 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 		out_state = read_u16be_inc(&rdptr); /* ENABLE */
 		is_out_enabled = out_state != 0;
 
-		/* Transfer another chunk of registers in a single call. */
-		g_mutex_lock(&devc->rw_mutex);
-		ret = rdtech_dps_read_holding_registers(modbus,
-			PRE_DPS_OVPSET, 2, registers);
-		g_mutex_unlock(&devc->rw_mutex);
-		if (ret != SR_OK)
-			return ret;
-
 		/* Interpret the second registers chunk's values. */
-		rdptr = (const void *)registers;
+		rdptr = (const void *)thresholds;
 		ovpset_raw = read_u16be_inc(&rdptr); /* PRE OVPSET */
 		ovp_threshold = ovpset_raw * devc->voltage_multiplier;
 		ocpset_raw = read_u16be_inc(&rdptr); /* PRE OCPSET */
@@ -366,10 +390,17 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 		break;
 
 	case MODEL_RD:
-		/* Retrieve a set of adjacent registers. */
+		/* Retrieve two sets of adjacent registers. */
+		ranges[0].address = REG_RD_VOLT_TGT;
+		ranges[0].nb_registers = 11;
+		ranges[0].registers = registers;
+		ranges[1].address = REG_RD_OVP_THR;
+		ranges[1].nb_registers = 2;
+		ranges[1].registers = thresholds;
+		range_count = get_config ? 2 : 1;
 		g_mutex_lock(&devc->rw_mutex);
-		ret = rdtech_dps_read_holding_registers(modbus,
-			REG_RD_VOLT_TGT, 11, registers);
+		ret = rdtech_dps_read_holding_ranges(modbus,
+			ranges, range_count);
 		g_mutex_unlock(&devc->rw_mutex);
 		if (ret != SR_OK)
 			return ret;
@@ -397,16 +428,8 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 		out_state = read_u16be_inc(&rdptr); /* ENABLE */
 		is_out_enabled = out_state != 0;
 
-		/* Retrieve a set of adjacent registers. */
-		g_mutex_lock(&devc->rw_mutex);
-		ret = rdtech_dps_read_holding_registers(modbus,
-			REG_RD_OVP_THR, 2, registers);
-		g_mutex_unlock(&devc->rw_mutex);
-		if (ret != SR_OK)
-			return ret;
-
-		/* Interpret the registers' raw content. */
-		rdptr = (const void *)registers;
+		/* Interpret the thresholds' raw content. */
+		rdptr = (const void *)thresholds;
 		ovpset_raw = read_u16be_inc(&rdptr); /* OVP THR */
 		ovp_threshold = ovpset_raw / devc->voltage_multiplier;
 		ocpset_raw = read_u16be_inc(&rdptr); /* OCP THR */
@@ -446,10 +469,12 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 	state->mask |= STATE_VOLTAGE_TARGET;
 	state->current_limit = curr_limit;
 	state->mask |= STATE_CURRENT_LIMIT;
-	state->ovp_threshold = ovp_threshold;
-	state->mask |= STATE_OVP_THRESHOLD;
-	state->ocp_threshold = ocp_threshold;
-	state->mask |= STATE_OCP_THRESHOLD;
+	if (get_config) {
+		state->ovp_threshold = ovp_threshold;
+		state->mask |= STATE_OVP_THRESHOLD;
+		state->ocp_threshold = ocp_threshold;
+		state->mask |= STATE_OCP_THRESHOLD;
+	}
 	state->voltage = curr_voltage;
 	state->mask |= STATE_VOLTAGE;
 	state->current = curr_current;
@@ -647,15 +672,15 @@ SR_PRIV int rdtech_dps_receive_data(int fd, int revents, void *cb_data)
 
 	/* Check for state changes. */
 	if (devc->curr_ovp_state != state.protect_ovp) {
-		(void)sr_session_send_meta(sdi,
+		(void)sr_session_send_meta_bool(sdi,
 			SR_CONF_OVER_VOLTAGE_PROTECTION_ACTIVE,
-			g_variant_new_boolean(state.protect_ovp));
+			state.protect_ovp);
 		devc->curr_ovp_state = state.protect_ovp;
 	}
 	if (devc->curr_ocp_state != state.protect_ocp) {
-		(void)sr_session_send_meta(sdi,
+		(void)sr_session_send_meta_bool(sdi,
 			SR_CONF_OVER_CURRENT_PROTECTION_ACTIVE,
-			g_variant_new_boolean(state.protect_ocp));
+			state.protect_ocp);
 		devc->curr_ocp_state = state.protect_ocp;
 	}
 	if (devc->curr_cc_state != state.regulation_cc) {
@@ -665,8 +690,8 @@ SR_PRIV int rdtech_dps_receive_data(int fd, int revents, void *cb_data)
 		devc->curr_cc_state = state.regulation_cc;
 	}
 	if (devc->curr_out_state != state.output_enabled) {
-		(void)sr_session_send_meta(sdi, SR_CONF_ENABLED,
-			g_variant_new_boolean(state.output_enabled));
+		(void)sr_session_send_meta_bool(sdi, SR_CONF_ENABLED,
+			state.output_enabled);
 		devc->curr_out_state = state.output_enabled;
 	}
 
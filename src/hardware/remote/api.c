@@ -0,0 +1,263 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Replay the datafeed which a remote server (see sr_remote_server_new())
+ * sends, as a virtual device. The connection spec is "tcp/<host>/<port>".
+ * Alternatively, replay a shared memory ring (see sr_shm_ring_new()) of
+ * another process on the same host, with the connection spec
+ * "shm/<path>".
+ */
+
+#include <config.h>
+#include <string.h>
+#include <unistd.h>
+#include "protocol.h"
+
+static const uint32_t scanopts[] = {
+	SR_CONF_CONN,
+};
+
+static const uint32_t drvopts[] = {
+	SR_CONF_LOGIC_ANALYZER,
+};
+
+static const uint32_t devopts[] = {
+	SR_CONF_CONTINUOUS,
+	SR_CONF_CONN | SR_CONF_GET,
+	SR_CONF_SAMPLERATE | SR_CONF_GET,
+	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_LIMIT_FRAMES | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+};
+
+static void clear_helper(struct dev_context *devc)
+{
+	g_free(devc->address);
+	g_free(devc->port);
+	g_free(devc->path);
+	if (devc->rxbuf)
+		g_byte_array_free(devc->rxbuf, TRUE);
+	if (devc->txbuf)
+		g_byte_array_free(devc->txbuf, TRUE);
+}
+
+static int dev_clear(const struct sr_dev_driver *di)
+{
+	return std_dev_clear_with_callback(di, (std_dev_clear_callback)clear_helper);
+}
+
+static GSList *scan(struct sr_dev_driver *di, GSList *options)
+{
+	struct sr_config *src;
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	const char *conn;
+	char **params;
+	GSList *l;
+	int ret;
+
+	conn = NULL;
+	for (l = options; l; l = l->next) {
+		src = l->data;
+		if (src->key == SR_CONF_CONN)
+			conn = g_variant_get_string(src->data, NULL);
+	}
+	if (!conn)
+		return NULL;
+
+	devc = g_malloc0(sizeof(*devc));
+	if (g_str_has_prefix(conn, "shm/") && conn[4]) {
+		devc->path = g_strdup(&conn[4]);
+	} else {
+		params = g_strsplit(conn, "/", 0);
+		if (g_strv_length(params) != 3 || strcmp(params[0], "tcp") != 0) {
+			sr_err("Invalid connection spec '%s', expected "
+				"tcp/<host>/<port> or shm/<path>.", conn);
+			g_strfreev(params);
+			g_free(devc);
+			return NULL;
+		}
+		devc->address = g_strdup(params[1]);
+		devc->port = g_strdup(params[2]);
+		g_strfreev(params);
+	}
+	devc->fd = -1;
+	devc->rxbuf = g_byte_array_new();
+	devc->txbuf = g_byte_array_new();
+	sr_sw_limits_init(&devc->limits);
+
+	sdi = g_malloc0(sizeof(*sdi));
+	sdi->status = SR_ST_INACTIVE;
+	sdi->inst_type = SR_INST_USER;
+	sdi->connection_id = g_strdup(conn);
+	sdi->priv = devc;
+
+	if (devc->path) {
+		ret = sr_shm_reader_open(&devc->shm, devc->path);
+		if (ret == SR_OK && (ret = sr_shm_reader_hello(devc->shm,
+				sdi)) == SR_ERR_NA)
+			sr_err("No device was shared through %s yet.", devc->path);
+		if (ret == SR_OK)
+			devc->samplerate = sr_shm_reader_samplerate(devc->shm);
+		sr_shm_reader_close(devc->shm);
+		devc->shm = NULL;
+	} else {
+		devc->fd = sr_remote_connect(devc->address, devc->port);
+		ret = devc->fd < 0 ? SR_ERR_IO : remote_hello_receive(devc, sdi);
+		if (devc->fd >= 0)
+			close(devc->fd);
+		devc->fd = -1;
+	}
+	if (ret != SR_OK) {
+		sr_dev_inst_free(sdi);
+		clear_helper(devc);
+		g_free(devc);
+		return NULL;
+	}
+	g_byte_array_set_size(devc->rxbuf, 0);
+
+	if (!sdi->vendor || !*sdi->vendor) {
+		g_free(sdi->vendor);
+		sdi->vendor = g_strdup("Remote");
+	}
+	sr_info("Found %s %s at %s.", sdi->vendor, sdi->model ? sdi->model : "",
+		conn);
+
+	return std_scan_complete(di, g_slist_append(NULL, sdi));
+}
+
+static int config_get(uint32_t key, GVariant **data,
+	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
+{
+	struct dev_context *devc;
+
+	(void)cg;
+
+	if (!sdi)
+		return SR_ERR_ARG;
+	devc = sdi->priv;
+
+	switch (key) {
+	case SR_CONF_CONN:
+		*data = g_variant_new_string(sdi->connection_id);
+		break;
+	case SR_CONF_SAMPLERATE:
+		if (!devc->samplerate)
+			return SR_ERR_NA;
+		*data = g_variant_new_uint64(devc->samplerate);
+		break;
+	case SR_CONF_LIMIT_SAMPLES:
+	case SR_CONF_LIMIT_FRAMES:
+	case SR_CONF_LIMIT_MSEC:
+		return sr_sw_limits_config_get(&devc->limits, key, data);
+	default:
+		return SR_ERR_NA;
+	}
+
+	return SR_OK;
+}
+
+static int config_set(uint32_t key, GVariant *data,
+	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
+{
+	struct dev_context *devc;
+
+	(void)cg;
+
+	devc = sdi->priv;
+
+	return sr_sw_limits_config_set(&devc->limits, key, data);
+}
+
+static int config_list(uint32_t key, GVariant **data,
+	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
+{
+	return STD_CONFIG_LIST(key, data, sdi, cg, scanopts, drvopts, devopts);
+}
+
+static int dev_acquisition_start(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	int ret;
+
+	devc = sdi->priv;
+
+	if (devc->path) {
+		if ((ret = sr_shm_reader_open(&devc->shm, devc->path)) != SR_OK)
+			return ret;
+		devc->samplerate = sr_shm_reader_samplerate(devc->shm);
+		devc->lost = 0;
+	} else {
+		devc->fd = sr_remote_connect(devc->address, devc->port);
+		if (devc->fd < 0)
+			return SR_ERR_IO;
+		g_byte_array_set_size(devc->rxbuf, 0);
+		if ((ret = remote_hello_receive(devc, NULL)) != SR_OK) {
+			close(devc->fd);
+			devc->fd = -1;
+			return ret;
+		}
+	}
+
+	devc->end_sent = FALSE;
+	devc->ping_time = 0;
+	devc->rtt_count = 0;
+	devc->rtt_sum = 0;
+	devc->rtt_max = 0;
+	sr_sw_limits_acquisition_start(&devc->limits);
+	sr_sw_limits_set_samplerate(&devc->limits, devc->samplerate);
+	std_session_send_df_header(sdi);
+
+	if (devc->shm)
+		sr_session_source_add(sdi->session, -1, 0, SHM_POLL_INTERVAL_MS,
+			remote_shm_receive_data, (void *)sdi);
+	else
+		sr_session_source_add(sdi->session, devc->fd, G_IO_IN, 100,
+			remote_receive_data, (void *)sdi);
+
+	return SR_OK;
+}
+
+static int dev_acquisition_stop(struct sr_dev_inst *sdi)
+{
+	remote_acquisition_finish(sdi);
+
+	return SR_OK;
+}
+
+static struct sr_dev_driver remote_driver_info = {
+	.name = "remote",
+	.longname = "Remote session",
+	.api_version = 1,
+	.init = std_init,
+	.cleanup = std_cleanup,
+	.scan = scan,
+	.dev_list = std_dev_list,
+	.dev_clear = dev_clear,
+	.config_get = config_get,
+	.config_set = config_set,
+	.config_list = config_list,
+	.dev_open = std_dummy_dev_open,
+	.dev_close = std_dummy_dev_close,
+	.dev_acquisition_start = dev_acquisition_start,
+	.dev_acquisition_stop = dev_acquisition_stop,
+	.context = NULL,
+};
+SR_REGISTER_DEV_DRIVER(remote_driver_info);
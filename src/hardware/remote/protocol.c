@@ -0,0 +1,287 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <unistd.h>
+#include "protocol.h"
+
+/**
+ * Receive the greeting of the server.
+ *
+ * @param[in] devc The device context, with an established connection.
+ * @param[in,out] sdi The device to take the description of the remote
+ *                    device, or NULL to skip the greeting.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_TIMEOUT No greeting was received.
+ * @retval SR_ERR_DATA The greeting is invalid.
+ * @retval SR_ERR_IO The connection failed.
+ */
+SR_PRIV int remote_hello_receive(struct dev_context *devc,
+		struct sr_dev_inst *sdi)
+{
+	int64_t deadline, now;
+	uint16_t type, flags;
+	size_t size;
+	int len, ret;
+
+	deadline = g_get_monotonic_time() + HELLO_TIMEOUT_MS * 1000;
+	while ((len = sr_remote_frame_parse(devc->rxbuf, &type, &flags,
+			&size)) == 0) {
+		now = g_get_monotonic_time();
+		if (now >= deadline) {
+			sr_err("No greeting from %s:%s.", devc->address,
+				devc->port);
+			return SR_ERR_TIMEOUT;
+		}
+		ret = sr_remote_recv(devc->fd, devc->rxbuf,
+			(deadline - now + 999) / 1000);
+		if (ret < 0)
+			return ret;
+	}
+	if (len < 0)
+		return len;
+	if (type != SR_REMOTE_FRAME_HELLO) {
+		sr_err("Expected a greeting, got frame type %d.", type);
+		return SR_ERR_DATA;
+	}
+
+	ret = SR_OK;
+	if (sdi)
+		ret = sr_remote_hello_decode(sdi,
+			&devc->rxbuf->data[SR_REMOTE_HEADER_SIZE], size);
+	g_byte_array_remove_range(devc->rxbuf, 0, len);
+
+	return ret;
+}
+
+static int handle_packet(struct sr_dev_inst *sdi, const uint8_t *data,
+		size_t size, uint16_t flags)
+{
+	struct dev_context *devc;
+	struct sr_remote_packet rp;
+	struct sr_config *src;
+	GSList *l;
+	int ret;
+
+	devc = sdi->priv;
+
+	ret = sr_remote_packet_decode(sdi, data, size, flags, &rp);
+	if (ret != SR_OK) {
+		sr_remote_packet_clear(&rp);
+		return ret == SR_ERR_NA ? SR_OK : ret;
+	}
+
+	switch (rp.packet.type) {
+	case SR_DF_HEADER:
+		/* The header was sent when the acquisition started. */
+		sr_remote_packet_clear(&rp);
+		return SR_OK;
+	case SR_DF_META:
+		for (l = rp.meta.config; l; l = l->next) {
+			src = l->data;
+			if (src->key == SR_CONF_SAMPLERATE
+					&& g_variant_is_of_type(src->data,
+						G_VARIANT_TYPE_UINT64)) {
+				devc->samplerate = g_variant_get_uint64(src->data);
+				sr_sw_limits_set_samplerate(&devc->limits,
+					devc->samplerate);
+			}
+		}
+		break;
+	case SR_DF_END:
+		devc->end_sent = TRUE;
+		break;
+	}
+
+	/* Clips the data to the limits, and stops at them. */
+	ret = sr_sw_limits_send(&devc->limits, sdi, &rp.packet);
+	sr_remote_packet_clear(&rp);
+
+	return ret;
+}
+
+static void handle_pong(struct dev_context *devc, const uint8_t *data,
+		size_t size)
+{
+	int64_t rtt;
+
+	if (size < sizeof(uint64_t))
+		return;
+
+	rtt = g_get_monotonic_time() - (int64_t)RL64(data);
+	devc->rtt_count++;
+	devc->rtt_sum += rtt;
+	devc->rtt_max = MAX(devc->rtt_max, rtt);
+	sr_spew("Round trip latency %.3f ms.", rtt / 1000.0);
+}
+
+static int send_ping(struct dev_context *devc)
+{
+	uint8_t buf[sizeof(uint64_t)];
+
+	devc->ping_time = g_get_monotonic_time();
+	WL64(buf, devc->ping_time);
+	sr_remote_frame_init(devc->txbuf);
+	g_byte_array_append(devc->txbuf, buf, sizeof(buf));
+
+	return sr_remote_frame_send(devc->fd, devc->txbuf,
+		SR_REMOTE_FRAME_PING, 0);
+}
+
+/**
+ * End the acquisition, and close the connection to the server or ring.
+ *
+ * @param[in] sdi The device.
+ */
+SR_PRIV void remote_acquisition_finish(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+	if (devc->shm) {
+		sr_session_source_remove(sdi->session, -1);
+		sr_shm_reader_close(devc->shm);
+		devc->shm = NULL;
+		if (devc->lost)
+			sr_warn("Fell behind the writer, lost %" PRIu64 " bytes.",
+				devc->lost);
+	} else if (devc->fd >= 0) {
+		sr_session_source_remove(sdi->session, devc->fd);
+		close(devc->fd);
+		devc->fd = -1;
+	} else {
+		return;
+	}
+
+	if (!devc->end_sent)
+		std_session_send_df_end(sdi);
+	devc->end_sent = TRUE;
+
+	if (devc->rtt_count)
+		sr_info("Round trip latency %.3f ms on average, "
+			"%.3f ms at most, over %" PRIu64 " pings.",
+			devc->rtt_sum / 1000.0 / devc->rtt_count,
+			devc->rtt_max / 1000.0, devc->rtt_count);
+}
+
+SR_PRIV int remote_receive_data(int fd, int revents, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	const uint8_t *payload;
+	uint16_t type, flags;
+	size_t size;
+	int len, ret;
+
+	(void)fd;
+
+	if (!(sdi = cb_data) || !(devc = sdi->priv))
+		return TRUE;
+
+	if (revents & G_IO_IN) {
+		if (sr_remote_recv(devc->fd, devc->rxbuf, 0) < 0) {
+			sr_err("Connection to %s:%s lost.", devc->address,
+				devc->port);
+			remote_acquisition_finish(sdi);
+			return TRUE;
+		}
+	}
+
+	ret = SR_OK;
+	while (!devc->end_sent && (len = sr_remote_frame_parse(devc->rxbuf,
+			&type, &flags, &size)) != 0) {
+		if (len < 0) {
+			ret = len;
+			break;
+		}
+		payload = &devc->rxbuf->data[SR_REMOTE_HEADER_SIZE];
+		if (type == SR_REMOTE_FRAME_PACKET)
+			ret = handle_packet(sdi, payload, size, flags);
+		else if (type == SR_REMOTE_FRAME_PONG)
+			handle_pong(devc, payload, size);
+		g_byte_array_remove_range(devc->rxbuf, 0, len);
+		if (ret != SR_OK || sr_sw_limits_check(&devc->limits))
+			break;
+	}
+
+	if (ret != SR_OK || devc->end_sent
+			|| sr_sw_limits_check(&devc->limits)) {
+		remote_acquisition_finish(sdi);
+		return TRUE;
+	}
+
+	if (g_get_monotonic_time() - devc->ping_time >= PING_INTERVAL_US
+			&& send_ping(devc) != SR_OK) {
+		sr_err("Connection to %s:%s lost.", devc->address, devc->port);
+		remote_acquisition_finish(sdi);
+	}
+
+	return TRUE;
+}
+
+SR_PRIV int remote_shm_receive_data(int fd, int revents, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	uint16_t type, flags;
+	uint64_t lost;
+	size_t size;
+	int ret;
+
+	(void)fd;
+	(void)revents;
+
+	if (!(sdi = cb_data) || !(devc = sdi->priv) || !devc->shm)
+		return TRUE;
+
+	ret = SR_OK;
+	while (!devc->end_sent && !sr_sw_limits_check(&devc->limits)) {
+		ret = sr_shm_reader_next(devc->shm, devc->rxbuf, &lost);
+		if (lost && !devc->lost)
+			sr_warn("Fell behind the writer, skipping to recent data.");
+		devc->lost += lost;
+		if (ret == SR_ERR_NA) {
+			ret = SR_OK;
+			break;
+		}
+		if (ret == SR_ERR_IO) {
+			sr_info("The writer closed %s.", devc->path);
+			break;
+		}
+		if (ret != SR_OK)
+			break;
+		type = RL16(&devc->rxbuf->data[4]);
+		flags = RL16(&devc->rxbuf->data[6]);
+		size = devc->rxbuf->len - SR_REMOTE_HEADER_SIZE;
+		if (type != SR_REMOTE_FRAME_PACKET)
+			continue;
+		ret = handle_packet(sdi, &devc->rxbuf->data[SR_REMOTE_HEADER_SIZE],
+			size, flags);
+		if (ret != SR_OK)
+			break;
+	}
+
+	if (ret != SR_OK || devc->end_sent
+			|| sr_sw_limits_check(&devc->limits))
+		remote_acquisition_finish(sdi);
+
+	return TRUE;
+}
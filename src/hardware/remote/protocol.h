@@ -0,0 +1,64 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBSIGROK_HARDWARE_REMOTE_PROTOCOL_H
+#define LIBSIGROK_HARDWARE_REMOTE_PROTOCOL_H
+
+#include <stdint.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "remote"
+
+/* How long to wait for the greeting of the server. */
+#define HELLO_TIMEOUT_MS 3000
+/* Interval of latency measurements. */
+#define PING_INTERVAL_US (1000 * 1000)
+/* How often to poll a shared memory ring for new data. */
+#define SHM_POLL_INTERVAL_MS 10
+
+struct dev_context {
+	char *address;
+	char *port;
+	int fd;
+	char *path;
+	struct sr_shm_reader *shm;
+	uint64_t lost;
+	GByteArray *rxbuf;
+	GByteArray *txbuf;
+	struct sr_sw_limits limits;
+	uint64_t samplerate;
+	gboolean header_sent;
+	gboolean end_sent;
+
+	/* Round trip latency measurement. */
+	int64_t ping_time;
+	uint64_t rtt_count;
+	int64_t rtt_sum;
+	int64_t rtt_max;
+};
+
+SR_PRIV int remote_hello_receive(struct dev_context *devc,
+		struct sr_dev_inst *sdi);
+SR_PRIV int remote_receive_data(int fd, int revents, void *cb_data);
+SR_PRIV int remote_shm_receive_data(int fd, int revents, void *cb_data);
+SR_PRIV void remote_acquisition_finish(struct sr_dev_inst *sdi);
+
+#endif
@@ -195,7 +195,8 @@ static const struct rigol_ds_vendor supported_vendors[] = {
 
 #define VENDOR(x) &supported_vendors[x]
 /* vendor, series/name, protocol, data format, max timebase, min vdiv,
- * number of horizontal divs, live waveform samples, memory buffer samples */
+ * number of horizontal divs, live waveform samples, memory buffer samples,
+ * samples per data block query */
 static const struct rigol_ds_series supported_series[] = {
 	[VS5000] = {VENDOR(RIGOL), "VS5000", PROTOCOL_V1, FORMAT_RAW,
 		{50, 1}, {2, 1000}, 14, 2048, 0},
@@ -210,11 +211,11 @@ static const struct rigol_ds_series supported_series[] = {
 	[DSO1000B] = {VENDOR(AGILENT), "DSO1000", PROTOCOL_V3, FORMAT_IEEE488_2,
 		{50, 1}, {2, 1000}, 12, 600, 20480},
 	[DS1000Z] = {VENDOR(RIGOL), "DS1000Z", PROTOCOL_V4, FORMAT_IEEE488_2,
-		{50, 1}, {1, 1000}, 12, 1200, 12000000},
+		{50, 1}, {1, 1000}, 12, 1200, 12000000, 250000},
 	[DS4000] = {VENDOR(RIGOL), "DS4000", PROTOCOL_V4, FORMAT_IEEE488_2,
-		{1000, 1}, {1, 1000}, 14, 1400, 0},
+		{1000, 1}, {1, 1000}, 14, 1400, 0, 250000},
 	[MSO5000] = {VENDOR(RIGOL), "MSO5000", PROTOCOL_V5, FORMAT_IEEE488_2,
-		{1000, 1}, {500, 1000000}, 10, 1000, 0},
+		{1000, 1}, {500, 1000000}, 10, 1000, 0, 250000},
 	[MSO7000A] = {VENDOR(AGILENT), "MSO7000A", PROTOCOL_V4, FORMAT_IEEE488_2,
 		{50, 1}, {2, 1000}, 10, 1000, 8000000},
 };
@@ -300,7 +301,6 @@ static void clear_helper(struct dev_context *devc)
 {
 	unsigned int i;
 
-	g_free(devc->data);
 	g_free(devc->buffer);
 	for (i = 0; i < ARRAY_SIZE(devc->coupling); i++)
 		g_free(devc->coupling[i]);
@@ -426,8 +426,8 @@ static struct sr_dev_inst *probe_device(struct sr_scpi_dev_inst *scpi)
 		}
 	}
 
-	devc->buffer = g_malloc(ACQ_BUFFER_SIZE);
-	devc->data = g_malloc(ACQ_BUFFER_SIZE * sizeof(float));
+	devc->buffer_size = MAX(ACQ_BUFFER_SIZE, rigol_ds_block_samples(devc));
+	devc->buffer = g_malloc(devc->buffer_size);
 
 	devc->data_source = DATA_SOURCE_LIVE;
 
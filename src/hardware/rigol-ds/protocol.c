@@ -544,6 +544,7 @@ SR_PRIV int rigol_ds_channel_start(const struct sr_dev_inst *sdi)
 	devc->num_channel_bytes = 0;
 	devc->num_header_bytes = 0;
 	devc->num_block_bytes = 0;
+	devc->block_requested = FALSE;
 
 	return SR_OK;
 }
@@ -605,6 +606,42 @@ static int rigol_ds_read_header(struct sr_dev_inst *sdi)
 	return ret;
 }
 
+/* Maximum number of samples to request with one data block query */
+SR_PRIV int rigol_ds_block_samples(const struct dev_context *devc)
+{
+	if (devc->model->series->block_samples)
+		return devc->model->series->block_samples;
+
+	return ACQ_BLOCK_SIZE;
+}
+
+/* Query the data block starting at the given byte of the channel */
+static int rigol_ds_block_request(const struct sr_dev_inst *sdi,
+		uint64_t channel_bytes)
+{
+	struct dev_context *devc = sdi->priv;
+	const gboolean first_frame = (devc->num_frames == 0);
+
+	if (devc->model->series->protocol >= PROTOCOL_V4) {
+		if (first_frame && rigol_ds_config_set(sdi, ":WAV:START %d",
+				(int)channel_bytes + 1) != SR_OK)
+			return SR_ERR;
+		if (first_frame && rigol_ds_config_set(sdi, ":WAV:STOP %d",
+				(int)MIN(channel_bytes + rigol_ds_block_samples(devc),
+					devc->analog_frame_size)) != SR_OK)
+			return SR_ERR;
+	}
+
+	if (devc->model->series->protocol >= PROTOCOL_V3) {
+		if (rigol_ds_config_set(sdi, ":WAV:BEG") != SR_OK)
+			return SR_ERR;
+		if (sr_scpi_send(sdi->conn, ":WAV:DATA?") != SR_OK)
+			return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
 SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 {
 	struct sr_dev_inst *sdi;
@@ -614,12 +651,14 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
+	GSList ch_node;
 	struct sr_analog_spec spec;
 	struct sr_datafeed_logic logic;
 	double vdiv, offset, origin;
-	int len, i, vref;
+	int len, vref;
 	struct sr_channel *ch;
 	gsize expected_data_bytes;
+	char linefeed;
 
 	(void)fd;
 
@@ -634,8 +673,6 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 	if (!(revents == G_IO_IN || revents == 0))
 		return TRUE;
 
-	const gboolean first_frame = (devc->num_frames == 0);
-
 	switch (devc->wait_event) {
 	case WAIT_NONE:
 		break;
@@ -668,22 +705,10 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 			devc->analog_frame_size : devc->digital_frame_size;
 
 	if (devc->num_block_bytes == 0) {
-		if (devc->model->series->protocol >= PROTOCOL_V4) {
-			if (first_frame && rigol_ds_config_set(sdi, ":WAV:START %d",
-					devc->num_channel_bytes + 1) != SR_OK)
-				return TRUE;
-			if (first_frame && rigol_ds_config_set(sdi, ":WAV:STOP %d",
-					MIN(devc->num_channel_bytes + ACQ_BLOCK_SIZE,
-						devc->analog_frame_size)) != SR_OK)
-				return TRUE;
-		}
-
-		if (devc->model->series->protocol >= PROTOCOL_V3) {
-			if (rigol_ds_config_set(sdi, ":WAV:BEG") != SR_OK)
-				return TRUE;
-			if (sr_scpi_send(sdi->conn, ":WAV:DATA?") != SR_OK)
-				return TRUE;
-		}
+		if (!devc->block_requested &&
+				rigol_ds_block_request(sdi, devc->num_channel_bytes) != SR_OK)
+			return TRUE;
+		devc->block_requested = FALSE;
 
 		if (sr_scpi_read_begin(scpi) != SR_OK)
 			return TRUE;
@@ -721,8 +746,8 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 	}
 
 	len = devc->num_block_bytes - devc->num_block_read;
-	if (len > ACQ_BUFFER_SIZE)
-		len = ACQ_BUFFER_SIZE;
+	if ((size_t)len > devc->buffer_size)
+		len = devc->buffer_size;
 	sr_dbg("Requesting read of %d bytes", len);
 
 	len = sr_scpi_read_data(scpi, (char *)devc->buffer, len);
@@ -738,30 +763,81 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 
 	devc->num_block_read += len;
 
+	if (devc->num_block_read == devc->num_block_bytes) {
+		sr_dbg("Block has been completed");
+		if (devc->model->series->protocol >= PROTOCOL_V3) {
+			/* Discard the terminating linefeed */
+			sr_scpi_read_data(scpi, &linefeed, 1);
+		}
+		if (devc->format == FORMAT_IEEE488_2) {
+			/* Prepare for possible next block */
+			devc->num_header_bytes = 0;
+			devc->num_block_bytes = 0;
+			if (devc->data_source != DATA_SOURCE_LIVE)
+				rigol_ds_set_wait_event(devc, WAIT_BLOCK);
+		}
+		if (!sr_scpi_read_complete(scpi) && !devc->channel_entry->next) {
+			sr_err("Read should have been completed");
+		}
+		devc->num_block_read = 0;
+		/*
+		 * Have the scope prepare the next block of this channel
+		 * while this one gets sent. There is no block wait on V4+
+		 * which would need the link in the meantime.
+		 */
+		if (devc->model->series->protocol >= PROTOCOL_V4 &&
+				devc->num_block_bytes == 0 &&
+				devc->num_channel_bytes + len < expected_data_bytes) {
+			if (rigol_ds_block_request(sdi,
+					devc->num_channel_bytes + len) != SR_OK) {
+				sr_err("Error while requesting the next block, aborting capture.");
+				std_session_send_df_frame_end(sdi);
+				sr_dev_acquisition_stop(sdi);
+				return TRUE;
+			}
+			devc->block_requested = TRUE;
+		}
+	} else {
+		sr_dbg("%" PRIu64 " of %" PRIu64 " block bytes read",
+			devc->num_block_read, devc->num_block_bytes);
+	}
+
 	if (ch->type == SR_CHANNEL_ANALOG) {
 		vref = devc->vert_reference[ch->index];
 		vdiv = devc->vert_inc[ch->index];
 		origin = devc->vert_origin[ch->index];
 		offset = devc->vert_offset[ch->index];
-		if (devc->model->series->protocol >= PROTOCOL_V3)
-			for (i = 0; i < len; i++)
-				devc->data[i] = ((int)devc->buffer[i] - vref - origin) * vdiv;
-		else
-			for (i = 0; i < len; i++)
-				devc->data[i] = (128 - devc->buffer[i]) * vdiv - offset;
 		float vdivlog = log10f(vdiv);
 		int digits = -(int)vdivlog + (vdivlog < 0.0);
 		sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
-		analog.meaning->channels = g_slist_append(NULL, ch);
+		/*
+		 * Send the raw bytes, the scale and offset of the encoding
+		 * describe the conversion to volts:
+		 * V3+: (raw - vref - origin) * vdiv
+		 * older: (128 - raw) * vdiv - offset
+		 */
+		encoding.unitsize = sizeof(uint8_t);
+		encoding.is_float = FALSE;
+		encoding.is_signed = FALSE;
+		encoding.is_bigendian = FALSE;
+		if (devc->model->series->protocol >= PROTOCOL_V3) {
+			sr_rational_from_double(&encoding.scale, vdiv);
+			sr_rational_from_double(&encoding.offset,
+				-(vref + origin) * vdiv);
+		} else {
+			sr_rational_from_double(&encoding.scale, -vdiv);
+			sr_rational_from_double(&encoding.offset,
+				128 * vdiv - offset);
+		}
+		sr_analog_meaning_channel_set(analog.meaning, &ch_node, ch);
 		analog.num_samples = len;
-		analog.data = devc->data;
+		analog.data = devc->buffer;
 		analog.meaning->mq = SR_MQ_VOLTAGE;
 		analog.meaning->unit = SR_UNIT_VOLT;
 		analog.meaning->mqflags = 0;
 		packet.type = SR_DF_ANALOG;
 		packet.payload = &analog;
 		sr_session_send(sdi, &packet);
-		g_slist_free(analog.meaning->channels);
 	} else {
 		logic.length = len;
 		// TODO: For the MSO1000Z series, we need a way to express that
@@ -774,28 +850,6 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 		sr_session_send(sdi, &packet);
 	}
 
-	if (devc->num_block_read == devc->num_block_bytes) {
-		sr_dbg("Block has been completed");
-		if (devc->model->series->protocol >= PROTOCOL_V3) {
-			/* Discard the terminating linefeed */
-			sr_scpi_read_data(scpi, (char *)devc->buffer, 1);
-		}
-		if (devc->format == FORMAT_IEEE488_2) {
-			/* Prepare for possible next block */
-			devc->num_header_bytes = 0;
-			devc->num_block_bytes = 0;
-			if (devc->data_source != DATA_SOURCE_LIVE)
-				rigol_ds_set_wait_event(devc, WAIT_BLOCK);
-		}
-		if (!sr_scpi_read_complete(scpi) && !devc->channel_entry->next) {
-			sr_err("Read should have been completed");
-		}
-		devc->num_block_read = 0;
-	} else {
-		sr_dbg("%" PRIu64 " of %" PRIu64 " block bytes read",
-			devc->num_block_read, devc->num_block_bytes);
-	}
-
 	devc->num_channel_bytes += len;
 
 	if (devc->num_channel_bytes < expected_data_bytes)
@@ -875,6 +929,7 @@ SR_PRIV int rigol_ds_get_dev_cfg(const struct sr_dev_inst *sdi)
 			return SR_ERR;
 		ch = g_slist_nth_data(sdi->channels, i);
 		ch->enabled = devc->analog_channels[i];
+		sr_dev_channels_changed(sdi);
 	}
 	sr_dbg("Current analog channel state:");
 	for (i = 0; i < devc->model->analog_channels; i++)
@@ -902,6 +957,7 @@ SR_PRIV int rigol_ds_get_dev_cfg(const struct sr_dev_inst *sdi)
 				return SR_ERR;
 			ch = g_slist_nth_data(sdi->channels, i + devc->model->analog_channels);
 			ch->enabled = devc->digital_channels[i];
+			sr_dev_channels_changed(sdi);
 			sr_dbg("D%d: %s", i, devc->digital_channels[i] ? "on" : "off");
 		}
 	}
@@ -31,7 +31,7 @@
 /* Size of acquisition buffers */
 #define ACQ_BUFFER_SIZE (32 * 1024)
 
-/* Maximum number of samples to retrieve at once. */
+/* Default maximum number of samples to retrieve at once. */
 #define ACQ_BLOCK_SIZE (30 * 1000)
 
 #define MAX_ANALOG_CHANNELS 4
@@ -73,6 +73,8 @@ struct rigol_ds_series {
 	int num_horizontal_divs;
 	int live_samples;
 	int buffer_samples;
+	/* Maximum number of samples per data block query, 0 for the default. */
+	int block_samples;
 };
 
 enum cmds {
@@ -156,15 +158,18 @@ struct dev_context {
 	uint64_t num_block_bytes;
 	/* Number of data block bytes already read */
 	uint64_t num_block_read;
+	/* The query for the next data block has been sent already */
+	gboolean block_requested;
 	/* What to wait for in *_receive */
 	enum wait_events wait_event;
 	/* Trigger/block copying/stop waiting status */
 	int wait_status;
-	/* Acq buffers used for reading from the scope and sending data to app */
+	/* Acq buffer used for reading from the scope and sending data to app */
 	unsigned char *buffer;
-	float *data;
+	size_t buffer_size;
 };
 
+SR_PRIV int rigol_ds_block_samples(const struct dev_context *devc);
 SR_PRIV int rigol_ds_config_set(const struct sr_dev_inst *sdi, const char *format, ...);
 SR_PRIV int rigol_ds_capture_start(const struct sr_dev_inst *sdi);
 SR_PRIV int rigol_ds_channel_start(const struct sr_dev_inst *sdi);
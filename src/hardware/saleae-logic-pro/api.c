@@ -60,17 +60,18 @@ static const uint64_t samplerates[] = {
 static int upload_firmware(struct sr_context *ctx, libusb_device *dev, const char *name)
 {
 	struct libusb_device_handle *hdl = NULL;
-	unsigned char *firmware = NULL;
+	GBytes *data = NULL;
+	const unsigned char *firmware;
 	int ret = SR_ERR;
 	size_t fw_size, fw_offset = 0;
 	uint32_t part_address = 0;
 	uint16_t part_size = 0;
 	uint8_t part_final = 0;
 
-	firmware = sr_resource_load(ctx, SR_RESOURCE_FIRMWARE,
-				    name, &fw_size, 256 * 1024);
-	if (!firmware)
+	data = sr_resource_get(ctx, SR_RESOURCE_FIRMWARE, name, 256 * 1024);
+	if (!data)
 		goto out;
+	firmware = g_bytes_get_data(data, &fw_size);
 
 	sr_info("Uploading firmware '%s'.", name);
 
@@ -78,9 +79,9 @@ static int upload_firmware(struct sr_context *ctx, libusb_device *dev, const cha
 		goto out;
 
 	while ((fw_offset + FW_HEADER_SIZE) <= fw_size) {
-		part_size = GUINT16_FROM_LE(*(uint16_t*)(firmware + fw_offset));
-		part_address = GUINT32_FROM_LE(*(uint32_t*)(firmware + fw_offset + 2));
-		part_final = *(uint8_t*)(firmware + fw_offset + 6);
+		part_size = RL16(firmware + fw_offset);
+		part_address = RL32(firmware + fw_offset + 2);
+		part_final = R8(firmware + fw_offset + 6);
 		if (part_size > FW_MAX_PART_SIZE) {
 			sr_err("Part too large (%d).", part_size);
 			goto out;
@@ -93,7 +94,7 @@ static int upload_firmware(struct sr_context *ctx, libusb_device *dev, const cha
 		ret = libusb_control_transfer(hdl, LIBUSB_REQUEST_TYPE_VENDOR |
 					      LIBUSB_ENDPOINT_OUT, 0xa0,
 					      part_address & 0xffff, part_address >> 16,
-					      firmware + fw_offset, part_size,
+					      (unsigned char *)firmware + fw_offset, part_size,
 					      100);
 		if (ret < 0) {
 			sr_err("Unable to send firmware to device: %s.",
@@ -121,7 +122,8 @@ static int upload_firmware(struct sr_context *ctx, libusb_device *dev, const cha
 	if (hdl)
 		libusb_close(hdl);
 
-	g_free(firmware);
+	if (data)
+		g_bytes_unref(data);
 
 	return ret;
 }
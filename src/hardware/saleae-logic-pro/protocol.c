@@ -492,17 +492,19 @@ static int upload_bitstream(const struct sr_dev_inst *sdi,
 			    const char *name)
 {
 	struct drv_context *drvc = sdi->driver->context;
-	unsigned char *bitstream = NULL;
+	GBytes *data = NULL;
+	const unsigned char *bitstream;
 	uint8_t req[2];
 	uint8_t rsp[1];
 	uint8_t reg_val;
 	int ret = SR_ERR;
 	size_t bs_size, bs_offset = 0, bs_part_size;
 
-	bitstream = sr_resource_load(drvc->sr_ctx, SR_RESOURCE_FIRMWARE,
-				     name, &bs_size, 512 * 1024);
-	if (!bitstream)
+	data = sr_resource_get(drvc->sr_ctx, SR_RESOURCE_FIRMWARE,
+			       name, 512 * 1024);
+	if (!data)
 		goto out;
+	bitstream = g_bytes_get_data(data, &bs_size);
 
 	sr_info("Uploading bitstream '%s'.", name);
 
@@ -511,7 +513,7 @@ static int upload_bitstream(const struct sr_dev_inst *sdi,
 
 	ret = transact(sdi, req, sizeof(req), rsp, sizeof(rsp));
 	if (ret != SR_OK)
-		return ret;
+		goto out;
 	if (rsp[0] != 0x00) {
 		sr_err("Failed to start bitstream upload (0x%02x).", rsp[0]);
 		ret = SR_ERR;
@@ -543,7 +545,8 @@ static int upload_bitstream(const struct sr_dev_inst *sdi,
 	}
 
  out:
-	g_free(bitstream);
+	if (data)
+		g_bytes_unref(data);
 
 	return ret;
 }
@@ -578,14 +581,16 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 			continue;
 
 		mask = 1 << c->index;
-		devc->dig_channel_masks[devc->dig_channel_cnt++] = mask;
+		devc->dig_channel_cnt++;
 		devc->dig_channel_mask |= mask;
 
 	}
 	sr_dbg("%d channels enabled (0x%04x)",
 	       devc->dig_channel_cnt, devc->dig_channel_mask);
 
-	return SR_OK;
+	/* Batches carry one 32-bit word per channel, first sample in MSB. */
+	return sr_transpose_init(&devc->transpose, devc->dig_channel_mask,
+		sizeof(uint32_t), TRUE);
 }
 
 SR_PRIV int saleae_logic_pro_init(const struct sr_dev_inst *sdi)
@@ -796,7 +801,7 @@ SR_PRIV int saleae_logic_pro_start(const struct sr_dev_inst *sdi)
 	struct dev_context *devc = sdi->priv;
 
 	devc->conv_size = 0;
-	devc->batch_index = 0;
+	devc->batch_fill = 0;
 
 	write_reg(sdi, 0x00, 0x01);
 
@@ -846,43 +851,39 @@ static void saleae_logic_pro_send_data(const struct sr_dev_inst *sdi,
  * This stream of batches is packed into USB packets with 16384 bytes each.
  */
 static void saleae_logic_pro_convert_data(const struct sr_dev_inst *sdi,
-					 const uint32_t *src, size_t srccnt)
+					 const uint8_t *src, size_t srclen)
 {
 	struct dev_context *devc = sdi->priv;
-	uint8_t *dst = devc->conv_buffer;
-	uint32_t samples;
-	uint16_t channel_mask;
-	unsigned int sample_index, batch_index;
-	uint16_t *dst_batch;
-
-	/* Copy partial batch to the beginning. */
-	memcpy(dst, dst + devc->conv_size, CONV_BATCH_SIZE);
-	/* Reset converted size. */
+	uint16_t *dst = (uint16_t *)devc->conv_buffer;
+	size_t batch_size, count, used;
+
+	batch_size = devc->transpose.block_size;
 	devc->conv_size = 0;
+	if (!batch_size)
+		return;
 
-	batch_index = devc->batch_index;
-	while (srccnt--) {
-		samples = *src++;
-		dst_batch = (uint16_t*)dst;
-
-		/* First index of the batch. */
-		if (batch_index == 0)
-			memset(dst, 0, CONV_BATCH_SIZE);
-
-		/* Convert one channel. */
-		channel_mask = devc->dig_channel_masks[batch_index];
-		for (sample_index = 0; sample_index <= 31; sample_index++)
-			if ((samples >> (31 - sample_index)) & 1)
-				dst_batch[sample_index] |= channel_mask;
-
-		/* Last index of the batch. */
-		if (++batch_index == devc->dig_channel_cnt) {
-			devc->conv_size += CONV_BATCH_SIZE;
-			batch_index = 0;
-			dst += CONV_BATCH_SIZE;
-		}
+	/* Complete the partial batch of the previous packet. */
+	if (devc->batch_fill) {
+		count = MIN(batch_size - devc->batch_fill, srclen);
+		memcpy(&devc->batch_data[devc->batch_fill], src, count);
+		devc->batch_fill += count;
+		src += count;
+		srclen -= count;
+		if (devc->batch_fill < batch_size)
+			return;
+		dst += sr_transpose_blocks(&devc->transpose,
+			devc->batch_data, batch_size, dst);
+		devc->batch_fill = 0;
 	}
-	devc->batch_index = batch_index;
+
+	/* Convert all complete batches, keep the remainder for later. */
+	count = sr_transpose_blocks(&devc->transpose, src, srclen, dst);
+	dst += count;
+	used = count / 32 * batch_size;
+	memcpy(devc->batch_data, &src[used], srclen - used);
+	devc->batch_fill = srclen - used;
+
+	devc->conv_size = (uint8_t *)dst - devc->conv_buffer;
 }
 
 SR_PRIV void LIBUSB_CALL saleae_logic_pro_receive_data(struct libusb_transfer *transfer)
@@ -903,7 +904,7 @@ SR_PRIV void LIBUSB_CALL saleae_logic_pro_receive_data(struct libusb_transfer *t
 		return;
 	}
 
-	saleae_logic_pro_convert_data(sdi, (uint32_t*)transfer->buffer, 16 * 1024 / 4);
+	saleae_logic_pro_convert_data(sdi, transfer->buffer, 16 * 1024);
 	saleae_logic_pro_send_data(sdi, devc->conv_buffer, devc->conv_size, 2);
 
 	if ((ret = libusb_submit_transfer(transfer)) != LIBUSB_SUCCESS)
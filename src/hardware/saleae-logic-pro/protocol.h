@@ -39,7 +39,6 @@
 struct dev_context {
 	unsigned int dig_channel_cnt;
 	uint16_t dig_channel_mask;
-	uint16_t dig_channel_masks[16];
 	uint64_t dig_samplerate;
 
 	uint32_t lfsr;
@@ -48,9 +47,11 @@ struct dev_context {
 	unsigned int submitted_transfers;
 	struct libusb_transfer **transfers;
 
+	struct sr_transpose transpose;
 	uint8_t *conv_buffer;
 	unsigned int conv_size;
-	unsigned int batch_index;
+	uint8_t batch_data[16 * sizeof(uint32_t)];
+	size_t batch_fill;
 };
 
 SR_PRIV int saleae_logic_pro_init(const struct sr_dev_inst *sdi);
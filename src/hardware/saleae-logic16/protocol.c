@@ -457,17 +457,66 @@ static int configure_led(const struct sr_dev_inst *sdi)
 	return set_led_mode(sdi, 1, 6250, 0, 1);
 }
 
+static int send_fpga_bitstream(const struct sr_dev_inst *sdi,
+			       const char *name, GBytes *bitstream)
+{
+	const uint8_t *data;
+	size_t size, sum, chunksize;
+	int ret;
+	uint8_t command[64];
+
+	sr_info("Uploading FPGA bitstream '%s'.", name);
+	data = g_bytes_get_data(bitstream, &size);
+
+	command[0] = COMMAND_FPGA_UPLOAD_INIT;
+	if ((ret = do_ep1_command(sdi, command, 1, NULL, 0)) != SR_OK)
+		return ret;
+
+	sum = 0;
+	while (sum < size) {
+		chunksize = MIN(size - sum, sizeof(command) - 2);
+		command[0] = COMMAND_FPGA_UPLOAD_SEND_DATA;
+		command[1] = chunksize;
+		memcpy(&command[2], &data[sum], chunksize);
+
+		ret = do_ep1_command(sdi, command, chunksize + 2, NULL, 0);
+		if (ret != SR_OK)
+			return ret;
+		sum += chunksize;
+	}
+	sr_info("FPGA bitstream upload (%zu bytes) done.", sum);
+
+	return SR_OK;
+}
+
+/*
+ * Check whether a bitstream which was uploaded before still runs. The
+ * FPGA must respond with a known version, after the register mapping
+ * for the bitstream's version got set up.
+ */
+static gboolean fpga_bitstream_responds(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	uint8_t version;
+
+	devc = sdi->priv;
+
+	if (setup_register_mapping(sdi) != SR_OK)
+		return FALSE;
+	if (read_fpga_register(sdi, FPGA_REG(VERSION), &version) != SR_OK)
+		return FALSE;
+
+	return version == 0x10 || version == 0x13;
+}
+
 static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 				 enum voltage_range vrange)
 {
-	uint64_t sum;
-	struct sr_resource bitstream;
+	GBytes *bitstream;
 	struct dev_context *devc;
 	struct drv_context *drvc;
 	const char *name;
-	ssize_t chunksize;
 	int ret;
-	uint8_t command[64];
 
 	devc = sdi->priv;
 	drvc = sdi->driver->context;
@@ -475,6 +524,7 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 	if (devc->cur_voltage_range == vrange)
 		return SR_OK;
 
+	bitstream = NULL;
 	if (devc->fpga_variant != FPGA_VARIANT_MCUPRO) {
 		switch (vrange) {
 		case VOLTAGE_RANGE_18_33_V:
@@ -488,51 +538,34 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 			return SR_ERR;
 		}
 
-		sr_info("Uploading FPGA bitstream '%s'.", name);
-		ret = sr_resource_open(drvc->sr_ctx, &bitstream,
-				SR_RESOURCE_FIRMWARE, name);
-		if (ret != SR_OK)
-			return ret;
-
-		command[0] = COMMAND_FPGA_UPLOAD_INIT;
-		if ((ret = do_ep1_command(sdi, command, 1, NULL, 0)) != SR_OK) {
-			sr_resource_close(drvc->sr_ctx, &bitstream);
-			return ret;
-		}
-
-		sum = 0;
-		while (1) {
-			chunksize = sr_resource_read(drvc->sr_ctx, &bitstream,
-					&command[2], sizeof(command) - 2);
-			if (chunksize < 0) {
-				sr_resource_close(drvc->sr_ctx, &bitstream);
-				return SR_ERR;
-			}
-			if (chunksize == 0)
-				break;
-			command[0] = COMMAND_FPGA_UPLOAD_SEND_DATA;
-			command[1] = chunksize;
+		bitstream = sr_resource_get(drvc->sr_ctx,
+				SR_RESOURCE_FIRMWARE, name, G_MAXSSIZE);
+		if (!bitstream)
+			return SR_ERR;
 
-			ret = do_ep1_command(sdi, command, chunksize + 2,
-					NULL, 0);
+		/* Skip the upload when the device runs the bitstream. */
+		if (sr_usb_fpga_bitstream_loaded(sdi, bitstream) &&
+				fpga_bitstream_responds(sdi)) {
+			sr_info("FPGA bitstream '%s' is loaded already.", name);
+		} else {
+			sr_usb_fpga_bitstream_set(sdi, NULL);
+			ret = send_fpga_bitstream(sdi, name, bitstream);
 			if (ret != SR_OK) {
-				sr_resource_close(drvc->sr_ctx, &bitstream);
+				g_bytes_unref(bitstream);
 				return ret;
 			}
-			sum += chunksize;
 		}
-		sr_resource_close(drvc->sr_ctx, &bitstream);
-		sr_info("FPGA bitstream upload (%" PRIu64 " bytes) done.", sum);
 	}
 
 	/* This needs to be called before accessing any FPGA registers. */
-	if ((ret = setup_register_mapping(sdi)) != SR_OK)
-		return ret;
-
-	if ((ret = prime_fpga(sdi)) != SR_OK)
-		return ret;
-
-	if ((ret = configure_led(sdi)) != SR_OK)
+	if ((ret = setup_register_mapping(sdi)) == SR_OK &&
+			(ret = prime_fpga(sdi)) == SR_OK)
+		ret = configure_led(sdi);
+	if (bitstream) {
+		sr_usb_fpga_bitstream_set(sdi, ret == SR_OK ? bitstream : NULL);
+		g_bytes_unref(bitstream);
+	}
+	if (ret != SR_OK)
 		return ret;
 
 	devc->cur_voltage_range = vrange;
@@ -803,46 +836,58 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 	sr_err("%s: %s", __func__, libusb_error_name(ret));
 }
 
+/*
+ * The device sends a 16-bit word per enabled channel, 16 samples of it
+ * with the first in the MSB. Transpose whole groups of channel words
+ * right into the buffer which gets sent, keep a partial group of the
+ * transfer for the next one.
+ */
 static size_t convert_sample_data(struct dev_context *devc,
 		uint8_t *dest, size_t destcnt, const uint8_t *src, size_t srccnt)
 {
-	uint16_t *channel_data;
-	int i, cur_channel;
-	size_t ret = 0;
-	uint16_t sample, channel_mask;
-
-	srccnt /= 2;
-
-	channel_data = devc->channel_data;
-	cur_channel = devc->cur_channel;
-
-	while (srccnt--) {
-		sample = src[0] | (src[1] << 8);
-		src += 2;
-
-		channel_mask = devc->channel_masks[cur_channel];
-
-		for (i = 15; i >= 0; --i, sample >>= 1)
-			if (sample & 1)
-				channel_data[i] |= channel_mask;
-
-		if (++cur_channel == devc->num_channels) {
-			cur_channel = 0;
-			if (destcnt < 16 * 2) {
-				sr_err("Conversion buffer too small!");
-				break;
-			}
-			memcpy(dest, channel_data, 16 * 2);
-			memset(channel_data, 0, 16 * 2);
-			dest += 16 * 2;
-			ret += 16;
-			destcnt -= 16 * 2;
-		}
-	}
-
-	devc->cur_channel = cur_channel;
-
-	return ret;
+	uint16_t *dst;
+	size_t block_size, count, used, samples;
+
+	block_size = devc->transpose.block_size;
+	if (!block_size)
+		return 0;
+
+	dst = (uint16_t *)dest;
+	samples = 0;
+
+	/* Complete the partial group of the previous transfer. */
+	if (devc->block_fill) {
+		count = MIN(block_size - devc->block_fill, srccnt);
+		memcpy(&devc->block_data[devc->block_fill], src, count);
+		devc->block_fill += count;
+		src += count;
+		srccnt -= count;
+		if (devc->block_fill < block_size)
+			return 0;
+		samples += sr_transpose_blocks(&devc->transpose,
+			devc->block_data, block_size, dst);
+		devc->block_fill = 0;
+	}
+
+	count = srccnt / block_size;
+	if ((samples + count * 16) * 2 > destcnt) {
+		sr_err("Conversion buffer too small!");
+		count = destcnt / 2 / 16 - samples / 16;
+		srccnt = count * block_size;
+	}
+	samples += sr_transpose_blocks(&devc->transpose, src, srccnt,
+		dst + samples);
+	used = count * block_size;
+	devc->block_fill = srccnt - used;
+	memcpy(devc->block_data, &src[used], devc->block_fill);
+
+#ifdef WORDS_BIGENDIAN
+	/* Output logic data is stored in little endian format. */
+	for (count = 0; count < samples; count++)
+		dst[count] = GUINT16_TO_LE(dst[count]);
+#endif
+
+	return samples;
 }
 
 SR_PRIV void LIBUSB_CALL logic16_receive_transfer(struct libusb_transfer *transfer)
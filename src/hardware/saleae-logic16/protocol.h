@@ -78,9 +78,10 @@ struct dev_context {
 	int submitted_transfers;
 	int empty_transfer_count;
 	int num_channels;
-	int cur_channel;
-	uint16_t channel_masks[16];
-	uint16_t channel_data[16];
+	struct sr_transpose transpose;
+	/* A partial group of channel words, which the next transfer completes. */
+	uint8_t block_data[16 * sizeof(uint16_t)];
+	size_t block_fill;
 	uint8_t *convbuffer;
 	size_t convbuffer_size;
 	struct soft_trigger_logic *stl;
@@ -48,6 +48,24 @@ static const uint32_t devopts_generic_range[] = {
 	SR_CONF_RANGE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 };
 
+static const uint32_t devopts_buffered[] = {
+	SR_CONF_CONTINUOUS,
+	SR_CONF_CONN | SR_CONF_GET,
+	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_MEASURED_QUANTITY | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
+	SR_CONF_RANGE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
+	SR_CONF_DATALOG | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
+};
+
+/* Without the DIG option, and with an integration time which fits. */
+static const uint64_t samplerates_keysight_34465a[] = {
+	SR_HZ(1),
+	SR_KHZ(5),
+	SR_HZ(1),
+};
+
 static const struct scpi_command cmdset_agilent[] = {
 	{ DMM_CMD_SETUP_REMOTE, "\n", },
 	{ DMM_CMD_SETUP_LOCAL, "SYST:LOC", },
@@ -63,6 +81,29 @@ static const struct scpi_command cmdset_agilent[] = {
 	ALL_ZERO,
 };
 
+/*
+ * The Truevolt meters take readings at a fixed interval into their
+ * memory. R? returns and removes the readings which are available.
+ */
+static const struct scpi_command cmdset_keysight_truevolt[] = {
+	{ DMM_CMD_SETUP_REMOTE, "\n", },
+	{ DMM_CMD_SETUP_LOCAL, "SYST:LOC", },
+	{ DMM_CMD_SETUP_FUNC, "CONF:%s", },
+	{ DMM_CMD_QUERY_FUNC, "CONF?", },
+	{ DMM_CMD_START_ACQ, "INIT", },
+	{ DMM_CMD_STOP_ACQ, "ABORT", },
+	{ DMM_CMD_QUERY_VALUE, "FETCH?", },
+	{ DMM_CMD_QUERY_PREC, "CONF?", },
+	{ DMM_CMD_QUERY_RANGE_AUTO, "%s:RANGE:AUTO?", },
+	{ DMM_CMD_QUERY_RANGE, "%s:RANGE?", },
+	{ DMM_CMD_SETUP_RANGE, "CONF:%s %s", },
+	{ DMM_CMD_SETUP_BUFFER, "TRIG:SOUR IMM;:TRIG:COUN 1;:SAMP:SOUR TIM;:SAMP:TIM %.6f;:SAMP:COUN %u", },
+	{ DMM_CMD_SETUP_BINARY, "FORM:DATA REAL,32", },
+	{ DMM_CMD_SETUP_ASCII, "FORM:DATA ASC", },
+	{ DMM_CMD_QUERY_BUFFER, "R? %u", },
+	ALL_ZERO,
+};
+
 /*
  * cmdset_hp is used for the 34401A, which was added to this code after the
  * 34405A and 34465A. It differs in starting the measurement with INIT: using
@@ -267,11 +308,12 @@ SR_PRIV const struct scpi_dmm_model models[] = {
 	},
 	{
 		"Keysight", "34465A",
-		1, 6, cmdset_agilent, ARRAY_AND_SIZE(mqopts_agilent_34405a),
+		1, 6, cmdset_keysight_truevolt, ARRAY_AND_SIZE(mqopts_agilent_34405a),
 		scpi_dmm_get_meas_agilent,
-		ARRAY_AND_SIZE(devopts_generic_range),
+		ARRAY_AND_SIZE(devopts_buffered),
 		0, 0, 10 * 1000, 0, FALSE,
 		scpi_dmm_get_range_text, scpi_dmm_set_range_from_text, NULL,
+		1000000, TRUE, samplerates_keysight_34465a,
 	},
 	{
 		"OWON", "XDM2041",
@@ -369,6 +411,8 @@ static struct sr_dev_inst *probe_device(struct sr_scpi_dev_inst *scpi)
 	devc->num_channels = model->num_channels;
 	devc->cmdset = model->cmdset;
 	devc->model = model;
+	if (model->samplerates)
+		devc->samplerate = model->samplerates[0];
 
 	for (i = 0; i < devc->num_channels; i++) {
 		channel_name = g_strdup_printf("P%zu", i + 1);
@@ -475,6 +519,16 @@ static int config_get(uint32_t key, GVariant **data,
 			return SR_ERR_NA;
 		*data = g_variant_new_string(range);
 		return SR_OK;
+	case SR_CONF_DATALOG:
+		if (!devc || !devc->model->buffer_size)
+			return SR_ERR_NA;
+		*data = g_variant_new_boolean(devc->datalog);
+		return SR_OK;
+	case SR_CONF_SAMPLERATE:
+		if (!devc || !devc->model->buffer_size)
+			return SR_ERR_NA;
+		*data = g_variant_new_uint64(devc->samplerate);
+		return SR_OK;
 	default:
 		return SR_ERR_NA;
 	}
@@ -488,6 +542,8 @@ static int config_set(uint32_t key, GVariant *data,
 	enum sr_mqflag mqflag;
 	GVariant *tuple_child;
 	const char *range;
+	uint64_t samplerate;
+	const uint64_t *rates;
 
 	(void)cg;
 
@@ -510,6 +566,20 @@ static int config_set(uint32_t key, GVariant *data,
 			return SR_ERR_NA;
 		range = g_variant_get_string(data, NULL);
 		return devc->model->set_range_from_text(sdi, range);
+	case SR_CONF_DATALOG:
+		if (!devc || !devc->model->buffer_size)
+			return SR_ERR_NA;
+		devc->datalog = g_variant_get_boolean(data);
+		return SR_OK;
+	case SR_CONF_SAMPLERATE:
+		if (!devc || !devc->model->buffer_size)
+			return SR_ERR_NA;
+		samplerate = g_variant_get_uint64(data);
+		rates = devc->model->samplerates;
+		if (samplerate < rates[0] || samplerate > rates[1])
+			return SR_ERR_ARG;
+		devc->samplerate = samplerate;
+		return SR_OK;
 	default:
 		return SR_ERR_NA;
 	}
@@ -554,6 +624,11 @@ static int config_list(uint32_t key, GVariant **data,
 			return SR_ERR_NA;
 		*data = devc->model->get_range_text_list(sdi);
 		return SR_OK;
+	case SR_CONF_SAMPLERATE:
+		if (!devc || !devc->model->samplerates)
+			return SR_ERR_NA;
+		*data = std_gvar_samplerates_steps(devc->model->samplerates, 3);
+		return SR_OK;
 	default:
 		(void)devc;
 		return SR_ERR_NA;
@@ -609,11 +684,26 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	if (do_mq_meas_delay && devc->model->meas_delay_us)
 		g_usleep(devc->model->meas_delay_us);
 
+	if (devc->datalog && devc->model->buffer_size) {
+		ret = scpi_dmm_buffer_start(sdi);
+		if (ret != SR_OK) {
+			scpi_dmm_buffer_stop(sdi);
+			return ret;
+		}
+	}
+
 	sr_sw_limits_acquisition_start(&devc->limits);
 	ret = std_session_send_df_header(sdi);
 	if (ret != SR_OK)
 		return ret;
 
+	if (devc->buffer.active) {
+		sr_session_send_meta_u64(sdi, SR_CONF_SAMPLERATE,
+			devc->samplerate);
+		return sr_scpi_source_add(sdi->session, scpi, G_IO_IN, 10,
+			scpi_dmm_receive_buffered, (void *)sdi);
+	}
+
 	ret = sr_scpi_source_add(sdi->session, scpi, G_IO_IN, 10,
 		scpi_dmm_receive_data, (void *)sdi);
 	if (ret != SR_OK)
@@ -636,6 +726,7 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 		scpi_dmm_cmd_delay(scpi);
 		(void)sr_scpi_send(scpi, command);
 	}
+	scpi_dmm_buffer_stop(sdi);
 	sr_scpi_source_remove(sdi->session, scpi);
 
 	std_session_send_df_end(sdi);
@@ -727,6 +727,7 @@ SR_PRIV int scpi_dmm_receive_data(int fd, int revents, void *cb_data)
 	gboolean sent_sample;
 	size_t ch;
 	struct sr_channel *channel;
+	GSList ch_node;
 	int ret;
 
 	(void)fd;
@@ -745,7 +746,7 @@ SR_PRIV int scpi_dmm_receive_data(int fd, int revents, void *cb_data)
 	ret = SR_OK;
 	for (ch = 0; ch < devc->num_channels; ch++) {
 		/* Check the channel's enabled status. */
-		channel = g_slist_nth_data(sdi->channels, ch);
+		channel = sr_dev_channel_nth(sdi, ch);
 		if (!channel->enabled)
 			continue;
 
@@ -786,9 +787,9 @@ SR_PRIV int scpi_dmm_receive_data(int fd, int revents, void *cb_data)
 
 		/* Send the packet that was filled in by the model's routine. */
 		info->analog[ch].num_samples = 1;
-		info->analog[ch].meaning->channels = g_slist_append(NULL, channel);
+		sr_analog_meaning_channel_set(info->analog[ch].meaning,
+			&ch_node, channel);
 		sr_session_send(sdi, &info->packet);
-		g_slist_free(info->analog[ch].meaning->channels);
 		sent_sample = TRUE;
 	}
 	if (sent_sample)
@@ -803,3 +804,161 @@ SR_PRIV int scpi_dmm_receive_data(int fd, int revents, void *cb_data)
 
 	return TRUE;
 }
+
+/*
+ * Set up buffered acquisition: the meter takes readings at the
+ * configured samplerate into its measurement memory, from where they
+ * get fetched in blocks. The rate is not limited by the round trip
+ * time of a query per reading.
+ *
+ * A single reading is taken first. Its quantity, unit and resolution
+ * apply to all readings from the memory.
+ */
+SR_PRIV int scpi_dmm_buffer_start(const struct sr_dev_inst *sdi)
+{
+	struct sr_scpi_dev_inst *scpi;
+	struct dev_context *devc;
+	struct scpi_dmm_acq_info *info;
+	uint64_t count;
+	int ret;
+
+	scpi = sdi->conn;
+	devc = sdi->priv;
+	info = &devc->run_acq_info;
+
+	if (!devc->samplerate) {
+		sr_err("Buffered acquisition needs a samplerate.");
+		return SR_ERR_ARG;
+	}
+	if (!devc->model->get_measurement)
+		return SR_ERR_NA;
+	sr_analog_init(&info->analog[0], &info->encoding[0],
+		&info->meaning[0], &info->spec[0], 0);
+	scpi_dmm_cmd_delay(scpi);
+	ret = devc->model->get_measurement(sdi, 0);
+	if (ret != SR_OK)
+		return (ret > 0) ? SR_ERR_DATA : ret;
+
+	count = devc->model->buffer_size;
+	if (devc->limits.limit_samples)
+		count = MIN(count, devc->limits.limit_samples);
+	scpi_dmm_cmd_delay(scpi);
+	ret = sr_scpi_cmd(sdi, devc->cmdset, 0, NULL, DMM_CMD_STOP_ACQ);
+	if (ret != SR_OK)
+		return ret;
+	/* From here on scpi_dmm_buffer_stop() restores the setup. */
+	devc->buffer.active = TRUE;
+	if (devc->model->buffer_binary) {
+		scpi_dmm_cmd_delay(scpi);
+		ret = sr_scpi_cmd(sdi, devc->cmdset, 0, NULL,
+			DMM_CMD_SETUP_BINARY);
+		if (ret != SR_OK)
+			return ret;
+	}
+	scpi_dmm_cmd_delay(scpi);
+	ret = sr_scpi_cmd(sdi, devc->cmdset, 0, NULL, DMM_CMD_SETUP_BUFFER,
+		1.0 / devc->samplerate, (unsigned int)count);
+	if (ret != SR_OK)
+		return ret;
+	scpi_dmm_cmd_delay(scpi);
+	ret = sr_scpi_cmd(sdi, devc->cmdset, 0, NULL, DMM_CMD_START_ACQ);
+	if (ret != SR_OK)
+		return ret;
+
+	devc->buffer.remain = count;
+	if (!devc->buffer.readings)
+		devc->buffer.readings = g_array_new(FALSE, FALSE, sizeof(float));
+
+	return SR_OK;
+}
+
+/* Have the meter take single readings again. */
+SR_PRIV void scpi_dmm_buffer_stop(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+	if (!devc->buffer.active)
+		return;
+
+	if (devc->model->buffer_binary) {
+		scpi_dmm_cmd_delay(sdi->conn);
+		(void)sr_scpi_cmd(sdi, devc->cmdset, 0, NULL,
+			DMM_CMD_SETUP_ASCII);
+	}
+	if (devc->buffer.readings)
+		g_array_free(devc->buffer.readings, TRUE);
+	devc->buffer.readings = NULL;
+	devc->buffer.active = FALSE;
+}
+
+/* Fetch the readings from the meter's memory, send them in one packet. */
+SR_PRIV int scpi_dmm_receive_buffered(int fd, int revents, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	struct scpi_dmm_acq_info *info;
+	struct sr_datafeed_analog *analog;
+	struct sr_channel *channel;
+	GSList ch_node;
+	const char *command;
+	char request[64];
+	float *values, limit;
+	size_t count, i;
+	int ret;
+
+	(void)fd;
+	(void)revents;
+
+	sdi = cb_data;
+	if (!sdi || !(devc = sdi->priv) || !devc->buffer.readings)
+		return TRUE;
+	info = &devc->run_acq_info;
+	analog = &info->analog[0];
+
+	command = sr_scpi_cmd_get(devc->cmdset, DMM_CMD_QUERY_BUFFER);
+	if (!command || !*command) {
+		sr_dev_acquisition_stop(sdi);
+		return TRUE;
+	}
+	count = MIN(devc->buffer.remain, SCPI_DMM_FETCH_MAX);
+	snprintf(request, sizeof(request), command, (unsigned int)count);
+	ret = sr_scpi_get_readings(sdi->conn, request,
+		devc->model->buffer_binary, devc->buffer.readings);
+	if (ret != SR_OK) {
+		sr_err("Cannot fetch readings: %s.", sr_strerror(ret));
+		sr_dev_acquisition_stop(sdi);
+		return TRUE;
+	}
+	count = MIN(devc->buffer.readings->len, devc->buffer.remain);
+	if (!count)
+		return TRUE;
+
+	/* Overload readings are huge values, like in single readings. */
+	limit = 9e37;
+	if (devc->model->infinity_limit != 0.0)
+		limit = devc->model->infinity_limit;
+	values = (float *)devc->buffer.readings->data;
+	for (i = 0; i < count; i++) {
+		if (values[i] >= +limit)
+			values[i] = +INFINITY;
+		else if (values[i] <= -limit)
+			values[i] = -INFINITY;
+	}
+
+	channel = sr_dev_channel_nth(sdi, 0);
+	analog->data = values;
+	analog->num_samples = count;
+	analog->encoding->unitsize = sizeof(float);
+	sr_analog_meaning_channel_set(analog->meaning, &ch_node, channel);
+	info->packet.type = SR_DF_ANALOG;
+	info->packet.payload = analog;
+	sr_session_send(sdi, &info->packet);
+
+	sr_sw_limits_update_samples_read(&devc->limits, count);
+	devc->buffer.remain -= count;
+	if (!devc->buffer.remain || sr_sw_limits_check(&devc->limits))
+		sr_dev_acquisition_stop(sdi);
+
+	return TRUE;
+}
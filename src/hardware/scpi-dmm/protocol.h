@@ -32,6 +32,9 @@
 
 #define SCPI_DMM_MAX_CHANNELS	1
 
+/* Most readings which one fetch from the measurement memory takes. */
+#define SCPI_DMM_FETCH_MAX	10000
+
 enum scpi_dmm_cmdcode {
 	DMM_CMD_SETUP_REMOTE,
 	DMM_CMD_SETUP_FUNC,
@@ -45,6 +48,10 @@ enum scpi_dmm_cmdcode {
 	DMM_CMD_QUERY_RANGE,
 	DMM_CMD_SETUP_RANGE_AUTO,
 	DMM_CMD_SETUP_RANGE,
+	DMM_CMD_SETUP_BUFFER,
+	DMM_CMD_SETUP_BINARY,
+	DMM_CMD_SETUP_ASCII,
+	DMM_CMD_QUERY_BUFFER,
 };
 
 struct mqopt_item {
@@ -81,6 +88,14 @@ struct scpi_dmm_model {
 	int (*set_range_from_text)(const struct sr_dev_inst *sdi,
 		const char *range);
 	GVariant *(*get_range_text_list)(const struct sr_dev_inst *sdi);
+	/*
+	 * Buffered acquisition: readings per acquisition in the measurement
+	 * memory (zero if not supported), binary transfer of readings, and
+	 * the min/max/step of the samplerate.
+	 */
+	size_t buffer_size;
+	gboolean buffer_binary;
+	const uint64_t *samplerates;
 };
 
 struct dev_context {
@@ -103,6 +118,13 @@ struct dev_context {
 	} run_acq_info;
 	gchar *precision;
 	char range_text[32];
+	gboolean datalog;
+	uint64_t samplerate;
+	struct {
+		gboolean active;
+		uint64_t remain;
+		GArray *readings;
+	} buffer;
 };
 
 SR_PRIV void scpi_dmm_cmd_delay(struct sr_scpi_dev_inst *scpi);
@@ -122,5 +144,8 @@ SR_PRIV GVariant *scpi_dmm_get_range_text_list(const struct sr_dev_inst *sdi);
 SR_PRIV int scpi_dmm_get_meas_agilent(const struct sr_dev_inst *sdi, size_t ch);
 SR_PRIV int scpi_dmm_get_meas_gwinstek(const struct sr_dev_inst *sdi, size_t ch);
 SR_PRIV int scpi_dmm_receive_data(int fd, int revents, void *cb_data);
+SR_PRIV int scpi_dmm_buffer_start(const struct sr_dev_inst *sdi);
+SR_PRIV void scpi_dmm_buffer_stop(const struct sr_dev_inst *sdi);
+SR_PRIV int scpi_dmm_receive_buffered(int fd, int revents, void *cb_data);
 
 #endif
@@ -100,6 +100,8 @@ static struct sr_dev_inst *probe_device(struct sr_scpi_dev_inst *scpi,
 
 	devc = g_malloc0(sizeof(struct dev_context));
 	devc->device = device;
+	if (device->samplerates)
+		devc->samplerate = device->samplerates[0];
 	sr_sw_limits_init(&devc->limits);
 	sdi->priv = devc;
 
@@ -324,6 +326,8 @@ static void clear_helper(struct dev_context *devc)
 {
 	g_free(devc->channels);
 	g_free(devc->channel_groups);
+	if (devc->readings)
+		g_array_free(devc->readings, TRUE);
 }
 
 static int dev_clear(const struct sr_dev_driver *di)
@@ -459,6 +463,16 @@ static int config_get(uint32_t key, GVariant **data,
 		gvtype = G_VARIANT_TYPE_STRING;
 		cmd = SCPI_CMD_GET_OUTPUT_REGULATION;
 		break;
+	case SR_CONF_DATALOG:
+		if (!devc->device->buffer_size)
+			return SR_ERR_NA;
+		*data = g_variant_new_boolean(devc->datalog);
+		return SR_OK;
+	case SR_CONF_SAMPLERATE:
+		if (!devc->device->buffer_size)
+			return SR_ERR_NA;
+		*data = g_variant_new_uint64(devc->samplerate);
+		return SR_OK;
 	default:
 		return sr_sw_limits_config_get(&devc->limits, key, data);
 	}
@@ -621,6 +635,7 @@ static int config_set(uint32_t key, GVariant *data,
 {
 	struct dev_context *devc;
 	double d;
+	uint64_t samplerate;
 	int channel_group_cmd;
 	char *channel_group_name;
 	int ret;
@@ -708,6 +723,28 @@ static int config_set(uint32_t key, GVariant *data,
 					channel_group_cmd, channel_group_name,
 					SCPI_CMD_SET_OVER_TEMPERATURE_PROTECTION_DISABLE);
 		break;
+	case SR_CONF_DATALOG:
+		if (!devc->device->buffer_size) {
+			ret = SR_ERR_NA;
+			break;
+		}
+		devc->datalog = g_variant_get_boolean(data);
+		ret = SR_OK;
+		break;
+	case SR_CONF_SAMPLERATE:
+		if (!devc->device->buffer_size) {
+			ret = SR_ERR_NA;
+			break;
+		}
+		samplerate = g_variant_get_uint64(data);
+		if (samplerate < devc->device->samplerates[0] ||
+				samplerate > devc->device->samplerates[1]) {
+			ret = SR_ERR_ARG;
+			break;
+		}
+		devc->samplerate = samplerate;
+		ret = SR_OK;
+		break;
 	default:
 		ret = sr_sw_limits_config_set(&devc->limits, key, data);
 	}
@@ -759,6 +796,12 @@ static int config_list(uint32_t key, GVariant **data,
 			}
 			*data = g_variant_new_strv(s, i);
 			break;
+		case SR_CONF_SAMPLERATE:
+			if (!devc || !devc->device || !devc->device->samplerates)
+				return SR_ERR_NA;
+			*data = std_gvar_samplerates_steps(
+				devc->device->samplerates, 3);
+			break;
 		default:
 			return SR_ERR_NA;
 		}
@@ -811,17 +854,31 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	devc = sdi->priv;
 	scpi = sdi->conn;
 
-	/* Prime the pipe with the first channel. */
-	devc->cur_acquisition_channel = sr_next_enabled_channel(sdi, NULL);
+	/* Prepare the queries for all enabled channels. */
+	if ((ret = scpi_pps_setup_measurements(sdi)) != SR_OK)
+		return ret;
 
 	/* Device specific initialization before acquisition starts. */
 	if (devc->device->init_acquisition)
 		devc->device->init_acquisition(sdi);
 
-	if ((ret = sr_scpi_source_add(sdi->session, scpi, G_IO_IN, 10,
-			scpi_pps_receive_data, (void *)sdi)) != SR_OK)
+	/* Have the device measure arrays when it supports that. */
+	devc->buffer_points = 0;
+	if (devc->datalog && devc->device->buffer_size) {
+		if ((ret = scpi_pps_buffer_start(sdi)) != SR_OK)
+			return ret;
+		ret = sr_scpi_source_add(sdi->session, scpi, G_IO_IN, 10,
+			scpi_pps_receive_buffered, (void *)sdi);
+	} else {
+		ret = sr_scpi_source_add(sdi->session, scpi, G_IO_IN, 10,
+			scpi_pps_receive_data, (void *)sdi);
+	}
+	if (ret != SR_OK)
 		return ret;
 	std_session_send_df_header(sdi);
+	if (devc->buffer_points)
+		sr_session_send_meta_u64(sdi, SR_CONF_SAMPLERATE,
+			devc->samplerate);
 	sr_sw_limits_acquisition_start(&devc->limits);
 
 	return SR_OK;
@@ -829,11 +886,19 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 {
+	struct dev_context *devc;
 	struct sr_scpi_dev_inst *scpi;
 
+	devc = sdi->priv;
 	scpi = sdi->conn;
 
 	sr_scpi_source_remove(sdi->session, scpi);
+	sr_scpi_async_cancel(scpi);
+	sr_scpi_batch_free(devc->measurements);
+	devc->measurements = NULL;
+	if (devc->readings)
+		g_array_free(devc->readings, TRUE);
+	devc->readings = NULL;
 
 	std_session_send_df_end(sdi);
 
@@ -692,18 +692,18 @@ static int hp_6630a_update_status(const struct sr_dev_inst *sdi)
 
 	/* OVP */
 	if (fault & (1 << 3))
-		sr_session_send_meta(sdi, SR_CONF_OVER_VOLTAGE_PROTECTION_ACTIVE,
-			g_variant_new_boolean(fault & (1 << 3)));
+		sr_session_send_meta_bool(sdi, SR_CONF_OVER_VOLTAGE_PROTECTION_ACTIVE,
+			fault & (1 << 3));
 
 	/* OCP */
 	if (fault & (1 << 6))
-		sr_session_send_meta(sdi, SR_CONF_OVER_CURRENT_PROTECTION_ACTIVE,
-			g_variant_new_boolean(fault & (1 << 6)));
+		sr_session_send_meta_bool(sdi, SR_CONF_OVER_CURRENT_PROTECTION_ACTIVE,
+			fault & (1 << 6));
 
 	/* OTP */
 	if (fault & (1 << 4))
-		sr_session_send_meta(sdi, SR_CONF_OVER_TEMPERATURE_PROTECTION_ACTIVE,
-			g_variant_new_boolean(fault & (1 << 4)));
+		sr_session_send_meta_bool(sdi, SR_CONF_OVER_TEMPERATURE_PROTECTION_ACTIVE,
+			fault & (1 << 4));
 
 	/* CV */
 	cv = (fault & (1 << 0));
@@ -749,6 +749,22 @@ static const uint32_t hp_6630b_devopts[] = {
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
 };
 
+/* Models with a digitizer, which measures arrays of up to 4096 points. */
+static const uint32_t hp_6630b_devopts_buffered[] = {
+	SR_CONF_CONTINUOUS,
+	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_DATALOG | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
+};
+
+/* The sample interval is 15.6us to 31200s, in steps of 15.6us. */
+static const uint64_t hp_6630b_samplerates[] = {
+	SR_HZ(1),
+	SR_KHZ(64),
+	SR_HZ(1),
+};
+
 static const uint32_t hp_6630b_devopts_cg[] = {
 	SR_CONF_ENABLED | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_VOLTAGE | SR_CONF_GET,
@@ -832,6 +848,11 @@ static const struct scpi_command hp_6630b_cmd[] = {
 	{ SCPI_CMD_SET_OVER_VOLTAGE_PROTECTION_THRESHOLD, ":VOLT:PROT %.6f" },
 	{ SCPI_CMD_GET_OVER_TEMPERATURE_PROTECTION_ACTIVE, "STAT:QUES:COND?" },
 	{ SCPI_CMD_GET_OUTPUT_REGULATION, "STAT:OPER:COND?" },
+	{ SCPI_CMD_SET_MEAS_ARRAY, ":SENS:SWE:POIN %u;TINT %.6e" },
+	{ SCPI_CMD_GET_MEAS_ARRAY_VOLTAGE, ":MEAS:ARR:VOLT?" },
+	{ SCPI_CMD_GET_MEAS_ARRAY_CURRENT, ":MEAS:ARR:CURR?" },
+	{ SCPI_CMD_GET_FETCH_ARRAY_VOLTAGE, ":FETC:ARR:VOLT?" },
+	{ SCPI_CMD_GET_FETCH_ARRAY_CURRENT, ":FETC:ARR:CURR?" },
 	ALL_ZERO
 };
 
@@ -929,18 +950,18 @@ static int hp_6630b_update_status(const struct sr_dev_inst *sdi)
 
 		/* OVP */
 		if (ques_even & (1 << 0))
-			sr_session_send_meta(sdi, SR_CONF_OVER_VOLTAGE_PROTECTION_ACTIVE,
-				g_variant_new_boolean(ques_cond & (1 << 0)));
+			sr_session_send_meta_bool(sdi, SR_CONF_OVER_VOLTAGE_PROTECTION_ACTIVE,
+				ques_cond & (1 << 0));
 
 		/* OCP */
 		if (ques_even & (1 << 1))
-			sr_session_send_meta(sdi, SR_CONF_OVER_CURRENT_PROTECTION_ACTIVE,
-				g_variant_new_boolean(ques_cond & (1 << 1)));
+			sr_session_send_meta_bool(sdi, SR_CONF_OVER_CURRENT_PROTECTION_ACTIVE,
+				ques_cond & (1 << 1));
 
 		/* OTP */
 		if (ques_even & (1 << 4))
-			sr_session_send_meta(sdi, SR_CONF_OVER_TEMPERATURE_PROTECTION_ACTIVE,
-				g_variant_new_boolean(ques_cond & (1 << 4)));
+			sr_session_send_meta_bool(sdi, SR_CONF_OVER_TEMPERATURE_PROTECTION_ACTIVE,
+				ques_cond & (1 << 4));
 
 		/* UNREG */
 		unreg = (ques_cond & (1 << 10));
@@ -955,8 +976,8 @@ static int hp_6630b_update_status(const struct sr_dev_inst *sdi)
 		ret = sr_scpi_get_bool(scpi, "OUTP:STAT?", &output_enabled);
 		if (ret != SR_OK)
 			return ret;
-		sr_session_send_meta(sdi, SR_CONF_ENABLED,
-			g_variant_new_boolean(output_enabled));
+		sr_session_send_meta_bool(sdi, SR_CONF_ENABLED,
+			output_enabled);
 	}
 
 	/* Operation status summary bit */
@@ -1537,7 +1558,7 @@ SR_PRIV const struct scpi_pps pps_profiles[] = {
 
 	/* HP 6631B */
 	{ "HP", "6631B", SCPI_DIALECT_HP_66XXB, PPS_OTP,
-		ARRAY_AND_SIZE(hp_6630b_devopts),
+		ARRAY_AND_SIZE(hp_6630b_devopts_buffered),
 		ARRAY_AND_SIZE(hp_6630b_devopts_cg),
 		ARRAY_AND_SIZE(hp_6631b_ch),
 		ARRAY_AND_SIZE(hp_6630b_cg),
@@ -1545,11 +1566,12 @@ SR_PRIV const struct scpi_pps pps_profiles[] = {
 		.probe_channels = NULL,
 		hp_6630b_init_acquisition,
 		hp_6630b_update_status,
+		4096, hp_6630b_samplerates,
 	},
 
 	/* HP 6632B */
 	{ "HP", "6632B", SCPI_DIALECT_HP_66XXB, PPS_OTP,
-		ARRAY_AND_SIZE(hp_6630b_devopts),
+		ARRAY_AND_SIZE(hp_6630b_devopts_buffered),
 		ARRAY_AND_SIZE(hp_6630b_devopts_cg),
 		ARRAY_AND_SIZE(hp_6632b_ch),
 		ARRAY_AND_SIZE(hp_6630b_cg),
@@ -1557,11 +1579,12 @@ SR_PRIV const struct scpi_pps pps_profiles[] = {
 		.probe_channels = NULL,
 		hp_6630b_init_acquisition,
 		hp_6630b_update_status,
+		4096, hp_6630b_samplerates,
 	},
 
 	/* HP 66312A */
 	{ "HP", "66312A", SCPI_DIALECT_HP_66XXB, PPS_OTP,
-		ARRAY_AND_SIZE(hp_6630b_devopts),
+		ARRAY_AND_SIZE(hp_6630b_devopts_buffered),
 		ARRAY_AND_SIZE(hp_6630b_devopts_cg),
 		ARRAY_AND_SIZE(hp_66312a_ch),
 		ARRAY_AND_SIZE(hp_6630b_cg),
@@ -1569,11 +1592,12 @@ SR_PRIV const struct scpi_pps pps_profiles[] = {
 		.probe_channels = NULL,
 		hp_6630b_init_acquisition,
 		hp_6630b_update_status,
+		4096, hp_6630b_samplerates,
 	},
 
 	/* HP 66332A */
 	{ "HP", "66332A", SCPI_DIALECT_HP_66XXB, PPS_OTP,
-		ARRAY_AND_SIZE(hp_6630b_devopts),
+		ARRAY_AND_SIZE(hp_6630b_devopts_buffered),
 		ARRAY_AND_SIZE(hp_6630b_devopts_cg),
 		ARRAY_AND_SIZE(hp_66332a_ch),
 		ARRAY_AND_SIZE(hp_6630b_cg),
@@ -1581,11 +1605,12 @@ SR_PRIV const struct scpi_pps pps_profiles[] = {
 		.probe_channels = NULL,
 		hp_6630b_init_acquisition,
 		hp_6630b_update_status,
+		4096, hp_6630b_samplerates,
 	},
 
 	/* HP 6633B */
 	{ "HP", "6633B", SCPI_DIALECT_HP_66XXB, PPS_OTP,
-		ARRAY_AND_SIZE(hp_6630b_devopts),
+		ARRAY_AND_SIZE(hp_6630b_devopts_buffered),
 		ARRAY_AND_SIZE(hp_6630b_devopts_cg),
 		ARRAY_AND_SIZE(hp_6633b_ch),
 		ARRAY_AND_SIZE(hp_6630b_cg),
@@ -1593,11 +1618,12 @@ SR_PRIV const struct scpi_pps pps_profiles[] = {
 		.probe_channels = NULL,
 		hp_6630b_init_acquisition,
 		hp_6630b_update_status,
+		4096, hp_6630b_samplerates,
 	},
 
 	/* HP 6634B */
 	{ "HP", "6634B", SCPI_DIALECT_HP_66XXB, PPS_OTP,
-		ARRAY_AND_SIZE(hp_6630b_devopts),
+		ARRAY_AND_SIZE(hp_6630b_devopts_buffered),
 		ARRAY_AND_SIZE(hp_6630b_devopts_cg),
 		ARRAY_AND_SIZE(hp_6634b_ch),
 		ARRAY_AND_SIZE(hp_6630b_cg),
@@ -1605,6 +1631,7 @@ SR_PRIV const struct scpi_pps pps_profiles[] = {
 		.probe_channels = NULL,
 		hp_6630b_init_acquisition,
 		hp_6630b_update_status,
+		4096, hp_6630b_samplerates,
 	},
 
 	/* Rigol DP700 series */
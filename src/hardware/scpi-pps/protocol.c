@@ -25,77 +25,22 @@
 #include "scpi.h"
 #include "protocol.h"
 
-SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
+/* Send a channel's measurement values to the session. */
+static void send_values(const struct sr_dev_inst *sdi,
+	struct sr_channel *ch, const float *values, size_t count)
 {
 	struct dev_context *devc;
-	const struct scpi_pps *device;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
+	GSList ch_node;
 	struct sr_analog_spec spec;
-	struct sr_dev_inst *sdi;
-	int channel_group_cmd;
-	const char *channel_group_name;
 	struct pps_channel *pch;
 	const struct channel_spec *ch_spec;
-	int ret;
-	float f;
-	GVariant *gvdata;
-	const GVariantType *gvtype;
-	int cmd;
-
-	(void)fd;
-	(void)revents;
 
-	if (!(sdi = cb_data))
-		return TRUE;
-
-	if (!(devc = sdi->priv))
-		return TRUE;
-
-	if (!(device = devc->device))
-		return TRUE;
-
-	pch = devc->cur_acquisition_channel->priv;
-
-	channel_group_cmd = 0;
-	channel_group_name = NULL;
-	if (g_slist_length(sdi->channel_groups) > 1) {
-		channel_group_cmd = SCPI_CMD_SELECT_CHANNEL;
-		channel_group_name = pch->hwname;
-	}
-
-	/*
-	 * When the current channel is the first in the array, perform the device
-	 * specific status update first.
-	 */
-	if (devc->cur_acquisition_channel == sr_next_enabled_channel(sdi, NULL) &&
-		device->update_status) {
-		device->update_status(sdi);
-	}
-
-	if (pch->mq == SR_MQ_VOLTAGE) {
-		gvtype = G_VARIANT_TYPE_DOUBLE;
-		cmd = SCPI_CMD_GET_MEAS_VOLTAGE;
-	} else if (pch->mq == SR_MQ_FREQUENCY) {
-		gvtype = G_VARIANT_TYPE_DOUBLE;
-		cmd = SCPI_CMD_GET_MEAS_FREQUENCY;
-	} else if (pch->mq == SR_MQ_CURRENT) {
-		gvtype = G_VARIANT_TYPE_DOUBLE;
-		cmd = SCPI_CMD_GET_MEAS_CURRENT;
-	} else if (pch->mq == SR_MQ_POWER) {
-		gvtype = G_VARIANT_TYPE_DOUBLE;
-		cmd = SCPI_CMD_GET_MEAS_POWER;
-	} else {
-		return SR_ERR;
-	}
-
-	ret = sr_scpi_cmd_resp(sdi, devc->device->commands,
-		channel_group_cmd, channel_group_name, &gvdata, gvtype, cmd);
-
-	if (ret != SR_OK)
-		return ret;
+	devc = sdi->priv;
+	pch = ch->priv;
 
 	if (devc->channels) {
 		/* Dynamically-probed devices. */
@@ -108,8 +53,8 @@ SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
 	packet.payload = &analog;
 	/* Note: digits/spec_digits will be overridden later. */
 	sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
-	analog.meaning->channels = g_slist_append(NULL, devc->cur_acquisition_channel);
-	analog.num_samples = 1;
+	sr_analog_meaning_channel_set(analog.meaning, &ch_node, ch);
+	analog.num_samples = count;
 	analog.meaning->mq = pch->mq;
 	analog.meaning->mqflags = pch->mqflags;
 	if (pch->mq == SR_MQ_VOLTAGE) {
@@ -129,25 +74,264 @@ SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
 		analog.encoding->digits = ch_spec->frequency[4];
 		analog.spec->spec_digits = ch_spec->frequency[3];
 	}
-	f = (float)g_variant_get_double(gvdata);
-	g_variant_unref(gvdata);
-	analog.data = &f;
+	analog.data = (void *)values;
 	sr_session_send(sdi, &packet);
-	g_slist_free(analog.meaning->channels);
+}
 
-	/* Next channel. */
-	if (g_slist_length(sdi->channels) > 1) {
-		devc->cur_acquisition_channel =
-			sr_next_enabled_channel(sdi, devc->cur_acquisition_channel);
-	}
+/* Send a channel's measurement value to the session. */
+static void send_measurement(const struct sr_dev_inst *sdi,
+	struct sr_channel *ch, GVariant *gvdata)
+{
+	float f;
+
+	f = (float)g_variant_get_double(gvdata);
+	send_values(sdi, ch, &f, 1);
+}
+
+/* Send the measurement values which a batch of queries returned. */
+static void receive_measurements(struct sr_scpi_batch *batch,
+	int status, GVariant **values, void *cb_data)
+{
+	struct dev_context *devc;
+	struct sr_dev_inst *sdi;
+	struct sr_channel *ch;
+	GSList *l;
+
+	(void)batch;
+
+	sdi = cb_data;
+	devc = sdi->priv;
 
-	if (devc->cur_acquisition_channel == sr_next_enabled_channel(sdi, NULL))
-		/* First enabled channel, so each channel has been sampled */
-		sr_sw_limits_update_samples_read(&devc->limits, 1);
+	/* Failed queries get retried in the next receive call. */
+	if (status != SR_OK)
+		return;
+
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (!ch->enabled)
+			continue;
+		send_measurement(sdi, ch, *values++);
+	}
+	sr_sw_limits_update_samples_read(&devc->limits, 1);
 
 	/* Stop if limits have been hit. */
 	if (sr_sw_limits_check(&devc->limits))
 		sr_dev_acquisition_stop(sdi);
+}
+
+/*
+ * Compile the measurement queries for all enabled channels into one
+ * batch. Devices which accept compound queries return all values of
+ * an acquisition cycle in a single round trip.
+ */
+SR_PRIV int scpi_pps_setup_measurements(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_channel *ch;
+	struct pps_channel *pch;
+	int channel_group_cmd;
+	const char *channel_group_name;
+	int cmd, ret;
+	GSList *l;
+
+	devc = sdi->priv;
+
+	sr_scpi_batch_free(devc->measurements);
+	devc->measurements = sr_scpi_batch_new();
+
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (!ch->enabled)
+			continue;
+		pch = ch->priv;
+
+		channel_group_cmd = 0;
+		channel_group_name = NULL;
+		if (g_slist_length(sdi->channel_groups) > 1) {
+			channel_group_cmd = SCPI_CMD_SELECT_CHANNEL;
+			channel_group_name = pch->hwname;
+		}
+
+		if (pch->mq == SR_MQ_VOLTAGE)
+			cmd = SCPI_CMD_GET_MEAS_VOLTAGE;
+		else if (pch->mq == SR_MQ_FREQUENCY)
+			cmd = SCPI_CMD_GET_MEAS_FREQUENCY;
+		else if (pch->mq == SR_MQ_CURRENT)
+			cmd = SCPI_CMD_GET_MEAS_CURRENT;
+		else if (pch->mq == SR_MQ_POWER)
+			cmd = SCPI_CMD_GET_MEAS_POWER;
+		else
+			return SR_ERR;
+
+		ret = sr_scpi_batch_add(devc->measurements,
+			devc->device->commands, channel_group_cmd,
+			channel_group_name, G_VARIANT_TYPE_DOUBLE, cmd);
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Measurements are queried asynchronously. The receive routine sends
+ * the batch of queries, and returns to the main loop. The responses get
+ * picked up when they have arrived, which lets many devices in the same
+ * session have their queries in flight at the same time.
+ */
+SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
+{
+	struct dev_context *devc;
+	const struct scpi_pps *device;
+	struct sr_dev_inst *sdi;
+	struct sr_scpi_dev_inst *scpi;
+	int ret;
+
+	(void)fd;
+
+	if (!(sdi = cb_data))
+		return TRUE;
+
+	if (!(devc = sdi->priv))
+		return TRUE;
+
+	if (!(device = devc->device))
+		return TRUE;
+
+	/* Pick up the responses to the previously sent queries. */
+	scpi = sdi->conn;
+	if (sr_scpi_async_pending(scpi)) {
+		(void)sr_scpi_async_receive(scpi, revents);
+		return TRUE;
+	}
+
+	/* Perform the device specific status update first. */
+	if (device->update_status)
+		device->update_status(sdi);
+
+	ret = sr_scpi_batch_send(sdi, devc->measurements,
+		receive_measurements, sdi);
+	if (ret != SR_OK)
+		return ret;
+
+	/* Transports without non-blocking reads respond right here. */
+	(void)sr_scpi_async_receive(scpi, 0);
+
+	return TRUE;
+}
+
+/*
+ * Set up buffered acquisition. Each array measurement digitizes the
+ * enabled channels at the configured samplerate, the arrays get fetched
+ * in one response per channel. An array takes about a quarter of a
+ * second, there are gaps between the arrays.
+ */
+SR_PRIV int scpi_pps_buffer_start(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_channel *ch;
+	struct pps_channel *pch;
+	uint64_t points;
+	GSList *l;
+	int ret;
+
+	devc = sdi->priv;
+
+	if (!devc->samplerate) {
+		sr_err("Buffered acquisition needs a samplerate.");
+		return SR_ERR_ARG;
+	}
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		pch = ch->priv;
+		if (!ch->enabled)
+			continue;
+		if (pch->mq != SR_MQ_VOLTAGE && pch->mq != SR_MQ_CURRENT) {
+			sr_err("Buffered acquisition measures voltage and "
+				"current only.");
+			return SR_ERR_NA;
+		}
+	}
+
+	points = devc->samplerate / 4;
+	points = MIN(points, devc->device->buffer_size);
+	if (devc->limits.limit_samples)
+		points = MIN(points, devc->limits.limit_samples);
+	points = MAX(points, 1);
+	ret = sr_scpi_cmd(sdi, devc->device->commands, 0, NULL,
+		SCPI_CMD_SET_MEAS_ARRAY, (unsigned int)points,
+		1.0 / devc->samplerate);
+	if (ret != SR_OK)
+		return ret;
+
+	devc->buffer_points = points;
+	if (!devc->readings)
+		devc->readings = g_array_new(FALSE, FALSE, sizeof(float));
+
+	return SR_OK;
+}
+
+/*
+ * The first enabled channel's query takes an array measurement, the
+ * other channels fetch theirs from the same measurement.
+ */
+SR_PRIV int scpi_pps_receive_buffered(int fd, int revents, void *cb_data)
+{
+	struct dev_context *devc;
+	struct sr_dev_inst *sdi;
+	struct sr_channel *ch;
+	struct pps_channel *pch;
+	const char *command;
+	uint64_t count, remain;
+	gboolean first;
+	GSList *l;
+	int cmd, ret;
+
+	(void)fd;
+	(void)revents;
+
+	if (!(sdi = cb_data))
+		return TRUE;
+	if (!(devc = sdi->priv) || !devc->readings)
+		return TRUE;
+
+	if (devc->device->update_status)
+		devc->device->update_status(sdi);
+
+	count = devc->buffer_points;
+	if (devc->limits.limit_samples) {
+		remain = devc->limits.limit_samples - devc->limits.samples_read;
+		count = MIN(count, remain);
+	}
+	first = TRUE;
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		pch = ch->priv;
+		if (!ch->enabled)
+			continue;
+		if (pch->mq == SR_MQ_VOLTAGE)
+			cmd = first ? SCPI_CMD_GET_MEAS_ARRAY_VOLTAGE :
+				SCPI_CMD_GET_FETCH_ARRAY_VOLTAGE;
+		else
+			cmd = first ? SCPI_CMD_GET_MEAS_ARRAY_CURRENT :
+				SCPI_CMD_GET_FETCH_ARRAY_CURRENT;
+		command = sr_scpi_cmd_get(devc->device->commands, cmd);
+		ret = sr_scpi_get_readings(sdi->conn, command, FALSE,
+			devc->readings);
+		if (ret != SR_OK) {
+			sr_err("Cannot get measured array: %s.",
+				sr_strerror(ret));
+			sr_dev_acquisition_stop(sdi);
+			return TRUE;
+		}
+		count = MIN(count, devc->readings->len);
+		send_values(sdi, ch, (float *)devc->readings->data, count);
+		first = FALSE;
+	}
+	sr_sw_limits_update_samples_read(&devc->limits, count);
+
+	if (sr_sw_limits_check(&devc->limits))
+		sr_dev_acquisition_stop(sdi);
 
 	return TRUE;
 }
@@ -66,6 +66,11 @@ enum pps_scpi_cmds {
 	SCPI_CMD_GET_OVER_CURRENT_PROTECTION_ACTIVE,
 	SCPI_CMD_GET_OVER_CURRENT_PROTECTION_THRESHOLD,
 	SCPI_CMD_SET_OVER_CURRENT_PROTECTION_THRESHOLD,
+	SCPI_CMD_SET_MEAS_ARRAY,
+	SCPI_CMD_GET_MEAS_ARRAY_VOLTAGE,
+	SCPI_CMD_GET_MEAS_ARRAY_CURRENT,
+	SCPI_CMD_GET_FETCH_ARRAY_VOLTAGE,
+	SCPI_CMD_GET_FETCH_ARRAY_CURRENT,
 };
 
 /* Defines the SCPI dialect */
@@ -110,6 +115,12 @@ struct scpi_pps {
 		struct channel_group_spec **channel_groups, unsigned int *num_channel_groups);
 	int (*init_acquisition) (const struct sr_dev_inst *sdi);
 	int (*update_status) (const struct sr_dev_inst *sdi);
+	/*
+	 * Buffered acquisition: points per measured array (zero if not
+	 * supported), and the min/max/step of the samplerate.
+	 */
+	unsigned int buffer_size;
+	const uint64_t *samplerates;
 };
 
 struct channel_spec {
@@ -162,14 +173,23 @@ struct dev_context {
 	struct channel_spec *channels;
 	struct channel_group_spec *channel_groups;
 
-	struct sr_channel *cur_acquisition_channel;
+	struct sr_scpi_batch *measurements;
 	struct sr_sw_limits limits;
+
+	gboolean datalog;
+	uint64_t samplerate;
+	/* Points per array of the running buffered acquisition. */
+	unsigned int buffer_points;
+	GArray *readings;
 };
 
 SR_PRIV extern unsigned int num_pps_profiles;
 SR_PRIV extern const struct scpi_pps pps_profiles[];
 
 SR_PRIV int select_channel(const struct sr_dev_inst *sdi, struct sr_channel *ch);
+SR_PRIV int scpi_pps_setup_measurements(const struct sr_dev_inst *sdi);
 SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data);
+SR_PRIV int scpi_pps_buffer_start(const struct sr_dev_inst *sdi);
+SR_PRIV int scpi_pps_receive_buffered(int fd, int revents, void *cb_data);
 
 #endif
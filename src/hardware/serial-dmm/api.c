@@ -282,8 +282,9 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 			return ret;
 	}
 
+	/* Meters of one session share an event source. */
 	serial = sdi->conn;
-	serial_source_add(sdi->session, serial, G_IO_IN, 50,
+	serial_mux_source_add(sdi->session, serial, G_IO_IN, 50,
 		cb_func, cb_data);
 
 	return SR_OK;
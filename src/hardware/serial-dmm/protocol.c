@@ -31,7 +31,7 @@ static void log_dmm_packet(const uint8_t *buf, size_t len)
 {
 	GString *text;
 
-	if (sr_log_loglevel_get() < SR_LOG_DBG)
+	if (!sr_log_enabled(SR_LOG_DBG))
 		return;
 
 	text = sr_hexdump_new(buf, len);
@@ -50,6 +50,7 @@ static void handle_packet(struct sr_dev_inst *sdi,
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
+	GSList ch_node;
 	struct sr_analog_spec spec;
 	gboolean sent_sample;
 	struct sr_channel *channel;
@@ -66,8 +67,8 @@ static void handle_packet(struct sr_dev_inst *sdi,
 		/* Note: digits/spec_digits will be overridden by the DMM parsers. */
 		sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
 
-		channel = g_slist_nth_data(sdi->channels, ch_idx);
-		analog.meaning->channels = g_slist_append(NULL, channel);
+		channel = sr_dev_channel_nth(sdi, ch_idx);
+		sr_analog_meaning_channel_set(analog.meaning, &ch_node, channel);
 		analog.num_samples = 1;
 		analog.meaning->mq = 0;
 
@@ -39,8 +39,8 @@ static void send_frame_start(struct sr_dev_inst *sdi)
 	freq = info->output_freq;
 	if (freq != devc->output_freq) {
 		devc->output_freq = freq;
-		sr_session_send_meta(sdi, SR_CONF_OUTPUT_FREQUENCY,
-			g_variant_new_double(freq));
+		sr_session_send_meta_double(sdi, SR_CONF_OUTPUT_FREQUENCY,
+			freq);
 	}
 	model = info->circuit_model;
 	if (model && model != devc->circuit_model) {
@@ -65,6 +65,7 @@ static int handle_packet(struct sr_dev_inst *sdi, const uint8_t *pkt)
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
+	GSList ch_node;
 	struct sr_analog_spec spec;
 	gboolean frame;
 	struct sr_channel *channel;
@@ -80,8 +81,8 @@ static int handle_packet(struct sr_dev_inst *sdi, const uint8_t *pkt)
 
 	frame = FALSE;
 	for (ch_idx = 0; ch_idx < lcr->channel_count; ch_idx++) {
-		channel = g_slist_nth_data(sdi->channels, ch_idx);
-		analog.meaning->channels = g_slist_append(NULL, channel);
+		channel = sr_dev_channel_nth(sdi, ch_idx);
+		sr_analog_meaning_channel_set(analog.meaning, &ch_node, channel);
 		info->ch_idx = ch_idx;
 		rc = lcr->packet_parse(pkt, &value, &analog, info);
 		if (sdi->session && rc == SR_OK && analog.meaning->mq && channel->enabled) {
@@ -93,7 +94,6 @@ static int handle_packet(struct sr_dev_inst *sdi, const uint8_t *pkt)
 			packet.payload = &analog;
 			sr_session_send(sdi, &packet);
 		}
-		g_slist_free(analog.meaning->channels);
 	}
 	if (frame) {
 		std_session_send_df_frame_end(sdi);
@@ -157,6 +157,7 @@ static const uint64_t averages[] = {
 static const char *data_sources[] = {
 	"Display",
 	"History",
+	"Sequence",
 };
 
 enum vendor {
@@ -427,6 +428,8 @@ static int config_get(uint32_t key, GVariant **data,
 			*data = g_variant_new_string("Screen");
 		else if (devc->data_source == DATA_SOURCE_HISTORY)
 			*data = g_variant_new_string("History");
+		else if (devc->data_source == DATA_SOURCE_SEQUENCE)
+			*data = g_variant_new_string("Sequence");
 		break;
 	case SR_CONF_SAMPLERATE:
 		siglent_sds_get_dev_cfg_horizontal(sdi);
@@ -675,6 +678,9 @@ static int config_set(uint32_t key, GVariant *data,
 		else if (devc->model->series->protocol >= SPO_MODEL
 			&& !strcmp(tmp_str, "History"))
 			devc->data_source = DATA_SOURCE_HISTORY;
+		else if (devc->model->series->protocol != NON_SPO_MODEL
+			&& !strcmp(tmp_str, "Sequence"))
+			devc->data_source = DATA_SOURCE_SEQUENCE;
 		else {
 			sr_err("Unknown data source: '%s'.", tmp_str);
 			return SR_ERR;
@@ -766,7 +772,7 @@ static int config_list(uint32_t key, GVariant **data,
 		switch (devc->model->series->protocol) {
 		/* TODO: Check what must be done here for the data source buffer sizes. */
 		case NON_SPO_MODEL:
-			*data = g_variant_new_strv(data_sources, ARRAY_SIZE(data_sources) - 1);
+			*data = g_variant_new_strv(data_sources, 1);
 			break;
 		case SPO_MODEL:
 		case ESERIES:
@@ -799,6 +805,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	devc = sdi->priv;
 
 	devc->num_frames = 0;
+	devc->num_frames_history = 0;
 	some_digital = FALSE;
 
 	/*
@@ -881,6 +888,17 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		break;
 	}
 
+	if (devc->data_source == DATA_SOURCE_SEQUENCE) {
+		/* Have the scope capture all frames on its own. */
+		if (devc->limit_frames == 0) {
+			sr_err("Sequence needs a frame limit.");
+			return SR_ERR_ARG;
+		}
+		if (siglent_sds_config_set(sdi, "SEQ ON,%" PRIu64,
+				devc->limit_frames) != SR_OK)
+			return SR_ERR;
+	}
+
 	sr_scpi_source_add(sdi->session, scpi, G_IO_IN, 7000,
 		siglent_sds_receive, (void *) sdi);
 
@@ -906,6 +924,9 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 
 	std_session_send_df_end(sdi);
 
+	if (devc->data_source == DATA_SOURCE_SEQUENCE)
+		siglent_sds_config_set(sdi, "SEQ OFF");
+
 	g_slist_free(devc->enabled_channels);
 	devc->enabled_channels = NULL;
 	scpi = sdi->conn;
@@ -149,6 +149,75 @@ SR_PRIV int siglent_sds_config_set(const struct sr_dev_inst *sdi, const char *fo
 	return ret;
 }
 
+/* Start reading the next frame from the history memory. */
+static int siglent_sds_history_start(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc = sdi->priv;
+	unsigned int framecount;
+	char buf[200];
+	int ret;
+
+	/* The number of frames doesn't change while reading them. */
+	if (!devc->num_frames_history) {
+		sr_dbg("Starting data capture for history frameset.");
+		if (siglent_sds_config_set(sdi, "FPAR?") != SR_OK)
+			return SR_ERR;
+		ret = sr_scpi_read_data(sdi->conn, buf, 200);
+		if (ret < 0) {
+			sr_err("Read error while reading data header.");
+			return SR_ERR;
+		}
+		memcpy(&framecount, buf + 40, 4);
+		if (devc->limit_frames > framecount)
+			sr_err("Frame limit higher than frames in buffer of device!");
+		else if (devc->limit_frames == 0)
+			devc->limit_frames = framecount;
+		devc->num_frames_history = framecount;
+	}
+	sr_dbg("Starting data capture for history frameset %" PRIu64 " of %" PRIu64,
+		devc->num_frames + 1, devc->limit_frames);
+	if (siglent_sds_config_set(sdi, "FRAM %i", devc->num_frames + 1) != SR_OK)
+		return SR_ERR;
+	if (siglent_sds_channel_start(sdi) != SR_OK)
+		return SR_ERR;
+	siglent_sds_set_wait_event(devc, WAIT_STOP);
+
+	return SR_OK;
+}
+
+/* Wait for the scope to stop, after capturing all frames of a sequence. */
+static int siglent_sds_sequence_wait(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	char *buf;
+	gboolean stopped;
+	time_t start;
+
+	if (!(devc = sdi->priv))
+		return SR_ERR;
+
+	start = time(NULL);
+
+	do {
+		if (time(NULL) - start >= 3) {
+			sr_dbg("Timeout waiting for the sequence.");
+			return SR_ERR_TIMEOUT;
+		}
+		if (sr_scpi_get_string(sdi->conn, "TRMD?", &buf) != SR_OK)
+			return SR_ERR;
+		stopped = g_strrstr(buf, "STOP") != NULL;
+		g_free(buf);
+		if (!stopped)
+			g_usleep(10000);
+	} while (!stopped);
+
+	sr_dbg("Sequence has been captured.");
+
+	devc->num_frames_history = 0;
+
+	return siglent_sds_history_start(sdi);
+}
+
 /* Start capturing a new frameset. */
 SR_PRIV int siglent_sds_capture_start(const struct sr_dev_inst *sdi)
 {
@@ -181,31 +250,17 @@ SR_PRIV int siglent_sds_capture_start(const struct sr_dev_inst *sdi)
 				sr_spew("Device did not enter ARM mode.");
 				return SR_ERR;
 			}
-		} else { /* TODO: Implement history retrieval. */
-			unsigned int framecount;
-			char buf[200];
-			int ret;
-
-			sr_dbg("Starting data capture for history frameset.");
-			if (siglent_sds_config_set(sdi, "FPAR?") != SR_OK)
-				return SR_ERR;
-			ret = sr_scpi_read_data(sdi->conn, buf, 200);
-			if (ret < 0) {
-				sr_err("Read error while reading data header.");
-				return SR_ERR;
-			}
-			memcpy(&framecount, buf + 40, 4);
-			if (devc->limit_frames > framecount)
-				sr_err("Frame limit higher than frames in buffer of device!");
-			else if (devc->limit_frames == 0)
-				devc->limit_frames = framecount;
-			sr_dbg("Starting data capture for history frameset %" PRIu64 " of %" PRIu64,
-				devc->num_frames + 1, devc->limit_frames);
-			if (siglent_sds_config_set(sdi, "FRAM %i", devc->num_frames + 1) != SR_OK)
+		} else if (devc->data_source == DATA_SOURCE_SEQUENCE
+				&& devc->num_frames == 0) {
+			/* Capture all segments, then read them from the history. */
+			sr_dbg("Starting data capture for sequence of %" PRIu64 " frames.",
+				devc->limit_frames);
+			if (siglent_sds_config_set(sdi, "ARM") != SR_OK)
 				return SR_ERR;
-			if (siglent_sds_channel_start(sdi) != SR_OK)
+			siglent_sds_set_wait_event(devc, WAIT_SEQUENCE);
+		} else {
+			if (siglent_sds_history_start(sdi) != SR_OK)
 				return SR_ERR;
-			siglent_sds_set_wait_event(devc, WAIT_STOP);
 		}
 		break;
 	case ESERIES:
@@ -231,31 +286,17 @@ SR_PRIV int siglent_sds_capture_start(const struct sr_dev_inst *sdi)
 				sr_spew("Device did not enter ARM mode.");
 				return SR_ERR;
 			}
-		} else { /* TODO: Implement history retrieval. */
-			unsigned int framecount;
-			char buf[200];
-			int ret;
-
-			sr_dbg("Starting data capture for history frameset.");
-			if (siglent_sds_config_set(sdi, "FPAR?") != SR_OK)
-				return SR_ERR;
-			ret = sr_scpi_read_data(sdi->conn, buf, 200);
-			if (ret < 0) {
-				sr_err("Read error while reading data header.");
-				return SR_ERR;
-			}
-			memcpy(&framecount, buf + 40, 4);
-			if (devc->limit_frames > framecount)
-				sr_err("Frame limit higher than frames in buffer of device!");
-			else if (devc->limit_frames == 0)
-				devc->limit_frames = framecount;
-			sr_dbg("Starting data capture for history frameset %" PRIu64 " of %" PRIu64,
-				devc->num_frames + 1, devc->limit_frames);
-			if (siglent_sds_config_set(sdi, "FRAM %i", devc->num_frames + 1) != SR_OK)
+		} else if (devc->data_source == DATA_SOURCE_SEQUENCE
+				&& devc->num_frames == 0) {
+			/* Capture all segments, then read them from the history. */
+			sr_dbg("Starting data capture for sequence of %" PRIu64 " frames.",
+				devc->limit_frames);
+			if (siglent_sds_config_set(sdi, "ARM") != SR_OK)
 				return SR_ERR;
-			if (siglent_sds_channel_start(sdi) != SR_OK)
+			siglent_sds_set_wait_event(devc, WAIT_SEQUENCE);
+		} else {
+			if (siglent_sds_history_start(sdi) != SR_OK)
 				return SR_ERR;
-			siglent_sds_set_wait_event(devc, WAIT_STOP);
 		}
 		break;
 	case NON_SPO_MODEL:
@@ -466,10 +507,11 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
+	GSList ch_node;
 	struct sr_analog_spec spec;
 	struct sr_datafeed_logic logic;
 	struct sr_channel *ch;
-	int len, i;
+	int len;
 	float wait;
 	gboolean read_complete = FALSE;
 
@@ -505,6 +547,10 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 		if (siglent_sds_channel_start(sdi) != SR_OK)
 			return TRUE;
 		return TRUE;
+	case WAIT_SEQUENCE:
+		if (siglent_sds_sequence_wait(sdi) != SR_OK)
+			return TRUE;
+		return TRUE;
 	default:
 		sr_err("BUG: Unknown event target encountered.");
 		break;
@@ -580,33 +626,28 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 				if (ch->type == SR_CHANNEL_ANALOG) {
 					float vdiv = devc->vdiv[ch->index];
 					float offset = devc->vert_offset[ch->index];
-					GArray *float_data;
-					static GArray *data;
-					float voltage, vdivlog;
+					float vdivlog;
 					int digits;
 
-					data = g_array_sized_new(FALSE, FALSE, sizeof(uint8_t), len);
-					g_array_append_vals(data, devc->buffer, len);
-					float_data = g_array_new(FALSE, FALSE, sizeof(float));
-					for (i = 0; i < len; i++) {
-						voltage = (float)g_array_index(data, int8_t, i) / 25;
-						voltage = ((vdiv * voltage) - offset);
-						g_array_append_val(float_data, voltage);
-					}
 					vdivlog = log10f(vdiv);
 					digits = -(int) vdivlog + (vdivlog < 0.0);
 					sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
-					analog.meaning->channels = g_slist_append(NULL, ch);
-					analog.num_samples = float_data->len;
-					analog.data = (float *)float_data->data;
+					/* Raw int8 samples, volts = raw / 25 * vdiv - offset. */
+					encoding.unitsize = sizeof(int8_t);
+					encoding.is_float = FALSE;
+					encoding.is_signed = TRUE;
+					encoding.is_bigendian = FALSE;
+					sr_rational_from_double(&encoding.scale, (double)vdiv / 25);
+					sr_rational_from_double(&encoding.offset, -offset);
+					sr_analog_meaning_channel_set(analog.meaning, &ch_node, ch);
+					analog.num_samples = len;
+					analog.data = devc->buffer;
 					analog.meaning->mq = SR_MQ_VOLTAGE;
 					analog.meaning->unit = SR_UNIT_VOLT;
 					analog.meaning->mqflags = 0;
 					packet.type = SR_DF_ANALOG;
 					packet.payload = &analog;
 					sr_session_send(sdi, &packet);
-					g_slist_free(analog.meaning->channels);
-					g_array_free(data, TRUE);
 				}
 				len = 0;
 				if (devc->num_samples == (devc->num_block_bytes - SIGLENT_HEADER_SIZE)) {
@@ -701,6 +742,7 @@ SR_PRIV int siglent_sds_get_dev_cfg(const struct sr_dev_inst *sdi)
 			return SR_ERR;
 		ch = g_slist_nth_data(sdi->channels, i);
 		ch->enabled = devc->analog_channels[i];
+		sr_dev_channels_changed(sdi);
 	}
 	sr_dbg("Current analog channel state:");
 	for (i = 0; i < devc->model->analog_channels; i++)
@@ -728,6 +770,7 @@ SR_PRIV int siglent_sds_get_dev_cfg(const struct sr_dev_inst *sdi)
 					return SR_ERR;
 				ch = g_slist_nth_data(sdi->channels, i + devc->model->analog_channels);
 				ch->enabled = devc->digital_channels[i];
+				sr_dev_channels_changed(sdi);
 				sr_dbg("D%d: %s", i, devc->digital_channels[i] ? "On" : "Off");
 			}
 		} else {
@@ -735,6 +778,7 @@ SR_PRIV int siglent_sds_get_dev_cfg(const struct sr_dev_inst *sdi)
 				ch = g_slist_nth_data(sdi->channels, i + devc->model->analog_channels);
 				devc->digital_channels[i] = FALSE;
 				ch->enabled = devc->digital_channels[i];
+				sr_dev_channels_changed(sdi);
 				sr_dbg("D%d: %s", i, devc->digital_channels[i] ? "On" : "Off");
 			}
 		}
@@ -54,6 +54,7 @@ enum protocol_version {
 enum data_source {
 	DATA_SOURCE_SCREEN,
 	DATA_SOURCE_HISTORY,
+	DATA_SOURCE_SEQUENCE,
 };
 
 struct siglent_sds_vendor {
@@ -86,6 +87,7 @@ enum wait_events {
 	WAIT_TRIGGER,	/* Wait for trigger */
 	WAIT_BLOCK,	/* Wait for block data (only when reading sample mem) */
 	WAIT_STOP,	/* Wait for scope stopping (only single shots) */
+	WAIT_SEQUENCE,	/* Wait for all segments of a sequence */
 };
 
 struct dev_context {
@@ -135,6 +137,8 @@ struct dev_context {
 
 	/* Number of frames received in total. */
 	uint64_t num_frames;
+	/* Number of frames in the history memory, 0 before asking. */
+	uint64_t num_frames_history;
 	/* GSList entry for the current channel. */
 	GSList *channel_entry;
 	/* Number of bytes received for current channel. */
@@ -27,50 +27,34 @@
 #define BITSTREAM_MAX_SIZE    (256 * 1024) /* Bitstream size limit for safety */
 #define BITSTREAM_HEADER_SIZE 4            /* Transfer header size in bytes */
 
-/* Load a bitstream file into memory. Returns a newly allocated array
- * consisting of a 32-bit length field followed by the bitstream data.
+/* Convert a bitstream file's content into the transfer format, which
+ * consists of a 32-bit length field followed by the bitstream data.
  */
-static unsigned char *load_bitstream(struct sr_context *ctx,
-				     const char *name, int *length_p)
+static GBytes *bitstream_to_transfer(GBytes *rbf, const char *name)
 {
-	struct sr_resource rbf;
 	unsigned char *stream;
-	ssize_t length, count;
+	const void *data;
+	size_t size, length;
 
-	if (sr_resource_open(ctx, &rbf, SR_RESOURCE_FIRMWARE, name) != SR_OK)
-		return NULL;
-
-	if (rbf.size == 0 || rbf.size > BITSTREAM_MAX_SIZE) {
-		sr_err("Refusing to load bitstream of unreasonable size "
-		       "(%" PRIu64 " bytes).", rbf.size);
-		sr_resource_close(ctx, &rbf);
+	data = g_bytes_get_data(rbf, &size);
+	if (size == 0) {
+		sr_err("Refusing to load empty bitstream '%s'.", name);
 		return NULL;
 	}
 
 	/* The message length includes the 4-byte header. */
-	length = BITSTREAM_HEADER_SIZE + rbf.size;
+	length = BITSTREAM_HEADER_SIZE + size;
 	stream = g_try_malloc(length);
 	if (!stream) {
 		sr_err("Failed to allocate bitstream buffer.");
-		sr_resource_close(ctx, &rbf);
 		return NULL;
 	}
 
 	/* Write the message length header. */
 	*(uint32_t *)stream = GUINT32_TO_BE(length);
+	memcpy(stream + BITSTREAM_HEADER_SIZE, data, size);
 
-	count = sr_resource_read(ctx, &rbf, stream + BITSTREAM_HEADER_SIZE,
-				 length - BITSTREAM_HEADER_SIZE);
-	sr_resource_close(ctx, &rbf);
-
-	if (count != length - BITSTREAM_HEADER_SIZE) {
-		sr_err("Failed to read bitstream '%s'.", name);
-		g_free(stream);
-		return NULL;
-	}
-
-	*length_p = length;
-	return stream;
+	return g_bytes_new_take(stream, length);
 }
 
 /* Load a Raw Binary File (.rbf) from the firmware directory and transfer
@@ -80,22 +64,29 @@ SR_PRIV int lwla_send_bitstream(struct sr_context *ctx,
 				const struct sr_usb_dev_inst *usb,
 				const char *name)
 {
-	unsigned char *stream;
+	GBytes *stream;
+	const unsigned char *data;
+	size_t size;
 	int ret, length, xfer_len;
 
 	if (!ctx || !usb || !name)
 		return SR_ERR_BUG;
 
-	stream = load_bitstream(ctx, name, &length);
+	stream = sr_resource_get_converted(ctx, SR_RESOURCE_FIRMWARE, name,
+					   BITSTREAM_MAX_SIZE, "transfer",
+					   &bitstream_to_transfer);
 	if (!stream)
 		return SR_ERR;
+	data = g_bytes_get_data(stream, &size);
+	length = size;
 
 	sr_info("Downloading FPGA bitstream '%s'.", name);
 
 	/* Transfer the entire bitstream in one URB. */
 	ret = libusb_bulk_transfer(usb->devhdl, EP_CONFIG,
-				   stream, length, &xfer_len, USB_TIMEOUT_MS);
-	g_free(stream);
+				   (unsigned char *)data, length,
+				   &xfer_len, USB_TIMEOUT_MS);
+	g_bytes_unref(stream);
 
 	if (ret != 0) {
 		sr_err("Failed to transfer bitstream: %s.",
@@ -63,6 +63,11 @@ struct sr_usb_dev_inst;
  */
 #define MAX_REG_SEQ_LEN		8
 
+/* Number of capture memory read requests kept in flight. The device
+ * receives the next requests while the host decodes a response.
+ */
+#define READ_QUEUE_DEPTH	4
+
 /* Logic datafeed packet size in bytes.
  * This is a multiple of both 4 and 5 to match any model's unit size
  * and memory granularity.
@@ -100,6 +105,18 @@ struct regval {
 	uint32_t val;
 };
 
+/** Capture memory read request, and the transfers which carry it. */
+struct read_request {
+	struct libusb_transfer *xfer_out;	/* USB out transfer record */
+	struct libusb_transfer *xfer_in;	/* USB in transfer record */
+	gboolean out_pending;		/* out transfer submitted */
+	gboolean in_pending;		/* in transfer submitted */
+	unsigned int mem_addr_end;	/* end address of requested data */
+
+	uint32_t xfer_buf_in[MAX_ACQ_RECV_LEN32];	/* USB in buffer */
+	uint16_t xfer_buf_out[MAX_ACQ_SEND_LEN16];	/* USB out buffer */
+};
+
 /** LWLA sample acquisition and decompression state. */
 struct acquisition_state {
 	uint64_t samples_max;	/* maximum number of samples to process */
@@ -117,6 +134,9 @@ struct acquisition_state {
 	unsigned int mem_addr_done;	/* next address to be processed */
 	unsigned int mem_addr_next;	/* start address for next async read */
 	unsigned int mem_addr_stop;	/* end of memory range to be read */
+	unsigned int mem_addr_read;	/* end address of current response */
+	const uint32_t *read_buf;	/* current read response data */
+	int read_len;			/* current read response length */
 	unsigned int in_index;		/* position in read transfer buffer */
 	unsigned int out_index;		/* position in logic packet buffer */
 	enum rle_state rle;		/* RLE decoding state */
@@ -128,6 +148,12 @@ struct acquisition_state {
 	unsigned int reg_seq_pos;	/* index of next register/value pair */
 	unsigned int reg_seq_len;	/* length of register/value sequence */
 
+	unsigned int read_head;		/* index of oldest queued request */
+	unsigned int read_pending;	/* number of queued requests */
+	unsigned int read_depth;	/* maximum number of queued requests */
+	gboolean read_stop;		/* queue no more read requests */
+
+	struct read_request read_queue[READ_QUEUE_DEPTH];
 	struct regval reg_sequence[MAX_REG_SEQ_LEN];	/* register buffer */
 	uint32_t xfer_buf_in[MAX_ACQ_RECV_LEN32];	/* USB in buffer */
 	uint16_t xfer_buf_out[MAX_ACQ_SEND_LEN16];	/* USB out buffer */
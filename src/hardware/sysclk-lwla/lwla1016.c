@@ -90,12 +90,13 @@ static const char bitstream_map[][32] = {
 /* Demangle incoming sample data from the transfer buffer. */
 static void read_response(struct acquisition_state *acq)
 {
-	uint32_t *in_p, *out_p;
+	const uint32_t *in_p;
+	uint32_t *out_p;
 	unsigned int words_left, num_words;
 	unsigned int max_samples, run_samples;
 	unsigned int i;
 
-	words_left = MIN(acq->mem_addr_next, acq->mem_addr_stop)
+	words_left = MIN(acq->mem_addr_read, acq->mem_addr_stop)
 			- acq->mem_addr_done;
 	/* Calculate number of samples to write into packet. */
 	max_samples = MIN(acq->samples_max - acq->samples_done,
@@ -110,7 +111,7 @@ static void read_response(struct acquisition_state *acq)
 	 * alignment is guaranteed.
 	 */
 	out_p = (uint32_t *)&acq->out_packet[acq->out_index * UNIT_SIZE];
-	in_p = &acq->xfer_buf_in[acq->in_index];
+	in_p = &acq->read_buf[acq->in_index];
 	/*
 	 * Transfer two samples at a time, taking care to swap the 16-bit
 	 * halves of each input word but keeping the samples themselves in
@@ -128,15 +129,15 @@ static void read_response(struct acquisition_state *acq)
 /* Demangle and decompress incoming sample data from the transfer buffer. */
 static void read_response_rle(struct acquisition_state *acq)
 {
-	uint32_t *in_p;
+	const uint32_t *in_p;
 	uint16_t *out_p;
 	unsigned int words_left, max_samples, run_samples, wi, ri;
 	uint32_t word;
 	uint16_t sample;
 
-	words_left = MIN(acq->mem_addr_next, acq->mem_addr_stop)
+	words_left = MIN(acq->mem_addr_read, acq->mem_addr_stop)
 			- acq->mem_addr_done;
-	in_p = &acq->xfer_buf_in[acq->in_index];
+	in_p = &acq->read_buf[acq->in_index];
 
 	for (wi = 0;; wi++) {
 		/* Calculate number of samples to write into packet. */
@@ -408,11 +409,11 @@ static int handle_response(const struct sr_dev_inst *sdi)
 		acq->mem_addr_stop = acq->reg_sequence[0].val + READ_START_ADDR - 1;
 		break;
 	case STATE_READ_REQUEST:
-		expect_len = (acq->mem_addr_next - acq->mem_addr_done
-				+ acq->in_index) * sizeof(acq->xfer_buf_in[0]);
-		if (acq->xfer_in->actual_length != expect_len) {
+		expect_len = (acq->mem_addr_read - acq->mem_addr_done
+				+ acq->in_index) * sizeof(acq->read_buf[0]);
+		if (acq->read_len != expect_len) {
 			sr_err("Received size %d does not match expected size %d.",
-			       acq->xfer_in->actual_length, expect_len);
+			       acq->read_len, expect_len);
 			devc->transfer_error = TRUE;
 			return SR_ERR;
 		}
@@ -190,12 +190,12 @@ static inline uint64_t bulk_long_get(const struct acquisition_state *acq,
 static void read_response(struct acquisition_state *acq)
 {
 	uint64_t sample, high_nibbles, word;
-	uint32_t *slice;
+	const uint32_t *slice;
 	uint8_t *out_p;
 	unsigned int words_left, max_samples, run_samples, wi, ri, si;
 
 	/* Number of 36-bit words remaining in the transfer buffer. */
-	words_left = MIN(acq->mem_addr_next, acq->mem_addr_stop)
+	words_left = MIN(acq->mem_addr_read, acq->mem_addr_stop)
 			- acq->mem_addr_done;
 
 	for (wi = 0;; wi++) {
@@ -226,7 +226,7 @@ static void read_response(struct acquisition_state *acq)
 			break; /* Done with current transfer. */
 
 		/* Get the current slice of 8 packed 36-bit words. */
-		slice = &acq->xfer_buf_in[(acq->in_index + wi) / 8 * 9];
+		slice = &acq->read_buf[(acq->in_index + wi) / 8 * 9];
 		si = (acq->in_index + wi) % 8; /* Word index within slice. */
 
 		/* Extract the next 36-bit word. */
@@ -527,12 +527,12 @@ static int handle_response(const struct sr_dev_inst *sdi)
 	case STATE_READ_REQUEST:
 		/* Expect a multiple of 8 36-bit words packed into 9 32-bit
 		 * words. */
-		expect_len = (acq->mem_addr_next - acq->mem_addr_done
-			+ acq->in_index + 7) / 8 * 9 * sizeof(acq->xfer_buf_in[0]);
+		expect_len = (acq->mem_addr_read - acq->mem_addr_done
+			+ acq->in_index + 7) / 8 * 9 * sizeof(acq->read_buf[0]);
 
-		if (acq->xfer_in->actual_length != expect_len) {
+		if (acq->read_len != expect_len) {
 			sr_err("Received size %d does not match expected size %d.",
-			       acq->xfer_in->actual_length, expect_len);
+			       acq->read_len, expect_len);
 			devc->transfer_error = TRUE;
 			return SR_ERR;
 		}
@@ -184,8 +184,146 @@ static void handle_length_response(const struct sr_dev_inst *sdi)
 	submit_request(sdi, STATE_READ_PREPARE);
 }
 
-/* Evaluate and act on the response to a capture memory read request. */
-static void handle_read_response(const struct sr_dev_inst *sdi)
+/* Submit a read request to the device, queued behind earlier ones. */
+static int submit_read_request(const struct sr_dev_inst *sdi,
+			       struct read_request *req)
+{
+	struct dev_context *devc;
+	struct acquisition_state *acq;
+	int ret;
+
+	devc = sdi->priv;
+	acq = devc->acquisition;
+
+	devc->state = STATE_READ_REQUEST;
+	acq->xfer_out->length = 0;
+	acq->reg_seq_pos = 0;
+	acq->reg_seq_len = 0;
+
+	/* The model fills in the command, and advances the address. */
+	ret = (*devc->model->prepare_request)(sdi);
+	if (ret != SR_OK) {
+		devc->transfer_error = TRUE;
+		return ret;
+	}
+	memcpy(req->xfer_buf_out, acq->xfer_buf_out, acq->xfer_out->length);
+	req->xfer_out->length = acq->xfer_out->length;
+	req->mem_addr_end = acq->mem_addr_next;
+
+	ret = submit_transfer(devc, req->xfer_out);
+	if (ret != SR_OK)
+		return ret;
+	req->out_pending = TRUE;
+
+	ret = submit_transfer(devc, req->xfer_in);
+	if (ret != SR_OK)
+		return ret;
+	req->in_pending = TRUE;
+
+	return SR_OK;
+}
+
+/* Keep the read queue filled until the capture memory has been read. */
+static void fill_read_queue(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct acquisition_state *acq;
+	struct read_request *req;
+
+	devc = sdi->priv;
+	acq = devc->acquisition;
+
+	while (!acq->read_stop && !devc->cancel_requested
+			&& !devc->transfer_error
+			&& acq->read_pending < acq->read_depth
+			&& acq->mem_addr_next < acq->mem_addr_stop) {
+		req = &acq->read_queue[(acq->read_head + acq->read_pending)
+				% READ_QUEUE_DEPTH];
+		if (req->out_pending || req->in_pending)
+			break;
+		acq->read_pending++;
+		if (submit_read_request(sdi, req) != SR_OK)
+			break;
+	}
+}
+
+/* Number of submitted read request transfers. */
+static unsigned int read_transfers_pending(struct acquisition_state *acq)
+{
+	unsigned int i, count;
+
+	count = 0;
+	for (i = 0; i < READ_QUEUE_DEPTH; i++) {
+		count += acq->read_queue[i].out_pending;
+		count += acq->read_queue[i].in_pending;
+	}
+
+	return count;
+}
+
+/* Cancel the submitted read request transfers. */
+static void cancel_read_transfers(struct acquisition_state *acq)
+{
+	unsigned int i;
+
+	for (i = 0; i < READ_QUEUE_DEPTH; i++) {
+		if (acq->read_queue[i].out_pending)
+			libusb_cancel_transfer(acq->read_queue[i].xfer_out);
+		if (acq->read_queue[i].in_pending)
+			libusb_cancel_transfer(acq->read_queue[i].xfer_in);
+	}
+}
+
+/* All read requests have completed, send the remaining samples. */
+static void finish_read(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct acquisition_state *acq;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+
+	devc = sdi->priv;
+	acq = devc->acquisition;
+
+	if (devc->transfer_error)
+		return;
+
+	/* Send partially filled packet as it is the last one. */
+	if (!devc->cancel_requested && acq->out_index > 0) {
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &logic;
+		logic.unitsize = (devc->model->num_channels + 7) / 8;
+		logic.data = acq->out_packet;
+		logic.length = acq->out_index * logic.unitsize;
+		sr_session_send(sdi, &packet);
+		acq->out_index = 0;
+	}
+	submit_request(sdi, STATE_READ_FINISH);
+}
+
+/* Start reading the capture memory. */
+static void start_read(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct acquisition_state *acq;
+
+	devc = sdi->priv;
+	acq = devc->acquisition;
+
+	acq->read_head = 0;
+	acq->read_pending = 0;
+	acq->read_stop = FALSE;
+	fill_read_queue(sdi);
+
+	if (acq->read_pending == 0)
+		finish_read(sdi);
+}
+
+/*
+ * Evaluate the response to a capture memory read request. Returns
+ * whether more data is wanted.
+ */
+static gboolean handle_read_response(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct acquisition_state *acq;
@@ -202,7 +340,7 @@ static void handle_read_response(const struct sr_dev_inst *sdi)
 	logic.unitsize = (devc->model->num_channels + 7) / 8;
 	logic.data = acq->out_packet;
 
-	end_addr = MIN(acq->mem_addr_next, acq->mem_addr_stop);
+	end_addr = MIN(acq->mem_addr_read, acq->mem_addr_stop);
 	acq->in_index = 0;
 
 	/*
@@ -215,7 +353,7 @@ static void handle_read_response(const struct sr_dev_inst *sdi)
 
 		if ((*devc->model->handle_response)(sdi) != SR_OK) {
 			devc->transfer_error = TRUE;
-			return;
+			return FALSE;
 		}
 		if (acq->out_index * logic.unitsize >= PACKET_SIZE) {
 			/* Send off full logic packet. */
@@ -225,21 +363,8 @@ static void handle_read_response(const struct sr_dev_inst *sdi)
 		}
 	}
 
-	if (!devc->cancel_requested
-			&& acq->samples_done < acq->samples_max
-			&& acq->mem_addr_next < acq->mem_addr_stop) {
-		/* Request the next block. */
-		submit_request(sdi, STATE_READ_REQUEST);
-		return;
-	}
-
-	/* Send partially filled packet as it is the last one. */
-	if (!devc->cancel_requested && acq->out_index > 0) {
- 		logic.length = acq->out_index * logic.unitsize;
-		sr_session_send(sdi, &packet);
-		acq->out_index = 0;
-	}
-	submit_request(sdi, STATE_READ_FINISH);
+	return !devc->cancel_requested
+		&& acq->samples_done < acq->samples_max;
 }
 
 /* Destroy and unset the acquisition state record. */
@@ -247,6 +372,7 @@ static void clear_acquisition_state(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct acquisition_state *acq;
+	unsigned int i;
 
 	devc = sdi->priv;
 	acq = devc->acquisition;
@@ -254,6 +380,10 @@ static void clear_acquisition_state(const struct sr_dev_inst *sdi)
 	devc->acquisition = NULL;
 
 	if (acq) {
+		for (i = 0; i < READ_QUEUE_DEPTH; i++) {
+			libusb_free_transfer(acq->read_queue[i].xfer_out);
+			libusb_free_transfer(acq->read_queue[i].xfer_in);
+		}
 		libusb_free_transfer(acq->xfer_out);
 		libusb_free_transfer(acq->xfer_in);
 		g_free(acq);
@@ -295,9 +425,18 @@ static int transfer_event(int fd, int revents, void *cb_data)
 			submit_request(sdi, STATE_STATUS_REQUEST);
 	}
 
-	/* Stop processing events if an error occurred on a transfer. */
-	if (devc->transfer_error)
+	/*
+	 * Stop processing events if an error occurred on a transfer.
+	 * Queued read requests must have returned before that.
+	 */
+	if (devc->transfer_error) {
+		if (devc->acquisition
+				&& read_transfers_pending(devc->acquisition) > 0) {
+			cancel_read_transfers(devc->acquisition);
+			return G_SOURCE_CONTINUE;
+		}
 		devc->state = STATE_IDLE;
+	}
 
 	if (devc->state != STATE_IDLE)
 		return G_SOURCE_CONTINUE;
@@ -361,7 +500,7 @@ static void LIBUSB_CALL transfer_out_completed(struct libusb_transfer *transfer)
 		break;
 	case STATE_READ_PREPARE:
 		if (acq->mem_addr_next < acq->mem_addr_stop && !devc->cancel_requested)
-			submit_request(sdi, STATE_READ_REQUEST);
+			start_read(sdi);
 		else
 			submit_request(sdi, STATE_READ_FINISH);
 		break;
@@ -426,9 +565,6 @@ static void LIBUSB_CALL transfer_in_completed(struct libusb_transfer *transfer)
 		else
 			handle_length_response(sdi);
 		break;
-	case STATE_READ_REQUEST:
-		handle_read_response(sdi);
-		break;
 	default:
 		sr_err("Unexpected device state %d.", devc->state);
 		devc->transfer_error = TRUE;
@@ -436,12 +572,99 @@ static void LIBUSB_CALL transfer_in_completed(struct libusb_transfer *transfer)
 	}
 }
 
+/* Look up the read request which a transfer belongs to. */
+static struct read_request *transfer_request(struct acquisition_state *acq,
+					     struct libusb_transfer *transfer)
+{
+	struct read_request *req;
+
+	req = acq->read_queue;
+	while (req->xfer_out != transfer && req->xfer_in != transfer)
+		req++;
+
+	return req;
+}
+
+/* Read request output transfer completion callback. */
+static void LIBUSB_CALL read_out_completed(struct libusb_transfer *transfer)
+{
+	const struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	struct acquisition_state *acq;
+	struct read_request *req;
+
+	sdi = transfer->user_data;
+	devc = sdi->priv;
+	acq = devc->acquisition;
+	req = transfer_request(acq, transfer);
+	req->out_pending = FALSE;
+
+	if (transfer->status == LIBUSB_TRANSFER_CANCELLED)
+		return;
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		sr_err("Read request to device failed: %s.",
+		       libusb_error_name(transfer->status));
+		devc->transfer_error = TRUE;
+		return;
+	}
+	/* The request's slot may have been waiting for reuse. */
+	fill_read_queue(sdi);
+}
+
+/* Read request input transfer completion callback. */
+static void LIBUSB_CALL read_in_completed(struct libusb_transfer *transfer)
+{
+	const struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	struct acquisition_state *acq;
+	struct read_request *req;
+
+	sdi = transfer->user_data;
+	devc = sdi->priv;
+	acq = devc->acquisition;
+
+	req = transfer_request(acq, transfer);
+	req->in_pending = FALSE;
+
+	if (transfer->status == LIBUSB_TRANSFER_CANCELLED || devc->transfer_error)
+		return;
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		sr_err("Read response from device failed: %s.",
+		       libusb_error_name(transfer->status));
+		devc->transfer_error = TRUE;
+		return;
+	}
+	/* Responses arrive in the order of the requests. */
+	if (req != &acq->read_queue[acq->read_head]) {
+		sr_err("Unexpected order of read responses.");
+		devc->transfer_error = TRUE;
+		return;
+	}
+	acq->read_head = (acq->read_head + 1) % READ_QUEUE_DEPTH;
+	acq->read_pending--;
+
+	/* Drain the responses to queued requests after the last one. */
+	if (!acq->read_stop) {
+		acq->read_buf = req->xfer_buf_in;
+		acq->read_len = transfer->actual_length;
+		acq->mem_addr_read = req->mem_addr_end;
+		if (!handle_read_response(sdi))
+			acq->read_stop = TRUE;
+	}
+	fill_read_queue(sdi);
+
+	if (acq->read_pending == 0)
+		finish_read(sdi);
+}
+
 /* Set up the acquisition state record. */
 static int init_acquisition_state(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
 	struct acquisition_state *acq;
+	struct read_request *req;
+	unsigned int i;
 
 	devc = sdi->priv;
 	usb = sdi->conn;
@@ -470,6 +693,28 @@ static int init_acquisition_state(const struct sr_dev_inst *sdi)
 		g_free(acq);
 		return SR_ERR_MALLOC;
 	}
+	for (i = 0; i < READ_QUEUE_DEPTH; i++) {
+		req = &acq->read_queue[i];
+		req->xfer_out = libusb_alloc_transfer(0);
+		req->xfer_in = libusb_alloc_transfer(0);
+		if (!req->xfer_out || !req->xfer_in) {
+			devc->acquisition = acq;
+			clear_acquisition_state(sdi);
+			return SR_ERR_MALLOC;
+		}
+		libusb_fill_bulk_transfer(req->xfer_out, usb->devhdl,
+					  EP_COMMAND,
+					  (unsigned char *)req->xfer_buf_out, 0,
+					  &read_out_completed,
+					  (struct sr_dev_inst *)sdi, USB_TIMEOUT_MS);
+		libusb_fill_bulk_transfer(req->xfer_in, usb->devhdl, EP_REPLY,
+					  (unsigned char *)req->xfer_buf_in,
+					  sizeof(req->xfer_buf_in),
+					  &read_in_completed,
+					  (struct sr_dev_inst *)sdi, USB_TIMEOUT_MS);
+	}
+	/* The short transfer quirk might not cope with queued reads. */
+	acq->read_depth = (devc->short_transfer_quirk) ? 1 : READ_QUEUE_DEPTH;
 
 	libusb_fill_bulk_transfer(acq->xfer_out, usb->devhdl, EP_COMMAND,
 				  (unsigned char *)acq->xfer_buf_out, 0,
@@ -169,7 +169,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	}
 
 	/* List all libusb devices. */
-	num_devs = libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	num_devs = sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	if (num_devs < 0) {
 		sr_err("Failed to list USB devices: %s.",
 			libusb_error_name(num_devs));
@@ -188,7 +188,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		devices = g_slist_append(devices, sdi);
 	}
 
-	libusb_free_device_list(devlist, 1);
+	sr_usb_free_device_list(devlist);
 	g_slist_free_full(conn_devices, (GDestroyNotify)&sr_usb_dev_inst_free);
 
 	return std_scan_complete(di, devices);
@@ -236,9 +236,12 @@ static int dev_open(struct sr_dev_inst *sdi)
 static int dev_close(struct sr_dev_inst *sdi)
 {
 	struct sr_usb_dev_inst *usb;
+	struct dev_context *devc;
 
 	usb = sdi->conn;
+	devc = sdi->priv;
 
+	sr_usb_stream_free(&devc->stream);
 	if (usb->devhdl)
 		libusb_release_interface(usb->devhdl, USB_INTERFACE);
 
@@ -510,11 +513,11 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 
 	devc = sdi->priv;
 
-	sr_session_source_remove(sdi->session, -1);
-
-	std_session_send_df_end(sdi);
-
-	devc->state = STATE_IDLE;
+	/* The session source callback finishes the acquisition. */
+	if (devc->state != STATE_IDLE && !devc->cancel_requested) {
+		devc->cancel_requested = TRUE;
+		sr_dbg("Requesting cancel.");
+	}
 
 	return SR_OK;
 }
@@ -412,15 +412,8 @@ static int sla5032_get_status(const struct sr_usb_dev_inst *usb, uint32_t status
 	return ret;
 }
 
-static int la_read_samples_data(const struct sr_usb_dev_inst *usb, void *buf,
-		unsigned int len, int *xfer_len)
-{
-	return libusb_bulk_transfer(usb->devhdl, EP_DATA, (uint8_t *)buf, len,
-			xfer_len, USB_DATA_TIMEOUT_MS);
-}
-
-static int sla5032_read_data_chunk(const struct sr_usb_dev_inst *usb,
-		void *buf, unsigned int len, int *xfer_len)
+/* Have the device send the next chunk of capture data to EP_DATA. */
+static int sla5032_request_data_chunk(const struct sr_usb_dev_inst *usb)
 {
 	int ret;
 
@@ -436,11 +429,7 @@ static int sla5032_read_data_chunk(const struct sr_usb_dev_inst *usb,
 	if (ret != SR_OK)
 		return ret;
 
-	ret = la_set_res_reg_bit(usb, 5, 4, 1);
-	if (ret != SR_OK)
-		return ret;
-
-	return la_read_samples_data(usb, buf, len, xfer_len);
+	return la_set_res_reg_bit(usb, 5, 4, 1);
 }
 
 static int sla5032_set_read_back(const struct sr_usb_dev_inst *usb)
@@ -516,49 +505,28 @@ static int la_cfg_fpga_done(const struct sr_usb_dev_inst *usb, unsigned int addr
 }
 
 /*
- * Load a bitstream file into memory. Returns a newly allocated array
- * consisting of a 32-bit length field followed by the bitstream data.
+ * Convert a bitstream file's content into the transfer format. The
+ * file's header gets replaced by 0x100 bytes of 0xFF padding.
  */
-static unsigned char *load_bitstream(struct sr_context *ctx,
-					const char *name, int *length_p)
+static GBytes *bitstream_to_transfer(GBytes *fw, const char *name)
 {
-	struct sr_resource fw;
-	unsigned char *stream, *fw_data;
-	ssize_t length, count;
-
-	if (sr_resource_open(ctx, &fw, SR_RESOURCE_FIRMWARE, name) != SR_OK)
-		return NULL;
+	const unsigned char *stream;
+	unsigned char *fw_data;
+	size_t size, length;
 
-	if (fw.size <= BITSTREAM_HEADER_SIZE || fw.size > BITSTREAM_MAX_SIZE) {
+	stream = g_bytes_get_data(fw, &size);
+	if (size <= BITSTREAM_HEADER_SIZE) {
 		sr_err("Refusing to load bitstream of unreasonable size "
-			   "(%" PRIu64 " bytes).", fw.size);
-		sr_resource_close(ctx, &fw);
-		return NULL;
-	}
-
-	stream = g_try_malloc(fw.size);
-	if (!stream) {
-		sr_err("Failed to allocate bitstream buffer.");
-		sr_resource_close(ctx, &fw);
-		return NULL;
-	}
-
-	count = sr_resource_read(ctx, &fw, stream, fw.size);
-	sr_resource_close(ctx, &fw);
-
-	if (count != (ssize_t)fw.size) {
-		sr_err("Failed to read bitstream '%s'.", name);
-		g_free(stream);
+			   "(%zu bytes).", size);
 		return NULL;
 	}
 
 	if (RB32(stream + BITSTREAM_HEADER_SIZE) != XILINX_SYNC_WORD) {
-		sr_err("Invalid bitstream signature.");
-		g_free(stream);
+		sr_err("Invalid bitstream signature in '%s'.", name);
 		return NULL;
 	}
 
-	length = fw.size - BITSTREAM_HEADER_SIZE + 0x100;
+	length = size - BITSTREAM_HEADER_SIZE + 0x100;
 	fw_data = g_try_malloc(length);
 	if (!fw_data) {
 		sr_err("Failed to allocate bitstream aligned buffer.");
@@ -567,12 +535,9 @@ static unsigned char *load_bitstream(struct sr_context *ctx,
 
 	memset(fw_data, 0xFF, 0x100);
 	memcpy(fw_data + 0x100, stream + BITSTREAM_HEADER_SIZE,
-			fw.size - BITSTREAM_HEADER_SIZE);
-	g_free(stream);
+			size - BITSTREAM_HEADER_SIZE);
 
-	*length_p = length;
-
-	return fw_data;
+	return g_bytes_new_take(fw_data, length);
 }
 
 static int sla5032_is_configured(const struct sr_usb_dev_inst *usb, gboolean *is_configured)
@@ -592,16 +557,22 @@ static int sla5032_is_configured(const struct sr_usb_dev_inst *usb, gboolean *is
 static int sla5032_send_bitstream(struct sr_context *ctx,
 		const struct sr_usb_dev_inst *usb, const char *name)
 {
-	unsigned char *stream;
+	GBytes *bitstream;
+	const uint8_t *stream;
+	size_t size;
 	int ret, length, i, n, m;
 	uint32_t reg2;
 
 	if (!ctx || !usb || !name)
 		return SR_ERR_BUG;
 
-	stream = load_bitstream(ctx, name, &length);
-	if (!stream)
+	bitstream = sr_resource_get_converted(ctx, SR_RESOURCE_FIRMWARE,
+			name, BITSTREAM_MAX_SIZE, "transfer",
+			&bitstream_to_transfer);
+	if (!bitstream)
 		return SR_ERR;
+	stream = g_bytes_get_data(bitstream, &size);
+	length = size;
 
 	sr_dbg("Downloading FPGA bitstream '%s'.", name);
 
@@ -612,7 +583,7 @@ static int sla5032_send_bitstream(struct sr_context *ctx,
 	/* Transfer the entire bitstream in one URB. */
 	ret = la_write_cmd_buf(usb, CMD_INIT_FW_UPLOAD, 0, 0, NULL); /* init firmware upload */
 	if (ret != SR_OK) {
-		g_free(stream);
+		g_bytes_unref(bitstream);
 		return ret;
 	}
 
@@ -625,7 +596,7 @@ static int sla5032_send_bitstream(struct sr_context *ctx,
 				FW_CHUNK_SIZE, &stream[i * FW_CHUNK_SIZE]);
 
 		if (ret != SR_OK) {
-			g_free(stream);
+			g_bytes_unref(bitstream);
 			return ret;
 		}
 	}
@@ -636,12 +607,12 @@ static int sla5032_send_bitstream(struct sr_context *ctx,
 				&stream[n * FW_CHUNK_SIZE]);
 
 		if (ret != SR_OK) {
-			g_free(stream);
+			g_bytes_unref(bitstream);
 			return ret;
 		}
 	}
 
-	g_free(stream);
+	g_bytes_unref(bitstream);
 
 	la_cfg_fpga_done(usb, 4000);
 
@@ -683,191 +654,280 @@ SR_PRIV int sla5032_apply_fpga_config(const struct sr_dev_inst *sdi)
 	return ret;
 }
 
-/* Callback handling data */
-static int la_prepare_data(int fd, int revents, void *cb_data)
-{
-	struct sr_dev_inst *sdi;
-	struct dev_context *devc;
-	struct sr_usb_dev_inst *usb;
-	int i, j, ret, xfer_len;
-	uint8_t *rle_buf, *samples;
-	const uint8_t *p, *q;
-	uint16_t rle_count;
-	int samples_count, rle_samples_count;
-	uint32_t status[3];
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
-	uint32_t value;
-	int trigger_offset;
-
-	enum {
-		RLE_SAMPLE_SIZE = sizeof(uint32_t) + sizeof(uint16_t),
-		RLE_SAMPLES_COUNT = 0x100000,
-		RLE_BUF_SIZE = RLE_SAMPLES_COUNT * RLE_SAMPLE_SIZE,
-		RLE_END_MARKER = 0xFFFF,
-	};
-
-	(void)fd;
-	(void)revents;
+/*
+ * Capture data is RLE compressed, each record holds a 32bit sample value
+ * and a 16bit repetition count. The device sends up to RLE_CHUNK_SIZE
+ * bytes per data request, a full chunk means that more data follows.
+ * Several transfers are kept queued while a chunk gets downloaded, each
+ * of them is decoded while the next ones are arriving.
+ */
+enum {
+	RLE_SAMPLE_SIZE = sizeof(uint32_t) + sizeof(uint16_t),
+	RLE_SAMPLES_COUNT = 0x100000,
+	RLE_CHUNK_SIZE = RLE_SAMPLES_COUNT * RLE_SAMPLE_SIZE,
+	RLE_END_MARKER = 0xFFFF,
+	/* A multiple of both the record size and the USB packet size. */
+	DATA_TRANSFER_SIZE = 32 * RLE_SAMPLE_SIZE * 512,
+	DATA_TRANSFER_COUNT = 4,
+	FEED_QUEUE_SAMPLES = 64 * 1024,
+	TRIGGER_CHECK_SAMPLES = 16 * 1024,
+};
 
-	sdi = cb_data;
-	devc = sdi->priv;
-	usb = sdi->conn;
+/* Check for the trigger condition in the expanded pre-trigger samples. */
+static void check_trigger(struct dev_context *devc)
+{
+	int offset;
+	size_t count;
+	uint8_t *data;
+
+	count = devc->trigger_check_count;
+	devc->trigger_check_count = 0;
+	if (!count)
+		return;
+
+	data = devc->trigger_check_buf;
+	offset = soft_trigger_logic_check(devc->stl, data,
+		count * sizeof(uint32_t), NULL);
+	if (offset < 0)
+		return;
+
+	devc->trigger_fired = TRUE;
+	feed_queue_logic_submit_many(devc->feed,
+		&data[offset * sizeof(uint32_t)], count - offset);
+}
 
-	memset(status, 0, sizeof(status));
-	ret = sla5032_get_status(usb, status);
-	if (ret != SR_OK) {
-		sla5032_write_reg14_zero(usb);
-		sr_dev_acquisition_stop(sdi);
-		return G_SOURCE_CONTINUE;
+/* Send a run of samples ('value' points to the LE32 sample). */
+static void send_run(struct dev_context *devc, const uint8_t *value,
+		size_t count)
+{
+	uint8_t *wrptr;
+	size_t chunk;
+
+	while (count && !devc->trigger_fired) {
+		chunk = MIN(count,
+			TRIGGER_CHECK_SAMPLES - devc->trigger_check_count);
+		wrptr = &devc->trigger_check_buf[devc->trigger_check_count
+			* sizeof(uint32_t)];
+		count -= chunk;
+		devc->trigger_check_count += chunk;
+		while (chunk--) {
+			memcpy(wrptr, value, sizeof(uint32_t));
+			wrptr += sizeof(uint32_t);
+		}
+		if (devc->trigger_check_count == TRIGGER_CHECK_SAMPLES)
+			check_trigger(devc);
 	}
+	if (count)
+		feed_queue_logic_submit(devc->feed, value, count);
+}
 
-	/* data not ready (acquision in progress) */
-	if (status[1] != 3)
-		return G_SOURCE_CONTINUE;
+/* Decode a completed data transfer, tell whether the chunk continues. */
+static gboolean receive_data_transfer(struct libusb_transfer *transfer,
+		void *cb_data)
+{
+	struct dev_context *devc;
+	const uint8_t *p;
+	size_t count, i;
+	uint16_t rle_count;
 
-	sr_dbg("acquision done, status: %u.", (unsigned int)status[2]);
+	devc = cb_data;
 
-	/* data ready (download, decode and send to sigrok) */
-	ret = sla5032_set_read_back(usb);
-	if (ret != SR_OK) {
-		sla5032_write_reg14_zero(usb);
-		sr_dev_acquisition_stop(sdi);
-		return G_SOURCE_CONTINUE;
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		sr_err("Capture data transfer failed: %s.",
+			libusb_error_name(transfer->status));
+		devc->download_done = TRUE;
+		return FALSE;
 	}
 
-	rle_buf = g_try_malloc(RLE_BUF_SIZE);
-	if (rle_buf == NULL) {
-		sla5032_write_reg14_zero(usb);
-		sr_dev_acquisition_stop(sdi);
-		return G_SOURCE_CONTINUE;
+	p = transfer->buffer;
+	count = transfer->actual_length / RLE_SAMPLE_SIZE;
+	for (i = 0; i < count; i++, p += RLE_SAMPLE_SIZE) {
+		rle_count = RL16(p + sizeof(uint32_t));
+		if (rle_count == RLE_END_MARKER) {
+			sr_dbg("RLE end marker found.");
+			devc->download_done = TRUE;
+			break;
+		}
+		send_run(devc, p, rle_count + 1);
 	}
+	if (!devc->trigger_fired)
+		check_trigger(devc);
 
-	do {
-		xfer_len = 0;
-		ret = sla5032_read_data_chunk(usb, rle_buf, RLE_BUF_SIZE, &xfer_len);
-		if (ret != SR_OK) {
-			sla5032_write_reg14_zero(usb);
-			g_free(rle_buf);
-			sr_dev_acquisition_stop(sdi);
-
-			sr_dbg("acquision done, ret: %d.", ret);
-			return G_SOURCE_CONTINUE;
-		}
+	devc->chunk_received += transfer->actual_length;
+	if (transfer->actual_length < transfer->length)
+		devc->download_done = TRUE;
 
-		sr_dbg("acquision done, xfer_len: %d.", xfer_len);
+	return !devc->download_done && devc->chunk_received < RLE_CHUNK_SIZE;
+}
 
-		if (xfer_len == 0) {
-			sla5032_write_reg14_zero(usb);
-			g_free(rle_buf);
-			sr_dev_acquisition_stop(sdi);
-			return G_SOURCE_CONTINUE;
-		}
+/* All transfers of the current chunk have returned. */
+static void data_chunk_done(void *cb_data)
+{
+	struct dev_context *devc;
 
-		p = rle_buf;
-		samples_count = 0;
-		rle_samples_count = xfer_len / RLE_SAMPLE_SIZE;
+	devc = cb_data;
 
-		sr_dbg("acquision done, rle_samples_count: %d.", rle_samples_count);
+	sr_dbg("Received %zu bytes of capture data.", devc->chunk_received);
+	if (devc->chunk_received < RLE_CHUNK_SIZE)
+		devc->download_done = TRUE;
+	devc->state = devc->download_done ? STATE_READ_FINISH : STATE_READ_PREPARE;
+}
 
-		for (i = 0; i < rle_samples_count; i++) {
-			p += sizeof(uint32_t); /* skip sample value */
+/* Request the next chunk, and queue the transfers which receive it. */
+static int start_data_chunk(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+	int ret;
 
-			rle_count = RL16(p); /* read RLE counter */
-			p += sizeof(uint16_t);
-			if (rle_count == RLE_END_MARKER) {
-				rle_samples_count = i;
-				break;
-			}
-			samples_count += rle_count + 1;
-		}
-		sr_dbg("acquision done, samples_count: %d.", samples_count);
+	devc = sdi->priv;
+	usb = sdi->conn;
 
-		if (samples_count == 0) {
-			sr_dbg("acquision done, no samples.");
-			sla5032_write_reg14_zero(usb);
-			g_free(rle_buf);
-			sr_dev_acquisition_stop(sdi);
-			return G_SOURCE_CONTINUE;
-		}
+	ret = sla5032_request_data_chunk(usb);
+	if (ret != SR_OK)
+		return ret;
 
-		/* Decode RLE */
-		samples = g_try_malloc(samples_count * sizeof(uint32_t));
-		if (!samples) {
-			sr_dbg("memory allocation error.");
-			sla5032_write_reg14_zero(usb);
-			g_free(rle_buf);
-			sr_dev_acquisition_stop(sdi);
-			return G_SOURCE_CONTINUE;
-		}
+	devc->chunk_received = 0;
+	devc->stream.transfer_size = DATA_TRANSFER_SIZE;
+	devc->stream.queue_depth = DATA_TRANSFER_COUNT;
+	sr_usb_stream_start(&devc->stream, 0, RLE_SAMPLE_SIZE * 512, 0,
+		DATA_TRANSFER_COUNT);
+	devc->stream.timeout = USB_DATA_TIMEOUT_MS;
 
-		p = rle_buf;
-		q = samples;
-		for (i = 0; i < rle_samples_count; i++) {
-			value = RL32(p);
-			p += sizeof(uint32_t); /* read sample value */
+	ret = sr_usb_stream_submit(&devc->stream, usb->devhdl, EP_DATA,
+		receive_data_transfer, data_chunk_done, devc);
+	if (ret != SR_OK)
+		return ret;
+	devc->state = STATE_READ_REQUEST;
 
-			rle_count = RL16(p); /* read RLE counter */
-			p += sizeof(uint16_t);
+	return SR_OK;
+}
 
-			if (rle_count == RLE_END_MARKER) {
-				sr_dbg("RLE end marker found.");
-				break;
-			}
+static int start_download(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	int ret;
 
-			for (j = 0; j <= rle_count; j++) {
-				WL32(q, value);
-				q += sizeof(uint32_t);
-			}
-		}
+	devc = sdi->priv;
 
-		if (devc->trigger_fired) {
-			/* Send the incoming transfer to the session bus. */
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-
-			logic.length = samples_count * sizeof(uint32_t);
-			logic.unitsize = sizeof(uint32_t);
-			logic.data = samples;
-			sr_session_send(sdi, &packet);
-		} else {
-			trigger_offset = soft_trigger_logic_check(devc->stl,
-				samples, samples_count * sizeof(uint32_t), NULL);
-			if (trigger_offset > -1) {
-				packet.type = SR_DF_LOGIC;
-				packet.payload = &logic;
-				int num_samples = samples_count - trigger_offset;
-
-				logic.length = num_samples * sizeof(uint32_t);
-				logic.unitsize = sizeof(uint32_t);
-				logic.data = samples + trigger_offset * sizeof(uint32_t);
-				sr_session_send(sdi, &packet);
-
-				devc->trigger_fired = TRUE;
-			}
-		}
+	ret = sla5032_set_read_back(sdi->conn);
+	if (ret != SR_OK)
+		return ret;
 
-		g_free(samples);
-	} while (rle_samples_count == RLE_SAMPLES_COUNT);
+	devc->feed = feed_queue_logic_alloc(sdi, FEED_QUEUE_SAMPLES,
+		sizeof(uint32_t));
+	if (!devc->trigger_fired)
+		devc->trigger_check_buf = g_try_malloc(TRIGGER_CHECK_SAMPLES
+			* sizeof(uint32_t));
+	if (!devc->feed || (!devc->trigger_fired && !devc->trigger_check_buf))
+		return SR_ERR_MALLOC;
+	devc->trigger_check_count = 0;
+	devc->download_done = FALSE;
 
-	sr_dbg("acquision stop, rle_samples_count < RLE_SAMPLES_COUNT.");
+	return start_data_chunk(sdi);
+}
 
-	sla5032_write_reg14_zero(usb);
+/* Release the acquisition's resources, and tell the session it is done. */
+static int finish_acquisition(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
 
-	sr_dev_acquisition_stop(sdi); /* if all data transfered */
+	devc = sdi->priv;
 
-	g_free(rle_buf);
+	sla5032_write_reg14_zero(sdi->conn);
 
+	if (devc->feed) {
+		if (!devc->cancel_requested)
+			feed_queue_logic_flush(devc->feed);
+		feed_queue_logic_free(devc->feed);
+		devc->feed = NULL;
+	}
+	g_free(devc->trigger_check_buf);
+	devc->trigger_check_buf = NULL;
 	if (devc->stl) {
 		soft_trigger_logic_free(devc->stl);
 		devc->stl = NULL;
 	}
 
+	std_session_send_df_end(sdi);
+	devc->state = STATE_IDLE;
+
+	return G_SOURCE_REMOVE;
+}
+
+/* USB event and capture status poll callback. */
+static int la_prepare_data(int fd, int revents, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	struct drv_context *drvc;
+	struct sr_usb_dev_inst *usb;
+	struct timeval tv;
+	int ret;
+	uint32_t status[3];
+
+	(void)fd;
+	(void)revents;
+
+	sdi = cb_data;
+	devc = sdi->priv;
+	drvc = sdi->driver->context;
+	usb = sdi->conn;
+
+	/* Handle completed data transfers without blocking. */
+	tv.tv_sec = 0;
+	tv.tv_usec = 0;
+	libusb_handle_events_timeout_completed(drvc->sr_ctx->libusb_ctx,
+		&tv, NULL);
+
+	switch (devc->state) {
+	case STATE_STATUS_WAIT:
+		if (devc->cancel_requested)
+			return finish_acquisition(sdi);
+
+		memset(status, 0, sizeof(status));
+		ret = sla5032_get_status(usb, status);
+		if (ret != SR_OK)
+			return finish_acquisition(sdi);
+
+		/* data not ready (acquision in progress) */
+		if (status[1] != 3)
+			return G_SOURCE_CONTINUE;
+
+		sr_dbg("acquision done, status: %u.", (unsigned int)status[2]);
+
+		/* data ready (download, decode and send to sigrok) */
+		ret = start_download(sdi);
+		if (ret != SR_OK) {
+			sr_err("Cannot start capture data download.");
+			return finish_acquisition(sdi);
+		}
+		break;
+	case STATE_READ_REQUEST:
+		/* Transfers are pending, stop them when cancelled. */
+		if (devc->cancel_requested)
+			sr_usb_stream_cancel(&devc->stream);
+		break;
+	case STATE_READ_PREPARE:
+		if (devc->cancel_requested)
+			return finish_acquisition(sdi);
+		ret = start_data_chunk(sdi);
+		if (ret != SR_OK) {
+			sr_err("Cannot request capture data.");
+			return finish_acquisition(sdi);
+		}
+		break;
+	case STATE_READ_FINISH:
+	default:
+		return finish_acquisition(sdi);
+	}
+
 	return G_SOURCE_CONTINUE;
 }
 
 SR_PRIV int sla5032_start_acquisition(const struct sr_dev_inst *sdi)
 {
+	struct drv_context *drvc;
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
 	struct sr_trigger *trigger;
@@ -875,6 +935,7 @@ SR_PRIV int sla5032_start_acquisition(const struct sr_dev_inst *sdi)
 	enum { poll_interval_ms = 100 };
 	uint64_t pre, post;
 
+	drvc = sdi->driver->context;
 	devc = sdi->priv;
 	usb = sdi->conn;
 
@@ -882,6 +943,7 @@ SR_PRIV int sla5032_start_acquisition(const struct sr_dev_inst *sdi)
 		sr_err("Not in idle state, cannot start acquisition.");
 		return SR_ERR;
 	}
+	devc->cancel_requested = FALSE;
 
 	pre = (devc->limit_samples * devc->capture_ratio) / 100;
 	post = devc->limit_samples - pre;
@@ -944,8 +1006,11 @@ SR_PRIV int sla5032_start_acquisition(const struct sr_dev_inst *sdi)
 	if (ret != SR_OK)
 		return ret;
 
-	sr_session_source_add(sdi->session, -1, 0, poll_interval_ms,
+	ret = usb_source_add(sdi->session, drvc->sr_ctx, poll_interval_ms,
 			la_prepare_data, (struct sr_dev_inst *)sdi);
+	if (ret != SR_OK)
+		return ret;
+	devc->state = STATE_STATUS_WAIT;
 
 	std_session_send_df_header(sdi);
 
@@ -104,6 +104,15 @@ struct dev_context {
 	int active_fpga_config;		/* FPGA configuration index */
 
 	enum protocol_state state;	/* async protocol state */
+	gboolean cancel_requested;	/* stop at the next opportunity */
+
+	/* Capture data download. */
+	struct sr_usb_stream stream;	/* queued data transfers */
+	size_t chunk_received;		/* bytes received of current chunk */
+	gboolean download_done;		/* no more chunks to request */
+	struct feed_queue_logic *feed;	/* session feed after the trigger */
+	uint8_t *trigger_check_buf;	/* expanded pre-trigger samples */
+	size_t trigger_check_count;
 };
 
 SR_PRIV int sla5032_start_acquisition(const struct sr_dev_inst *sdi);
@@ -225,6 +225,7 @@ SR_PRIV void testo_receive_packet(const struct sr_dev_inst *sdi)
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
+	GSList ch_node;
 	struct sr_analog_spec spec;
 	struct sr_channel *ch;
 	GString *dbg;
@@ -235,7 +236,7 @@ SR_PRIV void testo_receive_packet(const struct sr_dev_inst *sdi)
 	devc = sdi->priv;
 	sr_dbg("Got %d-byte packet.", devc->reply_size);
 
-	if (sr_log_loglevel_get() >= SR_LOG_SPEW) {
+	if (sr_log_enabled(SR_LOG_SPEW)) {
 		dbg = g_string_sized_new(128);
 		g_string_printf(dbg, "Packet:");
 		for (i = 0; i < devc->reply_size; i++)
@@ -288,8 +289,7 @@ SR_PRIV void testo_receive_packet(const struct sr_dev_inst *sdi)
 			return;
 		}
 		ch = g_slist_nth_data(sdi->channels, i);
-		analog.meaning->channels = g_slist_append(NULL, ch);
+		sr_analog_meaning_channel_set(analog.meaning, &ch_node, ch);
 		sr_session_send(sdi, &packet);
-		g_slist_free(analog.meaning->channels);
 	}
 }
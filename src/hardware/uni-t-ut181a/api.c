@@ -508,7 +508,8 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		 * So the index should be good, just the number of samples
 		 * in that recording is yet unknown. Get the sample count
 		 * and initiate the reception of the first chunk, completed
-		 * reception of a chunk advances through the sequence.
+		 * reception of a chunk advances through the sequence and
+		 * keeps several chunk requests outstanding.
 		 */
 		rec_idx = devc->data_source - DATA_SOURCE_REC_FIRST;
 		if (rec_idx >= devc->record_count)
@@ -528,9 +529,8 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		ret = ut181a_waitfor_response(sdi, 200);
 		if (ret < 0)
 			return ret;
-		devc->info.rec_data.samples_total = devc->wait_state.data_value;
-		devc->info.rec_data.samples_curr = 0;
-		ret = ut181a_send_cmd_get_rec_samples(serial, rec_idx, 0);
+		ret = ut181a_rec_data_start(sdi, rec_idx,
+			devc->wait_state.data_value);
 	} else {
 		sr_err("Unhandled data source %d, programming error?",
 			(int)devc->data_source);
@@ -1073,7 +1073,7 @@ static int ut181a_send_frame(struct sr_serial_dev_inst *serial,
 	uint16_t cs_value;
 	int ret;
 
-	if (FRAME_DUMP_BYTES && sr_log_loglevel_get() >= FRAME_DUMP_LEVEL) {
+	if (FRAME_DUMP_BYTES && sr_log_enabled(FRAME_DUMP_LEVEL)) {
 		GString *spew;
 		spew = sr_hexdump_new(data, dlen);
 		FRAME_DUMP_CALL("TX payload, %zu bytes: %s", dlen, spew->str);
@@ -1107,7 +1107,7 @@ static int ut181a_send_frame(struct sr_serial_dev_inst *serial,
 	WL16(&frame_buff[frame_off], cs_value);
 	frame_off += sizeof(uint16_t);
 
-	if (FRAME_DUMP_FRAME && sr_log_loglevel_get() >= FRAME_DUMP_LEVEL) {
+	if (FRAME_DUMP_FRAME && sr_log_enabled(FRAME_DUMP_LEVEL)) {
 		GString *spew;
 		spew = sr_hexdump_new(frame_buff, frame_off);
 		FRAME_DUMP_CALL("TX frame, %zu bytes: %s", frame_off, spew->str);
@@ -1232,6 +1232,101 @@ SR_PRIV int ut181a_send_cmd_get_rec_samples(struct sr_serial_dev_inst *serial, s
 	return ut181a_send_frame(serial, cmd, sizeof(cmd));
 }
 
+/**
+ * Release the sample storage of a recording download.
+ */
+SR_PRIV void ut181a_rec_data_free(struct dev_context *devc)
+{
+	if (!devc)
+		return;
+
+	g_free(devc->info.rec_data.values);
+	devc->info.rec_data.values = NULL;
+	g_free(devc->info.rec_data.digits);
+	devc->info.rec_data.digits = NULL;
+	g_free(devc->info.rec_data.stamps);
+	devc->info.rec_data.stamps = NULL;
+}
+
+/*
+ * Keep the pipeline of "get recording samples" requests filled. Only
+ * one request is outstanding until the meter's chunk size is known.
+ */
+static int ut181a_rec_data_request(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct ut181a_info *info;
+	size_t depth, slot;
+	int ret;
+
+	devc = sdi->priv;
+	info = &devc->info;
+
+	depth = info->rec_data.chunk_size ? REC_REQ_DEPTH : 1;
+	while (info->rec_data.req_count < depth) {
+		if (info->rec_data.samples_req >= info->rec_data.samples_total)
+			break;
+		ret = ut181a_send_cmd_get_rec_samples(sdi->conn,
+			info->rec_data.rec_idx, info->rec_data.samples_req);
+		if (ret < 0)
+			return ret;
+		slot = info->rec_data.req_head + info->rec_data.req_count;
+		slot %= REC_REQ_DEPTH;
+		info->rec_data.req_offs[slot] = info->rec_data.samples_req;
+		info->rec_data.req_count++;
+		info->rec_data.samples_req += MAX(info->rec_data.chunk_size, 1);
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Start the download of a recording's samples.
+ *
+ * @param[in] sdi The device instance.
+ * @param[in] idx The recording's index (0-based).
+ * @param[in] count The recording's number of samples.
+ *
+ * @returns SR_OK upon success, SR_ERR_* upon error.
+ *
+ * The sample storage for the complete recording gets allocated here.
+ * Received chunks get stored at their position, and contiguous ranges
+ * get sent to the session as they complete.
+ */
+SR_PRIV int ut181a_rec_data_start(const struct sr_dev_inst *sdi,
+	size_t idx, size_t count)
+{
+	struct dev_context *devc;
+	struct ut181a_info *info;
+
+	devc = sdi->priv;
+	info = &devc->info;
+
+	ut181a_rec_data_free(devc);
+	info->rec_data.rec_idx = idx;
+	info->rec_data.samples_total = count;
+	info->rec_data.samples_curr = 0;
+	info->rec_data.samples_sent = 0;
+	info->rec_data.samples_req = 0;
+	info->rec_data.chunk_size = 0;
+	info->rec_data.req_head = 0;
+	info->rec_data.req_count = 0;
+
+	/* An empty recording still gets one request, its response ends the acquisition. */
+	if (!count)
+		return ut181a_send_cmd_get_rec_samples(sdi->conn, idx, 0);
+
+	info->rec_data.values = g_try_malloc_n(count, sizeof(float));
+	info->rec_data.digits = g_try_malloc_n(count, sizeof(int8_t));
+	info->rec_data.stamps = g_try_malloc_n(count, sizeof(uint32_t));
+	if (!info->rec_data.values || !info->rec_data.digits || !info->rec_data.stamps) {
+		ut181a_rec_data_free(devc);
+		return SR_ERR_MALLOC;
+	}
+
+	return ut181a_rec_data_request(sdi);
+}
+
 /* TODO
  * Construct and transmit "record on/off" command. Requires a caption,
  * an interval, and a duration to start a recording. Recordings can get
@@ -1376,8 +1471,8 @@ static void ut181a_cond_stop_acquisition(struct sr_dev_inst *sdi)
 static int ut181a_feed_send_rate(struct sr_dev_inst *sdi, int interval)
 {
 #if 1
-	return sr_session_send_meta(sdi,
-		SR_CONF_SAMPLE_INTERVAL, g_variant_new_uint64(interval));
+	return sr_session_send_meta_u64(sdi,
+		SR_CONF_SAMPLE_INTERVAL, interval);
 #else
 	uint64_t rate;
 
@@ -1391,8 +1486,8 @@ static int ut181a_feed_send_rate(struct sr_dev_inst *sdi, int interval)
 	(void)interval;
 	rate = 0;
 
-	return sr_session_send_meta(sdi,
-		SR_CONF_SAMPLERATE, g_variant_new_uint64(rate));
+	return sr_session_send_meta_u64(sdi,
+		SR_CONF_SAMPLERATE, rate);
 #endif
 }
 
@@ -1573,6 +1668,96 @@ static int ut181a_feedbuff_count_frame(struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
+#if UT181A_WITH_TIMESTAMP
+/**
+ * Send the timestamps of a range of recorded samples to the session.
+ */
+static int ut181a_rec_data_feed_stamps(struct sr_dev_inst *sdi,
+	size_t first, size_t count)
+{
+	struct dev_context *devc;
+	struct feed_buffer feedbuff;
+	float *epochs;
+	size_t idx;
+	int ret;
+
+	devc = sdi->priv;
+	epochs = g_malloc_n(count, sizeof(*epochs));
+	for (idx = 0; idx < count; idx++) {
+		epochs[idx] = ut181a_get_epoch_for_timestamp(
+			devc->info.rec_data.stamps[first + idx]);
+	}
+
+	ret = SR_OK;
+	ret |= ut181a_feedbuff_initialize(&feedbuff);
+	ret |= ut181a_feedbuff_setup_channel(&feedbuff, UT181A_CH_TIME, sdi);
+	ret |= ut181a_feedbuff_setup_unit(&feedbuff, "timestamp");
+	feedbuff.analog.data = epochs;
+	feedbuff.analog.num_samples = count;
+	ret |= ut181a_feedbuff_send_feed(&feedbuff, sdi, 0);
+	ret |= ut181a_feedbuff_cleanup(&feedbuff);
+	g_free(epochs);
+
+	return ret;
+}
+#endif
+
+/**
+ * Send the contiguously received samples of a recording to the session.
+ * Each run of samples with equal precision becomes one analog packet,
+ * which references the sample storage.
+ */
+static int ut181a_rec_data_feed(struct sr_dev_inst *sdi,
+	struct feed_buffer *buff)
+{
+	struct dev_context *devc;
+	struct ut181a_info *info;
+	size_t first, count;
+	uint64_t remain;
+	int8_t digits;
+	int ret;
+
+	devc = sdi->priv;
+	info = &devc->info;
+
+	while (info->rec_data.samples_sent < info->rec_data.samples_curr) {
+		if (sdi->status != SR_ST_ACTIVE)
+			break;
+		first = info->rec_data.samples_sent;
+		digits = info->rec_data.digits[first];
+		count = 1;
+		while (first + count < info->rec_data.samples_curr) {
+			if (info->rec_data.digits[first + count] != digits)
+				break;
+			count++;
+		}
+
+		/* Large packets must not overshoot the samples limit. */
+		ret = sr_sw_limits_get_remain(&devc->limits,
+			&remain, NULL, NULL, NULL);
+		if (ret == SR_OK && remain && count > remain)
+			count = remain;
+
+#if UT181A_WITH_TIMESTAMP
+		ret = ut181a_rec_data_feed_stamps(sdi, first, count);
+		if (ret != SR_OK)
+			return ret;
+#endif
+		buff->analog.data = &info->rec_data.values[first];
+		buff->analog.num_samples = count;
+		buff->analog.encoding->digits = digits;
+		buff->analog.spec->spec_digits = digits;
+		info->rec_data.samples_sent += count;
+		ret = ut181a_feedbuff_send_feed(buff, sdi, count);
+		if (ret != SR_OK)
+			return ret;
+	}
+	buff->analog.data = &buff->main_value;
+	buff->analog.num_samples = 1;
+
+	return SR_OK;
+}
+
 /* Deserializing helpers which also advance the read pointer. */
 
 static int check_len(size_t *got, size_t want)
@@ -1742,6 +1927,8 @@ static int process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 	struct feed_buffer feedbuff;
 	struct value_params value;
 	const struct mqopt_item *mqitem;
+	size_t rec_off, rec_pos;
+	gboolean rec_keep;
 	int ret;
 	uint8_t v8; uint16_t v16; uint32_t v32; float vf;
 
@@ -1753,7 +1940,7 @@ static int process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 	devc = sdi ? sdi->priv : NULL;
 	state = devc ? &devc->wait_state : NULL;
 	info = devc ? &devc->info : NULL;
-	if (FRAME_DUMP_FRAME && sr_log_loglevel_get() >= FRAME_DUMP_LEVEL) {
+	if (FRAME_DUMP_FRAME && sr_log_enabled(FRAME_DUMP_LEVEL)) {
 		GString *spew;
 		spew = sr_hexdump_new(pkt, len);
 		FRAME_DUMP_CALL("RX frame, %zu bytes: %s", len, spew->str);
@@ -1812,7 +1999,7 @@ static int process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 	}
 	if (state)
 		state->response_count++;
-	if (FRAME_DUMP_BYTES && sr_log_loglevel_get() >= FRAME_DUMP_LEVEL) {
+	if (FRAME_DUMP_BYTES && sr_log_enabled(FRAME_DUMP_LEVEL)) {
 		GString *spew;
 		spew = sr_hexdump_new(payload, pl_dlen);
 		FRAME_DUMP_CALL("RX payload, %zu bytes: %s", pl_dlen, spew->str);
@@ -2564,12 +2751,28 @@ static int process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 		ret = consume_u8(&info->rec_data.samples_chunk, &payload, &pl_dlen);
 		if (ret != SR_OK)
 			return SR_ERR_DATA;
-		info->rec_data.samples_curr += info->rec_data.samples_chunk;
+
+		/*
+		 * Responses arrive in the order of requests. A chunk for
+		 * another than the next expected offset is stale (an
+		 * earlier chunk was shorter than assumed, and that offset
+		 * got requested again). Its content gets dropped.
+		 */
+		if (info->rec_data.req_count) {
+			rec_off = info->rec_data.req_offs[info->rec_data.req_head];
+			info->rec_data.req_head++;
+			info->rec_data.req_head %= REC_REQ_DEPTH;
+			info->rec_data.req_count--;
+		} else {
+			rec_off = info->rec_data.samples_curr;
+		}
+		rec_keep = rec_off == info->rec_data.samples_curr;
+		rec_pos = rec_off;
 		while (info->rec_data.samples_chunk--) {
 			/*
 			 * Implementation detail: Consume all received
-			 * data, yet skip processing when a limit was
-			 * reached and previously terminated acquisition.
+			 * data, yet only store what is expected and
+			 * fits the recording's sample storage.
 			 */
 			ret = SR_OK;
 			ret |= consume_flt(&vf, &payload, &pl_dlen);
@@ -2578,21 +2781,38 @@ static int process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 			if (ret != SR_OK)
 				return SR_ERR_DATA;
 
-			if (sdi->status != SR_ST_ACTIVE)
+			if (!rec_keep || rec_pos >= info->rec_data.samples_total)
 				continue;
 
-			ret = ut181a_feedbuff_start_frame(sdi);
-			if (ret != SR_OK)
-				return SR_ERR_DATA;
-
 			ret = SR_OK;
 			ret |= ut181a_get_value_params(&value, vf, v8);
 			ret |= ut181a_feedbuff_setup_value(&feedbuff, &value);
-			ret |= ut181a_feedbuff_send_feed(&feedbuff, sdi, 1);
 			if (ret != SR_OK)
 				return SR_ERR_DATA;
-
-			ret = ut181a_feedbuff_count_frame(sdi);
+			info->rec_data.values[rec_pos] = feedbuff.main_value;
+			info->rec_data.digits[rec_pos] = value.digits;
+			info->rec_data.stamps[rec_pos] = v32;
+			rec_pos++;
+		}
+		if (rec_keep) {
+			info->rec_data.samples_curr = rec_pos;
+			rec_off = rec_pos - rec_off;
+			if (!rec_off) {
+				/* No more data from the meter, end here. */
+				info->rec_data.samples_total = rec_pos;
+			} else if (rec_pos < info->rec_data.samples_total &&
+					rec_off != info->rec_data.chunk_size) {
+				/*
+				 * Learn the meter's chunk size, and continue
+				 * from the end of this chunk when the chunk
+				 * size changed.
+				 */
+				info->rec_data.chunk_size = rec_off;
+				info->rec_data.samples_req = rec_pos;
+			}
+			if (info->rec_data.samples_req < rec_pos)
+				info->rec_data.samples_req = rec_pos;
+			ret = ut181a_rec_data_feed(sdi, &feedbuff);
 			if (ret != SR_OK)
 				return SR_ERR_DATA;
 		}
@@ -2670,16 +2890,15 @@ static int process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 			if (!info)
 				break;
 			/*
-			 * The sample count was incremented above during
+			 * The sample count was updated above during
 			 * reception, because of variable length chunks
-			 * of sample data.
+			 * of sample data. Top up the outstanding requests.
 			 */
 			if (info->rec_data.samples_curr >= info->rec_data.samples_total) {
 				ut181a_cond_stop_acquisition(sdi);
 				break;
 			}
-			ret = ut181a_send_cmd_get_rec_samples(serial,
-				info->rec_data.rec_idx, info->rec_data.samples_curr);
+			ret = ut181a_rec_data_request(sdi);
 			if (ret < 0)
 				ut181a_cond_stop_acquisition(sdi);
 			break;
@@ -2761,7 +2980,7 @@ static int process_buffer(struct sr_dev_inst *sdi)
 		}
 
 		/* Process the packet which completed reception. */
-		if (FRAME_DUMP_CSUM && sr_log_loglevel_get() >= FRAME_DUMP_LEVEL) {
+		if (FRAME_DUMP_CSUM && sr_log_enabled(FRAME_DUMP_LEVEL)) {
 			GString *spew;
 			spew = sr_hexdump_new(pkt, pkt_len);
 			FRAME_DUMP_CALL("Found RX frame, %zu bytes: %s", pkt_len, spew->str);
@@ -2865,7 +3084,7 @@ static int ut181a_receive_data(struct sr_dev_inst *sdi)
 		return 0;
 	}
 	len = slen;
-	if (FRAME_DUMP_RXDATA && sr_log_loglevel_get() >= FRAME_DUMP_LEVEL) {
+	if (FRAME_DUMP_RXDATA && sr_log_enabled(FRAME_DUMP_LEVEL)) {
 		spew = sr_hexdump_new(data, len);
 		FRAME_DUMP_CALL("UART RX, %zu bytes: %s", len, spew->str);
 		sr_hexdump_free(spew);
@@ -2903,6 +3122,7 @@ SR_PRIV int ut181a_handle_events(int fd, int revents, void *cb_data)
 		}
 		serial_source_remove(sdi->session, serial);
 		std_session_send_df_end(sdi);
+		ut181a_rec_data_free(devc);
 	}
 
 	return TRUE;
@@ -39,15 +39,25 @@
  * can span up to 256 items which each occupy 9 bytes, plus some header
  * before the items array. Be generous and prepare to receive several
  * frames in a row, e.g. when synchronizing to the packet stream at the
- * start of a session or after communication failure.
+ * start of a session or after communication failure, or when several
+ * chunks of record data were requested at once.
  *
  * The largest frame we expect to transmit is a "start record" command.
  * Which contains 18 bytes of payload (plus 6 bytes of frame envelope).
  */
-#define RECV_BUFF_SIZE 4096
+#define RECV_BUFF_SIZE 8192
 #define SEND_BUFF_SIZE 32
 #define SEND_TO_MS 100
 
+/*
+ * Recording downloads keep several "get recording samples" requests
+ * in flight, which the meter answers in order. This hides the round
+ * trip through the cable's USB/UART bridge. Once the meter's chunk
+ * size is known, each request asks for the next chunk. A value of 1
+ * falls back to strict request/response pairs.
+ */
+#define REC_REQ_DEPTH 4
+
 /*
  * The device can hold several recordings, their number is under the
  * user's control and dynamic at runtime. It's assumed that there is an
@@ -355,7 +365,15 @@ struct ut181a_info {
 		size_t rec_idx;
 		size_t samples_total;
 		size_t samples_curr;
+		size_t samples_sent;
+		size_t samples_req;
 		uint8_t samples_chunk;
+		uint8_t chunk_size;
+		size_t req_offs[REC_REQ_DEPTH];
+		size_t req_head, req_count;
+		float *values;
+		int8_t *digits;
+		uint32_t *stamps;
 	} rec_data;
 	struct {
 		enum ut181_cmd_code code;
@@ -421,6 +439,9 @@ SR_PRIV int ut181a_send_cmd_get_saved_value(struct sr_serial_dev_inst *serial, s
 SR_PRIV int ut181a_send_cmd_get_recs_count(struct sr_serial_dev_inst *serial);
 SR_PRIV int ut181a_send_cmd_get_rec_info(struct sr_serial_dev_inst *serial, size_t idx);
 SR_PRIV int ut181a_send_cmd_get_rec_samples(struct sr_serial_dev_inst *serial, size_t idx, size_t off);
+SR_PRIV int ut181a_rec_data_start(const struct sr_dev_inst *sdi,
+	size_t idx, size_t count);
+SR_PRIV void ut181a_rec_data_free(struct dev_context *devc);
 
 SR_PRIV int ut181a_configure_waitfor(struct dev_context *devc,
 	gboolean want_code, enum ut181_cmd_code want_data,
@@ -70,12 +70,13 @@ static void process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
+	GSList ch_node;
 	struct sr_analog_spec spec;
 	GString *spew;
 	float temp;
 	gboolean is_valid;
 
-	if (sr_log_loglevel_get() >= SR_LOG_SPEW) {
+	if (sr_log_enabled(SR_LOG_SPEW)) {
 		spew = sr_hexdump_new(pkt, len);
 		sr_spew("Got a packet, len %zu, bytes%s", len, spew->str);
 		sr_hexdump_free(spew);
@@ -119,16 +120,19 @@ static void process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 		switch (pkt[13] - '0') {
 		case 0:
 			/* Channel T1. */
-			analog.meaning->channels = g_slist_append(NULL, g_slist_nth_data(sdi->channels, 0));
+			sr_analog_meaning_channel_set(analog.meaning, &ch_node,
+				g_slist_nth_data(sdi->channels, 0));
 			break;
 		case 1:
 			/* Channel T2. */
-			analog.meaning->channels = g_slist_append(NULL, g_slist_nth_data(sdi->channels, 1));
+			sr_analog_meaning_channel_set(analog.meaning, &ch_node,
+				g_slist_nth_data(sdi->channels, 1));
 			break;
 		case 2:
 		case 3:
 			/* Channel T1-T2. */
-			analog.meaning->channels = g_slist_append(NULL, g_slist_nth_data(sdi->channels, 2));
+			sr_analog_meaning_channel_set(analog.meaning, &ch_node,
+				g_slist_nth_data(sdi->channels, 2));
 			analog.meaning->mqflags |= SR_MQFLAG_RELATIVE;
 			break;
 		default:
@@ -141,7 +145,6 @@ static void process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 			packet.type = SR_DF_ANALOG;
 			packet.payload = &analog;
 			sr_session_send(sdi, &packet);
-			g_slist_free(analog.meaning->channels);
 		}
 	}
 
@@ -402,6 +402,7 @@ static int analog_channel_state_get(const struct sr_dev_inst *sdi,
 			ch = l->data;
 			if (ch->index == i) {
 				ch->enabled = state->analog_states[i].state;
+				sr_dev_channels_changed(sdi);
 				break;
 			}
 		}
@@ -484,6 +485,7 @@ static int digital_channel_state_get(const struct sr_dev_inst *sdi,
 			ch = l->data;
 			if (ch->index == i + DLM_DIG_CHAN_INDEX_OFFS) {
 				ch->enabled = state->digital_states[i];
+				sr_dev_channels_changed(sdi);
 				break;
 			}
 		}
@@ -538,6 +540,7 @@ SR_PRIV int dlm_channel_state_set(const struct sr_dev_inst *sdi,
 				}
 
 				ch->enabled = ch_state;
+				sr_dev_channels_changed(sdi);
 				state->analog_states[ch->index].state = ch_state;
 				chan_found = TRUE;
 				break;
@@ -553,6 +556,7 @@ SR_PRIV int dlm_channel_state_set(const struct sr_dev_inst *sdi,
 				}
 
 				ch->enabled = ch_state;
+				sr_dev_channels_changed(sdi);
 				state->digital_states[i] = ch_state;
 				chan_found = TRUE;
 
@@ -828,168 +832,199 @@ SR_PRIV int dlm_device_init(struct sr_dev_inst *sdi, int model_index)
 SR_PRIV int dlm_channel_data_request(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
-	struct sr_channel *ch;
 	int result;
 
 	devc = sdi->priv;
-	ch = devc->current_channel->data;
 
-	switch (ch->type) {
-	case SR_CHANNEL_ANALOG:
-		result = dlm_analog_data_get(sdi->conn, ch->index + 1);
-		break;
-	case SR_CHANNEL_LOGIC:
-		result = dlm_digital_data_get(sdi->conn);
-		break;
-	default:
-		sr_err("Invalid channel type encountered (%d).",
-				ch->type);
-		result = SR_ERR;
-	}
+	/*
+	 * Request the blocks of the current and all following enabled
+	 * channels in one program message. The scope answers with the
+	 * blocks back to back, no round trip is left between channels.
+	 */
+	result = dlm_channels_data_get(sdi->conn, devc->current_channel);
 
-	if (result == SR_OK)
+	if (result == SR_OK) {
 		devc->data_pending = TRUE;
-	else
+		devc->read_started = FALSE;
+		devc->blocks_pending = g_slist_length(devc->current_channel);
+		devc->block_state = BLOCK_SEEK;
+		devc->retry = FALSE;
+		if (devc->current_channel == devc->enabled_channels)
+			devc->frame_started = FALSE;
+	} else {
 		devc->data_pending = FALSE;
+	}
 
 	return result;
 }
 
 /**
- * Reads and removes the block data header from a given data input.
+ * Processes one character of a block data header, after its leading '#'.
  * Format is #ndddd... with n being the number of decimal digits d.
  * The string dddd... contains the decimal-encoded length of the data.
  * Example: #9000000013 would yield a length of 13 bytes.
  *
- * @param data The input data.
- * @param len The determined input data length.
+ * @param devc The device context, holds the header parser's state.
+ * @param c The header character.
  */
-static int dlm_block_data_header_process(GArray *data, int *len)
+static int dlm_block_data_header_process(struct dev_context *devc, char c)
 {
-	int i, n;
-	gchar s[20];
-
-	if (g_array_index(data, gchar, 0) != '#')
+	if (c < '0' || c > '9')
 		return SR_ERR;
 
-	n = (uint8_t)(g_array_index(data, gchar, 1) - '0');
-
-	for (i = 0; i < n; i++)
-		s[i] = g_array_index(data, gchar, 2 + i);
-	s[i] = 0;
-
-	if (sr_atoi(s, len) != SR_OK)
-		return SR_ERR;
+	if (devc->header_digits < 0) {
+		/* Blocks of indefinite length (#0) are not supported. */
+		devc->header_digits = c - '0';
+		if (!devc->header_digits)
+			return SR_ERR;
+		devc->block_remain = 0;
+		return SR_OK;
+	}
 
-	g_array_remove_range(data, 0, 2 + n);
+	devc->block_remain = devc->block_remain * 10 + (c - '0');
+	if (!--devc->header_digits) {
+		devc->block_state = BLOCK_DATA;
+		devc->block_samples = 0;
+	}
 
 	return SR_OK;
 }
 
 /**
- * Turns raw sample data into voltages and sends them off to the session bus.
+ * Sends raw sample data off to the session bus, the encoding describes
+ * the conversion to voltages.
  *
  * @param data The raw sample data.
+ * @param len The number of samples.
  * @ch_state Pointer to the state of the channel whose data we're processing.
  * @sdi The device instance.
- *
- * @return SR_ERR when data is trucated, SR_OK otherwise.
  */
-static int dlm_analog_samples_send(GArray *data,
+static void dlm_analog_samples_send(const uint8_t *data, size_t len,
 		struct analog_channel_state *ch_state,
 		struct sr_dev_inst *sdi)
 {
-	uint32_t i, samples;
-	float voltage, range, offset;
-	GArray *float_data;
 	struct dev_context *devc;
-	struct scope_state *model_state;
 	struct sr_channel *ch;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
+	GSList ch_node;
 	struct sr_analog_spec spec;
 	struct sr_datafeed_packet packet;
 
 	devc = sdi->priv;
-	model_state = devc->model_state;
-	samples = model_state->samples_per_frame;
 	ch = devc->current_channel->data;
 
-	if (data->len < samples * sizeof(uint8_t)) {
-		sr_err("Truncated waveform data packet received.");
-		return SR_ERR;
-	}
-
-	range = ch_state->waveform_range;
-	offset = ch_state->waveform_offset;
+	/* TODO: Use proper 'digits' value for this device (and its modes). */
+	sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
 
 	/*
 	 * Convert byte sample to voltage according to
 	 * page 269 of the Communication Interface User's Manual.
 	 */
-	float_data = g_array_new(FALSE, FALSE, sizeof(float));
-	for (i = 0; i < samples; i++) {
-		voltage = (float)g_array_index(data, int8_t, i);
-		voltage = (range * voltage /
-				DLM_DIVISION_FOR_BYTE_FORMAT) + offset;
-		g_array_append_val(float_data, voltage);
-	}
-
-	/* TODO: Use proper 'digits' value for this device (and its modes). */
-	sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
-	analog.meaning->channels = g_slist_append(NULL, ch);
-	analog.num_samples = float_data->len;
-	analog.data = (float*)float_data->data;
+	encoding.unitsize = sizeof(int8_t);
+	encoding.is_signed = TRUE;
+	encoding.is_float = FALSE;
+	encoding.is_bigendian = FALSE;
+	sr_rational_from_double(&encoding.scale,
+		ch_state->waveform_range / DLM_DIVISION_FOR_BYTE_FORMAT);
+	sr_rational_from_double(&encoding.offset, ch_state->waveform_offset);
+
+	sr_analog_meaning_channel_set(analog.meaning, &ch_node, ch);
+	analog.num_samples = len;
+	analog.data = (void *)data;
 	analog.meaning->mq = SR_MQ_VOLTAGE;
 	analog.meaning->unit = SR_UNIT_VOLT;
 	analog.meaning->mqflags = 0;
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &analog;
 	sr_session_send(sdi, &packet);
-	g_slist_free(analog.meaning->channels);
-
-	g_array_free(float_data, TRUE);
-	g_array_remove_range(data, 0, samples * sizeof(uint8_t));
-
-	return SR_OK;
 }
 
 /**
  * Sends logic sample data off to the session bus.
  *
  * @param data The raw sample data.
- * @ch_state Pointer to the state of the channel whose data we're processing.
+ * @param len The number of samples.
  * @sdi The device instance.
- *
- * @return SR_ERR when data is trucated, SR_OK otherwise.
  */
-static int dlm_digital_samples_send(GArray *data,
+static void dlm_digital_samples_send(const uint8_t *data, size_t len,
 		struct sr_dev_inst *sdi)
+{
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_packet packet;
+
+	logic.length = len;
+	logic.unitsize = 1;
+	logic.data = (void *)data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	sr_session_send(sdi, &packet);
+}
+
+/*
+ * Send a piece of the current block's data as it was received. Bytes
+ * beyond the frame's sample count get dropped.
+ */
+static void dlm_block_data_process(struct sr_dev_inst *sdi,
+		const uint8_t *data, size_t len)
 {
 	struct dev_context *devc;
 	struct scope_state *model_state;
+	struct sr_channel *ch;
 	uint32_t samples;
-	struct sr_datafeed_logic logic;
-	struct sr_datafeed_packet packet;
 
 	devc = sdi->priv;
 	model_state = devc->model_state;
+	ch = devc->current_channel->data;
+
 	samples = model_state->samples_per_frame;
+	samples -= MIN(samples, devc->block_samples);
+	len = MIN(len, samples);
+	if (!len)
+		return;
+
+	/* Signal the beginning of a new frame with its first data. */
+	if (!devc->frame_started) {
+		std_session_send_df_frame_begin(sdi);
+		devc->frame_started = TRUE;
+	}
+
+	switch (ch->type) {
+	case SR_CHANNEL_ANALOG:
+		dlm_analog_samples_send(data, len,
+			&model_state->analog_states[ch->index], sdi);
+		break;
+	case SR_CHANNEL_LOGIC:
+		dlm_digital_samples_send(data, len, sdi);
+		break;
+	default:
+		sr_err("Invalid channel type encountered.");
+		break;
+	}
+	devc->block_samples += len;
+}
+
+/* Finish the current block, the next block belongs to the next channel. */
+static int dlm_block_end(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct scope_state *model_state;
 
-	if (data->len < samples * sizeof(uint8_t)) {
+	devc = sdi->priv;
+	model_state = devc->model_state;
+
+	if (!devc->block_samples) {
+		devc->retry = TRUE;
+	} else if (devc->block_samples < model_state->samples_per_frame) {
 		sr_err("Truncated waveform data packet received.");
 		return SR_ERR;
 	}
 
-	logic.length = samples;
-	logic.unitsize = 1;
-	logic.data = data->data;
-	packet.type = SR_DF_LOGIC;
-	packet.payload = &logic;
-	sr_session_send(sdi, &packet);
-
-	g_array_remove_range(data, 0, samples * sizeof(uint8_t));
+	devc->blocks_pending--;
+	devc->block_state = BLOCK_SEEK;
+	if (devc->current_channel->next)
+		devc->current_channel = devc->current_channel->next;
 
 	return SR_OK;
 }
@@ -998,6 +1033,9 @@ static int dlm_digital_samples_send(GArray *data,
  * Attempts to query sample data from the oscilloscope in order to send it
  * to the session bus for further processing.
  *
+ * The blocks of all requested channels get parsed as they arrive, and
+ * their samples get sent right from the receive buffer.
+ *
  * @param fd The file descriptor used as the event source.
  * @param revents The received events.
  * @param cb_data Callback data, in this case our device instance.
@@ -1010,9 +1048,9 @@ SR_PRIV int dlm_data_receive(int fd, int revents, void *cb_data)
 	struct sr_dev_inst *sdi;
 	struct scope_state *model_state;
 	struct dev_context *devc;
-	struct sr_channel *ch;
-	int chunk_len, num_bytes;
-	static GArray *data = NULL;
+	const uint8_t *p, *end;
+	uint64_t len;
+	int chunk_len;
 
 	(void)fd;
 	(void)revents;
@@ -1031,100 +1069,84 @@ SR_PRIV int dlm_data_receive(int fd, int revents, void *cb_data)
 		return TRUE;
 
 	/* Check if a new query response is coming our way. */
-	if (!data) {
-		if (sr_scpi_read_begin(sdi->conn) == SR_OK)
-			/* The 16 here accounts for the header and EOL. */
-			data = g_array_sized_new(FALSE, FALSE, sizeof(uint8_t),
-					16 + model_state->samples_per_frame);
-		else
+	if (!devc->read_started) {
+		if (sr_scpi_read_begin(sdi->conn) != SR_OK)
 			return TRUE;
+		devc->read_started = TRUE;
 	}
 
-	/* Store incoming data. */
 	chunk_len = sr_scpi_read_data(sdi->conn, devc->receive_buffer,
 			RECEIVE_BUFFER_SIZE);
 	if (chunk_len < 0) {
 		sr_err("Error while reading data: %d", chunk_len);
-		goto fail;
+		return FALSE;
 	}
-	g_array_append_vals(data, devc->receive_buffer, chunk_len);
 
-	/* Read the entire query response before processing. */
-	if (!sr_scpi_read_complete(sdi->conn))
+	p = (const uint8_t *)devc->receive_buffer;
+	end = p + chunk_len;
+	while (p < end) {
+		switch (devc->block_state) {
+		case BLOCK_SEEK:
+			/* Skip separators and the response's terminator. */
+			if (devc->blocks_pending && *p == '#') {
+				devc->block_state = BLOCK_HEADER;
+				devc->header_digits = -1;
+			}
+			p++;
+			break;
+		case BLOCK_HEADER:
+			if (dlm_block_data_header_process(devc, *p++) != SR_OK) {
+				sr_err("Encountered malformed block data header.");
+				return FALSE;
+			}
+			if (devc->block_state == BLOCK_DATA && !devc->block_remain) {
+				if (dlm_block_end(sdi) != SR_OK)
+					return FALSE;
+			}
+			break;
+		case BLOCK_DATA:
+			len = MIN((uint64_t)(end - p), devc->block_remain);
+			dlm_block_data_process(sdi, p, len);
+			p += len;
+			devc->block_remain -= len;
+			if (!devc->block_remain && dlm_block_end(sdi) != SR_OK)
+				return FALSE;
+			break;
+		}
+	}
+
+	/* Read the entire query response before continuing. */
+	if (devc->blocks_pending || !sr_scpi_read_complete(sdi->conn))
 		return TRUE;
 
 	/* We finished reading and are no longer waiting for data. */
 	devc->data_pending = FALSE;
+	devc->read_started = FALSE;
 
-	/* Signal the beginning of a new frame if this is the first channel. */
-	if (devc->current_channel == devc->enabled_channels)
-		std_session_send_df_frame_begin(sdi);
-
-	if (dlm_block_data_header_process(data, &num_bytes) != SR_OK) {
-		sr_err("Encountered malformed block data header.");
-		goto fail;
+	if (devc->frame_started) {
+		std_session_send_df_frame_end(sdi);
+		devc->frame_started = FALSE;
 	}
+	devc->current_channel = devc->enabled_channels;
 
-	if (num_bytes == 0) {
+	if (devc->retry) {
 		sr_warn("Zero-length waveform data packet received. " \
 				"Live mode not supported yet, stopping " \
 				"acquisition and retrying.");
 		/* Don't care about return value here. */
 		dlm_acquisition_stop(sdi->conn);
-		g_array_free(data, TRUE);
-		dlm_channel_data_request(sdi);
+		if (dlm_channel_data_request(sdi) != SR_OK) {
+			sr_err("Failed to request acquisition data.");
+			return FALSE;
+		}
 		return TRUE;
 	}
 
-	ch = devc->current_channel->data;
-	switch (ch->type) {
-	case SR_CHANNEL_ANALOG:
-		if (dlm_analog_samples_send(data,
-				&model_state->analog_states[ch->index],
-				sdi) != SR_OK)
-			goto fail;
-		break;
-	case SR_CHANNEL_LOGIC:
-		if (dlm_digital_samples_send(data, sdi) != SR_OK)
-			goto fail;
-		break;
-	default:
-		sr_err("Invalid channel type encountered.");
-		break;
-	}
-
-	g_array_free(data, TRUE);
-	data = NULL;
-
 	/*
-	 * Signal the end of this frame if this was the last enabled channel
-	 * and set the next enabled channel. Then, request its data.
+	 * As of now we only support importing the current acquisition
+	 * data so we're going to stop at this point.
 	 */
-	if (!devc->current_channel->next) {
-		std_session_send_df_frame_end(sdi);
-		devc->current_channel = devc->enabled_channels;
-
-		/*
-		 * As of now we only support importing the current acquisition
-		 * data so we're going to stop at this point.
-		 */
-		sr_dev_acquisition_stop(sdi);
-		return TRUE;
-	} else
-		devc->current_channel = devc->current_channel->next;
-
-	if (dlm_channel_data_request(sdi) != SR_OK) {
-		sr_err("Failed to request acquisition data.");
-		goto fail;
-	}
+	sr_dev_acquisition_stop(sdi);
 
 	return TRUE;
-
-fail:
-	if (data) {
-		g_array_free(data, TRUE);
-		data = NULL;
-	}
-
-	return FALSE;
 }
@@ -53,6 +53,13 @@ extern const char *dlm_trigger_slopes[2];
 extern const uint64_t dlm_timebases[36][2];
 extern const uint64_t dlm_vdivs[17][2];
 
+/* Reception state of the waveform blocks, see dlm_data_receive(). */
+enum block_state {
+	BLOCK_SEEK,
+	BLOCK_HEADER,
+	BLOCK_DATA,
+};
+
 struct scope_config {
 	const char *model_id[MAX_INSTRUMENT_VERSIONS];
 	const char *model_name[MAX_INSTRUMENT_VERSIONS];
@@ -111,6 +118,16 @@ struct dev_context {
 
 	char receive_buffer[RECEIVE_BUFFER_SIZE];
 	gboolean data_pending;
+	gboolean read_started;
+
+	/* Streamed reception of the requested channels' blocks. */
+	size_t blocks_pending;
+	enum block_state block_state;
+	int header_digits;
+	uint64_t block_remain;
+	uint32_t block_samples;
+	gboolean frame_started;
+	gboolean retry;
 };
 
 SR_PRIV int dlm_channel_state_set(const struct sr_dev_inst *sdi,
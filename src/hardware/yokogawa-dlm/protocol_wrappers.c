@@ -326,9 +326,11 @@ int dlm_data_get(struct sr_scpi_dev_inst *scpi, int acquisition_num)
 	return sr_scpi_send(scpi, cmd);
 }
 
-int dlm_analog_data_get(struct sr_scpi_dev_inst *scpi, int channel)
+int dlm_channels_data_get(struct sr_scpi_dev_inst *scpi, const GSList *channels)
 {
-	gchar cmd[MAX_COMMAND_SIZE];
+	const GSList *l;
+	struct sr_channel *ch;
+	GString *cmd;
 	int result;
 
 	result = sr_scpi_send(scpi, ":WAVEFORM:FORMAT BYTE");
@@ -336,24 +338,19 @@ int dlm_analog_data_get(struct sr_scpi_dev_inst *scpi, int channel)
 	if (result == SR_OK) result = sr_scpi_send(scpi, ":WAVEFORM:START 0");
 	if (result == SR_OK) result = sr_scpi_send(scpi, ":WAVEFORM:END 124999999");
 
-	g_snprintf(cmd, sizeof(cmd), ":WAVEFORM:TRACE %d", channel);
-	if (result == SR_OK) result = sr_scpi_send(scpi, cmd);
-
-	if (result == SR_OK) result = sr_scpi_send(scpi, ":WAVEFORM:SEND? 1");
-
-	return result;
-}
-
-int dlm_digital_data_get(struct sr_scpi_dev_inst *scpi)
-{
-	int result;
-
-	result = sr_scpi_send(scpi, ":WAVEFORM:FORMAT BYTE");
-	if (result == SR_OK) result = sr_scpi_send(scpi, ":WAVEFORM:RECORD 0");
-	if (result == SR_OK) result = sr_scpi_send(scpi, ":WAVEFORM:START 0");
-	if (result == SR_OK) result = sr_scpi_send(scpi, ":WAVEFORM:END 124999999");
-	if (result == SR_OK) result = sr_scpi_send(scpi, ":WAVEFORM:TRACE LOGIC");
-	if (result == SR_OK) result = sr_scpi_send(scpi, ":WAVEFORM:SEND? 1");
+	/* One query per channel, their responses get concatenated. */
+	cmd = g_string_new(":WAVEFORM:");
+	for (l = channels; l; l = l->next) {
+		ch = l->data;
+		if (l != channels)
+			g_string_append_c(cmd, ';');
+		if (ch->type == SR_CHANNEL_LOGIC)
+			g_string_append(cmd, "TRACE LOGIC;SEND? 1");
+		else
+			g_string_append_printf(cmd, "TRACE %d;SEND? 1", ch->index + 1);
+	}
+	if (result == SR_OK) result = sr_scpi_send(scpi, "%s", cmd->str);
+	g_string_free(cmd, TRUE);
 
 	return result;
 }
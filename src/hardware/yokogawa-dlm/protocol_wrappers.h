@@ -85,7 +85,7 @@ extern int dlm_chunks_per_acq_get(struct sr_scpi_dev_inst *scpi,
 		int *response);
 extern int dlm_start_frame_set(struct sr_scpi_dev_inst *scpi, int value);
 extern int dlm_data_get(struct sr_scpi_dev_inst *scpi, int acquisition_num);
-extern int dlm_analog_data_get(struct sr_scpi_dev_inst *scpi, int channel);
-extern int dlm_digital_data_get(struct sr_scpi_dev_inst *scpi);
+extern int dlm_channels_data_get(struct sr_scpi_dev_inst *scpi,
+		const GSList *channels);
 
 #endif
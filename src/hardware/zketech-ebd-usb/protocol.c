@@ -253,10 +253,11 @@ static void ebd_send_value(const struct sr_dev_inst *sdi, struct sr_channel *ch,
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
+	GSList ch_node;
 	struct sr_analog_spec spec;
 
 	sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
-	analog.meaning->channels = g_slist_append(NULL, ch);
+	sr_analog_meaning_channel_set(analog.meaning, &ch_node, ch);
 	analog.num_samples = 1;
 	analog.data = &value;
 	analog.meaning->mq = mq;
@@ -266,7 +267,6 @@ static void ebd_send_value(const struct sr_dev_inst *sdi, struct sr_channel *ch,
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &analog;
 	sr_session_send(sdi, &packet);
-	g_slist_free(analog.meaning->channels);
 }
 
 SR_PRIV int ebd_receive_data(int fd, int revents, void *cb_data)
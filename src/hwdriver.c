@@ -230,6 +230,16 @@ static struct sr_key_info sr_key_info_config[] = {
 		"Probe factor", NULL},
 	{SR_CONF_ADC_POWERLINE_CYCLES, SR_T_FLOAT, "nplc",
 		"Number of ADC powerline cycles", NULL},
+	{SR_CONF_CAPTURE_OFFSET, SR_T_UINT64, "capture_offset",
+		"Capture offset", NULL},
+	{SR_CONF_USB_TRANSFER_SIZE, SR_T_UINT64, "usb_transfer_size",
+		"USB transfer size", NULL},
+	{SR_CONF_USB_QUEUE_DEPTH, SR_T_UINT64, "usb_queue_depth",
+		"USB queue depth", NULL},
+	{SR_CONF_USB_UNDERRUNS, SR_T_UINT64, "usb_underruns",
+		"USB underruns", NULL},
+	{SR_CONF_USB_OVERRUNS, SR_T_UINT64, "usb_overruns",
+		"USB overruns", NULL},
 
 	/* Acquisition modes, sample limiting */
 	{SR_CONF_LIMIT_MSEC, SR_T_UINT64, "limit_time",
@@ -393,9 +403,17 @@ SR_PRIV int sr_variant_type_check(uint32_t key, GVariant *value)
  */
 SR_API struct sr_dev_driver **sr_driver_list(const struct sr_context *ctx)
 {
+	struct sr_context *context;
+
 	if (!ctx)
 		return NULL;
 
+	context = (struct sr_context *)ctx;
+	if (g_once_init_enter(&context->driver_list_state)) {
+		sr_drivers_init(context);
+		g_once_init_leave(&context->driver_list_state, 1);
+	}
+
 	return ctx->driver_list;
 }
 
@@ -434,6 +452,11 @@ SR_API int sr_driver_init(struct sr_context *ctx, struct sr_dev_driver *driver)
 
 	/* No log message here, too verbose and not very useful. */
 
+	if (sr_context_hw_init(ctx) != SR_OK) {
+		sr_err("Hardware access is not available, can't initialize.");
+		return SR_ERR;
+	}
+
 	if ((ret = driver->init(driver, ctx)) < 0)
 		sr_err("Failed to initialize the driver: %d.", ret);
 
@@ -565,6 +588,7 @@ SR_API GSList *sr_driver_scan(struct sr_dev_driver *driver, GSList *options)
 			return NULL;
 	}
 
+	sr_driver_scan_wait(driver);
 	l = driver->scan(driver, options);
 
 	sr_spew("Scan found %d devices (%s).", g_slist_length(l), driver->name);
@@ -572,6 +596,439 @@ SR_API GSList *sr_driver_scan(struct sr_dev_driver *driver, GSList *options)
 	return l;
 }
 
+/* The number of sr_driver_scan_all() probes which run at the same time. */
+#define SCAN_PROBE_THREADS 16
+
+enum scan_probe_state {
+	SCAN_PROBE_PENDING,
+	SCAN_PROBE_RUNNING,
+	SCAN_PROBE_DONE,
+	SCAN_PROBE_ABANDONED,
+	SCAN_PROBE_FINISHED,
+};
+
+/* A scan of one driver, in a thread of its own. */
+struct scan_probe {
+	struct sr_context *ctx;
+	struct sr_dev_driver *driver;
+	GSList *options;
+	char *conn;
+	int state;
+	int64_t deadline;
+	GSList *devices;
+};
+
+static void scan_probe_free(struct scan_probe *probe)
+{
+	g_slist_free_full(probe->options, (GDestroyNotify)sr_config_free);
+	g_slist_free(probe->devices);
+	g_free(probe->conn);
+	g_free(probe);
+}
+
+/* A scan which was given up on has returned. Caller holds scan_mutex. */
+static void scan_late_done(struct sr_context *ctx,
+		const struct sr_dev_driver *driver)
+{
+	int count;
+
+	count = GPOINTER_TO_INT(g_hash_table_lookup(ctx->scan_late, driver));
+	if (count > 1)
+		g_hash_table_insert(ctx->scan_late, (void *)driver,
+			GINT_TO_POINTER(count - 1));
+	else
+		g_hash_table_remove(ctx->scan_late, driver);
+}
+
+static gpointer scan_probe_thread(gpointer data)
+{
+	struct scan_probe *probe;
+	struct sr_context *ctx;
+	GSList *devices;
+
+	probe = data;
+	ctx = probe->ctx;
+
+	/* Keep the lists for a scan which outlives sr_driver_scan_all(). */
+#ifdef HAVE_LIBUSB_1_0
+	sr_usb_devlist_cache_begin(ctx->libusb_ctx);
+#endif
+#ifdef HAVE_SERIAL_COMM
+	sr_serial_list_cache_begin();
+#endif
+	devices = sr_driver_scan(probe->driver, probe->options);
+#ifdef HAVE_SERIAL_COMM
+	sr_serial_list_cache_end();
+#endif
+#ifdef HAVE_LIBUSB_1_0
+	sr_usb_devlist_cache_end(ctx->libusb_ctx);
+#endif
+
+	g_mutex_lock(&ctx->scan_mutex);
+	if (probe->state == SCAN_PROBE_ABANDONED) {
+		/* Late devices remain in the driver's instance list. */
+		sr_info("Late scan of %s found %d devices.",
+			probe->driver->name, g_slist_length(devices));
+		g_slist_free(devices);
+		scan_late_done(ctx, probe->driver);
+		scan_probe_free(probe);
+	} else {
+		probe->devices = devices;
+		probe->state = SCAN_PROBE_DONE;
+	}
+	ctx->scan_threads--;
+	g_cond_broadcast(&ctx->scan_cond);
+	g_mutex_unlock(&ctx->scan_mutex);
+
+	return NULL;
+}
+
+static gboolean scan_options_supported(const struct sr_dev_driver *driver,
+		GSList *options)
+{
+	struct sr_config *src;
+	GArray *opts;
+	GSList *l;
+	guint i;
+
+	if (!options)
+		return TRUE;
+	if (!(opts = sr_driver_scan_options_list(driver)))
+		return FALSE;
+
+	for (l = options; l; l = l->next) {
+		src = l->data;
+		for (i = 0; i < opts->len; i++) {
+			if (g_array_index(opts, uint32_t, i) == src->key)
+				break;
+		}
+		if (i == opts->len)
+			break;
+	}
+	g_array_free(opts, TRUE);
+
+	return !l;
+}
+
+static char *scan_cache_key(const struct scan_probe *probe)
+{
+	return g_strdup_printf("%s\n%s", probe->driver->name, probe->conn);
+}
+
+static gboolean scan_conn_busy(GPtrArray *probes, const char *conn)
+{
+	struct scan_probe *probe;
+	guint i;
+
+	for (i = 0; i < probes->len; i++) {
+		probe = probes->pdata[i];
+		if (probe && probe->state == SCAN_PROBE_RUNNING &&
+				!g_strcmp0(probe->conn, conn))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Start the pending probes which can run now. Caller holds scan_mutex. */
+static gboolean scan_probes_start(struct sr_context *ctx, GPtrArray *probes,
+		unsigned int *running, GHashTable *hung, int timeout_ms)
+{
+	struct scan_probe *probe;
+	GThread *thread;
+	gboolean pending;
+	char *key;
+	guint i;
+
+	pending = FALSE;
+	for (i = 0; i < probes->len; i++) {
+		probe = probes->pdata[i];
+		if (!probe || probe->state != SCAN_PROBE_PENDING)
+			continue;
+		if (probe->conn && g_hash_table_lookup(hung, probe->conn)) {
+			sr_dbg("Not scanning %s, %s is unresponsive.",
+				probe->driver->name, probe->conn);
+			probe->state = SCAN_PROBE_FINISHED;
+			continue;
+		}
+		if (probe->conn && ctx->scan_negative) {
+			key = scan_cache_key(probe);
+			if (g_hash_table_lookup(ctx->scan_negative, key)) {
+				sr_spew("Not scanning %s on %s, found nothing before.",
+					probe->driver->name, probe->conn);
+				probe->state = SCAN_PROBE_FINISHED;
+			}
+			g_free(key);
+			if (probe->state == SCAN_PROBE_FINISHED)
+				continue;
+		}
+		/* Probes of the same connection run one after another. */
+		if (*running >= SCAN_PROBE_THREADS ||
+				(probe->conn && scan_conn_busy(probes, probe->conn))) {
+			pending = TRUE;
+			continue;
+		}
+
+		probe->state = SCAN_PROBE_RUNNING;
+		probe->deadline = g_get_monotonic_time() +
+			(int64_t)timeout_ms * 1000;
+		thread = g_thread_try_new("sr-scan", scan_probe_thread, probe, NULL);
+		if (!thread) {
+			sr_err("Cannot start the scan of %s.", probe->driver->name);
+			probe->state = SCAN_PROBE_FINISHED;
+			continue;
+		}
+		g_thread_unref(thread);
+		ctx->scan_threads++;
+		(*running)++;
+	}
+
+	return pending;
+}
+
+/**
+ * Tell several hardware drivers to scan for devices, at the same time.
+ *
+ * Every driver gets scanned in a thread of its own, like sr_driver_scan()
+ * does. The drivers share one enumeration of the USB devices and of the
+ * serial ports. Drivers only get the options if they support all of
+ * them, others get skipped. When the options specify a connection,
+ * the drivers probe it one after another.
+ *
+ * A scan which takes longer than the timeout is given up on. Its
+ * connection is not probed by the remaining drivers, the devices which
+ * the driver finds later are not returned. Until such a scan finishes,
+ * sr_driver_scan(), sr_dev_list() and sr_dev_clear() of its driver wait
+ * for it, as does sr_exit().
+ *
+ * @param ctx The libsigrok context. Must not be NULL.
+ * @param drivers The NULL terminated list of drivers which should scan,
+ *                from sr_driver_list(). NULL selects all drivers. They
+ *                must have been initialized with sr_driver_init(),
+ *                others get skipped.
+ * @param options A list of 'struct sr_config' options to pass to the
+ *                drivers' scanners. Can be NULL/empty.
+ * @param timeout_ms The time allowed per driver in milliseconds. Zero or
+ *                   negative values wait for all of them.
+ * @param flags Flags from enum sr_scan_flag.
+ *
+ * @return A GSList * of 'struct sr_dev_inst', in the order of the drivers,
+ *         or NULL if no devices were found. This list must be freed by the
+ *         caller using g_slist_free(), but without freeing the data
+ *         pointed to in the list.
+ *
+ * @since 0.6.0
+ */
+SR_API GSList *sr_driver_scan_all(struct sr_context *ctx,
+		struct sr_dev_driver **drivers, GSList *options,
+		int timeout_ms, int flags)
+{
+	struct sr_config *src;
+	struct scan_probe *probe;
+	GPtrArray *probes;
+	GHashTable *hung;
+	GSList *devices, *l;
+	const char *conn;
+	int64_t now, wakeup;
+	unsigned int running;
+	gboolean pending;
+	guint i;
+
+	if (!ctx) {
+		sr_err("Invalid context, can't scan for devices.");
+		return NULL;
+	}
+	if (!drivers)
+		drivers = sr_driver_list(ctx);
+
+	conn = NULL;
+	for (l = options; l; l = l->next) {
+		src = l->data;
+		if (src->key == SR_CONF_CONN &&
+				g_variant_is_of_type(src->data, G_VARIANT_TYPE_STRING))
+			conn = g_variant_get_string(src->data, NULL);
+	}
+
+	probes = g_ptr_array_new();
+	for (i = 0; drivers[i]; i++) {
+		if (!drivers[i]->context) {
+			sr_dbg("Driver %s not initialized, not scanning it.",
+				drivers[i]->name);
+			continue;
+		}
+		if (!scan_options_supported(drivers[i], options))
+			continue;
+		probe = g_malloc0(sizeof(*probe));
+		probe->ctx = ctx;
+		probe->driver = drivers[i];
+		for (l = options; l; l = l->next) {
+			src = l->data;
+			probe->options = g_slist_append(probe->options,
+				sr_config_new(src->key, src->data));
+		}
+		probe->conn = g_strdup(conn);
+		g_ptr_array_add(probes, probe);
+	}
+	hung = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+#ifdef HAVE_LIBUSB_1_0
+	sr_usb_devlist_cache_begin(ctx->libusb_ctx);
+#endif
+#ifdef HAVE_SERIAL_COMM
+	sr_serial_list_cache_begin();
+#endif
+
+	g_mutex_lock(&ctx->scan_mutex);
+	if ((flags & SR_SCAN_CACHE_NEGATIVE) && !ctx->scan_negative) {
+		ctx->scan_negative = g_hash_table_new_full(g_str_hash,
+			g_str_equal, g_free, NULL);
+	}
+	if (!ctx->scan_late)
+		ctx->scan_late = g_hash_table_new(g_direct_hash, g_direct_equal);
+	running = 0;
+	for (;;) {
+		/* Collect finished probes, give up on the late ones. */
+		now = g_get_monotonic_time();
+		wakeup = G_MAXINT64;
+		for (i = 0; i < probes->len; i++) {
+			probe = probes->pdata[i];
+			if (!probe)
+				continue;
+			if (probe->state == SCAN_PROBE_DONE) {
+				probe->state = SCAN_PROBE_FINISHED;
+				running--;
+				if (!probe->devices && probe->conn &&
+						(flags & SR_SCAN_CACHE_NEGATIVE)) {
+					g_hash_table_insert(ctx->scan_negative,
+						scan_cache_key(probe), GINT_TO_POINTER(1));
+				}
+			} else if (probe->state == SCAN_PROBE_RUNNING &&
+					timeout_ms > 0 && now >= probe->deadline) {
+				sr_warn("Scan of %s takes longer than %d ms, "
+					"giving up on it.", probe->driver->name,
+					timeout_ms);
+				if (probe->conn) {
+					g_hash_table_insert(hung,
+						g_strdup(probe->conn), GINT_TO_POINTER(1));
+				}
+				/* The thread frees the probe when it returns. */
+				probe->state = SCAN_PROBE_ABANDONED;
+				g_hash_table_insert(ctx->scan_late, probe->driver,
+					GINT_TO_POINTER(GPOINTER_TO_INT(
+					g_hash_table_lookup(ctx->scan_late,
+					probe->driver)) + 1));
+				probes->pdata[i] = NULL;
+				running--;
+			}
+		}
+
+		pending = scan_probes_start(ctx, probes, &running,
+			hung, timeout_ms);
+		if (!running && !pending)
+			break;
+
+		if (timeout_ms <= 0) {
+			g_cond_wait(&ctx->scan_cond, &ctx->scan_mutex);
+			continue;
+		}
+		for (i = 0; i < probes->len; i++) {
+			probe = probes->pdata[i];
+			if (probe && probe->state == SCAN_PROBE_RUNNING)
+				wakeup = MIN(wakeup, probe->deadline);
+		}
+		g_cond_wait_until(&ctx->scan_cond, &ctx->scan_mutex, wakeup);
+	}
+	g_mutex_unlock(&ctx->scan_mutex);
+
+#ifdef HAVE_SERIAL_COMM
+	sr_serial_list_cache_end();
+#endif
+#ifdef HAVE_LIBUSB_1_0
+	sr_usb_devlist_cache_end(ctx->libusb_ctx);
+#endif
+
+	devices = NULL;
+	for (i = 0; i < probes->len; i++) {
+		if (!(probe = probes->pdata[i]))
+			continue;
+		devices = g_slist_concat(devices, probe->devices);
+		probe->devices = NULL;
+		scan_probe_free(probe);
+	}
+	g_ptr_array_free(probes, TRUE);
+	g_hash_table_destroy(hung);
+
+	sr_dbg("Scan of all drivers found %d devices.", g_slist_length(devices));
+
+	return devices;
+}
+
+/**
+ * Forget the negative results of earlier sr_driver_scan_all() calls.
+ *
+ * @param ctx The libsigrok context. Must not be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_driver_scan_cache_clear(struct sr_context *ctx)
+{
+	if (!ctx)
+		return;
+
+	g_mutex_lock(&ctx->scan_mutex);
+	if (ctx->scan_negative)
+		g_hash_table_remove_all(ctx->scan_negative);
+	g_mutex_unlock(&ctx->scan_mutex);
+}
+
+/**
+ * Wait for the scans of a driver which sr_driver_scan_all() gave up on.
+ *
+ * Such scans still add devices to the driver's instance list, which
+ * must not be used meanwhile.
+ *
+ * @private
+ */
+SR_PRIV void sr_driver_scan_wait(const struct sr_dev_driver *driver)
+{
+	struct drv_context *drvc;
+	struct sr_context *ctx;
+
+	if (!driver || !(drvc = driver->context))
+		return;
+	ctx = drvc->sr_ctx;
+
+	g_mutex_lock(&ctx->scan_mutex);
+	while (ctx->scan_late && g_hash_table_contains(ctx->scan_late, driver))
+		g_cond_wait(&ctx->scan_cond, &ctx->scan_mutex);
+	g_mutex_unlock(&ctx->scan_mutex);
+}
+
+/**
+ * Wait for the scans which sr_driver_scan_all() gave up on, and release
+ * the scan cache.
+ *
+ * @private
+ */
+SR_PRIV void sr_driver_scan_cleanup(struct sr_context *ctx)
+{
+	g_mutex_lock(&ctx->scan_mutex);
+	if (ctx->scan_threads)
+		sr_info("Waiting for %d driver scans.", ctx->scan_threads);
+	while (ctx->scan_threads)
+		g_cond_wait(&ctx->scan_cond, &ctx->scan_mutex);
+	g_mutex_unlock(&ctx->scan_mutex);
+
+	if (ctx->scan_negative)
+		g_hash_table_destroy(ctx->scan_negative);
+	ctx->scan_negative = NULL;
+	if (ctx->scan_late)
+		g_hash_table_destroy(ctx->scan_late);
+	ctx->scan_late = NULL;
+	g_mutex_clear(&ctx->scan_mutex);
+	g_cond_clear(&ctx->scan_cond);
+}
+
 /**
  * Call driver cleanup function for all drivers.
  *
@@ -587,9 +1044,13 @@ SR_PRIV void sr_hw_cleanup_all(const struct sr_context *ctx)
 	if (!ctx)
 		return;
 
+	/* Nothing to clean up when the driver list was never used. */
+	if (!ctx->driver_list)
+		return;
+
 	sr_dbg("Cleaning up all drivers.");
 
-	drivers = sr_driver_list(ctx);
+	drivers = ctx->driver_list;
 	for (i = 0; drivers[i]; i++) {
 		if (drivers[i]->cleanup)
 			drivers[i]->cleanup(drivers[i]);
@@ -640,6 +1101,8 @@ SR_PRIV void sr_config_free(struct sr_config *src)
 /** @private */
 SR_PRIV int sr_dev_acquisition_start(struct sr_dev_inst *sdi)
 {
+	int ret, tag;
+
 	if (!sdi || !sdi->driver) {
 		sr_err("%s: Invalid arguments.", __func__);
 		return SR_ERR_ARG;
@@ -652,8 +1115,13 @@ SR_PRIV int sr_dev_acquisition_start(struct sr_dev_inst *sdi)
 	}
 
 	sr_dbg("%s: Starting acquisition.", sdi->driver->name);
+	sr_config_cache_invalidate(sdi);
+
+	tag = sr_mem_tag_enter(SR_MEM_DRIVER);
+	ret = sdi->driver->dev_acquisition_start(sdi);
+	sr_mem_tag_leave(tag);
 
-	return sdi->driver->dev_acquisition_start(sdi);
+	return ret;
 }
 
 /** @private */
@@ -671,10 +1139,90 @@ SR_PRIV int sr_dev_acquisition_stop(struct sr_dev_inst *sdi)
 	}
 
 	sr_dbg("%s: Stopping acquisition.", sdi->driver->name);
+	sr_config_cache_invalidate(sdi);
 
 	return sdi->driver->dev_acquisition_stop(sdi);
 }
 
+/*
+ * Config cache of a device instance. Lists are always cached, values
+ * only when the application enabled it with sr_config_cache_enable().
+ * The entries are immutable GVariants, callers get a new reference.
+ */
+struct config_cache_key {
+	const struct sr_channel_group *cg;
+	uint32_t key;
+	unsigned int op;
+};
+
+static guint config_cache_hash(gconstpointer p)
+{
+	const struct config_cache_key *k = p;
+
+	return g_direct_hash(k->cg) ^ (k->key * 31) ^ k->op;
+}
+
+static gboolean config_cache_equal(gconstpointer a, gconstpointer b)
+{
+	const struct config_cache_key *ka = a, *kb = b;
+
+	return ka->cg == kb->cg && ka->key == kb->key && ka->op == kb->op;
+}
+
+static GVariant *config_cache_lookup(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg, uint32_t key, unsigned int op)
+{
+	struct config_cache_key k;
+	GVariant *data;
+
+	if (!sdi || !sdi->config_cache)
+		return NULL;
+
+	k.cg = cg;
+	k.key = key;
+	k.op = op;
+	if (!(data = g_hash_table_lookup(sdi->config_cache, &k)))
+		return NULL;
+
+	return g_variant_ref(data);
+}
+
+static void config_cache_store(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg, uint32_t key, unsigned int op,
+		GVariant *data)
+{
+	struct sr_dev_inst *inst;
+	struct config_cache_key *k;
+
+	/* The cache is no part of the device's visible state. */
+	inst = (struct sr_dev_inst *)sdi;
+	if (!inst->config_cache)
+		inst->config_cache = g_hash_table_new_full(config_cache_hash,
+			config_cache_equal, g_free,
+			(GDestroyNotify)g_variant_unref);
+
+	k = g_malloc(sizeof(*k));
+	k->cg = cg;
+	k->key = key;
+	k->op = op;
+	g_hash_table_replace(inst->config_cache, k, g_variant_ref(data));
+}
+
+/**
+ * Drop all cached config lists and values of a device instance.
+ *
+ * This happens whenever a setting changes through the API, drivers call
+ * it when the device reports a change on its own (front panel, auto
+ * ranging) so that the next sr_config_get() asks the device again.
+ *
+ * @private
+ */
+SR_PRIV void sr_config_cache_invalidate(const struct sr_dev_inst *sdi)
+{
+	if (sdi && sdi->config_cache)
+		g_hash_table_remove_all(sdi->config_cache);
+}
+
 static void log_key(const struct sr_dev_inst *sdi,
 	const struct sr_channel_group *cg, uint32_t key, unsigned int op,
 	GVariant *data)
@@ -686,6 +1234,8 @@ static void log_key(const struct sr_dev_inst *sdi,
 	/* Don't log SR_CONF_DEVICE_OPTIONS, it's verbose and not too useful. */
 	if (key == SR_CONF_DEVICE_OPTIONS)
 		return;
+	if (!sr_log_enabled(SR_LOG_SPEW))
+		return;
 
 	opstr = op == SR_CONF_GET ? "get" : op == SR_CONF_SET ? "set" : "list";
 	srci = sr_key_info_get(SR_KEY_CONFIG, key);
@@ -697,9 +1247,34 @@ static void log_key(const struct sr_dev_inst *sdi,
 	g_free(tmp_str);
 }
 
+/* Reject values of integer keys which are never useful. */
+static int check_u64_value(const struct sr_key_info *srci, uint64_t value)
+{
+	switch (srci->key) {
+	case SR_CONF_LIMIT_MSEC:
+	case SR_CONF_LIMIT_SAMPLES:
+	case SR_CONF_SAMPLERATE:
+		/* Setting any of these to 0 is not useful. */
+		if (value == 0) {
+			sr_err("Cannot set '%s' to 0.", srci->id);
+			return SR_ERR_ARG;
+		}
+		break;
+	case SR_CONF_CAPTURE_RATIO:
+		/* Capture ratio must always be between 0 and 100. */
+		if (value > 100) {
+			sr_err("Capture ratio must be 0..100.");
+			return SR_ERR_ARG;
+		}
+		break;
+	}
+
+	return SR_OK;
+}
+
 static int check_key(const struct sr_dev_driver *driver,
 		const struct sr_dev_inst *sdi, const struct sr_channel_group *cg,
-		uint32_t key, unsigned int op, GVariant *data)
+		uint32_t key, unsigned int op, GVariant *data, uint32_t *caps)
 {
 	const struct sr_key_info *srci;
 	gsize num_opts, i;
@@ -722,28 +1297,10 @@ static int check_key(const struct sr_dev_driver *driver,
 	}
 	opstr = op == SR_CONF_GET ? "get" : op == SR_CONF_SET ? "set" : "list";
 
-	switch (key) {
-	case SR_CONF_LIMIT_MSEC:
-	case SR_CONF_LIMIT_SAMPLES:
-	case SR_CONF_SAMPLERATE:
-		/* Setting any of these to 0 is not useful. */
-		if (op != SR_CONF_SET || !data)
-			break;
-		if (g_variant_get_uint64(data) == 0) {
-			sr_err("Cannot set '%s' to 0.", srci->id);
-			return SR_ERR_ARG;
-		}
-		break;
-	case SR_CONF_CAPTURE_RATIO:
-		/* Capture ratio must always be between 0 and 100. */
-		if (op != SR_CONF_SET || !data)
-			break;
-		if (g_variant_get_uint64(data) > 100) {
-			sr_err("Capture ratio must be 0..100.");
-			return SR_ERR_ARG;
-		}
-		break;
-	}
+	if (op == SR_CONF_SET && data &&
+			g_variant_is_of_type(data, G_VARIANT_TYPE_UINT64) &&
+			check_u64_value(srci, g_variant_get_uint64(data)) != SR_OK)
+		return SR_ERR_ARG;
 
 	if (sr_config_list(driver, sdi, cg, SR_CONF_DEVICE_OPTIONS, &gvar_opts) != SR_OK) {
 		/* Driver publishes no options. */
@@ -769,6 +1326,9 @@ static int check_key(const struct sr_dev_driver *driver,
 		return SR_ERR_ARG;
 	}
 
+	if (caps)
+		*caps = pub_opt;
+
 	return SR_OK;
 }
 
@@ -803,6 +1363,7 @@ SR_API int sr_config_get(const struct sr_dev_driver *driver,
 		uint32_t key, GVariant **data)
 {
 	int ret;
+	uint32_t caps;
 
 	if (!driver || !data)
 		return SR_ERR;
@@ -810,7 +1371,11 @@ SR_API int sr_config_get(const struct sr_dev_driver *driver,
 	if (!driver->config_get)
 		return SR_ERR_ARG;
 
-	if (check_key(driver, sdi, cg, key, SR_CONF_GET, NULL) != SR_OK)
+	if (sdi && sdi->config_cache_get && sdi->driver == driver &&
+			(*data = config_cache_lookup(sdi, cg, key, SR_CONF_GET)))
+		return SR_OK;
+
+	if (check_key(driver, sdi, cg, key, SR_CONF_GET, NULL, &caps) != SR_OK)
 		return SR_ERR_ARG;
 
 	if (sdi && !sdi->priv) {
@@ -823,6 +1388,13 @@ SR_API int sr_config_get(const struct sr_dev_driver *driver,
 		/* Got a floating reference from the driver. Sink it here,
 		 * caller will need to unref when done with it. */
 		g_variant_ref_sink(*data);
+		/*
+		 * Only settings are cached. Read-only keys are measurements
+		 * or status, which change without anyone setting them.
+		 */
+		if (sdi && sdi->config_cache_get && sdi->driver == driver &&
+				(caps & SR_CONF_SET))
+			config_cache_store(sdi, cg, key, SR_CONF_GET, *data);
 	}
 
 	if (ret == SR_ERR_CHANNEL_GROUP)
@@ -868,11 +1440,14 @@ SR_API int sr_config_set(const struct sr_dev_inst *sdi,
 		sr_err("%s: Device instance not active, can't set config.",
 			sdi->driver->name);
 		ret = SR_ERR_DEV_CLOSED;
-	} else if (check_key(sdi->driver, sdi, cg, key, SR_CONF_SET, data) != SR_OK)
+	} else if (check_key(sdi->driver, sdi, cg, key, SR_CONF_SET, data, NULL) != SR_OK)
 		return SR_ERR_ARG;
 	else if ((ret = sr_variant_type_check(key, data)) == SR_OK) {
 		log_key(sdi, cg, key, SR_CONF_SET, data);
 		ret = sdi->driver->config_set(key, data, sdi, cg);
+		/* Other settings and lists may depend on this one. */
+		sr_config_cache_invalidate(sdi);
+		((struct sr_dev_inst *)sdi)->config_committed = FALSE;
 	}
 
 	g_variant_unref(data);
@@ -884,6 +1459,268 @@ SR_API int sr_config_set(const struct sr_dev_inst *sdi,
 	return ret;
 }
 
+/* The key exists, and holds values of the given type. */
+static const struct sr_key_info *typed_key_get(uint32_t key, int datatype)
+{
+	const struct sr_key_info *srci;
+
+	if (!(srci = sr_key_info_get(SR_KEY_CONFIG, key))) {
+		sr_err("Invalid key %d.", key);
+		return NULL;
+	}
+	if (srci->datatype != datatype) {
+		sr_err("Key '%s' has no value of this type.", srci->id);
+		return NULL;
+	}
+
+	return srci;
+}
+
+/*
+ * Get a scalar value the common way. The GVariant is the driver's, or
+ * one in the config cache, the caller extracts the value.
+ */
+static int config_get_scalar(const struct sr_dev_driver *driver,
+		const struct sr_dev_inst *sdi, const struct sr_channel_group *cg,
+		uint32_t key, int datatype, GVariant **data)
+{
+	if (!typed_key_get(key, datatype))
+		return SR_ERR_ARG;
+
+	return sr_config_get(driver, sdi, cg, key, data);
+}
+
+/**
+ * Query the value of an integer configuration key.
+ *
+ * Same as sr_config_get(), for keys of type SR_T_UINT64 such as
+ * SR_CONF_SAMPLERATE or SR_CONF_LIMIT_SAMPLES, without the GVariant.
+ * Drivers which implement the optional config_get_u64() callback answer
+ * without allocating anything, for the others the value gets taken from
+ * the config cache, or from the result of their config_get(). Suitable
+ * for queries in loops.
+ *
+ * @param[in] driver The sr_dev_driver struct to query. Must not be NULL.
+ * @param[in] sdi (optional) The device instance, see sr_config_get().
+ * @param[in] cg The channel group on the device, or NULL.
+ * @param[in] key The configuration key (SR_CONF_*).
+ * @param[out] value Receives the value. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Error.
+ * @retval SR_ERR_ARG Unknown key, or the key doesn't hold integers, or
+ *         the driver doesn't know that key.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_config_get_u64(const struct sr_dev_driver *driver,
+		const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg,
+		uint32_t key, uint64_t *value)
+{
+	GVariant *data;
+	int ret;
+
+	if (!driver || !value)
+		return SR_ERR;
+
+	if (!typed_key_get(key, SR_T_UINT64))
+		return SR_ERR_ARG;
+
+	if (sdi && sdi->config_cache_get && sdi->driver == driver &&
+			(data = config_cache_lookup(sdi, cg, key, SR_CONF_GET))) {
+		*value = g_variant_get_uint64(data);
+		g_variant_unref(data);
+		return SR_OK;
+	}
+
+	if (driver->config_get_u64) {
+		if (check_key(driver, sdi, cg, key, SR_CONF_GET, NULL, NULL) != SR_OK)
+			return SR_ERR_ARG;
+		if (sdi && !sdi->priv) {
+			sr_err("Can't get config (sdi != NULL, sdi->priv == NULL).");
+			return SR_ERR;
+		}
+		/* SR_ERR_NA leaves the key to the GVariant callback. */
+		ret = driver->config_get_u64(key, value, sdi, cg);
+		if (ret != SR_ERR_NA)
+			return ret;
+	}
+
+	if ((ret = sr_config_get(driver, sdi, cg, key, &data)) != SR_OK)
+		return ret;
+	*value = g_variant_get_uint64(data);
+	g_variant_unref(data);
+
+	return SR_OK;
+}
+
+/**
+ * Query the value of a boolean configuration key.
+ *
+ * Same as sr_config_get(), for keys of type SR_T_BOOL, without the
+ * GVariant.
+ *
+ * @param[in] driver The sr_dev_driver struct to query. Must not be NULL.
+ * @param[in] sdi (optional) The device instance, see sr_config_get().
+ * @param[in] cg The channel group on the device, or NULL.
+ * @param[in] key The configuration key (SR_CONF_*).
+ * @param[out] value Receives the value. Must not be NULL.
+ *
+ * @return See sr_config_get_u64().
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_config_get_bool(const struct sr_dev_driver *driver,
+		const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg,
+		uint32_t key, gboolean *value)
+{
+	GVariant *data;
+	int ret;
+
+	if (!driver || !value)
+		return SR_ERR;
+
+	ret = config_get_scalar(driver, sdi, cg, key, SR_T_BOOL, &data);
+	if (ret != SR_OK)
+		return ret;
+	*value = g_variant_get_boolean(data);
+	g_variant_unref(data);
+
+	return SR_OK;
+}
+
+/**
+ * Query the value of a floating point configuration key.
+ *
+ * Same as sr_config_get(), for keys of type SR_T_FLOAT, without the
+ * GVariant.
+ *
+ * @param[in] driver The sr_dev_driver struct to query. Must not be NULL.
+ * @param[in] sdi (optional) The device instance, see sr_config_get().
+ * @param[in] cg The channel group on the device, or NULL.
+ * @param[in] key The configuration key (SR_CONF_*).
+ * @param[out] value Receives the value. Must not be NULL.
+ *
+ * @return See sr_config_get_u64().
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_config_get_double(const struct sr_dev_driver *driver,
+		const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg,
+		uint32_t key, double *value)
+{
+	GVariant *data;
+	int ret;
+
+	if (!driver || !value)
+		return SR_ERR;
+
+	ret = config_get_scalar(driver, sdi, cg, key, SR_T_FLOAT, &data);
+	if (ret != SR_OK)
+		return ret;
+	*value = g_variant_get_double(data);
+	g_variant_unref(data);
+
+	return SR_OK;
+}
+
+/**
+ * Set the value of an integer configuration key in a device instance.
+ *
+ * Same as sr_config_set(), for keys of type SR_T_UINT64, without the
+ * GVariant. Drivers which implement the optional config_set_u64()
+ * callback take the value as it is, the others get it boxed.
+ *
+ * @param[in] sdi The device instance. Must not be NULL. sdi->driver and
+ *                sdi->priv must not be NULL either.
+ * @param[in] cg The channel group on the device, or NULL.
+ * @param[in] key The configuration key (SR_CONF_*).
+ * @param[in] value The new value.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Error.
+ * @retval SR_ERR_ARG Unknown key, or the key doesn't hold integers, or
+ *         the driver doesn't know that key.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_config_set_u64(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg,
+		uint32_t key, uint64_t value)
+{
+	const struct sr_key_info *srci;
+	int ret;
+
+	if (!sdi || !sdi->driver || !sdi->priv)
+		return SR_ERR;
+
+	if (!(srci = typed_key_get(key, SR_T_UINT64)))
+		return SR_ERR_ARG;
+
+	if (!sdi->driver->config_set_u64)
+		return sr_config_set(sdi, cg, key, g_variant_new_uint64(value));
+
+	if (sdi->status != SR_ST_ACTIVE) {
+		sr_err("%s: Device instance not active, can't set config.",
+			sdi->driver->name);
+		return SR_ERR_DEV_CLOSED;
+	}
+	if (check_u64_value(srci, value) != SR_OK ||
+			check_key(sdi->driver, sdi, cg, key, SR_CONF_SET, NULL, NULL) != SR_OK)
+		return SR_ERR_ARG;
+
+	sr_spew("sr_config_set_u64(): key %d (%s) sdi %p cg %s -> %" PRIu64,
+		key, srci->id, sdi, cg ? cg->name : "NULL", value);
+	ret = sdi->driver->config_set_u64(key, value, sdi, cg);
+	if (ret == SR_ERR_NA)
+		return sr_config_set(sdi, cg, key, g_variant_new_uint64(value));
+	/* Other settings and lists may depend on this one. */
+	sr_config_cache_invalidate(sdi);
+	((struct sr_dev_inst *)sdi)->config_committed = FALSE;
+
+	if (ret == SR_ERR_CHANNEL_GROUP)
+		sr_err("%s: No channel group specified.", sdi->driver->name);
+
+	return ret;
+}
+
+/**
+ * Set the value of a boolean configuration key in a device instance.
+ *
+ * @see sr_config_set_u64()
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_config_set_bool(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg,
+		uint32_t key, gboolean value)
+{
+	if (!typed_key_get(key, SR_T_BOOL))
+		return SR_ERR_ARG;
+
+	return sr_config_set(sdi, cg, key, g_variant_new_boolean(value));
+}
+
+/**
+ * Set the value of a floating point configuration key in a device instance.
+ *
+ * @see sr_config_set_u64()
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_config_set_double(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg,
+		uint32_t key, double value)
+{
+	if (!typed_key_get(key, SR_T_FLOAT))
+		return SR_ERR_ARG;
+
+	return sr_config_set(sdi, cg, key, g_variant_new_double(value));
+}
+
 /**
  * Apply configuration settings to the device hardware.
  *
@@ -898,19 +1735,52 @@ SR_API int sr_config_commit(const struct sr_dev_inst *sdi)
 	int ret;
 
 	if (!sdi || !sdi->driver)
-		ret = SR_ERR;
+		return SR_ERR;
 	else if (!sdi->driver->config_commit)
 		ret = SR_OK;
 	else if (sdi->status != SR_ST_ACTIVE) {
 		sr_err("%s: Device instance not active, can't commit config.",
 			sdi->driver->name);
 		ret = SR_ERR_DEV_CLOSED;
-	} else
+	} else {
 		ret = sdi->driver->config_commit(sdi);
+		sr_config_cache_invalidate(sdi);
+	}
+	/* Lets re-armed sessions skip the next commit, see sr_session_start(). */
+	((struct sr_dev_inst *)sdi)->config_committed = ret == SR_OK;
 
 	return ret;
 }
 
+/**
+ * Enable or disable caching of sr_config_get() results for a device.
+ *
+ * With the cache enabled, values of settable keys are kept after they
+ * have been read once, and further queries don't reach the driver (nor
+ * the instrument). Every sr_config_set() and sr_config_commit(), and
+ * opening, closing, starting or stopping the device instance drop the
+ * cache. Drivers drop it when the device reports changes on its own.
+ * Results of sr_config_list() are cached in any case.
+ *
+ * @param sdi The device instance. Must not be NULL.
+ * @param enable TRUE to cache values, FALSE to always ask the driver.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_config_cache_enable(struct sr_dev_inst *sdi, gboolean enable)
+{
+	if (!sdi)
+		return SR_ERR_ARG;
+
+	sdi->config_cache_get = enable;
+	sr_config_cache_invalidate(sdi);
+
+	return SR_OK;
+}
+
 /**
  * List all possible values for a configuration key.
  *
@@ -953,8 +1823,13 @@ SR_API int sr_config_list(const struct sr_dev_driver *driver,
 	if (!driver->config_list)
 		return SR_ERR_ARG;
 
+	/* A cached list was checked when it was stored. */
+	if (sdi && sdi->driver == driver &&
+			(*data = config_cache_lookup(sdi, cg, key, SR_CONF_LIST)))
+		return SR_OK;
+
 	if (key != SR_CONF_SCAN_OPTIONS && key != SR_CONF_DEVICE_OPTIONS) {
-		if (check_key(driver, sdi, cg, key, SR_CONF_LIST, NULL) != SR_OK)
+		if (check_key(driver, sdi, cg, key, SR_CONF_LIST, NULL, NULL) != SR_OK)
 			return SR_ERR_ARG;
 	}
 
@@ -987,6 +1862,8 @@ SR_API int sr_config_list(const struct sr_dev_driver *driver,
 	if ((ret = driver->config_list(key, data, sdi, cg)) == SR_OK) {
 		log_key(sdi, cg, key, SR_CONF_LIST, *data);
 		g_variant_ref_sink(*data);
+		if (sdi && sdi->driver == driver)
+			config_cache_store(sdi, cg, key, SR_CONF_LIST, *data);
 	}
 
 	if (ret == SR_ERR_CHANNEL_GROUP)
@@ -996,6 +1873,16 @@ SR_API int sr_config_list(const struct sr_dev_driver *driver,
 	return ret;
 }
 
+/*
+ * Lookup indexes of a key table, by key and by id. They are built on
+ * first use and live as long as the tables themselves. Where a key or
+ * id occurs twice, the first entry wins, as with a linear search.
+ */
+struct key_index {
+	GHashTable *by_key;
+	GHashTable *by_id;
+};
+
 static struct sr_key_info *get_keytable(int keytype)
 {
 	struct sr_key_info *table;
@@ -1018,6 +1905,37 @@ static struct sr_key_info *get_keytable(int keytype)
 	return table;
 }
 
+static const struct key_index *get_keyindex(int keytype)
+{
+	static struct key_index indexes[SR_KEY_MQFLAGS + 1];
+	static gsize built[SR_KEY_MQFLAGS + 1];
+	struct key_index *index;
+	struct sr_key_info *table;
+	gpointer key;
+	int i;
+
+	if (!(table = get_keytable(keytype)))
+		return NULL;
+
+	index = &indexes[keytype];
+	if (g_once_init_enter(&built[keytype])) {
+		index->by_key = g_hash_table_new(g_direct_hash, g_direct_equal);
+		index->by_id = g_hash_table_new(g_str_hash, g_str_equal);
+		for (i = 0; table[i].key; i++) {
+			key = GUINT_TO_POINTER(table[i].key);
+			if (!g_hash_table_contains(index->by_key, key))
+				g_hash_table_insert(index->by_key, key, &table[i]);
+			if (table[i].id && !g_hash_table_contains(index->by_id,
+					table[i].id))
+				g_hash_table_insert(index->by_id,
+					(gpointer)table[i].id, &table[i]);
+		}
+		g_once_init_leave(&built[keytype], 1);
+	}
+
+	return index;
+}
+
 /**
  * Get information about a key, by key.
  *
@@ -1031,18 +1949,12 @@ static struct sr_key_info *get_keytable(int keytype)
  */
 SR_API const struct sr_key_info *sr_key_info_get(int keytype, uint32_t key)
 {
-	struct sr_key_info *table;
-	int i;
+	const struct key_index *index;
 
-	if (!(table = get_keytable(keytype)))
+	if (!(index = get_keyindex(keytype)) || !key)
 		return NULL;
 
-	for (i = 0; table[i].key; i++) {
-		if (table[i].key == key)
-			return &table[i];
-	}
-
-	return NULL;
+	return g_hash_table_lookup(index->by_key, GUINT_TO_POINTER(key));
 }
 
 /**
@@ -1058,20 +1970,12 @@ SR_API const struct sr_key_info *sr_key_info_get(int keytype, uint32_t key)
  */
 SR_API const struct sr_key_info *sr_key_info_name_get(int keytype, const char *keyid)
 {
-	struct sr_key_info *table;
-	int i;
+	const struct key_index *index;
 
-	if (!(table = get_keytable(keytype)))
+	if (!(index = get_keyindex(keytype)) || !keyid)
 		return NULL;
 
-	for (i = 0; table[i].key; i++) {
-		if (!table[i].id)
-			continue;
-		if (!strcmp(table[i].id, keyid))
-			return &table[i];
-	}
-
-	return NULL;
+	return g_hash_table_lookup(index->by_id, keyid);
 }
 
 /** @} */
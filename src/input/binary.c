@@ -66,7 +66,8 @@ static int init(struct sr_input *in, GHashTable *options)
 	return SR_OK;
 }
 
-static int process_buffer(struct sr_input *in)
+/* Send whole samples from data, returns the number of bytes sent. */
+static gsize send_chunks(struct sr_input *in, uint8_t *data, gsize len)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
@@ -91,17 +92,26 @@ static int process_buffer(struct sr_input *in)
 	logic.unitsize = inc->unitsize;
 
 	/* Cut off at multiple of unitsize. */
-	chunk_size = in->buf->len / logic.unitsize * logic.unitsize;
+	chunk_size = len / logic.unitsize * logic.unitsize;
 
 	for (i = 0; i < chunk_size; i += chunk) {
-		logic.data = in->buf->str + i;
+		logic.data = data + i;
 		chunk = MIN(CHUNK_SIZE, chunk_size - i);
 		chunk /= logic.unitsize;
 		chunk *= logic.unitsize;
 		logic.length = chunk;
 		sr_session_send(in->sdi, &packet);
 	}
-	g_string_erase(in->buf, 0, chunk_size);
+
+	return chunk_size;
+}
+
+static int process_buffer(struct sr_input *in)
+{
+	gsize used;
+
+	used = send_chunks(in, (uint8_t *)in->buf->str, in->buf->len);
+	sr_input_buf_consume(in, used);
 
 	return SR_OK;
 }
@@ -110,7 +120,7 @@ static int receive(struct sr_input *in, GString *buf)
 {
 	int ret;
 
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf->str, buf->len);
 
 	if (!in->sdi_ready) {
 		/* sdi is ready, notify frontend. */
@@ -123,6 +133,30 @@ static int receive(struct sr_input *in, GString *buf)
 	return ret;
 }
 
+static int receive_mapped(struct sr_input *in, uint8_t *data, size_t len)
+{
+	struct context *inc;
+	gsize fill, used;
+
+	inc = in->priv;
+	process_buffer(in);
+
+	/* Complete a sample which was split off by receive(). */
+	if (in->buf->len) {
+		fill = MIN(len, inc->unitsize - in->buf->len);
+		sr_input_buf_append(in, (const char *)data, fill);
+		data += fill;
+		len -= fill;
+		process_buffer(in);
+	}
+
+	/* Send the rest straight from the mapping, keep the leftover. */
+	used = send_chunks(in, data, len);
+	sr_input_buf_append(in, (const char *)data + used, len - used);
+
+	return SR_OK;
+}
+
 static int end(struct sr_input *in)
 {
 	struct context *inc;
@@ -145,7 +179,7 @@ static int reset(struct sr_input *in)
 	struct context *inc = in->priv;
 
 	inc->started = FALSE;
-	g_string_truncate(in->buf, 0);
+	sr_input_buf_clear(in);
 
 	return SR_OK;
 }
@@ -174,6 +208,7 @@ SR_PRIV struct sr_input_module input_binary = {
 	.options = get_options,
 	.init = init,
 	.receive = receive,
+	.receive_mapped = receive_mapped,
 	.end = end,
 	.reset = reset,
 };
@@ -33,6 +33,7 @@
 #define LOG_PREFIX "input/csv"
 
 #define CHUNK_SIZE	(4 * 1024 * 1024)
+#define RLE_CHANGES	(64 * 1024)
 
 /*
  * The CSV input module has the following options:
@@ -91,6 +92,14 @@
  *     up to the end of the current text line. Can be empty to disable
  *     comment support. Defaults to semicolon.
  *
+ * sparse: Boolean option, rows are value changes at the time of their
+ *     timestamp column (in units of seconds). Each row's values last
+ *     until the next row's timestamp. The samplerate is taken from the
+ *     'samplerate' option, or from the first two rows' timestamps. Logic
+ *     data gets sent as value changes when the session accepts these,
+ *     which makes the cost of sparse event logs depend on the number of
+ *     rows rather than the time span. Off by default.
+ *
  * Typical examples of using these options:
  * - ... -I csv:column_formats=*l ...
  *   All columns are single-bit logic data. Identical to the previous
@@ -193,6 +202,12 @@ static gboolean format_is_timestamp(enum single_col_format fmt)
 	return fmt == FORMAT_TIME;
 }
 
+struct context;
+struct column_details;
+
+typedef int (*col_parse_cb)(const char *column, struct context *inc,
+	const struct column_details *details);
+
 struct column_details {
 	size_t col_nr;
 	enum single_col_format text_format;
@@ -200,6 +215,7 @@ struct column_details {
 	size_t channel_count;
 	int analog_digits;
 	GString **channel_names;
+	col_parse_cb parse_func;
 };
 
 struct context {
@@ -225,6 +241,7 @@ struct context {
 	const char *column_formats;
 	size_t column_want_count;
 	struct column_details *column_details;
+	char **column_texts;	/**!< Columns' text of the current line. */
 
 	/* Line number to start processing. */
 	size_t start_line;
@@ -239,6 +256,7 @@ struct context {
 	size_t sample_unit_size;	/**!< Byte count for a single sample. */
 	uint8_t *sample_buffer;		/**!< Buffer for a single sample. */
 	csv_analog_t *analog_sample_buffer;	/**!< Buffer for one set of analog values. */
+	size_t analog_sample_stride;	/**!< Distance of channels' values. */
 
 	uint8_t *datafeed_buffer;	/**!< Queue for datafeed submission. */
 	size_t datafeed_buf_size;
@@ -256,6 +274,25 @@ struct context {
 	/* List of previously created sigrok channels. */
 	GSList *prev_sr_channels;
 	GSList **prev_df_channels;
+
+	/* Sparse import, rows' values last until the next row's time. */
+	gboolean sparse;
+	double row_timestamp;
+	gboolean row_has_timestamp;
+	gboolean have_pending;
+	double first_timestamp;
+	double pending_timestamp;
+	uint64_t pending_pos;
+	uint8_t *row_logic, *pending_logic;
+	csv_analog_t *row_analog, *pending_analog;
+	struct {
+		gboolean checked;
+		gboolean use;
+		uint64_t *offsets;
+		uint8_t *values;
+		size_t num_changes;
+		uint64_t num_samples;
+	} rle;
 };
 
 /*
@@ -291,7 +328,10 @@ static void clear_logic_samples(struct context *inc)
 {
 	if (!inc->logic_channels)
 		return;
-	inc->sample_buffer = &inc->datafeed_buffer[inc->datafeed_buf_fill];
+	if (inc->sparse)
+		inc->sample_buffer = inc->row_logic;
+	else
+		inc->sample_buffer = &inc->datafeed_buffer[inc->datafeed_buf_fill];
 	memset(inc->sample_buffer, 0, inc->sample_unit_size);
 }
 
@@ -311,6 +351,36 @@ static void set_logic_level(struct context *inc, size_t ch_idx, int on)
 	inc->sample_buffer[byte_idx] |= bit_mask;
 }
 
+static int flush_logic_rle(const struct sr_input *in)
+{
+	struct context *inc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic_rle rle;
+	int rc;
+
+	inc = in->priv;
+	if (!inc->rle.num_samples)
+		return SR_OK;
+
+	rc = flush_samplerate(in);
+	if (rc != SR_OK)
+		return rc;
+
+	memset(&packet, 0, sizeof(packet));
+	memset(&rle, 0, sizeof(rle));
+	packet.type = SR_DF_LOGIC_RLE;
+	packet.payload = &rle;
+	rle.num_samples = inc->rle.num_samples;
+	rle.unitsize = inc->sample_unit_size;
+	rle.num_changes = inc->rle.num_changes;
+	rle.offsets = inc->rle.offsets;
+	rle.values = inc->rle.values;
+	inc->rle.num_changes = 0;
+	inc->rle.num_samples = 0;
+
+	return sr_session_send(in->sdi, &packet);
+}
+
 static int flush_logic_samples(const struct sr_input *in)
 {
 	struct context *inc;
@@ -319,6 +389,8 @@ static int flush_logic_samples(const struct sr_input *in)
 	int rc;
 
 	inc = in->priv;
+	if (inc->rle.use)
+		return flush_logic_rle(in);
 	if (!inc->datafeed_buf_fill)
 		return SR_OK;
 
@@ -370,7 +442,15 @@ static void clear_analog_samples(struct context *inc)
 
 	if (!inc->analog_channels)
 		return;
+	if (inc->sparse) {
+		inc->analog_sample_buffer = inc->row_analog;
+		inc->analog_sample_stride = 1;
+		for (idx = 0; idx < inc->analog_channels; idx++)
+			inc->row_analog[idx] = 0.0;
+		return;
+	}
 	inc->analog_sample_buffer = &inc->analog_datafeed_buffer[inc->analog_datafeed_buf_fill];
+	inc->analog_sample_stride = inc->analog_datafeed_buf_size;
 	for (idx = 0; idx < inc->analog_channels; idx++)
 		set_analog_value(inc, idx, 0.0);
 }
@@ -381,7 +461,7 @@ static void set_analog_value(struct context *inc, size_t ch_idx, csv_analog_t va
 		return;
 	if (!value)
 		return;
-	inc->analog_sample_buffer[ch_idx * inc->analog_datafeed_buf_size] = value;
+	inc->analog_sample_buffer[ch_idx * inc->analog_sample_stride] = value;
 }
 
 static int flush_analog_samples(const struct sr_input *in)
@@ -457,6 +537,223 @@ static int queue_analog_samples(const struct sr_input *in)
 	return SR_OK;
 }
 
+/*
+ * Sparse import. A row's values only get sent when the next row's
+ * timestamp is known, as a run of samples up to that time. Logic data
+ * gets sent as value changes where the session accepts these, or gets
+ * filled into the datafeed buffer in bulk. Analog data gets filled in.
+ */
+
+/*
+ * Check once before the first sample data, whether logic data can get
+ * sent as SR_DF_LOGIC_RLE packets. The device instance only becomes
+ * part of a session after the header was processed.
+ */
+static void check_logic_rle(const struct sr_input *in)
+{
+	struct context *inc;
+
+	inc = in->priv;
+	if (inc->rle.checked)
+		return;
+	inc->rle.checked = TRUE;
+
+	if (!inc->logic_channels)
+		return;
+	if (!sr_session_logic_rle_accepted(in->sdi->session))
+		return;
+	inc->rle.offsets = g_try_malloc(RLE_CHANGES * sizeof(uint64_t));
+	inc->rle.values = g_try_malloc(RLE_CHANGES * inc->sample_unit_size);
+	if (!inc->rle.offsets || !inc->rle.values) {
+		g_free(inc->rle.offsets);
+		inc->rle.offsets = NULL;
+		g_free(inc->rle.values);
+		inc->rle.values = NULL;
+		return;
+	}
+	inc->rle.use = TRUE;
+	sr_dbg("Sending run-length encoded logic data.");
+}
+
+static int fill_logic_samples(const struct sr_input *in,
+	const uint8_t *value, uint64_t count)
+{
+	struct context *inc;
+	uint8_t *start, *last;
+	size_t unit, chunk, filled, size, copy;
+	int rc;
+
+	inc = in->priv;
+	unit = inc->sample_unit_size;
+
+	if (inc->rle.use) {
+		last = NULL;
+		if (inc->rle.num_changes)
+			last = &inc->rle.values[(inc->rle.num_changes - 1) * unit];
+		if (!last || memcmp(last, value, unit) != 0) {
+			if (inc->rle.num_changes == RLE_CHANGES) {
+				rc = flush_logic_rle(in);
+				if (rc != SR_OK)
+					return rc;
+			}
+			inc->rle.offsets[inc->rle.num_changes] = inc->rle.num_samples;
+			memcpy(&inc->rle.values[inc->rle.num_changes * unit],
+				value, unit);
+			inc->rle.num_changes++;
+		}
+		inc->rle.num_samples += count;
+		return SR_OK;
+	}
+
+	/* Write one sample, then fill the run by doubling copies of it. */
+	while (count) {
+		chunk = (inc->datafeed_buf_size - inc->datafeed_buf_fill) / unit;
+		chunk = MIN(chunk, count);
+		start = &inc->datafeed_buffer[inc->datafeed_buf_fill];
+		memcpy(start, value, unit);
+		size = chunk * unit;
+		for (filled = unit; filled < size; filled += copy) {
+			copy = MIN(filled, size - filled);
+			memcpy(&start[filled], start, copy);
+		}
+		inc->datafeed_buf_fill += size;
+		count -= chunk;
+		if (inc->datafeed_buf_fill == inc->datafeed_buf_size) {
+			rc = flush_logic_samples(in);
+			if (rc != SR_OK)
+				return rc;
+		}
+	}
+
+	return SR_OK;
+}
+
+static int fill_analog_samples(const struct sr_input *in,
+	const csv_analog_t *values, uint64_t count)
+{
+	struct context *inc;
+	csv_analog_t *samples;
+	size_t ch_idx, chunk, idx;
+	int rc;
+
+	inc = in->priv;
+
+	while (count) {
+		chunk = inc->analog_datafeed_buf_size - inc->analog_datafeed_buf_fill;
+		chunk = MIN(chunk, count);
+		for (ch_idx = 0; ch_idx < inc->analog_channels; ch_idx++) {
+			samples = &inc->analog_datafeed_buffer[ch_idx * inc->analog_datafeed_buf_size];
+			samples += inc->analog_datafeed_buf_fill;
+			for (idx = 0; idx < chunk; idx++)
+				samples[idx] = values[ch_idx];
+		}
+		inc->analog_datafeed_buf_fill += chunk;
+		count -= chunk;
+		if (inc->analog_datafeed_buf_fill == inc->analog_datafeed_buf_size) {
+			rc = flush_analog_samples(in);
+			if (rc != SR_OK)
+				return rc;
+		}
+	}
+
+	return SR_OK;
+}
+
+/* Send the pending row's values as a run of samples. */
+static int send_pending_row(const struct sr_input *in, uint64_t count)
+{
+	struct context *inc;
+	int rc;
+
+	inc = in->priv;
+	check_logic_rle(in);
+
+	if (inc->logic_channels) {
+		rc = fill_logic_samples(in, inc->pending_logic, count);
+		if (rc != SR_OK)
+			return rc;
+	}
+	if (inc->analog_channels) {
+		rc = fill_analog_samples(in, inc->pending_analog, count);
+		if (rc != SR_OK)
+			return rc;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Take the current row's values. Send the previous row up to the
+ * current row's time, the current row becomes the pending one. Rows
+ * which map to the same sample number replace each other.
+ */
+static int queue_sparse_row(const struct sr_input *in)
+{
+	struct context *inc;
+	double ts, rate;
+	uint64_t pos;
+	uint8_t *logic;
+	csv_analog_t *analog;
+	int rc;
+
+	inc = in->priv;
+	if (!inc->row_has_timestamp) {
+		sr_err("Missing timestamp in line %zu.", inc->line_number);
+		return SR_ERR_DATA;
+	}
+	inc->row_has_timestamp = FALSE;
+	ts = inc->row_timestamp;
+
+	if (!inc->have_pending) {
+		inc->first_timestamp = ts;
+		inc->pending_pos = 0;
+	} else if (ts < inc->pending_timestamp) {
+		sr_err("Timestamp in line %zu leaps backwards.",
+			inc->line_number);
+		return SR_ERR_DATA;
+	} else if (ts > inc->pending_timestamp) {
+		if (!inc->calc_samplerate)
+			inc->calc_samplerate = inc->samplerate;
+		if (!inc->calc_samplerate) {
+			rate = 1.0 / (ts - inc->pending_timestamp) + 0.5;
+			inc->calc_samplerate = MAX((uint64_t)rate, 1);
+			sr_info("Samplerate %" PRIu64 " from timestamps in line %zu.",
+				inc->calc_samplerate, inc->line_number);
+		}
+		pos = (ts - inc->first_timestamp) * inc->calc_samplerate + 0.5;
+		if (pos > inc->pending_pos) {
+			rc = send_pending_row(in, pos - inc->pending_pos);
+			if (rc != SR_OK)
+				return rc;
+			inc->pending_pos = pos;
+		}
+	}
+
+	logic = inc->pending_logic;
+	inc->pending_logic = inc->row_logic;
+	inc->row_logic = logic;
+	analog = inc->pending_analog;
+	inc->pending_analog = inc->row_analog;
+	inc->row_analog = analog;
+	inc->pending_timestamp = ts;
+	inc->have_pending = TRUE;
+
+	return SR_OK;
+}
+
+/* The last row lasts for one sample. */
+static int flush_sparse_row(const struct sr_input *in)
+{
+	struct context *inc;
+
+	inc = in->priv;
+	if (!inc->have_pending)
+		return SR_OK;
+	inc->have_pending = FALSE;
+
+	return send_pending_row(in, 1);
+}
+
 /* Helpers for "column processing". */
 
 static int split_column_format(const char *spec,
@@ -717,16 +1014,6 @@ static int make_column_details_from_format(const struct sr_input *in,
 	return SR_OK;
 }
 
-static const struct column_details *lookup_column_details(struct context *inc, size_t nr)
-{
-	if (!inc || !inc->column_details)
-		return NULL;
-	if (!nr || nr > inc->column_want_count)
-		return NULL;
-
-	return &inc->column_details[nr - 1];
-}
-
 /*
  * Primitive operations for text input: Strip comments off text lines.
  * Split text lines into columns. Process input text for individual
@@ -774,6 +1061,47 @@ static char **split_line(char *buf, struct context *inc)
 	return fields;
 }
 
+/**
+ * Splits a text line into columns, in place.
+ *
+ * @param[in] line	The input text line, gets modified.
+ * @param[in] inc	The input module's context.
+ *
+ * @returns The number of columns found, up to the wanted count.
+ *
+ * This routine terminates the text of the columns which the column
+ * formats refer to, and keeps references to them in the context's
+ * column text table. Unlike split_line() no memory gets allocated,
+ * and text past the last wanted column is not inspected.
+ */
+static size_t tokenize_line(char *line, struct context *inc)
+{
+	const char *delim;
+	size_t delim_len, count;
+	char *end;
+
+	delim = inc->delimiter->str;
+	delim_len = inc->delimiter->len;
+	count = 0;
+	while (count < inc->column_want_count) {
+		inc->column_texts[count++] = line;
+		if (delim_len == 1)
+			end = strchr(line, delim[0]);
+		else
+			end = strstr(line, delim);
+		if (end) {
+			*end = '\0';
+			g_strchomp(line);
+			line = end + delim_len;
+			continue;
+		}
+		g_strchomp(line);
+		break;
+	}
+
+	return count;
+}
+
 /**
  * Parse a multi-bit field into several logic channels.
  *
@@ -813,6 +1141,16 @@ static int parse_logic(const char *column, struct context *inc,
 	ch_idx = details->channel_offset;
 	ch_rem = details->channel_count;
 
+	/* Fast path for the common case of single-bit binary columns. */
+	if (details->text_format == FORMAT_BIN && ch_rem == 1) {
+		c = rdptr[-1];
+		if (c == '1')
+			set_logic_level(inc, ch_idx, 1);
+		else if (c != '0')
+			goto invalid;
+		return SR_OK;
+	}
+
 	/*
 	 * Get another digit and derive up to four logic channels' state from
 	 * it. Make sure to not process more bits than the column has channels
@@ -838,12 +1176,8 @@ static int parse_logic(const char *column, struct context *inc,
 			valid = FALSE;
 			break;
 		}
-		if (!valid) {
-			type_text = col_format_text[details->text_format];
-			sr_err("Invalid text '%s' in %s type column %zu in line %zu.",
-				column, type_text, details->col_nr, inc->line_number);
-			return SR_ERR;
-		}
+		if (!valid)
+			goto invalid;
 		/* Use the digit's bits for logic channels' data. */
 		bits = g_ascii_xdigit_value(c);
 		switch (details->text_format) {
@@ -882,6 +1216,12 @@ static int parse_logic(const char *column, struct context *inc,
 	 */
 
 	return SR_OK;
+
+invalid:
+	type_text = col_format_text[details->text_format];
+	sr_err("Invalid text '%s' in %s type column %zu in line %zu.",
+		column, type_text, details->col_nr, inc->line_number);
+	return SR_ERR;
 }
 
 /**
@@ -901,7 +1241,8 @@ static int parse_analog(const char *column, struct context *inc,
 	const struct column_details *details)
 {
 	size_t length;
-	double dvalue; float fvalue;
+	double dvalue;
+	const char *endptr;
 	csv_analog_t value;
 	int ret;
 
@@ -914,15 +1255,10 @@ static int parse_analog(const char *column, struct context *inc,
 			inc->line_number);
 		return SR_ERR;
 	}
-	if (sizeof(value) == sizeof(double)) {
-		ret = sr_atod_ascii(column, &dvalue);
-		value = dvalue;
-	} else if (sizeof(value) == sizeof(float)) {
-		ret = sr_atof_ascii(column, &fvalue);
-		value = fvalue;
-	} else {
-		ret = SR_ERR_BUG;
-	}
+	ret = sr_parse_double_ascii(column, length + 1, &dvalue, &endptr);
+	if (ret == SR_OK && *endptr)
+		ret = SR_ERR_DATA;
+	value = dvalue;
 	if (ret != SR_OK) {
 		sr_err("Cannot parse analog text %s in column %zu in line %zu.",
 			column, details->col_nr, inc->line_number);
@@ -956,6 +1292,19 @@ static int parse_timestamp(const char *column, struct context *inc,
 	if (!format_is_timestamp(details->text_format))
 		return SR_ERR_BUG;
 
+	/* Sparse import takes every row's time, see queue_sparse_row(). */
+	if (inc->sparse) {
+		ret = sr_atod_ascii(column, &ts);
+		if (ret != SR_OK) {
+			sr_err("Cannot convert timestamp text %s in line %zu.",
+				column, inc->line_number);
+			return SR_ERR_DATA;
+		}
+		inc->row_timestamp = ts;
+		inc->row_has_timestamp = TRUE;
+		return SR_OK;
+	}
+
 	/*
 	 * Implementor's notes on timestamp interpretation. Use a simple
 	 * approach for improved maintainability which covers most cases
@@ -1038,9 +1387,6 @@ static int parse_ignore(const char *column, struct context *inc,
 	return SR_OK;
 }
 
-typedef int (*col_parse_cb)(const char *column, struct context *inc,
-	const struct column_details *details);
-
 static const col_parse_cb col_parse_funcs[] = {
 	[FORMAT_NONE] = parse_ignore,
 	[FORMAT_BIN] = parse_logic,
@@ -1215,6 +1561,7 @@ static int init(struct sr_input *in, GHashTable *options)
 	inc->samplerate = g_variant_get_uint64(g_hash_table_lookup(options, "samplerate"));
 	first_column = g_variant_get_uint32(g_hash_table_lookup(options, "first_column"));
 	inc->use_header = g_variant_get_boolean(g_hash_table_lookup(options, "header"));
+	inc->sparse = g_variant_get_boolean(g_hash_table_lookup(options, "sparse"));
 	inc->start_line = g_variant_get_uint32(g_hash_table_lookup(options, "start_line"));
 	if (inc->start_line < 1) {
 		sr_err("Invalid start line %zu.", inc->start_line);
@@ -1346,7 +1693,8 @@ static const char *get_line_termination(GString *buf)
 static int initial_parse(const struct sr_input *in, GString *buf)
 {
 	struct context *inc;
-	size_t num_columns;
+	size_t num_columns, col_idx;
+	struct column_details *detail;
 	size_t line_number, line_idx;
 	int ret;
 	char **lines, *line, **columns;
@@ -1421,6 +1769,21 @@ static int initial_parse(const struct sr_input *in, GString *buf)
 		goto out;
 	}
 
+	/*
+	 * Resolve the columns' parse routines once, and allocate the
+	 * table of column text references which the line tokenizer
+	 * fills in for every line of input text.
+	 */
+	for (col_idx = 0; col_idx < inc->column_want_count; col_idx++) {
+		detail = &inc->column_details[col_idx];
+		detail->parse_func = NULL;
+		if (format_is_ignore(detail->text_format))
+			continue;
+		detail->parse_func = col_parse_funcs[detail->text_format];
+	}
+	inc->column_texts = g_malloc0_n(inc->column_want_count + 1,
+		sizeof(inc->column_texts[0]));
+
 	/*
 	 * Allocate buffer memory for datafeed submission of sample data.
 	 * Calculate the minimum buffer size to store the set of samples
@@ -1463,6 +1826,25 @@ static int initial_parse(const struct sr_input *in, GString *buf)
 		inc->analog_datafeed_buf_fill = 0;
 	}
 
+	/* Sparse import keeps the current and the pending row's values. */
+	if (inc->sparse) {
+		for (col_idx = 0; col_idx < inc->column_want_count; col_idx++) {
+			if (format_is_timestamp(inc->column_details[col_idx].text_format))
+				break;
+		}
+		if (col_idx == inc->column_want_count) {
+			sr_err("Sparse import needs a timestamp column.");
+			ret = SR_ERR_ARG;
+			goto out;
+		}
+		inc->row_logic = g_malloc0(inc->sample_unit_size);
+		inc->pending_logic = g_malloc0(inc->sample_unit_size);
+		inc->row_analog = g_malloc0_n(inc->analog_channels,
+			sizeof(inc->row_analog[0]));
+		inc->pending_analog = g_malloc0_n(inc->analog_channels,
+			sizeof(inc->pending_analog[0]));
+	}
+
 out:
 	if (columns)
 		g_strfreev(columns);
@@ -1481,7 +1863,7 @@ out:
  * against multiple execution or dropping the BOM multiple times --
  * there should be at most one in the input stream.
  */
-static void initial_bom_check(const struct sr_input *in)
+static void initial_bom_check(struct sr_input *in)
 {
 	static const char *utf8_bom = "\xef\xbb\xbf";
 
@@ -1489,10 +1871,10 @@ static void initial_bom_check(const struct sr_input *in)
 		return;
 	if (strncmp(in->buf->str, utf8_bom, strlen(utf8_bom)) != 0)
 		return;
-	g_string_erase(in->buf, 0, strlen(utf8_bom));
+	sr_input_buf_consume(in, strlen(utf8_bom));
 }
 
-static int initial_receive(const struct sr_input *in)
+static int initial_receive(struct sr_input *in)
 {
 	struct context *inc;
 	GString *new_buf;
@@ -1532,13 +1914,11 @@ static int initial_receive(const struct sr_input *in)
 static int process_buffer(struct sr_input *in, gboolean is_eof)
 {
 	struct context *inc;
-	gsize num_columns;
-	size_t line_idx, col_idx, col_nr;
+	size_t num_columns, col_idx, term_len;
 	const struct column_details *details;
-	col_parse_cb parse_func;
 	int ret;
 	char *processed_up_to;
-	char **lines, *line, **columns, *column;
+	char *line, *next_line, *column;
 
 	inc = in->priv;
 	if (!inc->started) {
@@ -1572,10 +1952,19 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 		processed_up_to += strlen(inc->termination);
 	}
 
-	/* Split input text lines and process their columns. */
+	/*
+	 * Split input text lines and process their columns. Lines get
+	 * terminated in place in the input buffer, which gets consumed
+	 * after processing. No memory is allocated per line or column.
+	 */
 	ret = SR_OK;
-	lines = g_strsplit(in->buf->str, inc->termination, 0);
-	for (line_idx = 0; (line = lines[line_idx]); line_idx++) {
+	term_len = strlen(inc->termination);
+	for (line = in->buf->str; line; line = next_line) {
+		next_line = strstr(line, inc->termination);
+		if (next_line) {
+			*next_line = '\0';
+			next_line += term_len;
+		}
 		inc->line_number++;
 		if (inc->line_number < inc->start_line) {
 			sr_spew("Line %zu skipped (before start).", inc->line_number);
@@ -1601,18 +1990,10 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 		}
 
 		/* Split the line into columns, check for minimum length. */
-		columns = split_line(line, inc);
-		if (!columns) {
-			sr_err("Error while parsing line %zu.", inc->line_number);
-			g_strfreev(lines);
-			return SR_ERR;
-		}
-		num_columns = g_strv_length(columns);
+		num_columns = tokenize_line(line, inc);
 		if (num_columns < inc->column_want_count) {
 			sr_err("Insufficient column count %zu in line %zu.",
 				num_columns, inc->line_number);
-			g_strfreev(columns);
-			g_strfreev(lines);
 			return SR_ERR;
 		}
 
@@ -1620,36 +2001,28 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 		clear_logic_samples(inc);
 		clear_analog_samples(inc);
 		for (col_idx = 0; col_idx < inc->column_want_count; col_idx++) {
-			column = columns[col_idx];
-			col_nr = col_idx + 1;
-			details = lookup_column_details(inc, col_nr);
-			if (!details || !details->text_format)
-				continue;
-			parse_func = col_parse_funcs[details->text_format];
-			if (!parse_func)
+			details = &inc->column_details[col_idx];
+			if (!details->parse_func)
 				continue;
-			ret = parse_func(column, inc, details);
-			if (ret != SR_OK) {
-				g_strfreev(columns);
-				g_strfreev(lines);
+			column = inc->column_texts[col_idx];
+			ret = details->parse_func(column, inc, details);
+			if (ret != SR_OK)
 				return SR_ERR;
-			}
 		}
 
 		/* Send sample data to the session bus (buffered). */
-		ret = queue_logic_samples(in);
-		ret += queue_analog_samples(in);
+		if (inc->sparse) {
+			ret = queue_sparse_row(in);
+		} else {
+			ret = queue_logic_samples(in);
+			ret += queue_analog_samples(in);
+		}
 		if (ret != SR_OK) {
 			sr_err("Sending samples failed.");
-			g_strfreev(columns);
-			g_strfreev(lines);
 			return SR_ERR;
 		}
-
-		g_strfreev(columns);
 	}
-	g_strfreev(lines);
-	g_string_erase(in->buf, 0, processed_up_to - in->buf->str);
+	sr_input_buf_consume(in, processed_up_to - in->buf->str);
 
 	return ret;
 }
@@ -1659,7 +2032,7 @@ static int receive(struct sr_input *in, GString *buf)
 	struct context *inc;
 	int ret;
 
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf->str, buf->len);
 
 	inc = in->priv;
 	if (!inc->column_seen_count) {
@@ -1692,6 +2065,13 @@ static int end(struct sr_input *in)
 	if (ret != SR_OK)
 		return ret;
 
+	inc = in->priv;
+	if (inc->sparse) {
+		ret = flush_sparse_row(in);
+		if (ret != SR_OK)
+			return ret;
+	}
+
 	ret = flush_logic_samples(in);
 	ret += flush_analog_samples(in);
 	if (ret != SR_OK)
@@ -1722,10 +2102,18 @@ static void cleanup(struct sr_input *in)
 	inc->analog_datafeed_buffer = NULL;
 	g_free(inc->analog_datafeed_digits);
 	inc->analog_datafeed_digits = NULL;
+	g_free(inc->row_logic);
+	g_free(inc->pending_logic);
+	g_free(inc->row_analog);
+	g_free(inc->pending_analog);
+	g_free(inc->rle.offsets);
+	g_free(inc->rle.values);
 	/* analog_datafeed_channels was released in keep_header_for_reread() */
 	/* TODO Release channel names (before releasing details). */
 	g_free(inc->column_details);
 	inc->column_details = NULL;
+	g_free(inc->column_texts);
+	inc->column_texts = NULL;
 
 	/* Clear internal state, but keep what .init() has provided. */
 	save_ctx = *inc;
@@ -1736,6 +2124,7 @@ static void cleanup(struct sr_input *in)
 	inc->column_formats = save_ctx.column_formats;
 	inc->start_line = save_ctx.start_line;
 	inc->use_header = save_ctx.use_header;
+	inc->sparse = save_ctx.sparse;
 	inc->prev_sr_channels = save_ctx.prev_sr_channels;
 	inc->prev_df_channels = save_ctx.prev_df_channels;
 }
@@ -1747,7 +2136,7 @@ static int reset(struct sr_input *in)
 	inc = in->priv;
 	cleanup(in);
 	inc->started = FALSE;
-	g_string_truncate(in->buf, 0);
+	sr_input_buf_clear(in);
 
 	return SR_OK;
 }
@@ -1763,6 +2152,7 @@ enum option_index {
 	OPT_SAMPLERATE,
 	OPT_COL_SEP,
 	OPT_COMMENT,
+	OPT_SPARSE,
 	OPT_MAX,
 };
 
@@ -1817,6 +2207,11 @@ static struct sr_option options[] = {
 		"The text which starts comments at the end of text lines, semicolon by default.",
 		NULL, NULL,
 	},
+	[OPT_SPARSE] = {
+		"sparse", "Rows are value changes",
+		"Each row's values last until the next row's timestamp (in seconds). Requires a timestamp column. Off by default.",
+		NULL, NULL,
+	},
 	[OPT_MAX] = ALL_ZERO,
 };
 
@@ -1840,6 +2235,7 @@ static const struct sr_option *get_options(void)
 		options[OPT_SAMPLERATE].def = g_variant_ref_sink(g_variant_new_uint64(0));
 		options[OPT_COL_SEP].def = g_variant_ref_sink(g_variant_new_string(","));
 		options[OPT_COMMENT].def = g_variant_ref_sink(g_variant_new_string(";"));
+		options[OPT_SPARSE].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
 	}
 
 	return options;
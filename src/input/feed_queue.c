@@ -29,6 +29,8 @@ struct feed_queue_logic {
 	uint8_t *data_bytes;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
+	struct sr_buffer_pool *pool;
+	struct sr_buffer *buffer;
 };
 
 SR_API struct feed_queue_logic *feed_queue_logic_alloc(
@@ -57,28 +59,130 @@ SR_API struct feed_queue_logic *feed_queue_logic_alloc(
 	return q;
 }
 
+/*
+ * Write a number of copies of a sample value. Callers often submit
+ * long runs of one value (run length encoded input data). Replicate
+ * the already written part, which takes few memcpy() calls for any
+ * count.
+ */
+static void fill_samples(uint8_t *wrptr, const uint8_t *data,
+	size_t unit_size, size_t count)
+{
+	size_t total, done, chunk;
+
+	if (unit_size == 1) {
+		memset(wrptr, data[0], count);
+		return;
+	}
+
+	total = count * unit_size;
+	memcpy(wrptr, data, unit_size);
+	done = unit_size;
+	while (done < total) {
+		chunk = MIN(done, total - done);
+		memcpy(&wrptr[done], wrptr, chunk);
+		done += chunk;
+	}
+}
+
 SR_API int feed_queue_logic_submit(struct feed_queue_logic *q,
 	const uint8_t *data, size_t count)
 {
 	uint8_t *wrptr;
+	size_t chunk;
 	int ret;
 
-	wrptr = &q->data_bytes[q->fill_count * q->unit_size];
-	while (count--) {
-		memcpy(wrptr, data, q->unit_size);
-		wrptr += q->unit_size;
-		q->fill_count++;
+	while (count) {
+		chunk = MIN(count, q->alloc_count - q->fill_count);
+		wrptr = &q->data_bytes[q->fill_count * q->unit_size];
+		fill_samples(wrptr, data, q->unit_size, chunk);
+		q->fill_count += chunk;
+		count -= chunk;
 		if (q->fill_count == q->alloc_count) {
 			ret = feed_queue_logic_flush(q);
 			if (ret != SR_OK)
 				return ret;
-			wrptr = &q->data_bytes[0];
 		}
 	}
 
 	return SR_OK;
 }
 
+/*
+ * Submit a number of distinct samples, which are stored back to back
+ * in the caller's buffer.
+ */
+SR_API int feed_queue_logic_submit_many(struct feed_queue_logic *q,
+	const uint8_t *data, size_t count)
+{
+	size_t chunk;
+	int ret;
+
+	while (count) {
+		chunk = MIN(count, q->alloc_count - q->fill_count);
+		memcpy(&q->data_bytes[q->fill_count * q->unit_size],
+			data, chunk * q->unit_size);
+		data += chunk * q->unit_size;
+		q->fill_count += chunk;
+		count -= chunk;
+		if (q->fill_count == q->alloc_count) {
+			ret = feed_queue_logic_flush(q);
+			if (ret != SR_OK)
+				return ret;
+		}
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Get the queue's free space for direct writes, which saves a copy
+ * when callers decode their input in place. The space holds at least
+ * one sample. Callers write up to the returned count of samples, then
+ * call feed_queue_logic_commit() with the number of written samples.
+ */
+SR_API uint8_t *feed_queue_logic_get_buffer(struct feed_queue_logic *q,
+	size_t *count)
+{
+	if (count)
+		*count = q->alloc_count - q->fill_count;
+
+	return &q->data_bytes[q->fill_count * q->unit_size];
+}
+
+SR_API int feed_queue_logic_commit(struct feed_queue_logic *q, size_t count)
+{
+	if (count > q->alloc_count - q->fill_count)
+		return SR_ERR_ARG;
+
+	q->fill_count += count;
+	if (q->fill_count == q->alloc_count)
+		return feed_queue_logic_flush(q);
+
+	return SR_OK;
+}
+
+/*
+ * Have the queue send its data from reference counted buffers. Consumers
+ * which keep packets then share the buffers instead of copying the data,
+ * and the queue continues in a fresh buffer when the previous one is in
+ * use elsewhere. Released buffers get recycled, keep up to max_idle.
+ */
+SR_API int feed_queue_logic_use_pool(struct feed_queue_logic *q,
+	size_t max_idle)
+{
+	if (q->pool || q->fill_count)
+		return SR_ERR_ARG;
+
+	q->pool = sr_buffer_pool_new(q->alloc_count * q->unit_size, max_idle);
+	q->buffer = sr_buffer_pool_get(q->pool);
+	g_free(q->data_bytes);
+	q->data_bytes = q->buffer->data;
+	q->logic.data = q->data_bytes;
+
+	return SR_OK;
+}
+
 SR_API int feed_queue_logic_flush(struct feed_queue_logic *q)
 {
 	int ret;
@@ -87,11 +191,21 @@ SR_API int feed_queue_logic_flush(struct feed_queue_logic *q)
 		return SR_OK;
 
 	q->logic.length = q->fill_count * q->unit_size;
-	ret = sr_session_send(q->sdi, &q->packet);
+	if (q->buffer)
+		ret = sr_session_send_buffer(q->sdi, &q->packet, q->buffer);
+	else
+		ret = sr_session_send(q->sdi, &q->packet);
 	if (ret != SR_OK)
 		return ret;
 	q->fill_count = 0;
 
+	if (q->buffer && sr_buffer_is_shared(q->buffer)) {
+		sr_buffer_unref(q->buffer);
+		q->buffer = sr_buffer_pool_get(q->pool);
+		q->data_bytes = q->buffer->data;
+		q->logic.data = q->data_bytes;
+	}
+
 	return SR_OK;
 }
 
@@ -116,12 +230,17 @@ SR_API void feed_queue_logic_free(struct feed_queue_logic *q)
 	if (!q)
 		return;
 
-	g_free(q->data_bytes);
+	if (q->buffer)
+		sr_buffer_unref(q->buffer);
+	else
+		g_free(q->data_bytes);
+	sr_buffer_pool_free(q->pool);
 	g_free(q);
 }
 
 struct feed_queue_analog {
 	const struct sr_dev_inst *sdi;
+	size_t num_channels;
 	size_t alloc_count;
 	size_t fill_count;
 	float *data_values;
@@ -132,6 +251,8 @@ struct feed_queue_analog {
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
 	GSList *channels;
+	struct sr_buffer_pool *pool;
+	struct sr_buffer *buffer;
 };
 
 SR_API struct feed_queue_analog *feed_queue_analog_alloc(
@@ -139,17 +260,37 @@ SR_API struct feed_queue_analog *feed_queue_analog_alloc(
 	size_t sample_count, int digits, struct sr_channel *ch)
 {
 	struct feed_queue_analog *q;
+	GSList *channels;
+
+	channels = g_slist_append(NULL, ch);
+	q = feed_queue_analog_alloc_channels(sdi, sample_count, digits, channels);
+	g_slist_free(channels);
+
+	return q;
+}
+
+/*
+ * Allocate a queue for interleaved samples of several channels, which
+ * get sent in common packets. Counts are in samples per channel, the
+ * data of such queues is written with feed_queue_analog_get_buffer().
+ */
+SR_API struct feed_queue_analog *feed_queue_analog_alloc_channels(
+	const struct sr_dev_inst *sdi,
+	size_t sample_count, int digits, GSList *channels)
+{
+	struct feed_queue_analog *q;
 
 	q = g_malloc0(sizeof(*q));
 	q->sdi = sdi;
+	q->num_channels = g_slist_length(channels);
 	q->alloc_count = sample_count;
-	q->data_values = g_try_malloc(q->alloc_count * sizeof(float));
+	q->data_values = g_try_malloc(q->alloc_count * q->num_channels * sizeof(float));
 	if (!q->data_values) {
 		g_free(q);
 		return NULL;
 	}
 	q->digits = digits;
-	q->channels = g_slist_append(NULL, ch);
+	q->channels = g_slist_copy(channels);
 
 	memset(&q->packet, 0, sizeof(q->packet));
 	sr_analog_init(&q->analog, &q->encoding, &q->meaning, &q->spec, digits);
@@ -167,6 +308,9 @@ SR_API int feed_queue_analog_submit(struct feed_queue_analog *q,
 {
 	int ret;
 
+	if (q->num_channels != 1)
+		return SR_ERR_ARG;
+
 	while (count--) {
 		q->data_values[q->fill_count++] = data;
 		if (q->fill_count == q->alloc_count) {
@@ -179,6 +323,45 @@ SR_API int feed_queue_analog_submit(struct feed_queue_analog *q,
 	return SR_OK;
 }
 
+/* See feed_queue_logic_get_buffer(), samples are interleaved floats. */
+SR_API float *feed_queue_analog_get_buffer(struct feed_queue_analog *q,
+	size_t *count)
+{
+	if (count)
+		*count = q->alloc_count - q->fill_count;
+
+	return &q->data_values[q->fill_count * q->num_channels];
+}
+
+SR_API int feed_queue_analog_commit(struct feed_queue_analog *q, size_t count)
+{
+	if (count > q->alloc_count - q->fill_count)
+		return SR_ERR_ARG;
+
+	q->fill_count += count;
+	if (q->fill_count == q->alloc_count)
+		return feed_queue_analog_flush(q);
+
+	return SR_OK;
+}
+
+/* See feed_queue_logic_use_pool(). */
+SR_API int feed_queue_analog_use_pool(struct feed_queue_analog *q,
+	size_t max_idle)
+{
+	if (q->pool || q->fill_count)
+		return SR_ERR_ARG;
+
+	q->pool = sr_buffer_pool_new(q->alloc_count * q->num_channels * sizeof(float),
+		max_idle);
+	q->buffer = sr_buffer_pool_get(q->pool);
+	g_free(q->data_values);
+	q->data_values = (float *)q->buffer->data;
+	q->analog.data = q->data_values;
+
+	return SR_OK;
+}
+
 SR_API int feed_queue_analog_flush(struct feed_queue_analog *q)
 {
 	int ret;
@@ -187,11 +370,21 @@ SR_API int feed_queue_analog_flush(struct feed_queue_analog *q)
 		return SR_OK;
 
 	q->analog.num_samples = q->fill_count;
-	ret = sr_session_send(q->sdi, &q->packet);
+	if (q->buffer)
+		ret = sr_session_send_buffer(q->sdi, &q->packet, q->buffer);
+	else
+		ret = sr_session_send(q->sdi, &q->packet);
 	if (ret != SR_OK)
 		return ret;
 	q->fill_count = 0;
 
+	if (q->buffer && sr_buffer_is_shared(q->buffer)) {
+		sr_buffer_unref(q->buffer);
+		q->buffer = sr_buffer_pool_get(q->pool);
+		q->data_values = (float *)q->buffer->data;
+		q->analog.data = q->data_values;
+	}
+
 	return SR_OK;
 }
 
@@ -201,7 +394,11 @@ SR_API void feed_queue_analog_free(struct feed_queue_analog *q)
 	if (!q)
 		return;
 
-	g_free(q->data_values);
+	if (q->buffer)
+		sr_buffer_unref(q->buffer);
+	else
+		g_free(q->data_values);
+	sr_buffer_pool_free(q->pool);
 	g_slist_free(q->channels);
 	g_free(q);
 }
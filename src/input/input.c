@@ -19,9 +19,11 @@
 
 #include <config.h>
 #include <string.h>
-#include <errno.h>
 #include <glib.h>
 #include <glib/gstdio.h>
+#ifdef G_OS_UNIX
+#include <sys/mman.h>
+#endif
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -31,6 +33,15 @@
 
 /** @cond PRIVATE */
 #define CHUNK_SIZE	(4 * 1024 * 1024)
+
+/*
+ * A match at this confidence ends format detection, modules which match
+ * on a magic signature report it. Headers of at least SCAN_PARALLEL_MIN
+ * bytes get their matchers run concurrently, for smaller ones handing
+ * the work to threads costs more than it saves.
+ */
+#define SCAN_CONFIDENT		1
+#define SCAN_PARALLEL_MIN	(64 * 1024)
 /** @endcond */
 
 /**
@@ -65,6 +76,7 @@
 /** @cond PRIVATE */
 extern SR_PRIV struct sr_input_module input_chronovu_la8;
 extern SR_PRIV struct sr_input_module input_csv;
+extern SR_PRIV struct sr_input_module input_srzip;
 extern SR_PRIV struct sr_input_module input_binary;
 extern SR_PRIV struct sr_input_module input_stf;
 extern SR_PRIV struct sr_input_module input_trace32_ad;
@@ -80,6 +92,9 @@ static const struct sr_input_module *input_module_list[] = {
 	&input_binary,
 	&input_chronovu_la8,
 	&input_csv,
+#if defined HAVE_INPUT_SRZIP && HAVE_INPUT_SRZIP
+	&input_srzip,
+#endif
 #if defined HAVE_INPUT_STF && HAVE_INPUT_STF
 	&input_stf,
 #endif
@@ -242,6 +257,143 @@ SR_API void sr_input_options_free(const struct sr_option **options)
 	g_free(options);
 }
 
+/* Point the view at the unconsumed part of the buffer. */
+static void buf_view_update(struct sr_input *in)
+{
+	in->buf_view.str = in->buf_store->str + in->buf_pos;
+	in->buf_view.len = in->buf_store->len - in->buf_pos;
+	in->buf_view.allocated_len = in->buf_store->allocated_len - in->buf_pos;
+}
+
+/**
+ * Append received data to the buffer of an input instance.
+ *
+ * Data which was consumed before only gets dropped from the storage
+ * when it would have to grow otherwise, that moves just the part which
+ * is left.
+ *
+ * @private
+ */
+SR_PRIV void sr_input_buf_append(struct sr_input *in, const void *data,
+		size_t length)
+{
+	GString *store;
+	gsize allocated;
+
+	store = in->buf_store;
+	if (in->buf_pos && store->len + length >= store->allocated_len) {
+		memmove(store->str, store->str + in->buf_pos,
+			store->len - in->buf_pos);
+		g_string_truncate(store, store->len - in->buf_pos);
+		in->buf_pos = 0;
+	}
+	allocated = store->allocated_len;
+	g_string_append_len(store, data, length);
+	if (store->allocated_len != allocated) {
+		sr_mem_free_add(SR_MEM_INPUT, allocated);
+		sr_mem_alloc_add(SR_MEM_INPUT, store->allocated_len);
+	}
+	buf_view_update(in);
+}
+
+/**
+ * Drop data from the front of the buffer of an input instance, once the
+ * module processed it.
+ *
+ * @private
+ */
+SR_PRIV void sr_input_buf_consume(struct sr_input *in, size_t length)
+{
+	in->buf_pos += MIN(length, in->buf_view.len);
+	if (in->buf_pos == in->buf_store->len) {
+		g_string_truncate(in->buf_store, 0);
+		in->buf_pos = 0;
+	}
+	buf_view_update(in);
+}
+
+/**
+ * Drop all data from the buffer of an input instance.
+ *
+ * @private
+ */
+SR_PRIV void sr_input_buf_clear(struct sr_input *in)
+{
+	g_string_truncate(in->buf_store, 0);
+	in->buf_pos = 0;
+	buf_view_update(in);
+}
+
+/**
+ * Keep the text of the header which a module parsed, as a snapshot for
+ * re-reads of the input.
+ *
+ * A module which keeps the results of parsing the header across its
+ * reset() can then recognize the re-sent header by its text, with
+ * sr_input_header_skip(), instead of parsing it again.
+ *
+ * @param[in] in The input instance.
+ * @param[in] text The header text, exactly as it was received.
+ * @param[in] len The length of the header text.
+ *
+ * @private
+ */
+SR_PRIV void sr_input_header_keep(struct sr_input *in,
+		const char *text, size_t len)
+{
+	if (in->header)
+		g_string_free(in->header, TRUE);
+	in->header = g_string_new_len(text, len);
+}
+
+/**
+ * Drop the header snapshot, see sr_input_header_keep().
+ *
+ * @private
+ */
+SR_PRIV void sr_input_header_drop(struct sr_input *in)
+{
+	if (in->header)
+		g_string_free(in->header, TRUE);
+	in->header = NULL;
+}
+
+/**
+ * Check whether the received data starts with the header which was kept
+ * by sr_input_header_keep(), and consume it when it does.
+ *
+ * @param[in] in The input instance.
+ *
+ * @retval SR_OK The header was recognized and consumed.
+ * @retval SR_ERR_NA Not enough data to tell yet.
+ * @retval SR_ERR_DATA No header was kept, or the data has a different
+ *                     header. The snapshot is dropped, the module must
+ *                     parse the header.
+ *
+ * @private
+ */
+SR_PRIV int sr_input_header_skip(struct sr_input *in)
+{
+	size_t len;
+
+	if (!in->header)
+		return SR_ERR_DATA;
+
+	len = MIN(in->buf->len, in->header->len);
+	if (memcmp(in->buf->str, in->header->str, len) != 0) {
+		sr_dbg("Header changed, parsing it again.");
+		sr_input_header_drop(in);
+		return SR_ERR_DATA;
+	}
+	if (len < in->header->len)
+		return SR_ERR_NA;
+
+	sr_input_buf_consume(in, len);
+	sr_spew("Skipped %zu bytes of known header.", len);
+
+	return SR_OK;
+}
+
 /**
  * Create a new input instance using the specified input module.
  *
@@ -313,7 +465,10 @@ SR_API struct sr_input *sr_input_new(const struct sr_input_module *imod,
 		g_free(in);
 		in = NULL;
 	} else {
-		in->buf = g_string_sized_new(128);
+		in->buf_store = g_string_sized_new(128);
+		sr_mem_alloc_add(SR_MEM_INPUT, in->buf_store->allocated_len);
+		in->buf = &in->buf_view;
+		buf_view_update(in);
 	}
 
 	if (new_opts)
@@ -344,6 +499,196 @@ static gboolean check_required_metadata(const uint8_t *metadata, uint8_t *avail)
 	return TRUE;
 }
 
+/* Returns TRUE if the module handles one of the extensions, or all are OK. */
+static gboolean check_extensions(const struct sr_input_module *imod,
+		const char *const *exts)
+{
+	const char *ext;
+	unsigned int i, j;
+
+	if (!exts)
+		return TRUE;
+	if (!imod->exts)
+		return FALSE;
+	for (i = 0; exts[i]; i++) {
+		ext = exts[i];
+		if (*ext == '.')
+			ext++;
+		for (j = 0; imod->exts[j]; j++) {
+			if (!g_ascii_strcasecmp(ext, imod->exts[j]))
+				return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/* Returns TRUE if the module uses any of the available meta items. */
+static gboolean check_any_metadata(const uint8_t *metadata, uint8_t *avail)
+{
+	unsigned int m, a;
+
+	for (m = 0; m < 8 && metadata[m]; m++) {
+		for (a = 0; avail[a]; a++) {
+			if (avail[a] == (metadata[m] & ~SR_INPUT_META_REQUIRED))
+				return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+struct scan_context;
+
+struct scan_job {
+	struct scan_context *ctx;
+	unsigned int index;
+	const struct sr_input_module *imod;
+	int ret;
+	unsigned int conf;
+};
+
+struct scan_context {
+	GHashTable *meta;
+	struct scan_job *jobs;
+	unsigned int num_jobs;
+	/* Jobs after the first confident match need not run. */
+	unsigned int cutoff;
+	unsigned int pending;
+	GMutex mutex;
+	GCond cond;
+};
+
+static void scan_job_run(struct scan_job *job)
+{
+	sr_spew("Trying module %s.", job->imod->id);
+	job->ret = job->imod->format_match(job->ctx->meta, &job->conf);
+	if (job->ret == SR_OK)
+		sr_spew("Module %s matched, confidence %u.",
+			job->imod->id, job->conf);
+}
+
+static void scan_worker(gpointer data, gpointer user_data)
+{
+	struct scan_job *job;
+	struct scan_context *ctx;
+	gboolean skip;
+
+	(void)user_data;
+
+	job = data;
+	ctx = job->ctx;
+	g_mutex_lock(&ctx->mutex);
+	skip = job->index > ctx->cutoff;
+	g_mutex_unlock(&ctx->mutex);
+	if (!skip)
+		scan_job_run(job);
+
+	g_mutex_lock(&ctx->mutex);
+	if (!skip && job->ret == SR_OK && job->conf <= SCAN_CONFIDENT)
+		ctx->cutoff = MIN(ctx->cutoff, job->index);
+	if (--ctx->pending == 0)
+		g_cond_signal(&ctx->cond);
+	g_mutex_unlock(&ctx->mutex);
+}
+
+/* The pool is shared by all scans, its threads are started on demand. */
+static GThreadPool *scan_pool_get(void)
+{
+	static gsize pool;
+
+	if (g_once_init_enter(&pool)) {
+		g_once_init_leave(&pool, (gsize)g_thread_pool_new(scan_worker,
+			NULL, g_get_num_processors(), FALSE, NULL));
+	}
+
+	return (GThreadPool *)pool;
+}
+
+/*
+ * Run the format matchers of all modules which can use the metadata and
+ * handle one of the extensions (if any are given), and return the module
+ * with the best confidence. Ties go to the module listed first, exactly
+ * as when the matchers run one after another.
+ */
+static const struct sr_input_module *scan_modules(GHashTable *meta,
+		uint8_t *avail, const char *const *exts, gboolean parallel)
+{
+	const struct sr_input_module *imod, *best_imod;
+	struct scan_context ctx;
+	struct scan_job *job;
+	GThreadPool *pool;
+	unsigned int i, best_conf;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.meta = meta;
+	ctx.jobs = g_malloc0(sizeof(struct scan_job) * G_N_ELEMENTS(input_module_list));
+	for (i = 0; input_module_list[i]; i++) {
+		imod = input_module_list[i];
+		if (!imod->metadata[0]) {
+			/* Module has no metadata for matching so will take
+			 * any input. No point in letting it try to match. */
+			continue;
+		}
+		if (!check_required_metadata(imod->metadata, avail))
+			/* Cannot satisfy this module's requirements. */
+			continue;
+		if (!check_any_metadata(imod->metadata, avail))
+			/* No metadata for this module, so nothing to match. */
+			continue;
+		if (!check_extensions(imod, exts))
+			continue;
+		job = &ctx.jobs[ctx.num_jobs];
+		job->ctx = &ctx;
+		job->index = ctx.num_jobs++;
+		job->imod = imod;
+		job->ret = SR_ERR_NA;
+	}
+	ctx.cutoff = ctx.num_jobs;
+
+	pool = NULL;
+	if (parallel && ctx.num_jobs > 1 && g_get_num_processors() > 1)
+		pool = scan_pool_get();
+	if (pool) {
+		g_mutex_init(&ctx.mutex);
+		g_cond_init(&ctx.cond);
+		ctx.pending = ctx.num_jobs;
+		for (i = 0; i < ctx.num_jobs; i++)
+			g_thread_pool_push(pool, &ctx.jobs[i], NULL);
+		g_mutex_lock(&ctx.mutex);
+		while (ctx.pending)
+			g_cond_wait(&ctx.cond, &ctx.mutex);
+		g_mutex_unlock(&ctx.mutex);
+		g_cond_clear(&ctx.cond);
+		g_mutex_clear(&ctx.mutex);
+	} else {
+		for (i = 0; i < ctx.num_jobs; i++) {
+			job = &ctx.jobs[i];
+			scan_job_run(job);
+			if (job->ret == SR_OK && job->conf <= SCAN_CONFIDENT)
+				break;
+		}
+	}
+
+	/*
+	 * SR_ERR_DATA means the module recognized the data but cannot
+	 * handle it, SR_ERR that it didn't recognize it, and SR_ERR_NA
+	 * that there was not enough data to tell.
+	 */
+	best_imod = NULL;
+	best_conf = ~0;
+	for (i = 0; i < ctx.num_jobs && i <= ctx.cutoff; i++) {
+		job = &ctx.jobs[i];
+		if (job->ret != SR_OK || job->conf >= best_conf)
+			continue;
+		best_imod = job->imod;
+		best_conf = job->conf;
+	}
+	g_free(ctx.jobs);
+
+	return best_imod;
+}
+
 /**
  * Try to find an input module that can parse the given buffer.
  *
@@ -367,73 +712,77 @@ static gboolean check_required_metadata(const uint8_t *metadata, uint8_t *avail)
  */
 SR_API int sr_input_scan_buffer(GString *buf, const struct sr_input **in)
 {
-	const struct sr_input_module *imod, *best_imod;
+	return sr_input_scan_buffer_ext(buf, NULL, in);
+}
+
+/**
+ * Try to find an input module that can parse the given buffer, among the
+ * modules which handle one of the given file name extensions.
+ *
+ * This works like sr_input_scan_buffer(), see there. Restricting the
+ * candidates saves running the format matchers of the other modules,
+ * some of which parse a good part of the buffer.
+ *
+ * @param buf The beginning of the input data. Must not be NULL.
+ * @param exts NULL terminated list of extensions, with or without the
+ *   leading dot. NULL tries all input modules.
+ * @param in The created input instance, or NULL if no match was found.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_input_scan_buffer_ext(GString *buf, const char *const *exts,
+		const struct sr_input **in)
+{
+	const struct sr_input_module *best_imod;
 	GHashTable *meta;
-	unsigned int m, i;
-	unsigned int conf, best_conf;
-	int ret;
-	uint8_t mitem, avail_metadata[8];
+	uint8_t avail_metadata[8];
 
 	/* No more metadata to be had from a buffer. */
 	avail_metadata[0] = SR_INPUT_META_HEADER;
 	avail_metadata[1] = 0;
 
 	*in = NULL;
-	best_imod = NULL;
-	best_conf = ~0;
-	for (i = 0; input_module_list[i]; i++) {
-		imod = input_module_list[i];
-		if (!imod->metadata[0]) {
-			/* Module has no metadata for matching so will take
-			 * any input. No point in letting it try to match. */
-			continue;
-		}
-		if (!check_required_metadata(imod->metadata, avail_metadata))
-			/* Cannot satisfy this module's requirements. */
-			continue;
-
-		meta = g_hash_table_new(NULL, NULL);
-		for (m = 0; m < sizeof(imod->metadata); m++) {
-			mitem = imod->metadata[m] & ~SR_INPUT_META_REQUIRED;
-			if (mitem == SR_INPUT_META_HEADER)
-				g_hash_table_insert(meta, GINT_TO_POINTER(mitem), buf);
-		}
-		if (g_hash_table_size(meta) == 0) {
-			/* No metadata for this module, so nothing to match. */
-			g_hash_table_destroy(meta);
-			continue;
-		}
-		sr_spew("Trying module %s.", imod->id);
-		ret = imod->format_match(meta, &conf);
-		g_hash_table_destroy(meta);
-		if (ret == SR_ERR_DATA) {
-			/* Module recognized this buffer, but cannot handle it. */
-			continue;
-		} else if (ret == SR_ERR) {
-			/* Module didn't recognize this buffer. */
-			continue;
-		} else if (ret != SR_OK) {
-			/* Can be SR_ERR_NA. */
-			continue;
-		}
-
-		/* Found a matching module. */
-		sr_spew("Module %s matched, confidence %u.", imod->id, conf);
-		if (conf >= best_conf)
-			continue;
-		best_imod = imod;
-		best_conf = conf;
-	}
+	meta = g_hash_table_new(NULL, NULL);
+	g_hash_table_insert(meta, GINT_TO_POINTER(SR_INPUT_META_HEADER), buf);
+	best_imod = scan_modules(meta, avail_metadata, exts,
+		buf->len >= SCAN_PARALLEL_MIN);
+	g_hash_table_destroy(meta);
 
 	if (best_imod) {
 		*in = sr_input_new(best_imod, NULL);
-		g_string_insert_len((*in)->buf, 0, buf->str, buf->len);
+		sr_input_buf_append((struct sr_input *)*in, buf->str, buf->len);
 		return SR_OK;
 	}
 
 	return SR_ERR;
 }
 
+/*
+ * Map a file for reading. The mapping is private, so that writes to it
+ * (e.g. by transforms which modify packets in place) never reach the file.
+ */
+static GMappedFile *map_file(const char *filename)
+{
+	GMappedFile *mapped;
+	GError *error;
+
+	error = NULL;
+	mapped = g_mapped_file_new(filename, TRUE, &error);
+	if (!mapped) {
+		sr_err("Failed to map %s: %s", filename, error->message);
+		g_error_free(error);
+		return NULL;
+	}
+#if defined(G_OS_UNIX) && defined(POSIX_MADV_SEQUENTIAL)
+	/* Input files get read front to back, let the kernel read ahead. */
+	if (g_mapped_file_get_length(mapped) > 0)
+		posix_madvise(g_mapped_file_get_contents(mapped),
+			g_mapped_file_get_length(mapped), POSIX_MADV_SEQUENTIAL);
+#endif
+
+	return mapped;
+}
+
 /**
  * Try to find an input module that can parse the given file.
  *
@@ -445,15 +794,31 @@ SR_API int sr_input_scan_buffer(GString *buf, const struct sr_input **in)
  */
 SR_API int sr_input_scan_file(const char *filename, const struct sr_input **in)
 {
-	int64_t filesize;
-	FILE *stream;
-	const struct sr_input_module *imod, *best_imod;
+	return sr_input_scan_file_ext(filename, NULL, in);
+}
+
+/**
+ * Try to find an input module that can parse the given file, among the
+ * modules which handle one of the given file name extensions.
+ *
+ * This works like sr_input_scan_file(), see there.
+ *
+ * @param filename The file to scan. Must not be NULL.
+ * @param exts NULL terminated list of extensions, with or without the
+ *   leading dot. NULL tries all input modules.
+ * @param in The created input instance, or NULL if no match was found.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_input_scan_file_ext(const char *filename,
+		const char *const *exts, const struct sr_input **in)
+{
+	GMappedFile *mapped;
+	size_t filesize;
+	const struct sr_input_module *best_imod;
 	GHashTable *meta;
 	GString *header;
-	size_t count;
-	unsigned int midx, i;
-	unsigned int conf, best_conf;
-	int ret;
+	unsigned int midx;
 	uint8_t avail_metadata[8];
 
 	*in = NULL;
@@ -462,34 +827,23 @@ SR_API int sr_input_scan_file(const char *filename, const struct sr_input **in)
 		sr_err("Invalid filename.");
 		return SR_ERR_ARG;
 	}
-	stream = g_fopen(filename, "rb");
-	if (!stream) {
-		sr_err("Failed to open %s: %s", filename, g_strerror(errno));
-		return SR_ERR;
-	}
-	filesize = sr_file_get_size(stream);
-	if (filesize < 0) {
-		sr_err("Failed to get size of %s: %s",
-			filename, g_strerror(errno));
-		fclose(stream);
+	if (!(mapped = map_file(filename)))
 		return SR_ERR;
-	}
-	header = g_string_sized_new(CHUNK_SIZE);
-	count = fread(header->str, 1, header->allocated_len - 1, stream);
-	if (count < 1 || ferror(stream)) {
-		sr_err("Failed to read %s: %s", filename, g_strerror(errno));
-		fclose(stream);
-		g_string_free(header, TRUE);
+	filesize = g_mapped_file_get_length(mapped);
+	if (filesize < 1) {
+		sr_err("Failed to read %s: empty file", filename);
+		g_mapped_file_unref(mapped);
 		return SR_ERR;
 	}
-	fclose(stream);
-	g_string_set_size(header, count);
+	header = g_string_new_len(g_mapped_file_get_contents(mapped),
+		MIN(filesize, CHUNK_SIZE));
+	g_mapped_file_unref(mapped);
 
 	meta = g_hash_table_new(NULL, NULL);
 	g_hash_table_insert(meta, GINT_TO_POINTER(SR_INPUT_META_FILENAME),
 			(char *)filename);
 	g_hash_table_insert(meta, GINT_TO_POINTER(SR_INPUT_META_FILESIZE),
-			GSIZE_TO_POINTER(MIN(filesize, G_MAXSSIZE)));
+			GSIZE_TO_POINTER(MIN(filesize, (size_t)G_MAXSSIZE)));
 	g_hash_table_insert(meta, GINT_TO_POINTER(SR_INPUT_META_HEADER),
 			header);
 	midx = 0;
@@ -499,36 +853,8 @@ SR_API int sr_input_scan_file(const char *filename, const struct sr_input **in)
 	avail_metadata[midx] = 0;
 	/* TODO: MIME type */
 
-	best_imod = NULL;
-	best_conf = ~0;
-	for (i = 0; input_module_list[i]; i++) {
-		imod = input_module_list[i];
-		if (!imod->metadata[0]) {
-			/* Module has no metadata for matching so will take
-			 * any input. No point in letting it try to match. */
-			continue;
-		}
-		if (!check_required_metadata(imod->metadata, avail_metadata))
-			/* Cannot satisfy this module's requirements. */
-			continue;
-
-		sr_dbg("Trying module %s.", imod->id);
-
-		ret = imod->format_match(meta, &conf);
-		if (ret == SR_ERR) {
-			/* Module didn't recognize this buffer. */
-			continue;
-		} else if (ret != SR_OK) {
-			/* Module recognized this buffer, but cannot handle it. */
-			continue;
-		}
-		/* Found a matching module. */
-		sr_dbg("Module %s matched, confidence %u.", imod->id, conf);
-		if (conf >= best_conf)
-			continue;
-		best_imod = imod;
-		best_conf = conf;
-	}
+	best_imod = scan_modules(meta, avail_metadata, exts,
+		header->len >= SCAN_PARALLEL_MIN);
 	g_hash_table_destroy(meta);
 	g_string_free(header, TRUE);
 
@@ -591,10 +917,163 @@ SR_API struct sr_dev_inst *sr_input_dev_inst_get(const struct sr_input *in)
 SR_API int sr_input_send(const struct sr_input *in, GString *buf)
 {
 	size_t len;
+	int ret, tag;
 
 	len = buf ? buf->len : 0;
 	sr_spew("Sending %zu bytes to %s module.", len, in->module->id);
-	return in->module->receive((struct sr_input *)in, buf);
+	tag = sr_mem_tag_enter(SR_MEM_INPUT);
+	ret = in->module->receive((struct sr_input *)in, buf);
+	sr_mem_tag_leave(tag);
+
+	return ret;
+}
+
+/**
+ * Send data to the specified input instance, without copying it.
+ *
+ * Like sr_input_send(), but the data is passed to the input module as
+ * is. Modules which support it send packets which point straight into
+ * the data once the device instance is ready, and consumers of the
+ * packets may modify it in place. The data only needs to stay valid
+ * until this returns.
+ *
+ * @param in The input instance to use. Must not be NULL.
+ * @param data The data.
+ * @param length The number of bytes in data.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval other Error code returned by the input module.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_input_send_data(const struct sr_input *in_ro, void *data,
+		size_t length)
+{
+	struct sr_input *in;
+	GString view;
+	int ret, tag;
+
+	in = (struct sr_input *)in_ro;
+	if (!in || (!data && length))
+		return SR_ERR_ARG;
+
+	if (in->sdi_ready && in->module->receive_mapped) {
+		sr_spew("Sending %zu bytes in place to %s module.",
+			length, in->module->id);
+		tag = sr_mem_tag_enter(SR_MEM_INPUT);
+		ret = in->module->receive_mapped(in, data, length);
+		sr_mem_tag_leave(tag);
+		return ret;
+	}
+
+	/* Modules only read the buffer, a view of the data will do. */
+	view.str = data;
+	view.len = length;
+	view.allocated_len = length;
+
+	return sr_input_send(in, &view);
+}
+
+/**
+ * Map a file into memory, for sending it to the specified input instance
+ * with sr_input_send_mapped().
+ *
+ * Any previously mapped file is released. The mapping is kept until the
+ * instance gets freed.
+ *
+ * @param in The input instance to use. Must not be NULL.
+ * @param filename The file to map. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The file could not be mapped.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_input_map_file(const struct sr_input *in_ro, const char *filename)
+{
+	struct sr_input *in;
+	GMappedFile *mapped;
+
+	in = (struct sr_input *)in_ro;
+	if (!in || !filename || !filename[0])
+		return SR_ERR_ARG;
+	if (!(mapped = map_file(filename)))
+		return SR_ERR;
+	if (in->mapped)
+		g_mapped_file_unref(in->mapped);
+	in->mapped = mapped;
+	in->mapped_pos = 0;
+
+	return SR_OK;
+}
+
+/**
+ * Send the file mapped by sr_input_map_file() to the specified input
+ * instance.
+ *
+ * Like sr_input_send(), this returns the moment the device instance is
+ * ready, so a first call feeds just enough data to populate it. The
+ * next call sends the remainder of the file. Input modules which support
+ * it get handed views into the mapping instead of copies, and send
+ * packets which point straight into it.
+ *
+ * @param in The input instance to use. Must not be NULL.
+ *
+ * @retval SR_OK Success. The device instance may still not be ready,
+ *   if the file ended before the module could populate it.
+ * @retval SR_ERR_ARG Invalid argument, or no file was mapped.
+ * @retval other Error code returned by the input module.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_input_send_mapped(const struct sr_input *in_ro)
+{
+	struct sr_input *in;
+	GString *buf;
+	uint8_t *data;
+	size_t len, chunk;
+	gboolean was_ready;
+	int ret, tag;
+
+	in = (struct sr_input *)in_ro;
+	if (!in || !in->mapped)
+		return SR_ERR_ARG;
+
+	data = (uint8_t *)g_mapped_file_get_contents(in->mapped);
+	len = g_mapped_file_get_length(in->mapped);
+	if (in->mapped_pos >= len)
+		return SR_OK;
+
+	was_ready = in->sdi_ready;
+	if (was_ready && in->module->receive_mapped) {
+		sr_spew("Sending %zu mapped bytes to %s module.",
+			len - in->mapped_pos, in->module->id);
+		tag = sr_mem_tag_enter(SR_MEM_INPUT);
+		ret = in->module->receive_mapped(in, data + in->mapped_pos,
+			len - in->mapped_pos);
+		sr_mem_tag_leave(tag);
+		in->mapped_pos = len;
+		return ret;
+	}
+
+	/* Copy chunks until the device instance is ready, or to the end. */
+	ret = SR_OK;
+	buf = g_string_sized_new(MIN(len - in->mapped_pos, CHUNK_SIZE) + 1);
+	while (in->mapped_pos < len) {
+		chunk = MIN(len - in->mapped_pos, CHUNK_SIZE);
+		g_string_truncate(buf, 0);
+		g_string_append_len(buf, (const char *)data + in->mapped_pos, chunk);
+		in->mapped_pos += chunk;
+		if ((ret = sr_input_send(in, buf)) != SR_OK)
+			break;
+		if (!was_ready && in->sdi_ready)
+			break;
+	}
+	g_string_free(buf, TRUE);
+
+	return ret;
 }
 
 /**
@@ -607,8 +1086,14 @@ SR_API int sr_input_send(const struct sr_input *in, GString *buf)
  */
 SR_API int sr_input_end(const struct sr_input *in)
 {
+	int ret, tag;
+
 	sr_spew("Calling end() on %s module.", in->module->id);
-	return in->module->end((struct sr_input *)in);
+	tag = sr_mem_tag_enter(SR_MEM_INPUT);
+	ret = in->module->end((struct sr_input *)in);
+	sr_mem_tag_leave(tag);
+
+	return ret;
 }
 
 /**
@@ -618,6 +1103,9 @@ SR_API int sr_input_end(const struct sr_input *in)
  * the input data from the beginning without having to re-create the entire
  * input module.
  *
+ * Modules which support it keep the results of parsing the header, and
+ * skip the header when the same one is sent again.
+ *
  * @since 0.5.0
  */
 SR_API int sr_input_reset(const struct sr_input *in_ro)
@@ -659,8 +1147,9 @@ SR_API int sr_input_reset(const struct sr_input *in_ro)
 	 * rely on common code and keep working across resets.
 	 */
 	if (in->buf)
-		g_string_truncate(in->buf, 0);
+		sr_input_buf_clear(in);
 	in->sdi_ready = FALSE;
+	in->mapped_pos = 0;
 
 	return rc;
 }
@@ -689,12 +1178,16 @@ SR_API void sr_input_free(const struct sr_input *in)
 	 * .cleanup() released potentially nested resources under 'inc').
 	 */
 	sr_dev_inst_free(in->sdi);
+	sr_input_header_drop((struct sr_input *)in);
 	if (in->buf->len > 64) {
 		/* That seems more than just some sub-unitsize leftover... */
 		sr_warn("Found %" G_GSIZE_FORMAT
 			" unprocessed bytes at free time.", in->buf->len);
 	}
-	g_string_free(in->buf, TRUE);
+	sr_mem_free_add(SR_MEM_INPUT, in->buf_store->allocated_len);
+	g_string_free(in->buf_store, TRUE);
+	if (in->mapped)
+		g_mapped_file_unref(in->mapped);
 	g_free(in->priv);
 	g_free((gpointer)in);
 }
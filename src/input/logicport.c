@@ -415,32 +415,41 @@ static int process_inverted_channels(struct context *inc, char **flags)
 	return SR_OK;
 }
 
-static int process_sample_line(struct context *inc, char **values)
+static int process_sample_line(struct context *inc, char *line)
 {
-	size_t count, idx;
+	size_t idx;
 	struct sample_data_entry *entry;
-	uint64_t mask;
+	uint64_t mask, bits, undefined;
+	const char *field, *sep;
 	long conv_ret;
 	int rc;
 
 	/*
-	 * The 'values' array contains '0'/'1' text representation of
-	 * wire's values, as well as a (a textual representation of a)
-	 * repeat counter for that set of samples.
+	 * The line contains comma separated '0'/'1' text representation
+	 * of wire's values, as well as a (a textual representation of a)
+	 * repeat counter for that set of samples. Inspect the fields in
+	 * place, the data section can have millions of lines.
 	 */
-	count = g_strv_length(values);
-	if (count != inc->channel_count + 1)
-		return SR_ERR_DATA;
 	entry = &inc->sample_data_queue[inc->sample_lines_read];
-	entry->bits = 0;
+	bits = 0;
+	undefined = 0;
 	mask = UINT64_C(1);
+	field = line;
 	for (idx = 0; idx < inc->channel_count; idx++, mask <<= 1) {
-		if (strcmp(values[idx], "1") == 0)
-			entry->bits |= mask;
-		if (strcmp(values[idx], "U") == 0)
-			inc->wires_undefined |= mask;
+		sep = strchr(field, ',');
+		if (!sep)
+			return SR_ERR_DATA;
+		if (sep - field == 1 && field[0] == '1')
+			bits |= mask;
+		else if (sep - field == 1 && field[0] == 'U')
+			undefined |= mask;
+		field = sep + 1;
 	}
-	rc = sr_atol(values[inc->channel_count], &conv_ret);
+	if (strchr(field, ','))
+		return SR_ERR_DATA;
+	entry->bits = bits;
+	inc->wires_undefined |= undefined;
+	rc = sr_atol(field, &conv_ret);
 	if (rc != SR_OK)
 		return rc;
 	entry->repeat = conv_ret;
@@ -489,9 +498,7 @@ static int process_keyvalue_line(struct context *inc, char *line)
 	case SAMPLEDATA_DATA_LINES:
 		while (isspace(*line))
 			line++;
-		args = g_strsplit(line, ",", 0);
-		rc = process_sample_line(inc, args);
-		g_strfreev(args);
+		rc = process_sample_line(inc, line);
 		if (rc)
 			return rc;
 		inc->sample_lines_read++;
@@ -735,7 +742,7 @@ static int parse_header(struct sr_input *in)
 	inc = in->priv;
 	while (have_text_line(in, &line, &next)) {
 		rc = process_text_line(inc, line);
-		g_string_erase(in->buf, 0, next - line);
+		sr_input_buf_consume(in, next - line);
 		if (rc)
 			return rc;
 	}
@@ -863,7 +870,7 @@ static int add_samples(struct sr_input *in, uint64_t samples, size_t count)
 	struct context *inc;
 	uint8_t sample_buffer[sizeof(uint64_t)];
 	size_t idx;
-	size_t copy_count;
+	size_t copy_count, total, done, chunk;
 	uint8_t *p;
 	int rc;
 
@@ -878,11 +885,23 @@ static int add_samples(struct sr_input *in, uint64_t samples, size_t count)
 			copy_count = count;
 		count -= copy_count;
 
+		/*
+		 * Repeat counts can be large. Replicate the already written
+		 * part, which takes few memcpy() calls for any count.
+		 */
 		p = inc->feed_buffer + inc->samples_in_buffer * inc->unitsize;
-		while (copy_count-- > 0) {
+		inc->samples_in_buffer += copy_count;
+		if (inc->unitsize == 1) {
+			memset(p, sample_buffer[0], copy_count);
+		} else if (copy_count) {
+			total = copy_count * inc->unitsize;
 			memcpy(p, sample_buffer, inc->unitsize);
-			p += inc->unitsize;
-			inc->samples_in_buffer++;
+			done = inc->unitsize;
+			while (done < total) {
+				chunk = MIN(done, total - done);
+				memcpy(p + done, p, chunk);
+				done += chunk;
+			}
 		}
 
 		if (inc->samples_in_buffer == inc->samples_per_chunk) {
@@ -1041,7 +1060,7 @@ static int receive(struct sr_input *in, GString *buf)
 	int rc;
 
 	/* Accumulate another chunk of input data. */
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf->str, buf->len);
 
 	/*
 	 * Wait for the full header's availability, then process it in a
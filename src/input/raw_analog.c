@@ -34,12 +34,14 @@
 #define CHUNK_SIZE		(4 * 1024 * 1024)
 #define DEFAULT_NUM_CHANNELS	1
 #define DEFAULT_SAMPLERATE	0
+#define DEFAULT_CHUNK_SAMPLES	0
 
 struct context {
 	gboolean started;
 	int fmt_index;
 	uint64_t samplerate;
 	int samplesize;
+	uint32_t chunk_samples;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
@@ -147,15 +149,19 @@ static int init(struct sr_input *in, GHashTable *options)
 
 	inc->samplerate = g_variant_get_uint64(g_hash_table_lookup(options, "samplerate"));
 	inc->samplesize = sample_formats[fmt_index].encoding.unitsize * num_channels;
+	inc->chunk_samples = g_variant_get_uint32(g_hash_table_lookup(options, "chunk_samples"));
+	if (!inc->chunk_samples)
+		inc->chunk_samples = MAX(CHUNK_SIZE / inc->samplesize, 1);
 	init_context(inc, &sample_formats[fmt_index], in->sdi->channels);
 
 	return SR_OK;
 }
 
-static int process_buffer(struct sr_input *in)
+/* Send whole samples from data, returns the number of bytes sent. */
+static gsize send_chunks(struct sr_input *in, uint8_t *data, gsize len)
 {
 	struct context *inc;
-	unsigned int offset, chunk_size;
+	gsize offset, chunk_size;
 
 	inc = in->priv;
 	if (!inc->started) {
@@ -169,33 +175,46 @@ static int process_buffer(struct sr_input *in)
 		inc->started = TRUE;
 	}
 
-	/* Round down to the last channels * unitsize boundary. */
-	inc->analog.num_samples = CHUNK_SIZE / inc->samplesize;
+	/*
+	 * Packets point into the caller's data, which is a view of the
+	 * mapped file where possible. Send the configured number of
+	 * samples per packet, round the rest down to whole samples.
+	 */
+	inc->analog.num_samples = inc->chunk_samples;
 	chunk_size = inc->analog.num_samples * inc->samplesize;
 	offset = 0;
 
-	while ((offset + chunk_size) < in->buf->len) {
-		inc->analog.data = in->buf->str + offset;
+	while ((offset + chunk_size) < len) {
+		inc->analog.data = data + offset;
 		sr_session_send(in->sdi, &inc->packet);
 		offset += chunk_size;
 	}
 
-	inc->analog.num_samples = (in->buf->len - offset) / inc->samplesize;
+	inc->analog.num_samples = (len - offset) / inc->samplesize;
 	chunk_size = inc->analog.num_samples * inc->samplesize;
 	if (chunk_size > 0) {
-		inc->analog.data = in->buf->str + offset;
+		inc->analog.data = data + offset;
 		sr_session_send(in->sdi, &inc->packet);
 		offset += chunk_size;
 	}
 
-	if ((unsigned int)offset < in->buf->len) {
+	return offset;
+}
+
+static int process_buffer(struct sr_input *in)
+{
+	gsize offset;
+
+	offset = send_chunks(in, (uint8_t *)in->buf->str, in->buf->len);
+
+	if (offset < in->buf->len) {
 		/*
 		 * The incoming buffer wasn't processed completely. Stash
 		 * the leftover data for next time.
 		 */
-		g_string_erase(in->buf, 0, offset);
+		sr_input_buf_consume(in, offset);
 	} else {
-		g_string_truncate(in->buf, 0);
+		sr_input_buf_clear(in);
 	}
 
 	return SR_OK;
@@ -205,7 +224,7 @@ static int receive(struct sr_input *in, GString *buf)
 {
 	int ret;
 
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf->str, buf->len);
 
 	if (!in->sdi_ready) {
 		/* sdi is ready, notify frontend. */
@@ -218,6 +237,30 @@ static int receive(struct sr_input *in, GString *buf)
 	return ret;
 }
 
+static int receive_mapped(struct sr_input *in, uint8_t *data, size_t len)
+{
+	struct context *inc;
+	gsize fill, used;
+
+	inc = in->priv;
+	process_buffer(in);
+
+	/* Complete a sample which was split off by receive(). */
+	if (in->buf->len) {
+		fill = MIN(len, inc->samplesize - in->buf->len);
+		sr_input_buf_append(in, (const char *)data, fill);
+		data += fill;
+		len -= fill;
+		process_buffer(in);
+	}
+
+	/* Send the rest straight from the mapping, keep the leftover. */
+	used = send_chunks(in, data, len);
+	sr_input_buf_append(in, (const char *)data + used, len - used);
+
+	return SR_OK;
+}
+
 static int end(struct sr_input *in)
 {
 	struct context *inc;
@@ -239,6 +282,7 @@ static struct sr_option options[] = {
 	{ "numchannels", "Number of analog channels", "The number of (analog) channels in the data", NULL, NULL },
 	{ "samplerate", "Sample rate (Hz)", "The sample rate of the (analog) data in Hz", NULL, NULL },
 	{ "format", "Data format", "The format of the data (data type, signedness, endianness)", NULL, NULL },
+	{ "chunk_samples", "Samples per packet", "The number of samples per packet sent to the session, 0 for 4 MiB of data", NULL, NULL },
 	ALL_ZERO
 };
 
@@ -252,6 +296,7 @@ static const struct sr_option *get_options(void)
 			options[2].values = g_slist_append(options[2].values,
 				g_variant_ref_sink(g_variant_new_string(sample_formats[i].fmt_name)));
 		}
+		options[3].def = g_variant_ref_sink(g_variant_new_uint32(DEFAULT_CHUNK_SAMPLES));
 	}
 
 	return options;
@@ -265,6 +310,7 @@ static void cleanup(struct sr_input *in)
 	g_variant_unref(options[0].def);
 	g_variant_unref(options[1].def);
 	g_variant_unref(options[2].def);
+	g_variant_unref(options[3].def);
 	g_slist_free_full(options[2].values, (GDestroyNotify)g_variant_unref);
 }
 
@@ -274,7 +320,7 @@ static int reset(struct sr_input *in)
 
 	inc->started = FALSE;
 
-	g_string_truncate(in->buf, 0);
+	sr_input_buf_clear(in);
 
 	return SR_OK;
 }
@@ -287,6 +333,7 @@ SR_PRIV struct sr_input_module input_raw_analog = {
 	.options = get_options,
 	.init = init,
 	.receive = receive,
+	.receive_mapped = receive_mapped,
 	.end = end,
 	.cleanup = cleanup,
 	.reset = reset,
@@ -79,6 +79,9 @@
 
 #define CHUNK_SIZE  (4 * 1024 * 1024)
 
+/* Value changes per run-length encoded packet. */
+#define RLE_CHANGES (64 * 1024)
+
 #define LOGIC2_MAGIC "<SALEAE>"
 #define LOGIC2_VERSION 0
 #define LOGIC2_TYPE_DIGITAL 0
@@ -161,6 +164,14 @@ struct context {
 		uint8_t *buffer_digital;
 		float *buffer_analog;
 		uint8_t *write_pos;
+		/* Send transition lists as SR_DF_LOGIC_RLE packets. */
+		gboolean use_rle;
+		gboolean rle_checked;
+		struct {
+			uint64_t *offsets;
+			size_t num_changes;
+			uint64_t last;
+		} rle;
 		struct {
 			uint64_t stamp;
 			double time;
@@ -287,6 +298,11 @@ static int relse_feed_buffer(struct sr_input *in)
 	g_free(inc->feed.buffer_analog);
 	inc->feed.buffer_analog = NULL;
 	inc->feed.write_pos = NULL;
+	g_free(inc->feed.rle.offsets);
+	inc->feed.rle.offsets = NULL;
+	inc->feed.rle.num_changes = 0;
+	inc->feed.use_rle = FALSE;
+	inc->feed.rle_checked = FALSE;
 
 	return SR_OK;
 }
@@ -315,6 +331,7 @@ static int flush_feed_buffer(struct sr_input *in)
 	struct context *inc;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
+	struct sr_datafeed_logic_rle rle;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
@@ -358,6 +375,17 @@ static int flush_feed_buffer(struct sr_input *in)
 		packet.type = SR_DF_ANALOG;
 		packet.payload = &analog;
 		inc->feed.write_pos = (void *)inc->feed.buffer_analog;
+	} else if (inc->feed.use_rle) {
+		memset(&rle, 0, sizeof(rle));
+		rle.num_samples = inc->feed.samples_in_buffer;
+		rle.unitsize = inc->feed.unit_size;
+		rle.num_changes = inc->feed.rle.num_changes;
+		rle.offsets = inc->feed.rle.offsets;
+		rle.values = inc->feed.buffer_digital;
+		packet.type = SR_DF_LOGIC_RLE;
+		packet.payload = &rle;
+		inc->feed.write_pos = inc->feed.buffer_digital;
+		inc->feed.rle.num_changes = 0;
 	} else {
 		memset(&logic, 0, sizeof(logic));
 		logic.length = inc->feed.samples_in_buffer;
@@ -374,30 +402,101 @@ static int flush_feed_buffer(struct sr_input *in)
 	return sr_session_send(in->sdi, &packet);
 }
 
+static int write_feed_value_logic(struct context *inc, uint64_t data)
+{
+	if (inc->feed.unit_size == sizeof(uint64_t))
+		write_u64le_inc(&inc->feed.write_pos, data);
+	else if (inc->feed.unit_size == sizeof(uint32_t))
+		write_u32le_inc(&inc->feed.write_pos, data);
+	else if (inc->feed.unit_size == sizeof(uint16_t))
+		write_u16le_inc(&inc->feed.write_pos, data);
+	else if (inc->feed.unit_size == sizeof(uint8_t))
+		write_u8_inc(&inc->feed.write_pos, data);
+	else
+		return SR_ERR_BUG;
+
+	return SR_OK;
+}
+
+/*
+ * Queue a run of count samples as value changes. A new change starts
+ * each packet, packets are limited in their change count (the buffer
+ * size) and their sample count (to bound the size of their expansion
+ * where consumers don't accept them).
+ */
+static int addto_feed_buffer_rle(struct sr_input *in,
+	uint64_t data, size_t count)
+{
+	struct context *inc;
+	size_t chunk;
+	int rc;
+
+	inc = in->priv;
+
+	while (count) {
+		if (!inc->feed.rle.num_changes || data != inc->feed.rle.last) {
+			if (inc->feed.rle.num_changes == RLE_CHANGES) {
+				rc = flush_feed_buffer(in);
+				if (rc)
+					return rc;
+			}
+			inc->feed.rle.offsets[inc->feed.rle.num_changes++] =
+				inc->feed.samples_in_buffer;
+			rc = write_feed_value_logic(inc, data);
+			if (rc)
+				return rc;
+			inc->feed.rle.last = data;
+		}
+		chunk = inc->feed.samples_per_chunk - inc->feed.samples_in_buffer;
+		chunk = MIN(chunk, count);
+		inc->feed.samples_in_buffer += chunk;
+		count -= chunk;
+		if (inc->feed.samples_in_buffer == inc->feed.samples_per_chunk) {
+			rc = flush_feed_buffer(in);
+			if (rc)
+				return rc;
+		}
+	}
+
+	return SR_OK;
+}
+
 static int addto_feed_buffer_logic(struct sr_input *in,
 	uint64_t data, size_t count)
 {
 	struct context *inc;
+	uint8_t *start;
+	size_t chunk, filled, n;
+	int rc;
 
 	inc = in->priv;
 
 	if (inc->feed.is_analog)
 		return SR_ERR_ARG;
-
-	while (count--) {
-		if (inc->feed.unit_size == sizeof(uint64_t))
-			write_u64le_inc(&inc->feed.write_pos, data);
-		else if (inc->feed.unit_size == sizeof(uint32_t))
-			write_u32le_inc(&inc->feed.write_pos, data);
-		else if (inc->feed.unit_size == sizeof(uint16_t))
-			write_u16le_inc(&inc->feed.write_pos, data);
-		else if (inc->feed.unit_size == sizeof(uint8_t))
-			write_u8_inc(&inc->feed.write_pos, data);
-		else
-			return SR_ERR_BUG;
-		inc->feed.samples_in_buffer++;
-		if (inc->feed.samples_in_buffer == inc->feed.samples_per_chunk)
-			flush_feed_buffer(in);
+	if (inc->feed.use_rle)
+		return addto_feed_buffer_rle(in, data, count);
+
+	/* Write one sample, then fill the run by doubling copies of it. */
+	while (count) {
+		chunk = inc->feed.samples_per_chunk - inc->feed.samples_in_buffer;
+		chunk = MIN(chunk, count);
+		start = inc->feed.write_pos;
+		rc = write_feed_value_logic(inc, data);
+		if (rc)
+			return rc;
+		for (filled = 1; filled < chunk; filled += n) {
+			n = MIN(filled, chunk - filled);
+			memcpy(start + filled * inc->feed.unit_size, start,
+				n * inc->feed.unit_size);
+		}
+		inc->feed.write_pos = start + chunk * inc->feed.unit_size;
+		inc->feed.samples_in_buffer += chunk;
+		count -= chunk;
+		if (inc->feed.samples_in_buffer == inc->feed.samples_per_chunk) {
+			rc = flush_feed_buffer(in);
+			if (rc)
+				return rc;
+		}
 	}
 
 	return SR_OK;
@@ -666,7 +765,7 @@ static int parse_header(struct sr_input *in)
 
 	/* Remove the consumed header fields from the receive buffer. */
 	read_len = read_pos - start_pos;
-	g_string_erase(in->buf, 0, read_len);
+	sr_input_buf_consume(in, read_len);
 
 	return SR_OK;
 }
@@ -845,6 +944,76 @@ static int parse_next_item(struct sr_input *in,
 	/* UNREACH */
 }
 
+/*
+ * Check once before the first sample data, whether transition lists can
+ * get sent as SR_DF_LOGIC_RLE packets. The device instance only becomes
+ * part of a session after the header was processed.
+ */
+static void check_feed_rle(struct sr_input *in)
+{
+	struct context *inc;
+
+	inc = in->priv;
+	if (inc->feed.rle_checked)
+		return;
+	inc->feed.rle_checked = TRUE;
+
+	if (inc->feed.is_analog)
+		return;
+	switch (inc->logic_state.stage) {
+	case STAGE_L1D_CHANGE_INIT:
+	case STAGE_L1D_CHANGE_VALUE:
+	case STAGE_L2D_CHANGE_VALUE:
+		break;
+	default:
+		return;
+	}
+	if (!sr_session_logic_rle_accepted(in->sdi->session))
+		return;
+	inc->feed.rle.offsets = g_try_malloc(RLE_CHANGES * sizeof(uint64_t));
+	if (!inc->feed.rle.offsets)
+		return;
+	inc->feed.use_rle = TRUE;
+	sr_dbg("Sending run-length encoded logic data.");
+}
+
+/* Convert all available words of every-value data in a single loop. */
+static size_t parse_every_value(struct sr_input *in,
+	const uint8_t *buff, size_t blen)
+{
+	struct context *inc;
+	size_t word_size, count, chunk, i;
+	const uint8_t *rdptr;
+	uint32_t digital;
+
+	inc = in->priv;
+	word_size = inc->logic_state.word_size;
+	count = blen / word_size;
+	rdptr = buff;
+	digital = inc->feed.last.digital;
+	while (count) {
+		chunk = inc->feed.samples_per_chunk - inc->feed.samples_in_buffer;
+		chunk = MIN(chunk, count);
+		for (i = 0; i < chunk; i++, rdptr += word_size) {
+			if (word_size == sizeof(uint8_t))
+				digital = R8(rdptr);
+			else if (word_size == sizeof(uint16_t))
+				digital = RL16(rdptr);
+			else
+				digital = RL32(rdptr);
+			write_u32le_inc(&inc->feed.write_pos, digital);
+		}
+		inc->feed.samples_in_buffer += chunk;
+		count -= chunk;
+		if (inc->feed.samples_in_buffer == inc->feed.samples_per_chunk)
+			flush_feed_buffer(in);
+	}
+	inc->feed.last.digital = digital;
+	inc->feed.last.stamp += blen / word_size;
+
+	return rdptr - buff;
+}
+
 static int parse_samples(struct sr_input *in)
 {
 	const uint8_t *buff, *start;
@@ -853,10 +1022,23 @@ static int parse_samples(struct sr_input *in)
 	const uint8_t *curr, *next;
 	size_t len;
 	int rc;
+	struct context *inc;
+
+	inc = in->priv;
+	check_feed_rle(in);
 
 	start = (const uint8_t *)in->buf->str;
 	buff = start;
 	blen = in->buf->len;
+	if (inc->logic_state.stage == STAGE_L1D_EVERY_VALUE &&
+			inc->feed.unit_size == sizeof(uint32_t) &&
+			(inc->logic_state.word_size == sizeof(uint8_t) ||
+			inc->logic_state.word_size == sizeof(uint16_t) ||
+			inc->logic_state.word_size == sizeof(uint32_t))) {
+		len = parse_every_value(in, buff, blen);
+		buff += len;
+		blen -= len;
+	}
 	while (have_next_item(in, buff, blen, &curr, &next)) {
 		len = next - curr;
 		rc = parse_next_item(in, curr, len);
@@ -866,7 +1048,7 @@ static int parse_samples(struct sr_input *in)
 		blen -= len;
 	}
 	len = buff - start;
-	g_string_erase(in->buf, 0, len);
+	sr_input_buf_consume(in, len);
 
 	return SR_OK;
 }
@@ -998,7 +1180,7 @@ static int receive(struct sr_input *in, GString *buf)
 	inc = in->priv;
 
 	/* Accumulate another chunk of input data. */
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf->str, buf->len);
 
 	/*
 	 * Wait for the full header's availability, then process it in
@@ -1114,7 +1296,7 @@ static int reset(struct sr_input *in)
 	inc->module_state.got_header = FALSE;
 	inc->module_state.header_sent = FALSE;
 	inc->module_state.rate_sent = FALSE;
-	g_string_truncate(in->buf, 0);
+	sr_input_buf_clear(in);
 
 	return SR_OK;
 }
@@ -0,0 +1,994 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Streaming import of sigrok session files (.sr).
+ *
+ * Unlike sr_session_load(), which needs the whole file for random access
+ * via the ZIP central directory, this module walks the ZIP local headers
+ * in the order the bytes arrive. Entries get inflated incrementally,
+ * straight into the feed queues, using the compressed sizes from the
+ * local headers. Deflated entries with data descriptors (sizes unknown
+ * up front) are supported as well, their end is where the deflate
+ * stream ends. The central directory is not needed and gets ignored.
+ *
+ * The "metadata" entry describes the channels, so sample data can only
+ * be sent once it was seen. The srzip output module writes it right
+ * after the "version" entry, as libzip based versions did, which keeps
+ * memory use bounded. Archives which put the metadata after the sample
+ * data still import, their compressed data is held until the metadata
+ * is seen.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "input/srzip"
+
+/* How many bytes of sample data at a time to send to the session bus. */
+#define CHUNK_SIZE		(4 * 1024 * 1024)
+
+/* Inflate buffer for entries which are not sample data. */
+#define SCRATCH_SIZE		(64 * 1024)
+
+/* Upper limit for the "version" and "metadata" entries. */
+#define MAX_TEXT_SIZE		(1024 * 1024)
+
+#define ZIP_LOCAL_HEADER_SIG	0x04034b50
+#define ZIP_CENTRAL_HEADER_SIG	0x02014b50
+#define ZIP64_END_SIG		0x06064b50
+#define ZIP_END_SIG		0x06054b50
+#define ZIP_DESCRIPTOR_SIG	0x08074b50
+#define ZIP_LOCAL_HEADER_LEN	30
+#define ZIP_DESCRIPTOR_LEN	12
+#define ZIP64_DESCRIPTOR_LEN	20
+#define ZIP_FLAG_ENCRYPTED	0x0001
+#define ZIP_FLAG_DESCRIPTOR	0x0008
+#define ZIP_METHOD_STORE	0
+#define ZIP_METHOD_DEFLATE	8
+#define ZIP_EXTRA_ZIP64_ID	0x0001
+#define ZIP_U32_MAX		0xffffffffUL
+
+enum entry_kind {
+	ENTRY_SKIP,
+	ENTRY_VERSION,
+	ENTRY_METADATA,
+	ENTRY_LOGIC,
+	ENTRY_ANALOG,
+};
+
+/* The samples of the logic capture file, or of one analog channel. */
+struct srzip_stream {
+	struct feed_queue_logic *logic;
+	struct feed_queue_analog *analog;
+	size_t unitsize;
+	/* Bytes of an incomplete sample, kept in the queue's free space. */
+	size_t partial;
+	unsigned int chunk_num;
+};
+
+struct zip_entry {
+	char *name;
+	enum entry_kind kind;
+	/* Name without the chunk number, and the chunk number. */
+	char *base;
+	unsigned int chunk_num;
+	unsigned int analog_nr;
+	uint16_t method;
+	gboolean size_known;
+	gboolean zip64;
+	uint64_t comp_remain;
+	gboolean stream_end;
+	z_stream zs;
+	gboolean zs_init;
+	struct srzip_stream *stream;
+	GByteArray *text;
+	/* Compressed data, while the metadata was not seen yet. */
+	GByteArray *raw;
+};
+
+struct context {
+	enum {
+		STATE_HEADER,
+		STATE_DATA,
+		STATE_DESCRIPTOR,
+		STATE_TRAILER,
+	} state;
+	struct zip_entry *entry;
+	GSList *pending;
+	gboolean pending_warned;
+	gboolean have_version;
+	gboolean have_metadata;
+	gboolean started;
+	uint64_t samplerate;
+	char *capturefile;
+	size_t unitsize;
+	unsigned int first_analog_nr;
+	struct srzip_stream logic;
+	size_t analog_count;
+	struct srzip_stream *analog;
+	uint8_t *scratch;
+	GSList *prev_sr_channels;
+};
+
+static int format_match(GHashTable *metadata, unsigned int *confidence)
+{
+	GString *buf;
+
+	/* Session files start with the "version" entry. */
+	buf = g_hash_table_lookup(metadata,
+		GINT_TO_POINTER(SR_INPUT_META_HEADER));
+	if (!buf || buf->len < ZIP_LOCAL_HEADER_LEN + strlen("version"))
+		return SR_ERR;
+	if (RL32(buf->str) != ZIP_LOCAL_HEADER_SIG)
+		return SR_ERR;
+	if (RL16(buf->str + 26) != strlen("version"))
+		return SR_ERR;
+	if (memcmp(buf->str + ZIP_LOCAL_HEADER_LEN, "version", strlen("version")))
+		return SR_ERR;
+	*confidence = 1;
+
+	return SR_OK;
+}
+
+static int init(struct sr_input *in, GHashTable *options)
+{
+	struct context *inc;
+
+	(void)options;
+
+	in->sdi = g_malloc0(sizeof(*in->sdi));
+	in->priv = inc = g_malloc0(sizeof(*inc));
+	inc->scratch = g_malloc(SCRATCH_SIZE);
+
+	return SR_OK;
+}
+
+static void entry_free(struct zip_entry *entry)
+{
+	if (!entry)
+		return;
+	if (entry->zs_init)
+		inflateEnd(&entry->zs);
+	if (entry->text)
+		g_byte_array_free(entry->text, TRUE);
+	if (entry->raw)
+		g_byte_array_free(entry->raw, TRUE);
+	g_free(entry->base);
+	g_free(entry->name);
+	g_free(entry);
+}
+
+static void entry_free_cb(void *p)
+{
+	entry_free(p);
+}
+
+/*
+ * Chunks of the logic capture file are named "logic-1-<n>", chunks of
+ * analog channels "analog-1-<nr>-<n>". The capture file's name is only
+ * known from the metadata, so other names become logic candidates.
+ */
+static void entry_classify(struct zip_entry *entry)
+{
+	const char *sep;
+	char *end;
+
+	if (!strcmp(entry->name, "version")) {
+		entry->kind = ENTRY_VERSION;
+		return;
+	}
+	if (!strcmp(entry->name, "metadata")) {
+		entry->kind = ENTRY_METADATA;
+		return;
+	}
+
+	entry->kind = ENTRY_SKIP;
+	sep = strrchr(entry->name, '-');
+	if (!sep || sep == entry->name || !g_ascii_isdigit(sep[1]))
+		return;
+	entry->chunk_num = strtoul(sep + 1, &end, 10);
+	if (*end)
+		return;
+	entry->base = g_strndup(entry->name, sep - entry->name);
+	if (g_str_has_prefix(entry->base, "analog-1-")) {
+		entry->analog_nr = strtoul(entry->base + 9, &end, 10);
+		if (!*end && entry->analog_nr)
+			entry->kind = ENTRY_ANALOG;
+		return;
+	}
+	entry->kind = ENTRY_LOGIC;
+}
+
+/* Find the samples stream of a chunk, once the metadata is known. */
+static void entry_resolve(struct context *inc, struct zip_entry *entry)
+{
+	struct srzip_stream *stream;
+	size_t idx;
+
+	stream = NULL;
+	if (entry->kind == ENTRY_LOGIC) {
+		if (inc->capturefile && !strcmp(entry->base, inc->capturefile))
+			stream = &inc->logic;
+	} else if (entry->kind == ENTRY_ANALOG) {
+		idx = entry->analog_nr - inc->first_analog_nr;
+		if (entry->analog_nr >= inc->first_analog_nr
+				&& idx < inc->analog_count)
+			stream = &inc->analog[idx];
+	}
+	if (entry->kind == ENTRY_LOGIC || entry->kind == ENTRY_ANALOG) {
+		if (!stream || (!stream->logic && !stream->analog)) {
+			sr_dbg("Skipping unknown entry %s.", entry->name);
+			entry->kind = ENTRY_SKIP;
+			return;
+		}
+		if (entry->chunk_num != stream->chunk_num + 1)
+			sr_warn("Chunk %s is out of order.", entry->name);
+		stream->chunk_num = entry->chunk_num;
+	}
+	entry->stream = stream;
+}
+
+/*
+ * Get the space which the next inflated bytes go to: the feed queue of
+ * sample data, or a scratch buffer for everything else. An incomplete
+ * sample from a previous call is in front of the returned space.
+ */
+static uint8_t *entry_space(struct context *inc, struct zip_entry *entry,
+	size_t *space)
+{
+	struct srzip_stream *stream;
+	uint8_t *p;
+	size_t count;
+
+	stream = entry->stream;
+	if (!stream || entry->raw) {
+		*space = SCRATCH_SIZE;
+		return inc->scratch;
+	}
+
+	if (stream->logic)
+		p = feed_queue_logic_get_buffer(stream->logic, &count);
+	else
+		p = (uint8_t *)feed_queue_analog_get_buffer(stream->analog, &count);
+	*space = count * stream->unitsize - stream->partial;
+
+	return p + stream->partial;
+}
+
+/* Take the inflated bytes which were put into the entry's space. */
+static int entry_commit(struct zip_entry *entry, const uint8_t *data,
+	size_t len)
+{
+	struct srzip_stream *stream;
+	size_t count;
+
+	if (entry->raw)
+		return SR_OK;
+
+	switch (entry->kind) {
+	case ENTRY_VERSION:
+	case ENTRY_METADATA:
+		if (entry->text->len + len > MAX_TEXT_SIZE) {
+			sr_err("Entry %s is too large.", entry->name);
+			return SR_ERR_DATA;
+		}
+		g_byte_array_append(entry->text, data, len);
+		break;
+	case ENTRY_LOGIC:
+	case ENTRY_ANALOG:
+		stream = entry->stream;
+		len += stream->partial;
+		count = len / stream->unitsize;
+		stream->partial = len % stream->unitsize;
+		if (!count)
+			break;
+		if (stream->logic)
+			return feed_queue_logic_commit(stream->logic, count);
+		return feed_queue_analog_commit(stream->analog, count);
+	default:
+		break;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Feed compressed bytes of the current entry. Consumes up to the end of
+ * the entry, and tells how many input bytes were used.
+ */
+static int entry_consume(struct context *inc, struct zip_entry *entry,
+	const uint8_t *data, size_t len, size_t *used)
+{
+	uint8_t *out;
+	size_t space, in_len;
+	int zret, ret;
+
+	if (entry->size_known)
+		len = MIN(len, entry->comp_remain);
+	*used = 0;
+
+	if (entry->stream_end || (entry->raw && entry->size_known)) {
+		/* Trailing bytes, or data which is kept as is. */
+		*used = len;
+	} else if (entry->method == ZIP_METHOD_STORE) {
+		while (*used < len) {
+			out = entry_space(inc, entry, &space);
+			space = MIN(space, len - *used);
+			memcpy(out, data + *used, space);
+			if ((ret = entry_commit(entry, out, space)) != SR_OK)
+				return ret;
+			*used += space;
+		}
+	} else {
+		/* Continue while input is left, or the output space got full. */
+		entry->zs.next_in = (Bytef *)data;
+		for (;;) {
+			in_len = MIN(len - *used, G_MAXUINT);
+			entry->zs.avail_in = in_len;
+			out = entry_space(inc, entry, &space);
+			entry->zs.next_out = out;
+			entry->zs.avail_out = MIN(space, G_MAXUINT);
+			zret = inflate(&entry->zs, Z_NO_FLUSH);
+			if (zret != Z_OK && zret != Z_STREAM_END && zret != Z_BUF_ERROR) {
+				sr_err("Cannot inflate entry %s: %s.", entry->name,
+					entry->zs.msg ? entry->zs.msg : zError(zret));
+				return SR_ERR_DATA;
+			}
+			*used += in_len - entry->zs.avail_in;
+			ret = entry_commit(entry, out, entry->zs.next_out - out);
+			if (ret != SR_OK)
+				return ret;
+			if (zret == Z_STREAM_END) {
+				entry->stream_end = TRUE;
+				/* Known sizes: skip what follows the stream. */
+				if (entry->size_known)
+					*used = len;
+				break;
+			}
+			if (zret == Z_BUF_ERROR || (*used == len && entry->zs.avail_out))
+				break;
+		}
+	}
+
+	if (entry->raw)
+		g_byte_array_append(entry->raw, data, *used);
+	if (entry->size_known) {
+		entry->comp_remain -= *used;
+		if (!entry->comp_remain && !entry->raw && entry->zs_init
+				&& !entry->stream_end)
+			sr_warn("Entry %s is truncated.", entry->name);
+	}
+
+	return SR_OK;
+}
+
+static gboolean entry_complete(const struct zip_entry *entry)
+{
+	if (entry->size_known)
+		return entry->comp_remain == 0;
+
+	return entry->stream_end;
+}
+
+static int parse_metadata(struct sr_input *in, const GByteArray *text)
+{
+	struct context *inc;
+	GKeyFile *kf;
+	GError *error;
+	const char *devgroup;
+	char **groups, *key, *val;
+	char channelname[SR_MAX_CHANNELNAME_LEN + 1];
+	int total_probes, total_analog, unitsize, i;
+	uint64_t samplerate;
+
+	inc = in->priv;
+	devgroup = "device 1";
+
+	kf = g_key_file_new();
+	error = NULL;
+	if (!g_key_file_load_from_data(kf, (const char *)text->data, text->len,
+			G_KEY_FILE_NONE, &error)) {
+		sr_err("Failed to parse metadata: %s.", error->message);
+		g_error_free(error);
+		g_key_file_free(kf);
+		return SR_ERR_DATA;
+	}
+	if (!g_key_file_has_group(kf, devgroup)) {
+		sr_err("No device found in metadata.");
+		g_key_file_free(kf);
+		return SR_ERR_DATA;
+	}
+	groups = g_key_file_get_groups(kf, NULL);
+	for (i = 0; groups[i]; i++) {
+		if (g_str_has_prefix(groups[i], "device ")
+				&& strcmp(groups[i], devgroup)) {
+			sr_warn("Only %s of the session file gets imported.",
+				devgroup);
+			break;
+		}
+	}
+	g_strfreev(groups);
+
+	val = g_key_file_get_string(kf, devgroup, "samplerate", NULL);
+	if (val) {
+		if (sr_parse_sizestring(val, &samplerate) != SR_OK) {
+			sr_err("Invalid samplerate '%s' in metadata.", val);
+			g_free(val);
+			g_key_file_free(kf);
+			return SR_ERR_DATA;
+		}
+		inc->samplerate = samplerate;
+		g_free(val);
+	}
+
+	/* File contains logic data if a capturefile is set. */
+	inc->capturefile = g_key_file_get_string(kf, devgroup,
+		"capturefile", NULL);
+	total_probes = g_key_file_get_integer(kf, devgroup,
+		"total probes", NULL);
+	total_analog = g_key_file_get_integer(kf, devgroup,
+		"total analog", NULL);
+	unitsize = g_key_file_get_integer(kf, devgroup, "unitsize", NULL);
+	if (total_probes < 0 || total_analog < 0 || unitsize < 0) {
+		sr_err("Invalid channel counts in metadata.");
+		g_key_file_free(kf);
+		return SR_ERR_DATA;
+	}
+	if (inc->capturefile && !unitsize)
+		unitsize = (total_probes + 7) / 8;
+	inc->unitsize = unitsize;
+
+	/*
+	 * Create channels the way sr_session_load() does: all channels
+	 * of the device, named ones are enabled. Analog channel numbers
+	 * follow the last logic channel.
+	 */
+	for (i = 0; i < total_probes + total_analog; i++) {
+		if (i < total_probes)
+			key = g_strdup_printf("probe%d", i + 1);
+		else
+			key = g_strdup_printf("analog%d", i + 1);
+		val = g_key_file_get_string(kf, devgroup, key, NULL);
+		g_free(key);
+		g_snprintf(channelname, sizeof(channelname), "%d", i);
+		sr_channel_new(in->sdi, i,
+			i < total_probes ? SR_CHANNEL_LOGIC : SR_CHANNEL_ANALOG,
+			val != NULL, val ? val : channelname);
+		g_free(val);
+	}
+	inc->first_analog_nr = total_probes + 1;
+	inc->analog_count = total_analog;
+	inc->have_metadata = TRUE;
+
+	g_key_file_free(kf);
+
+	return SR_OK;
+}
+
+static int entry_finish(struct sr_input *in, struct zip_entry *entry)
+{
+	struct context *inc;
+	uint64_t version;
+	char *s;
+	int ret;
+
+	inc = in->priv;
+
+	switch (entry->kind) {
+	case ENTRY_VERSION:
+		s = g_strndup((const char *)entry->text->data, entry->text->len);
+		version = g_ascii_strtoull(s, NULL, 10);
+		g_free(s);
+		if (version == 0 || version > 2) {
+			sr_err("Cannot handle sigrok session file version %"
+				PRIu64 ".", version);
+			return SR_ERR_DATA;
+		}
+		inc->have_version = TRUE;
+		break;
+	case ENTRY_METADATA:
+		if (inc->have_metadata) {
+			sr_warn("Ignoring repeated metadata.");
+			break;
+		}
+		if ((ret = parse_metadata(in, entry->text)) != SR_OK)
+			return ret;
+		break;
+	case ENTRY_LOGIC:
+	case ENTRY_ANALOG:
+		if (entry->raw) {
+			/* Keep the data until the metadata is seen. */
+			inc->pending = g_slist_append(inc->pending, entry);
+			return SR_OK;
+		}
+		break;
+	default:
+		break;
+	}
+	entry_free(entry);
+
+	return SR_OK;
+}
+
+/*
+ * Parse a local file header. Returns SR_ERR_NA while the input does not
+ * hold all of it yet.
+ */
+static int parse_header(struct sr_input *in, const uint8_t *p, size_t len,
+	size_t *used)
+{
+	struct context *inc;
+	struct zip_entry *entry;
+	const uint8_t *extra;
+	uint32_t sig;
+	size_t header_len;
+	uint16_t flags, method, name_len, extra_len, id, size;
+	uint64_t comp_size, uncomp_size;
+	gboolean zip64;
+
+	inc = in->priv;
+	*used = 0;
+
+	if (len < sizeof(uint32_t))
+		return SR_ERR_NA;
+	sig = RL32(p);
+	if (sig == ZIP_CENTRAL_HEADER_SIG || sig == ZIP64_END_SIG
+			|| sig == ZIP_END_SIG) {
+		/* The central directory repeats what was seen already. */
+		inc->state = STATE_TRAILER;
+		return SR_OK;
+	}
+	if (sig != ZIP_LOCAL_HEADER_SIG) {
+		sr_err("Unexpected ZIP record signature 0x%08x.", sig);
+		return SR_ERR_DATA;
+	}
+
+	if (len < ZIP_LOCAL_HEADER_LEN)
+		return SR_ERR_NA;
+	flags = RL16(p + 6);
+	method = RL16(p + 8);
+	comp_size = RL32(p + 18);
+	uncomp_size = RL32(p + 22);
+	name_len = RL16(p + 26);
+	extra_len = RL16(p + 28);
+	header_len = ZIP_LOCAL_HEADER_LEN + name_len + extra_len;
+	if (len < header_len)
+		return SR_ERR_NA;
+
+	/* Sizes beyond 4GiB come in the zip64 extra field. */
+	zip64 = FALSE;
+	extra = p + ZIP_LOCAL_HEADER_LEN + name_len;
+	while (extra_len >= 4) {
+		id = RL16(extra);
+		size = RL16(extra + 2);
+		if (size > extra_len - 4)
+			break;
+		if (id == ZIP_EXTRA_ZIP64_ID) {
+			zip64 = TRUE;
+			if (uncomp_size == ZIP_U32_MAX && size >= 8) {
+				uncomp_size = RL64(extra + 4);
+				if (comp_size == ZIP_U32_MAX && size >= 16)
+					comp_size = RL64(extra + 12);
+			} else if (comp_size == ZIP_U32_MAX && size >= 8) {
+				comp_size = RL64(extra + 4);
+			}
+		}
+		extra += 4 + size;
+		extra_len -= 4 + size;
+	}
+
+	entry = g_malloc0(sizeof(*entry));
+	entry->name = g_strndup((const char *)p + ZIP_LOCAL_HEADER_LEN, name_len);
+	entry->method = method;
+	entry->zip64 = zip64;
+	entry->size_known = !(flags & ZIP_FLAG_DESCRIPTOR);
+	entry->comp_remain = comp_size;
+	*used = header_len;
+
+	if (flags & ZIP_FLAG_ENCRYPTED) {
+		sr_err("Encrypted entry %s is not supported.", entry->name);
+		entry_free(entry);
+		return SR_ERR_DATA;
+	}
+	if (method != ZIP_METHOD_STORE && method != ZIP_METHOD_DEFLATE) {
+		sr_err("Compression method %u of entry %s is not supported.",
+			method, entry->name);
+		entry_free(entry);
+		return SR_ERR_DATA;
+	}
+	if (method == ZIP_METHOD_STORE && !entry->size_known) {
+		sr_err("Stored entry %s without size is not supported.",
+			entry->name);
+		entry_free(entry);
+		return SR_ERR_DATA;
+	}
+	if (method == ZIP_METHOD_DEFLATE) {
+		if (inflateInit2(&entry->zs, -MAX_WBITS) != Z_OK) {
+			entry_free(entry);
+			return SR_ERR_MALLOC;
+		}
+		entry->zs_init = TRUE;
+	}
+
+	entry_classify(entry);
+	switch (entry->kind) {
+	case ENTRY_VERSION:
+	case ENTRY_METADATA:
+		entry->text = g_byte_array_new();
+		break;
+	case ENTRY_LOGIC:
+	case ENTRY_ANALOG:
+		if (inc->have_metadata) {
+			entry_resolve(inc, entry);
+			break;
+		}
+		if (!inc->pending_warned) {
+			sr_warn("Sample data precedes the metadata, "
+				"keeping it until the metadata is seen.");
+			inc->pending_warned = TRUE;
+		}
+		entry->raw = g_byte_array_new();
+		break;
+	default:
+		break;
+	}
+
+	inc->entry = entry;
+	inc->state = STATE_DATA;
+
+	return SR_OK;
+}
+
+/* Skip the data descriptor, its signature is optional. */
+static int skip_descriptor(struct context *inc, const uint8_t *p, size_t len,
+	size_t *used)
+{
+	size_t desc_len;
+
+	desc_len = inc->entry->zip64 ? ZIP64_DESCRIPTOR_LEN : ZIP_DESCRIPTOR_LEN;
+	if (len < sizeof(uint32_t))
+		return SR_ERR_NA;
+	if (RL32(p) == ZIP_DESCRIPTOR_SIG)
+		desc_len += sizeof(uint32_t);
+	if (len < desc_len)
+		return SR_ERR_NA;
+	*used = desc_len;
+
+	return SR_OK;
+}
+
+/* Feed a kept entry, after the metadata was seen. */
+static int replay_entry(struct sr_input *in, struct zip_entry *entry)
+{
+	struct context *inc;
+	GByteArray *raw;
+	size_t used;
+	int ret;
+
+	inc = in->priv;
+	raw = entry->raw;
+	entry->raw = NULL;
+	entry->size_known = TRUE;
+	entry->comp_remain = raw->len;
+	entry->stream_end = FALSE;
+	if (entry->zs_init)
+		inflateReset(&entry->zs);
+	entry_resolve(inc, entry);
+	ret = entry_consume(inc, entry, raw->data, raw->len, &used);
+	g_byte_array_free(raw, TRUE);
+
+	return ret;
+}
+
+static int start(struct sr_input *in)
+{
+	struct context *inc;
+	struct sr_channel *ch;
+	struct srzip_stream *stream;
+	GSList *l;
+	struct zip_entry *entry;
+	size_t idx;
+	int ret;
+
+	inc = in->priv;
+
+	if (!inc->have_version) {
+		sr_err("Not a sigrok session file: no version found.");
+		return SR_ERR_DATA;
+	}
+
+	if (inc->capturefile && inc->unitsize) {
+		inc->logic.unitsize = inc->unitsize;
+		inc->logic.logic = feed_queue_logic_alloc(in->sdi,
+			CHUNK_SIZE / inc->unitsize, inc->unitsize);
+		if (!inc->logic.logic) {
+			sr_err("Cannot allocate buffers.");
+			return SR_ERR_MALLOC;
+		}
+	}
+	inc->analog = g_malloc0_n(inc->analog_count + 1, sizeof(inc->analog[0]));
+	for (l = in->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_ANALOG)
+			continue;
+		idx = ch->index + 1 - inc->first_analog_nr;
+		if (idx >= inc->analog_count)
+			continue;
+		stream = &inc->analog[idx];
+		stream->unitsize = sizeof(float);
+		/* TODO: Use proper 'digits' value for this device (and its modes). */
+		stream->analog = feed_queue_analog_alloc(in->sdi,
+			CHUNK_SIZE / sizeof(float), 2, ch);
+		if (!stream->analog) {
+			sr_err("Cannot allocate buffers.");
+			return SR_ERR_MALLOC;
+		}
+	}
+
+	std_session_send_df_header(in->sdi);
+	if (inc->samplerate) {
+		(void)sr_session_send_meta(in->sdi, SR_CONF_SAMPLERATE,
+			g_variant_new_uint64(inc->samplerate));
+	}
+	inc->started = TRUE;
+
+	/* Data which preceded the metadata goes first. */
+	while (inc->pending) {
+		entry = inc->pending->data;
+		inc->pending = g_slist_delete_link(inc->pending, inc->pending);
+		ret = replay_entry(in, entry);
+		entry_free(entry);
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Check the channel list for consistency across file re-import. See
+ * the VCD input module for more details and motivation.
+ */
+
+static void keep_header_for_reread(const struct sr_input *in)
+{
+	struct context *inc;
+
+	inc = in->priv;
+	g_slist_free_full(inc->prev_sr_channels, sr_channel_free_cb);
+	inc->prev_sr_channels = in->sdi->channels;
+	in->sdi->channels = NULL;
+}
+
+static int check_header_in_reread(const struct sr_input *in)
+{
+	struct context *inc;
+
+	if (!in)
+		return FALSE;
+	inc = in->priv;
+	if (!inc)
+		return FALSE;
+	if (!inc->prev_sr_channels)
+		return TRUE;
+
+	if (sr_channel_lists_differ(inc->prev_sr_channels, in->sdi->channels)) {
+		sr_err("Channel list change not supported for file re-read.");
+		return FALSE;
+	}
+	g_slist_free_full(in->sdi->channels, sr_channel_free_cb);
+	in->sdi->channels = inc->prev_sr_channels;
+	inc->prev_sr_channels = NULL;
+
+	return TRUE;
+}
+
+static int process_buffer(struct sr_input *in)
+{
+	struct context *inc;
+	const uint8_t *data;
+	size_t pos, len, used;
+	int ret;
+
+	inc = in->priv;
+
+	if (in->sdi_ready && !inc->started) {
+		if ((ret = start(in)) != SR_OK)
+			return ret;
+	}
+
+	pos = 0;
+	ret = SR_OK;
+	while (ret == SR_OK) {
+		/* Empty entries complete without further input. */
+		if (pos == in->buf->len && (inc->state != STATE_DATA
+				|| !entry_complete(inc->entry)))
+			break;
+		data = (const uint8_t *)in->buf->str + pos;
+		len = in->buf->len - pos;
+		used = 0;
+		switch (inc->state) {
+		case STATE_HEADER:
+			ret = parse_header(in, data, len, &used);
+			break;
+		case STATE_DATA:
+			ret = entry_consume(inc, inc->entry, data, len, &used);
+			if (ret != SR_OK || !entry_complete(inc->entry))
+				break;
+			if (!inc->entry->size_known) {
+				inc->state = STATE_DESCRIPTOR;
+				break;
+			}
+			ret = entry_finish(in, inc->entry);
+			inc->entry = NULL;
+			inc->state = STATE_HEADER;
+			break;
+		case STATE_DESCRIPTOR:
+			ret = skip_descriptor(inc, data, len, &used);
+			if (ret != SR_OK)
+				break;
+			ret = entry_finish(in, inc->entry);
+			inc->entry = NULL;
+			inc->state = STATE_HEADER;
+			break;
+		case STATE_TRAILER:
+			used = len;
+			break;
+		}
+		pos += used;
+
+		/* Have the frontend see the channels before any data. */
+		if (ret == SR_OK && !in->sdi_ready && inc->have_metadata) {
+			if (!check_header_in_reread(in))
+				ret = SR_ERR_DATA;
+			in->sdi_ready = TRUE;
+			break;
+		}
+	}
+	sr_input_buf_consume(in, pos);
+
+	return ret == SR_ERR_NA ? SR_OK : ret;
+}
+
+static int receive(struct sr_input *in, GString *buf)
+{
+	sr_input_buf_append(in, buf->str, buf->len);
+
+	return process_buffer(in);
+}
+
+static int flush_stream(struct srzip_stream *stream)
+{
+	if (stream->partial)
+		sr_warn("Dropping an incomplete sample at the end of the data.");
+	stream->partial = 0;
+	if (stream->logic)
+		return feed_queue_logic_flush(stream->logic);
+	if (stream->analog)
+		return feed_queue_analog_flush(stream->analog);
+
+	return SR_OK;
+}
+
+static int end(struct sr_input *in)
+{
+	struct context *inc;
+	size_t idx;
+	int ret;
+
+	inc = in->priv;
+
+	/* The second run continues after the metadata. */
+	ret = process_buffer(in);
+	if (ret == SR_OK && in->sdi_ready && !inc->started)
+		ret = process_buffer(in);
+	if (ret == SR_OK && !in->sdi_ready) {
+		sr_err("No metadata found in session file.");
+		ret = SR_ERR_DATA;
+	}
+	if (ret == SR_OK && inc->state != STATE_HEADER
+			&& inc->state != STATE_TRAILER)
+		sr_warn("Session file ends within entry %s.", inc->entry->name);
+
+	if (ret == SR_OK && inc->started)
+		ret = flush_stream(&inc->logic);
+	for (idx = 0; ret == SR_OK && idx < inc->analog_count; idx++)
+		ret = flush_stream(&inc->analog[idx]);
+	if (inc->started)
+		std_session_send_df_end(in->sdi);
+
+	return ret;
+}
+
+static void context_clear(struct context *inc)
+{
+	size_t idx;
+
+	entry_free(inc->entry);
+	inc->entry = NULL;
+	g_slist_free_full(inc->pending, entry_free_cb);
+	inc->pending = NULL;
+	feed_queue_logic_free(inc->logic.logic);
+	inc->logic.logic = NULL;
+	for (idx = 0; inc->analog && idx < inc->analog_count; idx++)
+		feed_queue_analog_free(inc->analog[idx].analog);
+	g_free(inc->analog);
+	inc->analog = NULL;
+	g_free(inc->capturefile);
+	inc->capturefile = NULL;
+}
+
+static int reset(struct sr_input *in)
+{
+	struct context *inc;
+	uint8_t *scratch;
+	GSList *prev_sr_channels;
+
+	inc = in->priv;
+	context_clear(inc);
+	scratch = inc->scratch;
+	prev_sr_channels = inc->prev_sr_channels;
+	memset(inc, 0, sizeof(*inc));
+	inc->scratch = scratch;
+	inc->prev_sr_channels = prev_sr_channels;
+
+	/*
+	 * Create, and re-create channels for every iteration of file
+	 * import. Other logic will enforce a consistent set of channels
+	 * across re-import, or an appropriate error message when file
+	 * properties should change.
+	 */
+	keep_header_for_reread(in);
+
+	sr_input_buf_clear(in);
+
+	return SR_OK;
+}
+
+static void cleanup(struct sr_input *in)
+{
+	struct context *inc;
+
+	inc = in->priv;
+	context_clear(inc);
+	g_free(inc->scratch);
+	inc->scratch = NULL;
+	g_slist_free_full(inc->prev_sr_channels, sr_channel_free_cb);
+	inc->prev_sr_channels = NULL;
+}
+
+SR_PRIV struct sr_input_module input_srzip = {
+	.id = "srzip",
+	.name = "srzip",
+	.desc = "srzip session file format data",
+	.exts = (const char*[]){"sr", NULL},
+	.metadata = { SR_INPUT_META_HEADER | SR_INPUT_META_REQUIRED },
+	.format_match = format_match,
+	.init = init,
+	.receive = receive,
+	.end = end,
+	.reset = reset,
+	.cleanup = cleanup,
+};
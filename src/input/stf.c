@@ -154,6 +154,7 @@
 #define STF_CHUNK_INFO_SIZE	32
 #define STF_CHUNK_STAMP_SIZE	8
 #define STF_CHUNK_SAMPLE_SIZE	14
+#define STF_CHUNK_MAX_SAMPLES	(STF_CHUNK_CLUSTER_COUNT * STF_CHUNK_SAMPLE_SIZE * 2)
 
 struct context {
 	enum stf_stage {
@@ -202,6 +203,11 @@ struct context {
 		size_t unit_size;
 		uint16_t curr_data;	/* Current sample data. */
 		struct feed_queue_logic *feed;	/* Session feed helper. */
+		/* Channel mapping per sample of a 16bit item, per byte. */
+		uint16_t xlat[4][2][256];
+		/* Decoded samples of a chunk, not yet submitted. */
+		uint8_t block[STF_CHUNK_MAX_SAMPLES * sizeof(uint16_t)];
+		size_t block_count;
 	} submit;
 };
 
@@ -527,6 +533,8 @@ static int eval_header(const struct sr_input *in)
 	return SR_OK;
 }
 
+static void xlat_prepare(const struct sr_input *in);
+
 /* Preare datafeed submission in the DATA phase. */
 static int data_enter(const struct sr_input *in)
 {
@@ -562,6 +570,7 @@ static int data_enter(const struct sr_input *in)
 		CHUNKSIZE, inc->submit.unit_size);
 	if (!inc->submit.feed)
 		return SR_ERR_MALLOC;
+	xlat_prepare(in);
 
 	return SR_OK;
 }
@@ -585,11 +594,28 @@ static void data_leave(const struct sr_input *in)
 	inc->header_sent = FALSE;
 }
 
-/* Forward (repetitions of) sample data, optionally mark trigger location. */
-static void add_sample(const struct sr_input *in, uint16_t data, size_t count)
+/* Have samples queued, either repetitions of one or distinct samples. */
+static void queue_samples(const struct sr_input *in,
+	const uint8_t *data, size_t count, gboolean distinct)
+{
+	struct context *inc;
+
+	inc = in->priv;
+	if (distinct)
+		(void)feed_queue_logic_submit_many(inc->submit.feed, data, count);
+	else
+		(void)feed_queue_logic_submit(inc->submit.feed, data, count);
+}
+
+/*
+ * Forward samples to the session feed, optionally mark the trigger
+ * location. Either count repetitions of the sample at data, or count
+ * distinct samples which are stored back to back.
+ */
+static void submit_samples(const struct sr_input *in,
+	const uint8_t *data, size_t count, gboolean distinct)
 {
 	struct context *inc;
-	uint8_t unit_buffer[sizeof(data)];
 	size_t send_first;
 
 	inc = in->priv;
@@ -605,16 +631,13 @@ static void add_sample(const struct sr_input *in, uint16_t data, size_t count)
 	}
 
 	/*
-	 * Convert the caller's logical information (C language variable)
-	 * to its byte buffer presentation. Then send the caller specified
-	 * number of that value's repetitions to the session feed. Track
+	 * Send the caller specified samples to the session feed. Track
 	 * the number of forwarded samples, to skip remaining buffer content
 	 * after a previously configured amount of payload got forwarded,
 	 * and to emit the trigger location within the stream of sample
 	 * values. Split the transmission when needed to insert the packet
 	 * for a trigger location.
 	 */
-	write_u16le(unit_buffer, data);
 	send_first = 0;
 	if (!inc->submit.samples_to_trigger) {
 		/* EMPTY */
@@ -623,8 +646,9 @@ static void add_sample(const struct sr_input *in, uint16_t data, size_t count)
 		count -= inc->submit.samples_to_trigger;
 	}
 	if (send_first) {
-		(void)feed_queue_logic_submit(inc->submit.feed,
-			unit_buffer, send_first);
+		queue_samples(in, data, send_first, distinct);
+		if (distinct)
+			data += send_first * inc->submit.unit_size;
 		inc->submit.submit_count += send_first;
 		inc->submit.samples_to_trigger -= send_first;
 		sr_dbg("Trigger: sending DF packet, at %" PRIu64 ".",
@@ -632,14 +656,35 @@ static void add_sample(const struct sr_input *in, uint16_t data, size_t count)
 		feed_queue_logic_send_trigger(inc->submit.feed);
 	}
 	if (count) {
-		(void)feed_queue_logic_submit(inc->submit.feed,
-			unit_buffer, count);
+		queue_samples(in, data, count, distinct);
 		inc->submit.submit_count += count;
 		if (inc->submit.samples_to_trigger)
 			inc->submit.samples_to_trigger -= count;
 	}
 }
 
+/* Forward previously decoded samples of the current chunk. */
+static void flush_block(const struct sr_input *in)
+{
+	struct context *inc;
+	size_t count;
+
+	inc = in->priv;
+	count = inc->submit.block_count;
+	inc->submit.block_count = 0;
+	submit_samples(in, inc->submit.block, count, TRUE);
+}
+
+/* Forward repetitions of sample data, after previously decoded data. */
+static void add_sample(const struct sr_input *in, uint16_t data, size_t count)
+{
+	uint8_t unit_buffer[sizeof(data)];
+
+	flush_block(in);
+	write_u16le(unit_buffer, data);
+	submit_samples(in, unit_buffer, count, FALSE);
+}
+
 static int match_magic(GString *buf)
 {
 
@@ -670,14 +715,14 @@ static int parse_magic(struct sr_input *in)
 		return SR_OK;
 	if (strncmp(in->buf->str, STF_MAGIC_SIGMA, STF_MAGIC_LENGTH) == 0) {
 		inc->file_format = STF_FORMAT_SIGMA;
-		g_string_erase(in->buf, 0, STF_MAGIC_LENGTH);
+		sr_input_buf_consume(in, STF_MAGIC_LENGTH);
 		sr_dbg("Magic check: Detected SIGMA file format.");
 		inc->file_stage = STF_STAGE_HEADER;
 		return SR_OK;
 	}
 	if (strncmp(in->buf->str, STF_MAGIC_OMEGA, STF_MAGIC_LENGTH) == 0) {
 		inc->file_format = STF_FORMAT_OMEGA;
-		g_string_erase(in->buf, 0, STF_MAGIC_LENGTH);
+		sr_input_buf_consume(in, STF_MAGIC_LENGTH);
 		sr_dbg("Magic check: Detected OMEGA file format.");
 		sr_err("OMEGA format not supported by STF input module.");
 		inc->file_stage = STF_STAGE_DONE;
@@ -750,7 +795,7 @@ static int parse_header(struct sr_input *in)
 	inc = in->priv;
 	while (in->buf->len) {
 		if (in->buf->str[0] == '\0') {
-			g_string_erase(in->buf, 0, 1);
+			sr_input_buf_consume(in, 1);
 			sr_dbg("Header: End of section seen.");
 			rc = eval_header(in);
 			if (rc != SR_OK)
@@ -771,7 +816,7 @@ static int parse_header(struct sr_input *in)
 		sr_spew("Header: Got a line, len %zd, text: %s.", len, line);
 
 		parse_header_line(inc, line, len);
-		g_string_erase(in->buf, 0, len + strlen(STF_HEADER_EOL));
+		sr_input_buf_consume(in, len + strlen(STF_HEADER_EOL));
 	}
 	return SR_OK;
 }
@@ -818,7 +863,7 @@ static uint16_t get_sample_bits_4(uint16_t indata, int idx)
 }
 
 /* Map from Sigma file bit position to sigrok channel bit position. */
-static uint16_t map_input_chans(struct sr_input *in, uint16_t bits)
+static uint16_t map_input_chans(const struct sr_input *in, uint16_t bits)
 {
 	struct context *inc;
 	uint16_t data;
@@ -835,58 +880,75 @@ static uint16_t map_input_chans(struct sr_input *in, uint16_t bits)
 	return data;
 }
 
-/* Forward one 16bit entity to the session feed. */
-static void xlat_send_sample_data(struct sr_input *in, uint16_t indata)
+/*
+ * Prepare the translation of 16bit entities to sample data. For each
+ * of the one, two, or four samples in an entity, and each of its two
+ * bytes, look up that byte's contribution to the mapped sample data.
+ * Moves the per-bit work of the above routines out of the hot path.
+ */
+static void xlat_prepare(const struct sr_input *in)
 {
 	struct context *inc;
-	uint16_t bits, data;
+	size_t count, idx, byte, value;
+	uint16_t indata, bits;
 
-	/*
-	 * Depending on the sample rate the memory layout for sample
-	 * data varies. Get one, two, or four samples of 16, 8, or 4
-	 * bits each from one 16bit entity. Get a "dense" mapping of
-	 * the enabled channels from the "spread" input data. Forward
-	 * the dense logic data for datafeed submission to the session,
-	 * increment the timestamp for each submitted sample, and keep
-	 * the last submitted pattern since it must be repeated when
-	 * the next sample's timestamp is not adjacent to the current.
-	 */
 	inc = in->priv;
-	switch (inc->submit.bits_per_sample) {
-	case 16:
-		bits = get_sample_bits_16(indata);
-		data = map_input_chans(in, bits);
-		add_sample(in, data, 1);
-		inc->submit.last_submit_ts++;
-		inc->submit.curr_data = data;
-		break;
-	case 8:
-		bits = get_sample_bits_8(indata, 0);
-		data = map_input_chans(in, bits);
-		add_sample(in, data, 1);
-		bits = get_sample_bits_8(indata, 1);
-		data = map_input_chans(in, bits);
-		add_sample(in, data, 1);
-		inc->submit.last_submit_ts++;
-		inc->submit.curr_data = data;
-		break;
-	case 4:
-		bits = get_sample_bits_4(indata, 0);
-		data = map_input_chans(in, bits);
-		add_sample(in, data, 1);
-		bits = get_sample_bits_4(indata, 1);
-		data = map_input_chans(in, bits);
-		add_sample(in, data, 1);
-		bits = get_sample_bits_4(indata, 2);
-		data = map_input_chans(in, bits);
-		add_sample(in, data, 1);
-		bits = get_sample_bits_4(indata, 3);
-		data = map_input_chans(in, bits);
-		add_sample(in, data, 1);
+	count = 16 / inc->submit.bits_per_sample;
+	for (idx = 0; idx < count; idx++) {
+		for (byte = 0; byte < 2; byte++) {
+			for (value = 0; value < 256; value++) {
+				indata = value << (8 * byte);
+				if (count == 4)
+					bits = get_sample_bits_4(indata, idx);
+				else if (count == 2)
+					bits = get_sample_bits_8(indata, idx);
+				else
+					bits = get_sample_bits_16(indata);
+				inc->submit.xlat[idx][byte][value] =
+					map_input_chans(in, bits);
+			}
+		}
+	}
+}
+
+/*
+ * Translate 16bit entities to sample data, append it to the block of
+ * decoded samples. Depending on the sample rate the memory layout for
+ * sample data varies. Get one, two, or four samples of 16, 8, or 4
+ * bits each from one 16bit entity. Get a "dense" mapping of the
+ * enabled channels from the "spread" input data. Increment the
+ * timestamp for each entity, and keep the last decoded pattern since
+ * it must be repeated when the next cluster's timestamp is not
+ * adjacent to the current.
+ */
+static void xlat_send_sample_data(struct sr_input *in,
+	const uint8_t *samples, size_t count)
+{
+	struct context *inc;
+	uint16_t (*xlat)[2][256];
+	uint8_t *wrptr;
+	size_t per_item, unit_size, idx;
+	uint16_t data;
+
+	inc = in->priv;
+	xlat = inc->submit.xlat;
+	per_item = 16 / inc->submit.bits_per_sample;
+	unit_size = inc->submit.unit_size;
+	wrptr = &inc->submit.block[inc->submit.block_count * unit_size];
+	data = inc->submit.curr_data;
+	while (count--) {
+		for (idx = 0; idx < per_item; idx++) {
+			data = xlat[idx][0][samples[0]] | xlat[idx][1][samples[1]];
+			if (unit_size == sizeof(uint16_t))
+				write_u16le_inc(&wrptr, data);
+			else
+				write_u8_inc(&wrptr, data);
+		}
+		samples += sizeof(uint16_t);
+		inc->submit.block_count += per_item;
 		inc->submit.last_submit_ts++;
-		inc->submit.curr_data = data;
-		break;
 	}
+	inc->submit.curr_data = data;
 }
 
 /* Parse one "chunk" of a "record" of the file. */
@@ -970,11 +1032,10 @@ static int stf_parse_data_chunk(struct sr_input *in,
 			add_sample(in, inc->submit.curr_data, ts_diff);
 		}
 		inc->submit.last_submit_ts = ts;
-		for (sample = 0; sample < sample_count; sample++) {
-			sample_data = read_u16le_inc(&samples);
-			xlat_send_sample_data(in, sample_data);
-		}
-		if (inc->submit.submit_count >= inc->submit.sample_count) {
+		xlat_send_sample_data(in, samples, sample_count);
+		samples += STF_CHUNK_SAMPLE_SIZE;
+		if (inc->submit.submit_count + inc->submit.block_count >=
+				inc->submit.sample_count) {
 			sr_dbg("Cluster: Sample count reached, stopping.");
 			return SR_OK;
 		}
@@ -1014,6 +1075,7 @@ static int stf_parse_data_record(struct sr_input *in, struct stf_record *rec)
 
 	for (chunk_idx = 0; chunk_idx < chunk_count; chunk_idx++) {
 		ret = stf_parse_data_chunk(in, info, stamps, samples);
+		flush_block(in);
 		if (ret != SR_OK)
 			return ret;
 		info += STF_CHUNK_INFO_SIZE;
@@ -1074,7 +1136,7 @@ static int parse_file_data(struct sr_input *in)
 		crc = read_u32le_inc(&read_ptr);
 		if (len == final_len && !crc) {
 			sr_dbg("Data: Last record seen.");
-			g_string_erase(in->buf, 0, STF_DATA_REC_HDRLEN);
+			sr_input_buf_consume(in, STF_DATA_REC_HDRLEN);
 			inc->file_stage = STF_STAGE_DONE;
 			return SR_OK;
 		}
@@ -1105,10 +1167,9 @@ static int parse_file_data(struct sr_input *in)
 		 */
 		compressed = (void *)read_ptr;
 		raw_len = sizeof(inc->record_data.raw);
-		memset(&inc->record_data.raw, 0, sizeof(inc->record_data.raw));
 		rc = lzo1x_decompress_safe(compressed, want_len,
 			inc->record_data.raw, &raw_len, NULL);
-		g_string_erase(in->buf, 0, STF_DATA_REC_HDRLEN + want_len);
+		sr_input_buf_consume(in, STF_DATA_REC_HDRLEN + want_len);
 		if (rc) {
 			sr_err("Data: Decompression error %d.", rc);
 			return SR_ERR_DATA;
@@ -1245,6 +1306,9 @@ static int init(struct sr_input *in, GHashTable *options)
 	struct context *inc;
 	uint64_t sample_rate;
 
+	if (sr_lzo_init() != SR_OK)
+		return SR_ERR;
+
 	/* Allocate input module context. */
 	inc = g_malloc0(sizeof(*inc));
 	if (!inc)
@@ -1274,7 +1338,7 @@ static int receive(struct sr_input *in, GString *buf)
 	 * with end(), to make sure pending data gets processed, even
 	 * when receive() is only invoked exactly once for short input.
 	 */
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf->str, buf->len);
 	return process_data(in);
 }
 
@@ -1329,7 +1393,7 @@ static int reset(struct sr_input *in)
 	cleanup(in);
 	keep = inc->keep;
 	memset(inc, 0, sizeof(*inc));
-	g_string_truncate(in->buf, 0);
+	sr_input_buf_clear(in);
 	inc->keep = keep;
 
 	return SR_OK;
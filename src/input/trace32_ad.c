@@ -100,10 +100,19 @@ struct context {
 	int32_t last_record;
 	uint64_t samplerate;
 	double timestamp_scale;
+	size_t unitsize;
 	GString *out_buf;
+	/* Where the enabled pods' data and clock bits are in PI records. */
+	size_t pi_pod_count, pi_payload_len;
+	struct pi_pod_source {
+		size_t data_offset;
+		size_t clk_offset;
+		int clk_bit;
+	} pi_pods[MAX_POD_COUNT];
 };
 
 static int process_header(GString *buf, struct context *inc);
+static void create_pi_pod_map(struct context *inc);
 static void create_channels(struct sr_input *in);
 
 /* Transform non-printable chars to '\xNN' presentation. */
@@ -182,6 +191,7 @@ static int init(struct sr_input *in, GHashTable *options)
 		return SR_ERR;
 	}
 
+	inc->unitsize = (g_slist_length(in->sdi->channels) + 7) / 8;
 	inc->out_buf = g_string_sized_new(CHUNK_SIZE);
 
 	return SR_OK;
@@ -373,6 +383,8 @@ static int process_header(GString *buf, struct context *inc)
 		return SR_ERR;
 	}
 
+	create_pi_pod_map(inc);
+
 	inc->header_read = TRUE;
 
 	return SR_OK;
@@ -426,7 +438,7 @@ static void flush_output_buffer(struct sr_input *in)
 	if (inc->out_buf->len) {
 		packet.type = SR_DF_LOGIC;
 		packet.payload = &logic;
-		logic.unitsize = (g_slist_length(in->sdi->channels) + 7) / 8;
+		logic.unitsize = inc->unitsize;
 		logic.data = inc->out_buf->str;
 		logic.length = inc->out_buf->len;
 		sr_session_send(in->sdi, &packet);
@@ -435,136 +447,55 @@ static void flush_output_buffer(struct sr_input *in)
 	}
 }
 
-static void process_record_pi(struct sr_input *in, gsize start)
+/*
+ * Append a number of copies of a sample to the output buffer. Long
+ * time gaps become many copies, replicate the already written part
+ * and send the buffer whenever it is full.
+ */
+static void append_samples(struct sr_input *in, const uint8_t *sample,
+	size_t len, uint64_t count)
 {
 	struct context *inc;
-	uint64_t timestamp, next_timestamp;
-	uint32_t pod_data;
-	char single_payload[12 * 3];
 	GString *buf;
-	int i, pod_count, clk_offset, packet_count, pod;
-	int payload_bit, payload_len, value;
+	size_t pos, n, total, done, chunk;
+	char *p;
 
 	inc = in->priv;
-	buf = in->buf;
-
-	/*
-	 * 0x00 u8  timestamp
-	 * 0x08 u16 A15..0
-	 * 0x0A u16 B15..0
-	 * 0x0C u16 C15..0
-	 * 0x0E u16 D15..0
-	 * 0x10 u16 E15..0
-	 * 0x12 u16 F15..0
-	 * 0x14 u32 ??
-	 * 0x18 u16 J15..0                          Not present in 500MHz mode
-	 * 0x1A u16 K15..0                          Not present in 500MHz mode
-	 * 0x1C u16 L15..0                          Not present in 500MHz mode
-	 * 0x1E u16 M15..0                          Not present in 500MHz mode
-	 * 0x20 u16 N15..0                          Not present in 500MHz mode
-	 * 0x22 u16 O15..0                          Not present in 500MHz mode
-	 * 0x24 u32 ??                              Not present in 500MHz mode
-	 * 0x28/18 u8 CLKF..A (32=CLKF, .., 1=CLKA)
-	 * 0x29/1A u8 CLKO..J (32=CLKO, .., 1=CLKJ) Not present in 500MHz mode
-	 * 0x2A/19 u8 ??
-	 * 0x2B/1A u8 ??
-	 * 0x2C/1B u8 ??
-	 */
-
-	timestamp = RL64(buf->str + start);
-
-	if (inc->record_mode == AD_MODE_500MHZ) {
-		pod_count = 6;
-		clk_offset = 0x18;
-	} else {
-		pod_count = 12;
-		clk_offset = 0x28;
-	}
-
-	payload_bit = 0;
-	payload_len = 0;
-	single_payload[0] = 0;
-
-	for (pod = 0; pod < pod_count; pod++) {
-		if (!inc->pod_status[pod])
-			continue;
-
-		switch (pod) {
-		case 0: /* A */
-			pod_data = RL16(buf->str + start + 0x08);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 1) << 16;
-			break;
-		case 1: /* B */
-			pod_data = RL16(buf->str + start + 0x0A);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 2) << 15;
-			break;
-		case 2: /* C */
-			pod_data = RL16(buf->str + start + 0x0C);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 4) << 14;
-			break;
-		case 3: /* D */
-			pod_data = RL16(buf->str + start + 0x0E);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 8) << 13;
-			break;
-		case 4: /* E */
-			pod_data = RL16(buf->str + start + 0x10);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 16) << 12;
-			break;
-		case 5: /* F */
-			pod_data = RL16(buf->str + start + 0x12);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 32) << 11;
-			break;
-		case 6: /* J */
-			pod_data = RL16(buf->str + start + 0x18);
-			pod_data |= (RL16(buf->str + start + 0x29) & 1) << 16;
-			break;
-		case 7: /* K */
-			pod_data = RL16(buf->str + start + 0x1A);
-			pod_data |= (RL16(buf->str + start + 0x29) & 2) << 15;
-			break;
-		case 8: /* L */
-			pod_data = RL16(buf->str + start + 0x1C);
-			pod_data |= (RL16(buf->str + start + 0x29) & 4) << 14;
-			break;
-		case 9: /* M */
-			pod_data = RL16(buf->str + start + 0x1E);
-			pod_data |= (RL16(buf->str + start + 0x29) & 8) << 13;
-			break;
-		case 10: /* N */
-			pod_data = RL16(buf->str + start + 0x20);
-			pod_data |= (RL16(buf->str + start + 0x29) & 16) << 12;
-			break;
-		case 11: /* O */
-			pod_data = RL16(buf->str + start + 0x22);
-			pod_data |= (RL16(buf->str + start + 0x29) & 32) << 11;
-			break;
-		default:
-			pod_data = 0;
-			sr_err("Don't know how to obtain data for pod %d.", pod);
+	buf = inc->out_buf;
+
+	while (count) {
+		n = buf->len < CHUNK_SIZE ? (CHUNK_SIZE - buf->len) / len : 0;
+		n = MIN(MAX(n, 1), count);
+		count -= n;
+
+		pos = buf->len;
+		total = n * len;
+		g_string_set_size(buf, pos + total);
+		p = buf->str + pos;
+		memcpy(p, sample, len);
+		done = len;
+		while (done < total) {
+			chunk = MIN(done, total - done);
+			memcpy(p + done, p, chunk);
+			done += chunk;
 		}
 
-		for (i = 0; i < 17; i++) {
-			value = (pod_data >> i) & 1;
-			single_payload[payload_len] |= value << payload_bit;
-
-			payload_bit++;
-			if (payload_bit > 7) {
-				payload_bit = 0;
-				payload_len++;
-				single_payload[payload_len] = 0;
-			}
-		}
+		if (buf->len >= CHUNK_SIZE)
+			flush_output_buffer(in);
 	}
+}
+
+/* Send a record's sample data, which lasts until the next record. */
+static void append_record(struct sr_input *in, gsize start,
+	const uint8_t *sample, size_t len)
+{
+	struct context *inc;
+	uint64_t timestamp, next_timestamp;
+	int packet_count;
 
-	/* Make sure that payload_len accounts for any incomplete bytes used. */
-	if (payload_bit)
-		payload_len++;
+	inc = in->priv;
 
-	i = (g_slist_length(in->sdi->channels) + 7) / 8;
-	if (payload_len != i) {
-		sr_err("Payload unit size is %d but should be %d!", payload_len, i);
-		return;
-	}
+	timestamp = RL64(in->buf->str + start);
 
 	if (timestamp == inc->trigger_timestamp && !inc->trigger_sent) {
 		sr_dbg("Trigger @%lf s, record #%d.",
@@ -576,32 +507,122 @@ static void process_record_pi(struct sr_input *in, gsize start)
 	/* Is this the last record in the file? */
 	if (inc->cur_record == inc->record_count - 1) {
 		/* It is, so send the last sample data only once. */
-		g_string_append_len(inc->out_buf, single_payload, payload_len);
+		append_samples(in, sample, len, 1);
 	} else {
 		/* It's not, so fill the time gap by sending lots of data. */
-		next_timestamp = RL64(buf->str + start + inc->record_size);
+		next_timestamp = RL64(in->buf->str + start + inc->record_size);
 		packet_count = (int)(next_timestamp - timestamp) / inc->timestamp_scale;
 
 		/* Make sure we send at least one data set. */
 		if (packet_count == 0)
 			packet_count = 1;
 
-		for (i = 0; i < packet_count; i++)
-			g_string_append_len(inc->out_buf, single_payload, payload_len);
+		if (packet_count > 0)
+			append_samples(in, sample, len, packet_count);
 	}
+}
+
+/*
+ * Determine where the enabled pods' bits are found in PI records. Each
+ * pod contributes 16 data bits and its clock bit, the pods' bits are
+ * concatenated in the sample data.
+ *
+ * 0x00 u8  timestamp
+ * 0x08 u16 A15..0
+ * 0x0A u16 B15..0
+ * 0x0C u16 C15..0
+ * 0x0E u16 D15..0
+ * 0x10 u16 E15..0
+ * 0x12 u16 F15..0
+ * 0x14 u32 ??
+ * 0x18 u16 J15..0                          Not present in 500MHz mode
+ * 0x1A u16 K15..0                          Not present in 500MHz mode
+ * 0x1C u16 L15..0                          Not present in 500MHz mode
+ * 0x1E u16 M15..0                          Not present in 500MHz mode
+ * 0x20 u16 N15..0                          Not present in 500MHz mode
+ * 0x22 u16 O15..0                          Not present in 500MHz mode
+ * 0x24 u32 ??                              Not present in 500MHz mode
+ * 0x28/18 u8 CLKF..A (32=CLKF, .., 1=CLKA)
+ * 0x29/1A u8 CLKO..J (32=CLKO, .., 1=CLKJ) Not present in 500MHz mode
+ * 0x2A/19 u8 ??
+ * 0x2B/1A u8 ??
+ * 0x2C/1B u8 ??
+ */
+static void create_pi_pod_map(struct context *inc)
+{
+	struct pi_pod_source *src;
+	size_t pod, pod_count, clk_offset;
 
-	if (inc->out_buf->len >= CHUNK_SIZE)
-		flush_output_buffer(in);
+	if (inc->record_mode == AD_MODE_500MHZ) {
+		pod_count = 6;
+		clk_offset = 0x18;
+	} else {
+		pod_count = 12;
+		clk_offset = 0x28;
+	}
+
+	inc->pi_pod_count = 0;
+	for (pod = 0; pod < pod_count; pod++) {
+		if (!inc->pod_status[pod])
+			continue;
+		src = &inc->pi_pods[inc->pi_pod_count++];
+		if (pod < 6) {
+			src->data_offset = 0x08 + 2 * pod;
+			src->clk_offset = clk_offset;
+			src->clk_bit = pod;
+		} else {
+			src->data_offset = 0x18 + 2 * (pod - 6);
+			src->clk_offset = 0x29;
+			src->clk_bit = pod - 6;
+		}
+	}
+	inc->pi_payload_len = (inc->pi_pod_count * 17 + 7) / 8;
 }
 
-static void process_record_iprobe(struct sr_input *in, gsize start)
+static void process_record_pi(struct sr_input *in, gsize start)
 {
 	struct context *inc;
-	uint64_t timestamp, next_timestamp;
-	char single_payload[3];
-	int i, payload_len, packet_count;
+	const struct pi_pod_source *src;
+	const char *record;
+	uint8_t single_payload[12 * 3];
+	uint32_t pod_data, acc;
+	size_t idx, payload_len;
+	int acc_bits;
 
 	inc = in->priv;
+	record = in->buf->str + start;
+
+	if (inc->pi_payload_len != inc->unitsize) {
+		sr_err("Payload unit size is %zu but should be %zu!",
+			inc->pi_payload_len, inc->unitsize);
+		return;
+	}
+
+	/* Concatenate the pods' 17 bits, emit completed bytes. */
+	acc = 0;
+	acc_bits = 0;
+	payload_len = 0;
+	for (idx = 0; idx < inc->pi_pod_count; idx++) {
+		src = &inc->pi_pods[idx];
+		pod_data = RL16(record + src->data_offset);
+		pod_data |= ((RL16(record + src->clk_offset) >> src->clk_bit) & 1) << 16;
+		acc |= pod_data << acc_bits;
+		acc_bits += 17;
+		while (acc_bits >= 8) {
+			single_payload[payload_len++] = acc & 0xff;
+			acc >>= 8;
+			acc_bits -= 8;
+		}
+	}
+	if (acc_bits)
+		single_payload[payload_len++] = acc & 0xff;
+
+	append_record(in, start, single_payload, payload_len);
+}
+
+static void process_record_iprobe(struct sr_input *in, gsize start)
+{
+	uint8_t single_payload[3];
 
 	/*
 	 * 0x00 u64 timestamp
@@ -609,38 +630,11 @@ static void process_record_iprobe(struct sr_input *in, gsize start)
 	 * 0x0A u8  CLK
 	 */
 
-	timestamp = RL64(in->buf->str + start);
 	single_payload[0] = R8(in->buf->str + start + 0x08);
 	single_payload[1] = R8(in->buf->str + start + 0x09);
 	single_payload[2] = R8(in->buf->str + start + 0x0A) & 1;
-	payload_len = 3;
-
-	if (timestamp == inc->trigger_timestamp && !inc->trigger_sent) {
-		sr_dbg("Trigger @%lf s, record #%d.",
-			timestamp * TIMESTAMP_RESOLUTION, inc->cur_record);
-		std_session_send_df_trigger(in->sdi);
-		inc->trigger_sent = TRUE;
-	}
-
-	/* Is this the last record in the file? */
-	if (inc->cur_record == inc->record_count - 1) {
-		/* It is, so send the last sample data only once. */
-		g_string_append_len(inc->out_buf, single_payload, payload_len);
-	} else {
-		/* It's not, so fill the time gap by sending lots of data. */
-		next_timestamp = RL64(in->buf->str + start + inc->record_size);
-		packet_count = (int)(next_timestamp - timestamp) / inc->timestamp_scale;
-
-		/* Make sure we send at least one data set. */
-		if (packet_count == 0)
-			packet_count = 1;
-
-		for (i = 0; i < packet_count; i++)
-			g_string_append_len(inc->out_buf, single_payload, payload_len);
-	}
 
-	if (inc->out_buf->len >= CHUNK_SIZE)
-		flush_output_buffer(in);
+	append_record(in, start, single_payload, sizeof(single_payload));
 }
 
 static void process_practice_token(struct sr_input *in, char *cmd_token)
@@ -749,7 +743,7 @@ static void process_practice(struct sr_input *in)
 
 	g_strfreev(tokens);
 
-	g_string_erase(in->buf, 0, in->buf->len);
+	sr_input_buf_consume(in, in->buf->len);
 }
 
 static int process_buffer(struct sr_input *in)
@@ -761,7 +755,7 @@ static int process_buffer(struct sr_input *in)
 
 	if (!inc->header_read) {
 		res = process_header(in->buf, inc);
-		g_string_erase(in->buf, 0, inc->header_size);
+		sr_input_buf_consume(in, inc->header_size);
 		if (res != SR_OK)
 			return res;
 	}
@@ -796,7 +790,7 @@ static int process_buffer(struct sr_input *in)
 				inc->records_read = TRUE;
 		}
 
-		g_string_erase(in->buf, 0, i);
+		sr_input_buf_consume(in, i);
 	}
 
 	if (inc->records_read) {
@@ -809,7 +803,7 @@ static int process_buffer(struct sr_input *in)
 
 static int receive(struct sr_input *in, GString *buf)
 {
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf->str, buf->len);
 
 	if (!in->sdi_ready) {
 		/* sdi is ready, notify frontend. */
@@ -850,7 +844,7 @@ static int reset(struct sr_input *in)
 	inc->trigger_sent = FALSE;
 	inc->cur_record = 0;
 
-	g_string_truncate(in->buf, 0);
+	sr_input_buf_clear(in);
 
 	return SR_OK;
 }
@@ -36,12 +36,27 @@
  *   Value > 0: Start at the given timestamp.
  *
  * downsample: Divide the samplerate by the given factor. This can
- *   speed up operation on long captures.
+ *   speed up operation on long captures. Value 0 derives the factor
+ *   from the timestamps in the first part of the data section (the
+ *   largest factor which all of their distances are a multiple of),
+ *   and streams the remainder of the file with it. Later timestamps
+ *   which don't fit that factor get rounded down.
  *
  * compress: Trim idle periods which are longer than this value to span
  *   only this many timescale ticks. This can speed up operation on long
  *   captures (default 0, don't compress).
  *
+ * threads: Number of threads which parse the data section's text. The
+ *   body gets split into chunks at timestamp boundaries. Chunks are
+ *   parsed concurrently, their results get applied in input order.
+ *   Value 0 uses all processors. Default 1, parse in the caller's
+ *   thread.
+ *
+ * When the session accepts SR_DF_LOGIC_RLE packets, logic data gets sent
+ * as the list of its value changes. The cost of the import then depends
+ * on the number of changes, not the number of samples, and there is no
+ * need to downsample logic data (analog data still gets expanded).
+ *
  * Based on Verilog standard IEEE Std 1364-2001 Version C
  *
  * Supported features:
@@ -66,7 +81,10 @@
  * glib routines where they would hurt performance. Lots of memory
  * allocations increase execution time not by percents but by huge
  * factors. This motivated this module's custom code for splitting
- * words on text lines, and pooling previously allocated buffers.
+ * words on text lines, and re-using previously allocated buffers. Text
+ * gets parsed into a list of events (timestamps, value changes) which
+ * then get applied to the current sample values. Which allows to parse
+ * the text on several threads.
  *
  * TODO (in arbitrary order)
  * - Map VCD scopes to sigrok channel groups?
@@ -118,8 +136,17 @@
 #define LOG_PREFIX "input/vcd"
 
 #define CHUNK_SIZE (4 * 1024 * 1024)
+#define VCD_CHUNK_SIZE (256 * 1024)
+#define LOOKAHEAD_SIZE (1024 * 1024)
+#define RLE_CHANGES (64 * 1024)
 #define SCOPE_SEP '.'
 
+/* Parser state which spans text lines, and thus chunks. */
+struct vcd_section_state {
+	gboolean skip_until_end;
+	gboolean ignore_end_keyword;
+};
+
 struct context {
 	struct vcd_user_opt {
 		size_t maxchannels; /* sigrok channels (output) */
@@ -127,17 +154,26 @@ struct context {
 		uint64_t compress;
 		uint64_t skip_starttime;
 		gboolean skip_specified;
+		size_t threads;
 	} options;
 	gboolean use_skip;
 	gboolean started;
+	/* Options in units of samples, after downsampling. */
+	uint64_t downsample;
+	uint64_t compress;
+	uint64_t skip_starttime;
+	uint64_t downsample_phase;
+	gboolean downsample_warned;
 	gboolean got_header;
+	/* Header results survived reset(), the header text is unchecked. */
+	gboolean header_kept;
 	uint64_t prev_timestamp;
 	uint64_t samplerate;
 	size_t vcdsignals; /* VCD signals (input) */
 	GSList *ignored_signals;
+	GHashTable *signals;
 	gboolean data_after_timestamp;
-	gboolean ignore_end_keyword;
-	gboolean skip_until_end;
+	struct vcd_section_state section;
 	GSList *channels;
 	size_t unit_size;
 	size_t logic_count;
@@ -147,16 +183,23 @@ struct context {
 	struct {
 		size_t max_bits;
 		size_t unit_size;
-		uint8_t *value;
-		size_t sig_count;
 	} conv_bits;
 	GString *scope_prefix;
 	struct feed_queue_logic *feed_logic;
-	struct split_state {
-		size_t alloced;
-		char **words;
-		gboolean in_use;
-	} split;
+	struct vcd_rle {
+		gboolean use;
+		uint64_t *offsets;
+		uint8_t *values;
+		size_t num_changes;
+		uint64_t num_samples;
+	} rle;
+	struct vcd_workers {
+		GThreadPool *pool;
+		GMutex mutex;
+		GCond cond;
+		struct vcd_chunk *chunks;
+		size_t chunk_count;
+	} work;
 	struct ts_stats {
 		size_t total_ts_seen;
 		uint64_t last_ts_value;
@@ -189,6 +232,57 @@ struct vcd_channel {
 	struct feed_queue_analog *feed_analog;
 };
 
+/*
+ * A VCD signal identifier, and the channels which it translates to.
+ * Identifiers of signals which were not mapped to sigrok channels
+ * are marked "ignored", to silently accept their value changes.
+ */
+struct vcd_signal {
+	const char *identifier;
+	GSList *channels;
+	gboolean ignored;
+};
+
+/*
+ * Results of parsing a chunk of the data section's text, get applied
+ * in input order. Errors are events, too. So that all data before the
+ * error location gets processed, just like in the absence of chunks.
+ */
+enum vcd_event_type {
+	VCD_EVENT_TIMESTAMP,
+	VCD_EVENT_BITS,
+	VCD_EVENT_REAL,
+	VCD_EVENT_DATA,
+	VCD_EVENT_UNKNOWN,
+	VCD_EVENT_ERROR,
+};
+
+struct vcd_event {
+	enum vcd_event_type type;
+	union {
+		uint64_t timestamp;
+		float real;
+		struct {
+			size_t offset;
+			size_t count;
+		} bits;
+		int ret;
+	} v;
+	const struct vcd_signal *signal;
+	char *text;
+};
+
+struct vcd_chunk {
+	const struct context *inc;
+	const char *text;
+	size_t len;
+	struct vcd_section_state state_in, state_out;
+	GArray *events;
+	GByteArray *bits;
+	GString *scratch;
+	gboolean done;
+};
+
 static void free_channel(void *data)
 {
 	struct vcd_channel *vcd_ch;
@@ -307,6 +401,18 @@ static void ts_stats_check_early(struct ts_stats *stats)
 	}
 }
 
+/*
+ * Apply a downsample factor to the options which are given in timescale
+ * ticks. Value 0 (automatic) starts with factor 1, until the timestamps
+ * in the look-ahead window were seen.
+ */
+static void set_downsample(struct context *inc, uint64_t factor)
+{
+	inc->downsample = factor ? factor : 1;
+	inc->compress = inc->options.compress / inc->downsample;
+	inc->skip_starttime = inc->options.skip_starttime / inc->downsample;
+}
+
 /* Reset the internal state of the timestamp tracker. */
 static int ts_stats_prep(struct context *inc)
 {
@@ -317,7 +423,7 @@ static int ts_stats_prep(struct context *inc)
 	stats = &inc->ts_stats;
 	memset(stats, 0, sizeof(*stats));
 
-	down_sample_value = inc->options.downsample;
+	down_sample_value = inc->downsample;
 	down_sample_shift = 0;
 	while (down_sample_value >= 2) {
 		down_sample_shift++;
@@ -399,7 +505,7 @@ static int ts_stats_post(struct context *inc, gboolean ignore_terminal)
 	 * channel count).
 	 */
 	over_sample = stats->min_items[min_idx].delta;
-	over_sample_scaled = over_sample / inc->options.downsample;
+	over_sample_scaled = over_sample / inc->downsample;
 	sr_dbg("TS post stats: oversample unscaled %" PRIu64 ", scaled %" PRIu64,
 		over_sample, over_sample_scaled);
 	if (over_sample_scaled < 10) {
@@ -424,8 +530,8 @@ static int ts_stats_post(struct context *inc, gboolean ignore_terminal)
 			"Low overall change rate (total min TS delta %" PRIu64 ").",
 			over_sample_scaled);
 	}
-	has_downsample = inc->options.downsample > 1;
-	suggest_factor = inc->options.downsample;
+	has_downsample = inc->downsample > 1;
+	suggest_factor = inc->downsample;
 	while (over_sample_scaled >= 10) {
 		suggest_factor *= 10;
 		over_sample_scaled /= 10;
@@ -443,22 +549,25 @@ static int ts_stats_post(struct context *inc, gboolean ignore_terminal)
 	return SR_OK;
 }
 
-static void check_remove_bom(GString *buf)
+/* Get the length of the byte order mark the text starts with, if any. */
+static size_t bom_length(const GString *buf)
 {
 	static const char *bom_text = "\xef\xbb\xbf";
 
 	if (buf->len < strlen(bom_text))
-		return;
+		return 0;
 	if (strncmp(buf->str, bom_text, strlen(bom_text)) != 0)
-		return;
-	g_string_erase(buf, 0, strlen(bom_text));
+		return 0;
+	return strlen(bom_text);
 }
 
 /*
  * Reads a single VCD section from input file and parses it to name/contents.
  * e.g. $timescale 1ps $end => "timescale" "1ps"
+ * The length of the input text which was taken is stored in "used".
  */
-static gboolean parse_section(GString *buf, char **name, char **contents)
+static gboolean parse_section(const GString *buf, char **name,
+	char **contents, size_t *used)
 {
 	static const char *end_text = "$end";
 
@@ -510,8 +619,7 @@ static gboolean parse_section(GString *buf, char **name, char **contents)
 		if (sname->len)
 			status = TRUE;
 
-		/* Consume the input text which just was taken. */
-		g_string_erase(buf, 0, pos);
+		*used = pos;
 	}
 
 	/* Return section name and content if a section was seen. */
@@ -554,109 +662,6 @@ static void remove_empty_parts(gchar **parts)
 	*dest = NULL;
 }
 
-static char **split_text_line(struct context *inc, char *text, size_t *count)
-{
-	struct split_state *state;
-	size_t counted, alloced, wanted;
-	char **words, *p, **new_words;
-
-	state = &inc->split;
-
-	if (count)
-		*count = 0;
-
-	if (state->in_use) {
-		sr_dbg("coding error, split() called while \"in use\".");
-		return NULL;
-	}
-
-	/*
-	 * Seed allocation when invoked for the first time. Assume
-	 * simple logic data, start with a few words per line. Will
-	 * automatically adjust with subsequent use.
-	 */
-	if (!state->alloced) {
-		alloced = 20;
-		words = g_malloc(sizeof(words[0]) * alloced);
-		if (!words)
-			return NULL;
-		state->alloced = alloced;
-		state->words = words;
-	}
-
-	/* Start with most recently allocated word list space. */
-	alloced = state->alloced;
-	words = state->words;
-	counted = 0;
-
-	/* As long as more input text remains ... */
-	p = text;
-	while (*p) {
-		/* Resize word list if needed. Just double the size. */
-		if (counted + 1 >= alloced) {
-			wanted = 2 * alloced;
-			new_words = g_realloc(words, sizeof(words[0]) * wanted);
-			if (!new_words) {
-				return NULL;
-			}
-			words = new_words;
-			alloced = wanted;
-			state->words = words;
-			state->alloced = alloced;
-		}
-
-		/* Skip leading spaces. */
-		while (g_ascii_isspace(*p))
-			p++;
-		if (!*p)
-			break;
-
-		/* Add found word to word list. */
-		words[counted++] = p;
-
-		/* Find end of the word. Terminate loop upon EOS. */
-		while (*p && !g_ascii_isspace(*p))
-			p++;
-		if (!*p)
-			break;
-
-		/* More text follows. Terminate the word. */
-		*p++ = '\0';
-	}
-
-	/*
-	 * NULL terminate the word list. Provide its length so that
-	 * calling code need not re-iterate the list to get the count.
-	 */
-	words[counted] = NULL;
-	if (count)
-		*count = counted;
-	state->in_use = TRUE;
-
-	return words;
-}
-
-static void free_text_split(struct context *inc, char **words)
-{
-	struct split_state *state;
-
-	state = &inc->split;
-
-	if (words && words != state->words) {
-		sr_dbg("coding error, free() arg differs from split() result.");
-	}
-
-	/* "Double free" finally releases the memory. */
-	if (!state->in_use) {
-		g_free(state->words);
-		state->words = NULL;
-		state->alloced = 0;
-	}
-
-	/* Mark as no longer in use. */
-	state->in_use = FALSE;
-}
-
 static gboolean have_header(GString *buf)
 {
 	static const char *enddef_txt = "$enddefinitions";
@@ -1112,6 +1117,57 @@ static void create_feeds(const struct sr_input *in)
 	}
 }
 
+static void free_signal(void *data)
+{
+	struct vcd_signal *signal;
+
+	signal = data;
+	g_slist_free(signal->channels);
+	g_free(signal);
+}
+
+static struct vcd_signal *get_signal(struct context *inc, const char *id)
+{
+	struct vcd_signal *signal;
+
+	signal = g_hash_table_lookup(inc->signals, id);
+	if (signal)
+		return signal;
+
+	signal = g_malloc0(sizeof(*signal));
+	signal->identifier = id;
+	g_hash_table_insert(inc->signals, (gpointer)id, signal);
+
+	return signal;
+}
+
+/*
+ * Map VCD signal identifiers to their channels. Data section parsing
+ * looks up identifiers in this table, which remains unchanged after
+ * the header was parsed (can get accessed from several threads).
+ */
+static void create_signals(const struct sr_input *in)
+{
+	struct context *inc;
+	GSList *l;
+	struct vcd_channel *vcd_ch;
+	struct vcd_signal *signal;
+
+	inc = in->priv;
+
+	inc->signals = g_hash_table_new_full(g_str_hash, g_str_equal,
+		NULL, free_signal);
+	for (l = inc->channels; l; l = l->next) {
+		vcd_ch = l->data;
+		signal = get_signal(inc, vcd_ch->identifier);
+		signal->channels = g_slist_append(signal->channels, vcd_ch);
+	}
+	for (l = inc->ignored_signals; l; l = l->next) {
+		signal = get_signal(inc, l->data);
+		signal->ignored = TRUE;
+	}
+}
+
 /*
  * Keep track of a previously created channel list, in preparation of
  * re-reading the input file. Gets called from reset()/cleanup() paths.
@@ -1172,14 +1228,63 @@ static gboolean check_header_in_reread(const struct sr_input *in)
 	return TRUE;
 }
 
+/*
+ * Prepare the processing of the data section, after the header was
+ * parsed or recognized as the one which was parsed before.
+ */
+static int setup_data(struct sr_input *in)
+{
+	struct context *inc;
+	size_t size;
+	int ret;
+
+	inc = in->priv;
+
+	create_feeds(in);
+
+	/*
+	 * Determine the size of text to number conversions. Allocate
+	 * buffers to hold current sample values before submission to
+	 * the session feed. Allocate one buffer for all logic bits, and another for
+	 * all floating point values of all analog channels.
+	 *
+	 * The buffers get updated when the VCD input stream communicates
+	 * value changes. Upon reception of VCD timestamps, the buffer can
+	 * provide the previously received values, to "fill in the gaps"
+	 * in the generation of a continuous stream of samples for the
+	 * sigrok session.
+	 */
+	size = (inc->conv_bits.max_bits + 7) / 8;
+	inc->conv_bits.unit_size = size;
+
+	size = (inc->logic_count + 7) / 8;
+	inc->unit_size = size;
+	inc->current_logic = g_malloc0(size);
+	if (inc->unit_size && !inc->current_logic)
+		return SR_ERR_MALLOC;
+	size = sizeof(inc->current_floats[0]) * inc->analog_count;
+	inc->current_floats = g_malloc0(size);
+	if (size && !inc->current_floats)
+		return SR_ERR_MALLOC;
+	for (size = 0; size < inc->analog_count; size++)
+		inc->current_floats[size] = 0.;
+
+	set_downsample(inc, inc->options.downsample);
+	ret = ts_stats_prep(inc);
+	if (ret != SR_OK)
+		return ret;
+
+	return SR_OK;
+}
+
 /* Parse VCD file header sections (rate and variables declarations). */
-static int parse_header(const struct sr_input *in, GString *buf)
+static int parse_header(struct sr_input *in)
 {
 	struct context *inc;
 	gboolean enddef_seen, header_valid;
 	char *name, *contents;
-	size_t size;
-	int ret;
+	GString *text;
+	size_t used;
 
 	inc = in->priv;
 
@@ -1187,8 +1292,12 @@ static int parse_header(const struct sr_input *in, GString *buf)
 	enddef_seen = FALSE;
 	header_valid = TRUE;
 	name = contents = NULL;
+	text = g_string_new(NULL);
 	inc->conv_bits.max_bits = 1;
-	while (parse_section(buf, &name, &contents)) {
+	while (parse_section(in->buf, &name, &contents, &used)) {
+		/* Consume the input text which just was taken. */
+		g_string_append_len(text, in->buf->str, used);
+		sr_input_buf_consume(in, used);
 		sr_dbg("Section '%s', contents '%s'.", name, contents);
 
 		if (g_strcmp0(name, "enddefinitions") == 0) {
@@ -1229,51 +1338,105 @@ done_section:
 	g_free(contents);
 
 	inc->got_header = enddef_seen && header_valid;
-	if (!inc->got_header)
+	if (!inc->got_header) {
+		g_string_free(text, TRUE);
 		return SR_ERR_DATA;
+	}
 
 	/* Create sigrok channels here, late, logic before analog. */
 	create_channels(in, in->sdi, SR_CHANNEL_LOGIC);
 	create_channels(in, in->sdi, SR_CHANNEL_ANALOG);
-	if (!check_header_in_reread(in))
+	if (!check_header_in_reread(in)) {
+		g_string_free(text, TRUE);
 		return SR_ERR_DATA;
-	create_feeds(in);
+	}
+	create_signals(in);
 
-	/*
-	 * Allocate space for text to number conversion, and buffers to
-	 * hold current sample values before submission to the session
-	 * feed. Allocate one buffer for all logic bits, and another for
-	 * all floating point values of all analog channels.
-	 *
-	 * The buffers get updated when the VCD input stream communicates
-	 * value changes. Upon reception of VCD timestamps, the buffer can
-	 * provide the previously received values, to "fill in the gaps"
-	 * in the generation of a continuous stream of samples for the
-	 * sigrok session.
-	 */
-	size = (inc->conv_bits.max_bits + 7) / 8;
-	inc->conv_bits.unit_size = size;
-	inc->conv_bits.value = g_malloc0(size);
-	if (!inc->conv_bits.value)
-		return SR_ERR_MALLOC;
+	/* Re-reads of the input can skip this header, see reset(). */
+	sr_input_header_keep(in, text->str, text->len);
+	g_string_free(text, TRUE);
 
-	size = (inc->logic_count + 7) / 8;
-	inc->unit_size = size;
-	inc->current_logic = g_malloc0(size);
-	if (inc->unit_size && !inc->current_logic)
-		return SR_ERR_MALLOC;
-	size = sizeof(inc->current_floats[0]) * inc->analog_count;
-	inc->current_floats = g_malloc0(size);
-	if (size && !inc->current_floats)
-		return SR_ERR_MALLOC;
-	for (size = 0; size < inc->analog_count; size++)
-		inc->current_floats[size] = 0.;
+	return setup_data(in);
+}
 
-	ret = ts_stats_prep(inc);
-	if (ret != SR_OK)
-		return ret;
+/* Send the value changes which were queued for logic data. */
+static int rle_flush(const struct sr_input *in)
+{
+	struct context *inc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic_rle rle;
 
-	return SR_OK;
+	inc = in->priv;
+	if (!inc->rle.num_samples)
+		return SR_OK;
+
+	memset(&rle, 0, sizeof(rle));
+	rle.num_samples = inc->rle.num_samples;
+	rle.unitsize = inc->unit_size;
+	rle.num_changes = inc->rle.num_changes;
+	rle.offsets = inc->rle.offsets;
+	rle.values = inc->rle.values;
+	packet.type = SR_DF_LOGIC_RLE;
+	packet.payload = &rle;
+	inc->rle.num_changes = 0;
+	inc->rle.num_samples = 0;
+
+	return sr_session_send(in->sdi, &packet);
+}
+
+/*
+ * Queue N samples of the current logic value. Only changes are kept,
+ * a run costs the same regardless of its length.
+ */
+static void rle_submit(const struct sr_input *in, size_t count)
+{
+	struct context *inc;
+	struct vcd_rle *rle;
+	uint8_t *last;
+
+	inc = in->priv;
+	rle = &inc->rle;
+	if (!count)
+		return;
+
+	last = NULL;
+	if (rle->num_changes)
+		last = rle->values + (rle->num_changes - 1) * inc->unit_size;
+	if (!last || memcmp(last, inc->current_logic, inc->unit_size)) {
+		if (rle->num_changes == RLE_CHANGES)
+			(void)rle_flush(in);
+		rle->offsets[rle->num_changes] = rle->num_samples;
+		memcpy(rle->values + rle->num_changes * inc->unit_size,
+			inc->current_logic, inc->unit_size);
+		rle->num_changes++;
+	}
+	rle->num_samples += count;
+}
+
+/*
+ * Check once before the first sample data, whether logic data can get
+ * sent as SR_DF_LOGIC_RLE packets. The device instance only becomes
+ * part of a session after the header was processed.
+ */
+static void check_rle(const struct sr_input *in)
+{
+	struct context *inc;
+
+	inc = in->priv;
+	if (!inc->logic_count)
+		return;
+	if (!sr_session_logic_rle_accepted(in->sdi->session))
+		return;
+	inc->rle.offsets = g_try_malloc(RLE_CHANGES * sizeof(uint64_t));
+	inc->rle.values = g_try_malloc(RLE_CHANGES * inc->unit_size);
+	if (!inc->rle.offsets || !inc->rle.values) {
+		g_free(inc->rle.offsets);
+		g_free(inc->rle.values);
+		memset(&inc->rle, 0, sizeof(inc->rle));
+		return;
+	}
+	inc->rle.use = TRUE;
+	sr_dbg("Sending run-length encoded logic data.");
 }
 
 /*
@@ -1291,7 +1454,11 @@ static void add_samples(const struct sr_input *in, size_t count, gboolean flush)
 
 	inc = in->priv;
 
-	if (inc->logic_count) {
+	if (inc->logic_count && inc->rle.use) {
+		rle_submit(in, count);
+		if (flush)
+			(void)rle_flush(in);
+	} else if (inc->logic_count) {
 		feed_queue_logic_submit(inc->feed_logic,
 			inc->current_logic, count);
 		if (flush)
@@ -1311,19 +1478,6 @@ static void add_samples(const struct sr_input *in, size_t count, gboolean flush)
 	}
 }
 
-static gint vcd_compare_id(gconstpointer a, gconstpointer b)
-{
-	return strcmp((const char *)a, (const char *)b);
-}
-
-static gboolean is_ignored(struct context *inc, const char *id)
-{
-	GSList *ignored;
-
-	ignored = g_slist_find_custom(inc->ignored_signals, id, vcd_compare_id);
-	return ignored != NULL;
-}
-
 /*
  * Get an analog channel's value from a bit pattern (VCD 'integer' type).
  * The implementation assumes a maximum integer width (64bit), the API
@@ -1331,7 +1485,7 @@ static gboolean is_ignored(struct context *inc, const char *id)
  * channels may further constraint the number of significant digits
  * (current asumption: float -> 23bit).
  */
-static float get_int_val(uint8_t *in_bits_data, size_t in_bits_count)
+static float get_int_val(const uint8_t *in_bits_data, size_t in_bits_count)
 {
 	uint64_t int_value;
 	size_t byte_count, byte_idx;
@@ -1355,8 +1509,9 @@ static float get_int_val(uint8_t *in_bits_data, size_t in_bits_count)
  * and parsed value. Multi-bit VCD values will affect several sigrok
  * channels. One VCD signal name can translate to several sigrok channels.
  */
-static void process_bits(struct context *inc, char *identifier,
-	uint8_t *in_bits_data, size_t in_bits_count)
+static void process_bits(struct context *inc,
+	const struct vcd_signal *signal,
+	const uint8_t *in_bits_data, size_t in_bits_count)
 {
 	size_t size;
 	gboolean have_int;
@@ -1364,17 +1519,18 @@ static void process_bits(struct context *inc, char *identifier,
 	struct vcd_channel *vcd_ch;
 	float int_val;
 	size_t bit_idx;
-	uint8_t *in_bit_ptr, in_bit_mask;
+	const uint8_t *in_bit_ptr;
+	uint8_t in_bit_mask;
 	uint8_t *out_bit_ptr, out_bit_mask;
 	uint8_t bit_val;
+	const char *identifier;
 
+	identifier = signal->identifier;
 	size = 0;
 	have_int = FALSE;
 	int_val = 0;
-	for (l = inc->channels; l; l = l->next) {
+	for (l = signal->channels; l; l = l->next) {
 		vcd_ch = l->data;
-		if (g_strcmp0(identifier, vcd_ch->identifier) != 0)
-			continue;
 		if (vcd_ch->type == SR_CHANNEL_ANALOG) {
 			/* Special case for 'integer' VCD signal types. */
 			size = vcd_ch->size; /* Flag for "VCD signal found". */
@@ -1430,7 +1586,7 @@ static void process_bits(struct context *inc, char *identifier,
 			}
 		}
 	}
-	if (!size && !is_ignored(inc, identifier))
+	if (!size && !signal->ignored)
 		sr_warn("VCD signal not found for ID '%s'.", identifier);
 }
 
@@ -1438,19 +1594,20 @@ static void process_bits(struct context *inc, char *identifier,
  * Set an analog channel's value from a floating point number. One
  * VCD signal name can translate to several sigrok channels.
  */
-static void process_real(struct context *inc, char *identifier, float real_val)
+static void process_real(struct context *inc,
+	const struct vcd_signal *signal, float real_val)
 {
 	gboolean found;
 	GSList *l;
 	struct vcd_channel *vcd_ch;
+	const char *identifier;
 
+	identifier = signal->identifier;
 	found = FALSE;
-	for (l = inc->channels; l; l = l->next) {
+	for (l = signal->channels; l; l = l->next) {
 		vcd_ch = l->data;
 		if (vcd_ch->type != SR_CHANNEL_ANALOG)
 			continue;
-		if (g_strcmp0(identifier, vcd_ch->identifier) != 0)
-			continue;
 
 		/* Found our (analog) channel. */
 		found = TRUE;
@@ -1458,7 +1615,7 @@ static void process_real(struct context *inc, char *identifier, float real_val)
 			identifier, vcd_ch->array_index, real_val);
 		inc->current_floats[vcd_ch->array_index] = real_val;
 	}
-	if (!found && !is_ignored(inc, identifier))
+	if (!found && !signal->ignored)
 		sr_warn("VCD signal not found for ID '%s'.", identifier);
 }
 
@@ -1596,406 +1753,819 @@ static gboolean vcd_string_valid(const char *s)
 	return TRUE;
 }
 
-/* Parse one text line of the data section. */
-static int parse_textline(const struct sr_input *in, char *lines)
+/*
+ * Apply a timestamp to the session feed. Numbers prefixed by '#' are
+ * timestamps, which translate to sigrok sample numbers. Apply optional
+ * downsampling, and apply the 'skip' logic. Check the recent timestamp
+ * for plausibility. Submit the corresponding number of samples of
+ * previously accumulated data values to the session feed.
+ */
+static int process_timestamp(const struct sr_input *in, uint64_t timestamp)
 {
 	struct context *inc;
-	int ret;
-	char **words;
-	size_t word_count, word_idx;
-	char *curr_word, *next_word, curr_first;
-	gboolean is_timestamp, is_section;
-	gboolean is_real, is_multibit, is_singlebit, is_string;
-	uint64_t timestamp;
-	char *identifier, *endptr;
 	size_t count;
+	int ret;
 
 	inc = in->priv;
 
+	sr_spew("Got timestamp: %" PRIu64, timestamp);
+	if (!inc->rle.use || inc->analog_count) {
+		ret = ts_stats_check(&inc->ts_stats, timestamp);
+		if (ret != SR_OK)
+			return ret;
+	}
+	if (inc->downsample > 1) {
+		if (!inc->options.downsample && !inc->downsample_warned &&
+				timestamp % inc->downsample != inc->downsample_phase) {
+			sr_warn("Timestamp %" PRIu64 " is not a multiple of "
+				"the detected downsample factor %" PRIu64 ", "
+				"rounding.", timestamp, inc->downsample);
+			inc->downsample_warned = TRUE;
+		}
+		timestamp /= inc->downsample;
+		sr_spew("Downsampled timestamp: %" PRIu64, timestamp);
+	}
+
 	/*
-	 * Split the caller's text lines into a list of space separated
-	 * words. Note that some of the branches consume the very next
-	 * words as well, and assume that both adjacent words will be
-	 * available when the first word is seen. This constraint applies
-	 * to bit vector data, multi-bit integers and real (float) data,
-	 * as well as single-bit data with whitespace before its
-	 * identifier (if that's valid in VCD, we'd accept it here).
-	 * The fact that callers always pass complete text lines should
-	 * make this assumption acceptable.
+	 * Skip < 0 => skip until first timestamp.
+	 * Skip = 0 => don't skip
+	 * Skip > 0 => skip until timestamp >= skip.
 	 */
-	ret = SR_OK;
-	words = split_text_line(inc, lines, &word_count);
-	for (word_idx = 0; word_idx < word_count; word_idx++) {
-		/*
-		 * Make the next two words available, to simpilify code
-		 * paths below. The second word is optional here.
-		 */
-		curr_word = words[word_idx];
-		if (!curr_word && !curr_word[0])
-			continue;
-		curr_first = g_ascii_tolower(curr_word[0]);
-		next_word = words[word_idx + 1];
-		if (next_word && !next_word[0])
-			next_word = NULL;
-
+	if (inc->options.skip_specified && !inc->use_skip) {
+		sr_dbg("Seeding skip from user spec %" PRIu64,
+			inc->skip_starttime);
+		inc->prev_timestamp = inc->skip_starttime;
+		inc->use_skip = TRUE;
+	}
+	if (!inc->use_skip) {
+		sr_dbg("Seeding skip from first timestamp");
+		inc->skip_starttime = timestamp;
+		inc->prev_timestamp = timestamp;
+		inc->use_skip = TRUE;
+		return SR_OK;
+	}
+	if (inc->skip_starttime && timestamp < inc->skip_starttime) {
+		sr_spew("Timestamp skipped, before user spec");
+		inc->prev_timestamp = inc->skip_starttime;
+		return SR_OK;
+	}
+	if (timestamp == inc->prev_timestamp) {
 		/*
-		 * Optionally skip some sections that can be interleaved
-		 * with data (and may or may not be supported by this
-		 * input module). If the section is not skipped but the
-		 * $end keyword needs to get tracked, specifically handle
-		 * this case, for improved robustness (still reject files
-		 * which happen to use invalid syntax).
+		 * Ignore repeated timestamps (e.g. sigrok outputs these).
+		 * Can also happen when downsampling makes distinct input
+		 * values end up at the same scaled down value. Also
+		 * transparently covers the initial timestamp.
 		 */
-		if (inc->skip_until_end) {
-			if (strcmp(curr_word, "$end") == 0) {
-				/* Done with unhandled/unknown section. */
-				sr_dbg("done skipping until $end");
-				inc->skip_until_end = FALSE;
-			} else {
-				sr_spew("skipping word: %s", curr_word);
-			}
-			continue;
-		}
-		if (inc->ignore_end_keyword) {
-			if (strcmp(curr_word, "$end") == 0) {
-				sr_dbg("done ignoring $end keyword");
-				inc->ignore_end_keyword = FALSE;
-				continue;
-			}
+		sr_spew("Timestamp is identical to previous timestamp");
+		return SR_OK;
+	}
+	if (timestamp < inc->prev_timestamp) {
+		sr_err("Invalid timestamp: %" PRIu64 " (leap backwards).", timestamp);
+		return SR_ERR_DATA;
+	}
+	if (inc->compress) {
+		/* Compress long idle periods */
+		count = timestamp - inc->prev_timestamp;
+		if (count > inc->compress) {
+			sr_dbg("Long idle period, compressing");
+			count = timestamp - inc->compress;
+			inc->prev_timestamp = count;
 		}
+	}
 
-		/*
-		 * There may be $keyword sections inside the data part of
-		 * the input file. Do inspect some of the sections' content
-		 * but ignore their surrounding keywords. Silently skip
-		 * unsupported section types (which transparently covers
-		 * $comment sections).
-		 */
-		is_section = curr_first == '$' && curr_word[1];
-		if (is_section) {
-			gboolean inspect_data;
-
-			inspect_data = FALSE;
-			inspect_data |= g_strcmp0(curr_word, "$dumpvars") == 0;
-			inspect_data |= g_strcmp0(curr_word, "$dumpon") == 0;
-			inspect_data |= g_strcmp0(curr_word, "$dumpoff") == 0;
-			if (inspect_data) {
-				/* Ignore keywords, yet parse contents. */
-				sr_dbg("%s section, will parse content", curr_word);
-				inc->ignore_end_keyword = TRUE;
-			} else {
-				/* Ignore section from here up to $end. */
-				sr_dbg("%s section, will skip until $end", curr_word);
-				inc->skip_until_end = TRUE;
-			}
-			continue;
-		}
+	/* Generate samples from prev_timestamp up to timestamp - 1. */
+	count = timestamp - inc->prev_timestamp;
+	sr_spew("Got a new timestamp, feeding %zu samples", count);
+	add_samples(in, count, FALSE);
+	inc->prev_timestamp = timestamp;
+	inc->data_after_timestamp = FALSE;
 
-		/*
-		 * Numbers prefixed by '#' are timestamps, which translate
-		 * to sigrok sample numbers. Apply optional downsampling,
-		 * and apply the 'skip' logic. Check the recent timestamp
-		 * for plausibility. Submit the corresponding number of
-		 * samples of previously accumulated data values to the
-		 * session feed.
-		 */
-		is_timestamp = curr_first == '#' && g_ascii_isdigit(curr_word[1]);
-		if (is_timestamp) {
-			endptr = NULL;
-			timestamp = strtoull(&curr_word[1], &endptr, 10);
-			if (!endptr || *endptr) {
-				sr_err("Invalid timestamp: %s.", curr_word);
-				ret = SR_ERR_DATA;
-				break;
-			}
-			sr_spew("Got timestamp: %" PRIu64, timestamp);
-			ret = ts_stats_check(&inc->ts_stats, timestamp);
-			if (ret != SR_OK)
-				break;
-			if (inc->options.downsample > 1) {
-				timestamp /= inc->options.downsample;
-				sr_spew("Downsampled timestamp: %" PRIu64, timestamp);
+	return SR_OK;
+}
+
+/*
+ * Get the next space separated word from a text line. Does not modify
+ * the input text, chunks may need to get parsed another time.
+ */
+static gboolean get_word(const char **pos, const char *end,
+	const char **word, size_t *len)
+{
+	const char *p;
+
+	p = *pos;
+	while (p < end && g_ascii_isspace(*p))
+		p++;
+	if (p == end) {
+		*pos = p;
+		return FALSE;
+	}
+	*word = p;
+	while (p < end && !g_ascii_isspace(*p))
+		p++;
+	*len = p - *word;
+	*pos = p;
+
+	return TRUE;
+}
+
+static gboolean word_is(const char *word, size_t len, const char *text)
+{
+	return strlen(text) == len && memcmp(word, text, len) == 0;
+}
+
+/* Get a NUL terminated copy of a word, in the chunk's scratch space. */
+static const char *chunk_word_text(struct vcd_chunk *chunk,
+	const char *word, size_t len)
+{
+	g_string_truncate(chunk->scratch, 0);
+	g_string_append_len(chunk->scratch, word, len);
+
+	return chunk->scratch->str;
+}
+
+static void chunk_add_event(struct vcd_chunk *chunk,
+	enum vcd_event_type type, const struct vcd_signal *signal)
+{
+	struct vcd_event event;
+
+	memset(&event, 0, sizeof(event));
+	event.type = type;
+	event.signal = signal;
+	g_array_append_val(chunk->events, event);
+}
+
+static void chunk_add_error(struct vcd_chunk *chunk,
+	const char *format, const char *text)
+{
+	struct vcd_event *event;
+
+	chunk_add_event(chunk, VCD_EVENT_ERROR, NULL);
+	event = &g_array_index(chunk->events, struct vcd_event,
+		chunk->events->len - 1);
+	event->v.ret = SR_ERR_DATA;
+	event->text = g_strdup_printf(format, text);
+}
+
+/*
+ * Note that data was seen. Only needs to get tracked once after each
+ * timestamp, and at the start of a chunk.
+ */
+static void chunk_add_data(struct vcd_chunk *chunk)
+{
+	struct vcd_event *last;
+
+	if (chunk->events->len) {
+		last = &g_array_index(chunk->events, struct vcd_event,
+			chunk->events->len - 1);
+		if (last->type != VCD_EVENT_TIMESTAMP)
+			return;
+	}
+	chunk_add_event(chunk, VCD_EVENT_DATA, NULL);
+}
+
+/*
+ * Add the event for a value change of a signal. Values of unknown
+ * signals are reported when the event gets applied. Values of ignored
+ * signals just count as data after the most recent timestamp.
+ */
+static struct vcd_event *chunk_add_value(struct vcd_chunk *chunk,
+	enum vcd_event_type type, const char *id, size_t id_len)
+{
+	const struct vcd_signal *signal;
+	struct vcd_event *event;
+	const char *id_text;
+
+	id_text = chunk_word_text(chunk, id, id_len);
+	signal = g_hash_table_lookup(chunk->inc->signals, id_text);
+	if (!signal) {
+		chunk_add_event(chunk, VCD_EVENT_UNKNOWN, NULL);
+		event = &g_array_index(chunk->events, struct vcd_event,
+			chunk->events->len - 1);
+		event->text = g_strdup(id_text);
+		return NULL;
+	}
+	if (!signal->channels) {
+		chunk_add_data(chunk);
+		return NULL;
+	}
+	chunk_add_event(chunk, type, signal);
+
+	return &g_array_index(chunk->events, struct vcd_event,
+		chunk->events->len - 1);
+}
+
+static void chunk_clear_events(struct vcd_chunk *chunk)
+{
+	struct vcd_event *event;
+	size_t idx;
+
+	for (idx = 0; idx < chunk->events->len; idx++) {
+		event = &g_array_index(chunk->events, struct vcd_event, idx);
+		g_free(event->text);
+	}
+	g_array_set_size(chunk->events, 0);
+	g_byte_array_set_size(chunk->bits, 0);
+}
+
+/*
+ * Parse a chunk of complete text lines of the data section into a list
+ * of events. Only reads from the input module's context, may run on
+ * another thread. Begins with the caller provided section state, and
+ * keeps the state at the chunk's end.
+ *
+ * Some of the branches consume the very next word as well, and assume
+ * that both adjacent words will be available on the same text line.
+ * This constraint applies to bit vector data, multi-bit integers and
+ * real (float) data, as well as single-bit data with whitespace before
+ * its identifier (if that's valid in VCD, we'd accept it here).
+ */
+static void parse_chunk(struct vcd_chunk *chunk)
+{
+	const struct context *inc;
+	struct vcd_section_state state;
+	const char *pos, *end, *line_end;
+	const char *curr_word, *next_word;
+	size_t curr_len, next_len;
+	gboolean have_next;
+	char curr_first;
+	gboolean is_timestamp, is_section;
+	gboolean is_real, is_multibit, is_singlebit, is_string;
+	const char *text, *endptr;
+	uint64_t timestamp;
+	struct vcd_event *event;
+	int ret;
+
+	inc = chunk->inc;
+	chunk_clear_events(chunk);
+	state = chunk->state_in;
+
+	pos = chunk->text;
+	end = chunk->text + chunk->len;
+	while (pos < end) {
+		line_end = memchr(pos, '\n', end - pos);
+		if (!line_end)
+			line_end = end;
+		have_next = get_word(&pos, line_end, &next_word, &next_len);
+		while (have_next) {
+			/*
+			 * Make the next two words available, to simplify
+			 * code paths below. The second word is optional.
+			 */
+			curr_word = next_word;
+			curr_len = next_len;
+			curr_first = g_ascii_tolower(curr_word[0]);
+			have_next = get_word(&pos, line_end, &next_word, &next_len);
+
+			/*
+			 * Optionally skip some sections that can be
+			 * interleaved with data (and may or may not be
+			 * supported by this input module). If the section
+			 * is not skipped but the $end keyword needs to get
+			 * tracked, specifically handle this case, for
+			 * improved robustness (still reject files which
+			 * happen to use invalid syntax).
+			 */
+			if (state.skip_until_end) {
+				if (word_is(curr_word, curr_len, "$end")) {
+					/* Done with unhandled/unknown section. */
+					sr_dbg("done skipping until $end");
+					state.skip_until_end = FALSE;
+				}
+				continue;
+			}
+			if (state.ignore_end_keyword) {
+				if (word_is(curr_word, curr_len, "$end")) {
+					sr_dbg("done ignoring $end keyword");
+					state.ignore_end_keyword = FALSE;
+					continue;
+				}
 			}
 
 			/*
-			 * Skip < 0 => skip until first timestamp.
-			 * Skip = 0 => don't skip
-			 * Skip > 0 => skip until timestamp >= skip.
+			 * There may be $keyword sections inside the data
+			 * part of the input file. Do inspect some of the
+			 * sections' content but ignore their surrounding
+			 * keywords. Silently skip unsupported section types
+			 * (which transparently covers $comment sections).
 			 */
-			if (inc->options.skip_specified && !inc->use_skip) {
-				sr_dbg("Seeding skip from user spec %" PRIu64,
-					inc->options.skip_starttime);
-				inc->prev_timestamp = inc->options.skip_starttime;
-				inc->use_skip = TRUE;
+			is_section = curr_first == '$' && curr_len > 1;
+			if (is_section) {
+				gboolean inspect_data;
+
+				inspect_data = FALSE;
+				inspect_data |= word_is(curr_word, curr_len, "$dumpvars");
+				inspect_data |= word_is(curr_word, curr_len, "$dumpon");
+				inspect_data |= word_is(curr_word, curr_len, "$dumpoff");
+				if (inspect_data) {
+					/* Ignore keywords, yet parse contents. */
+					sr_dbg("%.*s section, will parse content",
+						(int)curr_len, curr_word);
+					state.ignore_end_keyword = TRUE;
+				} else {
+					/* Ignore section from here up to $end. */
+					sr_dbg("%.*s section, will skip until $end",
+						(int)curr_len, curr_word);
+					state.skip_until_end = TRUE;
+				}
+				continue;
 			}
-			if (!inc->use_skip) {
-				sr_dbg("Seeding skip from first timestamp");
-				inc->options.skip_starttime = timestamp;
-				inc->prev_timestamp = timestamp;
-				inc->use_skip = TRUE;
+
+			/* Timestamps get applied to the feed in input order. */
+			is_timestamp = curr_first == '#' && curr_len > 1;
+			is_timestamp = is_timestamp && g_ascii_isdigit(curr_word[1]);
+			if (is_timestamp) {
+				ret = sr_parse_u64_ascii(&curr_word[1], curr_len - 1,
+					&timestamp, &endptr);
+				if (ret != SR_OK || endptr != &curr_word[curr_len]) {
+					text = chunk_word_text(chunk, curr_word, curr_len);
+					chunk_add_error(chunk, "Invalid timestamp: %s.", text);
+					goto done;
+				}
+				chunk_add_event(chunk, VCD_EVENT_TIMESTAMP, NULL);
+				event = &g_array_index(chunk->events,
+					struct vcd_event, chunk->events->len - 1);
+				event->v.timestamp = timestamp;
 				continue;
 			}
-			if (inc->options.skip_starttime && timestamp < inc->options.skip_starttime) {
-				sr_spew("Timestamp skipped, before user spec");
-				inc->prev_timestamp = inc->options.skip_starttime;
+
+			/*
+			 * Data values come in different formats, are associated
+			 * with channel identifiers, and correspond to the period
+			 * of time from the most recent timestamp to the next
+			 * timestamp.
+			 *
+			 * Supported input data formats are:
+			 * - S<value> <sep> <id> (value not used, VCD type 'string').
+			 * - R<value> <sep> <id> (analog channel, VCD type 'real').
+			 * - B<value> <sep> <id> (analog channel, VCD type 'integer').
+			 * - B<value> <sep> <id> (logic channels, VCD bit vectors).
+			 * - <value> <id> (logic channel, VCD single-bit values).
+			 *
+			 * Input values can be:
+			 * - Floating point numbers.
+			 * - Bit strings (which covers multi-bit aka integers
+			 *   as well as vectors).
+			 * - Single bits.
+			 *
+			 * Things to note:
+			 * - Individual bits can be 0/1 which is supported by
+			 *   libsigrok, or x or z which is treated like 0 here
+			 *   (sigrok lacks support for ternary logic, neither is
+			 *   there support for the full IEEE set of values).
+			 * - Single-bit values typically won't be separated from
+			 *   the signal identifer, multi-bit values and floats
+			 *   are separated (will reference the next word). This
+			 *   implementation silently accepts separators for
+			 *   single-bit values, too.
+			 */
+			is_real = curr_first == 'r' && curr_len > 1;
+			is_multibit = curr_first == 'b' && curr_len > 1;
+			is_singlebit = curr_first == '0' || curr_first == '1';
+			is_singlebit |= curr_first == 'l' || curr_first == 'h';
+			is_singlebit |= curr_first == 'x' || curr_first == 'z';
+			is_singlebit |= curr_first == 'u' || curr_first == '-';
+			is_string = curr_first == 's';
+			if (is_real) {
+				double real_val;
+
+				if (!have_next) {
+					chunk_add_error(chunk, "%s", "Unexpected real format.");
+					goto done;
+				}
+				ret = sr_parse_double_ascii(&curr_word[1], curr_len - 1,
+					&real_val, &endptr);
+				if (ret != SR_OK || endptr != &curr_word[curr_len]) {
+					text = chunk_word_text(chunk, &curr_word[1], curr_len - 1);
+					chunk_add_error(chunk, "Cannot convert value: %s.", text);
+					goto done;
+				}
+				event = chunk_add_value(chunk, VCD_EVENT_REAL,
+					next_word, next_len);
+				if (event)
+					event->v.real = real_val;
+				have_next = get_word(&pos, line_end, &next_word, &next_len);
 				continue;
 			}
-			if (timestamp == inc->prev_timestamp) {
+			if (is_multibit) {
+				const char *bits_text, *bits_text_start;
+				size_t bit_count, sig_count, offset;
+				uint8_t bit_value;
+				uint8_t *value_ptr, value_mask;
+
+				if (!have_next) {
+					chunk_add_error(chunk, "%s", "Unexpected integer/vector format.");
+					goto done;
+				}
+
 				/*
-				 * Ignore repeated timestamps (e.g. sigrok
-				 * outputs these). Can also happen when
-				 * downsampling makes distinct input values
-				 * end up at the same scaled down value.
-				 * Also transparently covers the initial
-				 * timestamp.
+				 * Accept a bit string of arbitrary length (sort
+				 * of, within the limits of the previously setup
+				 * conversion buffer). The input text omits the
+				 * leading zeroes, hence we convert from end to
+				 * the start, to get the significant bits. There
+				 * should only be errors for invalid input, or
+				 * for input that is rather strange (data holds
+				 * more bits than the signal's declaration in
+				 * the header suggested). Silently accept data
+				 * that fits in the conversion buffer, and has
+				 * more significant bits than the signal's type
+				 * (that'd be non-sence yet acceptable input).
 				 */
-				sr_spew("Timestamp is identical to previous timestamp");
+				bits_text_start = &curr_word[1];
+				bits_text = &curr_word[curr_len];
+				bit_count = bits_text - bits_text_start;
+				if (bit_count > inc->conv_bits.max_bits) {
+					text = chunk_word_text(chunk, bits_text_start, bit_count);
+					chunk_add_error(chunk, "Value exceeds conversion buffer: %s", text);
+					goto done;
+				}
+				offset = chunk->bits->len;
+				g_byte_array_set_size(chunk->bits,
+					offset + inc->conv_bits.unit_size);
+				value_ptr = &chunk->bits->data[offset];
+				value_mask = 1 << 0;
+				sig_count = 0;
+				/* Plain 0/1 strings take a fast path. */
+				ret = sr_parse_bits_ascii(bits_text_start, bit_count,
+					value_ptr, inc->conv_bits.unit_size,
+					&sig_count, &endptr);
+				if (ret == SR_OK && endptr == bits_text) {
+					bits_text = bits_text_start;
+				} else {
+					sig_count = 0;
+					memset(value_ptr, 0, inc->conv_bits.unit_size);
+				}
+				while (bits_text > bits_text_start) {
+					sig_count++;
+					bit_value = vcd_char_to_value(*(--bits_text), NULL);
+					if (bit_value == 0) {
+						/* EMPTY */
+					} else if (bit_value == 1) {
+						*value_ptr |= value_mask;
+					} else {
+						sig_count = 0;
+						break;
+					}
+					value_mask <<= 1;
+					if (!value_mask) {
+						value_ptr++;
+						value_mask = 1 << 0;
+					}
+				}
+				if (!sig_count) {
+					text = chunk_word_text(chunk, bits_text_start, bit_count);
+					chunk_add_error(chunk, "Unexpected vector format: %s", text);
+					goto done;
+				}
+				event = chunk_add_value(chunk, VCD_EVENT_BITS,
+					next_word, next_len);
+				if (event) {
+					event->v.bits.offset = offset;
+					event->v.bits.count = sig_count;
+				} else {
+					g_byte_array_set_size(chunk->bits, offset);
+				}
+				have_next = get_word(&pos, line_end, &next_word, &next_len);
 				continue;
 			}
-			if (timestamp < inc->prev_timestamp) {
-				sr_err("Invalid timestamp: %" PRIu64 " (leap backwards).", timestamp);
-				ret = SR_ERR_DATA;
-				break;
+			if (is_singlebit) {
+				const char *identifier;
+				size_t id_len, offset;
+				uint8_t bit_value;
+
+				/* Get the value text, and signal identifier. */
+				identifier = &curr_word[1];
+				id_len = curr_len - 1;
+				if (!id_len && have_next) {
+					identifier = next_word;
+					id_len = next_len;
+					have_next = get_word(&pos, line_end, &next_word, &next_len);
+				}
+				if (!id_len) {
+					chunk_add_error(chunk, "%s", "Identifier missing.");
+					goto done;
+				}
+
+				/* Convert value text to single-bit number. */
+				bit_value = vcd_char_to_value(curr_word[0], NULL);
+				if (bit_value != 0 && bit_value != 1) {
+					text = chunk_word_text(chunk, curr_word, 1);
+					chunk_add_error(chunk, "Unsupported bit value '%s'.", text);
+					goto done;
+				}
+				event = chunk_add_value(chunk, VCD_EVENT_BITS,
+					identifier, id_len);
+				if (event) {
+					offset = chunk->bits->len;
+					g_byte_array_append(chunk->bits, &bit_value, 1);
+					event->v.bits.offset = offset;
+					event->v.bits.count = 1;
+				}
+				continue;
 			}
-			if (inc->options.compress) {
-				/* Compress long idle periods */
-				count = timestamp - inc->prev_timestamp;
-				if (count > inc->options.compress) {
-					sr_dbg("Long idle period, compressing");
-					count = timestamp - inc->options.compress;
-					inc->prev_timestamp = count;
+			if (is_string) {
+				const struct vcd_signal *signal;
+				gboolean ignored;
+
+				text = chunk_word_text(chunk, &curr_word[1], curr_len - 1);
+				if (!vcd_string_valid(text)) {
+					chunk_add_error(chunk, "Invalid string data: %s", text);
+					goto done;
 				}
+				if (!have_next) {
+					chunk_add_error(chunk, "%s", "String value without identifier.");
+					goto done;
+				}
+				text = chunk_word_text(chunk, next_word, next_len);
+				signal = g_hash_table_lookup(inc->signals, text);
+				ignored = signal && signal->ignored;
+				if (!ignored) {
+					chunk_add_error(chunk, "String value for identifier '%s'.", text);
+					goto done;
+				}
+				chunk_add_data(chunk);
+				have_next = get_word(&pos, line_end, &next_word, &next_len);
+				continue;
 			}
 
-			/* Generate samples from prev_timestamp up to timestamp - 1. */
-			count = timestamp - inc->prev_timestamp;
-			sr_spew("Got a new timestamp, feeding %zu samples", count);
-			add_samples(in, count, FALSE);
-			inc->prev_timestamp = timestamp;
-			inc->data_after_timestamp = FALSE;
+			/* Design choice: Consider unsupported input fatal. */
+			text = chunk_word_text(chunk, curr_word, curr_len);
+			chunk_add_error(chunk, "Unknown token '%s'.", text);
+			goto done;
+		}
+		pos = (line_end < end) ? line_end + 1 : end;
+	}
+
+done:
+	chunk->state_out = state;
+}
+
+/* Apply a chunk's events to the current values and the session feed. */
+static int apply_chunk(const struct sr_input *in, struct vcd_chunk *chunk)
+{
+	struct context *inc;
+	struct vcd_event *event;
+	size_t idx;
+	int ret;
+
+	inc = in->priv;
+
+	for (idx = 0; idx < chunk->events->len; idx++) {
+		event = &g_array_index(chunk->events, struct vcd_event, idx);
+		switch (event->type) {
+		case VCD_EVENT_TIMESTAMP:
+			ret = process_timestamp(in, event->v.timestamp);
+			if (ret != SR_OK)
+				return ret;
 			continue;
+		case VCD_EVENT_BITS:
+			process_bits(inc, event->signal,
+				&chunk->bits->data[event->v.bits.offset],
+				event->v.bits.count);
+			break;
+		case VCD_EVENT_REAL:
+			process_real(inc, event->signal, event->v.real);
+			break;
+		case VCD_EVENT_DATA:
+			break;
+		case VCD_EVENT_UNKNOWN:
+			sr_warn("VCD signal not found for ID '%s'.", event->text);
+			break;
+		case VCD_EVENT_ERROR:
+			sr_err("%s", event->text);
+			return event->v.ret;
 		}
 		inc->data_after_timestamp = TRUE;
+	}
+	inc->section = chunk->state_out;
 
-		/*
-		 * Data values come in different formats, are associated
-		 * with channel identifiers, and correspond to the period
-		 * of time from the most recent timestamp to the next
-		 * timestamp.
-		 *
-		 * Supported input data formats are:
-		 * - S<value> <sep> <id> (value not used, VCD type 'string').
-		 * - R<value> <sep> <id> (analog channel, VCD type 'real').
-		 * - B<value> <sep> <id> (analog channel, VCD type 'integer').
-		 * - B<value> <sep> <id> (logic channels, VCD bit vectors).
-		 * - <value> <id> (logic channel, VCD single-bit values).
-		 *
-		 * Input values can be:
-		 * - Floating point numbers.
-		 * - Bit strings (which covers multi-bit aka integers
-		 *   as well as vectors).
-		 * - Single bits.
-		 *
-		 * Things to note:
-		 * - Individual bits can be 0/1 which is supported by
-		 *   libsigrok, or x or z which is treated like 0 here
-		 *   (sigrok lacks support for ternary logic, neither is
-		 *   there support for the full IEEE set of values).
-		 * - Single-bit values typically won't be separated from
-		 *   the signal identifer, multi-bit values and floats
-		 *   are separated (will reference the next word). This
-		 *   implementation silently accepts separators for
-		 *   single-bit values, too.
-		 */
-		is_real = curr_first == 'r' && curr_word[1];
-		is_multibit = curr_first == 'b' && curr_word[1];
-		is_singlebit = curr_first == '0' || curr_first == '1';
-		is_singlebit |= curr_first == 'l' || curr_first == 'h';
-		is_singlebit |= curr_first == 'x' || curr_first == 'z';
-		is_singlebit |= curr_first == 'u' || curr_first == '-';
-		is_string = curr_first == 's';
-		if (is_real) {
-			char *real_text;
-			float real_val;
-
-			real_text = &curr_word[1];
-			identifier = next_word;
-			word_idx++;
-			if (!*real_text || !identifier || !*identifier) {
-				sr_err("Unexpected real format.");
-				ret = SR_ERR_DATA;
-				break;
-			}
-			sr_spew("Got real data %s for id '%s'.",
-				real_text, identifier);
-			if (sr_atof_ascii(real_text, &real_val) != SR_OK) {
-				sr_err("Cannot convert value: %s.", real_text);
-				ret = SR_ERR_DATA;
-				break;
-			}
-			process_real(inc, identifier, real_val);
-			continue;
+	return SR_OK;
+}
+
+/*
+ * Determine where a chunk of text ends, at least "want" bytes after
+ * its start where possible. Prefer to split before timestamps, where
+ * sections are not expected to span chunk boundaries. Fall back to
+ * any line boundary, section state is tracked across chunks.
+ */
+static size_t chunk_length(const char *text, size_t len, size_t want)
+{
+	const char *p, *end, *limit;
+
+	if (len <= want)
+		return len;
+	end = text + len;
+	limit = text + MIN(len, 2 * want);
+	p = text + want - 1;
+	while ((p = memchr(p, '\n', limit - p)) && p + 1 < limit) {
+		if (p[1] == '#')
+			return p + 1 - text;
+		p++;
+	}
+	p = memchr(text + want - 1, '\n', end - (text + want - 1));
+	if (!p)
+		return len;
+
+	return p + 1 - text;
+}
+
+static void chunk_worker(gpointer data, gpointer user_data)
+{
+	struct vcd_chunk *chunk;
+	struct vcd_workers *work;
+
+	chunk = data;
+	work = user_data;
+
+	parse_chunk(chunk);
+
+	g_mutex_lock(&work->mutex);
+	chunk->done = TRUE;
+	g_cond_broadcast(&work->cond);
+	g_mutex_unlock(&work->mutex);
+}
+
+static void workers_free(struct context *inc)
+{
+	struct vcd_workers *work;
+	struct vcd_chunk *chunk;
+	size_t idx;
+
+	work = &inc->work;
+	if (work->pool) {
+		g_thread_pool_free(work->pool, FALSE, TRUE);
+		work->pool = NULL;
+		g_mutex_clear(&work->mutex);
+		g_cond_clear(&work->cond);
+	}
+	for (idx = 0; idx < work->chunk_count; idx++) {
+		chunk = &work->chunks[idx];
+		chunk_clear_events(chunk);
+		g_array_free(chunk->events, TRUE);
+		g_byte_array_free(chunk->bits, TRUE);
+		g_string_free(chunk->scratch, TRUE);
+	}
+	g_free(work->chunks);
+	work->chunks = NULL;
+	work->chunk_count = 0;
+}
+
+static void workers_setup(struct context *inc)
+{
+	struct vcd_workers *work;
+	struct vcd_chunk *chunk;
+	size_t count, idx;
+
+	work = &inc->work;
+	if (work->chunks)
+		return;
+
+	count = inc->options.threads;
+	if (count > 1) {
+		g_mutex_init(&work->mutex);
+		g_cond_init(&work->cond);
+		work->pool = g_thread_pool_new(chunk_worker, work,
+			count, FALSE, NULL);
+		if (!work->pool) {
+			sr_warn("Cannot create parser threads, parsing inline.");
+			g_mutex_clear(&work->mutex);
+			g_cond_clear(&work->cond);
+			count = 1;
 		}
-		if (is_multibit) {
-			char *bits_text_start;
-			size_t bit_count;
-			char *bits_text, bit_char;
-			uint8_t bit_value;
-			uint8_t *value_ptr, value_mask;
-			GString *bits_val_text;
-
-			/* TODO
-			 * Fold in single-bit code path here? To re-use
-			 * the X/Z support. Current redundancy is few so
-			 * there is little pressure to unify code paths.
-			 * Also multi-bit handling is often different
-			 * from single-bit handling, so the "unified"
-			 * path would often check for special cases. So
-			 * we may never unify code paths at all here.
-			 */
-			bits_text = &curr_word[1];
-			identifier = next_word;
-			word_idx++;
+	} else {
+		count = 1;
+	}
 
-			if (!*bits_text || !identifier || !*identifier) {
-				sr_err("Unexpected integer/vector format.");
-				ret = SR_ERR_DATA;
-				break;
-			}
-			sr_spew("Got integer/vector data %s for id '%s'.",
-				bits_text, identifier);
+	work->chunks = g_malloc0_n(count, sizeof(work->chunks[0]));
+	work->chunk_count = count;
+	for (idx = 0; idx < count; idx++) {
+		chunk = &work->chunks[idx];
+		chunk->inc = inc;
+		chunk->events = g_array_new(FALSE, FALSE, sizeof(struct vcd_event));
+		chunk->bits = g_byte_array_new();
+		chunk->scratch = g_string_sized_new(32);
+	}
+}
 
-			/*
-			 * Accept a bit string of arbitrary length (sort
-			 * of, within the limits of the previously setup
-			 * conversion buffer). The input text omits the
-			 * leading zeroes, hence we convert from end to
-			 * the start, to get the significant bits. There
-			 * should only be errors for invalid input, or
-			 * for input that is rather strange (data holds
-			 * more bits than the signal's declaration in
-			 * the header suggested). Silently accept data
-			 * that fits in the conversion buffer, and has
-			 * more significant bits than the signal's type
-			 * (that'd be non-sence yet acceptable input).
-			 */
-			bits_text_start = bits_text;
-			bits_text += strlen(bits_text);
-			bit_count = bits_text - bits_text_start;
-			if (bit_count > inc->conv_bits.max_bits) {
-				sr_err("Value exceeds conversion buffer: %s",
-					bits_text_start);
-				ret = SR_ERR_DATA;
-				break;
-			}
-			memset(inc->conv_bits.value, 0, inc->conv_bits.unit_size);
-			value_ptr = &inc->conv_bits.value[0];
-			value_mask = 1 << 0;
-			inc->conv_bits.sig_count = 0;
-			while (bits_text > bits_text_start) {
-				inc->conv_bits.sig_count++;
-				bit_char = *(--bits_text);
-				bit_value = vcd_char_to_value(bit_char, NULL);
-				if (bit_value == 0) {
-					/* EMPTY */
-				} else if (bit_value == 1) {
-					*value_ptr |= value_mask;
-				} else {
-					inc->conv_bits.sig_count = 0;
-					break;
-				}
-				value_mask <<= 1;
-				if (!value_mask) {
-					value_ptr++;
-					value_mask = 1 << 0;
-				}
-			}
-			if (!inc->conv_bits.sig_count) {
-				sr_err("Unexpected vector format: %s",
-					bits_text_start);
-				ret = SR_ERR_DATA;
-				break;
-			}
-			if (sr_log_loglevel_get() >= SR_LOG_SPEW) {
-				bits_val_text = sr_hexdump_new(inc->conv_bits.value,
-					value_ptr - inc->conv_bits.value + 1);
-				sr_spew("Vector value: %s.", bits_val_text->str);
-				sr_hexdump_free(bits_val_text);
-			}
+/*
+ * Parse complete text lines of the data section. Without threads,
+ * chunks get parsed and applied one after another. With threads, a
+ * set of chunks gets parsed concurrently, results are applied in input
+ * order. A chunk which was parsed with a wrong assumption about its
+ * section state (starts within a section) gets parsed another time.
+ */
+static int parse_lines(const struct sr_input *in, const char *text, size_t len)
+{
+	struct context *inc;
+	struct vcd_workers *work;
+	struct vcd_chunk *chunk;
+	size_t count, idx, used;
+	gboolean state_ok;
+	int ret;
 
-			process_bits(inc, identifier,
-				inc->conv_bits.value, inc->conv_bits.sig_count);
-			continue;
+	inc = in->priv;
+	work = &inc->work;
+	workers_setup(inc);
+
+	ret = SR_OK;
+	while (len) {
+		/* Have a set of chunks parsed. */
+		for (count = 0; count < work->chunk_count && len; count++) {
+			chunk = &work->chunks[count];
+			used = chunk_length(text, len, VCD_CHUNK_SIZE);
+			chunk->text = text;
+			chunk->len = used;
+			text += used;
+			len -= used;
+			chunk->done = FALSE;
+			if (!work->pool)
+				continue;
+			/* Assume that chunks start outside of sections. */
+			memset(&chunk->state_in, 0, sizeof(chunk->state_in));
+			g_thread_pool_push(work->pool, chunk, NULL);
 		}
-		if (is_singlebit) {
-			char *bits_text, bit_char;
-			uint8_t bit_value;
-
-			/* Get the value text, and signal identifier. */
-			bits_text = &curr_word[0];
-			bit_char = *bits_text;
-			if (!bit_char) {
-				sr_err("Bit value missing.");
-				ret = SR_ERR_DATA;
-				break;
-			}
-			identifier = ++bits_text;
-			if (!*identifier) {
-				identifier = next_word;
-				word_idx++;
+
+		/* Apply results in input order. Wait for all before exit. */
+		for (idx = 0; idx < count; idx++) {
+			chunk = &work->chunks[idx];
+			if (work->pool) {
+				g_mutex_lock(&work->mutex);
+				while (!chunk->done)
+					g_cond_wait(&work->cond, &work->mutex);
+				g_mutex_unlock(&work->mutex);
 			}
-			if (!identifier || !*identifier) {
-				sr_err("Identifier missing.");
-				ret = SR_ERR_DATA;
-				break;
+			if (ret != SR_OK)
+				continue;
+			state_ok = work->pool && chunk->state_in.skip_until_end ==
+				inc->section.skip_until_end &&
+				chunk->state_in.ignore_end_keyword ==
+				inc->section.ignore_end_keyword;
+			if (!state_ok) {
+				chunk->state_in = inc->section;
+				parse_chunk(chunk);
 			}
+			ret = apply_chunk(in, chunk);
+		}
+		if (ret != SR_OK)
+			return ret;
+	}
 
-			/* Convert value text to single-bit number. */
-			bit_value = vcd_char_to_value(bit_char, NULL);
-			if (bit_value != 0 && bit_value != 1) {
-				sr_err("Unsupported bit value '%c'.", bit_char);
-				ret = SR_ERR_DATA;
-				break;
-			}
-			inc->conv_bits.value[0] = bit_value;
-			process_bits(inc, identifier, inc->conv_bits.value, 1);
+	return SR_OK;
+}
+
+/*
+ * Derive the downsample factor from the timestamps in the look-ahead
+ * window: the greatest common divisor of their distances. Which keeps
+ * all of these timestamps at distinct sample numbers, and the number
+ * of samples at a minimum. The window gets parsed again as data.
+ */
+static void detect_downsample(struct sr_input *in, const char *text,
+	size_t len)
+{
+	struct context *inc;
+	struct vcd_chunk *chunk;
+	struct vcd_event *event;
+	uint64_t first, prev, delta, factor, a;
+	gboolean have_prev;
+	size_t idx;
+
+	inc = in->priv;
+	workers_setup(inc);
+	chunk = &inc->work.chunks[0];
+	chunk->text = text;
+	chunk->len = len;
+	chunk->state_in = inc->section;
+	parse_chunk(chunk);
+
+	factor = 0;
+	first = prev = 0;
+	have_prev = FALSE;
+	for (idx = 0; idx < chunk->events->len; idx++) {
+		event = &g_array_index(chunk->events, struct vcd_event, idx);
+		if (event->type != VCD_EVENT_TIMESTAMP)
 			continue;
-		}
-		if (is_string) {
-			const char *str_value;
-
-			str_value = &curr_word[1];
-			identifier = next_word;
-			word_idx++;
-			if (!vcd_string_valid(str_value)) {
-				sr_err("Invalid string data: %s", str_value);
-				ret = SR_ERR_DATA;
-				break;
-			}
-			if (!identifier || !*identifier) {
-				sr_err("String value without identifier.");
-				ret = SR_ERR_DATA;
-				break;
+		if (have_prev && event->v.timestamp > prev) {
+			delta = event->v.timestamp - prev;
+			while (delta) {
+				a = factor % delta;
+				factor = delta;
+				delta = a;
 			}
-			sr_spew("Got string data, id '%s', value \"%s\".",
-				identifier, str_value);
-			if (!is_ignored(inc, identifier)) {
-				sr_err("String value for identifier '%s'.",
-					identifier);
-				ret = SR_ERR_DATA;
-				break;
-			}
-			continue;
 		}
-
-		/* Design choice: Consider unsupported input fatal. */
-		sr_err("Unknown token '%s'.", curr_word);
-		ret = SR_ERR_DATA;
-		break;
+		if (!have_prev)
+			first = event->v.timestamp;
+		prev = event->v.timestamp;
+		have_prev = TRUE;
 	}
-	free_text_split(inc, words);
-
-	return ret;
+	chunk_clear_events(chunk);
+
+	if (!factor)
+		factor = 1;
+	inc->downsample_phase = first % factor;
+	sr_info("Timestamps are multiples of %" PRIu64 " ticks, "
+		"downsampling by that factor.", factor);
+	set_downsample(inc, factor);
+	(void)ts_stats_prep(inc);
 }
 
 static int process_buffer(struct sr_input *in, gboolean is_eof)
@@ -2004,7 +2574,7 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 	uint64_t samplerate;
 	GVariant *gvar;
 	int ret;
-	char *rdptr, *endptr, *trimptr;
+	char *endptr;
 	size_t rdlen;
 
 	inc = in->priv;
@@ -2012,11 +2582,26 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 	if (!inc->got_header)
 		return SR_ERR_DATA;
 
+	/*
+	 * Gather the look-ahead window before the samplerate is sent,
+	 * when the downsample factor is to be derived from it.
+	 */
+	if (!inc->started && !inc->options.downsample) {
+		if (!is_eof && in->buf->len < LOOKAHEAD_SIZE)
+			return SR_OK;
+		endptr = g_strrstr_len(in->buf->str, in->buf->len, "\n");
+		rdlen = in->buf->len;
+		if (endptr)
+			rdlen = endptr + 1 - in->buf->str;
+		detect_downsample(in, in->buf->str, rdlen);
+	}
+
 	/* Send feed header and samplerate (once) before sample data. */
 	if (!inc->started) {
+		check_rle(in);
 		std_session_send_df_header(in->sdi);
 
-		samplerate = inc->samplerate / inc->options.downsample;
+		samplerate = inc->samplerate / inc->downsample;
 		if (samplerate) {
 			gvar = g_variant_new_uint64(samplerate);
 			sr_session_send_meta(in->sdi, SR_CONF_SAMPLERATE, gvar);
@@ -2031,33 +2616,15 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 	 * harmed by another empty line of input data.
 	 */
 	if (is_eof)
-		g_string_append_c(in->buf, '\n');
+		sr_input_buf_append(in, "\n", 1);
 
 	/* Find and process complete text lines in the input data. */
-	ret = SR_OK;
-	rdptr = in->buf->str;
-	while (TRUE) {
-		rdlen = &in->buf->str[in->buf->len] - rdptr;
-		endptr = g_strstr_len(rdptr, rdlen, "\n");
-		if (!endptr)
-			break;
-		trimptr = endptr;
-		*endptr++ = '\0';
-		while (g_ascii_isspace(*rdptr))
-			rdptr++;
-		while (trimptr > rdptr && g_ascii_isspace(trimptr[-1]))
-			*(--trimptr) = '\0';
-		if (!*rdptr) {
-			rdptr = endptr;
-			continue;
-		}
-		ret = parse_textline(in, rdptr);
-		rdptr = endptr;
-		if (ret != SR_OK)
-			break;
-	}
-	rdlen = rdptr - in->buf->str;
-	g_string_erase(in->buf, 0, rdlen);
+	endptr = g_strrstr_len(in->buf->str, in->buf->len, "\n");
+	if (!endptr)
+		return SR_OK;
+	rdlen = endptr + 1 - in->buf->str;
+	ret = parse_lines(in, in->buf->str, rdlen);
+	sr_input_buf_consume(in, rdlen);
 
 	return ret;
 }
@@ -2067,6 +2634,7 @@ static int format_match(GHashTable *metadata, unsigned int *confidence)
 	GString *buf, *tmpbuf;
 	gboolean status;
 	char *name, *contents;
+	size_t used;
 
 	buf = g_hash_table_lookup(metadata,
 		GINT_TO_POINTER(SR_INPUT_META_HEADER));
@@ -2076,8 +2644,8 @@ static int format_match(GHashTable *metadata, unsigned int *confidence)
 	 * If we can parse the first section correctly, then it is
 	 * assumed that the input is in VCD format.
 	 */
-	check_remove_bom(tmpbuf);
-	status = parse_section(tmpbuf, &name, &contents);
+	g_string_erase(tmpbuf, 0, bom_length(tmpbuf));
+	status = parse_section(tmpbuf, &name, &contents, &used);
 	g_string_free(tmpbuf, TRUE);
 	g_free(name);
 	g_free(contents);
@@ -2101,12 +2669,9 @@ static int init(struct sr_input *in, GHashTable *options)
 
 	data = g_hash_table_lookup(options, "downsample");
 	inc->options.downsample = g_variant_get_uint64(data);
-	if (inc->options.downsample < 1)
-		inc->options.downsample = 1;
 
 	data = g_hash_table_lookup(options, "compress");
 	inc->options.compress = g_variant_get_uint64(data);
-	inc->options.compress /= inc->options.downsample;
 
 	data = g_hash_table_lookup(options, "skip");
 	if (data) {
@@ -2116,9 +2681,13 @@ static int init(struct sr_input *in, GHashTable *options)
 			inc->options.skip_specified = FALSE;
 			inc->options.skip_starttime = 0;
 		}
-		inc->options.skip_starttime /= inc->options.downsample;
 	}
 
+	data = g_hash_table_lookup(options, "threads");
+	inc->options.threads = g_variant_get_uint32(data);
+	if (!inc->options.threads)
+		inc->options.threads = g_get_num_processors();
+
 	in->sdi = g_malloc0(sizeof(*in->sdi));
 	in->priv = inc;
 
@@ -2135,15 +2704,33 @@ static int receive(struct sr_input *in, GString *buf)
 	inc = in->priv;
 
 	/* Collect all input chunks, potential deferred processing. */
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf->str, buf->len);
 	if (!inc->got_header && in->buf->len == buf->len)
-		check_remove_bom(in->buf);
+		sr_input_buf_consume(in, bom_length(in->buf));
+
+	/* Skip the header when it is the one which was parsed before. */
+	if (inc->header_kept) {
+		ret = sr_input_header_skip(in);
+		if (ret == SR_ERR_NA)
+			return SR_OK;
+		if (ret == SR_OK) {
+			inc->header_kept = FALSE;
+			inc->got_header = TRUE;
+			ret = setup_data(in);
+			if (ret != SR_OK)
+				return ret;
+			/* sdi is ready, notify frontend. */
+			in->sdi_ready = TRUE;
+			return SR_OK;
+		}
+		header_free(in);
+	}
 
 	/* Must complete reception of the VCD header first. */
 	if (!inc->got_header) {
 		if (!have_header(in->buf))
 			return SR_OK;
-		ret = parse_header(in, in->buf);
+		ret = parse_header(in);
 		if (ret != SR_OK)
 			return ret;
 		/* sdi is ready, notify frontend. */
@@ -2177,8 +2764,11 @@ static int end(struct sr_input *in)
 		add_samples(in, count, TRUE);
 	}
 
-	/* Optionally suggest downsampling after all input data was seen. */
-	if (inc->got_header)
+	/*
+	 * Optionally suggest downsampling after all input data was seen.
+	 * Doesn't apply when only logic data was sent as value changes.
+	 */
+	if (inc->got_header && (!inc->rle.use || inc->analog_count))
 		(void)ts_stats_post(inc, !inc->data_after_timestamp);
 
 	/* Must send DF_END when DF_HEADER was sent before. */
@@ -2188,7 +2778,31 @@ static int end(struct sr_input *in)
 	return ret;
 }
 
-static void cleanup(struct sr_input *in)
+/* Release the resources of the data section's processing. */
+static void data_free(struct context *inc)
+{
+	GSList *l;
+	struct vcd_channel *vcd_ch;
+
+	for (l = inc->channels; l; l = l->next) {
+		vcd_ch = l->data;
+		feed_queue_analog_free(vcd_ch->feed_analog);
+		vcd_ch->feed_analog = NULL;
+	}
+	feed_queue_logic_free(inc->feed_logic);
+	inc->feed_logic = NULL;
+	g_free(inc->rle.offsets);
+	g_free(inc->rle.values);
+	memset(&inc->rle, 0, sizeof(inc->rle));
+	workers_free(inc);
+	g_free(inc->current_logic);
+	inc->current_logic = NULL;
+	g_free(inc->current_floats);
+	inc->current_floats = NULL;
+}
+
+/* Release the results of parsing the header. */
+static void header_free(struct sr_input *in)
 {
 	struct context *inc;
 
@@ -2198,40 +2812,67 @@ static void cleanup(struct sr_input *in)
 
 	g_slist_free_full(inc->channels, free_channel);
 	inc->channels = NULL;
-	feed_queue_logic_free(inc->feed_logic);
-	inc->feed_logic = NULL;
-	g_free(inc->conv_bits.value);
-	inc->conv_bits.value = NULL;
-	g_free(inc->current_logic);
-	inc->current_logic = NULL;
-	g_free(inc->current_floats);
-	inc->current_floats = NULL;
+	if (inc->signals)
+		g_hash_table_destroy(inc->signals);
+	inc->signals = NULL;
 	g_string_free(inc->scope_prefix, TRUE);
-	inc->scope_prefix = NULL;
+	inc->scope_prefix = g_string_new("\0");
 	g_slist_free_full(inc->ignored_signals, g_free);
 	inc->ignored_signals = NULL;
-	free_text_split(inc, NULL);
+	inc->vcdsignals = 0;
+	inc->logic_count = 0;
+	inc->analog_count = 0;
+	inc->samplerate = 0;
+	memset(&inc->conv_bits, 0, sizeof(inc->conv_bits));
+	inc->header_kept = FALSE;
 }
 
+static void cleanup(struct sr_input *in)
+{
+	struct context *inc;
+
+	inc = in->priv;
+
+	data_free(inc);
+	header_free(in);
+	g_string_free(inc->scope_prefix, TRUE);
+	inc->scope_prefix = NULL;
+}
+
+/*
+ * The results of parsing the header are kept, when the header's text
+ * is available. Re-reads which start with the same text skip parsing,
+ * see receive(). Everything else starts over.
+ */
 static int reset(struct sr_input *in)
 {
 	struct context *inc;
-	struct vcd_user_opt save;
-	struct vcd_prev prev;
+	struct context save;
+	gboolean keep;
 
 	inc = in->priv;
 
-	/* Relase previously allocated resources. */
-	cleanup(in);
-	g_string_truncate(in->buf, 0);
+	data_free(inc);
+	keep = (inc->got_header || inc->header_kept) && in->header;
+	if (!keep)
+		header_free(in);
+	sr_input_buf_clear(in);
 
 	/* Restore part of the context, init() won't run again. */
-	save = inc->options;
-	prev = inc->prev;
+	save = *inc;
 	memset(inc, 0, sizeof(*inc));
-	inc->options = save;
-	inc->prev = prev;
-	inc->scope_prefix = g_string_new("\0");
+	inc->options = save.options;
+	inc->prev = save.prev;
+	inc->scope_prefix = save.scope_prefix;
+	inc->ignored_signals = save.ignored_signals;
+	inc->signals = save.signals;
+	inc->channels = save.channels;
+	inc->vcdsignals = save.vcdsignals;
+	inc->logic_count = save.logic_count;
+	inc->analog_count = save.analog_count;
+	inc->samplerate = save.samplerate;
+	inc->conv_bits = save.conv_bits;
+	inc->header_kept = keep;
 
 	return SR_OK;
 }
@@ -2241,6 +2882,7 @@ enum vcd_option_t {
 	OPT_DOWN_SAMPLE,
 	OPT_SKIP_COUNT,
 	OPT_COMPRESS,
+	OPT_THREADS,
 	OPT_MAX,
 };
 
@@ -2252,7 +2894,8 @@ static struct sr_option options[] = {
 	},
 	[OPT_DOWN_SAMPLE] = {
 		"downsample", "Downsampling factor",
-		"Downsample the input file's samplerate, i.e. divide by the specified factor.",
+		"Downsample the input file's samplerate, i.e. divide by the specified factor. "
+		"Value 0 derives the factor from the timestamps at the start of the data.",
 		NULL, NULL,
 	},
 	[OPT_SKIP_COUNT] = {
@@ -2268,6 +2911,11 @@ static struct sr_option options[] = {
 		"Compress idle periods which are longer than the specified number of timescale ticks.",
 		NULL, NULL,
 	},
+	[OPT_THREADS] = {
+		"threads", "Parser threads",
+		"Number of threads which parse the data section, 0 uses all processors.",
+		NULL, NULL,
+	},
 	[OPT_MAX] = ALL_ZERO,
 };
 
@@ -2278,6 +2926,7 @@ static const struct sr_option *get_options(void)
 		options[OPT_DOWN_SAMPLE].def = g_variant_ref_sink(g_variant_new_uint64(1));
 		options[OPT_SKIP_COUNT].def = g_variant_ref_sink(g_variant_new_uint64(~UINT64_C(0)));
 		options[OPT_COMPRESS].def = g_variant_ref_sink(g_variant_new_uint64(0));
+		options[OPT_THREADS].def = g_variant_ref_sink(g_variant_new_uint32(1));
 	}
 
 	return options;
@@ -30,7 +30,7 @@
 
 #define LOG_PREFIX "input/wav"
 
-/* How many bytes at a time to process and send to the session bus. */
+/* How many bytes of float samples at a time to send to the session bus. */
 #define CHUNK_SIZE               (1 * 1024 * 1024 * sizeof(float))
 
 /* Minimum size of header + 1 8-bit mono PCM sample. */
@@ -51,6 +51,7 @@ struct context {
 	int num_channels;
 	int unitsize;
 	gboolean found_data;
+	struct feed_queue_analog *feed;
 	GSList *prev_sr_channels;
 };
 
@@ -70,8 +71,8 @@ static int parse_wav_header(GString *buf, struct context *inc)
 	if (num_channels == 0)
 		return SR_ERR;
 	unitsize = samplesize / num_channels;
-	if (unitsize != 1 && unitsize != 2 && unitsize != 4) {
-		sr_err("Only 8, 16 or 32 bits per sample supported.");
+	if (unitsize < 1 || unitsize > 4) {
+		sr_err("Only 8, 16, 24 or 32 bits per sample supported.");
 		return SR_ERR_DATA;
 	}
 
@@ -184,72 +185,55 @@ static int find_data_chunk(GString *buf, int initial_offset)
 	return offset;
 }
 
-static void send_chunk(const struct sr_input *in, int offset, int num_samples)
+/*
+ * Convert count values. Each format gets its own loop, which compilers
+ * can vectorize.
+ */
+static void convert_samples(const struct context *inc, const uint8_t *s,
+		float *d, size_t count)
 {
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_analog analog;
-	struct sr_analog_encoding encoding;
-	struct sr_analog_meaning meaning;
-	struct sr_analog_spec spec;
-	struct context *inc;
-	float *fdata;
-	int total_samples, samplenum;
-	char *s, *d;
+	size_t i;
 
-	inc = in->priv;
-
-	total_samples = num_samples * inc->num_channels;
-	fdata = g_malloc0(total_samples * sizeof(float));
-	s = in->buf->str + offset;
-	d = (char *)fdata;
-
-	for (samplenum = 0; samplenum < total_samples; samplenum++) {
-		if (inc->fmt_code == WAVE_FORMAT_PCM_) {
-			switch (inc->unitsize) {
-			case 1:
-				/* 8-bit PCM samples are unsigned. */
-				fdata[samplenum] = *(uint8_t*)(s) / (float)255;
-				break;
-			case 2:
-				fdata[samplenum] = RL16S(s) / (float)INT16_MAX;
-				break;
-			case 4:
-				fdata[samplenum] = RL32S(s) / (float)INT32_MAX;
-				break;
-			}
-		} else {
-			/* BINARY32 float */
+	if (inc->fmt_code == WAVE_FORMAT_IEEE_FLOAT_) {
+		/* BINARY32 float */
 #ifdef WORDS_BIGENDIAN
-			int i;
-			for (i = 0; i < inc->unitsize; i++)
-				d[i] = s[inc->unitsize - 1 - i];
+		for (i = 0; i < count; i++)
+			d[i] = RLFL(s + 4 * i);
 #else
-			memcpy(d, s, inc->unitsize);
+		memcpy(d, s, count * sizeof(float));
 #endif
-		}
-		s += inc->unitsize;
-		d += inc->unitsize;
+		return;
 	}
 
-	/* TODO: Use proper 'digits' value for this device (and its modes). */
-	sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
-	packet.type = SR_DF_ANALOG;
-	packet.payload = &analog;
-	analog.num_samples = num_samples;
-	analog.data = fdata;
-	analog.meaning->channels = in->sdi->channels;
-	analog.meaning->mq = 0;
-	analog.meaning->mqflags = 0;
-	analog.meaning->unit = 0;
-	sr_session_send(in->sdi, &packet);
-	g_free(fdata);
+	switch (inc->unitsize) {
+	case 1:
+		/* 8-bit PCM samples are unsigned. */
+		for (i = 0; i < count; i++)
+			d[i] = s[i] * (1.0f / 255);
+		break;
+	case 2:
+		for (i = 0; i < count; i++)
+			d[i] = RL16S(s + 2 * i) * (1.0f / INT16_MAX);
+		break;
+	case 3:
+		/* Sign extend by placing the sample in the upper bytes. */
+		for (i = 0; i < count; i++)
+			d[i] = ((int32_t)(read_u24le(s + 3 * i) << 8) >> 8) * (1.0f / 0x7fffff);
+		break;
+	case 4:
+		for (i = 0; i < count; i++)
+			d[i] = RL32S(s + 4 * i) * (1.0f / INT32_MAX);
+		break;
+	}
 }
 
 static int process_buffer(struct sr_input *in)
 {
 	struct context *inc;
-	int offset, chunk_samples, total_samples, processed, max_chunk_samples;
-	int num_samples, i;
+	const uint8_t *s;
+	float *d;
+	size_t num_samples, space, count;
+	int offset, i, ret;
 
 	inc = in->priv;
 	if (!inc->started) {
@@ -268,25 +252,36 @@ static int process_buffer(struct sr_input *in)
 				sr_err("Couldn't find data chunk.");
 				return SR_ERR;
 			}
+			/* Not enough data yet. */
+			return SR_OK;
 		}
 		inc->found_data = TRUE;
 	} else
 		offset = 0;
 
-	/* Round off up to the last channels * unitsize boundary. */
-	chunk_samples = (in->buf->len - offset) / inc->samplesize;
-	max_chunk_samples = CHUNK_SIZE / inc->samplesize;
-	processed = 0;
-	total_samples = chunk_samples;
-	while (processed < total_samples) {
-		if (chunk_samples > max_chunk_samples)
-			num_samples = max_chunk_samples;
-		else
-			num_samples = chunk_samples;
-		send_chunk(in, offset, num_samples);
-		offset += num_samples * inc->samplesize;
-		chunk_samples -= num_samples;
-		processed += num_samples;
+	if (!inc->feed) {
+		/* TODO: Use proper 'digits' value for this device (and its modes). */
+		inc->feed = feed_queue_analog_alloc_channels(in->sdi,
+			CHUNK_SIZE / sizeof(float) / inc->num_channels, 2,
+			in->sdi->channels);
+		if (!inc->feed) {
+			sr_err("Cannot allocate buffers.");
+			return SR_ERR_MALLOC;
+		}
+	}
+
+	/* Convert whole samples of all channels, straight into the queue. */
+	s = (const uint8_t *)in->buf->str + offset;
+	num_samples = (in->buf->len - offset) / inc->samplesize;
+	while (num_samples) {
+		d = feed_queue_analog_get_buffer(inc->feed, &space);
+		count = MIN(num_samples, space);
+		convert_samples(inc, s, d, count * inc->num_channels);
+		if ((ret = feed_queue_analog_commit(inc->feed, count)) != SR_OK)
+			return ret;
+		s += count * inc->samplesize;
+		offset += count * inc->samplesize;
+		num_samples -= count;
 	}
 
 	if ((unsigned int)offset < in->buf->len) {
@@ -294,9 +289,9 @@ static int process_buffer(struct sr_input *in)
 		 * The incoming buffer wasn't processed completely. Stash
 		 * the leftover data for next time.
 		 */
-		g_string_erase(in->buf, 0, offset);
+		sr_input_buf_consume(in, offset);
 	} else
-		g_string_truncate(in->buf, 0);
+		sr_input_buf_clear(in);
 
 	return SR_OK;
 }
@@ -345,7 +340,7 @@ static int receive(struct sr_input *in, GString *buf)
 	int ret;
 	char channelname[16];
 
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf->str, buf->len);
 
 	if (in->buf->len < MIN_DATA_CHUNK_OFFSET) {
 		/*
@@ -391,6 +386,8 @@ static int end(struct sr_input *in)
 		ret = SR_OK;
 
 	inc = in->priv;
+	if (ret == SR_OK && inc->feed)
+		ret = feed_queue_analog_flush(inc->feed);
 	if (inc->started)
 		std_session_send_df_end(in->sdi);
 
@@ -402,6 +399,7 @@ static int reset(struct sr_input *in)
 	struct context *inc;
 
 	inc = in->priv;
+	feed_queue_analog_free(inc->feed);
 	memset(inc, 0, sizeof(*inc));
 
 	/*
@@ -412,11 +410,22 @@ static int reset(struct sr_input *in)
 	 */
 	keep_header_for_reread(in);
 
-	g_string_truncate(in->buf, 0);
+	sr_input_buf_clear(in);
 
 	return SR_OK;
 }
 
+static void cleanup(struct sr_input *in)
+{
+	struct context *inc;
+
+	inc = in->priv;
+	feed_queue_analog_free(inc->feed);
+	inc->feed = NULL;
+	g_slist_free_full(inc->prev_sr_channels, sr_channel_free_cb);
+	inc->prev_sr_channels = NULL;
+}
+
 SR_PRIV struct sr_input_module input_wav = {
 	.id = "wav",
 	.name = "WAV",
@@ -427,5 +436,6 @@ SR_PRIV struct sr_input_module input_wav = {
 	.init = init,
 	.receive = receive,
 	.end = end,
+	.cleanup = cleanup,
 	.reset = reset,
 };
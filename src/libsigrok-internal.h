@@ -538,6 +538,7 @@ static inline void write_u64be(uint8_t *p, uint64_t x)
 	p[1] = x & 0xff; x >>= 8;
 	p[0] = x & 0xff; x >>= 8;
 }
+#define WB64(p, x) write_u64be((uint8_t *)(p), (uint64_t)(x))
 
 /**
  * Write a 64 bits unsigned integer to memory stored as little endian.
@@ -581,7 +582,7 @@ static inline void write_fltle(uint8_t *p, float x)
 	u.f = x;
 	write_u32le(p, u.u);
 }
-#define WLFL(p, x) write_fltle((uint8_t *)(p), float (x))
+#define WLFL(p, x) write_fltle((uint8_t *)(p), (float)(x))
 
 /**
  * Write a 64 bits float to memory stored as little endian.
@@ -594,7 +595,7 @@ static inline void write_dblle(uint8_t *p, double x)
 	u.f = x;
 	write_u64le(p, u.u);
 }
-#define WLDB(p, x) write_dblle((uint8_t *)(p), float (x))
+#define WLDB(p, x) write_dblle((uint8_t *)(p), (double)(x))
 
 /* Endianess conversion helpers with read/write position increment. */
 
@@ -1141,6 +1142,9 @@ SR_API void sr_drivers_init(struct sr_context *context);
 
 struct sr_context {
 	struct sr_dev_driver **driver_list;
+	/* Lazy setup of the driver list and of libusb/HIDAPI. */
+	gsize driver_list_state;
+	gsize hw_state;
 #ifdef HAVE_LIBUSB_1_0
 	libusb_context *libusb_ctx;
 #endif
@@ -1148,6 +1152,21 @@ struct sr_context {
 	sr_resource_close_callback resource_close_cb;
 	sr_resource_read_callback resource_read_cb;
 	void *resource_cb_data;
+	/*
+	 * Firmware images and their preprocessed forms, see resource.c.
+	 * Checksums of FPGA bitstreams which USB devices run, see usb.c.
+	 * Both get guarded by the resource mutex.
+	 */
+	GMutex resource_mutex;
+	GHashTable *resource_cache;
+	GHashTable *fpga_bitstreams;
+	/* Probes of sr_driver_scan_all(), and their negative results. */
+	GMutex scan_mutex;
+	GCond scan_cond;
+	int scan_threads;
+	GHashTable *scan_negative;
+	/* Drivers with scans which were given up on, and their count. */
+	GHashTable *scan_late;
 };
 
 /** Input module metadata keys. */
@@ -1169,9 +1188,23 @@ struct sr_input {
 	 * A pointer to this input module's 'struct sr_input_module'.
 	 */
 	const struct sr_input_module *module;
+	/*
+	 * The data which was received but not processed yet. This is a
+	 * view of buf_store from the read position on, so that consuming
+	 * data never moves the rest. Modules only read it directly, and
+	 * modify it with the sr_input_buf_*() helpers.
+	 */
 	GString *buf;
+	GString buf_view;
+	GString *buf_store;
+	size_t buf_pos;
 	struct sr_dev_inst *sdi;
 	gboolean sdi_ready;
+	/* File mapped by sr_input_map_file(), and how far it was sent. */
+	GMappedFile *mapped;
+	size_t mapped_pos;
+	/* Header text which survives resets, see sr_input_header_keep(). */
+	GString *header;
 	void *priv;
 };
 
@@ -1269,11 +1302,34 @@ struct sr_input_module {
 	 * the chance to examine the device instance, attach session callbacks
 	 * and so on.
 	 *
+	 * The buffer must not be modified, it can be a view of the caller's
+	 * data (see sr_input_send_data()) which is not NUL terminated.
+	 *
 	 * @retval SR_OK Success
 	 * @retval other Negative error code.
 	 */
 	int (*receive) (struct sr_input *in, GString *buf);
 
+	/**
+	 * Send a view into a mapped input file to the specified input
+	 * instance.
+	 *
+	 * This is called by sr_input_send_mapped() once the device instance
+	 * is ready, instead of receive(). The data stays valid until the
+	 * instance is freed, so packets can point straight into it. Their
+	 * consumers may modify the data in place, the mapping is private.
+	 * sr_input_send_data() calls it with the caller's data, which only
+	 * stays valid until the call returns.
+	 * Data which cannot be processed yet is appended to in->buf, and
+	 * data left in in->buf by receive() must be processed first.
+	 *
+	 * This function is optional.
+	 *
+	 * @retval SR_OK Success
+	 * @retval other Negative error code.
+	 */
+	int (*receive_mapped) (struct sr_input *in, uint8_t *data, size_t len);
+
 	/**
 	 * Signal the input module no more data will come.
 	 *
@@ -1287,7 +1343,8 @@ struct sr_input_module {
 	 *
 	 * Causes the input module to reset its internal state so that we can
 	 * re-send the input data from the beginning without having to
-	 * re-create the entire input module.
+	 * re-create the entire input module. The module may keep the state
+	 * of its header parser, see sr_input_header_keep().
 	 *
 	 * @retval SR_OK Success.
 	 * @retval other Negative error code.
@@ -1331,6 +1388,19 @@ struct sr_output {
 	 * there, and only flush it when it reaches a certain size.
 	 */
 	void *priv;
+
+	/** Re-used buffer for expanding SR_DF_LOGIC_RLE packets. */
+	uint8_t *rle_buffer;
+	/** Size of the RLE buffer in bytes. */
+	uint64_t rle_size;
+
+	/** Re-used buffer sink for modules which only write to sinks. */
+	struct sr_output_sink *sink;
+
+	/** Compressor of the output, NULL if not compressed. */
+	struct sr_output_compress *compress;
+	/** Re-used buffer sink for the output before compression. */
+	struct sr_output_sink *compress_sink;
 };
 
 /** Output module driver. */
@@ -1413,6 +1483,23 @@ struct sr_output_module {
 	int (*receive) (const struct sr_output *o,
 			const struct sr_datafeed_packet *packet, GString **out);
 
+	/**
+	 * Optional alternative to receive(), which writes the output to
+	 * a sink with sr_output_sink_write() and sr_output_sink_write_ref()
+	 * instead of allocating a GString per packet. Either one of the
+	 * two must be provided, the core adapts calls to the other.
+	 *
+	 * @param o Pointer to the respective 'struct sr_output'.
+	 * @param packet The complete packet.
+	 * @param sink The sink to write the output to.
+	 *
+	 * @retval SR_OK Success
+	 * @retval other Negative error code.
+	 */
+	int (*receive_sink) (const struct sr_output *o,
+			const struct sr_datafeed_packet *packet,
+			struct sr_output_sink *sink);
+
 	/**
 	 * This function is called after the caller is finished using
 	 * the output module, and can be used to free any internal
@@ -1424,6 +1511,18 @@ struct sr_output_module {
 	int (*cleanup) (struct sr_output *o);
 };
 
+/** Output buffers of a transform chain, used in turns. */
+struct sr_transform_buffers {
+	struct {
+		void *data;
+		size_t size;
+	} bufs[2];
+	/** The buffer which holds the current packet's data, or -1. */
+	int current;
+};
+
+struct session_stage;
+
 /** Transform module instance. */
 struct sr_transform {
 	/** A pointer to this transform's module. */
@@ -1440,6 +1539,25 @@ struct sr_transform {
 	 * state between calls into its callback functions.
 	 */
 	void *priv;
+
+	/** The output buffers this transform uses. */
+	struct sr_transform_buffers *buffers;
+
+	/** Whether the transform runs in a pipeline stage of its own. */
+	gboolean threaded;
+
+	/** The stage this transform starts in a running session, or NULL. */
+	struct session_stage *stage;
+
+	/** Copies of the packets which sr_transform_emit() queued. */
+	GQueue emitted;
+
+	/**
+	 * The device which the following transforms and the datafeed
+	 * callbacks get, or NULL for the transform's device. Set by modules
+	 * which change the channel layout of the packets they return.
+	 */
+	const struct sr_dev_inst *sdi_out;
 };
 
 struct sr_transform_module {
@@ -1487,6 +1605,12 @@ struct sr_transform_module {
 	 * It can either return (in packet_out) a pointer to another packet
 	 * (possibly the exact same packet it got as input), or NULL.
 	 *
+	 * Transforms which keep the size of the data modify packet_in's
+	 * data in place. Others write their output data to the buffer from
+	 * sr_transform_buffer_get(), which stays valid until the packet has
+	 * passed the rest of the chain.
+	 * The packet structures themselves belong to the module.
+	 *
 	 * @param t Pointer to the respective 'struct sr_transform'.
 	 * @param packet_in Pointer to a datafeed packet.
 	 * @param packet_out Pointer to the resulting datafeed packet after
@@ -1526,6 +1650,7 @@ struct sr_usb_dev_inst {
 struct sr_serial_dev_inst;
 #ifdef HAVE_SERIAL_COMM
 struct ser_lib_functions;
+struct ser_replay;
 struct ser_hid_chip_functions;
 struct sr_bt_desc;
 typedef void (*serial_rx_chunk_callback)(struct sr_serial_dev_inst *serial,
@@ -1542,9 +1667,19 @@ struct sr_serial_dev_inst {
 		int parity_bits;
 		int stop_bits;
 	} comm_params;
-	GString *rcv_buffer;
+	/** Receive queue, see sr_ser_queue_rx_data(). */
+	struct sr_ser_rx_queue {
+		uint8_t *data;
+		size_t size;
+		size_t head;
+		size_t len;
+	} rcv_queue;
 	serial_rx_chunk_callback rx_chunk_cb_func;
 	void *rx_chunk_cb_data;
+	/** Data which was put back after recording, see sr_traffic_record(). */
+	size_t rec_skip;
+	/** State of the replay transport, see serial_replay.c. */
+	struct ser_replay *replay;
 #ifdef HAVE_LIBSERIALPORT
 	/** libserialport port handle */
 	struct sp_port *sp_data;
@@ -1599,6 +1734,82 @@ struct drv_context {
 	GSList *instances;
 };
 
+/*--- backend.c -------------------------------------------------------------*/
+
+SR_PRIV int sr_context_hw_init(struct sr_context *ctx);
+SR_PRIV int sr_lzo_init(void);
+
+/*--- lzo.c -----------------------------------------------------------------*/
+
+struct sr_lzo;
+
+SR_PRIV struct sr_lzo *sr_lzo_new(void);
+SR_PRIV void sr_lzo_free(struct sr_lzo *lzo);
+SR_PRIV int sr_lzo_compress(struct sr_lzo *lzo, const void *data,
+		size_t length, GByteArray *out);
+SR_PRIV int sr_lzo_decompress(const void *data, size_t size, void *out,
+		size_t length);
+
+/*--- remote.c --------------------------------------------------------------*/
+
+#define SR_REMOTE_PROTOCOL_VERSION 1
+#define SR_REMOTE_HEADER_SIZE 8
+#define SR_REMOTE_MAX_PAYLOAD (256 * 1024 * 1024)
+/* The bulk data of the frame is LZO compressed. */
+#define SR_REMOTE_FLAG_LZO (1 << 0)
+
+enum sr_remote_frame_type {
+	SR_REMOTE_FRAME_HELLO = 1,
+	SR_REMOTE_FRAME_PACKET,
+	SR_REMOTE_FRAME_PING,
+	SR_REMOTE_FRAME_PONG,
+};
+
+/* A received datafeed packet, and the storage of its payload. */
+struct sr_remote_packet {
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_header header;
+	struct sr_datafeed_meta meta;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct sr_rational *channel_rationals;
+	uint8_t *data;
+};
+
+SR_PRIV int sr_remote_connect(const char *address, const char *port);
+SR_PRIV void sr_remote_frame_init(GByteArray *frame);
+SR_PRIV int sr_remote_frame_send(int fd, GByteArray *frame, uint16_t type,
+		uint16_t flags);
+SR_PRIV int sr_remote_recv(int fd, GByteArray *buf, int timeout_ms);
+SR_PRIV int sr_remote_frame_parse(const GByteArray *buf, uint16_t *type,
+		uint16_t *flags, size_t *size);
+SR_PRIV void sr_remote_hello_encode(const struct sr_dev_inst *sdi,
+		GByteArray *frame);
+SR_PRIV int sr_remote_hello_decode(struct sr_dev_inst *sdi,
+		const uint8_t *data, size_t size);
+SR_PRIV int sr_remote_packet_encode(const struct sr_datafeed_packet *packet,
+		struct sr_lzo *lzo, GByteArray *frame, uint16_t *flags);
+SR_PRIV int sr_remote_packet_decode(const struct sr_dev_inst *sdi,
+		const uint8_t *data, size_t size, uint16_t flags,
+		struct sr_remote_packet *rp);
+SR_PRIV void sr_remote_packet_clear(struct sr_remote_packet *rp);
+
+/*--- shm_ring.c ------------------------------------------------------------*/
+
+struct sr_shm_reader;
+
+SR_PRIV int sr_shm_reader_open(struct sr_shm_reader **reader,
+		const char *path);
+SR_PRIV int sr_shm_reader_hello(struct sr_shm_reader *reader,
+		struct sr_dev_inst *sdi);
+SR_PRIV uint64_t sr_shm_reader_samplerate(struct sr_shm_reader *reader);
+SR_PRIV int sr_shm_reader_next(struct sr_shm_reader *reader,
+		GByteArray *frame, uint64_t *lost);
+SR_PRIV void sr_shm_reader_close(struct sr_shm_reader *reader);
+
 /*--- log.c -----------------------------------------------------------------*/
 
 #if defined(_WIN32) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 4))
@@ -1619,6 +1830,11 @@ SR_PRIV int sr_log(int loglevel, const char *format, ...) G_GNUC_PRINTF(2, 3);
 #define sr_warn(...)	sr_log(SR_LOG_WARN, LOG_PREFIX ": " __VA_ARGS__)
 #define sr_err(...)	sr_log(SR_LOG_ERR,  LOG_PREFIX ": " __VA_ARGS__)
 
+SR_PRIV gboolean sr_log_check(int loglevel, const char *module);
+
+/* Whether messages of the loglevel get shown for the current file. */
+#define sr_log_enabled(loglevel)	sr_log_check(loglevel, LOG_PREFIX)
+
 /*--- device.c --------------------------------------------------------------*/
 
 /** Scan options supported by a driver. */
@@ -1644,6 +1860,13 @@ SR_PRIV struct sr_channel *sr_next_enabled_channel(const struct sr_dev_inst *sdi
 		struct sr_channel *cur_channel);
 SR_PRIV gboolean sr_channels_differ(struct sr_channel *ch1, struct sr_channel *ch2);
 SR_PRIV gboolean sr_channel_lists_differ(GSList *l1, GSList *l2);
+SR_PRIV void sr_dev_channels_changed(const struct sr_dev_inst *sdi);
+SR_PRIV struct sr_channel *sr_dev_channel_nth(const struct sr_dev_inst *sdi,
+		unsigned int pos);
+SR_PRIV unsigned int sr_dev_channel_count(const struct sr_dev_inst *sdi,
+		int type, gboolean enabled_only);
+SR_PRIV const uint64_t *sr_dev_enabled_channels(const struct sr_dev_inst *sdi,
+		int type, size_t *num_words);
 
 SR_PRIV struct sr_channel_group *sr_channel_group_new(struct sr_dev_inst *sdi,
 	const char *name, void *priv);
@@ -1678,6 +1901,14 @@ struct sr_dev_inst {
 	void *priv;
 	/** Session to which this device is currently assigned. */
 	struct sr_session *session;
+	/** Cached config lists and values, see sr_config_cache_enable(). */
+	GHashTable *config_cache;
+	/** Whether sr_config_get() results are cached as well. */
+	gboolean config_cache_get;
+	/** Whether the settings were committed since they last changed. */
+	gboolean config_committed;
+	/** Channel lookup index, see sr_dev_channel_nth(). */
+	struct sr_channel_index *channel_index;
 };
 
 /* Generic device instances */
@@ -1731,13 +1962,68 @@ SR_PRIV void sr_usbtmc_dev_inst_free(struct sr_usbtmc_dev_inst *usbtmc);
 SR_PRIV const GVariantType *sr_variant_type_get(int datatype);
 SR_PRIV int sr_variant_type_check(uint32_t key, GVariant *data);
 SR_PRIV void sr_hw_cleanup_all(const struct sr_context *ctx);
+SR_PRIV void sr_driver_scan_wait(const struct sr_dev_driver *driver);
+SR_PRIV void sr_driver_scan_cleanup(struct sr_context *ctx);
 SR_PRIV struct sr_config *sr_config_new(uint32_t key, GVariant *data);
 SR_PRIV void sr_config_free(struct sr_config *src);
+SR_PRIV void sr_config_cache_invalidate(const struct sr_dev_inst *sdi);
 SR_PRIV int sr_dev_acquisition_start(struct sr_dev_inst *sdi);
 SR_PRIV int sr_dev_acquisition_stop(struct sr_dev_inst *sdi);
 
+/*--- buffer.c --------------------------------------------------------------*/
+
+/**
+ * Reference counted sample data buffer, from a struct sr_buffer_pool.
+ * The data is aligned to SR_DATAFEED_ALIGN, and padded.
+ */
+struct sr_buffer {
+	gint refcount;
+	struct sr_buffer_pool *pool;
+	uint8_t *data;
+	size_t size;
+	/* The subsystem which it is accounted to, see mem_stats.c. */
+	int tag;
+};
+
+struct sr_buffer_pool;
+
+SR_PRIV void *sr_aligned_alloc(size_t size);
+SR_PRIV void sr_aligned_free(void *data);
+SR_PRIV struct sr_buffer_pool *sr_buffer_pool_new(size_t size, size_t max_idle);
+SR_PRIV void sr_buffer_pool_free(struct sr_buffer_pool *pool);
+SR_PRIV struct sr_buffer *sr_buffer_pool_get(struct sr_buffer_pool *pool);
+SR_PRIV struct sr_buffer *sr_buffer_new(size_t size);
+SR_PRIV struct sr_buffer *sr_buffer_ref(struct sr_buffer *buf);
+SR_PRIV void sr_buffer_unref(struct sr_buffer *buf);
+SR_PRIV gboolean sr_buffer_is_shared(struct sr_buffer *buf);
+SR_PRIV struct sr_buffer *sr_buffer_lend(struct sr_buffer *buf);
+SR_PRIV struct sr_buffer *sr_buffer_lent_ref(const void *data, size_t size);
+
 /*--- session.c -------------------------------------------------------------*/
 
+#define SR_PACKET_METER_TYPES (SR_DF_LOGIC_RLE - SR_DF_HEADER + 1)
+
+struct sr_packet_meter_time {
+	uint64_t count;
+	int64_t min_us;
+	int64_t max_us;
+	int64_t total_us;
+};
+
+/** What a measuring sink received, see sr_packet_meter_add(). */
+struct sr_packet_meter {
+	/* When the first and the previous packet arrived. */
+	int64_t start_us;
+	int64_t last_us;
+	/* Counters by packet type, indexed by type - SR_DF_HEADER. */
+	uint64_t packets[SR_PACKET_METER_TYPES];
+	uint64_t samples[SR_PACKET_METER_TYPES];
+	uint64_t bytes[SR_PACKET_METER_TYPES];
+	/* The times between packets, and since they were sent. */
+	struct sr_packet_meter_time gap;
+	struct sr_packet_meter_time latency;
+};
+
 struct sr_session {
 	/** Context this session exists in. */
 	struct sr_context *ctx;
@@ -1759,17 +2045,88 @@ struct sr_session {
 	GMutex main_mutex;
 	/** Context of the session main loop. */
 	GMainContext *main_context;
+	/** How the main loop polls descriptors, see sr_session_poll_backend_set(). */
+	enum sr_session_poll_backend poll_backend;
+	/** Poll function of the main context before the session replaced it. */
+	GPollFunc prev_poll_func;
+	/** Keep the main context between runs, see sr_session_rearm_set(). */
+	gboolean rearm;
+	/** The trigger which the last start of a re-armed session verified. */
+	struct sr_trigger *verified_trigger;
 
 	/** Registered event sources for this session. */
 	GHashTable *event_sources;
 	/** Session main loop. */
 	GMainLoop *main_loop;
+	/** Priority from the last sr_session_poll_prepare(), for dispatch. */
+	int poll_priority;
 	/** ID of idle source for dispatching the session stop notification. */
 	unsigned int stop_check_id;
 	/** Whether the session has been started. */
 	gboolean running;
+	/** Whether packets get queued to a consumer thread. */
+	gboolean threaded;
+	/** Requested queue capacity of the threaded mode, in packets. */
+	uint32_t queue_depth;
+	/** Drop data packets instead of waiting when the queue is full. */
+	gboolean drop_on_overflow;
+	/** Packet queue of a running threaded session, or NULL. */
+	struct session_ring *ring;
+	/** Queue statistics of the current or most recent run. */
+	struct sr_session_queue_stats queue_stats;
+	/** Mutex protecting the statistics and the ring pointer. */
+	GMutex stats_mutex;
+	/** Throughput statistics of the current or most recent run. */
+	struct sr_session_stats stats;
+	/** Sample counters per analog channel, and per device for logic. */
+	GHashTable *channel_stats;
+	/** Sample positions per device, see sr_session_packet_position(). */
+	GHashTable *positions;
+	/** The packet which the datafeed callbacks get, and its position. */
+	const struct sr_datafeed_packet *position_packet;
+	struct sr_datafeed_position position;
+	/** Start time of the run, and time of its last processed packet. */
+	int64_t stats_start_us;
+	int64_t stats_last_us;
+	/** Re-used buffer for coalescing batched logic packets. */
+	uint8_t *batch_buffer;
+	/** Size of the batch buffer in bytes. */
+	uint64_t batch_size;
+	/** Whether datafeed callbacks accept SR_DF_LOGIC_RLE packets. */
+	gboolean logic_rle;
+	/** Re-used buffer for expanding SR_DF_LOGIC_RLE packets. */
+	uint8_t *rle_buffer;
+	/** Size of the RLE buffer in bytes. */
+	uint64_t rle_size;
+	/** Output buffers of the transform chain. */
+	struct sr_transform_buffers transform_buffers;
+	/** Pipeline stages of a running session, see sr_transform_threaded_set(). */
+	GSList *stages;
+	/** Scratch memory for packets being sent, see sr_session_scratch_get(). */
+	uint8_t *scratch;
+	size_t scratch_size;
+	size_t scratch_used;
+	/** Allocations which did not fit into the scratch memory. */
+	GSList *scratch_spill;
+	size_t scratch_spilled;
+	/** Nesting depth of sr_session_send() calls. */
+	int send_depth;
+	/** Last scalar meta value of each key, see sr_session_send_meta_u64(). */
+	GHashTable *meta_values;
+	GMutex meta_mutex;
+	/** Combining of data packets, see sr_session_coalesce_set(), or NULL. */
+	struct session_coalesce *coalesce;
+	/** Scheduling of the acquisition thread, see sr_session_sched_set(). */
+	struct sr_session_sched sched;
+	/** The part of it which took effect in the current or last run. */
+	struct sr_session_sched sched_applied;
+	/** Settings of the thread from before the run, to restore. */
+	struct session_sched_saved *sched_saved;
 };
 
+SR_PRIV void sr_session_sched_apply(struct sr_session *session);
+SR_PRIV void sr_session_sched_restore(struct sr_session *session);
+
 SR_PRIV int sr_session_source_add_internal(struct sr_session *session,
 		void *key, GSource *source);
 SR_PRIV int sr_session_source_remove_internal(struct sr_session *session,
@@ -1796,12 +2153,64 @@ SR_PRIV int sr_session_source_remove_channel(struct sr_session *session,
 
 SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
 		uint32_t key, GVariant *var);
+SR_PRIV int sr_session_send_meta_u64(const struct sr_dev_inst *sdi,
+		uint32_t key, uint64_t value);
+SR_PRIV int sr_session_send_meta_bool(const struct sr_dev_inst *sdi,
+		uint32_t key, gboolean value);
+SR_PRIV int sr_session_send_meta_double(const struct sr_dev_inst *sdi,
+		uint32_t key, double value);
 SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		const struct sr_datafeed_packet *packet);
+SR_PRIV gboolean sr_session_logic_rle_accepted(const struct sr_session *session);
+SR_PRIV void sr_session_output_time_add(int64_t time_us);
+SR_PRIV int64_t sr_session_dispatch_latency(void);
+SR_PRIV void sr_packet_meter_reset(struct sr_packet_meter *meter);
+SR_PRIV void sr_packet_meter_add(struct sr_packet_meter *meter,
+		const struct sr_datafeed_packet *packet);
+SR_PRIV GString *sr_packet_meter_summary(const struct sr_packet_meter *meter);
+SR_PRIV void *sr_transform_buffer_get(const struct sr_transform *t,
+		size_t size);
+SR_PRIV void *sr_transform_data_writable(const struct sr_transform *t,
+		void *data, size_t size);
+SR_PRIV int sr_transform_emit(const struct sr_transform *t,
+		const struct sr_datafeed_packet *packet);
+SR_PRIV size_t sr_packet_shared_size(const struct sr_datafeed_packet *packet);
+SR_PRIV int sr_session_send_buffer(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, struct sr_buffer *buf);
+SR_PRIV int sr_session_send_batch(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packets, size_t count);
+SR_PRIV void *sr_session_scratch_get(const struct sr_dev_inst *sdi,
+		size_t size);
 SR_PRIV int sr_sessionfile_check(const char *filename);
 SR_PRIV struct sr_dev_inst *sr_session_prepare_sdi(const char *filename,
 		struct sr_session **session);
 
+/*--- session_poll.c --------------------------------------------------------*/
+
+SR_PRIV void sr_session_poll_sources_changed(void);
+SR_PRIV GPollFunc sr_session_poll_func(enum sr_session_poll_backend backend);
+
+/*--- session_driver.c ------------------------------------------------------*/
+
+SR_PRIV int sr_session_driver_index_build(const struct sr_dev_inst *sdi,
+		struct zip *archive);
+SR_PRIV int sr_session_driver_samples(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch, uint64_t *samples);
+SR_PRIV int sr_session_driver_merge_init(struct sr_dev_inst *sdi,
+		GSList *members);
+SR_PRIV int sr_session_driver_read(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch, uint64_t offset, uint64_t *count,
+		void *buf);
+SR_PRIV int sr_session_driver_summary_levels(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch, unsigned int *levels,
+		unsigned int *shift);
+SR_PRIV int sr_session_driver_summary_read(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch, unsigned int level, uint64_t offset,
+		uint64_t *count, void *buf);
+SR_PRIV int sr_session_driver_edge_next(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch, uint64_t from, int match,
+		uint64_t *pos);
+
 /*--- session_file.c --------------------------------------------------------*/
 
 #if !HAVE_ZIP_DISCARD
@@ -1813,6 +2222,131 @@ SR_PRIV void sr_zip_discard(struct zip *archive);
 SR_PRIV GKeyFile *sr_sessionfile_read_metadata(struct zip *archive,
 			const struct zip_stat *entry);
 
+/* A member of a session file, from the ZIP central directory. */
+struct sr_zip_member {
+	char *name;
+	uint16_t method;
+	uint64_t size;
+	uint64_t comp_size;
+	/* Position of the member's local header. */
+	uint64_t header_offset;
+};
+
+SR_PRIV gboolean sr_sessionfile_read_at(FILE *f, uint64_t offset,
+		void *buf, size_t len);
+SR_PRIV GArray *sr_sessionfile_members(FILE *f);
+SR_PRIV void sr_sessionfile_members_free(GArray *members);
+SR_PRIV uint64_t sr_sessionfile_member_data(FILE *f,
+		const struct sr_zip_member *member);
+SR_PRIV gboolean sr_sessionfile_chunk_number(const char *name,
+		const char *base, gboolean analog, uint64_t *number,
+		gboolean *encoded);
+SR_PRIV void sr_sessionfile_analog_encoding_set(GKeyFile *kf, int ch_nr,
+		const struct sr_analog_encoding *enc);
+SR_PRIV int sr_sessionfile_analog_encoding(GKeyFile *kf, int ch_nr,
+		struct sr_analog_encoding *enc);
+
+/*--- input/input.c ---------------------------------------------------------*/
+
+SR_PRIV void sr_input_buf_append(struct sr_input *in, const void *data,
+		size_t length);
+SR_PRIV void sr_input_buf_consume(struct sr_input *in, size_t length);
+SR_PRIV void sr_input_buf_clear(struct sr_input *in);
+SR_PRIV void sr_input_header_keep(struct sr_input *in,
+		const char *text, size_t len);
+SR_PRIV void sr_input_header_drop(struct sr_input *in);
+SR_PRIV int sr_input_header_skip(struct sr_input *in);
+
+/*--- output/output.c -------------------------------------------------------*/
+
+SR_PRIV int sr_output_sink_write(struct sr_output_sink *sink,
+		const void *data, size_t length);
+SR_PRIV int sr_output_sink_write_ref(struct sr_output_sink *sink,
+		const void *data, size_t length);
+SR_PRIV int sr_output_sink_flush(struct sr_output_sink *sink);
+
+/*--- output/compress.c -----------------------------------------------------*/
+
+struct sr_output_compress;
+
+SR_PRIV int sr_output_compress_new(const char *spec,
+	struct sr_output_compress **comp);
+SR_PRIV int sr_output_compress_data(struct sr_output_compress *comp,
+	const void *data, size_t len, gboolean finish,
+	const uint8_t **out, size_t *out_len);
+SR_PRIV void sr_output_compress_free(struct sr_output_compress *comp);
+
+/*--- output/disk.c ---------------------------------------------------------*/
+
+struct sr_disk_writer;
+
+SR_PRIV struct sr_disk_writer *sr_disk_writer_new(const char *filename,
+	gboolean direct, enum sr_disk_sync sync);
+SR_PRIV int sr_disk_writer_write(struct sr_disk_writer *dw,
+	const void *data, size_t len);
+SR_PRIV int sr_disk_writer_flush(struct sr_disk_writer *dw);
+SR_PRIV int sr_disk_writer_close(struct sr_disk_writer *dw);
+SR_PRIV void sr_disk_writer_stats(struct sr_disk_writer *dw,
+	struct sr_disk_stats *stats);
+SR_PRIV void sr_disk_writer_free(struct sr_disk_writer *dw);
+
+/*--- output/zip.c ----------------------------------------------------------*/
+
+struct sr_zip_writer;
+
+SR_PRIV struct sr_zip_writer *sr_zip_writer_new(const char *filename,
+	int level, guint threads, gboolean direct, enum sr_disk_sync sync);
+SR_PRIV int sr_zip_writer_add(struct sr_zip_writer *zw, const char *name,
+	const void *data, size_t size);
+SR_PRIV int sr_zip_writer_finish(struct sr_zip_writer *zw);
+SR_PRIV void sr_zip_writer_free(struct sr_zip_writer *zw);
+
+/*--- summary.c -------------------------------------------------------------*/
+
+/* Samples per entry of the finest summary level, as a power of two. */
+#define SR_SUMMARY_SHIFT 12
+
+struct sr_summary;
+
+SR_PRIV struct sr_summary *sr_summary_new(size_t unitsize, size_t num_analog);
+SR_PRIV void sr_summary_free(struct sr_summary *summary);
+SR_PRIV void sr_summary_logic_feed(struct sr_summary *summary,
+	const uint8_t *data, uint64_t count);
+SR_PRIV void sr_summary_analog_feed(struct sr_summary *summary, size_t index,
+	const float *data, uint64_t count);
+SR_PRIV int sr_summary_write(struct sr_summary *summary,
+	struct sr_zip_writer *zw, size_t first_analog_nr);
+SR_PRIV size_t sr_summary_logic_entry_size(size_t unitsize);
+SR_PRIV size_t sr_summary_analog_entry_size(void);
+SR_PRIV void sr_summary_logic_unpack(const uint8_t *entries, size_t unitsize,
+	unsigned int index, uint64_t count, struct sr_logic_summary *out);
+SR_PRIV void sr_summary_analog_unpack(const uint8_t *entries, uint64_t count,
+	struct sr_analog_summary *out);
+
+/*--- edge_index.c ----------------------------------------------------------*/
+
+/* Samples per entry of written transition indexes, as a power of two. */
+#define SR_EDGE_INDEX_SHIFT 12
+
+struct sr_edge_index;
+
+SR_PRIV struct sr_edge_index *sr_edge_index_new(size_t unitsize);
+SR_PRIV void sr_edge_index_free(struct sr_edge_index *ei);
+SR_PRIV void sr_edge_index_feed(struct sr_edge_index *ei,
+	const uint8_t *data, uint64_t count);
+SR_PRIV GBytes *sr_edge_index_finish(struct sr_edge_index *ei);
+SR_PRIV int sr_edge_index_write(struct sr_edge_index *ei,
+	struct sr_zip_writer *zw, gboolean finish);
+SR_PRIV size_t sr_edge_index_entry_size(size_t unitsize);
+SR_PRIV unsigned int sr_edge_index_shift(GKeyFile *kf);
+SR_PRIV GBytes *sr_edge_index_load(const char *path, uint64_t file_size,
+	int64_t mtime, size_t unitsize, uint64_t num_entries);
+SR_PRIV void sr_edge_index_save(const char *path, uint64_t file_size,
+	int64_t mtime, size_t unitsize, GBytes *entries);
+SR_PRIV gboolean sr_edge_index_find(const uint8_t *entries,
+	uint64_t num_entries, size_t unitsize, unsigned int index,
+	uint64_t *block, unsigned int *first, unsigned int *last);
+
 /*--- analog.c --------------------------------------------------------------*/
 
 SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
@@ -1820,6 +2354,14 @@ SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
                            struct sr_analog_meaning *meaning,
                            struct sr_analog_spec *spec,
                            int digits);
+SR_PRIV void sr_analog_meaning_channel_set(struct sr_analog_meaning *meaning,
+		GSList *node, struct sr_channel *ch);
+SR_PRIV size_t sr_analog_frame_size(const struct sr_datafeed_analog *analog);
+SR_PRIV gboolean sr_analog_is_packed(const struct sr_datafeed_analog *analog);
+SR_PRIV void sr_analog_channel_scaling(const struct sr_datafeed_analog *analog,
+		unsigned int channel, double *scale, double *offset);
+SR_PRIV void sr_rational_from_double(struct sr_rational *r, double value);
+SR_PRIV void sr_rational_reduce(struct sr_rational *r);
 
 /*--- std.c -----------------------------------------------------------------*/
 
@@ -1911,6 +2453,15 @@ SR_PRIV gssize sr_resource_read(struct sr_context *ctx,
 SR_PRIV void *sr_resource_load(struct sr_context *ctx, int type,
 		const char *name, size_t *size, size_t max_size)
 		G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+typedef GBytes *(*sr_resource_convert_cb)(GBytes *data, const char *name);
+SR_PRIV GBytes *sr_resource_get(struct sr_context *ctx, int type,
+		const char *name, size_t max_size)
+		G_GNUC_WARN_UNUSED_RESULT;
+SR_PRIV GBytes *sr_resource_get_converted(struct sr_context *ctx, int type,
+		const char *name, size_t max_size,
+		const char *form, sr_resource_convert_cb convert)
+		G_GNUC_WARN_UNUSED_RESULT;
+SR_PRIV void sr_resource_cache_free(struct sr_context *ctx);
 
 /*--- strutil.c -------------------------------------------------------------*/
 
@@ -1923,32 +2474,124 @@ SR_PRIV int sr_atof(const char *str, float *ret);
 SR_PRIV int sr_atod_ascii(const char *str, double *ret);
 SR_PRIV int sr_atod_ascii_digits(const char *str, double *ret, int *digits);
 SR_PRIV int sr_atof_ascii(const char *str, float *ret);
+SR_PRIV int sr_parse_double_ascii(const char *str, size_t len,
+	double *ret, const char **end);
+SR_PRIV int sr_parse_u64_ascii(const char *str, size_t len,
+	uint64_t *ret, const char **end);
+SR_PRIV int sr_parse_bits_ascii(const char *str, size_t len,
+	uint8_t *buf, size_t size, size_t *count, const char **end);
+SR_PRIV size_t sr_count_char_ascii(const char *str, size_t len, char c);
+SR_PRIV int sr_parse_floatv_ascii(const char *str, size_t len,
+	float *buf, size_t size, size_t *count, const char **end);
+SR_PRIV int sr_parse_uint8v_ascii(const char *str, size_t len,
+	uint8_t *buf, size_t size, size_t *count, const char **end);
 
 SR_PRIV GString *sr_hexdump_new(const uint8_t *data, const size_t len);
 SR_PRIV void sr_hexdump_free(GString *s);
 
+/*--- trigger.c -------------------------------------------------------------*/
+
+/* What a hardware trigger engine can evaluate, see sr_trigger_plan(). */
+struct sr_trigger_caps {
+	/* Supported matches, a bit (1 << SR_TRIGGER_*) each. */
+	uint32_t matches;
+	/* Number of stages. */
+	int max_stages;
+	/* Number of rising/falling/edge matches per stage, -1 for any. */
+	int max_edges;
+};
+
+SR_PRIV int sr_trigger_plan(const struct sr_trigger *trigger,
+		const struct sr_trigger_caps *caps,
+		struct sr_trigger **hw, gboolean *sw);
+
 /*--- soft-trigger.c --------------------------------------------------------*/
 
+struct soft_trigger_stage_masks;
+
+typedef void (*soft_trigger_release_cb)(void *buffer_priv);
+
+/* A reference to (part of) a lent buffer, kept for pre-trigger data. */
+struct soft_trigger_view {
+	uint8_t *data;
+	int offset;
+	int length;
+	soft_trigger_release_cb release;
+	void *buffer_priv;
+};
+
 struct soft_trigger_logic {
 	const struct sr_dev_inst *sdi;
 	const struct sr_trigger *trigger;
 	int count;
 	int unitsize;
+	int num_words;
+	int num_stages;
+	struct soft_trigger_stage_masks *stages;
+	uint64_t *stage_words;
 	int cur_stage;
 	uint8_t *prev_sample;
 	uint8_t *pre_trigger_buffer;
 	uint8_t *pre_trigger_head;
 	int pre_trigger_size;
 	int pre_trigger_fill;
+	gboolean zero_copy;
+	struct soft_trigger_view *views;
+	int view_size;
+	int view_head;
+	int view_count;
+	/* Segmented capture. */
+	gboolean segmented;
+	uint64_t post_trigger_samples;
+	uint64_t num_segments;
+	uint64_t segments_done;
+	uint64_t segment_left;
+	gboolean in_segment;
 };
 
 SR_PRIV int logic_channel_unitsize(GSList *channels);
 SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
 		int pre_trigger_samples);
+SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new_zerocopy(
+		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
+		int pre_trigger_samples);
 SR_PRIV void soft_trigger_logic_free(struct soft_trigger_logic *st);
 SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *st, uint8_t *buf,
 		int len, int *pre_trigger_samples);
+SR_PRIV int soft_trigger_logic_check_lent(struct soft_trigger_logic *st,
+		uint8_t *buf, int len, int *pre_trigger_samples,
+		soft_trigger_release_cb release, void *buffer_priv);
+SR_PRIV int soft_trigger_logic_scan(struct soft_trigger_logic *st,
+		const uint8_t *buf, int len);
+SR_PRIV void soft_trigger_logic_segments_set(struct soft_trigger_logic *st,
+		uint64_t post_trigger_samples, uint64_t num_segments);
+SR_PRIV int soft_trigger_logic_segmented_send(struct soft_trigger_logic *st,
+		uint8_t *buf, int len);
+SR_PRIV gboolean soft_trigger_logic_segments_done(struct soft_trigger_logic *st);
+
+struct soft_trigger_analog;
+
+SR_PRIV struct soft_trigger_analog *soft_trigger_analog_new(
+		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
+		int pre_trigger_samples, float hysteresis);
+SR_PRIV void soft_trigger_analog_free(struct soft_trigger_analog *sta);
+SR_PRIV int soft_trigger_analog_check(struct soft_trigger_analog *sta,
+		const struct sr_datafeed_analog *analog, int *pre_trigger_samples);
+
+/*--- traffic.c -------------------------------------------------------------*/
+
+/** Kinds of recorded data, see sr_traffic_record(). */
+enum sr_traffic_kind {
+	SR_TRAFFIC_SERIAL_RX = 1,
+	SR_TRAFFIC_USB_BULK_IN = 2,
+};
+
+SR_PRIV void sr_traffic_record(enum sr_traffic_kind kind, uint8_t endpoint,
+	const void *data, size_t len);
+SR_PRIV void sr_traffic_record_close(void);
+SR_PRIV int sr_traffic_load(const char *filename, enum sr_traffic_kind kind,
+	GBytes **data);
 
 /*--- serial.c --------------------------------------------------------------*/
 
@@ -1999,13 +2642,20 @@ SR_PRIV int serial_source_add(struct sr_session *session,
 		sr_receive_data_callback cb, void *cb_data);
 SR_PRIV int serial_source_remove(struct sr_session *session,
 		struct sr_serial_dev_inst *serial);
+SR_PRIV int serial_mux_source_add(struct sr_session *session,
+		struct sr_serial_dev_inst *serial, int events, int timeout,
+		sr_receive_data_callback cb, void *cb_data);
 SR_PRIV GSList *sr_serial_find_usb(uint16_t vendor_id, uint16_t product_id);
+SR_PRIV void sr_serial_list_cache_begin(void);
+SR_PRIV void sr_serial_list_cache_end(void);
 SR_PRIV int serial_timeout(struct sr_serial_dev_inst *port, int num_bytes);
 
 SR_PRIV void sr_ser_discard_queued_data(struct sr_serial_dev_inst *serial);
 SR_PRIV size_t sr_ser_has_queued_data(struct sr_serial_dev_inst *serial);
 SR_PRIV void sr_ser_queue_rx_data(struct sr_serial_dev_inst *serial,
 		const uint8_t *data, size_t len);
+SR_PRIV void sr_ser_unread_rx_data(struct sr_serial_dev_inst *serial,
+	const uint8_t *data, size_t len);
 SR_PRIV size_t sr_ser_unqueue_rx_data(struct sr_serial_dev_inst *serial,
 		uint8_t *data, size_t len);
 
@@ -2037,12 +2687,16 @@ struct ser_lib_functions {
 	int (*get_frame_format)(struct sr_serial_dev_inst *serial,
 			int *baud, int *bits);
 	size_t (*get_rx_avail)(struct sr_serial_dev_inst *serial);
+	int (*get_pollfd)(struct sr_serial_dev_inst *serial, int events,
+			gintptr *fd, unsigned int *poll_events);
 };
 extern SR_PRIV struct ser_lib_functions *ser_lib_funcs_libsp;
 SR_PRIV int ser_name_is_hid(struct sr_serial_dev_inst *serial);
 extern SR_PRIV struct ser_lib_functions *ser_lib_funcs_hid;
 SR_PRIV int ser_name_is_bt(struct sr_serial_dev_inst *serial);
 extern SR_PRIV struct ser_lib_functions *ser_lib_funcs_bt;
+SR_PRIV int ser_name_is_replay(struct sr_serial_dev_inst *serial);
+extern SR_PRIV struct ser_lib_functions *ser_lib_funcs_replay;
 
 #ifdef HAVE_LIBHIDAPI
 struct vid_pid_item {
@@ -2097,6 +2751,8 @@ SR_PRIV int sr_bt_config_rfcomm(struct sr_bt_desc *desc, size_t channel);
 SR_PRIV int sr_bt_config_notify(struct sr_bt_desc *desc,
 	uint16_t read_handle, uint16_t write_handle,
 	uint16_t cccd_handle, uint16_t cccd_value);
+SR_PRIV int sr_bt_config_conn_interval(struct sr_bt_desc *desc,
+	unsigned int min_us, unsigned int max_us);
 
 SR_PRIV int sr_bt_scan_le(struct sr_bt_desc *desc, int duration);
 SR_PRIV int sr_bt_scan_bt(struct sr_bt_desc *desc, int duration);
@@ -2122,6 +2778,9 @@ SR_PRIV int ezusb_install_firmware(struct sr_context *ctx, libusb_device_handle
 				   const char *name);
 SR_PRIV int ezusb_upload_firmware(struct sr_context *ctx, libusb_device *dev,
 				  int configuration, const char *name);
+SR_PRIV int ezusb_wait_renumeration(struct sr_dev_inst *sdi,
+		int64_t fw_updated, int max_delay_ms,
+		int (*open_cb)(struct sr_dev_inst *sdi));
 #endif
 
 /*--- usb.c -----------------------------------------------------------------*/
@@ -2129,6 +2788,13 @@ SR_PRIV int ezusb_upload_firmware(struct sr_context *ctx, libusb_device *dev,
 SR_PRIV int sr_usb_split_conn(const char *conn,
 	uint16_t *vid, uint16_t *pid, uint8_t *bus, uint8_t *addr);
 #ifdef HAVE_LIBUSB_1_0
+SR_PRIV void sr_usb_registry_init(libusb_context *usb_ctx);
+SR_PRIV void sr_usb_registry_free(libusb_context *usb_ctx);
+SR_PRIV void sr_usb_devlist_cache_begin(libusb_context *usb_ctx);
+SR_PRIV void sr_usb_devlist_cache_end(libusb_context *usb_ctx);
+SR_PRIV ssize_t sr_usb_get_device_list(libusb_context *usb_ctx,
+	libusb_device ***list);
+SR_PRIV void sr_usb_free_device_list(libusb_device **list);
 SR_PRIV GSList *sr_usb_find(libusb_context *usb_ctx, const char *conn);
 SR_PRIV int sr_usb_open(libusb_context *usb_ctx, struct sr_usb_dev_inst *usb);
 SR_PRIV void sr_usb_close(struct sr_usb_dev_inst *usb);
@@ -2138,6 +2804,78 @@ SR_PRIV int usb_source_remove(struct sr_session *session, struct sr_context *ctx
 SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len);
 SR_PRIV gboolean usb_match_manuf_prod(libusb_device *dev,
 		const char *manufacturer, const char *product);
+SR_PRIV gboolean sr_usb_fpga_bitstream_loaded(const struct sr_dev_inst *sdi,
+		GBytes *bitstream);
+SR_PRIV void sr_usb_fpga_bitstream_set(const struct sr_dev_inst *sdi,
+		GBytes *bitstream);
+
+/**
+ * Process data of a completed USB transfer.
+ * @returns TRUE to resubmit the transfer, FALSE to end reception.
+ */
+typedef gboolean (*sr_usb_stream_receive_cb)(struct libusb_transfer *transfer,
+	void *cb_data);
+/** Reception has ended, all transfers have returned. */
+typedef void (*sr_usb_stream_done_cb)(void *cb_data);
+
+/** Transfer queue of a USB bulk data stream, sizing and statistics. */
+struct sr_usb_stream {
+	/* User settings, zero selects automatic sizing. */
+	uint64_t transfer_size;
+	uint64_t queue_depth;
+	/*
+	 * Hold completed transfers until sr_usb_stream_resubmit(), so the
+	 * driver can keep their data for a batch across the transfers which
+	 * complete in one round of event handling.
+	 */
+	gboolean hold;
+	/* Host service latency seen in previous acquisitions. */
+	uint64_t latency_us;
+	/* Sizing of the current acquisition. */
+	uint64_t bytes_per_ms;
+	size_t size;
+	unsigned int depth;
+	unsigned int max_depth;
+	unsigned int timeout;
+	/* Statistics of the current (or last) acquisition. */
+	int64_t last_completion_us;
+	int64_t max_gap_us;
+	uint64_t underruns;
+	uint64_t overruns;
+	/* Transfers of the current acquisition. */
+	libusb_device_handle *devhdl;
+	unsigned char endpoint;
+	sr_usb_stream_receive_cb receive_cb;
+	sr_usb_stream_done_cb done_cb;
+	void *cb_data;
+	struct libusb_transfer **transfers;
+	size_t transfer_count;
+	unsigned int submitted;
+	struct libusb_transfer **held;
+	size_t held_count;
+	gboolean dev_mem;
+	gboolean stopping;
+	/* Transfers of the last acquisition, kept for the next one. */
+	struct libusb_transfer **idle;
+	size_t idle_count;
+	size_t idle_size;
+	gboolean idle_dev_mem;
+};
+
+SR_PRIV void sr_usb_stream_start(struct sr_usb_stream *st,
+	uint64_t bytes_per_second, size_t granularity,
+	unsigned int min_queue_ms, unsigned int max_depth);
+SR_PRIV int sr_usb_stream_submit(struct sr_usb_stream *st,
+	libusb_device_handle *devhdl, unsigned char endpoint,
+	sr_usb_stream_receive_cb receive_cb, sr_usb_stream_done_cb done_cb,
+	void *cb_data);
+SR_PRIV void sr_usb_stream_resubmit(struct sr_usb_stream *st);
+SR_PRIV void sr_usb_stream_cancel(struct sr_usb_stream *st);
+SR_PRIV void sr_usb_stream_drain(struct sr_usb_stream *st,
+	libusb_context *usb_ctx, unsigned int timeout_ms);
+SR_PRIV size_t sr_usb_ftdi_payload(uint8_t *buf, size_t length,
+	size_t packet_size);
+SR_PRIV void sr_usb_stream_free(struct sr_usb_stream *st);
 #endif
 
 /*--- binary_helpers.c ------------------------------------------------------*/
@@ -2226,6 +2964,107 @@ SR_PRIV int bv_send_analog_channel(const struct sr_dev_inst *sdi, struct sr_chan
  */
 SR_PRIV uint16_t sr_crc16(uint16_t crc, const uint8_t *buffer, int len);
 
+/**
+ * Calculate a CRC32 checksum using the 0x04C11DB7 polynomial.
+ *
+ * This is the CRC32 flavor of ZIP archives and zlib (reflected, with
+ * pre and post inversion). Pass 0 as the initial value, or the result
+ * of a previous call to continue a calculation.
+ *
+ * @param crc Initial value (typically 0)
+ * @param buffer Input buffer
+ * @param len Buffer length
+ * @return Checksum
+ */
+SR_PRIV uint32_t sr_crc32(uint32_t crc, const uint8_t *buffer, size_t len);
+
+/*--- trace.c ---------------------------------------------------------------*/
+
+enum sr_trace_type {
+	SR_TRACE_USB_DISPATCH,
+	SR_TRACE_USB_TRANSFER,
+	SR_TRACE_SESSION_SEND,
+	SR_TRACE_TRANSFORM,
+	SR_TRACE_DATAFEED_CB,
+	SR_TRACE_OUTPUT_RECEIVE,
+};
+
+enum sr_trace_phase {
+	SR_TRACE_BEGIN,
+	SR_TRACE_END,
+	SR_TRACE_INSTANT,
+};
+
+extern SR_PRIV int sr_trace_active;
+
+SR_PRIV void sr_trace_record(int type, int phase, uint64_t arg);
+
+/* Record a trace event, costs a test while tracing is not active. */
+#define sr_trace(type, phase, arg) do { \
+	if (G_UNLIKELY(sr_trace_active)) \
+		sr_trace_record(type, phase, arg); \
+} while (0)
+
+/*--- mem_stats.c -----------------------------------------------------------*/
+
+#ifdef HAVE_MEM_STATS
+SR_PRIV int sr_mem_tag_current(void);
+SR_PRIV int sr_mem_tag_enter(int tag);
+SR_PRIV void sr_mem_tag_leave(int prev);
+SR_PRIV void sr_mem_alloc_add(int tag, size_t size);
+SR_PRIV void sr_mem_free_add(int tag, size_t size);
+#else
+/* Without accounting, these cost nothing. */
+#define sr_mem_tag_current() (SR_MEM_OTHER)
+#define sr_mem_tag_enter(tag) ((void)(tag), SR_MEM_OTHER)
+#define sr_mem_tag_leave(prev) ((void)(prev))
+#define sr_mem_alloc_add(tag, size) ((void)(tag), (void)(size))
+#define sr_mem_free_add(tag, size) ((void)(tag), (void)(size))
+#endif
+
+/*--- analog_codec.c --------------------------------------------------------*/
+
+SR_PRIV int sr_analog_xor_encode(const float *values, size_t count,
+		GByteArray *out);
+SR_PRIV int sr_analog_xor_count(const uint8_t *data, size_t len,
+		size_t *count);
+SR_PRIV int sr_analog_xor_decode(const uint8_t *data, size_t len,
+		float *values, size_t count);
+
+/*--- logic_kernels.c -------------------------------------------------------*/
+
+SR_PRIV uint64_t sr_logic_find_match(const uint8_t *data, size_t unitsize,
+		uint64_t from, uint64_t count,
+		const uint8_t *mask, const uint8_t *value);
+SR_PRIV uint64_t sr_logic_next_change(const uint8_t *data, size_t unitsize,
+		uint64_t from, uint64_t count, const uint8_t *mask);
+SR_PRIV void sr_logic_channel_extract(const uint8_t *data, size_t unitsize,
+		uint64_t count, unsigned int index, uint8_t *out, size_t stride);
+SR_PRIV void sr_logic_bytes_extract(const uint8_t *data, size_t stride,
+		uint64_t count, uint8_t *out);
+
+/*--- transpose.c -----------------------------------------------------------*/
+
+/**
+ * Conversion of "bit planes" (one word of samples per channel) to
+ * samples with one bit per channel. Supports up to 16 channels.
+ */
+struct sr_transpose {
+	size_t word_size;
+	gboolean msb_first;
+	size_t plane_count;
+	size_t block_size;
+	uint8_t plane_bit[16];
+	gboolean high_channels;
+};
+
+SR_PRIV int sr_transpose_init(struct sr_transpose *tp, uint16_t channel_mask,
+	size_t word_size, gboolean msb_first);
+SR_PRIV size_t sr_transpose_blocks(const struct sr_transpose *tp,
+	const uint8_t *src, size_t length, uint16_t *dst);
+SR_PRIV void sr_transpose_samples(const uint8_t *src, size_t unitsize,
+	size_t count, size_t bytes, uint8_t *planes);
+
 /*--- modbus/modbus.c -------------------------------------------------------*/
 
 struct sr_modbus_dev_inst {
@@ -2271,6 +3110,18 @@ SR_PRIV int sr_modbus_read_coils(struct sr_modbus_dev_inst *modbus,
 SR_PRIV int sr_modbus_read_holding_registers(struct sr_modbus_dev_inst *modbus,
                                              int address, int nb_registers,
                                              uint16_t *registers);
+
+/** A range of holding registers, see sr_modbus_read_holding_ranges(). */
+struct sr_modbus_read_range {
+	int address;
+	int nb_registers;
+	/* Receives the registers' values, in the Modbus byte order. */
+	uint16_t *registers;
+};
+
+SR_PRIV int sr_modbus_read_holding_ranges(struct sr_modbus_dev_inst *modbus,
+                                          struct sr_modbus_read_range *ranges,
+                                          size_t count, int max_gap);
 SR_PRIV int sr_modbus_write_coil(struct sr_modbus_dev_inst *modbus,
                                  int address, int value);
 SR_PRIV int sr_modbus_write_multiple_registers(struct sr_modbus_dev_inst*modbus,
@@ -2279,6 +3130,33 @@ SR_PRIV int sr_modbus_write_multiple_registers(struct sr_modbus_dev_inst*modbus,
 SR_PRIV int sr_modbus_close(struct sr_modbus_dev_inst *modbus);
 SR_PRIV void sr_modbus_free(struct sr_modbus_dev_inst *modbus);
 
+/*
+ * Decoding of 7-segment LCD digits. Meter chips report the segments of
+ * a digit as bits in a byte, and differ in the bit which each segment
+ * occupies. SEG7_DIGIT_TABLE() builds a chip's lookup table from its
+ * segment bits at compile time (a is the top segment, b to f follow
+ * clockwise, g is the middle segment). Table entries hold the digit's
+ * value plus one, zero for codes which are not a digit.
+ */
+#define SEG7_DIGIT_TABLE(a, b, c, d, e, f, g) { \
+	[(a) | (b) | (c) | (d) | (e) | (f)] = 1, \
+	[(b) | (c)] = 2, \
+	[(a) | (b) | (d) | (e) | (g)] = 3, \
+	[(a) | (b) | (c) | (d) | (g)] = 4, \
+	[(b) | (c) | (f) | (g)] = 5, \
+	[(a) | (c) | (d) | (f) | (g)] = 6, \
+	[(a) | (c) | (d) | (e) | (f) | (g)] = 7, \
+	[(a) | (b) | (c)] = 8, \
+	[(a) | (b) | (c) | (d) | (e) | (f) | (g)] = 9, \
+	[(a) | (b) | (c) | (d) | (f) | (g)] = 10, \
+}
+
+/* Get the digit for a segment code, -1 when it is not a digit. */
+static inline int seg7_digit(const uint8_t *table, uint8_t code)
+{
+	return (int)table[code] - 1;
+}
+
 /*--- dmm/es519xx.c ---------------------------------------------------------*/
 
 /**
@@ -2746,6 +3624,10 @@ struct sr_sw_limits {
 	uint64_t samples_read;
 	uint64_t frames_read;
 	uint64_t start_time;
+	/* Applies limit_msec to sample timestamps when set. */
+	uint64_t samplerate;
+	/* Set when sr_sw_limits_send() stopped the acquisition. */
+	gboolean stopped;
 };
 
 SR_PRIV int sr_sw_limits_config_get(const struct sr_sw_limits *limits, uint32_t key,
@@ -2753,6 +3635,8 @@ SR_PRIV int sr_sw_limits_config_get(const struct sr_sw_limits *limits, uint32_t
 SR_PRIV int sr_sw_limits_config_set(struct sr_sw_limits *limits, uint32_t key,
 	GVariant *data);
 SR_PRIV void sr_sw_limits_acquisition_start(struct sr_sw_limits *limits);
+SR_PRIV void sr_sw_limits_set_samplerate(struct sr_sw_limits *limits,
+	uint64_t samplerate);
 SR_PRIV gboolean sr_sw_limits_check(struct sr_sw_limits *limits);
 SR_PRIV int sr_sw_limits_get_remain(const struct sr_sw_limits *limits,
 	uint64_t *samples, uint64_t *frames, uint64_t *msecs,
@@ -2762,6 +3646,8 @@ SR_PRIV void sr_sw_limits_update_samples_read(struct sr_sw_limits *limits,
 SR_PRIV void sr_sw_limits_update_frames_read(struct sr_sw_limits *limits,
 	uint64_t frames_read);
 SR_PRIV void sr_sw_limits_init(struct sr_sw_limits *limits);
+SR_PRIV int sr_sw_limits_send(struct sr_sw_limits *limits,
+	struct sr_dev_inst *sdi, const struct sr_datafeed_packet *packet);
 
 /*--- feed_queue.h ----------------------------------------------------------*/
 
@@ -2773,6 +3659,13 @@ SR_API struct feed_queue_logic *feed_queue_logic_alloc(
 	size_t sample_count, size_t unit_size);
 SR_API int feed_queue_logic_submit(struct feed_queue_logic *q,
 	const uint8_t *data, size_t count);
+SR_API int feed_queue_logic_submit_many(struct feed_queue_logic *q,
+	const uint8_t *data, size_t count);
+SR_API uint8_t *feed_queue_logic_get_buffer(struct feed_queue_logic *q,
+	size_t *count);
+SR_API int feed_queue_logic_commit(struct feed_queue_logic *q, size_t count);
+SR_API int feed_queue_logic_use_pool(struct feed_queue_logic *q,
+	size_t max_idle);
 SR_API int feed_queue_logic_flush(struct feed_queue_logic *q);
 SR_API int feed_queue_logic_send_trigger(struct feed_queue_logic *q);
 SR_API void feed_queue_logic_free(struct feed_queue_logic *q);
@@ -2780,8 +3673,16 @@ SR_API void feed_queue_logic_free(struct feed_queue_logic *q);
 SR_API struct feed_queue_analog *feed_queue_analog_alloc(
 	const struct sr_dev_inst *sdi,
 	size_t sample_count, int digits, struct sr_channel *ch);
+SR_API struct feed_queue_analog *feed_queue_analog_alloc_channels(
+	const struct sr_dev_inst *sdi,
+	size_t sample_count, int digits, GSList *channels);
 SR_API int feed_queue_analog_submit(struct feed_queue_analog *q,
 	float data, size_t count);
+SR_API float *feed_queue_analog_get_buffer(struct feed_queue_analog *q,
+	size_t *count);
+SR_API int feed_queue_analog_commit(struct feed_queue_analog *q, size_t count);
+SR_API int feed_queue_analog_use_pool(struct feed_queue_analog *q,
+	size_t max_idle);
 SR_API int feed_queue_analog_flush(struct feed_queue_analog *q);
 SR_API void feed_queue_analog_free(struct feed_queue_analog *q);
 
@@ -20,6 +20,7 @@
 #include <config.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 #include <glib/gprintf.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
@@ -63,6 +64,26 @@ static void *sr_log_cb_data = NULL;
 /** @endcond */
 static int64_t sr_log_start_time = 0;
 
+/*
+ * Loglevels of modules (the LOG_PREFIX of a source file), which take
+ * precedence over the global loglevel. The count and the maximum of
+ * the module loglevels keep the check of messages cheap.
+ */
+static GRWLock module_lock;
+static GHashTable *module_loglevels;
+static int module_count;
+static int max_module_loglevel = SR_LOG_NONE;
+
+/* Buffer for the messages of the default log callback, per thread. */
+#define LOG_LINE_SIZE 1024
+static GPrivate log_line = G_PRIVATE_INIT(g_free);
+
+/* Queue and thread which write messages when the output is asynchronous. */
+static GRWLock sink_lock;
+static GAsyncQueue *sink_queue;
+static GThread *sink_thread;
+static char sink_stop;
+
 /**
  * Set the libsigrok loglevel.
  *
@@ -109,6 +130,128 @@ SR_API int sr_log_loglevel_get(void)
 	return cur_loglevel;
 }
 
+static void update_max_module_loglevel(void)
+{
+	GHashTableIter iter;
+	gpointer value;
+	int max_level;
+
+	max_level = SR_LOG_NONE;
+	g_hash_table_iter_init(&iter, module_loglevels);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+		max_level = MAX(max_level, GPOINTER_TO_INT(value));
+	g_atomic_int_set(&max_module_loglevel, max_level);
+	g_atomic_int_set(&module_count, g_hash_table_size(module_loglevels));
+}
+
+/**
+ * Set the loglevel of a libsigrok module.
+ *
+ * Messages of the module are shown according to this loglevel instead
+ * of the global loglevel. This can be used to show the debug messages
+ * of one driver only, for example.
+ *
+ * @param module The module's name, which is the prefix of its messages
+ *               (e.g. "fx2lafw" or "session"). Must not be NULL.
+ * @param loglevel The loglevel to set, or -1 to have the module use the
+ *                 global loglevel again.
+ *
+ * @return SR_OK upon success, SR_ERR_ARG upon invalid arguments.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_log_loglevel_set_module(const char *module, int loglevel)
+{
+	if (!module || !*module) {
+		sr_err("%s: module was NULL or empty", __func__);
+		return SR_ERR_ARG;
+	}
+	if (loglevel < -1 || loglevel > SR_LOG_SPEW) {
+		sr_err("Invalid loglevel %d.", loglevel);
+		return SR_ERR_ARG;
+	}
+	if (loglevel >= LOGLEVEL_TIMESTAMP && sr_log_start_time == 0)
+		sr_log_start_time = g_get_monotonic_time();
+
+	g_rw_lock_writer_lock(&module_lock);
+	if (!module_loglevels) {
+		module_loglevels = g_hash_table_new_full(g_str_hash,
+			g_str_equal, g_free, NULL);
+	}
+	if (loglevel < 0) {
+		g_hash_table_remove(module_loglevels, module);
+	} else {
+		g_hash_table_insert(module_loglevels, g_strdup(module),
+			GINT_TO_POINTER(loglevel));
+	}
+	update_max_module_loglevel();
+	g_rw_lock_writer_unlock(&module_lock);
+
+	sr_dbg("Loglevel of module %s set to %d.", module, loglevel);
+
+	return SR_OK;
+}
+
+/**
+ * Get the loglevel of a libsigrok module.
+ *
+ * @param module The module's name. Must not be NULL.
+ *
+ * @return The loglevel of the module, which is the global loglevel
+ *         unless the module has a loglevel of its own.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_log_loglevel_get_module(const char *module)
+{
+	gpointer value;
+	int loglevel;
+
+	loglevel = cur_loglevel;
+	if (!module)
+		return loglevel;
+
+	g_rw_lock_reader_lock(&module_lock);
+	if (module_loglevels && g_hash_table_lookup_extended(module_loglevels,
+			module, NULL, &value))
+		loglevel = GPOINTER_TO_INT(value);
+	g_rw_lock_reader_unlock(&module_lock);
+
+	return loglevel;
+}
+
+/* Check a message's loglevel, for a module name of the given length. */
+static gboolean loglevel_enabled(int loglevel, const char *module, size_t len)
+{
+	char name[64];
+
+	if (!g_atomic_int_get(&module_count))
+		return loglevel <= cur_loglevel;
+	if (loglevel > cur_loglevel &&
+			loglevel > g_atomic_int_get(&max_module_loglevel))
+		return FALSE;
+	if (!module || !len || len >= sizeof(name))
+		return loglevel <= cur_loglevel;
+
+	memcpy(name, module, len);
+	name[len] = '\0';
+
+	return loglevel <= sr_log_loglevel_get_module(name);
+}
+
+/**
+ * Check whether messages of a loglevel get shown for a module.
+ *
+ * This is for code which prepares extra output for the log, like
+ * hex dumps. See sr_log_enabled() for the current source file's module.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_log_check(int loglevel, const char *module)
+{
+	return loglevel_enabled(loglevel, module, module ? strlen(module) : 0);
+}
+
 /**
  * Set the libsigrok log callback to the specified function.
  *
@@ -160,6 +303,68 @@ SR_API int sr_log_callback_set_default(void)
 	return SR_OK;
 }
 
+static gpointer sink_thread_func(gpointer data)
+{
+	GAsyncQueue *queue;
+	char *line;
+
+	queue = data;
+	while ((line = g_async_queue_pop(queue)) != &sink_stop) {
+		fputs(line, stderr);
+		g_free(line);
+	}
+	fflush(stderr);
+
+	return NULL;
+}
+
+/**
+ * Have the default log callback write messages asynchronously.
+ *
+ * The default log callback formats messages in the calling thread,
+ * and a separate thread writes them to stderr. This keeps logging
+ * threads from waiting for the output. Disabling asynchronous output
+ * writes all pending messages before it returns, applications should
+ * do so before they exit.
+ *
+ * Log callbacks other than the default one are not affected.
+ *
+ * @param enable TRUE to write messages asynchronously, FALSE to write
+ *               them before the log call returns (the default).
+ *
+ * @return SR_OK upon success.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_log_async_set(gboolean enable)
+{
+	GAsyncQueue *queue;
+	GThread *thread;
+
+	queue = NULL;
+	thread = NULL;
+	g_rw_lock_writer_lock(&sink_lock);
+	if (enable && !sink_queue) {
+		sink_queue = g_async_queue_new();
+		sink_thread = g_thread_new("sr-log", sink_thread_func,
+			sink_queue);
+	} else if (!enable && sink_queue) {
+		queue = sink_queue;
+		thread = sink_thread;
+		sink_queue = NULL;
+		sink_thread = NULL;
+	}
+	g_rw_lock_writer_unlock(&sink_lock);
+
+	if (thread) {
+		g_async_queue_push(queue, &sink_stop);
+		g_thread_join(thread);
+		g_async_queue_unref(queue);
+	}
+
+	return SR_OK;
+}
+
 /**
  * Get the libsigrok log callback routine and callback data.
  *
@@ -182,19 +387,39 @@ SR_API int sr_log_callback_get(sr_log_callback *cb, void **cb_data)
 	return SR_OK;
 }
 
+static void log_write(const char *line, size_t len)
+{
+	g_rw_lock_reader_lock(&sink_lock);
+	if (sink_queue) {
+		g_async_queue_push(sink_queue, g_strndup(line, len));
+	} else {
+		fwrite(line, 1, len, stderr);
+		fflush(stderr);
+	}
+	g_rw_lock_reader_unlock(&sink_lock);
+}
+
 static int sr_logv(void *cb_data, int loglevel, const char *format, va_list args)
 {
 	uint64_t elapsed_us, minutes;
 	unsigned int rest_us, seconds, microseconds;
-	char *raw_output, *output;
-	int raw_len, raw_idx, idx, ret;
+	char *line, *long_line;
+	int prefix_len, text_len, idx, len;
+	va_list args_copy;
 
 	/* This specific log callback doesn't need the void pointer data. */
 	(void)cb_data;
 
 	(void)loglevel;
 
-	if (cur_loglevel >= LOGLEVEL_TIMESTAMP) {
+	line = g_private_get(&log_line);
+	if (!line) {
+		line = g_malloc(LOG_LINE_SIZE);
+		g_private_set(&log_line, line);
+	}
+
+	if (MAX(cur_loglevel, g_atomic_int_get(&max_module_loglevel))
+			>= LOGLEVEL_TIMESTAMP) {
 		elapsed_us = g_get_monotonic_time() - sr_log_start_time;
 
 		minutes = elapsed_us / G_TIME_SPAN_MINUTE;
@@ -202,31 +427,40 @@ static int sr_logv(void *cb_data, int loglevel, const char *format, va_list args
 		seconds = rest_us / G_TIME_SPAN_SECOND;
 		microseconds = rest_us % G_TIME_SPAN_SECOND;
 
-		ret = g_fprintf(stderr, "sr: [%.2" PRIu64 ":%.2u.%.6u] ",
+		prefix_len = g_snprintf(line, LOG_LINE_SIZE,
+				"sr: [%.2" PRIu64 ":%.2u.%.6u] ",
 				minutes, seconds, microseconds);
 	} else {
-		ret = fputs("sr: ", stderr);
+		prefix_len = g_snprintf(line, LOG_LINE_SIZE, "sr: ");
 	}
 
-	if (ret < 0 || (raw_len = g_vasprintf(&raw_output, format, args)) < 0)
+	/* Keep room for the newline. */
+	G_VA_COPY(args_copy, args);
+	text_len = g_vsnprintf(&line[prefix_len], LOG_LINE_SIZE - prefix_len - 1,
+			format, args_copy);
+	va_end(args_copy);
+	if (text_len < 0)
 		return SR_ERR;
 
-	output = g_malloc0(raw_len + 1);
+	/* Long messages get formatted again, in a buffer of their own. */
+	long_line = NULL;
+	if (text_len >= LOG_LINE_SIZE - prefix_len - 1) {
+		long_line = g_malloc(prefix_len + text_len + 2);
+		memcpy(long_line, line, prefix_len);
+		g_vsnprintf(&long_line[prefix_len], text_len + 1, format, args);
+		line = long_line;
+	}
 
-	/* Copy the string without any unwanted newlines. */
-	raw_idx = idx = 0;
-	while (raw_idx < raw_len) {
-		if (raw_output[raw_idx] != '\n') {
-			output[idx] = raw_output[raw_idx];
-			idx++;
-		}
-		raw_idx++;
+	/* Strip any unwanted newlines. */
+	len = prefix_len;
+	for (idx = prefix_len; idx < prefix_len + text_len; idx++) {
+		if (line[idx] != '\n')
+			line[len++] = line[idx];
 	}
+	line[len++] = '\n';
 
-	g_fprintf(stderr, "%s\n", output);
-	fflush(stderr);
-	g_free(raw_output);
-	g_free(output);
+	log_write(line, len);
+	g_free(long_line);
 
 	return SR_OK;
 }
@@ -236,10 +470,22 @@ SR_PRIV int sr_log(int loglevel, const char *format, ...)
 {
 	int ret;
 	va_list args;
+	const char *sep;
+	size_t len;
 
-	/* Only output messages of at least the selected loglevel(s). */
-	if (loglevel > cur_loglevel)
-		return SR_OK;
+	/*
+	 * Only output messages of at least the selected loglevel(s). The
+	 * module name is the prefix of the format, see sr_err() etc.
+	 */
+	if (!g_atomic_int_get(&module_count)) {
+		if (loglevel > cur_loglevel)
+			return SR_OK;
+	} else {
+		sep = strchr(format, ':');
+		len = sep ? (size_t)(sep - format) : 0;
+		if (!loglevel_enabled(loglevel, format, len))
+			return SR_OK;
+	}
 
 	va_start(args, format);
 	ret = sr_log_cb(sr_log_cb_data, loglevel, format, args);
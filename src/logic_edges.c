@@ -0,0 +1,351 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Collecting the edges of logic channels, and their timing.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "logic-edges"
+/** @endcond */
+
+/**
+ * @defgroup grp_logic_edges Logic edges
+ *
+ * Edge positions and pulse timing of logic channels.
+ *
+ * An edge collector gets fed the logic packets of a stream, and keeps
+ * the sample numbers of each channel's edges in an array. Runs of
+ * unchanged samples get skipped in wide chunks, only samples where any
+ * bit changes are looked at, and only the changed bits of those.
+ *
+ * @{
+ */
+
+/* The edges of one channel. */
+struct edge_channel {
+	GArray *positions;
+	/* Whether the first edge in positions is a rising one. */
+	gboolean first_rising;
+	/* The current level, valid once a sample was seen. */
+	gboolean level;
+};
+
+struct sr_logic_edges {
+	unsigned int num_channels;
+	struct edge_channel *channels;
+	uint16_t unitsize;
+	/* The last sample, and the number of samples seen. */
+	uint8_t *last;
+	uint8_t *prev;
+	uint64_t offset;
+	/* Whether the levels were set from the stream's first sample. */
+	gboolean primed;
+};
+
+/**
+ * Create a collector of logic edges.
+ *
+ * @param[out] edges Pointer where to store the new collector.
+ * @param[in] num_channels The number of channels to watch, the bits 0 to
+ *                         num_channels - 1 of the samples. At least 1.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_edges_new(struct sr_logic_edges **edges,
+		unsigned int num_channels)
+{
+	unsigned int i;
+
+	if (!edges || !num_channels)
+		return SR_ERR_ARG;
+
+	*edges = g_malloc0(sizeof(**edges));
+	(*edges)->num_channels = num_channels;
+	(*edges)->channels = g_malloc0_n(num_channels,
+		sizeof((*edges)->channels[0]));
+	for (i = 0; i < num_channels; i++)
+		(*edges)->channels[i].positions = g_array_new(FALSE, FALSE,
+			sizeof(uint64_t));
+
+	return SR_OK;
+}
+
+/**
+ * Free a collector of logic edges.
+ *
+ * @param[in] edges The collector to free. May be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_logic_edges_free(struct sr_logic_edges *edges)
+{
+	unsigned int i;
+
+	if (!edges)
+		return;
+
+	for (i = 0; i < edges->num_channels; i++)
+		g_array_free(edges->channels[i].positions, TRUE);
+	g_free(edges->channels);
+	g_free(edges->last);
+	g_free(edges->prev);
+	g_free(edges);
+}
+
+/* Record the bits which differ between the previous and this sample. */
+static int edges_change(uint64_t offset, const uint8_t *value, void *cb_data)
+{
+	struct sr_logic_edges *edges;
+	struct edge_channel *ch;
+	uint64_t pos;
+	unsigned int b, bit, index;
+	uint8_t x;
+
+	edges = cb_data;
+	if (!edges->primed) {
+		/* The first sample is no edge, it sets the levels. */
+		for (index = 0; index < edges->num_channels; index++) {
+			b = index / 8;
+			edges->channels[index].level = b < edges->unitsize
+				&& (value[b] >> (index % 8)) & 1;
+		}
+		memcpy(edges->prev, value, edges->unitsize);
+		edges->primed = TRUE;
+		return SR_OK;
+	}
+	pos = edges->offset + offset;
+	for (b = 0; b < edges->unitsize && b * 8 < edges->num_channels; b++) {
+		x = edges->prev[b] ^ value[b];
+		while (x) {
+			bit = __builtin_ctz(x);
+			x &= x - 1;
+			index = b * 8 + bit;
+			if (index >= edges->num_channels)
+				break;
+			ch = &edges->channels[index];
+			ch->level = !ch->level;
+			if (!ch->positions->len)
+				ch->first_rising = ch->level;
+			g_array_append_val(ch->positions, pos);
+		}
+	}
+	memcpy(edges->prev, value, edges->unitsize);
+
+	return SR_OK;
+}
+
+/**
+ * Collect the edges in a logic packet.
+ *
+ * Packets of a stream need to be fed in order. The first sample of the
+ * stream sets the channels' initial levels.
+ *
+ * @param[in] edges The collector.
+ * @param[in] packet A packet of type SR_DF_LOGIC or SR_DF_LOGIC_RLE.
+ *                   The unit size must not change within the stream.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_edges_feed(struct sr_logic_edges *edges,
+		const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
+	uint64_t samples;
+	uint16_t unitsize;
+	gboolean initial;
+	int ret;
+
+	if (!edges || !packet || !packet->payload)
+		return SR_ERR_ARG;
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		unitsize = logic->unitsize;
+		samples = unitsize ? logic->length / unitsize : 0;
+	} else if (packet->type == SR_DF_LOGIC_RLE) {
+		rle = packet->payload;
+		unitsize = rle->unitsize;
+		samples = rle->num_samples;
+	} else {
+		return SR_ERR_ARG;
+	}
+	if (!unitsize || (edges->unitsize && unitsize != edges->unitsize))
+		return SR_ERR_ARG;
+	if (!samples)
+		return SR_OK;
+
+	initial = !edges->unitsize;
+	if (initial) {
+		edges->unitsize = unitsize;
+		edges->last = g_malloc0(unitsize);
+		edges->prev = g_malloc0(unitsize);
+	}
+	ret = sr_logic_changes_foreach(packet, edges->last, initial,
+		edges_change, edges);
+	if (ret != SR_OK)
+		return ret;
+	edges->offset += samples;
+
+	return SR_OK;
+}
+
+/**
+ * Get the edges of a channel.
+ *
+ * @param[in] edges The collector.
+ * @param[in] channel The channel's bit position in the samples.
+ * @param[out] positions Receives the sample numbers of the edges, in
+ *                       increasing order. Valid until the collector
+ *                       gets fed, cleared or freed.
+ * @param[out] count Receives the number of edges.
+ * @param[out] first_rising Receives whether the first edge is a rising
+ *                          one, after which the directions alternate.
+ *                          May be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_edges_get(const struct sr_logic_edges *edges,
+		unsigned int channel, const uint64_t **positions, size_t *count,
+		gboolean *first_rising)
+{
+	const struct edge_channel *ch;
+
+	if (!edges || channel >= edges->num_channels || !positions || !count)
+		return SR_ERR_ARG;
+
+	ch = &edges->channels[channel];
+	*positions = (const uint64_t *)ch->positions->data;
+	*count = ch->positions->len;
+	if (first_rising)
+		*first_rising = ch->first_rising;
+
+	return SR_OK;
+}
+
+/**
+ * Drop the collected edges, except for the most recent ones.
+ *
+ * Keeping two edges of each channel lets sr_logic_edges_timing() count
+ * the periods which span the point of clearing.
+ *
+ * @param[in] edges The collector.
+ * @param[in] keep The number of edges to keep per channel.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_edges_clear(struct sr_logic_edges *edges, size_t keep)
+{
+	struct edge_channel *ch;
+	unsigned int i;
+	size_t drop;
+
+	if (!edges)
+		return SR_ERR_ARG;
+
+	for (i = 0; i < edges->num_channels; i++) {
+		ch = &edges->channels[i];
+		if (ch->positions->len <= keep)
+			continue;
+		drop = ch->positions->len - keep;
+		g_array_remove_range(ch->positions, 0, drop);
+		if (drop % 2)
+			ch->first_rising = !ch->first_rising;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Get the pulse timing of a channel from its collected edges.
+ *
+ * A period runs from a rising edge to the next one, its high time to the
+ * falling edge in between. Only complete periods count.
+ *
+ * @param[in] edges The collector.
+ * @param[in] channel The channel's bit position in the samples.
+ * @param[out] timing Receives the timing, in samples.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA No complete period was collected.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_edges_timing(const struct sr_logic_edges *edges,
+		unsigned int channel, struct sr_logic_timing *timing)
+{
+	const uint64_t *pos;
+	size_t count, i;
+	gboolean rising;
+	uint64_t period, high, sum_period, sum_high;
+	int ret;
+
+	if (!timing)
+		return SR_ERR_ARG;
+	ret = sr_logic_edges_get(edges, channel, &pos, &count, &rising);
+	if (ret != SR_OK)
+		return ret;
+
+	memset(timing, 0, sizeof(*timing));
+	timing->edges = count;
+	/* Start at the first rising edge, a period takes two more edges. */
+	i = rising ? 0 : 1;
+	sum_period = sum_high = 0;
+	for (; i + 2 < count; i += 2) {
+		period = pos[i + 2] - pos[i];
+		high = pos[i + 1] - pos[i];
+		if (!timing->periods || period < timing->period_min)
+			timing->period_min = period;
+		if (period > timing->period_max)
+			timing->period_max = period;
+		sum_period += period;
+		sum_high += high;
+		timing->periods++;
+	}
+	if (!timing->periods)
+		return SR_ERR_NA;
+
+	timing->period = (double)sum_period / timing->periods;
+	timing->high = (double)sum_high / timing->periods;
+	timing->duty_cycle = (double)sum_high / sum_period;
+
+	return SR_OK;
+}
+
+/** @} */
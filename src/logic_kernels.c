@@ -0,0 +1,340 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Common operations on logic sample data, specialized for the unitsizes
+ * which devices actually use. Each routine picks the kernel for the
+ * unitsize once per call, the kernels for 1, 2, 4 and 8 byte samples
+ * then work on native words. Other unitsizes take a generic byte wise
+ * path.
+ *
+ * Samples get loaded with memcpy(), in host byte order. Masks and
+ * values are passed in the byte layout of the sample data, and get
+ * loaded the same way, so bit N is channel N in either byte order.
+ *
+ * Searches check blocks of samples without an early exit, which
+ * compilers turn into vector code, and only look at the samples of the
+ * block which has a hit one by one.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "logic-kernels"
+/** @endcond */
+
+#if !defined(WORDS_BIGENDIAN) && defined(__GNUC__) && defined(__x86_64__)
+#define LOGIC_SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#define LOGIC_BLOCK 16
+
+#define DEFINE_LOGIC_KERNELS(bits) \
+static inline uint##bits##_t load##bits(const uint8_t *p) \
+{ \
+	uint##bits##_t w; \
+\
+	memcpy(&w, p, sizeof(w)); \
+\
+	return w; \
+} \
+\
+static uint64_t find_match##bits(const uint8_t *data, uint64_t from, \
+		uint64_t count, const uint8_t *mask_bytes, \
+		const uint8_t *value_bytes) \
+{ \
+	uint##bits##_t mask, value; \
+	uint64_t i, k; \
+	int hit; \
+\
+	mask = load##bits(mask_bytes); \
+	value = load##bits(value_bytes) & mask; \
+	for (i = from; i + LOGIC_BLOCK <= count; i += LOGIC_BLOCK) { \
+		hit = 0; \
+		for (k = 0; k < LOGIC_BLOCK; k++) \
+			hit |= (load##bits(data + (i + k) * (bits / 8)) \
+				& mask) == value; \
+		if (hit) \
+			break; \
+	} \
+	for (; i < count; i++) { \
+		if ((load##bits(data + i * (bits / 8)) & mask) == value) \
+			return i; \
+	} \
+\
+	return count; \
+} \
+\
+static uint64_t next_change##bits(const uint8_t *data, uint64_t from, \
+		uint64_t count, const uint8_t *mask_bytes) \
+{ \
+	uint##bits##_t mask; \
+	uint64_t i, k; \
+	int hit; \
+\
+	mask = load##bits(mask_bytes); \
+	for (i = from + 1; i + LOGIC_BLOCK <= count; i += LOGIC_BLOCK) { \
+		hit = 0; \
+		for (k = 0; k < LOGIC_BLOCK; k++) \
+			hit |= ((load##bits(data + (i + k) * (bits / 8)) \
+				^ load##bits(data + (i + k - 1) * (bits / 8))) \
+				& mask) != 0; \
+		if (hit) \
+			break; \
+	} \
+	for (; i < count; i++) { \
+		if ((load##bits(data + i * (bits / 8)) \
+				^ load##bits(data + (i - 1) * (bits / 8))) & mask) \
+			return i; \
+	} \
+\
+	return count; \
+} \
+\
+static void channel_extract##bits(const uint8_t *data, uint64_t count, \
+		unsigned int index, uint8_t *out, size_t stride) \
+{ \
+	uint64_t i; \
+	uint8_t mask_bytes[bits / 8]; \
+	uint##bits##_t mask; \
+\
+	memset(mask_bytes, 0, sizeof(mask_bytes)); \
+	mask_bytes[index / 8] = 1 << (index % 8); \
+	mask = load##bits(mask_bytes); \
+	for (i = 0; i < count; i++) \
+		out[i * stride] = (load##bits(data + i * (bits / 8)) & mask) != 0; \
+}
+
+DEFINE_LOGIC_KERNELS(8)
+DEFINE_LOGIC_KERNELS(16)
+DEFINE_LOGIC_KERNELS(32)
+DEFINE_LOGIC_KERNELS(64)
+
+/**
+ * Find the first sample which matches a value in the masked bits.
+ *
+ * @param[in] data The sample data.
+ * @param[in] unitsize The number of bytes per sample, non-zero.
+ * @param[in] from The first sample to check.
+ * @param[in] count The number of samples in data.
+ * @param[in] mask The unitsize bytes of the bits to compare.
+ * @param[in] value The unitsize bytes of the expected bit values.
+ *
+ * @return The number of the first matching sample, or count if none.
+ */
+SR_PRIV uint64_t sr_logic_find_match(const uint8_t *data, size_t unitsize,
+		uint64_t from, uint64_t count,
+		const uint8_t *mask, const uint8_t *value)
+{
+	uint64_t i;
+	size_t b;
+
+	switch (unitsize) {
+	case 1:
+		return find_match8(data, from, count, mask, value);
+	case 2:
+		return find_match16(data, from, count, mask, value);
+	case 4:
+		return find_match32(data, from, count, mask, value);
+	case 8:
+		return find_match64(data, from, count, mask, value);
+	}
+
+	for (i = from; i < count; i++) {
+		for (b = 0; b < unitsize; b++) {
+			if ((data[i * unitsize + b] ^ value[b]) & mask[b])
+				break;
+		}
+		if (b == unitsize)
+			return i;
+	}
+
+	return count;
+}
+
+/*
+ * Compare the sample data against itself shifted by one unitsize. Long
+ * unchanged runs get skipped in wide chunks, regardless of the unitsize.
+ */
+static uint64_t next_change_any(const uint8_t *data, size_t unitsize,
+		uint64_t from, uint64_t count)
+{
+	const uint8_t *p, *q;
+	size_t pos, end;
+	uint64_t w1, w2;
+
+	pos = from * unitsize;
+	end = (count - 1) * unitsize;
+	p = data;
+	q = data + unitsize;
+
+#ifdef LOGIC_SIMD_SSE2
+	while (pos + 16 <= end) {
+		__m128i a, b;
+		int mask;
+
+		a = _mm_loadu_si128((const __m128i *)(p + pos));
+		b = _mm_loadu_si128((const __m128i *)(q + pos));
+		mask = _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) ^ 0xffff;
+		if (mask) {
+			pos += __builtin_ctz(mask);
+			return pos / unitsize + 1;
+		}
+		pos += 16;
+	}
+#endif
+
+	while (pos + sizeof(w1) <= end) {
+		memcpy(&w1, p + pos, sizeof(w1));
+		memcpy(&w2, q + pos, sizeof(w2));
+		if (w1 != w2)
+			break;
+		pos += sizeof(w1);
+	}
+	while (pos < end && p[pos] == q[pos])
+		pos++;
+	if (pos >= end)
+		return count;
+
+	return pos / unitsize + 1;
+}
+
+/**
+ * Find the first sample after "from" which differs from its predecessor
+ * in the masked bits. The distance to it is the length of the run of
+ * samples which starts at "from".
+ *
+ * @param[in] data The sample data.
+ * @param[in] unitsize The number of bytes per sample, non-zero.
+ * @param[in] from The sample to start at.
+ * @param[in] count The number of samples in data.
+ * @param[in] mask The unitsize bytes of the bits to watch, or NULL for
+ *                 all bits.
+ *
+ * @return The number of the first changed sample, or count if none.
+ */
+SR_PRIV uint64_t sr_logic_next_change(const uint8_t *data, size_t unitsize,
+		uint64_t from, uint64_t count, const uint8_t *mask)
+{
+	uint64_t i;
+	size_t b;
+
+	if (from + 1 >= count)
+		return count;
+	if (!mask)
+		return next_change_any(data, unitsize, from, count);
+
+	switch (unitsize) {
+	case 1:
+		return next_change8(data, from, count, mask);
+	case 2:
+		return next_change16(data, from, count, mask);
+	case 4:
+		return next_change32(data, from, count, mask);
+	case 8:
+		return next_change64(data, from, count, mask);
+	}
+
+	for (i = from + 1; i < count; i++) {
+		for (b = 0; b < unitsize; b++) {
+			if ((data[i * unitsize + b] ^ data[(i - 1) * unitsize + b])
+					& mask[b])
+				return i;
+		}
+	}
+
+	return count;
+}
+
+/**
+ * Extract the bits of one channel, one byte per sample.
+ *
+ * @param[in] data The sample data.
+ * @param[in] unitsize The number of bytes per sample, non-zero.
+ * @param[in] count The number of samples in data.
+ * @param[in] index The bit position of the channel, below 8 * unitsize.
+ * @param[out] out Receives 0 or 1 for each sample.
+ * @param[in] stride The distance between the bytes in out.
+ */
+SR_PRIV void sr_logic_channel_extract(const uint8_t *data, size_t unitsize,
+		uint64_t count, unsigned int index, uint8_t *out, size_t stride)
+{
+	uint64_t i;
+	uint8_t bit;
+
+	switch (unitsize) {
+	case 1:
+		channel_extract8(data, count, index, out, stride);
+		return;
+	case 2:
+		channel_extract16(data, count, index, out, stride);
+		return;
+	case 4:
+		channel_extract32(data, count, index, out, stride);
+		return;
+	case 8:
+		channel_extract64(data, count, index, out, stride);
+		return;
+	}
+
+	data += index / 8;
+	bit = 1 << (index % 8);
+	for (i = 0; i < count; i++)
+		out[i * stride] = (data[i * unitsize] & bit) != 0;
+}
+
+/**
+ * Copy one byte out of every group of stride bytes, e.g. the logic half
+ * of logic/analog byte pairs.
+ *
+ * @param[in] data The interleaved data, count * stride bytes.
+ * @param[in] stride The distance between the bytes to copy, non-zero.
+ * @param[in] count The number of bytes to copy.
+ * @param[out] out Receives count bytes.
+ */
+SR_PRIV void sr_logic_bytes_extract(const uint8_t *data, size_t stride,
+		uint64_t count, uint8_t *out)
+{
+	uint64_t i;
+
+	i = 0;
+#ifdef LOGIC_SIMD_SSE2
+	if (stride == 2) {
+		const __m128i low = _mm_set1_epi16(0x00ff);
+
+		/* Keep the low byte of each pair, then pack 32 into 16. */
+		for (; i + 16 <= count; i += 16) {
+			__m128i a, b;
+
+			a = _mm_loadu_si128((const __m128i *)(data + i * 2));
+			b = _mm_loadu_si128((const __m128i *)(data + i * 2 + 16));
+			a = _mm_and_si128(a, low);
+			b = _mm_and_si128(b, low);
+			_mm_storeu_si128((__m128i *)(out + i),
+				_mm_packus_epi16(a, b));
+		}
+	}
+#endif
+	for (; i < count; i++)
+		out[i] = data[i * stride];
+}
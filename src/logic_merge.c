@@ -0,0 +1,565 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Merging the logic data of several devices of a session.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "logic-merge"
+/** @endcond */
+
+/**
+ * @defgroup grp_logic_merge Logic merge
+ *
+ * Combine the logic data of several devices into one stream.
+ *
+ * Capturing a bus which is wider than one device can take works by
+ * adding several devices to one session, with sr_session_dev_add().
+ * The devices run alongside each other, each with its own sources in
+ * the session's main loop. A logic merge collects the logic data of all
+ * the session's devices, aligns it by sample index, and passes on one
+ * stream of logic data, with one sample holding the samples of all the
+ * devices. The channels of the merged stream belong to a device
+ * instance of the merge, see sr_logic_merge_dev_inst_get().
+ *
+ * Sample index alignment takes that the devices sample at the same
+ * rate, and that their captures share a timebase, i.e. that they run
+ * off a common external clock, or start on a common external trigger.
+ * Alternatively, the captures get aligned on the position of the first
+ * trigger of each device.
+ *
+ * The datafeed callbacks of a session are not thread-safe, enable the
+ * threaded session mode (see sr_session_threaded_set()) to move the
+ * merge, and the processing of the merged stream, out of the thread
+ * which runs the devices.
+ *
+ * @{
+ */
+
+/** @cond PRIVATE */
+/* Merged samples passed on per packet. */
+#define CHUNK_SAMPLES (64 * 1024)
+/* Pending data of one device, beyond which the devices are out of sync. */
+#define MAX_BACKLOG (64 * 1024 * 1024)
+
+struct merge_input {
+	const struct sr_dev_inst *sdi;
+	/* Position and size of the device's samples in merged samples. */
+	size_t offset;
+	uint16_t unitsize;
+	/* Unit size of the device's logic packets. */
+	uint16_t dev_unitsize;
+	/* Samples received, but not yet merged. */
+	GByteArray *pending;
+	uint64_t received;
+	int64_t trigger;
+	uint64_t skip;
+	uint64_t samplerate;
+	gboolean ended;
+};
+
+struct sr_logic_merge {
+	enum sr_logic_merge_align align;
+	GPtrArray *inputs;
+	struct sr_dev_inst *sdi;
+	uint16_t unitsize;
+	sr_datafeed_callback cb;
+	void *cb_data;
+	/* State of the current acquisition. */
+	gboolean running;
+	gboolean aligned;
+	gboolean failed;
+	gboolean meta_sent;
+	int64_t trigger;
+	uint64_t merged;
+	uint8_t *out;
+	uint8_t *rle_buf;
+	size_t rle_buf_size;
+};
+/** @endcond */
+
+static void merge_send(struct sr_logic_merge *merge, int type,
+		const void *payload)
+{
+	struct sr_datafeed_packet packet;
+
+	packet.type = type;
+	packet.payload = payload;
+	merge->cb(merge->sdi, &packet, merge->cb_data);
+}
+
+static struct merge_input *input_find(struct sr_logic_merge *merge,
+		const struct sr_dev_inst *sdi)
+{
+	struct merge_input *in;
+	guint i;
+
+	for (i = 0; i < merge->inputs->len; i++) {
+		in = g_ptr_array_index(merge->inputs, i);
+		if (in->sdi == sdi)
+			return in;
+	}
+
+	return NULL;
+}
+
+static void input_free(struct merge_input *in)
+{
+	g_byte_array_free(in->pending, TRUE);
+	g_free(in);
+}
+
+static void merge_reset(struct sr_logic_merge *merge)
+{
+	struct merge_input *in;
+	guint i;
+
+	for (i = 0; i < merge->inputs->len; i++) {
+		in = g_ptr_array_index(merge->inputs, i);
+		g_byte_array_set_size(in->pending, 0);
+		in->dev_unitsize = 0;
+		in->received = 0;
+		in->trigger = -1;
+		in->skip = 0;
+		in->samplerate = 0;
+		in->ended = FALSE;
+	}
+	merge->aligned = FALSE;
+	merge->failed = FALSE;
+	merge->meta_sent = FALSE;
+	merge->trigger = -1;
+	merge->merged = 0;
+}
+
+static size_t input_samples(const struct merge_input *in)
+{
+	return in->dev_unitsize ? in->pending->len / in->dev_unitsize : 0;
+}
+
+/* Work out how many leading samples to drop from each device. */
+static void merge_align(struct sr_logic_merge *merge)
+{
+	struct merge_input *in;
+	int64_t first;
+	guint i;
+
+	first = -1;
+	for (i = 0; i < merge->inputs->len; i++) {
+		in = g_ptr_array_index(merge->inputs, i);
+		if (merge->align == SR_LOGIC_MERGE_ALIGN_TRIGGER) {
+			if (in->trigger < 0 && !in->ended)
+				return;
+			if (in->trigger >= 0 && (first < 0 || in->trigger < first))
+				first = in->trigger;
+		}
+	}
+
+	for (i = 0; i < merge->inputs->len; i++) {
+		in = g_ptr_array_index(merge->inputs, i);
+		if (first >= 0 && in->trigger >= 0)
+			in->skip = in->trigger - first;
+	}
+	merge->trigger = first;
+	merge->aligned = TRUE;
+	if (merge->align == SR_LOGIC_MERGE_ALIGN_TRIGGER && first < 0)
+		sr_warn("No device triggered, aligning on the first sample.");
+}
+
+static void merge_chunk(struct sr_logic_merge *merge, size_t count)
+{
+	struct sr_datafeed_logic logic;
+	struct merge_input *in;
+	const uint8_t *src;
+	uint8_t *dst;
+	size_t copy, n;
+	guint i;
+
+	for (i = 0; i < merge->inputs->len; i++) {
+		in = g_ptr_array_index(merge->inputs, i);
+		copy = MIN(in->unitsize, in->dev_unitsize);
+		src = in->pending->data;
+		dst = merge->out + in->offset;
+		for (n = 0; n < count; n++) {
+			memcpy(dst, src, copy);
+			if (copy < in->unitsize)
+				memset(dst + copy, 0, in->unitsize - copy);
+			src += in->dev_unitsize;
+			dst += merge->unitsize;
+		}
+		g_byte_array_remove_range(in->pending, 0,
+			count * in->dev_unitsize);
+	}
+
+	logic.length = count * merge->unitsize;
+	logic.unitsize = merge->unitsize;
+	logic.data = merge->out;
+	merge_send(merge, SR_DF_LOGIC, &logic);
+	merge->merged += count;
+}
+
+/* Pass on the samples which all devices delivered. */
+static void merge_run(struct sr_logic_merge *merge)
+{
+	struct merge_input *in;
+	size_t count, drop, n;
+	guint i;
+
+	if (!merge->aligned)
+		merge_align(merge);
+	if (!merge->aligned)
+		return;
+
+	count = SIZE_MAX;
+	for (i = 0; i < merge->inputs->len; i++) {
+		in = g_ptr_array_index(merge->inputs, i);
+		if (in->skip) {
+			drop = MIN(in->skip, input_samples(in));
+			g_byte_array_remove_range(in->pending, 0,
+				drop * in->dev_unitsize);
+			in->skip -= drop;
+		}
+		count = MIN(count, in->skip ? 0 : input_samples(in));
+	}
+
+	while (count) {
+		if (merge->trigger >= 0 && merge->merged <= (uint64_t)merge->trigger
+				&& merge->merged + count > (uint64_t)merge->trigger) {
+			if (merge->merged == (uint64_t)merge->trigger) {
+				merge_send(merge, SR_DF_TRIGGER, NULL);
+				merge->trigger = -1;
+				continue;
+			}
+			n = merge->trigger - merge->merged;
+		} else {
+			n = count;
+		}
+		n = MIN(n, CHUNK_SAMPLES);
+		merge_chunk(merge, n);
+		count -= n;
+	}
+}
+
+static int input_logic(struct sr_logic_merge *merge, struct merge_input *in,
+		const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
+	const void *data;
+	uint64_t length;
+	uint16_t unitsize;
+	size_t size;
+
+	if (packet->type == SR_DF_LOGIC_RLE) {
+		rle = packet->payload;
+		unitsize = rle->unitsize;
+		length = rle->num_samples * unitsize;
+		size = length;
+		if (size > merge->rle_buf_size) {
+			merge->rle_buf = g_realloc(merge->rle_buf, size);
+			merge->rle_buf_size = size;
+		}
+		if (sr_logic_rle_expand(rle, merge->rle_buf) != SR_OK)
+			return SR_ERR_DATA;
+		data = merge->rle_buf;
+	} else {
+		logic = packet->payload;
+		unitsize = logic->unitsize;
+		length = logic->length;
+		data = logic->data;
+	}
+	if (!unitsize)
+		return SR_ERR_DATA;
+
+	if (!in->dev_unitsize) {
+		in->dev_unitsize = unitsize;
+		if (unitsize < in->unitsize)
+			sr_dbg("%s sends %d bytes per sample, expected %d.",
+				in->sdi->model ? in->sdi->model : "Device",
+				unitsize, in->unitsize);
+	} else if (unitsize != in->dev_unitsize) {
+		sr_err("Unit size of a device changed from %d to %d.",
+			in->dev_unitsize, unitsize);
+		return SR_ERR_DATA;
+	}
+
+	if (in->pending->len + length > MAX_BACKLOG) {
+		sr_err("Devices are out of sync, more than %d MiB pending.",
+			MAX_BACKLOG / (1024 * 1024));
+		return SR_ERR_DATA;
+	}
+	g_byte_array_append(in->pending, data, length);
+	in->received += length / unitsize;
+
+	return SR_OK;
+}
+
+static void input_meta(struct sr_logic_merge *merge, struct merge_input *in,
+		const struct sr_datafeed_meta *meta)
+{
+	struct sr_datafeed_meta out;
+	struct sr_config *src, cfg;
+	struct merge_input *other;
+	GSList *l;
+	guint i;
+
+	for (l = meta->config; l; l = l->next) {
+		src = l->data;
+		if (src->key != SR_CONF_SAMPLERATE)
+			continue;
+		in->samplerate = g_variant_get_uint64(src->data);
+		for (i = 0; i < merge->inputs->len; i++) {
+			other = g_ptr_array_index(merge->inputs, i);
+			if (other->samplerate && other->samplerate != in->samplerate)
+				sr_warn("Devices sample at different rates, "
+					"%" PRIu64 " and %" PRIu64 ".",
+					other->samplerate, in->samplerate);
+		}
+		if (merge->meta_sent)
+			continue;
+		cfg.key = SR_CONF_SAMPLERATE;
+		cfg.data = src->data;
+		out.config = g_slist_append(NULL, &cfg);
+		merge_send(merge, SR_DF_META, &out);
+		g_slist_free(out.config);
+		merge->meta_sent = TRUE;
+	}
+}
+
+static void merge_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct sr_logic_merge *merge;
+	struct merge_input *in;
+	guint i;
+
+	merge = cb_data;
+	if (!(in = input_find(merge, sdi)))
+		return;
+
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		if (!merge->running) {
+			merge_reset(merge);
+			merge->running = TRUE;
+			merge_send(merge, SR_DF_HEADER, packet->payload);
+		}
+		break;
+	case SR_DF_META:
+		if (merge->running)
+			input_meta(merge, in, packet->payload);
+		break;
+	case SR_DF_LOGIC:
+	case SR_DF_LOGIC_RLE:
+		if (!merge->running || merge->failed || in->ended)
+			break;
+		if (input_logic(merge, in, packet) != SR_OK) {
+			merge->failed = TRUE;
+			break;
+		}
+		merge_run(merge);
+		break;
+	case SR_DF_TRIGGER:
+		if (merge->running && in->trigger < 0) {
+			in->trigger = in->received;
+			if (!merge->failed)
+				merge_run(merge);
+		}
+		break;
+	case SR_DF_END:
+		if (!merge->running)
+			break;
+		in->ended = TRUE;
+		for (i = 0; i < merge->inputs->len; i++) {
+			in = g_ptr_array_index(merge->inputs, i);
+			if (!in->ended)
+				break;
+		}
+		if (!merge->failed)
+			merge_run(merge);
+		if (i == merge->inputs->len) {
+			merge_send(merge, SR_DF_END, NULL);
+			merge->running = FALSE;
+		}
+		break;
+	}
+}
+
+/**
+ * Create a logic merge.
+ *
+ * @param[out] merge Pointer where to store the new logic merge.
+ * @param[in] align How to align the captures of the devices.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_merge_new(struct sr_logic_merge **merge,
+		enum sr_logic_merge_align align)
+{
+	struct sr_logic_merge *m;
+
+	if (!merge || (align != SR_LOGIC_MERGE_ALIGN_START
+			&& align != SR_LOGIC_MERGE_ALIGN_TRIGGER))
+		return SR_ERR_ARG;
+
+	m = g_malloc0(sizeof(*m));
+	m->align = align;
+	m->inputs = g_ptr_array_new_with_free_func((GDestroyNotify)input_free);
+	*merge = m;
+
+	return SR_OK;
+}
+
+/**
+ * Merge the logic data of the devices of a session.
+ *
+ * The merge takes the devices which the session holds at this time,
+ * and which have logic channels. Merged samples hold the samples of
+ * the devices in the order of the session's device list.
+ *
+ * @param[in] merge The logic merge.
+ * @param[in] session The session.
+ * @param[in] cb The callback to receive the merged datafeed.
+ * @param[in] cb_data Opaque pointer passed to the callback.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or the session holds no device
+ *                    with logic channels.
+ * @retval SR_ERR_NA The merge was attached already.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_merge_attach(struct sr_logic_merge *merge,
+		struct sr_session *session, sr_datafeed_callback cb, void *cb_data)
+{
+	struct merge_input *in;
+	struct sr_channel *ch;
+	GSList *devices, *l, *c;
+	char *name;
+	int num, max_index;
+
+	if (!merge || !session || !cb)
+		return SR_ERR_ARG;
+	if (merge->sdi)
+		return SR_ERR_NA;
+
+	if (sr_session_dev_list(session, &devices) != SR_OK)
+		return SR_ERR_ARG;
+
+	merge->sdi = sr_dev_inst_user_new("sigrok", "Merged logic", NULL);
+	for (l = devices, num = 0; l; l = l->next, num++) {
+		max_index = -1;
+		for (c = ((struct sr_dev_inst *)l->data)->channels; c; c = c->next) {
+			ch = c->data;
+			if (ch->type == SR_CHANNEL_LOGIC)
+				max_index = MAX(max_index, ch->index);
+		}
+		if (max_index < 0)
+			continue;
+
+		in = g_malloc0(sizeof(*in));
+		in->sdi = l->data;
+		in->offset = merge->unitsize;
+		in->unitsize = (max_index + 8) / 8;
+		in->pending = g_byte_array_new();
+		in->trigger = -1;
+		g_ptr_array_add(merge->inputs, in);
+
+		for (c = in->sdi->channels; c; c = c->next) {
+			ch = c->data;
+			if (ch->type != SR_CHANNEL_LOGIC)
+				continue;
+			name = g_strdup_printf("%d:%s", num, ch->name);
+			sr_channel_new(merge->sdi, in->offset * 8 + ch->index,
+				SR_CHANNEL_LOGIC, ch->enabled, name);
+			g_free(name);
+		}
+		merge->unitsize += in->unitsize;
+	}
+	g_slist_free(devices);
+
+	if (!merge->inputs->len) {
+		sr_err("No device with logic channels to merge.");
+		sr_dev_inst_free(merge->sdi);
+		merge->sdi = NULL;
+		return SR_ERR_ARG;
+	}
+	sr_info("Merging %u devices into %d bytes per sample.",
+		merge->inputs->len, merge->unitsize);
+
+	merge->out = g_malloc((size_t)CHUNK_SAMPLES * merge->unitsize);
+	merge->cb = cb;
+	merge->cb_data = cb_data;
+
+	return sr_session_datafeed_callback_add(session, merge_datafeed, merge);
+}
+
+/**
+ * Get the device instance which the merged datafeed originates from.
+ *
+ * The device holds the logic channels of all merged devices. The
+ * channels of the n-th device get named "<n>:<name>", and their index
+ * is their bit position in merged samples.
+ *
+ * @param[in] merge The logic merge, attached to a session.
+ *
+ * @return The device instance, or NULL. Owned by the logic merge.
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_dev_inst *sr_logic_merge_dev_inst_get(
+		struct sr_logic_merge *merge)
+{
+	return merge ? merge->sdi : NULL;
+}
+
+/**
+ * Destroy a logic merge.
+ *
+ * The session which the merge is attached to must not run, and must
+ * have its datafeed callbacks removed.
+ *
+ * @param[in] merge The logic merge to destroy. May be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_logic_merge_free(struct sr_logic_merge *merge)
+{
+	if (!merge)
+		return;
+
+	g_ptr_array_free(merge->inputs, TRUE);
+	if (merge->sdi)
+		sr_dev_inst_free(merge->sdi);
+	g_free(merge->out);
+	g_free(merge->rle_buf);
+	g_free(merge);
+}
+
+/** @} */
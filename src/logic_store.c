@@ -0,0 +1,585 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Compressed in-memory storage of logic data.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "logic-store"
+/** @endcond */
+
+/**
+ * @defgroup grp_logic_store Logic store
+ *
+ * Hold captured logic data compressed in memory, with random access.
+ *
+ * A logic store accepts logic data in chunks of any size, and keeps it
+ * in blocks of a fixed number of samples. Each completed block gets
+ * compressed on its own, as a list of runs of identical samples when
+ * the lines change rarely, else with the bundled LZO compressor. Any
+ * range of samples can be read back at any time, which decompresses
+ * the blocks which the range touches only.
+ *
+ * Applications which keep the data of long captures (e.g. to display
+ * it) can use a store to hold it in a fraction of the memory which the
+ * expanded samples would take.
+ *
+ * @{
+ */
+
+/** @cond PRIVATE */
+/* Number of samples per compressed block. */
+#define BLOCK_SAMPLES (64 * 1024)
+
+/* Bookkeeping overhead accounted for every block. */
+#define BLOCK_OVERHEAD sizeof(struct store_block)
+
+enum block_method {
+	BLOCK_RAW,
+	BLOCK_RUNS,
+	BLOCK_LZO,
+};
+
+/*
+ * A completed block. Runs are stored as the sample value, followed by
+ * the 32bit little endian number of samples in the run.
+ */
+struct store_block {
+	uint8_t *data;
+	uint32_t size;
+	enum block_method method;
+};
+
+struct sr_logic_store {
+	GMutex mutex;
+	uint16_t unitsize;
+	uint64_t num_samples;
+	uint64_t size;
+	GArray *blocks;
+	/* Samples of the incomplete last block. */
+	uint8_t *tail;
+	size_t tail_samples;
+	/* The most recently decompressed block. */
+	uint8_t *cache;
+	size_t cache_index;
+	gboolean cache_valid;
+	/* Compressor, and its output. */
+	struct sr_lzo *lzo;
+	GByteArray *lzo_out;
+	/* Expanded run-length encoded logic data. */
+	uint8_t *rle_buf;
+	size_t rle_buf_size;
+};
+/** @endcond */
+
+static size_t block_bytes(const struct sr_logic_store *store)
+{
+	return (size_t)BLOCK_SAMPLES * store->unitsize;
+}
+
+/* Count the runs of identical samples in a block. */
+static size_t count_runs(const uint8_t *data, size_t unitsize, size_t count)
+{
+	size_t runs, i;
+
+	runs = 1;
+	for (i = 1; i < count; i++, data += unitsize) {
+		if (memcmp(data, data + unitsize, unitsize) != 0)
+			runs++;
+	}
+
+	return runs;
+}
+
+static void encode_runs(const uint8_t *data, size_t unitsize, size_t count,
+		uint8_t *out)
+{
+	const uint8_t *value;
+	uint32_t run;
+	size_t i;
+
+	value = data;
+	run = 1;
+	for (i = 1; i <= count; i++) {
+		data += unitsize;
+		if (i < count && memcmp(value, data, unitsize) == 0) {
+			run++;
+			continue;
+		}
+		memcpy(out, value, unitsize);
+		WL32(out + unitsize, run);
+		out += unitsize + sizeof(uint32_t);
+		value = data;
+		run = 1;
+	}
+}
+
+static int decode_runs(const uint8_t *data, size_t size, size_t unitsize,
+		uint8_t *out, size_t count)
+{
+	size_t record, run, i;
+
+	record = unitsize + sizeof(uint32_t);
+	for (; size >= record; size -= record, data += record) {
+		run = RL32(data + unitsize);
+		if (run > count)
+			return SR_ERR_DATA;
+		for (i = 0; i < run; i++, out += unitsize)
+			memcpy(out, data, unitsize);
+		count -= run;
+	}
+
+	return count || size ? SR_ERR_DATA : SR_OK;
+}
+
+/*
+ * Compress the completed tail block. Lines which rarely change keep
+ * their runs, other data gets compressed with LZO. Data which does
+ * not compress is kept as is.
+ */
+static void store_tail(struct sr_logic_store *store)
+{
+	struct store_block block;
+	size_t raw_size, runs_size;
+	const uint8_t *src;
+
+	raw_size = block_bytes(store);
+	runs_size = count_runs(store->tail, store->unitsize, BLOCK_SAMPLES)
+		* (store->unitsize + sizeof(uint32_t));
+
+	block.method = BLOCK_RAW;
+	block.size = raw_size;
+	src = store->tail;
+	if (runs_size < raw_size) {
+		block.method = BLOCK_RUNS;
+		block.size = runs_size;
+	}
+	if (block.size > raw_size / 16 && store->lzo) {
+		g_byte_array_set_size(store->lzo_out, 0);
+		if (sr_lzo_compress(store->lzo, store->tail, raw_size,
+				store->lzo_out) == SR_OK
+				&& store->lzo_out->len < block.size) {
+			block.method = BLOCK_LZO;
+			block.size = store->lzo_out->len;
+			src = store->lzo_out->data;
+		}
+	}
+
+	block.data = g_malloc(block.size);
+	if (block.method == BLOCK_RUNS)
+		encode_runs(store->tail, store->unitsize, BLOCK_SAMPLES,
+			block.data);
+	else
+		memcpy(block.data, src, block.size);
+
+	g_array_append_val(store->blocks, block);
+	store->size += block.size + BLOCK_OVERHEAD;
+	store->tail_samples = 0;
+}
+
+/* Provide the samples of a completed block. */
+static const uint8_t *block_get(struct sr_logic_store *store, size_t index)
+{
+	const struct store_block *block;
+	int ret;
+
+	block = &g_array_index(store->blocks, struct store_block, index);
+	if (block->method == BLOCK_RAW)
+		return block->data;
+	if (store->cache_valid && store->cache_index == index)
+		return store->cache;
+
+	store->cache_valid = FALSE;
+	if (block->method == BLOCK_RUNS) {
+		ret = decode_runs(block->data, block->size, store->unitsize,
+			store->cache, BLOCK_SAMPLES);
+	} else {
+		ret = sr_lzo_decompress(block->data, block->size,
+			store->cache, block_bytes(store));
+	}
+	if (ret != SR_OK) {
+		sr_err("Cannot decompress block %zu.", index);
+		return NULL;
+	}
+	store->cache_index = index;
+	store->cache_valid = TRUE;
+
+	return store->cache;
+}
+
+static void store_setup(struct sr_logic_store *store, uint16_t unitsize)
+{
+	size_t size;
+
+	store->unitsize = unitsize;
+	size = block_bytes(store);
+	store->tail = g_malloc(size);
+	store->cache = g_malloc(size);
+	store->size += 2 * size;
+}
+
+static int store_append(struct sr_logic_store *store, const uint8_t *data,
+		uint64_t count)
+{
+	size_t chunk;
+
+	while (count) {
+		chunk = MIN(count, BLOCK_SAMPLES - store->tail_samples);
+		memcpy(&store->tail[store->tail_samples * store->unitsize],
+			data, chunk * store->unitsize);
+		data += chunk * store->unitsize;
+		count -= chunk;
+		store->tail_samples += chunk;
+		store->num_samples += chunk;
+		if (store->tail_samples == BLOCK_SAMPLES)
+			store_tail(store);
+	}
+
+	return SR_OK;
+}
+
+static int store_append_rle(struct sr_logic_store *store,
+		const struct sr_datafeed_logic_rle *rle)
+{
+	size_t size;
+	int ret;
+
+	size = rle->num_samples * rle->unitsize;
+	if (size > store->rle_buf_size) {
+		g_free(store->rle_buf);
+		store->rle_buf = g_malloc(size);
+		store->rle_buf_size = size;
+	}
+	if ((ret = sr_logic_rle_expand(rle, store->rle_buf)) != SR_OK)
+		return ret;
+
+	return store_append(store, store->rle_buf, rle->num_samples);
+}
+
+static void store_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	(void)sdi;
+
+	if (packet->type != SR_DF_LOGIC && packet->type != SR_DF_LOGIC_RLE)
+		return;
+	if (sr_logic_store_append_packet(cb_data, packet) != SR_OK)
+		sr_warn("Cannot store logic data.");
+}
+
+/**
+ * Create a logic store.
+ *
+ * @param[out] store Pointer where to store the new logic store.
+ * @param[in] unitsize The size of a sample in bytes, or 0 to take the
+ *                     unit size of the first appended data.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_store_new(struct sr_logic_store **store,
+		uint16_t unitsize)
+{
+	struct sr_logic_store *st;
+
+	if (!store)
+		return SR_ERR_ARG;
+
+	st = g_malloc0(sizeof(*st));
+	g_mutex_init(&st->mutex);
+	st->blocks = g_array_new(FALSE, FALSE, sizeof(struct store_block));
+	st->lzo = sr_lzo_new();
+	st->lzo_out = g_byte_array_new();
+	if (unitsize)
+		store_setup(st, unitsize);
+	*store = st;
+
+	return SR_OK;
+}
+
+/**
+ * Destroy a logic store, and all of its data.
+ *
+ * The store must no longer be attached to a session, i.e. the session
+ * was destroyed, or its datafeed callbacks were removed.
+ *
+ * @param[in] store The logic store to destroy. May be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_logic_store_free(struct sr_logic_store *store)
+{
+	guint i;
+
+	if (!store)
+		return;
+
+	for (i = 0; i < store->blocks->len; i++)
+		g_free(g_array_index(store->blocks, struct store_block, i).data);
+	g_array_free(store->blocks, TRUE);
+	g_free(store->tail);
+	g_free(store->cache);
+	sr_lzo_free(store->lzo);
+	g_byte_array_free(store->lzo_out, TRUE);
+	g_free(store->rle_buf);
+	g_mutex_clear(&store->mutex);
+	g_free(store);
+}
+
+/**
+ * Append samples to a logic store.
+ *
+ * @param[in] store The logic store.
+ * @param[in] data The samples to append.
+ * @param[in] length The size of the data in bytes, a multiple of the
+ *                   store's unit size.
+ * @param[in] unitsize The size of a sample in bytes, which must match
+ *                     the store's unit size.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_store_append(struct sr_logic_store *store,
+		const void *data, uint64_t length, uint16_t unitsize)
+{
+	int ret;
+
+	if (!store || (!data && length) || !unitsize || length % unitsize)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&store->mutex);
+	if (!store->unitsize)
+		store_setup(store, unitsize);
+	if (unitsize == store->unitsize)
+		ret = store_append(store, data, length / unitsize);
+	else
+		ret = SR_ERR_ARG;
+	g_mutex_unlock(&store->mutex);
+
+	return ret;
+}
+
+/**
+ * Append the samples of a datafeed packet to a logic store.
+ *
+ * Accepts SR_DF_LOGIC and SR_DF_LOGIC_RLE packets.
+ *
+ * @param[in] store The logic store.
+ * @param[in] packet The packet to append.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or unit size mismatch.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_store_append_packet(struct sr_logic_store *store,
+		const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
+	int ret;
+
+	if (!store || !packet || !packet->payload)
+		return SR_ERR_ARG;
+
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		return sr_logic_store_append(store, logic->data,
+			logic->length, logic->unitsize);
+	}
+	if (packet->type != SR_DF_LOGIC_RLE)
+		return SR_ERR_ARG;
+
+	rle = packet->payload;
+	if (!rle->unitsize)
+		return SR_ERR_ARG;
+	g_mutex_lock(&store->mutex);
+	if (!store->unitsize)
+		store_setup(store, rle->unitsize);
+	if (rle->unitsize == store->unitsize)
+		ret = store_append_rle(store, rle);
+	else
+		ret = SR_ERR_ARG;
+	g_mutex_unlock(&store->mutex);
+
+	return ret;
+}
+
+/**
+ * Store the logic data of a session.
+ *
+ * @param[in] store The logic store.
+ * @param[in] session The session whose logic data to store.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_store_attach(struct sr_logic_store *store,
+		struct sr_session *session)
+{
+	if (!store)
+		return SR_ERR_ARG;
+
+	return sr_session_datafeed_callback_add(session, store_datafeed, store);
+}
+
+/**
+ * Read a range of samples from a logic store.
+ *
+ * Samples can be read while more data gets appended.
+ *
+ * @param[in] store The logic store.
+ * @param[in] start The index of the first sample to read.
+ * @param[in] count The number of samples to read.
+ * @param[out] buf The buffer to receive the samples, with room for
+ *                 count times the unit size bytes.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or range exceeds the stored data.
+ * @retval SR_ERR_DATA Stored data is corrupted.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_store_read(struct sr_logic_store *store,
+		uint64_t start, uint64_t count, void *buf)
+{
+	const uint8_t *block;
+	uint8_t *out;
+	uint64_t index;
+	size_t offset, chunk;
+	int ret;
+
+	if (!store || (!buf && count))
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&store->mutex);
+	if (start > store->num_samples || count > store->num_samples - start) {
+		g_mutex_unlock(&store->mutex);
+		return SR_ERR_ARG;
+	}
+
+	out = buf;
+	ret = SR_OK;
+	while (count) {
+		index = start / BLOCK_SAMPLES;
+		offset = start % BLOCK_SAMPLES;
+		chunk = MIN(count, BLOCK_SAMPLES - offset);
+		if (index < store->blocks->len)
+			block = block_get(store, index);
+		else
+			block = store->tail;
+		if (!block) {
+			ret = SR_ERR_DATA;
+			break;
+		}
+		memcpy(out, &block[offset * store->unitsize],
+			chunk * store->unitsize);
+		out += chunk * store->unitsize;
+		start += chunk;
+		count -= chunk;
+	}
+	g_mutex_unlock(&store->mutex);
+
+	return ret;
+}
+
+/**
+ * Get the number of samples in a logic store.
+ *
+ * @param[in] store The logic store.
+ *
+ * @return The number of samples, 0 for invalid arguments.
+ *
+ * @since 0.6.0
+ */
+SR_API uint64_t sr_logic_store_samples(struct sr_logic_store *store)
+{
+	uint64_t count;
+
+	if (!store)
+		return 0;
+
+	g_mutex_lock(&store->mutex);
+	count = store->num_samples;
+	g_mutex_unlock(&store->mutex);
+
+	return count;
+}
+
+/**
+ * Get the unit size of the samples in a logic store.
+ *
+ * @param[in] store The logic store.
+ *
+ * @return The unit size in bytes, 0 while the store has no data yet.
+ *
+ * @since 0.6.0
+ */
+SR_API uint16_t sr_logic_store_unitsize(struct sr_logic_store *store)
+{
+	uint16_t unitsize;
+
+	if (!store)
+		return 0;
+
+	g_mutex_lock(&store->mutex);
+	unitsize = store->unitsize;
+	g_mutex_unlock(&store->mutex);
+
+	return unitsize;
+}
+
+/**
+ * Get the amount of memory which a logic store uses.
+ *
+ * @param[in] store The logic store.
+ *
+ * @return The memory use in bytes, 0 for invalid arguments.
+ *
+ * @since 0.6.0
+ */
+SR_API uint64_t sr_logic_store_size(struct sr_logic_store *store)
+{
+	uint64_t size;
+
+	if (!store)
+		return 0;
+
+	g_mutex_lock(&store->mutex);
+	size = store->size;
+	g_mutex_unlock(&store->mutex);
+
+	return size;
+}
+
+/** @} */
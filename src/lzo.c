@@ -0,0 +1,221 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Block-wise LZO compression of packet payloads.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "minilzo/minilzo.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "lzo"
+/** @endcond */
+
+/*
+ * Payloads get compressed in blocks of BLOCK_SIZE bytes, the last block
+ * may be shorter. Every block starts with a 32bit little endian header,
+ * which holds the size of the stored block, and the BLOCK_RAW flag for
+ * blocks which are stored as is, because they did not compress.
+ *
+ * Before a block gets compressed, its first PROBE_SIZE bytes are tried
+ * on their own. When that probe does not shrink by at least an eighth,
+ * the block is taken to be random-looking, and stored right away. That
+ * keeps the cost low for noisy analog data, while sparse logic traces
+ * compress well.
+ */
+#define BLOCK_SIZE (64 * 1024)
+#define PROBE_SIZE (4 * 1024)
+#define BLOCK_RAW (1UL << 31)
+#define HEADER_SIZE sizeof(uint32_t)
+
+/* Worst case size of the compressed data of one block. */
+#define BLOCK_BOUND (BLOCK_SIZE + BLOCK_SIZE / 16 + 64 + 3)
+
+struct sr_lzo {
+	void *wrkmem;
+};
+
+/**
+ * Create an LZO compressor.
+ *
+ * A compressor holds the work memory of compression, and must not be
+ * used by several threads at the same time.
+ *
+ * @return The new compressor, or NULL when LZO is not usable.
+ *
+ * @private
+ */
+SR_PRIV struct sr_lzo *sr_lzo_new(void)
+{
+	struct sr_lzo *lzo;
+
+	if (sr_lzo_init() != SR_OK)
+		return NULL;
+
+	lzo = g_malloc0(sizeof(*lzo));
+	lzo->wrkmem = g_malloc(LZO1X_1_MEM_COMPRESS);
+
+	return lzo;
+}
+
+/**
+ * Destroy an LZO compressor.
+ *
+ * @param[in] lzo The compressor to destroy. May be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_lzo_free(struct sr_lzo *lzo)
+{
+	if (!lzo)
+		return;
+
+	g_free(lzo->wrkmem);
+	g_free(lzo);
+}
+
+/**
+ * Compress data, and append the result to a byte array.
+ *
+ * The caller keeps the length of the uncompressed data, which
+ * sr_lzo_decompress() needs. Compressed data of random-looking
+ * content takes a few bytes per 64KiB more than the input.
+ *
+ * @param[in] lzo The compressor.
+ * @param[in] data The data to compress.
+ * @param[in] length The size of the data in bytes.
+ * @param[in,out] out The byte array to append the compressed data to.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR Compression failed.
+ *
+ * @private
+ */
+SR_PRIV int sr_lzo_compress(struct sr_lzo *lzo, const void *data,
+		size_t length, GByteArray *out)
+{
+	const uint8_t *src;
+	uint8_t *dst;
+	size_t pos, block;
+	lzo_uint size;
+
+	if (!lzo || (!data && length) || !out)
+		return SR_ERR_ARG;
+
+	src = data;
+	while (length) {
+		block = MIN(length, BLOCK_SIZE);
+		pos = out->len;
+		g_byte_array_set_size(out, pos + HEADER_SIZE + BLOCK_BOUND);
+		dst = out->data + pos + HEADER_SIZE;
+
+		size = 0;
+		if (block > PROBE_SIZE) {
+			if (lzo1x_1_compress(src, PROBE_SIZE, dst, &size,
+					lzo->wrkmem) != LZO_E_OK)
+				goto fail;
+			size = size > PROBE_SIZE - PROBE_SIZE / 8 ? block : 0;
+		}
+		if (size < block && lzo1x_1_compress(src, block, dst, &size,
+				lzo->wrkmem) != LZO_E_OK)
+			goto fail;
+
+		if (size < block) {
+			WL32(out->data + pos, size);
+		} else {
+			memcpy(dst, src, block);
+			size = block;
+			WL32(out->data + pos, size | BLOCK_RAW);
+		}
+		g_byte_array_set_size(out, pos + HEADER_SIZE + size);
+		src += block;
+		length -= block;
+	}
+
+	return SR_OK;
+
+fail:
+	sr_err("Cannot compress data.");
+	return SR_ERR;
+}
+
+/**
+ * Decompress data which sr_lzo_compress() returned.
+ *
+ * @param[in] data The compressed data.
+ * @param[in] size The size of the compressed data in bytes.
+ * @param[out] out The buffer to receive the decompressed data.
+ * @param[in] length The size of the decompressed data in bytes.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_DATA The compressed data is invalid.
+ *
+ * @private
+ */
+SR_PRIV int sr_lzo_decompress(const void *data, size_t size, void *out,
+		size_t length)
+{
+	const uint8_t *src;
+	uint8_t *dst;
+	uint32_t header, stored;
+	size_t block;
+	lzo_uint done;
+
+	if ((!data && size) || (!out && length))
+		return SR_ERR_ARG;
+
+	src = data;
+	dst = out;
+	while (length) {
+		if (size < HEADER_SIZE)
+			return SR_ERR_DATA;
+		header = RL32(src);
+		stored = header & ~BLOCK_RAW;
+		src += HEADER_SIZE;
+		size -= HEADER_SIZE;
+		if (stored > size)
+			return SR_ERR_DATA;
+
+		block = MIN(length, BLOCK_SIZE);
+		if (header & BLOCK_RAW) {
+			if (stored != block)
+				return SR_ERR_DATA;
+			memcpy(dst, src, block);
+		} else {
+			done = block;
+			if (lzo1x_decompress_safe(src, stored, dst, &done,
+					NULL) != LZO_E_OK || done != block)
+				return SR_ERR_DATA;
+		}
+		src += stored;
+		size -= stored;
+		dst += block;
+		length -= block;
+	}
+
+	return size ? SR_ERR_DATA : SR_OK;
+}
@@ -0,0 +1,252 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Accounting of the allocations which grow with the amount of data:
+ * sample buffers, packet copies, and the buffers of the input modules,
+ * the transforms and the session. Each thread has a current subsystem,
+ * which the library sets while it runs driver, input, output and
+ * transform code. Allocations get accounted to the subsystem which was
+ * current when they were made, and remember it for their release.
+ *
+ * The accounting only gets built with --enable-mem-stats, otherwise the
+ * internal calls compile to nothing, and sr_mem_stats_get() fails.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "mem"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Accounting of allocations by subsystem.
+ */
+
+/**
+ * @defgroup grp_mem_stats Memory accounting
+ *
+ * Accounting of allocations by subsystem.
+ *
+ * @{
+ */
+
+static const char *const mem_tag_names[SR_MEM_TAGS] = {
+	[SR_MEM_OTHER] = "other",
+	[SR_MEM_DRIVER] = "driver",
+	[SR_MEM_INPUT] = "input",
+	[SR_MEM_OUTPUT] = "output",
+	[SR_MEM_TRANSFORM] = "transform",
+	[SR_MEM_SESSION] = "session",
+};
+
+#ifdef HAVE_MEM_STATS
+
+struct mem_counters {
+	uint64_t live_bytes;
+	uint64_t peak_bytes;
+	uint64_t allocations;
+	uint64_t frees;
+	uint64_t bytes_allocated;
+};
+
+static GMutex mem_mutex;
+static struct mem_counters mem_counters[SR_MEM_TAGS];
+static int64_t mem_start_us;
+
+/* The current subsystem plus one, so that unset means SR_MEM_OTHER. */
+static GPrivate mem_tag = G_PRIVATE_INIT(NULL);
+
+/** @private */
+SR_PRIV int sr_mem_tag_current(void)
+{
+	int tag;
+
+	tag = GPOINTER_TO_INT(g_private_get(&mem_tag)) - 1;
+
+	return tag < 0 ? SR_MEM_OTHER : tag;
+}
+
+/**
+ * Make a subsystem the current one of the calling thread.
+ *
+ * @param tag The subsystem, see enum sr_mem_tag.
+ *
+ * @return The previous subsystem, to pass to sr_mem_tag_leave().
+ *
+ * @private
+ */
+SR_PRIV int sr_mem_tag_enter(int tag)
+{
+	int prev;
+
+	prev = sr_mem_tag_current();
+	g_private_set(&mem_tag, GINT_TO_POINTER(tag + 1));
+
+	return prev;
+}
+
+/** @private */
+SR_PRIV void sr_mem_tag_leave(int prev)
+{
+	g_private_set(&mem_tag, GINT_TO_POINTER(prev + 1));
+}
+
+/** @private */
+SR_PRIV void sr_mem_alloc_add(int tag, size_t size)
+{
+	struct mem_counters *c;
+
+	if (tag < 0 || tag >= SR_MEM_TAGS)
+		tag = SR_MEM_OTHER;
+
+	g_mutex_lock(&mem_mutex);
+	if (!mem_start_us)
+		mem_start_us = g_get_monotonic_time();
+	c = &mem_counters[tag];
+	c->live_bytes += size;
+	if (c->live_bytes > c->peak_bytes)
+		c->peak_bytes = c->live_bytes;
+	c->allocations++;
+	c->bytes_allocated += size;
+	g_mutex_unlock(&mem_mutex);
+}
+
+/** @private */
+SR_PRIV void sr_mem_free_add(int tag, size_t size)
+{
+	struct mem_counters *c;
+
+	if (tag < 0 || tag >= SR_MEM_TAGS)
+		tag = SR_MEM_OTHER;
+
+	g_mutex_lock(&mem_mutex);
+	c = &mem_counters[tag];
+	c->live_bytes -= MIN(size, c->live_bytes);
+	c->frees++;
+	g_mutex_unlock(&mem_mutex);
+}
+
+#endif
+
+/**
+ * Get the name of a subsystem which allocations are accounted to.
+ *
+ * @param tag The subsystem, see enum sr_mem_tag.
+ *
+ * @return The name, or NULL for an invalid subsystem.
+ *
+ * @since 0.6.0
+ */
+SR_API const char *sr_mem_tag_name(int tag)
+{
+	if (tag < 0 || tag >= SR_MEM_TAGS)
+		return NULL;
+
+	return mem_tag_names[tag];
+}
+
+/**
+ * Get the allocation counters of a subsystem.
+ *
+ * The counters cover the whole process. The allocation rate is the
+ * number of bytes allocated per second, since the first allocation or
+ * the last sr_mem_stats_reset(). Live bytes which stay flat while the
+ * rate is not zero show that buffers get recycled, rather than leak.
+ *
+ * @param tag The subsystem, see enum sr_mem_tag.
+ * @param stats Receives the counters. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The library was built without memory accounting.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_mem_stats_get(int tag, struct sr_mem_stats *stats)
+{
+#ifdef HAVE_MEM_STATS
+	const struct mem_counters *c;
+	int64_t elapsed_us;
+
+	if (tag < 0 || tag >= SR_MEM_TAGS || !stats)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&mem_mutex);
+	c = &mem_counters[tag];
+	stats->live_bytes = c->live_bytes;
+	stats->peak_bytes = c->peak_bytes;
+	stats->allocations = c->allocations;
+	stats->frees = c->frees;
+	stats->bytes_allocated = c->bytes_allocated;
+	elapsed_us = mem_start_us ? g_get_monotonic_time() - mem_start_us : 0;
+	g_mutex_unlock(&mem_mutex);
+
+	stats->elapsed_us = elapsed_us;
+	stats->alloc_rate = elapsed_us > 0 ?
+		stats->bytes_allocated * 1e6 / elapsed_us : 0;
+
+	return SR_OK;
+#else
+	if (tag < 0 || tag >= SR_MEM_TAGS || !stats)
+		return SR_ERR_ARG;
+
+	memset(stats, 0, sizeof(*stats));
+
+	return SR_ERR_NA;
+#endif
+}
+
+/**
+ * Restart the allocation counters of all subsystems.
+ *
+ * Live bytes stay, the peaks start over from them.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_NA The library was built without memory accounting.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_mem_stats_reset(void)
+{
+#ifdef HAVE_MEM_STATS
+	struct mem_counters *c;
+	int tag;
+
+	g_mutex_lock(&mem_mutex);
+	for (tag = 0; tag < SR_MEM_TAGS; tag++) {
+		c = &mem_counters[tag];
+		c->peak_bytes = c->live_bytes;
+		c->allocations = c->frees = c->bytes_allocated = 0;
+	}
+	mem_start_us = g_get_monotonic_time();
+	g_mutex_unlock(&mem_mutex);
+
+	return SR_OK;
+#else
+	return SR_ERR_NA;
+#endif
+}
+
+/** @} */
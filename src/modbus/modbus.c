@@ -478,6 +478,79 @@ SR_PRIV int sr_modbus_read_holding_registers(struct sr_modbus_dev_inst *modbus,
 	return SR_OK;
 }
 
+/* The most registers which one read holding registers reply can hold. */
+#define MODBUS_MAX_READ_REGISTERS 125
+
+/**
+ * Read several ranges of holding registers, with as few requests as
+ * possible. Ranges which overlap, or which are at most max_gap registers
+ * apart, get combined into one request, as long as the protocol's limit
+ * on the number of registers allows.
+ *
+ * @param modbus Previously initialized Modbus device structure.
+ * @param ranges The ranges of registers to read, in any order.
+ * @param count The number of ranges.
+ * @param max_gap The number of unused registers between two ranges which
+ *                is cheaper to transfer than another request.
+ *
+ * @return SR_OK upon success, SR_ERR_ARG upon invalid arguments,
+ *         SR_ERR_DATA upon invalid data, or SR_ERR on failure.
+ */
+SR_PRIV int sr_modbus_read_holding_ranges(struct sr_modbus_dev_inst *modbus,
+		struct sr_modbus_read_range *ranges, size_t count, int max_gap)
+{
+	uint16_t registers[MODBUS_MAX_READ_REGISTERS];
+	struct sr_modbus_read_range **order, *r;
+	size_t i, j, first;
+	int start, end, ret;
+
+	if (!ranges || !count || max_gap < 0)
+		return SR_ERR_ARG;
+	for (i = 0; i < count; i++) {
+		if (ranges[i].address < 0 || ranges[i].address > 0xFFFF ||
+				ranges[i].nb_registers < 1 ||
+				ranges[i].nb_registers > MODBUS_MAX_READ_REGISTERS ||
+				!ranges[i].registers)
+			return SR_ERR_ARG;
+	}
+
+	/* Sort the ranges by address, there are a few only. */
+	order = g_malloc(count * sizeof(*order));
+	for (i = 0; i < count; i++) {
+		r = &ranges[i];
+		for (j = i; j > 0 && order[j - 1]->address > r->address; j--)
+			order[j] = order[j - 1];
+		order[j] = r;
+	}
+
+	ret = SR_OK;
+	for (first = 0; first < count && ret == SR_OK; first = i) {
+		/* Extend the request while the next range fits. */
+		start = order[first]->address;
+		end = start + order[first]->nb_registers;
+		for (i = first + 1; i < count; i++) {
+			r = order[i];
+			if (r->address > end + max_gap)
+				break;
+			if (MAX(end, r->address + r->nb_registers) - start >
+					MODBUS_MAX_READ_REGISTERS)
+				break;
+			end = MAX(end, r->address + r->nb_registers);
+		}
+
+		ret = sr_modbus_read_holding_registers(modbus,
+			start, end - start, registers);
+		for (j = first; j < i && ret == SR_OK; j++) {
+			r = order[j];
+			memcpy(r->registers, &registers[r->address - start],
+				r->nb_registers * sizeof(registers[0]));
+		}
+	}
+	g_free(order);
+
+	return ret;
+}
+
 /**
  * Send a Modbus write coil command.
  *
@@ -29,11 +29,22 @@
 
 #define BIN_TO_DEC_DIGITS (log(2) / log(10))
 
+/* Largest fixed point value which append_fixed() renders itself. */
+#define FIXED_MAX 1e9
+/* Digits beyond a float's precision only repeat its binary expansion. */
+#define FIXED_MAX_DIGITS 60
+
 struct context {
 	int num_enabled_channels;
 	GPtrArray *channellist;
 	int digits;
 	float *fdata;
+	/* The unit suffix, for the meaning it was rendered for. */
+	gboolean have_suffix;
+	enum sr_unit unit;
+	enum sr_mqflag mqflags;
+	gboolean si_friendly;
+	char *suffix;
 };
 
 enum {
@@ -72,6 +83,69 @@ static int init(struct sr_output *o, GHashTable *options)
 	return SR_OK;
 }
 
+/*
+ * Append a value with a fixed number of fraction digits, like "%.*f"
+ * but independent of the locale. Values which fit get rendered from a
+ * scaled integer, ties and large values are left to g_ascii_formatd().
+ */
+static void append_fixed(GString *out, float value, int digits)
+{
+	static const double pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+	};
+	char buf[128], fmt[16], *p;
+	double scaled, rounded;
+	uint64_t n;
+	int i;
+
+	digits = CLAMP(digits, 0, FIXED_MAX_DIGITS);
+	if (isfinite(value) && digits < (int)ARRAY_SIZE(pow10)) {
+		scaled = fabs((double)value) * pow10[digits];
+		rounded = floor(scaled + 0.5);
+		/* The scaling's rounding error could flip ties. */
+		if (scaled < FIXED_MAX && fabs(rounded - scaled - 0.5) > 1e-6
+				&& fabs(rounded - scaled + 0.5) > 1e-6) {
+			n = rounded;
+			p = &buf[sizeof(buf)];
+			for (i = 0; i < digits; i++) {
+				*--p = '0' + n % 10;
+				n /= 10;
+			}
+			if (digits)
+				*--p = '.';
+			do {
+				*--p = '0' + n % 10;
+				n /= 10;
+			} while (n);
+			if (signbit(value))
+				*--p = '-';
+			g_string_append_len(out, p, &buf[sizeof(buf)] - p);
+			return;
+		}
+	}
+
+	g_snprintf(fmt, sizeof(fmt), "%%.%df", digits);
+	g_string_append(out, g_ascii_formatd(buf, sizeof(buf), fmt, value));
+}
+
+/* Render the unit suffix when the meaning differs from the last one. */
+static const char *unit_suffix(struct context *ctx,
+		const struct sr_datafeed_analog *analog)
+{
+	if (ctx->have_suffix && ctx->unit == analog->meaning->unit
+			&& ctx->mqflags == analog->meaning->mqflags)
+		return ctx->suffix;
+
+	g_free(ctx->suffix);
+	sr_analog_unit_to_string(analog, &ctx->suffix);
+	ctx->unit = analog->meaning->unit;
+	ctx->mqflags = analog->meaning->mqflags;
+	ctx->si_friendly = sr_analog_si_prefix_friendly(ctx->unit);
+	ctx->have_suffix = TRUE;
+
+	return ctx->suffix;
+}
+
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
 		GString **out)
 {
@@ -85,7 +159,7 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	float *fdata;
 	unsigned int i;
 	int num_channels, c, ret, digits, actual_digits;
-	char *number, *suffix;
+	const char *suffix;
 
 	*out = NULL;
 	if (!o || !o->sdi)
@@ -101,13 +175,14 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		break;
 	case SR_DF_META:
 		meta = packet->payload;
+		*out = g_string_sized_new(512);
 		for (l = meta->config; l; l = l->next) {
 			src = l->data;
 			if (!(srci = sr_key_info_get(SR_KEY_CONFIG, src->key)))
 				return SR_ERR;
-			*out = g_string_sized_new(512);
 			g_string_append(*out, "META ");
-			g_string_append_printf(*out, "%s: ", srci->id);
+			g_string_append(*out, srci->id);
+			g_string_append(*out, ": ");
 			if (srci->datatype == SR_T_BOOL) {
 				g_string_append_printf(*out, "%u",
 					g_variant_get_boolean(src->data));
@@ -134,34 +209,31 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		ctx->fdata = fdata;
 		if ((ret = sr_analog_to_float(analog, fdata)) != SR_OK)
 			return ret;
-		*out = g_string_sized_new(512);
+		suffix = unit_suffix(ctx, analog);
+		*out = g_string_sized_new(analog->num_samples * num_channels * 32);
 		if (ctx->digits == DIGITS_ALL)
 			digits = analog->encoding->digits;
 		else
 			digits = analog->spec->spec_digits;
 		if (!analog->encoding->is_digits_decimal)
 			digits = copysign(ceil(abs(digits) * BIN_TO_DEC_DIGITS), digits);
-		gboolean si_friendly = sr_analog_si_prefix_friendly(analog->meaning->unit);
-		sr_analog_unit_to_string(analog, &suffix);
 		for (i = 0; i < analog->num_samples; i++) {
 			for (l = analog->meaning->channels, c = 0; l; l = l->next, c++) {
 				float value = fdata[i * num_channels + c];
 				const char *prefix = "";
 				actual_digits = digits;
-				if (si_friendly)
+				if (ctx->si_friendly)
 					prefix = sr_analog_si_prefix(&value, &actual_digits);
 				ch = l->data;
-				g_string_append_printf(*out, "%s: ", ch->name);
-				number = g_strdup_printf("%.*f", MAX(actual_digits, 0), value);
-				g_string_append(*out, number);
-				g_free(number);
-				g_string_append(*out, " ");
+				g_string_append(*out, ch->name);
+				g_string_append(*out, ": ");
+				append_fixed(*out, value, actual_digits);
+				g_string_append_c(*out, ' ');
 				g_string_append(*out, prefix);
 				g_string_append(*out, suffix);
-				g_string_append(*out, "\n");
+				g_string_append_c(*out, '\n');
 			}
 		}
-		g_free(suffix);
 		break;
 	}
 
@@ -204,6 +276,7 @@ static int cleanup(struct sr_output *o)
 		options[0].values = NULL;
 	}
 	g_free(ctx->fdata);
+	g_free(ctx->suffix);
 	g_free(ctx);
 	o->priv = NULL;
 
@@ -43,30 +43,54 @@ struct context {
 	int trigger;
 	uint64_t samplerate;
 	int *channel_index;
-	char **aligned_names;
 	size_t max_namelen;
-	char **line_values;
-	uint8_t *prev_sample;
+	size_t plane_bytes;
+	uint8_t *planes;
+	uint8_t *prev_bits;
 	gboolean header_done;
-	GString **lines;
+	char *lines;
+	size_t line_size;
 	const char *charset;
 	gboolean edges;
+	/* Eight output characters for each value of a bit plane byte. */
+	uint64_t level_chars[256];
+	uint64_t edge_chars[256];
+	uint64_t edge_mask[256];
 };
 
+static void build_table(uint64_t *table, char low, char high)
+{
+	char chars[8];
+	size_t value, bit;
+
+	for (value = 0; value < 256; value++) {
+		for (bit = 0; bit < 8; bit++)
+			chars[bit] = (value & (1U << bit)) ? high : low;
+		memcpy(&table[value], chars, sizeof(chars));
+	}
+}
+
 static int init(struct sr_output *o, GHashTable *options)
 {
 	struct context *ctx;
 	struct sr_channel *ch;
 	GSList *l;
-	size_t j, max_namelen, alloc_line_len;
+	size_t j, spl, max_namelen, max_index;
+	char *line;
 
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 
+	spl = g_variant_get_uint32(g_hash_table_lookup(options, "width"));
+	if (!spl) {
+		sr_err("Invalid width of zero samples per line.");
+		return SR_ERR_ARG;
+	}
+
 	ctx = g_malloc0(sizeof(struct context));
 	o->priv = ctx;
 	ctx->trigger = -1;
-	ctx->spl = g_variant_get_uint32(g_hash_table_lookup(options, "width"));
+	ctx->spl = spl;
 	ctx->charset = g_strdup(g_variant_get_string(
 		g_hash_table_lookup(options, "charset"), NULL));
 	if (!ctx->charset || strlen(ctx->charset) < 2) {
@@ -74,33 +98,38 @@ static int init(struct sr_output *o, GHashTable *options)
 		ctx->charset = g_strdup(DEFAULT_ASCII_CHARS);
 	}
 	ctx->edges = (strlen(ctx->charset) >= 4) ? TRUE : FALSE;
-
-	for (l = o->sdi->channels; l; l = l->next) {
-		ch = l->data;
-		if (ch->type != SR_CHANNEL_LOGIC)
-			continue;
-		if (!ch->enabled)
-			continue;
-		ctx->num_enabled_channels++;
+	build_table(ctx->level_chars, ctx->charset[0], ctx->charset[1]);
+	if (ctx->edges) {
+		build_table(ctx->edge_chars, ctx->charset[2], ctx->charset[3]);
+		build_table(ctx->edge_mask, 0x00, (char)0xff);
 	}
-	ctx->channel_index = g_malloc0(sizeof(ctx->channel_index[0]) * ctx->num_enabled_channels);
-	ctx->aligned_names = g_malloc0(sizeof(ctx->aligned_names[0]) * ctx->num_enabled_channels);
-	ctx->lines = g_malloc0(sizeof(ctx->lines[0]) * ctx->num_enabled_channels);
-	ctx->prev_sample = g_malloc0(g_slist_length(o->sdi->channels));
 
 	/* Get the maximum length across all active logic channels. */
 	max_namelen = 0;
+	max_index = 0;
 	for (l = o->sdi->channels; l; l = l->next) {
 		ch = l->data;
 		if (ch->type != SR_CHANNEL_LOGIC)
 			continue;
 		if (!ch->enabled)
 			continue;
+		ctx->num_enabled_channels++;
 		max_namelen = MAX(max_namelen, strlen(ch->name));
+		max_index = MAX(max_index, (size_t)ch->index);
 	}
 	ctx->max_namelen = max_namelen;
+	ctx->channel_index = g_malloc0(sizeof(ctx->channel_index[0]) * ctx->num_enabled_channels);
+	ctx->prev_bits = g_malloc0(ctx->num_enabled_channels);
+	ctx->plane_bytes = max_index / 8 + 1;
+	ctx->planes = g_malloc0(8 * ctx->plane_bytes);
 
-	alloc_line_len = ctx->max_namelen + 8 + ctx->spl;
+	/*
+	 * One line buffer per channel, grown once: the aligned name,
+	 * the samples and the newline, plus the slack for writing the
+	 * characters of eight samples at a time.
+	 */
+	ctx->line_size = max_namelen + 1 + spl + 1 + sizeof(uint64_t);
+	ctx->lines = g_malloc0(ctx->line_size * ctx->num_enabled_channels);
 	j = 0;
 	for (l = o->sdi->channels; l; l = l->next) {
 		ch = l->data;
@@ -110,10 +139,8 @@ static int init(struct sr_output *o, GHashTable *options)
 			continue;
 
 		ctx->channel_index[j] = ch->index;
-		ctx->aligned_names[j] = g_strdup_printf("%*s", (int)max_namelen, ch->name);
-
-		ctx->lines[j] = g_string_sized_new(alloc_line_len);
-		g_string_printf(ctx->lines[j], "%s:", ctx->aligned_names[j]);
+		line = ctx->lines + j * ctx->line_size;
+		g_snprintf(line, ctx->line_size, "%*s:", (int)max_namelen, ch->name);
 
 		j++;
 	}
@@ -140,7 +167,7 @@ static GString *gen_header(const struct sr_output *o)
 
 	header = g_string_sized_new(512);
 	g_string_printf(header, "%s %s\n", PACKAGE_NAME, sr_package_version_string_get());
-	num_channels = g_slist_length(o->sdi->channels);
+	num_channels = sr_dev_channel_count(o->sdi, 0, FALSE);
 	g_string_append_printf(header, "Acquisition with %zu/%zu channels",
 			ctx->num_enabled_channels, num_channels);
 	if (ctx->samplerate != 0) {
@@ -172,6 +199,56 @@ static void maybe_add_trigger(struct context *ctx, GString *out)
 		offset + 1, "^", offset);
 }
 
+static void reserve(GString *out, size_t extra)
+{
+	size_t len;
+
+	len = out->len;
+	g_string_set_size(out, len + extra);
+	g_string_truncate(out, len);
+}
+
+/* Render up to eight samples per channel, given as bit planes. */
+static void render_samples(struct context *ctx, size_t count)
+{
+	size_t j, pos;
+	uint64_t chars, mask;
+	uint8_t bits, edges, valid;
+
+	pos = ctx->max_namelen + 1 + ctx->spl_cnt;
+	valid = 0xff >> (8 - count);
+	for (j = 0; j < ctx->num_enabled_channels; j++) {
+		bits = ctx->planes[ctx->channel_index[j]];
+		chars = ctx->level_chars[bits];
+		if (ctx->edges) {
+			/* No edge on the first sample of a line. */
+			edges = (bits ^ ((bits << 1) | ctx->prev_bits[j])) & valid;
+			if (!ctx->spl_cnt)
+				edges &= ~1;
+			if (edges) {
+				mask = ctx->edge_mask[edges];
+				chars = (chars & ~mask) | (ctx->edge_chars[bits] & mask);
+			}
+			ctx->prev_bits[j] = (bits >> (count - 1)) & 1;
+		}
+		memcpy(ctx->lines + j * ctx->line_size + pos, &chars, sizeof(chars));
+	}
+}
+
+static void flush_lines(struct context *ctx, GString *out)
+{
+	size_t j, len;
+	char *line;
+
+	len = ctx->max_namelen + 1 + ctx->spl_cnt;
+	for (j = 0; j < ctx->num_enabled_channels; j++) {
+		line = ctx->lines + j * ctx->line_size;
+		line[len] = '\n';
+		g_string_append_len(out, line, len + 1);
+	}
+	maybe_add_trigger(ctx, out);
+}
+
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
 		GString **out)
 {
@@ -180,13 +257,8 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	const struct sr_config *src;
 	GSList *l;
 	struct context *ctx;
-	size_t idx, i, j;
-	size_t num_samples;
+	size_t num_samples, num_lines, count, bytes;
 	const uint8_t *curr_sample;
-	size_t bytepos;
-	uint8_t bitmask, curbit, prevbit;
-	char c;
-	size_t charidx;
 
 	*out = NULL;
 	if (!o || !o->sdi)
@@ -217,49 +289,34 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 
 		logic = packet->payload;
 		num_samples = logic->length / logic->unitsize;
+		num_lines = (ctx->spl_cnt + num_samples) / ctx->spl;
+		reserve(*out, num_lines * (ctx->num_enabled_channels *
+			(ctx->max_namelen + 1 + ctx->spl + 1)));
+
+		/* Channels beyond the sample width read as low. */
+		bytes = MIN(ctx->plane_bytes, logic->unitsize);
+		memset(ctx->planes, 0, 8 * ctx->plane_bytes);
 		curr_sample = logic->data;
-		while (num_samples--) {
-			ctx->spl_cnt++;
-			for (j = 0; j < ctx->num_enabled_channels; j++) {
-				idx = ctx->channel_index[j];
-				bytepos = idx / 8;
-				bitmask = 1U << (idx % 8);
-				curbit = curr_sample[bytepos] & bitmask;
-				prevbit = ctx->prev_sample[bytepos] & bitmask;
-
-				charidx = curbit ? 1 : 0;
-				if (ctx->edges && ctx->spl_cnt > 1) {
-					if (curbit != prevbit)
-						charidx += 2;
-				}
-				c = ctx->charset[charidx];
-				g_string_append_c(ctx->lines[j], c);
-
-				if (ctx->spl_cnt == ctx->spl) {
-					/* Flush line buffers. */
-					g_string_append_len(*out, ctx->lines[j]->str, ctx->lines[j]->len);
-					g_string_append_c(*out, '\n');
-					if (j + 1 == ctx->num_enabled_channels)
-						maybe_add_trigger(ctx, *out);
-					g_string_printf(ctx->lines[j], "%s:", ctx->aligned_names[j]);
-				}
-			}
-			if (ctx->spl_cnt == ctx->spl)
-				/* Line buffers were already flushed. */
+		while (num_samples) {
+			count = MIN(num_samples, 8);
+			count = MIN(count, ctx->spl - ctx->spl_cnt);
+			sr_transpose_samples(curr_sample, logic->unitsize,
+				count, bytes, ctx->planes);
+			render_samples(ctx, count);
+			ctx->spl_cnt += count;
+			curr_sample += count * logic->unitsize;
+			num_samples -= count;
+			if (ctx->spl_cnt == ctx->spl) {
+				flush_lines(ctx, *out);
 				ctx->spl_cnt = 0;
-			memcpy(ctx->prev_sample, curr_sample, logic->unitsize);
-			curr_sample += logic->unitsize;
+			}
 		}
 		break;
 	case SR_DF_END:
 		if (ctx->spl_cnt) {
 			/* Line buffers need flushing. */
 			*out = g_string_sized_new(512);
-			for (i = 0; i < ctx->num_enabled_channels; i++) {
-				g_string_append_len(*out, ctx->lines[i]->str, ctx->lines[i]->len);
-				g_string_append_c(*out, '\n');
-			}
-			maybe_add_trigger(ctx, *out);
+			flush_lines(ctx, *out);
 		}
 		break;
 	}
@@ -270,7 +327,6 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 static int cleanup(struct sr_output *o)
 {
 	struct context *ctx;
-	size_t i;
 
 	if (!o)
 		return SR_ERR_ARG;
@@ -279,12 +335,8 @@ static int cleanup(struct sr_output *o)
 		return SR_OK;
 
 	g_free(ctx->channel_index);
-	g_free(ctx->prev_sample);
-	for (i = 0; i < ctx->num_enabled_channels; i++) {
-		g_free(ctx->aligned_names[i]);
-		g_string_free(ctx->lines[i], TRUE);
-	}
-	g_free(ctx->aligned_names);
+	g_free(ctx->prev_bits);
+	g_free(ctx->planes);
 	g_free(ctx->lines);
 	g_free((gpointer)ctx->charset);
 	g_free(ctx);
@@ -35,26 +35,61 @@ struct context {
 	int trigger;
 	uint64_t samplerate;
 	int *channel_index;
-	char **channel_names;
+	size_t *prefix_len;
+	size_t plane_bytes;
+	uint8_t *planes;
 	gboolean header_done;
-	GString **lines;
+	char *lines;
+	size_t line_size;
+	size_t line_pos;
 };
 
+/* Eight digits for each value of a bit plane byte. */
+static uint64_t bit_chars[256];
+
+static void build_table(void)
+{
+	char chars[8];
+	size_t value, bit;
+
+	for (value = 0; value < 256; value++) {
+		for (bit = 0; bit < 8; bit++)
+			chars[bit] = (value & (1U << bit)) ? '1' : '0';
+		memcpy(&bit_chars[value], chars, sizeof(chars));
+	}
+}
+
 static int init(struct sr_output *o, GHashTable *options)
 {
+	static gsize table_done;
 	struct context *ctx;
 	struct sr_channel *ch;
 	GSList *l;
-	unsigned int i, j;
+	unsigned int j;
+	size_t max_namelen, max_index, spl;
+	char *line;
 
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 
+	spl = g_variant_get_uint32(g_hash_table_lookup(options, "width"));
+	if (!spl || spl > G_MAXINT) {
+		sr_err("Invalid width of %zu samples per line.", spl);
+		return SR_ERR_ARG;
+	}
+
+	if (g_once_init_enter(&table_done)) {
+		build_table();
+		g_once_init_leave(&table_done, 1);
+	}
+
 	ctx = g_malloc0(sizeof(struct context));
 	o->priv = ctx;
 	ctx->trigger = -1;
-	ctx->spl = g_variant_get_uint32(g_hash_table_lookup(options, "width"));
+	ctx->spl = spl;
 
+	max_namelen = 0;
+	max_index = 0;
 	for (l = o->sdi->channels; l; l = l->next) {
 		ch = l->data;
 		if (ch->type != SR_CHANNEL_LOGIC)
@@ -62,22 +97,31 @@ static int init(struct sr_output *o, GHashTable *options)
 		if (!ch->enabled)
 			continue;
 		ctx->num_enabled_channels++;
+		max_namelen = MAX(max_namelen, strlen(ch->name));
+		max_index = MAX(max_index, (size_t)ch->index);
 	}
 	ctx->channel_index = g_malloc(sizeof(int) * ctx->num_enabled_channels);
-	ctx->channel_names = g_malloc(sizeof(char *) * ctx->num_enabled_channels);
-	ctx->lines = g_malloc(sizeof(GString *) * ctx->num_enabled_channels);
+	ctx->prefix_len = g_malloc(sizeof(size_t) * ctx->num_enabled_channels);
+	ctx->plane_bytes = max_index / 8 + 1;
+	ctx->planes = g_malloc0(8 * ctx->plane_bytes);
 
+	/*
+	 * One line buffer per channel, grown once: the name, the digits
+	 * with a space after every 8th, the newline, and the slack for
+	 * writing the digits of eight samples at a time.
+	 */
+	ctx->line_size = max_namelen + 1 + spl + spl / 8 + 1 + sizeof(uint64_t);
+	ctx->lines = g_malloc0(ctx->line_size * ctx->num_enabled_channels);
 	j = 0;
-	for (i = 0, l = o->sdi->channels; l; l = l->next, i++) {
+	for (l = o->sdi->channels; l; l = l->next) {
 		ch = l->data;
 		if (ch->type != SR_CHANNEL_LOGIC)
 			continue;
 		if (!ch->enabled)
 			continue;
 		ctx->channel_index[j] = ch->index;
-		ctx->channel_names[j] = ch->name;
-		ctx->lines[j] = g_string_sized_new(80);
-		g_string_printf(ctx->lines[j], "%s:", ch->name);
+		line = ctx->lines + j * ctx->line_size;
+		ctx->prefix_len[j] = g_snprintf(line, ctx->line_size, "%s:", ch->name);
 		j++;
 	}
 
@@ -103,7 +147,7 @@ static GString *gen_header(const struct sr_output *o)
 
 	header = g_string_sized_new(512);
 	g_string_printf(header, "%s %s\n", PACKAGE_NAME, sr_package_version_string_get());
-	num_channels = g_slist_length(o->sdi->channels);
+	num_channels = sr_dev_channel_count(o->sdi, 0, FALSE);
 	g_string_append_printf(header, "Acquisition with %d/%d channels",
 			ctx->num_enabled_channels, num_channels);
 	if (ctx->samplerate != 0) {
@@ -116,6 +160,46 @@ static GString *gen_header(const struct sr_output *o)
 	return header;
 }
 
+static void reserve(GString *out, size_t extra)
+{
+	size_t len;
+
+	len = out->len;
+	g_string_set_size(out, len + extra);
+	g_string_truncate(out, len);
+}
+
+/* Render up to eight samples per channel, given as bit planes. */
+static void render_samples(struct context *ctx, size_t count, gboolean space)
+{
+	unsigned int j;
+	char *line;
+
+	for (j = 0; j < ctx->num_enabled_channels; j++) {
+		line = ctx->lines + j * ctx->line_size + ctx->prefix_len[j];
+		memcpy(line + ctx->line_pos,
+			&bit_chars[ctx->planes[ctx->channel_index[j]]],
+			sizeof(uint64_t));
+		if (space)
+			line[ctx->line_pos + count] = ' ';
+	}
+	ctx->line_pos += count + (space ? 1 : 0);
+}
+
+static void flush_lines(struct context *ctx, GString *out)
+{
+	unsigned int j;
+	size_t len;
+	char *line;
+
+	for (j = 0; j < ctx->num_enabled_channels; j++) {
+		line = ctx->lines + j * ctx->line_size;
+		len = ctx->prefix_len[j] + ctx->line_pos;
+		line[len] = '\n';
+		g_string_append_len(out, line, len + 1);
+	}
+}
+
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
 		GString **out)
 {
@@ -124,9 +208,9 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	const struct sr_config *src;
 	struct context *ctx;
 	GSList *l;
-	int idx, offset;
-	uint64_t i, j;
-	gchar *p, c;
+	int offset;
+	size_t num_samples, num_lines, count, bytes;
+	const uint8_t *curr_sample;
 
 	*out = NULL;
 	if (!o || !o->sdi)
@@ -155,47 +239,51 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			*out = g_string_sized_new(512);
 
 		logic = packet->payload;
-		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
-			ctx->spl_cnt++;
-			for (j = 0; j < ctx->num_enabled_channels; j++) {
-				idx = ctx->channel_index[j];
-				p = logic->data + i + idx / 8;
-				c = (*p & (1 << (idx % 8))) ? '1' : '0';
-				g_string_append_c(ctx->lines[j], c);
-
-				if (ctx->spl_cnt == ctx->spl) {
-					/* Flush line buffers. */
-					g_string_append_len(*out, ctx->lines[j]->str, ctx->lines[j]->len);
-					g_string_append_c(*out, '\n');
-					if (j == ctx->num_enabled_channels - 1 && ctx->trigger > -1) {
-						/*
-						 * Sample data lines have one character per bit,
-						 * plus one separator per byte. Align trigger marker
-						 * to this layout.
-						 */
-						offset = ctx->trigger + ctx->trigger / 8;
-						g_string_append_printf(*out, "T:%*s^ %d\n", offset, "", ctx->trigger);
-						ctx->trigger = -1;
-					}
-					g_string_printf(ctx->lines[j], "%s:", ctx->channel_names[j]);
-				} else if ((ctx->spl_cnt & 7) == 0) {
-					/* Add a space every 8th bit. */
-					g_string_append_c(ctx->lines[j], ' ');
-				}
+		num_samples = logic->length / logic->unitsize;
+		num_lines = (ctx->spl_cnt + num_samples) / ctx->spl;
+		reserve(*out, num_lines * ctx->num_enabled_channels *
+			ctx->line_size);
+
+		/* Channels beyond the sample width read as low. */
+		bytes = MIN(ctx->plane_bytes, logic->unitsize);
+		memset(ctx->planes, 0, 8 * ctx->plane_bytes);
+		curr_sample = logic->data;
+		while (num_samples) {
+			/* Groups of samples end at the spaces. */
+			count = 8 - (ctx->spl_cnt & 7);
+			count = MIN(count, num_samples);
+			count = MIN(count, (size_t)(ctx->spl - ctx->spl_cnt));
+			sr_transpose_samples(curr_sample, logic->unitsize,
+				count, bytes, ctx->planes);
+			ctx->spl_cnt += count;
+			render_samples(ctx, count, (ctx->spl_cnt & 7) == 0 &&
+				ctx->spl_cnt != ctx->spl);
+			curr_sample += count * logic->unitsize;
+			num_samples -= count;
+			if (ctx->spl_cnt != ctx->spl)
+				continue;
+
+			/* Flush line buffers. */
+			flush_lines(ctx, *out);
+			if (ctx->num_enabled_channels && ctx->trigger > -1) {
+				/*
+				 * Sample data lines have one character per bit,
+				 * plus one separator per byte. Align trigger marker
+				 * to this layout.
+				 */
+				offset = ctx->trigger + ctx->trigger / 8;
+				g_string_append_printf(*out, "T:%*s^ %d\n", offset, "", ctx->trigger);
+				ctx->trigger = -1;
 			}
-			if (ctx->spl_cnt == ctx->spl)
-				/* Line buffers were already flushed. */
-				ctx->spl_cnt = 0;
+			ctx->spl_cnt = 0;
+			ctx->line_pos = 0;
 		}
 		break;
 	case SR_DF_END:
 		if (ctx->spl_cnt) {
 			/* Line buffers need flushing. */
 			*out = g_string_sized_new(512);
-			for (i = 0; i < ctx->num_enabled_channels; i++) {
-				g_string_append_len(*out, ctx->lines[i]->str, ctx->lines[i]->len);
-				g_string_append_c(*out, '\n');
-			}
+			flush_lines(ctx, *out);
 		}
 		break;
 	}
@@ -206,7 +294,6 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 static int cleanup(struct sr_output *o)
 {
 	struct context *ctx;
-	unsigned int i;
 
 	if (!o)
 		return SR_ERR_ARG;
@@ -215,9 +302,8 @@ static int cleanup(struct sr_output *o)
 		return SR_OK;
 
 	g_free(ctx->channel_index);
-	g_free(ctx->channel_names);
-	for (i = 0; i < ctx->num_enabled_channels; i++)
-		g_string_free(ctx->lines[i], TRUE);
+	g_free(ctx->prefix_len);
+	g_free(ctx->planes);
 	g_free(ctx->lines);
 	g_free(ctx);
 	o->priv = NULL;
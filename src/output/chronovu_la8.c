@@ -27,13 +27,19 @@
 
 #define LOG_PREFIX "output/chronovu-la8"
 
+/*
+ * The hardware captures up to 8MiB of samples, which is also the most
+ * which needs buffering before the trigger position is known.
+ */
+#define LA8_DATA_SIZE	(8 * 1024 * 1024)
+
 struct context {
 	unsigned int num_enabled_channels;
 	gboolean triggered;
 	uint64_t samplerate;
 	uint64_t samplecount;
 	int *channel_index;
-	GString *pretrig_buf;
+	GByteArray *pretrig_buf;
 };
 
 /**
@@ -99,21 +105,27 @@ static int init(struct sr_output *o, GHashTable *options)
 		ctx->num_enabled_channels++;
 	}
 	ctx->channel_index = g_malloc(sizeof(int) * ctx->num_enabled_channels);
-	ctx->pretrig_buf = g_string_sized_new(1024);
+	ctx->pretrig_buf = g_byte_array_sized_new(LA8_DATA_SIZE);
 
 	return SR_OK;
 }
 
-static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
-		GString **out)
+/*
+ * Sample data passes to the sink by reference, it is only copied while
+ * the trigger position is not known yet. Buffered data stays valid until
+ * the sink has written it, the buffer only gets reused in later calls.
+ */
+static int receive_sink(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet,
+		struct sr_output_sink *sink)
 {
 	const struct sr_datafeed_logic *logic;
 	struct context *ctx;
 	GVariant *gvar;
 	uint64_t samplerate;
-	gchar c[4];
+	uint8_t c[4];
+	int ret;
 
-	*out = NULL;
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 	if (!(ctx = o->priv))
@@ -129,36 +141,39 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		} else
 			samplerate = 0;
 		c[0] = samplerate_to_divcount(samplerate);
-		*out = g_string_new_len(c, 1);
 		ctx->triggered = FALSE;
-		break;
+		g_byte_array_set_size(ctx->pretrig_buf, 0);
+		return sr_output_sink_write(sink, c, 1);
 	case SR_DF_TRIGGER:
+		if (ctx->triggered)
+			break;
 		/* Four bytes (little endian) for the trigger point. */
-		c[0] = ctx->samplecount & 0xff;
-		c[1] = (ctx->samplecount >> 8) & 0xff;
-		c[2] = (ctx->samplecount >> 16) & 0xff;
-		c[3] = (ctx->samplecount >> 24) & 0xff;
-		*out = g_string_new_len(c, 4);
-		/* Flush the pre-trigger buffer. */
-		if (ctx->pretrig_buf->len)
-			g_string_append_len(*out, ctx->pretrig_buf->str,
-					ctx->pretrig_buf->len);
+		WL32(c, ctx->samplecount);
 		ctx->triggered = TRUE;
-		break;
+		if ((ret = sr_output_sink_write(sink, c, sizeof(c))) != SR_OK)
+			return ret;
+		/* Flush the pre-trigger buffer. */
+		return sr_output_sink_write_ref(sink, ctx->pretrig_buf->data,
+			ctx->pretrig_buf->len);
 	case SR_DF_LOGIC:
 		logic = packet->payload;
-		if (!ctx->triggered)
-			g_string_append_len(ctx->pretrig_buf, logic->data, logic->length);
-		else
-			*out = g_string_new_len(logic->data, logic->length);
+		if (!logic->unitsize)
+			break;
 		ctx->samplecount += logic->length / logic->unitsize;
+		if (ctx->triggered)
+			return sr_output_sink_write_ref(sink, logic->data,
+				logic->length);
+		g_byte_array_append(ctx->pretrig_buf, logic->data, logic->length);
 		break;
 	case SR_DF_END:
 		if (!ctx->triggered && ctx->pretrig_buf->len) {
 			/* We never got a trigger, submit an empty one. */
-			*out = g_string_sized_new(ctx->pretrig_buf->len + 4);
-			g_string_append_len(*out, "\x00\x00\x00\x00", 4);
-			g_string_append_len(*out, ctx->pretrig_buf->str, ctx->pretrig_buf->len);
+			memset(c, 0, sizeof(c));
+			ctx->triggered = TRUE;
+			if ((ret = sr_output_sink_write(sink, c, sizeof(c))) != SR_OK)
+				return ret;
+			return sr_output_sink_write_ref(sink,
+				ctx->pretrig_buf->data, ctx->pretrig_buf->len);
 		}
 		break;
 	}
@@ -175,7 +190,7 @@ static int cleanup(struct sr_output *o)
 
 	if (o->priv) {
 		ctx = o->priv;
-		g_string_free(ctx->pretrig_buf, TRUE);
+		g_byte_array_free(ctx->pretrig_buf, TRUE);
 		g_free(ctx->channel_index);
 		g_free(o->priv);
 		o->priv = NULL;
@@ -192,6 +207,6 @@ SR_PRIV struct sr_output_module output_chronovu_la8 = {
 	.flags = 0,
 	.options = NULL,
 	.init = init,
-	.receive = receive,
+	.receive_sink = receive_sink,
 	.cleanup = cleanup,
 };
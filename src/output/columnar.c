@@ -0,0 +1,753 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Columnar binary output, for analysis tools which memory-map the file
+ * and scan typed columns instead of parsing text.
+ *
+ * All numbers are little endian. Every section starts at a multiple of
+ * 8 bytes from the start of the file, so the column data is naturally
+ * aligned when the file gets mapped.
+ *
+ * File header:
+ *   8 bytes   magic "SRCOLUMN"
+ *   uint32    format version, 1
+ *   uint32    number of columns
+ *   column descriptors, each padded to a multiple of 8 bytes:
+ *     uint8   type: 1 time (int64), 2 logic (packed sample, bit n is
+ *             the channel with index n), 3 analog (IEEE float)
+ *     uint8   width of a value in bytes
+ *     uint16  length of the name
+ *     uint32  channel index of analog columns, else 0xffffffff
+ *     name    channel name, "time" or "logic", not NUL terminated
+ *
+ * Blocks follow, each starts with:
+ *   4 bytes   tag, "META" or "ROWS"
+ *   uint32    number of entries or rows
+ *   uint64    length of the payload in bytes, a multiple of 8
+ *
+ * A META block holds key/value text pairs, each padded to a multiple
+ * of 8 bytes: uint32 key length, uint32 value length, key, value. Later
+ * META blocks add to or replace earlier values. Keys are the ids of
+ * the config keys in SR_DF_META packets (e.g. "samplerate"), and:
+ *   driver      The driver of the device.
+ *   starttime   Start of the acquisition, in seconds since the epoch.
+ *   time_unit   "ns" or "sample", the unit of the time column. Times
+ *               are nanoseconds since the start when the samplerate is
+ *               known when the first rows get written, else sample numbers.
+ *   trigger     Comma separated row numbers of triggers.
+ *   logic.<n>   Name of the logic channel in bit n.
+ *   <name>.unit Unit of an analog channel.
+ *
+ * A ROWS block (a row group) holds the values of all columns for its
+ * rows, one column after the other in the order of the descriptors,
+ * each column padded to a multiple of 8 bytes.
+ *
+ * Options:
+ *
+ * rows:    The number of rows per row group. Defaults to 65536.
+ *
+ * analog:  The type of analog columns, "float32" or "float64".
+ *          Defaults to "float32".
+ *
+ * time:    Whether to write the time column. Defaults to TRUE.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/columnar"
+
+#define FORMAT_VERSION 1
+#define DEFAULT_GROUP_ROWS (64 * 1024)
+/* Columns may run ahead of others by this many row groups. */
+#define MAX_GROUPS_AHEAD 16
+
+enum column_type {
+	COLUMN_TIME = 1,
+	COLUMN_LOGIC = 2,
+	COLUMN_ANALOG = 3,
+};
+
+struct column {
+	enum column_type type;
+	size_t width;
+	const char *name;
+	struct sr_channel *ch;
+	gboolean have_unit;
+	/* Values not yet written, from offset start on. */
+	GByteArray *data;
+	size_t start;
+};
+
+struct context {
+	/* Options */
+	size_t group_rows;
+	gboolean use_double;
+	gboolean time;
+
+	size_t num_columns;
+	struct column *columns;
+	struct column *logic;
+	size_t first_data;
+
+	gboolean header_done;
+	GHashTable *meta;
+	GHashTable *meta_pending;
+	uint64_t rows_written;
+	uint64_t samplerate;
+	gboolean time_ns;
+	uint64_t time_base_row;
+	uint64_t time_base_ns;
+	gboolean warned_lag;
+
+	void *convbuf;
+	size_t convbuf_size;
+};
+
+static const uint8_t zeros[8];
+
+static size_t pad8(size_t len)
+{
+	return (len + 7) & ~(size_t)7;
+}
+
+static void set_meta(struct context *ctx, const char *key, char *value)
+{
+	g_hash_table_replace(ctx->meta, g_strdup(key), value);
+	g_hash_table_replace(ctx->meta_pending, g_strdup(key), g_strdup(value));
+}
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct context *ctx;
+	struct sr_channel *ch;
+	struct column *col;
+	GSList *l;
+	size_t rows, num_analog, logic_bytes;
+	gboolean have_logic;
+	char *key;
+
+	if (!o || !o->sdi)
+		return SR_ERR_ARG;
+
+	rows = g_variant_get_uint32(g_hash_table_lookup(options, "rows"));
+	if (!rows) {
+		sr_err("Invalid row group size of zero rows.");
+		return SR_ERR_ARG;
+	}
+
+	ctx = g_malloc0(sizeof(struct context));
+	o->priv = ctx;
+	ctx->group_rows = rows;
+	ctx->use_double = !g_strcmp0(g_variant_get_string(
+		g_hash_table_lookup(options, "analog"), NULL), "float64");
+	ctx->time = g_variant_get_boolean(g_hash_table_lookup(options, "time"));
+	ctx->meta = g_hash_table_new_full(g_str_hash, g_str_equal,
+		g_free, g_free);
+	ctx->meta_pending = g_hash_table_new_full(g_str_hash, g_str_equal,
+		g_free, g_free);
+
+	/* The logic column is as wide as the highest enabled channel needs. */
+	have_logic = FALSE;
+	logic_bytes = 0;
+	num_analog = 0;
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (!ch->enabled)
+			continue;
+		if (ch->type == SR_CHANNEL_LOGIC) {
+			have_logic = TRUE;
+			logic_bytes = MAX(logic_bytes, (size_t)ch->index / 8 + 1);
+			key = g_strdup_printf("logic.%d", ch->index);
+			set_meta(ctx, key, g_strdup(ch->name));
+			g_free(key);
+		} else if (ch->type == SR_CHANNEL_ANALOG) {
+			num_analog++;
+		}
+	}
+
+	ctx->num_columns = (ctx->time ? 1 : 0) + (have_logic ? 1 : 0) + num_analog;
+	ctx->columns = g_malloc0(sizeof(ctx->columns[0]) * ctx->num_columns);
+	col = ctx->columns;
+	if (ctx->time) {
+		col->type = COLUMN_TIME;
+		col->width = sizeof(int64_t);
+		col->name = "time";
+		col->data = g_byte_array_new();
+		col++;
+	}
+	ctx->first_data = col - ctx->columns;
+	if (have_logic) {
+		col->type = COLUMN_LOGIC;
+		col->width = logic_bytes;
+		col->name = "logic";
+		col->data = g_byte_array_new();
+		ctx->logic = col++;
+	}
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (!ch->enabled || ch->type != SR_CHANNEL_ANALOG)
+			continue;
+		col->type = COLUMN_ANALOG;
+		col->width = ctx->use_double ? sizeof(double) : sizeof(float);
+		col->name = ch->name;
+		col->ch = ch;
+		col->data = g_byte_array_new();
+		col++;
+	}
+
+	return SR_OK;
+}
+
+static size_t column_rows(const struct column *col)
+{
+	return (col->data->len - col->start) / col->width;
+}
+
+/* Drop the values which were written by the previous call. */
+static void compact_columns(struct context *ctx)
+{
+	struct column *col;
+	size_t i;
+
+	for (i = 0; i < ctx->num_columns; i++) {
+		col = &ctx->columns[i];
+		if (!col->start)
+			continue;
+		g_byte_array_remove_range(col->data, 0, col->start);
+		col->start = 0;
+	}
+}
+
+static size_t pending_rows(const struct context *ctx, gboolean complete)
+{
+	size_t i, rows, count;
+
+	rows = complete ? SIZE_MAX : 0;
+	for (i = ctx->first_data; i < ctx->num_columns; i++) {
+		count = column_rows(&ctx->columns[i]);
+		rows = complete ? MIN(rows, count) : MAX(rows, count);
+	}
+
+	return rows == SIZE_MAX ? 0 : rows;
+}
+
+/* Fill up columns which lag behind, with NaN or low logic samples. */
+static void pad_columns(struct context *ctx, size_t rows)
+{
+	struct column *col;
+	size_t i, count, len;
+	uint8_t *p;
+
+	for (i = ctx->first_data; i < ctx->num_columns; i++) {
+		col = &ctx->columns[i];
+		count = column_rows(col);
+		if (count >= rows)
+			continue;
+		len = col->data->len;
+		g_byte_array_set_size(col->data, len + (rows - count) * col->width);
+		p = col->data->data + len;
+		for (; count < rows; count++, p += col->width) {
+			if (col->type == COLUMN_LOGIC)
+				memset(p, 0, col->width);
+			else if (ctx->use_double)
+				WLDB(p, NAN);
+			else
+				WLFL(p, NAN);
+		}
+	}
+}
+
+static int write_block_header(struct sr_output_sink *sink,
+		const char *tag, uint32_t count, uint64_t length)
+{
+	uint8_t hdr[16];
+
+	memcpy(hdr, tag, 4);
+	WL32(&hdr[4], count);
+	WL64(&hdr[8], length);
+
+	return sr_output_sink_write(sink, hdr, sizeof(hdr));
+}
+
+static int write_padding(struct sr_output_sink *sink, size_t len)
+{
+	return sr_output_sink_write(sink, zeros, pad8(len) - len);
+}
+
+static gint compare_keys(gconstpointer a, gconstpointer b)
+{
+	return strcmp(a, b);
+}
+
+static int write_meta(struct sr_output_sink *sink, GHashTable *meta)
+{
+	GList *keys, *l;
+	const char *value;
+	uint8_t lengths[8];
+	size_t klen, vlen;
+	uint64_t length;
+	int ret;
+
+	if (!g_hash_table_size(meta))
+		return SR_OK;
+
+	/* Sorted keys, for reproducible output. */
+	keys = g_list_sort(g_hash_table_get_keys(meta), compare_keys);
+	length = 0;
+	for (l = keys; l; l = l->next) {
+		value = g_hash_table_lookup(meta, l->data);
+		length += pad8(8 + strlen(l->data) + strlen(value));
+	}
+	ret = write_block_header(sink, "META", g_hash_table_size(meta), length);
+	for (l = keys; l && ret == SR_OK; l = l->next) {
+		value = g_hash_table_lookup(meta, l->data);
+		klen = strlen(l->data);
+		vlen = strlen(value);
+		WL32(&lengths[0], klen);
+		WL32(&lengths[4], vlen);
+		sr_output_sink_write(sink, lengths, sizeof(lengths));
+		sr_output_sink_write(sink, l->data, klen);
+		sr_output_sink_write(sink, value, vlen);
+		ret = write_padding(sink, 8 + klen + vlen);
+	}
+	g_list_free(keys);
+
+	return ret;
+}
+
+static int write_header(struct context *ctx, struct sr_output_sink *sink)
+{
+	const struct column *col;
+	uint8_t buf[16];
+	size_t i, len;
+	int ret;
+
+	ctx->header_done = TRUE;
+	ctx->time_ns = ctx->samplerate != 0;
+	set_meta(ctx, "time_unit", g_strdup(ctx->time_ns ? "ns" : "sample"));
+
+	memcpy(buf, "SRCOLUMN", 8);
+	WL32(&buf[8], FORMAT_VERSION);
+	WL32(&buf[12], ctx->num_columns);
+	ret = sr_output_sink_write(sink, buf, sizeof(buf));
+	for (i = 0; i < ctx->num_columns && ret == SR_OK; i++) {
+		col = &ctx->columns[i];
+		len = strlen(col->name);
+		buf[0] = col->type;
+		buf[1] = col->width;
+		WL16(&buf[2], len);
+		WL32(&buf[4], col->ch ? (uint32_t)col->ch->index : 0xffffffff);
+		sr_output_sink_write(sink, buf, 8);
+		sr_output_sink_write(sink, col->name, len);
+		ret = write_padding(sink, len);
+	}
+	if (ret != SR_OK)
+		return ret;
+
+	/* The full set of metadata, nothing is pending after it. */
+	g_hash_table_remove_all(ctx->meta_pending);
+
+	return write_meta(sink, ctx->meta);
+}
+
+static int write_pending_meta(struct context *ctx, struct sr_output_sink *sink)
+{
+	int ret;
+
+	ret = write_meta(sink, ctx->meta_pending);
+	g_hash_table_remove_all(ctx->meta_pending);
+
+	return ret;
+}
+
+static uint64_t row_time(const struct context *ctx, uint64_t row)
+{
+	uint64_t delta;
+
+	if (!ctx->time_ns)
+		return row;
+
+	/* Split the division to keep the product from overflowing. */
+	delta = row - ctx->time_base_row;
+	return ctx->time_base_ns + delta / ctx->samplerate * 1000000000 +
+		delta % ctx->samplerate * 1000000000 / ctx->samplerate;
+}
+
+static int write_rows(struct context *ctx, struct sr_output_sink *sink,
+		size_t rows)
+{
+	struct column *col;
+	uint64_t length, row;
+	size_t i, len;
+	uint8_t *p;
+	int ret;
+
+	if (!ctx->header_done) {
+		if ((ret = write_header(ctx, sink)) != SR_OK)
+			return ret;
+	}
+	if ((ret = write_pending_meta(ctx, sink)) != SR_OK)
+		return ret;
+
+	if (ctx->time) {
+		col = &ctx->columns[0];
+		g_byte_array_set_size(col->data, col->start + rows * col->width);
+		p = col->data->data + col->start;
+		for (row = 0; row < rows; row++, p += col->width)
+			WL64(p, row_time(ctx, ctx->rows_written + row));
+	}
+
+	length = 0;
+	for (i = 0; i < ctx->num_columns; i++)
+		length += pad8(rows * ctx->columns[i].width);
+	ret = write_block_header(sink, "ROWS", rows, length);
+
+	/* Column data stays in place until the next packet arrives. */
+	for (i = 0; i < ctx->num_columns && ret == SR_OK; i++) {
+		col = &ctx->columns[i];
+		len = rows * col->width;
+		sr_output_sink_write_ref(sink, col->data->data + col->start, len);
+		ret = write_padding(sink, len);
+		col->start += len;
+	}
+	ctx->rows_written += rows;
+
+	return ret;
+}
+
+/* Write the row groups which are complete, or all rows at the end. */
+static int flush_rows(struct context *ctx, struct sr_output_sink *sink,
+		gboolean all)
+{
+	size_t rows, ahead;
+	int ret;
+
+	ahead = pending_rows(ctx, FALSE);
+	if (all) {
+		pad_columns(ctx, ahead);
+	} else if (ahead > MAX_GROUPS_AHEAD * ctx->group_rows &&
+			pending_rows(ctx, TRUE) < ctx->group_rows) {
+		/* Some channel doesn't deliver, keep memory use bounded. */
+		if (!ctx->warned_lag)
+			sr_warn("Channels without data, padding their columns.");
+		ctx->warned_lag = TRUE;
+		pad_columns(ctx, ahead);
+	}
+
+	while ((rows = pending_rows(ctx, TRUE))) {
+		if (rows < ctx->group_rows && !all)
+			break;
+		rows = MIN(rows, ctx->group_rows);
+		if ((ret = write_rows(ctx, sink, rows)) != SR_OK)
+			return ret;
+	}
+
+	return SR_OK;
+}
+
+static void process_logic(struct context *ctx,
+		const struct sr_datafeed_logic *logic)
+{
+	struct column *col;
+	const uint8_t *src;
+	size_t num_samples, len, copy;
+	uint8_t *p;
+
+	if (!(col = ctx->logic) || !logic->unitsize)
+		return;
+
+	num_samples = logic->length / logic->unitsize;
+	if (logic->unitsize == col->width) {
+		g_byte_array_append(col->data, logic->data,
+			num_samples * col->width);
+		return;
+	}
+
+	len = col->data->len;
+	g_byte_array_set_size(col->data, len + num_samples * col->width);
+	p = col->data->data + len;
+	src = logic->data;
+	copy = MIN(logic->unitsize, col->width);
+	while (num_samples--) {
+		memcpy(p, src, copy);
+		memset(p + copy, 0, col->width - copy);
+		p += col->width;
+		src += logic->unitsize;
+	}
+}
+
+static int process_analog(struct context *ctx,
+		const struct sr_datafeed_analog *analog)
+{
+	struct column *col;
+	struct sr_channel *ch;
+	const float *fdata;
+	const double *ddata;
+	GSList *l;
+	size_t i, num_channels, idx, smpl, len, size;
+	uint8_t *p;
+	char *unit, *key;
+	int ret;
+
+	num_channels = g_slist_length(analog->meaning->channels);
+	if (!num_channels || !analog->num_samples)
+		return SR_OK;
+
+	size = (size_t)analog->num_samples * num_channels *
+		(ctx->use_double ? sizeof(double) : sizeof(float));
+	if (size > ctx->convbuf_size) {
+		g_free(ctx->convbuf);
+		ctx->convbuf = g_malloc(size);
+		ctx->convbuf_size = size;
+	}
+	if (ctx->use_double)
+		ret = sr_analog_to_double(analog, ctx->convbuf);
+	else
+		ret = sr_analog_to_float(analog, ctx->convbuf);
+	if (ret != SR_OK)
+		return ret;
+	fdata = ctx->convbuf;
+	ddata = ctx->convbuf;
+
+	for (l = analog->meaning->channels, idx = 0; l; l = l->next, idx++) {
+		ch = l->data;
+		col = NULL;
+		for (i = ctx->first_data; i < ctx->num_columns; i++) {
+			if (ctx->columns[i].ch == ch) {
+				col = &ctx->columns[i];
+				break;
+			}
+		}
+		if (!col)
+			continue;
+
+		if (!col->have_unit &&
+				sr_analog_unit_to_string(analog, &unit) == SR_OK) {
+			key = g_strdup_printf("%s.unit", col->name);
+			set_meta(ctx, key, unit);
+			g_free(key);
+			col->have_unit = TRUE;
+		}
+
+		len = col->data->len;
+		g_byte_array_set_size(col->data,
+			len + analog->num_samples * col->width);
+		p = col->data->data + len;
+		for (smpl = 0; smpl < analog->num_samples; smpl++) {
+			if (ctx->use_double)
+				WLDB(p, ddata[smpl * num_channels + idx]);
+			else
+				WLFL(p, fdata[smpl * num_channels + idx]);
+			p += col->width;
+		}
+	}
+
+	return SR_OK;
+}
+
+static char *meta_value(const struct sr_key_info *info, GVariant *data)
+{
+	if (info->datatype == SR_T_UINT64)
+		return g_strdup_printf("%" PRIu64, g_variant_get_uint64(data));
+	if (info->datatype == SR_T_STRING)
+		return g_strdup(g_variant_get_string(data, NULL));
+
+	return g_variant_print(data, FALSE);
+}
+
+static void process_meta(struct context *ctx,
+		const struct sr_datafeed_meta *meta)
+{
+	const struct sr_config *src;
+	const struct sr_key_info *info;
+	GSList *l;
+	uint64_t row;
+
+	for (l = meta->config; l; l = l->next) {
+		src = l->data;
+		if (!(info = sr_key_info_get(SR_KEY_CONFIG, src->key)))
+			continue;
+		set_meta(ctx, info->id, meta_value(info, src->data));
+		if (src->key != SR_CONF_SAMPLERATE)
+			continue;
+		if (ctx->time_ns) {
+			/* Times of later rows follow the new samplerate. */
+			row = ctx->rows_written + pending_rows(ctx, FALSE);
+			ctx->time_base_ns = row_time(ctx, row);
+			ctx->time_base_row = row;
+		}
+		ctx->samplerate = g_variant_get_uint64(src->data);
+		if (!ctx->samplerate)
+			ctx->time_ns = FALSE;
+	}
+}
+
+static void process_header(const struct sr_output *o,
+		const struct sr_datafeed_header *hdr)
+{
+	struct context *ctx;
+	GVariant *gvar;
+
+	ctx = o->priv;
+	if (!ctx->samplerate && sr_config_get(o->sdi->driver, o->sdi, NULL,
+			SR_CONF_SAMPLERATE, &gvar) == SR_OK) {
+		ctx->samplerate = g_variant_get_uint64(gvar);
+		g_variant_unref(gvar);
+	}
+	if (ctx->samplerate)
+		set_meta(ctx, "samplerate",
+			g_strdup_printf("%" PRIu64, ctx->samplerate));
+	if (o->sdi->driver)
+		set_meta(ctx, "driver", g_strdup(o->sdi->driver->name));
+	set_meta(ctx, "starttime", g_strdup_printf("%" PRId64 ".%06ld",
+		(int64_t)hdr->starttime.tv_sec, (long)hdr->starttime.tv_usec));
+}
+
+static void process_trigger(struct context *ctx)
+{
+	const char *prev;
+	uint64_t row;
+
+	/* The trigger is at the next sample of the logic data. */
+	if (ctx->logic)
+		row = ctx->rows_written + column_rows(ctx->logic);
+	else
+		row = ctx->rows_written + pending_rows(ctx, FALSE);
+
+	prev = g_hash_table_lookup(ctx->meta, "trigger");
+	if (prev)
+		set_meta(ctx, "trigger", g_strdup_printf("%s,%" PRIu64, prev, row));
+	else
+		set_meta(ctx, "trigger", g_strdup_printf("%" PRIu64, row));
+}
+
+static int receive_sink(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet,
+		struct sr_output_sink *sink)
+{
+	struct context *ctx;
+	int ret;
+
+	if (!o || !o->sdi)
+		return SR_ERR_ARG;
+	if (!(ctx = o->priv))
+		return SR_ERR_ARG;
+
+	compact_columns(ctx);
+
+	ret = SR_OK;
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		process_header(o, packet->payload);
+		break;
+	case SR_DF_META:
+		process_meta(ctx, packet->payload);
+		break;
+	case SR_DF_TRIGGER:
+		process_trigger(ctx);
+		break;
+	case SR_DF_LOGIC:
+		process_logic(ctx, packet->payload);
+		ret = flush_rows(ctx, sink, FALSE);
+		break;
+	case SR_DF_ANALOG:
+		if ((ret = process_analog(ctx, packet->payload)) == SR_OK)
+			ret = flush_rows(ctx, sink, FALSE);
+		break;
+	case SR_DF_FRAME_END:
+		/* Keep the columns aligned at frame boundaries. */
+		pad_columns(ctx, pending_rows(ctx, FALSE));
+		break;
+	case SR_DF_END:
+		if ((ret = flush_rows(ctx, sink, TRUE)) != SR_OK)
+			break;
+		if (!ctx->header_done)
+			ret = write_header(ctx, sink);
+		else
+			ret = write_pending_meta(ctx, sink);
+		break;
+	}
+
+	return ret;
+}
+
+static int cleanup(struct sr_output *o)
+{
+	struct context *ctx;
+	size_t i;
+
+	if (!o)
+		return SR_ERR_ARG;
+
+	if (!(ctx = o->priv))
+		return SR_OK;
+
+	for (i = 0; i < ctx->num_columns; i++)
+		g_byte_array_free(ctx->columns[i].data, TRUE);
+	g_free(ctx->columns);
+	g_hash_table_destroy(ctx->meta);
+	g_hash_table_destroy(ctx->meta_pending);
+	g_free(ctx->convbuf);
+	g_free(ctx);
+	o->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "rows", "Rows per group", "Number of rows in a row group", NULL, NULL },
+	{ "analog", "Analog type", "Type of analog columns", NULL, NULL },
+	{ "time", "Time column", "Output the sample time as the first column", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	GSList *l = NULL;
+
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_uint32(DEFAULT_GROUP_ROWS));
+		options[1].def = g_variant_ref_sink(g_variant_new_string("float32"));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("float32")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("float64")));
+		options[1].values = l;
+		options[2].def = g_variant_ref_sink(g_variant_new_boolean(TRUE));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_output_module output_columnar = {
+	.id = "columnar",
+	.name = "Columnar",
+	.desc = "Binary columns of typed values, for analysis tools",
+	.exts = (const char *[]){"srcol", NULL},
+	.flags = 0,
+	.options = get_options,
+	.init = init,
+	.receive_sink = receive_sink,
+	.cleanup = cleanup,
+};
@@ -0,0 +1,302 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Streaming compression of the output of any output module, see the
+ * "compress" option in output.c. The output gets compressed as it is
+ * produced, into a gzip or zstd stream which ends with SR_DF_END. A
+ * following acquisition appends another gzip member or zstd frame,
+ * which the tools decompress as one stream.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/compress"
+
+/* Room which gets added to the output buffer for each compression step. */
+#define COMPRESS_OUT_STEP	(64 * 1024)
+
+enum compress_method {
+	COMPRESS_GZIP,
+	COMPRESS_ZSTD,
+};
+
+struct sr_output_compress {
+	enum compress_method method;
+	int level;
+	/* The stream was ended, the next data starts another one. */
+	gboolean finished;
+#ifdef HAVE_ZLIB
+	z_stream strm;
+#endif
+#ifdef HAVE_LIBZSTD
+	ZSTD_CCtx *cctx;
+#endif
+	/* Compressed output of the most recent call. */
+	GByteArray *out;
+};
+
+static int compress_init(struct sr_output_compress *comp)
+{
+#ifdef HAVE_LIBZSTD
+	size_t ret;
+	guint threads;
+#endif
+
+	switch (comp->method) {
+	case COMPRESS_GZIP:
+#ifdef HAVE_ZLIB
+		/* Window bits plus 16 selects the gzip format. */
+		if (deflateInit2(&comp->strm, comp->level, Z_DEFLATED,
+				MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+			return SR_ERR;
+		return SR_OK;
+#else
+		break;
+#endif
+	case COMPRESS_ZSTD:
+#ifdef HAVE_LIBZSTD
+		if (!(comp->cctx = ZSTD_createCCtx()))
+			return SR_ERR_MALLOC;
+		ZSTD_CCtx_setParameter(comp->cctx, ZSTD_c_compressionLevel,
+			comp->level);
+		/*
+		 * Have the library compress on worker threads, which
+		 * needs a build of it with multi-threading support.
+		 */
+		threads = g_get_num_processors();
+		if (threads > 1) {
+			ret = ZSTD_CCtx_setParameter(comp->cctx,
+				ZSTD_c_nbWorkers, threads);
+			if (ZSTD_isError(ret))
+				sr_dbg("No zstd threads: %s",
+					ZSTD_getErrorName(ret));
+		}
+		return SR_OK;
+#else
+		break;
+#endif
+	}
+
+	return SR_ERR_NA;
+}
+
+/**
+ * Create a compressor from a specification of the form "method" or
+ * "method:level", where the method is "gzip" or "zstd".
+ *
+ * @param[in] spec The specification, "none" (or empty) for no compression.
+ * @param[out] comp The new compressor, NULL for no compression.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid specification.
+ * @retval SR_ERR_NA The method is not available in this build.
+ *
+ * @private
+ */
+SR_PRIV int sr_output_compress_new(const char *spec,
+		struct sr_output_compress **comp)
+{
+	struct sr_output_compress *c;
+	enum compress_method method;
+	char **parts;
+	char *end;
+	long level, max_level;
+	int ret;
+
+	*comp = NULL;
+	if (!spec || !*spec || !strcmp(spec, "none"))
+		return SR_OK;
+
+	parts = g_strsplit(spec, ":", 2);
+	if (!strcmp(parts[0], "gzip")) {
+		method = COMPRESS_GZIP;
+		level = 6;
+		max_level = 9;
+	} else if (!strcmp(parts[0], "zstd")) {
+		method = COMPRESS_ZSTD;
+		level = 3;
+		max_level = 22;
+	} else {
+		sr_err("Unknown compression method '%s'.", parts[0]);
+		g_strfreev(parts);
+		return SR_ERR_ARG;
+	}
+	if (parts[1]) {
+		level = strtol(parts[1], &end, 10);
+		if (end == parts[1] || *end || level < 1 || level > max_level) {
+			sr_err("Compression level '%s' out of range (1-%ld).",
+				parts[1], max_level);
+			g_strfreev(parts);
+			return SR_ERR_ARG;
+		}
+	}
+	g_strfreev(parts);
+
+	c = g_malloc0(sizeof(*c));
+	c->method = method;
+	c->level = level;
+	if ((ret = compress_init(c)) != SR_OK) {
+		if (ret == SR_ERR_NA)
+			sr_err("Compression method '%s' is not supported.", spec);
+		g_free(c);
+		return ret;
+	}
+	c->out = g_byte_array_new();
+	*comp = c;
+
+	return SR_OK;
+}
+
+#ifdef HAVE_ZLIB
+static int gzip_data(struct sr_output_compress *comp,
+		const void *data, size_t len, gboolean finish)
+{
+	z_stream *strm;
+	size_t used;
+	int ret;
+
+	strm = &comp->strm;
+	if (comp->finished) {
+		deflateReset(strm);
+		comp->finished = FALSE;
+	}
+	strm->next_in = (Bytef *)data;
+	strm->avail_in = len;
+	do {
+		used = comp->out->len;
+		g_byte_array_set_size(comp->out, used + COMPRESS_OUT_STEP);
+		strm->next_out = comp->out->data + used;
+		strm->avail_out = COMPRESS_OUT_STEP;
+		ret = deflate(strm, finish ? Z_FINISH : Z_NO_FLUSH);
+		g_byte_array_set_size(comp->out,
+			used + COMPRESS_OUT_STEP - strm->avail_out);
+		if (ret == Z_STREAM_ERROR)
+			return SR_ERR;
+	} while (strm->avail_in || !strm->avail_out
+		|| (finish && ret != Z_STREAM_END));
+	comp->finished = finish;
+
+	return SR_OK;
+}
+#endif
+
+#ifdef HAVE_LIBZSTD
+static int zstd_data(struct sr_output_compress *comp,
+		const void *data, size_t len, gboolean finish)
+{
+	ZSTD_inBuffer in;
+	ZSTD_outBuffer out;
+	size_t used, remain;
+
+	in.src = data;
+	in.size = len;
+	in.pos = 0;
+	do {
+		used = comp->out->len;
+		g_byte_array_set_size(comp->out, used + COMPRESS_OUT_STEP);
+		out.dst = comp->out->data + used;
+		out.size = COMPRESS_OUT_STEP;
+		out.pos = 0;
+		remain = ZSTD_compressStream2(comp->cctx, &out, &in,
+			finish ? ZSTD_e_end : ZSTD_e_continue);
+		g_byte_array_set_size(comp->out, used + out.pos);
+		if (ZSTD_isError(remain)) {
+			sr_err("zstd compression failed: %s",
+				ZSTD_getErrorName(remain));
+			return SR_ERR;
+		}
+	} while (in.pos < in.size || (finish && remain));
+	comp->finished = finish;
+
+	return SR_OK;
+}
+#endif
+
+/**
+ * Compress a piece of output.
+ *
+ * @param[in] comp The compressor.
+ * @param[in] data The output. Can be NULL if len is 0.
+ * @param[in] len The length of the output in bytes.
+ * @param[in] finish End the compressed stream after the data.
+ * @param[out] out The compressed data, which stays valid until the
+ *                 next call. Can be empty, the compressor buffers.
+ * @param[out] out_len The length of the compressed data.
+ *
+ * @private
+ */
+SR_PRIV int sr_output_compress_data(struct sr_output_compress *comp,
+		const void *data, size_t len, gboolean finish,
+		const uint8_t **out, size_t *out_len)
+{
+	int ret;
+
+	g_byte_array_set_size(comp->out, 0);
+	ret = SR_ERR_NA;
+	if (len || finish) {
+		switch (comp->method) {
+		case COMPRESS_GZIP:
+#ifdef HAVE_ZLIB
+			ret = gzip_data(comp, data, len, finish);
+#endif
+			break;
+		case COMPRESS_ZSTD:
+#ifdef HAVE_LIBZSTD
+			ret = zstd_data(comp, data, len, finish);
+#endif
+			break;
+		}
+	} else {
+		ret = SR_OK;
+	}
+	*out = comp->out->data;
+	*out_len = comp->out->len;
+
+	return ret;
+}
+
+/** @private */
+SR_PRIV void sr_output_compress_free(struct sr_output_compress *comp)
+{
+	if (!comp)
+		return;
+
+#ifdef HAVE_ZLIB
+	if (comp->method == COMPRESS_GZIP)
+		deflateEnd(&comp->strm);
+#endif
+#ifdef HAVE_LIBZSTD
+	if (comp->method == COMPRESS_ZSTD)
+		ZSTD_freeCCtx(comp->cctx);
+#endif
+	g_byte_array_free(comp->out, TRUE);
+	g_free(comp);
+}
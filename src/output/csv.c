@@ -69,6 +69,16 @@ struct ctx_channel {
 	float min, max;
 };
 
+/*
+ * Where the text of a data column comes from. Gets determined once for
+ * the row layout, is applied to every sample of a dump.
+ */
+struct csv_column {
+	enum sr_channeltype type;
+	size_t chan_idx;	/* Index into the channels[] array. */
+	size_t data_idx;	/* Index into the analog or logic sample. */
+};
+
 struct context {
 	/* Options */
 	const char *gnuplot;
@@ -99,6 +109,8 @@ struct context {
 	uint8_t *previous_sample;
 	float *analog_samples;
 	uint8_t *logic_samples;
+	struct csv_column *columns;
+	size_t value_len;
 	const char *xlabel;	/* Don't free: will point to a static string. */
 	const char *title;	/* Don't free: will point into the driver struct. */
 
@@ -116,7 +128,7 @@ struct context {
 
 static int init(struct sr_output *o, GHashTable *options)
 {
-	unsigned int i, analog_channels, logic_channels;
+	unsigned int i, col, analog_channels, logic_channels;
 	struct context *ctx;
 	struct sr_channel *ch;
 	const char *label_string;
@@ -148,6 +160,8 @@ static int init(struct sr_output *o, GHashTable *options)
 	ctx->dedup = g_variant_get_boolean(g_hash_table_lookup(options, "dedup"));
 	ctx->dedup &= ctx->time;
 
+	ctx->value_len = strlen(ctx->value);
+
 	if (*ctx->gnuplot && g_strcmp0(ctx->record, "\n"))
 		sr_warn("gnuplot record separator must be newline.");
 
@@ -207,6 +221,18 @@ static int init(struct sr_output *o, GHashTable *options)
 		}
 	}
 
+	/* Map data columns to their analog or logic sample data. */
+	ctx->columns = g_malloc0(sizeof(ctx->columns[0]) * i);
+	analog_channels = logic_channels = 0;
+	for (col = 0; col < i; col++) {
+		ctx->columns[col].chan_idx = col;
+		ctx->columns[col].type = ctx->channels[col].ch->type;
+		if (ctx->columns[col].type == SR_CHANNEL_ANALOG)
+			ctx->columns[col].data_idx = analog_channels++;
+		else if (ctx->columns[col].type == SR_CHANNEL_LOGIC)
+			ctx->columns[col].data_idx = logic_channels++;
+	}
+
 	return SR_OK;
 }
 
@@ -377,7 +403,6 @@ static void process_logic(struct context *ctx,
 {
 	unsigned int i, j, ch, num_samples;
 	int idx;
-	uint8_t *sample;
 
 	num_samples = logic->length / logic->unitsize;
 	ctx->channels_seen += ctx->logic_channel_count;
@@ -393,18 +418,117 @@ static void process_logic(struct context *ctx,
 
 	for (j = ch = 0; ch < ctx->num_logic_channels; j++) {
 		if (ctx->channels[j].ch->type == SR_CHANNEL_LOGIC) {
-			for (i = 0; i < num_samples; i++) {
-				sample = logic->data + i * logic->unitsize;
-				idx = ctx->channels[j].ch->index;
-				if (ctx->label_do && !ctx->label_names)
-					ctx->channels[j].label = "logic";
-				ctx->logic_samples[i * ctx->num_logic_channels + ch] = sample[idx / 8] & (1 << (idx % 8));
-			}
+			idx = ctx->channels[j].ch->index;
+			if (ctx->label_do && !ctx->label_names)
+				ctx->channels[j].label = "logic";
+			if (idx < logic->unitsize * 8)
+				sr_logic_channel_extract(logic->data,
+					logic->unitsize, num_samples, idx,
+					&ctx->logic_samples[ch],
+					ctx->num_logic_channels);
+			else
+				for (i = 0; i < num_samples; i++)
+					ctx->logic_samples[i * ctx->num_logic_channels + ch] = 0;
 			ch++;
 		}
 	}
 }
 
+/*
+ * Text formatting of sample values, without the overhead of printf(3)
+ * format string interpretation for every value. Output is identical to
+ * the "%" PRIu64 and "%g" formats (C locale).
+ */
+static void append_u64(GString *s, uint64_t value)
+{
+	char buf[24], *p;
+
+	p = &buf[sizeof(buf)];
+	do {
+		*--p = '0' + value % 10;
+		value /= 10;
+	} while (value);
+	g_string_append_len(s, p, &buf[sizeof(buf)] - p);
+}
+
+static void append_float(GString *s, float value)
+{
+	static const double pow10[] = {
+		1e-4, 1e-3, 1e-2, 1e-1,
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+	};
+	char buf[16], *p, *end;
+	double v;
+	long long digits;
+	int exp, pos;
+
+	/*
+	 * The "%g" format with its default precision of six digits uses
+	 * fixed point notation for decimal exponents from -4 to 5. This
+	 * range gets handled here. Scaling the float value to six digits
+	 * then is exact in double precision, rounding to the nearest
+	 * integer matches printf(3) properly. Emit the digits, strip
+	 * trailing zeros. Other values take the slow path.
+	 */
+	v = fabs(value);
+	if (v == 0.0) {
+		g_string_append(s, signbit(value) ? "-0" : "0");
+		return;
+	}
+	if (!(v >= 1e-4 && v < 1e6)) {
+		g_string_append_printf(s, "%g", value);
+		return;
+	}
+	for (exp = 5; exp > -4 && v < pow10[exp + 4]; exp--)
+		;
+	digits = llrint(v * pow10[9 - exp]);
+	if (digits < 100000 && exp > -4)
+		digits = llrint(v * pow10[9 - --exp]);
+	if (digits >= 1000000) {
+		if (++exp > 5) {
+			g_string_append_printf(s, "%g", value);
+			return;
+		}
+		digits = llrint(v * pow10[9 - exp]);
+	}
+
+	/* Format six digits, the decimal point goes after "exp + 1" digits. */
+	p = buf;
+	if (value < 0)
+		*p++ = '-';
+	if (exp < 0) {
+		*p++ = '0';
+		*p++ = '.';
+		for (pos = exp + 1; pos < 0; pos++)
+			*p++ = '0';
+	}
+	end = p + 6;
+	for (pos = 5; pos >= 0; pos--) {
+		p[pos] = '0' + digits % 10;
+		digits /= 10;
+	}
+	if (exp >= 0 && exp < 5) {
+		memmove(&p[exp + 2], &p[exp + 1], 5 - exp);
+		p[exp + 1] = '.';
+		end++;
+	}
+	if (exp < 5) {
+		while (end[-1] == '0')
+			end--;
+		if (end[-1] == '.')
+			end--;
+	}
+	g_string_append_len(s, buf, end - buf);
+}
+
+static void append_separator(struct context *ctx, GString *s)
+{
+	if (ctx->value_len == 1)
+		g_string_append_c(s, ctx->value[0]);
+	else
+		g_string_append_len(s, ctx->value, ctx->value_len);
+}
+
 static void dump_saved_values(struct context *ctx, GString **out)
 {
 	unsigned int i, j, analog_size, num_channels;
@@ -412,6 +536,9 @@ static void dump_saved_values(struct context *ctx, GString **out)
 	uint64_t sample_time_u64;
 	float *analog_sample, value;
 	uint8_t *logic_sample;
+	const struct csv_column *col;
+	struct ctx_channel *channel;
+	size_t row_size, out_len;
 
 	/* If we haven't seen samples we're expecting, skip them. */
 	if ((ctx->num_analog_channels && !ctx->analog_samples) ||
@@ -420,11 +547,31 @@ static void dump_saved_values(struct context *ctx, GString **out)
 	} else {
 		sr_info("Dumping %u samples", ctx->num_samples);
 
-		if (!*out)
-			*out = g_string_sized_new(512);
 		num_channels =
 		    ctx->num_logic_channels + ctx->num_analog_channels;
 
+		/*
+		 * Have the output text allocated in one go. Estimate the
+		 * row size from its columns, analog values typically take
+		 * up to a dozen characters.
+		 */
+		row_size = strlen(ctx->record);
+		row_size += (num_channels + 2) * ctx->value_len;
+		row_size += ctx->num_logic_channels;
+		row_size += ctx->num_analog_channels * 12;
+		if (ctx->time)
+			row_size += 20;
+		if (ctx->do_trigger)
+			row_size += 1;
+		row_size *= ctx->num_samples;
+		if (!*out) {
+			*out = g_string_sized_new(row_size);
+		} else {
+			out_len = (*out)->len;
+			g_string_set_size(*out, out_len + row_size);
+			g_string_truncate(*out, out_len);
+		}
+
 		if (ctx->label_do) {
 			if (ctx->time)
 				g_string_append_printf(*out, "%s%s",
@@ -441,7 +588,7 @@ static void dump_saved_values(struct context *ctx, GString **out)
 				g_string_append_printf(*out, "Trigger%s",
 						       ctx->value);
 			/* Drop last separator. */
-			g_string_truncate(*out, (*out)->len - 1);
+			g_string_truncate(*out, (*out)->len - ctx->value_len);
 			g_string_append(*out, ctx->record);
 
 			ctx->label_do = FALSE;
@@ -474,40 +621,37 @@ static void dump_saved_values(struct context *ctx, GString **out)
 			}
 
 			if (ctx->time && !ctx->sample_rate) {
-				g_string_append_printf(*out, "0%s", ctx->value);
+				g_string_append_c(*out, '0');
 			} else if (ctx->time) {
 				sample_time_dbl = ctx->out_sample_count++;
 				sample_time_dbl /= ctx->sample_rate;
 				sample_time_dbl *= ctx->sample_scale;
 				sample_time_u64 = sample_time_dbl;
-				g_string_append_printf(*out, "%" PRIu64 "%s",
-					sample_time_u64, ctx->value);
+				append_u64(*out, sample_time_u64);
 			}
 
 			for (j = 0; j < num_channels; j++) {
-				if (ctx->channels[j].ch->type == SR_CHANNEL_ANALOG) {
-					value = ctx->analog_samples[i * ctx->num_analog_channels + j];
-					ctx->channels[j].max =
-					    fmax(value, ctx->channels[j].max);
-					ctx->channels[j].min =
-					    fmin(value, ctx->channels[j].min);
-					g_string_append_printf(*out, "%g%s",
-						value, ctx->value);
-				} else if (ctx->channels[j].ch->type == SR_CHANNEL_LOGIC) {
-					g_string_append_printf(*out, "%c%s",
-							       ctx->logic_samples[i * ctx->num_logic_channels + j] ? '1' : '0', ctx->value);
-				} else {
-					sr_warn("Unexpected channel type: %d",
-						ctx->channels[i].ch->type);
+				col = &ctx->columns[j];
+				if (j || ctx->time)
+					append_separator(ctx, *out);
+				if (col->type == SR_CHANNEL_ANALOG) {
+					value = analog_sample[col->data_idx];
+					channel = &ctx->channels[col->chan_idx];
+					channel->max = fmax(value, channel->max);
+					channel->min = fmin(value, channel->min);
+					append_float(*out, value);
+				} else if (col->type == SR_CHANNEL_LOGIC) {
+					g_string_append_c(*out,
+						logic_sample[col->data_idx] ? '1' : '0');
 				}
 			}
 
 			if (ctx->do_trigger) {
-				g_string_append_printf(*out, "%d%s",
-					ctx->trigger, ctx->value);
+				if (num_channels || ctx->time)
+					append_separator(ctx, *out);
+				g_string_append_c(*out, ctx->trigger ? '1' : '0');
 				ctx->trigger = FALSE;
 			}
-			g_string_truncate(*out, (*out)->len - 1);
 			g_string_append(*out, ctx->record);
 		}
 	}
@@ -729,6 +873,7 @@ static int cleanup(struct sr_output *o)
 		g_free((gpointer)ctx->gnuplot);
 		g_free((gpointer)ctx->value);
 		g_free(ctx->previous_sample);
+		g_free(ctx->columns);
 		g_free(ctx->channels);
 		g_free(o->priv);
 		o->priv = NULL;
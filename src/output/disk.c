@@ -0,0 +1,406 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Streaming file writer for long recordings, shared by the disk output
+ * sink (see output.c) and the ZIP archive writer (see zip.c).
+ *
+ * Data gets collected in two aligned blocks. A full block is written by
+ * a thread while the caller fills the other one, so that the latency of
+ * the disk does not stall acquisitions. Optionally the file is written
+ * around the page cache (O_DIRECT, or F_NOCACHE on Mac OS), which keeps
+ * long recordings from evicting everything else on the host. The file
+ * gets synchronized to the disk according to a policy.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/disk"
+
+/* Size of one block, a multiple of the alignment. */
+#define DISK_BLOCK_SIZE		(4 * 1024 * 1024)
+/* Alignment of memory, file offsets and sizes for direct I/O. */
+#define DISK_ALIGN		4096
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+struct disk_block {
+	uint8_t *mem;
+	uint8_t *data;
+	size_t fill;
+};
+
+struct sr_disk_writer {
+	int fd;
+	gboolean direct;
+	enum sr_disk_sync sync;
+	struct disk_block blocks[2];
+	/* The block which the caller fills. */
+	unsigned int cur;
+	GThread *thread;
+	GMutex mutex;
+	GCond cond;
+	/* The block which the thread writes, NULL when it is idle. */
+	struct disk_block *pending;
+	gboolean quit;
+	/* Sticky error of a failed write. */
+	int error;
+	struct sr_disk_stats stats;
+};
+
+static int disk_sync(int fd)
+{
+#ifdef _WIN32
+	return _commit(fd);
+#else
+	return fsync(fd);
+#endif
+}
+
+/* Write a block to the file, and account for it. */
+static int block_write(struct sr_disk_writer *dw, const uint8_t *data,
+	size_t len)
+{
+	int64_t start_us, us;
+	ssize_t ret;
+	size_t left;
+
+	start_us = g_get_monotonic_time();
+	for (left = len; left; ) {
+		ret = write(dw->fd, data, left);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 0) {
+			sr_err("Output write error: %s", g_strerror(errno));
+			return SR_ERR_IO;
+		}
+		data += ret;
+		left -= ret;
+	}
+	if (dw->sync == SR_DISK_SYNC_BLOCK && disk_sync(dw->fd) != 0) {
+		sr_err("Output sync error: %s", g_strerror(errno));
+		return SR_ERR_IO;
+	}
+	us = g_get_monotonic_time() - start_us;
+
+	g_mutex_lock(&dw->mutex);
+	dw->stats.bytes += len;
+	dw->stats.writes++;
+	dw->stats.write_us_total += us;
+	dw->stats.write_us_max = MAX(dw->stats.write_us_max, (uint64_t)us);
+	g_mutex_unlock(&dw->mutex);
+
+	return SR_OK;
+}
+
+static gpointer disk_thread(gpointer data)
+{
+	struct sr_disk_writer *dw;
+	struct disk_block *block;
+	int ret;
+
+	dw = data;
+
+	g_mutex_lock(&dw->mutex);
+	for (;;) {
+		while (!dw->pending && !dw->quit)
+			g_cond_wait(&dw->cond, &dw->mutex);
+		if (!(block = dw->pending))
+			break;
+		g_mutex_unlock(&dw->mutex);
+		ret = SR_OK;
+		if (!dw->error)
+			ret = block_write(dw, block->data, block->fill);
+		g_mutex_lock(&dw->mutex);
+		if (ret != SR_OK)
+			dw->error = ret;
+		block->fill = 0;
+		dw->pending = NULL;
+		g_cond_broadcast(&dw->cond);
+	}
+	g_mutex_unlock(&dw->mutex);
+
+	return NULL;
+}
+
+/* Wait until the thread wrote the pending block. Caller holds the lock. */
+static void wait_idle(struct sr_disk_writer *dw)
+{
+	if (!dw->pending)
+		return;
+	dw->stats.stalls++;
+	while (dw->pending)
+		g_cond_wait(&dw->cond, &dw->mutex);
+}
+
+/* Have the current block written, continue in the other one. */
+static int block_submit(struct sr_disk_writer *dw)
+{
+	struct disk_block *block;
+	int ret;
+
+	block = &dw->blocks[dw->cur];
+	if (!dw->thread) {
+		ret = block_write(dw, block->data, block->fill);
+		block->fill = 0;
+		return ret;
+	}
+
+	g_mutex_lock(&dw->mutex);
+	wait_idle(dw);
+	ret = dw->error;
+	if (ret == SR_OK) {
+		dw->pending = block;
+		g_cond_broadcast(&dw->cond);
+	}
+	g_mutex_unlock(&dw->mutex);
+	dw->cur ^= 1;
+
+	return ret;
+}
+
+/* Bypass the page cache, where the platform and file system allow. */
+static int open_direct(const char *filename, int flags)
+{
+	int fd;
+
+#if defined(O_DIRECT)
+	fd = g_open(filename, flags | O_DIRECT, 0666);
+	if (fd >= 0 || errno != EINVAL)
+		return fd;
+	sr_warn("No direct I/O for '%s', using the page cache.", filename);
+	fd = g_open(filename, flags, 0666);
+#elif defined(F_NOCACHE)
+	fd = g_open(filename, flags, 0666);
+	if (fd >= 0 && fcntl(fd, F_NOCACHE, 1) != 0)
+		sr_warn("No direct I/O for '%s', using the page cache.",
+			filename);
+#else
+	sr_warn("No direct I/O support, using the page cache.");
+	fd = g_open(filename, flags, 0666);
+#endif
+
+	return fd;
+}
+
+/**
+ * Create a file for streaming writes.
+ *
+ * @param[in] filename The file, gets overwritten.
+ * @param[in] direct Write around the page cache, where supported.
+ * @param[in] sync When to synchronize the file with the disk.
+ *
+ * @returns The writer, or NULL when the file can't get created.
+ */
+SR_PRIV struct sr_disk_writer *sr_disk_writer_new(const char *filename,
+	gboolean direct, enum sr_disk_sync sync)
+{
+	struct sr_disk_writer *dw;
+	struct disk_block *block;
+	unsigned int i;
+	int flags, fd;
+
+	flags = O_WRONLY | O_CREAT | O_TRUNC | O_BINARY;
+	if (direct)
+		fd = open_direct(filename, flags);
+	else
+		fd = g_open(filename, flags, 0666);
+	if (fd < 0) {
+		sr_err("Cannot create file '%s': %s",
+			filename, g_strerror(errno));
+		return NULL;
+	}
+
+	dw = g_malloc0(sizeof(*dw));
+	dw->fd = fd;
+	dw->direct = direct;
+	dw->sync = sync;
+	for (i = 0; i < G_N_ELEMENTS(dw->blocks); i++) {
+		block = &dw->blocks[i];
+		block->mem = g_malloc(DISK_BLOCK_SIZE + DISK_ALIGN);
+		block->data = (uint8_t *)(((uintptr_t)block->mem + DISK_ALIGN - 1)
+			& ~(uintptr_t)(DISK_ALIGN - 1));
+		sr_mem_alloc_add(SR_MEM_OUTPUT, DISK_BLOCK_SIZE + DISK_ALIGN);
+	}
+	g_mutex_init(&dw->mutex);
+	g_cond_init(&dw->cond);
+	dw->thread = g_thread_try_new("sr-disk", disk_thread, dw, NULL);
+	if (!dw->thread)
+		sr_warn("Cannot create the writer thread, writing inline.");
+
+	return dw;
+}
+
+/**
+ * Write data to the file. The data gets copied.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_IO Writing failed, now or before.
+ */
+SR_PRIV int sr_disk_writer_write(struct sr_disk_writer *dw,
+	const void *data, size_t len)
+{
+	struct disk_block *block;
+	const uint8_t *p;
+	size_t n;
+	int ret;
+
+	if (dw->fd < 0)
+		return SR_ERR_IO;
+
+	p = data;
+	while (len) {
+		block = &dw->blocks[dw->cur];
+		n = MIN(len, DISK_BLOCK_SIZE - block->fill);
+		memcpy(block->data + block->fill, p, n);
+		block->fill += n;
+		p += n;
+		len -= n;
+		if (block->fill < DISK_BLOCK_SIZE)
+			break;
+		if ((ret = block_submit(dw)) != SR_OK)
+			return ret;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Wait until the data of full blocks was written. Data of a partial
+ * block stays buffered, it must be written in whole blocks.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_IO Writing failed.
+ */
+SR_PRIV int sr_disk_writer_flush(struct sr_disk_writer *dw)
+{
+	int ret;
+
+	g_mutex_lock(&dw->mutex);
+	while (dw->pending)
+		g_cond_wait(&dw->cond, &dw->mutex);
+	ret = dw->error;
+	g_mutex_unlock(&dw->mutex);
+
+	return ret;
+}
+
+/**
+ * Write out all data, synchronize and close the file.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_IO Writing failed.
+ */
+SR_PRIV int sr_disk_writer_close(struct sr_disk_writer *dw)
+{
+	struct disk_block *block;
+	int ret, flags;
+
+	if (dw->fd < 0)
+		return dw->error;
+
+	ret = sr_disk_writer_flush(dw);
+
+	/* The tail is not a whole block, write it through the cache. */
+	block = &dw->blocks[dw->cur];
+	if (ret == SR_OK && block->fill) {
+#ifdef O_DIRECT
+		flags = fcntl(dw->fd, F_GETFL);
+		if (dw->direct && flags >= 0 && (flags & O_DIRECT))
+			fcntl(dw->fd, F_SETFL, flags & ~O_DIRECT);
+#else
+		(void)flags;
+#endif
+		ret = block_write(dw, block->data, block->fill);
+	}
+	block->fill = 0;
+
+	if (ret == SR_OK && dw->sync != SR_DISK_SYNC_NONE
+			&& disk_sync(dw->fd) != 0) {
+		sr_err("Output sync error: %s", g_strerror(errno));
+		ret = SR_ERR_IO;
+	}
+	if (close(dw->fd) != 0 && ret == SR_OK) {
+		sr_err("Output close error: %s", g_strerror(errno));
+		ret = SR_ERR_IO;
+	}
+	dw->fd = -1;
+	if (ret != SR_OK)
+		dw->error = ret;
+
+	sr_dbg("Wrote %" PRIu64 " bytes in %" PRIu64 " writes, %" PRIu64
+		" us max. latency, %" PRIu64 " stalls.", dw->stats.bytes,
+		dw->stats.writes, dw->stats.write_us_max, dw->stats.stalls);
+
+	return ret;
+}
+
+/** Get the write statistics. */
+SR_PRIV void sr_disk_writer_stats(struct sr_disk_writer *dw,
+	struct sr_disk_stats *stats)
+{
+	g_mutex_lock(&dw->mutex);
+	*stats = dw->stats;
+	g_mutex_unlock(&dw->mutex);
+}
+
+/**
+ * Free a writer. A file which was not closed by sr_disk_writer_close()
+ * gets closed, without the data of the partial block.
+ *
+ * @param[in] dw The writer. Can be NULL.
+ */
+SR_PRIV void sr_disk_writer_free(struct sr_disk_writer *dw)
+{
+	unsigned int i;
+
+	if (!dw)
+		return;
+
+	if (dw->thread) {
+		g_mutex_lock(&dw->mutex);
+		dw->quit = TRUE;
+		g_cond_broadcast(&dw->cond);
+		g_mutex_unlock(&dw->mutex);
+		g_thread_join(dw->thread);
+	}
+	if (dw->fd >= 0)
+		close(dw->fd);
+	for (i = 0; i < G_N_ELEMENTS(dw->blocks); i++) {
+		g_free(dw->blocks[i].mem);
+		sr_mem_free_add(SR_MEM_OUTPUT, DISK_BLOCK_SIZE + DISK_ALIGN);
+	}
+	g_cond_clear(&dw->cond);
+	g_mutex_clear(&dw->mutex);
+	g_free(dw);
+}
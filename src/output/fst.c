@@ -0,0 +1,991 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * FST (Fast Signal Trace) output, the native format of GTKWave. Files
+ * are a sequence of blocks (tag byte, big endian length, content):
+ *
+ * - The header, with the time range, counts and the timescale. It gets
+ *   written with placeholders first, and is updated at the end.
+ * - Value change blocks. Each covers a range of time, holds the values
+ *   of all signals at its start (the "frame"), the compressed changes
+ *   per signal, a table of where the signals' data start, and the
+ *   compressed table of the block's timestamps. Readers only inflate
+ *   the blocks and signals they display.
+ * - The geometry (the bit width of every signal).
+ * - The hierarchy: a "libsigrok" scope with a scope per channel group
+ *   and the channels which are not in any group. Channels which are in
+ *   several groups are aliases of the same signal.
+ *
+ * Logic channels are 1 bit wires, analog channels are real variables.
+ * Changes get collected until enough of them accumulated, and are
+ * written once data of all channels was received up to a sample
+ * number. The timescale is the one the VCD output picks.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/fst"
+
+#define FST_BL_HDR		0
+#define FST_BL_VCDATA_DYN_ALIAS	5
+#define FST_BL_GEOM		3
+#define FST_BL_HIER		4
+
+#define FST_ST_VCD_MODULE	0
+#define FST_ST_VCD_SCOPE	254
+#define FST_ST_VCD_UPSCOPE	255
+#define FST_VT_VCD_REAL		3
+#define FST_VT_VCD_WIRE		16
+#define FST_VD_IMPLICIT		0
+#define FST_FT_VERILOG		0
+
+#define FST_HDR_SIM_VERSION_SIZE	128
+#define FST_HDR_DATE_SIZE	119
+#define FST_HDR_LENGTH		330
+#define FST_DOUBLE_ENDTEST	2.7182818284590452354
+
+/* Signal data shorter than this is stored, compression won't pay off. */
+#define FST_COMPRESS_MIN	32
+
+/* Number of collected value changes which triggers writing a block. */
+#define BLOCK_CHANGES		(1024 * 1024)
+
+union fst_value {
+	uint8_t bit;
+	double real;
+};
+
+struct fst_change {
+	uint64_t snum;
+	union fst_value value;
+};
+
+struct fst_signal {
+	struct sr_channel *ch;
+	gboolean is_real;
+	/* Last received value, for change detection. */
+	gboolean have_cur;
+	union fst_value cur;
+	/* Value at the end of the last written block. */
+	gboolean have_value;
+	union fst_value value;
+	/* Changes which were not written yet, in sample order. */
+	GArray *changes;
+	uint64_t rcvd_snum;
+	/* Per block: the signal's data, and its position in the block. */
+	GByteArray *data;
+	uint64_t pos;
+};
+
+struct context {
+	char *filename;
+	FILE *file;
+	gboolean header_done;
+	gboolean finished;
+	uint64_t samplerate;
+	uint64_t period;
+	uint64_t ts_factor;
+	int timescale;
+	struct fst_signal *signals;
+	size_t num_signals;
+	size_t num_logic;
+	uint64_t logic_snum;
+	uint8_t *last_logic;
+	size_t last_logic_size;
+	size_t num_changes;
+	GByteArray *hier;
+	uint64_t num_scopes;
+	uint64_t num_vars;
+	uint64_t start_time;
+	uint64_t end_time;
+	uint64_t num_blocks;
+	GArray *times;
+	GByteArray *block;
+	GByteArray *scratch;
+	float *fbuf;
+	size_t fbuf_size;
+};
+
+static void put_u64be(GByteArray *a, uint64_t value)
+{
+	uint8_t buf[sizeof(uint64_t)];
+
+	WB64(buf, value);
+	g_byte_array_append(a, buf, sizeof(buf));
+}
+
+static void put_varint(GByteArray *a, uint64_t value)
+{
+	uint8_t buf[10];
+	size_t len;
+
+	len = 0;
+	while (value >= 0x80) {
+		buf[len++] = (value & 0x7f) | 0x80;
+		value >>= 7;
+	}
+	buf[len++] = value;
+	g_byte_array_append(a, buf, len);
+}
+
+static void put_string(GByteArray *a, const char *s)
+{
+	g_byte_array_append(a, (const guint8 *)s, strlen(s) + 1);
+}
+
+/*
+ * Compress the data with zlib's format, return the length or zero when
+ * compression did not shrink it (readers tell the cases apart by the
+ * compressed length being different from the uncompressed length).
+ */
+static size_t compress_data(GByteArray *dst, const uint8_t *src, size_t len)
+{
+#ifdef HAVE_ZLIB
+	uLongf clen;
+	size_t pos;
+
+	if (len < FST_COMPRESS_MIN)
+		return 0;
+	pos = dst->len;
+	clen = compressBound(len);
+	g_byte_array_set_size(dst, pos + clen);
+	if (compress2(dst->data + pos, &clen, src, len, Z_DEFAULT_COMPRESSION) != Z_OK
+			|| clen >= len) {
+		g_byte_array_set_size(dst, pos);
+		return 0;
+	}
+	g_byte_array_set_size(dst, pos + clen);
+
+	return clen;
+#else
+	(void)dst;
+	(void)src;
+	(void)len;
+
+	return 0;
+#endif
+}
+
+/*
+ * The hierarchy block is read with gzip's functions, which also pass
+ * uncompressed data through.
+ */
+static void gzip_data(GByteArray *dst, const uint8_t *src, size_t len)
+{
+#ifdef HAVE_ZLIB
+	z_stream strm;
+	size_t pos;
+
+	memset(&strm, 0, sizeof(strm));
+	if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+			MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK) {
+		pos = dst->len;
+		g_byte_array_set_size(dst, pos + deflateBound(&strm, len));
+		strm.next_in = (Bytef *)src;
+		strm.avail_in = len;
+		strm.next_out = dst->data + pos;
+		strm.avail_out = dst->len - pos;
+		if (deflate(&strm, Z_FINISH) == Z_STREAM_END) {
+			g_byte_array_set_size(dst, pos + strm.total_out);
+			deflateEnd(&strm);
+			return;
+		}
+		deflateEnd(&strm);
+		g_byte_array_set_size(dst, pos);
+	}
+#endif
+	g_byte_array_append(dst, src, len);
+}
+
+static void hier_scope(struct context *ctx, const char *name)
+{
+	g_byte_array_append(ctx->hier, (const guint8 []){FST_ST_VCD_SCOPE,
+		FST_ST_VCD_MODULE}, 2);
+	put_string(ctx->hier, name);
+	put_string(ctx->hier, "");
+	ctx->num_scopes++;
+}
+
+static void hier_upscope(struct context *ctx)
+{
+	g_byte_array_append(ctx->hier, (const guint8 []){FST_ST_VCD_UPSCOPE}, 1);
+}
+
+/*
+ * Declare a channel's variable in the current scope. The first
+ * declaration of a channel creates its signal, later ones alias it.
+ */
+static void hier_var(struct context *ctx, struct sr_channel *ch, size_t *handles)
+{
+	struct fst_signal *sig;
+	gboolean is_real;
+	size_t alias;
+
+	is_real = ch->type == SR_CHANNEL_ANALOG;
+	g_byte_array_append(ctx->hier, (const guint8 []){is_real ?
+		FST_VT_VCD_REAL : FST_VT_VCD_WIRE, FST_VD_IMPLICIT}, 2);
+	put_string(ctx->hier, ch->name);
+	put_varint(ctx->hier, is_real ? sizeof(double) : 1);
+	ctx->num_vars++;
+
+	alias = handles[ch->index];
+	put_varint(ctx->hier, alias);
+	if (alias)
+		return;
+
+	sig = &ctx->signals[ctx->num_signals++];
+	handles[ch->index] = ctx->num_signals;
+	sig->ch = ch;
+	sig->is_real = is_real;
+	sig->changes = g_array_new(FALSE, FALSE, sizeof(struct fst_change));
+	sig->data = g_byte_array_new();
+	if (!is_real)
+		ctx->num_logic++;
+}
+
+static gboolean channel_wanted(const struct sr_channel *ch)
+{
+	return ch->enabled && (ch->type == SR_CHANNEL_LOGIC ||
+		ch->type == SR_CHANNEL_ANALOG);
+}
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct context *ctx;
+	struct sr_channel_group *cg;
+	struct sr_channel *ch;
+	GSList *l, *lc;
+	size_t *handles;
+	size_t count;
+	int max_index;
+
+	(void)options;
+
+	if (!o->filename || o->filename[0] == '\0') {
+		sr_info("fst output module requires a file name, cannot save.");
+		return SR_ERR_ARG;
+	}
+	if (!o->sdi)
+		return SR_ERR_ARG;
+
+	count = 0;
+	max_index = 0;
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		max_index = MAX(max_index, ch->index);
+		if (channel_wanted(ch))
+			count++;
+	}
+	if (!count) {
+		sr_err("No logic or analog channels enabled.");
+		return SR_ERR_ARG;
+	}
+
+	ctx = g_malloc0(sizeof(*ctx));
+	o->priv = ctx;
+	ctx->filename = g_strdup(o->filename);
+	ctx->signals = g_malloc0(sizeof(ctx->signals[0]) * count);
+	ctx->hier = g_byte_array_new();
+	ctx->times = g_array_new(FALSE, FALSE, sizeof(uint64_t));
+	ctx->block = g_byte_array_new();
+	ctx->scratch = g_byte_array_new();
+
+	/* Signal handles are 1 based in the order of declaration. */
+	handles = g_malloc0(sizeof(handles[0]) * (max_index + 1));
+	hier_scope(ctx, PACKAGE_NAME);
+	for (l = o->sdi->channel_groups; l; l = l->next) {
+		cg = l->data;
+		for (lc = cg->channels; lc; lc = lc->next) {
+			if (channel_wanted(lc->data))
+				break;
+		}
+		if (!lc)
+			continue;
+		hier_scope(ctx, cg->name);
+		for (lc = cg->channels; lc; lc = lc->next) {
+			if (channel_wanted(lc->data))
+				hier_var(ctx, lc->data, handles);
+		}
+		hier_upscope(ctx);
+	}
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (channel_wanted(ch) && !handles[ch->index])
+			hier_var(ctx, ch, handles);
+	}
+	hier_upscope(ctx);
+	g_free(handles);
+
+	return SR_OK;
+}
+
+/* Same timescale selection as the VCD output. */
+static uint64_t get_timescale_freq(uint64_t samplerate)
+{
+	uint64_t timescale;
+	size_t max_up_scale;
+
+	timescale = 1;
+	while (timescale < samplerate)
+		timescale *= 10;
+
+	max_up_scale = 2;
+	while (max_up_scale--) {
+		if (timescale / samplerate * samplerate == timescale)
+			break;
+		timescale *= 10;
+	}
+
+	return timescale;
+}
+
+static uint64_t snum_to_ts(const struct context *ctx, uint64_t snum)
+{
+	double ts;
+
+	if (ctx->ts_factor)
+		return snum * ctx->ts_factor;
+
+	ts = (double)snum;
+	ts /= ctx->samplerate;
+	ts *= ctx->period;
+
+	return (uint64_t)nearbyint(ts);
+}
+
+static void write_header(struct context *ctx)
+{
+	uint8_t hdr[FST_HDR_LENGTH], *p;
+	double endtest;
+	time_t t;
+	char *s;
+
+	memset(hdr, 0, sizeof(hdr));
+	p = hdr;
+	*p++ = FST_BL_HDR;
+	WB64(p, FST_HDR_LENGTH - 1);
+	p += 8;
+	WB64(p, ctx->start_time);
+	p += 8;
+	WB64(p, ctx->end_time);
+	p += 8;
+	endtest = FST_DOUBLE_ENDTEST;
+	memcpy(p, &endtest, sizeof(endtest));
+	p += 8;
+	/* Writer memory usage, informational only. */
+	WB64(p, 0);
+	p += 8;
+	WB64(p, ctx->num_scopes);
+	p += 8;
+	WB64(p, ctx->num_vars);
+	p += 8;
+	WB64(p, ctx->num_signals);
+	p += 8;
+	WB64(p, ctx->num_blocks);
+	p += 8;
+	*p++ = (uint8_t)(int8_t)ctx->timescale;
+	s = g_strdup_printf("%s %s", PACKAGE_NAME,
+		sr_package_version_string_get());
+	strncpy((char *)p, s, FST_HDR_SIM_VERSION_SIZE - 1);
+	g_free(s);
+	p += FST_HDR_SIM_VERSION_SIZE;
+	t = time(NULL);
+	strncpy((char *)p, ctime(&t), FST_HDR_DATE_SIZE - 1);
+	p += FST_HDR_DATE_SIZE;
+	*p++ = FST_FT_VERILOG;
+	/* Time zero, signed. */
+	WB64(p, 0);
+
+	fwrite(hdr, 1, sizeof(hdr), ctx->file);
+}
+
+static int start_file(const struct sr_output *o)
+{
+	struct context *ctx;
+	GVariant *gvar;
+	uint64_t period;
+
+	ctx = o->priv;
+	ctx->header_done = TRUE;
+
+	if (!ctx->samplerate && sr_config_get(o->sdi->driver, o->sdi, NULL,
+			SR_CONF_SAMPLERATE, &gvar) == SR_OK) {
+		ctx->samplerate = g_variant_get_uint64(gvar);
+		g_variant_unref(gvar);
+	}
+	if (ctx->samplerate) {
+		ctx->period = get_timescale_freq(ctx->samplerate);
+		if (ctx->period % ctx->samplerate == 0)
+			ctx->ts_factor = ctx->period / ctx->samplerate;
+	} else {
+		/* Without a samplerate times are sample numbers. */
+		ctx->period = 1;
+		ctx->ts_factor = 1;
+	}
+	for (period = ctx->period; period >= 10; period /= 10)
+		ctx->timescale--;
+
+	if (!(ctx->file = g_fopen(ctx->filename, "wb"))) {
+		sr_err("Cannot create file '%s'.", ctx->filename);
+		return SR_ERR_IO;
+	}
+	write_header(ctx);
+
+	return SR_OK;
+}
+
+static void add_change(struct context *ctx, struct fst_signal *sig,
+	uint64_t snum, const struct fst_change *change)
+{
+	struct fst_change c;
+
+	c = *change;
+	c.snum = snum;
+	g_array_append_val(sig->changes, c);
+	ctx->num_changes++;
+}
+
+struct fst_logic_walk {
+	struct context *ctx;
+	uint64_t snum;
+};
+
+static int logic_change(uint64_t offset, const uint8_t *sample, void *cb_data)
+{
+	struct fst_logic_walk *walk;
+	struct context *ctx;
+	struct fst_signal *sig;
+	struct fst_change c;
+	size_t i, index;
+	uint8_t bit;
+
+	walk = cb_data;
+	ctx = walk->ctx;
+	for (i = 0; i < ctx->num_signals; i++) {
+		sig = &ctx->signals[i];
+		if (sig->is_real)
+			continue;
+		index = sig->ch->index;
+		bit = (sample[index / 8] >> (index % 8)) & 1;
+		if (sig->have_cur && bit == sig->cur.bit)
+			continue;
+		sig->have_cur = TRUE;
+		sig->cur.bit = bit;
+		c.value.bit = bit;
+		add_change(ctx, sig, walk->snum + offset, &c);
+	}
+
+	return SR_OK;
+}
+
+static int process_logic(struct context *ctx,
+	const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
+	struct fst_logic_walk walk;
+	size_t unit_size, count;
+
+	if (!ctx->num_logic)
+		return SR_OK;
+
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		unit_size = logic->unitsize;
+		count = unit_size ? logic->length / unit_size : 0;
+	} else {
+		rle = packet->payload;
+		unit_size = rle->unitsize;
+		count = rle->num_samples;
+	}
+	if (!count)
+		return SR_OK;
+	if (unit_size > ctx->last_logic_size) {
+		ctx->last_logic = g_realloc(ctx->last_logic, unit_size);
+		ctx->last_logic_size = unit_size;
+	}
+
+	walk.ctx = ctx;
+	walk.snum = ctx->logic_snum;
+	ctx->logic_snum += count;
+
+	return sr_logic_changes_foreach(packet, ctx->last_logic,
+		walk.snum == 0, logic_change, &walk);
+}
+
+static int process_analog(struct context *ctx,
+	const struct sr_datafeed_analog *analog)
+{
+	struct fst_signal *sig;
+	struct fst_change c;
+	GSList *l;
+	size_t i, idx, smpl, size;
+	double value, prev;
+	int ret;
+
+	if (!analog->num_samples)
+		return SR_OK;
+
+	size = analog->num_samples * sizeof(float);
+	if (size > ctx->fbuf_size) {
+		g_free(ctx->fbuf);
+		ctx->fbuf = g_malloc(size);
+		ctx->fbuf_size = size;
+	}
+
+	for (l = analog->meaning->channels, idx = 0; l; l = l->next, idx++) {
+		sig = NULL;
+		for (i = 0; i < ctx->num_signals; i++) {
+			if (ctx->signals[i].ch == l->data) {
+				sig = &ctx->signals[i];
+				break;
+			}
+		}
+		if (!sig || !sig->is_real)
+			continue;
+		ret = sr_analog_channel_to_float(analog, idx, ctx->fbuf, 1);
+		if (ret != SR_OK)
+			return ret;
+
+		for (smpl = 0; smpl < analog->num_samples; smpl++) {
+			value = ctx->fbuf[smpl];
+			prev = sig->cur.real;
+			if (sig->have_cur &&
+					(value == prev || (isnan(value) && isnan(prev))))
+				continue;
+			sig->have_cur = TRUE;
+			sig->cur.real = value;
+			c.value.real = value;
+			add_change(ctx, sig, sig->rcvd_snum + smpl, &c);
+		}
+		sig->rcvd_snum += analog->num_samples;
+	}
+
+	return SR_OK;
+}
+
+static int cmp_u64(gconstpointer a, gconstpointer b)
+{
+	uint64_t va, vb;
+
+	va = *(const uint64_t *)a;
+	vb = *(const uint64_t *)b;
+
+	return (va > vb) - (va < vb);
+}
+
+/* The received sample count which all signals have reached. */
+static uint64_t complete_snum(const struct context *ctx)
+{
+	const struct fst_signal *sig;
+	uint64_t snum, rcvd;
+	size_t i;
+
+	snum = UINT64_MAX;
+	for (i = 0; i < ctx->num_signals; i++) {
+		sig = &ctx->signals[i];
+		rcvd = sig->is_real ? sig->rcvd_snum : ctx->logic_snum;
+		snum = MIN(snum, rcvd);
+	}
+
+	return snum;
+}
+
+/* Signals without a value yet start as 'x' (or NaN for reals). */
+static void append_frame_value(GByteArray *frame, const struct fst_signal *sig,
+	gboolean have_value, const union fst_value *value)
+{
+	double real;
+	uint8_t c;
+
+	if (sig->is_real) {
+		real = have_value ? value->real : NAN;
+		g_byte_array_append(frame, (const guint8 *)&real, sizeof(real));
+	} else {
+		c = have_value ? '0' + value->bit : 'x';
+		g_byte_array_append(frame, &c, 1);
+	}
+}
+
+/*
+ * Write a value change block with the changes before sample number
+ * 'upto'. The final block also carries the time at 'end_snum', as the
+ * length of the capture.
+ */
+static int write_block(struct context *ctx, uint64_t upto,
+	gboolean final, uint64_t end_snum)
+{
+	struct fst_signal *sig;
+	struct fst_change *c;
+	GByteArray *blk, *frame, *tdata, *scratch;
+	uint64_t *times, ts, tidx, last_tidx, prev, mem_required, pos, prevpos;
+	union fst_value value;
+	gboolean have_value;
+	uint8_t *p;
+	size_t i, j, n, num_times, clen, zerocnt, len_offset;
+
+	/* The sorted, unique timestamps of the block. */
+	g_array_set_size(ctx->times, 0);
+	for (i = 0; i < ctx->num_signals; i++) {
+		sig = &ctx->signals[i];
+		for (j = 0; j < sig->changes->len; j++) {
+			c = &g_array_index(sig->changes, struct fst_change, j);
+			if (c->snum >= upto)
+				break;
+			ts = snum_to_ts(ctx, c->snum);
+			g_array_append_val(ctx->times, ts);
+		}
+	}
+	if (final) {
+		ts = snum_to_ts(ctx, end_snum);
+		g_array_append_val(ctx->times, ts);
+	}
+	if (!ctx->times->len)
+		return SR_OK;
+	g_array_sort(ctx->times, cmp_u64);
+	times = (uint64_t *)ctx->times->data;
+	num_times = 1;
+	for (i = 1; i < ctx->times->len; i++) {
+		if (times[i] != times[num_times - 1])
+			times[num_times++] = times[i];
+	}
+
+	/*
+	 * Values at the block's first time go to the frame, later changes
+	 * to the signals' data: varints of the time index delta and (for
+	 * bits) the value, reals are followed by the native double.
+	 */
+	frame = g_byte_array_new();
+	mem_required = 0;
+	for (i = 0; i < ctx->num_signals; i++) {
+		sig = &ctx->signals[i];
+		g_byte_array_set_size(sig->data, 0);
+		have_value = sig->have_value;
+		value = sig->value;
+		tidx = 0;
+		last_tidx = 0;
+		for (n = 0; n < sig->changes->len; n++) {
+			c = &g_array_index(sig->changes, struct fst_change, n);
+			if (c->snum >= upto)
+				break;
+			ts = snum_to_ts(ctx, c->snum);
+			while (times[tidx] < ts)
+				tidx++;
+			if (tidx == 0) {
+				have_value = TRUE;
+				value = c->value;
+				continue;
+			}
+			if (sig->is_real) {
+				put_varint(sig->data, ((tidx - last_tidx) << 1) | 1);
+				g_byte_array_append(sig->data,
+					(const guint8 *)&c->value.real, sizeof(double));
+			} else {
+				put_varint(sig->data, ((tidx - last_tidx) << 2) |
+					(c->value.bit << 1));
+			}
+			last_tidx = tidx;
+		}
+		append_frame_value(frame, sig, have_value, &value);
+		mem_required += sig->data->len;
+
+		/* The values at the end of the block. */
+		if (n) {
+			c = &g_array_index(sig->changes, struct fst_change, n - 1);
+			sig->have_value = TRUE;
+			sig->value = c->value;
+		}
+		g_array_remove_range(sig->changes, 0, n);
+		ctx->num_changes -= n;
+	}
+
+	blk = ctx->block;
+	scratch = ctx->scratch;
+	g_byte_array_set_size(blk, 0);
+	g_byte_array_append(blk, (const guint8 []){FST_BL_VCDATA_DYN_ALIAS}, 1);
+	len_offset = blk->len;
+	put_u64be(blk, 0);
+	put_u64be(blk, times[0]);
+	put_u64be(blk, times[num_times - 1]);
+	put_u64be(blk, mem_required);
+
+	/* The frame, compressed when that makes it shorter. */
+	g_byte_array_set_size(scratch, 0);
+	clen = compress_data(scratch, frame->data, frame->len);
+	put_varint(blk, frame->len);
+	put_varint(blk, clen ? clen : frame->len);
+	put_varint(blk, ctx->num_signals);
+	if (clen)
+		g_byte_array_append(blk, scratch->data, clen);
+	else
+		g_byte_array_append(blk, frame->data, frame->len);
+	g_byte_array_free(frame, TRUE);
+
+	/*
+	 * The signals' data, each prefixed by its uncompressed length, or
+	 * zero when it is stored. Positions are relative to the pack type,
+	 * so that zero means "no data".
+	 */
+	put_varint(blk, ctx->num_signals);
+	pos = blk->len;
+	g_byte_array_append(blk, (const guint8 *)"Z", 1);
+	for (i = 0; i < ctx->num_signals; i++) {
+		sig = &ctx->signals[i];
+		sig->pos = 0;
+		if (!sig->data->len)
+			continue;
+		sig->pos = blk->len - pos;
+		g_byte_array_set_size(scratch, 0);
+		clen = compress_data(scratch, sig->data->data, sig->data->len);
+		put_varint(blk, clen ? sig->data->len : 0);
+		if (clen)
+			g_byte_array_append(blk, scratch->data, clen);
+		else
+			g_byte_array_append(blk, sig->data->data, sig->data->len);
+	}
+
+	/* The position table: deltas, and runs of signals without data. */
+	j = blk->len;
+	prevpos = 0;
+	zerocnt = 0;
+	for (i = 0; i < ctx->num_signals; i++) {
+		sig = &ctx->signals[i];
+		if (!sig->pos) {
+			zerocnt++;
+			continue;
+		}
+		if (zerocnt) {
+			put_varint(blk, zerocnt << 1);
+			zerocnt = 0;
+		}
+		put_varint(blk, ((sig->pos - prevpos) << 1) | 1);
+		prevpos = sig->pos;
+	}
+	if (zerocnt)
+		put_varint(blk, zerocnt << 1);
+	put_u64be(blk, blk->len - j);
+
+	/* The time table, deltas to the previous time. */
+	tdata = g_byte_array_new();
+	prev = 0;
+	for (i = 0; i < num_times; i++) {
+		put_varint(tdata, times[i] - prev);
+		prev = times[i];
+	}
+	clen = compress_data(blk, tdata->data, tdata->len);
+	if (!clen) {
+		g_byte_array_append(blk, tdata->data, tdata->len);
+		clen = tdata->len;
+	}
+	put_u64be(blk, tdata->len);
+	put_u64be(blk, clen);
+	put_u64be(blk, num_times);
+	g_byte_array_free(tdata, TRUE);
+
+	p = blk->data + len_offset;
+	WB64(p, blk->len - len_offset);
+	fwrite(blk->data, 1, blk->len, ctx->file);
+
+	if (!ctx->num_blocks)
+		ctx->start_time = times[0];
+	ctx->end_time = times[num_times - 1];
+	ctx->num_blocks++;
+
+	return ferror(ctx->file) ? SR_ERR_IO : SR_OK;
+}
+
+/* Write a block when enough changes accumulated. */
+static int check_block(struct context *ctx)
+{
+	if (ctx->num_changes < BLOCK_CHANGES)
+		return SR_OK;
+
+	return write_block(ctx, complete_snum(ctx), FALSE, 0);
+}
+
+static int finish_file(struct context *ctx)
+{
+	struct fst_signal *sig;
+	GByteArray *blk, *geom;
+	uint64_t end_snum;
+	size_t i, clen;
+	uint8_t *p;
+	int ret;
+
+	if (!ctx->file || ctx->finished)
+		return SR_OK;
+	ctx->finished = TRUE;
+
+	/* The capture's length is the largest received sample count. */
+	end_snum = ctx->logic_snum;
+	for (i = 0; i < ctx->num_signals; i++) {
+		sig = &ctx->signals[i];
+		if (sig->is_real)
+			end_snum = MAX(end_snum, sig->rcvd_snum);
+	}
+	ret = write_block(ctx, UINT64_MAX, TRUE, end_snum);
+
+	/* Geometry: bit widths, zero for reals. */
+	geom = g_byte_array_new();
+	for (i = 0; i < ctx->num_signals; i++)
+		put_varint(geom, ctx->signals[i].is_real ? 0 : 1);
+	blk = ctx->block;
+	g_byte_array_set_size(blk, 0);
+	g_byte_array_append(blk, (const guint8 []){FST_BL_GEOM}, 1);
+	put_u64be(blk, 0);
+	put_u64be(blk, geom->len);
+	put_u64be(blk, ctx->num_signals);
+	clen = compress_data(blk, geom->data, geom->len);
+	if (!clen)
+		g_byte_array_append(blk, geom->data, geom->len);
+	p = blk->data + 1;
+	WB64(p, blk->len - 1);
+	fwrite(blk->data, 1, blk->len, ctx->file);
+	g_byte_array_free(geom, TRUE);
+
+	/* Hierarchy. */
+	g_byte_array_set_size(blk, 0);
+	g_byte_array_append(blk, (const guint8 []){FST_BL_HIER}, 1);
+	put_u64be(blk, 0);
+	put_u64be(blk, ctx->hier->len);
+	gzip_data(blk, ctx->hier->data, ctx->hier->len);
+	p = blk->data + 1;
+	WB64(p, blk->len - 1);
+	fwrite(blk->data, 1, blk->len, ctx->file);
+
+	/* The header with the final counts and time range. */
+	if (fseek(ctx->file, 0, SEEK_SET) == 0)
+		write_header(ctx);
+	else
+		ret = SR_ERR_IO;
+	if (ferror(ctx->file))
+		ret = SR_ERR_IO;
+	if (fclose(ctx->file) != 0)
+		ret = SR_ERR_IO;
+	ctx->file = NULL;
+	if (ret != SR_OK)
+		sr_err("Cannot write file '%s'.", ctx->filename);
+
+	return ret;
+}
+
+static int receive(const struct sr_output *o,
+	const struct sr_datafeed_packet *packet, GString **out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_meta *meta;
+	const struct sr_config *src;
+	GSList *l;
+	int ret;
+
+	*out = NULL;
+	if (!o || !o->sdi || !(ctx = o->priv))
+		return SR_ERR_ARG;
+
+	switch (packet->type) {
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key != SR_CONF_SAMPLERATE)
+				continue;
+			/* The timescale is fixed once the file is started. */
+			if (!ctx->header_done)
+				ctx->samplerate = g_variant_get_uint64(src->data);
+		}
+		break;
+	case SR_DF_LOGIC:
+	case SR_DF_LOGIC_RLE:
+	case SR_DF_ANALOG:
+		if (!ctx->header_done && (ret = start_file(o)) != SR_OK)
+			return ret;
+		if (!ctx->file)
+			return SR_ERR_IO;
+		if (packet->type == SR_DF_ANALOG)
+			ret = process_analog(ctx, packet->payload);
+		else
+			ret = process_logic(ctx, packet);
+		if (ret != SR_OK)
+			return ret;
+		return check_block(ctx);
+	case SR_DF_END:
+		if (!ctx->header_done && (ret = start_file(o)) != SR_OK)
+			return ret;
+		return finish_file(ctx);
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_output *o)
+{
+	struct context *ctx;
+	struct fst_signal *sig;
+	size_t i;
+
+	if (!o || !o->priv)
+		return SR_ERR_ARG;
+	ctx = o->priv;
+
+	/* Complete the file if the session did not end regularly. */
+	finish_file(ctx);
+
+	for (i = 0; i < ctx->num_signals; i++) {
+		sig = &ctx->signals[i];
+		g_array_free(sig->changes, TRUE);
+		g_byte_array_free(sig->data, TRUE);
+	}
+	g_free(ctx->signals);
+	g_byte_array_free(ctx->hier, TRUE);
+	g_byte_array_free(ctx->block, TRUE);
+	g_byte_array_free(ctx->scratch, TRUE);
+	g_array_free(ctx->times, TRUE);
+	g_free(ctx->last_logic);
+	g_free(ctx->fbuf);
+	g_free(ctx->filename);
+	g_free(ctx);
+	o->priv = NULL;
+
+	return SR_OK;
+}
+
+SR_PRIV struct sr_output_module output_fst = {
+	.id = "fst",
+	.name = "FST",
+	.desc = "Fast Signal Trace, compressed value changes for GTKWave",
+	.exts = (const char*[]){"fst", NULL},
+	.flags = SR_OUTPUT_INTERNAL_IO_HANDLING | SR_OUTPUT_LOGIC_RLE,
+	.options = NULL,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -31,33 +31,76 @@
 struct context {
 	unsigned int num_enabled_channels;
 	int spl;
-	int bit_cnt;
 	int spl_cnt;
 	int trigger;
 	uint64_t samplerate;
 	int *channel_index;
-	char **channel_names;
-	char **line_values;
+	size_t *prefix_len;
+	size_t plane_bytes;
+	uint8_t *planes;
 	uint8_t *sample_buf;
 	gboolean header_done;
-	GString **lines;
+	char *lines;
+	size_t line_size;
+	size_t line_pos;
 };
 
+/* Bit reversed bytes, the first sample goes to the MSB. */
+static uint8_t reversed[256];
+/* Two hex digits and the separator for each byte value. */
+static uint32_t hex_chars[256];
+
+static void build_tables(void)
+{
+	static const char digits[] = "0123456789abcdef";
+	char chars[4];
+	size_t value, bit;
+
+	for (value = 0; value < 256; value++) {
+		reversed[value] = 0;
+		for (bit = 0; bit < 8; bit++) {
+			if (value & (1U << bit))
+				reversed[value] |= 0x80 >> bit;
+		}
+		chars[0] = digits[value >> 4];
+		chars[1] = digits[value & 0xf];
+		chars[2] = ' ';
+		chars[3] = '\0';
+		memcpy(&hex_chars[value], chars, sizeof(chars));
+	}
+}
+
 static int init(struct sr_output *o, GHashTable *options)
 {
+	static gsize tables_done;
 	struct context *ctx;
 	struct sr_channel *ch;
 	GSList *l;
-	unsigned int i, j;
+	unsigned int j;
+	size_t max_namelen, max_index, spl;
+	char *line;
 
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 
+	spl = g_variant_get_uint32(g_hash_table_lookup(options, "width"));
+	if (!spl || spl > G_MAXINT) {
+		sr_err("Invalid width of %zu samples per line.", spl);
+		return SR_ERR_ARG;
+	}
+
+	if (g_once_init_enter(&tables_done)) {
+		build_tables();
+		g_once_init_leave(&tables_done, 1);
+	}
+
 	ctx = g_malloc0(sizeof(struct context));
 	o->priv = ctx;
 	ctx->trigger = -1;
-	ctx->spl = g_variant_get_uint32(g_hash_table_lookup(options, "width"));
+	ctx->spl = spl;
 
+	max_namelen = 0;
+	max_index = 0;
 	for (l = o->sdi->channels; l; l = l->next) {
 		ch = l->data;
 		if (ch->type != SR_CHANNEL_LOGIC)
@@ -65,24 +108,32 @@ static int init(struct sr_output *o, GHashTable *options)
 		if (!ch->enabled)
 			continue;
 		ctx->num_enabled_channels++;
+		max_namelen = MAX(max_namelen, strlen(ch->name));
+		max_index = MAX(max_index, (size_t)ch->index);
 	}
 	ctx->channel_index = g_malloc(sizeof(int) * ctx->num_enabled_channels);
-	ctx->channel_names = g_malloc(sizeof(char *) * ctx->num_enabled_channels);
-	ctx->lines = g_malloc(sizeof(GString *) * ctx->num_enabled_channels);
-	ctx->sample_buf = g_malloc(ctx->num_enabled_channels);
+	ctx->prefix_len = g_malloc(sizeof(size_t) * ctx->num_enabled_channels);
+	ctx->sample_buf = g_malloc0(ctx->num_enabled_channels);
+	ctx->plane_bytes = max_index / 8 + 1;
+	ctx->planes = g_malloc0(8 * ctx->plane_bytes);
 
+	/*
+	 * One line buffer per channel, grown once: the name, three
+	 * characters per byte (plus one byte for the end of the data),
+	 * the newline and the slack of the 32 bit stores.
+	 */
+	ctx->line_size = max_namelen + 1 + (spl / 8 + 1) * 3 + 1 + sizeof(uint32_t);
+	ctx->lines = g_malloc0(ctx->line_size * ctx->num_enabled_channels);
 	j = 0;
-	for (i = 0, l = o->sdi->channels; l; l = l->next, i++) {
+	for (l = o->sdi->channels; l; l = l->next) {
 		ch = l->data;
 		if (ch->type != SR_CHANNEL_LOGIC)
 			continue;
 		if (!ch->enabled)
 			continue;
 		ctx->channel_index[j] = ch->index;
-		ctx->channel_names[j] = ch->name;
-		ctx->lines[j] = g_string_sized_new(80);
-		ctx->sample_buf[j] = 0;
-		g_string_printf(ctx->lines[j], "%s:", ch->name);
+		line = ctx->lines + j * ctx->line_size;
+		ctx->prefix_len[j] = g_snprintf(line, ctx->line_size, "%s:", ch->name);
 		j++;
 	}
 
@@ -108,7 +159,7 @@ static GString *gen_header(const struct sr_output *o)
 
 	header = g_string_sized_new(512);
 	g_string_printf(header, "%s %s\n", PACKAGE_NAME, sr_package_version_string_get());
-	num_channels = g_slist_length(o->sdi->channels);
+	num_channels = sr_dev_channel_count(o->sdi, 0, FALSE);
 	g_string_append_printf(header, "Acquisition with %d/%d channels",
 			ctx->num_enabled_channels, num_channels);
 	if (ctx->samplerate != 0) {
@@ -121,6 +172,45 @@ static GString *gen_header(const struct sr_output *o)
 	return header;
 }
 
+static void reserve(GString *out, size_t extra)
+{
+	size_t len;
+
+	len = out->len;
+	g_string_set_size(out, len + extra);
+	g_string_truncate(out, len);
+}
+
+/* Append one byte of each channel's samples to its line, as hex. */
+static void append_bytes(struct context *ctx, unsigned int shift)
+{
+	unsigned int j;
+	char *line;
+
+	for (j = 0; j < ctx->num_enabled_channels; j++) {
+		line = ctx->lines + j * ctx->line_size + ctx->prefix_len[j];
+		memcpy(line + ctx->line_pos,
+			&hex_chars[(ctx->sample_buf[j] << shift) & 0xff],
+			sizeof(uint32_t));
+		ctx->sample_buf[j] = 0;
+	}
+	ctx->line_pos += 3;
+}
+
+static void flush_lines(struct context *ctx, GString *out)
+{
+	unsigned int j;
+	size_t len;
+	char *line;
+
+	for (j = 0; j < ctx->num_enabled_channels; j++) {
+		line = ctx->lines + j * ctx->line_size;
+		len = ctx->prefix_len[j] + ctx->line_pos;
+		line[len] = '\n';
+		g_string_append_len(out, line, len + 1);
+	}
+}
+
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
 		GString **out)
 {
@@ -129,9 +219,11 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	const struct sr_config *src;
 	GSList *l;
 	struct context *ctx;
-	int idx, pos, offset;
-	uint64_t i, j;
-	gchar *p;
+	int offset;
+	unsigned int j;
+	size_t num_samples, num_lines, count, bytes;
+	const uint8_t *curr_sample;
+	uint8_t bits;
 
 	*out = NULL;
 	if (!o || !o->sdi)
@@ -160,55 +252,63 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			*out = g_string_sized_new(512);
 
 		logic = packet->payload;
-		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
-			ctx->spl_cnt++;
-			pos = ctx->spl_cnt & 7;
+		num_samples = logic->length / logic->unitsize;
+		num_lines = (ctx->spl_cnt + num_samples) / ctx->spl;
+		reserve(*out, num_lines * ctx->num_enabled_channels *
+			ctx->line_size);
+
+		/*
+		 * Gather up to 8 samples of all channels at once, which costs
+		 * a transpose per sample byte. The bits of a channel then get
+		 * shifted into its byte, the first sample in the MSB.
+		 */
+		bytes = MIN(ctx->plane_bytes, logic->unitsize);
+		memset(ctx->planes, 0, 8 * ctx->plane_bytes);
+		curr_sample = logic->data;
+		while (num_samples) {
+			count = 8 - (ctx->spl_cnt & 7);
+			count = MIN(count, num_samples);
+			count = MIN(count, (size_t)(ctx->spl - ctx->spl_cnt));
+			sr_transpose_samples(curr_sample, logic->unitsize,
+				count, bytes, ctx->planes);
 			for (j = 0; j < ctx->num_enabled_channels; j++) {
-				idx = ctx->channel_index[j];
-				p = logic->data + i + idx / 8;
-				ctx->sample_buf[j] <<= 1;
-				if (*p & (1 << (idx % 8)))
-					ctx->sample_buf[j] |= 1;
-				if (ctx->spl_cnt && pos == 0) {
-					/* Buffered a byte's worth, output hex. */
-					g_string_append_printf(ctx->lines[j], "%.2x ",
-							ctx->sample_buf[j]);
-					ctx->sample_buf[j] = 0;
-				}
-
-				if (ctx->spl_cnt == ctx->spl) {
-					/* Flush line buffers. */
-					g_string_append_len(*out, ctx->lines[j]->str, ctx->lines[j]->len);
-					g_string_append_c(*out, '\n');
-					if (j == ctx->num_enabled_channels - 1 && ctx->trigger > -1) {
-						/*
-						 * Sample data lines have one character per nibble,
-						 * plus one separator per byte. Align trigger marker
-						 * to this layout.
-						 */
-						offset = ctx->trigger / 4 + ctx->trigger / 8;
-						g_string_append_printf(*out, "T:%*s^ %d\n", offset, "", ctx->trigger);
-						ctx->trigger = -1;
-					}
-					g_string_printf(ctx->lines[j], "%s:", ctx->channel_names[j]);
-				}
+				bits = reversed[ctx->planes[ctx->channel_index[j]]];
+				ctx->sample_buf[j] = (ctx->sample_buf[j] << count) |
+					(bits >> (8 - count));
+			}
+			ctx->spl_cnt += count;
+			curr_sample += count * logic->unitsize;
+			num_samples -= count;
+			if ((ctx->spl_cnt & 7) == 0) {
+				/* Buffered a byte's worth, output hex. */
+				append_bytes(ctx, 0);
 			}
-			if (ctx->spl_cnt == ctx->spl)
-				/* Line buffers were already flushed. */
-				ctx->spl_cnt = 0;
+			if (ctx->spl_cnt != ctx->spl)
+				continue;
+
+			/* Flush line buffers. */
+			flush_lines(ctx, *out);
+			if (ctx->num_enabled_channels && ctx->trigger > -1) {
+				/*
+				 * Sample data lines have one character per nibble,
+				 * plus one separator per byte. Align trigger marker
+				 * to this layout.
+				 */
+				offset = ctx->trigger / 4 + ctx->trigger / 8;
+				g_string_append_printf(*out, "T:%*s^ %d\n", offset, "", ctx->trigger);
+				ctx->trigger = -1;
+			}
+			ctx->spl_cnt = 0;
+			ctx->line_pos = 0;
 		}
 		break;
 	case SR_DF_END:
 		if (ctx->spl_cnt) {
 			/* Line buffers need flushing. */
 			*out = g_string_sized_new(512);
-			for (i = 0; i < ctx->num_enabled_channels; i++) {
-				if (ctx->spl_cnt & 7)
-					g_string_append_printf(ctx->lines[i], "%.2x ",
-							ctx->sample_buf[i] << (8 - (ctx->spl_cnt & 7)));
-				g_string_append_len(*out, ctx->lines[i]->str, ctx->lines[i]->len);
-				g_string_append_c(*out, '\n');
-			}
+			if (ctx->spl_cnt & 7)
+				append_bytes(ctx, 8 - (ctx->spl_cnt & 7));
+			flush_lines(ctx, *out);
 		}
 		break;
 	}
@@ -219,7 +319,6 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 static int cleanup(struct sr_output *o)
 {
 	struct context *ctx;
-	unsigned int i;
 
 	if (!o)
 		return SR_ERR_ARG;
@@ -228,10 +327,9 @@ static int cleanup(struct sr_output *o)
 		return SR_OK;
 
 	g_free(ctx->channel_index);
+	g_free(ctx->prefix_len);
 	g_free(ctx->sample_buf);
-	g_free(ctx->channel_names);
-	for (i = 0; i < ctx->num_enabled_channels; i++)
-		g_string_free(ctx->lines[i], TRUE);
+	g_free(ctx->planes);
 	g_free(ctx->lines);
 	g_free(ctx);
 	o->priv = NULL;
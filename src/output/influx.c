@@ -0,0 +1,329 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Analog values in the InfluxDB line protocol, one line per sample and
+ * channel:
+ *
+ *   sigrok,device=UT61E,channel=P1,mq=voltage,unit=V,flags=dc+autorange
+ *     value=1.234 1767225600000000000
+ *
+ * (without the line break). The tags identify the series, the value is
+ * rendered with the digits which the device reported. Values which are
+ * not finite, like overloads, are skipped. Timestamps are in
+ * nanoseconds since the epoch. With a known samplerate they count from
+ * the acquisition's start time, else each packet is stamped with the
+ * time it arrived at.
+ *
+ * Lines get collected, and are returned in batches of the configured
+ * number of lines, or when the oldest line waited for the configured
+ * time, or at the end of the session. The output can be sent to the
+ * database's write API as is.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/influx"
+
+#define BIN_TO_DEC_DIGITS (log(2) / log(10))
+
+struct context {
+	char *measurement;
+	char *device;
+	uint64_t samplerate;
+	/* Acquisition start, in microseconds since the epoch. */
+	int64_t start_us;
+	/* Samples sent per channel, indexed by the channel index. */
+	uint64_t *sample_counts;
+	size_t num_sample_counts;
+	GString *batch;
+	size_t batch_lines;
+	size_t max_lines;
+	/* Arrival of the oldest line in batch, monotonic microseconds. */
+	int64_t batch_since_us;
+	int64_t max_delay_us;
+	float *fdata;
+};
+
+/* Backslash escape the characters which the line protocol reserves. */
+static void append_escaped(GString *s, const char *text, const char *special)
+{
+	for (; *text; text++) {
+		if (strchr(special, *text))
+			g_string_append_c(s, '\\');
+		g_string_append_c(s, *text);
+	}
+}
+
+static void append_tag(GString *s, const char *key, const char *value)
+{
+	if (!value || !*value)
+		return;
+	g_string_append_c(s, ',');
+	g_string_append(s, key);
+	g_string_append_c(s, '=');
+	append_escaped(s, value, ", =");
+}
+
+static void append_flags(GString *s, enum sr_mqflag mqflags)
+{
+	const struct sr_key_info *info;
+	uint64_t bit;
+	gboolean first;
+
+	first = TRUE;
+	for (bit = 1; bit && bit <= (uint64_t)mqflags; bit <<= 1) {
+		if (!(mqflags & bit))
+			continue;
+		if (!(info = sr_key_info_get(SR_KEY_MQFLAGS, bit)))
+			continue;
+		g_string_append(s, first ? ",flags=" : "+");
+		append_escaped(s, info->id, ", =");
+		first = FALSE;
+	}
+}
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct context *ctx;
+	struct sr_channel *ch;
+	const char *model;
+	GSList *l;
+	size_t count;
+
+	if (!o || !o->sdi)
+		return SR_ERR_ARG;
+
+	o->priv = ctx = g_malloc0(sizeof(*ctx));
+	ctx->measurement = g_strdup(g_variant_get_string(
+		g_hash_table_lookup(options, "measurement"), NULL));
+	ctx->max_lines = g_variant_get_uint32(
+		g_hash_table_lookup(options, "batch_lines"));
+	ctx->max_delay_us = g_variant_get_uint32(
+		g_hash_table_lookup(options, "batch_ms")) * (int64_t)1000;
+	if (!*ctx->measurement) {
+		g_free(ctx->measurement);
+		ctx->measurement = g_strdup("sigrok");
+	}
+	model = sr_dev_inst_model_get(o->sdi);
+	ctx->device = g_strdup(model ? model : sr_dev_inst_vendor_get(o->sdi));
+
+	count = 0;
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		count = MAX(count, (size_t)ch->index + 1);
+	}
+	ctx->num_sample_counts = count;
+	ctx->sample_counts = g_malloc0_n(MAX(count, 1),
+		sizeof(ctx->sample_counts[0]));
+	ctx->batch = g_string_sized_new(4096);
+
+	return SR_OK;
+}
+
+/* Hand out the collected lines. */
+static void batch_take(struct context *ctx, GString **out)
+{
+	if (!ctx->batch_lines)
+		return;
+	*out = ctx->batch;
+	ctx->batch = g_string_sized_new(MAX((*out)->allocated_len, 4096));
+	ctx->batch_lines = 0;
+}
+
+/* Timestamp of a sample, in nanoseconds since the epoch. */
+static int64_t sample_time_ns(const struct context *ctx, int64_t now_us,
+		uint64_t sample)
+{
+	double offset;
+
+	if (!ctx->samplerate || !ctx->start_us)
+		return now_us * 1000;
+	offset = (double)sample / ctx->samplerate;
+
+	return ctx->start_us * 1000 + (int64_t)(offset * 1e9);
+}
+
+static int append_analog(struct context *ctx,
+		const struct sr_datafeed_analog *analog)
+{
+	struct sr_channel *ch;
+	GSList *l;
+	GString *tags;
+	char *unit, fmt[16], number[G_ASCII_DTOSTR_BUF_SIZE];
+	float *fdata;
+	uint64_t *count;
+	int64_t now_us;
+	unsigned int i;
+	int num_channels, c, digits, ret;
+	float value;
+	const struct sr_key_info *mq;
+
+	num_channels = g_slist_length(analog->meaning->channels);
+	if (!num_channels || !analog->num_samples)
+		return SR_OK;
+	fdata = g_try_realloc(ctx->fdata,
+		analog->num_samples * num_channels * sizeof(float));
+	if (!fdata)
+		return SR_ERR_MALLOC;
+	ctx->fdata = fdata;
+	if ((ret = sr_analog_to_float(analog, fdata)) != SR_OK)
+		return ret;
+
+	digits = analog->encoding->digits;
+	if (!analog->encoding->is_digits_decimal)
+		digits = copysign(ceil(abs(digits) * BIN_TO_DEC_DIGITS), digits);
+	g_snprintf(fmt, sizeof(fmt), "%%.%df", MAX(digits, 0));
+
+	/* The tags which all lines of the packet share, but the channel. */
+	tags = g_string_sized_new(128);
+	mq = sr_key_info_get(SR_KEY_MQ, analog->meaning->mq);
+	append_tag(tags, "mq", mq ? mq->id : NULL);
+	sr_analog_unit_to_string(analog, &unit);
+	append_tag(tags, "unit", unit);
+	g_free(unit);
+	append_flags(tags, analog->meaning->mqflags);
+
+	now_us = g_get_real_time();
+	if (!ctx->batch_lines)
+		ctx->batch_since_us = g_get_monotonic_time();
+	for (l = analog->meaning->channels, c = 0; l; l = l->next, c++) {
+		ch = l->data;
+		count = NULL;
+		if ((size_t)ch->index < ctx->num_sample_counts)
+			count = &ctx->sample_counts[ch->index];
+		for (i = 0; i < analog->num_samples; i++) {
+			/* The line protocol has no NaN or infinity (overload). */
+			value = fdata[i * num_channels + c];
+			if (!isfinite(value))
+				continue;
+			append_escaped(ctx->batch, ctx->measurement, ", ");
+			append_tag(ctx->batch, "device", ctx->device);
+			append_tag(ctx->batch, "channel", ch->name);
+			g_string_append_len(ctx->batch, tags->str, tags->len);
+			g_string_append(ctx->batch, " value=");
+			g_ascii_formatd(number, sizeof(number), fmt, value);
+			g_string_append(ctx->batch, number);
+			g_string_append_printf(ctx->batch, " %" PRId64 "\n",
+				sample_time_ns(ctx, now_us, count ? *count + i : 0));
+			ctx->batch_lines++;
+		}
+		if (count)
+			*count += analog->num_samples;
+	}
+	g_string_free(tags, TRUE);
+
+	return SR_OK;
+}
+
+static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
+		GString **out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_header *header;
+	const struct sr_datafeed_meta *meta;
+	const struct sr_config *src;
+	GSList *l;
+	int ret;
+
+	*out = NULL;
+	if (!o || !o->sdi || !(ctx = o->priv))
+		return SR_ERR_ARG;
+
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		header = packet->payload;
+		ctx->start_us = header->starttime.tv_sec * (int64_t)G_USEC_PER_SEC
+			+ header->starttime.tv_usec;
+		break;
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key == SR_CONF_SAMPLERATE)
+				ctx->samplerate = g_variant_get_uint64(src->data);
+		}
+		break;
+	case SR_DF_ANALOG:
+		if ((ret = append_analog(ctx, packet->payload)) != SR_OK)
+			return ret;
+		if (ctx->batch_lines >= ctx->max_lines || g_get_monotonic_time()
+				- ctx->batch_since_us >= ctx->max_delay_us)
+			batch_take(ctx, out);
+		break;
+	case SR_DF_END:
+		batch_take(ctx, out);
+		break;
+	}
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{"measurement", "Measurement", "Name of the measurement which the lines belong to", NULL, NULL},
+	{"batch_lines", "Batch lines", "Number of lines which get written at once", NULL, NULL},
+	{"batch_ms", "Batch time", "Maximum time in ms which lines wait to get written", NULL, NULL},
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_string("sigrok"));
+		options[1].def = g_variant_ref_sink(g_variant_new_uint32(5000));
+		options[2].def = g_variant_ref_sink(g_variant_new_uint32(1000));
+	}
+
+	return options;
+}
+
+static int cleanup(struct sr_output *o)
+{
+	struct context *ctx;
+
+	if (!o || !(ctx = o->priv))
+		return SR_ERR_ARG;
+
+	g_free(ctx->measurement);
+	g_free(ctx->device);
+	g_free(ctx->sample_counts);
+	g_string_free(ctx->batch, TRUE);
+	g_free(ctx->fdata);
+	g_free(ctx);
+	o->priv = NULL;
+
+	return SR_OK;
+}
+
+SR_PRIV struct sr_output_module output_influx = {
+	.id = "influx",
+	.name = "InfluxDB",
+	.desc = "InfluxDB line protocol of analog values",
+	.exts = (const char*[]){"lp", NULL},
+	.flags = 0,
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -24,13 +24,45 @@
 
 #define LOG_PREFIX "output/null"
 
+/*
+ * Discards all data, but measures what it receives: the number of
+ * packets, samples and bytes of each type, the time between packets,
+ * and the time since they were sent. The summary is the output at the
+ * end of the feed, which makes for a quick check of the throughput
+ * which the rest of the pipeline achieves.
+ */
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	(void)options;
+
+	o->priv = g_malloc0(sizeof(struct sr_packet_meter));
+
+	return SR_OK;
+}
+
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
 		GString **out)
 {
-	(void)o;
-	(void)packet;
+	struct sr_packet_meter *meter;
 
 	*out = NULL;
+	if (!o || !(meter = o->priv))
+		return SR_ERR_ARG;
+
+	if (packet->type == SR_DF_HEADER)
+		sr_packet_meter_reset(meter);
+	sr_packet_meter_add(meter, packet);
+	if (packet->type == SR_DF_END)
+		*out = sr_packet_meter_summary(meter);
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_output *o)
+{
+	g_free(o->priv);
+	o->priv = NULL;
 
 	return SR_OK;
 }
@@ -38,9 +70,11 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 SR_PRIV struct sr_output_module output_null = {
 	.id = "null",
 	.name = "Null output",
-	.desc = "Null output (discards all data)",
+	.desc = "Null output (discards all data, prints statistics)",
 	.exts = NULL,
 	.flags = 0,
 	.options = NULL,
+	.init = init,
 	.receive = receive,
+	.cleanup = cleanup,
 };
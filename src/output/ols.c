@@ -22,6 +22,10 @@
  * This implements version 1.3 of the output format for the OpenBench Logic
  * Sniffer "Alternative" Java client. Details:
  * https://github.com/jawi/ols/wiki/OLS-data-file-format
+ *
+ * The data is written "compressed": lines only for samples which differ
+ * from their predecessor, each with its absolute sample number. The last
+ * sample always gets a line, which tells the length of the capture.
  */
 
 #include <config.h>
@@ -36,6 +40,10 @@
 struct context {
 	uint64_t samplerate;
 	uint64_t num_samples;
+	/* The last received sample, and the number of its last line. */
+	uint8_t *prev;
+	size_t prev_size;
+	uint64_t last_line;
 };
 
 static int init(struct sr_output *o, GHashTable *options)
@@ -86,6 +94,59 @@ static GString *gen_header(const struct sr_dev_inst *sdi, struct context *ctx)
 	return s;
 }
 
+/* The OLS format wants the samples presented MSB first. */
+static void append_line(GString *s, const uint8_t *sample, size_t unitsize,
+	uint64_t samplenum)
+{
+	static const char hex[] = "0123456789abcdef";
+	char *p;
+	size_t pos;
+
+	pos = s->len;
+	g_string_set_size(s, pos + 2 * unitsize);
+	p = s->str + pos;
+	while (unitsize--) {
+		*p++ = hex[sample[unitsize] >> 4];
+		*p++ = hex[sample[unitsize] & 0xf];
+	}
+	g_string_append_printf(s, "@%" PRIu64 "\n", samplenum);
+}
+
+static void process_logic(struct context *ctx,
+	const struct sr_datafeed_logic *logic, GString *s)
+{
+	const uint8_t *sample, *prev;
+	size_t unitsize, count, i;
+
+	unitsize = logic->unitsize;
+	count = unitsize ? logic->length / unitsize : 0;
+	if (!count)
+		return;
+
+	/* Samples which equal their predecessor get no line. */
+	sample = logic->data;
+	prev = NULL;
+	if (ctx->num_samples && ctx->prev_size == unitsize)
+		prev = ctx->prev;
+	for (i = 0; i < count; i++, sample += unitsize) {
+		if (prev && !memcmp(sample, prev, unitsize)) {
+			prev = sample;
+			continue;
+		}
+		ctx->last_line = ctx->num_samples + i;
+		append_line(s, sample, unitsize, ctx->last_line);
+		prev = sample;
+	}
+	ctx->num_samples += count;
+
+	if (ctx->prev_size != unitsize) {
+		g_free(ctx->prev);
+		ctx->prev = g_malloc(unitsize);
+		ctx->prev_size = unitsize;
+	}
+	memcpy(ctx->prev, prev, unitsize);
+}
+
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
 		GString **out)
 {
@@ -94,8 +155,6 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	const struct sr_datafeed_logic *logic;
 	const struct sr_config *src;
 	GSList *l;
-	unsigned int i, j;
-	uint8_t c;
 
 	*out = NULL;
 	if (!o || !o->sdi)
@@ -118,13 +177,14 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			*out = gen_header(o->sdi, ctx);
 		} else
 			*out = g_string_sized_new(512);
-		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
-			for (j = 0; j < logic->unitsize; j++) {
-				/* The OLS format wants the samples presented MSB first. */
-				c = *((uint8_t *)logic->data + i + logic->unitsize - 1 - j);
-				g_string_append_printf(*out, "%02x", c);
-			}
-			g_string_append_printf(*out, "@%"PRIu64"\n", ctx->num_samples++);
+		process_logic(ctx, logic, *out);
+		break;
+	case SR_DF_END:
+		/* The last sample tells the capture's length. */
+		if (ctx->num_samples && ctx->last_line != ctx->num_samples - 1) {
+			*out = g_string_sized_new(64);
+			append_line(*out, ctx->prev, ctx->prev_size,
+				ctx->num_samples - 1);
 		}
 		break;
 	}
@@ -140,6 +200,7 @@ static int cleanup(struct sr_output *o)
 		return SR_ERR_ARG;
 
 	ctx = o->priv;
+	g_free(ctx->prev);
 	g_free(ctx);
 	o->priv = NULL;
 
@@ -18,7 +18,12 @@
  */
 
 #include <config.h>
+#include <errno.h>
 #include <string.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -49,6 +54,11 @@
  * Output modules generate a newly allocated GString. The caller is then
  * expected to free this with g_string_free() when finished with it.
  *
+ * Alternatively the output goes to a sink, see sr_output_send_sink().
+ * Sinks write to a file descriptor, collect the output in one buffer
+ * that is re-used, or pass it to a routine. Modules written for sinks
+ * avoid the allocation and copy of the data for every packet.
+ *
  * @{
  */
 
@@ -58,11 +68,15 @@ extern SR_PRIV struct sr_output_module output_hex;
 extern SR_PRIV struct sr_output_module output_ascii;
 extern SR_PRIV struct sr_output_module output_binary;
 extern SR_PRIV struct sr_output_module output_vcd;
+extern SR_PRIV struct sr_output_module output_fst;
 extern SR_PRIV struct sr_output_module output_ols;
 extern SR_PRIV struct sr_output_module output_chronovu_la8;
 extern SR_PRIV struct sr_output_module output_csv;
+extern SR_PRIV struct sr_output_module output_columnar;
 extern SR_PRIV struct sr_output_module output_analog;
+extern SR_PRIV struct sr_output_module output_influx;
 extern SR_PRIV struct sr_output_module output_srzip;
+extern SR_PRIV struct sr_output_module output_zarr;
 extern SR_PRIV struct sr_output_module output_wav;
 extern SR_PRIV struct sr_output_module output_wavedrom;
 extern SR_PRIV struct sr_output_module output_null;
@@ -73,12 +87,16 @@ static const struct sr_output_module *output_module_list[] = {
 	&output_binary,
 	&output_bits,
 	&output_csv,
+	&output_columnar,
 	&output_hex,
 	&output_ols,
 	&output_vcd,
+	&output_fst,
 	&output_chronovu_la8,
 	&output_analog,
+	&output_influx,
 	&output_srzip,
+	&output_zarr,
 	&output_wav,
 	&output_wavedrom,
 	&output_null,
@@ -189,10 +207,47 @@ SR_API const struct sr_output_module *sr_output_find(char *id)
 	return NULL;
 }
 
+/*
+ * Options which output.c handles for all modules that write their
+ * output through the library. "compress" compresses the output, as
+ * "gzip" or "zstd" optionally followed by ":<level>".
+ */
+static struct sr_option output_options[] = {
+	{"compress", "Compression", "Compress the output as it is produced (none, gzip[:level], zstd[:level])", NULL, NULL},
+	ALL_ZERO
+};
+
+static const struct sr_option *generic_options(
+		const struct sr_output_module *omod)
+{
+	if (omod->flags & SR_OUTPUT_INTERNAL_IO_HANDLING)
+		return NULL;
+	if (!output_options[0].def)
+		output_options[0].def = g_variant_ref_sink(g_variant_new_string("none"));
+
+	return output_options;
+}
+
+static gboolean is_generic_option(const struct sr_output_module *omod,
+		const char *id)
+{
+	const struct sr_option *opt;
+
+	for (opt = generic_options(omod); opt && opt->id; opt++) {
+		if (!strcmp(opt->id, id))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
 /**
  * Returns a NULL-terminated array of struct sr_option, or NULL if the
  * module takes no options.
  *
+ * Modules which don't handle their output themselves all take the
+ * generic "compress" option as well.
+ *
  * Each call to this function must be followed by a call to
  * sr_output_options_free().
  *
@@ -200,21 +255,28 @@ SR_API const struct sr_output_module *sr_output_find(char *id)
  */
 SR_API const struct sr_option **sr_output_options_get(const struct sr_output_module *omod)
 {
-	const struct sr_option *mod_opts, **opts;
-	int size, i;
+	const struct sr_option *mod_opts, *gen_opts, **opts;
+	int size, gen_size, i;
 
-	if (!omod || !omod->options)
+	if (!omod)
 		return NULL;
 
-	mod_opts = omod->options();
+	mod_opts = omod->options ? omod->options() : NULL;
+	gen_opts = generic_options(omod);
+	if (!mod_opts && !gen_opts)
+		return NULL;
 
-	for (size = 0; mod_opts[size].id; size++)
+	for (size = 0; mod_opts && mod_opts[size].id; size++)
+		;
+	for (gen_size = 0; gen_opts && gen_opts[gen_size].id; gen_size++)
 		;
-	opts = g_malloc((size + 1) * sizeof(struct sr_option *));
+	opts = g_malloc((size + gen_size + 1) * sizeof(struct sr_option *));
 
 	for (i = 0; i < size; i++)
 		opts[i] = &mod_opts[i];
-	opts[i] = NULL;
+	for (i = 0; i < gen_size; i++)
+		opts[size + i] = &gen_opts[i];
+	opts[size + gen_size] = NULL;
 
 	return opts;
 }
@@ -257,6 +319,11 @@ SR_API void sr_output_options_free(const struct sr_option **options)
  * The sr_dev_inst passed in can be used by the instance to determine
  * channel names, samplerate, and so on.
  *
+ * The generic "compress" option, e.g. "zstd:3", has the output
+ * compressed while it is produced (see sr_output_options_get()).
+ * sr_output_send() and sr_output_send_sink() then return compressed
+ * data, and the stream gets completed with SR_DF_END.
+ *
  * @since 0.4.0
  */
 SR_API const struct sr_output *sr_output_new(const struct sr_output_module *omod,
@@ -269,13 +336,30 @@ SR_API const struct sr_output *sr_output_new(const struct sr_output_module *omod
 	GHashTable *new_opts;
 	GHashTableIter iter;
 	gpointer key, value;
+	const char *spec;
 	int i;
 
-	op = g_malloc(sizeof(struct sr_output));
+	op = g_malloc0(sizeof(struct sr_output));
 	op->module = omod;
 	op->sdi = sdi;
 	op->filename = g_strdup(filename);
 
+	/* Take the generic options, the module doesn't see them. */
+	spec = NULL;
+	value = options ? g_hash_table_lookup(options, "compress") : NULL;
+	if (value && is_generic_option(omod, "compress")) {
+		if (!g_variant_is_of_type(value, G_VARIANT_TYPE_STRING)) {
+			sr_err("Invalid type for 'compress' option.");
+			g_free(op);
+			return NULL;
+		}
+		spec = g_variant_get_string(value, NULL);
+	}
+	if (sr_output_compress_new(spec, &op->compress) != SR_OK) {
+		g_free(op);
+		return NULL;
+	}
+
 	new_opts = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
 			(GDestroyNotify)g_variant_unref);
 	if (omod->options) {
@@ -288,6 +372,8 @@ SR_API const struct sr_output *sr_output_new(const struct sr_output_module *omod
 				if (!g_variant_is_of_type(value, gvt)) {
 					sr_err("Invalid type for '%s' option.",
 						(char *)key);
+					g_hash_table_destroy(new_opts);
+					sr_output_compress_free(op->compress);
 					g_free(op);
 					return NULL;
 				}
@@ -304,10 +390,12 @@ SR_API const struct sr_output *sr_output_new(const struct sr_output_module *omod
 		if (options) {
 			g_hash_table_iter_init(&iter, options);
 			while (g_hash_table_iter_next(&iter, &key, &value)) {
-				if (!g_hash_table_lookup(new_opts, key)) {
+				if (!g_hash_table_lookup(new_opts, key)
+						&& !is_generic_option(omod, key)) {
 					sr_err("Output module '%s' has no option '%s'",
 						omod->id, (char *)key);
 					g_hash_table_destroy(new_opts);
+					sr_output_compress_free(op->compress);
 					g_free(op);
 					return NULL;
 				}
@@ -316,6 +404,7 @@ SR_API const struct sr_output *sr_output_new(const struct sr_output_module *omod
 	}
 
 	if (op->module->init && op->module->init(op, new_opts) != SR_OK) {
+		sr_output_compress_free(op->compress);
 		g_free(op);
 		op = NULL;
 	}
@@ -325,18 +414,656 @@ SR_API const struct sr_output *sr_output_new(const struct sr_output_module *omod
 	return op;
 }
 
+/** @cond PRIVATE */
+/* Copied output is written out when this much is staged. */
+#define SINK_FLUSH_SIZE		(256 * 1024)
+/* Referenced data shorter than this gets copied instead. */
+#define SINK_COPY_MAX		4096
+/* Maximum number of segments per writev() call. */
+#define SINK_IOV_MAX		64
+/** @endcond */
+
+/* A piece of pending output, either referenced or in the staging buffer. */
+struct sink_segment {
+	const uint8_t *ref;
+	size_t offset;
+	size_t length;
+};
+
+/** @private */
+struct sr_output_sink {
+	/** File descriptor to write to, or -1 for buffer and callback sinks. */
+	int fd;
+	/** Routine which takes the output of callback sinks, else NULL. */
+	sr_output_sink_callback cb;
+	void *cb_data;
+	/** File writer of disk sinks, else NULL. */
+	struct sr_disk_writer *disk;
+	/** Collected output (buffer sink) or staged copies (fd sink). */
+	GByteArray *buf;
+	/** Pending output of fd sinks, in order. */
+	GArray *segments;
+	/** Whether segments reference data of the current packet. */
+	gboolean has_refs;
+	/** Total number of bytes written to the sink. */
+	uint64_t bytes;
+	/** Sticky error of a failed write. */
+	int error;
+};
+
+static struct sr_output_sink *sink_new(int fd)
+{
+	struct sr_output_sink *sink;
+
+	sink = g_malloc0(sizeof(*sink));
+	sink->fd = fd;
+	sink->buf = g_byte_array_new();
+	if (fd >= 0)
+		sink->segments = g_array_new(FALSE, FALSE,
+			sizeof(struct sink_segment));
+
+	return sink;
+}
+
+static inline gboolean sink_is_buffer(const struct sr_output_sink *sink)
+{
+	return sink->fd < 0 && !sink->cb && !sink->disk;
+}
+
+/**
+ * Create an output sink which writes to a file descriptor.
+ *
+ * Output is batched, and large blocks of sample data are written
+ * straight from the packets with writev() where available. The file
+ * descriptor is not closed by sr_output_sink_free().
+ *
+ * @param fd The file descriptor, open for writing.
+ *
+ * @return The new sink, or NULL on invalid arguments.
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_output_sink *sr_output_sink_fd_new(int fd)
+{
+	if (fd < 0)
+		return NULL;
+
+	return sink_new(fd);
+}
+
+/**
+ * Create an output sink which collects the output in memory.
+ *
+ * The output accumulates until sr_output_sink_buffer_clear(), which
+ * keeps the memory for re-use.
+ *
+ * @return The new sink.
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_output_sink *sr_output_sink_buffer_new(void)
+{
+	return sink_new(-1);
+}
+
+/**
+ * Create an output sink which passes the output to a routine.
+ *
+ * The routine gets each piece of output as the output module writes
+ * it, without copying or batching. The data is only valid during the
+ * call. Large blocks of sample data point straight into the packets.
+ *
+ * @param cb The routine to invoke. A return value other than SR_OK
+ *           fails the current and all further sends to the sink.
+ * @param cb_data Opaque pointer passed to the routine.
+ *
+ * @return The new sink, or NULL on invalid arguments.
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_output_sink *sr_output_sink_callback_new(
+		sr_output_sink_callback cb, void *cb_data)
+{
+	struct sr_output_sink *sink;
+
+	if (!cb)
+		return NULL;
+
+	sink = sink_new(-1);
+	sink->cb = cb;
+	sink->cb_data = cb_data;
+
+	return sink;
+}
+
+/**
+ * Create an output sink which streams to a file, for long recordings
+ * at high rates.
+ *
+ * Output gets collected in large blocks, which a thread writes while
+ * the next block fills. With direct I/O the file is written around the
+ * page cache where the platform and file system support it, so that
+ * the recording does not evict the other data of the host. The output
+ * of the current block only reaches the file when the sink gets freed.
+ *
+ * @param filename The file, gets overwritten. Must not be NULL.
+ * @param direct Write around the page cache.
+ * @param sync When to synchronize the file with the disk.
+ *
+ * @return The new sink, or NULL when the file can't get created.
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_output_sink *sr_output_sink_disk_new(const char *filename,
+		gboolean direct, enum sr_disk_sync sync)
+{
+	struct sr_output_sink *sink;
+	struct sr_disk_writer *disk;
+
+	if (!filename || sync > SR_DISK_SYNC_BLOCK)
+		return NULL;
+	if (!(disk = sr_disk_writer_new(filename, direct, sync)))
+		return NULL;
+
+	sink = sink_new(-1);
+	sink->disk = disk;
+
+	return sink;
+}
+
+/**
+ * Get the write statistics of a disk sink.
+ *
+ * @param sink The sink. Must not be NULL.
+ * @param[out] stats The statistics.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG The sink is not a disk sink.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_output_sink_disk_stats(const struct sr_output_sink *sink,
+		struct sr_disk_stats *stats)
+{
+	if (!sink || !sink->disk || !stats)
+		return SR_ERR_ARG;
+
+	sr_disk_writer_stats(sink->disk, stats);
+
+	return SR_OK;
+}
+
+/**
+ * Get the output collected by a buffer sink.
+ *
+ * @param sink The sink. Must not be NULL.
+ * @param[out] length The number of bytes of output. Can be NULL.
+ *
+ * @return The output, valid until the next write to or clear of the sink.
+ *
+ * @since 0.6.0
+ */
+SR_API const uint8_t *sr_output_sink_buffer_get(
+		const struct sr_output_sink *sink, size_t *length)
+{
+	if (length)
+		*length = sink_is_buffer(sink) ? sink->buf->len : 0;
+
+	return sink_is_buffer(sink) ? sink->buf->data : NULL;
+}
+
+/**
+ * Discard the output collected by a buffer sink, keeping its memory.
+ *
+ * @param sink The sink. Must not be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_output_sink_buffer_clear(struct sr_output_sink *sink)
+{
+	if (sink_is_buffer(sink))
+		g_byte_array_set_size(sink->buf, 0);
+}
+
+/**
+ * Get the total number of bytes written to a sink.
+ *
+ * @param sink The sink. Must not be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API uint64_t sr_output_sink_bytes(const struct sr_output_sink *sink)
+{
+	return sink->bytes;
+}
+
+/**
+ * Write out pending output and free a sink.
+ *
+ * @param sink The sink. If NULL, the function does nothing.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_output_sink_free(struct sr_output_sink *sink)
+{
+	if (!sink)
+		return;
+
+	sr_output_sink_flush(sink);
+	if (sink->disk) {
+		sr_disk_writer_close(sink->disk);
+		sr_disk_writer_free(sink->disk);
+	}
+	g_byte_array_free(sink->buf, TRUE);
+	if (sink->segments)
+		g_array_free(sink->segments, TRUE);
+	g_free(sink);
+}
+
+static void sink_add_segment(struct sr_output_sink *sink,
+		const uint8_t *ref, size_t offset, size_t length)
+{
+	struct sink_segment *last, seg;
+
+	/* Extend the previous segment when the new one continues it. */
+	if (sink->segments->len) {
+		last = &g_array_index(sink->segments, struct sink_segment,
+			sink->segments->len - 1);
+		if (!ref && !last->ref && last->offset + last->length == offset) {
+			last->length += length;
+			return;
+		}
+	}
+
+	seg.ref = ref;
+	seg.offset = offset;
+	seg.length = length;
+	g_array_append_val(sink->segments, seg);
+}
+
+/* Pass data to the routine of a callback sink. */
+static int sink_write_cb(struct sr_output_sink *sink,
+		const void *data, size_t length)
+{
+	int ret;
+
+	if (sink->error)
+		return sink->error;
+	if ((ret = sink->cb(data, length, sink->cb_data)) != SR_OK)
+		sink->error = ret;
+	sink->bytes += length;
+
+	return sink->error;
+}
+
+/**
+ * Write a copy of the given data to a sink.
+ *
+ * @private
+ */
+SR_PRIV int sr_output_sink_write(struct sr_output_sink *sink,
+		const void *data, size_t length)
+{
+	size_t offset;
+
+	if (!length)
+		return SR_OK;
+	if (sink->cb)
+		return sink_write_cb(sink, data, length);
+	if (sink->disk) {
+		if (!sink->error)
+			sink->error = sr_disk_writer_write(sink->disk,
+				data, length);
+		sink->bytes += length;
+		return sink->error;
+	}
+
+	offset = sink->buf->len;
+	g_byte_array_append(sink->buf, data, length);
+	sink->bytes += length;
+	if (sink->fd < 0)
+		return SR_OK;
+
+	sink_add_segment(sink, NULL, offset, length);
+	if (sink->buf->len >= SINK_FLUSH_SIZE)
+		return sr_output_sink_flush(sink);
+
+	return sink->error;
+}
+
+/**
+ * Write the given data to a sink without copying it, where possible.
+ *
+ * The data must stay valid until the module's receive_sink() returns.
+ *
+ * @private
+ */
+SR_PRIV int sr_output_sink_write_ref(struct sr_output_sink *sink,
+		const void *data, size_t length)
+{
+	if (sink->fd < 0 || length < SINK_COPY_MAX)
+		return sr_output_sink_write(sink, data, length);
+
+	sink_add_segment(sink, data, 0, length);
+	sink->has_refs = TRUE;
+	sink->bytes += length;
+
+	return sink->error;
+}
+
+static int sink_write_fd(struct sr_output_sink *sink,
+		const struct sink_segment *segs, unsigned int count)
+{
+	const uint8_t *p;
+	size_t len, skip;
+	unsigned int i;
+	ssize_t ret;
+#ifndef _WIN32
+	struct iovec iov[SINK_IOV_MAX];
+	unsigned int n;
+
+	skip = 0;
+	while (count) {
+		n = MIN(count, SINK_IOV_MAX);
+		for (i = 0; i < n; i++) {
+			p = segs[i].ref ? segs[i].ref :
+				sink->buf->data + segs[i].offset;
+			iov[i].iov_base = (void *)p;
+			iov[i].iov_len = segs[i].length;
+		}
+		iov[0].iov_base = (uint8_t *)iov[0].iov_base + skip;
+		iov[0].iov_len -= skip;
+		ret = writev(sink->fd, iov, n);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 0) {
+			sr_err("Output write error: %s", g_strerror(errno));
+			return SR_ERR_IO;
+		}
+		/* Skip what was written, partial writes resume mid-segment. */
+		len = ret + skip;
+		skip = 0;
+		while (count && len >= segs->length) {
+			len -= segs->length;
+			segs++;
+			count--;
+		}
+		skip = len;
+	}
+#else
+	for (i = 0; i < count; i++) {
+		p = segs[i].ref ? segs[i].ref : sink->buf->data + segs[i].offset;
+		len = segs[i].length;
+		while (len) {
+			ret = write(sink->fd, p, len);
+			if (ret < 0 && errno == EINTR)
+				continue;
+			if (ret < 0) {
+				sr_err("Output write error: %s", g_strerror(errno));
+				return SR_ERR_IO;
+			}
+			p += ret;
+			len -= ret;
+		}
+	}
+	(void)skip;
+#endif
+
+	return SR_OK;
+}
+
+/**
+ * Write out all output pending in a file descriptor sink.
+ *
+ * @private
+ */
+SR_PRIV int sr_output_sink_flush(struct sr_output_sink *sink)
+{
+	int ret;
+
+	/* Disk sinks write in whole blocks, wait for the full ones. */
+	if (sink->disk) {
+		if (!sink->error)
+			sink->error = sr_disk_writer_flush(sink->disk);
+		return sink->error;
+	}
+	if (sink->fd < 0 || !sink->segments->len)
+		return sink->error;
+
+	ret = SR_OK;
+	if (!sink->error)
+		ret = sink_write_fd(sink, (const struct sink_segment *)
+			sink->segments->data, sink->segments->len);
+	if (ret != SR_OK)
+		sink->error = ret;
+	g_array_set_size(sink->segments, 0);
+	g_byte_array_set_size(sink->buf, 0);
+	sink->has_refs = FALSE;
+
+	return sink->error;
+}
+
+/* Expand RLE packets for modules which don't take them. */
+static int output_packet(const struct sr_output *o,
+		const struct sr_datafeed_packet **packet,
+		struct sr_datafeed_packet *expanded, struct sr_datafeed_logic *logic)
+{
+	struct sr_output *op;
+	const struct sr_datafeed_logic_rle *rle;
+	uint64_t size;
+	int ret;
+
+	if ((*packet)->type != SR_DF_LOGIC_RLE ||
+			(o->module->flags & SR_OUTPUT_LOGIC_RLE))
+		return SR_OK;
+
+	/* The expansion buffer is kept for re-use. */
+	op = (struct sr_output *)o;
+	rle = (*packet)->payload;
+	size = rle->num_samples * rle->unitsize;
+	if (size > op->rle_size) {
+		sr_mem_free_add(SR_MEM_OUTPUT, op->rle_size);
+		g_free(op->rle_buffer);
+		op->rle_buffer = g_try_malloc(size);
+		op->rle_size = op->rle_buffer ? size : 0;
+		sr_mem_alloc_add(SR_MEM_OUTPUT, op->rle_size);
+		if (!op->rle_buffer)
+			return SR_ERR_MALLOC;
+	}
+	if ((ret = sr_logic_rle_expand(rle, op->rle_buffer)) != SR_OK)
+		return ret;
+	logic->length = size;
+	logic->unitsize = rle->unitsize;
+	logic->data = op->rle_buffer;
+	expanded->type = SR_DF_LOGIC;
+	expanded->payload = logic;
+	*packet = expanded;
+
+	return SR_OK;
+}
+
+static int output_send_module(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString **out)
+{
+	struct sr_output *op;
+	struct sr_datafeed_packet expanded;
+	struct sr_datafeed_logic logic;
+	const uint8_t *data;
+	size_t len;
+	int ret;
+
+	if ((ret = output_packet(o, &packet, &expanded, &logic)) != SR_OK)
+		return ret;
+	if (o->module->receive)
+		return o->module->receive(o, packet, out);
+
+	/* Sink based module, collect its output in the instance's buffer. */
+	op = (struct sr_output *)o;
+	if (!op->sink)
+		op->sink = sr_output_sink_buffer_new();
+	sr_output_sink_buffer_clear(op->sink);
+	*out = NULL;
+	if ((ret = o->module->receive_sink(o, packet, op->sink)) != SR_OK)
+		return ret;
+	data = sr_output_sink_buffer_get(op->sink, &len);
+	if (len)
+		*out = g_string_new_len((const char *)data, len);
+
+	return SR_OK;
+}
+
+/* Have the module's output compressed, if that was asked for. */
+static int output_send(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString **out)
+{
+	const uint8_t *data;
+	size_t len;
+	int ret;
+
+	ret = output_send_module(o, packet, out);
+	if (ret != SR_OK || !o->compress)
+		return ret;
+
+	ret = sr_output_compress_data(o->compress, *out ? (*out)->str : NULL,
+		*out ? (*out)->len : 0, packet->type == SR_DF_END,
+		&data, &len);
+	if (*out)
+		g_string_free(*out, TRUE);
+	*out = NULL;
+	if (ret == SR_OK && len)
+		*out = g_string_new_len((const char *)data, len);
+
+	return ret;
+}
+
+static int output_send_sink_module(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet,
+		struct sr_output_sink *sink)
+{
+	struct sr_datafeed_packet expanded;
+	struct sr_datafeed_logic logic;
+	GString *out;
+	int ret;
+
+	if ((ret = output_packet(o, &packet, &expanded, &logic)) != SR_OK)
+		return ret;
+	if (o->module->receive_sink)
+		return o->module->receive_sink(o, packet, sink);
+
+	/* GString based module, pass its output on. */
+	out = NULL;
+	ret = o->module->receive(o, packet, &out);
+	if (ret == SR_OK && out)
+		ret = sr_output_sink_write(sink, out->str, out->len);
+	if (out)
+		g_string_free(out, TRUE);
+
+	return ret;
+}
+
+/*
+ * Have the module's output compressed, if that was asked for. It gets
+ * collected in a buffer sink, which takes copies of referenced data.
+ */
+static int output_send_sink(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet,
+		struct sr_output_sink *sink)
+{
+	struct sr_output *op;
+	const uint8_t *data;
+	size_t len;
+	int ret;
+
+	if (!o->compress)
+		return output_send_sink_module(o, packet, sink);
+
+	op = (struct sr_output *)o;
+	if (!op->compress_sink)
+		op->compress_sink = sr_output_sink_buffer_new();
+	sr_output_sink_buffer_clear(op->compress_sink);
+	ret = output_send_sink_module(o, packet, op->compress_sink);
+	if (ret != SR_OK)
+		return ret;
+	data = sr_output_sink_buffer_get(op->compress_sink, &len);
+	ret = sr_output_compress_data(o->compress, data, len,
+		packet->type == SR_DF_END, &data, &len);
+	if (ret != SR_OK)
+		return ret;
+
+	return sr_output_sink_write(sink, data, len);
+}
+
 /**
  * Send a packet to the specified output instance.
  *
  * The instance's output is returned as a newly allocated GString,
  * which must be freed by the caller.
  *
+ * SR_DF_LOGIC_RLE packets get expanded into SR_DF_LOGIC packets for
+ * output modules which don't accept them.
+ *
  * @since 0.4.0
  */
 SR_API int sr_output_send(const struct sr_output *o,
 		const struct sr_datafeed_packet *packet, GString **out)
 {
-	return o->module->receive(o, packet, out);
+	int64_t start_us;
+	int ret, tag;
+
+	sr_trace(SR_TRACE_OUTPUT_RECEIVE, SR_TRACE_BEGIN, packet->type);
+	start_us = g_get_monotonic_time();
+	tag = sr_mem_tag_enter(SR_MEM_OUTPUT);
+	ret = output_send(o, packet, out);
+	sr_mem_tag_leave(tag);
+	sr_session_output_time_add(g_get_monotonic_time() - start_us);
+	sr_trace(SR_TRACE_OUTPUT_RECEIVE, SR_TRACE_END, packet->type);
+
+	return ret;
+}
+
+/**
+ * Send a packet to the specified output instance, writing to a sink.
+ *
+ * This works with every output module. Modules which support sinks
+ * write without a GString per packet, and file descriptor sinks write
+ * the sample data of binary outputs without copying it. Copied output
+ * is batched until enough accumulated or the end of the data feed.
+ *
+ * @param o The output instance. Must not be NULL.
+ * @param packet The packet. Must not be NULL.
+ * @param sink The sink for the output. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_IO Writing to the file descriptor failed.
+ * @retval other Error codes of the output module.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_output_send_sink(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet,
+		struct sr_output_sink *sink)
+{
+	int64_t start_us;
+	int ret, flush_ret, tag;
+
+	if (!o || !packet || !sink)
+		return SR_ERR_ARG;
+
+	sr_trace(SR_TRACE_OUTPUT_RECEIVE, SR_TRACE_BEGIN, packet->type);
+	start_us = g_get_monotonic_time();
+	tag = sr_mem_tag_enter(SR_MEM_OUTPUT);
+	ret = output_send_sink(o, packet, sink);
+	/* Referenced packet data only lives until we return. */
+	if (sink->has_refs || packet->type == SR_DF_END) {
+		flush_ret = sr_output_sink_flush(sink);
+		if (ret == SR_OK)
+			ret = flush_ret;
+	}
+	sr_mem_tag_leave(tag);
+	sr_session_output_time_add(g_get_monotonic_time() - start_us);
+	sr_trace(SR_TRACE_OUTPUT_RECEIVE, SR_TRACE_END, packet->type);
+
+	return ret;
 }
 
 /**
@@ -354,6 +1081,11 @@ SR_API int sr_output_free(const struct sr_output *o)
 	ret = SR_OK;
 	if (o->module->cleanup)
 		ret = o->module->cleanup((struct sr_output *)o);
+	sr_mem_free_add(SR_MEM_OUTPUT, o->rle_size);
+	g_free(o->rle_buffer);
+	sr_output_sink_free(o->sink);
+	sr_output_sink_free(o->compress_sink);
+	sr_output_compress_free(o->compress);
 	g_free((char *)o->filename);
 	g_free((gpointer)o);
 
@@ -20,20 +20,41 @@
 #include <config.h>
 #include <stdlib.h>
 #include <string.h>
-#include <errno.h>
 #include <glib.h>
-#include <glib/gstdio.h>
-#include <zip.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
 #define LOG_PREFIX "output/srzip"
 #define CHUNK_SIZE (4 * 1024 * 1024)
 
+#define DEFAULT_COMPRESSION	6
+
 struct out_context {
 	gboolean zip_created;
+	gboolean zip_finished;
 	uint64_t samplerate;
 	char *filename;
+	struct sr_zip_writer *zip;
+	GKeyFile *meta;
+	unsigned int logic_chunk_num;
+	unsigned int *analog_chunk_num;
+	int level;
+	guint num_threads;
+	/* Store analog chunks with the XOR codec, as "<name>.xor". */
+	gboolean analog_xor;
+	/* Store analog chunks in their source's encoding, as "<name>.raw". */
+	gboolean analog_native;
+	/* Metadata is held back until the analog encodings are known. */
+	gboolean meta_pending;
+	/* Multi-resolution summary of the samples, if enabled. */
+	gboolean with_summary;
+	struct sr_summary *summary;
+	/* Transition index of the logic data, if enabled. */
+	gboolean with_edges;
+	/* How the file gets written, see disk.c. */
+	gboolean direct_io;
+	enum sr_disk_sync sync;
+	struct sr_edge_index *edges;
 	size_t first_analog_index;
 	size_t analog_ch_count;
 	gint *analog_index_map;
@@ -44,35 +65,140 @@ struct out_context {
 		size_t fill_size;
 	} logic_buff;
 	struct analog_buff {
+		size_t unit_size;
 		size_t alloc_size;
-		float *samples;
+		uint8_t *samples;
 		size_t fill_size;
+		/* Encoding of the stored samples, once known (native only). */
+		gboolean have_encoding;
+		struct sr_analog_encoding encoding;
 	} *analog_buff;
 };
 
 static int init(struct sr_output *o, GHashTable *options)
 {
 	struct out_context *outc;
-
-	(void)options;
+	guint level, threads;
+	const char *encoding, *sync;
+	gboolean summary, edges;
 
 	if (!o->filename || o->filename[0] == '\0') {
 		sr_info("srzip output module requires a file name, cannot save.");
 		return SR_ERR_ARG;
 	}
 
+	level = g_variant_get_uint32(g_hash_table_lookup(options, "compression"));
+	threads = g_variant_get_uint32(g_hash_table_lookup(options, "threads"));
+	encoding = g_variant_get_string(g_hash_table_lookup(options,
+		"analog_encoding"), NULL);
+	summary = g_variant_get_boolean(g_hash_table_lookup(options, "summary"));
+	edges = g_variant_get_boolean(g_hash_table_lookup(options, "edge_index"));
+	sync = g_variant_get_string(g_hash_table_lookup(options, "sync"), NULL);
+	if (level > 9) {
+		sr_err("Compression level %u out of range (0-9).", level);
+		return SR_ERR_ARG;
+	}
+	if (strcmp(encoding, "float") && strcmp(encoding, "xor")
+			&& strcmp(encoding, "native")) {
+		sr_err("Unknown analog encoding '%s'.", encoding);
+		return SR_ERR_ARG;
+	}
+	if (strcmp(sync, "none") && strcmp(sync, "close")
+			&& strcmp(sync, "block")) {
+		sr_err("Unknown sync policy '%s'.", sync);
+		return SR_ERR_ARG;
+	}
+
 	outc = g_malloc0(sizeof(*outc));
 	outc->filename = g_strdup(o->filename);
+	outc->level = level;
+	outc->num_threads = threads;
+	outc->analog_xor = !strcmp(encoding, "xor");
+	outc->analog_native = !strcmp(encoding, "native");
+	outc->with_summary = summary;
+	outc->with_edges = edges;
+	outc->direct_io = g_variant_get_boolean(g_hash_table_lookup(options,
+		"direct_io"));
+	if (!strcmp(sync, "close"))
+		outc->sync = SR_DISK_SYNC_CLOSE;
+	else if (!strcmp(sync, "block"))
+		outc->sync = SR_DISK_SYNC_BLOCK;
+	else
+		outc->sync = SR_DISK_SYNC_NONE;
 	o->priv = outc;
 
 	return SR_OK;
 }
 
+static int metadata_write(const struct sr_output *o)
+{
+	struct out_context *outc;
+	struct analog_buff *buff;
+	char *metabuf;
+	gsize metalen;
+	size_t idx;
+	int ret;
+
+	outc = o->priv;
+	for (idx = 0; outc->analog_native && idx < outc->analog_ch_count; idx++) {
+		buff = &outc->analog_buff[idx];
+		if (!buff->have_encoding)
+			continue;
+		sr_sessionfile_analog_encoding_set(outc->meta,
+			outc->first_analog_index + idx, &buff->encoding);
+	}
+	metabuf = g_key_file_to_data(outc->meta, &metalen, NULL);
+	ret = sr_zip_writer_add(outc->zip, "metadata", metabuf, metalen);
+	g_free(metabuf);
+	if (ret != SR_OK)
+		sr_err("Error saving metadata into zipfile.");
+
+	return ret;
+}
+
+/*
+ * Write the metadata if it was held back, the summary and the
+ * transition index, if any, and the ZIP central directory, which
+ * completes the archive.
+ */
+static int zip_finish(const struct sr_output *o)
+{
+	struct out_context *outc;
+	int ret;
+
+	outc = o->priv;
+	if (!outc->zip_created || outc->zip_finished)
+		return SR_OK;
+	outc->zip_finished = TRUE;
+
+	if (outc->meta_pending) {
+		outc->meta_pending = FALSE;
+		if ((ret = metadata_write(o)) != SR_OK)
+			return ret;
+	}
+
+	if (outc->summary) {
+		ret = sr_summary_write(outc->summary, outc->zip,
+			outc->first_analog_index);
+		if (ret != SR_OK) {
+			sr_err("Error saving summary into zipfile.");
+			return ret;
+		}
+	}
+	if (outc->edges) {
+		ret = sr_edge_index_write(outc->edges, outc->zip, TRUE);
+		if (ret != SR_OK) {
+			sr_err("Error saving transition index into zipfile.");
+			return ret;
+		}
+	}
+
+	return sr_zip_writer_finish(outc->zip);
+}
+
 static int zip_create(const struct sr_output *o)
 {
 	struct out_context *outc;
-	struct zip *zipfile;
-	struct zip_source *versrc, *metasrc;
 	struct sr_channel *ch;
 	size_t ch_nr;
 	size_t alloc_size;
@@ -80,8 +206,7 @@ static int zip_create(const struct sr_output *o)
 	GKeyFile *meta;
 	GSList *l;
 	const char *devgroup;
-	char *s, *metabuf;
-	gsize metalen;
+	char *s;
 	guint logic_channels, enabled_logic_channels;
 	guint enabled_analog_channels;
 	guint index;
@@ -94,24 +219,20 @@ static int zip_create(const struct sr_output *o)
 		g_variant_unref(gvar);
 	}
 
-	/* Quietly delete it first, libzip wants replace ops otherwise. */
-	g_unlink(outc->filename);
-	zipfile = zip_open(outc->filename, ZIP_CREATE, NULL);
-	if (!zipfile)
-		return SR_ERR;
+	outc->zip = sr_zip_writer_new(outc->filename, outc->level,
+		outc->num_threads, outc->direct_io, outc->sync);
+	if (!outc->zip)
+		return SR_ERR_IO;
 
 	/* "version" */
-	versrc = zip_source_buffer(zipfile, "2", 1, FALSE);
-	if (zip_add(zipfile, "version", versrc) < 0) {
-		sr_err("Error saving version into zipfile: %s",
-			zip_strerror(zipfile));
-		zip_source_free(versrc);
-		zip_discard(zipfile);
+	if (sr_zip_writer_add(outc->zip, "version", "2", 1) != SR_OK) {
+		sr_err("Error saving version into zipfile.");
 		return SR_ERR;
 	}
 
 	/* init "metadata" */
 	meta = g_key_file_new();
+	outc->meta = meta;
 
 	g_key_file_set_string(meta, "global", "sigrok version",
 			sr_package_version_string_get());
@@ -160,6 +281,8 @@ static int zip_create(const struct sr_output *o)
 	outc->analog_ch_count = enabled_analog_channels;
 	alloc_size = sizeof(gint) * outc->analog_ch_count + 1;
 	outc->analog_index_map = g_malloc0(alloc_size);
+	outc->analog_chunk_num = g_malloc0_n(outc->analog_ch_count + 1,
+		sizeof(outc->analog_chunk_num[0]));
 
 	index = 0;
 	for (l = o->sdi->channels; l; l = l->next) {
@@ -215,6 +338,17 @@ static int zip_create(const struct sr_output *o)
 	outc->logic_buff.alloc_size = alloc_size;
 	outc->logic_buff.fill_size = 0;
 
+	if (outc->with_summary) {
+		outc->summary = sr_summary_new(enabled_logic_channels > 0
+			? outc->logic_buff.unit_size : 0, outc->analog_ch_count);
+	}
+	if (outc->with_edges && enabled_logic_channels > 0)
+		outc->edges = sr_edge_index_new(outc->logic_buff.unit_size);
+
+	/*
+	 * Native analog samples are as wide as the encoding of their
+	 * channel's first packet, see native_values().
+	 */
 	alloc_size = sizeof(outc->analog_buff[0]) * outc->analog_ch_count + 1;
 	outc->analog_buff = g_malloc0(alloc_size);
 	for (index = 0; index < outc->analog_ch_count; index++) {
@@ -222,33 +356,29 @@ static int zip_create(const struct sr_output *o)
 		outc->analog_buff[index].samples = g_try_malloc0(alloc_size);
 		if (!outc->analog_buff[index].samples)
 			return SR_ERR_MALLOC;
-		alloc_size /= sizeof(outc->analog_buff[0].samples[0]);
+		outc->analog_buff[index].unit_size = sizeof(float);
+		alloc_size /= sizeof(float);
 		outc->analog_buff[index].alloc_size = alloc_size;
 		outc->analog_buff[index].fill_size = 0;
 	}
 
-	metabuf = g_key_file_to_data(meta, &metalen, NULL);
-	g_key_file_free(meta);
-
-	metasrc = zip_source_buffer(zipfile, metabuf, metalen, FALSE);
-	if (zip_add(zipfile, "metadata", metasrc) < 0) {
-		sr_err("Error saving metadata into zipfile: %s",
-			zip_strerror(zipfile));
-		zip_source_free(metasrc);
-		zip_discard(zipfile);
-		g_free(metabuf);
-		return SR_ERR;
+	/*
+	 * All of the metadata is known by now, the unit size follows from
+	 * the logic channel count. Have it follow the version right away,
+	 * so that streaming readers see it before the sample data. The
+	 * encodings of native analog samples are only known from their
+	 * packets though, that metadata gets written at the end.
+	 */
+	if (enabled_logic_channels > 0) {
+		g_key_file_set_integer(meta, devgroup, "unitsize",
+			outc->logic_buff.unit_size);
 	}
-
-	if (zip_close(zipfile) < 0) {
-		sr_err("Error saving zipfile: %s", zip_strerror(zipfile));
-		zip_discard(zipfile);
-		g_free(metabuf);
-		return SR_ERR;
+	if (outc->analog_native && outc->analog_ch_count) {
+		outc->meta_pending = TRUE;
+		return SR_OK;
 	}
-	g_free(metabuf);
 
-	return SR_OK;
+	return metadata_write(o);
 }
 
 /**
@@ -265,123 +395,29 @@ static int zip_append(const struct sr_output *o,
 	uint8_t *buf, size_t unitsize, size_t length)
 {
 	struct out_context *outc;
-	struct zip *archive;
-	struct zip_source *logicsrc;
-	int64_t i, num_files;
-	struct zip_stat zs;
-	struct zip_source *metasrc;
-	GKeyFile *kf;
-	GError *error;
-	uint64_t chunk_num;
-	const char *entry_name;
-	char *metabuf;
-	gsize metalen;
 	char *chunkname;
-	unsigned int next_chunk_num;
+	int ret;
 
 	if (!length)
 		return SR_OK;
 
 	outc = o->priv;
-	if (!(archive = zip_open(outc->filename, 0, NULL)))
-		return SR_ERR;
-
-	if (zip_stat(archive, "metadata", 0, &zs) < 0) {
-		sr_err("Failed to open metadata: %s", zip_strerror(archive));
-		zip_discard(archive);
-		return SR_ERR;
-	}
-	kf = sr_sessionfile_read_metadata(archive, &zs);
-	if (!kf) {
-		zip_discard(archive);
-		return SR_ERR_DATA;
-	}
-	/*
-	 * If the file was only initialized but doesn't yet have any
-	 * data it in, it won't have a unitsize field in metadata yet.
-	 */
-	error = NULL;
-	metabuf = NULL;
-	if (!g_key_file_has_key(kf, "device 1", "unitsize", &error)) {
-		if (error && error->code != G_KEY_FILE_ERROR_KEY_NOT_FOUND) {
-			sr_err("Failed to check unitsize key: %s", error->message);
-			g_error_free(error);
-			g_key_file_free(kf);
-			zip_discard(archive);
-			return SR_ERR;
-		}
-		g_clear_error(&error);
-
-		/* Add unitsize field. */
-		g_key_file_set_integer(kf, "device 1", "unitsize", unitsize);
-		metabuf = g_key_file_to_data(kf, &metalen, NULL);
-		metasrc = zip_source_buffer(archive, metabuf, metalen, FALSE);
-
-		if (zip_replace(archive, zs.index, metasrc) < 0) {
-			sr_err("Failed to replace metadata: %s",
-				zip_strerror(archive));
-			g_key_file_free(kf);
-			zip_source_free(metasrc);
-			zip_discard(archive);
-			g_free(metabuf);
-			return SR_ERR;
-		}
-	}
-	g_key_file_free(kf);
-
-	next_chunk_num = 1;
-	num_files = zip_get_num_entries(archive, 0);
-	for (i = 0; i < num_files; i++) {
-		entry_name = zip_get_name(archive, i, 0);
-		if (!entry_name || strncmp(entry_name, "logic-1", 7) != 0)
-			continue;
-		if (entry_name[7] == '\0') {
-			/*
-			 * This file has no extra chunks, just a single
-			 * "logic-1". Rename it to "logic-1-1" and continue
-			 * with chunk 2.
-			 */
-			if (zip_rename(archive, i, "logic-1-1") < 0) {
-				sr_err("Failed to rename 'logic-1' to 'logic-1-1': %s",
-					zip_strerror(archive));
-				zip_discard(archive);
-				g_free(metabuf);
-				return SR_ERR;
-			}
-			next_chunk_num = 2;
-			break;
-		} else if (entry_name[7] == '-') {
-			chunk_num = g_ascii_strtoull(entry_name + 8, NULL, 10);
-			if (chunk_num < G_MAXINT && chunk_num >= next_chunk_num)
-				next_chunk_num = chunk_num + 1;
-		}
-	}
 
 	if (length % unitsize != 0) {
 		sr_warn("Chunk size %zu not a multiple of the"
 			" unit size %zu.", length, unitsize);
 	}
-	logicsrc = zip_source_buffer(archive, buf, length, FALSE);
-	chunkname = g_strdup_printf("logic-1-%u", next_chunk_num);
-	i = zip_add(archive, chunkname, logicsrc);
+	if (outc->summary)
+		sr_summary_logic_feed(outc->summary, buf, length / unitsize);
+	chunkname = g_strdup_printf("logic-1-%u", ++outc->logic_chunk_num);
+	ret = sr_zip_writer_add(outc->zip, chunkname, buf, length);
 	g_free(chunkname);
-	if (i < 0) {
-		sr_err("Failed to add chunk 'logic-1-%u': %s",
-			next_chunk_num, zip_strerror(archive));
-		zip_source_free(logicsrc);
-		zip_discard(archive);
-		g_free(metabuf);
-		return SR_ERR;
+	if (ret == SR_OK && outc->edges) {
+		sr_edge_index_feed(outc->edges, buf, length / unitsize);
+		ret = sr_edge_index_write(outc->edges, outc->zip, FALSE);
 	}
-	if (zip_close(archive) < 0) {
-		sr_err("Error saving session file: %s", zip_strerror(archive));
-		zip_discard(archive);
-		g_free(metabuf);
-		return SR_ERR;
-	}
-	g_free(metabuf);
 
-	return SR_OK;
+	return ret;
 }
 
 /**
@@ -450,79 +486,166 @@ static int zip_append_queue(const struct sr_output *o,
 	return SR_OK;
 }
 
+/* Feed native analog samples to the summary, which takes floats. */
+static int summary_feed_native(struct out_context *outc, size_t idx,
+	const uint8_t *data, size_t count)
+{
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	float *values;
+	int ret;
+
+	sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
+	encoding = outc->analog_buff[idx].encoding;
+	analog.data = (void *)data;
+	analog.num_samples = count;
+	values = g_try_malloc(count * sizeof(values[0]));
+	if (!values)
+		return SR_ERR_MALLOC;
+	ret = sr_analog_to_float(&analog, values);
+	if (ret == SR_OK)
+		sr_summary_analog_feed(outc->summary, idx, values, count);
+	g_free(values);
+
+	return ret;
+}
+
 /**
  * Append analog data of a channel to an srzip archive.
  *
  * @param[in] o Output module instance.
- * @param[in] values Sample data as array of floating point values.
- * @param[in] count Number of samples (float items, not bytes).
+ * @param[in] data Sample data, floating point values unless the
+ *            native encoding is stored.
+ * @param[in] count Number of samples (items, not bytes).
  * @param[in] ch_nr 1-based channel number.
  *
  * @returns SR_OK et al error codes.
  */
 static int zip_append_analog(const struct sr_output *o,
-	const float *values, size_t count, size_t ch_nr)
+	const uint8_t *data, size_t count, size_t ch_nr)
 {
 	struct out_context *outc;
-	struct zip *archive;
-	struct zip_source *analogsrc;
-	int64_t i, num_files;
-	size_t size;
-	struct zip_stat zs;
-	uint64_t chunk_num;
-	const char *entry_name;
-	char *basename;
-	gsize baselen;
+	const float *values;
 	char *chunkname;
-	unsigned int next_chunk_num;
+	GByteArray *encoded;
+	size_t idx;
+	int ret;
 
 	outc = o->priv;
 
-	if (!(archive = zip_open(outc->filename, 0, NULL)))
-		return SR_ERR;
-
-	if (zip_stat(archive, "metadata", 0, &zs) < 0) {
-		sr_err("Failed to open metadata: %s", zip_strerror(archive));
-		zip_discard(archive);
-		return SR_ERR;
+	idx = ch_nr - outc->first_analog_index;
+	if (outc->analog_native) {
+		if (outc->summary) {
+			ret = summary_feed_native(outc, idx, data, count);
+			if (ret != SR_OK)
+				return ret;
+		}
+		chunkname = g_strdup_printf("analog-1-%zu-%u.raw", ch_nr,
+			++outc->analog_chunk_num[idx]);
+		ret = sr_zip_writer_add(outc->zip, chunkname, data,
+			outc->analog_buff[idx].unit_size * count);
+		g_free(chunkname);
+		return ret;
 	}
 
-	basename = g_strdup_printf("analog-1-%zu", ch_nr);
-	baselen = strlen(basename);
-	next_chunk_num = 1;
-	num_files = zip_get_num_entries(archive, 0);
-	for (i = 0; i < num_files; i++) {
-		entry_name = zip_get_name(archive, i, 0);
-		if (!entry_name || strncmp(entry_name, basename, baselen) != 0) {
-			continue;
-		} else if (entry_name[baselen] == '-') {
-			chunk_num = g_ascii_strtoull(entry_name + baselen + 1, NULL, 10);
-			if (chunk_num < G_MAXINT && chunk_num >= next_chunk_num)
-				next_chunk_num = chunk_num + 1;
-		}
+	values = (const float *)data;
+	if (outc->summary)
+		sr_summary_analog_feed(outc->summary, idx, values, count);
+	if (!outc->analog_xor) {
+		chunkname = g_strdup_printf("analog-1-%zu-%u", ch_nr,
+			++outc->analog_chunk_num[idx]);
+		ret = sr_zip_writer_add(outc->zip, chunkname, values,
+			sizeof(values[0]) * count);
+		g_free(chunkname);
+		return ret;
 	}
 
-	size = sizeof(values[0]) * count;
-	analogsrc = zip_source_buffer(archive, values, size, FALSE);
-	chunkname = g_strdup_printf("%s-%u", basename, next_chunk_num);
-	i = zip_add(archive, chunkname, analogsrc);
-	if (i < 0) {
-		sr_err("Failed to add chunk '%s': %s", chunkname, zip_strerror(archive));
+	encoded = g_byte_array_new();
+	ret = sr_analog_xor_encode(values, count, encoded);
+	if (ret == SR_OK) {
+		chunkname = g_strdup_printf("analog-1-%zu-%u.xor", ch_nr,
+			++outc->analog_chunk_num[idx]);
+		ret = sr_zip_writer_add(outc->zip, chunkname,
+			encoded->data, encoded->len);
 		g_free(chunkname);
-		g_free(basename);
-		zip_source_free(analogsrc);
-		zip_discard(archive);
-		return SR_ERR;
 	}
-	g_free(chunkname);
-	if (zip_close(archive) < 0) {
-		sr_err("Error saving session file: %s", zip_strerror(archive));
-		g_free(basename);
-		zip_discard(archive);
-		return SR_ERR;
+	g_byte_array_free(encoded, TRUE);
+
+	return ret;
+}
+
+/* Convert a packet's samples to floats. */
+static int float_values(const struct sr_datafeed_analog *analog,
+	uint8_t **values)
+{
+	float *buf;
+	int ret;
+
+	buf = g_try_malloc0(analog->num_samples * sizeof(buf[0]));
+	if (!buf)
+		return SR_ERR_MALLOC;
+	ret = sr_analog_to_float(analog, buf);
+	if (ret != SR_OK) {
+		g_free(buf);
+		return ret;
 	}
+	*values = (uint8_t *)buf;
+
+	return SR_OK;
+}
 
-	g_free(basename);
+/*
+ * Take a packet's samples in their encoding. The first packet of a
+ * channel sets the encoding which the file stores, later packets must
+ * have the same one. Interleaved samples get packed.
+ */
+static int native_values(struct analog_buff *buff,
+	const struct sr_datafeed_analog *analog, uint8_t **values)
+{
+	const struct sr_analog_encoding *enc;
+	const uint8_t *rdptr;
+	size_t frame_size, i;
+
+	enc = analog->encoding;
+	if (!enc->unitsize || enc->unitsize > 8) {
+		sr_err("Invalid analog unit size %u.", enc->unitsize);
+		return SR_ERR_ARG;
+	}
+	if (enc->channel_scale || enc->channel_offset) {
+		sr_err("Per-channel scaling cannot be stored natively.");
+		return SR_ERR_NA;
+	}
+	if (!buff->have_encoding) {
+		buff->encoding = *enc;
+		buff->encoding.stride = 0;
+		buff->have_encoding = TRUE;
+		buff->unit_size = enc->unitsize;
+		buff->alloc_size = CHUNK_SIZE / buff->unit_size;
+	} else if (enc->unitsize != buff->encoding.unitsize
+			|| enc->is_signed != buff->encoding.is_signed
+			|| enc->is_float != buff->encoding.is_float
+			|| enc->is_bigendian != buff->encoding.is_bigendian
+			|| !sr_rational_eq(&enc->scale, &buff->encoding.scale)
+			|| !sr_rational_eq(&enc->offset, &buff->encoding.offset)) {
+		sr_err("Analog encoding changed, cannot store natively.");
+		return SR_ERR_DATA;
+	}
+
+	*values = g_try_malloc(analog->num_samples * buff->unit_size + 1);
+	if (!*values)
+		return SR_ERR_MALLOC;
+	frame_size = sr_analog_frame_size(analog);
+	rdptr = analog->data;
+	if (frame_size == buff->unit_size) {
+		memcpy(*values, rdptr, analog->num_samples * buff->unit_size);
+		return SR_OK;
+	}
+	for (i = 0; i < analog->num_samples; i++) {
+		memcpy(*values + i * buff->unit_size, rdptr, buff->unit_size);
+		rdptr += frame_size;
+	}
 
 	return SR_OK;
 }
@@ -543,7 +666,7 @@ static int zip_append_analog_queue(const struct sr_output *o,
 	const struct sr_channel *ch;
 	size_t idx, nr;
 	struct analog_buff *buff;
-	float *values, *wrptr, *rdptr;
+	uint8_t *values, *wrptr, *rdptr;
 	size_t send_size, remain, copy_size;
 	int ret;
 
@@ -581,15 +704,16 @@ static int zip_append_analog_queue(const struct sr_output *o,
 	nr = outc->first_analog_index + idx;
 	buff = &outc->analog_buff[idx];
 
-	/* Convert the analog data to an array of float values. */
-	values = g_try_malloc0(analog->num_samples * sizeof(values[0]));
-	if (!values)
-		return SR_ERR_MALLOC;
-	ret = sr_analog_to_float(analog, values);
-	if (ret != SR_OK) {
-		g_free(values);
+	/*
+	 * Keep the analog data as it is in native mode, otherwise
+	 * convert it to an array of float values.
+	 */
+	if (outc->analog_native)
+		ret = native_values(buff, analog, &values);
+	else
+		ret = float_values(analog, &values);
+	if (ret != SR_OK)
 		return ret;
-	}
 
 	/*
 	 * Queue most recently received samples to the local buffer.
@@ -600,12 +724,12 @@ static int zip_append_analog_queue(const struct sr_output *o,
 	while (send_size) {
 		remain = buff->alloc_size - buff->fill_size;
 		if (remain) {
-			wrptr = &buff->samples[buff->fill_size];
+			wrptr = &buff->samples[buff->fill_size * buff->unit_size];
 			copy_size = MIN(send_size, remain);
 			send_size -= copy_size;
 			buff->fill_size += copy_size;
-			memcpy(wrptr, rdptr, copy_size * sizeof(values[0]));
-			rdptr += copy_size;
+			memcpy(wrptr, rdptr, copy_size * buff->unit_size);
+			rdptr += copy_size * buff->unit_size;
 			remain -= copy_size;
 		}
 		if (send_size && !remain) {
@@ -688,6 +812,9 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			ret = zip_append_analog_queue(o, NULL, TRUE);
 			if (ret != SR_OK)
 				return ret;
+			ret = zip_finish(o);
+			if (ret != SR_OK)
+				return ret;
 		}
 		break;
 	}
@@ -696,11 +823,40 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 }
 
 static struct sr_option options[] = {
+	{"compression", "Compression", "Deflate level of data chunks, 0 stores them uncompressed (0-9)", NULL, NULL},
+	{"threads", "Threads", "Number of compression threads, 0 uses all processors", NULL, NULL},
+	{"analog_encoding", "Analog encoding", "Encoding of analog data chunks, xor compresses slowly varying signals losslessly, native keeps the samples as the source sent them (float, xor, native)", NULL, NULL},
+	{"summary", "Summary", "Store a multi-resolution summary of the samples, for fast overviews", NULL, NULL},
+	{"edge_index", "Edge index", "Store an index of the transitions of logic channels, for fast edge searches", NULL, NULL},
+	{"direct_io", "Direct I/O", "Write the file around the page cache, for long recordings at high rates", NULL, NULL},
+	{"sync", "Sync", "When to synchronize the file with the disk (none, close, block)", NULL, NULL},
 	ALL_ZERO
 };
 
 static const struct sr_option *get_options(void)
 {
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_uint32(DEFAULT_COMPRESSION));
+		options[1].def = g_variant_ref_sink(g_variant_new_uint32(0));
+		options[2].def = g_variant_ref_sink(g_variant_new_string("float"));
+		options[2].values = g_slist_append(options[2].values,
+				g_variant_ref_sink(g_variant_new_string("float")));
+		options[2].values = g_slist_append(options[2].values,
+				g_variant_ref_sink(g_variant_new_string("xor")));
+		options[2].values = g_slist_append(options[2].values,
+				g_variant_ref_sink(g_variant_new_string("native")));
+		options[3].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+		options[4].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+		options[5].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+		options[6].def = g_variant_ref_sink(g_variant_new_string("none"));
+		options[6].values = g_slist_append(options[6].values,
+				g_variant_ref_sink(g_variant_new_string("none")));
+		options[6].values = g_slist_append(options[6].values,
+				g_variant_ref_sink(g_variant_new_string("close")));
+		options[6].values = g_slist_append(options[6].values,
+				g_variant_ref_sink(g_variant_new_string("block")));
+	}
+
 	return options;
 }
 
@@ -711,6 +867,18 @@ static int cleanup(struct sr_output *o)
 
 	outc = o->priv;
 
+	/* Complete the archive if the session did not end regularly. */
+	if (outc->zip && !outc->zip_finished) {
+		zip_append_queue(o, NULL, 0, 0, TRUE);
+		zip_append_analog_queue(o, NULL, TRUE);
+		zip_finish(o);
+	}
+	sr_zip_writer_free(outc->zip);
+	sr_summary_free(outc->summary);
+	sr_edge_index_free(outc->edges);
+	if (outc->meta)
+		g_key_file_free(outc->meta);
+	g_free(outc->analog_chunk_num);
 	g_free(outc->analog_index_map);
 	g_free(outc->filename);
 	g_free(outc->logic_buff.samples);
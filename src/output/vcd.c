@@ -31,6 +31,7 @@
 
 #include <ctype.h>
 #include <glib.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -42,12 +43,20 @@
 static const int with_queue_stats = 0;
 static const int with_pool_stats = 0;
 
+/* Identifiers take up to three characters, plus the terminator. */
+#define VCD_IDENT_SIZE	4
+
+/* Logic packets get formatted on threads in ranges of at least this size. */
+#define VCD_RANGE_SAMPLES	(256 * 1024)
+
 struct vcd_channel_desc {
 	size_t index;
-	GString *name;
+	const char *name;
+	/* Logic value change text, " 0<name>" and " 1<name>". */
+	char bit_text[2][VCD_IDENT_SIZE + 2];
+	size_t bit_len;
 	enum sr_channeltype type;
 	struct {
-		uint8_t logic;
 		double real;
 	} last;
 	uint64_t last_rcvd_snum;
@@ -59,25 +68,59 @@ struct vcd_queue_item {
 	GString *values;	/**!< text of value changes */
 };
 
+/* Sentinel for vcd_queue_pos, when no queue item is current. */
+#define QUEUE_POS_NONE	((size_t)-1)
+
+/* A range of samples of a logic packet, which one thread formats. */
+struct vcd_range {
+	struct context *ctx;
+	const uint8_t *data;
+	size_t unit_size;
+	uint64_t count;
+	/* Sample number of the range's first sample. */
+	uint64_t snum;
+	/* Sample before the range, two copies, see logic_range(). */
+	uint8_t *last;
+	uint8_t *prev;
+	GString *text;
+	int rc;
+	gboolean done;
+};
+
 struct context {
 	size_t enabled_count;
 	size_t logic_count;
 	size_t analog_count;
 	gboolean header_done;
 	uint64_t period;
+	uint64_t ts_factor;
 	struct vcd_channel_desc *channels;
+	char *idents;
 	uint64_t samplerate;
-	GSList *free_list, *used_list;
-	size_t alloced, freed, reused, pooled;
-	GList *vcd_queue_list;
-	GList *vcd_queue_last;
+	GPtrArray *free_strings;
+	size_t alloced, reused;
+	GArray *vcd_queue;
+	size_t vcd_queue_head;
+	size_t vcd_queue_pos;
 	gboolean immediate_write;
 	uint8_t *last_logic;
+	uint8_t *prev_logic;
+	size_t last_logic_size;
+	size_t num_threads;
+	struct vcd_workers {
+		GThreadPool *pool;
+		GMutex mutex;
+		GCond cond;
+		struct vcd_range *ranges;
+		size_t range_count;
+	} work;
 };
 
 /*
  * Construct VCD signal identifiers from a sigrok channel index. The
- * routine returns a GString which the caller is supposed to release.
+ * routine writes the NUL terminated text to the caller's buffer of
+ * VCD_IDENT_SIZE bytes, and returns its length (zero when the index
+ * is not supported).
  *
  * There are 94 printable ASCII characters. For larger channel index
  * numbers multiple letters get concatenated (sticking with letters).
@@ -107,58 +150,54 @@ struct context {
 #define VCD_IDENT_COUNT_3CHAR	(VCD_IDENT_COUNT_2CHAR * VCD_IDENT_COUNT_ALPHA)
 #define VCD_IDENT_COUNT		(VCD_IDENT_COUNT_1CHAR + VCD_IDENT_COUNT_2CHAR + VCD_IDENT_COUNT_3CHAR)
 
-static GString *vcd_identifier(size_t idx)
+static size_t vcd_identifier(size_t idx, char *ident)
 {
-	GString *symbol;
-	char c1, c2, c3;
-
-	symbol = g_string_sized_new(4);
-
 	/* First 94 channels, one printable character. */
 	if (idx < VCD_IDENT_COUNT_1CHAR) {
-		c1 = VCD_IDENT_CHAR_MIN + idx;
-		g_string_printf(symbol, "%c", c1);
-		return symbol;
+		ident[0] = VCD_IDENT_CHAR_MIN + idx;
+		ident[1] = '\0';
+		return 1;
 	}
 	idx -= VCD_IDENT_COUNT_1CHAR;
 
 	/* Next 676 channels, two lower case characters. */
 	if (idx < VCD_IDENT_COUNT_2CHAR) {
-		c2 = VCD_IDENT_ALPHA_MIN + (idx % VCD_IDENT_COUNT_ALPHA);
+		ident[1] = VCD_IDENT_ALPHA_MIN + (idx % VCD_IDENT_COUNT_ALPHA);
 		idx /= VCD_IDENT_COUNT_ALPHA;
-		c1 = VCD_IDENT_ALPHA_MIN + (idx % VCD_IDENT_COUNT_ALPHA);
+		ident[0] = VCD_IDENT_ALPHA_MIN + (idx % VCD_IDENT_COUNT_ALPHA);
 		idx /= VCD_IDENT_COUNT_ALPHA;
 		if (idx)
 			sr_dbg("VCD identifier creation BUG (two char).");
-		g_string_printf(symbol, "%c%c", c1, c2);
-		return symbol;
+		ident[2] = '\0';
+		return 2;
 	}
 	idx -= VCD_IDENT_COUNT_2CHAR;
 
 	/* Next 17576 channels, three lower case characters. */
 	if (idx < VCD_IDENT_COUNT_3CHAR) {
-		c3 = VCD_IDENT_ALPHA_MIN + (idx % VCD_IDENT_COUNT_ALPHA);
+		ident[2] = VCD_IDENT_ALPHA_MIN + (idx % VCD_IDENT_COUNT_ALPHA);
 		idx /= VCD_IDENT_COUNT_ALPHA;
-		c2 = VCD_IDENT_ALPHA_MIN + (idx % VCD_IDENT_COUNT_ALPHA);
+		ident[1] = VCD_IDENT_ALPHA_MIN + (idx % VCD_IDENT_COUNT_ALPHA);
 		idx /= VCD_IDENT_COUNT_ALPHA;
-		c1 = VCD_IDENT_ALPHA_MIN + (idx % VCD_IDENT_COUNT_ALPHA);
+		ident[0] = VCD_IDENT_ALPHA_MIN + (idx % VCD_IDENT_COUNT_ALPHA);
 		idx /= VCD_IDENT_COUNT_ALPHA;
 		if (idx)
 			sr_dbg("VCD identifier creation BUG (three char).");
-		g_string_printf(symbol, "%c%c%c", c1, c2, c3);
-		return symbol;
+		ident[3] = '\0';
+		return 3;
 	}
 	idx -= VCD_IDENT_COUNT_3CHAR;
 
 	/*
 	 * TODO
 	 * Add combinations with more positions or larger character sets
-	 * when support for more channels is required.
+	 * when support for more channels is required. Extend
+	 * VCD_IDENT_SIZE accordingly.
 	 */
 	sr_dbg("VCD identifier creation ENOTSUPP (need %zu more).", idx);
-	g_string_free(symbol, TRUE);
+	ident[0] = '\0';
 
-	return NULL;
+	return 0;
 }
 
 /*
@@ -175,31 +214,40 @@ static GString *vcd_identifier(size_t idx)
  *   "%.16g" format such that all bits of the internal presentation of
  *   the IEEE754 floating point value get communicated between the
  *   writer and the reader.
+ * - Timestamps and single bit values are the bulk of the text. They
+ *   don't go through printf(), the digits of timestamps get generated
+ *   here, bit values are copied from the text which init() prepared.
  */
 
-static void append_vcd_timestamp(GString *s, double ts, gboolean lf)
+static void append_vcd_timestamp(GString *s, uint64_t ts, gboolean lf)
 {
-
-	g_string_append_c(s, '\n');
-	g_string_append_c(s, '#');
-	g_string_append_printf(s, "%.0f", ts);
-	g_string_append_c(s, lf ? '\n' : ' ');
+	char text[24], *p;
+
+	/* Fill the buffer from its end: "\n#<digits>" and the separator. */
+	p = &text[sizeof(text)];
+	*--p = lf ? '\n' : ' ';
+	do {
+		*--p = '0' + ts % 10;
+		ts /= 10;
+	} while (ts);
+	*--p = '#';
+	*--p = '\n';
+	g_string_append_len(s, p, &text[sizeof(text)] - p);
 }
 
-static void format_vcd_value_bit(GString *s, uint8_t bit_value, GString *id)
+/* Append the value text, the caller has put the separator already. */
+static void format_vcd_value_bit(GString *s, uint8_t bit_value,
+	const struct vcd_channel_desc *desc)
 {
 
-	g_string_append_c(s, bit_value ? '1' : '0');
-	g_string_append(s, id->str);
+	g_string_append_len(s, &desc->bit_text[bit_value][1], desc->bit_len - 1);
 }
 
-static void format_vcd_value_real(GString *s, double real_value, GString *id)
+static void format_vcd_value_real(GString *s, double real_value,
+	const struct vcd_channel_desc *desc)
 {
 
-	g_string_append_c(s, 'r');
-	g_string_append_printf(s, "%.16g", real_value);
-	g_string_append_c(s, ' ');
-	g_string_append(s, id->str);
+	g_string_append_printf(s, "r%.16g %s", real_value, desc->name);
 }
 
 static int init(struct sr_output *o, GHashTable *options)
@@ -208,10 +256,9 @@ static int init(struct sr_output *o, GHashTable *options)
 	size_t alloc_size;
 	struct sr_channel *ch;
 	GSList *l;
-	size_t num_enabled, num_logic, num_analog, desc_idx;
+	size_t num_enabled, num_logic, num_analog, desc_idx, len;
 	struct vcd_channel_desc *desc;
-
-	(void)options;
+	char *ident;
 
 	/* Determine the number of involved channels. */
 	num_enabled = 0;
@@ -243,36 +290,54 @@ static int init(struct sr_output *o, GHashTable *options)
 	ctx->analog_count = num_analog;
 	alloc_size = sizeof(ctx->channels[0]) * ctx->enabled_count;
 	ctx->channels = g_malloc0(alloc_size);
+	ctx->idents = g_malloc0(VCD_IDENT_SIZE * ctx->enabled_count);
+	ctx->vcd_queue = g_array_new(FALSE, FALSE, sizeof(struct vcd_queue_item));
+	ctx->vcd_queue_pos = QUEUE_POS_NONE;
+	ctx->free_strings = g_ptr_array_new();
+	ctx->num_threads = g_variant_get_uint32(g_hash_table_lookup(options,
+		"threads"));
+	if (!ctx->num_threads)
+		ctx->num_threads = g_get_num_processors();
 
 	/*
 	 * Reiterate input descriptions, to fill in output descriptions.
-	 * Map channel indices, and assign symbols to VCD channels.
+	 * Map channel indices, and assign symbols to VCD channels. The
+	 * symbols live in one table. The text of logic value changes
+	 * gets prepared for both states here, so that .receive() need
+	 * not format it.
 	 */
 	desc_idx = 0;
 	for (l = o->sdi->channels; l; l = l->next) {
 		ch = l->data;
 		if (!ch->enabled)
 			continue;
+		if (ch->type == SR_CHANNEL_LOGIC && num_logic)
+			num_logic--;
+		else if (ch->type == SR_CHANNEL_ANALOG && num_analog)
+			num_analog--;
+		else
+			continue;
 		desc = &ctx->channels[desc_idx];
 		desc->index = ch->index;
-		desc->name = vcd_identifier(desc_idx);
 		desc->type = ch->type;
+		ident = &ctx->idents[VCD_IDENT_SIZE * desc_idx];
+		len = vcd_identifier(desc_idx, ident);
+		desc->name = ident;
+		desc->bit_text[0][0] = ' ';
+		desc->bit_text[0][1] = '0';
+		memcpy(&desc->bit_text[0][2], ident, len + 1);
+		memcpy(desc->bit_text[1], desc->bit_text[0], len + 3);
+		desc->bit_text[1][1] = '1';
+		desc->bit_len = len + 2;
 		/*
 		 * Make sure to _not_ match next time, to have initial
 		 * values dumped when the first sample gets received.
+		 * Logic values get dumped for sample number 0 anyway.
 		 */
-		if (desc->type == SR_CHANNEL_LOGIC && num_logic) {
-			num_logic--;
-			desc->last.logic = ~0;
-		} else if (desc->type == SR_CHANNEL_ANALOG && num_analog) {
-			num_analog--;
+		if (desc->type == SR_CHANNEL_ANALOG) {
 			/* "Construct" NaN, avoid a compile time error. */
 			desc->last.real = 0.0;
 			desc->last.real = 0.0 / desc->last.real;
-		} else {
-			g_string_free(desc->name, TRUE);
-			memset(desc, 0, sizeof(*desc));
-			continue;
 		}
 		desc_idx++;
 	}
@@ -295,8 +360,10 @@ static int init(struct sr_output *o, GHashTable *options)
 	 */
 	alloc_size = (ctx->logic_count + 7) / 8;
 	ctx->last_logic = g_malloc0(alloc_size);
-	if (ctx->logic_count && !ctx->last_logic)
+	ctx->prev_logic = g_malloc0(alloc_size);
+	if (ctx->logic_count && (!ctx->last_logic || !ctx->prev_logic))
 		return SR_ERR_MALLOC;
+	ctx->last_logic_size = alloc_size;
 
 	return SR_OK;
 }
@@ -351,7 +418,7 @@ static GString *gen_header(const struct sr_output *o)
 	ctx = o->priv;
 
 	/* Get channel count, and samplerate if not done yet. */
-	num_channels = g_slist_length(o->sdi->channels);
+	num_channels = sr_dev_channel_count(o->sdi, 0, FALSE);
 	if (!ctx->samplerate) {
 		ret = sr_config_get(o->sdi->driver, o->sdi, NULL,
 			SR_CONF_SAMPLERATE, &gvar);
@@ -361,6 +428,9 @@ static GString *gen_header(const struct sr_output *o)
 		}
 	}
 	ctx->period = get_timescale_freq(ctx->samplerate);
+	ctx->ts_factor = 0;
+	if (ctx->samplerate && ctx->period % ctx->samplerate == 0)
+		ctx->ts_factor = ctx->period / ctx->samplerate;
 	t = time(NULL);
 	timestamp = g_strdup(ctime(&t));
 	timestamp[strlen(timestamp) - 1] = '\0';
@@ -401,7 +471,7 @@ static GString *gen_header(const struct sr_output *o)
 			continue;
 		}
 		g_string_append_printf(header, "$var %s %s %s %s $end\n",
-			type_text, size_text, desc->name->str, ch->name);
+			type_text, size_text, desc->name, ch->name);
 	}
 	g_string_append(header, "$upscope $end\n");
 
@@ -445,313 +515,100 @@ static GString *chk_header(const struct sr_output *o)
  * no other channel's data can arrive any more.
  */
 
-static struct vcd_queue_item *queue_alloc_item(struct context *ctx, uint64_t snum)
+/* Get an empty GString for a queue item, re-use released ones. */
+static GString *queue_alloc_values(struct context *ctx)
 {
-	GSList *node;
-	struct vcd_queue_item *item;
-
-	/* Get an item from the free list if available. */
-	node = ctx->free_list;
-	if (node) {
+	if (ctx->free_strings->len) {
 		ctx->reused++;
-
-		/* Unlink GSList node from the free list. */
-		ctx->free_list = node->next;
-		node->next = NULL;
-		item = node->data;
-		node->data = NULL;
-
-		/* Setup content of the item. */
-		item->samplenum = snum;
-		if (!item->values)
-			item->values = g_string_sized_new(32);
-		else
-			g_string_truncate(item->values, 0);
-
-		/* Keep GSList node in the used list (avoid free/alloc). */
-		node->next = ctx->used_list;
-		ctx->used_list = node;
-
-		return item;
+		return g_ptr_array_remove_index_fast(ctx->free_strings,
+			ctx->free_strings->len - 1);
 	}
 
-	/* Dynamic allocation of an item. */
 	ctx->alloced++;
-	item = g_malloc0(sizeof(*item));
-	if (!item)
-		return NULL;
-	item->samplenum = snum;
-	item->values = g_string_sized_new(32);
-
-	/* Create a used list item, to later move to the free list. */
-	ctx->used_list = g_slist_prepend(ctx->used_list, item);
-
-	return item;
+	return g_string_sized_new(32);
 }
 
-static void queue_free_item(struct context *ctx, struct vcd_queue_item *item)
+static void queue_free_values(struct context *ctx, GString *values)
 {
-	GSList *node;
-
-	/*
-	 * Put item back into the free list. We can assume to find a
-	 * used list node, it got allocated when the item was acquired.
-	 */
-	node = ctx->used_list;
-	if (node) {
-		ctx->pooled++;
-
-		ctx->used_list = node->next;
-		node->next = NULL;
-		node->data = item;
-
-		item->samplenum = 0;
-		g_string_truncate(item->values, 0);
-
-		node->next = ctx->free_list;
-		ctx->free_list = node;
-
-		return;
-	}
-
-	/*
-	 * Release dynamically allocated resources. Could also be used
-	 * to release free list items when the use list is empty.
-	 */
-	ctx->freed++;
-	if (item->values)
-		g_string_free(item->values, TRUE);
-	g_free(item);
-}
-
-static void queue_drain_pool_cb(gpointer data, gpointer cb_data)
-{
-	struct context *ctx;
-	struct vcd_queue_item *item;
-
-	item = data;
-	ctx = cb_data;
-	queue_free_item(ctx, item);
+	g_string_truncate(values, 0);
+	g_ptr_array_add(ctx->free_strings, values);
 }
 
 static void queue_drain_pool(struct context *ctx)
 {
-	GSList *list;
+	struct vcd_queue_item *item;
+	size_t i;
 
-	/*
-	 * Grab the list and "empty" the context member. Then
-	 * iterate over the items, have dymamic memory released.
-	 * Then free the GSList nodes (but not their data parts).
-	 * Do this for the used and the free lists.
-	 */
-	list = ctx->used_list;
-	ctx->used_list = NULL;
-	g_slist_foreach(list, queue_drain_pool_cb, ctx);
-	g_slist_free(list);
-
-	list = ctx->free_list;
-	ctx->free_list = NULL;
-	g_slist_foreach(list, queue_drain_pool_cb, ctx);
-	g_slist_free(list);
-}
+	if (!ctx->vcd_queue || !ctx->free_strings)
+		return;
 
-static int cmp_snum(gconstpointer l, gconstpointer d)
-{
-	const struct vcd_queue_item *list_item;
-	const uint64_t *snum_ptr;
-
-	list_item = l;
-	snum_ptr = d;
-	if (list_item->samplenum > *snum_ptr)
-		return +1;
-	if (list_item->samplenum < *snum_ptr)
-		return -1;
-	return 0;
-}
+	for (i = ctx->vcd_queue_head; i < ctx->vcd_queue->len; i++) {
+		item = &g_array_index(ctx->vcd_queue, struct vcd_queue_item, i);
+		g_string_free(item->values, TRUE);
+	}
+	g_array_free(ctx->vcd_queue, TRUE);
+	ctx->vcd_queue = NULL;
 
-static int cmp_items(gconstpointer a, gconstpointer b)
-{
-	const struct vcd_queue_item *item_a, *item_b;
-
-	item_a = a;
-	item_b = b;
-	if (item_a->samplenum > item_b->samplenum)
-		return +1;
-	if (item_a->samplenum < item_b->samplenum)
-		return -1;
-	return 0;
+	for (i = 0; i < ctx->free_strings->len; i++)
+		g_string_free(g_ptr_array_index(ctx->free_strings, i), TRUE);
+	g_ptr_array_free(ctx->free_strings, TRUE);
+	ctx->free_strings = NULL;
 }
 
 /*
- * Position the current pointer of the VCD value queue to a specific
- * sample number. Create a new queue item when needed. The logic assumes
- * a specific use pattern: Reception of striped sample data for channels
- * and processing in strict order of sample numbers within a channel.
- * Lower sample numbers near the start of the queue when channels change
- * between session feed packets, before another linear sequence follows.
+ * Position the current item of the VCD value queue at a specific sample
+ * number. Create a new queue item when needed.
  *
- * Naive use of convenience glib routines would severely lose performance.
- * That's why custom code is used, which is as complex as it needs to be,
- * yet shall execute faster than a simpler implementation. For trivial
- * cases (logic only, one analog channel only) this queue is bypassed.
+ * The queue is an array of items which is sorted by sample number, its
+ * not yet written items start at vcd_queue_head. Reception of striped
+ * sample data for channels is in strict order of sample numbers within
+ * a channel, so most lookups hit the current item, or append to the
+ * end. Other positions are found by binary search. Export cost scales
+ * with the number of value changes, not the number of samples. For
+ * trivial cases (logic only, one analog channel only) this queue is
+ * bypassed.
  */
 static int queue_samplenum(struct context *ctx, uint64_t snum)
 {
-	struct vcd_queue_item *item, *add_item;
-	GList *walk_list, *after_snum, *before_snum, *add_list;
-	GList *last;
-	gboolean add_after_last, do_search;
+	struct vcd_queue_item *items, add_item;
+	size_t lo, hi, mid, len;
+
+	items = (struct vcd_queue_item *)ctx->vcd_queue->data;
+	len = ctx->vcd_queue->len;
 
 	/* Already at that position? */
-	item = ctx->vcd_queue_last ? ctx->vcd_queue_last->data : NULL;
-	if (item && item->samplenum == snum)
+	if (ctx->vcd_queue_pos != QUEUE_POS_NONE &&
+			items[ctx->vcd_queue_pos].samplenum == snum)
 		return SR_OK;
 
-	/*
-	 * Search after the current position in the remaining queue. The
-	 * custom code uses the queue's being sorted by sample number.
-	 * Narrow down a later insert position as much as possible. This
-	 * avoids linear search in huge spaces later on.
-	 */
-	last = NULL;
-	add_after_last = FALSE;
-	after_snum = NULL;
-	before_snum = NULL;
-	walk_list = ctx->vcd_queue_last;
-	while (walk_list) {
-		item = walk_list->data;
-		if (!item)
-			break;
-		if (item->samplenum == snum) {
-			ctx->vcd_queue_last = walk_list;
-			return SR_OK;
-		}
-		last = walk_list;
-		if (item->samplenum < snum)
-			before_snum = walk_list;
-		if (item->samplenum > snum) {
-			after_snum = walk_list;
-			break;
-		}
-		if (!walk_list->next)
-			add_after_last = TRUE;
-		walk_list = walk_list->next;
-	}
-
-	/*
-	 * No exact match at or beyond the current position. Run another
-	 * search from the start of the queue, again restrict the space
-	 * which is searched, and narrow down the insert position when
-	 * no match is found.
-	 *
-	 * If the searched sample number is larger than any we have seen
-	 * before, or was in the above covered range but was not found,
-	 * then we know that another queue item needs to get added, and
-	 * where to put it. In that case we need not iterate the earlier
-	 * list items.
-	 */
-	walk_list = ctx->vcd_queue_list;
-	do_search = TRUE;
-	if (add_after_last)
-		do_search = FALSE;
-	if (before_snum)
-		do_search = FALSE;
-	while (do_search && walk_list && walk_list != ctx->vcd_queue_last) {
-		item = walk_list->data;
-		if (!item)
-			break;
-		if (item->samplenum == snum) {
-			ctx->vcd_queue_last = walk_list;
-			return SR_OK;
-		}
-		if (item->samplenum < snum)
-			before_snum = walk_list;
-		if (item->samplenum > snum) {
-			after_snum = walk_list;
-			break;
-		}
-		walk_list = walk_list->next;
-	}
-
-	/*
-	 * The complete existing queue was exhausted, no exact match was
-	 * found. A new queue item must get inserted. Identify a good
-	 * position where to start searching for the exact position to
-	 * link the new item to the list. Assume that the combination of
-	 * the glib routine's list traversal and the sample number check
-	 * in the callback is expensive, reduce the amount of work done.
-	 *
-	 * If we have seen an item with a larger sample number than the
-	 * wanted, check its immediate predecessor. If this has a smaller
-	 * sample number, then we found a perfect location to insert the
-	 * new item. If we know that the new item must be inserted after
-	 * the last traversed queue item, start there.
-	 */
-	if (!before_snum) do {
-		if (add_after_last)
-			break;
-		if (!after_snum)
-			break;
-		walk_list = after_snum->prev;
-		if (!walk_list)
-			break;
-		item = walk_list->data;
-		if (!item)
-			break;
-		if (item->samplenum == snum) {
-			ctx->vcd_queue_last = walk_list;
-			return SR_OK;
-		}
-		if (item->samplenum < snum)
-			before_snum = walk_list;
-	} while (0);
-	add_list = add_after_last ? last : before_snum;
-	if (!add_list) {
-		walk_list = ctx->vcd_queue_list;
-		while (walk_list) {
-			item = walk_list->data;
-			if (!item)
-				break;
-			if (item->samplenum == snum) {
-				ctx->vcd_queue_last = walk_list;
-				return SR_OK;
-			}
-			if (item->samplenum > snum) {
-				after_snum = walk_list;
-				break;
-			}
-			add_list = walk_list;
-			walk_list = walk_list->next;
-		}
+	/* Find the first item at or after the sample number. */
+	lo = ctx->vcd_queue_head;
+	hi = len;
+	if (lo < hi && items[hi - 1].samplenum < snum)
+		lo = hi;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (items[mid].samplenum < snum)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
-	if (add_list && (item = add_list->data) && item->samplenum == snum) {
-		ctx->vcd_queue_last = add_list;
+	if (lo < len && items[lo].samplenum == snum) {
+		ctx->vcd_queue_pos = lo;
 		return SR_OK;
 	}
 
 	/*
 	 * Create a new queue item for the so far untracked sample
-	 * number. Immediately search for the inserted position (is
-	 * unfortunately not returned from the insert call), and
-	 * cache that position for subsequent lookups.
+	 * number, and cache its position for subsequent lookups.
 	 */
 	if (with_queue_stats)
 		sr_dbg("%s(), queue nr %" PRIu64, __func__, snum);
-	add_item = queue_alloc_item(ctx, snum);
-	if (!add_item)
-		return SR_ERR_MALLOC;
-	if (!add_list)
-		add_list = ctx->vcd_queue_list;
-	if (add_list && add_list->prev)
-		add_list = add_list->prev;
-	walk_list = g_list_insert_sorted(add_list, add_item, cmp_items);
-	if (!walk_list->prev)
-		ctx->vcd_queue_list = walk_list;
-	walk_list = g_list_find_custom(walk_list, &snum, cmp_snum);
-	item = walk_list ? walk_list->data : NULL;
-	if (item && item->samplenum == snum) {
-		ctx->vcd_queue_last = walk_list;
-	}
+	add_item.samplenum = snum;
+	add_item.values = queue_alloc_values(ctx);
+	g_array_insert_val(ctx->vcd_queue, lo, add_item);
+	ctx->vcd_queue_pos = lo;
+
 	return SR_OK;
 }
 
@@ -766,9 +623,10 @@ static GString *queue_value_text_prep(struct context *ctx)
 	GString *buff;
 
 	/* Cope with not-yet-positioned write pointers. */
-	item = ctx->vcd_queue_last ? ctx->vcd_queue_last->data : NULL;
-	if (!item)
+	if (ctx->vcd_queue_pos == QUEUE_POS_NONE)
 		return NULL;
+	item = &g_array_index(ctx->vcd_queue, struct vcd_queue_item,
+		ctx->vcd_queue_pos);
 
 	/* Create a GString if not done already. */
 	buff = item->values;
@@ -784,15 +642,22 @@ static GString *queue_value_text_prep(struct context *ctx)
 	return buff;
 }
 
-static double snum_to_ts(struct context *ctx, uint64_t snum)
+/*
+ * The timescale usually is a multiple of the samplerate, which keeps
+ * the conversion in integers. Odd rates go through floating point.
+ */
+static uint64_t snum_to_ts(struct context *ctx, uint64_t snum)
 {
 	double ts;
 
+	if (ctx->ts_factor)
+		return snum * ctx->ts_factor;
+
 	ts = (double)snum;
 	ts /= ctx->samplerate;
 	ts *= ctx->period;
 
-	return ts;
+	return (uint64_t)nearbyint(ts);
 }
 
 /*
@@ -802,7 +667,7 @@ static double snum_to_ts(struct context *ctx, uint64_t snum)
 static int unqueue_item(struct context *ctx,
 	struct vcd_queue_item *item, GString *s)
 {
-	double ts;
+	uint64_t ts;
 	GString *buff;
 	gboolean is_empty;
 
@@ -934,7 +799,6 @@ static uint64_t get_max_snum_flush(struct context *ctx)
 static int write_completed_changes(struct context *ctx, GString *out)
 {
 	uint64_t upto_snum;
-	GList **listref, *node;
 	struct vcd_queue_item *item;
 	int rc;
 	size_t dumped;
@@ -945,40 +809,293 @@ static int write_completed_changes(struct context *ctx, GString *out)
 		sr_spew("%s(), check up to %" PRIu64, __func__, upto_snum);
 
 	/*
-	 * Forward and consume those items from the head of the list
+	 * Forward and consume those items from the head of the queue
 	 * which we completely have accumulated and are certain about.
 	 */
 	dumped = 0;
-	listref = &ctx->vcd_queue_list;
-	while (*listref) {
+	rc = SR_OK;
+	while (ctx->vcd_queue_head < ctx->vcd_queue->len) {
 		/* Find items before the targetted sample number. */
-		node = *listref;
-		item = node->data;
-		if (!item)
-			break;
+		item = &g_array_index(ctx->vcd_queue, struct vcd_queue_item,
+			ctx->vcd_queue_head);
 		if (item->samplenum >= upto_snum)
 			break;
 
-		/*
-		 * Unlink the item from the list. Void cached positions.
-		 * Append its timestamp and values to the caller's text.
-		 */
+		/* Append its timestamp and values to the caller's text. */
 		dumped++;
 		if (with_queue_stats)
 			sr_dbg("%s(), dump nr %" PRIu64,
 				__func__, item->samplenum);
-		if (ctx->vcd_queue_last == node)
-			ctx->vcd_queue_last = NULL;
-		*listref = g_list_remove_link(*listref, node);
 		rc = unqueue_item(ctx, item, out);
-		queue_free_item(ctx, item);
+		queue_free_values(ctx, item->values);
+		ctx->vcd_queue_head++;
 		if (rc != SR_OK)
-			return rc;
+			break;
 	}
 
+	/* Void cached positions, drop written items from the array. */
+	if (dumped) {
+		if (ctx->vcd_queue_pos != QUEUE_POS_NONE &&
+				ctx->vcd_queue_pos < ctx->vcd_queue_head)
+			ctx->vcd_queue_pos = QUEUE_POS_NONE;
+		if (ctx->vcd_queue_head == ctx->vcd_queue->len) {
+			g_array_set_size(ctx->vcd_queue, 0);
+			ctx->vcd_queue_head = 0;
+			ctx->vcd_queue_pos = QUEUE_POS_NONE;
+		} else if (ctx->vcd_queue_head > ctx->vcd_queue->len / 2) {
+			g_array_remove_range(ctx->vcd_queue, 0,
+				ctx->vcd_queue_head);
+			if (ctx->vcd_queue_pos != QUEUE_POS_NONE)
+				ctx->vcd_queue_pos -= ctx->vcd_queue_head;
+			ctx->vcd_queue_head = 0;
+		}
+	}
+
+	return rc;
+}
+
+/*
+ * Where logic value changes of a packet get written to. The previous
+ * sample is kept here, for the comparison of individual channels.
+ */
+struct vcd_logic_walk {
+	struct context *ctx;
+	GString *out;
+	uint64_t snum;
+	uint8_t *prev;
+	size_t unit_size;
+};
+
+/* Emit the text for one changed set of logic samples. */
+static int logic_change(uint64_t offset, const uint8_t *sample, void *cb_data)
+{
+	struct vcd_logic_walk *walk;
+	struct context *ctx;
+	struct vcd_channel_desc *desc;
+	uint64_t snum_curr;
+	size_t index, p;
+	uint8_t prevbit, curbit;
+	GString *s_val;
+	uint64_t ts;
+
+	walk = cb_data;
+	ctx = walk->ctx;
+	snum_curr = walk->snum + offset;
+
+	/*
+	 * Start or continue tracking that sample number.
+	 * Avoid string copies for logic-only setups.
+	 */
+	if (ctx->immediate_write) {
+		ts = snum_to_ts(ctx, snum_curr);
+		append_vcd_timestamp(walk->out, ts, FALSE);
+	} else {
+		queue_samplenum(ctx, snum_curr);
+	}
+
+	/* Iterate over individual logic channels. */
+	for (p = 0; p < ctx->enabled_count; p++) {
+		/*
+		 * TODO Check whether the mapping from
+		 * data image positions to channel numbers
+		 * is required. Experiments suggest that
+		 * the data image "is dense", and packs
+		 * bits of enabled channels, and leaves no
+		 * room for positions of disabled channels.
+		 */
+		desc = &ctx->channels[p];
+		if (desc->type != SR_CHANNEL_LOGIC)
+			continue;
+		index = desc->index;
+
+		/* Skip over unchanged values. */
+		prevbit = walk->prev[index / 8];
+		prevbit = (prevbit & (1 << (index % 8))) ? 1 : 0;
+		curbit = sample[index / 8];
+		curbit = (curbit & (1 << (index % 8))) ? 1 : 0;
+		if (snum_curr != 0 && prevbit == curbit)
+			continue;
+
+		/*
+		 * Queue, or immediately emit the text for
+		 * the observed value change.
+		 */
+		if (ctx->immediate_write) {
+			g_string_append_len(walk->out,
+				desc->bit_text[curbit], desc->bit_len);
+			continue;
+		}
+		s_val = queue_value_text_prep(ctx);
+		if (!s_val)
+			break;
+		format_vcd_value_bit(s_val, curbit, desc);
+	}
+	memcpy(walk->prev, sample, walk->unit_size);
+
 	return SR_OK;
 }
 
+/*
+ * Format the value changes of one range of a logic packet. The range
+ * starts with copies of the sample before it: one which the change
+ * detection updates, and one which logic_change() compares channels
+ * against. Only used in immediate write mode, the text goes to the
+ * range's own buffer.
+ */
+static void logic_range(struct vcd_range *range)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct vcd_logic_walk walk;
+
+	logic.length = range->count * range->unit_size;
+	logic.unitsize = range->unit_size;
+	logic.data = (void *)range->data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+
+	g_string_truncate(range->text, 0);
+	walk.ctx = range->ctx;
+	walk.out = range->text;
+	walk.snum = range->snum;
+	walk.prev = range->prev;
+	walk.unit_size = range->unit_size;
+	range->rc = sr_logic_changes_foreach(&packet, range->last,
+		range->snum == 0, logic_change, &walk);
+}
+
+static void range_worker(gpointer data, gpointer user_data)
+{
+	struct vcd_range *range;
+	struct vcd_workers *work;
+
+	range = data;
+	work = user_data;
+
+	logic_range(range);
+
+	g_mutex_lock(&work->mutex);
+	range->done = TRUE;
+	g_cond_broadcast(&work->cond);
+	g_mutex_unlock(&work->mutex);
+}
+
+static void workers_free(struct context *ctx)
+{
+	struct vcd_workers *work;
+	struct vcd_range *range;
+	size_t idx;
+
+	work = &ctx->work;
+	if (work->pool) {
+		g_thread_pool_free(work->pool, FALSE, TRUE);
+		work->pool = NULL;
+		g_mutex_clear(&work->mutex);
+		g_cond_clear(&work->cond);
+	}
+	for (idx = 0; idx < work->range_count; idx++) {
+		range = &work->ranges[idx];
+		g_free(range->last);
+		g_free(range->prev);
+		g_string_free(range->text, TRUE);
+	}
+	g_free(work->ranges);
+	work->ranges = NULL;
+	work->range_count = 0;
+}
+
+/* Returns FALSE when packets get formatted inline. */
+static gboolean workers_setup(struct context *ctx)
+{
+	struct vcd_workers *work;
+	size_t idx;
+
+	work = &ctx->work;
+	if (work->ranges)
+		return TRUE;
+	if (ctx->num_threads < 2)
+		return FALSE;
+
+	g_mutex_init(&work->mutex);
+	g_cond_init(&work->cond);
+	work->pool = g_thread_pool_new(range_worker, work,
+		ctx->num_threads, FALSE, NULL);
+	if (!work->pool) {
+		sr_warn("Cannot create formatter threads, formatting inline.");
+		g_mutex_clear(&work->mutex);
+		g_cond_clear(&work->cond);
+		ctx->num_threads = 1;
+		return FALSE;
+	}
+	work->ranges = g_malloc0_n(ctx->num_threads, sizeof(work->ranges[0]));
+	work->range_count = ctx->num_threads;
+	for (idx = 0; idx < work->range_count; idx++) {
+		work->ranges[idx].ctx = ctx;
+		work->ranges[idx].text = g_string_sized_new(4096);
+	}
+
+	return TRUE;
+}
+
+/*
+ * Format a large logic packet in ranges on the worker threads, and
+ * concatenate their text in order. Every range compares its first
+ * sample against the one before it, which stitches the ranges
+ * together as if the packet had been formatted in one go.
+ */
+static int logic_threaded(struct context *ctx,
+	const struct sr_datafeed_logic *logic, uint64_t snum, GString *out)
+{
+	struct vcd_workers *work;
+	struct vcd_range *range;
+	const uint8_t *data;
+	uint64_t count, start, len;
+	size_t unit_size, num, idx;
+	int rc;
+
+	work = &ctx->work;
+	data = logic->data;
+	unit_size = logic->unitsize;
+	count = logic->length / unit_size;
+	num = MIN(work->range_count, count / VCD_RANGE_SAMPLES);
+
+	start = 0;
+	for (idx = 0; idx < num; idx++) {
+		range = &work->ranges[idx];
+		len = (idx + 1 == num) ? count - start : count / num;
+		range->last = g_realloc(range->last, unit_size);
+		range->prev = g_realloc(range->prev, unit_size);
+		memcpy(range->last, idx ? &data[(start - 1) * unit_size]
+			: ctx->last_logic, unit_size);
+		memcpy(range->prev, range->last, unit_size);
+		range->data = &data[start * unit_size];
+		range->unit_size = unit_size;
+		range->count = len;
+		range->snum = snum + start;
+		range->done = FALSE;
+		g_thread_pool_push(work->pool, range, NULL);
+		start += len;
+	}
+
+	/* Collect the text in sample order. Wait for all before exit. */
+	rc = SR_OK;
+	for (idx = 0; idx < num; idx++) {
+		range = &work->ranges[idx];
+		g_mutex_lock(&work->mutex);
+		while (!range->done)
+			g_cond_wait(&work->cond, &work->mutex);
+		g_mutex_unlock(&work->mutex);
+		if (rc == SR_OK)
+			rc = range->rc;
+		if (rc == SR_OK)
+			g_string_append_len(out, range->text->str,
+				range->text->len);
+	}
+	memcpy(ctx->last_logic, &data[(count - 1) * unit_size], unit_size);
+
+	return rc;
+}
+
 /* Get packets from the session feed, generate output text. */
 static int receive(const struct sr_output *o,
 	const struct sr_datafeed_packet *packet, GString **out)
@@ -986,20 +1103,21 @@ static int receive(const struct sr_output *o,
 	struct context *ctx;
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
 	const struct sr_datafeed_analog *analog;
 	const struct sr_config *src;
 	GSList *l;
 	struct vcd_channel_desc *desc;
+	struct vcd_logic_walk walk;
 	uint64_t snum_curr;
-	size_t count, index, p, unit_size;
+	size_t count, index, unit_size;
 	gboolean changed;
 	GString *s_val;
-	uint8_t *sample, *last_logic, prevbit, curbit;
 	GSList *channels;
 	struct sr_channel *channel;
 	int rc;
 	float *floats, value;
-	double ts;
+	uint64_t ts;
 
 	*out = NULL;
 	if (!o || !o->priv)
@@ -1017,78 +1135,50 @@ static int receive(const struct sr_output *o,
 		}
 		break;
 	case SR_DF_LOGIC:
+	case SR_DF_LOGIC_RLE:
 		*out = chk_header(o);
 
-		logic = packet->payload;
-		sample = logic->data;
-		unit_size = logic->unitsize;
-		count = logic->length / unit_size;
-		snum_curr = get_last_snum_logic(ctx);
-		upd_last_snum_logic(ctx, count);
-
-		last_logic = ctx->last_logic;
-		while (count--) {
-			/* Check whether any logic value has changed. */
-			changed = memcmp(last_logic, sample, unit_size) != 0;
-			changed |= snum_curr == 0;
-			if (changed)
-				memcpy(last_logic, sample, unit_size);
-
-			/*
-			 * Start or continue tracking that sample number.
-			 * Avoid string copies for logic-only setups.
-			 */
-			if (changed) {
-				if (ctx->immediate_write) {
-					ts = snum_to_ts(ctx, snum_curr);
-					append_vcd_timestamp(*out, ts, FALSE);
-				} else {
-					queue_samplenum(ctx, snum_curr);
-				}
-			}
+		if (packet->type == SR_DF_LOGIC) {
+			logic = packet->payload;
+			unit_size = logic->unitsize;
+			count = unit_size ? logic->length / unit_size : 0;
+		} else {
+			logic = NULL;
+			rle = packet->payload;
+			unit_size = rle->unitsize;
+			count = rle->num_samples;
+		}
+		if (!count)
+			break;
 
-			/* Iterate over individual logic channels. */
-			for (p = 0; changed && p < ctx->enabled_count; p++) {
-				/*
-				 * TODO Check whether the mapping from
-				 * data image positions to channel numbers
-				 * is required. Experiments suggest that
-				 * the data image "is dense", and packs
-				 * bits of enabled channels, and leaves no
-				 * room for positions of disabled channels.
-				 */
-				desc = &ctx->channels[p];
-				if (desc->type != SR_CHANNEL_LOGIC)
-					continue;
-				index = desc->index;
-				prevbit = desc->last.logic;
-
-				/* Skip over unchanged values. */
-				curbit = sample[index / 8];
-				curbit = (curbit & (1 << (index % 8))) ? 1 : 0;
-				if (snum_curr != 0 && prevbit == curbit)
-					continue;
-				desc->last.logic = curbit;
-
-				/*
-				 * Queue, or immediately emit the text for
-				 * the observed value change.
-				 */
-				if (ctx->immediate_write) {
-					g_string_append_c(*out, ' ');
-					s_val = *out;
-				} else {
-					s_val = queue_value_text_prep(ctx);
-					if (!s_val)
-						break;
-				}
-				format_vcd_value_bit(s_val, curbit, desc->name);
-			}
+		if (unit_size > ctx->last_logic_size) {
+			ctx->last_logic = g_realloc(ctx->last_logic, unit_size);
+			ctx->prev_logic = g_realloc(ctx->prev_logic, unit_size);
+			ctx->last_logic_size = unit_size;
+		}
 
-			/* Advance to next set of logic samples. */
-			snum_curr++;
-			sample += unit_size;
+		/*
+		 * Only samples which changed get looked at. Large packets
+		 * get formatted on threads when the text goes out
+		 * immediately, the queue cannot be shared.
+		 */
+		walk.ctx = ctx;
+		walk.out = *out;
+		walk.snum = get_last_snum_logic(ctx);
+		walk.prev = ctx->prev_logic;
+		walk.unit_size = unit_size;
+		upd_last_snum_logic(ctx, count);
+		if (packet->type == SR_DF_LOGIC && ctx->immediate_write
+				&& count >= 2 * VCD_RANGE_SAMPLES
+				&& workers_setup(ctx)) {
+			rc = logic_threaded(ctx, logic, walk.snum, *out);
+		} else {
+			memcpy(walk.prev, ctx->last_logic, unit_size);
+			rc = sr_logic_changes_foreach(packet, ctx->last_logic,
+				walk.snum == 0, logic_change, &walk);
 		}
+		if (rc != SR_OK)
+			return rc;
 		write_completed_changes(ctx, *out);
 		break;
 	case SR_DF_ANALOG:
@@ -1156,7 +1246,7 @@ static int receive(const struct sr_output *o,
 				queue_samplenum(ctx, snum_curr + index);
 				s_val = queue_value_text_prep(ctx);
 			}
-			format_vcd_value_real(s_val, value, desc->name);
+			format_vcd_value_real(s_val, value, desc);
 		}
 
 		g_free(floats);
@@ -1178,7 +1268,6 @@ static int receive(const struct sr_output *o,
 static int cleanup(struct sr_output *o)
 {
 	struct context *ctx;
-	struct vcd_channel_desc *desc;
 
 	if (!o || !o->priv)
 		return SR_ERR_ARG;
@@ -1186,30 +1275,40 @@ static int cleanup(struct sr_output *o)
 	ctx = o->priv;
 
 	if (with_pool_stats)
-		sr_info("STATS: alloc/reuse %zu/%zu, pool/free %zu/%zu",
-			ctx->alloced, ctx->reused, ctx->pooled, ctx->freed);
+		sr_info("STATS: alloc/reuse %zu/%zu",
+			ctx->alloced, ctx->reused);
 	queue_drain_pool(ctx);
-	if (with_pool_stats)
-		sr_info("STATS: alloc/reuse %zu/%zu, pool/free %zu/%zu",
-			ctx->alloced, ctx->reused, ctx->pooled, ctx->freed);
+	workers_free(ctx);
 
-	while (ctx->enabled_count--) {
-		desc = &ctx->channels[ctx->enabled_count];
-		g_string_free(desc->name, TRUE);
-	}
+	g_free(ctx->idents);
 	g_free(ctx->channels);
+	g_free(ctx->last_logic);
+	g_free(ctx->prev_logic);
 	g_free(ctx);
 
 	return SR_OK;
 }
 
+static struct sr_option options[] = {
+	{"threads", "Threads", "Number of threads which format large logic packets, 0 uses all processors", NULL, NULL},
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_uint32(0));
+
+	return options;
+}
+
 struct sr_output_module output_vcd = {
 	.id = "vcd",
 	.name = "VCD",
 	.desc = "Value Change Dump data",
 	.exts = (const char*[]){"vcd", NULL},
-	.flags = 0,
-	.options = NULL,
+	.flags = SR_OUTPUT_LOGIC_RLE,
+	.options = get_options,
 	.init = init,
 	.receive = receive,
 	.cleanup = cleanup,
@@ -27,60 +27,89 @@
 /* Minimum/maximum number of samples per channel to put in a data chunk */
 #define MIN_DATA_CHUNK_SAMPLES 10
 
+enum {
+	FORMAT_FLOAT32,
+	FORMAT_PCM16,
+};
+
 struct out_context {
 	double scale;
+	/* Factor which gets applied to every value, 1 / scale. */
+	float factor;
+	int format;
+	/* Bytes per value in the data chunk. */
+	int sample_size;
 	gboolean header_done;
 	uint64_t samplerate;
 	int num_channels;
 	GSList *channels;
+	/* Output index + 1 of each enabled channel. */
+	GHashTable *channel_index;
+	/* Channels of the last packet, and their output indices. */
+	struct sr_channel **packet_channels;
+	int packet_num_channels;
+	int *packet_index;
+	gboolean packet_ordered;
 	int chanbuf_size;
 	int *chanbuf_used;
 	uint8_t **chanbuf;
 	float *fdata;
+	size_t fdata_size;
 };
 
-static int realloc_chanbufs(const struct sr_output *o, int size)
+static const char *formats[] = { "float32", "pcm16", };
+
+/* Make room for size samples per channel, keeping the buffered ones. */
+static int grow_chanbufs(const struct sr_output *o, int size)
 {
 	struct out_context *outc;
+	uint8_t *buf;
 	int i;
 
 	outc = o->priv;
 	for (i = 0; i < outc->num_channels; i++) {
-		if (!(outc->chanbuf[i] = g_try_realloc(outc->chanbuf[i], sizeof(float) * size))) {
+		if (!(buf = g_try_realloc(outc->chanbuf[i], outc->sample_size * size))) {
 			sr_err("Unable to allocate enough output buffer memory.");
 			return SR_ERR;
 		}
-		outc->chanbuf_used[i] = 0;
+		outc->chanbuf[i] = buf;
 	}
 	outc->chanbuf_size = size;
 
 	return SR_OK;
 }
 
+/* Grow the string by len bytes, and return the start of the new space. */
+static uint8_t *string_extend(GString *out, size_t len)
+{
+	size_t pos;
+
+	pos = out->len;
+	g_string_set_size(out, pos + len);
+
+	return (uint8_t *)out->str + pos;
+}
+
 static int flush_chanbufs(const struct sr_output *o, GString *out)
 {
 	struct out_context *outc;
-	int num_samples, i, j;
-	char *buf, *bufp;
+	int num_samples, size, i, j;
+	uint8_t *bufp;
 
 	outc = o->priv;
 
 	/* Any one of them will do. */
 	num_samples = outc->chanbuf_used[0];
-	if (!(buf = g_try_malloc(4 * num_samples * outc->num_channels))) {
-		sr_err("Unable to allocate enough interleaved output buffer memory.");
-		return SR_ERR;
-	}
+	size = outc->sample_size;
 
-	bufp = buf;
+	/* Interleave right into the output. */
+	bufp = string_extend(out, size * num_samples * outc->num_channels);
 	for (i = 0; i < num_samples; i++) {
 		for (j = 0; j < outc->num_channels; j++) {
-			memcpy(bufp, outc->chanbuf[j] + i * 4, 4);
-			bufp += 4;
+			memcpy(bufp, outc->chanbuf[j] + i * size, size);
+			bufp += size;
 		}
 	}
-	g_string_append_len(out, buf, 4 * num_samples * outc->num_channels);
-	g_free(buf);
 
 	for (i = 0; i < outc->num_channels; i++)
 		outc->chanbuf_used[i] = 0;
@@ -92,12 +121,25 @@ static int init(struct sr_output *o, GHashTable *options)
 {
 	struct out_context *outc;
 	struct sr_channel *ch;
+	const char *format;
 	GSList *l;
 
 	outc = g_malloc0(sizeof(struct out_context));
 	o->priv = outc;
 	outc->scale = g_variant_get_double(g_hash_table_lookup(options, "scale"));
+	outc->factor = (outc->scale != 0.0) ? 1.0 / outc->scale : 1.0;
+	format = g_variant_get_string(g_hash_table_lookup(options, "format"), NULL);
+	if (!strcmp(format, formats[FORMAT_PCM16])) {
+		outc->format = FORMAT_PCM16;
+		outc->sample_size = sizeof(int16_t);
+	} else {
+		if (strcmp(format, formats[FORMAT_FLOAT32]))
+			sr_warn("Unknown format '%s', using float32.", format);
+		outc->format = FORMAT_FLOAT32;
+		outc->sample_size = sizeof(float);
+	}
 
+	outc->channel_index = g_hash_table_new(g_direct_hash, g_direct_equal);
 	for (l = o->sdi->channels; l; l = l->next) {
 		ch = l->data;
 		if (ch->type != SR_CHANNEL_ANALOG)
@@ -106,13 +148,17 @@ static int init(struct sr_output *o, GHashTable *options)
 			continue;
 		outc->channels = g_slist_append(outc->channels, ch);
 		outc->num_channels++;
+		g_hash_table_insert(outc->channel_index, ch,
+			GINT_TO_POINTER(outc->num_channels));
 	}
 
-	outc->chanbuf = g_malloc0(sizeof(float *) * outc->num_channels);
+	outc->chanbuf = g_malloc0(sizeof(uint8_t *) * outc->num_channels);
 	outc->chanbuf_used = g_malloc0(sizeof(int) * outc->num_channels);
+	outc->packet_channels = g_malloc0(sizeof(struct sr_channel *) * outc->num_channels);
+	outc->packet_index = g_malloc0(sizeof(int) * outc->num_channels);
 
 	/* Start off the interleaved buffer with 100 samples/channel. */
-	realloc_chanbufs(o, 100);
+	grow_chanbufs(o, 100);
 
 	return SR_OK;
 }
@@ -127,8 +173,8 @@ static void add_data_chunk(const struct sr_output *o, GString *gs)
 	/* Remaining chunk size */
 	WL32(tmp, 0x12);
 	g_string_append_len(gs, tmp, 4);
-	/* Format code 3 = IEEE float */
-	WL16(tmp, 0x0003);
+	/* Format code 3 = IEEE float, 1 = PCM */
+	WL16(tmp, outc->format == FORMAT_PCM16 ? 0x0001 : 0x0003);
 	g_string_append_len(gs, tmp, 2);
 	/* Number of channels */
 	WL16(tmp, outc->num_channels);
@@ -136,14 +182,14 @@ static void add_data_chunk(const struct sr_output *o, GString *gs)
 	/* Samplerate */
 	WL32(tmp, outc->samplerate);
 	g_string_append_len(gs, tmp, 4);
-	/* Byterate, using 32-bit floats. */
-	WL32(tmp, outc->samplerate * outc->num_channels * 4);
+	/* Byterate */
+	WL32(tmp, outc->samplerate * outc->num_channels * outc->sample_size);
 	g_string_append_len(gs, tmp, 4);
 	/* Blockalign */
-	WL16(tmp, outc->num_channels * 4);
+	WL16(tmp, outc->num_channels * outc->sample_size);
 	g_string_append_len(gs, tmp, 2);
 	/* Bits per sample */
-	WL16(tmp, 32);
+	WL16(tmp, 8 * outc->sample_size);
 	g_string_append_len(gs, tmp, 2);
 	WL16(tmp, 0);
 	g_string_append_len(gs, tmp, 2);
@@ -182,24 +228,70 @@ static GString *gen_header(const struct sr_output *o)
 }
 
 /*
- * Stores the float in little-endian BINARY32 IEEE-754 2008 format.
+ * Scale count values, and store them in the output format (little-endian
+ * IEEE-754 binary32, or 16-bit PCM). The contiguous case keeps the loops
+ * simple enough for the compiler to vectorize.
  */
-static void float_to_le(uint8_t *buf, float value)
+static void convert(const struct out_context *outc, const float *in,
+		size_t in_stride, uint8_t *out, size_t out_stride, size_t count)
 {
-	uint8_t *old;
-
-	old = (uint8_t *)&value;
-#ifdef WORDS_BIGENDIAN
-	buf[0] = old[3];
-	buf[1] = old[2];
-	buf[2] = old[1];
-	buf[3] = old[0];
-#else
-	buf[0] = old[0];
-	buf[1] = old[1];
-	buf[2] = old[2];
-	buf[3] = old[3];
-#endif
+	float factor, v;
+	uint32_t u;
+	int16_t pcm;
+	size_t i;
+
+	factor = outc->factor;
+	if (outc->format == FORMAT_PCM16) {
+		for (i = 0; i < count; i++) {
+			v = in[i * in_stride] * factor * 32767.0f;
+			v = (v > 32767.0f) ? 32767.0f : (v < -32767.0f) ? -32767.0f : v;
+			pcm = (int16_t)(v + (v < 0 ? -0.5f : 0.5f));
+			WL16(out + i * out_stride, pcm);
+		}
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		v = in[i * in_stride] * factor;
+		memcpy(&u, &v, sizeof(u));
+		u = GUINT32_TO_LE(u);
+		memcpy(out + i * out_stride, &u, sizeof(u));
+	}
+}
+
+/* Look up the output index of each of the packet's channels. */
+static int map_channels(struct out_context *outc, const GSList *channels,
+		int num_channels)
+{
+	const GSList *l;
+	int i, idx;
+
+	/* Usually the packet has the same channels as the previous one. */
+	if (num_channels == outc->packet_num_channels) {
+		for (l = channels, i = 0; l; l = l->next, i++) {
+			if (l->data != outc->packet_channels[i])
+				break;
+		}
+		if (!l)
+			return SR_OK;
+	}
+
+	outc->packet_num_channels = 0;
+	outc->packet_ordered = TRUE;
+	for (l = channels, i = 0; l; l = l->next, i++) {
+		idx = GPOINTER_TO_INT(g_hash_table_lookup(outc->channel_index, l->data));
+		if (!idx) {
+			sr_err("Packet has a channel which is not enabled.");
+			return SR_ERR;
+		}
+		outc->packet_channels[i] = l->data;
+		outc->packet_index[i] = idx - 1;
+		if (idx - 1 != i)
+			outc->packet_ordered = FALSE;
+	}
+	outc->packet_num_channels = num_channels;
+
+	return SR_OK;
 }
 
 /*
@@ -240,11 +332,8 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_analog *analog;
 	const struct sr_config *src;
-	struct sr_channel *ch;
 	GSList *l;
-	const GSList *channels;
-	float f;
-	int num_channels, num_samples, size, *chan_idx, idx, i, j, ret;
+	int num_channels, num_samples, size, idx, j, ret;
 	float *data;
 	uint8_t *buf;
 
@@ -272,15 +361,7 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 
 		analog = packet->payload;
 		num_samples = analog->num_samples;
-		channels = analog->meaning->channels;
 		num_channels = g_slist_length(analog->meaning->channels);
-		if (!(data = g_try_realloc(outc->fdata, sizeof(float) * num_samples * num_channels)))
-			return SR_ERR_MALLOC;
-		outc->fdata = data;
-		ret = sr_analog_to_float(analog, data);
-		if (ret != SR_OK)
-			return ret;
-
 		if (num_samples == 0)
 			return SR_OK;
 
@@ -289,30 +370,50 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 					num_channels, outc->num_channels);
 			return SR_ERR;
 		}
+		if ((ret = map_channels(outc, analog->meaning->channels, num_channels)) != SR_OK)
+			return ret;
 
-		if (num_samples > outc->chanbuf_size) {
-			if (realloc_chanbufs(o, analog->num_samples) != SR_OK)
+		if (outc->fdata_size < (size_t)num_samples * num_channels) {
+			if (!(data = g_try_realloc(outc->fdata, sizeof(float) * num_samples * num_channels)))
 				return SR_ERR_MALLOC;
+			outc->fdata = data;
+			outc->fdata_size = (size_t)num_samples * num_channels;
 		}
+		data = outc->fdata;
+		ret = sr_analog_to_float(analog, data);
+		if (ret != SR_OK)
+			return ret;
 
-		/* Index the channels in this packet, so we can interleave quicker. */
-		chan_idx = g_malloc(sizeof(int) * outc->num_channels);
-		for (i = 0; i < num_channels; i++) {
-			ch = g_slist_nth_data((GSList *) channels, i);
-			chan_idx[i] = g_slist_index(outc->channels, ch);
+		size = outc->sample_size;
+		if (num_channels == outc->num_channels && check_chanbuf_size(o) < 0) {
+			/* All channels at once: no need to interleave. */
+			buf = string_extend(*out, size * num_samples * num_channels);
+			if (outc->packet_ordered) {
+				convert(outc, data, 1, buf, size, num_samples * num_channels);
+				break;
+			}
+			for (j = 0; j < num_channels; j++) {
+				convert(outc, data + j, num_channels,
+					buf + outc->packet_index[j] * size,
+					num_channels * size, num_samples);
+			}
+			break;
 		}
 
-		for (i = 0; i < num_samples; i++) {
-			for (j = 0; j < num_channels; j++) {
-				idx = chan_idx[j];
-				buf = outc->chanbuf[idx] + outc->chanbuf_used[idx]++ * 4;
-				f = data[i * num_channels + j];
-				if (outc->scale != 1.0)
-					f /= outc->scale;
-				float_to_le(buf, f);
+		for (j = 0; j < num_channels; j++) {
+			idx = outc->packet_index[j];
+			if (outc->chanbuf_used[idx] + num_samples > outc->chanbuf_size) {
+				if (grow_chanbufs(o, outc->chanbuf_used[idx] + num_samples) != SR_OK)
+					return SR_ERR_MALLOC;
 			}
 		}
-		g_free(chan_idx);
+
+		for (j = 0; j < num_channels; j++) {
+			idx = outc->packet_index[j];
+			buf = outc->chanbuf[idx] + outc->chanbuf_used[idx] * size;
+			convert(outc, data + j, num_channels, buf, size, num_samples);
+			outc->chanbuf_used[idx] += num_samples;
+		}
 
 		size = check_chanbuf_size(o);
 		if (size > MIN_DATA_CHUNK_SAMPLES)
@@ -322,7 +423,7 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	case SR_DF_END:
 		size = check_chanbuf_size(o);
 		if (size > 0) {
-			*out = g_string_sized_new(4 * size * outc->num_channels);
+			*out = g_string_sized_new(outc->sample_size * size * outc->num_channels);
 			if (flush_chanbufs(o, *out) != SR_OK)
 				return SR_ERR;
 		}
@@ -334,13 +435,21 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 
 static struct sr_option options[] = {
 	{ "scale", "Scale", "Scale values by factor", NULL, NULL },
+	{ "format", "Format", "Sample format (float32, or pcm16 with full scale at +/-1.0)", NULL, NULL },
 	ALL_ZERO
 };
 
 static const struct sr_option *get_options(void)
 {
-	if (!options[0].def)
+	unsigned int i;
+
+	if (!options[0].def) {
 		options[0].def = g_variant_ref_sink(g_variant_new_double(1.0));
+		options[1].def = g_variant_ref_sink(g_variant_new_string(formats[0]));
+		for (i = 0; i < ARRAY_SIZE(formats); i++)
+			options[1].values = g_slist_append(options[1].values,
+				g_variant_ref_sink(g_variant_new_string(formats[i])));
+	}
 
 	return options;
 }
@@ -352,11 +461,13 @@ static int cleanup(struct sr_output *o)
 
 	outc = o->priv;
 	g_slist_free(outc->channels);
-	g_variant_unref(options[0].def);
+	g_hash_table_destroy(outc->channel_index);
 	for (i = 0; i < outc->num_channels; i++)
 		g_free(outc->chanbuf[i]);
 	g_free(outc->chanbuf_used);
 	g_free(outc->chanbuf);
+	g_free(outc->packet_channels);
+	g_free(outc->packet_index);
 	g_free(outc->fdata);
 	g_free(outc);
 	o->priv = NULL;
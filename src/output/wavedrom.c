@@ -24,38 +24,67 @@
 
 #define LOG_PREFIX "output/wavedrom"
 
+/*
+ * The samples of a channel, as the lengths of its runs of samples of
+ * the same value. The values alternate, starting at first_value.
+ */
+struct channel_runs {
+	gboolean have_value;
+	gboolean first_value;
+	gboolean value;
+	GArray *runs;
+	uint64_t run;
+};
+
 struct context {
 	uint32_t channel_count;
 	struct sr_channel **channels;
-	GString **channel_outputs; /* output strings */
+	struct channel_runs *channel_runs;
+	/* The bits of the enabled logic channels in a sample. */
+	uint8_t *mask;
+	size_t mask_size;
 };
 
+static void render_repeats(GString *output, uint64_t count)
+{
+	static const char dots[] = "................................"
+		"................................";
+	size_t len;
+
+	while (count) {
+		len = MIN(count, sizeof(dots) - 1);
+		g_string_append_len(output, dots, len);
+		count -= len;
+	}
+}
+
 /* Converts accumulated output data to a JSON string. */
 static GString *wavedrom_render(const struct context *ctx)
 {
+	const struct channel_runs *cr;
 	GString *output;
-	size_t ch, i;
-	char last_char, curr_char;
+	size_t ch;
+	guint i;
+	gboolean value;
 
 	output = g_string_new("{ \"signal\": [");
 	for (ch = 0; ch < ctx->channel_count; ch++) {
-		if (!ctx->channel_outputs[ch])
+		cr = &ctx->channel_runs[ch];
+		if (!cr->runs)
 			continue;
 
 		/* Channel strip. */
 		g_string_append_printf(output,
 			"{ \"name\": \"%s\", \"wave\": \"", ctx->channels[ch]->name);
 
-		last_char = 0;
-		for (i = 0; i < ctx->channel_outputs[ch]->len; i++) {
-			curr_char = ctx->channel_outputs[ch]->str[i];
-			/* Data point. */
-			if (curr_char == last_char) {
-				g_string_append_c(output, '.');
-			} else {
-				g_string_append_c(output, curr_char);
-				last_char = curr_char;
-			}
+		/* A run is its value, followed by a '.' per repetition. */
+		value = cr->first_value;
+		for (i = 0; i <= cr->runs->len && cr->have_value; i++) {
+			g_string_append_c(output, value ? '1' : '0');
+			render_repeats(output, (i < cr->runs->len
+				? g_array_index(cr->runs, uint64_t, i)
+				: cr->run) - 1);
+			value = !value;
 		}
 		if (ch < ctx->channel_count - 1) {
 			g_string_append(output, "\" },");
@@ -69,52 +98,70 @@ static GString *wavedrom_render(const struct context *ctx)
 	return output;
 }
 
+/* Add a run of samples of the same value to each channel. */
+static void process_run(const struct context *ctx, const uint8_t *sample,
+	size_t unitsize, uint64_t length)
+{
+	struct channel_runs *cr;
+	size_t ch;
+	gboolean bit;
+
+	for (ch = 0; ch < ctx->channel_count; ch++) {
+		cr = &ctx->channel_runs[ch];
+		if (!cr->runs)
+			continue;
+		bit = ch / 8 < unitsize && (sample[ch / 8] & (1 << (ch % 8)));
+		if (!cr->have_value) {
+			cr->have_value = TRUE;
+			cr->first_value = cr->value = bit;
+		} else if (bit != cr->value) {
+			g_array_append_val(cr->runs, cr->run);
+			cr->run = 0;
+			cr->value = bit;
+		}
+		cr->run += length;
+	}
+}
+
 static void process_logic(const struct context *ctx,
 	const struct sr_datafeed_logic *logic)
 {
-	size_t sample_count, ch, i;
-	uint8_t *sample, bit;
-	GString *accu;
+	uint64_t sample_count, i, next;
+	const uint8_t *mask;
 
-	if (!ctx->channel_count)
+	if (!ctx->channel_count || !logic->unitsize)
 		return;
 
 	/*
-	 * Extract the logic bits for each channel and store them
-	 * as wavedrom letters (1/0) in each channel's text string.
-	 * This transforms the input which consists of sample sets
-	 * that span multiple channels into output stripes per logic
-	 * channel which consist of bits for that individual channel.
-	 *
-	 * TODO Reduce memory consumption during accumulation of
-	 * output data.
-	 *
-	 * Ideally we'd accumulate binary chunks, and defer conversion
-	 * to the text format. Analog data already won't get here, only
-	 * logic data does. When the per-channel transformation also
-	 * gets deferred until later, then the only overhead would be
-	 * for disabled logic channels. Which may be acceptable or even
-	 * negligable.
-	 *
-	 * An optional addition to the above mentioned accumulation of
-	 * binary data is RLE compression. Mark both the position in the
-	 * accumulated data as well as a repetition counter, instead of
-	 * repeatedly storing the same sample set. The efficiency of
-	 * this approach of course depends on the change rate of input
-	 * data. But the approach perfectly matches the WaveDrom syntax
-	 * for repeated bit patterns, and thus is easily handled in the
-	 * text rendering stage of the output module.
+	 * Keep the samples of each channel as run lengths, which match
+	 * the WaveDrom syntax for repeated values, and defer conversion
+	 * to the text format until the end of the data feed. Runs of
+	 * sample sets in which no enabled channel changes get skipped
+	 * word by word.
 	 */
+	mask = logic->unitsize <= ctx->mask_size ? ctx->mask : NULL;
 	sample_count = logic->length / logic->unitsize;
-	for (i = 0; i < sample_count; i++) {
-		sample = logic->data + i * logic->unitsize;
-		for (ch = 0; ch < ctx->channel_count; ch++) {
-			accu = ctx->channel_outputs[ch];
-			if (!accu)
-				continue;
-			bit = sample[ch / 8] & (1 << (ch % 8));
-			g_string_append_c(accu, bit ? '1' : '0');
-		}
+	for (i = 0; i < sample_count; i = next) {
+		next = sr_logic_next_change(logic->data, logic->unitsize,
+			i, sample_count, mask);
+		process_run(ctx, (const uint8_t *)logic->data
+			+ i * logic->unitsize, logic->unitsize, next - i);
+	}
+}
+
+static void process_logic_rle(const struct context *ctx,
+	const struct sr_datafeed_logic_rle *rle)
+{
+	uint64_t i, end;
+
+	if (!ctx->channel_count)
+		return;
+
+	for (i = 0; i < rle->num_changes; i++) {
+		end = i + 1 < rle->num_changes
+			? rle->offsets[i + 1] : rle->num_samples;
+		process_run(ctx, (const uint8_t *)rle->values + i * rle->unitsize,
+			rle->unitsize, end - rle->offsets[i]);
 	}
 }
 
@@ -134,6 +181,9 @@ static int receive(const struct sr_output *o,
 	case SR_DF_LOGIC:
 		process_logic(ctx, packet->payload);
 		break;
+	case SR_DF_LOGIC_RLE:
+		process_logic_rle(ctx, packet->payload);
+		break;
 	case SR_DF_END:
 		*out = wavedrom_render(ctx);
 		break;
@@ -159,14 +209,18 @@ static int init(struct sr_output *o, GHashTable *options)
 	ctx->channel_count = g_slist_length(o->sdi->channels);
 	ctx->channels = g_malloc0(
 		sizeof(ctx->channels[0]) * ctx->channel_count);
-	ctx->channel_outputs = g_malloc0(
-		sizeof(ctx->channel_outputs[0]) * ctx->channel_count);
+	ctx->channel_runs = g_malloc0(
+		sizeof(ctx->channel_runs[0]) * ctx->channel_count);
+	ctx->mask_size = (ctx->channel_count + 7) / 8;
+	ctx->mask = g_malloc0(MAX(ctx->mask_size, 1));
 
 	for (i = 0, l = o->sdi->channels; l; l = l->next, i++) {
 		channel = l->data;
 		if (channel->enabled && channel->type == SR_CHANNEL_LOGIC) {
 			ctx->channels[i] = channel;
-			ctx->channel_outputs[i] = g_string_new(NULL);
+			ctx->channel_runs[i].runs = g_array_new(FALSE, FALSE,
+				sizeof(uint64_t));
+			ctx->mask[i / 8] |= 1 << (i % 8);
 		}
 	}
 
@@ -176,7 +230,7 @@ static int init(struct sr_output *o, GHashTable *options)
 static int cleanup(struct sr_output *o)
 {
 	struct context *ctx;
-	GString *s;
+	size_t i;
 
 	if (!o)
 		return SR_ERR_ARG;
@@ -185,12 +239,12 @@ static int cleanup(struct sr_output *o)
 	o->priv = NULL;
 
 	if (ctx) {
-		while (--ctx->channel_count) {
-			s = ctx->channel_outputs[ctx->channel_count];
-			if (s)
-				g_string_free(s, TRUE);
+		for (i = 0; i < ctx->channel_count; i++) {
+			if (ctx->channel_runs[i].runs)
+				g_array_free(ctx->channel_runs[i].runs, TRUE);
 		}
-		g_free(ctx->channel_outputs);
+		g_free(ctx->channel_runs);
+		g_free(ctx->mask);
 		g_free(ctx->channels);
 		g_free(ctx);
 	}
@@ -203,7 +257,7 @@ SR_PRIV struct sr_output_module output_wavedrom = {
 	.name = "WaveDrom",
 	.desc = "WaveDrom.com file format",
 	.exts = (const char *[]){"wavedrom", "json", NULL},
-	.flags = 0,
+	.flags = SR_OUTPUT_LOGIC_RLE,
 	.options = NULL,
 	.init = init,
 	.receive = receive,
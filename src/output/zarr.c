@@ -0,0 +1,596 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Chunked array output in the Zarr (version 2) layout, stored in a ZIP
+ * archive (a Zarr "ZipStore"), e.g. for zarr.open(zarr.ZipStore(name))
+ * or xarray.
+ *
+ * The archive holds one array for the logic data, "logic", with the
+ * packed samples (1-D of unsigned integers for unit sizes of 1, 2, 4
+ * or 8 bytes, else 2-D of bytes), and one array per enabled analog
+ * channel, "analog/<name>", of 32 bit floats. Each chunk of an array
+ * is an entry of its own, deflated by the ZIP layer (in parallel by
+ * the compression threads), so that readers can get at any range of
+ * samples by inflating only the chunks which cover it. Attributes:
+ *
+ * /            sigrok_version, driver, samplerate, trigger (the sample
+ *              numbers of triggers in the logic data)
+ * logic        channels (names and bit numbers)
+ * analog/<ch>  channel, index, and from the first packet's meaning:
+ *              mq, mq_id, unit, unit_id, mqflags, mqflags_id
+ *
+ * Options:
+ *
+ * chunk:       The number of samples per chunk. Defaults to 1048576.
+ *
+ * compression: The deflate level of chunks, 0 stores them. Defaults to 6.
+ *
+ * threads:     The number of compression threads, 0 uses all processors.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/zarr"
+
+#define DEFAULT_CHUNK_SAMPLES	(1024 * 1024)
+#define DEFAULT_COMPRESSION	6
+
+struct dataset {
+	char *path;
+	struct sr_channel *ch;
+	/* Bytes per sample, 0 until the first packet. */
+	size_t width;
+	gboolean two_dim;
+	uint8_t *buf;
+	size_t fill;
+	uint64_t length;
+	uint64_t chunks;
+	GString *attrs;
+};
+
+struct context {
+	char *filename;
+	int level;
+	guint threads;
+	size_t chunk_samples;
+	struct sr_zip_writer *zip;
+	gboolean zip_created;
+	gboolean zip_finished;
+	uint64_t samplerate;
+	GString *triggers;
+	struct dataset logic;
+	GString *logic_channels;
+	struct dataset *analog;
+	size_t num_analog;
+	float *fbuf;
+	size_t fbuf_size;
+};
+
+/* Append a string as a JSON string literal. */
+static void json_append_string(GString *s, const char *str)
+{
+	g_string_append_c(s, '"');
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\')
+			g_string_append_c(s, '\\');
+		if ((unsigned char)*str < 0x20)
+			g_string_append_printf(s, "\\u%04x", (unsigned char)*str);
+		else
+			g_string_append_c(s, *str);
+	}
+	g_string_append_c(s, '"');
+}
+
+/* Array paths only take a subset of the characters of channel names. */
+static char *dataset_path(const char *prefix, const char *name)
+{
+	GString *path;
+
+	path = g_string_new(prefix);
+	for (; *name; name++) {
+		if (g_ascii_isalnum(*name) || *name == '_' || *name == '-')
+			g_string_append_c(path, *name);
+		else
+			g_string_append_c(path, '_');
+	}
+
+	return g_string_free(path, FALSE);
+}
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct context *ctx;
+	struct sr_channel *ch;
+	struct dataset *ds;
+	GSList *l;
+	size_t chunk, i, j;
+	guint level;
+
+	if (!o->filename || o->filename[0] == '\0') {
+		sr_info("zarr output module requires a file name, cannot save.");
+		return SR_ERR_ARG;
+	}
+	if (!o->sdi)
+		return SR_ERR_ARG;
+
+	chunk = g_variant_get_uint32(g_hash_table_lookup(options, "chunk"));
+	level = g_variant_get_uint32(g_hash_table_lookup(options, "compression"));
+	if (!chunk) {
+		sr_err("Invalid chunk size of zero samples.");
+		return SR_ERR_ARG;
+	}
+	if (level > 9) {
+		sr_err("Compression level %u out of range (0-9).", level);
+		return SR_ERR_ARG;
+	}
+
+	ctx = g_malloc0(sizeof(*ctx));
+	o->priv = ctx;
+	ctx->filename = g_strdup(o->filename);
+	ctx->level = level;
+	ctx->threads = g_variant_get_uint32(g_hash_table_lookup(options, "threads"));
+	ctx->chunk_samples = chunk;
+	ctx->triggers = g_string_new(NULL);
+	ctx->logic.path = g_strdup("logic");
+	ctx->logic_channels = g_string_new(NULL);
+
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (!ch->enabled)
+			continue;
+		if (ch->type == SR_CHANNEL_LOGIC) {
+			g_string_append(ctx->logic_channels,
+				ctx->logic_channels->len ? ", " : "");
+			json_append_string(ctx->logic_channels, ch->name);
+			g_string_append_printf(ctx->logic_channels, ": %d", ch->index);
+		} else if (ch->type == SR_CHANNEL_ANALOG) {
+			ctx->num_analog++;
+		}
+	}
+
+	ctx->analog = g_malloc0(sizeof(ctx->analog[0]) * (ctx->num_analog + 1));
+	i = 0;
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (!ch->enabled || ch->type != SR_CHANNEL_ANALOG)
+			continue;
+		ds = &ctx->analog[i];
+		ds->ch = ch;
+		ds->width = sizeof(float);
+		ds->path = dataset_path("analog/", ch->name);
+		/* Names which map to the same path get the index appended. */
+		for (j = 0; j < i; j++) {
+			if (strcmp(ctx->analog[j].path, ds->path))
+				continue;
+			g_free(ds->path);
+			ds->path = g_strdup_printf("analog/%d", ch->index);
+			break;
+		}
+		i++;
+	}
+
+	return SR_OK;
+}
+
+static int zip_create(const struct sr_output *o)
+{
+	struct context *ctx;
+	GVariant *gvar;
+
+	ctx = o->priv;
+	if (ctx->samplerate == 0 && sr_config_get(o->sdi->driver, o->sdi, NULL,
+			SR_CONF_SAMPLERATE, &gvar) == SR_OK) {
+		ctx->samplerate = g_variant_get_uint64(gvar);
+		g_variant_unref(gvar);
+	}
+
+	ctx->zip = sr_zip_writer_new(ctx->filename, ctx->level, ctx->threads,
+		FALSE, SR_DISK_SYNC_NONE);
+	if (!ctx->zip)
+		return SR_ERR_IO;
+	ctx->zip_created = TRUE;
+
+	return SR_OK;
+}
+
+/* Write the chunk in the dataset's buffer, padded with the fill value. */
+static int dataset_write_chunk(struct context *ctx, struct dataset *ds)
+{
+	size_t idx;
+	char *name;
+	int ret;
+
+	if (ds->ch) {
+		for (idx = ds->fill; idx < ctx->chunk_samples; idx++)
+			WLFL(&ds->buf[idx * ds->width], NAN);
+	} else {
+		memset(&ds->buf[ds->fill * ds->width], 0,
+			(ctx->chunk_samples - ds->fill) * ds->width);
+	}
+
+	name = g_strdup_printf("%s/%" PRIu64 "%s", ds->path, ds->chunks,
+		ds->two_dim ? ".0" : "");
+	ret = sr_zip_writer_add(ctx->zip, name, ds->buf,
+		ctx->chunk_samples * ds->width);
+	g_free(name);
+	ds->chunks++;
+	ds->fill = 0;
+
+	return ret;
+}
+
+static int dataset_append(struct context *ctx, struct dataset *ds,
+	const uint8_t *data, size_t count)
+{
+	size_t copy;
+	int ret;
+
+	if (!ds->buf)
+		ds->buf = g_malloc(ctx->chunk_samples * ds->width);
+
+	while (count) {
+		copy = MIN(count, ctx->chunk_samples - ds->fill);
+		memcpy(&ds->buf[ds->fill * ds->width], data, copy * ds->width);
+		ds->fill += copy;
+		ds->length += copy;
+		data += copy * ds->width;
+		count -= copy;
+		if (ds->fill < ctx->chunk_samples)
+			break;
+		if ((ret = dataset_write_chunk(ctx, ds)) != SR_OK)
+			return ret;
+	}
+
+	return SR_OK;
+}
+
+static int process_logic(struct context *ctx,
+	const struct sr_datafeed_logic *logic)
+{
+	struct dataset *ds;
+
+	if (!ctx->logic_channels->len || !logic->unitsize)
+		return SR_OK;
+
+	ds = &ctx->logic;
+	if (!ds->width) {
+		ds->width = logic->unitsize;
+		ds->two_dim = ds->width != 1 && ds->width != 2 &&
+			ds->width != 4 && ds->width != 8;
+	}
+	if (logic->unitsize != ds->width) {
+		sr_warn("Unexpected unit size, discarding logic data.");
+		return SR_ERR_ARG;
+	}
+
+	return dataset_append(ctx, ds, logic->data,
+		logic->length / logic->unitsize);
+}
+
+/* Attributes of an analog array, from the meaning of its first packet. */
+static GString *analog_attrs(const struct dataset *ds,
+	const struct sr_datafeed_analog *analog)
+{
+	const struct sr_key_info *info;
+	struct sr_datafeed_analog plain;
+	struct sr_analog_meaning meaning;
+	GString *attrs;
+	uint64_t flag;
+	char *unit;
+	gboolean first;
+
+	attrs = g_string_new("{\n  \"_ARRAY_DIMENSIONS\": [\"sample\"],\n  \"channel\": ");
+	json_append_string(attrs, ds->ch->name);
+	g_string_append_printf(attrs, ",\n  \"index\": %d", ds->ch->index);
+
+	info = sr_key_info_get(SR_KEY_MQ, analog->meaning->mq);
+	g_string_append(attrs, ",\n  \"mq\": ");
+	json_append_string(attrs, info ? info->id : "");
+	g_string_append_printf(attrs, ",\n  \"mq_id\": %d", analog->meaning->mq);
+
+	/* The unit string without the MQ flags. */
+	plain = *analog;
+	meaning = *analog->meaning;
+	meaning.mqflags = 0;
+	plain.meaning = &meaning;
+	unit = NULL;
+	sr_analog_unit_to_string(&plain, &unit);
+	g_string_append(attrs, ",\n  \"unit\": ");
+	json_append_string(attrs, unit ? unit : "");
+	g_free(unit);
+	g_string_append_printf(attrs, ",\n  \"unit_id\": %d", analog->meaning->unit);
+
+	g_string_append(attrs, ",\n  \"mqflags\": [");
+	first = TRUE;
+	for (flag = 1; flag; flag <<= 1) {
+		if (!(analog->meaning->mqflags & flag))
+			continue;
+		if (!(info = sr_key_info_get(SR_KEY_MQFLAGS, flag)))
+			continue;
+		g_string_append(attrs, first ? "" : ", ");
+		json_append_string(attrs, info->id);
+		first = FALSE;
+	}
+	g_string_append_printf(attrs, "],\n  \"mqflags_id\": %" PRIu64 "\n}\n",
+		(uint64_t)analog->meaning->mqflags);
+
+	return attrs;
+}
+
+static int process_analog(struct context *ctx,
+	const struct sr_datafeed_analog *analog)
+{
+	struct dataset *ds;
+	GSList *l;
+	size_t i, idx, smpl, size;
+	int ret;
+
+	if (!analog->num_samples)
+		return SR_OK;
+
+	size = analog->num_samples * sizeof(float);
+	if (size > ctx->fbuf_size) {
+		g_free(ctx->fbuf);
+		ctx->fbuf = g_malloc(size);
+		ctx->fbuf_size = size;
+	}
+
+	for (l = analog->meaning->channels, idx = 0; l; l = l->next, idx++) {
+		ds = NULL;
+		for (i = 0; i < ctx->num_analog; i++) {
+			if (ctx->analog[i].ch == l->data) {
+				ds = &ctx->analog[i];
+				break;
+			}
+		}
+		if (!ds)
+			continue;
+		if (!ds->attrs)
+			ds->attrs = analog_attrs(ds, analog);
+
+		ret = sr_analog_channel_to_float(analog, idx, ctx->fbuf, 1);
+		if (ret != SR_OK)
+			return ret;
+		/* The arrays are little endian. */
+		for (smpl = 0; smpl < analog->num_samples; smpl++)
+			WLFL(&ctx->fbuf[smpl], ctx->fbuf[smpl]);
+		ret = dataset_append(ctx, ds, (const uint8_t *)ctx->fbuf,
+			analog->num_samples);
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	return SR_OK;
+}
+
+static int add_text(struct context *ctx, const char *name, const GString *s)
+{
+	return sr_zip_writer_add(ctx->zip, name, s->str, s->len);
+}
+
+/* Write the last chunk and the metadata of an array. */
+static int dataset_finish(struct context *ctx, struct dataset *ds)
+{
+	GString *s;
+	char *name;
+	int ret;
+
+	if (ds->fill && (ret = dataset_write_chunk(ctx, ds)) != SR_OK)
+		return ret;
+
+	s = g_string_new("{\n  \"zarr_format\": 2,\n");
+	if (ds->two_dim) {
+		g_string_append_printf(s, "  \"shape\": [%" PRIu64 ", %zu],\n"
+			"  \"chunks\": [%zu, %zu],\n", ds->length, ds->width,
+			ctx->chunk_samples, ds->width);
+	} else {
+		g_string_append_printf(s, "  \"shape\": [%" PRIu64 "],\n"
+			"  \"chunks\": [%zu],\n", ds->length, ctx->chunk_samples);
+	}
+	if (ds->ch)
+		g_string_append(s, "  \"dtype\": \"<f4\",\n  \"fill_value\": \"NaN\",\n");
+	else if (ds->width == 1 || ds->two_dim)
+		g_string_append(s, "  \"dtype\": \"|u1\",\n  \"fill_value\": 0,\n");
+	else
+		g_string_append_printf(s, "  \"dtype\": \"<u%zu\",\n"
+			"  \"fill_value\": 0,\n", ds->width);
+	g_string_append(s, "  \"compressor\": null,\n  \"filters\": null,\n"
+		"  \"order\": \"C\"\n}\n");
+	name = g_strdup_printf("%s/.zarray", ds->path);
+	ret = add_text(ctx, name, s);
+	g_free(name);
+	g_string_free(s, TRUE);
+	if (ret != SR_OK)
+		return ret;
+
+	if (ds->ch) {
+		if (!ds->attrs)
+			return SR_OK;
+		s = g_string_new(ds->attrs->str);
+	} else {
+		s = g_string_new("{\n  \"_ARRAY_DIMENSIONS\": ");
+		g_string_append(s, ds->two_dim ?
+			"[\"sample\", \"byte\"]" : "[\"sample\"]");
+		g_string_append_printf(s, ",\n  \"channels\": {%s}\n}\n",
+			ctx->logic_channels->str);
+	}
+	name = g_strdup_printf("%s/.zattrs", ds->path);
+	ret = add_text(ctx, name, s);
+	g_free(name);
+	g_string_free(s, TRUE);
+
+	return ret;
+}
+
+static int zip_finish(const struct sr_output *o)
+{
+	struct context *ctx;
+	GString *s;
+	size_t i;
+	int ret;
+
+	ctx = o->priv;
+	if (!ctx->zip_created || ctx->zip_finished)
+		return SR_OK;
+	ctx->zip_finished = TRUE;
+
+	ret = SR_OK;
+	if (ctx->logic.width)
+		ret = dataset_finish(ctx, &ctx->logic);
+	for (i = 0; i < ctx->num_analog && ret == SR_OK; i++)
+		ret = dataset_finish(ctx, &ctx->analog[i]);
+	if (ret != SR_OK)
+		return ret;
+
+	s = g_string_new("{\n  \"zarr_format\": 2\n}\n");
+	ret = add_text(ctx, ".zgroup", s);
+	if (ret == SR_OK && ctx->num_analog)
+		ret = add_text(ctx, "analog/.zgroup", s);
+	g_string_free(s, TRUE);
+	if (ret != SR_OK)
+		return ret;
+
+	s = g_string_new("{\n  \"sigrok_version\": ");
+	json_append_string(s, sr_package_version_string_get());
+	if (o->sdi->driver) {
+		g_string_append(s, ",\n  \"driver\": ");
+		json_append_string(s, o->sdi->driver->name);
+	}
+	g_string_append_printf(s, ",\n  \"samplerate\": %" PRIu64
+		",\n  \"trigger\": [%s]\n}\n", ctx->samplerate, ctx->triggers->str);
+	ret = add_text(ctx, ".zattrs", s);
+	g_string_free(s, TRUE);
+	if (ret != SR_OK)
+		return ret;
+
+	return sr_zip_writer_finish(ctx->zip);
+}
+
+static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
+		GString **out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_meta *meta;
+	const struct sr_config *src;
+	GSList *l;
+	int ret;
+
+	*out = NULL;
+	if (!o || !o->sdi || !(ctx = o->priv))
+		return SR_ERR_ARG;
+
+	switch (packet->type) {
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key != SR_CONF_SAMPLERATE)
+				continue;
+			ctx->samplerate = g_variant_get_uint64(src->data);
+		}
+		break;
+	case SR_DF_TRIGGER:
+		g_string_append_printf(ctx->triggers, "%s%" PRIu64,
+			ctx->triggers->len ? ", " : "", ctx->logic.width ?
+			ctx->logic.length : ctx->analog[0].length);
+		break;
+	case SR_DF_LOGIC:
+		if (!ctx->zip_created && (ret = zip_create(o)) != SR_OK)
+			return ret;
+		return process_logic(ctx, packet->payload);
+	case SR_DF_ANALOG:
+		if (!ctx->zip_created && (ret = zip_create(o)) != SR_OK)
+			return ret;
+		return process_analog(ctx, packet->payload);
+	case SR_DF_END:
+		return zip_finish(o);
+	}
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{"chunk", "Chunk size", "Number of samples per chunk", NULL, NULL},
+	{"compression", "Compression", "Deflate level of chunks, 0 stores them uncompressed (0-9)", NULL, NULL},
+	{"threads", "Threads", "Number of compression threads, 0 uses all processors", NULL, NULL},
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_uint32(DEFAULT_CHUNK_SAMPLES));
+		options[1].def = g_variant_ref_sink(g_variant_new_uint32(DEFAULT_COMPRESSION));
+		options[2].def = g_variant_ref_sink(g_variant_new_uint32(0));
+	}
+
+	return options;
+}
+
+static void dataset_free(struct dataset *ds)
+{
+	g_free(ds->path);
+	g_free(ds->buf);
+	if (ds->attrs)
+		g_string_free(ds->attrs, TRUE);
+}
+
+static int cleanup(struct sr_output *o)
+{
+	struct context *ctx;
+	size_t i;
+
+	ctx = o->priv;
+
+	/* Complete the archive if the session did not end regularly. */
+	zip_finish(o);
+	sr_zip_writer_free(ctx->zip);
+
+	dataset_free(&ctx->logic);
+	for (i = 0; i < ctx->num_analog; i++)
+		dataset_free(&ctx->analog[i]);
+	g_free(ctx->analog);
+	g_string_free(ctx->logic_channels, TRUE);
+	g_string_free(ctx->triggers, TRUE);
+	g_free(ctx->fbuf);
+	g_free(ctx->filename);
+	g_free(ctx);
+	o->priv = NULL;
+
+	return SR_OK;
+}
+
+SR_PRIV struct sr_output_module output_zarr = {
+	.id = "zarr",
+	.name = "Zarr",
+	.desc = "Chunked Zarr arrays in a ZIP archive",
+	.exts = (const char*[]){"zip", NULL},
+	.flags = SR_OUTPUT_INTERNAL_IO_HANDLING,
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -0,0 +1,539 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Sequential ZIP archive writer, shared by the output modules which
+ * write archives (srzip, zarr). Entries can be deflated by a pool of
+ * worker threads, they still get written in the order of submission.
+ * The file gets written by a disk writer, see disk.c.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/zip"
+
+/*
+ * The archive is written sequentially while the acquisition runs: every
+ * chunk gets appended as soon as its buffer is full, and the ZIP central
+ * directory gets written once at the end. The file is kept open for the
+ * whole session, its size grows linearly with the amount of sample data.
+ * (libzip rewrites the archive on every close, which made long captures
+ * quadratically slower.)
+ */
+#define ZIP_LOCAL_HEADER_SIG	0x04034b50
+#define ZIP_CENTRAL_HEADER_SIG	0x02014b50
+#define ZIP_END_SIG		0x06054b50
+#define ZIP64_END_SIG		0x06064b50
+#define ZIP64_LOCATOR_SIG	0x07064b50
+#define ZIP_LOCAL_HEADER_LEN	30
+#define ZIP_CENTRAL_HEADER_LEN	46
+#define ZIP_END_LEN		22
+#define ZIP64_END_LEN		56
+#define ZIP64_LOCATOR_LEN	20
+#define ZIP_METHOD_STORE	0
+#define ZIP_METHOD_DEFLATE	8
+#define ZIP_U16_MAX		0xffff
+#define ZIP_U32_MAX		0xffffffffUL
+
+/*
+ * Stored chunks get their data aligned to this boundary, by padding the
+ * local header's extra field. Readers can then map them into memory.
+ */
+#define ZIP_DATA_ALIGN		4096
+#define ZIP_EXTRA_ALIGN_ID	0xd935
+
+/* Entries which may be in flight per compression thread. */
+#define JOBS_PER_THREAD		2
+
+struct zip_entry_info {
+	char *name;
+	uint64_t offset;
+	uint64_t size;
+	uint64_t comp_size;
+	uint32_t crc;
+	uint16_t method;
+};
+
+/*
+ * An archive entry on its way to the file. The checksum and the
+ * compressed data get computed by a worker thread (or inline when
+ * compression threads are not used), entries are then written in the
+ * order in which they were submitted.
+ */
+struct zip_job {
+	char *name;
+	const uint8_t *data;
+	uint8_t *data_copy;
+	size_t size;
+	int level;
+	uint8_t *comp_buf;
+	size_t comp_size;
+	uint32_t crc;
+	gboolean done;
+};
+
+struct sr_zip_writer {
+	struct sr_disk_writer *archive;
+	uint64_t archive_offset;
+	GArray *entries;
+	uint16_t dos_time, dos_date;
+	int level;
+	guint num_threads;
+	GThreadPool *pool;
+	GMutex job_mutex;
+	GCond job_cond;
+	GSList *jobs;
+	guint num_jobs;
+};
+
+static void entries_free(GArray *entries)
+{
+	size_t i;
+
+	if (!entries)
+		return;
+	for (i = 0; i < entries->len; i++)
+		g_free(g_array_index(entries, struct zip_entry_info, i).name);
+	g_array_free(entries, TRUE);
+}
+
+static int archive_write(struct sr_zip_writer *zw,
+	const void *data, size_t size)
+{
+	if (!size)
+		return SR_OK;
+	if (sr_disk_writer_write(zw->archive, data, size) != SR_OK) {
+		sr_err("Error writing session file.");
+		return SR_ERR_IO;
+	}
+	zw->archive_offset += size;
+
+	return SR_OK;
+}
+
+/*
+ * Compute the checksum and (optionally) the compressed representation
+ * of an entry. Only touches the job, so it may run in any thread. A
+ * compressed size of 0 means that the data gets stored as is.
+ */
+static void job_prepare(struct zip_job *job)
+{
+#ifdef HAVE_ZLIB
+	z_stream zs;
+	size_t bound;
+	int ret;
+#endif
+
+	job->crc = sr_crc32(0, job->data, job->size);
+	job->comp_size = 0;
+
+#ifdef HAVE_ZLIB
+	if (!job->level || job->size < 64)
+		return;
+
+	memset(&zs, 0, sizeof(zs));
+	if (deflateInit2(&zs, job->level, Z_DEFLATED,
+			-MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		return;
+	bound = deflateBound(&zs, job->size);
+	job->comp_buf = g_try_malloc(bound);
+	if (!job->comp_buf) {
+		deflateEnd(&zs);
+		return;
+	}
+	zs.next_in = (uint8_t *)job->data;
+	zs.avail_in = job->size;
+	zs.next_out = job->comp_buf;
+	zs.avail_out = bound;
+	ret = deflate(&zs, Z_FINISH);
+	deflateEnd(&zs);
+	if (ret != Z_STREAM_END || zs.total_out >= zs.total_in) {
+		g_free(job->comp_buf);
+		job->comp_buf = NULL;
+		return;
+	}
+	job->comp_size = zs.total_out;
+#endif
+}
+
+static void job_free(struct zip_job *job)
+{
+	g_free(job->name);
+	g_free(job->data_copy);
+	g_free(job->comp_buf);
+	g_free(job);
+}
+
+/* Append a prepared entry (local header plus data) to the archive. */
+static int job_commit(struct sr_zip_writer *zw, struct zip_job *job)
+{
+	struct zip_entry_info entry;
+	uint8_t header[ZIP_LOCAL_HEADER_LEN], *p;
+	uint8_t extra[ZIP_DATA_ALIGN + 4];
+	const void *payload;
+	size_t name_len, extra_len;
+	int ret;
+
+	name_len = strlen(job->name);
+	entry.name = g_strdup(job->name);
+	entry.offset = zw->archive_offset;
+	entry.size = job->size;
+	entry.crc = job->crc;
+	if (job->comp_size) {
+		entry.method = ZIP_METHOD_DEFLATE;
+		entry.comp_size = job->comp_size;
+		payload = job->comp_buf;
+	} else {
+		entry.method = ZIP_METHOD_STORE;
+		entry.comp_size = job->size;
+		payload = job->data;
+	}
+
+	extra_len = 0;
+	if (entry.method == ZIP_METHOD_STORE && entry.size >= ZIP_DATA_ALIGN) {
+		extra_len = ZIP_DATA_ALIGN - (entry.offset + sizeof(header)
+			+ name_len + 4) % ZIP_DATA_ALIGN;
+		extra_len = extra_len % ZIP_DATA_ALIGN + 4;
+		memset(extra, 0, extra_len);
+		p = extra;
+		write_u16le_inc(&p, ZIP_EXTRA_ALIGN_ID);
+		write_u16le_inc(&p, extra_len - 4);
+	}
+
+	p = header;
+	write_u32le_inc(&p, ZIP_LOCAL_HEADER_SIG);
+	write_u16le_inc(&p, 20);
+	write_u16le_inc(&p, 0);
+	write_u16le_inc(&p, entry.method);
+	write_u16le_inc(&p, zw->dos_time);
+	write_u16le_inc(&p, zw->dos_date);
+	write_u32le_inc(&p, entry.crc);
+	write_u32le_inc(&p, entry.comp_size);
+	write_u32le_inc(&p, entry.size);
+	write_u16le_inc(&p, name_len);
+	write_u16le_inc(&p, extra_len);
+
+	ret = archive_write(zw, header, sizeof(header));
+	if (ret == SR_OK)
+		ret = archive_write(zw, job->name, name_len);
+	if (ret == SR_OK)
+		ret = archive_write(zw, extra, extra_len);
+	if (ret == SR_OK)
+		ret = archive_write(zw, payload, entry.comp_size);
+	if (ret != SR_OK) {
+		sr_err("Failed to add chunk '%s'.", job->name);
+		g_free(entry.name);
+		return ret;
+	}
+	g_array_append_val(zw->entries, entry);
+
+	return SR_OK;
+}
+
+static void job_worker(gpointer data, gpointer user_data)
+{
+	struct sr_zip_writer *zw;
+	struct zip_job *job;
+
+	job = data;
+	zw = user_data;
+
+	job_prepare(job);
+
+	g_mutex_lock(&zw->job_mutex);
+	job->done = TRUE;
+	g_cond_broadcast(&zw->job_cond);
+	g_mutex_unlock(&zw->job_mutex);
+}
+
+/*
+ * Write completed entries in submission order. Waits until no more
+ * than 'max_pending' entries are in flight.
+ */
+static int jobs_commit(struct sr_zip_writer *zw, guint max_pending)
+{
+	struct zip_job *job;
+	int ret;
+
+	ret = SR_OK;
+	g_mutex_lock(&zw->job_mutex);
+	while (zw->jobs) {
+		job = zw->jobs->data;
+		if (!job->done) {
+			if (zw->num_jobs <= max_pending)
+				break;
+			g_cond_wait(&zw->job_cond, &zw->job_mutex);
+			continue;
+		}
+		zw->jobs = g_slist_delete_link(zw->jobs, zw->jobs);
+		zw->num_jobs--;
+		g_mutex_unlock(&zw->job_mutex);
+		if (ret == SR_OK)
+			ret = job_commit(zw, job);
+		job_free(job);
+		g_mutex_lock(&zw->job_mutex);
+	}
+	g_mutex_unlock(&zw->job_mutex);
+
+	return ret;
+}
+
+/*
+ * Add an entry to the archive. With compression threads, the data gets
+ * copied and compressed in the background, and this call only blocks
+ * when too many chunks are in flight. Without threads, the entry gets
+ * compressed and written right away.
+ */
+SR_PRIV int sr_zip_writer_add(struct sr_zip_writer *zw, const char *name,
+	const void *data, size_t size)
+{
+	struct zip_job *job;
+	int ret;
+
+	job = g_malloc0(sizeof(*job));
+	job->name = g_strdup(name);
+	job->size = size;
+	job->level = zw->level;
+
+	if (!zw->pool) {
+		job->data = data;
+		job_prepare(job);
+		ret = job_commit(zw, job);
+		job_free(job);
+		return ret;
+	}
+
+	job->data_copy = g_try_malloc(size ? size : 1);
+	if (!job->data_copy) {
+		job_free(job);
+		return SR_ERR_MALLOC;
+	}
+	memcpy(job->data_copy, data, size);
+	job->data = job->data_copy;
+
+	g_mutex_lock(&zw->job_mutex);
+	zw->jobs = g_slist_append(zw->jobs, job);
+	zw->num_jobs++;
+	g_mutex_unlock(&zw->job_mutex);
+	g_thread_pool_push(zw->pool, job, NULL);
+
+	return jobs_commit(zw, zw->num_threads * JOBS_PER_THREAD);
+}
+
+/* Write the central directory and end records, then close the file. */
+SR_PRIV int sr_zip_writer_finish(struct sr_zip_writer *zw)
+{
+	struct zip_entry_info *entry;
+	uint8_t header[ZIP_CENTRAL_HEADER_LEN + 4 + 8], *p;
+	uint64_t cd_offset, cd_size, zip64_offset;
+	struct sr_disk_stats stats;
+	gboolean zip64, need64;
+	size_t i, name_len;
+	int ret;
+
+	/* Wait for the chunks which are still being compressed. */
+	ret = jobs_commit(zw, 0);
+
+	cd_offset = zw->archive_offset;
+	zip64 = FALSE;
+	for (i = 0; ret == SR_OK && i < zw->entries->len; i++) {
+		entry = &g_array_index(zw->entries, struct zip_entry_info, i);
+		name_len = strlen(entry->name);
+		need64 = entry->offset >= ZIP_U32_MAX;
+		zip64 |= need64;
+
+		p = header;
+		write_u32le_inc(&p, ZIP_CENTRAL_HEADER_SIG);
+		write_u16le_inc(&p, (3 << 8) | 45);
+		write_u16le_inc(&p, need64 ? 45 : 20);
+		write_u16le_inc(&p, 0);
+		write_u16le_inc(&p, entry->method);
+		write_u16le_inc(&p, zw->dos_time);
+		write_u16le_inc(&p, zw->dos_date);
+		write_u32le_inc(&p, entry->crc);
+		write_u32le_inc(&p, entry->comp_size);
+		write_u32le_inc(&p, entry->size);
+		write_u16le_inc(&p, name_len);
+		write_u16le_inc(&p, need64 ? 4 + 8 : 0);
+		write_u16le_inc(&p, 0);
+		write_u16le_inc(&p, 0);
+		write_u16le_inc(&p, 0);
+		write_u32le_inc(&p, 0100644UL << 16);
+		write_u32le_inc(&p, need64 ? ZIP_U32_MAX : entry->offset);
+		ret = archive_write(zw, header, p - header);
+		if (ret == SR_OK)
+			ret = archive_write(zw, entry->name, name_len);
+		if (ret == SR_OK && need64) {
+			/* Zip64 extended information, local header offset. */
+			p = header;
+			write_u16le_inc(&p, 0x0001);
+			write_u16le_inc(&p, 8);
+			write_u64le_inc(&p, entry->offset);
+			ret = archive_write(zw, header, p - header);
+		}
+	}
+	cd_size = zw->archive_offset - cd_offset;
+	zip64 |= cd_offset >= ZIP_U32_MAX || zw->entries->len >= ZIP_U16_MAX;
+
+	if (ret == SR_OK && zip64) {
+		zip64_offset = zw->archive_offset;
+		p = header;
+		write_u32le_inc(&p, ZIP64_END_SIG);
+		write_u64le_inc(&p, ZIP64_END_LEN - 12);
+		write_u16le_inc(&p, (3 << 8) | 45);
+		write_u16le_inc(&p, 45);
+		write_u32le_inc(&p, 0);
+		write_u32le_inc(&p, 0);
+		write_u64le_inc(&p, zw->entries->len);
+		write_u64le_inc(&p, zw->entries->len);
+		write_u64le_inc(&p, cd_size);
+		write_u64le_inc(&p, cd_offset);
+		ret = archive_write(zw, header, p - header);
+		if (ret == SR_OK) {
+			p = header;
+			write_u32le_inc(&p, ZIP64_LOCATOR_SIG);
+			write_u32le_inc(&p, 0);
+			write_u64le_inc(&p, zip64_offset);
+			write_u32le_inc(&p, 1);
+			ret = archive_write(zw, header, p - header);
+		}
+	}
+	if (ret == SR_OK) {
+		p = header;
+		write_u32le_inc(&p, ZIP_END_SIG);
+		write_u16le_inc(&p, 0);
+		write_u16le_inc(&p, 0);
+		write_u16le_inc(&p, zip64 ? ZIP_U16_MAX : zw->entries->len);
+		write_u16le_inc(&p, zip64 ? ZIP_U16_MAX : zw->entries->len);
+		write_u32le_inc(&p, zip64 ? ZIP_U32_MAX : cd_size);
+		write_u32le_inc(&p, zip64 ? ZIP_U32_MAX : cd_offset);
+		write_u16le_inc(&p, 0);
+		ret = archive_write(zw, header, p - header);
+	}
+
+	if (sr_disk_writer_close(zw->archive) != SR_OK && ret == SR_OK) {
+		sr_err("Error saving session file.");
+		ret = SR_ERR_IO;
+	}
+	sr_disk_writer_stats(zw->archive, &stats);
+	sr_info("Wrote %" PRIu64 " bytes, write latency %" PRIu64
+		" us max., %" PRIu64 " us avg.", stats.bytes,
+		stats.write_us_max,
+		stats.writes ? stats.write_us_total / stats.writes : 0);
+	sr_disk_writer_free(zw->archive);
+	zw->archive = NULL;
+
+	return ret;
+}
+
+static void dos_timestamp(struct sr_zip_writer *zw)
+{
+	GDateTime *now;
+
+	now = g_date_time_new_now_local();
+	zw->dos_time = (g_date_time_get_hour(now) << 11) |
+		(g_date_time_get_minute(now) << 5) |
+		(g_date_time_get_second(now) / 2);
+	zw->dos_date = ((MAX(g_date_time_get_year(now), 1980) - 1980) << 9) |
+		(g_date_time_get_month(now) << 5) |
+		g_date_time_get_day_of_month(now);
+	g_date_time_unref(now);
+}
+
+
+/**
+ * Create a ZIP archive.
+ *
+ * @param[in] filename The name of the archive file, gets overwritten.
+ * @param[in] level The deflate level of entries, 0 stores them as is.
+ * @param[in] threads The number of compression threads, 0 uses all
+ *            processors.
+ * @param[in] direct Write the file around the page cache.
+ * @param[in] sync When to synchronize the file with the disk.
+ *
+ * @returns The writer, or NULL when the file can't get created.
+ */
+SR_PRIV struct sr_zip_writer *sr_zip_writer_new(const char *filename,
+	int level, guint threads, gboolean direct, enum sr_disk_sync sync)
+{
+	struct sr_zip_writer *zw;
+
+#ifndef HAVE_ZLIB
+	if (level)
+		sr_dbg("No zlib support, storing entries uncompressed.");
+	level = 0;
+#endif
+	/* Compression threads are pointless when nothing gets compressed. */
+	if (!threads)
+		threads = g_get_num_processors();
+	if (!level)
+		threads = 1;
+
+	zw = g_malloc0(sizeof(*zw));
+	zw->archive = sr_disk_writer_new(filename, direct, sync);
+	if (!zw->archive) {
+		g_free(zw);
+		return NULL;
+	}
+	zw->level = level;
+	zw->num_threads = threads;
+	zw->entries = g_array_new(FALSE, FALSE, sizeof(struct zip_entry_info));
+	g_mutex_init(&zw->job_mutex);
+	g_cond_init(&zw->job_cond);
+	dos_timestamp(zw);
+	if (zw->num_threads > 1) {
+		zw->pool = g_thread_pool_new(job_worker, zw,
+			zw->num_threads, FALSE, NULL);
+		if (!zw->pool)
+			sr_warn("Cannot create compression threads, compressing inline.");
+	}
+
+	return zw;
+}
+
+/**
+ * Free a ZIP archive writer.
+ *
+ * An archive which was not completed by sr_zip_writer_finish() gets
+ * closed as is, it lacks the central directory then.
+ *
+ * @param[in] zw The writer. Can be NULL.
+ */
+SR_PRIV void sr_zip_writer_free(struct sr_zip_writer *zw)
+{
+	if (!zw)
+		return;
+
+	if (zw->pool)
+		g_thread_pool_free(zw->pool, FALSE, TRUE);
+	g_slist_free_full(zw->jobs, (GDestroyNotify)job_free);
+	g_cond_clear(&zw->job_cond);
+	g_mutex_clear(&zw->job_mutex);
+	sr_disk_writer_free(zw->archive);
+	entries_free(zw->entries);
+	g_free(zw);
+}
@@ -0,0 +1,590 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Bounded recording of the most recent session data.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <sys/time.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "recorder"
+/** @endcond */
+
+/**
+ * @defgroup grp_recorder Recorder
+ *
+ * Keep the most recent data of a running session in a bounded ring.
+ *
+ * A recorder is a datafeed sink which holds as many of the most recent
+ * logic and analog packets as fit into its memory budget, dropping the
+ * oldest packets as new ones arrive. Memory use stays constant no matter
+ * how long the acquisition runs. Logic data can optionally be compressed
+ * while it is held.
+ *
+ * The recorded window can be written to an output module at any time,
+ * e.g. from a user event, or when a soft trigger fired.
+ *
+ * @{
+ */
+
+/** @cond PRIVATE */
+/* Bookkeeping overhead accounted for every recorded packet. */
+#define CHUNK_OVERHEAD 64
+
+struct recorder_chunk {
+	/* Analog or uncompressed logic data. */
+	struct sr_datafeed_packet *packet;
+	/* Compressed logic data. */
+	uint8_t *lzo_data;
+	size_t lzo_size;
+	size_t length;
+	uint16_t unitsize;
+	/* Memory accounted for this chunk. */
+	size_t size;
+};
+
+struct sr_recorder {
+	GMutex mutex;
+	uint64_t max_size;
+	uint64_t size;
+	gboolean compress;
+	GQueue chunks;
+	struct sr_datafeed_packet *header;
+	GSList *meta;
+	/* Compressor, and scratch space for both directions. */
+	struct sr_lzo *lzo;
+	GByteArray *lzo_out;
+	uint8_t *lzo_buf;
+	size_t lzo_buf_size;
+	/* Expanded run-length encoded logic data. */
+	uint8_t *rle_buf;
+	size_t rle_buf_size;
+
+	struct sr_trigger *trigger;
+	struct soft_trigger_logic *stl;
+	uint64_t post_trigger_samples;
+	uint64_t post_trigger_left;
+	gboolean triggered;
+	sr_recorder_callback cb;
+	void *cb_data;
+};
+/** @endcond */
+
+static void chunk_free(struct recorder_chunk *chunk)
+{
+	if (chunk->packet)
+		sr_packet_free(chunk->packet);
+	g_free(chunk->lzo_data);
+	g_free(chunk);
+}
+
+static void chunks_clear(struct sr_recorder *rec)
+{
+	struct recorder_chunk *chunk;
+
+	while ((chunk = g_queue_pop_head(&rec->chunks)))
+		chunk_free(chunk);
+	rec->size = 0;
+}
+
+static void chunks_drop(struct sr_recorder *rec, uint64_t size)
+{
+	struct recorder_chunk *chunk;
+
+	while (rec->size + size > rec->max_size) {
+		if (!(chunk = g_queue_pop_head(&rec->chunks)))
+			break;
+		rec->size -= chunk->size;
+		chunk_free(chunk);
+	}
+}
+
+static void meta_clear(struct sr_recorder *rec)
+{
+	g_slist_free_full(rec->meta, (GDestroyNotify)sr_packet_free);
+	rec->meta = NULL;
+}
+
+static uint8_t *scratch_get(struct sr_recorder *rec, size_t size)
+{
+	if (size > rec->lzo_buf_size) {
+		g_free(rec->lzo_buf);
+		rec->lzo_buf = g_malloc(size);
+		rec->lzo_buf_size = size;
+	}
+
+	return rec->lzo_buf;
+}
+
+/*
+ * Copy packet data into a new chunk. Packets which exceed the memory
+ * budget on their own keep their most recent samples only.
+ */
+static struct recorder_chunk *chunk_new(struct sr_recorder *rec,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_datafeed_packet trimmed;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+	struct recorder_chunk *chunk;
+	struct sr_buffer *lent;
+	uint64_t room, sample_size, keep;
+	int ret;
+
+	room = rec->max_size > CHUNK_OVERHEAD ? rec->max_size - CHUNK_OVERHEAD : 0;
+	trimmed = *packet;
+	if (packet->type == SR_DF_LOGIC) {
+		logic = *(const struct sr_datafeed_logic *)packet->payload;
+		if (!logic.unitsize)
+			return NULL;
+		if (logic.length > room) {
+			keep = room / logic.unitsize * logic.unitsize;
+			logic.data = (uint8_t *)logic.data + logic.length - keep;
+			logic.length = keep;
+		}
+		if (!logic.length)
+			return NULL;
+		trimmed.payload = &logic;
+	} else {
+		analog = *(const struct sr_datafeed_analog *)packet->payload;
+		if (!analog.num_samples)
+			return NULL;
+		sample_size = sr_analog_frame_size(&analog);
+		if (sr_analog_data_size(&analog) > room) {
+			keep = room / sample_size;
+			if (!keep)
+				return NULL;
+			analog.data = (uint8_t *)analog.data
+				+ (analog.num_samples - keep) * sample_size;
+			analog.num_samples = keep;
+		}
+		trimmed.payload = &analog;
+	}
+
+	chunk = g_malloc0(sizeof(*chunk));
+	if (packet->type == SR_DF_LOGIC && rec->compress) {
+		g_byte_array_set_size(rec->lzo_out, 0);
+		if (sr_lzo_compress(rec->lzo, logic.data, logic.length,
+				rec->lzo_out) == SR_OK
+				&& rec->lzo_out->len < logic.length) {
+			chunk->lzo_size = rec->lzo_out->len;
+			chunk->lzo_data = g_malloc(chunk->lzo_size);
+			memcpy(chunk->lzo_data, rec->lzo_out->data,
+				chunk->lzo_size);
+			chunk->length = logic.length;
+			chunk->unitsize = logic.unitsize;
+			chunk->size = chunk->lzo_size + CHUNK_OVERHEAD;
+			return chunk;
+		}
+	}
+
+	if (sr_packet_copy(&trimmed, &chunk->packet) != SR_OK) {
+		g_free(chunk);
+		return NULL;
+	}
+	if (sr_packet_shared_size(chunk->packet) > room) {
+		/* Sharing would exceed the budget, copy the data instead. */
+		sr_packet_free(chunk->packet);
+		lent = sr_buffer_lend(NULL);
+		ret = sr_packet_copy(&trimmed, &chunk->packet);
+		sr_buffer_lend(lent);
+		if (ret != SR_OK) {
+			g_free(chunk);
+			return NULL;
+		}
+	}
+	if (packet->type == SR_DF_LOGIC)
+		chunk->size = logic.length;
+	else
+		chunk->size = sr_analog_data_size(&analog);
+	/* Shared data keeps all of its buffer alive. */
+	chunk->size = MAX(chunk->size, sr_packet_shared_size(chunk->packet));
+	chunk->size += CHUNK_OVERHEAD;
+
+	return chunk;
+}
+
+static void record(struct sr_recorder *rec,
+		const struct sr_datafeed_packet *packet)
+{
+	struct recorder_chunk *chunk;
+
+	if (!(chunk = chunk_new(rec, packet)))
+		return;
+
+	chunks_drop(rec, chunk->size);
+	g_queue_push_tail(&rec->chunks, chunk);
+	rec->size += chunk->size;
+}
+
+/*
+ * Check logic data for the trigger, and count down the samples to wait
+ * for after the trigger matched. Returns TRUE when the recorded window
+ * is complete.
+ */
+static gboolean trigger_check(struct sr_recorder *rec,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_logic *logic)
+{
+	uint64_t num_samples;
+	int offset;
+
+	if (!rec->trigger || !logic->unitsize)
+		return FALSE;
+
+	num_samples = logic->length / logic->unitsize;
+	if (!rec->triggered) {
+		if (!rec->stl) {
+			rec->stl = soft_trigger_logic_new_zerocopy(sdi,
+				rec->trigger, 0);
+			if (!rec->stl) {
+				sr_err("Cannot setup the recorder trigger.");
+				rec->trigger = NULL;
+				return FALSE;
+			}
+		}
+		offset = soft_trigger_logic_scan(rec->stl, logic->data,
+			logic->length);
+		if (offset < 0)
+			return FALSE;
+		rec->triggered = TRUE;
+		rec->post_trigger_left = rec->post_trigger_samples;
+		num_samples -= offset;
+	}
+
+	if (num_samples < rec->post_trigger_left) {
+		rec->post_trigger_left -= num_samples;
+		return FALSE;
+	}
+	rec->triggered = FALSE;
+
+	return TRUE;
+}
+
+/* Turn run-length encoded logic data into a plain logic packet. */
+static gboolean rle_expand(struct sr_recorder *rec,
+		const struct sr_datafeed_logic_rle *rle,
+		struct sr_datafeed_packet *packet, struct sr_datafeed_logic *logic)
+{
+	size_t size;
+
+	size = rle->num_samples * rle->unitsize;
+	if (size > rec->rle_buf_size) {
+		g_free(rec->rle_buf);
+		rec->rle_buf = g_malloc(size);
+		rec->rle_buf_size = size;
+	}
+	if (sr_logic_rle_expand(rle, rec->rle_buf) != SR_OK)
+		return FALSE;
+	logic->length = size;
+	logic->unitsize = rle->unitsize;
+	logic->data = rec->rle_buf;
+	packet->type = SR_DF_LOGIC;
+	packet->payload = logic;
+
+	return TRUE;
+}
+
+static void recorder_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct sr_recorder *rec;
+	struct sr_datafeed_packet *copy, expanded;
+	struct sr_datafeed_logic logic;
+	gboolean fire;
+
+	rec = cb_data;
+	fire = FALSE;
+
+	g_mutex_lock(&rec->mutex);
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		/* A new acquisition starts over. */
+		chunks_clear(rec);
+		meta_clear(rec);
+		if (rec->header)
+			sr_packet_free(rec->header);
+		rec->header = NULL;
+		sr_packet_copy(packet, &rec->header);
+		if (rec->stl)
+			soft_trigger_logic_free(rec->stl);
+		rec->stl = NULL;
+		rec->triggered = FALSE;
+		break;
+	case SR_DF_META:
+		if (sr_packet_copy(packet, &copy) == SR_OK)
+			rec->meta = g_slist_append(rec->meta, copy);
+		break;
+	case SR_DF_LOGIC_RLE:
+		if (!rle_expand(rec, packet->payload, &expanded, &logic))
+			break;
+		packet = &expanded;
+		/* Fall through. */
+	case SR_DF_LOGIC:
+		record(rec, packet);
+		fire = trigger_check(rec, sdi, packet->payload);
+		break;
+	case SR_DF_ANALOG:
+		record(rec, packet);
+		break;
+	case SR_DF_END:
+		/* Don't wait for post-trigger samples which won't come. */
+		fire = rec->triggered;
+		rec->triggered = FALSE;
+		break;
+	default:
+		break;
+	}
+	g_mutex_unlock(&rec->mutex);
+
+	if (fire && rec->cb)
+		rec->cb(rec, rec->cb_data);
+}
+
+/**
+ * Create a recorder.
+ *
+ * @param[out] rec Pointer where to store the new recorder.
+ * @param[in] max_size The memory budget for recorded data, in bytes.
+ * @param[in] compress Compress logic data while it is held.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_recorder_new(struct sr_recorder **rec, uint64_t max_size,
+		gboolean compress)
+{
+	if (!rec || !max_size)
+		return SR_ERR_ARG;
+
+	*rec = g_malloc0(sizeof(**rec));
+	g_mutex_init(&(*rec)->mutex);
+	g_queue_init(&(*rec)->chunks);
+	(*rec)->max_size = max_size;
+	if (compress)
+		(*rec)->lzo = sr_lzo_new();
+	(*rec)->compress = (*rec)->lzo != NULL;
+	if ((*rec)->compress)
+		(*rec)->lzo_out = g_byte_array_new();
+
+	return SR_OK;
+}
+
+/**
+ * Destroy a recorder, and all of its recorded data.
+ *
+ * The recorder must no longer be attached to a session, i.e. the
+ * session was destroyed, or its datafeed callbacks were removed.
+ *
+ * @param[in] rec The recorder to destroy. May be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_recorder_free(struct sr_recorder *rec)
+{
+	if (!rec)
+		return;
+
+	chunks_clear(rec);
+	meta_clear(rec);
+	if (rec->header)
+		sr_packet_free(rec->header);
+	if (rec->stl)
+		soft_trigger_logic_free(rec->stl);
+	sr_lzo_free(rec->lzo);
+	if (rec->lzo_out)
+		g_byte_array_free(rec->lzo_out, TRUE);
+	g_free(rec->lzo_buf);
+	g_free(rec->rle_buf);
+	g_mutex_clear(&rec->mutex);
+	g_free(rec);
+}
+
+/**
+ * Record the datafeed of a session.
+ *
+ * @param[in] rec The recorder.
+ * @param[in] session The session to record.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_recorder_attach(struct sr_recorder *rec,
+		struct sr_session *session)
+{
+	if (!rec)
+		return SR_ERR_ARG;
+
+	return sr_session_datafeed_callback_add(session, recorder_datafeed, rec);
+}
+
+/**
+ * Have the recorder watch the logic data for a trigger.
+ *
+ * When the trigger matches, the recorder waits for the given number of
+ * samples to arrive, then invokes the callback, which typically calls
+ * sr_recorder_snapshot(). The trigger re-arms afterwards.
+ *
+ * @param[in] rec The recorder.
+ * @param[in] trigger The trigger to watch for, or NULL to remove the
+ *                    trigger. Must remain valid while it is set.
+ * @param[in] post_trigger_samples The number of samples to wait for
+ *                                 after the trigger matched.
+ * @param[in] cb The callback to invoke. It must not destroy the recorder.
+ * @param[in] cb_data Opaque pointer passed to the callback.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_recorder_trigger_set(struct sr_recorder *rec,
+		struct sr_trigger *trigger, uint64_t post_trigger_samples,
+		sr_recorder_callback cb, void *cb_data)
+{
+	if (!rec || (trigger && !cb))
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&rec->mutex);
+	if (rec->stl)
+		soft_trigger_logic_free(rec->stl);
+	rec->stl = NULL;
+	rec->trigger = trigger;
+	rec->post_trigger_samples = post_trigger_samples;
+	rec->triggered = FALSE;
+	rec->cb = cb;
+	rec->cb_data = cb_data;
+	g_mutex_unlock(&rec->mutex);
+
+	return SR_OK;
+}
+
+static int snapshot_send(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString *out)
+{
+	GString *chunk_out;
+	int ret;
+
+	chunk_out = NULL;
+	if ((ret = sr_output_send(o, packet, &chunk_out)) != SR_OK)
+		return ret;
+	if (chunk_out) {
+		g_string_append_len(out, chunk_out->str, chunk_out->len);
+		g_string_free(chunk_out, TRUE);
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Write the recorded data to an output.
+ *
+ * The output receives a complete datafeed: the header and metadata of
+ * the acquisition, the recorded packets, and an end packet. Recording
+ * continues during and after the snapshot.
+ *
+ * @param[in] rec The recorder.
+ * @param[in] o The output to write to, which was not sent any data yet.
+ * @param[out] out Pointer where to store the output's text, if any.
+ *                 Must be freed by the caller.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR Other error.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_recorder_snapshot(struct sr_recorder *rec,
+		const struct sr_output *o, GString **out)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_header header;
+	struct sr_datafeed_logic logic;
+	struct recorder_chunk *chunk;
+	GString *text;
+	GList *l;
+	GSList *m;
+	int ret;
+
+	if (!rec || !o || !out)
+		return SR_ERR_ARG;
+
+	text = g_string_sized_new(0);
+	g_mutex_lock(&rec->mutex);
+
+	if (rec->header) {
+		ret = snapshot_send(o, rec->header, text);
+	} else {
+		header.feed_version = 1;
+		gettimeofday(&header.starttime, NULL);
+		packet.type = SR_DF_HEADER;
+		packet.payload = &header;
+		ret = snapshot_send(o, &packet, text);
+	}
+	for (m = rec->meta; m && ret == SR_OK; m = m->next)
+		ret = snapshot_send(o, m->data, text);
+
+	for (l = rec->chunks.head; l && ret == SR_OK; l = l->next) {
+		chunk = l->data;
+		if (chunk->packet) {
+			ret = snapshot_send(o, chunk->packet, text);
+			continue;
+		}
+		logic.data = scratch_get(rec, chunk->length);
+		if (sr_lzo_decompress(chunk->lzo_data, chunk->lzo_size,
+				logic.data, chunk->length) != SR_OK) {
+			sr_err("Cannot decompress recorded data.");
+			ret = SR_ERR;
+			break;
+		}
+		logic.length = chunk->length;
+		logic.unitsize = chunk->unitsize;
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &logic;
+		ret = snapshot_send(o, &packet, text);
+	}
+
+	if (ret == SR_OK) {
+		packet.type = SR_DF_END;
+		packet.payload = NULL;
+		ret = snapshot_send(o, &packet, text);
+	}
+	g_mutex_unlock(&rec->mutex);
+
+	if (ret != SR_OK) {
+		g_string_free(text, TRUE);
+		return ret;
+	}
+	*out = text;
+
+	return SR_OK;
+}
+
+/** @} */
@@ -0,0 +1,1187 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Serving a session's datafeed over the network.
+ */
+
+#include <config.h>
+#ifdef _WIN32
+#define _WIN32_WINNT 0x0501
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#endif
+#include <glib.h>
+#include <string.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#endif
+#include <errno.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "remote"
+/** @endcond */
+
+/**
+ * @defgroup grp_remote Remote sessions
+ *
+ * Serve the datafeed of a session to other libsigrok instances.
+ *
+ * A remote server listens on a TCP port, and sends the datafeed of the
+ * session it is attached to, to every connected client. Clients use the
+ * "remote" driver, which turns the stream into a virtual device, much
+ * like session files get replayed by the session driver.
+ *
+ * Every frame on the wire starts with the payload size (32bit), the
+ * frame type (16bit) and flags (16bit), all little endian. The server
+ * greets new clients with a description of the device, and then sends
+ * header, meta, logic, analog, trigger, frame and end packets as the
+ * session runs. The bulk data of logic and analog packets can travel
+ * LZO compressed. Clients send ping frames, which the server echoes,
+ * so that they can measure the round trip latency.
+ *
+ * Flow control is left to TCP: sends block while a client falls
+ * behind, which slows down the session's datafeed. Clients which take
+ * no data for several seconds get dropped.
+ *
+ * @{
+ */
+
+/** @cond PRIVATE */
+/* How long a send may wait for a client to take data. */
+#define SEND_TIMEOUT_MS 5000
+/* How often the server thread checks for its termination. */
+#define POLL_INTERVAL_MS 100
+#define RECV_CHUNK_SIZE (64 * 1024)
+
+/* Lost clients must not raise SIGPIPE. */
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+struct remote_client {
+	int fd;
+	gboolean dead;
+	GByteArray *rxbuf;
+};
+
+struct sr_remote_server {
+	GMutex mutex;
+	int listen_fd;
+	GThread *thread;
+	gint quit;
+	struct sr_session *session;
+	const struct sr_dev_inst *sdi;
+	struct sr_lzo *lzo;
+	GByteArray *frame;
+	GSList *clients;
+};
+
+/* Bounds checked parsing of frame payloads. */
+struct remote_reader {
+	const uint8_t *p;
+	size_t left;
+	gboolean error;
+};
+/** @endcond */
+
+static void put_u8(GByteArray *b, uint8_t x)
+{
+	g_byte_array_append(b, &x, sizeof(x));
+}
+
+static void put_u16(GByteArray *b, uint16_t x)
+{
+	uint8_t buf[sizeof(x)];
+
+	WL16(buf, x);
+	g_byte_array_append(b, buf, sizeof(buf));
+}
+
+static void put_u32(GByteArray *b, uint32_t x)
+{
+	uint8_t buf[sizeof(x)];
+
+	WL32(buf, x);
+	g_byte_array_append(b, buf, sizeof(buf));
+}
+
+static void put_u64(GByteArray *b, uint64_t x)
+{
+	uint8_t buf[sizeof(x)];
+
+	WL64(buf, x);
+	g_byte_array_append(b, buf, sizeof(buf));
+}
+
+static void put_string(GByteArray *b, const char *s)
+{
+	size_t len;
+
+	len = s ? MIN(strlen(s), G_MAXUINT16) : 0;
+	put_u16(b, len);
+	g_byte_array_append(b, (const uint8_t *)s, len);
+}
+
+static void put_rational(GByteArray *b, const struct sr_rational *r)
+{
+	put_u64(b, r->p);
+	put_u64(b, r->q);
+}
+
+static const uint8_t *get_bytes(struct remote_reader *r, size_t len)
+{
+	const uint8_t *p;
+
+	if (r->error || len > r->left) {
+		r->error = TRUE;
+		return NULL;
+	}
+	p = r->p;
+	r->p += len;
+	r->left -= len;
+
+	return p;
+}
+
+static uint8_t get_u8(struct remote_reader *r)
+{
+	const uint8_t *p;
+
+	p = get_bytes(r, sizeof(uint8_t));
+
+	return p ? R8(p) : 0;
+}
+
+static uint16_t get_u16(struct remote_reader *r)
+{
+	const uint8_t *p;
+
+	p = get_bytes(r, sizeof(uint16_t));
+
+	return p ? RL16(p) : 0;
+}
+
+static uint32_t get_u32(struct remote_reader *r)
+{
+	const uint8_t *p;
+
+	p = get_bytes(r, sizeof(uint32_t));
+
+	return p ? RL32(p) : 0;
+}
+
+static uint64_t get_u64(struct remote_reader *r)
+{
+	const uint8_t *p;
+
+	p = get_bytes(r, sizeof(uint64_t));
+
+	return p ? RL64(p) : 0;
+}
+
+static char *get_string(struct remote_reader *r)
+{
+	const uint8_t *p;
+	size_t len;
+
+	len = get_u16(r);
+	p = get_bytes(r, len);
+
+	return p ? g_strndup((const char *)p, len) : NULL;
+}
+
+static void get_rational(struct remote_reader *r, struct sr_rational *rat)
+{
+	rat->p = (int64_t)get_u64(r);
+	rat->q = get_u64(r);
+}
+
+/* Append bulk data, compressed if that saves space. */
+static void put_data(GByteArray *b, struct sr_lzo *lzo, const void *data,
+		size_t length, uint16_t *flags)
+{
+	size_t pos;
+
+	put_u64(b, length);
+	pos = b->len;
+	if (lzo && sr_lzo_compress(lzo, data, length, b) == SR_OK
+			&& b->len - pos < length) {
+		*flags |= SR_REMOTE_FLAG_LZO;
+		return;
+	}
+	g_byte_array_set_size(b, pos);
+	g_byte_array_append(b, data, length);
+}
+
+static uint8_t *bytes_dup(const uint8_t *p, size_t len)
+{
+	uint8_t *copy;
+
+	copy = g_malloc(len);
+	memcpy(copy, p, len);
+
+	return copy;
+}
+
+static uint8_t *get_data(struct remote_reader *r, uint16_t flags,
+		uint64_t *length)
+{
+	const uint8_t *p;
+	uint8_t *data;
+	size_t size;
+
+	*length = get_u64(r);
+	if (r->error || *length > SR_REMOTE_MAX_PAYLOAD) {
+		r->error = TRUE;
+		return NULL;
+	}
+	if (!(flags & SR_REMOTE_FLAG_LZO)) {
+		if (!(p = get_bytes(r, *length)))
+			return NULL;
+		return bytes_dup(p, *length);
+	}
+
+	size = r->left;
+	p = get_bytes(r, size);
+	data = g_malloc(*length);
+	if (sr_lzo_decompress(p, size, data, *length) != SR_OK) {
+		g_free(data);
+		r->error = TRUE;
+		return NULL;
+	}
+
+	return data;
+}
+
+/**
+ * Connect to a remote server.
+ *
+ * @param[in] address The host name or address of the server.
+ * @param[in] port The TCP port of the server.
+ *
+ * @return The socket, or -1 on errors.
+ *
+ * @private
+ */
+SR_PRIV int sr_remote_connect(const char *address, const char *port)
+{
+	struct addrinfo hints;
+	struct addrinfo *results, *res;
+	int fd, one, err;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+
+	err = getaddrinfo(address, port, &hints, &results);
+	if (err) {
+		sr_err("Address lookup failed: %s:%s: %s", address, port,
+			gai_strerror(err));
+		return -1;
+	}
+
+	fd = -1;
+	for (res = results; res; res = res->ai_next) {
+		if ((fd = socket(res->ai_family, res->ai_socktype,
+				res->ai_protocol)) < 0)
+			continue;
+		if (connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+			close(fd);
+			fd = -1;
+			continue;
+		}
+		break;
+	}
+	freeaddrinfo(results);
+
+	if (fd < 0) {
+		sr_err("Failed to connect to %s:%s: %s", address, port,
+			g_strerror(errno));
+		return -1;
+	}
+
+	/* Small frames like pings must not wait for more data. */
+	one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const void *)&one,
+		sizeof(one));
+
+	return fd;
+}
+
+/**
+ * Start a new frame.
+ *
+ * @param[out] frame The byte array to hold the frame.
+ *
+ * @private
+ */
+SR_PRIV void sr_remote_frame_init(GByteArray *frame)
+{
+	g_byte_array_set_size(frame, SR_REMOTE_HEADER_SIZE);
+}
+
+/**
+ * Complete a frame, and send it.
+ *
+ * @param[in] fd The socket to send to.
+ * @param[in,out] frame The frame, started with sr_remote_frame_init().
+ * @param[in] type The frame type.
+ * @param[in] flags The frame flags.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_IO The connection failed.
+ *
+ * @private
+ */
+SR_PRIV int sr_remote_frame_send(int fd, GByteArray *frame, uint16_t type,
+		uint16_t flags)
+{
+	const uint8_t *p;
+	size_t left;
+	ssize_t len;
+
+	WL32(&frame->data[0], frame->len - SR_REMOTE_HEADER_SIZE);
+	WL16(&frame->data[4], type);
+	WL16(&frame->data[6], flags);
+
+	p = frame->data;
+	left = frame->len;
+	while (left) {
+		len = send(fd, (const void *)p, left, SEND_FLAGS);
+		if (len < 0 && errno == EINTR)
+			continue;
+		if (len <= 0) {
+			sr_dbg("Send error: %s", g_strerror(errno));
+			return SR_ERR_IO;
+		}
+		p += len;
+		left -= len;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Receive data from a socket.
+ *
+ * @param[in] fd The socket to receive from.
+ * @param[in,out] buf The byte array to append the data to.
+ * @param[in] timeout_ms How long to wait for data, in milliseconds.
+ *
+ * @return The number of bytes received, 0 when none arrived in time,
+ *         or a negative error code when the connection closed or
+ *         failed.
+ *
+ * @private
+ */
+SR_PRIV int sr_remote_recv(int fd, GByteArray *buf, int timeout_ms)
+{
+	struct timeval tv;
+	fd_set fds;
+	size_t pos;
+	ssize_t len;
+	int ret;
+
+	FD_ZERO(&fds);
+	FD_SET(fd, &fds);
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+	ret = select(fd + 1, &fds, NULL, NULL, &tv);
+	if (ret < 0)
+		return errno == EINTR ? 0 : SR_ERR_IO;
+	if (ret == 0)
+		return 0;
+
+	pos = buf->len;
+	g_byte_array_set_size(buf, pos + RECV_CHUNK_SIZE);
+	len = recv(fd, (void *)&buf->data[pos], RECV_CHUNK_SIZE, 0);
+	g_byte_array_set_size(buf, pos + MAX(len, 0));
+	if (len < 0 && errno == EINTR)
+		return 0;
+	if (len <= 0)
+		return SR_ERR_IO;
+
+	return len;
+}
+
+/**
+ * Find the first complete frame in received data.
+ *
+ * @param[in] buf The received data.
+ * @param[out] type The frame type.
+ * @param[out] flags The frame flags.
+ * @param[out] size The payload size, which follows the frame header.
+ *
+ * @return The size of the complete frame including its header, 0 when
+ *         more data is needed, or SR_ERR_DATA for invalid frames.
+ *
+ * @private
+ */
+SR_PRIV int sr_remote_frame_parse(const GByteArray *buf, uint16_t *type,
+		uint16_t *flags, size_t *size)
+{
+	if (buf->len < SR_REMOTE_HEADER_SIZE)
+		return 0;
+
+	*size = RL32(&buf->data[0]);
+	*type = RL16(&buf->data[4]);
+	*flags = RL16(&buf->data[6]);
+	if (*size > SR_REMOTE_MAX_PAYLOAD) {
+		sr_err("Invalid frame size %zu.", *size);
+		return SR_ERR_DATA;
+	}
+	if (buf->len - SR_REMOTE_HEADER_SIZE < *size)
+		return 0;
+
+	return SR_REMOTE_HEADER_SIZE + *size;
+}
+
+/**
+ * Describe a device, for the greeting of clients.
+ *
+ * @param[in] sdi The device to describe.
+ * @param[in,out] frame The frame to append the description to.
+ *
+ * @private
+ */
+SR_PRIV void sr_remote_hello_encode(const struct sr_dev_inst *sdi,
+		GByteArray *frame)
+{
+	struct sr_channel *ch;
+	GSList *l;
+
+	put_u32(frame, SR_REMOTE_PROTOCOL_VERSION);
+	put_string(frame, sdi ? sdi->vendor : NULL);
+	put_string(frame, sdi ? sdi->model : NULL);
+	put_string(frame, sdi ? sdi->version : NULL);
+	put_u32(frame, sdi ? g_slist_length(sdi->channels) : 0);
+	for (l = sdi ? sdi->channels : NULL; l; l = l->next) {
+		ch = l->data;
+		put_u32(frame, ch->index);
+		put_u32(frame, ch->type);
+		put_u8(frame, ch->enabled);
+		put_string(frame, ch->name);
+	}
+}
+
+/**
+ * Set up a device from the greeting of a server.
+ *
+ * @param[in,out] sdi The device to take the vendor, model, version and
+ *                    channels of the remote device.
+ * @param[in] data The payload of the greeting.
+ * @param[in] size The size of the payload in bytes.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_DATA The greeting is invalid, or of another protocol
+ *                     version.
+ *
+ * @private
+ */
+SR_PRIV int sr_remote_hello_decode(struct sr_dev_inst *sdi,
+		const uint8_t *data, size_t size)
+{
+	struct remote_reader r;
+	uint32_t version, count, index, type, i;
+	gboolean enabled;
+	char *name;
+
+	r.p = data;
+	r.left = size;
+	r.error = FALSE;
+
+	version = get_u32(&r);
+	if (version != SR_REMOTE_PROTOCOL_VERSION) {
+		sr_err("Unsupported protocol version %" PRIu32 ".", version);
+		return SR_ERR_DATA;
+	}
+	sdi->vendor = get_string(&r);
+	sdi->model = get_string(&r);
+	sdi->version = get_string(&r);
+	count = get_u32(&r);
+	for (i = 0; i < count && !r.error; i++) {
+		index = get_u32(&r);
+		type = get_u32(&r);
+		enabled = get_u8(&r);
+		name = get_string(&r);
+		if (name)
+			sr_channel_new(sdi, index, type, enabled, name);
+		g_free(name);
+	}
+
+	return r.error ? SR_ERR_DATA : SR_OK;
+}
+
+static void encode_analog(const struct sr_datafeed_analog *analog,
+		struct sr_lzo *lzo, GByteArray *frame, uint16_t *flags)
+{
+	const struct sr_analog_encoding *enc;
+	struct sr_channel *ch;
+	uint32_t num_channels, i;
+	GSList *l;
+
+	enc = analog->encoding;
+	num_channels = g_slist_length(analog->meaning->channels);
+	put_u32(frame, analog->num_samples);
+	put_u8(frame, enc->unitsize);
+	put_u8(frame, enc->is_signed);
+	put_u8(frame, enc->is_float);
+	put_u8(frame, enc->is_bigendian);
+	put_u8(frame, enc->digits);
+	put_u8(frame, enc->is_digits_decimal);
+	put_rational(frame, &enc->scale);
+	put_rational(frame, &enc->offset);
+	put_u32(frame, enc->stride);
+	put_u8(frame, enc->channel_scale && enc->channel_offset);
+	put_u32(frame, analog->meaning->mq);
+	put_u32(frame, analog->meaning->unit);
+	put_u64(frame, analog->meaning->mqflags);
+	put_u32(frame, num_channels);
+	for (l = analog->meaning->channels; l; l = l->next) {
+		ch = l->data;
+		put_u32(frame, ch->index);
+	}
+	if (enc->channel_scale && enc->channel_offset) {
+		for (i = 0; i < num_channels; i++)
+			put_rational(frame, &enc->channel_scale[i]);
+		for (i = 0; i < num_channels; i++)
+			put_rational(frame, &enc->channel_offset[i]);
+	}
+	put_u8(frame, analog->spec ? analog->spec->spec_digits : 0);
+	put_data(frame, lzo, analog->data, sr_analog_data_size(analog), flags);
+}
+
+/**
+ * Encode a datafeed packet.
+ *
+ * Run-length encoded logic data gets expanded.
+ *
+ * @param[in] packet The packet to encode.
+ * @param[in] lzo Compressor for bulk data, or NULL to not compress.
+ * @param[in,out] frame The frame to append the packet to.
+ * @param[out] flags The frame flags which the encoding needs.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_NA The packet type is not sent to remote clients.
+ * @retval SR_ERR_ARG Invalid packet.
+ *
+ * @private
+ */
+SR_PRIV int sr_remote_packet_encode(const struct sr_datafeed_packet *packet,
+		struct sr_lzo *lzo, GByteArray *frame, uint16_t *flags)
+{
+	const struct sr_datafeed_header *header;
+	const struct sr_datafeed_meta *meta;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
+	const struct sr_config *src;
+	uint8_t *expanded;
+	GVariant *data;
+	GSList *l;
+
+	*flags = 0;
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		header = packet->payload;
+		put_u16(frame, SR_DF_HEADER);
+		put_u32(frame, header->feed_version);
+		put_u64(frame, header->starttime.tv_sec);
+		put_u64(frame, header->starttime.tv_usec);
+		break;
+	case SR_DF_META:
+		meta = packet->payload;
+		put_u16(frame, SR_DF_META);
+		put_u32(frame, g_slist_length(meta->config));
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			data = g_variant_get_normal_form(src->data);
+			put_u32(frame, src->key);
+			put_string(frame, g_variant_get_type_string(data));
+			put_u32(frame, g_variant_get_size(data));
+			g_byte_array_append(frame, g_variant_get_data(data),
+				g_variant_get_size(data));
+			g_variant_unref(data);
+		}
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		put_u16(frame, SR_DF_LOGIC);
+		put_u16(frame, logic->unitsize);
+		put_data(frame, lzo, logic->data, logic->length, flags);
+		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		if (!rle->unitsize)
+			return SR_ERR_ARG;
+		expanded = g_malloc(rle->num_samples * rle->unitsize);
+		if (sr_logic_rle_expand(rle, expanded) != SR_OK) {
+			g_free(expanded);
+			return SR_ERR_ARG;
+		}
+		put_u16(frame, SR_DF_LOGIC);
+		put_u16(frame, rle->unitsize);
+		put_data(frame, lzo, expanded,
+			rle->num_samples * rle->unitsize, flags);
+		g_free(expanded);
+		break;
+	case SR_DF_ANALOG:
+		put_u16(frame, SR_DF_ANALOG);
+		encode_analog(packet->payload, lzo, frame, flags);
+		break;
+	case SR_DF_END:
+	case SR_DF_TRIGGER:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
+		put_u16(frame, packet->type);
+		break;
+	default:
+		return SR_ERR_NA;
+	}
+
+	return SR_OK;
+}
+
+static int decode_analog(const struct sr_dev_inst *sdi,
+		struct remote_reader *r, uint16_t flags,
+		struct sr_remote_packet *rp)
+{
+	struct sr_analog_encoding *enc;
+	struct sr_channel *ch;
+	uint32_t num_channels, index, i;
+	uint64_t length;
+	gboolean rationals;
+	GSList *l;
+
+	enc = &rp->encoding;
+	rp->analog.encoding = enc;
+	rp->analog.meaning = &rp->meaning;
+	rp->analog.spec = &rp->spec;
+	rp->analog.num_samples = get_u32(r);
+	enc->unitsize = get_u8(r);
+	enc->is_signed = get_u8(r);
+	enc->is_float = get_u8(r);
+	enc->is_bigendian = get_u8(r);
+	enc->digits = (int8_t)get_u8(r);
+	enc->is_digits_decimal = get_u8(r);
+	get_rational(r, &enc->scale);
+	get_rational(r, &enc->offset);
+	enc->stride = get_u32(r);
+	rationals = get_u8(r);
+	rp->meaning.mq = get_u32(r);
+	rp->meaning.unit = get_u32(r);
+	rp->meaning.mqflags = get_u64(r);
+	num_channels = get_u32(r);
+	if (r->error || num_channels > g_slist_length(sdi->channels))
+		return SR_ERR_DATA;
+	for (i = 0; i < num_channels; i++) {
+		index = get_u32(r);
+		for (l = sdi->channels; l; l = l->next) {
+			ch = l->data;
+			if ((uint32_t)ch->index == index)
+				break;
+		}
+		if (!l)
+			return SR_ERR_DATA;
+		rp->meaning.channels = g_slist_append(rp->meaning.channels, ch);
+	}
+	if (rationals) {
+		rp->channel_rationals = g_malloc0_n(2 * num_channels,
+			sizeof(struct sr_rational));
+		for (i = 0; i < 2 * num_channels; i++)
+			get_rational(r, &rp->channel_rationals[i]);
+		enc->channel_scale = rp->channel_rationals;
+		enc->channel_offset = rp->channel_rationals + num_channels;
+	}
+	rp->spec.spec_digits = (int8_t)get_u8(r);
+	rp->data = get_data(r, flags, &length);
+	rp->analog.data = rp->data;
+	if (r->error || length != sr_analog_data_size(&rp->analog))
+		return SR_ERR_DATA;
+
+	return SR_OK;
+}
+
+/**
+ * Decode a datafeed packet.
+ *
+ * @param[in] sdi The device whose channels analog packets refer to.
+ * @param[in] data The frame payload.
+ * @param[in] size The size of the payload in bytes.
+ * @param[in] flags The frame flags.
+ * @param[out] rp The decoded packet, to be released with
+ *                sr_remote_packet_clear() in any case.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_NA Unknown packet type.
+ * @retval SR_ERR_DATA The payload is invalid.
+ *
+ * @private
+ */
+SR_PRIV int sr_remote_packet_decode(const struct sr_dev_inst *sdi,
+		const uint8_t *data, size_t size, uint16_t flags,
+		struct sr_remote_packet *rp)
+{
+	struct remote_reader r;
+	struct sr_config *src;
+	const uint8_t *bytes;
+	const GVariantType *type;
+	uint32_t count, key, len, i;
+	uint64_t length;
+	char *type_string;
+	int ret;
+
+	memset(rp, 0, sizeof(*rp));
+	r.p = data;
+	r.left = size;
+	r.error = FALSE;
+
+	rp->packet.type = get_u16(&r);
+	ret = SR_OK;
+	switch (rp->packet.type) {
+	case SR_DF_HEADER:
+		rp->header.feed_version = get_u32(&r);
+		rp->header.starttime.tv_sec = get_u64(&r);
+		rp->header.starttime.tv_usec = get_u64(&r);
+		rp->packet.payload = &rp->header;
+		break;
+	case SR_DF_META:
+		count = get_u32(&r);
+		for (i = 0; i < count && !r.error; i++) {
+			key = get_u32(&r);
+			type_string = get_string(&r);
+			len = get_u32(&r);
+			bytes = get_bytes(&r, len);
+			if (!type_string || !bytes
+					|| !g_variant_type_string_is_valid(type_string)) {
+				g_free(type_string);
+				r.error = TRUE;
+				break;
+			}
+			type = G_VARIANT_TYPE(type_string);
+			src = g_malloc0(sizeof(*src));
+			src->key = key;
+			src->data = g_variant_ref_sink(g_variant_new_from_data(
+				type, bytes_dup(bytes, len), len, FALSE,
+				g_free, NULL));
+			g_free(type_string);
+			rp->meta.config = g_slist_append(rp->meta.config, src);
+		}
+		rp->packet.payload = &rp->meta;
+		break;
+	case SR_DF_LOGIC:
+		rp->logic.unitsize = get_u16(&r);
+		rp->data = get_data(&r, flags, &length);
+		rp->logic.length = length;
+		rp->logic.data = rp->data;
+		if (!rp->logic.unitsize || length % rp->logic.unitsize)
+			r.error = TRUE;
+		rp->packet.payload = &rp->logic;
+		break;
+	case SR_DF_ANALOG:
+		ret = decode_analog(sdi, &r, flags, rp);
+		rp->packet.payload = &rp->analog;
+		break;
+	case SR_DF_END:
+	case SR_DF_TRIGGER:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
+		break;
+	default:
+		sr_dbg("Ignoring packet type %d.", rp->packet.type);
+		return SR_ERR_NA;
+	}
+
+	if (ret == SR_OK && r.error)
+		ret = SR_ERR_DATA;
+	if (ret != SR_OK)
+		sr_err("Invalid packet of type %d.", rp->packet.type);
+
+	return ret;
+}
+
+static void config_free(struct sr_config *src)
+{
+	g_variant_unref(src->data);
+	g_free(src);
+}
+
+/**
+ * Release the data of a decoded packet.
+ *
+ * @param[in] rp The packet.
+ *
+ * @private
+ */
+SR_PRIV void sr_remote_packet_clear(struct sr_remote_packet *rp)
+{
+	g_slist_free_full(rp->meta.config, (GDestroyNotify)config_free);
+	g_slist_free(rp->meaning.channels);
+	g_free(rp->channel_rationals);
+	g_free(rp->data);
+	memset(rp, 0, sizeof(*rp));
+}
+
+static void client_free(struct remote_client *client)
+{
+	close(client->fd);
+	g_byte_array_free(client->rxbuf, TRUE);
+	g_free(client);
+}
+
+/* Greet a new client. Runs in the server thread. */
+static void server_accept(struct sr_remote_server *server)
+{
+	struct remote_client *client;
+	struct timeval tv;
+	GByteArray *frame;
+	int fd, one;
+	GSList *devices;
+
+	if ((fd = accept(server->listen_fd, NULL, NULL)) < 0)
+		return;
+
+	one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const void *)&one,
+		sizeof(one));
+	tv.tv_sec = SEND_TIMEOUT_MS / 1000;
+	tv.tv_usec = (SEND_TIMEOUT_MS % 1000) * 1000;
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, (const void *)&tv, sizeof(tv));
+
+	client = g_malloc0(sizeof(*client));
+	client->fd = fd;
+	client->rxbuf = g_byte_array_new();
+
+	g_mutex_lock(&server->mutex);
+	if (!server->sdi && server->session
+			&& sr_session_dev_list(server->session, &devices) == SR_OK) {
+		server->sdi = devices ? devices->data : NULL;
+		g_slist_free(devices);
+	}
+	frame = g_byte_array_new();
+	sr_remote_frame_init(frame);
+	sr_remote_hello_encode(server->sdi, frame);
+	if (sr_remote_frame_send(fd, frame, SR_REMOTE_FRAME_HELLO, 0) == SR_OK) {
+		server->clients = g_slist_append(server->clients, client);
+		sr_info("Client connected.");
+	} else {
+		client_free(client);
+	}
+	g_byte_array_free(frame, TRUE);
+	g_mutex_unlock(&server->mutex);
+}
+
+/* Answer the pings of a client. Runs in the server thread. */
+static void server_client_input(struct remote_client *client)
+{
+	GByteArray *frame;
+	uint16_t type, flags;
+	size_t size;
+	int len;
+
+	if (sr_remote_recv(client->fd, client->rxbuf, 0) < 0) {
+		client->dead = TRUE;
+		return;
+	}
+
+	while ((len = sr_remote_frame_parse(client->rxbuf, &type, &flags,
+			&size)) > 0) {
+		if (type == SR_REMOTE_FRAME_PING) {
+			frame = g_byte_array_new();
+			sr_remote_frame_init(frame);
+			g_byte_array_append(frame,
+				&client->rxbuf->data[SR_REMOTE_HEADER_SIZE], size);
+			if (sr_remote_frame_send(client->fd, frame,
+					SR_REMOTE_FRAME_PONG, 0) != SR_OK)
+				client->dead = TRUE;
+			g_byte_array_free(frame, TRUE);
+		}
+		g_byte_array_remove_range(client->rxbuf, 0, len);
+	}
+	if (len < 0)
+		client->dead = TRUE;
+}
+
+static gpointer server_thread(gpointer data)
+{
+	struct sr_remote_server *server;
+	struct remote_client *client;
+	struct timeval tv;
+	fd_set fds;
+	GSList *l, *next;
+	int max_fd;
+
+	server = data;
+	while (!g_atomic_int_get(&server->quit)) {
+		g_mutex_lock(&server->mutex);
+		for (l = server->clients; l; l = next) {
+			next = l->next;
+			client = l->data;
+			if (!client->dead)
+				continue;
+			sr_info("Client disconnected.");
+			server->clients = g_slist_delete_link(server->clients, l);
+			client_free(client);
+		}
+		FD_ZERO(&fds);
+		FD_SET(server->listen_fd, &fds);
+		max_fd = server->listen_fd;
+		for (l = server->clients; l; l = l->next) {
+			client = l->data;
+			FD_SET(client->fd, &fds);
+			max_fd = MAX(max_fd, client->fd);
+		}
+		g_mutex_unlock(&server->mutex);
+
+		/* Only this thread closes sockets, the set stays valid. */
+		tv.tv_sec = 0;
+		tv.tv_usec = POLL_INTERVAL_MS * 1000;
+		if (select(max_fd + 1, &fds, NULL, NULL, &tv) <= 0)
+			continue;
+
+		if (FD_ISSET(server->listen_fd, &fds))
+			server_accept(server);
+		g_mutex_lock(&server->mutex);
+		for (l = server->clients; l; l = l->next) {
+			client = l->data;
+			if (FD_ISSET(client->fd, &fds) && !client->dead)
+				server_client_input(client);
+		}
+		g_mutex_unlock(&server->mutex);
+	}
+
+	return NULL;
+}
+
+static void server_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct sr_remote_server *server;
+	struct remote_client *client;
+	uint16_t flags;
+	GSList *l;
+
+	server = cb_data;
+	g_mutex_lock(&server->mutex);
+
+	/* Clients know the channels of one device only. */
+	if (!server->sdi)
+		server->sdi = sdi;
+	if (sdi != server->sdi || !server->clients) {
+		g_mutex_unlock(&server->mutex);
+		return;
+	}
+
+	sr_remote_frame_init(server->frame);
+	if (sr_remote_packet_encode(packet, server->lzo, server->frame,
+			&flags) == SR_OK) {
+		for (l = server->clients; l; l = l->next) {
+			client = l->data;
+			if (client->dead)
+				continue;
+			if (sr_remote_frame_send(client->fd, server->frame,
+					SR_REMOTE_FRAME_PACKET, flags) != SR_OK) {
+				sr_warn("Dropping client which does not take data.");
+				client->dead = TRUE;
+			}
+		}
+	}
+	g_mutex_unlock(&server->mutex);
+}
+
+static int server_listen(const char *address, const char *port)
+{
+	struct addrinfo hints;
+	struct addrinfo *results, *res;
+	int fd, one, err;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	hints.ai_flags = AI_PASSIVE;
+
+	err = getaddrinfo(address, port, &hints, &results);
+	if (err) {
+		sr_err("Address lookup failed: %s:%s: %s",
+			address ? address : "*", port, gai_strerror(err));
+		return -1;
+	}
+
+	fd = -1;
+	for (res = results; res; res = res->ai_next) {
+		if ((fd = socket(res->ai_family, res->ai_socktype,
+				res->ai_protocol)) < 0)
+			continue;
+		one = 1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const void *)&one,
+			sizeof(one));
+		if (bind(fd, res->ai_addr, res->ai_addrlen) != 0
+				|| listen(fd, 4) != 0) {
+			close(fd);
+			fd = -1;
+			continue;
+		}
+		break;
+	}
+	freeaddrinfo(results);
+
+	if (fd < 0)
+		sr_err("Failed to listen on %s:%s: %s",
+			address ? address : "*", port, g_strerror(errno));
+
+	return fd;
+}
+
+/**
+ * Create a remote server, and start listening for clients.
+ *
+ * @param[out] server Pointer where to store the new server.
+ * @param[in] address The local address to listen on, or NULL for any.
+ * @param[in] port The TCP port to listen on.
+ * @param[in] compress Compress logic and analog data for the network.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_IO Cannot listen on the address.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_remote_server_new(struct sr_remote_server **server,
+		const char *address, const char *port, gboolean compress)
+{
+	struct sr_remote_server *srv;
+	int fd;
+
+	if (!server || !port)
+		return SR_ERR_ARG;
+
+	if ((fd = server_listen(address, port)) < 0)
+		return SR_ERR_IO;
+
+	srv = g_malloc0(sizeof(*srv));
+	g_mutex_init(&srv->mutex);
+	srv->listen_fd = fd;
+	srv->frame = g_byte_array_new();
+	if (compress)
+		srv->lzo = sr_lzo_new();
+	srv->thread = g_thread_new("sr-remote", server_thread, srv);
+	*server = srv;
+
+	return SR_OK;
+}
+
+/**
+ * Serve the datafeed of a session.
+ *
+ * Clients see the channels of the session's first device, and receive
+ * the packets of that device.
+ *
+ * @param[in] server The remote server.
+ * @param[in] session The session to serve.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_remote_server_attach(struct sr_remote_server *server,
+		struct sr_session *session)
+{
+	if (!server || !session)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&server->mutex);
+	server->session = session;
+	server->sdi = NULL;
+	g_mutex_unlock(&server->mutex);
+
+	return sr_session_datafeed_callback_add(session, server_datafeed,
+		server);
+}
+
+/**
+ * Get the number of clients which are connected to a remote server.
+ *
+ * @param[in] server The remote server.
+ *
+ * @return The number of clients, 0 for invalid arguments.
+ *
+ * @since 0.6.0
+ */
+SR_API unsigned int sr_remote_server_clients(struct sr_remote_server *server)
+{
+	struct remote_client *client;
+	unsigned int count;
+	GSList *l;
+
+	if (!server)
+		return 0;
+
+	count = 0;
+	g_mutex_lock(&server->mutex);
+	for (l = server->clients; l; l = l->next) {
+		client = l->data;
+		if (!client->dead)
+			count++;
+	}
+	g_mutex_unlock(&server->mutex);
+
+	return count;
+}
+
+/**
+ * Stop a remote server, and disconnect its clients.
+ *
+ * The server must no longer be attached to a session, i.e. the session
+ * was destroyed, or its datafeed callbacks were removed.
+ *
+ * @param[in] server The remote server to destroy. May be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_remote_server_free(struct sr_remote_server *server)
+{
+	if (!server)
+		return;
+
+	g_atomic_int_set(&server->quit, 1);
+	g_thread_join(server->thread);
+	g_slist_free_full(server->clients, (GDestroyNotify)client_free);
+	close(server->listen_fd);
+	sr_lzo_free(server->lzo);
+	g_byte_array_free(server->frame, TRUE);
+	g_mutex_clear(&server->mutex);
+	g_free(server);
+}
+
+/** @} */
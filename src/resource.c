@@ -423,3 +423,241 @@ SR_PRIV void *sr_resource_load(struct sr_context *ctx,
 	*size = res_size;
 	return buf;
 }
+
+/** @cond PRIVATE */
+struct resource_cache_entry {
+	gint64 mtime;
+	gint64 size;
+	GBytes *data;
+};
+/** @endcond */
+
+static void resource_cache_entry_free(void *p)
+{
+	struct resource_cache_entry *entry;
+
+	entry = p;
+	g_bytes_unref(entry->data);
+	g_free(entry);
+}
+
+/*
+ * Find the file which the default open callback would use for a
+ * resource. Returns the newly allocated filename and the file's
+ * status, or NULL when no search path has the file.
+ */
+static char *find_resource_file(int type, const char *name, GStatBuf *st)
+{
+	GSList *paths, *p;
+	char *filename;
+
+	paths = sr_resourcepaths_get(type);
+	filename = NULL;
+	for (p = paths; p && !filename; p = p->next) {
+		filename = g_build_filename(p->data, name, NULL);
+		if (g_stat(filename, st) == 0 && S_ISREG(st->st_mode))
+			break;
+		sr_spew("Attempt to find '%s' failed.", filename);
+		g_free(filename);
+		filename = NULL;
+	}
+	g_slist_free_full(paths, g_free);
+
+	return filename;
+}
+
+static GBytes *resource_cache_lookup(struct sr_context *ctx,
+		const char *key, const GStatBuf *st)
+{
+	struct resource_cache_entry *entry;
+	GBytes *data;
+
+	data = NULL;
+	g_mutex_lock(&ctx->resource_mutex);
+	entry = NULL;
+	if (ctx->resource_cache)
+		entry = g_hash_table_lookup(ctx->resource_cache, key);
+	if (entry && entry->mtime == st->st_mtime && entry->size == st->st_size)
+		data = g_bytes_ref(entry->data);
+	g_mutex_unlock(&ctx->resource_mutex);
+
+	return data;
+}
+
+static void resource_cache_store(struct sr_context *ctx,
+		const char *key, const GStatBuf *st, GBytes *data)
+{
+	struct resource_cache_entry *entry;
+
+	entry = g_malloc0(sizeof(*entry));
+	entry->mtime = st->st_mtime;
+	entry->size = st->st_size;
+	entry->data = g_bytes_ref(data);
+
+	g_mutex_lock(&ctx->resource_mutex);
+	if (!ctx->resource_cache) {
+		ctx->resource_cache = g_hash_table_new_full(g_str_hash,
+			g_str_equal, g_free, resource_cache_entry_free);
+	}
+	g_hash_table_replace(ctx->resource_cache, g_strdup(key), entry);
+	g_mutex_unlock(&ctx->resource_mutex);
+}
+
+/* Load a resource through the application's hooks, bypassing the cache. */
+static GBytes *resource_get_uncached(struct sr_context *ctx, int type,
+		const char *name, size_t max_size, sr_resource_convert_cb convert)
+{
+	GBytes *raw, *data;
+	void *buf;
+	size_t size;
+
+	buf = sr_resource_load(ctx, type, name, &size, max_size);
+	if (!buf)
+		return NULL;
+	raw = g_bytes_new_take(buf, size);
+	if (!convert)
+		return raw;
+
+	data = convert(raw, name);
+	g_bytes_unref(raw);
+
+	return data;
+}
+
+/**
+ * Get a resource's content, or a preprocessed form of it.
+ *
+ * Resource files are memory mapped, and are kept in a cache of the
+ * libsigrok context. So are the results of the @a convert routine,
+ * which turns file content into the form which drivers upload (like
+ * FPGA bitstreams with transfer headers, or bitbang sequences). Later
+ * requests for the same resource share the data, until the file's
+ * modification time or size change. Resources which are provided by
+ * application hooks (see sr_resource_set_hooks()) are not cached, the
+ * hooks neither provide a modification time nor a file to map.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ * @param type Resource type ID.
+ * @param name Name of the resource. Must not be NULL.
+ * @param max_size Size limit. Error out if the resource is larger than this.
+ * @param form Name of the preprocessed form, or NULL for the file content.
+ *             Different conversions of a resource need different names.
+ * @param convert Conversion routine, must be given when @a form is.
+ *                Returns a new reference, or NULL upon errors.
+ *
+ * @return A reference to the data, or NULL on failure. Must be released
+ *         by the caller using g_bytes_unref().
+ *
+ * @private
+ */
+SR_PRIV GBytes *sr_resource_get_converted(struct sr_context *ctx,
+		int type, const char *name, size_t max_size,
+		const char *form, sr_resource_convert_cb convert)
+{
+	GStatBuf st;
+	GMappedFile *file;
+	GError *error;
+	GBytes *raw, *data;
+	char *filename, *key;
+
+	if (!ctx || !name || (form && !convert) || (!form && convert))
+		return NULL;
+
+	if (ctx->resource_open_cb != &resource_open_default)
+		return resource_get_uncached(ctx, type, name, max_size, convert);
+
+	/* Currently, the enum only defines SR_RESOURCE_FIRMWARE. */
+	if (type != SR_RESOURCE_FIRMWARE) {
+		sr_err("%s: unknown type %d.", __func__, type);
+		return NULL;
+	}
+
+	filename = find_resource_file(type, name, &st);
+	if (!filename) {
+		sr_err("Failed to locate resource '%s'.", name);
+		return NULL;
+	}
+	if ((guint64)st.st_size > max_size) {
+		sr_err("Size %" PRIu64 " of '%s' exceeds limit %zu.",
+			(uint64_t)st.st_size, name, max_size);
+		g_free(filename);
+		return NULL;
+	}
+
+	key = g_strdup_printf("%d:%s:%s", type, name, form ? form : "");
+	data = resource_cache_lookup(ctx, key, &st);
+	if (data) {
+		sr_dbg("Using cached '%s'%s%s.", filename,
+			form ? ", form " : "", form ? form : "");
+		g_free(key);
+		g_free(filename);
+		return data;
+	}
+
+	if (form) {
+		raw = sr_resource_get_converted(ctx, type, name, max_size,
+			NULL, NULL);
+		data = raw ? convert(raw, name) : NULL;
+		if (raw)
+			g_bytes_unref(raw);
+	} else {
+		error = NULL;
+		file = g_mapped_file_new(filename, FALSE, &error);
+		if (file) {
+			data = g_mapped_file_get_bytes(file);
+			g_mapped_file_unref(file);
+			sr_info("Mapped '%s'.", filename);
+		} else {
+			sr_err("Failed to map '%s': %s", filename,
+				error->message);
+			g_error_free(error);
+			data = NULL;
+		}
+	}
+	if (data)
+		resource_cache_store(ctx, key, &st, data);
+	g_free(key);
+	g_free(filename);
+
+	return data;
+}
+
+/**
+ * Get a resource's content, from the context's cache if possible.
+ *
+ * See sr_resource_get_converted() for details.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ * @param type Resource type ID.
+ * @param name Name of the resource. Must not be NULL.
+ * @param max_size Size limit. Error out if the resource is larger than this.
+ *
+ * @return A reference to the data, or NULL on failure. Must be released
+ *         by the caller using g_bytes_unref().
+ *
+ * @private
+ */
+SR_PRIV GBytes *sr_resource_get(struct sr_context *ctx,
+		int type, const char *name, size_t max_size)
+{
+	return sr_resource_get_converted(ctx, type, name, max_size,
+		NULL, NULL);
+}
+
+/**
+ * Release the context's cache of resources.
+ *
+ * Data which callers still hold references to stays valid.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_resource_cache_free(struct sr_context *ctx)
+{
+	g_mutex_lock(&ctx->resource_mutex);
+	if (ctx->resource_cache)
+		g_hash_table_destroy(ctx->resource_cache);
+	ctx->resource_cache = NULL;
+	g_mutex_unlock(&ctx->resource_mutex);
+}
@@ -114,8 +114,18 @@ struct sr_scpi_dev_inst {
 	GMutex scpi_mutex;
 	char *actual_channel_name;
 	gboolean no_opc_command;
+	/* Asynchronous queries which wait for their response. */
+	GQueue async_queue;
+	GString *async_rx;
 };
 
+typedef void (*sr_scpi_async_cb)(struct sr_scpi_dev_inst *scpi,
+		int status, GVariant *value, void *cb_data);
+
+struct sr_scpi_batch;
+typedef void (*sr_scpi_batch_cb)(struct sr_scpi_batch *batch,
+		int status, GVariant **values, void *cb_data);
+
 SR_PRIV GSList *sr_scpi_scan(struct drv_context *drvc, GSList *options,
 		struct sr_dev_inst *(*probe_device)(struct sr_scpi_dev_inst *scpi));
 SR_PRIV struct sr_scpi_dev_inst *scpi_dev_inst_new(struct drv_context *drvc,
@@ -154,10 +164,14 @@ SR_PRIV int sr_scpi_get_double(struct sr_scpi_dev_inst *scpi,
 SR_PRIV int sr_scpi_get_opc(struct sr_scpi_dev_inst *scpi);
 SR_PRIV int sr_scpi_get_floatv(struct sr_scpi_dev_inst *scpi,
 			const char *command, GArray **scpi_response);
+SR_PRIV int sr_scpi_get_readings(struct sr_scpi_dev_inst *scpi,
+			const char *command, gboolean binary, GArray *readings);
 SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 			const char *command, GArray **scpi_response);
 SR_PRIV int sr_scpi_get_data(struct sr_scpi_dev_inst *scpi,
 			const char *command, GString **scpi_response);
+SR_PRIV int sr_scpi_read_block(struct sr_scpi_dev_inst *scpi,
+			const char *command, GByteArray *block);
 SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 			const char *command, GByteArray **scpi_response);
 SR_PRIV int sr_scpi_get_hw_id(struct sr_scpi_dev_inst *scpi,
@@ -177,6 +191,22 @@ SR_PRIV int sr_scpi_cmd_resp(const struct sr_dev_inst *sdi,
 		const struct scpi_command *cmdtable,
 		int channel_command, const char *channel_name,
 		GVariant **gvar, const GVariantType *gvtype, int command, ...);
+SR_PRIV int sr_scpi_cmd_resp_async(const struct sr_dev_inst *sdi,
+		const struct scpi_command *cmdtable,
+		int channel_command, const char *channel_name,
+		const GVariantType *gvtype, sr_scpi_async_cb cb, void *cb_data,
+		int command, ...);
+SR_PRIV size_t sr_scpi_async_pending(struct sr_scpi_dev_inst *scpi);
+SR_PRIV int sr_scpi_async_receive(struct sr_scpi_dev_inst *scpi, int revents);
+SR_PRIV void sr_scpi_async_cancel(struct sr_scpi_dev_inst *scpi);
+SR_PRIV struct sr_scpi_batch *sr_scpi_batch_new(void);
+SR_PRIV void sr_scpi_batch_free(struct sr_scpi_batch *batch);
+SR_PRIV int sr_scpi_batch_add(struct sr_scpi_batch *batch,
+		const struct scpi_command *cmdtable,
+		int channel_command, const char *channel_name,
+		const GVariantType *gvtype, int command, ...);
+SR_PRIV int sr_scpi_batch_send(const struct sr_dev_inst *sdi,
+		struct sr_scpi_batch *batch, sr_scpi_batch_cb cb, void *cb_data);
 
 /*--- GPIB only functions ---------------------------------------------------*/
 
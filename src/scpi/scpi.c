@@ -605,6 +605,10 @@ SR_PRIV void sr_scpi_free(struct sr_scpi_dev_inst *scpi)
 	scpi->free(scpi->priv);
 	g_free(scpi->priv);
 	g_free(scpi->actual_channel_name);
+	while (scpi->async_queue.length)
+		g_free(g_queue_pop_head(&scpi->async_queue));
+	if (scpi->async_rx)
+		g_string_free(scpi->async_rx, TRUE);
 	g_free(scpi);
 }
 
@@ -859,10 +863,8 @@ SR_PRIV int sr_scpi_get_floatv(struct sr_scpi_dev_inst *scpi,
 			       const char *command, GArray **scpi_response)
 {
 	int ret;
-	float tmp;
 	char *response;
-	gchar **ptr, **tokens;
-	size_t token_count;
+	size_t len, count;
 	GArray *response_array;
 
 	*scpi_response = NULL;
@@ -872,23 +874,17 @@ SR_PRIV int sr_scpi_get_floatv(struct sr_scpi_dev_inst *scpi,
 	if (ret != SR_OK && !response)
 		return ret;
 
-	tokens = g_strsplit(response, ",", 0);
-	token_count = g_strv_length(tokens);
-
+	/* Size the array once, then convert right into its storage. */
+	len = strlen(response);
+	count = len ? sr_count_char_ascii(response, len, ',') + 1 : 0;
 	response_array = g_array_sized_new(TRUE, FALSE,
-		sizeof(float), token_count + 1);
-
-	ptr = tokens;
-	while (*ptr) {
-		ret = sr_atof_ascii(*ptr, &tmp);
-		if (ret != SR_OK) {
-			ret = SR_ERR_DATA;
-			break;
-		}
-		response_array = g_array_append_val(response_array, tmp);
-		ptr++;
-	}
-	g_strfreev(tokens);
+		sizeof(float), count + 1);
+	g_array_set_size(response_array, count);
+	ret = sr_parse_floatv_ascii(response, len,
+		(float *)response_array->data, count, &count, NULL);
+	g_array_set_size(response_array, count);
+	if (ret != SR_OK)
+		ret = SR_ERR_DATA;
 	g_free(response);
 
 	if (ret != SR_OK && response_array->len == 0) {
@@ -901,6 +897,81 @@ SR_PRIV int sr_scpi_get_floatv(struct sr_scpi_dev_inst *scpi,
 	return ret;
 }
 
+/**
+ * Send a SCPI command, and read a block of measurement readings into a
+ * caller provided array of floats.
+ *
+ * Instruments return the content of their measurement memory either as
+ * comma separated text, which may come in a definite length block, or
+ * as a definite length block of binary single precision values (the
+ * FORMat REAL,32 response in normal byte order).
+ *
+ * The array gets resized to the number of readings. Callers which keep
+ * the array across calls avoid the allocation for every block.
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ * @param[in] command The SCPI command to send to the device (can be NULL).
+ * @param[in] binary The readings come as binary block.
+ * @param[in,out] readings The array of floats which receives the readings.
+ *
+ * @return SR_OK upon successfully reading all values, SR_ERR* upon a
+ *         parsing error or upon no response.
+ */
+SR_PRIV int sr_scpi_get_readings(struct sr_scpi_dev_inst *scpi,
+			       const char *command, gboolean binary,
+			       GArray *readings)
+{
+	GByteArray *block;
+	char *response;
+	const char *text;
+	size_t len, count, i;
+	int ret;
+
+	g_array_set_size(readings, 0);
+
+	if (binary) {
+		block = g_byte_array_new();
+		ret = sr_scpi_read_block(scpi, command, block);
+		if (ret == SR_OK) {
+			count = block->len / sizeof(float);
+			g_array_set_size(readings, count);
+			for (i = 0; i < count; i++)
+				g_array_index(readings, float, i) =
+					RBFL(&block->data[i * sizeof(float)]);
+		}
+		g_byte_array_free(block, TRUE);
+		return ret;
+	}
+
+	response = NULL;
+	ret = sr_scpi_get_string(scpi, command, &response);
+	if (ret != SR_OK) {
+		g_free(response);
+		return ret;
+	}
+
+	/* Skip the length spec of a definite length block. */
+	text = response;
+	if (text[0] == '#' && g_ascii_isdigit(text[1])) {
+		len = text[1] - '0';
+		if (strlen(&text[2]) < len) {
+			g_free(response);
+			return SR_ERR_DATA;
+		}
+		text += 2 + len;
+	}
+
+	len = strlen(text);
+	count = len ? sr_count_char_ascii(text, len, ',') + 1 : 0;
+	g_array_set_size(readings, count);
+	ret = sr_parse_floatv_ascii(text, len,
+		(float *)readings->data, count, &count, NULL);
+	g_array_set_size(readings, count);
+	g_free(response);
+
+	return (ret == SR_OK) ? SR_OK : SR_ERR_DATA;
+}
+
 /**
  * Send a SCPI command, read the reply, parse it as comma separated list of
  * unsigned 8 bit integers and store the as an result in scpi_response.
@@ -918,10 +989,9 @@ SR_PRIV int sr_scpi_get_floatv(struct sr_scpi_dev_inst *scpi,
 SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 			       const char *command, GArray **scpi_response)
 {
-	int tmp, ret;
+	int ret;
 	char *response;
-	gchar **ptr, **tokens;
-	size_t token_count;
+	size_t len, count;
 	GArray *response_array;
 
 	*scpi_response = NULL;
@@ -931,23 +1001,16 @@ SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 	if (ret != SR_OK && !response)
 		return ret;
 
-	tokens = g_strsplit(response, ",", 0);
-	token_count = g_strv_length(tokens);
-
+	len = strlen(response);
+	count = len ? sr_count_char_ascii(response, len, ',') + 1 : 0;
 	response_array = g_array_sized_new(TRUE, FALSE,
-		sizeof(uint8_t), token_count + 1);
-
-	ptr = tokens;
-	while (*ptr) {
-		ret = sr_atoi(*ptr, &tmp);
-		if (ret != SR_OK) {
-			ret = SR_ERR_DATA;
-			break;
-		}
-		response_array = g_array_append_val(response_array, tmp);
-		ptr++;
-	}
-	g_strfreev(tokens);
+		sizeof(uint8_t), count + 1);
+	g_array_set_size(response_array, count);
+	ret = sr_parse_uint8v_ascii(response, len,
+		(uint8_t *)response_array->data, count, &count, NULL);
+	g_array_set_size(response_array, count);
+	if (ret != SR_OK)
+		ret = SR_ERR_DATA;
 	g_free(response);
 
 	if (response_array->len == 0) {
@@ -960,32 +1023,68 @@ SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 	return ret;
 }
 
+/*
+ * Read into a buffer until it holds at least 'want' bytes, without
+ * mutex. Keeps the number of bytes in the buffer in 'have', does not
+ * read beyond 'size'. The timeout gets extended while data arrives.
+ */
+static int scpi_read_until(struct sr_scpi_dev_inst *scpi,
+	uint8_t *buf, size_t size, size_t *have, size_t want,
+	gint64 *abs_timeout_us)
+{
+	size_t space;
+	int len;
+
+	while (*have < want) {
+		space = MIN(size - *have, (size_t)G_MAXINT);
+		len = scpi->read_data(scpi->priv, (char *)&buf[*have], space);
+		if (len < 0) {
+			sr_err("Incompletely read SCPI response.");
+			return SR_ERR;
+		}
+		if (len > 0) {
+			*have += len;
+			*abs_timeout_us = g_get_monotonic_time();
+			*abs_timeout_us += scpi->read_timeout_us;
+			continue;
+		}
+		if (g_get_monotonic_time() > *abs_timeout_us) {
+			sr_err("Timed out waiting for SCPI response.");
+			return SR_ERR_TIMEOUT;
+		}
+	}
+
+	return SR_OK;
+}
+
 /**
  * Send a SCPI command, read the reply, parse it as binary data with a
- * "definite length block" header and store the as an result in scpi_response.
+ * "definite length block" header and store the data in a caller
+ * provided array.
  *
- * Callers must free the allocated memory (unless it's NULL) regardless of
- * the routine's return code. See @ref g_byte_array_free().
+ * The array gets resized to the block's length, and the data is read
+ * into it directly. Callers which keep the array across calls avoid
+ * the allocation for every block.
  *
  * @param[in] scpi Previously initialised SCPI device structure.
  * @param[in] command The SCPI command to send to the device (can be NULL).
- * @param[out] scpi_response Pointer where to store the parsed result.
+ * @param[in,out] block The array which receives the block's data.
  *
- * @return SR_OK upon successfully parsing all values, SR_ERR* upon a parsing
- *         error or upon no response.
+ * @return SR_OK upon successfully reading the block, SR_ERR* upon
+ *         a parsing error or upon no response.
  */
-SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
-			       const char *command, GByteArray **scpi_response)
+SR_PRIV int sr_scpi_read_block(struct sr_scpi_dev_inst *scpi,
+			       const char *command, GByteArray *block)
 {
 	int ret;
-	GString* response;
-	gsize oldlen;
+	uint8_t head[64];
+	size_t have, used, got;
 	char buf[10];
 	long llen;
 	long datalen;
 	gint64 timeout;
 
-	*scpi_response = NULL;
+	g_byte_array_set_size(block, 0);
 
 	g_mutex_lock(&scpi->scpi_mutex);
 
@@ -1000,23 +1099,28 @@ SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 		return SR_ERR;
 	}
 
-	/*
-	 * Assume an initial maximum length, optionally gets adjusted below.
-	 * Prepare a NULL return value for when error paths will be taken.
-	 */
-	response = g_string_sized_new(1024);
-
 	timeout = g_get_monotonic_time() + scpi->read_timeout_us;
 
-	/* Get (the first chunk of) the response. */
+	/*
+	 * Get the first chunk of the response into a small buffer, which
+	 * holds the length spec and probably some of the data bytes.
+	 */
+	have = 0;
 	do {
-		ret = scpi_read_response(scpi, response, timeout);
-		if (ret < 0) {
+		ret = scpi_read_until(scpi, head, sizeof(head), &have, 2,
+			&timeout);
+		if (ret != SR_OK) {
 			g_mutex_unlock(&scpi->scpi_mutex);
-			g_string_free(response, TRUE);
 			return ret;
 		}
-	} while (response->len < 2);
+		/* Skip the terminator of a previous block's message. */
+		for (used = 0; used < have; used++) {
+			if (head[used] != '\r' && head[used] != '\n')
+				break;
+		}
+		have -= used;
+		memmove(head, &head[used], have);
+	} while (have < 2);
 
 	/*
 	 * SCPI protocol data blocks are preceeded with a length spec.
@@ -1025,16 +1129,12 @@ SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 	 * respective number of characters which specify the data block's
 	 * length. Raw data bytes follow (thus one must no longer assume
 	 * that the received input stream would be an ASCIIZ string).
-	 *
-	 * Get the data block length, and strip off the length spec from
-	 * the input buffer, leaving just the data bytes.
 	 */
-	if (response->str[0] != '#') {
+	if (head[0] != '#') {
 		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
 		return SR_ERR_DATA;
 	}
-	buf[0] = response->str[1];
+	buf[0] = head[1];
 	buf[1] = '\0';
 	ret = sr_atol(buf, &llen);
 	/*
@@ -1061,64 +1161,81 @@ SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 	}
 	if (ret != SR_OK) {
 		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
 		return ret;
 	}
 
-	while (response->len < (unsigned long)(2 + llen)) {
-		ret = scpi_read_response(scpi, response, timeout);
-		if (ret < 0) {
-			g_mutex_unlock(&scpi->scpi_mutex);
-			g_string_free(response, TRUE);
-			return ret;
-		}
+	used = 2 + llen;
+	ret = scpi_read_until(scpi, head, sizeof(head), &have, used, &timeout);
+	if (ret != SR_OK) {
+		g_mutex_unlock(&scpi->scpi_mutex);
+		return ret;
 	}
-
-	memcpy(buf, &response->str[2], llen);
+	memcpy(buf, &head[2], llen);
 	buf[llen] = '\0';
 	ret = sr_atol(buf, &datalen);
-	if ((ret != SR_OK) || (datalen == 0)) {
+	if (ret != SR_OK || datalen < 0) {
 		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
-		return ret;
+		return SR_ERR_DATA;
 	}
-	g_string_erase(response, 0, 2 + llen);
 
 	/*
-	 * Re-allocate the buffer size to the now known length
-	 * and keep reading more chunks of response data.
+	 * Size the array to the now known length, move data bytes which
+	 * came with the length spec, read the remainder in place. Leave
+	 * room for the message terminator (CR/LF) after the data bytes,
+	 * which then gets consumed with the last chunk of data.
 	 */
-	oldlen = response->len;
-	g_string_set_size(response, datalen);
-	g_string_set_size(response, oldlen);
-
-	if (oldlen < (unsigned long)(datalen)) {
-		do {
-			oldlen = response->len;
-			ret = scpi_read_response(scpi, response, timeout);
-
-			/* On timeout truncate the buffer and send the partial response
-			 * instead of getting stuck on timeouts...
-			 */
-			if (ret == SR_ERR_TIMEOUT) {
-				datalen = oldlen;
-				break;
-			}
-			if (ret < 0) {
-				g_mutex_unlock(&scpi->scpi_mutex);
-				g_string_free(response, TRUE);
-				return ret;
-			}
-			if (ret > 0)
-				timeout = g_get_monotonic_time() + scpi->read_timeout_us;
-		} while (response->len < (unsigned long)(datalen));
-	}
+	g_byte_array_set_size(block, datalen + 2);
+	got = MIN(have - used, (size_t)datalen);
+	if (got)
+		memcpy(block->data, &head[used], got);
+	ret = scpi_read_until(scpi, block->data, block->len, &got, datalen,
+		&timeout);
 
 	g_mutex_unlock(&scpi->scpi_mutex);
 
-	/* Convert received data to byte array. */
-	*scpi_response = g_byte_array_new_take(
-		(guint8*)g_string_free(response, FALSE), datalen);
+	/* On timeout truncate the buffer and return the partial response
+	 * instead of getting stuck on timeouts...
+	 */
+	if (ret == SR_ERR_TIMEOUT) {
+		datalen = got;
+		ret = SR_OK;
+	}
+	if (ret != SR_OK)
+		datalen = 0;
+	g_byte_array_set_size(block, datalen);
+
+	return ret;
+}
+
+/**
+ * Send a SCPI command, read the reply, parse it as binary data with a
+ * "definite length block" header and store the as an result in scpi_response.
+ *
+ * Callers must free the allocated memory (unless it's NULL) regardless of
+ * the routine's return code. See @ref g_byte_array_free().
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ * @param[in] command The SCPI command to send to the device (can be NULL).
+ * @param[out] scpi_response Pointer where to store the parsed result.
+ *
+ * @return SR_OK upon successfully parsing all values, SR_ERR* upon a parsing
+ *         error or upon no response.
+ */
+SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
+			       const char *command, GByteArray **scpi_response)
+{
+	GByteArray *block;
+	int ret;
+
+	*scpi_response = NULL;
+
+	block = g_byte_array_new();
+	ret = sr_scpi_read_block(scpi, command, block);
+	if (ret != SR_OK) {
+		g_byte_array_free(block, TRUE);
+		return ret;
+	}
+	*scpi_response = block;
 
 	return SR_OK;
 }
@@ -1333,6 +1450,31 @@ SR_PRIV int sr_scpi_cmd(const struct sr_dev_inst *sdi,
 	return ret;
 }
 
+/* Convert a response text to a GVariant of the requested type. */
+static int scpi_parse_variant(const char *s, const GVariantType *gvtype,
+		GVariant **gvar)
+{
+	gboolean b;
+	double d;
+	int ret;
+
+	ret = SR_OK;
+	if (g_variant_type_equal(gvtype, G_VARIANT_TYPE_BOOLEAN)) {
+		if ((ret = parse_strict_bool(s, &b)) == SR_OK)
+			*gvar = g_variant_new_boolean(b);
+	} else if (g_variant_type_equal(gvtype, G_VARIANT_TYPE_DOUBLE)) {
+		if ((ret = sr_atod_ascii(s, &d)) == SR_OK)
+			*gvar = g_variant_new_double(d);
+	} else if (g_variant_type_equal(gvtype, G_VARIANT_TYPE_STRING)) {
+		*gvar = g_variant_new_string(s);
+	} else {
+		sr_err("Unable to convert to desired GVariant type.");
+		ret = SR_ERR_NA;
+	}
+
+	return ret;
+}
+
 SR_PRIV int sr_scpi_cmd_resp(const struct sr_dev_inst *sdi,
 		const struct scpi_command *cmdtable,
 		int channel_command, const char *channel_name,
@@ -1344,8 +1486,6 @@ SR_PRIV int sr_scpi_cmd_resp(const struct sr_dev_inst *sdi,
 	const char *cmd;
 	GString *response;
 	char *s;
-	gboolean b;
-	double d;
 	int ret;
 
 	scpi = sdi->conn;
@@ -1398,21 +1538,618 @@ SR_PRIV int sr_scpi_cmd_resp(const struct sr_dev_inst *sdi,
 
 	s = g_string_free(response, FALSE);
 
+	ret = scpi_parse_variant(s, gvtype, gvar);
+
+	g_free(s);
+
+	return ret;
+}
+
+/*
+ * Asynchronous queries. The query gets sent immediately, the response
+ * gets picked up later by sr_scpi_async_receive() from the session's
+ * event source callback. Responses are matched to queries in the order
+ * of submission. This allows several devices to have their queries in
+ * flight at the same time, instead of waiting for each device's round
+ * trip in turn.
+ *
+ * Only stream transports with line terminated responses which signal
+ * data availability via their file descriptor (raw TCP, serial) get
+ * read without blocking. Other transports are read synchronously, one
+ * response per receive call.
+ */
+
+struct scpi_async_query {
+	const GVariantType *gvtype;
+	sr_scpi_async_cb cb;
+	void *cb_data;
+	gint64 deadline;
+	int status;
+	char *text;
+};
+
+static gboolean scpi_async_nonblocking(struct sr_scpi_dev_inst *scpi)
+{
+	return scpi->transport == SCPI_TRANSPORT_RAW_TCP ||
+		scpi->transport == SCPI_TRANSPORT_SERIAL;
+}
+
+static void scpi_async_query_free(void *data)
+{
+	struct scpi_async_query *query;
+
+	query = data;
+	g_free(query->text);
+	g_free(query);
+}
+
+/*
+ * Move the oldest pending query to the list of completed queries. Their
+ * callbacks run after the mutex was released, callbacks may send the
+ * next query.
+ */
+static void scpi_async_complete(struct sr_scpi_dev_inst *scpi,
+		GSList **done, int status, const char *text)
+{
+	struct scpi_async_query *query;
+
+	query = g_queue_pop_head(&scpi->async_queue);
+	if (!query)
+		return;
+	query->status = status;
+	query->text = g_strdup(text);
+	*done = g_slist_append(*done, query);
+}
+
+static void scpi_async_run_callbacks(struct sr_scpi_dev_inst *scpi,
+		GSList *done)
+{
+	struct scpi_async_query *query;
+	GVariant *gvar;
+	GSList *l;
+	int status;
+
+	for (l = done; l; l = l->next) {
+		query = l->data;
+		gvar = NULL;
+		status = query->status;
+		if (status == SR_OK)
+			status = scpi_parse_variant(query->text, query->gvtype, &gvar);
+		query->cb(scpi, status, gvar, query->cb_data);
+		if (gvar)
+			g_variant_unref(gvar);
+	}
+	g_slist_free_full(done, scpi_async_query_free);
+}
+
+/* Complete all queries for which a response line was received. */
+static void scpi_async_dispatch(struct sr_scpi_dev_inst *scpi, GSList **done)
+{
+	GString *rx;
+	char *eol;
+	size_t len;
+
+	rx = scpi->async_rx;
+	while (scpi->async_queue.length && rx->len) {
+		eol = memchr(rx->str, '\n', rx->len);
+		if (!eol)
+			break;
+		len = eol - rx->str;
+		*eol = '\0';
+		if (len && rx->str[len - 1] == '\r')
+			rx->str[len - 1] = '\0';
+		scpi_async_complete(scpi, done, SR_OK, rx->str);
+		g_string_erase(rx, 0, len + 1);
+	}
+}
+
+/* Read another chunk of response data, without mutex. */
+static int scpi_async_read(struct sr_scpi_dev_inst *scpi)
+{
+	GString *rx;
+	size_t len;
+	int ret;
+
+	rx = scpi->async_rx;
+	if (rx->allocated_len - rx->len < 128) {
+		len = rx->len;
+		g_string_set_size(rx, len + 128);
+		g_string_set_size(rx, len);
+	}
+	ret = scpi_read_response(scpi, rx, G_MAXINT64);
+
+	return ret < 0 ? ret : SR_OK;
+}
+
+/* Queue a query which was sent, without mutex. */
+static void scpi_async_push(struct sr_scpi_dev_inst *scpi,
+		const GVariantType *gvtype, sr_scpi_async_cb cb, void *cb_data)
+{
+	struct scpi_async_query *query;
+
+	if (!scpi->async_rx)
+		scpi->async_rx = g_string_sized_new(128);
+	if (!scpi->async_queue.length && scpi_async_nonblocking(scpi))
+		sr_scpi_read_begin(scpi);
+	query = g_malloc0(sizeof(*query));
+	query->gvtype = gvtype;
+	query->cb = cb;
+	query->cb_data = cb_data;
+	query->deadline = g_get_monotonic_time() + scpi->read_timeout_us;
+	g_queue_push_tail(&scpi->async_queue, query);
+}
+
+/**
+ * Send a SCPI query, and have its response delivered to a callback.
+ *
+ * Takes the same command table and channel selection arguments as
+ * sr_scpi_cmd_resp(). The response gets converted to a GVariant of the
+ * requested type and passed to the callback, which must not keep it.
+ * The callback receives SR_ERR* codes and a NULL value for failed or
+ * timed out queries. Callers which queue several queries must only do
+ * so for devices which accept another query before they have sent the
+ * previous response.
+ *
+ * @return SR_OK when the query was sent, SR_ERR* upon failure. The
+ *         callback does not get invoked in the latter case.
+ */
+SR_PRIV int sr_scpi_cmd_resp_async(const struct sr_dev_inst *sdi,
+		const struct scpi_command *cmdtable,
+		int channel_command, const char *channel_name,
+		const GVariantType *gvtype, sr_scpi_async_cb cb, void *cb_data,
+		int command, ...)
+{
+	struct sr_scpi_dev_inst *scpi;
+	va_list args;
+	const char *channel_cmd;
+	const char *cmd;
+	int ret;
+
+	scpi = sdi->conn;
+
+	if (!(cmd = sr_scpi_cmd_get(cmdtable, command))) {
+		/* Device does not implement this command. */
+		return SR_ERR_NA;
+	}
+
+	g_mutex_lock(&scpi->scpi_mutex);
+
+	/* Select channel. */
+	channel_cmd = sr_scpi_cmd_get(cmdtable, channel_command);
+	if (channel_cmd && channel_name &&
+			g_strcmp0(channel_name, scpi->actual_channel_name)) {
+		sr_spew("sr_scpi_cmd_resp_async(): new channel = %s", channel_name);
+		g_free(scpi->actual_channel_name);
+		scpi->actual_channel_name = g_strdup(channel_name);
+		ret = scpi_send(scpi, channel_cmd, channel_name);
+		if (ret != SR_OK) {
+			g_mutex_unlock(&scpi->scpi_mutex);
+			return ret;
+		}
+	}
+
+	va_start(args, command);
+	ret = scpi_send_variadic(scpi, cmd, args);
+	va_end(args);
+	if (ret != SR_OK) {
+		g_mutex_unlock(&scpi->scpi_mutex);
+		return ret;
+	}
+
+	scpi_async_push(scpi, gvtype, cb, cb_data);
+
+	g_mutex_unlock(&scpi->scpi_mutex);
+
+	return SR_OK;
+}
+
+/**
+ * Get the number of asynchronous queries which wait for their response.
+ */
+SR_PRIV size_t sr_scpi_async_pending(struct sr_scpi_dev_inst *scpi)
+{
+	return scpi->async_queue.length;
+}
+
+/**
+ * Receive responses to asynchronous queries. Call this from the event
+ * source callback, passing the callback's 'revents' argument. Invokes
+ * the callbacks of all queries whose response has arrived, and fails
+ * queries whose response did not arrive in time.
+ *
+ * @return SR_OK upon success, SR_ERR* upon communication failure.
+ */
+SR_PRIV int sr_scpi_async_receive(struct sr_scpi_dev_inst *scpi, int revents)
+{
+	struct scpi_async_query *query;
+	GString *response;
+	GSList *done;
+	int ret;
+
+	if (!scpi->async_queue.length)
+		return SR_OK;
+
+	done = NULL;
+	g_mutex_lock(&scpi->scpi_mutex);
+
+	if (!scpi_async_nonblocking(scpi)) {
+		/* Transports with message framing, one at a time. */
+		response = g_string_sized_new(128);
+		ret = scpi_get_data(scpi, NULL, &response);
+		g_strchomp(response->str);
+		scpi_async_complete(scpi, &done, ret, response->str);
+		g_string_free(response, TRUE);
+	} else {
+		ret = SR_OK;
+		if (revents & G_IO_IN)
+			ret = scpi_async_read(scpi);
+		scpi_async_dispatch(scpi, &done);
+
+		/*
+		 * A late response would get assigned to the wrong
+		 * query. Fail all pending queries, and discard what
+		 * was received so far.
+		 */
+		query = g_queue_peek_head(&scpi->async_queue);
+		if (query && ret == SR_OK &&
+				g_get_monotonic_time() > query->deadline) {
+			sr_err("Timed out waiting for SCPI response.");
+			ret = SR_ERR_TIMEOUT;
+		}
+		if (ret != SR_OK) {
+			while (scpi->async_queue.length)
+				scpi_async_complete(scpi, &done, ret, NULL);
+			g_string_truncate(scpi->async_rx, 0);
+		}
+	}
+
+	g_mutex_unlock(&scpi->scpi_mutex);
+
+	scpi_async_run_callbacks(scpi, done);
+
+	return ret;
+}
+
+/**
+ * Drop pending asynchronous queries without invoking their callbacks,
+ * e.g. when the acquisition stops. Waits for their responses on stream
+ * transports, so that later queries don't receive them.
+ */
+SR_PRIV void sr_scpi_async_cancel(struct sr_scpi_dev_inst *scpi)
+{
+	struct scpi_async_query *query;
+	GSList *done;
+
+	done = NULL;
+	g_mutex_lock(&scpi->scpi_mutex);
+	while (scpi->async_queue.length && scpi_async_nonblocking(scpi)) {
+		scpi_async_dispatch(scpi, &done);
+		query = g_queue_peek_head(&scpi->async_queue);
+		if (!query || g_get_monotonic_time() > query->deadline)
+			break;
+		if (scpi_async_read(scpi) != SR_OK)
+			break;
+	}
+	while ((query = g_queue_pop_head(&scpi->async_queue)))
+		scpi_async_query_free(query);
+	if (scpi->async_rx)
+		g_string_truncate(scpi->async_rx, 0);
+	g_mutex_unlock(&scpi->scpi_mutex);
+
+	g_slist_free_full(done, scpi_async_query_free);
+}
+
+/*
+ * Batches of queries. The queries (and their channel selection) get
+ * compiled once into a compound program message, which results in one
+ * response line with ';' separated values. Devices which don't accept
+ * compound queries (the response fails to parse, or does not arrive)
+ * get the batch's queries as separate messages from then on.
+ */
+
+struct scpi_batch_item {
+	char *select;
+	char *query;
+	const GVariantType *gvtype;
+};
+
+struct sr_scpi_batch {
+	GArray *items;
+	char *compound;
+	char *last_channel;
+	gboolean separate;
+	/* State of the batch which currently executes. */
+	sr_scpi_batch_cb cb;
+	void *cb_data;
+	GVariant **values;
+	size_t items_sent, received;
+	int status;
+	gboolean busy;
+};
+
+static char *scpi_format_variadic(const char *format, va_list args)
+{
+	va_list args_copy;
+	char *buf;
+	int len;
+
+	va_copy(args_copy, args);
+	len = sr_vsnprintf_ascii(NULL, 0, format, args_copy);
+	va_end(args_copy);
+
+	buf = g_malloc0(len + 1);
+	sr_vsprintf_ascii(buf, format, args);
+
+	return buf;
+}
+
+static char *scpi_format(const char *format, ...)
+{
+	va_list args;
+	char *buf;
+
+	va_start(args, format);
+	buf = scpi_format_variadic(format, args);
+	va_end(args);
+
+	return buf;
+}
+
+/*
+ * Append a command to a compound program message. Headers which are
+ * not common commands get anchored at the root, so that they don't
+ * get interpreted relative to the previous command's header path.
+ */
+static void scpi_batch_append(GString *line, const char *cmd)
+{
+	if (line->len)
+		g_string_append_c(line, ';');
+	if (*cmd != ':' && *cmd != '*')
+		g_string_append_c(line, ':');
+	g_string_append(line, cmd);
+}
+
+/**
+ * Create an empty batch of queries. See sr_scpi_batch_add().
+ */
+SR_PRIV struct sr_scpi_batch *sr_scpi_batch_new(void)
+{
+	struct sr_scpi_batch *batch;
+
+	batch = g_malloc0(sizeof(*batch));
+	batch->items = g_array_new(FALSE, TRUE, sizeof(struct scpi_batch_item));
+
+	return batch;
+}
+
+SR_PRIV void sr_scpi_batch_free(struct sr_scpi_batch *batch)
+{
+	struct scpi_batch_item *item;
+	size_t idx;
+
+	if (!batch)
+		return;
+
+	for (idx = 0; idx < batch->items->len; idx++) {
+		item = &g_array_index(batch->items, struct scpi_batch_item, idx);
+		g_free(item->select);
+		g_free(item->query);
+	}
+	g_array_free(batch->items, TRUE);
+	g_free(batch->compound);
+	g_free(batch->last_channel);
+	g_free(batch->values);
+	g_free(batch);
+}
+
+/**
+ * Add a query to a batch. Takes the same arguments as sr_scpi_cmd_resp().
+ * Results get delivered in the order of the batch's queries.
+ *
+ * @return SR_OK upon success, SR_ERR_NA when the device does not
+ *         implement the command. The batch is unchanged in that case.
+ */
+SR_PRIV int sr_scpi_batch_add(struct sr_scpi_batch *batch,
+		const struct scpi_command *cmdtable,
+		int channel_command, const char *channel_name,
+		const GVariantType *gvtype, int command, ...)
+{
+	struct scpi_batch_item item;
+	const char *channel_cmd;
+	const char *cmd;
+	va_list args;
+
+	if (!(cmd = sr_scpi_cmd_get(cmdtable, command)))
+		return SR_ERR_NA;
+
+	memset(&item, 0, sizeof(item));
+	channel_cmd = sr_scpi_cmd_get(cmdtable, channel_command);
+	if (channel_cmd && channel_name)
+		item.select = scpi_format(channel_cmd, channel_name);
+	va_start(args, command);
+	item.query = scpi_format_variadic(cmd, args);
+	va_end(args);
+	item.gvtype = gvtype;
+	g_array_append_val(batch->items, item);
+
+	/* Channel selection is tracked by name, as in sr_scpi_cmd(). */
+	if (item.select) {
+		g_free(batch->last_channel);
+		batch->last_channel = g_strdup(channel_name);
+	}
+	g_free(batch->compound);
+	batch->compound = NULL;
+
+	return SR_OK;
+}
+
+/* Compile the batch's queries into one compound program message. */
+static const char *scpi_batch_compound(struct sr_scpi_batch *batch)
+{
+	struct scpi_batch_item *item;
+	const char *select;
+	GString *line;
+	size_t idx;
+
+	if (batch->compound)
+		return batch->compound;
+
+	line = g_string_sized_new(256);
+	select = NULL;
+	for (idx = 0; idx < batch->items->len; idx++) {
+		item = &g_array_index(batch->items, struct scpi_batch_item, idx);
+		if (item->select && g_strcmp0(item->select, select))
+			scpi_batch_append(line, item->select);
+		if (item->select)
+			select = item->select;
+		scpi_batch_append(line, item->query);
+	}
+	batch->compound = g_string_free(line, FALSE);
+
+	return batch->compound;
+}
+
+/*
+ * Deliver the batch's results. The callback may free the batch (when
+ * it stops the acquisition), don't access the batch after it returned.
+ */
+static void scpi_batch_finish(struct sr_scpi_batch *batch)
+{
+	GVariant **values;
+	size_t count, idx;
+
+	values = batch->values;
+	batch->values = NULL;
+	count = batch->items->len;
+	batch->busy = FALSE;
+	batch->cb(batch, batch->status, values, batch->cb_data);
+	for (idx = 0; idx < count; idx++) {
+		if (values[idx])
+			g_variant_unref(values[idx]);
+	}
+	g_free(values);
+}
+
+/* Split the response to a compound query, and parse its values. */
+static void scpi_batch_compound_cb(struct sr_scpi_dev_inst *scpi,
+		int status, GVariant *value, void *cb_data)
+{
+	struct sr_scpi_batch *batch;
+	struct scpi_batch_item *item;
+	gchar **tokens;
+	size_t idx;
+
+	(void)scpi;
+
+	batch = cb_data;
+
+	tokens = NULL;
+	if (status == SR_OK) {
+		tokens = g_strsplit(g_variant_get_string(value, NULL), ";", 0);
+		if (g_strv_length(tokens) != batch->items->len)
+			status = SR_ERR_DATA;
+	}
+	for (idx = 0; status == SR_OK && idx < batch->items->len; idx++) {
+		item = &g_array_index(batch->items, struct scpi_batch_item, idx);
+		status = scpi_parse_variant(g_strstrip(tokens[idx]),
+			item->gvtype, &batch->values[idx]);
+	}
+	g_strfreev(tokens);
+
+	if (status != SR_OK && batch->items->len > 1) {
+		sr_warn("Compound query failed, sending queries separately.");
+		batch->separate = TRUE;
+	}
+	batch->status = status;
+	scpi_batch_finish(batch);
+}
+
+static void scpi_batch_item_cb(struct sr_scpi_dev_inst *scpi,
+		int status, GVariant *value, void *cb_data)
+{
+	struct sr_scpi_batch *batch;
+
+	(void)scpi;
+
+	batch = cb_data;
+
+	if (status == SR_OK)
+		batch->values[batch->received] = g_variant_ref(value);
+	else if (batch->status == SR_OK)
+		batch->status = status;
+	if (++batch->received == batch->items_sent)
+		scpi_batch_finish(batch);
+}
+
+/**
+ * Send a batch of queries, deliver the results to a callback. Responses
+ * get received by sr_scpi_async_receive(). The callback receives an
+ * array of values which it must not keep, with one item for each of
+ * the batch's queries (NULL for failed queries).
+ *
+ * @return SR_OK when the batch (or part of it) was sent, SR_ERR* upon
+ *         failure. The callback does not get invoked in the latter case.
+ */
+SR_PRIV int sr_scpi_batch_send(const struct sr_dev_inst *sdi,
+		struct sr_scpi_batch *batch, sr_scpi_batch_cb cb, void *cb_data)
+{
+	struct sr_scpi_dev_inst *scpi;
+	struct scpi_batch_item *item;
+	const char *select;
+	size_t idx;
+	int ret;
+
+	scpi = sdi->conn;
+	select = NULL;
+
+	if (!batch->items->len || batch->busy)
+		return SR_ERR_ARG;
+	batch->values = g_malloc0_n(batch->items->len, sizeof(GVariant *));
+	batch->cb = cb;
+	batch->cb_data = cb_data;
+	batch->received = 0;
+	batch->items_sent = batch->items->len;
+	batch->status = SR_OK;
+
+	g_mutex_lock(&scpi->scpi_mutex);
+
 	ret = SR_OK;
-	if (g_variant_type_equal(gvtype, G_VARIANT_TYPE_BOOLEAN)) {
-		if ((ret = parse_strict_bool(s, &b)) == SR_OK)
-			*gvar = g_variant_new_boolean(b);
-	} else if (g_variant_type_equal(gvtype, G_VARIANT_TYPE_DOUBLE)) {
-		if ((ret = sr_atod_ascii(s, &d)) == SR_OK)
-			*gvar = g_variant_new_double(d);
-	} else if (g_variant_type_equal(gvtype, G_VARIANT_TYPE_STRING)) {
-		*gvar = g_variant_new_string(s);
+	if (!batch->separate) {
+		ret = scpi_send(scpi, "%s", scpi_batch_compound(batch));
+		if (ret == SR_OK)
+			scpi_async_push(scpi, G_VARIANT_TYPE_STRING,
+				scpi_batch_compound_cb, batch);
+	}
+	for (idx = 0; batch->separate && idx < batch->items->len; idx++) {
+		item = &g_array_index(batch->items, struct scpi_batch_item, idx);
+		if (item->select && g_strcmp0(item->select, select))
+			ret = scpi_send(scpi, "%s", item->select);
+		if (item->select)
+			select = item->select;
+		if (ret == SR_OK)
+			ret = scpi_send(scpi, "%s", item->query);
+		if (ret != SR_OK)
+			break;
+		scpi_async_push(scpi, item->gvtype, scpi_batch_item_cb, batch);
+	}
+	/* Queries which were sent before a failure still complete. */
+	if (ret != SR_OK && idx) {
+		batch->items_sent = idx;
+		batch->status = ret;
+		ret = SR_OK;
+	}
+	if (ret == SR_OK) {
+		batch->busy = TRUE;
 	} else {
-		sr_err("Unable to convert to desired GVariant type.");
-		ret = SR_ERR_NA;
+		g_free(batch->values);
+		batch->values = NULL;
+	}
+	if (batch->last_channel) {
+		g_free(scpi->actual_channel_name);
+		scpi->actual_channel_name = g_strdup(batch->last_channel);
 	}
 
-	g_free(s);
+	g_mutex_unlock(&scpi->scpi_mutex);
 
 	return ret;
 }
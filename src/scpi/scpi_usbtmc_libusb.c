@@ -29,6 +29,15 @@
 #define MAX_TRANSFER_LENGTH 2048
 #define TRANSFER_TIMEOUT 1000
 
+/* Bulk in transfers kept in flight for the rest of long messages. */
+#define BULK_IN_TRANSFER_LENGTH (64 * 1024)
+#define NUM_BULK_IN_TRANSFERS 8
+
+struct usbtmc_bulkin_transfer {
+	struct libusb_transfer *xfer;
+	int done;
+};
+
 struct scpi_usbtmc_libusb {
 	struct sr_context *ctx;
 	struct sr_usb_dev_inst *usb;
@@ -42,10 +51,20 @@ struct scpi_usbtmc_libusb {
 	uint8_t usb488_dev_cap;
 	uint8_t bTag;
 	uint8_t bulkin_attributes;
+	uint16_t bulk_in_packet_size;
 	uint8_t buffer[MAX_TRANSFER_LENGTH];
+	uint8_t *response;
 	int response_length;
 	int response_bytes_read;
 	int remaining_length;
+	/* Queued bulk in transfers, the oldest one at bulkin_head. */
+	struct usbtmc_bulkin_transfer bulkin[NUM_BULK_IN_TRANSFERS];
+	int bulkin_head;
+	int bulkin_submitted;
+	/* Bytes of the message not covered by the queued transfers. */
+	int bulkin_unqueued;
+	/* The completed transfer which response points into. */
+	struct usbtmc_bulkin_transfer *bulkin_current;
 };
 
 /* Some USBTMC-specific enums, as defined in the USBTMC standard. */
@@ -130,7 +149,7 @@ static GSList *scpi_usbtmc_libusb_scan(struct drv_context *drvc)
 	int confidx, intfidx, ret, i;
 	char *res;
 
-	ret = libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	ret = sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	if (ret < 0) {
 		sr_err("Failed to get device list: %s.",
 		       libusb_error_name(ret));
@@ -164,7 +183,7 @@ static GSList *scpi_usbtmc_libusb_scan(struct drv_context *drvc)
 			libusb_free_config_descriptor(confdes);
 		}
 	}
-	libusb_free_device_list(devlist, 1);
+	sr_usb_free_device_list(devlist);
 
 	/* No log message for #devices found (caller will log that). */
 
@@ -338,6 +357,7 @@ static int scpi_usbtmc_libusb_open(struct sr_scpi_dev_inst *scpi)
 				if (ep->bmAttributes == LIBUSB_TRANSFER_TYPE_BULK &&
 				    ep->bEndpointAddress & (LIBUSB_ENDPOINT_DIR_MASK)) {
 					uscpi->bulk_in_ep = ep->bEndpointAddress;
+					uscpi->bulk_in_packet_size = ep->wMaxPacketSize;
 					sr_dbg("Bulk IN EP %d", uscpi->bulk_in_ep & 0x7f);
 				}
 				if (ep->bmAttributes == LIBUSB_TRANSFER_TYPE_INTERRUPT &&
@@ -563,6 +583,7 @@ static int scpi_usbtmc_bulkin_start(struct scpi_usbtmc_libusb *uscpi,
 	}
 
 	message_size += USBTMC_BULK_HEADER_SIZE;
+	uscpi->response = data;
 	uscpi->response_length = MIN(transferred, message_size);
 	uscpi->response_bytes_read = USBTMC_BULK_HEADER_SIZE;
 	uscpi->remaining_length = message_size - uscpi->response_length;
@@ -584,6 +605,7 @@ static int scpi_usbtmc_bulkin_continue(struct scpi_usbtmc_libusb *uscpi,
 		return SR_ERR;
 	}
 
+	uscpi->response = data;
 	uscpi->response_length = MIN(transferred, uscpi->remaining_length);
 	uscpi->response_bytes_read = 0;
 	uscpi->remaining_length -= uscpi->response_length;
@@ -591,6 +613,126 @@ static int scpi_usbtmc_bulkin_continue(struct scpi_usbtmc_libusb *uscpi,
 	return transferred;
 }
 
+static void LIBUSB_CALL scpi_usbtmc_bulkin_cb(struct libusb_transfer *xfer)
+{
+	struct usbtmc_bulkin_transfer *transfer = xfer->user_data;
+
+	transfer->done = 1;
+}
+
+/* Submit transfers for the rest of the message, as far as they go. */
+static int scpi_usbtmc_bulkin_queue(struct scpi_usbtmc_libusb *uscpi)
+{
+	struct sr_usb_dev_inst *usb = uscpi->usb;
+	struct usbtmc_bulkin_transfer *transfer;
+	int packet_size, length, ret;
+
+	packet_size = uscpi->bulk_in_packet_size ? uscpi->bulk_in_packet_size : 64;
+
+	while (uscpi->bulkin_submitted < NUM_BULK_IN_TRANSFERS &&
+	       uscpi->bulkin_unqueued > 0) {
+		transfer = &uscpi->bulkin[(uscpi->bulkin_head +
+			uscpi->bulkin_submitted) % NUM_BULK_IN_TRANSFERS];
+		if (transfer == uscpi->bulkin_current)
+			break;
+		if (!transfer->xfer) {
+			transfer->xfer = libusb_alloc_transfer(0);
+			transfer->xfer->buffer = g_malloc(BULK_IN_TRANSFER_LENGTH);
+		}
+		/* Whole packets, the device ends the message short. */
+		length = (uscpi->bulkin_unqueued + packet_size - 1)
+			/ packet_size * packet_size;
+		length = MIN(length, BULK_IN_TRANSFER_LENGTH);
+		libusb_fill_bulk_transfer(transfer->xfer, usb->devhdl,
+			uscpi->bulk_in_ep, transfer->xfer->buffer, length,
+			scpi_usbtmc_bulkin_cb, transfer, TRANSFER_TIMEOUT);
+		transfer->done = 0;
+		if ((ret = libusb_submit_transfer(transfer->xfer)) < 0) {
+			sr_err("USBTMC bulk in submit error: %s.",
+			       libusb_error_name(ret));
+			return SR_ERR;
+		}
+		uscpi->bulkin_submitted++;
+		uscpi->bulkin_unqueued -= MIN(length, uscpi->bulkin_unqueued);
+	}
+
+	return SR_OK;
+}
+
+static void scpi_usbtmc_bulkin_wait(struct scpi_usbtmc_libusb *uscpi,
+                                    struct usbtmc_bulkin_transfer *transfer)
+{
+	struct timeval tv = { .tv_sec = 0, .tv_usec = 100 * 1000 };
+
+	while (!transfer->done)
+		libusb_handle_events_timeout_completed(uscpi->ctx->libusb_ctx,
+			&tv, &transfer->done);
+}
+
+/* Cancel the queued transfers, after the message got abandoned. */
+static void scpi_usbtmc_bulkin_cancel(struct scpi_usbtmc_libusb *uscpi)
+{
+	int i;
+
+	for (i = 0; i < uscpi->bulkin_submitted; i++)
+		libusb_cancel_transfer(uscpi->bulkin[(uscpi->bulkin_head + i)
+			% NUM_BULK_IN_TRANSFERS].xfer);
+	while (uscpi->bulkin_submitted) {
+		scpi_usbtmc_bulkin_wait(uscpi, &uscpi->bulkin[uscpi->bulkin_head]);
+		uscpi->bulkin_head = (uscpi->bulkin_head + 1) % NUM_BULK_IN_TRANSFERS;
+		uscpi->bulkin_submitted--;
+	}
+	uscpi->bulkin_current = NULL;
+	uscpi->bulkin_unqueued = 0;
+}
+
+/*
+ * Get the next part of a long message. Several transfers stay queued,
+ * so the device can keep sending while the host reads the data.
+ */
+static int scpi_usbtmc_bulkin_next(struct scpi_usbtmc_libusb *uscpi)
+{
+	struct usbtmc_bulkin_transfer *transfer;
+	struct libusb_transfer *xfer;
+
+	uscpi->bulkin_current = NULL;
+	/* Up to three bytes of alignment padding follow the message. */
+	if (!uscpi->bulkin_submitted && uscpi->bulkin_unqueued <= 0)
+		uscpi->bulkin_unqueued = uscpi->remaining_length + 3;
+	if (scpi_usbtmc_bulkin_queue(uscpi) != SR_OK) {
+		scpi_usbtmc_bulkin_cancel(uscpi);
+		return SR_ERR;
+	}
+
+	transfer = &uscpi->bulkin[uscpi->bulkin_head];
+	scpi_usbtmc_bulkin_wait(uscpi, transfer);
+	uscpi->bulkin_head = (uscpi->bulkin_head + 1) % NUM_BULK_IN_TRANSFERS;
+	uscpi->bulkin_submitted--;
+
+	xfer = transfer->xfer;
+	if (xfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		sr_err("USBTMC bulk in transfer error: %s.",
+		       libusb_error_name(xfer->status == LIBUSB_TRANSFER_TIMED_OUT
+				? LIBUSB_ERROR_TIMEOUT : LIBUSB_ERROR_IO));
+		scpi_usbtmc_bulkin_cancel(uscpi);
+		return SR_ERR;
+	}
+
+	uscpi->bulkin_current = transfer;
+	uscpi->response = xfer->buffer;
+	uscpi->response_length = MIN(xfer->actual_length, uscpi->remaining_length);
+	uscpi->response_bytes_read = 0;
+	uscpi->remaining_length -= uscpi->response_length;
+
+	/* Keep the device busy while this part gets read. */
+	if (scpi_usbtmc_bulkin_queue(uscpi) != SR_OK) {
+		scpi_usbtmc_bulkin_cancel(uscpi);
+		return SR_ERR;
+	}
+
+	return xfer->actual_length;
+}
+
 static int scpi_usbtmc_libusb_send(void *priv, const char *command)
 {
 	struct scpi_usbtmc_libusb *uscpi = priv;
@@ -608,6 +750,7 @@ static int scpi_usbtmc_libusb_read_begin(void *priv)
 {
 	struct scpi_usbtmc_libusb *uscpi = priv;
 
+	scpi_usbtmc_bulkin_cancel(uscpi);
 	uscpi->remaining_length = 0;
 
 	if (scpi_usbtmc_bulkout(uscpi, REQUEST_DEV_DEP_MSG_IN,
@@ -627,7 +770,11 @@ static int scpi_usbtmc_libusb_read_data(void *priv, char *buf, int maxlen)
 	int read_length;
 
 	if (uscpi->response_bytes_read >= uscpi->response_length) {
-		if (uscpi->remaining_length > 0) {
+		if (uscpi->remaining_length > (int)sizeof(uscpi->buffer) ||
+		    (uscpi->remaining_length > 0 && uscpi->bulkin_submitted)) {
+			if (scpi_usbtmc_bulkin_next(uscpi) <= 0)
+				return SR_ERR;
+		} else if (uscpi->remaining_length > 0) {
 			if (scpi_usbtmc_bulkin_continue(uscpi, uscpi->buffer,
 			                                sizeof(uscpi->buffer)) <= 0)
 				return SR_ERR;
@@ -641,7 +788,7 @@ static int scpi_usbtmc_libusb_read_data(void *priv, char *buf, int maxlen)
 
 	read_length = MIN(uscpi->response_length - uscpi->response_bytes_read, maxlen);
 
-	memcpy(buf, uscpi->buffer + uscpi->response_bytes_read, read_length);
+	memcpy(buf, uscpi->response + uscpi->response_bytes_read, read_length);
 
 	uscpi->response_bytes_read += read_length;
 
@@ -660,11 +807,20 @@ static int scpi_usbtmc_libusb_close(struct sr_scpi_dev_inst *scpi)
 {
 	struct scpi_usbtmc_libusb *uscpi = scpi->priv;
 	struct sr_usb_dev_inst *usb = uscpi->usb;
-	int ret;
+	int i, ret;
 
 	if (!usb->devhdl)
 		return SR_ERR;
 
+	scpi_usbtmc_bulkin_cancel(uscpi);
+	for (i = 0; i < NUM_BULK_IN_TRANSFERS; i++) {
+		if (!uscpi->bulkin[i].xfer)
+			continue;
+		g_free(uscpi->bulkin[i].xfer->buffer);
+		libusb_free_transfer(uscpi->bulkin[i].xfer);
+		uscpi->bulkin[i].xfer = NULL;
+	}
+
 	scpi_usbtmc_local(uscpi);
 
 	if ((ret = libusb_release_interface(usb->devhdl, uscpi->interface)) < 0)
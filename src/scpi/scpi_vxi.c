@@ -30,6 +30,8 @@
 
 #define LOG_PREFIX "scpi_vxi"
 #define VXI_DEFAULT_TIMEOUT_MS 2000
+/* Bytes to ask for per device_read, whatever the caller's buffer size. */
+#define VXI_READ_SIZE (1024 * 1024)
 
 struct scpi_vxi {
 	char *address;
@@ -38,6 +40,11 @@ struct scpi_vxi {
 	Device_Link link;
 	unsigned int max_send_size;
 	unsigned int read_complete;
+	/* Response data received ahead of the caller's reads. */
+	char *read_data;
+	unsigned long read_len;
+	unsigned long read_pos;
+	long read_reason;
 };
 
 static int scpi_vxi_dev_inst_new(void *priv, struct drv_context *drvc,
@@ -79,7 +86,7 @@ static int scpi_vxi_open(struct sr_scpi_dev_inst *scpi)
 	link_parms.clientId = (long) vxi->client;
 	link_parms.lockDevice = 0;
 	link_parms.lock_timeout = VXI_DEFAULT_TIMEOUT_MS;
-	link_parms.device = (char *)"inst0";
+	link_parms.device = vxi->instrument;
 
 	link_resp = create_link_1(&link_parms, vxi->client);
 	if (!link_resp) {
@@ -169,6 +176,11 @@ static int scpi_vxi_read_begin(void *priv)
 	vxi = priv;
 	vxi->read_complete = 0;
 
+	/* Drop what is left of an earlier response. */
+	g_free(vxi->read_data);
+	vxi->read_data = NULL;
+	vxi->read_len = vxi->read_pos = 0;
+
 	return SR_OK;
 }
 
@@ -182,31 +194,52 @@ static int scpi_vxi_read_data(void *priv, char *buf, int maxlen)
 	struct scpi_vxi *vxi;
 	Device_ReadParms read_parms;
 	Device_ReadResp *read_resp;
+	unsigned long len;
 
 	vxi = priv;
-	read_parms.lid          = vxi->link;
-	read_parms.io_timeout   = VXI_DEFAULT_TIMEOUT_MS;
-	read_parms.lock_timeout = VXI_DEFAULT_TIMEOUT_MS;
-	read_parms.flags        = 0;
-	read_parms.termChar     = 0;
-	read_parms.requestSize  = maxlen;
-
-	read_resp = device_read_1(&read_parms, vxi->client);
-	if (!read_resp || read_resp->error) {
-		sr_err("Device read failed for %s with error %ld",
-		       vxi->address, read_resp ? read_resp->error : 0);
-		if (read_resp) {
-			g_free(read_resp->data.data_val);
-			read_resp->data.data_val = NULL;
+
+	/*
+	 * Every device_read is an RPC round trip, so ask for a large
+	 * chunk, and serve small reads like those of block headers from
+	 * what was received already.
+	 */
+	if (vxi->read_pos >= vxi->read_len) {
+		g_free(vxi->read_data);
+		vxi->read_data = NULL;
+		vxi->read_len = vxi->read_pos = 0;
+
+		read_parms.lid          = vxi->link;
+		read_parms.io_timeout   = VXI_DEFAULT_TIMEOUT_MS;
+		read_parms.lock_timeout = VXI_DEFAULT_TIMEOUT_MS;
+		read_parms.flags        = 0;
+		read_parms.termChar     = 0;
+		read_parms.requestSize  = MAX(maxlen, VXI_READ_SIZE);
+
+		read_resp = device_read_1(&read_parms, vxi->client);
+		if (!read_resp || read_resp->error) {
+			sr_err("Device read failed for %s with error %ld",
+			       vxi->address, read_resp ? read_resp->error : 0);
+			if (read_resp) {
+				g_free(read_resp->data.data_val);
+				read_resp->data.data_val = NULL;
+			}
+			return SR_ERR;
 		}
-		return SR_ERR;
+
+		/* Keep the received data, instead of copying it. */
+		vxi->read_data = read_resp->data.data_val;
+		vxi->read_len = read_resp->data.data_len;
+		vxi->read_reason = read_resp->reason;
+		read_resp->data.data_val = NULL;
 	}
 
-	memcpy(buf, read_resp->data.data_val, read_resp->data.data_len);
-	g_free(read_resp->data.data_val);
-	read_resp->data.data_val = NULL;
-	vxi->read_complete = read_resp->reason & (RRR_TERM | RRR_END);
-	return read_resp->data.data_len;  /* actual number of bytes received */
+	len = MIN((unsigned long)maxlen, vxi->read_len - vxi->read_pos);
+	memcpy(buf, vxi->read_data + vxi->read_pos, len);
+	vxi->read_pos += len;
+	vxi->read_complete = vxi->read_pos >= vxi->read_len
+		&& (vxi->read_reason & (RRR_TERM | RRR_END));
+
+	return len;
 }
 
 static int scpi_vxi_read_complete(void *priv)
@@ -234,6 +267,10 @@ static int scpi_vxi_close(struct sr_scpi_dev_inst *scpi)
 	clnt_destroy(vxi->client);
 	vxi->client = NULL;
 
+	g_free(vxi->read_data);
+	vxi->read_data = NULL;
+	vxi->read_len = vxi->read_pos = 0;
+
 	return SR_OK;
 }
 
@@ -95,7 +95,9 @@ SR_PRIV int serial_open(struct sr_serial_dev_inst *serial, int flags)
 	 * variant from the serial port's name. Default to libserialport
 	 * for backwards compatibility.
 	 */
-	if (ser_name_is_hid(serial))
+	if (ser_name_is_replay(serial))
+		serial->lib_funcs = ser_lib_funcs_replay;
+	else if (ser_name_is_hid(serial))
 		serial->lib_funcs = ser_lib_funcs_hid;
 	else if (ser_name_is_bt(serial))
 		serial->lib_funcs = ser_lib_funcs_bt;
@@ -105,11 +107,10 @@ SR_PRIV int serial_open(struct sr_serial_dev_inst *serial, int flags)
 		return SR_ERR_NA;
 
 	/*
-	 * Note that use of the 'rcv_buffer' is optional, and the buffer's
-	 * size heavily depends on the specific transport. That's why the
-	 * buffer's content gets accessed and the buffer is released here in
-	 * common code, but the buffer gets allocated in libraries' open()
-	 * routines.
+	 * The receive queue is common code. Transports queue data which
+	 * they receive in larger chunks than callers read, common code
+	 * puts back data which it has read ahead. Storage gets allocated
+	 * on first use, and released when the port gets closed.
 	 */
 
 	/*
@@ -167,9 +168,10 @@ SR_PRIV int serial_close(struct sr_serial_dev_inst *serial)
 		return SR_ERR_NA;
 
 	rc = serial->lib_funcs->close(serial);
-	if (rc == SR_OK && serial->rcv_buffer) {
-		g_string_free(serial->rcv_buffer, TRUE);
-		serial->rcv_buffer = NULL;
+	if (rc == SR_OK) {
+		g_free(serial->rcv_queue.data);
+		memset(&serial->rcv_queue, 0, sizeof(serial->rcv_queue));
+		serial->rec_skip = 0;
 	}
 
 	return rc;
@@ -274,6 +276,51 @@ SR_PRIV int serial_set_read_chunk_cb(struct sr_serial_dev_inst *serial,
 	return SR_OK;
 }
 
+/*
+ * The receive queue is a ring buffer of a power of two size, which
+ * grows on demand. Data is taken from the head, and appended at the
+ * tail. Putting back read ahead data moves the head backwards.
+ */
+static void rx_queue_peek(const struct sr_ser_rx_queue *q,
+	uint8_t *data, size_t len)
+{
+	size_t first;
+
+	first = MIN(len, q->size - q->head);
+	memcpy(data, &q->data[q->head], first);
+	memcpy(&data[first], q->data, len - first);
+}
+
+static void rx_queue_reserve(struct sr_ser_rx_queue *q, size_t len)
+{
+	size_t size;
+	uint8_t *data;
+
+	if (q->len + len <= q->size)
+		return;
+
+	size = q->size ? q->size : 64;
+	while (size < q->len + len)
+		size *= 2;
+	data = g_malloc(size);
+	if (q->len)
+		rx_queue_peek(q, data, q->len);
+	g_free(q->data);
+	q->data = data;
+	q->size = size;
+	q->head = 0;
+}
+
+static void rx_queue_store(struct sr_ser_rx_queue *q, size_t pos,
+	const uint8_t *data, size_t len)
+{
+	size_t first;
+
+	first = MIN(len, q->size - pos);
+	memcpy(&q->data[pos], data, first);
+	memcpy(q->data, &data[first], len - first);
+}
+
 /**
  * Discard previously queued RX data. Internal to the serial subsystem,
  * coordination between common and transport specific support code.
@@ -284,10 +331,12 @@ SR_PRIV int serial_set_read_chunk_cb(struct sr_serial_dev_inst *serial,
  */
 SR_PRIV void sr_ser_discard_queued_data(struct sr_serial_dev_inst *serial)
 {
-	if (!serial || !serial->rcv_buffer)
+	if (!serial)
 		return;
 
-	g_string_truncate(serial->rcv_buffer, 0);
+	serial->rcv_queue.head = 0;
+	serial->rcv_queue.len = 0;
+	serial->rec_skip = 0;
 }
 
 /**
@@ -300,10 +349,10 @@ SR_PRIV void sr_ser_discard_queued_data(struct sr_serial_dev_inst *serial)
  */
 SR_PRIV size_t sr_ser_has_queued_data(struct sr_serial_dev_inst *serial)
 {
-	if (!serial || !serial->rcv_buffer)
+	if (!serial)
 		return 0;
 
-	return serial->rcv_buffer->len;
+	return serial->rcv_queue.len;
 }
 
 /**
@@ -319,13 +368,49 @@ SR_PRIV size_t sr_ser_has_queued_data(struct sr_serial_dev_inst *serial)
 SR_PRIV void sr_ser_queue_rx_data(struct sr_serial_dev_inst *serial,
 	const uint8_t *data, size_t len)
 {
+	struct sr_ser_rx_queue *q;
+
 	if (!serial || !data || !len)
 		return;
 
-	if (serial->rx_chunk_cb_func)
+	if (serial->rx_chunk_cb_func) {
+		sr_traffic_record(SR_TRAFFIC_SERIAL_RX, 0, data, len);
 		serial->rx_chunk_cb_func(serial, serial->rx_chunk_cb_data, data, len);
-	else if (serial->rcv_buffer)
-		g_string_append_len(serial->rcv_buffer, (const gchar *)data, len);
+		return;
+	}
+
+	q = &serial->rcv_queue;
+	rx_queue_reserve(q, len);
+	rx_queue_store(q, (q->head + q->len) & (q->size - 1), data, len);
+	q->len += len;
+}
+
+/**
+ * Put back data which was read ahead, to have it received again before
+ * all other data. Internal to the serial subsystem.
+ *
+ * @param[in] serial Previously opened serial port instance.
+ * @param[in] data Pointer to the data bytes, in the order of reception.
+ * @param[in] len Number of data bytes.
+ *
+ * @private
+ */
+SR_PRIV void sr_ser_unread_rx_data(struct sr_serial_dev_inst *serial,
+	const uint8_t *data, size_t len)
+{
+	struct sr_ser_rx_queue *q;
+
+	if (!serial || !data || !len)
+		return;
+
+	/* Put back data gets received again, but is recorded once. */
+	serial->rec_skip += len;
+
+	q = &serial->rcv_queue;
+	rx_queue_reserve(q, len);
+	q->head = (q->head + q->size - len) & (q->size - 1);
+	rx_queue_store(q, q->head, data, len);
+	q->len += len;
 }
 
 /**
@@ -341,23 +426,20 @@ SR_PRIV void sr_ser_queue_rx_data(struct sr_serial_dev_inst *serial,
 SR_PRIV size_t sr_ser_unqueue_rx_data(struct sr_serial_dev_inst *serial,
 	uint8_t *data, size_t len)
 {
-	size_t qlen;
-	GString *buf;
+	struct sr_ser_rx_queue *q;
 
 	if (!serial || !data || !len)
 		return 0;
 
-	qlen = sr_ser_has_queued_data(serial);
-	if (!qlen)
+	q = &serial->rcv_queue;
+	if (len > q->len)
+		len = q->len;
+	if (!len)
 		return 0;
 
-	buf = serial->rcv_buffer;
-	if (len > buf->len)
-		len = buf->len;
-	if (len) {
-		memcpy(data, buf->str, len);
-		g_string_erase(buf, 0, len);
-	}
+	rx_queue_peek(q, data, len);
+	q->len -= len;
+	q->head = q->len ? (q->head + len) & (q->size - 1) : 0;
 
 	return len;
 }
@@ -450,10 +532,22 @@ SR_PRIV int serial_write_nonblocking(struct sr_serial_dev_inst *serial,
 	return _serial_write(serial, buf, count, 1, 0);
 }
 
+/* Record received data, except for data which was put back. */
+static void serial_record(struct sr_serial_dev_inst *serial,
+	const uint8_t *buf, size_t len)
+{
+	size_t skip;
+
+	skip = MIN(serial->rec_skip, len);
+	serial->rec_skip -= skip;
+	sr_traffic_record(SR_TRAFFIC_SERIAL_RX, 0, buf + skip, len - skip);
+}
+
 static int _serial_read(struct sr_serial_dev_inst *serial,
 	void *buf, size_t count, int nonblocking, unsigned int timeout_ms)
 {
 	ssize_t ret;
+	size_t got;
 
 	if (!serial) {
 		sr_dbg("Invalid serial port.");
@@ -462,8 +556,23 @@ static int _serial_read(struct sr_serial_dev_inst *serial,
 
 	if (!serial->lib_funcs || !serial->lib_funcs->read)
 		return SR_ERR_NA;
-	ret = serial->lib_funcs->read(serial, buf, count,
-		nonblocking, timeout_ms);
+
+	/* Queued data comes first, including data which was put back. */
+	got = sr_ser_unqueue_rx_data(serial, buf, count);
+	if (got == count) {
+		serial_record(serial, buf, got);
+		sr_spew("Read %zu/%zu bytes.", got, count);
+		return got;
+	}
+
+	ret = serial->lib_funcs->read(serial, (uint8_t *)buf + got,
+		count - got, nonblocking, timeout_ms);
+	if (ret < 0) {
+		serial_record(serial, buf, got);
+		return got ? (ssize_t)got : ret;
+	}
+	ret += got;
+	serial_record(serial, buf, ret);
 	if (ret > 0)
 		sr_spew("Read %zd/%zu bytes.", ret, count);
 
@@ -719,6 +828,27 @@ SR_PRIV int serial_set_paramstr(struct sr_serial_dev_inst *serial,
 			flow, rts, dtr);
 }
 
+/*
+ * Wait for receive data up to the timeout, then take all that is
+ * available, up to the buffer size. Callers put back what they have
+ * read ahead, see sr_ser_unread_rx_data(). Returns the number of
+ * bytes, or a negative error code.
+ */
+static int serial_read_available(struct sr_serial_dev_inst *serial,
+	uint8_t *buf, size_t size, unsigned int timeout_ms)
+{
+	int ret, more;
+
+	ret = serial_read_blocking(serial, buf, 1, timeout_ms);
+	if (ret < 1 || size == 1)
+		return ret;
+	more = serial_read_nonblocking(serial, &buf[1], size - 1);
+	if (more > 0)
+		ret += more;
+
+	return ret;
+}
+
 /**
  * Read a line from the specified serial port.
  *
@@ -739,6 +869,7 @@ SR_PRIV int serial_readline(struct sr_serial_dev_inst *serial,
 {
 	gint64 start, remaining;
 	int maxlen, len;
+	char *p, *end;
 
 	if (!serial) {
 		sr_dbg("Invalid serial port.");
@@ -759,16 +890,23 @@ SR_PRIV int serial_readline(struct sr_serial_dev_inst *serial,
 		len = maxlen - *buflen - 1;
 		if (len < 1)
 			break;
-		len = serial_read_blocking(serial, *buf + *buflen, 1, remaining);
+		len = serial_read_available(serial,
+			(uint8_t *)*buf + *buflen, len, remaining);
 		if (len > 0) {
-			*buflen += len;
-			*(*buf + *buflen) = '\0';
-			if (*buflen > 0 && (*(*buf + *buflen - 1) == '\r'
-					|| *(*buf + *buflen - 1) == '\n')) {
-				/* Strip CR/LF and terminate. */
-				*(*buf + --*buflen) = '\0';
+			p = *buf + *buflen;
+			end = p + len;
+			while (p < end && *p != '\r' && *p != '\n')
+				p++;
+			if (p < end) {
+				/* Strip CR/LF and terminate, keep what follows. */
+				sr_ser_unread_rx_data(serial,
+					(uint8_t *)p + 1, end - p - 1);
+				*buflen = p - *buf;
+				*p = '\0';
 				break;
 			}
+			*buflen += len;
+			*(*buf + *buflen) = '\0';
 		}
 		/* Reduce timeout by time elapsed. */
 		remaining = timeout_ms - ((g_get_monotonic_time() - start) / 1000);
@@ -816,12 +954,11 @@ SR_PRIV int serial_stream_detect(struct sr_serial_dev_inst *serial,
 	packet_valid_len_callback is_valid_len, size_t *return_size,
 	uint64_t timeout_ms)
 {
-	uint64_t start_us, elapsed_ms, byte_delay_us;
+	uint64_t start_us, elapsed_ms;
 	size_t fill_idx, check_idx, max_fill_idx;
-	ssize_t recv_len;
+	int recv_len;
 	const uint8_t *check_ptr;
 	size_t check_len, pkt_len;
-	gboolean do_dump;
 	int ret;
 
 	sr_dbg("Detecting packets on %s (timeout = %" PRIu64 "ms).",
@@ -838,86 +975,77 @@ SR_PRIV int serial_stream_detect(struct sr_serial_dev_inst *serial,
 		return SR_ERR_ARG;
 	}
 
-	byte_delay_us = serial_timeout(serial, 1) * 1000;
 	start_us = g_get_monotonic_time();
 
 	check_idx = fill_idx = 0;
+	elapsed_ms = 0;
 	while (fill_idx < max_fill_idx) {
 		/*
-		 * Read bytes individually. Lets callers continue to
-		 * successfully process next RX data after first match.
-		 * Run full loop bodies for empty or failed reception
-		 * in an iteration, to have timeouts checked.
+		 * Wait for more receive data, then take all that is
+		 * available. Data which follows a valid packet gets put
+		 * back, callers continue to process it after the match.
 		 */
-		recv_len = serial_read_nonblocking(serial, &buf[fill_idx], 1);
+		recv_len = serial_read_available(serial, &buf[fill_idx],
+			max_fill_idx - fill_idx, MAX(timeout_ms - elapsed_ms, 1));
 		if (recv_len > 0)
 			fill_idx += recv_len;
 
-		/* Dump receive data when (a minimum) size is reached. */
-		check_ptr = &buf[check_idx];
-		check_len = fill_idx - check_idx;
-		do_dump = check_len >= packet_size;
-		do_dump &= sr_log_loglevel_get() >= SR_LOG_SPEW;
-		if (do_dump) {
-			GString *text;
-
-			text = sr_hexdump_new(check_ptr, check_len);
-			sr_spew("Trying packet: len %zu, bytes %s",
-				check_len, text->str);
-			sr_hexdump_free(text);
-		}
+		/* Check all positions where a (minimum) packet was received. */
+		while (fill_idx - check_idx >= packet_size) {
+			check_ptr = &buf[check_idx];
+			check_len = fill_idx - check_idx;
+			if (sr_log_enabled(SR_LOG_SPEW)) {
+				GString *text;
+
+				text = sr_hexdump_new(check_ptr, check_len);
+				sr_spew("Trying packet: len %zu, bytes %s",
+					check_len, text->str);
+				sr_hexdump_free(text);
+			}
 
-		/* A packet's (minimum) length was received, check its data. */
-		elapsed_ms = g_get_monotonic_time() - start_us;
-		elapsed_ms /= 1000;
-		if (is_valid_len && check_len >= packet_size) {
 			pkt_len = packet_size;
-			ret = is_valid_len(NULL, check_ptr, check_len, &pkt_len);
-			if (ret == SR_PACKET_VALID) {
-				/* Exact match. Terminate with success. */
-				sr_spew("Valid packet after %" PRIu64 "ms.",
-					elapsed_ms);
-				sr_spew("RX count %zu, packet len %zu.",
-					fill_idx, pkt_len);
-				*buflen = fill_idx;
-				if (return_size)
-					*return_size = pkt_len;
-				return SR_OK;
-			}
-			if (ret == SR_PACKET_NEED_RX) {
-				/* Incomplete, keep accumulating RX data. */
-				sr_spew("Checker needs more RX data.");
+			if (is_valid_len) {
+				ret = is_valid_len(NULL, check_ptr, check_len, &pkt_len);
+				if (ret == SR_PACKET_NEED_RX) {
+					/* Incomplete, keep accumulating RX data. */
+					sr_spew("Checker needs more RX data.");
+					break;
+				}
+				ret = ret == SR_PACKET_VALID;
 			} else {
+				ret = is_valid && is_valid(check_ptr);
+			}
+			if (!ret) {
 				/* Not a valid packet. Continue searching. */
 				sr_spew("Invalid packet, advancing read pos.");
 				check_idx++;
+				continue;
 			}
-		}
-		if (is_valid && check_len >= packet_size) {
-			if (is_valid(check_ptr)) {
-				/* Exact match. Terminate with success. */
-				sr_spew("Valid packet after %" PRIu64 "ms.",
-					elapsed_ms);
-				sr_spew("RX count %zu, packet len %zu.",
-					fill_idx, packet_size);
-				*buflen = fill_idx;
-				if (return_size)
-					*return_size = packet_size;
-				return SR_OK;
+
+			/* Exact match. Terminate with success. */
+			elapsed_ms = (g_get_monotonic_time() - start_us) / 1000;
+			sr_spew("Valid packet after %" PRIu64 "ms.", elapsed_ms);
+			if (check_idx + pkt_len < fill_idx) {
+				sr_ser_unread_rx_data(serial, &buf[check_idx + pkt_len],
+					fill_idx - check_idx - pkt_len);
+				fill_idx = check_idx + pkt_len;
 			}
-			/* Not a valid packet. Continue searching. */
-			sr_spew("Invalid packet, advancing read pointer.");
-			check_idx++;
+			sr_spew("RX count %zu, packet len %zu.", fill_idx, pkt_len);
+			*buflen = fill_idx;
+			if (return_size)
+				*return_size = pkt_len;
+			return SR_OK;
 		}
 
 		/* Check for packet search timeout. */
+		elapsed_ms = (g_get_monotonic_time() - start_us) / 1000;
 		if (elapsed_ms >= timeout_ms) {
 			sr_dbg("Detection timed out after %" PRIu64 "ms.",
 				elapsed_ms);
 			break;
 		}
-		if (recv_len < 1)
-			g_usleep(byte_delay_us);
+		if (recv_len < 0)
+			g_usleep(serial_timeout(serial, 1) * 1000);
 	}
 	sr_info("Didn't find a valid packet (read %zu bytes).", fill_idx);
 	*buflen = fill_idx;
@@ -1003,6 +1131,254 @@ SR_PRIV int serial_source_add(struct sr_session *session,
 		events, timeout, cb, cb_data);
 }
 
+/*
+ * Multiplexer of the serial ports in a session. One event source polls
+ * all ports which joined it. Port timeouts expire on a common time grid
+ * (multiples of the timeout), so ports with the same timeout get served
+ * in one wakeup rather than by timers of their own.
+ */
+struct serial_mux_port {
+	struct sr_serial_dev_inst *serial;
+	GPollFD pollfd;
+	int64_t timeout_us;
+	int64_t due_us;
+	sr_receive_data_callback cb;
+	void *cb_data;
+	gboolean removed;
+};
+
+struct serial_mux {
+	GSource base;
+	struct sr_session *session;
+	GPtrArray *ports;
+	gboolean dispatching;
+};
+
+/* The key of the multiplexer in the session's event sources. */
+static int serial_mux_key;
+
+static int64_t serial_mux_next_due(int64_t now_us, int64_t timeout_us)
+{
+	return (now_us / timeout_us + 1) * timeout_us;
+}
+
+static gboolean serial_mux_prepare(GSource *source, int *timeout)
+{
+	struct serial_mux *mux;
+	struct serial_mux_port *port;
+	int64_t now_us, due_us;
+	guint i;
+
+	mux = (struct serial_mux *)source;
+	now_us = g_source_get_time(source);
+	due_us = INT64_MAX;
+	for (i = 0; i < mux->ports->len; i++) {
+		port = g_ptr_array_index(mux->ports, i);
+		if (port->timeout_us < 0)
+			continue;
+		if (!port->due_us)
+			port->due_us = serial_mux_next_due(now_us, port->timeout_us);
+		due_us = MIN(due_us, port->due_us);
+	}
+
+	if (due_us == INT64_MAX)
+		*timeout = -1;
+	else
+		*timeout = (MAX(0, due_us - now_us) + 999) / 1000;
+
+	return *timeout == 0;
+}
+
+static gboolean serial_mux_check(GSource *source)
+{
+	struct serial_mux *mux;
+	struct serial_mux_port *port;
+	int64_t now_us;
+	guint i;
+
+	mux = (struct serial_mux *)source;
+	now_us = g_source_get_time(source);
+	for (i = 0; i < mux->ports->len; i++) {
+		port = g_ptr_array_index(mux->ports, i);
+		if (port->pollfd.revents)
+			return TRUE;
+		if (port->timeout_us >= 0 && port->due_us <= now_us)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void serial_mux_purge(struct serial_mux *mux)
+{
+	struct serial_mux_port *port;
+	guint i;
+
+	i = 0;
+	while (i < mux->ports->len) {
+		port = g_ptr_array_index(mux->ports, i);
+		if (!port->removed) {
+			i++;
+			continue;
+		}
+		g_source_remove_poll(&mux->base, &port->pollfd);
+		g_ptr_array_remove_index(mux->ports, i);
+		g_free(port);
+	}
+}
+
+static gboolean serial_mux_dispatch(GSource *source,
+	GSourceFunc callback, void *user_data)
+{
+	struct serial_mux *mux;
+	struct serial_mux_port *port;
+	unsigned int revents;
+	int64_t now_us;
+	guint i, count;
+
+	(void)callback;
+	(void)user_data;
+
+	mux = (struct serial_mux *)source;
+	now_us = g_source_get_time(source);
+	mux->dispatching = TRUE;
+	/* Ports which callbacks add get served in the next iteration. */
+	count = mux->ports->len;
+	for (i = 0; i < count; i++) {
+		port = g_ptr_array_index(mux->ports, i);
+		if (port->removed)
+			continue;
+		revents = port->pollfd.revents;
+		port->pollfd.revents = 0;
+		if (!revents && (port->timeout_us < 0 || port->due_us > now_us))
+			continue;
+		if (!port->cb(port->pollfd.fd, revents, port->cb_data)) {
+			port->removed = TRUE;
+			continue;
+		}
+		if (port->timeout_us >= 0)
+			port->due_us = serial_mux_next_due(now_us, port->timeout_us);
+	}
+	mux->dispatching = FALSE;
+	serial_mux_purge(mux);
+
+	return mux->ports->len ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+}
+
+static void serial_mux_finalize(GSource *source)
+{
+	struct serial_mux *mux;
+
+	mux = (struct serial_mux *)source;
+	g_ptr_array_free(mux->ports, TRUE);
+	sr_session_source_destroyed(mux->session, &serial_mux_key, source);
+}
+
+/**
+ * Add a serial port to the session's multiplexer, which polls all of
+ * its ports in one event source.
+ *
+ * The callback runs when the port has events, or when the timeout has
+ * passed without a callback for the port. Timeouts of all ports expire
+ * on multiples of their value, so the first one may come early. Ports
+ * of transports which cannot be polled get an event source of their
+ * own, see serial_source_add(). serial_source_remove() removes ports
+ * in either case.
+ *
+ * @private
+ */
+SR_PRIV int serial_mux_source_add(struct sr_session *session,
+	struct sr_serial_dev_inst *serial, int events, int timeout,
+	sr_receive_data_callback cb, void *cb_data)
+{
+	static GSourceFuncs serial_mux_funcs = {
+		.prepare  = serial_mux_prepare,
+		.check    = serial_mux_check,
+		.dispatch = serial_mux_dispatch,
+		.finalize = serial_mux_finalize,
+	};
+	struct serial_mux *mux;
+	struct serial_mux_port *port;
+	GSource *source;
+	gintptr fd;
+	unsigned int poll_events;
+	int ret;
+
+	if (!session || !cb)
+		return SR_ERR_ARG;
+	if (!dev_is_supported(serial)) {
+		sr_err("Invalid serial port.");
+		return SR_ERR_ARG;
+	}
+	if (!serial->lib_funcs || !serial->lib_funcs->get_pollfd)
+		return serial_source_add(session, serial, events,
+			timeout, cb, cb_data);
+
+	ret = serial->lib_funcs->get_pollfd(serial, events, &fd, &poll_events);
+	if (ret != SR_OK)
+		return ret;
+
+	source = g_hash_table_lookup(session->event_sources, &serial_mux_key);
+	if (source) {
+		mux = (struct serial_mux *)source;
+	} else {
+		source = g_source_new(&serial_mux_funcs, sizeof(*mux));
+		g_source_set_name(source, "serial-mux");
+		mux = (struct serial_mux *)source;
+		mux->session = session;
+		mux->ports = g_ptr_array_new();
+		ret = sr_session_source_add_internal(session,
+			&serial_mux_key, source);
+		g_source_unref(source);
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	port = g_malloc0(sizeof(*port));
+	port->serial = serial;
+	port->pollfd.fd = fd;
+	port->pollfd.events = poll_events;
+	port->timeout_us = timeout >= 0 ? 1000 * (int64_t)timeout : -1;
+	port->cb = cb;
+	port->cb_data = cb_data;
+	g_ptr_array_add(mux->ports, port);
+	g_source_add_poll(source, &port->pollfd);
+
+	return SR_OK;
+}
+
+/* Remove a port from the session's multiplexer, if it is there. */
+static gboolean serial_mux_source_remove(struct sr_session *session,
+	struct sr_serial_dev_inst *serial)
+{
+	struct serial_mux *mux;
+	struct serial_mux_port *port;
+	guint i;
+
+	if (!session)
+		return FALSE;
+	mux = g_hash_table_lookup(session->event_sources, &serial_mux_key);
+	if (!mux)
+		return FALSE;
+
+	for (i = 0; i < mux->ports->len; i++) {
+		port = g_ptr_array_index(mux->ports, i);
+		if (port->serial == serial && !port->removed)
+			break;
+	}
+	if (i == mux->ports->len)
+		return FALSE;
+
+	port->removed = TRUE;
+	if (mux->dispatching)
+		return TRUE;
+	serial_mux_purge(mux);
+	if (!mux->ports->len)
+		g_source_destroy(&mux->base);
+
+	return TRUE;
+}
+
 /** @private */
 SR_PRIV int serial_source_remove(struct sr_session *session,
 	struct sr_serial_dev_inst *serial)
@@ -1012,6 +1388,9 @@ SR_PRIV int serial_source_remove(struct sr_session *session,
 		return SR_ERR_ARG;
 	}
 
+	if (serial_mux_source_remove(session, serial))
+		return SR_OK;
+
 	if (!serial->lib_funcs || !serial->lib_funcs->setup_source_remove)
 		return SR_ERR_NA;
 
@@ -1057,11 +1436,231 @@ SR_API void sr_serial_free(struct sr_serial_port *serial)
 	g_free(serial);
 }
 
+/*
+ * Port lists of the enumerators (libserialport, HID, Bluetooth), which
+ * get kept across calls. Enumerators which need to run do so in
+ * threads of their own, concurrently, and a time budget limits how
+ * long callers wait for them. Results of late enumerators still get
+ * stored, for later calls.
+ *
+ * Device nodes come and go with the directory timestamps of /dev and
+ * of /dev/bus/usb/, which the libserialport and HID results get checked
+ * against (on Linux, elsewhere they don't persist). Bluetooth inquiry
+ * results expire after SERIAL_BT_CACHE_MS. While scans share the cache
+ * (see sr_serial_list_cache_begin()), results are not checked again.
+ */
+
+#define SERIAL_BT_CACHE_MS 60000
+
+enum {
+	PORT_LIST_LIBSP,
+	PORT_LIST_HID,
+	PORT_LIST_BT,
+	PORT_LIST_COUNT,
+};
+
+struct port_list {
+	gboolean valid;
+	gboolean running;
+	/* Changes when results get dropped, even while enumerating. */
+	unsigned int generation;
+	GSList *ports;
+	int64_t time_us;
+};
+
+static struct {
+	GMutex mutex;
+	GCond cond;
+	int users;
+	int timeout_ms;
+	uint64_t stamp;
+	struct port_list lists[PORT_LIST_COUNT];
+	GHashTable *usb_ports;
+} port_cache;
+
+static void free_port_names(void *data)
+{
+	g_slist_free_full(data, g_free);
+}
+
+static const struct ser_lib_functions *port_list_lib(int idx)
+{
+	switch (idx) {
+	case PORT_LIST_LIBSP:
+		return ser_lib_funcs_libsp;
+	case PORT_LIST_HID:
+		return ser_lib_funcs_hid;
+	case PORT_LIST_BT:
+		return ser_lib_funcs_bt;
+	}
+
+	return NULL;
+}
+
+#ifdef __linux__
+static uint64_t stamp_add(uint64_t stamp, const char *path)
+{
+	GStatBuf st;
+
+	if (g_stat(path, &st) != 0)
+		return stamp;
+	stamp ^= (uint64_t)st.st_mtim.tv_sec * G_GUINT64_CONSTANT(1000000007)
+		+ st.st_mtim.tv_nsec + st.st_ino;
+
+	return stamp * G_GUINT64_CONSTANT(0x100000001b3);
+}
+#endif
+
+/* A value which changes with the set of device nodes, 0 if unknown. */
+static uint64_t device_nodes_stamp(void)
+{
+#ifdef __linux__
+	GDir *dir;
+	const char *name;
+	char *path;
+	uint64_t stamp;
+
+	stamp = G_GUINT64_CONSTANT(0xcbf29ce484222325);
+	stamp = stamp_add(stamp, "/dev");
+	stamp = stamp_add(stamp, "/dev/bus/usb");
+	if ((dir = g_dir_open("/dev/bus/usb", 0, NULL))) {
+		while ((name = g_dir_read_name(dir))) {
+			path = g_build_filename("/dev/bus/usb", name, NULL);
+			stamp = stamp_add(stamp, path);
+			g_free(path);
+		}
+		g_dir_close(dir);
+	}
+
+	return stamp ? stamp : 1;
+#else
+	return 0;
+#endif
+}
+
+/* Drop outdated results. Called with the cache mutex held. */
+static void port_cache_validate(void)
+{
+	struct port_list *list;
+	uint64_t stamp;
+	int64_t now;
+	int i;
+
+	stamp = device_nodes_stamp();
+	now = g_get_monotonic_time();
+	for (i = 0; i < PORT_LIST_COUNT; i++) {
+		list = &port_cache.lists[i];
+		if (i == PORT_LIST_BT) {
+			if (now - list->time_us < SERIAL_BT_CACHE_MS * (int64_t)1000)
+				continue;
+		} else if (stamp && stamp == port_cache.stamp) {
+			continue;
+		}
+		list->valid = FALSE;
+		list->generation++;
+	}
+	if (port_cache.usb_ports && (!stamp || stamp != port_cache.stamp))
+		g_hash_table_remove_all(port_cache.usb_ports);
+	port_cache.stamp = stamp;
+}
+
+/**
+ * Share one list of serial ports, until the matching call to
+ * sr_serial_list_cache_end(). Calls can nest.
+ *
+ * @private
+ */
+SR_PRIV void sr_serial_list_cache_begin(void)
+{
+	g_mutex_lock(&port_cache.mutex);
+	if (!port_cache.users++)
+		port_cache_validate();
+	g_mutex_unlock(&port_cache.mutex);
+}
+
+/** @private */
+SR_PRIV void sr_serial_list_cache_end(void)
+{
+	g_mutex_lock(&port_cache.mutex);
+	if (port_cache.users)
+		port_cache.users--;
+	g_mutex_unlock(&port_cache.mutex);
+}
+
+/**
+ * Set the time budget of serial port enumeration.
+ *
+ * sr_serial_list() waits this long for enumerators (e.g. Bluetooth
+ * inquiry) which need to run. The results of late enumerators are
+ * missing from the list, they get kept for later calls though.
+ *
+ * @param timeout_ms The budget in milliseconds, 0 to wait for all
+ *                   enumerators (the default).
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_serial_list_set_timeout(int timeout_ms)
+{
+	g_mutex_lock(&port_cache.mutex);
+	port_cache.timeout_ms = MAX(timeout_ms, 0);
+	g_mutex_unlock(&port_cache.mutex);
+}
+
+/**
+ * Forget the kept results of serial port enumeration.
+ *
+ * The next sr_serial_list() call enumerates ports again, even when
+ * no device nodes changed (e.g. to repeat a Bluetooth inquiry).
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_serial_list_cache_clear(void)
+{
+	int i;
+
+	g_mutex_lock(&port_cache.mutex);
+	for (i = 0; i < PORT_LIST_COUNT; i++) {
+		port_cache.lists[i].valid = FALSE;
+		port_cache.lists[i].generation++;
+	}
+	if (port_cache.usb_ports)
+		g_hash_table_remove_all(port_cache.usb_ports);
+	g_mutex_unlock(&port_cache.mutex);
+}
+
 static GSList *append_port_list(GSList *devs, const char *name, const char *desc)
 {
 	return g_slist_append(devs, sr_serial_new(name, desc));
 }
 
+static gpointer port_list_thread(gpointer data)
+{
+	struct port_list *list;
+	GSList *ports;
+	unsigned int generation;
+	int idx;
+
+	idx = GPOINTER_TO_INT(data);
+	list = &port_cache.lists[idx];
+	g_mutex_lock(&port_cache.mutex);
+	generation = list->generation;
+	g_mutex_unlock(&port_cache.mutex);
+
+	ports = port_list_lib(idx)->list(NULL, append_port_list);
+
+	g_mutex_lock(&port_cache.mutex);
+	g_slist_free_full(list->ports, (GDestroyNotify)sr_serial_free);
+	list->ports = ports;
+	list->time_us = g_get_monotonic_time();
+	/* Devices which changed meanwhile need another run. */
+	list->valid = generation == list->generation;
+	list->running = FALSE;
+	g_cond_broadcast(&port_cache.cond);
+	g_mutex_unlock(&port_cache.mutex);
+
+	return NULL;
+}
+
 /**
  * List available serial devices.
  *
@@ -1071,27 +1670,73 @@ static GSList *append_port_list(GSList *devs, const char *name, const char *desc
  */
 SR_API GSList *sr_serial_list(const struct sr_dev_driver *driver)
 {
-	GSList *tty_devs;
-	GSList *(*list_func)(GSList *list, sr_ser_list_append_t append);
+	const struct ser_lib_functions *lib;
+	struct port_list *list;
+	struct sr_serial_port *port;
+	GSList *tty_devs, *l;
+	GThread *thread;
+	gboolean waiting[PORT_LIST_COUNT];
+	gboolean pending;
+	int64_t deadline;
+	int i;
 
 	/* Currently unused, but will be used by some drivers later on. */
 	(void)driver;
 
-	tty_devs = NULL;
-	if (ser_lib_funcs_libsp && ser_lib_funcs_libsp->list) {
-		list_func = ser_lib_funcs_libsp->list;
-		tty_devs = list_func(tty_devs, append_port_list);
+	g_mutex_lock(&port_cache.mutex);
+	if (!port_cache.users)
+		port_cache_validate();
+
+	/* Start the enumerators which need to run. */
+	for (i = 0; i < PORT_LIST_COUNT; i++) {
+		list = &port_cache.lists[i];
+		lib = port_list_lib(i);
+		waiting[i] = lib && lib->list && !list->valid;
+		if (!waiting[i] || list->running)
+			continue;
+		thread = g_thread_try_new("serial-list", port_list_thread,
+			GINT_TO_POINTER(i), NULL);
+		if (!thread) {
+			/* Enumerate in place. */
+			g_mutex_unlock(&port_cache.mutex);
+			port_list_thread(GINT_TO_POINTER(i));
+			g_mutex_lock(&port_cache.mutex);
+			continue;
+		}
+		list->running = TRUE;
+		g_thread_unref(thread);
 	}
-	if (ser_lib_funcs_hid && ser_lib_funcs_hid->list) {
-		list_func = ser_lib_funcs_hid->list;
-		tty_devs = list_func(tty_devs, append_port_list);
+
+	deadline = g_get_monotonic_time()
+		+ port_cache.timeout_ms * (int64_t)1000;
+	for (;;) {
+		pending = FALSE;
+		for (i = 0; i < PORT_LIST_COUNT; i++)
+			pending |= waiting[i] && port_cache.lists[i].running;
+		if (!pending)
+			break;
+		if (!port_cache.timeout_ms) {
+			g_cond_wait(&port_cache.cond, &port_cache.mutex);
+		} else if (!g_cond_wait_until(&port_cache.cond,
+				&port_cache.mutex, deadline)) {
+			sr_dbg("Serial port enumeration exceeds %d ms.",
+				port_cache.timeout_ms);
+			break;
+		}
 	}
-	if (ser_lib_funcs_bt && ser_lib_funcs_bt->list) {
-		list_func = ser_lib_funcs_bt->list;
-		tty_devs = list_func(tty_devs, append_port_list);
+
+	/* Late enumerators contribute their previous results, if any. */
+	tty_devs = NULL;
+	for (i = 0; i < PORT_LIST_COUNT; i++) {
+		for (l = port_cache.lists[i].ports; l; l = l->next) {
+			port = l->data;
+			tty_devs = g_slist_prepend(tty_devs,
+				sr_serial_new(port->name, port->description));
+		}
 	}
+	g_mutex_unlock(&port_cache.mutex);
 
-	return tty_devs;
+	return g_slist_reverse(tty_devs);
 }
 
 static GSList *append_port_find(GSList *devs, const char *name)
@@ -1102,19 +1747,7 @@ static GSList *append_port_find(GSList *devs, const char *name)
 	return g_slist_append(devs, g_strdup(name));
 }
 
-/**
- * Find USB serial devices via the USB vendor ID and product ID.
- *
- * @param[in] vendor_id Vendor ID of the USB device.
- * @param[in] product_id Product ID of the USB device.
- *
- * @return A GSList of strings containing the path of the serial device or
- *         NULL if no serial device is found. The returned list must be freed
- *         by the caller.
- *
- * @private
- */
-SR_PRIV GSList *sr_serial_find_usb(uint16_t vendor_id, uint16_t product_id)
+static GSList *find_usb_ports(uint16_t vendor_id, uint16_t product_id)
 {
 	GSList *tty_devs;
 	GSList *(*find_func)(GSList *list, sr_ser_find_append_t append,
@@ -1135,6 +1768,50 @@ SR_PRIV GSList *sr_serial_find_usb(uint16_t vendor_id, uint16_t product_id)
 	return tty_devs;
 }
 
+/**
+ * Find USB serial devices via the USB vendor ID and product ID.
+ *
+ * Results are kept like those of sr_serial_list().
+ *
+ * @param[in] vendor_id Vendor ID of the USB device.
+ * @param[in] product_id Product ID of the USB device.
+ *
+ * @return A GSList of strings containing the path of the serial device or
+ *         NULL if no serial device is found. The returned list must be freed
+ *         by the caller.
+ *
+ * @private
+ */
+SR_PRIV GSList *sr_serial_find_usb(uint16_t vendor_id, uint16_t product_id)
+{
+	GSList *tty_devs, *l;
+	gpointer key, names;
+
+	g_mutex_lock(&port_cache.mutex);
+	if (!port_cache.users)
+		port_cache_validate();
+	if (!port_cache.users && !port_cache.stamp) {
+		g_mutex_unlock(&port_cache.mutex);
+		return find_usb_ports(vendor_id, product_id);
+	}
+	if (!port_cache.usb_ports) {
+		port_cache.usb_ports = g_hash_table_new_full(g_direct_hash,
+			g_direct_equal, NULL, free_port_names);
+	}
+	key = GUINT_TO_POINTER(((guint)vendor_id << 16) | product_id);
+	if (!g_hash_table_lookup_extended(port_cache.usb_ports,
+			key, NULL, &names)) {
+		names = find_usb_ports(vendor_id, product_id);
+		g_hash_table_insert(port_cache.usb_ports, key, names);
+	}
+	tty_devs = NULL;
+	for (l = names; l; l = l->next)
+		tty_devs = g_slist_prepend(tty_devs, g_strdup(l->data));
+	g_mutex_unlock(&port_cache.mutex);
+
+	return g_slist_reverse(tty_devs);
+}
+
 /** @private */
 SR_PRIV int serial_timeout(struct sr_serial_dev_inst *port, int num_bytes)
 {
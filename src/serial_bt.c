@@ -32,6 +32,10 @@
 #define SER_BT_CONN_PREFIX	"bt"
 #define SER_BT_CHUNK_SIZE	1200
 
+/* Connection interval for BLE links, short enough for streaming meters. */
+#define SER_BT_CONN_INTERVAL_MIN_US	7500
+#define SER_BT_CONN_INTERVAL_MAX_US	15000
+
 /**
  * @file
  *
@@ -362,9 +366,6 @@ static int ser_bt_open(struct sr_serial_dev_inst *serial, int flags)
 	}
 	serial->bt_conn_type = conn_type;
 
-	/* Make sure the receive buffer can accept input data. */
-	if (!serial->rcv_buffer)
-		serial->rcv_buffer = g_string_sized_new(SER_BT_CHUNK_SIZE);
 	rc = sr_bt_config_cb_data(desc, ser_bt_data_cb, serial);
 	if (rc < 0)
 		return SR_ERR;
@@ -379,6 +380,8 @@ static int ser_bt_open(struct sr_serial_dev_inst *serial, int flags)
 	case SER_BT_CONN_BLE122:
 	case SER_BT_CONN_NRF51:
 	case SER_BT_CONN_CC254x:
+		sr_bt_config_conn_interval(desc, SER_BT_CONN_INTERVAL_MIN_US,
+			SER_BT_CONN_INTERVAL_MAX_US);
 		rc = sr_bt_connect_ble(desc);
 		if (rc < 0)
 			return SR_ERR;
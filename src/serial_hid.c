@@ -428,6 +428,36 @@ struct hidapi_source_args_t {
 	struct sr_serial_dev_inst *serial;
 };
 
+/*
+ * Collect the RX data of all pending reports, up to the buffer's size.
+ * Only the first report gets waited for, subsequent reads don't block.
+ * Returns the number of RX bytes, or a negative value upon errors when
+ * no data was received.
+ */
+static int ser_hid_read_batch(struct sr_serial_dev_inst *serial,
+	uint8_t *buf, size_t size, unsigned int timeout_ms)
+{
+	const struct ser_hid_chip_functions *funcs;
+	size_t got;
+	int rc;
+
+	funcs = serial->hid_chip_funcs;
+	got = 0;
+	while (size - got >= (size_t)funcs->max_bytes_per_request) {
+		rc = funcs->read_bytes(serial, &buf[got], size - got,
+			got ? 0 : timeout_ms);
+		if (rc < 0)
+			return got ? (int)got : rc;
+		if (!rc)
+			break;
+		got += rc;
+	}
+	if (got)
+		ser_hid_mask_databits(serial, buf, got);
+
+	return got;
+}
+
 /*
  * Gets periodically invoked by the glib main loop. "Drives" (checks)
  * progress of USB communication, and invokes the application's callback
@@ -437,7 +467,7 @@ struct hidapi_source_args_t {
 static int hidapi_source_cb(int fd, int revents, void *cb_data)
 {
 	struct hidapi_source_args_t *args;
-	uint8_t rx_buf[SER_HID_CHUNK_SIZE];
+	uint8_t rx_buf[SER_HID_BATCH_SIZE];
 	int rc;
 
 	args = cb_data;
@@ -449,13 +479,10 @@ static int hidapi_source_cb(int fd, int revents, void *cb_data)
 	 * application is expecting.
 	 */
 	do {
-		rc = args->serial->hid_chip_funcs->read_bytes(args->serial,
-				rx_buf, sizeof(rx_buf), 0);
-		if (rc > 0) {
-			ser_hid_mask_databits(args->serial, rx_buf, rc);
+		rc = ser_hid_read_batch(args->serial, rx_buf, sizeof(rx_buf), 0);
+		if (rc > 0)
 			sr_ser_queue_rx_data(args->serial, rx_buf, rc);
-		}
-	} while (rc > 0);
+	} while (rc == sizeof(rx_buf));
 
 	/*
 	 * When RX data became available (now or earlier), pass this
@@ -1132,9 +1159,6 @@ static int ser_hid_open(struct sr_serial_dev_inst *serial, int flags)
 		return SR_ERR_IO;
 	}
 
-	if (!serial->rcv_buffer)
-		serial->rcv_buffer = g_string_sized_new(SER_HID_CHUNK_SIZE);
-
 	return SR_OK;
 }
 
@@ -1249,7 +1273,7 @@ static int ser_hid_read(struct sr_serial_dev_inst *serial,
 	int nonblocking, unsigned int timeout_ms)
 {
 	gint64 deadline_us, now_us;
-	uint8_t buffer[SER_HID_CHUNK_SIZE];
+	uint8_t buffer[SER_HID_BATCH_SIZE];
 	int rc;
 	unsigned int got;
 
@@ -1306,27 +1330,21 @@ static int ser_hid_read(struct sr_serial_dev_inst *serial,
 
 		/*
 		 * Check the HID transport for the availability of more
-		 * receive data.
+		 * receive data. Grab the data of all pending reports.
 		 */
-		rc = serial->hid_chip_funcs->read_bytes(serial,
-				buffer, sizeof(buffer), timeout_ms);
+		rc = ser_hid_read_batch(serial, buffer, sizeof(buffer),
+			timeout_ms);
 		if (rc < 0) {
 			sr_dbg("DBG: %s() read error %d.", __func__, rc);
 			return SR_ERR;
 		}
-		if (rc) {
-			ser_hid_mask_databits(serial, buffer, rc);
+		if (rc)
 			sr_ser_queue_rx_data(serial, buffer, rc);
-		}
 		got = sr_ser_has_queued_data(serial);
 
 		/*
 		 * Stop reading when the requested amount is available,
 		 * or when the timeout has expired.
-		 *
-		 * TODO Consider whether grabbing all RX data is more
-		 * desirable. Implementing this approach requires a cheap
-		 * check for the availability of more data on the USB level.
 		 */
 		if (got >= count)
 			break;
@@ -38,6 +38,12 @@
  */
 #define SER_HID_CHUNK_SIZE	64
 
+/*
+ * The amount of RX data which gets collected from pending reports in
+ * a single read attempt, see ser_hid_read_batch().
+ */
+#define SER_HID_BATCH_SIZE	1024
+
 /*
  * Routines to get/set reports/data, provided by serial_hid.c and used
  * in serial_hid_<chip>.c files.
@@ -108,14 +108,14 @@ static int ch9325_read_bytes(struct sr_serial_dev_inst *serial,
 		return SR_ERR;
 	if (rc == 0)
 		return 0;
-	sr_dbg("DBG: %s() got report len %d, 0x%02x.", __func__, rc, buffer[0]);
+	sr_spew("%s() got report len %d, 0x%02x.", __func__, rc, buffer[0]);
 
 	/* Check the length spec, get the byte count. */
 	count = buffer[0];
 	if ((count & 0xf0) != 0xf0)
 		return SR_ERR;
 	count &= 0x0f;
-	sr_dbg("DBG: %s(), got %d UART RX bytes.", __func__, count);
+	sr_spew("%s(), got %d UART RX bytes.", __func__, count);
 	if (count > space)
 		return SR_ERR;
 
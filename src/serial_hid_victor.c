@@ -92,7 +92,7 @@ static int victor_unobfuscate(uint8_t *rx_buf, size_t rx_len,
 	int is_zero;
 	size_t idx, to_idx;
 
-	if (sr_log_loglevel_get() >= SR_LOG_SPEW) {
+	if (sr_log_enabled(SR_LOG_SPEW)) {
 		txt = sr_hexdump_new(rx_buf, rx_len);
 		sr_spew("Received %zu bytes: %s.", rx_len, txt->str);
 		sr_hexdump_free(txt);
@@ -124,7 +124,7 @@ static int victor_unobfuscate(uint8_t *rx_buf, size_t rx_len,
 		ret_buf[to_idx] = bit_reverse(rx_buf[idx] - obfuscation[idx]);
 	}
 
-	if (sr_log_loglevel_get() >= SR_LOG_SPEW) {
+	if (sr_log_enabled(SR_LOG_SPEW)) {
 		txt = sr_hexdump_new(ret_buf, idx);
 		sr_spew("Deobfuscated: %s.", txt->str);
 		sr_hexdump_free(txt);
@@ -402,6 +402,15 @@ static int sr_ser_libsp_source_add(struct sr_session *session,
 		timeout, cb, cb_data);
 }
 
+static int sr_ser_libsp_get_pollfd(struct sr_serial_dev_inst *serial,
+	int events, gintptr *fd, unsigned int *poll_events)
+{
+	void *key;
+
+	return sr_ser_libsp_source_add_int(serial, events,
+		&key, fd, poll_events);
+}
+
 static int sr_ser_libsp_source_remove(struct sr_session *session,
 	struct sr_serial_dev_inst *serial)
 {
@@ -532,6 +541,7 @@ static struct ser_lib_functions serlib_sp = {
 	.find_usb = sr_ser_libsp_find_usb,
 	.get_frame_format = sr_ser_libsp_get_frame_format,
 	.get_rx_avail = sr_ser_libsp_get_rx_avail,
+	.get_pollfd = sr_ser_libsp_get_pollfd,
 };
 SR_PRIV struct ser_lib_functions *ser_lib_funcs_libsp = &serlib_sp;
 
@@ -0,0 +1,257 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "serial-replay"
+
+#ifdef HAVE_SERIAL_COMM
+
+#define SER_REPLAY_CONN_PREFIX	"replay/"
+
+/**
+ * @file
+ *
+ * Serial port replay of recorded traffic, see traffic.c.
+ */
+
+/**
+ * @defgroup grp_serial_replay Serial port handling, replay group
+ *
+ * Plays back data which was recorded from a serial port, to run drivers
+ * without the device. The port name is "replay/<file>". The recording
+ * repeats endlessly, and is received as fast as the driver reads it.
+ * Data which the driver sends gets discarded, communication parameters
+ * are ignored.
+ *
+ * @{
+ */
+
+struct ser_replay {
+	GBytes *data;
+	size_t pos;
+	/* The application's receive callback. */
+	sr_receive_data_callback cb;
+	void *cb_data;
+};
+
+SR_PRIV int ser_name_is_replay(struct sr_serial_dev_inst *serial)
+{
+	if (!serial || !serial->port)
+		return 0;
+
+	return g_str_has_prefix(serial->port, SER_REPLAY_CONN_PREFIX);
+}
+
+static int ser_replay_open(struct sr_serial_dev_inst *serial, int flags)
+{
+	struct ser_replay *replay;
+	GBytes *data;
+	int ret;
+
+	(void)flags;
+
+	ret = sr_traffic_load(serial->port + strlen(SER_REPLAY_CONN_PREFIX),
+		SR_TRAFFIC_SERIAL_RX, &data);
+	if (ret != SR_OK)
+		return ret;
+	if (!g_bytes_get_size(data)) {
+		sr_err("No serial data in the recording.");
+		g_bytes_unref(data);
+		return SR_ERR_DATA;
+	}
+
+	replay = g_malloc0(sizeof(*replay));
+	replay->data = data;
+	serial->replay = replay;
+
+	return SR_OK;
+}
+
+static int ser_replay_close(struct sr_serial_dev_inst *serial)
+{
+	if (!serial->replay)
+		return SR_ERR_ARG;
+
+	g_bytes_unref(serial->replay->data);
+	g_free(serial->replay);
+	serial->replay = NULL;
+
+	return SR_OK;
+}
+
+static int ser_replay_flush(struct sr_serial_dev_inst *serial)
+{
+	(void)serial;
+
+	return SR_OK;
+}
+
+static int ser_replay_drain(struct sr_serial_dev_inst *serial)
+{
+	(void)serial;
+
+	return SR_OK;
+}
+
+static int ser_replay_write(struct sr_serial_dev_inst *serial,
+	const void *buf, size_t count,
+	int nonblocking, unsigned int timeout_ms)
+{
+	(void)serial;
+	(void)buf;
+	(void)nonblocking;
+	(void)timeout_ms;
+
+	return count;
+}
+
+/*
+ * Non-blocking reads return the data up to the end of the recording,
+ * blocking reads wrap around and always return the requested amount.
+ */
+static int ser_replay_read(struct sr_serial_dev_inst *serial,
+	void *buf, size_t count,
+	int nonblocking, unsigned int timeout_ms)
+{
+	struct ser_replay *replay;
+	const uint8_t *data;
+	size_t size, got, len;
+
+	(void)timeout_ms;
+
+	replay = serial->replay;
+	if (!replay)
+		return SR_ERR_ARG;
+	data = g_bytes_get_data(replay->data, &size);
+
+	got = 0;
+	while (got < count) {
+		if (replay->pos == size)
+			replay->pos = 0;
+		len = MIN(count - got, size - replay->pos);
+		memcpy((uint8_t *)buf + got, &data[replay->pos], len);
+		replay->pos += len;
+		got += len;
+		if (nonblocking)
+			break;
+	}
+
+	return got;
+}
+
+static int ser_replay_set_params(struct sr_serial_dev_inst *serial,
+	int baudrate, int bits, int parity, int stopbits,
+	int flowcontrol, int rts, int dtr)
+{
+	(void)serial;
+	(void)baudrate;
+	(void)bits;
+	(void)parity;
+	(void)stopbits;
+	(void)flowcontrol;
+	(void)rts;
+	(void)dtr;
+
+	return SR_OK;
+}
+
+static int ser_replay_set_handshake(struct sr_serial_dev_inst *serial,
+	int rts, int dtr)
+{
+	(void)serial;
+	(void)rts;
+	(void)dtr;
+
+	return SR_OK;
+}
+
+/* Receive data is always available, run the application's callback. */
+static int ser_replay_source_cb(int fd, int revents, void *cb_data)
+{
+	struct ser_replay *replay;
+
+	(void)revents;
+
+	replay = cb_data;
+
+	return replay->cb(fd, G_IO_IN, replay->cb_data);
+}
+
+static int ser_replay_setup_source_add(struct sr_session *session,
+	struct sr_serial_dev_inst *serial,
+	int events, int timeout,
+	sr_receive_data_callback cb, void *cb_data)
+{
+	struct ser_replay *replay;
+
+	(void)timeout;
+
+	replay = serial->replay;
+	if (!replay)
+		return SR_ERR_ARG;
+	replay->cb = cb;
+	replay->cb_data = cb_data;
+
+	/* Run on each main loop iteration, don't wait for a timeout. */
+	return sr_session_fd_source_add(session, replay, -1, events, 0,
+		ser_replay_source_cb, replay);
+}
+
+static int ser_replay_setup_source_remove(struct sr_session *session,
+	struct sr_serial_dev_inst *serial)
+{
+	return sr_session_source_remove_internal(session, serial->replay);
+}
+
+static size_t ser_replay_get_rx_avail(struct sr_serial_dev_inst *serial)
+{
+	struct ser_replay *replay;
+	size_t size;
+
+	replay = serial->replay;
+	if (!replay)
+		return 0;
+	size = g_bytes_get_size(replay->data);
+
+	return replay->pos < size ? size - replay->pos : size;
+}
+
+static struct ser_lib_functions serlib_replay = {
+	.open = ser_replay_open,
+	.close = ser_replay_close,
+	.flush = ser_replay_flush,
+	.drain = ser_replay_drain,
+	.write = ser_replay_write,
+	.read = ser_replay_read,
+	.set_params = ser_replay_set_params,
+	.set_handshake = ser_replay_set_handshake,
+	.setup_source_add = ser_replay_setup_source_add,
+	.setup_source_remove = ser_replay_setup_source_remove,
+	.get_rx_avail = ser_replay_get_rx_avail,
+};
+SR_PRIV struct ser_lib_functions *ser_lib_funcs_replay = &serlib_replay;
+
+/** @} */
+
+#endif
@@ -46,6 +46,9 @@
  * @{
  */
 
+/* Default packet queue capacity of the threaded session mode. */
+#define SESSION_QUEUE_DEPTH 1024
+
 struct datafeed_callback {
 	sr_datafeed_callback cb;
 	void *cb_data;
@@ -67,6 +70,44 @@ struct fd_source {
 	GPollFD pollfd;
 };
 
+/* Sample counters of an analog channel, or a device's logic data. */
+struct channel_stats {
+	uint64_t samples;
+	uint64_t bytes;
+};
+
+/* Sample counters of a device, for the positions of its packets. */
+struct device_position {
+	uint64_t logic_samples;
+	/* Sample counters of the analog channels, keyed by channel. */
+	GHashTable *analog_samples;
+	uint64_t analog_max;
+	uint64_t samplerate;
+	struct timeval starttime;
+	int64_t trigger_index;
+	uint64_t frame;
+};
+
+static void device_position_free(struct device_position *dp)
+{
+	g_hash_table_unref(dp->analog_samples);
+	g_free(dp);
+}
+
+struct session_ring;
+static void transform_buffers_free(struct sr_transform_buffers *buffers);
+static void scratch_free(struct sr_session *session);
+static int session_ring_start(struct sr_session *session);
+static void session_ring_stop(struct sr_session *session);
+static int session_ring_push(struct session_ring *ring,
+		const struct sr_dev_inst *sdi, struct sr_datafeed_packet *packet);
+static guint session_ring_fill(struct session_ring *ring);
+static void session_stats_reset(struct sr_session *session);
+static void session_disarm(struct sr_session *session);
+static void coalesce_start(struct sr_session *session);
+static void coalesce_flush(struct sr_session *session);
+static void coalesce_free(struct sr_session *session);
+
 /** FD event source prepare() method.
  * This is called immediately before poll().
  */
@@ -118,6 +159,7 @@ static gboolean fd_source_dispatch(GSource *source,
 	struct fd_source *fsource;
 	unsigned int revents;
 	gboolean keep;
+	int tag;
 
 	fsource = (struct fd_source *)source;
 	revents = fsource->pollfd.revents;
@@ -126,8 +168,11 @@ static gboolean fd_source_dispatch(GSource *source,
 		sr_err("Callback not set, cannot dispatch event.");
 		return G_SOURCE_REMOVE;
 	}
+	/* Event sources are the drivers' data paths. */
+	tag = sr_mem_tag_enter(SR_MEM_DRIVER);
 	keep = (*SR_RECEIVE_DATA_CALLBACK(callback))
 			(fsource->pollfd.fd, revents, user_data);
+	sr_mem_tag_leave(tag);
 
 	if (fsource->timeout_us >= 0 && G_LIKELY(keep)
 			&& G_LIKELY(!g_source_is_destroyed(source)))
@@ -225,6 +270,14 @@ SR_API int sr_session_new(struct sr_context *ctx,
 	session->ctx = ctx;
 
 	g_mutex_init(&session->main_mutex);
+	g_mutex_init(&session->stats_mutex);
+	session->channel_stats = g_hash_table_new_full(NULL, NULL,
+		NULL, g_free);
+	session->positions = g_hash_table_new_full(NULL, NULL,
+		NULL, (GDestroyNotify)device_position_free);
+	g_mutex_init(&session->meta_mutex);
+	session->meta_values = g_hash_table_new_full(NULL, NULL,
+		NULL, (GDestroyNotify)g_variant_unref);
 
 	/* To maintain API compatibility, we need a lookup table
 	 * which maps poll_object IDs to GSource* pointers.
@@ -259,10 +312,22 @@ SR_API int sr_session_destroy(struct sr_session *session)
 
 	sr_session_datafeed_callback_remove_all(session);
 
+	session_disarm(session);
 	g_hash_table_unref(session->event_sources);
 
 	g_mutex_clear(&session->main_mutex);
-
+	g_hash_table_unref(session->channel_stats);
+	g_hash_table_unref(session->positions);
+	g_mutex_clear(&session->stats_mutex);
+	g_hash_table_unref(session->meta_values);
+	g_mutex_clear(&session->meta_mutex);
+
+	coalesce_free(session);
+	g_free(session->batch_buffer);
+	scratch_free(session);
+	sr_mem_free_add(SR_MEM_SESSION, session->rle_size);
+	g_free(session->rle_buffer);
+	transform_buffers_free(&session->transform_buffers);
 	g_free(session);
 
 	return SR_OK;
@@ -540,6 +605,7 @@ SR_API int sr_session_trigger_set(struct sr_session *session, struct sr_trigger
 		return SR_ERR_ARG;
 
 	session->trigger = trig;
+	session->verified_trigger = NULL;
 
 	return SR_OK;
 }
@@ -620,6 +686,14 @@ static int set_main_context(struct sr_session *session)
 	}
 	session->main_context = main_context;
 
+	/* The previous poll function gets restored when the session stops. */
+	session->prev_poll_func = NULL;
+	if (session->poll_backend != SR_SESSION_POLL_GLIB) {
+		session->prev_poll_func = g_main_context_get_poll_func(main_context);
+		g_main_context_set_poll_func(main_context,
+			sr_session_poll_func(session->poll_backend));
+	}
+
 	g_mutex_unlock(&session->main_mutex);
 
 	return SR_OK;
@@ -640,6 +714,10 @@ static int unset_main_context(struct sr_session *session)
 	g_mutex_lock(&session->main_mutex);
 
 	if (session->main_context) {
+		if (session->prev_poll_func)
+			g_main_context_set_poll_func(session->main_context,
+				session->prev_poll_func);
+		session->prev_poll_func = NULL;
 		g_main_context_unref(session->main_context);
 		session->main_context = NULL;
 		ret = SR_OK;
@@ -654,6 +732,16 @@ static int unset_main_context(struct sr_session *session)
 	return ret;
 }
 
+/*
+ * Release the main context which a stopped, re-armed session kept from
+ * its last run.
+ */
+static void session_disarm(struct sr_session *session)
+{
+	if (!session->running && session->main_context)
+		unset_main_context(session);
+}
+
 static unsigned int session_source_attach(struct sr_session *session,
 		GSource *source)
 {
@@ -661,10 +749,16 @@ static unsigned int session_source_attach(struct sr_session *session,
 
 	g_mutex_lock(&session->main_mutex);
 
-	if (session->main_context)
+	/*
+	 * GLib only wakes up a context which a thread owns, but external
+	 * loops wait without owning it (see sr_session_poll_prepare()).
+	 */
+	if (session->main_context) {
 		id = g_source_attach(source, session->main_context);
-	else
+		g_main_context_wakeup(session->main_context);
+	} else {
 		sr_err("Cannot add event source without main context.");
+	}
 
 	g_mutex_unlock(&session->main_mutex);
 
@@ -690,7 +784,13 @@ static gboolean delayed_stop_check(void *data)
 		return G_SOURCE_REMOVE;
 
 	session->running = FALSE;
-	unset_main_context(session);
+	session_ring_stop(session);
+	/* Streams which ended without SR_DF_END may have left samples. */
+	coalesce_flush(session);
+	sr_session_sched_restore(session);
+	/* Re-armed sessions keep the main context for the next run. */
+	if (!session->rearm)
+		unset_main_context(session);
 
 	sr_info("Stopped.");
 
@@ -773,10 +873,12 @@ SR_API int sr_session_start(struct sr_session *session)
 		return SR_ERR;
 	}
 
-	if (session->trigger) {
+	if (session->trigger && session->trigger != session->verified_trigger) {
 		ret = verify_trigger(session->trigger);
 		if (ret != SR_OK)
 			return ret;
+		if (session->rearm)
+			session->verified_trigger = session->trigger;
 	}
 
 	/* Check enabled channels and commit settings of all devices. */
@@ -793,6 +895,8 @@ SR_API int sr_session_start(struct sr_session *session)
 			return SR_ERR;
 		}
 
+		if (session->rearm && sdi->config_committed)
+			continue;
 		ret = sr_config_commit(sdi);
 		if (ret != SR_OK) {
 			sr_err("Failed to commit %s device %s settings "
@@ -802,9 +906,22 @@ SR_API int sr_session_start(struct sr_session *session)
 		}
 	}
 
-	ret = set_main_context(session);
-	if (ret != SR_OK)
+	/* A re-armed session still has the main context of its last run. */
+	if (!session->rearm || !session->main_context) {
+		ret = set_main_context(session);
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	session_stats_reset(session);
+	ret = session_ring_start(session);
+	if (ret != SR_OK) {
+		unset_main_context(session);
 		return ret;
+	}
+	coalesce_start(session);
+	/* Consumer threads exist by now, and keep their own scheduling. */
+	sr_session_sched_apply(session);
 
 	sr_info("Starting.");
 
@@ -837,6 +954,8 @@ SR_API int sr_session_start(struct sr_session *session)
 		 * sources... */
 		session->running = FALSE;
 
+		session_ring_stop(session);
+		sr_session_sched_restore(session);
 		unset_main_context(session);
 		return ret;
 	}
@@ -855,7 +974,9 @@ SR_API int sr_session_start(struct sr_session *session)
  *
  * Instead of using this function, applications may run their own GLib main
  * loop, and use sr_session_stopped_callback_set() to receive notification
- * when the session finished running.
+ * when the session finished running. Applications with an event loop of
+ * another kind drive the session with sr_session_poll_prepare() and
+ * sr_session_poll_dispatch().
  *
  * @param session The session to use. Must not be NULL.
  *
@@ -899,6 +1020,135 @@ SR_API int sr_session_run(struct sr_session *session)
 	return SR_OK;
 }
 
+/* Acquire the session's main context for one step of an external loop. */
+static GMainContext *poll_context_acquire(struct sr_session *session)
+{
+	GMainContext *main_context;
+
+	g_mutex_lock(&session->main_mutex);
+
+	main_context = (session->main_context)
+		? g_main_context_ref(session->main_context)
+		: NULL;
+
+	g_mutex_unlock(&session->main_mutex);
+
+	if (!main_context) {
+		sr_err("No main context set; session not started?");
+		return NULL;
+	}
+	if (!g_main_context_acquire(main_context)) {
+		sr_err("Main context is owned by another thread.");
+		g_main_context_unref(main_context);
+		return NULL;
+	}
+
+	return main_context;
+}
+
+static void poll_context_release(GMainContext *main_context)
+{
+	g_main_context_release(main_context);
+	g_main_context_unref(main_context);
+}
+
+/**
+ * Get the descriptors and the timeout an external event loop has to
+ * wait for, before calling sr_session_poll_dispatch().
+ *
+ * Instead of sr_session_run(), applications with their own event loop
+ * may drive a started session with these two functions, one step at a
+ * time: prepare, wait until one of the descriptors has events or the
+ * timeout expired, then dispatch. The descriptors include the wakeup
+ * of the session's main context, which gets signalled when e.g.
+ * sr_session_stop() is called from another thread.
+ *
+ * The steps of one session must not overlap, but subsequent steps may
+ * run in different threads, so that many sessions can share a pool of
+ * threads. The poll backend of the session does not apply here, the
+ * application does the waiting.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param fds Array which receives the descriptors. May be NULL if
+ *            *n_fds is 0.
+ * @param n_fds On entry the size of the fds array, on return the number
+ *              of descriptors to wait for. If that is more than the
+ *              array holds, only the array's size got filled in, and
+ *              the caller should call again with a larger array.
+ * @param timeout_ms Receives the timeout in milliseconds, 0 if events
+ *                   are pending already, or -1 for no timeout.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The session was not started, or its main context is in
+ *                use by another thread.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_poll_prepare(struct sr_session *session,
+		GPollFD *fds, int *n_fds, int *timeout_ms)
+{
+	GMainContext *main_context;
+	int priority, count;
+
+	if (!session || !n_fds || *n_fds < 0 || (!fds && *n_fds)
+			|| !timeout_ms) {
+		sr_err("%s: invalid argument", __func__);
+		return SR_ERR_ARG;
+	}
+	if (!(main_context = poll_context_acquire(session)))
+		return SR_ERR;
+
+	g_main_context_prepare(main_context, &priority);
+	count = g_main_context_query(main_context, priority, timeout_ms,
+		fds, *n_fds);
+	session->poll_priority = priority;
+	*n_fds = count;
+
+	poll_context_release(main_context);
+
+	return SR_OK;
+}
+
+/**
+ * Dispatch the session events which the descriptors from the last
+ * sr_session_poll_prepare() report, and those whose timeout expired.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param fds The array from sr_session_poll_prepare(), with the revents
+ *            fields filled in by the external loop.
+ * @param n_fds The number of descriptors which sr_session_poll_prepare()
+ *              returned.
+ *
+ * @retval SR_OK Success. Use sr_session_is_running() to find out whether
+ *               the session still runs.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The session was not started, or its main context is in
+ *                use by another thread.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_poll_dispatch(struct sr_session *session,
+		GPollFD *fds, int n_fds)
+{
+	GMainContext *main_context;
+
+	if (!session || n_fds < 0 || (!fds && n_fds)) {
+		sr_err("%s: invalid argument", __func__);
+		return SR_ERR_ARG;
+	}
+	if (!(main_context = poll_context_acquire(session)))
+		return SR_ERR;
+
+	if (g_main_context_check(main_context, session->poll_priority,
+			fds, n_fds))
+		g_main_context_dispatch(main_context);
+
+	poll_context_release(main_context);
+
+	return SR_OK;
+}
+
 static gboolean session_stop_sync(void *user_data)
 {
 	struct sr_session *session;
@@ -971,6 +1221,53 @@ SR_API int sr_session_stop(struct sr_session *session)
 	return SR_OK;
 }
 
+/**
+ * Request a session to stop, without waiting for the devices.
+ *
+ * Unlike sr_session_stop(), which stops the devices right away when the
+ * caller can acquire the session's main context, this always leaves the
+ * stop to the next iteration of the session's event loop, and returns
+ * immediately. That is what event loop callbacks and threads which must
+ * not block on a driver want.
+ *
+ * If the session is not running, this silently does nothing.
+ *
+ * @param session The session to use. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_stop_async(struct sr_session *session)
+{
+	GSource *source;
+
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	source = g_idle_source_new();
+	g_source_set_priority(source, G_PRIORITY_DEFAULT);
+	g_source_set_callback(source, &session_stop_sync, session, NULL);
+
+	g_mutex_lock(&session->main_mutex);
+
+	if (session->main_context) {
+		g_source_attach(source, session->main_context);
+		g_main_context_wakeup(session->main_context);
+	} else {
+		sr_dbg("No main context set; already stopped?");
+	}
+
+	g_mutex_unlock(&session->main_mutex);
+
+	g_source_unref(source);
+
+	return SR_OK;
+}
+
 /**
  * Return whether the session is currently running.
  *
@@ -1027,169 +1324,2345 @@ SR_API int sr_session_stopped_callback_set(struct sr_session *session,
 }
 
 /**
- * Debug helper.
+ * Enable or disable the threaded session mode.
  *
- * @param packet The packet to show debugging information for.
+ * In threaded mode, packets which get sent by devices are queued, and
+ * a separate consumer thread runs transforms and datafeed callbacks. The
+ * thread which runs the session (see sr_session_start()) then only
+ * handles device I/O, so that slow datafeed consumers do not delay the
+ * acquisition. Datafeed callbacks get invoked from the consumer thread,
+ * and the queue gets drained before the session is reported as stopped.
+ *
+ * When the queue is full, the acquisition either waits for the consumer
+ * (the default), or drops logic and analog packets if drop_on_overflow
+ * is set. Other packet types are never dropped.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param threaded TRUE to enable the threaded mode.
+ * @param queue_depth Queue capacity in packets. Gets rounded up to the
+ *                    next power of two, 0 selects a default.
+ * @param drop_on_overflow TRUE to drop data instead of waiting for room.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
  */
-static void datafeed_dump(const struct sr_datafeed_packet *packet)
+SR_API int sr_session_threaded_set(struct sr_session *session,
+		gboolean threaded, uint32_t queue_depth,
+		gboolean drop_on_overflow)
 {
-	const struct sr_datafeed_logic *logic;
-	const struct sr_datafeed_analog *analog;
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
 
-	/* Please use the same order as in libsigrok.h. */
-	switch (packet->type) {
-	case SR_DF_HEADER:
-		sr_dbg("bus: Received SR_DF_HEADER packet.");
-		break;
-	case SR_DF_END:
-		sr_dbg("bus: Received SR_DF_END packet.");
-		break;
-	case SR_DF_META:
-		sr_dbg("bus: Received SR_DF_META packet.");
-		break;
-	case SR_DF_TRIGGER:
-		sr_dbg("bus: Received SR_DF_TRIGGER packet.");
-		break;
-	case SR_DF_LOGIC:
-		logic = packet->payload;
-		sr_dbg("bus: Received SR_DF_LOGIC packet (%" PRIu64 " bytes, "
-		       "unitsize = %d).", logic->length, logic->unitsize);
-		break;
-	case SR_DF_FRAME_BEGIN:
-		sr_dbg("bus: Received SR_DF_FRAME_BEGIN packet.");
-		break;
-	case SR_DF_FRAME_END:
-		sr_dbg("bus: Received SR_DF_FRAME_END packet.");
-		break;
-	case SR_DF_ANALOG:
-		analog = packet->payload;
-		sr_dbg("bus: Received SR_DF_ANALOG packet (%d samples).",
-		       analog->num_samples);
-		break;
-	default:
-		sr_dbg("bus: Received unknown packet type: %d.", packet->type);
-		break;
+	if (session->running) {
+		sr_err("Cannot change the threaded mode of a running session.");
+		return SR_ERR;
 	}
+
+	session->threaded = threaded;
+	session->queue_depth = queue_depth ? queue_depth : SESSION_QUEUE_DEPTH;
+	session->drop_on_overflow = drop_on_overflow;
+
+	return SR_OK;
 }
 
 /**
- * Helper to send a meta datafeed package (SR_DF_META) to the session bus.
+ * Get packet queue statistics of a threaded session.
  *
- * @param sdi The device instance to send the package from. Must not be NULL.
- * @param key The config key to send to the session bus.
- * @param var The value to send to the session bus.
+ * The statistics cover the current (or most recent) session run, and
+ * are all zero when the threaded mode was not used. This may be called
+ * from any thread, also while the session is running.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param stats Receives the statistics. Must not be NULL.
  *
  * @retval SR_OK Success.
  * @retval SR_ERR_ARG Invalid argument.
  *
- * @private
+ * @since 0.6.0
  */
-SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
-		uint32_t key, GVariant *var)
+SR_API int sr_session_queue_stats_get(struct sr_session *session,
+		struct sr_session_queue_stats *stats)
 {
-	struct sr_config *cfg;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_meta meta;
-	int ret;
+	if (!session || !stats)
+		return SR_ERR_ARG;
 
-	cfg = sr_config_new(key, var);
+	g_mutex_lock(&session->stats_mutex);
+	*stats = session->queue_stats;
+	g_mutex_unlock(&session->stats_mutex);
 
-	memset(&meta, 0, sizeof(meta));
+	return SR_OK;
+}
 
-	packet.type = SR_DF_META;
-	packet.payload = &meta;
+/**
+ * Get throughput and latency statistics of a session.
+ *
+ * The statistics cover the current (or most recent) session run. This
+ * may be called from any thread, also while the session is running.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param stats Receives the statistics. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_stats_get(struct sr_session *session,
+		struct sr_session_stats *stats)
+{
+	struct session_ring *ring;
+	int64_t end_us;
 
-	meta.config = g_slist_append(NULL, cfg);
+	if (!session || !stats)
+		return SR_ERR_ARG;
 
-	ret = sr_session_send(sdi, &packet);
-	g_slist_free(meta.config);
-	sr_config_free(cfg);
+	g_mutex_lock(&session->stats_mutex);
+	*stats = session->stats;
+	end_us = session->stats_last_us;
+	if (session->running)
+		end_us = g_get_monotonic_time();
+	if (session->stats_start_us && end_us > session->stats_start_us)
+		stats->elapsed_us = end_us - session->stats_start_us;
+	stats->packets_dropped = session->queue_stats.packets_dropped;
+	stats->queue_capacity = session->queue_stats.capacity;
+	if ((ring = session->ring))
+		stats->queue_fill = session_ring_fill(ring);
+	stats->sched_cpu_mask = session->sched_applied.cpu_mask;
+	stats->sched_policy = session->sched_applied.policy;
+	stats->sched_priority = session->sched_applied.priority;
+	stats->memory_locked = session->sched_applied.lock_memory;
+	g_mutex_unlock(&session->stats_mutex);
 
-	return ret;
+	return SR_OK;
 }
 
 /**
- * Send a packet to whatever is listening on the datafeed bus.
+ * Get the sample counters of a channel.
  *
- * Hardware drivers use this to send a data packet to the frontend.
+ * Analog channels count their own samples. Logic channels share the
+ * counters of their device's logic data, since each logic sample
+ * covers all of them.
  *
- * @param sdi TODO.
- * @param packet The datafeed packet to send to the session bus.
+ * @param session The session to use. Must not be NULL.
+ * @param ch The channel. Must not be NULL.
+ * @param samples Receives the number of samples. Can be NULL.
+ * @param bytes Receives the size of the samples in bytes. Can be NULL.
  *
  * @retval SR_OK Success.
  * @retval SR_ERR_ARG Invalid argument.
  *
- * @private
+ * @since 0.6.0
  */
-SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
-		const struct sr_datafeed_packet *packet)
+SR_API int sr_session_stats_channel_get(struct sr_session *session,
+		const struct sr_channel *ch, uint64_t *samples, uint64_t *bytes)
 {
-	GSList *l;
-	struct datafeed_callback *cb_struct;
-	struct sr_datafeed_packet *packet_in, *packet_out;
-	struct sr_transform *t;
-	int ret;
+	const struct channel_stats *cs;
+	const void *key;
 
-	if (!sdi) {
-		sr_err("%s: sdi was NULL", __func__);
+	if (!session || !ch)
 		return SR_ERR_ARG;
-	}
 
-	if (!packet) {
-		sr_err("%s: packet was NULL", __func__);
-		return SR_ERR_ARG;
-	}
+	key = ch;
+	if (ch->type == SR_CHANNEL_LOGIC)
+		key = ch->sdi;
+	g_mutex_lock(&session->stats_mutex);
+	cs = g_hash_table_lookup(session->channel_stats, key);
+	if (samples)
+		*samples = cs ? cs->samples : 0;
+	if (bytes)
+		*bytes = cs ? cs->bytes : 0;
+	g_mutex_unlock(&session->stats_mutex);
 
-	if (!sdi->session) {
+	return SR_OK;
+}
+
+/**
+ * Let datafeed callbacks receive run-length encoded logic packets.
+ *
+ * Devices may send logic data as SR_DF_LOGIC_RLE packets. By default,
+ * these get expanded into SR_DF_LOGIC packets before they are passed to
+ * the datafeed callbacks. Callbacks which handle both packet types
+ * (e.g. by means of sr_logic_changes_foreach()) can skip the expansion.
+ * Packets always get expanded for transforms.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param accept TRUE to pass SR_DF_LOGIC_RLE packets unchanged.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_logic_rle_set(struct sr_session *session,
+		gboolean accept)
+{
+	if (!session) {
 		sr_err("%s: session was NULL", __func__);
-		return SR_ERR_BUG;
+		return SR_ERR_ARG;
 	}
 
-	/*
-	 * Pass the packet to the first transform module. If that returns
+	session->logic_rle = accept;
+
+	return SR_OK;
+}
+
+/**
+ * Select how the main loop of a session polls descriptors.
+ *
+ * By default, the main loop polls with GLib's poll function, which
+ * passes all descriptors to the kernel on every iteration. The epoll
+ * backend keeps them registered instead, which saves the per-iteration
+ * overhead when a session runs many descriptors, or iterates at a high
+ * rate, e.g. to react to USB transfer completions quickly.
+ *
+ * The backend applies to the main context of the session while the
+ * session runs (see sr_session_start()), and the previous poll function
+ * of the context gets restored when the session stops. Descriptors
+ * which epoll does not support (e.g. regular files) make the backend
+ * fall back to GLib's poll function, until they are removed.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param backend The poll backend.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR_NA The backend is not available on this platform.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_poll_backend_set(struct sr_session *session,
+		enum sr_session_poll_backend backend)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (session->running) {
+		sr_err("Cannot change the poll backend of a running session.");
+		return SR_ERR;
+	}
+
+	if (backend != SR_SESSION_POLL_GLIB && !sr_session_poll_func(backend)) {
+		sr_err("Poll backend %d is not available.", backend);
+		return SR_ERR_NA;
+	}
+	/* The kept main context of a re-armed session has the old one. */
+	session_disarm(session);
+	session->poll_backend = backend;
+
+	return SR_OK;
+}
+
+/**
+ * Keep a session armed between runs, for quick restarts.
+ *
+ * A re-armed session keeps the main context (and its poll function)
+ * after it stopped, instead of releasing it. The next sr_session_start()
+ * reuses it, and skips the checks and commits which the previous start
+ * did: it verifies the trigger only after sr_session_trigger_set(), and
+ * commits the settings of devices only after sr_config_set() or changes
+ * of enabled channels. This cuts the gap between short captures which
+ * run in a loop without changes to the setup.
+ *
+ * A re-armed session must be restarted from the thread which ran it
+ * before. Modifications of a trigger which the session verified need
+ * another sr_session_trigger_set() call to take effect. Disabling the
+ * mode releases the main context of a stopped session, and so does
+ * sr_session_destroy().
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param rearm TRUE to keep the session armed between runs.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_rearm_set(struct sr_session *session, gboolean rearm)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	session->rearm = rearm;
+	session->verified_trigger = NULL;
+	if (!rearm)
+		session_disarm(session);
+
+	return SR_OK;
+}
+
+/**
+ * Set up the scheduling of the acquisition thread of a session.
+ *
+ * The acquisition thread is the one which calls sr_session_start(),
+ * and runs the session's events, e.g. the handling of USB transfer
+ * completions. Pinning it to CPUs which nothing else uses, and giving
+ * it a real-time policy, keeps scheduler jitter on busy hosts from
+ * delaying the resubmission of transfers. Consumer threads of the
+ * threaded mode (see sr_session_threaded_set()) keep their scheduling,
+ * so that they cannot starve the acquisition thread.
+ *
+ * The settings apply from the start of each run, and the previous
+ * settings of the thread get restored when the session stops. Locking
+ * the memory of the process keeps page faults out of the acquisition,
+ * for all buffers the process allocates while the session runs. It
+ * ends with the session, also for other sessions which locked it.
+ *
+ * Settings which did not take effect, for missing privileges or
+ * platform support, only cause a warning. The statistics of the
+ * session (see sr_session_stats_get()) tell which ones did.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param sched The settings, NULL to leave the thread as it is.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_sched_set(struct sr_session *session,
+		const struct sr_session_sched *sched)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (session->running) {
+		sr_err("Cannot change the scheduling of a running session.");
+		return SR_ERR;
+	}
+
+	if (!sched) {
+		memset(&session->sched, 0, sizeof(session->sched));
+		return SR_OK;
+	}
+	if (sched->policy != SR_SESSION_SCHED_DEFAULT &&
+			sched->policy != SR_SESSION_SCHED_FIFO &&
+			sched->policy != SR_SESSION_SCHED_RR) {
+		sr_err("Invalid scheduling policy %d.", sched->policy);
+		return SR_ERR_ARG;
+	}
+	if (sched->policy != SR_SESSION_SCHED_DEFAULT && sched->priority < 1) {
+		sr_err("Invalid real-time priority %d.", sched->priority);
+		return SR_ERR_ARG;
+	}
+	session->sched = *sched;
+
+	return SR_OK;
+}
+
+/*
+ * Check whether SR_DF_LOGIC_RLE packets reach the datafeed callbacks
+ * without getting expanded. Sources which have their data in run-length
+ * form anyway can then skip the expansion themselves.
+ */
+SR_PRIV gboolean sr_session_logic_rle_accepted(const struct sr_session *session)
+{
+	return session && session->logic_rle && !session->transforms;
+}
+
+/**
+ * Debug helper.
+ *
+ * @param packet The packet to show debugging information for.
+ */
+static void datafeed_dump(const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
+	const struct sr_datafeed_analog *analog;
+
+	/* Please use the same order as in libsigrok.h. */
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		sr_dbg("bus: Received SR_DF_HEADER packet.");
+		break;
+	case SR_DF_END:
+		sr_dbg("bus: Received SR_DF_END packet.");
+		break;
+	case SR_DF_META:
+		sr_dbg("bus: Received SR_DF_META packet.");
+		break;
+	case SR_DF_TRIGGER:
+		sr_dbg("bus: Received SR_DF_TRIGGER packet.");
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		sr_dbg("bus: Received SR_DF_LOGIC packet (%" PRIu64 " bytes, "
+		       "unitsize = %d).", logic->length, logic->unitsize);
+		break;
+	case SR_DF_FRAME_BEGIN:
+		sr_dbg("bus: Received SR_DF_FRAME_BEGIN packet.");
+		break;
+	case SR_DF_FRAME_END:
+		sr_dbg("bus: Received SR_DF_FRAME_END packet.");
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		sr_dbg("bus: Received SR_DF_ANALOG packet (%d samples).",
+		       analog->num_samples);
+		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		sr_dbg("bus: Received SR_DF_LOGIC_RLE packet (%" PRIu64 " samples, "
+		       "%" PRIu64 " changes, unitsize = %d).", rle->num_samples,
+		       rle->num_changes, rle->unitsize);
+		break;
+	default:
+		sr_dbg("bus: Received unknown packet type: %d.", packet->type);
+		break;
+	}
+}
+
+/**
+ * Helper to send a meta datafeed package (SR_DF_META) to the session bus.
+ *
+ * @param sdi The device instance to send the package from. Must not be NULL.
+ * @param key The config key to send to the session bus.
+ * @param var The value to send to the session bus.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
+		uint32_t key, GVariant *var)
+{
+	struct sr_config cfg;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_meta meta;
+	GSList node;
+	int ret;
+
+	/* Receivers don't keep the config, nor the list. */
+	cfg.key = key;
+	cfg.data = g_variant_ref_sink(var);
+	node.data = &cfg;
+	node.next = NULL;
+
+	packet.type = SR_DF_META;
+	packet.payload = &meta;
+	meta.config = &node;
+
+	ret = sr_session_send(sdi, &packet);
+	g_variant_unref(cfg.data);
+
+	return ret;
+}
+
+/*
+ * Send a scalar meta value, of GVariant type 'b', 't' or 'd'. Devices repeat the same values with each
+ * reading, the session keeps the last value of each key, and re-uses
+ * it while it doesn't change. That saves allocating a GVariant per
+ * update.
+ */
+static int session_send_meta_scalar(const struct sr_dev_inst *sdi,
+		uint32_t key, char type, uint64_t u, double d)
+{
+	struct sr_session *session;
+	GVariant *var;
+	gboolean same;
+
+	session = sdi ? sdi->session : NULL;
+	var = NULL;
+	if (session) {
+		g_mutex_lock(&session->meta_mutex);
+		var = g_hash_table_lookup(session->meta_values,
+			GUINT_TO_POINTER(key));
+		same = var && *g_variant_get_type_string(var) == type;
+		if (same && type == 'b')
+			same = !g_variant_get_boolean(var) == !u;
+		else if (same && type == 't')
+			same = g_variant_get_uint64(var) == u;
+		else if (same)
+			same = g_variant_get_double(var) == d;
+		var = same ? g_variant_ref(var) : NULL;
+		g_mutex_unlock(&session->meta_mutex);
+	}
+
+	if (!var) {
+		if (type == 'b')
+			var = g_variant_new_boolean(u != 0);
+		else if (type == 't')
+			var = g_variant_new_uint64(u);
+		else
+			var = g_variant_new_double(d);
+		g_variant_ref_sink(var);
+		if (session) {
+			g_mutex_lock(&session->meta_mutex);
+			g_hash_table_replace(session->meta_values,
+				GUINT_TO_POINTER(key), g_variant_ref(var));
+			g_mutex_unlock(&session->meta_mutex);
+		}
+	}
+
+	return sr_session_send_meta(sdi, key, var);
+}
+
+/**
+ * Send a meta datafeed packet with an integer value.
+ *
+ * Same as sr_session_send_meta(), without the need to allocate a
+ * GVariant for each update. Values which don't change between updates
+ * are sent without allocating anything.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_send_meta_u64(const struct sr_dev_inst *sdi,
+		uint32_t key, uint64_t value)
+{
+	return session_send_meta_scalar(sdi, key, 't',
+		value, 0);
+}
+
+/** @private */
+SR_PRIV int sr_session_send_meta_bool(const struct sr_dev_inst *sdi,
+		uint32_t key, gboolean value)
+{
+	return session_send_meta_scalar(sdi, key, 'b',
+		value ? 1 : 0, 0);
+}
+
+/** @private */
+SR_PRIV int sr_session_send_meta_double(const struct sr_dev_inst *sdi,
+		uint32_t key, double value)
+{
+	return session_send_meta_scalar(sdi, key, 'd',
+		0, value);
+}
+
+/*
+ * Expand run-length encoded logic data into a buffer which the session
+ * keeps for re-use. Only used by the thread which processes packets.
+ */
+static int session_rle_expand(struct sr_session *session,
+		const struct sr_datafeed_logic_rle *rle,
+		struct sr_datafeed_logic *logic)
+{
+	uint64_t size;
+	int ret;
+
+	size = rle->num_samples * rle->unitsize;
+	if (size > session->rle_size) {
+		sr_mem_free_add(SR_MEM_SESSION, session->rle_size);
+		g_free(session->rle_buffer);
+		session->rle_buffer = g_try_malloc(size);
+		session->rle_size = session->rle_buffer ? size : 0;
+		sr_mem_alloc_add(SR_MEM_SESSION, session->rle_size);
+		if (!session->rle_buffer) {
+			sr_err("Cannot expand RLE logic data.");
+			return SR_ERR_MALLOC;
+		}
+	}
+	if ((ret = sr_logic_rle_expand(rle, session->rle_buffer)) != SR_OK) {
+		sr_err("Invalid RLE logic data.");
+		return ret;
+	}
+	logic->length = size;
+	logic->unitsize = rle->unitsize;
+	logic->data = session->rle_buffer;
+
+	return SR_OK;
+}
+
+/* Time which the current thread spent in sr_output_send(). */
+static GPrivate output_time = G_PRIVATE_INIT(g_free);
+
+/** @private */
+SR_PRIV void sr_session_output_time_add(int64_t time_us)
+{
+	uint64_t *total;
+
+	if (!(total = g_private_get(&output_time))) {
+		total = g_malloc0(sizeof(*total));
+		g_private_set(&output_time, total);
+	}
+	*total += time_us;
+}
+
+static uint64_t output_time_get(void)
+{
+	uint64_t *total;
+
+	total = g_private_get(&output_time);
+
+	return total ? *total : 0;
+}
+
+/* When the packet which the current thread works on was sent. */
+static GPrivate dispatch_start = G_PRIVATE_INIT(g_free);
+
+static void dispatch_start_set(int64_t time_us)
+{
+	int64_t *start;
+
+	if (!(start = g_private_get(&dispatch_start))) {
+		start = g_malloc0(sizeof(*start));
+		g_private_set(&dispatch_start, start);
+	}
+	*start = time_us;
+}
+
+static int64_t dispatch_start_get(void)
+{
+	int64_t *start;
+
+	start = g_private_get(&dispatch_start);
+
+	return start ? *start : 0;
+}
+
+/**
+ * Get the time since the packet which is being processed got sent.
+ *
+ * This covers the time it waited in the session's queues, and the time
+ * which transforms and other callbacks before the caller spent on it.
+ * Only valid while a transform or datafeed callback runs.
+ *
+ * @return The latency in microseconds, 0 when unknown.
+ *
+ * @private
+ */
+SR_PRIV int64_t sr_session_dispatch_latency(void)
+{
+	int64_t start_us;
+
+	if (!(start_us = dispatch_start_get()))
+		return 0;
+
+	return g_get_monotonic_time() - start_us;
+}
+
+/* Get the number of samples and their size in bytes, of data packets. */
+static gboolean packet_data_size(const struct sr_datafeed_packet *packet,
+		uint64_t *samples, uint64_t *bytes)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
+	const struct sr_datafeed_analog *analog;
+	unsigned int channels;
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		*samples = logic->unitsize ? logic->length / logic->unitsize : 0;
+		*bytes = logic->length;
+		return TRUE;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		*samples = rle->num_samples;
+		*bytes = rle->num_samples * rle->unitsize;
+		return TRUE;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		channels = g_slist_length(analog->meaning->channels);
+		*samples = (uint64_t)analog->num_samples * channels;
+		*bytes = *samples * analog->encoding->unitsize;
+		return TRUE;
+	default:
+		*samples = *bytes = 0;
+		return FALSE;
+	}
+}
+
+static const char *const meter_type_names[SR_PACKET_METER_TYPES] = {
+	"header", "end", "meta", "trigger", "logic", "frame begin",
+	"frame end", "analog", "logic (RLE)",
+};
+
+static void meter_time_add(struct sr_packet_meter_time *t, int64_t time_us)
+{
+	if (!t->count || time_us < t->min_us)
+		t->min_us = time_us;
+	if (!t->count || time_us > t->max_us)
+		t->max_us = time_us;
+	t->total_us += time_us;
+	t->count++;
+}
+
+/** @private */
+SR_PRIV void sr_packet_meter_reset(struct sr_packet_meter *meter)
+{
+	memset(meter, 0, sizeof(*meter));
+}
+
+/**
+ * Account for a packet which a measuring sink received.
+ *
+ * Counts the packet, its samples and bytes by type, and takes the time
+ * since the previous packet, and the time since the packet was sent
+ * (see sr_session_dispatch_latency()).
+ *
+ * @private
+ */
+SR_PRIV void sr_packet_meter_add(struct sr_packet_meter *meter,
+		const struct sr_datafeed_packet *packet)
+{
+	uint64_t samples, bytes;
+	int64_t now_us, latency_us;
+	int type;
+
+	now_us = g_get_monotonic_time();
+	if (!meter->start_us)
+		meter->start_us = now_us;
+	else
+		meter_time_add(&meter->gap, now_us - meter->last_us);
+	meter->last_us = now_us;
+	if ((latency_us = sr_session_dispatch_latency()) > 0)
+		meter_time_add(&meter->latency, latency_us);
+
+	type = packet->type - SR_DF_HEADER;
+	if (type < 0 || type >= SR_PACKET_METER_TYPES)
+		return;
+	packet_data_size(packet, &samples, &bytes);
+	meter->packets[type]++;
+	meter->samples[type] += samples;
+	meter->bytes[type] += bytes;
+}
+
+static void meter_time_append(GString *s, const char *name,
+		const struct sr_packet_meter_time *t)
+{
+	if (!t->count)
+		return;
+	g_string_append_printf(s, "%s: min %" PRIi64 " us, avg %.1f us, "
+		"max %" PRIi64 " us\n", name, t->min_us,
+		t->total_us / (double)t->count, t->max_us);
+}
+
+/**
+ * Describe what a measuring sink received, one line per item.
+ *
+ * @return A newly allocated string, which the caller must free.
+ *
+ * @private
+ */
+SR_PRIV GString *sr_packet_meter_summary(const struct sr_packet_meter *meter)
+{
+	GString *s;
+	double seconds;
+	uint64_t packets;
+	int i;
+
+	seconds = MAX(meter->last_us - meter->start_us, 1) / 1e6;
+	packets = 0;
+	for (i = 0; i < SR_PACKET_METER_TYPES; i++)
+		packets += meter->packets[i];
+
+	s = g_string_sized_new(512);
+	g_string_append_printf(s, "%" PRIu64 " packets in %.6f s, "
+		"%.0f packets/s\n", packets, seconds, packets / seconds);
+	for (i = 0; i < SR_PACKET_METER_TYPES; i++) {
+		if (!meter->packets[i])
+			continue;
+		g_string_append_printf(s, "%s: %" PRIu64 " packets",
+			meter_type_names[i], meter->packets[i]);
+		if (meter->bytes[i]) {
+			g_string_append_printf(s, ", %" PRIu64 " samples, "
+				"%" PRIu64 " bytes, %.3f Msamples/s, %.3f MB/s",
+				meter->samples[i], meter->bytes[i],
+				meter->samples[i] / seconds / 1e6,
+				meter->bytes[i] / seconds / 1e6);
+		}
+		g_string_append_c(s, '\n');
+	}
+	meter_time_append(s, "gap", &meter->gap);
+	meter_time_append(s, "latency", &meter->latency);
+
+	return s;
+}
+
+static void channel_stats_add(struct sr_session *session, const void *key,
+		uint64_t samples, uint64_t bytes)
+{
+	struct channel_stats *cs;
+
+	if (!(cs = g_hash_table_lookup(session->channel_stats, key))) {
+		cs = g_malloc0(sizeof(*cs));
+		g_hash_table_insert(session->channel_stats, (void *)key, cs);
+	}
+	cs->samples += samples;
+	cs->bytes += bytes;
+}
+
+/*
+ * Account for a packet which was passed to the datafeed callbacks, or
+ * only for the transform time when no packet was left to pass on.
+ */
+static void session_stats_add(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, int64_t transform_us,
+		int64_t callback_us, uint64_t output_us)
+{
+	struct sr_session *session;
+	struct sr_session_stats *stats;
+	const struct sr_datafeed_analog *analog;
+	uint64_t samples, bytes, t;
+	unsigned int bucket;
+	GSList *l;
+
+	session = sdi->session;
+	stats = &session->stats;
+	g_mutex_lock(&session->stats_mutex);
+	session->stats_last_us = g_get_monotonic_time();
+	stats->transform_us += transform_us;
+	if (!packet) {
+		g_mutex_unlock(&session->stats_mutex);
+		return;
+	}
+	stats->packets++;
+	stats->callback_us += callback_us;
+	stats->output_us += output_us;
+	bucket = 0;
+	for (t = callback_us; t && bucket < SR_SESSION_STATS_BUCKETS - 1; t >>= 1)
+		bucket++;
+	stats->callback_hist[bucket]++;
+
+	if (packet_data_size(packet, &samples, &bytes)) {
+		if (packet->type == SR_DF_ANALOG) {
+			stats->analog_samples += samples;
+			stats->analog_bytes += bytes;
+			analog = packet->payload;
+			for (l = analog->meaning->channels; l; l = l->next) {
+				channel_stats_add(session, l->data,
+					analog->num_samples,
+					(uint64_t)analog->num_samples *
+					analog->encoding->unitsize);
+			}
+		} else {
+			stats->logic_samples += samples;
+			stats->logic_bytes += bytes;
+			channel_stats_add(session, sdi, samples, bytes);
+		}
+	}
+	g_mutex_unlock(&session->stats_mutex);
+}
+
+/* Account for a data packet which the threaded mode dropped. */
+static void session_stats_drop(struct sr_session *session,
+		const struct sr_datafeed_packet *packet)
+{
+	uint64_t samples, bytes;
+
+	packet_data_size(packet, &samples, &bytes);
+	g_mutex_lock(&session->stats_mutex);
+	session->stats.bytes_dropped += bytes;
+	session->queue_stats.packets_dropped++;
+	g_mutex_unlock(&session->stats_mutex);
+}
+
+static void session_stats_reset(struct sr_session *session)
+{
+	g_mutex_lock(&session->stats_mutex);
+	memset(&session->stats, 0, sizeof(session->stats));
+	g_hash_table_remove_all(session->channel_stats);
+	session->stats_start_us = g_get_monotonic_time();
+	session->stats_last_us = session->stats_start_us;
+	g_mutex_unlock(&session->stats_mutex);
+}
+
+/*
+ * The transform chain uses two output buffers in turns. Each transform
+ * gets the one which doesn't hold its input, so the data of a packet
+ * survives until the next transform is done with it, and a chain of any
+ * length needs no allocations once the buffers have grown. Pipeline
+ * stages have buffers of their own.
+ */
+static int transform_buffer_find(const struct sr_transform_buffers *buffers,
+		const struct sr_datafeed_packet *packet)
+{
+	const uint8_t *data, *start;
+	int i;
+
+	if (packet->type == SR_DF_LOGIC)
+		data = ((const struct sr_datafeed_logic *)packet->payload)->data;
+	else if (packet->type == SR_DF_ANALOG)
+		data = ((const struct sr_datafeed_analog *)packet->payload)->data;
+	else
+		return -1;
+
+	for (i = 0; i < 2; i++) {
+		start = buffers->bufs[i].data;
+		if (start && data >= start && data < start + buffers->bufs[i].size)
+			return i;
+	}
+
+	return -1;
+}
+
+static void transform_buffers_free(struct sr_transform_buffers *buffers)
+{
+	sr_mem_free_add(SR_MEM_TRANSFORM, buffers->bufs[0].size);
+	sr_mem_free_add(SR_MEM_TRANSFORM, buffers->bufs[1].size);
+	g_free(buffers->bufs[0].data);
+	g_free(buffers->bufs[1].data);
+	memset(buffers, 0, sizeof(*buffers));
+}
+
+/**
+ * Get an output buffer for a transform module's receive() callback.
+ *
+ * The buffer belongs to the session and is re-used for later packets.
+ * It stays valid until the packet which refers to it has passed the
+ * rest of the transform chain.
+ *
+ * @param t The transform instance whose receive() callback runs.
+ * @param size The size of the buffer in bytes.
+ *
+ * @return The buffer, or NULL when it cannot get allocated.
+ *
+ * @private
+ */
+SR_PRIV void *sr_transform_buffer_get(const struct sr_transform *t,
+		size_t size)
+{
+	struct sr_transform_buffers *buffers;
+	void *data;
+	int i;
+
+	buffers = t->buffers;
+	i = (buffers->current == 0) ? 1 : 0;
+	if (buffers->bufs[i].size < size) {
+		data = g_try_realloc(buffers->bufs[i].data, size);
+		if (!data) {
+			sr_err("Cannot allocate transform buffer.");
+			return NULL;
+		}
+		sr_mem_free_add(SR_MEM_TRANSFORM, buffers->bufs[i].size);
+		sr_mem_alloc_add(SR_MEM_TRANSFORM, size);
+		buffers->bufs[i].data = data;
+		buffers->bufs[i].size = size;
+	}
+
+	return buffers->bufs[i].data;
+}
+
+/**
+ * Emit a packet from a transform module's receive() callback, in
+ * addition to its output packet.
+ *
+ * The packet gets copied. It passes through the transforms which follow
+ * the emitting one, after the output packet of the current receive()
+ * call, or in place of it when the callback returns no output packet.
+ *
+ * @param t The transform instance whose receive() callback runs.
+ * @param packet The packet to emit.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @private
+ */
+SR_PRIV int sr_transform_emit(const struct sr_transform *t,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_datafeed_packet *copy;
+	int ret;
+
+	if (!t || !packet)
+		return SR_ERR_ARG;
+	if ((ret = sr_packet_copy(packet, &copy)) != SR_OK)
+		return ret;
+	g_queue_push_tail(&((struct sr_transform *)t)->emitted, copy);
+
+	return SR_OK;
+}
+
+/**
+ * Get sample data which a transform module can modify in place.
+ *
+ * Sample data which other packets share gets copied into an output
+ * buffer of the transform first (see sr_transform_buffer_get()), so
+ * that in-place modifications do not show in packets which consumers
+ * keep.
+ *
+ * @param t The transform instance whose receive() callback runs.
+ * @param data The sample data of the packet to modify.
+ * @param size The size of the sample data in bytes.
+ *
+ * @return The data to modify, and to pass on. NULL when a copy cannot
+ *         get allocated.
+ *
+ * @private
+ */
+SR_PRIV void *sr_transform_data_writable(const struct sr_transform *t,
+		void *data, size_t size)
+{
+	struct sr_buffer *buf;
+	gboolean shared;
+	void *copy;
+
+	if (!size || !(buf = sr_buffer_lent_ref(data, size)))
+		return data;
+	/* Not counting the reference just taken, and the sender's. */
+	shared = g_atomic_int_get(&buf->refcount) > 2;
+	sr_buffer_unref(buf);
+	if (!shared)
+		return data;
+
+	if (!(copy = sr_transform_buffer_get(t, size)))
+		return NULL;
+	memcpy(copy, data, size);
+
+	return copy;
+}
+
+/*
+ * A pipeline stage runs a threaded transform and the unthreaded ones
+ * which follow it in a worker thread, fed by a queue of its own.
+ */
+struct session_stage {
+	struct session_ring *ring;
+	GSList *first;
+	struct sr_transform_buffers buffers;
+	struct sr_session_queue_stats stats;
+};
+
+/*
+ * Run the transforms from *list on, up to the start of another pipeline
+ * stage. Upon return *list is the first transform of the next stage or
+ * NULL, *packet is NULL when a transform swallowed the packet, and *sdi
+ * is the device which the packet comes from after the transforms.
+ */
+static int transforms_run(struct session_stage *stage, GSList **list,
+		struct sr_datafeed_packet **packet, const struct sr_dev_inst **sdi,
+		int64_t *time_us)
+{
+	GSList *l;
+	struct sr_datafeed_packet *packet_in, *packet_out;
+	struct sr_transform *t;
+	int64_t start_us;
+	int ret, tag;
+
+	ret = SR_OK;
+	packet_in = *packet;
+	start_us = g_get_monotonic_time();
+	for (l = *list; l; l = l->next) {
+		t = l->data;
+		if (t->stage && t->stage != stage)
+			break;
+		if (l == *list)
+			t->buffers->current = -1;
+		sr_spew("Running transform module '%s'.", t->module->id);
+		sr_trace(SR_TRACE_TRANSFORM, SR_TRACE_BEGIN, packet_in->type);
+		tag = sr_mem_tag_enter(SR_MEM_TRANSFORM);
+		ret = t->module->receive(t, packet_in, &packet_out);
+		sr_mem_tag_leave(tag);
+		sr_trace(SR_TRACE_TRANSFORM, SR_TRACE_END, packet_in->type);
+		if (ret < 0) {
+			sr_err("Error while running transform module: %d.", ret);
+			ret = SR_ERR;
+			break;
+		}
+		if (!packet_out) {
+			/*
+			 * If any of the transforms don't return an output
+			 * packet, abort.
+			 */
+			sr_spew("Transform module didn't return a packet, aborting.");
+			packet_in = NULL;
+			break;
+		}
+		/*
+		 * Use this transform module's output packet as input
+		 * for the next transform module.
+		 */
+		packet_in = packet_out;
+		t->buffers->current = transform_buffer_find(t->buffers, packet_in);
+		if (t->sdi_out)
+			*sdi = t->sdi_out;
+	}
+	*time_us = (l != *list) ? g_get_monotonic_time() - start_us : 0;
+	*list = l;
+	*packet = packet_in;
+
+	return ret;
+}
+
+/* Pass a packet to all datafeed callbacks. */
+static struct device_position *device_position_get(
+		struct sr_session *session, const struct sr_dev_inst *sdi)
+{
+	struct device_position *dp;
+
+	if (!(dp = g_hash_table_lookup(session->positions, sdi))) {
+		dp = g_malloc0(sizeof(*dp));
+		dp->analog_samples = g_hash_table_new_full(NULL, NULL,
+			NULL, g_free);
+		dp->trigger_index = -1;
+		g_hash_table_insert(session->positions, (void *)sdi, dp);
+	}
+
+	return dp;
+}
+
+static uint64_t *analog_counter(struct device_position *dp, void *ch)
+{
+	uint64_t *counter;
+
+	if (!(counter = g_hash_table_lookup(dp->analog_samples, ch))) {
+		counter = g_malloc0(sizeof(*counter));
+		g_hash_table_insert(dp->analog_samples, ch, counter);
+	}
+
+	return counter;
+}
+
+/*
+ * Determine the position of a packet which gets passed to the datafeed
+ * callbacks, and advance the device's sample counters past it.
+ */
+static void position_update(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_session *session;
+	struct sr_datafeed_position *pos;
+	struct device_position *dp;
+	const struct sr_datafeed_header *header;
+	const struct sr_datafeed_meta *meta;
+	const struct sr_datafeed_analog *analog;
+	const struct sr_config *src;
+	uint64_t samples, bytes;
+	GVariant *gvar;
+	GSList *l;
+
+	session = sdi->session;
+	dp = device_position_get(session, sdi);
+	pos = &session->position;
+
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		header = packet->payload;
+		g_hash_table_remove_all(dp->analog_samples);
+		dp->logic_samples = 0;
+		dp->analog_max = 0;
+		dp->trigger_index = -1;
+		dp->frame = 0;
+		dp->starttime = header->starttime;
+		dp->samplerate = 0;
+		if (sdi->driver && sr_config_get(sdi->driver, sdi, NULL,
+				SR_CONF_SAMPLERATE, &gvar) == SR_OK) {
+			dp->samplerate = g_variant_get_uint64(gvar);
+			g_variant_unref(gvar);
+		}
+		break;
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key == SR_CONF_SAMPLERATE)
+				dp->samplerate = g_variant_get_uint64(src->data);
+		}
+		break;
+	case SR_DF_TRIGGER:
+		dp->trigger_index = MAX(dp->logic_samples, dp->analog_max);
+		break;
+	case SR_DF_FRAME_BEGIN:
+		dp->frame++;
+		break;
+	default:
+		break;
+	}
+
+	pos->sample_index = MAX(dp->logic_samples, dp->analog_max);
+	pos->num_samples = 0;
+	if (packet->type == SR_DF_ANALOG) {
+		analog = packet->payload;
+		l = analog->meaning->channels;
+		pos->sample_index = l ? *analog_counter(dp, l->data)
+			: dp->analog_max;
+		pos->num_samples = analog->num_samples;
+		for (; l; l = l->next)
+			*analog_counter(dp, l->data) = pos->sample_index
+				+ analog->num_samples;
+		dp->analog_max = MAX(dp->analog_max,
+			pos->sample_index + analog->num_samples);
+	} else if (packet_data_size(packet, &samples, &bytes)) {
+		pos->sample_index = dp->logic_samples;
+		pos->num_samples = samples;
+		dp->logic_samples += samples;
+	}
+	pos->samplerate = dp->samplerate;
+	pos->starttime = dp->starttime;
+	pos->trigger_index = dp->trigger_index;
+	pos->frame = dp->frame;
+	session->position_packet = packet;
+}
+
+/**
+ * Get the position of a packet within the acquisition.
+ *
+ * Only works from within a datafeed callback, for the packet which the
+ * callback was passed. Callbacks which keep packets for later use need
+ * to keep their positions too.
+ *
+ * The position of SR_DF_TRIGGER and other packets without samples is
+ * the index of the next sample.
+ *
+ * @param session The session. Must not be NULL.
+ * @param packet The packet which the datafeed callback was passed.
+ * @param pos Receives the position.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or the packet is not the one
+ *         which the datafeed callbacks currently get.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_packet_position(struct sr_session *session,
+		const struct sr_datafeed_packet *packet,
+		struct sr_datafeed_position *pos)
+{
+	if (!session || !packet || !pos)
+		return SR_ERR_ARG;
+	if (packet != session->position_packet)
+		return SR_ERR_ARG;
+
+	*pos = session->position;
+
+	return SR_OK;
+}
+
+static void callbacks_run(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, gboolean dump,
+		int64_t transform_us)
+{
+	GSList *l;
+	struct datafeed_callback *cb_struct;
+	int64_t start_us, callback_us;
+	uint64_t output_us;
+
+	if (dump && sdi->session->datafeed_callbacks)
+		datafeed_dump(packet);
+	start_us = g_get_monotonic_time();
+	output_us = output_time_get();
+	position_update(sdi, packet);
+	for (l = sdi->session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		sr_trace(SR_TRACE_DATAFEED_CB, SR_TRACE_BEGIN, packet->type);
+		cb_struct->cb(sdi, packet, cb_struct->cb_data);
+		sr_trace(SR_TRACE_DATAFEED_CB, SR_TRACE_END, packet->type);
+	}
+	sdi->session->position_packet = NULL;
+	callback_us = g_get_monotonic_time() - start_us;
+	output_us = output_time_get() - output_us;
+	session_stats_add(sdi, packet, transform_us, callback_us, output_us);
+}
+
+/*
+ * Data packets which wait to get combined with the following ones,
+ * before they are passed to the datafeed callbacks. Only the thread
+ * which runs the callbacks touches it while the session runs.
+ */
+struct session_coalesce {
+	uint64_t max_bytes;
+	int64_t max_latency_us;
+	/* Whether a timer in the main context flushes late samples. */
+	gboolean timer;
+	GSource *timer_source;
+	/* The combined packet, pending while length is not 0. */
+	const struct sr_dev_inst *sdi;
+	gboolean dump;
+	int64_t since_us;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	uint8_t *data;
+	size_t size;
+	size_t length;
+};
+
+/*
+ * Get the size of the sample data of a packet which can get combined
+ * with others. Analog values need to be packed, with the same scaling
+ * for all channels.
+ */
+static gboolean coalesce_size(const struct sr_datafeed_packet *packet,
+		size_t *size)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+
+	if (!packet->payload)
+		return FALSE;
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		if (!logic->unitsize || !logic->length ||
+				logic->length % logic->unitsize)
+			return FALSE;
+		*size = logic->length;
+		return TRUE;
+	}
+	if (packet->type == SR_DF_ANALOG) {
+		analog = packet->payload;
+		if (!analog->encoding || !analog->meaning || !analog->spec ||
+				!analog->meaning->channels || !analog->num_samples ||
+				!sr_analog_is_packed(analog))
+			return FALSE;
+		*size = (size_t)analog->num_samples * sr_analog_frame_size(analog);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Check whether a packet continues the pending one. */
+static gboolean coalesce_match(const struct session_coalesce *co,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	const struct sr_analog_encoding *enc;
+	const struct sr_analog_meaning *meaning;
+	GSList *a, *b;
+
+	if (sdi != co->sdi || packet->type != co->packet.type)
+		return FALSE;
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		return logic->unitsize == co->logic.unitsize;
+	}
+
+	analog = packet->payload;
+	enc = analog->encoding;
+	meaning = analog->meaning;
+	if (analog->num_samples > UINT32_MAX - co->analog.num_samples)
+		return FALSE;
+	if (enc->unitsize != co->encoding.unitsize ||
+			enc->is_signed != co->encoding.is_signed ||
+			enc->is_float != co->encoding.is_float ||
+			enc->is_bigendian != co->encoding.is_bigendian ||
+			enc->digits != co->encoding.digits ||
+			enc->is_digits_decimal != co->encoding.is_digits_decimal ||
+			!sr_rational_eq(&enc->scale, &co->encoding.scale) ||
+			!sr_rational_eq(&enc->offset, &co->encoding.offset))
+		return FALSE;
+	if (meaning->mq != co->meaning.mq || meaning->unit != co->meaning.unit ||
+			meaning->mqflags != co->meaning.mqflags)
+		return FALSE;
+	if (analog->spec->spec_digits != co->spec.spec_digits)
+		return FALSE;
+	for (a = meaning->channels, b = co->meaning.channels; a && b;
+			a = a->next, b = b->next) {
+		if (a->data != b->data)
+			return FALSE;
+	}
+
+	return !a && !b;
+}
+
+static void coalesce_start(struct sr_session *session)
+{
+	/* Without consumer threads, the callbacks run in the main context. */
+	if (session->coalesce)
+		session->coalesce->timer = !session->ring && !session->stages;
+}
+
+/* Pass the pending packet to the datafeed callbacks. */
+static void coalesce_flush(struct sr_session *session)
+{
+	struct session_coalesce *co;
+
+	if (!(co = session->coalesce))
+		return;
+	if (co->timer_source) {
+		g_source_destroy(co->timer_source);
+		g_source_unref(co->timer_source);
+		co->timer_source = NULL;
+	}
+	if (!co->length)
+		return;
+
+	if (co->packet.type == SR_DF_LOGIC) {
+		co->logic.data = co->data;
+		co->packet.payload = &co->logic;
+	} else {
+		co->analog.data = co->data;
+		co->packet.payload = &co->analog;
+	}
+	callbacks_run(co->sdi, &co->packet, co->dump, 0);
+	g_slist_free(co->meaning.channels);
+	co->meaning.channels = NULL;
+	co->length = 0;
+}
+
+static gboolean coalesce_timeout(gpointer data)
+{
+	coalesce_flush(data);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* When the consumer thread which runs the callbacks needs to flush. */
+static int64_t coalesce_deadline(const struct sr_session *session)
+{
+	const struct session_coalesce *co;
+
+	co = session->coalesce;
+	if (!co || !co->length || !co->max_latency_us)
+		return 0;
+
+	return co->since_us + co->max_latency_us;
+}
+
+static void coalesce_append(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, size_t size,
+		gboolean dump)
+{
+	struct session_coalesce *co;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	GSource *source;
+	size_t new_size;
+
+	co = session->coalesce;
+	if (co->length + size > co->size) {
+		new_size = MIN(MAX(co->length + size, 2 * co->size),
+			co->max_bytes);
+		sr_mem_free_add(SR_MEM_SESSION, co->size);
+		sr_mem_alloc_add(SR_MEM_SESSION, new_size);
+		co->data = g_realloc(co->data, new_size);
+		co->size = new_size;
+	}
+
+	if (!co->length) {
+		co->sdi = sdi;
+		co->dump = dump;
+		co->since_us = g_get_monotonic_time();
+		co->packet.type = packet->type;
+		if (packet->type == SR_DF_LOGIC) {
+			co->logic.unitsize =
+				((const struct sr_datafeed_logic *)packet->payload)->unitsize;
+			co->logic.length = 0;
+		} else {
+			analog = packet->payload;
+			co->encoding = *analog->encoding;
+			co->meaning = *analog->meaning;
+			co->meaning.channels = g_slist_copy(analog->meaning->channels);
+			co->spec = *analog->spec;
+			co->analog.encoding = &co->encoding;
+			co->analog.meaning = &co->meaning;
+			co->analog.spec = &co->spec;
+			co->analog.num_samples = 0;
+		}
+		if (co->timer && co->max_latency_us) {
+			source = g_timeout_source_new(
+				MAX(co->max_latency_us / 1000, 1));
+			g_source_set_callback(source, coalesce_timeout,
+				session, NULL);
+			if (session_source_attach(session, source))
+				co->timer_source = source;
+			else
+				g_source_unref(source);
+		}
+	}
+
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		memcpy(co->data + co->length, logic->data, size);
+		co->logic.length += size;
+	} else {
+		analog = packet->payload;
+		memcpy(co->data + co->length, analog->data, size);
+		co->analog.num_samples += analog->num_samples;
+	}
+	co->length += size;
+}
+
+/*
+ * Pass a packet to the datafeed callbacks, or combine it with the
+ * pending one when coalescing is enabled.
+ */
+static void callbacks_deliver(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, gboolean dump,
+		int64_t transform_us)
+{
+	struct sr_session *session;
+	struct session_coalesce *co;
+	size_t size;
+
+	session = sdi->session;
+	if (!(co = session->coalesce)) {
+		callbacks_run(sdi, packet, dump, transform_us);
+		return;
+	}
+
+	/* Anything else is a boundary, which gets its place kept. */
+	if (!coalesce_size(packet, &size)) {
+		coalesce_flush(session);
+		callbacks_run(sdi, packet, dump, transform_us);
+		return;
+	}
+	if (co->length && (!coalesce_match(co, sdi, packet) ||
+			co->length + size > co->max_bytes))
+		coalesce_flush(session);
+	if (size >= co->max_bytes) {
+		callbacks_run(sdi, packet, dump, transform_us);
+		return;
+	}
+
+	coalesce_append(session, sdi, packet, size, dump);
+	session_stats_add(sdi, NULL, transform_us, 0, 0);
+	if (co->length >= co->max_bytes || (co->max_latency_us &&
+			g_get_monotonic_time() - co->since_us >= co->max_latency_us))
+		coalesce_flush(session);
+}
+
+static void coalesce_free(struct sr_session *session)
+{
+	struct session_coalesce *co;
+
+	if (!(co = session->coalesce))
+		return;
+	if (co->timer_source) {
+		g_source_destroy(co->timer_source);
+		g_source_unref(co->timer_source);
+	}
+	g_slist_free(co->meaning.channels);
+	sr_mem_free_add(SR_MEM_SESSION, co->size);
+	g_free(co->data);
+	g_free(co);
+	session->coalesce = NULL;
+}
+
+/**
+ * Combine small data packets for the datafeed callbacks.
+ *
+ * Devices which send a few samples at a time (multimeters, or short USB
+ * transfers) make callbacks which write files or hand the data to a
+ * script run once per packet. With coalescing enabled, consecutive
+ * SR_DF_LOGIC packets of a device with the same unitsize, and consecutive
+ * SR_DF_ANALOG packets of a device with the same channels, encoding and
+ * meaning, get combined after the transforms ran on them.
+ *
+ * A combined packet gets passed on when it would grow beyond max_bytes,
+ * when max_latency_ms passed since its first samples arrived, and before
+ * any other packet, so that triggers, meta packets, frame boundaries and
+ * the end of the stream keep their places. Packets of max_bytes or more,
+ * and analog packets with interleaved values or per-channel scaling,
+ * pass unchanged.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param max_bytes The most sample data of a combined packet, in bytes.
+ *                  0 disables coalescing.
+ * @param max_latency_ms How long samples may wait for more, in
+ *                       milliseconds. 0 for no limit.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_coalesce_set(struct sr_session *session,
+		uint64_t max_bytes, uint32_t max_latency_ms)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (session->running) {
+		sr_err("Cannot change the coalescing of a running session.");
+		return SR_ERR;
+	}
+
+	coalesce_free(session);
+	if (!max_bytes)
+		return SR_OK;
+
+	session->coalesce = g_malloc0(sizeof(*session->coalesce));
+	session->coalesce->max_bytes = max_bytes;
+	session->coalesce->max_latency_us = max_latency_ms * (int64_t)1000;
+
+	return SR_OK;
+}
+
+/*
+ * Run a packet through the transforms from first on, and then either
+ * queue it for the next pipeline stage, or pass it to the callbacks.
+ */
+static int session_chain(const struct sr_dev_inst *sdi,
+		struct session_stage *stage, GSList *first,
+		const struct sr_datafeed_packet *packet, gboolean dump)
+{
+	const struct sr_dev_inst *out_sdi;
+	struct sr_datafeed_packet *out, *copy, *emitted;
+	struct sr_transform *next, *t;
+	GSList *start, *l;
+	int64_t transform_us;
+	int ret;
+
+	start = first;
+	out = (struct sr_datafeed_packet *)packet;
+	out_sdi = sdi;
+	ret = transforms_run(stage, &first, &out, &out_sdi, &transform_us);
+	if (ret == SR_OK && out && !first) {
+		callbacks_deliver(out_sdi, out, dump, transform_us);
+	} else if (ret == SR_OK) {
+		session_stats_add(sdi, NULL, transform_us, 0, 0);
+		if (out) {
+			/*
+			 * The stage keeps working on its buffers, the next
+			 * one gets a copy.
+			 */
+			next = first->data;
+			ret = sr_packet_copy(out, &copy);
+			if (ret == SR_OK)
+				ret = session_ring_push(next->stage->ring,
+					out_sdi, copy);
+		}
+	}
+
+	/*
+	 * Packets which the transforms emitted (see sr_transform_emit())
+	 * follow their input packet, through the transforms after them.
+	 * The transform buffers are free for reuse by now.
+	 */
+	for (l = start; l; l = l->next) {
+		t = l->data;
+		if (l != start && t->stage && t->stage != stage)
+			break;
+		if (t->sdi_out)
+			sdi = t->sdi_out;
+		/* After an error, they get dropped. */
+		while ((emitted = g_queue_pop_head(&t->emitted))) {
+			if (ret == SR_OK)
+				ret = session_chain(sdi, stage, l->next, emitted, dump);
+			sr_packet_free(emitted);
+		}
+	}
+
+	return ret;
+}
+
+/*
+ * Run a packet through the session's transform chain, and pass the
+ * result to all datafeed callbacks. Arguments were checked by the caller.
+ */
+static int session_process(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, gboolean dump)
+{
+	struct sr_datafeed_packet expanded;
+	struct sr_datafeed_logic logic;
+	int ret;
+
+	/* Expand run-length encoded logic data, unless it is accepted. */
+	if (packet->type == SR_DF_LOGIC_RLE &&
+			!sr_session_logic_rle_accepted(sdi->session)) {
+		ret = session_rle_expand(sdi->session, packet->payload, &logic);
+		if (ret != SR_OK)
+			return ret;
+		expanded.type = SR_DF_LOGIC;
+		expanded.payload = &logic;
+		packet = &expanded;
+	}
+
+	/*
+	 * Pass the packet to the first transform module. If that returns
 	 * another packet (instead of NULL), pass that packet to the next
 	 * transform module in the list, and so on.
 	 */
-	packet_in = (struct sr_datafeed_packet *)packet;
-	for (l = sdi->session->transforms; l; l = l->next) {
+	return session_chain(sdi, NULL, sdi->session->transforms, packet, dump);
+}
+
+/*
+ * Packets from sr_packet_copy(). Their sample data lives in a buffer
+ * which can be shared with other packets, and gets treated as read-only
+ * once it is shared.
+ */
+struct packet_copy {
+	struct sr_datafeed_packet packet;
+	gint refcount;
+	struct sr_buffer *buffer;
+};
+
+static struct sr_buffer *packet_buffer(const struct sr_datafeed_packet *packet)
+{
+	return ((const struct packet_copy *)packet)->buffer;
+}
+
+/*
+ * Threaded session mode.
+ *
+ * Packets which get sent by drivers (from the thread that runs the
+ * session's main loop) are copied into a single-producer/single-consumer
+ * ring. A consumer thread takes packets off the ring and runs transforms
+ * and datafeed callbacks. Ring indices are free running counters which
+ * are only ever written by one side, so the fast path needs no locks. The
+ * mutex and condition only get involved when one side waits for the
+ * other (empty ring, or full ring with blocking backpressure).
+ */
+struct session_ring_entry {
+	const struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet *packet;
+	/* When the packet was sent, see sr_session_dispatch_latency(). */
+	int64_t send_us;
+};
+
+struct session_ring {
+	struct sr_session *session;
+	/* The pipeline stage this ring feeds, or NULL for the session. */
+	struct session_stage *stage;
+	struct sr_session_queue_stats *stats;
+	struct session_ring_entry *slots;
+	guint mask;
+	gint head;
+	gint tail;
+	gint consumer_waiting;
+	gint producer_waiting;
+	gboolean drop_on_overflow;
+	gboolean dump;
+	/* Whether the consumer runs the datafeed callbacks. */
+	gboolean callbacks;
+	GMutex mutex;
+	GCond cond;
+	GThread *thread;
+};
+
+static guint session_ring_fill(struct session_ring *ring)
+{
+	return (guint)g_atomic_int_get(&ring->tail) -
+		(guint)g_atomic_int_get(&ring->head);
+}
+
+static void session_ring_wake(struct session_ring *ring, gint *waiting)
+{
+	if (!g_atomic_int_get(waiting))
+		return;
+	g_mutex_lock(&ring->mutex);
+	g_cond_broadcast(&ring->cond);
+	g_mutex_unlock(&ring->mutex);
+}
+
+static gpointer session_ring_consumer(gpointer data)
+{
+	struct session_ring *ring;
+	struct session_ring_entry entry;
+	struct sr_buffer *prev;
+	int64_t deadline;
+	guint head;
+
+	ring = data;
+	for (;;) {
+		head = g_atomic_int_get(&ring->head);
+		if (head == (guint)g_atomic_int_get(&ring->tail)) {
+			/* Combined packets must not wait for more too long. */
+			deadline = ring->callbacks ?
+				coalesce_deadline(ring->session) : 0;
+			g_mutex_lock(&ring->mutex);
+			g_atomic_int_set(&ring->consumer_waiting, 1);
+			while (head == (guint)g_atomic_int_get(&ring->tail)) {
+				if (!deadline)
+					g_cond_wait(&ring->cond, &ring->mutex);
+				else if (!g_cond_wait_until(&ring->cond,
+						&ring->mutex, deadline))
+					break;
+			}
+			g_atomic_int_set(&ring->consumer_waiting, 0);
+			g_mutex_unlock(&ring->mutex);
+			if (head == (guint)g_atomic_int_get(&ring->tail)) {
+				coalesce_flush(ring->session);
+				continue;
+			}
+		}
+		entry = ring->slots[head & ring->mask];
+		g_atomic_int_set(&ring->head, head + 1);
+		session_ring_wake(ring, &ring->producer_waiting);
+
+		/* A NULL packet terminates the consumer. */
+		if (!entry.packet)
+			break;
+		prev = sr_buffer_lend(packet_buffer(entry.packet));
+		dispatch_start_set(entry.send_us);
+		if (ring->stage)
+			session_chain(entry.sdi, ring->stage, ring->stage->first,
+				entry.packet, ring->dump);
+		else
+			session_process(entry.sdi, entry.packet, ring->dump);
+		sr_buffer_lend(prev);
+		sr_packet_free(entry.packet);
+	}
+
+	return NULL;
+}
+
+/* Producer side. Takes ownership of the packet. */
+static int session_ring_push(struct session_ring *ring,
+		const struct sr_dev_inst *sdi, struct sr_datafeed_packet *packet)
+{
+	struct sr_session_queue_stats *stats;
+	guint tail, fill;
+	gboolean droppable;
+
+	stats = ring->stats;
+	tail = g_atomic_int_get(&ring->tail);
+	fill = tail - (guint)g_atomic_int_get(&ring->head);
+	if (fill > ring->mask) {
+		/* Only sample data may get lost, never the framing. */
+		droppable = packet && (packet->type == SR_DF_LOGIC ||
+			packet->type == SR_DF_LOGIC_RLE ||
+			packet->type == SR_DF_ANALOG);
+		if (ring->drop_on_overflow && droppable) {
+			session_stats_drop(ring->session, packet);
+			sr_packet_free(packet);
+			return SR_OK;
+		}
+		g_mutex_lock(&ring->session->stats_mutex);
+		stats->producer_stalls++;
+		g_mutex_unlock(&ring->session->stats_mutex);
+		g_mutex_lock(&ring->mutex);
+		g_atomic_int_set(&ring->producer_waiting, 1);
+		while (tail - (guint)g_atomic_int_get(&ring->head) > ring->mask)
+			g_cond_wait(&ring->cond, &ring->mutex);
+		g_atomic_int_set(&ring->producer_waiting, 0);
+		g_mutex_unlock(&ring->mutex);
+		fill = tail - (guint)g_atomic_int_get(&ring->head);
+	}
+
+	ring->slots[tail & ring->mask].sdi = sdi;
+	ring->slots[tail & ring->mask].packet = packet;
+	/* Pipeline stages pass on the time of the original packet. */
+	ring->slots[tail & ring->mask].send_us = ring->stage ?
+		dispatch_start_get() : g_get_monotonic_time();
+	g_atomic_int_set(&ring->tail, tail + 1);
+	session_ring_wake(ring, &ring->consumer_waiting);
+
+	/* Other threads read the statistics, see sr_session_queue_stats_get(). */
+	g_mutex_lock(&ring->session->stats_mutex);
+	if (packet)
+		stats->packets_queued++;
+	if (fill + 1 > stats->high_water)
+		stats->high_water = fill + 1;
+	g_mutex_unlock(&ring->session->stats_mutex);
+
+	return SR_OK;
+}
+
+static struct session_ring *session_ring_new(struct sr_session *session,
+		struct session_stage *stage, uint32_t depth,
+		struct sr_session_queue_stats *stats)
+{
+	struct session_ring *ring;
+	guint capacity;
+
+	/* Round the capacity up to a power of two. */
+	capacity = 1;
+	while (capacity < depth)
+		capacity <<= 1;
+
+	ring = g_malloc0(sizeof(*ring));
+	ring->session = session;
+	ring->stage = stage;
+	ring->stats = stats;
+	ring->slots = g_malloc0_n(capacity, sizeof(ring->slots[0]));
+	ring->mask = capacity - 1;
+	/* Pipeline stages never drop, their input is processed data. */
+	ring->drop_on_overflow = !stage && session->drop_on_overflow;
+	ring->dump = sr_log_enabled(SR_LOG_DBG);
+	ring->callbacks = stage ?
+		stage == g_slist_last(session->stages)->data : !session->stages;
+	g_mutex_init(&ring->mutex);
+	g_cond_init(&ring->cond);
+
+	g_mutex_lock(&session->stats_mutex);
+	memset(stats, 0, sizeof(*stats));
+	stats->capacity = capacity;
+	g_mutex_unlock(&session->stats_mutex);
+
+	ring->thread = g_thread_try_new(stage ? "sr-transform" : "sr-session",
+		session_ring_consumer, ring, NULL);
+	if (!ring->thread) {
+		sr_err("Failed to create session consumer thread.");
+		g_cond_clear(&ring->cond);
+		g_mutex_clear(&ring->mutex);
+		g_free(ring->slots);
+		g_free(ring);
+		return NULL;
+	}
+
+	return ring;
+}
+
+/* Let the consumer drain the ring, then terminate it. */
+static void session_ring_free(struct session_ring *ring)
+{
+	session_ring_push(ring, NULL, NULL);
+	g_thread_join(ring->thread);
+	g_cond_clear(&ring->cond);
+	g_mutex_clear(&ring->mutex);
+	g_free(ring->slots);
+	g_free(ring);
+}
+
+/* Stop the pipeline stages in order, each one drains into the next. */
+static void session_stages_stop(struct sr_session *session)
+{
+	struct session_stage *stage;
+	struct sr_transform *t;
+	GSList *l;
+
+	for (l = session->stages; l; l = l->next) {
+		stage = l->data;
+		if (stage->ring)
+			session_ring_free(stage->ring);
+	}
+	for (l = session->transforms; l; l = l->next) {
+		t = l->data;
+		t->stage = NULL;
+		t->buffers = &session->transform_buffers;
+	}
+	for (l = session->stages; l; l = l->next) {
+		stage = l->data;
+		transform_buffers_free(&stage->buffers);
+		g_free(stage);
+	}
+	g_slist_free(session->stages);
+	session->stages = NULL;
+}
+
+/* Start a pipeline stage for each threaded transform. */
+static int session_stages_start(struct sr_session *session)
+{
+	struct session_stage *stage;
+	struct sr_transform *t;
+	GSList *l;
+	uint32_t depth;
+
+	depth = session->queue_depth ? session->queue_depth : SESSION_QUEUE_DEPTH;
+	stage = NULL;
+	for (l = session->transforms; l; l = l->next) {
 		t = l->data;
-		sr_spew("Running transform module '%s'.", t->module->id);
-		ret = t->module->receive(t, packet_in, &packet_out);
-		if (ret < 0) {
-			sr_err("Error while running transform module: %d.", ret);
+		if (t->threaded) {
+			stage = g_malloc0(sizeof(*stage));
+			stage->first = l;
+			stage->buffers.current = -1;
+			session->stages = g_slist_append(session->stages, stage);
+			t->stage = stage;
+		}
+		if (stage)
+			t->buffers = &stage->buffers;
+	}
+
+	for (l = session->stages; l; l = l->next) {
+		stage = l->data;
+		stage->ring = session_ring_new(session, stage, depth, &stage->stats);
+		if (!stage->ring) {
+			session_stages_stop(session);
 			return SR_ERR;
 		}
-		if (!packet_out) {
-			/*
-			 * If any of the transforms don't return an output
-			 * packet, abort.
-			 */
-			sr_spew("Transform module didn't return a packet, aborting.");
-			return SR_OK;
-		} else {
-			/*
-			 * Use this transform module's output packet as input
-			 * for the next transform module.
-			 */
-			packet_in = packet_out;
+	}
+
+	return SR_OK;
+}
+
+static int session_ring_start(struct sr_session *session)
+{
+	struct session_ring *ring;
+	int ret;
+
+	if ((ret = session_stages_start(session)) != SR_OK)
+		return ret;
+	if (!session->threaded)
+		return SR_OK;
+
+	ring = session_ring_new(session, NULL, session->queue_depth,
+		&session->queue_stats);
+	if (!ring) {
+		session_stages_stop(session);
+		return SR_ERR;
+	}
+	g_mutex_lock(&session->stats_mutex);
+	session->ring = ring;
+	g_mutex_unlock(&session->stats_mutex);
+
+	return SR_OK;
+}
+
+/* Drain the session's queue, and then the pipeline stages. */
+static void session_ring_stop(struct sr_session *session)
+{
+	struct session_ring *ring;
+
+	ring = session->ring;
+	if (ring) {
+		session_ring_free(ring);
+		g_mutex_lock(&session->stats_mutex);
+		session->ring = NULL;
+		g_mutex_unlock(&session->stats_mutex);
+	}
+	session_stages_stop(session);
+}
+
+/*
+ * Pass a packet on to the consumer. In threaded mode the packet gets
+ * copied into the ring, otherwise it is processed right away.
+ */
+static int session_dispatch(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, gboolean dump)
+{
+	struct sr_datafeed_packet *copy;
+	struct session_ring *ring;
+	int64_t prev_us;
+	int ret;
+
+	ring = sdi->session->ring;
+	if (!ring) {
+		/* Packets may get sent while another one is processed. */
+		prev_us = dispatch_start_get();
+		dispatch_start_set(g_get_monotonic_time());
+		ret = session_process(sdi, packet, dump);
+		dispatch_start_set(prev_us);
+		return ret;
+	}
+
+	ret = sr_packet_copy(packet, &copy);
+	if (ret != SR_OK)
+		return ret;
+
+	return session_ring_push(ring, sdi, copy);
+}
+
+static void scratch_free(struct sr_session *session)
+{
+	g_slist_free_full(session->scratch_spill, g_free);
+	session->scratch_spill = NULL;
+	session->scratch_spilled = 0;
+	sr_mem_free_add(SR_MEM_SESSION, session->scratch_size);
+	g_free(session->scratch);
+	session->scratch = NULL;
+	session->scratch_size = session->scratch_used = 0;
+}
+
+/*
+ * Release the scratch memory once the outermost sr_session_send() call
+ * returns. When some of it had to be allocated separately, the scratch
+ * memory grows to hold all of it, next time.
+ */
+static void scratch_release(struct sr_session *session)
+{
+	size_t size;
+
+	if (--session->send_depth > 0)
+		return;
+	session->send_depth = 0;
+	if (session->scratch_spill) {
+		size = session->scratch_used + session->scratch_spilled;
+		scratch_free(session);
+		if ((session->scratch = g_try_malloc(size))) {
+			session->scratch_size = size;
+			sr_mem_alloc_add(SR_MEM_SESSION, size);
 		}
 	}
-	packet = packet_in;
+	session->scratch_used = 0;
+}
+
+/**
+ * Get scratch memory for the data of a packet which is about to be sent.
+ *
+ * The memory stays valid until the outermost sr_session_send() call of
+ * the session returns, then it gets reused. The session keeps it from
+ * one packet to the next, so drivers which convert data per transfer
+ * or per frame need no allocations once the memory has grown. There is
+ * no need to release it, and it must not be passed to g_free().
+ *
+ * @param sdi The device instance which is going to send the packet.
+ * @param size The size in bytes.
+ *
+ * @return The memory, suitably aligned for any type of sample data, or
+ *         NULL when it cannot get allocated.
+ *
+ * @private
+ */
+SR_PRIV void *sr_session_scratch_get(const struct sr_dev_inst *sdi,
+		size_t size)
+{
+	struct sr_session *session;
+	void *data;
+
+	if (!sdi || !(session = sdi->session))
+		return NULL;
+
+	size = (MAX(size, 1) + 15) & ~(size_t)15;
+	if (session->scratch_size - session->scratch_used >= size) {
+		data = session->scratch + session->scratch_used;
+		session->scratch_used += size;
+		return data;
+	}
 
-	/*
-	 * If the last transform did output a packet, pass it to all datafeed
-	 * callbacks.
-	 */
-	for (l = sdi->session->datafeed_callbacks; l; l = l->next) {
-		if (sr_log_loglevel_get() >= SR_LOG_DBG)
-			datafeed_dump(packet);
-		cb_struct = l->data;
-		cb_struct->cb(sdi, packet, cb_struct->cb_data);
+	/* Earlier memory must stay in place, this gets merged later. */
+	if (!(data = g_try_malloc(size)))
+		return NULL;
+	session->scratch_spill = g_slist_prepend(session->scratch_spill, data);
+	session->scratch_spilled += size;
+
+	return data;
+}
+
+static int session_send_check(const struct sr_dev_inst *sdi)
+{
+	if (!sdi) {
+		sr_err("%s: sdi was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (!sdi->session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_BUG;
 	}
 
 	return SR_OK;
 }
 
+/**
+ * Send a packet to whatever is listening on the datafeed bus.
+ *
+ * Hardware drivers use this to send a data packet to the frontend.
+ * Scratch memory from sr_session_scratch_get() gets reused after the
+ * outermost call returns.
+ *
+ * @param sdi TODO.
+ * @param packet The datafeed packet to send to the session bus.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	int ret;
+
+	if ((ret = session_send_check(sdi)) != SR_OK)
+		return ret;
+
+	if (!packet) {
+		sr_err("%s: packet was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	sr_trace(SR_TRACE_SESSION_SEND, SR_TRACE_INSTANT, packet->type);
+
+	sdi->session->send_depth++;
+	ret = session_dispatch(sdi, packet,
+		sr_log_enabled(SR_LOG_DBG));
+	scratch_release(sdi->session);
+
+	return ret;
+}
+
+/**
+ * Send a packet whose sample data is in a pool buffer.
+ *
+ * Consumers which keep the packet share the buffer instead of copying
+ * its content. Callers must not modify the buffer after the call when
+ * sr_buffer_is_shared() reports other users, and should continue in a
+ * fresh buffer from the pool.
+ *
+ * @param sdi The device instance which sends the packet.
+ * @param packet The datafeed packet to send to the session bus.
+ * @param buf The buffer which holds the packet's sample data.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_send_buffer(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, struct sr_buffer *buf)
+{
+	struct sr_buffer *prev;
+	int ret;
+
+	prev = sr_buffer_lend(buf);
+	ret = sr_session_send(sdi, packet);
+	sr_buffer_lend(prev);
+
+	return ret;
+}
+
+/*
+ * Determine how many packets starting at packets[0] can be combined into
+ * a single logic packet. Consecutive logic packets of the same unitsize
+ * qualify. Sets *contiguous when their data is adjacent in memory and can
+ * be passed on without copying.
+ */
+static size_t batch_logic_run(const struct sr_datafeed_packet *packets,
+		size_t count, uint64_t *total, gboolean *contiguous)
+{
+	const struct sr_datafeed_logic *first, *prev, *logic;
+	size_t n;
+
+	first = packets[0].payload;
+	prev = first;
+	*total = first->length;
+	*contiguous = TRUE;
+	for (n = 1; n < count; n++) {
+		if (packets[n].type != SR_DF_LOGIC)
+			break;
+		logic = packets[n].payload;
+		if (!logic || logic->unitsize != first->unitsize)
+			break;
+		if ((const uint8_t *)prev->data + prev->length != logic->data)
+			*contiguous = FALSE;
+		*total += logic->length;
+		prev = logic;
+	}
+
+	return n;
+}
+
+/*
+ * Determine how many analog packets starting at packets[0] describe one
+ * contiguous block of samples of the same channels and encoding.
+ */
+static size_t batch_analog_run(const struct sr_datafeed_packet *packets,
+		size_t count, uint32_t *num_samples)
+{
+	const struct sr_datafeed_analog *first, *prev, *analog;
+	size_t n, stride;
+
+	first = packets[0].payload;
+	prev = first;
+	*num_samples = first->num_samples;
+	if (!first->encoding || !first->meaning)
+		return 1;
+	stride = sr_analog_frame_size(first);
+	for (n = 1; n < count; n++) {
+		if (packets[n].type != SR_DF_ANALOG)
+			break;
+		analog = packets[n].payload;
+		if (!analog || analog->encoding != first->encoding ||
+				analog->meaning != first->meaning ||
+				analog->spec != first->spec)
+			break;
+		if ((const uint8_t *)prev->data + prev->num_samples * stride
+				!= analog->data)
+			break;
+		*num_samples += analog->num_samples;
+		prev = analog;
+	}
+
+	return n;
+}
+
+/**
+ * Send a batch of packets to whatever is listening on the datafeed bus.
+ *
+ * Drivers which have accumulated several packets (e.g. one per completed
+ * USB transfer) can hand them over in one call. Consecutive logic packets
+ * of the same unitsize get coalesced into a single packet, as do analog
+ * packets for the same channels and encoding which are adjacent in
+ * memory. Transforms and datafeed callbacks see the coalesced packets.
+ * Argument checks and log level lookups happen once per batch.
+ *
+ * Logic data which is not adjacent in memory is copied into a buffer
+ * which the session keeps for re-use, the caller's buffers need not
+ * remain valid after this call returns. Scratch memory gets reused after
+ * it returns, as with sr_session_send().
+ *
+ * @param sdi The device instance to send the packets from.
+ * @param packets Array of datafeed packets, in order.
+ * @param count Number of packets in the array.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_send_batch(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packets, size_t count)
+{
+	struct sr_session *session;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+	const struct sr_datafeed_logic *src;
+	gboolean dump, contiguous;
+	uint64_t total;
+	uint32_t num_samples;
+	size_t i, n, j;
+	uint8_t *wrptr;
+	int ret;
+
+	if ((ret = session_send_check(sdi)) != SR_OK)
+		return ret;
+	if (!packets && count) {
+		sr_err("%s: packets was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+	session = sdi->session;
+	dump = sr_log_enabled(SR_LOG_DBG);
+
+	session->send_depth++;
+	for (i = 0; i < count; i += n) {
+		n = 1;
+		if (packets[i].type == SR_DF_LOGIC && packets[i].payload) {
+			n = batch_logic_run(&packets[i], count - i,
+				&total, &contiguous);
+		} else if (packets[i].type == SR_DF_ANALOG && packets[i].payload) {
+			n = batch_analog_run(&packets[i], count - i,
+				&num_samples);
+		}
+		if (n == 1) {
+			ret = session_dispatch(sdi, &packets[i], dump);
+			if (ret != SR_OK)
+				break;
+			continue;
+		}
+
+		packet.type = packets[i].type;
+		if (packet.type == SR_DF_ANALOG) {
+			analog = *(const struct sr_datafeed_analog *)packets[i].payload;
+			analog.num_samples = num_samples;
+			packet.payload = &analog;
+		} else {
+			src = packets[i].payload;
+			logic.length = total;
+			logic.unitsize = src->unitsize;
+			logic.data = src->data;
+			if (!contiguous) {
+				if (session->batch_size < total) {
+					g_free(session->batch_buffer);
+					session->batch_buffer = g_malloc(total);
+					session->batch_size = total;
+				}
+				wrptr = session->batch_buffer;
+				for (j = i; j < i + n; j++) {
+					src = packets[j].payload;
+					memcpy(wrptr, src->data, src->length);
+					wrptr += src->length;
+				}
+				logic.data = session->batch_buffer;
+			}
+			packet.payload = &logic;
+		}
+		ret = session_dispatch(sdi, &packet, dump);
+		if (ret != SR_OK)
+			break;
+	}
+	scratch_release(session);
+
+	return ret;
+}
+
 /**
  * Add an event source for a file descriptor.
  *
@@ -1218,6 +3691,7 @@ SR_PRIV int sr_session_source_add_internal(struct sr_session *session,
 		return SR_ERR_BUG;
 	}
 	g_hash_table_insert(session->event_sources, key, source);
+	sr_session_poll_sources_changed();
 
 	if (session_source_attach(session, source) == 0)
 		return SR_ERR;
@@ -1469,6 +3943,7 @@ SR_PRIV int sr_session_source_destroyed(struct sr_session *session,
 		return SR_ERR_BUG;
 	}
 	g_hash_table_remove(session->event_sources, key);
+	sr_session_poll_sources_changed();
 
 	if (g_hash_table_size(session->event_sources) > 0)
 		return SR_OK;
@@ -1480,6 +3955,26 @@ SR_PRIV int sr_session_source_destroyed(struct sr_session *session,
 	return stop_check_later(session);
 }
 
+/**
+ * Get the size of the buffer which a packet copy shares with others.
+ *
+ * @param[in] packet A packet from sr_packet_copy().
+ *
+ * @returns The buffer size in bytes, or 0 when the packet has a buffer of
+ *          its own.
+ *
+ * @private
+ */
+SR_PRIV size_t sr_packet_shared_size(const struct sr_datafeed_packet *packet)
+{
+	struct sr_buffer *buf;
+
+	buf = packet ? packet_buffer(packet) : NULL;
+
+	/* Buffers outside of pools hold the packet's data only. */
+	return buf && buf->pool ? buf->size : 0;
+}
+
 static void copy_src(struct sr_config *src, struct sr_datafeed_meta *meta_copy)
 {
 	struct sr_config *item;
@@ -1494,6 +3989,26 @@ static void copy_src(struct sr_config *src, struct sr_datafeed_meta *meta_copy)
 	meta_copy->config = g_slist_append(meta_copy->config, item);
 }
 
+/**
+ * Copy a datafeed packet, for consumers which keep packets beyond the
+ * datafeed callback.
+ *
+ * Sample data which a producer sends from a pool buffer gets shared
+ * with the copy instead of copied. The buffer gets recycled after the
+ * last packet that shares it was released. Other sample data gets
+ * copied into a buffer of its own, which further copies share while
+ * the threaded session mode passes the packet on.
+ *
+ * The copy has a reference count of one. Consumers which pass a copy
+ * on to others take more references with sr_packet_ref() instead of
+ * copying it again.
+ *
+ * @param[in] packet The packet to copy.
+ * @param[out] copy The copy. Release it with sr_packet_unref().
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unknown packet type, or out of memory.
+ */
 SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		struct sr_datafeed_packet **copy)
 {
@@ -1501,19 +4016,29 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	struct sr_datafeed_meta *meta_copy;
 	const struct sr_datafeed_logic *logic;
 	struct sr_datafeed_logic *logic_copy;
+	const struct sr_datafeed_logic_rle *rle;
+	struct sr_datafeed_logic_rle *rle_copy;
 	const struct sr_datafeed_analog *analog;
 	struct sr_datafeed_analog *analog_copy;
 	struct sr_analog_encoding *encoding_copy;
 	struct sr_analog_meaning *meaning_copy;
 	struct sr_analog_spec *spec_copy;
+	struct sr_rational *rationals;
+	struct packet_copy *wrap;
 	uint8_t *payload;
+	size_t size;
+	int tag;
 
-	*copy = g_malloc0(sizeof(struct sr_datafeed_packet));
+	wrap = g_malloc0(sizeof(*wrap));
+	wrap->refcount = 1;
+	*copy = &wrap->packet;
 	(*copy)->type = packet->type;
 
 	switch (packet->type) {
 	case SR_DF_TRIGGER:
 	case SR_DF_END:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
 		/* No payload. */
 		break;
 	case SR_DF_HEADER:
@@ -1524,31 +4049,57 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	case SR_DF_META:
 		meta = packet->payload;
 		meta_copy = g_malloc0(sizeof(struct sr_datafeed_meta));
-		g_slist_foreach(meta->config, (GFunc)copy_src, meta_copy->config);
+		g_slist_foreach(meta->config, (GFunc)copy_src, meta_copy);
 		(*copy)->payload = meta_copy;
 		break;
 	case SR_DF_LOGIC:
 		logic = packet->payload;
 		logic_copy = g_malloc(sizeof(*logic_copy));
-		if (!logic_copy)
-			return SR_ERR;
 		logic_copy->length = logic->length;
 		logic_copy->unitsize = logic->unitsize;
-		logic_copy->data = g_malloc(logic->length * logic->unitsize);
-		if (!logic_copy->data) {
-			g_free(logic_copy);
-			return SR_ERR;
+		wrap->buffer = sr_buffer_lent_ref(logic->data, logic->length);
+		if (wrap->buffer) {
+			logic_copy->data = logic->data;
+		} else {
+			/* Copies wait in the session's queues. */
+			tag = sr_mem_tag_enter(SR_MEM_SESSION);
+			wrap->buffer = sr_buffer_new(logic->length);
+			sr_mem_tag_leave(tag);
+			memcpy(wrap->buffer->data, logic->data, logic->length);
+			logic_copy->data = wrap->buffer->data;
 		}
-		memcpy(logic_copy->data, logic->data, logic->length * logic->unitsize);
 		(*copy)->payload = logic_copy;
 		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		rle_copy = g_malloc(sizeof(*rle_copy));
+		*rle_copy = *rle;
+		rle_copy->offsets = g_malloc(rle->num_changes
+			* sizeof(rle->offsets[0]));
+		memcpy(rle_copy->offsets, rle->offsets,
+			rle->num_changes * sizeof(rle->offsets[0]));
+		rle_copy->values = g_malloc(rle->num_changes * rle->unitsize);
+		memcpy(rle_copy->values, rle->values,
+			rle->num_changes * rle->unitsize);
+		sr_mem_alloc_add(SR_MEM_SESSION, rle->num_changes
+			* (sizeof(rle->offsets[0]) + rle->unitsize));
+		(*copy)->payload = rle_copy;
+		break;
 	case SR_DF_ANALOG:
 		analog = packet->payload;
 		analog_copy = g_malloc(sizeof(*analog_copy));
-		analog_copy->data = g_malloc(
-				analog->encoding->unitsize * analog->num_samples);
-		memcpy(analog_copy->data, analog->data,
-				analog->encoding->unitsize * analog->num_samples);
+		/* Samples of all channels, at least one. */
+		size = sr_analog_data_size(analog);
+		wrap->buffer = sr_buffer_lent_ref(analog->data, size);
+		if (wrap->buffer) {
+			analog_copy->data = analog->data;
+		} else {
+			tag = sr_mem_tag_enter(SR_MEM_SESSION);
+			wrap->buffer = sr_buffer_new(size);
+			sr_mem_tag_leave(tag);
+			memcpy(wrap->buffer->data, analog->data, size);
+			analog_copy->data = wrap->buffer->data;
+		}
 		analog_copy->num_samples = analog->num_samples;
 #if GLIB_CHECK_VERSION(2, 67, 3)
 		encoding_copy = g_memdup2(analog->encoding, sizeof(*analog->encoding));
@@ -1559,6 +4110,19 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		meaning_copy = g_memdup(analog->meaning, sizeof(*analog->meaning));
 		spec_copy = g_memdup(analog->spec, sizeof(*analog->spec));
 #endif
+		/* Per-channel scaling, one entry per channel. */
+		size = MAX(g_slist_length(analog->meaning->channels), 1)
+			* sizeof(struct sr_rational);
+		if (analog->encoding->channel_scale) {
+			rationals = g_malloc(size);
+			memcpy(rationals, analog->encoding->channel_scale, size);
+			encoding_copy->channel_scale = rationals;
+		}
+		if (analog->encoding->channel_offset) {
+			rationals = g_malloc(size);
+			memcpy(rationals, analog->encoding->channel_offset, size);
+			encoding_copy->channel_offset = rationals;
+		}
 		analog_copy->encoding = encoding_copy;
 		analog_copy->meaning = meaning_copy;
 		analog_copy->meaning->channels = g_slist_copy(
@@ -1574,17 +4138,60 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	return SR_OK;
 }
 
-SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
+/**
+ * Take a reference to a packet copy.
+ *
+ * @param[in] packet A packet from sr_packet_copy().
+ *
+ * @return The packet. Release the reference with sr_packet_unref().
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_datafeed_packet *sr_packet_ref(
+		struct sr_datafeed_packet *packet)
+{
+	struct packet_copy *wrap;
+
+	if (!packet)
+		return NULL;
+
+	wrap = (struct packet_copy *)packet;
+	g_atomic_int_inc(&wrap->refcount);
+
+	return packet;
+}
+
+/**
+ * Release a reference to a packet copy. The packet gets freed when the
+ * last reference is gone.
+ *
+ * Only packets from sr_packet_copy() may be passed. Packets which the
+ * caller built itself are not reference counted, the caller frees them.
+ *
+ * @param[in] packet A packet from sr_packet_copy(). May be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_packet_unref(struct sr_datafeed_packet *packet)
 {
 	const struct sr_datafeed_meta *meta;
-	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
 	const struct sr_datafeed_analog *analog;
+	struct packet_copy *wrap;
 	struct sr_config *src;
 	GSList *l;
 
+	if (!packet)
+		return;
+	wrap = (struct packet_copy *)packet;
+	if (!g_atomic_int_dec_and_test(&wrap->refcount))
+		return;
+
 	switch (packet->type) {
 	case SR_DF_TRIGGER:
 	case SR_DF_END:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
 		/* No payload. */
 		break;
 	case SR_DF_HEADER:
@@ -1602,13 +4209,22 @@ SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
 		g_free((void *)packet->payload);
 		break;
 	case SR_DF_LOGIC:
-		logic = packet->payload;
-		g_free(logic->data);
+		sr_buffer_unref(wrap->buffer);
+		g_free((void *)packet->payload);
+		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		sr_mem_free_add(SR_MEM_SESSION, rle->num_changes
+			* (sizeof(rle->offsets[0]) + rle->unitsize));
+		g_free(rle->offsets);
+		g_free(rle->values);
 		g_free((void *)packet->payload);
 		break;
 	case SR_DF_ANALOG:
 		analog = packet->payload;
-		g_free(analog->data);
+		sr_buffer_unref(wrap->buffer);
+		g_free((void *)analog->encoding->channel_scale);
+		g_free((void *)analog->encoding->channel_offset);
 		g_free(analog->encoding);
 		g_slist_free(analog->meaning->channels);
 		g_free(analog->meaning);
@@ -1618,7 +4234,25 @@ SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
 	default:
 		sr_err("Unknown packet type %d", packet->type);
 	}
-	g_free(packet);
+	g_free(wrap);
+}
+
+/**
+ * Release a packet copy.
+ *
+ * Same as sr_packet_unref(), the packet gets freed when no other
+ * references to it are left.
+ *
+ * Since packet copies are reference counted, this only accepts packets
+ * from sr_packet_copy(). Earlier versions freed any packet whose payload
+ * was allocated the way sr_packet_copy() did, frontends which build
+ * packets themselves need to free them on their own now.
+ *
+ * @param[in] packet A packet from sr_packet_copy().
+ */
+SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
+{
+	sr_packet_unref(packet);
 }
 
 /** @} */
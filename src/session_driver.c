@@ -23,7 +23,10 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/time.h>
+#include <stdio.h>
+#include <string.h>
 #include <zip.h>
+#include <glib/gstdio.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -36,6 +39,32 @@
 
 SR_PRIV struct sr_dev_driver session_driver_info;
 
+/* One archive member holding (part of) a stream's samples. */
+struct session_chunk {
+	char *name;
+	/* Byte position of the chunk's first sample within its stream. */
+	uint64_t offset;
+	uint64_t size;
+	/* Position of the data in the file if stored uncompressed, or 0. */
+	uint64_t data_offset;
+	/* Size of an XOR encoded member, or 0 for raw samples. */
+	uint64_t encoded_size;
+};
+
+/* The logic data, or the samples of one analog channel. */
+struct session_stream {
+	/* Index into the analog channels, or -1 for logic data. */
+	int analog_index;
+	/* Analog samples are stored in this encoding instead of as floats. */
+	gboolean native;
+	struct sr_analog_encoding encoding;
+	/* struct session_chunk, sorted by position. */
+	GArray *chunks;
+	/* Number of summary levels, and their entries once read. */
+	guint summary_levels;
+	GBytes **summary;
+};
+
 struct session_vdev {
 	char *sessionfile;
 	char *capturefile;
@@ -46,126 +75,1284 @@ struct session_vdev {
 	int unitsize;
 	int num_logic_channels;
 	int num_analog_channels;
-	int cur_analog_channel;
 	GArray *analog_channels;
-	int cur_chunk;
+	/* struct session_stream, in playback order. */
+	GArray *streams;
+	/* Samples per level 0 summary entry as a shift, 0 without summary. */
+	unsigned int summary_shift;
+	/* Transition index of the logic data once needed, see edge_index.c. */
+	GBytes *edges;
+	unsigned int edges_shift;
+	uint64_t offset;
+	uint64_t limit_samples;
+	guint cur_stream;
+	guint cur_chunk;
+	/* Byte positions of the playback window within the current stream. */
+	uint64_t stream_pos;
+	uint64_t stream_end;
+	/* Read buffer, consumers can share it, see send_buffer(). */
+	struct sr_buffer *buffer;
+	uint8_t *buf;
+	/* The samples of the current chunk, if it is XOR encoded. */
+	float *decoded;
+	/* All chunks are stored uncompressed, and get sent from a mapping. */
+	gboolean mappable;
+	GMappedFile *mapped;
 	gboolean finished;
+	/* Devices whose logic data this device merges, and their playback. */
+	GSList *members;
+	struct merge_member *merge;
+	guint merge_count;
+	uint64_t merge_sent;
 };
 
 static const uint32_t devopts[] = {
 	SR_CONF_CAPTUREFILE | SR_CONF_SET,
 	SR_CONF_CAPTURE_UNITSIZE | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_CAPTURE_OFFSET | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_NUM_LOGIC_CHANNELS | SR_CONF_SET,
 	SR_CONF_NUM_ANALOG_CHANNELS | SR_CONF_SET,
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_SESSIONFILE | SR_CONF_SET,
 };
 
+static void streams_free(GArray *streams)
+{
+	struct session_stream *stream;
+	guint i, j;
+
+	if (!streams)
+		return;
+	for (i = 0; i < streams->len; i++) {
+		stream = &g_array_index(streams, struct session_stream, i);
+		for (j = 0; j < stream->chunks->len; j++)
+			g_free(g_array_index(stream->chunks,
+				struct session_chunk, j).name);
+		g_array_free(stream->chunks, TRUE);
+		for (j = 0; j < stream->summary_levels; j++) {
+			if (stream->summary[j])
+				g_bytes_unref(stream->summary[j]);
+		}
+		g_free(stream->summary);
+	}
+	g_array_free(streams, TRUE);
+}
+
+static gint chunk_compare(gconstpointer a, gconstpointer b)
+{
+	const struct session_chunk *ca, *cb;
+
+	/* The chunk number is kept in the offset until sorted. */
+	ca = a;
+	cb = b;
+	if (ca->offset < cb->offset)
+		return -1;
+
+	return ca->offset > cb->offset;
+}
+
+/*
+ * Find where the data of uncompressed archive members is located in
+ * the file. libzip does not provide this, so it gets taken from the
+ * central directory. Returns a table of member name to data position,
+ * or NULL if the file cannot be parsed.
+ */
+static GHashTable *stored_members(const char *filename)
+{
+	GHashTable *members;
+	GArray *all;
+	const struct sr_zip_member *member;
+	FILE *f;
+	uint64_t *data_offset, offset;
+	guint i;
+
+	if (!(f = g_fopen(filename, "rb")))
+		return NULL;
+
+	members = NULL;
+	if ((all = sr_sessionfile_members(f))) {
+		members = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, g_free);
+		for (i = 0; i < all->len; i++) {
+			member = &g_array_index(all, struct sr_zip_member, i);
+			if (member->method != ZIP_CM_STORE
+					|| member->size != member->comp_size)
+				continue;
+			if (!(offset = sr_sessionfile_member_data(f, member)))
+				continue;
+			data_offset = g_malloc(sizeof(*data_offset));
+			*data_offset = offset;
+			g_hash_table_insert(members, g_strdup(member->name),
+				data_offset);
+		}
+		sr_sessionfile_members_free(all);
+	}
+	fclose(f);
+
+	return members;
+}
+
+/* Get the decoded size of an XOR encoded member from its header. */
+static gboolean encoded_size(struct zip *archive, zip_int64_t index,
+		uint64_t *size)
+{
+	struct zip_file *zf;
+	uint8_t header[4];
+	size_t count;
+	gboolean ok;
+
+	if (!(zf = zip_fopen_index(archive, index, 0)))
+		return FALSE;
+	ok = zip_fread(zf, header, sizeof(header)) == sizeof(header)
+		&& sr_analog_xor_count(header, sizeof(header), &count) == SR_OK;
+	zip_fclose(zf);
+	if (ok)
+		*size = (uint64_t)count * sizeof(float);
+
+	return ok;
+}
+
+/*
+ * Collect the chunks of one stream, see sr_sessionfile_chunk_number()
+ * for how they are named.
+ */
+static GArray *stream_index(struct zip *archive, const char *base,
+		GHashTable *stored, gboolean analog)
+{
+	GArray *chunks;
+	struct session_chunk chunk;
+	struct zip_stat zs;
+	zip_int64_t num_entries, i;
+	uint64_t offset, number;
+	const char *name;
+	uint64_t *data_offset;
+	gboolean encoded;
+	guint j;
+
+	chunks = g_array_new(FALSE, FALSE, sizeof(struct session_chunk));
+	num_entries = zip_get_num_entries(archive, 0);
+	for (i = 0; i < num_entries; i++) {
+		if (zip_stat_index(archive, i, 0, &zs) < 0)
+			continue;
+		name = zs.name;
+		if (!sr_sessionfile_chunk_number(name, base, analog,
+				&number, &encoded))
+			continue;
+		chunk.name = g_strdup(name);
+		chunk.offset = number;
+		chunk.size = zs.size;
+		chunk.data_offset = 0;
+		chunk.encoded_size = 0;
+		if (encoded) {
+			chunk.encoded_size = zs.size;
+			if (!encoded_size(archive, i, &chunk.size)) {
+				sr_warn("Cannot read header of %s, ignoring.", name);
+				g_free(chunk.name);
+				continue;
+			}
+		} else {
+			data_offset = stored ? g_hash_table_lookup(stored, name) : NULL;
+			chunk.data_offset = data_offset ? *data_offset : 0;
+		}
+		g_array_append_val(chunks, chunk);
+	}
+	g_array_sort(chunks, chunk_compare);
+
+	offset = 0;
+	for (j = 0; j < chunks->len; j++) {
+		g_array_index(chunks, struct session_chunk, j).offset = offset;
+		offset += g_array_index(chunks, struct session_chunk, j).size;
+	}
+
+	return chunks;
+}
+
+/* Get the parameters of the summary of the samples, if the file has one. */
+static unsigned int summary_shift(struct zip *archive)
+{
+	GKeyFile *kf;
+	struct zip_stat zs;
+	unsigned int shift;
+
+	if (zip_stat(archive, "summary", 0, &zs) < 0)
+		return 0;
+	if (!(kf = sr_sessionfile_read_metadata(archive, &zs)))
+		return 0;
+	shift = 0;
+	if (g_key_file_get_integer(kf, "summary", "version", NULL) == 1)
+		shift = g_key_file_get_integer(kf, "summary", "shift", NULL);
+	g_key_file_free(kf);
+
+	return shift < 64 ? shift : 0;
+}
+
+/* Get the name of a summary level's member, see summary.c. */
+static char *summary_name(const struct session_vdev *vdev,
+		const struct session_stream *stream, guint level)
+{
+	if (stream->analog_index < 0)
+		return g_strdup_printf("summary-logic-1-%u", level);
+
+	return g_strdup_printf("summary-analog-1-%d-%u",
+		vdev->num_logic_channels + stream->analog_index + 1, level);
+}
+
+/* Count the summary levels of a stream. */
+static void summary_index(const struct session_vdev *vdev,
+		struct zip *archive, struct session_stream *stream)
+{
+	char *name;
+
+	stream->summary_levels = 0;
+	stream->summary = NULL;
+	if (!vdev->summary_shift)
+		return;
+	for (;; stream->summary_levels++) {
+		name = summary_name(vdev, stream, stream->summary_levels);
+		if (zip_name_locate(archive, name, 0) < 0) {
+			g_free(name);
+			break;
+		}
+		g_free(name);
+	}
+	stream->summary = g_malloc0_n(MAX(stream->summary_levels, 1),
+		sizeof(stream->summary[0]));
+}
+
+static size_t stream_unitsize(const struct session_vdev *vdev,
+		const struct session_stream *stream)
+{
+	if (stream->native)
+		return stream->encoding.unitsize;
+	if (stream->analog_index >= 0)
+		return sizeof(float);
+
+	return vdev->unitsize;
+}
+
+/* Read the encodings of analog streams which are stored natively. */
+static int analog_encodings(const struct session_vdev *vdev,
+		struct zip *archive)
+{
+	struct session_stream *stream;
+	GKeyFile *kf;
+	struct zip_stat zs;
+	guint i;
+	int ret;
+
+	if (zip_stat(archive, "metadata", 0, &zs) < 0)
+		return SR_ERR_DATA;
+	if (!(kf = sr_sessionfile_read_metadata(archive, &zs)))
+		return SR_ERR_DATA;
+	ret = SR_OK;
+	for (i = 0; i < vdev->streams->len && ret == SR_OK; i++) {
+		stream = &g_array_index(vdev->streams, struct session_stream, i);
+		if (stream->analog_index < 0)
+			continue;
+		ret = sr_sessionfile_analog_encoding(kf,
+			vdev->num_logic_channels + stream->analog_index + 1,
+			&stream->encoding);
+		stream->native = ret == SR_OK;
+		if (ret == SR_ERR_NA)
+			ret = SR_OK;
+	}
+	g_key_file_free(kf);
+
+	return ret;
+}
+
+/**
+ * Build the index of the sample data chunks in a session file.
+ *
+ * Must be called after the device's capture file and channel counts
+ * have been configured.
+ *
+ * @param sdi The virtual session device.
+ * @param archive The opened session file.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_DATA A stream has no data in the archive.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_driver_index_build(const struct sr_dev_inst *sdi,
+		struct zip *archive)
+{
+	struct session_vdev *vdev;
+	struct session_stream stream;
+	struct session_chunk *chunk;
+	GHashTable *stored;
+	char *base;
+	int ret, i;
+	guint j, k;
+
+	vdev = sdi->priv;
+
+	streams_free(vdev->streams);
+	vdev->streams = g_array_new(FALSE, FALSE, sizeof(struct session_stream));
+	stored = stored_members(vdev->sessionfile);
+	vdev->summary_shift = summary_shift(archive);
+	if (vdev->edges) {
+		g_bytes_unref(vdev->edges);
+		vdev->edges = NULL;
+	}
+
+	ret = SR_OK;
+	if (vdev->capturefile) {
+		stream.analog_index = -1;
+		stream.native = FALSE;
+		stream.chunks = stream_index(archive, vdev->capturefile, stored,
+			FALSE);
+		summary_index(vdev, archive, &stream);
+		g_array_append_val(vdev->streams, stream);
+		if (!stream.chunks->len) {
+			sr_err("No capture file '%s' in session file '%s'.",
+				vdev->capturefile, vdev->sessionfile);
+			ret = SR_ERR_DATA;
+		}
+	}
+	for (i = 0; i < vdev->num_analog_channels; i++) {
+		base = g_strdup_printf("analog-1-%d",
+			vdev->num_logic_channels + i + 1);
+		stream.analog_index = i;
+		stream.native = FALSE;
+		stream.chunks = stream_index(archive, base, stored, TRUE);
+		summary_index(vdev, archive, &stream);
+		g_array_append_val(vdev->streams, stream);
+		g_free(base);
+	}
+	if (stored)
+		g_hash_table_destroy(stored);
+	if (vdev->num_analog_channels && ret == SR_OK)
+		ret = analog_encodings(vdev, archive);
+
+	/*
+	 * Sample data can be sent straight from a mapping of the file if
+	 * no chunk is compressed or encoded. Analog samples must be
+	 * aligned to their size.
+	 */
+	vdev->mappable = stored && vdev->streams->len;
+	for (j = 0; j < vdev->streams->len && vdev->mappable; j++) {
+		stream = g_array_index(vdev->streams, struct session_stream, j);
+		for (k = 0; k < stream.chunks->len; k++) {
+			chunk = &g_array_index(stream.chunks, struct session_chunk, k);
+			if (!chunk->data_offset || (stream.analog_index >= 0
+					&& chunk->data_offset
+						% stream_unitsize(vdev, &stream))) {
+				vdev->mappable = FALSE;
+				break;
+			}
+		}
+	}
+
+	sr_dbg("Indexed %u streams in '%s'%s.", vdev->streams->len,
+		vdev->sessionfile, vdev->mappable ? ", uncompressed" : "");
+
+	return ret;
+}
+
+/* Map the session file, if all of its chunks can be sent from there. */
+static void session_map(struct session_vdev *vdev)
+{
+	struct session_stream *stream;
+	struct session_chunk *chunk;
+	GError *error;
+	gsize length;
+	guint i, j;
+
+	/*
+	 * Transforms may modify sample data in place. A writable mapping
+	 * is private to the process, pages only get copied when touched.
+	 */
+	error = NULL;
+	vdev->mapped = g_mapped_file_new(vdev->sessionfile, TRUE, &error);
+	if (!vdev->mapped) {
+		sr_dbg("Cannot map session file: %s", error->message);
+		g_error_free(error);
+		return;
+	}
+
+	length = g_mapped_file_get_length(vdev->mapped);
+	for (i = 0; i < vdev->streams->len; i++) {
+		stream = &g_array_index(vdev->streams, struct session_stream, i);
+		for (j = 0; j < stream->chunks->len; j++) {
+			chunk = &g_array_index(stream->chunks, struct session_chunk, j);
+			if (chunk->data_offset > length
+					|| chunk->size > length - chunk->data_offset) {
+				sr_dbg("Chunk %s exceeds the file, not mapping.",
+					chunk->name);
+				g_mapped_file_unref(vdev->mapped);
+				vdev->mapped = NULL;
+				return;
+			}
+		}
+	}
+	sr_dbg("Mapped session file '%s'.", vdev->sessionfile);
+}
+
+/* The part of one chunk which a bulk read copies to its buffer. */
+struct read_task {
+	const struct session_chunk *chunk;
+	/* Byte position within the chunk, and length. */
+	uint64_t start;
+	uint64_t len;
+	uint8_t *dest;
+};
+
+struct read_job {
+	const char *filename;
+	GArray *tasks;
+	gint next;
+	gint error;
+};
+
+/* Read a stored chunk's part straight from the file. */
+static int task_read_stored(struct read_task *task, const char *filename,
+		FILE **file)
+{
+	if (!*file && !(*file = g_fopen(filename, "rb")))
+		return SR_ERR_IO;
+	if (!sr_sessionfile_read_at(*file, task->chunk->data_offset + task->start,
+			task->dest, task->len))
+		return SR_ERR_IO;
+
+	return SR_OK;
+}
+
+/* Decode an XOR encoded chunk, and copy out the part. */
+static int task_read_encoded(struct read_task *task, struct zip *archive)
+{
+	const struct session_chunk *chunk;
+	struct zip_file *zf;
+	uint8_t *data;
+	float *decoded;
+	zip_int64_t ret;
+	int err;
+
+	chunk = task->chunk;
+	if (!(zf = zip_fopen(archive, chunk->name, 0)))
+		return SR_ERR_IO;
+	data = g_try_malloc(chunk->encoded_size);
+	decoded = g_try_malloc(chunk->size);
+	ret = -1;
+	if (data && decoded)
+		ret = zip_fread(zf, data, chunk->encoded_size);
+	zip_fclose(zf);
+	err = SR_ERR_DATA;
+	if (ret >= 0 && (uint64_t)ret == chunk->encoded_size)
+		err = sr_analog_xor_decode(data, chunk->encoded_size,
+			decoded, chunk->size / sizeof(float));
+	if (err == SR_OK)
+		memcpy(task->dest, (uint8_t *)decoded + task->start, task->len);
+	g_free(data);
+	g_free(decoded);
+
+	return err;
+}
+
+/*
+ * Decompress a chunk up to the end of the part. The decompressed data
+ * before the part gets skipped through the destination buffer.
+ */
+static int task_read_compressed(struct read_task *task, struct zip *archive)
+{
+	struct zip_file *zf;
+	uint64_t skip, done;
+	zip_int64_t ret;
+
+	if (!(zf = zip_fopen(archive, task->chunk->name, 0)))
+		return SR_ERR_IO;
+	ret = 1;
+	for (skip = task->start; skip && ret > 0; skip -= ret)
+		ret = zip_fread(zf, task->dest, MIN(skip, task->len));
+	for (done = 0; done < task->len && ret > 0; done += ret)
+		ret = zip_fread(zf, task->dest + done, task->len - done);
+	zip_fclose(zf);
+
+	return ret > 0 ? SR_OK : SR_ERR_DATA;
+}
+
+/* Worker of a bulk read, taking tasks until none are left. */
+static gpointer read_worker(gpointer data)
+{
+	struct read_job *job;
+	struct read_task *task;
+	struct zip *archive;
+	FILE *file;
+	guint i;
+	int ret;
+
+	job = data;
+	archive = NULL;
+	file = NULL;
+	while ((i = g_atomic_int_add(&job->next, 1)) < job->tasks->len
+			&& g_atomic_int_get(&job->error) == SR_OK) {
+		task = &g_array_index(job->tasks, struct read_task, i);
+		if (task->chunk->data_offset) {
+			ret = task_read_stored(task, job->filename, &file);
+		} else if (!archive
+				&& !(archive = zip_open(job->filename, 0, NULL))) {
+			ret = SR_ERR_IO;
+		} else if (task->chunk->encoded_size) {
+			ret = task_read_encoded(task, archive);
+		} else {
+			ret = task_read_compressed(task, archive);
+		}
+		if (ret != SR_OK) {
+			sr_err("Cannot read %s.", task->chunk->name);
+			g_atomic_int_compare_and_exchange(&job->error, SR_OK, ret);
+		}
+	}
+	if (archive)
+		zip_discard(archive);
+	if (file)
+		fclose(file);
+
+	return NULL;
+}
+
+/* Find the stream of the logic data, or of an analog channel. */
+static struct session_stream *stream_get(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch)
+{
+	struct session_vdev *vdev;
+	struct session_stream *stream;
+	struct zip *archive;
+	GSList *l;
+	guint i;
+	int analog_index, ret;
+
+	vdev = sdi->priv;
+	if (!vdev->streams) {
+		if (!(archive = zip_open(vdev->sessionfile, 0, NULL)))
+			return NULL;
+		ret = sr_session_driver_index_build(sdi, archive);
+		zip_discard(archive);
+		if (ret != SR_OK)
+			return NULL;
+	}
+
+	analog_index = -1;
+	if (ch && ch->type == SR_CHANNEL_ANALOG) {
+		for (l = sdi->channels; l && l->data != ch; l = l->next) {
+			if (((struct sr_channel *)l->data)->type == SR_CHANNEL_ANALOG)
+				analog_index++;
+		}
+		if (!l)
+			return NULL;
+		analog_index++;
+	}
+	for (i = 0; i < vdev->streams->len; i++) {
+		stream = &g_array_index(vdev->streams, struct session_stream, i);
+		if (stream->analog_index == analog_index)
+			return stream;
+	}
+
+	return NULL;
+}
+
+/**
+ * Get the number of samples of the logic data, or of an analog channel,
+ * in a loaded session file.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_driver_samples(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch, uint64_t *samples)
+{
+	const struct session_stream *stream;
+	const struct session_chunk *last;
+	size_t unitsize;
+
+	if (!(stream = stream_get(sdi, ch)))
+		return SR_ERR_NA;
+	if (!(unitsize = stream_unitsize(sdi->priv, stream)))
+		return SR_ERR_NA;
+
+	*samples = 0;
+	if (stream->chunks->len) {
+		last = &g_array_index(stream->chunks, struct session_chunk,
+			stream->chunks->len - 1);
+		*samples = (last->offset + last->size) / unitsize;
+	}
+
+	return SR_OK;
+}
+
+/* Convert natively stored analog samples to floats. */
+static int native_to_float(const struct session_stream *stream,
+		const uint8_t *data, uint64_t count, float *values)
+{
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+
+	if (!count)
+		return SR_OK;
+	sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
+	encoding = stream->encoding;
+	analog.data = (void *)data;
+	analog.num_samples = count;
+
+	return sr_analog_to_float(&analog, values);
+}
+
+/**
+ * Read samples of the logic data, or of an analog channel, from a
+ * loaded session file into a buffer. The chunks within the window get
+ * read by parallel threads, stored ones straight from the file.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_driver_read(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch, uint64_t offset, uint64_t *count,
+		void *buf)
+{
+	struct session_vdev *vdev;
+	const struct session_stream *stream;
+	const struct session_chunk *chunk;
+	struct read_job job;
+	struct read_task task;
+	GThread **threads;
+	uint64_t pos, end;
+	size_t unitsize;
+	guint i, num_threads;
+	uint8_t *dest;
+	int ret;
+
+	vdev = sdi->priv;
+	if (!(stream = stream_get(sdi, ch)))
+		return SR_ERR_NA;
+	if (!(unitsize = stream_unitsize(vdev, stream)))
+		return SR_ERR_NA;
+
+	/* Natively stored samples get read aside, and converted to floats. */
+	dest = buf;
+	if (stream->native && !(dest = g_try_malloc(*count * unitsize + 1)))
+		return SR_ERR_MALLOC;
+
+	job.filename = vdev->sessionfile;
+	job.tasks = g_array_new(FALSE, FALSE, sizeof(struct read_task));
+	job.next = 0;
+	job.error = SR_OK;
+	pos = offset * unitsize;
+	end = pos + *count * unitsize;
+	for (i = 0; i < stream->chunks->len && pos < end; i++) {
+		chunk = &g_array_index(stream->chunks, struct session_chunk, i);
+		if (pos >= chunk->offset + chunk->size)
+			continue;
+		task.chunk = chunk;
+		task.start = pos - chunk->offset;
+		task.len = MIN(end, chunk->offset + chunk->size) - pos;
+		task.dest = dest + (pos - offset * unitsize);
+		g_array_append_val(job.tasks, task);
+		pos += task.len;
+	}
+	*count = (pos - MIN(pos, offset * unitsize)) / unitsize;
+
+	num_threads = MIN(job.tasks->len, g_get_num_processors());
+	threads = g_malloc0_n(MAX(num_threads, 1), sizeof(threads[0]));
+	for (i = 1; i < num_threads; i++)
+		threads[i] = g_thread_new("session-read", read_worker, &job);
+	/* The calling thread is a worker as well. */
+	read_worker(&job);
+	for (i = 1; i < num_threads; i++)
+		g_thread_join(threads[i]);
+	g_free(threads);
+	g_array_free(job.tasks, TRUE);
+
+	sr_dbg("Read %" PRIu64 " samples in %u threads.", *count,
+		MAX(num_threads, 1));
+
+	ret = job.error;
+	if (stream->native) {
+		if (ret == SR_OK)
+			ret = native_to_float(stream, dest, *count, buf);
+		g_free(dest);
+	}
+
+	return ret;
+}
+
+/**
+ * Get the number of summary levels of the logic data, or of an analog
+ * channel, in a loaded session file, and the samples per entry of level
+ * 0 as a power of two.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_driver_summary_levels(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch, unsigned int *levels,
+		unsigned int *shift)
+{
+	const struct session_vdev *vdev;
+	const struct session_stream *stream;
+
+	vdev = sdi->priv;
+	if (!(stream = stream_get(sdi, ch)))
+		return SR_ERR_NA;
+	if (!stream->summary_levels)
+		return SR_ERR_NA;
+
+	*levels = stream->summary_levels;
+	*shift = vdev->summary_shift;
+
+	return SR_OK;
+}
+
+/* Read a summary level, it is kept for later reads. */
+static GBytes *summary_get(const struct session_vdev *vdev,
+		struct session_stream *stream, guint level)
+{
+	struct zip *archive;
+	struct zip_file *zf;
+	struct zip_stat zs;
+	uint8_t *data;
+	char *name;
+	zip_int64_t n;
+
+	if (stream->summary[level])
+		return stream->summary[level];
+
+	if (!(archive = zip_open(vdev->sessionfile, 0, NULL)))
+		return NULL;
+	name = summary_name(vdev, stream, level);
+	data = NULL;
+	zf = NULL;
+	if (zip_stat(archive, name, 0, &zs) == 0 && zs.size <= G_MAXSIZE
+			&& (data = g_try_malloc(MAX(zs.size, 1)))
+			&& (zf = zip_fopen_index(archive, zs.index, 0))) {
+		n = zip_fread(zf, data, zs.size);
+		if (n == (zip_int64_t)zs.size)
+			stream->summary[level] = g_bytes_new_take(data, zs.size);
+		else
+			g_free(data);
+	} else {
+		g_free(data);
+	}
+	if (zf)
+		zip_fclose(zf);
+	zip_discard(archive);
+	if (!stream->summary[level])
+		sr_err("Cannot read summary %s of '%s'.", name, vdev->sessionfile);
+	g_free(name);
+
+	return stream->summary[level];
+}
+
+/**
+ * Read entries of a summary level of a loaded session file, see
+ * summary.c for their contents.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_driver_summary_read(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch, unsigned int level, uint64_t offset,
+		uint64_t *count, void *buf)
+{
+	const struct session_vdev *vdev;
+	struct session_stream *stream;
+	GBytes *entries;
+	const uint8_t *data;
+	size_t entry_size;
+	uint64_t total;
+
+	vdev = sdi->priv;
+	if (!(stream = stream_get(sdi, ch)))
+		return SR_ERR_NA;
+	if (level >= stream->summary_levels)
+		return SR_ERR_NA;
+	if (stream->analog_index < 0 && (!ch || ch->type != SR_CHANNEL_LOGIC
+			|| ch->index >= 8 * vdev->unitsize))
+		return SR_ERR_ARG;
+	if (!(entries = summary_get(vdev, stream, level)))
+		return SR_ERR_IO;
+
+	entry_size = stream->analog_index < 0
+		? sr_summary_logic_entry_size(vdev->unitsize)
+		: sr_summary_analog_entry_size();
+	total = g_bytes_get_size(entries) / entry_size;
+	*count = offset < total ? MIN(*count, total - offset) : 0;
+	data = (const uint8_t *)g_bytes_get_data(entries, NULL)
+		+ offset * entry_size;
+	if (stream->analog_index < 0)
+		sr_summary_logic_unpack(data, vdev->unitsize, ch->index,
+			*count, buf);
+	else
+		sr_summary_analog_unpack(data, *count, buf);
+
+	return SR_OK;
+}
+
+/* Read the transition index which the srzip output stored, if any. */
+static GBytes *edges_stored(struct session_vdev *vdev, uint64_t samples)
+{
+	struct zip *archive;
+	struct zip_file *zf;
+	struct zip_stat zs;
+	const struct session_chunk *chunk;
+	GByteArray *entries;
+	GArray *chunks;
+	GKeyFile *kf;
+	unsigned int shift;
+	uint64_t num_entries;
+	guint i;
+	gboolean ok;
+
+	if (!(archive = zip_open(vdev->sessionfile, 0, NULL)))
+		return NULL;
+	shift = 0;
+	if (zip_stat(archive, "edges", 0, &zs) == 0
+			&& (kf = sr_sessionfile_read_metadata(archive, &zs))) {
+		shift = sr_edge_index_shift(kf);
+		g_key_file_free(kf);
+	}
+	if (!shift) {
+		zip_discard(archive);
+		return NULL;
+	}
+
+	entries = g_byte_array_new();
+	chunks = stream_index(archive, "edges-logic-1", NULL, FALSE);
+	ok = TRUE;
+	for (i = 0; i < chunks->len && ok; i++) {
+		chunk = &g_array_index(chunks, struct session_chunk, i);
+		ok = chunk->size <= G_MAXUINT - entries->len
+			&& (zf = zip_fopen(archive, chunk->name, 0));
+		if (!ok)
+			break;
+		g_byte_array_set_size(entries, entries->len + chunk->size);
+		ok = zip_fread(zf, entries->data + chunk->offset, chunk->size)
+			== (zip_int64_t)chunk->size;
+		zip_fclose(zf);
+	}
+	for (i = 0; i < chunks->len; i++)
+		g_free(g_array_index(chunks, struct session_chunk, i).name);
+	g_array_free(chunks, TRUE);
+	zip_discard(archive);
+
+	/* A capture which was not completed has an incomplete index. */
+	num_entries = (samples + (UINT64_C(1) << shift) - 1) >> shift;
+	if (!ok || entries->len
+			!= num_entries * sr_edge_index_entry_size(vdev->unitsize)) {
+		sr_dbg("Ignoring the transition index of '%s'.",
+			vdev->sessionfile);
+		g_byte_array_free(entries, TRUE);
+		return NULL;
+	}
+	vdev->edges_shift = shift;
+
+	return g_byte_array_free_to_bytes(entries);
+}
+
+/* Build the transition index from the samples. */
+static GBytes *edges_build(const struct sr_dev_inst *sdi, uint64_t samples)
+{
+	struct session_vdev *vdev;
+	struct sr_edge_index *ei;
+	uint8_t *buf;
+	uint64_t pos, count, window;
+	int ret;
+
+	vdev = sdi->priv;
+	window = MAX(CHUNKSIZE / vdev->unitsize, 1);
+	buf = g_malloc(window * vdev->unitsize);
+	ei = sr_edge_index_new(vdev->unitsize);
+	ret = SR_OK;
+	for (pos = 0; pos < samples && ret == SR_OK; pos += count) {
+		count = MIN(window, samples - pos);
+		ret = sr_session_driver_read(sdi, NULL, pos, &count, buf);
+		if (ret == SR_OK && !count)
+			ret = SR_ERR_DATA;
+		if (ret == SR_OK)
+			sr_edge_index_feed(ei, buf, count);
+	}
+	g_free(buf);
+	if (ret != SR_OK) {
+		sr_err("Cannot build the transition index of '%s'.",
+			vdev->sessionfile);
+		sr_edge_index_free(ei);
+		return NULL;
+	}
+	vdev->edges_shift = SR_EDGE_INDEX_SHIFT;
+	sr_dbg("Built the transition index of '%s'.", vdev->sessionfile);
+
+	return sr_edge_index_finish(ei);
+}
+
+/*
+ * Get the transition index of the logic data. Without one in the file
+ * it gets built once, and kept in a file next to the session file.
+ */
+static GBytes *edges_get(const struct sr_dev_inst *sdi, uint64_t samples)
+{
+	struct session_vdev *vdev;
+	GStatBuf st;
+	uint64_t num_entries;
+	char *path;
+
+	vdev = sdi->priv;
+	if (vdev->edges)
+		return vdev->edges;
+	if ((vdev->edges = edges_stored(vdev, samples)))
+		return vdev->edges;
+
+	if (g_stat(vdev->sessionfile, &st) < 0)
+		return NULL;
+	path = g_strconcat(vdev->sessionfile, ".edges", NULL);
+	num_entries = (samples + (UINT64_C(1) << SR_EDGE_INDEX_SHIFT) - 1)
+		>> SR_EDGE_INDEX_SHIFT;
+	vdev->edges = sr_edge_index_load(path, st.st_size, st.st_mtime,
+		vdev->unitsize, num_entries);
+	if (vdev->edges) {
+		vdev->edges_shift = SR_EDGE_INDEX_SHIFT;
+	} else if ((vdev->edges = edges_build(sdi, samples))) {
+		sr_edge_index_save(path, st.st_size, st.st_mtime,
+			vdev->unitsize, vdev->edges);
+	}
+	g_free(path);
+
+	return vdev->edges;
+}
+
+/* Find the first matching edge of a channel within a range of samples. */
+static int edge_scan(const struct sr_dev_inst *sdi, unsigned int index,
+		uint64_t first, uint64_t last, int match, uint64_t *pos)
+{
+	struct session_vdev *vdev;
+	uint8_t *buf, *mask;
+	uint64_t count, i;
+	size_t byte;
+	uint8_t bit;
+	gboolean rising;
+	int ret;
+
+	vdev = sdi->priv;
+	byte = index / 8;
+	bit = 1 << (index % 8);
+
+	/* The sample before the first one tells whether that is an edge. */
+	count = last - first + 2;
+	buf = g_malloc(count * vdev->unitsize);
+	if ((ret = sr_session_driver_read(sdi, NULL, first - 1, &count,
+			buf)) != SR_OK) {
+		g_free(buf);
+		return ret;
+	}
+	mask = g_malloc0(vdev->unitsize);
+	mask[byte] = bit;
+
+	ret = SR_ERR_NA;
+	i = 0;
+	while ((i = sr_logic_next_change(buf, vdev->unitsize, i, count,
+			mask)) < count) {
+		rising = (buf[i * vdev->unitsize + byte] & bit) != 0;
+		if (match == SR_TRIGGER_EDGE
+				|| rising == (match == SR_TRIGGER_RISING)) {
+			*pos = first - 1 + i;
+			ret = SR_OK;
+			break;
+		}
+	}
+	g_free(mask);
+	g_free(buf);
+
+	return ret;
+}
+
+/**
+ * Find the next edge of a logic channel after a sample in a loaded
+ * session file. Blocks of samples without an edge of the channel are
+ * skipped by means of the transition index, see edge_index.c.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_driver_edge_next(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch, uint64_t from, int match,
+		uint64_t *pos)
+{
+	struct session_vdev *vdev;
+	GBytes *edges;
+	const uint8_t *entries;
+	uint64_t samples, num_entries, block, start, lo, hi;
+	unsigned int first, last;
+	gsize len;
+	int ret;
+
+	vdev = sdi->priv;
+	if (!ch || ch->type != SR_CHANNEL_LOGIC || vdev->unitsize <= 0
+			|| ch->index >= 8 * vdev->unitsize)
+		return SR_ERR_ARG;
+	if (match != SR_TRIGGER_RISING && match != SR_TRIGGER_FALLING
+			&& match != SR_TRIGGER_EDGE)
+		return SR_ERR_ARG;
+	if ((ret = sr_session_driver_samples(sdi, NULL, &samples)) != SR_OK)
+		return ret;
+	if (from >= samples)
+		return SR_ERR_NA;
+	if (!(edges = edges_get(sdi, samples)))
+		return SR_ERR_IO;
+
+	entries = g_bytes_get_data(edges, &len);
+	num_entries = len / sr_edge_index_entry_size(vdev->unitsize);
+	start = from + 1;
+	block = start >> vdev->edges_shift;
+	for (; sr_edge_index_find(entries, num_entries, vdev->unitsize,
+			ch->index, &block, &first, &last); block++) {
+		lo = (block << vdev->edges_shift) + first;
+		hi = (block << vdev->edges_shift) + last;
+		if (hi < start)
+			continue;
+		if (lo >= start && match == SR_TRIGGER_EDGE) {
+			*pos = lo;
+			return SR_OK;
+		}
+		/* The edge's direction needs the samples of the block. */
+		ret = edge_scan(sdi, ch->index, MAX(lo, start), hi, match, pos);
+		if (ret != SR_ERR_NA)
+			return ret;
+	}
+
+	return SR_ERR_NA;
+}
+
+/*
+ * Position playback at the start of the window within the current
+ * stream. The chunk containing the first sample is found by a binary
+ * search, so no data before it needs to be decompressed.
+ */
+static void stream_seek(struct session_vdev *vdev)
+{
+	struct session_stream *stream;
+	struct session_chunk *chunk;
+	size_t unitsize;
+	guint lo, hi, mid;
+
+	stream = &g_array_index(vdev->streams, struct session_stream,
+		vdev->cur_stream);
+	unitsize = stream_unitsize(vdev, stream);
+
+	vdev->stream_pos = vdev->offset * unitsize;
+	if (vdev->limit_samples)
+		vdev->stream_end = vdev->stream_pos + vdev->limit_samples * unitsize;
+	else
+		vdev->stream_end = UINT64_MAX;
+
+	lo = 0;
+	hi = stream->chunks->len;
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+		chunk = &g_array_index(stream->chunks, struct session_chunk, mid);
+		if (chunk->offset <= vdev->stream_pos)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	vdev->cur_chunk = lo;
+}
+
+static void stream_next(struct session_vdev *vdev)
+{
+	if (++vdev->cur_stream < vdev->streams->len)
+		stream_seek(vdev);
+}
+
+/*
+ * Advance to the chunk holding the current playback position, moving
+ * on to the next chunk or stream as needed. Returns FALSE when there is
+ * no more data within the window.
+ */
+static gboolean chunk_find(struct session_vdev *vdev)
+{
+	struct session_stream *stream;
+	struct session_chunk *chunk;
+
+	while (vdev->cur_stream < vdev->streams->len) {
+		stream = &g_array_index(vdev->streams, struct session_stream,
+			vdev->cur_stream);
+		if (!stream_unitsize(vdev, stream)) {
+			sr_warn("Neither analog nor logic data. Ignoring.");
+			stream_next(vdev);
+			continue;
+		}
+		if (vdev->stream_pos >= vdev->stream_end
+				|| vdev->cur_chunk >= stream->chunks->len) {
+			stream_next(vdev);
+			continue;
+		}
+		chunk = &g_array_index(stream->chunks, struct session_chunk,
+			vdev->cur_chunk);
+		if (vdev->stream_pos >= chunk->offset + chunk->size) {
+			vdev->cur_chunk++;
+			continue;
+		}
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Decode all samples of an XOR encoded chunk. */
+static gboolean chunk_decode(struct session_vdev *vdev,
+		const struct session_chunk *chunk)
+{
+	struct zip_file *zf;
+	uint8_t *data;
+	zip_int64_t ret;
+	int err;
+
+	if (!(zf = zip_fopen(vdev->archive, chunk->name, 0)))
+		return FALSE;
+	data = g_try_malloc(chunk->encoded_size);
+	vdev->decoded = g_try_malloc(chunk->size);
+	ret = -1;
+	if (data && vdev->decoded)
+		ret = zip_fread(zf, data, chunk->encoded_size);
+	zip_fclose(zf);
+	err = SR_ERR_DATA;
+	if (ret >= 0 && (uint64_t)ret == chunk->encoded_size)
+		err = sr_analog_xor_decode(data, chunk->encoded_size,
+			vdev->decoded, chunk->size / sizeof(float));
+	g_free(data);
+	if (err != SR_OK) {
+		sr_err("Cannot decode %s.", chunk->name);
+		g_free(vdev->decoded);
+		vdev->decoded = NULL;
+		return FALSE;
+	}
+	sr_dbg("Decoded %s.", chunk->name);
+
+	return TRUE;
+}
+
+/* Open the chunk holding the current playback position. */
+static gboolean chunk_open(struct session_vdev *vdev)
+{
+	struct session_stream *stream;
+	struct session_chunk *chunk;
+	uint64_t skip;
+	zip_int64_t ret;
+
+	if (!chunk_find(vdev))
+		return FALSE;
+
+	stream = &g_array_index(vdev->streams, struct session_stream,
+		vdev->cur_stream);
+	chunk = &g_array_index(stream->chunks, struct session_chunk,
+		vdev->cur_chunk);
+
+	if (chunk->encoded_size)
+		return chunk_decode(vdev, chunk);
+
+	if (!(vdev->capfile = zip_fopen(vdev->archive, chunk->name, 0)))
+		return FALSE;
+	sr_dbg("Opened %s.", chunk->name);
+
+	/* Decompress up to the window's start within the chunk. */
+	skip = vdev->stream_pos - chunk->offset;
+	while (skip) {
+		ret = zip_fread(vdev->capfile, vdev->buf,
+			MIN(skip, CHUNKSIZE));
+		if (ret <= 0) {
+			zip_fclose(vdev->capfile);
+			vdev->capfile = NULL;
+			return FALSE;
+		}
+		skip -= ret;
+	}
+
+	return TRUE;
+}
+
+/*
+ * Send a packet whose data is in the read buffer. Consumers which keep
+ * the data share the buffer, reading continues in a new one then.
+ */
+static int send_buffer(struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet)
+{
+	struct session_vdev *vdev;
+	int ret;
+
+	vdev = sdi->priv;
+	ret = sr_session_send_buffer(sdi, packet, vdev->buffer);
+	if (sr_buffer_is_shared(vdev->buffer)) {
+		sr_buffer_unref(vdev->buffer);
+		vdev->buffer = sr_buffer_new(CHUNKSIZE);
+		vdev->buf = vdev->buffer->data;
+	}
+
+	return ret;
+}
+
 static gboolean stream_session_data(struct sr_dev_inst *sdi)
 {
 	struct session_vdev *vdev;
+	struct session_stream *stream;
+	struct session_chunk *chunk;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
-	struct zip_stat zs;
-	int ret, got_data;
-	char capturefile[128];
+	uint64_t len;
+	size_t unitsize;
 	void *buf;
+	int ret;
 
-	got_data = FALSE;
 	vdev = sdi->priv;
 
-	if (!vdev->capfile) {
-		/* No capture file opened yet, or finished with the last
-		 * chunked one. */
-		if (vdev->capturefile && (vdev->cur_chunk == 0)) {
-			/* capturefile is always the unchunked base name. */
-			if (zip_stat(vdev->archive, vdev->capturefile, 0, &zs) != -1) {
-				/* No chunks, just a single capture file. */
-				vdev->cur_chunk = 0;
-				if (!(vdev->capfile = zip_fopen(vdev->archive,
-						vdev->capturefile, 0)))
-					return FALSE;
-				sr_dbg("Opened %s.", vdev->capturefile);
-			} else {
-				/* Try as first chunk filename. */
-				snprintf(capturefile, sizeof(capturefile) - 1, "%s-1", vdev->capturefile);
-				if (zip_stat(vdev->archive, capturefile, 0, &zs) != -1) {
-					vdev->cur_chunk = 1;
-					if (!(vdev->capfile = zip_fopen(vdev->archive,
-							capturefile, 0)))
-						return FALSE;
-					sr_dbg("Opened %s.", capturefile);
-				} else {
-					sr_err("No capture file '%s' in " "session file '%s'.",
-							vdev->capturefile, vdev->sessionfile);
-					return FALSE;
-				}
-			}
-		} else {
-			/* Capture data is chunked, advance to the next chunk. */
-			vdev->cur_chunk++;
-			snprintf(capturefile, sizeof(capturefile) - 1, "%s-%d", vdev->capturefile,
-					vdev->cur_chunk);
-			if (zip_stat(vdev->archive, capturefile, 0, &zs) != -1) {
-				if (!(vdev->capfile = zip_fopen(vdev->archive,
-						capturefile, 0)))
-					return FALSE;
-				sr_dbg("Opened %s.", capturefile);
-			} else if (vdev->cur_analog_channel < vdev->num_analog_channels) {
-				vdev->capturefile = g_strdup_printf("analog-1-%d",
-						vdev->num_logic_channels + vdev->cur_analog_channel + 1);
-				vdev->cur_analog_channel++;
-				vdev->cur_chunk = 0;
-				return TRUE;
-			} else {
-				/* We got all the chunks, finish up. */
-				g_free(vdev->capturefile);
-
-				/* If the file has logic channels, the initial value for
-				 * capturefile is set by stream_session_data() - however only
-				 * once. In order to not mess this mechanism up, we simulate
-				 * this here if needed. For purely analog files, capturefile
-				 * is not set.
-				 */
-				if (vdev->num_logic_channels)
-					vdev->capturefile = g_strdup("logic-1");
-				else
-					vdev->capturefile = NULL;
-				return FALSE;
-			}
-		}
+	if (vdev->mapped) {
+		if (!chunk_find(vdev))
+			return FALSE;
+	} else if (!vdev->capfile && !vdev->decoded && !chunk_open(vdev)) {
+		return FALSE;
 	}
 
-	buf = g_malloc(CHUNKSIZE);
+	stream = &g_array_index(vdev->streams, struct session_stream,
+		vdev->cur_stream);
+	chunk = &g_array_index(stream->chunks, struct session_chunk,
+		vdev->cur_chunk);
+	unitsize = stream_unitsize(vdev, stream);
 
-	/* unitsize is not defined for purely analog session files. */
-	if (vdev->unitsize)
-		ret = zip_fread(vdev->capfile, buf,
-				CHUNKSIZE / vdev->unitsize * vdev->unitsize);
-	else
-		ret = zip_fread(vdev->capfile, buf, CHUNKSIZE);
+	len = MIN(chunk->offset + chunk->size, vdev->stream_end) - vdev->stream_pos;
+	len = MIN(len, CHUNKSIZE / unitsize * unitsize);
+	if (vdev->mapped) {
+		/* Send the samples straight from the file mapping. */
+		buf = g_mapped_file_get_contents(vdev->mapped)
+			+ chunk->data_offset + (vdev->stream_pos - chunk->offset);
+		ret = len;
+	} else if (vdev->decoded) {
+		buf = (uint8_t *)vdev->decoded + (vdev->stream_pos - chunk->offset);
+		ret = len;
+	} else {
+		buf = vdev->buf;
+		ret = zip_fread(vdev->capfile, buf, len);
+	}
 
 	if (ret > 0) {
-		if (vdev->cur_analog_channel != 0) {
-			got_data = TRUE;
+		if (stream->analog_index >= 0) {
 			packet.type = SR_DF_ANALOG;
 			packet.payload = &analog;
 			/* TODO: Use proper 'digits' value for this device (and its modes). */
 			sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
 			analog.meaning->channels = g_slist_prepend(NULL,
 					g_array_index(vdev->analog_channels,
-						struct sr_channel *, vdev->cur_analog_channel - 1));
-			analog.num_samples = ret / sizeof(float);
+						struct sr_channel *, stream->analog_index));
+			if (stream->native) {
+				encoding = stream->encoding;
+				spec.spec_digits = encoding.digits;
+			}
+			analog.num_samples = ret / unitsize;
 			analog.meaning->mq = SR_MQ_VOLTAGE;
 			analog.meaning->unit = SR_UNIT_VOLT;
 			analog.meaning->mqflags = SR_MQFLAG_DC;
-			analog.data = (float *) buf;
-		} else if (vdev->unitsize) {
-			got_data = TRUE;
+			analog.data = buf;
+		} else {
 			if (ret % vdev->unitsize != 0)
 				sr_warn("Read size %d not a multiple of the"
 					" unit size %d.", ret, vdev->unitsize);
@@ -174,36 +1361,323 @@ static gboolean stream_session_data(struct sr_dev_inst *sdi)
 			logic.length = ret;
 			logic.unitsize = vdev->unitsize;
 			logic.data = buf;
-		} else {
-			/*
-			 * Neither analog data, nor logic which has
-			 * unitsize, must be an unexpected API use.
-			 */
-			sr_warn("Neither analog nor logic data. Ignoring.");
 		}
-		if (got_data) {
-			vdev->bytes_read += ret;
+		vdev->bytes_read += ret;
+		vdev->stream_pos += ret;
+		if (buf == vdev->buf)
+			send_buffer(sdi, &packet);
+		else
 			sr_session_send(sdi, &packet);
-		}
-	} else {
-		/* done with this capture file */
+		if (stream->analog_index >= 0)
+			g_slist_free(analog.meaning->channels);
+	}
+	if (vdev->capfile && (ret <= 0
+			|| vdev->stream_pos >= chunk->offset + chunk->size
+			|| vdev->stream_pos >= vdev->stream_end)) {
+		/* Done with this chunk, or a short one. */
 		zip_fclose(vdev->capfile);
 		vdev->capfile = NULL;
-		if (vdev->cur_chunk != 0) {
-			/* There might be more chunks, so don't fall through
-			 * to the SR_DF_END here. */
-			got_data = TRUE;
+		if (ret <= 0)
+			vdev->stream_pos = chunk->offset + chunk->size;
+	}
+	if (vdev->decoded && (vdev->stream_pos >= chunk->offset + chunk->size
+			|| vdev->stream_pos >= vdev->stream_end)) {
+		g_free(vdev->decoded);
+		vdev->decoded = NULL;
+	}
+
+	return TRUE;
+}
+
+/*
+ * Merged playback of several session files. Each file's logic data gets
+ * read ahead by a thread of its own, in blocks which cycle between the
+ * thread and playback. Playback puts the samples of all files side by
+ * side into wide samples, repeating those of files with lower rates.
+ */
+
+/** @cond PRIVATE */
+#define MERGE_BLOCKS		4
+#define MERGE_BLOCK_SAMPLES	(256 * 1024)
+/** @endcond */
+
+struct merge_block {
+	uint8_t *data;
+	/* Number of samples, 0 at the end of the file's data. */
+	uint64_t count;
+};
+
+struct merge_member {
+	const struct sr_dev_inst *sdi;
+	size_t unitsize;
+	/* Position of the file's sample within the merged sample. */
+	size_t byte_offset;
+	/* Merged samples per sample of the file. */
+	uint64_t ratio;
+	/* The next sample which the reader reads. */
+	uint64_t pos;
+	gint stop;
+	GThread *thread;
+	GAsyncQueue *free_blocks;
+	GAsyncQueue *full_blocks;
+	struct merge_block blocks[MERGE_BLOCKS];
+	/* The block being played back, its sample, and that's repetition. */
+	struct merge_block *cur;
+	uint64_t idx;
+	uint64_t rep;
+};
+
+/**
+ * Setup a device which merges the logic data of other devices of loaded
+ * session files. Its samplerate is the highest of theirs, which all
+ * others must divide. The samples of each device start at a byte
+ * boundary within the merged samples.
+ *
+ * @param[in] sdi The merging device.
+ * @param[in] members The devices to merge, which must stay around.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_DATA A device has no logic data, or the samplerates
+ *         are incompatible.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_driver_merge_init(struct sr_dev_inst *sdi,
+		GSList *members)
+{
+	struct session_vdev *vdev, *mvdev;
+	struct sr_dev_inst *msdi;
+	struct sr_channel *ch;
+	GSList *l, *c;
+	uint64_t samplerate;
+	char *name, *rate, *max_rate;
+	int bit_base;
+	guint nr;
+
+	vdev = sdi->priv;
+	if (!members)
+		return SR_ERR_ARG;
+
+	samplerate = 0;
+	for (l = members; l; l = l->next) {
+		mvdev = ((struct sr_dev_inst *)l->data)->priv;
+		if (!mvdev->capturefile || !mvdev->unitsize
+				|| !mvdev->samplerate) {
+			sr_err("No logic data to merge in '%s'.",
+				mvdev->sessionfile);
+			return SR_ERR_DATA;
 		}
+		samplerate = MAX(samplerate, mvdev->samplerate);
+	}
+	for (l = members; l; l = l->next) {
+		mvdev = ((struct sr_dev_inst *)l->data)->priv;
+		if (samplerate % mvdev->samplerate == 0)
+			continue;
+		rate = sr_samplerate_string(mvdev->samplerate);
+		max_rate = sr_samplerate_string(samplerate);
+		sr_err("Cannot merge samplerates %s and %s.", rate, max_rate);
+		g_free(rate);
+		g_free(max_rate);
+		return SR_ERR_DATA;
 	}
-	g_free(buf);
 
-	return got_data;
+	bit_base = 0;
+	nr = 0;
+	for (l = members; l; l = l->next) {
+		msdi = l->data;
+		mvdev = msdi->priv;
+		nr++;
+		for (c = msdi->channels; c; c = c->next) {
+			ch = c->data;
+			if (ch->type != SR_CHANNEL_LOGIC)
+				continue;
+			name = g_strdup_printf("%u:%s", nr, ch->name);
+			sr_channel_new(sdi, bit_base + ch->index,
+				SR_CHANNEL_LOGIC, ch->enabled, name);
+			g_free(name);
+		}
+		bit_base += mvdev->unitsize * 8;
+	}
+
+	g_slist_free(vdev->members);
+	vdev->members = g_slist_copy(members);
+	vdev->samplerate = samplerate;
+	vdev->unitsize = bit_base / 8;
+	vdev->num_logic_channels = bit_base;
+	sr_dbg("Merging %u devices, %d bytes per sample.", nr, vdev->unitsize);
+
+	return SR_OK;
+}
+
+/* Reader thread of a merged device, reads blocks ahead of playback. */
+static gpointer merge_reader(gpointer data)
+{
+	struct merge_member *m;
+	struct merge_block *block;
+	uint64_t count;
+	int ret;
+
+	m = data;
+	for (;;) {
+		block = g_async_queue_pop(m->free_blocks);
+		if (g_atomic_int_get(&m->stop))
+			break;
+		count = MERGE_BLOCK_SAMPLES;
+		ret = sr_session_driver_read(m->sdi, NULL, m->pos, &count,
+			block->data);
+		if (ret != SR_OK) {
+			sr_err("Cannot read merged data: %s.", sr_strerror(ret));
+			count = 0;
+		}
+		m->pos += count;
+		block->count = count;
+		g_async_queue_push(m->full_blocks, block);
+		if (!count)
+			break;
+	}
+
+	return NULL;
+}
+
+static void merge_stop(struct session_vdev *vdev)
+{
+	struct merge_member *m;
+	guint i, j;
+
+	for (i = 0; i < vdev->merge_count; i++) {
+		m = &vdev->merge[i];
+		if (m->thread) {
+			g_atomic_int_set(&m->stop, 1);
+			g_async_queue_push(m->free_blocks, &m->blocks[0]);
+			g_thread_join(m->thread);
+		}
+		if (m->free_blocks)
+			g_async_queue_unref(m->free_blocks);
+		if (m->full_blocks)
+			g_async_queue_unref(m->full_blocks);
+		for (j = 0; j < MERGE_BLOCKS; j++)
+			g_free(m->blocks[j].data);
+	}
+	g_free(vdev->merge);
+	vdev->merge = NULL;
+	vdev->merge_count = 0;
+}
+
+static int merge_start(struct session_vdev *vdev)
+{
+	struct session_vdev *mvdev;
+	struct merge_member *m;
+	struct sr_dev_inst *msdi;
+	size_t byte_offset;
+	GSList *l;
+	guint j;
+
+	vdev->merge_count = g_slist_length(vdev->members);
+	vdev->merge = g_malloc0_n(vdev->merge_count, sizeof(vdev->merge[0]));
+	vdev->merge_sent = 0;
+	byte_offset = 0;
+	for (l = vdev->members, m = vdev->merge; l; l = l->next, m++) {
+		msdi = l->data;
+		mvdev = msdi->priv;
+		m->sdi = msdi;
+		m->unitsize = mvdev->unitsize;
+		m->byte_offset = byte_offset;
+		byte_offset += m->unitsize;
+		m->ratio = vdev->samplerate / mvdev->samplerate;
+		/* The merged device's offset is in merged samples. */
+		m->pos = mvdev->offset + vdev->offset / m->ratio;
+		m->rep = vdev->offset % m->ratio;
+		m->free_blocks = g_async_queue_new();
+		m->full_blocks = g_async_queue_new();
+		for (j = 0; j < MERGE_BLOCKS; j++) {
+			m->blocks[j].data = g_try_malloc(MERGE_BLOCK_SAMPLES
+				* m->unitsize);
+			if (!m->blocks[j].data) {
+				sr_err("Merge buffer malloc failed.");
+				return SR_ERR_MALLOC;
+			}
+			g_async_queue_push(m->free_blocks, &m->blocks[j]);
+		}
+		m->thread = g_thread_new("session-merge", merge_reader, m);
+	}
+
+	return SR_OK;
+}
+
+/* Send the next merged samples. Returns FALSE at the end of any file. */
+static gboolean merge_session_data(struct sr_dev_inst *sdi)
+{
+	struct session_vdev *vdev;
+	struct merge_member *m;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	const uint8_t *src;
+	uint8_t *dst;
+	uint64_t count, avail, j;
+	guint i;
+
+	vdev = sdi->priv;
+
+	count = CHUNKSIZE / vdev->unitsize;
+	if (vdev->limit_samples)
+		count = MIN(count, vdev->limit_samples - vdev->merge_sent);
+	if (!count)
+		return FALSE;
+
+	for (i = 0; i < vdev->merge_count; i++) {
+		m = &vdev->merge[i];
+		if (!m->cur || m->idx == m->cur->count) {
+			if (m->cur)
+				g_async_queue_push(m->free_blocks, m->cur);
+			m->cur = g_async_queue_pop(m->full_blocks);
+			m->idx = 0;
+			if (!m->cur->count)
+				return FALSE;
+		}
+		avail = (m->cur->count - m->idx) * m->ratio - m->rep;
+		count = MIN(count, avail);
+	}
+
+	for (i = 0; i < vdev->merge_count; i++) {
+		m = &vdev->merge[i];
+		src = m->cur->data + m->idx * m->unitsize;
+		dst = vdev->buf + m->byte_offset;
+		if (m->ratio == 1) {
+			for (j = 0; j < count; j++) {
+				memcpy(dst, src, m->unitsize);
+				src += m->unitsize;
+				dst += vdev->unitsize;
+			}
+			m->idx += count;
+			continue;
+		}
+		for (j = 0; j < count; j++) {
+			memcpy(dst, src, m->unitsize);
+			dst += vdev->unitsize;
+			if (++m->rep == m->ratio) {
+				m->rep = 0;
+				m->idx++;
+				src += m->unitsize;
+			}
+		}
+	}
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.length = count * vdev->unitsize;
+	logic.unitsize = vdev->unitsize;
+	logic.data = vdev->buf;
+	vdev->merge_sent += count;
+	send_buffer(sdi, &packet);
+
+	return TRUE;
 }
 
 static int receive_data(int fd, int revents, void *cb_data)
 {
 	struct sr_dev_inst *sdi;
 	struct session_vdev *vdev;
+	gboolean more;
 
 	(void)fd;
 	(void)revents;
@@ -211,11 +1685,20 @@ static int receive_data(int fd, int revents, void *cb_data)
 	sdi = cb_data;
 	vdev = sdi->priv;
 
-	if (!vdev->finished && !stream_session_data(sdi))
-		vdev->finished = TRUE;
+	if (!vdev->finished) {
+		if (vdev->members)
+			more = merge_session_data(sdi);
+		else
+			more = stream_session_data(sdi);
+		if (!more)
+			vdev->finished = TRUE;
+	}
 	if (!vdev->finished)
 		return G_SOURCE_CONTINUE;
 
+	if (vdev->merge)
+		merge_stop(vdev);
+
 	if (vdev->capfile) {
 		zip_fclose(vdev->capfile);
 		vdev->capfile = NULL;
@@ -224,6 +1707,17 @@ static int receive_data(int fd, int revents, void *cb_data)
 		zip_discard(vdev->archive);
 		vdev->archive = NULL;
 	}
+	if (vdev->mapped) {
+		g_mapped_file_unref(vdev->mapped);
+		vdev->mapped = NULL;
+	}
+	sr_buffer_unref(vdev->buffer);
+	vdev->buffer = NULL;
+	vdev->buf = NULL;
+	g_free(vdev->decoded);
+	vdev->decoded = NULL;
+	g_array_free(vdev->analog_channels, TRUE);
+	vdev->analog_channels = NULL;
 
 	std_session_send_df_end(sdi);
 
@@ -252,6 +1746,10 @@ static int dev_close(struct sr_dev_inst *sdi)
 	const struct session_vdev *const vdev = sdi->priv;
 	g_free(vdev->sessionfile);
 	g_free(vdev->capturefile);
+	streams_free(vdev->streams);
+	g_slist_free(vdev->members);
+	if (vdev->edges)
+		g_bytes_unref(vdev->edges);
 
 	g_free(sdi->priv);
 	sdi->priv = NULL;
@@ -278,6 +1776,12 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_CAPTURE_UNITSIZE:
 		*data = g_variant_new_uint64(vdev->unitsize);
 		break;
+	case SR_CONF_CAPTURE_OFFSET:
+		*data = g_variant_new_uint64(vdev->offset);
+		break;
+	case SR_CONF_LIMIT_SAMPLES:
+		*data = g_variant_new_uint64(vdev->limit_samples);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -294,6 +1798,17 @@ static int config_set(uint32_t key, GVariant *data,
 
 	vdev = sdi->priv;
 
+	switch (key) {
+	case SR_CONF_SESSIONFILE:
+	case SR_CONF_CAPTUREFILE:
+	case SR_CONF_NUM_LOGIC_CHANNELS:
+	case SR_CONF_NUM_ANALOG_CHANNELS:
+		/* The chunk index gets rebuilt upon acquisition start. */
+		streams_free(vdev->streams);
+		vdev->streams = NULL;
+		break;
+	}
+
 	switch (key) {
 	case SR_CONF_SAMPLERATE:
 		vdev->samplerate = g_variant_get_uint64(data);
@@ -318,6 +1833,12 @@ static int config_set(uint32_t key, GVariant *data,
 	case SR_CONF_NUM_ANALOG_CHANNELS:
 		vdev->num_analog_channels = g_variant_get_int32(data);
 		break;
+	case SR_CONF_CAPTURE_OFFSET:
+		vdev->offset = g_variant_get_uint64(data);
+		break;
+	case SR_CONF_LIMIT_SAMPLES:
+		vdev->limit_samples = g_variant_get_uint64(data);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -340,7 +1861,6 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 	vdev = sdi->priv;
 	vdev->bytes_read = 0;
-	vdev->cur_analog_channel = 0;
 	vdev->analog_channels = g_array_sized_new(FALSE, FALSE,
 			sizeof(struct sr_channel *), vdev->num_analog_channels);
 	for (l = sdi->channels; l; l = l->next) {
@@ -348,17 +1868,55 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		if (ch->type == SR_CHANNEL_ANALOG)
 			g_array_append_val(vdev->analog_channels, ch);
 	}
-	vdev->cur_chunk = 0;
 	vdev->finished = FALSE;
 
+	if (vdev->members) {
+		ret = merge_start(vdev);
+		if (ret != SR_OK) {
+			merge_stop(vdev);
+			g_array_free(vdev->analog_channels, TRUE);
+			vdev->analog_channels = NULL;
+			return ret;
+		}
+		vdev->buffer = sr_buffer_new(CHUNKSIZE);
+		vdev->buf = vdev->buffer->data;
+		std_session_send_df_header(sdi);
+		sr_session_source_add(sdi->session, -1, 0, 0, receive_data,
+			(void *)sdi);
+		return SR_OK;
+	}
+
 	sr_info("Opening archive %s file %s", vdev->sessionfile,
 		vdev->capturefile);
 
 	if (!(vdev->archive = zip_open(vdev->sessionfile, 0, &ret))) {
 		sr_err("Failed to open session file '%s': "
 		       "zip error %d.", vdev->sessionfile, ret);
+		g_array_free(vdev->analog_channels, TRUE);
+		vdev->analog_channels = NULL;
 		return SR_ERR;
 	}
+	if (!vdev->streams) {
+		ret = sr_session_driver_index_build(sdi, vdev->archive);
+		if (ret != SR_OK) {
+			zip_discard(vdev->archive);
+			vdev->archive = NULL;
+			g_array_free(vdev->analog_channels, TRUE);
+			vdev->analog_channels = NULL;
+			return ret;
+		}
+	}
+
+	if (vdev->mappable)
+		session_map(vdev);
+	if (!vdev->mapped) {
+		vdev->buffer = sr_buffer_new(CHUNKSIZE);
+		vdev->buf = vdev->buffer->data;
+	}
+
+	vdev->cur_stream = 0;
+	if (vdev->streams->len)
+		stream_seek(vdev);
 
 	std_session_send_df_header(sdi);
 
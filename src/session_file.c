@@ -24,6 +24,9 @@
 #include <errno.h>
 #include <glib.h>
 #include <glib/gstdio.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -31,6 +34,29 @@
 #define LOG_PREFIX "session-file"
 /** @endcond */
 
+#define ZIP_LOCAL_HEADER_SIG	0x04034b50
+#define ZIP_CENTRAL_HEADER_SIG	0x02014b50
+#define ZIP_END_SIG		0x06054b50
+#define ZIP64_END_SIG		0x06064b50
+#define ZIP64_LOCATOR_SIG	0x07064b50
+#define ZIP_LOCAL_HEADER_LEN	30
+#define ZIP_CENTRAL_HEADER_LEN	46
+#define ZIP_END_LEN		22
+#define ZIP64_END_LEN		56
+#define ZIP64_LOCATOR_LEN	20
+#define ZIP_MAX_COMMENT		0xffff
+#define ZIP_EXTRA_ZIP64_ID	0x0001
+#define ZIP_U16_MAX		0xffff
+#define ZIP_U32_MAX		0xffffffffUL
+
+/* Upper limit of the metadata size, and the inflate input chunk size. */
+#define METADATA_MAX_SIZE	(1024 * 1024)
+#define INFLATE_CHUNK_SIZE	(16 * 1024)
+
+/* Suffix and group of the index next to a session file. */
+#define INFO_INDEX_SUFFIX	".info"
+#define INFO_INDEX_GROUP	"session file info"
+
 /**
  * @file
  *
@@ -112,66 +138,554 @@ SR_PRIV GKeyFile *sr_sessionfile_read_metadata(struct zip *archive,
 }
 
 /** @private */
-SR_PRIV int sr_sessionfile_check(const char *filename)
+SR_PRIV gboolean sr_sessionfile_read_at(FILE *f, uint64_t offset,
+		void *buf, size_t len)
+{
+	if (fseeko(f, offset, SEEK_SET) < 0)
+		return FALSE;
+
+	return fread(buf, 1, len, f) == len;
+}
+
+/* Pick the 64-bit values from a central directory entry's Zip64 extra. */
+static void zip64_extra_parse(const uint8_t *extra, size_t len,
+		uint64_t *size, uint64_t *comp_size, uint64_t *offset)
+{
+	uint16_t id, field_len;
+	const uint8_t *p, *end;
+
+	while (len >= 4) {
+		id = read_u16le(extra);
+		field_len = read_u16le(extra + 2);
+		if (field_len > len - 4)
+			return;
+		if (id == ZIP_EXTRA_ZIP64_ID) {
+			p = extra + 4;
+			end = p + field_len;
+			if (*size == ZIP_U32_MAX && p + 8 <= end) {
+				*size = read_u64le(p);
+				p += 8;
+			}
+			if (*comp_size == ZIP_U32_MAX && p + 8 <= end) {
+				*comp_size = read_u64le(p);
+				p += 8;
+			}
+			if (*offset == ZIP_U32_MAX && p + 8 <= end)
+				*offset = read_u64le(p);
+			return;
+		}
+		extra += 4 + field_len;
+		len -= 4 + field_len;
+	}
+}
+
+/**
+ * Read the members of a session file from the ZIP central directory.
+ *
+ * This only reads the end of the file, and is much cheaper than opening
+ * the archive with libzip, which also checks every local header.
+ *
+ * @param[in] f The opened session file.
+ *
+ * @return An array of struct sr_zip_member, or NULL if the file is not
+ *         a ZIP archive. Free it with sr_sessionfile_members_free().
+ *
+ * @private
+ */
+SR_PRIV GArray *sr_sessionfile_members(FILE *f)
+{
+	GArray *members;
+	struct sr_zip_member member;
+	uint8_t *tail, *cd, *p, hdr[ZIP64_END_LEN];
+	uint64_t file_size, tail_off, cd_off, cd_size, count, i, offset;
+	size_t tail_len, pos, name_len, extra_len, comment_len;
+	gboolean found;
+
+	members = NULL;
+	tail = cd = NULL;
+	if (fseeko(f, 0, SEEK_END) < 0)
+		goto done;
+	file_size = ftello(f);
+	if (file_size < ZIP_END_LEN)
+		goto done;
+
+	/* The end record is followed by an up to 64k long comment. */
+	tail_len = MIN(file_size, ZIP_END_LEN + ZIP_MAX_COMMENT);
+	tail_off = file_size - tail_len;
+	tail = g_malloc(tail_len);
+	if (!sr_sessionfile_read_at(f, tail_off, tail, tail_len))
+		goto done;
+	found = FALSE;
+	for (pos = tail_len - ZIP_END_LEN; ; pos--) {
+		if (read_u32le(tail + pos) == ZIP_END_SIG) {
+			found = TRUE;
+			break;
+		}
+		if (!pos)
+			break;
+	}
+	if (!found)
+		goto done;
+	count = read_u16le(tail + pos + 10);
+	cd_size = read_u32le(tail + pos + 12);
+	cd_off = read_u32le(tail + pos + 16);
+
+	if (count == ZIP_U16_MAX || cd_size == ZIP_U32_MAX || cd_off == ZIP_U32_MAX) {
+		if (tail_off + pos < ZIP64_LOCATOR_LEN)
+			goto done;
+		if (!sr_sessionfile_read_at(f, tail_off + pos - ZIP64_LOCATOR_LEN,
+				hdr, ZIP64_LOCATOR_LEN))
+			goto done;
+		if (read_u32le(hdr) != ZIP64_LOCATOR_SIG)
+			goto done;
+		offset = read_u64le(hdr + 8);
+		if (!sr_sessionfile_read_at(f, offset, hdr, ZIP64_END_LEN))
+			goto done;
+		if (read_u32le(hdr) != ZIP64_END_SIG)
+			goto done;
+		count = read_u64le(hdr + 32);
+		cd_size = read_u64le(hdr + 40);
+		cd_off = read_u64le(hdr + 48);
+	}
+	if (cd_off > file_size || cd_size > file_size - cd_off)
+		goto done;
+
+	cd = g_try_malloc(cd_size ? cd_size : 1);
+	if (!cd || !sr_sessionfile_read_at(f, cd_off, cd, cd_size))
+		goto done;
+
+	members = g_array_new(FALSE, FALSE, sizeof(struct sr_zip_member));
+	p = cd;
+	for (i = 0; i < count; i++) {
+		if ((size_t)(cd + cd_size - p) < ZIP_CENTRAL_HEADER_LEN
+				|| read_u32le(p) != ZIP_CENTRAL_HEADER_SIG)
+			break;
+		member.method = read_u16le(p + 10);
+		member.comp_size = read_u32le(p + 20);
+		member.size = read_u32le(p + 24);
+		name_len = read_u16le(p + 28);
+		extra_len = read_u16le(p + 30);
+		comment_len = read_u16le(p + 32);
+		member.header_offset = read_u32le(p + 42);
+		if ((size_t)(cd + cd_size - p) < ZIP_CENTRAL_HEADER_LEN
+				+ name_len + extra_len + comment_len)
+			break;
+		zip64_extra_parse(p + ZIP_CENTRAL_HEADER_LEN + name_len,
+			extra_len, &member.size, &member.comp_size,
+			&member.header_offset);
+		member.name = g_strndup((const char *)p + ZIP_CENTRAL_HEADER_LEN,
+			name_len);
+		g_array_append_val(members, member);
+		p += ZIP_CENTRAL_HEADER_LEN + name_len + extra_len + comment_len;
+	}
+
+done:
+	g_free(cd);
+	g_free(tail);
+
+	return members;
+}
+
+/** @private */
+SR_PRIV void sr_sessionfile_members_free(GArray *members)
+{
+	guint i;
+
+	if (!members)
+		return;
+	for (i = 0; i < members->len; i++)
+		g_free(g_array_index(members, struct sr_zip_member, i).name);
+	g_array_free(members, TRUE);
+}
+
+/**
+ * Get the position of a member's data in the session file.
+ *
+ * @return The file offset of the (possibly compressed) data, or 0 if
+ *         the member's local header cannot be read.
+ *
+ * @private
+ */
+SR_PRIV uint64_t sr_sessionfile_member_data(FILE *f,
+		const struct sr_zip_member *member)
+{
+	uint8_t local[ZIP_LOCAL_HEADER_LEN];
+
+	if (!sr_sessionfile_read_at(f, member->header_offset, local, sizeof(local))
+			|| read_u32le(local) != ZIP_LOCAL_HEADER_SIG)
+		return 0;
+
+	return member->header_offset + sizeof(local)
+		+ read_u16le(local + 26) + read_u16le(local + 28);
+}
+
+/**
+ * Check whether a member holds (part of) the samples of a stream. Its
+ * data is either kept in a single member named after the base name, or
+ * in members numbered "<base>-1", "<base>-2" etc. Analog members may be
+ * XOR encoded instead, and carry an ".xor" suffix, or hold the samples
+ * in the encoding of their source, and carry a ".raw" suffix. See
+ * sr_sessionfile_analog_encoding() for the latter.
+ *
+ * @param[in] name The member name.
+ * @param[in] base The base name of the stream.
+ * @param[in] analog Whether the stream holds analog samples.
+ * @param[out] number The number of the chunk, 0 for a single member.
+ * @param[out] encoded Whether the member is XOR encoded.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_sessionfile_chunk_number(const char *name,
+		const char *base, gboolean analog, uint64_t *number,
+		gboolean *encoded)
+{
+	size_t base_len;
+	char *end;
+
+	base_len = strlen(base);
+	if (!name || strncmp(name, base, base_len))
+		return FALSE;
+	*encoded = FALSE;
+	if (name[base_len] == '\0') {
+		*number = 0;
+		return TRUE;
+	}
+	if (name[base_len] != '-' || !g_ascii_isdigit(name[base_len + 1]))
+		return FALSE;
+	*number = g_ascii_strtoull(name + base_len + 1, &end, 10);
+	if (analog && !strcmp(end, ".xor"))
+		*encoded = TRUE;
+	else if (*end && !(analog && !strcmp(end, ".raw")))
+		return FALSE;
+
+	return *number != 0;
+}
+
+/* Name of the metadata group with the encoding of an analog stream. */
+static char *analog_encoding_group(int ch_nr)
 {
+	return g_strdup_printf("analog-1-%d", ch_nr);
+}
+
+/**
+ * Record the encoding of an analog stream whose chunks are stored as
+ * they came from the source (".raw" members), in the metadata.
+ *
+ * @param[in] kf The metadata.
+ * @param[in] ch_nr 1-based number of the analog channel in the file.
+ * @param[in] enc The encoding of the stored samples. They are packed,
+ *                one channel per stream.
+ *
+ * @private
+ */
+SR_PRIV void sr_sessionfile_analog_encoding_set(GKeyFile *kf, int ch_nr,
+		const struct sr_analog_encoding *enc)
+{
+	char *group, *s;
+
+	group = analog_encoding_group(ch_nr);
+	g_key_file_set_integer(kf, group, "unitsize", enc->unitsize);
+	g_key_file_set_boolean(kf, group, "signed", enc->is_signed);
+	g_key_file_set_boolean(kf, group, "float", enc->is_float);
+	g_key_file_set_boolean(kf, group, "bigendian", enc->is_bigendian);
+	g_key_file_set_integer(kf, group, "digits", enc->digits);
+	g_key_file_set_boolean(kf, group, "decimal digits",
+		enc->is_digits_decimal);
+	s = g_strdup_printf("%" PRId64 "/%" PRIu64, enc->scale.p, enc->scale.q);
+	g_key_file_set_string(kf, group, "scale", s);
+	g_free(s);
+	s = g_strdup_printf("%" PRId64 "/%" PRIu64, enc->offset.p, enc->offset.q);
+	g_key_file_set_string(kf, group, "offset", s);
+	g_free(s);
+	g_free(group);
+}
+
+static gboolean rational_get(GKeyFile *kf, const char *group,
+		const char *key, struct sr_rational *r)
+{
+	char *s;
+	int64_t p;
+	uint64_t q;
+	gboolean ok;
+
+	if (!(s = g_key_file_get_string(kf, group, key, NULL)))
+		return FALSE;
+	ok = sscanf(s, "%" SCNd64 "/%" SCNu64, &p, &q) == 2 && q;
+	g_free(s);
+	if (ok)
+		sr_rational_set(r, p, q);
+
+	return ok;
+}
+
+/**
+ * Get the encoding of an analog stream from the metadata, see
+ * sr_sessionfile_analog_encoding_set().
+ *
+ * @param[in] kf The metadata.
+ * @param[in] ch_nr 1-based number of the analog channel in the file.
+ * @param[out] enc The encoding of the stored samples.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_NA The samples are stored as floats.
+ * @retval SR_ERR_DATA Malformed encoding.
+ *
+ * @private
+ */
+SR_PRIV int sr_sessionfile_analog_encoding(GKeyFile *kf, int ch_nr,
+		struct sr_analog_encoding *enc)
+{
+	char *group;
+	int unitsize, ret;
+
+	group = analog_encoding_group(ch_nr);
+	if (!g_key_file_has_group(kf, group)) {
+		g_free(group);
+		return SR_ERR_NA;
+	}
+
+	memset(enc, 0, sizeof(*enc));
+	unitsize = g_key_file_get_integer(kf, group, "unitsize", NULL);
+	enc->is_signed = g_key_file_get_boolean(kf, group, "signed", NULL);
+	enc->is_float = g_key_file_get_boolean(kf, group, "float", NULL);
+	enc->is_bigendian = g_key_file_get_boolean(kf, group,
+		"bigendian", NULL);
+	enc->digits = g_key_file_get_integer(kf, group, "digits", NULL);
+	enc->is_digits_decimal = g_key_file_get_boolean(kf, group,
+		"decimal digits", NULL);
+	ret = SR_OK;
+	if (unitsize <= 0 || unitsize > 8
+			|| (enc->is_float && unitsize != sizeof(float)
+				&& unitsize != sizeof(double))
+			|| !rational_get(kf, group, "scale", &enc->scale)
+			|| !rational_get(kf, group, "offset", &enc->offset)) {
+		sr_err("Malformed encoding of analog channel %d.", ch_nr);
+		ret = SR_ERR_DATA;
+	}
+	enc->unitsize = unitsize;
+	g_free(group);
+
+	return ret;
+}
+
+/*
+ * Reads members of a session file straight from the file where it can,
+ * and through libzip for compression methods which it cannot handle.
+ */
+struct member_reader {
+	const char *filename;
+	FILE *file;
+	GArray *members;
 	struct zip *archive;
-	struct zip_file *zf;
-	struct zip_stat zs;
-	uint64_t version;
-	int ret;
-	char s[11];
+};
 
-	if (!filename)
-		return SR_ERR_ARG;
+static int reader_open(struct member_reader *rd, const char *filename)
+{
+	memset(rd, 0, sizeof(*rd));
+	rd->filename = filename;
+	if (!(rd->file = g_fopen(filename, "rb")))
+		return SR_ERR_IO;
+	if (!(rd->members = sr_sessionfile_members(rd->file))) {
+		fclose(rd->file);
+		return SR_ERR;
+	}
 
-	if (!g_file_test(filename, G_FILE_TEST_IS_REGULAR)) {
-		sr_err("Not a regular file: %s.", filename);
+	return SR_OK;
+}
+
+static void reader_close(struct member_reader *rd)
+{
+	if (rd->archive)
+		zip_discard(rd->archive);
+	sr_sessionfile_members_free(rd->members);
+	fclose(rd->file);
+}
+
+static const struct sr_zip_member *member_find(const struct member_reader *rd,
+		const char *name)
+{
+	const struct sr_zip_member *member;
+	guint i;
+
+	for (i = 0; i < rd->members->len; i++) {
+		member = &g_array_index(rd->members, struct sr_zip_member, i);
+		if (!strcmp(member->name, name))
+			return member;
+	}
+
+	return NULL;
+}
+
+#ifdef HAVE_ZLIB
+/* Inflate the start of a deflated member's data into a buffer. */
+static int member_inflate(FILE *f, uint64_t offset, uint64_t comp_size,
+		uint8_t *buf, size_t len)
+{
+	z_stream zs;
+	uint8_t in[INFLATE_CHUNK_SIZE];
+	size_t n;
+	int zret, ret;
+
+	memset(&zs, 0, sizeof(zs));
+	if (inflateInit2(&zs, -MAX_WBITS) != Z_OK)
 		return SR_ERR;
+	zs.next_out = buf;
+	zs.avail_out = len;
+
+	ret = SR_OK;
+	while (zs.avail_out) {
+		if (!zs.avail_in) {
+			if (!comp_size) {
+				ret = SR_ERR_DATA;
+				break;
+			}
+			n = MIN(comp_size, sizeof(in));
+			if (!sr_sessionfile_read_at(f, offset, in, n)) {
+				ret = SR_ERR_IO;
+				break;
+			}
+			offset += n;
+			comp_size -= n;
+			zs.next_in = in;
+			zs.avail_in = n;
+		}
+		zret = inflate(&zs, Z_NO_FLUSH);
+		if (zret == Z_STREAM_END) {
+			if (zs.avail_out)
+				ret = SR_ERR_DATA;
+			break;
+		}
+		if (zret != Z_OK) {
+			ret = SR_ERR_DATA;
+			break;
+		}
 	}
+	inflateEnd(&zs);
 
-	if (!(archive = zip_open(filename, 0, NULL)))
-		/* No logging: this can be used just to check if it's
-		 * a sigrok session file or not. */
+	return ret;
+}
+#endif
+
+/* Read the member's data through libzip. */
+static int member_read_zip(struct member_reader *rd,
+		const struct sr_zip_member *member, uint8_t *buf, size_t len)
+{
+	struct zip_file *zf;
+	zip_int64_t n;
+
+	if (!rd->archive && !(rd->archive = zip_open(rd->filename, 0, NULL)))
 		return SR_ERR;
+	if (!(zf = zip_fopen(rd->archive, member->name, 0)))
+		return SR_ERR_DATA;
+	n = zip_fread(zf, buf, len);
+	zip_fclose(zf);
+
+	return n == (zip_int64_t)len ? SR_OK : SR_ERR_DATA;
+}
+
+/*
+ * Read up to max_len bytes from the start of a member. The buffer gets
+ * NUL terminated, so that text members can be parsed right away.
+ */
+static int member_read(struct member_reader *rd,
+		const struct sr_zip_member *member, size_t max_len,
+		char **buf, size_t *len)
+{
+	uint64_t offset;
+	int ret;
+
+	*len = MIN(member->size, max_len);
+	if (!(*buf = g_try_malloc(*len + 1)))
+		return SR_ERR_MALLOC;
+
+	offset = 0;
+	if (member->method == ZIP_CM_STORE || member->method == ZIP_CM_DEFLATE)
+		offset = sr_sessionfile_member_data(rd->file, member);
+	if (offset && member->method == ZIP_CM_STORE)
+		ret = sr_sessionfile_read_at(rd->file, offset, *buf, *len)
+			? SR_OK : SR_ERR_IO;
+#ifdef HAVE_ZLIB
+	else if (offset && member->method == ZIP_CM_DEFLATE)
+		ret = member_inflate(rd->file, offset, member->comp_size,
+			(uint8_t *)*buf, *len);
+#endif
+	else
+		ret = member_read_zip(rd, member, (uint8_t *)*buf, *len);
+
+	if (ret != SR_OK) {
+		g_free(*buf);
+		*buf = NULL;
+		return ret;
+	}
+	(*buf)[*len] = '\0';
+
+	return SR_OK;
+}
+
+/* Check the "version" member of a session file. */
+static int version_check(struct member_reader *rd)
+{
+	const struct sr_zip_member *member;
+	uint64_t version;
+	size_t len;
+	char *s;
 
-	/* check "version" */
-	if (!(zf = zip_fopen(archive, "version", 0))) {
+	if (!(member = member_find(rd, "version"))) {
 		sr_dbg("Not a sigrok session file: no version found.");
-		zip_discard(archive);
 		return SR_ERR;
 	}
-	ret = zip_fread(zf, s, sizeof(s) - 1);
-	if (ret < 0) {
-		sr_err("Failed to read version file: %s",
-			zip_file_strerror(zf));
-		zip_fclose(zf);
-		zip_discard(archive);
+	if (member_read(rd, member, 10, &s, &len) != SR_OK) {
+		sr_err("Failed to read version file of %s.", rd->filename);
 		return SR_ERR;
 	}
-	zip_fclose(zf);
-	s[ret] = '\0';
 	version = g_ascii_strtoull(s, NULL, 10);
+	g_free(s);
 	if (version == 0 || version > 2) {
 		sr_dbg("Cannot handle sigrok session file version %" PRIu64 ".",
 			version);
-		zip_discard(archive);
 		return SR_ERR;
 	}
 	sr_spew("Detected sigrok session file version %" PRIu64 ".", version);
 
-	/* read "metadata" */
-	if (zip_stat(archive, "metadata", 0, &zs) < 0) {
-		sr_dbg("Not a valid sigrok session file.");
-		zip_discard(archive);
+	return SR_OK;
+}
+
+/** @private */
+SR_PRIV int sr_sessionfile_check(const char *filename)
+{
+	struct member_reader rd;
+	int ret;
+
+	if (!filename)
+		return SR_ERR_ARG;
+
+	if (!g_file_test(filename, G_FILE_TEST_IS_REGULAR)) {
+		sr_err("Not a regular file: %s.", filename);
 		return SR_ERR;
 	}
-	zip_discard(archive);
 
-	return SR_OK;
+	if (reader_open(&rd, filename) != SR_OK)
+		/* No logging: this can be used just to check if it's
+		 * a sigrok session file or not. */
+		return SR_ERR;
+
+	ret = version_check(&rd);
+	if (ret == SR_OK && !member_find(&rd, "metadata")) {
+		sr_dbg("Not a valid sigrok session file.");
+		ret = SR_ERR;
+	}
+	reader_close(&rd);
+
+	return ret;
 }
 
-/** @private */
-SR_PRIV struct sr_dev_inst *sr_session_prepare_sdi(const char *filename, struct sr_session **session)
+/*
+ * Create a device of the session driver, which the session owns. Devices
+ * whose data gets merged into another device's are not added to the
+ * session's devices.
+ */
+static struct sr_dev_inst *file_sdi_new(const char *filename,
+		struct sr_session *session, gboolean add)
 {
 	struct sr_dev_inst *sdi = NULL;
 
@@ -184,28 +698,28 @@ SR_PRIV struct sr_dev_inst *sr_session_prepare_sdi(const char *filename, struct
 		sdi->driver->init(sdi->driver, NULL);
 	}
 	sr_dev_open(sdi);
-	sr_session_dev_add(*session, sdi);
-	(*session)->owned_devs = g_slist_append((*session)->owned_devs, sdi);
-	sr_config_set(sdi, NULL, SR_CONF_SESSIONFILE,
-			g_variant_new_string(filename));
+	if (add)
+		sr_session_dev_add(session, sdi);
+	session->owned_devs = g_slist_append(session->owned_devs, sdi);
+	if (filename)
+		sr_config_set(sdi, NULL, SR_CONF_SESSIONFILE,
+				g_variant_new_string(filename));
 
 	return sdi;
 }
 
-/**
- * Load the session from the specified filename.
- *
- * @param ctx The context in which to load the session.
- * @param filename The name of the session file to load.
- * @param session The session to load the file into.
- *
- * @retval SR_OK Success
- * @retval SR_ERR_MALLOC Memory allocation error
- * @retval SR_ERR_DATA Malformed session file
- * @retval SR_ERR This is not a session file
+/** @private */
+SR_PRIV struct sr_dev_inst *sr_session_prepare_sdi(const char *filename, struct sr_session **session)
+{
+	return file_sdi_new(filename, *session, TRUE);
+}
+
+/*
+ * Load the devices of a session file into a session, which gets created
+ * if there is none yet. The devices which were created can be returned.
  */
-SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
-		struct sr_session **session)
+static int load_file(struct sr_context *ctx, const char *filename,
+		struct sr_session **session, gboolean add, GSList **devs)
 {
 	GKeyFile *kf;
 	GError *error;
@@ -216,7 +730,7 @@ SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
 	int ret, i, j;
 	uint64_t tmp_u64;
 	int total_channels, total_analog, k;
-	GSList *l;
+	GSList *l, *last;
 	int unitsize;
 	char **sections, **keys, *val;
 	char channelname[SR_MAX_CHANNELNAME_LEN + 1];
@@ -233,14 +747,17 @@ SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
 		return SR_ERR;
 	}
 	kf = sr_sessionfile_read_metadata(archive, &zs);
-	zip_discard(archive);
-	if (!kf)
+	if (!kf) {
+		zip_discard(archive);
 		return SR_ERR_DATA;
+	}
 
-	if ((ret = sr_session_new(ctx, session)) != SR_OK) {
+	if (!*session && (ret = sr_session_new(ctx, session)) != SR_OK) {
 		g_key_file_free(kf);
+		zip_discard(archive);
 		return ret;
 	}
+	last = g_slist_last((*session)->owned_devs);
 
 	total_channels = 0;
 
@@ -261,7 +778,7 @@ SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
 			total_analog = g_key_file_get_integer(kf, sections[i],
 					"total analog",	&error);
 			if (total_analog > 0 && !error)
-				sdi = sr_session_prepare_sdi(filename, session);
+				sdi = file_sdi_new(filename, *session, add);
 			g_clear_error(&error);
 
 			/* File contains logic data if a capturefile is set. */
@@ -269,7 +786,7 @@ SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
 				"capturefile", &error);
 			if (val && !error) {
 				if (!sdi)
-					sdi = sr_session_prepare_sdi(filename, session);
+					sdi = file_sdi_new(filename, *session, add);
 				sr_config_set(sdi, NULL, SR_CONF_CAPTUREFILE,
 						g_variant_new_string(val));
 				g_free(val);
@@ -386,6 +903,14 @@ SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
 	g_strfreev(sections);
 	g_key_file_free(kf);
 
+	/* Index the sample data, for random access during playback. */
+	l = last ? last->next : (*session)->owned_devs;
+	if (devs)
+		*devs = g_slist_copy(l);
+	for (; l && ret == SR_OK; l = l->next)
+		ret = sr_session_driver_index_build(l->data, archive);
+	zip_discard(archive);
+
 	if (error) {
 		sr_err("Failed to parse metadata: %s", error->message);
 		g_error_free(error);
@@ -393,4 +918,567 @@ SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
 	return ret;
 }
 
+/**
+ * Load the session from the specified filename.
+ *
+ * @param ctx The context in which to load the session.
+ * @param filename The name of the session file to load.
+ * @param session The session to load the file into.
+ *
+ * @retval SR_OK Success
+ * @retval SR_ERR_MALLOC Memory allocation error
+ * @retval SR_ERR_DATA Malformed session file
+ * @retval SR_ERR This is not a session file
+ */
+SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
+		struct sr_session **session)
+{
+	*session = NULL;
+
+	return load_file(ctx, filename, session, TRUE, NULL);
+}
+
+/* Number of samples at a samplerate within a time span in ns. */
+static uint64_t span_samples(uint64_t span_ns, uint64_t samplerate)
+{
+	return span_ns / SR_GHZ(1) * samplerate
+		+ span_ns % SR_GHZ(1) * samplerate / SR_GHZ(1);
+}
+
+/**
+ * Load several session files into one session, for playback on a shared
+ * timebase. E.g. the captures of several devices which ran at the same
+ * time, one file per device.
+ *
+ * Playback of all files starts at the same point in time, the latest
+ * start of any of the files. The data of files which started earlier
+ * gets skipped up to there.
+ *
+ * The devices of each file get added to the session, unless the flag
+ * SR_SESSION_LOAD_MERGE_LOGIC is given. The logic data of all files gets
+ * merged into one device then, whose samples hold the samples of all
+ * files side by side. The samples of each file start at a byte boundary,
+ * and its channel names get prefixed with the file's number ("2:CLK").
+ * The merged samplerate is the highest of the files', which must be a
+ * multiple of all others. Samples of files with lower samplerates get
+ * repeated. Each file is read by a thread of its own. Analog data is
+ * not played back.
+ *
+ * @param ctx The context in which to load the session.
+ * @param filenames The names of the session files, NULL terminated.
+ * @param start_ns The time of the first sample of each file on the
+ *                 shared timebase, in ns. NULL if all files start at
+ *                 the same time.
+ * @param flags Flags, see enum sr_session_load_flags.
+ * @param session The new session.
+ *
+ * @retval SR_OK Success
+ * @retval SR_ERR_ARG Invalid argument
+ * @retval SR_ERR_DATA Malformed session file, or files which cannot be
+ *         merged
+ * @retval SR_ERR This is not a session file
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_load_files(struct sr_context *ctx,
+		const char *const *filenames, const int64_t *start_ns,
+		int flags, struct sr_session **session)
+{
+	GSList **devs, *members, *l;
+	struct sr_dev_inst *sdi;
+	uint64_t samplerate;
+	int64_t start;
+	gboolean merge;
+	guint i, count;
+	int ret;
+
+	*session = NULL;
+	if (!filenames || !filenames[0])
+		return SR_ERR_ARG;
+	count = g_strv_length((gchar **)filenames);
+	merge = (flags & SR_SESSION_LOAD_MERGE_LOGIC) != 0;
+
+	devs = g_malloc0_n(count, sizeof(devs[0]));
+	ret = SR_OK;
+	for (i = 0; i < count && ret == SR_OK; i++)
+		ret = load_file(ctx, filenames[i], session, !merge, &devs[i]);
+
+	/* Skip the data before the latest start. */
+	start = INT64_MIN;
+	for (i = 0; start_ns && i < count; i++)
+		start = MAX(start, start_ns[i]);
+	for (i = 0; start_ns && i < count && ret == SR_OK; i++) {
+		for (l = devs[i]; l && ret == SR_OK; l = l->next) {
+			sdi = l->data;
+			if (sr_config_get_u64(sdi->driver, sdi, NULL,
+					SR_CONF_SAMPLERATE, &samplerate) != SR_OK)
+				continue;
+			ret = sr_config_set(sdi, NULL, SR_CONF_CAPTURE_OFFSET,
+				g_variant_new_uint64(span_samples(
+					start - start_ns[i], samplerate)));
+		}
+	}
+
+	if (merge && ret == SR_OK) {
+		members = NULL;
+		for (i = 0; i < count; i++)
+			members = g_slist_concat(members, g_slist_copy(devs[i]));
+		sdi = file_sdi_new(NULL, *session, TRUE);
+		ret = sr_session_driver_merge_init(sdi, members);
+		g_slist_free(members);
+	}
+
+	for (i = 0; i < count; i++)
+		g_slist_free(devs[i]);
+	g_free(devs);
+
+	if (ret != SR_OK && *session) {
+		sr_session_destroy(*session);
+		*session = NULL;
+	}
+
+	return ret;
+}
+
+/* Check for a device of a loaded session file, and a channel of it. */
+static gboolean file_dev_check(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch)
+{
+	if (!sdi || sdi->driver != &session_driver || !sdi->priv) {
+		sr_err("Not a device of a loaded session file.");
+		return FALSE;
+	}
+	if (ch && ch->sdi != sdi) {
+		sr_err("Channel %s is not of this device.", ch->name);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Get the number of samples in a loaded session file.
+ *
+ * @param sdi A device of a session from sr_session_load().
+ * @param ch An analog channel of the device, or NULL (or a logic
+ *           channel) for the logic data.
+ * @param samples Receives the number of samples.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The file has no such data.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_samples(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch, uint64_t *samples)
+{
+	if (!file_dev_check(sdi, ch) || !samples)
+		return SR_ERR_ARG;
+
+	return sr_session_driver_samples(sdi, ch, samples);
+}
+
+/**
+ * Read samples of a loaded session file into a buffer, without running
+ * the session.
+ *
+ * Logic samples are unitsize bytes wide (see SR_CONF_CAPTURE_UNITSIZE),
+ * analog samples are native floats, also where the file keeps them in
+ * the encoding of their source. The chunks of the file which the
+ * window covers get read in parallel, by as many threads as there are
+ * processors, so that large files can be read at the speed of the disk.
+ *
+ * The device must not be running an acquisition at the same time.
+ *
+ * @param sdi A device of a session from sr_session_load().
+ * @param ch An analog channel of the device, or NULL (or a logic
+ *           channel) for the logic data.
+ * @param offset The number of the first sample to read.
+ * @param count On entry the number of samples to read, which buf must
+ *              have room for. On return the number of samples read,
+ *              fewer when the window exceeds the end of the data.
+ * @param buf The buffer to read into.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The file has no such data.
+ * @retval SR_ERR_IO The file could not be read.
+ * @retval SR_ERR_DATA Malformed sample data.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_read(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch, uint64_t offset, uint64_t *count,
+		void *buf)
+{
+	if (!file_dev_check(sdi, ch) || !count || (!buf && *count))
+		return SR_ERR_ARG;
+
+	return sr_session_driver_read(sdi, ch, offset, count, buf);
+}
+
+/**
+ * Get the number of levels of the summary which a session file carries,
+ * see the "summary" option of the srzip output module.
+ *
+ * An entry of level 0 of the summary covers 2^shift samples, an entry
+ * of each following level twice the samples of the one before. The last
+ * level has a single entry.
+ *
+ * @param sdi A device of a session from sr_session_load().
+ * @param ch An analog channel of the device, or NULL (or a logic
+ *           channel) for the logic data.
+ * @param levels Receives the number of levels.
+ * @param shift Receives the samples per entry of level 0, as a power
+ *              of two.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The file has no summary of this data.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_summary_levels(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch, unsigned int *levels,
+		unsigned int *shift)
+{
+	if (!file_dev_check(sdi, ch) || !levels || !shift)
+		return SR_ERR_ARG;
+
+	return sr_session_driver_summary_levels(sdi, ch, levels, shift);
+}
+
+/**
+ * Read entries of a level of the summary which a session file carries.
+ *
+ * Rendering an overview of a capture this way takes time in proportion
+ * to the width of the view, not to the number of samples. A level gets
+ * read from the file once, and is kept while the session is loaded.
+ *
+ * @param sdi A device of a session from sr_session_load().
+ * @param ch A logic or analog channel of the device.
+ * @param level The level, below the number of levels.
+ * @param offset The number of the first entry to read.
+ * @param count On entry the number of entries to read, which buf must
+ *              have room for. On return the number of entries read,
+ *              fewer when the window exceeds the end of the level.
+ * @param buf Receives struct sr_logic_summary entries for a logic
+ *            channel, struct sr_analog_summary entries for an analog
+ *            channel.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The file has no such summary level.
+ * @retval SR_ERR_IO The file could not be read.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_summary_read(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch, unsigned int level, uint64_t offset,
+		uint64_t *count, void *buf)
+{
+	if (!file_dev_check(sdi, ch) || !ch || !count || (!buf && *count))
+		return SR_ERR_ARG;
+
+	return sr_session_driver_summary_read(sdi, ch, level, offset,
+		count, buf);
+}
+
+/**
+ * Find the next edge of a logic channel after a sample of a session file.
+ *
+ * The search skips the blocks of samples in which the channel does not
+ * change without reading them, by means of a transition index. Session
+ * files carry one if written with the "edge_index" option of the srzip
+ * output module. For other files the index is built from all of the
+ * samples on the first search, and kept in a "<filename>.edges" file
+ * next to the session file for later sessions, where possible.
+ *
+ * @param sdi A device of a session from sr_session_load().
+ * @param ch A logic channel of the device.
+ * @param from Edges after this sample are searched for.
+ * @param match SR_TRIGGER_RISING, SR_TRIGGER_FALLING, or SR_TRIGGER_EDGE
+ *              for either.
+ * @param pos Receives the position of the edge, the first sample with
+ *            the new level.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The channel has no such edge after the sample.
+ * @retval SR_ERR_IO The file could not be read.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_edge_next(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch, uint64_t from, int match,
+		uint64_t *pos)
+{
+	if (!file_dev_check(sdi, ch) || !ch || !pos)
+		return SR_ERR_ARG;
+
+	return sr_session_driver_edge_next(sdi, ch, from, match, pos);
+}
+
+/* Sum up the size of a stream's samples in bytes. */
+static int stream_size(struct member_reader *rd, const char *base,
+		gboolean analog, uint64_t *size)
+{
+	const struct sr_zip_member *member;
+	uint64_t number;
+	gboolean encoded;
+	size_t len, count;
+	char *header;
+	guint i;
+
+	*size = 0;
+	for (i = 0; i < rd->members->len; i++) {
+		member = &g_array_index(rd->members, struct sr_zip_member, i);
+		if (!sr_sessionfile_chunk_number(member->name, base, analog,
+				&number, &encoded))
+			continue;
+		if (!encoded) {
+			*size += member->size;
+			continue;
+		}
+		/* The sample count of encoded chunks is in their header. */
+		if (member_read(rd, member, 4, &header, &len) != SR_OK)
+			return SR_ERR_DATA;
+		if (sr_analog_xor_count((const uint8_t *)header, len,
+				&count) != SR_OK) {
+			g_free(header);
+			return SR_ERR_DATA;
+		}
+		g_free(header);
+		*size += (uint64_t)count * sizeof(float);
+	}
+
+	return SR_OK;
+}
+
+/* Summarize the first device of a session file. */
+static int info_read(struct member_reader *rd,
+		struct sr_session_file_info *info)
+{
+	const struct sr_zip_member *member;
+	struct sr_analog_encoding enc;
+	GKeyFile *kf;
+	GError *error;
+	char **groups, *group, *val, *base;
+	uint64_t size;
+	size_t len, unitsize;
+	int ret, i;
+
+	if ((ret = version_check(rd)) != SR_OK)
+		return ret;
+	if (!(member = member_find(rd, "metadata"))) {
+		sr_dbg("Not a valid sigrok session file.");
+		return SR_ERR;
+	}
+	if (member->size > METADATA_MAX_SIZE) {
+		sr_err("Metadata of %s is too large.", rd->filename);
+		return SR_ERR_DATA;
+	}
+	if ((ret = member_read(rd, member, member->size, &val, &len)) != SR_OK) {
+		sr_err("Failed to read metadata of %s.", rd->filename);
+		return ret;
+	}
+	kf = g_key_file_new();
+	error = NULL;
+	g_key_file_load_from_data(kf, val, len, G_KEY_FILE_NONE, &error);
+	g_free(val);
+	if (error) {
+		sr_err("Failed to parse metadata: %s", error->message);
+		g_error_free(error);
+		g_key_file_free(kf);
+		return SR_ERR_DATA;
+	}
+
+	group = NULL;
+	groups = g_key_file_get_groups(kf, NULL);
+	for (i = 0; groups[i] && !group; i++) {
+		if (!strncmp(groups[i], "device ", 7))
+			group = groups[i];
+	}
+
+	ret = SR_OK;
+	if (group) {
+		info->num_logic_channels = MAX(0, g_key_file_get_integer(kf,
+			group, "total probes", NULL));
+		info->num_analog_channels = MAX(0, g_key_file_get_integer(kf,
+			group, "total analog", NULL));
+		val = g_key_file_get_string(kf, group, "samplerate", NULL);
+		if (val && sr_parse_sizestring(val, &info->samplerate) != SR_OK)
+			ret = SR_ERR_DATA;
+		g_free(val);
+
+		val = g_key_file_get_string(kf, group, "capturefile", NULL);
+		if (ret == SR_OK && val) {
+			info->unitsize = g_key_file_get_integer(kf, group,
+				"unitsize", NULL);
+			if (info->unitsize <= 0)
+				ret = SR_ERR_DATA;
+			else if ((ret = stream_size(rd, val, FALSE, &size)) == SR_OK)
+				info->samples = size / info->unitsize;
+		} else if (ret == SR_OK && info->num_analog_channels) {
+			base = g_strdup_printf("analog-1-%d",
+				info->num_logic_channels + 1);
+			ret = sr_sessionfile_analog_encoding(kf,
+				info->num_logic_channels + 1, &enc);
+			unitsize = ret == SR_OK ? enc.unitsize : sizeof(float);
+			if (ret == SR_ERR_NA)
+				ret = SR_OK;
+			if (ret == SR_OK
+					&& (ret = stream_size(rd, base, TRUE, &size)) == SR_OK)
+				info->samples = size / unitsize;
+			g_free(base);
+		}
+		g_free(val);
+	}
+	g_strfreev(groups);
+	g_key_file_free(kf);
+
+	if (ret != SR_OK)
+		sr_err("Malformed session file %s.", rd->filename);
+
+	return ret;
+}
+
+/* Take the summary from the index, if it is of the file as it is now. */
+static gboolean info_index_load(const char *path, const GStatBuf *st,
+		struct sr_session_file_info *info)
+{
+	GKeyFile *kf;
+	GError *error;
+	gboolean ok;
+
+	kf = g_key_file_new();
+	if (!g_key_file_load_from_file(kf, path, G_KEY_FILE_NONE, NULL)) {
+		g_key_file_free(kf);
+		return FALSE;
+	}
+
+	error = NULL;
+	ok = g_key_file_get_int64(kf, INFO_INDEX_GROUP, "size", &error)
+			== (gint64)st->st_size && !error;
+	ok = ok && g_key_file_get_int64(kf, INFO_INDEX_GROUP, "mtime", &error)
+			== (gint64)st->st_mtime && !error;
+	if (ok) {
+		info->num_logic_channels = g_key_file_get_integer(kf,
+			INFO_INDEX_GROUP, "logic channels", &error);
+		if (!error)
+			info->num_analog_channels = g_key_file_get_integer(kf,
+				INFO_INDEX_GROUP, "analog channels", &error);
+		if (!error)
+			info->unitsize = g_key_file_get_integer(kf,
+				INFO_INDEX_GROUP, "unitsize", &error);
+		if (!error)
+			info->samplerate = g_key_file_get_uint64(kf,
+				INFO_INDEX_GROUP, "samplerate", &error);
+		if (!error)
+			info->samples = g_key_file_get_uint64(kf,
+				INFO_INDEX_GROUP, "samples", &error);
+		ok = !error;
+	}
+	g_clear_error(&error);
+	g_key_file_free(kf);
+
+	return ok;
+}
+
+/* Write the index. Failing to is fine, e.g. in read-only directories. */
+static void info_index_save(const char *path, const GStatBuf *st,
+		const struct sr_session_file_info *info)
+{
+	GKeyFile *kf;
+	GError *error;
+	char *data;
+	gsize len;
+
+	kf = g_key_file_new();
+	g_key_file_set_int64(kf, INFO_INDEX_GROUP, "size", st->st_size);
+	g_key_file_set_int64(kf, INFO_INDEX_GROUP, "mtime", st->st_mtime);
+	g_key_file_set_integer(kf, INFO_INDEX_GROUP, "logic channels",
+		info->num_logic_channels);
+	g_key_file_set_integer(kf, INFO_INDEX_GROUP, "analog channels",
+		info->num_analog_channels);
+	g_key_file_set_integer(kf, INFO_INDEX_GROUP, "unitsize", info->unitsize);
+	g_key_file_set_uint64(kf, INFO_INDEX_GROUP, "samplerate",
+		info->samplerate);
+	g_key_file_set_uint64(kf, INFO_INDEX_GROUP, "samples", info->samples);
+	data = g_key_file_to_data(kf, &len, NULL);
+	g_key_file_free(kf);
+
+	error = NULL;
+	if (!g_file_set_contents(path, data, len, &error)) {
+		sr_dbg("Cannot write %s: %s.", path, error->message);
+		g_error_free(error);
+	}
+	g_free(data);
+}
+
+/**
+ * Summarize a session file without loading it.
+ *
+ * Only the ZIP central directory, and the version and metadata members
+ * of the file get read, so that whole directories of captures can be
+ * listed quickly. The sample count follows from the sizes of the sample
+ * data members. Only the first device of the file is summarized.
+ *
+ * With SR_SESSION_FILE_INFO_INDEX the summary is kept in a
+ * "<filename>.info" file next to the session file, which is used
+ * instead while the size and modification time of the session file
+ * are the same as when it was written.
+ *
+ * @param filename The name of the session file.
+ * @param flags Zero or more of enum sr_session_file_info_flags.
+ * @param info Receives the summary.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_DATA Malformed session file.
+ * @retval SR_ERR This is not a session file.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_info_get(const char *filename, int flags,
+		struct sr_session_file_info *info)
+{
+	struct member_reader rd;
+	GStatBuf st;
+	char *index;
+	int ret;
+
+	if (!filename || !info)
+		return SR_ERR_ARG;
+
+	if (g_stat(filename, &st) < 0 || !S_ISREG(st.st_mode)) {
+		sr_err("Not a regular file: %s.", filename);
+		return SR_ERR;
+	}
+	memset(info, 0, sizeof(*info));
+
+	index = NULL;
+	if (flags & SR_SESSION_FILE_INFO_INDEX) {
+		index = g_strconcat(filename, INFO_INDEX_SUFFIX, NULL);
+		if (info_index_load(index, &st, info)) {
+			g_free(index);
+			return SR_OK;
+		}
+		memset(info, 0, sizeof(*info));
+	}
+
+	if ((ret = reader_open(&rd, filename)) == SR_OK) {
+		ret = info_read(&rd, info);
+		reader_close(&rd);
+	} else {
+		ret = SR_ERR;
+	}
+	if (ret == SR_OK && index)
+		info_index_save(index, &st, info);
+	g_free(index);
+
+	return ret;
+}
+
 /** @} */
@@ -0,0 +1,265 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Alternative backends for polling the descriptors of a session.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session"
+/** @endcond */
+
+/*
+ * GLib hands the poll function of a main context the complete set of
+ * descriptors on every iteration, and poll() registers each of them
+ * with the kernel again. The epoll backend keeps the descriptors
+ * registered across iterations instead, and rebuilds its interest set
+ * only when the poll set changes.
+ *
+ * A descriptor which gets closed drops out of the epoll interest set,
+ * even when a new descriptor with the same number replaces it in the
+ * poll set. Such replacements involve removing and adding an event
+ * source, so each change of a session's event sources invalidates the
+ * interest sets of all threads.
+ */
+
+/* Changes of event sources, across all sessions. */
+static gint sources_generation;
+
+/** @private */
+SR_PRIV void sr_session_poll_sources_changed(void)
+{
+	g_atomic_int_inc(&sources_generation);
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+
+/* Interest set of the main context which the current thread runs. */
+struct epoll_state {
+	int epfd;
+	gint generation;
+	/* The poll set which the interest set was built from. */
+	GPollFD *fds;
+	guint nfds;
+	struct epoll_event *events;
+	guint max_events;
+	/* The poll set holds descriptors which epoll does not support. */
+	gboolean use_poll;
+};
+
+static void epoll_state_free(void *data)
+{
+	struct epoll_state *state;
+
+	state = data;
+	if (state->epfd >= 0)
+		close(state->epfd);
+	g_free(state->fds);
+	g_free(state->events);
+	g_free(state);
+}
+
+static GPrivate epoll_private = G_PRIVATE_INIT(epoll_state_free);
+
+static uint32_t epoll_mask(gushort events)
+{
+	uint32_t mask;
+
+	mask = 0;
+	if (events & G_IO_IN)
+		mask |= EPOLLIN;
+	if (events & G_IO_OUT)
+		mask |= EPOLLOUT;
+	if (events & G_IO_PRI)
+		mask |= EPOLLPRI;
+
+	return mask;
+}
+
+static gushort poll_mask(uint32_t events)
+{
+	gushort mask;
+
+	mask = 0;
+	if (events & EPOLLIN)
+		mask |= G_IO_IN;
+	if (events & EPOLLOUT)
+		mask |= G_IO_OUT;
+	if (events & EPOLLPRI)
+		mask |= G_IO_PRI;
+	if (events & EPOLLERR)
+		mask |= G_IO_ERR;
+	if (events & EPOLLHUP)
+		mask |= G_IO_HUP;
+
+	return mask;
+}
+
+static gboolean poll_set_equal(const struct epoll_state *state,
+		const GPollFD *fds, guint nfds)
+{
+	guint i;
+
+	if (nfds != state->nfds)
+		return FALSE;
+	for (i = 0; i < nfds; i++) {
+		if (fds[i].fd != state->fds[i].fd)
+			return FALSE;
+		if (fds[i].events != state->fds[i].events)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static int epoll_rebuild(struct epoll_state *state, GPollFD *fds, guint nfds)
+{
+	struct epoll_event ev;
+	uint32_t mask;
+	guint i, j;
+
+	g_free(state->fds);
+	state->fds = g_malloc(MAX(nfds, 1) * sizeof(*fds));
+	memcpy(state->fds, fds, nfds * sizeof(*fds));
+	state->nfds = nfds;
+
+	if (state->epfd >= 0)
+		close(state->epfd);
+	state->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (state->epfd < 0)
+		return -1;
+
+	for (i = 0; i < nfds; i++) {
+		fds[i].revents = 0;
+		if (fds[i].fd < 0)
+			continue;
+		/* Register each descriptor once, for all its entries. */
+		for (j = 0; j < i; j++) {
+			if (fds[j].fd == fds[i].fd)
+				break;
+		}
+		if (j < i)
+			continue;
+		mask = 0;
+		for (j = i; j < nfds; j++) {
+			if (fds[j].fd == fds[i].fd)
+				mask |= epoll_mask(fds[j].events);
+		}
+		memset(&ev, 0, sizeof(ev));
+		ev.events = mask;
+		ev.data.fd = fds[i].fd;
+		if (epoll_ctl(state->epfd, EPOLL_CTL_ADD, fds[i].fd, &ev) < 0) {
+			/* E.g. regular files, or invalid descriptors. */
+			close(state->epfd);
+			state->epfd = -1;
+			return -1;
+		}
+	}
+
+	if (nfds > state->max_events) {
+		g_free(state->events);
+		state->events = g_malloc(nfds * sizeof(*state->events));
+		state->max_events = nfds;
+	}
+
+	return 0;
+}
+
+static gint epoll_poll(GPollFD *fds, guint nfds, gint timeout)
+{
+	struct epoll_state *state;
+	gint generation;
+	gushort revents;
+	int count, ready, i;
+	guint j;
+
+	if (!(state = g_private_get(&epoll_private))) {
+		state = g_malloc0(sizeof(*state));
+		state->epfd = -1;
+		g_private_set(&epoll_private, state);
+	}
+
+	generation = g_atomic_int_get(&sources_generation);
+	if (!state->fds || generation != state->generation
+			|| !poll_set_equal(state, fds, nfds)) {
+		state->use_poll = epoll_rebuild(state, fds, nfds) < 0;
+		state->generation = generation;
+	}
+	if (state->use_poll || !nfds)
+		return g_poll(fds, nfds, timeout);
+
+	for (j = 0; j < nfds; j++)
+		fds[j].revents = 0;
+
+	count = epoll_wait(state->epfd, state->events, state->max_events,
+		timeout);
+	if (count <= 0)
+		return count;
+
+	ready = 0;
+	for (i = 0; i < count; i++) {
+		revents = poll_mask(state->events[i].events);
+		for (j = 0; j < nfds; j++) {
+			if (fds[j].fd != state->events[i].data.fd)
+				continue;
+			fds[j].revents = revents
+				& (fds[j].events | G_IO_ERR | G_IO_HUP);
+			if (fds[j].revents)
+				ready++;
+		}
+	}
+
+	return ready;
+}
+
+#endif
+
+/**
+ * Get the poll function which implements a session poll backend.
+ *
+ * @param backend The backend.
+ *
+ * @return The poll function, or NULL for GLib's default poll function,
+ *         or when the backend is not available.
+ *
+ * @private
+ */
+SR_PRIV GPollFunc sr_session_poll_func(enum sr_session_poll_backend backend)
+{
+	switch (backend) {
+#ifdef HAVE_SYS_EPOLL_H
+	case SR_SESSION_POLL_EPOLL:
+		return epoll_poll;
+#endif
+	default:
+		return NULL;
+	}
+}
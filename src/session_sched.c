@@ -0,0 +1,213 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * CPU affinity, real-time scheduling and memory locking of the thread
+ * which runs a session's events.
+ */
+
+/* Needed for the CPU set macros. */
+#define _GNU_SOURCE
+
+#include <config.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <string.h>
+#ifdef HAVE_SCHED_SETAFFINITY
+#include <sched.h>
+#endif
+#ifdef HAVE_PTHREAD_SETSCHEDPARAM
+#include <pthread.h>
+#endif
+#ifdef HAVE_MLOCKALL
+#include <sys/mman.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session"
+/** @endcond */
+
+struct session_sched_saved {
+#ifdef HAVE_SCHED_SETAFFINITY
+	gboolean affinity;
+	cpu_set_t cpus;
+#endif
+#ifdef HAVE_PTHREAD_SETSCHEDPARAM
+	gboolean sched;
+	int policy;
+	struct sched_param param;
+#endif
+	gboolean locked;
+};
+
+static gboolean affinity_apply(struct session_sched_saved *saved,
+		uint64_t cpu_mask)
+{
+#ifdef HAVE_SCHED_SETAFFINITY
+	cpu_set_t cpus;
+	unsigned int i;
+
+	CPU_ZERO(&cpus);
+	for (i = 0; i < 64; i++) {
+		if (cpu_mask & (UINT64_C(1) << i))
+			CPU_SET(i, &cpus);
+	}
+	if (sched_getaffinity(0, sizeof(saved->cpus), &saved->cpus) < 0 ||
+			sched_setaffinity(0, sizeof(cpus), &cpus) < 0) {
+		sr_warn("Cannot pin the acquisition thread to CPUs 0x%"
+			PRIx64 ": %s.", cpu_mask, g_strerror(errno));
+		return FALSE;
+	}
+	saved->affinity = TRUE;
+
+	return TRUE;
+#else
+	(void)saved;
+	(void)cpu_mask;
+	sr_warn("Pinning threads to CPUs is not supported on this platform.");
+
+	return FALSE;
+#endif
+}
+
+static gboolean policy_apply(struct session_sched_saved *saved,
+		enum sr_session_sched_policy policy, int priority)
+{
+#ifdef HAVE_PTHREAD_SETSCHEDPARAM
+	struct sched_param param;
+	int ret;
+
+	ret = pthread_getschedparam(pthread_self(), &saved->policy,
+		&saved->param);
+	if (ret == 0) {
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = priority;
+		ret = pthread_setschedparam(pthread_self(),
+			(policy == SR_SESSION_SCHED_FIFO) ? SCHED_FIFO : SCHED_RR,
+			&param);
+	}
+	if (ret != 0) {
+		sr_warn("Cannot set real-time priority %d for the "
+			"acquisition thread: %s.", priority, g_strerror(ret));
+		return FALSE;
+	}
+	saved->sched = TRUE;
+
+	return TRUE;
+#else
+	(void)saved;
+	(void)policy;
+	(void)priority;
+	sr_warn("Real-time scheduling is not supported on this platform.");
+
+	return FALSE;
+#endif
+}
+
+static gboolean memory_lock(struct session_sched_saved *saved)
+{
+#ifdef HAVE_MLOCKALL
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+		sr_warn("Cannot lock the memory of the process: %s.",
+			g_strerror(errno));
+		return FALSE;
+	}
+	saved->locked = TRUE;
+
+	return TRUE;
+#else
+	(void)saved;
+	sr_warn("Locking memory is not supported on this platform.");
+
+	return FALSE;
+#endif
+}
+
+/**
+ * Apply the scheduling settings of a session to the calling thread,
+ * at the start of a run.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_sched_apply(struct sr_session *session)
+{
+	const struct sr_session_sched *req;
+	struct session_sched_saved *saved;
+	struct sr_session_sched applied;
+
+	req = &session->sched;
+	memset(&applied, 0, sizeof(applied));
+
+	if (req->cpu_mask || req->policy != SR_SESSION_SCHED_DEFAULT ||
+			req->lock_memory) {
+		saved = g_malloc0(sizeof(*saved));
+		if (req->cpu_mask && affinity_apply(saved, req->cpu_mask))
+			applied.cpu_mask = req->cpu_mask;
+		if (req->policy != SR_SESSION_SCHED_DEFAULT &&
+				policy_apply(saved, req->policy, req->priority)) {
+			applied.policy = req->policy;
+			applied.priority = req->priority;
+		}
+		if (req->lock_memory && memory_lock(saved))
+			applied.lock_memory = TRUE;
+		session->sched_saved = saved;
+		sr_dbg("Acquisition thread: CPUs 0x%" PRIx64 ", policy %d, "
+			"priority %d, memory %slocked.", applied.cpu_mask,
+			applied.policy, applied.priority,
+			applied.lock_memory ? "" : "not ");
+	}
+
+	g_mutex_lock(&session->stats_mutex);
+	session->sched_applied = applied;
+	g_mutex_unlock(&session->stats_mutex);
+}
+
+/**
+ * Restore the scheduling of the calling thread from before the run.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_sched_restore(struct sr_session *session)
+{
+	struct session_sched_saved *saved;
+
+	if (!(saved = session->sched_saved))
+		return;
+
+#ifdef HAVE_MLOCKALL
+	if (saved->locked)
+		munlockall();
+#endif
+#ifdef HAVE_PTHREAD_SETSCHEDPARAM
+	if (saved->sched)
+		pthread_setschedparam(pthread_self(), saved->policy,
+			&saved->param);
+#endif
+#ifdef HAVE_SCHED_SETAFFINITY
+	if (saved->affinity)
+		sched_setaffinity(0, sizeof(saved->cpus), &saved->cpus);
+#endif
+
+	g_free(saved);
+	session->sched_saved = NULL;
+}
@@ -0,0 +1,732 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Sharing a session's datafeed with other processes on the same host.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "shm-ring"
+/** @endcond */
+
+/**
+ * @defgroup grp_shm_ring Shared memory ring
+ *
+ * Share the datafeed of a session with other processes on the host.
+ *
+ * A shared memory ring is a datafeed sink which writes every packet of
+ * a session into a file backed memory mapping. Any number of processes
+ * can map the same file, and replay the packets with the "remote"
+ * driver (conn=shm/<path>), while only one process drives the device.
+ * Placing the file on a RAM backed file system like /dev/shm keeps
+ * the data in memory. Packets are stored in the frame format of remote
+ * sessions, see @ref grp_remote.
+ *
+ * The writer never waits for readers. Readers which fall behind by
+ * more than the ring holds lose data, detect that, and continue with
+ * the most recent data. Every reader publishes its read position, so
+ * that the writer can tell how far its readers lag.
+ *
+ * @{
+ */
+
+/** @cond PRIVATE */
+#define RING_MAGIC 0x47525253 /* "SRRG" */
+#define RING_VERSION 1
+#define RING_MAX_READERS 16
+/* Ring data starts at this offset, after the header and greeting. */
+#define RING_DATA_OFFSET (64 * 1024)
+#define RING_MIN_SIZE (64 * 1024)
+#define RING_MAX_SIZE (1UL << 30)
+/* Records start at multiples of this. */
+#define RECORD_ALIGN 8
+/* Record type which skips the rest of the ring, where records wrap. */
+#define RECORD_PAD 0
+
+/*
+ * The header of the shared ring. Positions are byte counters which
+ * wrap at 32 bits, the ring size is a power of two.
+ *
+ * Before the writer overwrites ring data, it advances reserve_pos to
+ * the end of the record it is about to write. Once the record is in
+ * place, write_pos follows. Readers copy a record out, and then check
+ * that reserve_pos did not reach into the copied range.
+ */
+struct ring_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;
+	gint closed;
+	guint reserve_pos;
+	guint write_pos;
+	gint hello_seq;
+	uint32_t hello_size;
+	uint64_t samplerate;
+	struct {
+		gint active;
+		guint pid;
+		guint read_pos;
+		guint reserved;
+	} readers[RING_MAX_READERS];
+	uint8_t hello[];
+};
+
+struct sr_shm_ring {
+	int fd;
+	uint8_t *map;
+	size_t map_size;
+	struct ring_header *header;
+	uint8_t *data;
+	const struct sr_dev_inst *sdi;
+	GByteArray *frame;
+};
+
+struct sr_shm_reader {
+	int fd;
+	uint8_t *map;
+	size_t map_size;
+	struct ring_header *header;
+	uint8_t *data;
+	int slot;
+	guint read_pos;
+};
+/** @endcond */
+
+static size_t record_size(size_t frame_size)
+{
+	return (frame_size + RECORD_ALIGN - 1) & ~(size_t)(RECORD_ALIGN - 1);
+}
+
+#ifdef HAVE_SYS_MMAN_H
+
+static void ring_write(struct sr_shm_ring *ring, const GByteArray *frame)
+{
+	struct ring_header *hdr;
+	guint pos, offset, room, size;
+
+	hdr = ring->header;
+	size = record_size(frame->len);
+	pos = g_atomic_int_get(&hdr->write_pos);
+	offset = pos & (hdr->size - 1);
+	room = hdr->size - offset;
+	if (room < size) {
+		/* Skip the end of the ring, records do not wrap. */
+		g_atomic_int_set(&hdr->reserve_pos, pos + room);
+		if (room >= SR_REMOTE_HEADER_SIZE) {
+			WL32(&ring->data[offset], 0);
+			WL16(&ring->data[offset + 4], RECORD_PAD);
+		}
+		pos += room;
+		g_atomic_int_set(&hdr->write_pos, pos);
+		offset = 0;
+	}
+
+	g_atomic_int_set(&hdr->reserve_pos, pos + size);
+	memcpy(&ring->data[offset], frame->data, frame->len);
+	g_atomic_int_set(&hdr->write_pos, pos + size);
+}
+
+static void ring_hello(struct sr_shm_ring *ring, const struct sr_dev_inst *sdi)
+{
+	struct ring_header *hdr;
+	GByteArray *hello;
+
+	hdr = ring->header;
+	hello = g_byte_array_new();
+	sr_remote_hello_encode(sdi, hello);
+	if (hello->len > RING_DATA_OFFSET - sizeof(*hdr)) {
+		sr_err("Device description exceeds the ring header.");
+		g_byte_array_free(hello, TRUE);
+		return;
+	}
+
+	/* Odd sequence numbers tell readers that an update is ongoing. */
+	g_atomic_int_inc(&hdr->hello_seq);
+	memcpy(hdr->hello, hello->data, hello->len);
+	hdr->hello_size = hello->len;
+	g_atomic_int_inc(&hdr->hello_seq);
+	g_byte_array_free(hello, TRUE);
+}
+
+/* Write a packet, split logic data which the ring cannot hold at once. */
+static void ring_packet(struct sr_shm_ring *ring,
+		const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	struct sr_datafeed_packet part;
+	struct sr_datafeed_logic chunk;
+	uint64_t max, chunk_max, pos;
+	uint16_t flags;
+
+	/* Frames take at most a quarter of the ring, so readers keep up. */
+	max = ring->header->size / 4;
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		chunk_max = max - SR_REMOTE_HEADER_SIZE - 64;
+		if (logic->unitsize && logic->length > chunk_max) {
+			max = chunk_max - chunk_max % logic->unitsize;
+			chunk = *logic;
+			part.type = SR_DF_LOGIC;
+			part.payload = &chunk;
+			for (pos = 0; pos < logic->length; pos += chunk.length) {
+				chunk.data = (uint8_t *)logic->data + pos;
+				chunk.length = MIN(max, logic->length - pos);
+				ring_packet(ring, &part);
+			}
+			return;
+		}
+	}
+
+	sr_remote_frame_init(ring->frame);
+	if (sr_remote_packet_encode(packet, NULL, ring->frame, &flags) != SR_OK)
+		return;
+	if (ring->frame->len > max) {
+		sr_warn("Packet of %u bytes exceeds the ring, dropping it.",
+			ring->frame->len);
+		return;
+	}
+	WL32(&ring->frame->data[0], ring->frame->len - SR_REMOTE_HEADER_SIZE);
+	WL16(&ring->frame->data[4], SR_REMOTE_FRAME_PACKET);
+	WL16(&ring->frame->data[6], flags);
+	ring_write(ring, ring->frame);
+}
+
+static void ring_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct sr_shm_ring *ring;
+	const struct sr_datafeed_meta *meta;
+	const struct sr_config *src;
+	GSList *l;
+
+	ring = cb_data;
+
+	/* Readers know the channels of one device only. */
+	if (!ring->sdi) {
+		ring->sdi = sdi;
+		ring_hello(ring, sdi);
+	}
+	if (sdi != ring->sdi)
+		return;
+
+	if (packet->type == SR_DF_META) {
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key == SR_CONF_SAMPLERATE)
+				ring->header->samplerate =
+					g_variant_get_uint64(src->data);
+		}
+	}
+	ring_packet(ring, packet);
+}
+
+static int map_file(const char *path, gboolean create, size_t create_size,
+		int *fd, uint8_t **map, size_t *map_size)
+{
+	struct stat st;
+	void *addr;
+
+	*fd = open(path, create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR, 0660);
+	if (*fd < 0) {
+		sr_err("Cannot open '%s': %s", path, g_strerror(errno));
+		return SR_ERR_IO;
+	}
+	if (create && ftruncate(*fd, create_size) != 0) {
+		sr_err("Cannot size '%s': %s", path, g_strerror(errno));
+		close(*fd);
+		return SR_ERR_IO;
+	}
+	if (fstat(*fd, &st) != 0 || st.st_size < RING_DATA_OFFSET) {
+		sr_err("'%s' is no shared memory ring.", path);
+		close(*fd);
+		return SR_ERR_DATA;
+	}
+
+	addr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		*fd, 0);
+	if (addr == MAP_FAILED) {
+		sr_err("Cannot map '%s': %s", path, g_strerror(errno));
+		close(*fd);
+		return SR_ERR_IO;
+	}
+	*map = addr;
+	*map_size = st.st_size;
+
+	return SR_OK;
+}
+
+/**
+ * Create a shared memory ring.
+ *
+ * An existing file at the path gets replaced.
+ *
+ * @param[out] ring Pointer where to store the new ring.
+ * @param[in] path The file to hold the ring, e.g. in /dev/shm.
+ * @param[in] size The size of the ring data in bytes. Gets rounded up
+ *                 to a power of two of at least 64KiB, and at most 1GiB.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_IO Cannot create the file.
+ * @retval SR_ERR_NA Shared memory is not supported on this platform.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_shm_ring_new(struct sr_shm_ring **ring, const char *path,
+		uint64_t size)
+{
+	struct sr_shm_ring *r;
+	uint32_t ring_size;
+	int ret;
+
+	if (!ring || !path || !size || size > RING_MAX_SIZE)
+		return SR_ERR_ARG;
+
+	ring_size = RING_MIN_SIZE;
+	while (ring_size < size)
+		ring_size <<= 1;
+
+	r = g_malloc0(sizeof(*r));
+	ret = map_file(path, TRUE, RING_DATA_OFFSET + ring_size, &r->fd,
+		&r->map, &r->map_size);
+	if (ret != SR_OK) {
+		g_free(r);
+		return ret;
+	}
+	r->header = (struct ring_header *)r->map;
+	r->data = r->map + RING_DATA_OFFSET;
+	r->frame = g_byte_array_new();
+	r->header->version = RING_VERSION;
+	r->header->size = ring_size;
+	g_atomic_int_set(&r->header->magic, RING_MAGIC);
+	*ring = r;
+
+	return SR_OK;
+}
+
+/**
+ * Share the datafeed of a session.
+ *
+ * Readers see the channels of the session's first device, and receive
+ * the packets of that device.
+ *
+ * @param[in] ring The shared memory ring.
+ * @param[in] session The session to share.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_shm_ring_attach(struct sr_shm_ring *ring,
+		struct sr_session *session)
+{
+	GSList *devices;
+
+	if (!ring || !session)
+		return SR_ERR_ARG;
+
+	ring->sdi = NULL;
+	if (sr_session_dev_list(session, &devices) == SR_OK && devices) {
+		ring->sdi = devices->data;
+		ring_hello(ring, ring->sdi);
+	}
+	g_slist_free(devices);
+
+	return sr_session_datafeed_callback_add(session, ring_datafeed, ring);
+}
+
+/**
+ * Get how far the readers of a shared memory ring lag behind.
+ *
+ * @param[in] ring The shared memory ring.
+ * @param[out] readers The number of attached readers. May be NULL.
+ * @param[out] max_lag The largest number of bytes which a reader has
+ *                     yet to read. May be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_shm_ring_reader_lag(struct sr_shm_ring *ring,
+		unsigned int *readers, uint64_t *max_lag)
+{
+	struct ring_header *hdr;
+	unsigned int count, i;
+	guint write_pos, lag, max;
+
+	if (!ring)
+		return SR_ERR_ARG;
+
+	hdr = ring->header;
+	write_pos = g_atomic_int_get(&hdr->write_pos);
+	count = 0;
+	max = 0;
+	for (i = 0; i < RING_MAX_READERS; i++) {
+		if (!g_atomic_int_get(&hdr->readers[i].active))
+			continue;
+		count++;
+		lag = write_pos - g_atomic_int_get(&hdr->readers[i].read_pos);
+		max = MAX(max, lag);
+	}
+	if (readers)
+		*readers = count;
+	if (max_lag)
+		*max_lag = max;
+
+	return SR_OK;
+}
+
+/**
+ * Destroy a shared memory ring.
+ *
+ * Readers see the ring closed. The file stays, and gets replaced by
+ * the next ring at the same path.
+ *
+ * @param[in] ring The shared memory ring to destroy. May be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_shm_ring_free(struct sr_shm_ring *ring)
+{
+	if (!ring)
+		return;
+
+	g_atomic_int_set(&ring->header->closed, 1);
+	munmap(ring->map, ring->map_size);
+	close(ring->fd);
+	g_byte_array_free(ring->frame, TRUE);
+	g_free(ring);
+}
+
+/**
+ * Attach to a shared memory ring as a reader.
+ *
+ * Reading starts at the most recent data.
+ *
+ * @param[out] reader Pointer where to store the new reader.
+ * @param[in] path The file which holds the ring.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_IO Cannot open the ring.
+ * @retval SR_ERR_DATA The file holds no valid ring.
+ * @retval SR_ERR All reader slots are taken.
+ *
+ * @private
+ */
+SR_PRIV int sr_shm_reader_open(struct sr_shm_reader **reader,
+		const char *path)
+{
+	struct sr_shm_reader *r;
+	struct ring_header *hdr;
+	int ret, i;
+
+	r = g_malloc0(sizeof(*r));
+	ret = map_file(path, FALSE, 0, &r->fd, &r->map, &r->map_size);
+	if (ret != SR_OK) {
+		g_free(r);
+		return ret;
+	}
+
+	hdr = (struct ring_header *)r->map;
+	if (g_atomic_int_get(&hdr->magic) != RING_MAGIC
+			|| hdr->version != RING_VERSION
+			|| hdr->size < RING_MIN_SIZE
+			|| (hdr->size & (hdr->size - 1))
+			|| RING_DATA_OFFSET + (size_t)hdr->size > r->map_size) {
+		sr_err("'%s' is no shared memory ring.", path);
+		sr_shm_reader_close(r);
+		return SR_ERR_DATA;
+	}
+	r->header = hdr;
+	r->data = r->map + RING_DATA_OFFSET;
+
+	r->slot = -1;
+	r->read_pos = g_atomic_int_get(&hdr->write_pos);
+	for (i = 0; i < RING_MAX_READERS; i++) {
+		if (!g_atomic_int_compare_and_exchange(&hdr->readers[i].active,
+				0, 1))
+			continue;
+		r->slot = i;
+		hdr->readers[i].pid = getpid();
+		g_atomic_int_set(&hdr->readers[i].read_pos, r->read_pos);
+		break;
+	}
+	if (r->slot < 0) {
+		sr_err("All %d reader slots of '%s' are taken.",
+			RING_MAX_READERS, path);
+		sr_shm_reader_close(r);
+		return SR_ERR;
+	}
+	*reader = r;
+
+	return SR_OK;
+}
+
+/**
+ * Set up a device from the description in a shared memory ring.
+ *
+ * @param[in] reader The reader.
+ * @param[in,out] sdi The device to take the description.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_NA The writer did not describe a device yet.
+ * @retval SR_ERR_DATA The description is invalid.
+ *
+ * @private
+ */
+SR_PRIV int sr_shm_reader_hello(struct sr_shm_reader *reader,
+		struct sr_dev_inst *sdi)
+{
+	struct ring_header *hdr;
+	uint8_t *hello;
+	size_t size;
+	gint seq;
+	int ret;
+
+	hdr = reader->header;
+	do {
+		seq = g_atomic_int_get(&hdr->hello_seq);
+		size = MIN(hdr->hello_size, RING_DATA_OFFSET - sizeof(*hdr));
+		hello = g_malloc(MAX(size, 1));
+		memcpy(hello, hdr->hello, size);
+		if (!(seq & 1) && seq == g_atomic_int_get(&hdr->hello_seq))
+			break;
+		g_free(hello);
+		g_usleep(1000);
+	} while (TRUE);
+
+	ret = seq ? sr_remote_hello_decode(sdi, hello, size) : SR_ERR_NA;
+	g_free(hello);
+
+	return ret;
+}
+
+/**
+ * Get the samplerate which the writer last announced.
+ *
+ * @param[in] reader The reader.
+ *
+ * @return The samplerate, or 0 if none is known.
+ *
+ * @private
+ */
+SR_PRIV uint64_t sr_shm_reader_samplerate(struct sr_shm_reader *reader)
+{
+	return reader->header->samplerate;
+}
+
+/**
+ * Copy the next frame out of a shared memory ring.
+ *
+ * @param[in] reader The reader.
+ * @param[out] frame Receives the complete frame, including its header.
+ * @param[out] lost Set to the number of bytes which were overwritten
+ *                  before the reader got to them, 0 if none.
+ *
+ * @retval SR_OK A frame was copied.
+ * @retval SR_ERR_NA No new data is available.
+ * @retval SR_ERR_IO The writer closed the ring.
+ * @retval SR_ERR_DATA The ring data is invalid.
+ *
+ * @private
+ */
+SR_PRIV int sr_shm_reader_next(struct sr_shm_reader *reader,
+		GByteArray *frame, uint64_t *lost)
+{
+	struct ring_header *hdr;
+	guint write_pos, offset, room, size;
+	uint32_t payload;
+	uint16_t type;
+
+	hdr = reader->header;
+	*lost = 0;
+	while (TRUE) {
+		write_pos = g_atomic_int_get(&hdr->write_pos);
+		if (write_pos == reader->read_pos)
+			return g_atomic_int_get(&hdr->closed) ? SR_ERR_IO : SR_ERR_NA;
+		if (write_pos - reader->read_pos > hdr->size) {
+			/* Lapped by the writer, continue with recent data. */
+			*lost += write_pos - reader->read_pos;
+			reader->read_pos = write_pos;
+			g_atomic_int_set(&hdr->readers[reader->slot].read_pos,
+				reader->read_pos);
+			continue;
+		}
+
+		offset = reader->read_pos & (hdr->size - 1);
+		room = hdr->size - offset;
+		type = RECORD_PAD;
+		payload = 0;
+		if (room >= SR_REMOTE_HEADER_SIZE) {
+			payload = RL32(&reader->data[offset]);
+			type = RL16(&reader->data[offset + 4]);
+		}
+		if (type == RECORD_PAD) {
+			size = room;
+		} else {
+			size = record_size(SR_REMOTE_HEADER_SIZE + (size_t)payload);
+			if (payload > hdr->size || size > room)
+				size = 0;
+			else
+				g_byte_array_set_size(frame,
+					SR_REMOTE_HEADER_SIZE + payload);
+			if (size)
+				memcpy(frame->data, &reader->data[offset],
+					frame->len);
+		}
+
+		/* The writer must not have touched what was just copied. */
+		if (g_atomic_int_get(&hdr->reserve_pos) - reader->read_pos
+				> hdr->size) {
+			*lost += write_pos - reader->read_pos;
+			reader->read_pos = g_atomic_int_get(&hdr->write_pos);
+			g_atomic_int_set(&hdr->readers[reader->slot].read_pos,
+				reader->read_pos);
+			continue;
+		}
+		if (!size) {
+			sr_err("Invalid record in shared memory ring.");
+			return SR_ERR_DATA;
+		}
+
+		reader->read_pos += size;
+		g_atomic_int_set(&hdr->readers[reader->slot].read_pos,
+			reader->read_pos);
+		if (type != RECORD_PAD)
+			return SR_OK;
+	}
+}
+
+/**
+ * Detach a reader from a shared memory ring.
+ *
+ * @param[in] reader The reader. May be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_shm_reader_close(struct sr_shm_reader *reader)
+{
+	if (!reader)
+		return;
+
+	if (reader->header && reader->slot >= 0)
+		g_atomic_int_set(&reader->header->readers[reader->slot].active, 0);
+	munmap(reader->map, reader->map_size);
+	close(reader->fd);
+	g_free(reader);
+}
+
+#else
+
+SR_API int sr_shm_ring_new(struct sr_shm_ring **ring, const char *path,
+		uint64_t size)
+{
+	(void)ring;
+	(void)path;
+	(void)size;
+
+	sr_err("Shared memory is not supported on this platform.");
+	return SR_ERR_NA;
+}
+
+SR_API int sr_shm_ring_attach(struct sr_shm_ring *ring,
+		struct sr_session *session)
+{
+	(void)ring;
+	(void)session;
+
+	return SR_ERR_ARG;
+}
+
+SR_API int sr_shm_ring_reader_lag(struct sr_shm_ring *ring,
+		unsigned int *readers, uint64_t *max_lag)
+{
+	(void)ring;
+	(void)readers;
+	(void)max_lag;
+
+	return SR_ERR_ARG;
+}
+
+SR_API void sr_shm_ring_free(struct sr_shm_ring *ring)
+{
+	(void)ring;
+}
+
+SR_PRIV int sr_shm_reader_open(struct sr_shm_reader **reader,
+		const char *path)
+{
+	(void)reader;
+	(void)path;
+
+	sr_err("Shared memory is not supported on this platform.");
+	return SR_ERR_NA;
+}
+
+SR_PRIV int sr_shm_reader_hello(struct sr_shm_reader *reader,
+		struct sr_dev_inst *sdi)
+{
+	(void)reader;
+	(void)sdi;
+
+	return SR_ERR_NA;
+}
+
+SR_PRIV uint64_t sr_shm_reader_samplerate(struct sr_shm_reader *reader)
+{
+	(void)reader;
+
+	return 0;
+}
+
+SR_PRIV int sr_shm_reader_next(struct sr_shm_reader *reader,
+		GByteArray *frame, uint64_t *lost)
+{
+	(void)reader;
+	(void)frame;
+	(void)lost;
+
+	return SR_ERR_IO;
+}
+
+SR_PRIV void sr_shm_reader_close(struct sr_shm_reader *reader)
+{
+	(void)reader;
+}
+
+#endif
+
+/** @} */
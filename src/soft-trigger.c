@@ -18,6 +18,7 @@
  */
 
 #include <config.h>
+#include <math.h>
 #include <string.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
@@ -41,7 +42,233 @@ SR_PRIV int logic_channel_unitsize(GSList *channels)
 	return (number + 7) / 8;
 }
 
-SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
+/*
+ * Trigger stages get compiled into bit masks when the soft trigger is
+ * created. Each mask covers the full unitsize (rounded up to a multiple
+ * of 64 bits), bit N of the sample data corresponds to channel index N.
+ * Checking a stage then is a few word wide AND/XOR/compare operations
+ * per sample, no matter how many channels participate in the stage.
+ */
+struct soft_trigger_stage_masks {
+	gboolean empty;
+	gboolean never;
+	gboolean need_prev;
+	uint64_t *level_mask;
+	uint64_t *level_value;
+	uint64_t *rise_mask;
+	uint64_t *fall_mask;
+	uint64_t *edge_mask;
+	/* Bits which need to change for the edge matches. */
+	uint64_t *change_mask;
+};
+
+static void mask_set_bit(uint64_t *mask, int index)
+{
+	uint8_t *bytes;
+
+	/* Byte addressing keeps the layout identical to sample data. */
+	bytes = (uint8_t *)mask;
+	bytes[index / 8] |= 1 << (index % 8);
+}
+
+static gboolean mask_get_bit(const uint64_t *mask, int index)
+{
+	const uint8_t *bytes;
+
+	bytes = (const uint8_t *)mask;
+
+	return (bytes[index / 8] & (1 << (index % 8))) != 0;
+}
+
+static int compile_stages(struct soft_trigger_logic *stl)
+{
+	struct sr_trigger_stage *stage;
+	struct sr_trigger_match *match;
+	struct soft_trigger_stage_masks *sm;
+	GSList *l, *m;
+	uint64_t *words;
+	int idx, nwords;
+
+	nwords = stl->num_words;
+	stl->num_stages = g_slist_length(stl->trigger->stages);
+	stl->stages = g_malloc0_n(stl->num_stages, sizeof(*stl->stages));
+	stl->stage_words = g_malloc0_n(stl->num_stages * 6 * nwords,
+		sizeof(uint64_t));
+
+	words = stl->stage_words;
+	for (l = stl->trigger->stages, sm = stl->stages; l; l = l->next, sm++) {
+		stage = l->data;
+		sm->level_mask = words;
+		sm->level_value = sm->level_mask + nwords;
+		sm->rise_mask = sm->level_value + nwords;
+		sm->fall_mask = sm->rise_mask + nwords;
+		sm->edge_mask = sm->fall_mask + nwords;
+		sm->change_mask = sm->edge_mask + nwords;
+		words = sm->change_mask + nwords;
+
+		/* No matches supplied, client error. Reported at check time. */
+		sm->empty = !stage->matches;
+
+		for (m = stage->matches; m; m = m->next) {
+			match = m->data;
+			/* Ignore disabled channels with a trigger. */
+			if (!match->channel->enabled)
+				continue;
+			idx = match->channel->index;
+			if (idx < 0 || idx >= stl->unitsize * 8) {
+				sr_err("Trigger channel %d exceeds unitsize %d.",
+					idx, stl->unitsize);
+				return SR_ERR_ARG;
+			}
+			switch (match->match) {
+			case SR_TRIGGER_ZERO:
+				/* Conflicting levels on one channel never match. */
+				if (mask_get_bit(sm->level_value, idx))
+					sm->never = TRUE;
+				mask_set_bit(sm->level_mask, idx);
+				break;
+			case SR_TRIGGER_ONE:
+				if (mask_get_bit(sm->level_mask, idx) &&
+				    !mask_get_bit(sm->level_value, idx))
+					sm->never = TRUE;
+				mask_set_bit(sm->level_mask, idx);
+				mask_set_bit(sm->level_value, idx);
+				break;
+			case SR_TRIGGER_RISING:
+				mask_set_bit(sm->rise_mask, idx);
+				mask_set_bit(sm->change_mask, idx);
+				sm->need_prev = TRUE;
+				break;
+			case SR_TRIGGER_FALLING:
+				mask_set_bit(sm->fall_mask, idx);
+				mask_set_bit(sm->change_mask, idx);
+				sm->need_prev = TRUE;
+				break;
+			case SR_TRIGGER_EDGE:
+				mask_set_bit(sm->edge_mask, idx);
+				mask_set_bit(sm->change_mask, idx);
+				sm->need_prev = TRUE;
+				break;
+			default:
+				sr_err("Unsupported logic trigger match %d.",
+					match->match);
+				return SR_ERR_ARG;
+			}
+		}
+	}
+
+	return SR_OK;
+}
+
+/* Return the oldest 'count' lent buffers to their owners. */
+static void pre_trigger_views_release(struct soft_trigger_logic *stl,
+		int count)
+{
+	struct soft_trigger_view *view;
+
+	while (count-- > 0 && stl->view_count > 0) {
+		view = &stl->views[stl->view_head];
+		stl->pre_trigger_fill -= view->length;
+		if (view->release)
+			view->release(view->buffer_priv);
+		memset(view, 0, sizeof(*view));
+		stl->view_head = (stl->view_head + 1) % stl->view_size;
+		stl->view_count--;
+	}
+}
+
+/* Trim or release the oldest views until at most 'keep' bytes remain. */
+static void pre_trigger_views_trim(struct soft_trigger_logic *stl, int keep)
+{
+	struct soft_trigger_view *view;
+	int excess;
+
+	excess = stl->pre_trigger_fill - MAX(keep, 0);
+	while (excess > 0 && stl->view_count > 0) {
+		view = &stl->views[stl->view_head];
+		if (view->length > excess) {
+			view->offset += excess;
+			view->length -= excess;
+			stl->pre_trigger_fill -= excess;
+			break;
+		}
+		excess -= view->length;
+		pre_trigger_views_release(stl, 1);
+	}
+}
+
+/*
+ * Keep a reference to a lent buffer. Older views are trimmed or released
+ * such that the retained data never exceeds the pre-trigger depth.
+ */
+static void pre_trigger_view_append(struct soft_trigger_logic *stl,
+		uint8_t *buf, int len,
+		soft_trigger_release_cb release, void *buffer_priv)
+{
+	struct soft_trigger_view *view, *grown;
+	int offset, size, i;
+
+	if (len <= 0 || stl->pre_trigger_size <= 0) {
+		if (release)
+			release(buffer_priv);
+		return;
+	}
+
+	/* Avoid uselessly retaining more than the pre-trigger size. */
+	offset = 0;
+	if (len > stl->pre_trigger_size) {
+		offset = len - stl->pre_trigger_size;
+		len = stl->pre_trigger_size;
+	}
+	pre_trigger_views_trim(stl, stl->pre_trigger_size - len);
+
+	if (stl->view_count == stl->view_size) {
+		/* Linearize the ring while growing it. */
+		size = stl->view_size * 2 + 4;
+		grown = g_malloc0_n(size, sizeof(*grown));
+		for (i = 0; i < stl->view_count; i++)
+			grown[i] = stl->views[(stl->view_head + i) % stl->view_size];
+		g_free(stl->views);
+		stl->views = grown;
+		stl->view_size = size;
+		stl->view_head = 0;
+	}
+
+	view = &stl->views[(stl->view_head + stl->view_count) % stl->view_size];
+	view->data = buf;
+	view->offset = offset;
+	view->length = len;
+	view->release = release;
+	view->buffer_priv = buffer_priv;
+	stl->view_count++;
+	stl->pre_trigger_fill += len;
+}
+
+/* Send the retained views as logic packets, then return them. */
+static void pre_trigger_views_send(struct soft_trigger_logic *stl,
+		int *pre_trigger_samples)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct soft_trigger_view *view;
+	int i;
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = stl->unitsize;
+
+	for (i = 0; i < stl->view_count; i++) {
+		view = &stl->views[(stl->view_head + i) % stl->view_size];
+		logic.length = view->length;
+		logic.data = view->data + view->offset;
+		sr_session_send(stl->sdi, &packet);
+		if (pre_trigger_samples)
+			*pre_trigger_samples += view->length / stl->unitsize;
+	}
+	pre_trigger_views_release(stl, stl->view_count);
+}
+
+static struct soft_trigger_logic *trigger_logic_alloc(
 		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
 		int pre_trigger_samples)
 {
@@ -51,8 +278,27 @@ SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 	stl->sdi = sdi;
 	stl->trigger = trigger;
 	stl->unitsize = logic_channel_unitsize(sdi->channels);
-	stl->prev_sample = g_malloc0(stl->unitsize);
+	stl->num_words = (stl->unitsize + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+	/* Padded to full words, the stage check loads whole words. */
+	stl->prev_sample = g_malloc0(stl->num_words * sizeof(uint64_t));
+	if (compile_stages(stl) != SR_OK) {
+		soft_trigger_logic_free(stl);
+		return NULL;
+	}
 	stl->pre_trigger_size = stl->unitsize * pre_trigger_samples;
+
+	return stl;
+}
+
+SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
+		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
+		int pre_trigger_samples)
+{
+	struct soft_trigger_logic *stl;
+
+	stl = trigger_logic_alloc(sdi, trigger, pre_trigger_samples);
+	if (!stl)
+		return NULL;
 	stl->pre_trigger_buffer = g_try_malloc(stl->pre_trigger_size);
 	if (pre_trigger_samples > 0 && !stl->pre_trigger_buffer) {
 		/*
@@ -73,10 +319,42 @@ SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 	return stl;
 }
 
+/**
+ * Create a soft trigger which keeps pre-trigger data by reference.
+ *
+ * Instead of copying every non-triggered sample into a private circular
+ * buffer, the trigger keeps views (buffer, offset, length) of the most
+ * recent buffers which were passed to soft_trigger_logic_check_lent().
+ * Only as many buffers as are needed to cover the pre-trigger depth are
+ * kept, older buffers get returned to the caller as soon as possible.
+ * Pre-trigger data then gets sent straight out of the lent buffers when
+ * the trigger fires.
+ *
+ * Buffers which are passed to soft_trigger_logic_check() get duplicated,
+ * so both check routines can be used with this kind of soft trigger.
+ */
+SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new_zerocopy(
+		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
+		int pre_trigger_samples)
+{
+	struct soft_trigger_logic *stl;
+
+	stl = trigger_logic_alloc(sdi, trigger, pre_trigger_samples);
+	if (!stl)
+		return NULL;
+	stl->zero_copy = TRUE;
+
+	return stl;
+}
+
 SR_PRIV void soft_trigger_logic_free(struct soft_trigger_logic *stl)
 {
+	pre_trigger_views_release(stl, stl->view_count);
+	g_free(stl->views);
 	g_free(stl->pre_trigger_buffer);
 	g_free(stl->prev_sample);
+	g_free(stl->stage_words);
+	g_free(stl->stages);
 	g_free(stl);
 }
 
@@ -138,36 +416,244 @@ static void pre_trigger_send(struct soft_trigger_logic *stl,
 	}
 }
 
-static gboolean logic_check_match(struct soft_trigger_logic *stl,
-		uint8_t *sample, struct sr_trigger_match *match)
+static inline uint64_t load_word(const uint8_t *p, int len)
+{
+	uint64_t w;
+
+	if (len >= (int)sizeof(w)) {
+		memcpy(&w, p, sizeof(w));
+		return w;
+	}
+	w = 0;
+	memcpy(&w, p, len);
+
+	return w;
+}
+
+/* Check one sample against a compiled stage. prev is NULL if unknown. */
+static inline gboolean stage_match(const struct soft_trigger_logic *stl,
+		const struct soft_trigger_stage_masks *sm,
+		const uint8_t *sample, const uint8_t *prev)
 {
-	int bit, prev_bit;
-	gboolean result;
+	uint64_t cur, last;
+	int w, len;
+
+	if (sm->never)
+		return FALSE;
+	if (sm->need_prev && !prev)
+		/* First sample, don't have enough for an edge match yet. */
+		return FALSE;
 
-	stl->count++;
-	result = FALSE;
-	bit = *(sample + match->channel->index / 8)
-			& (1 << (match->channel->index % 8));
-	if (match->match == SR_TRIGGER_ZERO)
-		result = bit == 0;
-	else if (match->match == SR_TRIGGER_ONE)
-		result = bit != 0;
-	else {
-		/* Edge matches. */
-		if (stl->count == 1)
-			/* First sample, don't have enough for an edge match yet. */
+	len = stl->unitsize;
+	for (w = 0; w < stl->num_words; w++) {
+		cur = load_word(sample, len);
+		if ((cur & sm->level_mask[w]) != sm->level_value[w])
 			return FALSE;
-		prev_bit = *(stl->prev_sample + match->channel->index / 8)
-				& (1 << (match->channel->index % 8));
-		if (match->match == SR_TRIGGER_RISING)
-			result = prev_bit == 0 && bit != 0;
-		else if (match->match == SR_TRIGGER_FALLING)
-			result = prev_bit != 0 && bit == 0;
-		else if (match->match == SR_TRIGGER_EDGE)
-			result = prev_bit != bit;
+		if (sm->need_prev) {
+			last = load_word(prev, len);
+			if ((cur & ~last & sm->rise_mask[w]) != sm->rise_mask[w])
+				return FALSE;
+			if ((~cur & last & sm->fall_mask[w]) != sm->fall_mask[w])
+				return FALSE;
+			if (((cur ^ last) & sm->edge_mask[w]) != sm->edge_mask[w])
+				return FALSE;
+			prev += sizeof(uint64_t);
+		}
+		sample += sizeof(uint64_t);
+		len -= sizeof(uint64_t);
+	}
+
+	return TRUE;
+}
+
+/*
+ * Find the first sample at or after 'from' which matches the stage.
+ * Returns the sample number, or -1 when no sample in the block matches.
+ * This is the hot loop while waiting for the trigger. Level-only stages
+ * search for the masked value, stages with edges only look at samples
+ * where the bits of the edges changed.
+ */
+static int stage_scan(const struct soft_trigger_logic *stl,
+		const struct soft_trigger_stage_masks *sm,
+		const uint8_t *buf, int from, int num_samples)
+{
+	const uint8_t *prev;
+	uint64_t s;
+
+	if (sm->never)
+		return -1;
+
+	if (!sm->need_prev) {
+		s = sr_logic_find_match(buf, stl->unitsize, from, num_samples,
+			(const uint8_t *)sm->level_mask,
+			(const uint8_t *)sm->level_value);
+		return s < (uint64_t)num_samples ? (int)s : -1;
+	}
+
+	for (s = from; s < (uint64_t)num_samples; ) {
+		if (s > 0)
+			prev = buf + (s - 1) * stl->unitsize;
+		else
+			prev = stl->count ? stl->prev_sample : NULL;
+		if (stage_match(stl, sm, buf + s * stl->unitsize, prev))
+			return s;
+		s = sr_logic_next_change(buf, stl->unitsize, s, num_samples,
+			(const uint8_t *)sm->change_mask);
+	}
+
+	return -1;
+}
+
+/*
+ * Run the trigger stages over a block of samples. Returns the offset (in
+ * samples) within buf of where the trigger occurred, or -1 if not
+ * triggered. Does not touch the pre-trigger data.
+ */
+static int trigger_scan(struct soft_trigger_logic *stl,
+		const uint8_t *buf, int len)
+{
+	const struct soft_trigger_stage_masks *sm;
+	const uint8_t *prev;
+	int num_samples, s, offset;
+
+	if (!stl->num_stages)
+		return SR_ERR_ARG;
+
+	num_samples = len / stl->unitsize;
+	offset = -1;
+	s = 0;
+	while (s < num_samples) {
+		sm = &stl->stages[stl->cur_stage];
+		if (sm->empty)
+			/* No matches supplied, client error. */
+			return SR_ERR_ARG;
+
+		if (stl->cur_stage == 0) {
+			/* Skip ahead to the first candidate in the block. */
+			s = stage_scan(stl, sm, buf, s, num_samples);
+			if (s < 0)
+				break;
+		} else {
+			if (s > 0)
+				prev = buf + (s - 1) * stl->unitsize;
+			else
+				prev = stl->count ? stl->prev_sample : NULL;
+			if (!stage_match(stl, sm, buf + s * stl->unitsize, prev)) {
+				/*
+				 * We had a match at an earlier stage, but failed
+				 * on the current stage. However, we may have a
+				 * match on this stage in the next bit -- trigger
+				 * on 0001 will fail on seeing 00001, so we need
+				 * to go back to stage 0 -- but at the next sample
+				 * from the one that matched originally.
+				 */
+				s -= stl->cur_stage - 1;
+				if (s < 0)
+					s = 0; /* Oops, went back past this buffer. */
+				/* Reset trigger stage. */
+				stl->cur_stage = 0;
+				continue;
+			}
+		}
+
+		/* Matched on the current stage. */
+		if (stl->cur_stage + 1 < stl->num_stages) {
+			/* Advance to next stage. */
+			stl->cur_stage++;
+			s++;
+			continue;
+		}
+
+		/* Matched on last stage. */
+		offset = s;
+		break;
+	}
+
+	/* Keep the last inspected sample for edge detection. */
+	if (num_samples > 0) {
+		s = (offset == -1) ? num_samples - 1 : offset;
+		memcpy(stl->prev_sample, buf + s * stl->unitsize, stl->unitsize);
+		stl->count++;
+	}
+
+	return offset;
+}
+
+/*
+ * Trigger matched at 'offset' within buf with a zero-copy soft trigger.
+ * Send the retained views and this buffer's pre-trigger part, then fire.
+ */
+static int trigger_fire_lent(struct soft_trigger_logic *stl,
+		uint8_t *buf, int offset, int *pre_trigger_samples)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	int len;
+
+	if (offset < 0)
+		return offset;
+
+	if (pre_trigger_samples)
+		*pre_trigger_samples = 0;
+
+	len = MIN(offset * stl->unitsize, stl->pre_trigger_size);
+	pre_trigger_views_trim(stl, stl->pre_trigger_size - len);
+	pre_trigger_views_send(stl, pre_trigger_samples);
+	if (len > 0) {
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &logic;
+		logic.unitsize = stl->unitsize;
+		logic.length = len;
+		logic.data = buf + offset * stl->unitsize - len;
+		sr_session_send(stl->sdi, &packet);
+		if (pre_trigger_samples)
+			*pre_trigger_samples += len / stl->unitsize;
 	}
 
-	return result;
+	/* Fire trigger. */
+	std_session_send_df_trigger(stl->sdi);
+
+	return offset;
+}
+
+/* Retain the data of a buffer without a match, for pre-trigger data. */
+static void pre_trigger_keep(struct soft_trigger_logic *stl,
+		uint8_t *buf, int len)
+{
+	uint8_t *copy;
+
+	if (!stl->zero_copy) {
+		pre_trigger_append(stl, buf, len);
+		return;
+	}
+
+	/* Caller keeps its buffer, retain a private copy instead. */
+	if (len > stl->pre_trigger_size) {
+		buf += len - stl->pre_trigger_size;
+		len = stl->pre_trigger_size;
+	}
+	if (len > 0) {
+		copy = g_malloc(len);
+		memcpy(copy, buf, len);
+		pre_trigger_view_append(stl, copy, len, g_free, copy);
+	}
+}
+
+/* Trigger matched at 'offset' within buf, send pre-trigger data and fire. */
+static int trigger_fire(struct soft_trigger_logic *stl,
+		uint8_t *buf, int offset, int *pre_trigger_samples)
+{
+	if (stl->zero_copy)
+		return trigger_fire_lent(stl, buf, offset, pre_trigger_samples);
+
+	/* Matched on last stage, send pre-trigger data. */
+	pre_trigger_append(stl, buf, offset * stl->unitsize);
+	pre_trigger_send(stl, pre_trigger_samples);
+
+	/* Fire trigger. */
+	std_session_send_df_trigger(stl->sdi);
+
+	return offset;
 }
 
 /* Returns the offset (in samples) within buf of where the trigger
@@ -175,69 +661,785 @@ static gboolean logic_check_match(struct soft_trigger_logic *stl,
 SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *stl,
 		uint8_t *buf, int len, int *pre_trigger_samples)
 {
+	int offset;
+
+	offset = trigger_scan(stl, buf, len);
+	if (offset < 0) {
+		if (offset == -1)
+			pre_trigger_keep(stl, buf, len);
+		return offset;
+	}
+
+	return trigger_fire(stl, buf, offset, pre_trigger_samples);
+}
+
+/**
+ * Switch a soft trigger to segmented capture.
+ *
+ * In segmented mode, soft_trigger_logic_segmented_send() sends a frame
+ * for each trigger match: the pre-trigger data, the trigger, and then
+ * post_trigger_samples samples. The trigger then re-arms, and collects
+ * pre-trigger data for the next segment from the samples after the
+ * frame. Samples outside of the frames get discarded.
+ *
+ * @param stl The soft trigger.
+ * @param post_trigger_samples Number of samples from the trigger on,
+ *        which each segment contains.
+ * @param num_segments Number of segments to capture, 0 for no limit.
+ */
+SR_PRIV void soft_trigger_logic_segments_set(struct soft_trigger_logic *stl,
+		uint64_t post_trigger_samples, uint64_t num_segments)
+{
+	stl->segmented = TRUE;
+	stl->post_trigger_samples = post_trigger_samples;
+	stl->num_segments = num_segments;
+	stl->segments_done = 0;
+	stl->segment_left = 0;
+	stl->in_segment = FALSE;
+}
+
+static void segment_end(struct soft_trigger_logic *stl)
+{
+	std_session_send_df_frame_end(stl->sdi);
+	stl->in_segment = FALSE;
+	stl->segments_done++;
+	stl->cur_stage = 0;
+}
+
+/**
+ * Check a buffer for trigger matches in segmented mode, and send the
+ * segments which it contains.
+ *
+ * The caller keeps ownership of the buffer. See
+ * soft_trigger_logic_segments_set().
+ *
+ * @param stl The soft trigger.
+ * @param buf The sample data.
+ * @param len Length of the sample data in bytes.
+ *
+ * @retval SR_OK Success. Check soft_trigger_logic_segments_done().
+ * @retval SR_ERR_ARG Invalid arguments, or the trigger has no matches.
+ */
+SR_PRIV int soft_trigger_logic_segmented_send(struct soft_trigger_logic *stl,
+		uint8_t *buf, int len)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint64_t count;
+	int offset;
+
+	if (!stl->segmented)
+		return SR_ERR_ARG;
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = stl->unitsize;
+
+	while (len >= stl->unitsize && !soft_trigger_logic_segments_done(stl)) {
+		if (stl->in_segment) {
+			/* Post-trigger part of the current segment. */
+			count = MIN((uint64_t)(len / stl->unitsize),
+				stl->segment_left);
+			if (count > 0) {
+				logic.length = count * stl->unitsize;
+				logic.data = buf;
+				sr_session_send(stl->sdi, &packet);
+				buf += logic.length;
+				len -= logic.length;
+				stl->segment_left -= count;
+				/* The next scan continues from here. */
+				memcpy(stl->prev_sample, buf - stl->unitsize,
+					stl->unitsize);
+			}
+			if (!stl->segment_left)
+				segment_end(stl);
+			continue;
+		}
+
+		offset = trigger_scan(stl, buf, len);
+		if (offset < 0) {
+			if (offset != -1)
+				return offset;
+			pre_trigger_keep(stl, buf, len);
+			break;
+		}
+
+		std_session_send_df_frame_begin(stl->sdi);
+		trigger_fire(stl, buf, offset, NULL);
+		buf += offset * stl->unitsize;
+		len -= offset * stl->unitsize;
+		stl->in_segment = TRUE;
+		stl->segment_left = stl->post_trigger_samples;
+		if (!stl->segment_left)
+			segment_end(stl);
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Check whether a segmented capture has all its segments.
+ */
+SR_PRIV gboolean soft_trigger_logic_segments_done(struct soft_trigger_logic *stl)
+{
+	return stl->segmented && stl->num_segments
+		&& stl->segments_done >= stl->num_segments;
+}
+
+/**
+ * Check a buffer for a trigger match, without sending any data.
+ *
+ * For consumers of the datafeed, which must not feed data back into the
+ * session. No pre-trigger data is kept, and the trigger re-arms after a
+ * match, so later matches can be found in subsequent buffers.
+ *
+ * @return The offset (in samples) within buf of where the trigger
+ *         occurred, -1 if not triggered, or negative SR_ERR_* codes.
+ */
+SR_PRIV int soft_trigger_logic_scan(struct soft_trigger_logic *stl,
+		const uint8_t *buf, int len)
+{
+	int offset;
+
+	offset = trigger_scan(stl, buf, len);
+	if (offset >= 0)
+		stl->cur_stage = 0;
+
+	return offset;
+}
+
+/**
+ * Check a lent buffer for a trigger match.
+ *
+ * Behaves like soft_trigger_logic_check(), but for triggers created by
+ * soft_trigger_logic_new_zerocopy() the buffer is not copied. When no
+ * trigger was found (return value -1), the soft trigger takes ownership
+ * of the buffer and invokes the release callback with buffer_priv when
+ * the data is no longer needed, which may happen before this routine
+ * returns. In all other cases (trigger found, or error), ownership stays
+ * with the caller and the release callback is not invoked for this buffer.
+ *
+ * @param stl The soft trigger.
+ * @param buf The sample data.
+ * @param len Length of the sample data in bytes.
+ * @param pre_trigger_samples Receives the number of pre-trigger samples
+ *        that were sent when the trigger fired. Can be NULL.
+ * @param release Routine which returns the buffer to its owner. Can be NULL.
+ * @param buffer_priv Opaque caller data that is passed to @a release.
+ *
+ * @return The offset (in samples) within buf of where the trigger
+ *         occurred, -1 if not triggered, or negative SR_ERR_* codes.
+ */
+SR_PRIV int soft_trigger_logic_check_lent(struct soft_trigger_logic *stl,
+		uint8_t *buf, int len, int *pre_trigger_samples,
+		soft_trigger_release_cb release, void *buffer_priv)
+{
+	int offset;
+
+	if (!stl->zero_copy) {
+		offset = soft_trigger_logic_check(stl, buf, len,
+			pre_trigger_samples);
+		if (offset == -1 && release)
+			release(buffer_priv);
+		return offset;
+	}
+
+	offset = trigger_scan(stl, buf, len);
+	if (offset == -1) {
+		pre_trigger_view_append(stl, buf, len, release, buffer_priv);
+		return offset;
+	}
+
+	return trigger_fire_lent(stl, buf, offset, pre_trigger_samples);
+}
+
+/*
+ * Analog soft trigger. Supports a single stage, with OVER, UNDER,
+ * RISING, FALLING and EDGE matches on analog channels. At most one of
+ * the matches can be an edge, which then gets searched for. The level
+ * matches of the stage must hold at the same sample. A window trigger
+ * is an OVER and an UNDER match on the same channel.
+ *
+ * Edges use hysteresis: a rising edge only gets armed once the value
+ * was below (level - hysteresis), a falling edge once it was above
+ * (level + hysteresis). Noise around the level does not fire the
+ * trigger repeatedly.
+ *
+ * The search runs on the raw values of the payload. The trigger level
+ * gets translated to a raw threshold per packet, from the packet's
+ * scale and offset, so no sample gets converted to float on the way.
+ */
+
+/* Edge search state. */
+enum {
+	ANALOG_EDGE_UNARMED,
+	ANALOG_EDGE_BELOW,
+	ANALOG_EDGE_ABOVE,
+};
+
+/* One channel's values within a packet. */
+struct analog_channel_view {
+	const uint8_t *data;
+	size_t stride;
+	const struct sr_analog_encoding *encoding;
+	double scale;
+	double offset;
+};
+
+struct soft_trigger_analog {
+	const struct sr_dev_inst *sdi;
+	/* The match which gets searched for comes first. */
+	struct sr_trigger_match *matches;
+	struct analog_channel_view *views;
+	int num_matches;
+	float hysteresis;
+	int edge_state;
+	/* Pre-trigger data, packed frames of the packets carrying matches[0]. */
+	int pre_trigger_samples;
+	uint8_t *pre_trigger_buffer;
+	int pre_trigger_head;
+	int pre_trigger_fill;
+	size_t frame_size;
+	GSList *channels;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+};
+
+static gboolean analog_view_init(struct analog_channel_view *view,
+		const struct sr_datafeed_analog *analog,
+		const struct sr_channel *ch)
+{
+	int pos;
+
+	pos = g_slist_index(analog->meaning->channels, ch);
+	if (pos < 0)
+		return FALSE;
+	view->encoding = analog->encoding;
+	view->data = (const uint8_t *)analog->data
+		+ pos * analog->encoding->unitsize;
+	view->stride = sr_analog_frame_size(analog);
+	sr_analog_channel_scaling(analog, pos, &view->scale, &view->offset);
+
+	return TRUE;
+}
+
+static double analog_view_raw(const struct analog_channel_view *view,
+		int64_t s)
+{
+	const struct sr_analog_encoding *enc;
+	const uint8_t *p;
+	gboolean be;
+
+	enc = view->encoding;
+	p = view->data + s * view->stride;
+	be = enc->is_bigendian;
+	if (enc->is_float) {
+		if (enc->unitsize == sizeof(double))
+			return be ? read_dblbe(p) : read_dblle(p);
+		return be ? read_fltbe(p) : read_fltle(p);
+	}
+	switch (enc->unitsize) {
+	case 1:
+		return enc->is_signed ? read_i8(p) : read_u8(p);
+	case 2:
+		if (enc->is_signed)
+			return be ? read_i16be(p) : read_i16le(p);
+		return be ? read_u16be(p) : read_u16le(p);
+	default:
+		if (enc->is_signed)
+			return be ? read_i32be(p) : read_i32le(p);
+		return be ? read_u32be(p) : read_u32le(p);
+	}
+}
+
+static double analog_view_value(const struct analog_channel_view *view,
+		int64_t s)
+{
+	return analog_view_raw(view, s) * view->scale + view->offset;
+}
+
+/*
+ * Scan loops for the first raw value beyond a threshold. Blocks of
+ * values get reduced to a single flag without an early exit, which
+ * compilers turn into vector compares. Only the block with the hit
+ * gets scanned value by value.
+ */
+#define ANALOG_SCAN_BLOCK 16
+
+#define DEFINE_ANALOG_SCAN(name, read, type) \
+static int64_t name(const uint8_t *p, size_t stride, int64_t s, int64_t n, \
+		type t, gboolean above) \
+{ \
+	int64_t k; \
+	int hit; \
+\
+	if (above) { \
+		for (; s + ANALOG_SCAN_BLOCK <= n; s += ANALOG_SCAN_BLOCK) { \
+			hit = 0; \
+			for (k = 0; k < ANALOG_SCAN_BLOCK; k++) \
+				hit |= (type)read(p + (s + k) * stride) > t; \
+			if (hit) \
+				break; \
+		} \
+		for (; s < n; s++) { \
+			if ((type)read(p + s * stride) > t) \
+				return s; \
+		} \
+	} else { \
+		for (; s + ANALOG_SCAN_BLOCK <= n; s += ANALOG_SCAN_BLOCK) { \
+			hit = 0; \
+			for (k = 0; k < ANALOG_SCAN_BLOCK; k++) \
+				hit |= (type)read(p + (s + k) * stride) < t; \
+			if (hit) \
+				break; \
+		} \
+		for (; s < n; s++) { \
+			if ((type)read(p + s * stride) < t) \
+				return s; \
+		} \
+	} \
+\
+	return -1; \
+}
+
+DEFINE_ANALOG_SCAN(scan_i8, read_i8, int64_t)
+DEFINE_ANALOG_SCAN(scan_u8, read_u8, int64_t)
+DEFINE_ANALOG_SCAN(scan_i16le, read_i16le, int64_t)
+DEFINE_ANALOG_SCAN(scan_i16be, read_i16be, int64_t)
+DEFINE_ANALOG_SCAN(scan_u16le, read_u16le, int64_t)
+DEFINE_ANALOG_SCAN(scan_u16be, read_u16be, int64_t)
+DEFINE_ANALOG_SCAN(scan_i32le, read_i32le, int64_t)
+DEFINE_ANALOG_SCAN(scan_i32be, read_i32be, int64_t)
+DEFINE_ANALOG_SCAN(scan_u32le, read_u32le, int64_t)
+DEFINE_ANALOG_SCAN(scan_u32be, read_u32be, int64_t)
+DEFINE_ANALOG_SCAN(scan_fltle, read_fltle, double)
+DEFINE_ANALOG_SCAN(scan_fltbe, read_fltbe, double)
+DEFINE_ANALOG_SCAN(scan_dblle, read_dblle, double)
+DEFINE_ANALOG_SCAN(scan_dblbe, read_dblbe, double)
+
+/*
+ * Find the first sample in [s, n) whose value is above (or below) the
+ * level, or return -1.
+ */
+static int64_t analog_view_find(const struct analog_channel_view *view,
+		int64_t s, int64_t n, double level, gboolean above)
+{
+	const struct sr_analog_encoding *enc;
+	const uint8_t *p;
+	size_t stride;
+	double raw;
+	int64_t t;
+	gboolean be;
+
+	if (s >= n)
+		return -1;
+	if (view->scale == 0) {
+		/* All values are the offset. */
+		if (above ? view->offset > level : view->offset < level)
+			return s;
+		return -1;
+	}
+
+	/* Translate the level to the raw domain. */
+	raw = (level - view->offset) / view->scale;
+	if (view->scale < 0)
+		above = !above;
+
+	enc = view->encoding;
+	p = view->data;
+	stride = view->stride;
+	be = enc->is_bigendian;
+	if (enc->is_float) {
+		if (enc->unitsize == sizeof(double))
+			return be ? scan_dblbe(p, stride, s, n, raw, above)
+				: scan_dblle(p, stride, s, n, raw, above);
+		return be ? scan_fltbe(p, stride, s, n, raw, above)
+			: scan_fltle(p, stride, s, n, raw, above);
+	}
+
+	/*
+	 * Integer values are above a threshold when they are above its
+	 * integral part, below it when they are below its ceiling. The
+	 * clamp keeps the conversion in range, 32 bit values never get
+	 * near it.
+	 */
+	raw = CLAMP(raw, -(double)(1LL << 40), (double)(1LL << 40));
+	t = above ? (int64_t)floor(raw) : (int64_t)ceil(raw);
+	switch (enc->unitsize) {
+	case 1:
+		return enc->is_signed ? scan_i8(p, stride, s, n, t, above)
+			: scan_u8(p, stride, s, n, t, above);
+	case 2:
+		if (enc->is_signed)
+			return be ? scan_i16be(p, stride, s, n, t, above)
+				: scan_i16le(p, stride, s, n, t, above);
+		return be ? scan_u16be(p, stride, s, n, t, above)
+			: scan_u16le(p, stride, s, n, t, above);
+	default:
+		if (enc->is_signed)
+			return be ? scan_i32be(p, stride, s, n, t, above)
+				: scan_i32le(p, stride, s, n, t, above);
+		return be ? scan_u32be(p, stride, s, n, t, above)
+			: scan_u32le(p, stride, s, n, t, above);
+	}
+}
+
+static gboolean analog_encoding_supported(const struct sr_analog_encoding *enc)
+{
+	if (enc->is_float)
+		return enc->unitsize == sizeof(float)
+			|| enc->unitsize == sizeof(double);
+
+	return enc->unitsize == 1 || enc->unitsize == 2 || enc->unitsize == 4;
+}
+
+/**
+ * Create an analog soft trigger.
+ *
+ * @param sdi The device instance, used for sending pre-trigger data.
+ * @param trigger The trigger, with a single stage of matches on analog
+ *                channels. Matches on disabled channels get ignored.
+ * @param pre_trigger_samples Number of samples which are kept, and sent
+ *                            before the trigger.
+ * @param hysteresis Distance from the level, in the channel's unit, which
+ *                   the value needs to move away before the next edge.
+ *
+ * @return The soft trigger, or NULL when the trigger is not supported.
+ */
+SR_PRIV struct soft_trigger_analog *soft_trigger_analog_new(
+		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
+		int pre_trigger_samples, float hysteresis)
+{
+	struct soft_trigger_analog *sta;
 	struct sr_trigger_stage *stage;
 	struct sr_trigger_match *match;
-	GSList *l, *l_stage;
-	int offset;
-	int i;
-	gboolean match_found;
+	GSList *l;
+	int num_edges, i;
 
-	offset = -1;
-	for (i = 0; i < len; i += stl->unitsize) {
-		l_stage = g_slist_nth(stl->trigger->stages, stl->cur_stage);
-		stage = l_stage->data;
-		if (!stage->matches)
-			/* No matches supplied, client error. */
-			return SR_ERR_ARG;
+	if (!trigger || g_slist_length(trigger->stages) != 1) {
+		sr_err("Analog soft trigger needs exactly one stage.");
+		return NULL;
+	}
+	stage = trigger->stages->data;
 
-		match_found = TRUE;
-		for (l = stage->matches; l; l = l->next) {
-			match = l->data;
-			if (!match->channel->enabled)
-				/* Ignore disabled channels with a trigger. */
-				continue;
-			if (!logic_check_match(stl, buf + i, match)) {
-				match_found = FALSE;
-				break;
+	sta = g_malloc0(sizeof(*sta));
+	sta->sdi = sdi;
+	sta->hysteresis = fabsf(hysteresis);
+	sta->pre_trigger_samples = MAX(pre_trigger_samples, 0);
+	sta->matches = g_malloc0(MAX(g_slist_length(stage->matches), 1)
+		* sizeof(*sta->matches));
+	sta->views = g_malloc0(MAX(g_slist_length(stage->matches), 1)
+		* sizeof(*sta->views));
+	num_edges = 0;
+	for (l = stage->matches; l; l = l->next) {
+		match = l->data;
+		if (!match->channel || !match->channel->enabled || !match->match)
+			continue;
+		if (match->channel->type != SR_CHANNEL_ANALOG) {
+			sr_err("Analog soft trigger on non-analog channel %s.",
+				match->channel->name);
+			soft_trigger_analog_free(sta);
+			return NULL;
+		}
+		switch (match->match) {
+		case SR_TRIGGER_RISING:
+		case SR_TRIGGER_FALLING:
+		case SR_TRIGGER_EDGE:
+			if (num_edges++) {
+				sr_err("Analog soft trigger supports one edge only.");
+				soft_trigger_analog_free(sta);
+				return NULL;
 			}
+			/* The edge gets searched for, move it to the front. */
+			for (i = sta->num_matches; i > 0; i--)
+				sta->matches[i] = sta->matches[i - 1];
+			sta->matches[0] = *match;
+			break;
+		case SR_TRIGGER_OVER:
+		case SR_TRIGGER_UNDER:
+			sta->matches[sta->num_matches] = *match;
+			break;
+		default:
+			sr_err("Unsupported analog trigger match %d.", match->match);
+			soft_trigger_analog_free(sta);
+			return NULL;
 		}
-		memcpy(stl->prev_sample, buf + i, stl->unitsize);
-		if (match_found) {
-			/* Matched on the current stage. */
-			if (l_stage->next) {
-				/* Advance to next stage. */
-				stl->cur_stage++;
-			} else {
-				/* Matched on last stage, send pre-trigger data. */
-				pre_trigger_append(stl, buf, i);
-				pre_trigger_send(stl, pre_trigger_samples);
-
-				/* Fire trigger. */
-				offset = i / stl->unitsize;
-
-				std_session_send_df_trigger(stl->sdi);
+		sta->num_matches++;
+	}
+	if (!sta->num_matches) {
+		sr_err("Analog soft trigger without matches.");
+		soft_trigger_analog_free(sta);
+		return NULL;
+	}
+
+	return sta;
+}
+
+SR_PRIV void soft_trigger_analog_free(struct soft_trigger_analog *sta)
+{
+	if (!sta)
+		return;
+	g_slist_free(sta->channels);
+	g_free((void *)sta->encoding.channel_scale);
+	g_free((void *)sta->encoding.channel_offset);
+	g_free(sta->pre_trigger_buffer);
+	g_free(sta->views);
+	g_free(sta->matches);
+	g_free(sta);
+}
+
+static gboolean analog_level_match(const struct sr_trigger_match *match,
+		const struct analog_channel_view *view, int64_t s)
+{
+	double value;
+
+	value = analog_view_value(view, s);
+	if (match->match == SR_TRIGGER_OVER)
+		return value > match->value;
+
+	return value < match->value;
+}
+
+/* Find the first sample of [0, n) where all matches hold, or return -1. */
+static int64_t analog_trigger_scan(struct soft_trigger_analog *sta,
+		const struct analog_channel_view *views, int64_t n)
+{
+	const struct sr_trigger_match *primary;
+	double level, h;
+	int64_t s, below, above;
+	int i;
+
+	primary = &sta->matches[0];
+	level = primary->value;
+	h = sta->hysteresis;
+	s = 0;
+	while (s < n) {
+		if (primary->match == SR_TRIGGER_OVER
+				|| primary->match == SR_TRIGGER_UNDER) {
+			s = analog_view_find(&views[0], s, n, level,
+				primary->match == SR_TRIGGER_OVER);
+		} else {
+			if (sta->edge_state == ANALOG_EDGE_UNARMED) {
+				below = above = -1;
+				if (primary->match != SR_TRIGGER_FALLING)
+					below = analog_view_find(&views[0], s, n,
+						level - h, FALSE);
+				if (primary->match != SR_TRIGGER_RISING)
+					above = analog_view_find(&views[0], s,
+						below < 0 ? n : below, level + h, TRUE);
+				if (above >= 0) {
+					sta->edge_state = ANALOG_EDGE_ABOVE;
+					s = above;
+				} else if (below >= 0) {
+					sta->edge_state = ANALOG_EDGE_BELOW;
+					s = below;
+				} else {
+					return -1;
+				}
+			}
+			s = analog_view_find(&views[0], s, n, level,
+				sta->edge_state == ANALOG_EDGE_BELOW);
+			if (s >= 0)
+				sta->edge_state = ANALOG_EDGE_UNARMED;
+		}
+		if (s < 0)
+			return -1;
+
+		for (i = 1; i < sta->num_matches; i++) {
+			if (!views[i].data
+					|| !analog_level_match(&sta->matches[i], &views[i], s))
 				break;
+		}
+		if (i == sta->num_matches)
+			return s;
+		s++;
+	}
+
+	return -1;
+}
+
+/*
+ * Keep the layout of the packets which carry pre-trigger data, to send
+ * the data later. The buffer restarts when the layout changes.
+ */
+static void pre_trigger_layout(struct soft_trigger_analog *sta,
+		const struct sr_datafeed_analog *analog)
+{
+	const struct sr_analog_encoding *enc;
+	size_t num_channels, frame_size, size;
+	GSList *l, *m;
+
+	enc = analog->encoding;
+	num_channels = MAX(g_slist_length(analog->meaning->channels), 1);
+	frame_size = enc->unitsize * num_channels;
+
+	if (sta->pre_trigger_buffer && frame_size == sta->frame_size
+			&& enc->unitsize == sta->encoding.unitsize
+			&& enc->is_float == sta->encoding.is_float
+			&& enc->is_signed == sta->encoding.is_signed
+			&& enc->is_bigendian == sta->encoding.is_bigendian
+			&& !memcmp(&enc->scale, &sta->encoding.scale, sizeof(enc->scale))
+			&& !memcmp(&enc->offset, &sta->encoding.offset, sizeof(enc->offset))
+			&& !enc->channel_scale == !sta->encoding.channel_scale
+			&& !enc->channel_offset == !sta->encoding.channel_offset
+			&& analog->meaning->mq == sta->meaning.mq
+			&& analog->meaning->unit == sta->meaning.unit
+			&& analog->meaning->mqflags == sta->meaning.mqflags) {
+		for (l = analog->meaning->channels, m = sta->channels;
+				l && m && l->data == m->data; l = l->next, m = m->next);
+		size = num_channels * sizeof(struct sr_rational);
+		if (!l && !m
+				&& (!enc->channel_scale || !memcmp(enc->channel_scale,
+					sta->encoding.channel_scale, size))
+				&& (!enc->channel_offset || !memcmp(enc->channel_offset,
+					sta->encoding.channel_offset, size)))
+			return;
+	}
+
+	g_slist_free(sta->channels);
+	g_free((void *)sta->encoding.channel_scale);
+	g_free((void *)sta->encoding.channel_offset);
+	g_free(sta->pre_trigger_buffer);
+
+	sta->frame_size = frame_size;
+	sta->pre_trigger_buffer = g_malloc(MAX(sta->pre_trigger_samples, 1)
+		* frame_size);
+	sta->pre_trigger_head = 0;
+	sta->pre_trigger_fill = 0;
+	sta->channels = g_slist_copy(analog->meaning->channels);
+	sta->meaning = *analog->meaning;
+	sta->meaning.channels = sta->channels;
+	sta->spec = analog->spec ? *analog->spec : (struct sr_analog_spec){ 0 };
+	sta->encoding = *enc;
+	sta->encoding.stride = 0;
+	size = num_channels * sizeof(struct sr_rational);
+	if (enc->channel_scale) {
+		sta->encoding.channel_scale = g_malloc(size);
+		memcpy((void *)sta->encoding.channel_scale, enc->channel_scale, size);
+	}
+	if (enc->channel_offset) {
+		sta->encoding.channel_offset = g_malloc(size);
+		memcpy((void *)sta->encoding.channel_offset, enc->channel_offset, size);
+	}
+}
+
+static void pre_trigger_analog_append(struct soft_trigger_analog *sta,
+		const struct sr_datafeed_analog *analog, int64_t count)
+{
+	const uint8_t *src;
+	size_t stride;
+	int64_t start, len;
+
+	if (!sta->pre_trigger_samples || count <= 0)
+		return;
+	pre_trigger_layout(sta, analog);
+
+	/* Avoid uselessly copying more than the pre-trigger size. */
+	start = MAX(count - sta->pre_trigger_samples, 0);
+	stride = sr_analog_frame_size(analog);
+	src = (const uint8_t *)analog->data + start * stride;
+	count -= start;
+	sta->pre_trigger_fill = MIN(sta->pre_trigger_fill + count,
+		sta->pre_trigger_samples);
+	while (count > 0) {
+		len = MIN(count, sta->pre_trigger_samples - sta->pre_trigger_head);
+		if (stride == sta->frame_size) {
+			memcpy(sta->pre_trigger_buffer
+				+ sta->pre_trigger_head * sta->frame_size,
+				src, len * stride);
+			src += len * stride;
+		} else {
+			for (start = 0; start < len; start++) {
+				memcpy(sta->pre_trigger_buffer
+					+ (sta->pre_trigger_head + start) * sta->frame_size,
+					src, sta->frame_size);
+				src += stride;
 			}
-		} else if (stl->cur_stage > 0) {
-			/*
-			 * We had a match at an earlier stage, but failed on the
-			 * current stage. However, we may have a match on this
-			 * stage in the next bit -- trigger on 0001 will fail on
-			 * seeing 00001, so we need to go back to stage 0 -- but
-			 * at the next sample from the one that matched originally,
-			 * which the counter increment at the end of the loop
-			 * takes care of.
-			 */
-			i -= stl->cur_stage * stl->unitsize;
-			if (i < -1)
-				i = -1; /* Oops, went back past this buffer. */
-			/* Reset trigger stage. */
-			stl->cur_stage = 0;
 		}
+		sta->pre_trigger_head = (sta->pre_trigger_head + len)
+			% sta->pre_trigger_samples;
+		count -= len;
 	}
+}
 
-	if (offset == -1)
-		pre_trigger_append(stl, buf, len);
+static void pre_trigger_analog_send(struct soft_trigger_analog *sta,
+		int *pre_trigger_samples)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	int tail, len;
+
+	if (pre_trigger_samples)
+		*pre_trigger_samples = 0;
+	if (!sta->pre_trigger_fill)
+		return;
+
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	analog.encoding = &sta->encoding;
+	analog.meaning = &sta->meaning;
+	analog.spec = &sta->spec;
+
+	/* Oldest samples first. */
+	tail = (sta->pre_trigger_head + sta->pre_trigger_samples
+		- sta->pre_trigger_fill) % sta->pre_trigger_samples;
+	while (sta->pre_trigger_fill > 0) {
+		len = MIN(sta->pre_trigger_fill, sta->pre_trigger_samples - tail);
+		analog.data = sta->pre_trigger_buffer + tail * sta->frame_size;
+		analog.num_samples = len;
+		sr_session_send(sta->sdi, &packet);
+		if (pre_trigger_samples)
+			*pre_trigger_samples += len;
+		tail = 0;
+		sta->pre_trigger_fill -= len;
+	}
+	sta->pre_trigger_head = 0;
+}
+
+/**
+ * Check an analog packet for a trigger match.
+ *
+ * Packets which do not carry the channel of the searched for match get
+ * ignored. Level matches on channels which the packet lacks never hold.
+ * When the trigger fires, the pre-trigger data and the SR_DF_TRIGGER
+ * packet get sent. The caller then sends the packet's samples from the
+ * returned offset on.
+ *
+ * @return The offset (in samples) within the packet of where the trigger
+ *         occurred, or -1 if not triggered.
+ */
+SR_PRIV int soft_trigger_analog_check(struct soft_trigger_analog *sta,
+		const struct sr_datafeed_analog *analog, int *pre_trigger_samples)
+{
+	struct analog_channel_view *views;
+	int64_t offset;
+	int i;
+
+	if (!analog->num_samples || !analog->meaning || !analog->encoding)
+		return -1;
+	if (!analog_encoding_supported(analog->encoding))
+		return -1;
+
+	views = sta->views;
+	for (i = 0; i < sta->num_matches; i++) {
+		if (!analog_view_init(&views[i], analog, sta->matches[i].channel))
+			views[i].data = NULL;
+	}
+	if (!views[0].data)
+		return -1;
+
+	offset = analog_trigger_scan(sta, views, analog->num_samples);
+	if (offset < 0) {
+		pre_trigger_analog_append(sta, analog, analog->num_samples);
+		return -1;
+	}
+
+	/* Send pre-trigger data, including the packet's data before the match. */
+	pre_trigger_analog_append(sta, analog, offset);
+	pre_trigger_analog_send(sta, pre_trigger_samples);
+
+	std_session_send_df_trigger(sta->sdi);
 
 	return offset;
 }
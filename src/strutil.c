@@ -23,6 +23,7 @@
 /** @endcond */
 #include <config.h>
 #include <ctype.h>
+#include <float.h>
 #include <locale.h>
 #if defined(__FreeBSD__) || defined(__APPLE__)
 #include <xlocale.h>
@@ -294,6 +295,584 @@ SR_PRIV int sr_atof(const char *str, float *ret)
 	return SR_OK;
 }
 
+/*
+ * Locale independent number parsers for text input. These work on text
+ * which need not be NUL terminated, report the position after the
+ * number, and neither allocate nor copy for common input.
+ *
+ * Decimals with up to 19 significant digits and values which doubles
+ * can represent exactly get converted directly. A mantissa below 2^53
+ * and a power of ten up to 10^22 are both exact, a single multiplication
+ * or division then rounds correctly. Other input takes a strtod() path.
+ */
+
+#define MAX_DECIMAL_DIGITS 19
+#define MAX_EXACT_MANTISSA (UINT64_C(1) << 53)
+
+/* Powers of ten which a double represents exactly. */
+static const double exact_pow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static inline uint64_t load_le64(const char *p)
+{
+	uint64_t w;
+
+	memcpy(&w, p, sizeof(w));
+
+	return GUINT64_FROM_LE(w);
+}
+
+/* Check whether all of eight characters are decimal digits. */
+static inline gboolean is_8digits(uint64_t w)
+{
+	return ((w & UINT64_C(0xf0f0f0f0f0f0f0f0)) |
+		(((w + UINT64_C(0x0606060606060606)) &
+		UINT64_C(0xf0f0f0f0f0f0f0f0)) >> 4)) ==
+		UINT64_C(0x3333333333333333);
+}
+
+/* Convert eight decimal digits, the first one being the most significant. */
+static inline uint32_t parse_8digits(uint64_t w)
+{
+	w -= UINT64_C(0x3030303030303030);
+	w = w * 10 + (w >> 8);
+	w = ((w & UINT64_C(0x000000ff000000ff)) * UINT64_C(0x000f424000000064) +
+		((w >> 16) & UINT64_C(0x000000ff000000ff)) *
+		UINT64_C(0x0000271000000001)) >> 32;
+
+	return w;
+}
+
+/*
+ * Accumulate the significant digits of a decimal number, leading zeros
+ * are skipped. Digits beyond what fits get counted in "dropped".
+ */
+static const char *scan_digits(const char *p, const char *end,
+	uint64_t *w, int *count, int *dropped)
+{
+	uint64_t v;
+	unsigned int c;
+
+	if (!*count) {
+		while (p < end && *p == '0')
+			p++;
+	}
+	while (end - p >= 8 && *count <= MAX_DECIMAL_DIGITS - 8) {
+		v = load_le64(p);
+		if (!is_8digits(v))
+			break;
+		*w = *w * 100000000 + parse_8digits(v);
+		*count += 8;
+		p += 8;
+	}
+	while (p < end && (c = (unsigned char)*p - '0') <= 9) {
+		if (*count < MAX_DECIMAL_DIGITS) {
+			*w = *w * 10 + c;
+			(*count)++;
+		} else {
+			(*dropped)++;
+		}
+		p++;
+	}
+
+	return p;
+}
+
+/* Convert w * 10^exp10 when the result is exact, or return FALSE. */
+static gboolean decimal_to_double(uint64_t w, int64_t exp10, double *ret)
+{
+#if FLT_EVAL_METHOD == 0 || FLT_EVAL_METHOD == 1
+	int64_t max_exp;
+
+	if (!w) {
+		*ret = 0.0;
+		return TRUE;
+	}
+	if (w > MAX_EXACT_MANTISSA)
+		return FALSE;
+	if (exp10 < 0 && exp10 >= -22) {
+		*ret = (double)w / exact_pow10[-exp10];
+		return TRUE;
+	}
+	if (exp10 < 0)
+		return FALSE;
+	/* Move excess powers of ten into the mantissa, while it is exact. */
+	max_exp = G_N_ELEMENTS(exact_pow10) - 1;
+	while (exp10 > max_exp) {
+		if (w > MAX_EXACT_MANTISSA / 10)
+			return FALSE;
+		w *= 10;
+		exp10--;
+	}
+	*ret = (double)w * exact_pow10[exp10];
+
+	return TRUE;
+#else
+	/* Excess precision of intermediate results would round twice. */
+	(void)w;
+	(void)exp10;
+	(void)ret;
+
+	return FALSE;
+#endif
+}
+
+/* Have strtod() convert the text, copy it when it lacks a terminator. */
+static int parse_double_strtod(const char *str, size_t len,
+	double *ret, const char **end)
+{
+	char buf[64], *copy, *endptr;
+	const char *text;
+	double value;
+	int ret_errno;
+
+	copy = NULL;
+	if (memchr(str, '\0', len)) {
+		text = str;
+	} else if (len < sizeof(buf)) {
+		memcpy(buf, str, len);
+		buf[len] = '\0';
+		text = buf;
+	} else {
+		text = copy = g_strndup(str, len);
+	}
+
+	errno = 0;
+	endptr = NULL;
+	value = g_ascii_strtod(text, &endptr);
+	ret_errno = errno;
+	if (!endptr || endptr == text)
+		ret_errno = EINVAL;
+	if (end)
+		*end = str + (endptr ? endptr - text : 0);
+	g_free(copy);
+	if (ret_errno) {
+		errno = ret_errno;
+		return SR_ERR;
+	}
+	*ret = value;
+
+	return SR_OK;
+}
+
+static int parse_double(const char *str, size_t len,
+	double *ret, int *digits, const char **end)
+{
+	const char *p, *stop, *q, *frac;
+	uint64_t w;
+	int64_t exp10, exp_value;
+	int count, dropped, dropped_int, frac_len;
+	gboolean negative, exp_negative, have_digits;
+	double value;
+
+	p = str;
+	stop = str + len;
+	while (p < stop && g_ascii_isspace(*p))
+		p++;
+	negative = FALSE;
+	if (p < stop && (*p == '-' || *p == '+'))
+		negative = *p++ == '-';
+
+	/* The mantissa's digits, and the position of its period. */
+	w = 0;
+	count = 0;
+	dropped = 0;
+	q = p;
+	p = scan_digits(p, stop, &w, &count, &dropped);
+	have_digits = p > q;
+	exp10 = dropped;
+	frac_len = 0;
+	if (p < stop && *p == '.') {
+		frac = ++p;
+		dropped_int = dropped;
+		p = scan_digits(p, stop, &w, &count, &dropped);
+		frac_len = p - frac;
+		have_digits |= frac_len > 0;
+		exp10 -= frac_len - (dropped - dropped_int);
+	}
+	if (digits)
+		*digits = 0;
+	if (!have_digits) {
+		/* Infinity, not-a-number, or invalid input. */
+		return parse_double_strtod(str, len, ret, end);
+	}
+
+	/* An optional exponent, which needs at least one digit. */
+	exp_value = 0;
+	if (p < stop && (*p == 'e' || *p == 'E')) {
+		q = p + 1;
+		exp_negative = FALSE;
+		if (q < stop && (*q == '-' || *q == '+'))
+			exp_negative = *q++ == '-';
+		if (q < stop && g_ascii_isdigit(*q)) {
+			while (q < stop && g_ascii_isdigit(*q)) {
+				if (exp_value < 100000)
+					exp_value = exp_value * 10 + (*q - '0');
+				q++;
+			}
+			if (exp_negative)
+				exp_value = -exp_value;
+			exp10 += exp_value;
+			p = q;
+		}
+	}
+	if (digits)
+		*digits = frac_len - exp_value;
+
+	/* Hexadecimal numbers, and values which are not exact. */
+	if (p < stop && (*p == 'x' || *p == 'X'))
+		return parse_double_strtod(str, len, ret, end);
+	if (dropped || !decimal_to_double(w, exp10, &value))
+		return parse_double_strtod(str, len, ret, end);
+
+	*ret = negative ? -value : value;
+	if (end)
+		*end = p;
+
+	return SR_OK;
+}
+
+/**
+ * Convert the text of a floating point number, independent of the locale.
+ *
+ * @param[in] str The input text, which need not be NUL terminated.
+ * @param[in] len The number of characters which may get read, the
+ *                terminating NUL character may be part of them.
+ * @param[out] ret The conversion result.
+ * @param[out] end The position after the number, can be NULL.
+ *
+ * @retval SR_OK Conversion successful.
+ * @retval SR_ERR No number, or out of range. Sets errno.
+ *
+ * Accepts the syntax of strtod(), leading whitespace is skipped. The
+ * result is correctly rounded.
+ *
+ * @private
+ */
+SR_PRIV int sr_parse_double_ascii(const char *str, size_t len,
+	double *ret, const char **end)
+{
+	return parse_double(str, len, ret, NULL, end);
+}
+
+/**
+ * Convert the text of an unsigned decimal integer, independent of the
+ * locale.
+ *
+ * @param[in] str The input text, which need not be NUL terminated.
+ * @param[in] len The number of characters which may get read.
+ * @param[out] ret The conversion result.
+ * @param[out] end The position after the digits, can be NULL.
+ *
+ * @retval SR_OK Conversion successful.
+ * @retval SR_ERR No digits, or out of range. Sets errno.
+ *
+ * Unlike strtoull(), neither accepts whitespace nor a sign.
+ *
+ * @private
+ */
+SR_PRIV int sr_parse_u64_ascii(const char *str, size_t len,
+	uint64_t *ret, const char **end)
+{
+	const char *p, *stop;
+	uint64_t w, v;
+	unsigned int c;
+
+	p = str;
+	stop = str + len;
+	w = 0;
+	while (stop - p >= 8 && p - str <= MAX_DECIMAL_DIGITS - 8) {
+		v = load_le64(p);
+		if (!is_8digits(v))
+			break;
+		w = w * 100000000 + parse_8digits(v);
+		p += 8;
+	}
+	while (p < stop && (c = (unsigned char)*p - '0') <= 9) {
+		if (w > (UINT64_MAX - c) / 10) {
+			if (end)
+				*end = p;
+			errno = ERANGE;
+			return SR_ERR;
+		}
+		w = w * 10 + c;
+		p++;
+	}
+	if (end)
+		*end = p;
+	if (p == str) {
+		errno = EINVAL;
+		return SR_ERR;
+	}
+	*ret = w;
+
+	return SR_OK;
+}
+
+/* Check whether all of eight characters are '0' or '1'. */
+static inline gboolean is_8bits(uint64_t w)
+{
+	return (w & UINT64_C(0xfefefefefefefefe)) == UINT64_C(0x3030303030303030);
+}
+
+/* Pack eight bit characters, the first one becomes the MSB. */
+static inline uint8_t pack_8bits(uint64_t w)
+{
+	w &= UINT64_C(0x0101010101010101);
+
+	return (w * UINT64_C(0x8040201008040201)) >> 56;
+}
+
+/**
+ * Convert the text of a bit string, the last character becomes bit 0.
+ *
+ * @param[in] str The input text, which need not be NUL terminated.
+ * @param[in] len The number of characters which may get read.
+ * @param[out] buf Receives the bits, least significant byte first, the
+ *                 bytes beyond the bit string get cleared.
+ * @param[in] size The size of buf in bytes.
+ * @param[out] count The number of bits in the text.
+ * @param[out] end The position after the bit string, can be NULL.
+ *
+ * @retval SR_OK Conversion successful.
+ * @retval SR_ERR No bits, or too many bits for buf. Sets errno.
+ *
+ * The bit string is the run of '0' and '1' characters at the start of
+ * the text.
+ *
+ * @private
+ */
+SR_PRIV int sr_parse_bits_ascii(const char *str, size_t len,
+	uint8_t *buf, size_t size, size_t *count, const char **end)
+{
+	const char *p;
+	size_t n, i;
+	int bit;
+
+	n = 0;
+	while (len - n >= 8 && is_8bits(load_le64(&str[n])))
+		n += 8;
+	while (n < len && (str[n] == '0' || str[n] == '1'))
+		n++;
+	if (end)
+		*end = &str[n];
+	if (!n) {
+		errno = EINVAL;
+		return SR_ERR;
+	}
+	if (n > size * 8) {
+		errno = ERANGE;
+		return SR_ERR;
+	}
+
+	memset(buf, 0, size);
+	p = &str[n];
+	i = 0;
+	while (p - str >= 8) {
+		p -= 8;
+		buf[i++] = pack_8bits(load_le64(p));
+	}
+	for (bit = 0; p > str; bit++) {
+		if (*--p == '1')
+			buf[i] |= 1 << bit;
+	}
+	*count = n;
+
+	return SR_OK;
+}
+
+/* Flag the bytes which are zero, in their most significant bit. */
+static inline uint64_t zero_bytes(uint64_t w)
+{
+	uint64_t low7;
+
+	low7 = UINT64_C(0x7f7f7f7f7f7f7f7f);
+
+	return ~(((w & low7) + low7) | w | low7);
+}
+
+/**
+ * Count the occurrences of a character in a text.
+ *
+ * @param[in] str The input text, which need not be NUL terminated.
+ * @param[in] len The number of characters to check.
+ * @param[in] c The character to count.
+ *
+ * @returns The number of occurrences.
+ *
+ * Checks eight characters at a time, which makes sizing the result of
+ * a comma separated list cheap.
+ *
+ * @private
+ */
+SR_PRIV size_t sr_count_char_ascii(const char *str, size_t len, char c)
+{
+	uint64_t pattern, w;
+	size_t n, i;
+
+	pattern = UINT64_C(0x0101010101010101) * (uint8_t)c;
+	n = 0;
+	for (i = 0; len - i >= 8; i += 8) {
+		w = zero_bytes(load_le64(&str[i]) ^ pattern) >> 7;
+		n += (w * UINT64_C(0x0101010101010101)) >> 56;
+	}
+	for (; i < len; i++)
+		n += str[i] == c;
+
+	return n;
+}
+
+/*
+ * Skip the separator after a list item: optional whitespace, then a
+ * comma or the end of the text. Returns NULL for other characters.
+ */
+static const char *list_next(const char *p, const char *stop, gboolean *last)
+{
+	while (p < stop && g_ascii_isspace(*p))
+		p++;
+	*last = p == stop || !*p;
+	if (*last)
+		return p;
+	if (*p != ',')
+		return NULL;
+
+	return p + 1;
+}
+
+/**
+ * Convert the text of a comma separated list of numbers to floats,
+ * independent of the locale.
+ *
+ * @param[in] str The input text, which need not be NUL terminated.
+ * @param[in] len The number of characters which may get read.
+ * @param[out] buf Receives the values.
+ * @param[in] size The number of values which buf can hold.
+ * @param[out] count The number of values which were stored, also when
+ *                   the conversion failed.
+ * @param[out] end The position after the list, or of the item which
+ *                 failed conversion, can be NULL.
+ *
+ * @retval SR_OK Conversion successful.
+ * @retval SR_ERR An invalid item, or too many items for buf. Sets errno.
+ *
+ * Items may be surrounded by whitespace. Empty text is an empty list.
+ * The conversion does not allocate memory, and converts the common
+ * notation of instruments without the help of strtod(). Which keeps
+ * large ASCII waveforms cheap.
+ *
+ * @private
+ */
+SR_PRIV int sr_parse_floatv_ascii(const char *str, size_t len,
+	float *buf, size_t size, size_t *count, const char **end)
+{
+	const char *p, *q, *stop;
+	gboolean last;
+	double value;
+	size_t n;
+	int ret;
+
+	p = str;
+	stop = str + len;
+	n = 0;
+	ret = SR_OK;
+	last = !len || !*str;
+	while (!last) {
+		if (parse_double(p, stop - p, &value, NULL, &q) != SR_OK) {
+			ret = SR_ERR;
+			break;
+		}
+		if (!(q = list_next(q, stop, &last))) {
+			errno = EINVAL;
+			ret = SR_ERR;
+			break;
+		}
+		if (n == size) {
+			errno = ERANGE;
+			ret = SR_ERR;
+			break;
+		}
+		buf[n++] = value;
+		p = q;
+	}
+	*count = n;
+	if (end)
+		*end = p;
+
+	return ret;
+}
+
+/**
+ * Convert the text of a comma separated list of unsigned 8 bit integers.
+ *
+ * @param[in] str The input text, which need not be NUL terminated.
+ * @param[in] len The number of characters which may get read.
+ * @param[out] buf Receives the values.
+ * @param[in] size The number of values which buf can hold.
+ * @param[out] count The number of values which were stored, also when
+ *                   the conversion failed.
+ * @param[out] end The position after the list, or of the item which
+ *                 failed conversion, can be NULL.
+ *
+ * @retval SR_OK Conversion successful.
+ * @retval SR_ERR An invalid item, a value above 255, or too many items
+ *                for buf. Sets errno.
+ *
+ * Items may be surrounded by whitespace, and may have a '+' sign. Empty
+ * text is an empty list.
+ *
+ * @private
+ */
+SR_PRIV int sr_parse_uint8v_ascii(const char *str, size_t len,
+	uint8_t *buf, size_t size, size_t *count, const char **end)
+{
+	const char *p, *q, *stop;
+	gboolean last;
+	uint64_t value;
+	size_t n;
+	int ret;
+
+	p = str;
+	stop = str + len;
+	n = 0;
+	ret = SR_OK;
+	last = !len || !*str;
+	while (!last) {
+		q = p;
+		while (q < stop && g_ascii_isspace(*q))
+			q++;
+		if (q < stop && *q == '+')
+			q++;
+		if (sr_parse_u64_ascii(q, stop - q, &value, &q) != SR_OK) {
+			ret = SR_ERR;
+			break;
+		}
+		if (value > UINT8_MAX) {
+			errno = ERANGE;
+			ret = SR_ERR;
+			break;
+		}
+		if (!(q = list_next(q, stop, &last))) {
+			errno = EINVAL;
+			ret = SR_ERR;
+			break;
+		}
+		if (n == size) {
+			errno = ERANGE;
+			ret = SR_ERR;
+			break;
+		}
+		buf[n++] = value;
+		p = q;
+	}
+	*count = n;
+	if (end)
+		*end = p;
+
+	return ret;
+}
+
 /**
  * Convert a string representation of a numeric value to a double. The
  * conversion is strict and will fail if the complete string does not represent
@@ -311,14 +890,12 @@ SR_PRIV int sr_atof(const char *str, float *ret)
 SR_PRIV int sr_atod_ascii(const char *str, double *ret)
 {
 	double tmp;
-	char *endptr = NULL;
-
-	errno = 0;
-	tmp = g_ascii_strtod(str, &endptr);
+	const char *endptr;
 
-	if (!endptr || *endptr || errno) {
-		if (!errno)
-			errno = EINVAL;
+	if (sr_parse_double_ascii(str, strlen(str) + 1, &tmp, &endptr) != SR_OK)
+		return SR_ERR;
+	if (*endptr) {
+		errno = EINVAL;
 		return SR_ERR;
 	}
 
@@ -340,55 +917,22 @@ SR_PRIV int sr_atod_ascii(const char *str, double *ret)
  */
 SR_PRIV int sr_atod_ascii_digits(const char *str, double *ret, int *digits)
 {
-	const char *p;
-	int *dig_ref, m_dig, exp;
-	char c;
+	const char *endptr;
+	int m_dig;
 	double f;
 
 	/*
 	 * Convert floating point text to the number value, _and_ get
-	 * the value's precision in the process. Steps taken to do it:
-	 * - Skip leading whitespace.
-	 * - Count the number of decimals after the mantissa's period.
-	 * - Get the exponent's signed value.
-	 *
-	 * This implementation still uses common code for the actual
-	 * conversion, but "violates API layers" by duplicating the
-	 * text scan, to get the number of significant digits.
+	 * the value's precision in the process: the number of decimals
+	 * after the mantissa's period, less the exponent's value.
 	 */
-	p = str;
-	while (*p && isspace(*p))
-		p++;
-	if (*p == '-' || *p == '+')
-		p++;
-	m_dig = 0;
-	exp = 0;
-	dig_ref = NULL;
-	while (*p) {
-		c = *p++;
-		if (toupper(c) == 'E') {
-			exp = strtol(p, NULL, 10);
-			break;
-		}
-		if (c == '.') {
-			m_dig = 0;
-			dig_ref = &m_dig;
-			continue;
-		}
-		if (isdigit(c)) {
-			if (dig_ref)
-				(*dig_ref)++;
-			continue;
-		}
-		/* Need not warn, conversion will fail. */
-		break;
-	}
-	sr_spew("atod digits: txt \"%s\" -> m %d, e %d -> digits %d",
-		str, m_dig, exp, m_dig + -exp);
-	m_dig += -exp;
-
-	if (sr_atod_ascii(str, &f) != SR_OK)
+	if (parse_double(str, strlen(str) + 1, &f, &m_dig, &endptr) != SR_OK)
 		return SR_ERR;
+	if (*endptr) {
+		errno = EINVAL;
+		return SR_ERR;
+	}
+	sr_spew("atod digits: txt \"%s\" -> digits %d", str, m_dig);
 	if (ret)
 		*ret = f;
 	if (digits)
@@ -414,16 +958,9 @@ SR_PRIV int sr_atod_ascii_digits(const char *str, double *ret, int *digits)
 SR_PRIV int sr_atof_ascii(const char *str, float *ret)
 {
 	double tmp;
-	char *endptr = NULL;
-
-	errno = 0;
-	tmp = g_ascii_strtod(str, &endptr);
 
-	if (!endptr || *endptr || errno) {
-		if (!errno)
-			errno = EINVAL;
+	if (sr_atod_ascii(str, &tmp) != SR_OK)
 		return SR_ERR;
-	}
 
 	/* FIXME This fails unexpectedly. Some other method to safel downcast
 	 * needs to be found. Checking against FLT_MAX doesn't work as well. */
@@ -0,0 +1,442 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Multi-resolution summaries of captures, which session files can carry
+ * so that zoomed out views need not read all of the samples.
+ *
+ * An entry of level 0 covers 2^SR_SUMMARY_SHIFT samples, an entry of
+ * level n covers twice the samples of level n - 1. The last entry of a
+ * level may cover fewer. Levels get added until one has a single entry.
+ *
+ * Each level of a stream is kept in an archive member named after the
+ * stream, "summary-logic-1-<level>" and "summary-analog-1-<nr>-<level>".
+ * Logic entries hold the OR and the AND of the samples (unitsize bytes
+ * each), followed by the number of transitions of each channel as 32-bit
+ * little endian values. A transition between the last sample of an entry
+ * and the first one of the next counts for the latter. Analog entries
+ * hold the minimum and maximum as little endian floats, NaN if all of
+ * the samples are. The "summary" member holds the parameters.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "summary"
+/** @endcond */
+
+#define SUMMARY_VERSION 1
+
+#define ANALOG_ENTRY_SIZE (2 * sizeof(float))
+
+/* The summary of the samples being collected for the current entry. */
+struct summary_logic {
+	size_t unitsize;
+	uint64_t fill;
+	gboolean have_prev;
+	uint8_t *prev;
+	uint8_t *or_mask;
+	uint8_t *and_mask;
+	uint32_t *transitions;
+	/* The completed entries of level 0. */
+	GByteArray *entries;
+};
+
+struct summary_analog {
+	uint64_t fill;
+	float min;
+	float max;
+	GByteArray *entries;
+};
+
+struct sr_summary {
+	struct summary_logic logic;
+	size_t num_analog;
+	struct summary_analog *analog;
+};
+
+/** @private */
+SR_PRIV size_t sr_summary_logic_entry_size(size_t unitsize)
+{
+	return 2 * unitsize + 8 * unitsize * sizeof(uint32_t);
+}
+
+/**
+ * Start collecting the summary of a capture.
+ *
+ * @param unitsize The size of a logic sample, 0 without logic data.
+ * @param num_analog The number of analog channels.
+ *
+ * @private
+ */
+SR_PRIV struct sr_summary *sr_summary_new(size_t unitsize, size_t num_analog)
+{
+	struct sr_summary *summary;
+	struct summary_logic *logic;
+	size_t i;
+
+	summary = g_malloc0(sizeof(*summary));
+	logic = &summary->logic;
+	logic->unitsize = unitsize;
+	if (unitsize) {
+		logic->prev = g_malloc0(unitsize);
+		logic->or_mask = g_malloc0(unitsize);
+		logic->and_mask = g_malloc0(unitsize);
+		logic->transitions = g_malloc0_n(8 * unitsize,
+			sizeof(logic->transitions[0]));
+		logic->entries = g_byte_array_new();
+	}
+	summary->num_analog = num_analog;
+	summary->analog = g_malloc0_n(MAX(num_analog, 1),
+		sizeof(summary->analog[0]));
+	for (i = 0; i < num_analog; i++)
+		summary->analog[i].entries = g_byte_array_new();
+
+	return summary;
+}
+
+/** @private */
+SR_PRIV void sr_summary_free(struct sr_summary *summary)
+{
+	size_t i;
+
+	if (!summary)
+		return;
+	g_free(summary->logic.prev);
+	g_free(summary->logic.or_mask);
+	g_free(summary->logic.and_mask);
+	g_free(summary->logic.transitions);
+	if (summary->logic.entries)
+		g_byte_array_free(summary->logic.entries, TRUE);
+	for (i = 0; i < summary->num_analog; i++)
+		g_byte_array_free(summary->analog[i].entries, TRUE);
+	g_free(summary->analog);
+	g_free(summary);
+}
+
+/* Add a sample to the current entry, starting a new one if needed. */
+static void logic_add(struct summary_logic *logic, const uint8_t *sample,
+		gboolean changed)
+{
+	size_t i;
+	uint8_t x;
+
+	if (!logic->fill) {
+		memset(logic->or_mask, 0x00, logic->unitsize);
+		memset(logic->and_mask, 0xff, logic->unitsize);
+		memset(logic->transitions, 0,
+			8 * logic->unitsize * sizeof(logic->transitions[0]));
+	}
+	for (i = 0; i < logic->unitsize; i++) {
+		logic->or_mask[i] |= sample[i];
+		logic->and_mask[i] &= sample[i];
+		if (!changed)
+			continue;
+		for (x = sample[i] ^ logic->prev[i]; x; x &= x - 1)
+			logic->transitions[8 * i + __builtin_ctz(x)]++;
+	}
+	if (changed)
+		memcpy(logic->prev, sample, logic->unitsize);
+}
+
+static void logic_entry_end(struct summary_logic *logic)
+{
+	uint8_t *p;
+	size_t i, len;
+
+	len = logic->entries->len;
+	g_byte_array_set_size(logic->entries,
+		len + sr_summary_logic_entry_size(logic->unitsize));
+	p = logic->entries->data + len;
+	memcpy(p, logic->or_mask, logic->unitsize);
+	p += logic->unitsize;
+	memcpy(p, logic->and_mask, logic->unitsize);
+	p += logic->unitsize;
+	for (i = 0; i < 8 * logic->unitsize; i++)
+		write_u32le_inc(&p, logic->transitions[i]);
+	logic->fill = 0;
+}
+
+/**
+ * Add logic samples to the summary. Runs of identical samples get
+ * skipped over rather than looked at one by one.
+ *
+ * @private
+ */
+SR_PRIV void sr_summary_logic_feed(struct sr_summary *summary,
+		const uint8_t *data, uint64_t count)
+{
+	struct summary_logic *logic;
+	const uint8_t *sample;
+	uint64_t i, next, run, n;
+
+	logic = &summary->logic;
+	if (!logic->unitsize)
+		return;
+
+	for (i = 0; i < count; i = next) {
+		sample = data + i * logic->unitsize;
+		logic_add(logic, sample, logic->have_prev
+			&& memcmp(sample, logic->prev, logic->unitsize));
+		if (!logic->have_prev) {
+			memcpy(logic->prev, sample, logic->unitsize);
+			logic->have_prev = TRUE;
+		}
+		next = sr_logic_next_change(data, logic->unitsize, i, count, NULL);
+		for (run = next - i; run; run -= n) {
+			n = MIN(run, (UINT64_C(1) << SR_SUMMARY_SHIFT) - logic->fill);
+			logic->fill += n;
+			if (logic->fill < UINT64_C(1) << SR_SUMMARY_SHIFT)
+				continue;
+			logic_entry_end(logic);
+			/* The rest of the run starts the next entry. */
+			if (run > n)
+				logic_add(logic, sample, FALSE);
+		}
+	}
+}
+
+static void analog_entry_end(struct summary_analog *analog)
+{
+	uint8_t entry[ANALOG_ENTRY_SIZE];
+
+	write_fltle(entry, analog->min);
+	write_fltle(entry + sizeof(float), analog->max);
+	g_byte_array_append(analog->entries, entry, sizeof(entry));
+	analog->fill = 0;
+}
+
+/**
+ * Add samples of an analog channel to the summary.
+ *
+ * @param index The number of the channel among the analog channels.
+ *
+ * @private
+ */
+SR_PRIV void sr_summary_analog_feed(struct sr_summary *summary, size_t index,
+		const float *data, uint64_t count)
+{
+	struct summary_analog *analog;
+	uint64_t i;
+
+	if (index >= summary->num_analog)
+		return;
+	analog = &summary->analog[index];
+
+	for (i = 0; i < count; i++) {
+		if (!analog->fill)
+			analog->min = analog->max = NAN;
+		/* fminf() and fmaxf() ignore NaN samples. */
+		analog->min = fminf(analog->min, data[i]);
+		analog->max = fmaxf(analog->max, data[i]);
+		if (++analog->fill == UINT64_C(1) << SR_SUMMARY_SHIFT)
+			analog_entry_end(analog);
+	}
+}
+
+/* Combine pairs of entries of a level into the entries of the next. */
+static GByteArray *logic_level_next(const GByteArray *level, size_t unitsize)
+{
+	GByteArray *next;
+	const uint8_t *a, *b;
+	uint8_t *p;
+	size_t entry_size, count, i, j;
+	uint64_t sum;
+
+	entry_size = sr_summary_logic_entry_size(unitsize);
+	count = level->len / entry_size;
+	next = g_byte_array_sized_new((count + 1) / 2 * entry_size);
+	g_byte_array_set_size(next, (count + 1) / 2 * entry_size);
+	for (i = 0; i < count; i += 2) {
+		a = level->data + i * entry_size;
+		p = next->data + i / 2 * entry_size;
+		if (i + 1 == count) {
+			memcpy(p, a, entry_size);
+			break;
+		}
+		b = a + entry_size;
+		for (j = 0; j < unitsize; j++) {
+			p[j] = a[j] | b[j];
+			p[unitsize + j] = a[unitsize + j] & b[unitsize + j];
+		}
+		for (j = 2 * unitsize; j < entry_size; j += 4) {
+			sum = (uint64_t)read_u32le(a + j) + read_u32le(b + j);
+			write_u32le(p + j, MIN(sum, UINT32_MAX));
+		}
+	}
+
+	return next;
+}
+
+static GByteArray *analog_level_next(const GByteArray *level)
+{
+	GByteArray *next;
+	const uint8_t *a, *b;
+	uint8_t *p;
+	size_t count, i;
+
+	count = level->len / ANALOG_ENTRY_SIZE;
+	next = g_byte_array_sized_new((count + 1) / 2 * ANALOG_ENTRY_SIZE);
+	g_byte_array_set_size(next, (count + 1) / 2 * ANALOG_ENTRY_SIZE);
+	for (i = 0; i < count; i += 2) {
+		a = level->data + i * ANALOG_ENTRY_SIZE;
+		p = next->data + i / 2 * ANALOG_ENTRY_SIZE;
+		if (i + 1 == count) {
+			memcpy(p, a, ANALOG_ENTRY_SIZE);
+			break;
+		}
+		b = a + ANALOG_ENTRY_SIZE;
+		write_fltle(p, fminf(read_fltle(a), read_fltle(b)));
+		write_fltle(p + sizeof(float), fmaxf(read_fltle(a + sizeof(float)),
+			read_fltle(b + sizeof(float))));
+	}
+
+	return next;
+}
+
+/*
+ * Write all levels of a stream, starting with the given level 0. For
+ * logic streams unitsize is non-zero.
+ */
+static int levels_write(struct sr_zip_writer *zw, const char *base,
+		GByteArray *level0, size_t unitsize)
+{
+	GByteArray *level, *next;
+	size_t entry_size;
+	unsigned int i;
+	char *name;
+	int ret;
+
+	entry_size = unitsize ? sr_summary_logic_entry_size(unitsize)
+		: ANALOG_ENTRY_SIZE;
+	if (!level0->len)
+		return SR_OK;
+
+	ret = SR_OK;
+	level = level0;
+	for (i = 0; ret == SR_OK; i++) {
+		name = g_strdup_printf("%s-%u", base, i);
+		ret = sr_zip_writer_add(zw, name, level->data, level->len);
+		g_free(name);
+		if (level->len <= entry_size)
+			break;
+		next = unitsize ? logic_level_next(level, unitsize)
+			: analog_level_next(level);
+		if (level != level0)
+			g_byte_array_free(level, TRUE);
+		level = next;
+	}
+	if (level != level0)
+		g_byte_array_free(level, TRUE);
+
+	return ret;
+}
+
+/**
+ * Complete the summary, and add it to a session file.
+ *
+ * @param summary The summary.
+ * @param zw The writer of the session file.
+ * @param first_analog_nr The number of the first analog channel in the
+ *                        names of the archive members.
+ *
+ * @private
+ */
+SR_PRIV int sr_summary_write(struct sr_summary *summary,
+		struct sr_zip_writer *zw, size_t first_analog_nr)
+{
+	GKeyFile *kf;
+	char *base, *data;
+	gsize len;
+	size_t i;
+	int ret;
+
+	ret = SR_OK;
+	if (summary->logic.unitsize) {
+		if (summary->logic.fill)
+			logic_entry_end(&summary->logic);
+		ret = levels_write(zw, "summary-logic-1", summary->logic.entries,
+			summary->logic.unitsize);
+	}
+	for (i = 0; i < summary->num_analog && ret == SR_OK; i++) {
+		if (summary->analog[i].fill)
+			analog_entry_end(&summary->analog[i]);
+		base = g_strdup_printf("summary-analog-1-%zu",
+			first_analog_nr + i);
+		ret = levels_write(zw, base, summary->analog[i].entries, 0);
+		g_free(base);
+	}
+	if (ret != SR_OK)
+		return ret;
+
+	kf = g_key_file_new();
+	g_key_file_set_integer(kf, "summary", "version", SUMMARY_VERSION);
+	g_key_file_set_integer(kf, "summary", "shift", SR_SUMMARY_SHIFT);
+	data = g_key_file_to_data(kf, &len, NULL);
+	g_key_file_free(kf);
+	ret = sr_zip_writer_add(zw, "summary", data, len);
+	g_free(data);
+
+	return ret;
+}
+
+/**
+ * Get the summary of one logic channel from entries of a summary level.
+ *
+ * @private
+ */
+SR_PRIV void sr_summary_logic_unpack(const uint8_t *entries, size_t unitsize,
+		unsigned int index, uint64_t count, struct sr_logic_summary *out)
+{
+	size_t entry_size, byte;
+	uint8_t bit;
+	uint64_t i;
+
+	entry_size = sr_summary_logic_entry_size(unitsize);
+	byte = index / 8;
+	bit = 1 << (index % 8);
+	for (i = 0; i < count; i++, entries += entry_size) {
+		out[i].high = (entries[byte] & bit) != 0;
+		out[i].low = !(entries[unitsize + byte] & bit);
+		out[i].transitions = read_u32le(entries + 2 * unitsize
+			+ index * sizeof(uint32_t));
+	}
+}
+
+/** @private */
+SR_PRIV void sr_summary_analog_unpack(const uint8_t *entries, uint64_t count,
+		struct sr_analog_summary *out)
+{
+	uint64_t i;
+
+	for (i = 0; i < count; i++, entries += ANALOG_ENTRY_SIZE) {
+		out[i].min = read_fltle(entries);
+		out[i].max = read_fltle(entries + sizeof(float));
+	}
+}
+
+/** @private */
+SR_PRIV size_t sr_summary_analog_entry_size(void)
+{
+	return ANALOG_ENTRY_SIZE;
+}
@@ -121,24 +121,61 @@ SR_PRIV void sr_sw_limits_acquisition_start(struct sr_sw_limits *limits)
 	limits->samples_read = 0;
 	limits->frames_read = 0;
 	limits->start_time = g_get_monotonic_time();
+	limits->stopped = FALSE;
 }
 
 /**
- * Check if any of the configured software limits has been reached
+ * Set the samplerate of the acquisition
  *
- * Usually should be called at the end of the drivers work function after all
- * processing has been done.
+ * With a known samplerate the time limit applies to the timestamps of the
+ * samples which have been read, rather than to the wall clock. The limit
+ * then gets reached at an exact sample, and checks don't need to read the
+ * clock. A samplerate of 0 returns to the wall clock.
  *
  * @param limits software limits instance
- * @returns TRUE if any of the software limits has been reached and the driver
- *               should stop data acquisition, otherwise FALSE.
+ * @param samplerate the samplerate in Hz
  */
-SR_PRIV gboolean sr_sw_limits_check(struct sr_sw_limits *limits)
+SR_PRIV void sr_sw_limits_set_samplerate(struct sr_sw_limits *limits,
+	uint64_t samplerate)
 {
-	if (limits->limit_samples) {
-		if (limits->samples_read >= limits->limit_samples) {
-			sr_dbg("Requested number of samples (%" PRIu64
-			       ") reached.", limits->limit_samples);
+	limits->samplerate = samplerate;
+}
+
+/*
+ * The sample count at which the samples limit, or the time limit when
+ * the samplerate is known, is reached. FALSE when neither applies.
+ */
+static gboolean sample_limit(const struct sr_sw_limits *limits,
+	uint64_t *limit)
+{
+	uint64_t msec_samples;
+
+	*limit = limits->limit_samples;
+	if (limits->limit_msec && limits->samplerate) {
+		/* limit_msec is in microseconds. */
+		msec_samples = limits->limit_msec / 1000000 * limits->samplerate;
+		msec_samples += limits->limit_msec % 1000000
+			* limits->samplerate / 1000000;
+		msec_samples = MAX(msec_samples, 1);
+		if (!*limit || msec_samples < *limit)
+			*limit = msec_samples;
+	}
+
+	return *limit != 0;
+}
+
+static gboolean limits_reached(const struct sr_sw_limits *limits)
+{
+	uint64_t limit;
+
+	if (sample_limit(limits, &limit)) {
+		if (limits->samples_read >= limit) {
+			if (limit == limits->limit_samples)
+				sr_dbg("Requested number of samples (%" PRIu64
+				       ") reached.", limits->limit_samples);
+			else
+				sr_dbg("Requested sampling time (%" PRIu64
+				       "ms) reached.", limits->limit_msec / 1000);
 			return TRUE;
 		}
 	}
@@ -151,7 +188,7 @@ SR_PRIV gboolean sr_sw_limits_check(struct sr_sw_limits *limits)
 		}
 	}
 
-	if (limits->limit_msec && limits->start_time) {
+	if (limits->limit_msec && limits->start_time && !limits->samplerate) {
 		guint64 now;
 		now = g_get_monotonic_time();
 		if (now > limits->start_time &&
@@ -165,6 +202,25 @@ SR_PRIV gboolean sr_sw_limits_check(struct sr_sw_limits *limits)
 	return FALSE;
 }
 
+/**
+ * Check if any of the configured software limits has been reached
+ *
+ * Usually should be called at the end of the drivers work function after all
+ * processing has been done.
+ *
+ * @param limits software limits instance
+ * @returns TRUE if any of the software limits has been reached and the driver
+ *               should stop data acquisition, otherwise FALSE. Also FALSE
+ *               when sr_sw_limits_send() already stopped the acquisition.
+ */
+SR_PRIV gboolean sr_sw_limits_check(struct sr_sw_limits *limits)
+{
+	if (limits->stopped)
+		return FALSE;
+
+	return limits_reached(limits);
+}
+
 /**
  * Get remaining counts until software limits are reached.
  *
@@ -199,15 +255,17 @@ SR_PRIV int sr_sw_limits_get_remain(const struct sr_sw_limits *limits,
 		*exceeded = FALSE;
 
 	if (samples) do {
+		uint64_t limit;
+
 		*samples = 0;
-		if (!limits->limit_samples)
+		if (!sample_limit(limits, &limit))
 			break;
-		if (limits->samples_read >= limits->limit_samples) {
+		if (limits->samples_read >= limit) {
 			if (exceeded)
 				*exceeded = TRUE;
 			break;
 		}
-		*samples = limits->limit_samples - limits->samples_read;
+		*samples = limit - limits->samples_read;
 	} while (0);
 
 	if (frames) do {
@@ -228,6 +286,17 @@ SR_PRIV int sr_sw_limits_get_remain(const struct sr_sw_limits *limits,
 		*msecs = 0;
 		if (!limits->limit_msec)
 			break;
+		if (limits->samplerate) {
+			elapsed = limits->samples_read * 1000
+				/ limits->samplerate * 1000;
+			if (elapsed >= limits->limit_msec) {
+				if (exceeded)
+					*exceeded = TRUE;
+				break;
+			}
+			*msecs = (limits->limit_msec - elapsed) / 1000;
+			break;
+		}
 		if (!limits->start_time)
 			break;
 		now = g_get_monotonic_time();
@@ -279,3 +348,131 @@ SR_PRIV void sr_sw_limits_update_frames_read(struct sr_sw_limits *limits,
 {
 	limits->frames_read += frames_read;
 }
+
+static gboolean has_logic_channels(const struct sr_dev_inst *sdi)
+{
+	const struct sr_channel *ch;
+	const GSList *l;
+
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type == SR_CHANNEL_LOGIC && ch->enabled)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+ * Send a packet, and enforce the software limits on it
+ *
+ * Sample data gets clipped to the samples which remain until the samples
+ * limit, or the time limit with a known samplerate, is reached (see
+ * sr_sw_limits_set_samplerate()). The packet which reaches a limit stops
+ * the acquisition right after it was sent, so that consumers never see
+ * data beyond the limit. Sample data which the driver sends after that
+ * gets dropped, and sr_sw_limits_check() returns FALSE from then on.
+ *
+ * Logic samples count towards the limit. Analog samples count when the
+ * device has no enabled logic channels, and then are expected to carry
+ * all channels in each packet. Drivers which send analog channels in
+ * packets of their own should keep to sr_sw_limits_update_samples_read()
+ * and sr_sw_limits_check().
+ *
+ * @param limits software limits instance
+ * @param sdi the device instance which sends the packet
+ * @param packet the packet to send
+ * @return the result of sr_session_send(), SR_ERR_ARG for invalid arguments
+ */
+SR_PRIV int sr_sw_limits_send(struct sr_sw_limits *limits,
+	struct sr_dev_inst *sdi, const struct sr_datafeed_packet *packet)
+{
+	struct sr_datafeed_packet clipped;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_logic_rle rle;
+	struct sr_datafeed_analog analog;
+	const struct sr_datafeed_logic *logic_in;
+	const struct sr_datafeed_logic_rle *rle_in;
+	const struct sr_datafeed_analog *analog_in;
+	uint64_t samples, limit, remain;
+	gboolean is_data, counted;
+	int ret;
+
+	if (!limits || !sdi || !packet)
+		return SR_ERR_ARG;
+
+	samples = 0;
+	is_data = TRUE;
+	counted = TRUE;
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic_in = packet->payload;
+		if (logic_in->unitsize)
+			samples = logic_in->length / logic_in->unitsize;
+		break;
+	case SR_DF_LOGIC_RLE:
+		rle_in = packet->payload;
+		samples = rle_in->num_samples;
+		break;
+	case SR_DF_ANALOG:
+		analog_in = packet->payload;
+		samples = analog_in->num_samples;
+		counted = !has_logic_channels(sdi);
+		break;
+	default:
+		is_data = FALSE;
+		counted = FALSE;
+		break;
+	}
+
+	if (is_data && limits->stopped)
+		return SR_OK;
+
+	if (counted && samples && sample_limit(limits, &limit)) {
+		remain = 0;
+		if (limits->samples_read < limit)
+			remain = limit - limits->samples_read;
+		if (samples > remain) {
+			sr_spew("Clipping %" PRIu64 " samples to %" PRIu64 ".",
+				samples, remain);
+			samples = remain;
+			clipped.type = packet->type;
+			switch (packet->type) {
+			case SR_DF_LOGIC:
+				logic = *logic_in;
+				logic.length = samples * logic.unitsize;
+				clipped.payload = &logic;
+				break;
+			case SR_DF_LOGIC_RLE:
+				rle = *rle_in;
+				rle.num_samples = samples;
+				while (rle.num_changes && rle.offsets[
+						rle.num_changes - 1] >= samples)
+					rle.num_changes--;
+				clipped.payload = &rle;
+				break;
+			default:
+				analog = *analog_in;
+				analog.num_samples = samples;
+				clipped.payload = &analog;
+				break;
+			}
+			packet = &clipped;
+		}
+	}
+
+	ret = SR_OK;
+	if (!counted || samples)
+		ret = sr_session_send(sdi, packet);
+	if (counted)
+		limits->samples_read += samples;
+	if (packet->type == SR_DF_FRAME_END)
+		limits->frames_read++;
+
+	if (!limits->stopped && limits_reached(limits)) {
+		limits->stopped = TRUE;
+		sr_dev_acquisition_stop(sdi);
+	}
+
+	return ret;
+}
@@ -0,0 +1,264 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Tracing of the datafeed's hot paths. While tracing is active, each
+ * thread records timestamped events into a ring buffer of its own, so
+ * recording takes neither locks nor allocations. The rings keep the
+ * most recent events, and get exported in the Chrome trace event JSON
+ * format, which Perfetto as well as chrome://tracing can read.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "trace"
+
+/* Number of events per thread, a power of two. */
+#define TRACE_RING_SIZE 16384
+
+struct trace_event {
+	int64_t time_us;
+	uint64_t arg;
+	uint16_t type;
+	uint16_t phase;
+};
+
+struct trace_ring {
+	struct trace_event events[TRACE_RING_SIZE];
+	uint64_t count;
+	unsigned int id;
+	int generation;
+	gint exited;
+};
+
+SR_PRIV int sr_trace_active;
+
+/* All rings, and the current tracing run. */
+static GMutex trace_mutex;
+static GSList *trace_rings;
+static unsigned int trace_ring_id;
+static int trace_generation;
+
+static void trace_ring_exited(void *data)
+{
+	struct trace_ring *ring;
+
+	/* The ring stays for the export, sr_trace_start() releases it. */
+	ring = data;
+	g_atomic_int_set(&ring->exited, TRUE);
+}
+
+static GPrivate trace_ring = G_PRIVATE_INIT(trace_ring_exited);
+
+static const char *trace_event_names[] = {
+	[SR_TRACE_USB_DISPATCH] = "usb dispatch",
+	[SR_TRACE_USB_TRANSFER] = "usb transfer",
+	[SR_TRACE_SESSION_SEND] = "session send",
+	[SR_TRACE_TRANSFORM] = "transform",
+	[SR_TRACE_DATAFEED_CB] = "datafeed callback",
+	[SR_TRACE_OUTPUT_RECEIVE] = "output receive",
+};
+
+static struct trace_ring *trace_ring_get(void)
+{
+	struct trace_ring *ring;
+
+	ring = g_private_get(&trace_ring);
+	if (ring)
+		return ring;
+
+	ring = g_malloc0(sizeof(*ring));
+	g_mutex_lock(&trace_mutex);
+	ring->id = ++trace_ring_id;
+	ring->generation = trace_generation;
+	trace_rings = g_slist_prepend(trace_rings, ring);
+	g_mutex_unlock(&trace_mutex);
+	g_private_set(&trace_ring, ring);
+
+	return ring;
+}
+
+/**
+ * Record a trace event in the current thread's ring. Use sr_trace(),
+ * which only calls this while tracing is active.
+ *
+ * @private
+ */
+SR_PRIV void sr_trace_record(int type, int phase, uint64_t arg)
+{
+	struct trace_ring *ring;
+	struct trace_event *event;
+	int generation;
+
+	ring = trace_ring_get();
+	generation = g_atomic_int_get(&trace_generation);
+	if (ring->generation != generation) {
+		ring->generation = generation;
+		ring->count = 0;
+	}
+
+	event = &ring->events[ring->count++ & (TRACE_RING_SIZE - 1)];
+	event->time_us = g_get_monotonic_time();
+	event->arg = arg;
+	event->type = type;
+	event->phase = phase;
+}
+
+/**
+ * Start tracing the datafeed.
+ *
+ * Events of a previous run get discarded. Tracing costs a test per
+ * trace point while it is not active.
+ *
+ * @return SR_OK upon success.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_trace_start(void)
+{
+	GSList *l, *next;
+	struct trace_ring *ring;
+
+	g_mutex_lock(&trace_mutex);
+	for (l = trace_rings; l; l = next) {
+		next = l->next;
+		ring = l->data;
+		if (!g_atomic_int_get(&ring->exited))
+			continue;
+		trace_rings = g_slist_delete_link(trace_rings, l);
+		g_free(ring);
+	}
+	g_atomic_int_inc(&trace_generation);
+	g_mutex_unlock(&trace_mutex);
+
+	g_atomic_int_set(&sr_trace_active, 1);
+	sr_dbg("Tracing started.");
+
+	return SR_OK;
+}
+
+/**
+ * Stop tracing the datafeed. The recorded events are kept for
+ * sr_trace_export().
+ *
+ * @return SR_OK upon success.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_trace_stop(void)
+{
+	g_atomic_int_set(&sr_trace_active, 0);
+	sr_dbg("Tracing stopped.");
+
+	return SR_OK;
+}
+
+static void trace_ring_export(FILE *file, const struct trace_ring *ring,
+	gboolean *first)
+{
+	const struct trace_event *event;
+	uint64_t idx;
+	const char *name;
+	char phase;
+
+	idx = 0;
+	if (ring->count > TRACE_RING_SIZE)
+		idx = ring->count - TRACE_RING_SIZE;
+	for (; idx < ring->count; idx++) {
+		event = &ring->events[idx & (TRACE_RING_SIZE - 1)];
+		name = "unknown";
+		if (event->type < ARRAY_SIZE(trace_event_names))
+			name = trace_event_names[event->type];
+		if (event->phase == SR_TRACE_BEGIN)
+			phase = 'B';
+		else if (event->phase == SR_TRACE_END)
+			phase = 'E';
+		else
+			phase = 'i';
+		fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"%c\","
+			"\"ts\":%" PRId64 ",\"pid\":1,\"tid\":%u,"
+			"\"args\":{\"arg\":%" PRIu64 "}%s}",
+			*first ? "" : ",", name, phase, event->time_us,
+			ring->id, event->arg, phase == 'i' ? ",\"s\":\"t\"" : "");
+		*first = FALSE;
+	}
+}
+
+/**
+ * Export the events of the last tracing run.
+ *
+ * The file is in the Chrome trace event JSON format, which Perfetto
+ * and chrome://tracing can open. Each thread appears as a track of
+ * its own. Tracing must be stopped before the export.
+ *
+ * @param filename The name of the file to write. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or tracing is active.
+ * @retval SR_ERR_IO The file could not be written.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_trace_export(const char *filename)
+{
+	FILE *file;
+	GSList *l;
+	struct trace_ring *ring;
+	gboolean first;
+	int ret;
+
+	if (!filename)
+		return SR_ERR_ARG;
+	if (g_atomic_int_get(&sr_trace_active)) {
+		sr_err("Cannot export while tracing is active.");
+		return SR_ERR_ARG;
+	}
+
+	file = g_fopen(filename, "w");
+	if (!file) {
+		sr_err("Cannot create trace file '%s'.", filename);
+		return SR_ERR_IO;
+	}
+
+	fputs("{\"traceEvents\":[", file);
+	first = TRUE;
+	g_mutex_lock(&trace_mutex);
+	for (l = trace_rings; l; l = l->next) {
+		ring = l->data;
+		if (ring->generation != trace_generation)
+			continue;
+		trace_ring_export(file, ring, &first);
+	}
+	g_mutex_unlock(&trace_mutex);
+	fputs("\n],\"displayTimeUnit\":\"ns\"}\n", file);
+
+	ret = SR_OK;
+	if (ferror(file))
+		ret = SR_ERR_IO;
+	if (fclose(file) != 0)
+		ret = SR_ERR_IO;
+	if (ret != SR_OK)
+		sr_err("Cannot write trace file '%s'.", filename);
+
+	return ret;
+}
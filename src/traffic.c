@@ -0,0 +1,203 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Recording of the data which devices send, for later replay without
+ * the device. When the SIGROK_TRAFFIC_RECORD environment variable names
+ * a file, the serial and the USB stream support code append all data
+ * which they receive to it. The serial "replay/<file>" transport plays
+ * it back to drivers, tests/bench_replay.c measures their throughput.
+ *
+ * The file starts with a magic, followed by records of a header (the
+ * kind of data, the USB endpoint, the payload length as little endian
+ * 32bit number) and the payload.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "traffic"
+
+#define TRAFFIC_MAGIC		"SRTRAFC1"
+#define TRAFFIC_MAGIC_LEN	8
+#define TRAFFIC_HEADER_LEN	8
+
+static GMutex record_mutex;
+static FILE *record_file;
+static gboolean record_failed;
+static gsize record_path_init;
+static const char *record_path;
+
+static gboolean record_enabled(void)
+{
+	if (g_once_init_enter(&record_path_init)) {
+		record_path = g_getenv("SIGROK_TRAFFIC_RECORD");
+		if (record_path && !*record_path)
+			record_path = NULL;
+		g_once_init_leave(&record_path_init, 1);
+	}
+
+	return record_path != NULL;
+}
+
+/* Open the recording, append to it if it exists. Caller holds the lock. */
+static gboolean record_open(void)
+{
+	if (record_file)
+		return TRUE;
+	if (record_failed)
+		return FALSE;
+
+	record_file = g_fopen(record_path, "ab");
+	if (!record_file || fseek(record_file, 0, SEEK_END) != 0) {
+		sr_err("Cannot open traffic recording '%s'.", record_path);
+		if (record_file)
+			fclose(record_file);
+		record_file = NULL;
+		record_failed = TRUE;
+		return FALSE;
+	}
+	if (ftell(record_file) == 0)
+		fwrite(TRAFFIC_MAGIC, 1, TRAFFIC_MAGIC_LEN, record_file);
+	sr_info("Recording received data to '%s'.", record_path);
+
+	return TRUE;
+}
+
+/**
+ * Record data which was received from a device.
+ *
+ * Does nothing unless the SIGROK_TRAFFIC_RECORD environment variable
+ * names a file. Safe to call from any thread.
+ *
+ * @param[in] kind The kind of data.
+ * @param[in] endpoint The USB endpoint address, 0 for serial data.
+ * @param[in] data The received data.
+ * @param[in] len The number of bytes received.
+ *
+ * @private
+ */
+SR_PRIV void sr_traffic_record(enum sr_traffic_kind kind, uint8_t endpoint,
+	const void *data, size_t len)
+{
+	uint8_t header[TRAFFIC_HEADER_LEN];
+
+	if (G_LIKELY(!record_enabled()) || !data || !len)
+		return;
+
+	header[0] = kind;
+	header[1] = endpoint;
+	header[2] = 0;
+	header[3] = 0;
+	WL32(&header[4], len);
+
+	g_mutex_lock(&record_mutex);
+	if (record_open()) {
+		if (fwrite(header, 1, sizeof(header), record_file) != sizeof(header)
+				|| fwrite(data, 1, len, record_file) != len) {
+			sr_err("Cannot write traffic recording.");
+			fclose(record_file);
+			record_file = NULL;
+			record_failed = TRUE;
+		}
+	}
+	g_mutex_unlock(&record_mutex);
+}
+
+/**
+ * Complete the recording, see sr_traffic_record(). Data which gets
+ * recorded later is appended to the file.
+ *
+ * @private
+ */
+SR_PRIV void sr_traffic_record_close(void)
+{
+	g_mutex_lock(&record_mutex);
+	if (record_file)
+		fclose(record_file);
+	record_file = NULL;
+	g_mutex_unlock(&record_mutex);
+}
+
+/**
+ * Load recorded data for replay.
+ *
+ * @param[in] filename The recording, see sr_traffic_record().
+ * @param[in] kind The kind of data to load.
+ * @param[out] data The payload of all records of that kind, in the
+ *                  order of reception. Free with g_bytes_unref().
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_IO The file cannot be read.
+ * @retval SR_ERR_DATA The file is not a recording, or is truncated.
+ *
+ * @private
+ */
+SR_PRIV int sr_traffic_load(const char *filename, enum sr_traffic_kind kind,
+	GBytes **data)
+{
+	GError *error;
+	GByteArray *out;
+	gchar *contents;
+	gsize size, pos;
+	uint32_t len;
+
+	*data = NULL;
+	error = NULL;
+	if (!g_file_get_contents(filename, &contents, &size, &error)) {
+		sr_err("Cannot read traffic recording: %s.", error->message);
+		g_error_free(error);
+		return SR_ERR_IO;
+	}
+	if (size < TRAFFIC_MAGIC_LEN
+			|| memcmp(contents, TRAFFIC_MAGIC, TRAFFIC_MAGIC_LEN)) {
+		sr_err("'%s' is not a traffic recording.", filename);
+		g_free(contents);
+		return SR_ERR_DATA;
+	}
+
+	out = g_byte_array_new();
+	for (pos = TRAFFIC_MAGIC_LEN; pos < size; pos += len) {
+		if (size - pos < TRAFFIC_HEADER_LEN)
+			break;
+		len = RL32(&contents[pos + 4]);
+		if (size - pos - TRAFFIC_HEADER_LEN < len)
+			break;
+		if ((uint8_t)contents[pos] == kind)
+			g_byte_array_append(out,
+				(const guint8 *)&contents[pos + TRAFFIC_HEADER_LEN],
+				len);
+		pos += TRAFFIC_HEADER_LEN;
+	}
+	g_free(contents);
+	if (pos != size) {
+		sr_err("Traffic recording '%s' is truncated.", filename);
+		g_byte_array_free(out, TRUE);
+		return SR_ERR_DATA;
+	}
+	sr_dbg("Loaded %u bytes of recorded traffic.", out->len);
+	*data = g_byte_array_free_to_bytes(out);
+
+	return SR_OK;
+}
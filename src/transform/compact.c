@@ -0,0 +1,343 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Drop the bits of disabled logic channels from logic data, so that a
+ * device which sends 16 channels with three of them enabled gets one
+ * byte per sample instead of two. The enabled channels keep their
+ * order, and get numbered from 0 on.
+ *
+ * The following transforms and the datafeed callbacks see a view of
+ * the device, which only has the enabled logic channels, with their
+ * new indices (and the other channels as they are). This transform
+ * should thus go last in the chain, or at least after the transforms
+ * which select logic channels by index.
+ *
+ * The bits get gathered with BMI2 PEXT where the CPU has it and the
+ * unitsize is 8 bytes at most, or else through one lookup table per
+ * input byte, whose entries get ORed together.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#if !defined(WORDS_BIGENDIAN) && defined(__GNUC__) && defined(__x86_64__)
+#define COMPACT_PEXT 1
+#include <immintrin.h>
+#endif
+
+#define LOG_PREFIX "transform/compact"
+
+/* The most logic channels which the output words hold. */
+#define MAX_CHANNELS 64
+
+struct context {
+	/* The device as the following transforms see it. */
+	struct sr_dev_inst view;
+	/* The logic channels of the view, which this transform owns. */
+	GSList *copies;
+	/* Input bit position of each output bit. */
+	int src_index[MAX_CHANNELS];
+	unsigned int num_channels;
+	uint16_t out_unitsize;
+	/* Whether the input layout already is the output layout. */
+	gboolean identity;
+	/* Whether the enabled channels come in the order of their indices. */
+	gboolean ascending;
+	/* Input unitsize which the gather state below was set up for. */
+	uint16_t unitsize;
+	/* The input bytes which hold enabled channels, and their tables. */
+	unsigned int num_bytes;
+	uint16_t bytes[MAX_CHANNELS];
+	uint64_t (*lut)[256];
+	uint64_t mask;
+	gboolean use_pext;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_packet packet;
+};
+
+static void view_free(struct context *ctx)
+{
+	struct sr_channel *ch;
+	GSList *l;
+
+	for (l = ctx->copies; l; l = l->next) {
+		ch = l->data;
+		g_free(ch->name);
+		g_free(ch);
+	}
+	g_slist_free(ctx->copies);
+	ctx->copies = NULL;
+	g_slist_free(ctx->view.channels);
+	ctx->view.channels = NULL;
+	sr_dev_channels_changed(&ctx->view);
+}
+
+/* (Re-)build the view of the device, from its current channels. */
+static void view_update(struct context *ctx, const struct sr_dev_inst *sdi)
+{
+	struct sr_channel *ch, *copy;
+	GSList *l;
+	unsigned int n;
+
+	view_free(ctx);
+	ctx->view.driver = sdi->driver;
+	ctx->view.status = sdi->status;
+	ctx->view.inst_type = sdi->inst_type;
+	ctx->view.vendor = sdi->vendor;
+	ctx->view.model = sdi->model;
+	ctx->view.version = sdi->version;
+	ctx->view.serial_num = sdi->serial_num;
+	ctx->view.connection_id = sdi->connection_id;
+	ctx->view.conn = sdi->conn;
+	ctx->view.priv = sdi->priv;
+	ctx->view.session = sdi->session;
+
+	n = 0;
+	ctx->identity = ctx->ascending = TRUE;
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_LOGIC) {
+			ctx->view.channels = g_slist_append(ctx->view.channels, ch);
+			continue;
+		}
+		if (!ch->enabled)
+			continue;
+		if (n == MAX_CHANNELS) {
+			sr_warn("More than %d enabled logic channels, "
+				"ignoring '%s'.", MAX_CHANNELS, ch->name);
+			continue;
+		}
+		copy = g_malloc0(sizeof(*copy));
+		copy->sdi = &ctx->view;
+		copy->index = n;
+		copy->type = ch->type;
+		copy->enabled = TRUE;
+		copy->name = g_strdup(ch->name);
+		ctx->copies = g_slist_append(ctx->copies, copy);
+		ctx->view.channels = g_slist_append(ctx->view.channels, copy);
+		ctx->src_index[n] = ch->index;
+		if (ch->index != (int)n)
+			ctx->identity = FALSE;
+		if (n && ch->index < ctx->src_index[n - 1])
+			ctx->ascending = FALSE;
+		n++;
+	}
+	ctx->num_channels = n;
+	ctx->out_unitsize = (n + 7) / 8;
+	ctx->unitsize = 0;
+}
+
+/* Set up the gather for logic data of the given unitsize. */
+static void gather_update(struct context *ctx, uint16_t unitsize)
+{
+	unsigned int i, j, byte, bit;
+	int v;
+
+	ctx->unitsize = unitsize;
+	ctx->num_bytes = 0;
+	ctx->mask = 0;
+	for (i = 0; i < ctx->num_channels; i++) {
+		byte = ctx->src_index[i] / 8;
+		if (byte >= unitsize)
+			continue;
+		for (j = 0; j < ctx->num_bytes; j++) {
+			if (ctx->bytes[j] == byte)
+				break;
+		}
+		if (j == ctx->num_bytes)
+			ctx->bytes[ctx->num_bytes++] = byte;
+		if (ctx->src_index[i] < 64)
+			ctx->mask |= UINT64_C(1) << ctx->src_index[i];
+	}
+
+	/* PEXT packs the bits in the order of their input positions. */
+#ifdef COMPACT_PEXT
+	ctx->use_pext = ctx->ascending && unitsize <= sizeof(uint64_t) &&
+		__builtin_cpu_supports("bmi2");
+#endif
+	if (ctx->use_pext)
+		return;
+
+	g_free(ctx->lut);
+	ctx->lut = g_malloc0_n(MAX(ctx->num_bytes, 1), sizeof(ctx->lut[0]));
+	for (i = 0; i < ctx->num_channels; i++) {
+		byte = ctx->src_index[i] / 8;
+		if (byte >= unitsize)
+			continue;
+		for (j = 0; ctx->bytes[j] != byte; j++)
+			;
+		bit = ctx->src_index[i] % 8;
+		for (v = 0; v < 256; v++) {
+			if (v & (1 << bit))
+				ctx->lut[j][v] |= UINT64_C(1) << i;
+		}
+	}
+}
+
+/*
+ * Gather the samples in place. Each output sample is no longer than its
+ * input sample, so it never overwrites input which is yet to be read.
+ */
+static void gather_lut(const struct context *ctx, uint8_t *data,
+		size_t samples)
+{
+	const uint8_t *in;
+	uint8_t *out;
+	uint64_t word;
+	size_t i;
+	unsigned int k;
+
+	in = out = data;
+	for (i = 0; i < samples; i++) {
+		word = 0;
+		for (k = 0; k < ctx->num_bytes; k++)
+			word |= ctx->lut[k][in[ctx->bytes[k]]];
+		for (k = 0; k < ctx->out_unitsize; k++)
+			out[k] = word >> (8 * k);
+		in += ctx->unitsize;
+		out += ctx->out_unitsize;
+	}
+}
+
+#ifdef COMPACT_PEXT
+__attribute__((target("bmi2")))
+static void gather_pext(const struct context *ctx, uint8_t *data,
+		size_t samples)
+{
+	const uint8_t *in;
+	uint8_t *out;
+	uint64_t word;
+	size_t i;
+
+	in = out = data;
+	for (i = 0; i < samples; i++) {
+		word = 0;
+		memcpy(&word, in, ctx->unitsize);
+		word = _pext_u64(word, ctx->mask);
+		memcpy(out, &word, ctx->out_unitsize);
+		in += ctx->unitsize;
+		out += ctx->out_unitsize;
+	}
+}
+#endif
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+
+	(void)options;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+	view_update(ctx, t->sdi);
+	t->sdi_out = &ctx->view;
+
+	return SR_OK;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_logic *logic;
+	uint8_t *data;
+	size_t samples;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	*packet_out = packet_in;
+
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+		/* Channels may have been enabled or disabled since. */
+		view_update(ctx, t->sdi);
+		break;
+	case SR_DF_LOGIC:
+		logic = packet_in->payload;
+		if (!logic->unitsize)
+			break;
+		if (!ctx->num_channels) {
+			/* Nothing left of the samples. */
+			*packet_out = NULL;
+			break;
+		}
+		if (ctx->identity && logic->unitsize == ctx->out_unitsize)
+			break;
+		if (logic->unitsize != ctx->unitsize)
+			gather_update(ctx, logic->unitsize);
+		samples = logic->length / logic->unitsize;
+		if (!(data = sr_transform_data_writable(t, logic->data,
+				samples * logic->unitsize)))
+			return SR_ERR_MALLOC;
+#ifdef COMPACT_PEXT
+		if (ctx->use_pext)
+			gather_pext(ctx, data, samples);
+		else
+#endif
+			gather_lut(ctx, data, samples);
+		ctx->logic = *logic;
+		ctx->logic.length = samples * ctx->out_unitsize;
+		ctx->logic.unitsize = ctx->out_unitsize;
+		ctx->logic.data = data;
+		ctx->packet.type = SR_DF_LOGIC;
+		ctx->packet.payload = &ctx->logic;
+		*packet_out = &ctx->packet;
+		break;
+	default:
+		sr_spew("Unsupported packet type %d, ignoring.", packet_in->type);
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	t->sdi_out = NULL;
+	view_free(ctx);
+	g_free(ctx->lut);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+SR_PRIV struct sr_transform_module transform_compact = {
+	.id = "compact",
+	.name = "Compact",
+	.desc = "Drop the bits of disabled logic channels",
+	.options = NULL,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
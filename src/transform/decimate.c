@@ -0,0 +1,518 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Reduce the samplerate by an integer factor. Each bucket of 'factor'
+ * consecutive samples becomes one output sample. Logic data keeps the
+ * first sample of each bucket, or ORs / ANDs all of them so that short
+ * pulses survive. Analog data takes the mean, minimum or maximum of
+ * each bucket, and is passed on as 32-bit floats. Buckets continue
+ * across packets, the partial bucket at the end of the stream is
+ * dropped. The samplerate in meta packets is divided accordingly.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/decimate"
+
+enum {
+	LOGIC_NTH,
+	LOGIC_OR,
+	LOGIC_AND,
+};
+
+enum {
+	ANALOG_MEAN,
+	ANALOG_MIN,
+	ANALOG_MAX,
+};
+
+/* Bucket state of the analog packets of one set of channels. */
+struct analog_state {
+	unsigned int num_channels;
+	uint64_t count;
+	/* Running sum, minimum or maximum per channel. */
+	float *acc;
+	float *values;
+	size_t values_size;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+};
+
+struct context {
+	uint64_t factor;
+	int logic_mode;
+	int analog_mode;
+
+	/* Logic bucket state. */
+	uint64_t logic_count;
+	uint8_t *logic_acc;
+	uint16_t unitsize;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_packet packet;
+
+	/* Analog states, keyed by the packet's first channel. */
+	GHashTable *analog;
+};
+
+static const char *logic_modes[] = { "nth", "or", "and", };
+static const char *analog_modes[] = { "mean", "min", "max", };
+
+static int mode_lookup(const char *const *modes, size_t count, const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		if (!strcmp(modes[i], name))
+			return i;
+	}
+
+	return -1;
+}
+
+static void analog_state_free(void *data)
+{
+	struct analog_state *state;
+
+	state = data;
+	g_free(state->acc);
+	g_free(state->values);
+	g_free(state);
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	const char *name;
+	int logic_mode, analog_mode;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	name = g_variant_get_string(g_hash_table_lookup(options, "logic"), NULL);
+	logic_mode = mode_lookup(logic_modes, ARRAY_SIZE(logic_modes), name);
+	if (logic_mode < 0) {
+		sr_err("Invalid logic mode '%s'.", name);
+		return SR_ERR_ARG;
+	}
+	name = g_variant_get_string(g_hash_table_lookup(options, "analog"), NULL);
+	analog_mode = mode_lookup(analog_modes, ARRAY_SIZE(analog_modes), name);
+	if (analog_mode < 0) {
+		sr_err("Invalid analog mode '%s'.", name);
+		return SR_ERR_ARG;
+	}
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+	ctx->factor = g_variant_get_uint64(g_hash_table_lookup(options, "factor"));
+	if (!ctx->factor)
+		ctx->factor = 1;
+	ctx->logic_mode = logic_mode;
+	ctx->analog_mode = analog_mode;
+	ctx->analog = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+		NULL, analog_state_free);
+
+	return SR_OK;
+}
+
+static void reset(struct context *ctx)
+{
+	ctx->logic_count = 0;
+	g_hash_table_remove_all(ctx->analog);
+}
+
+/* Divide the samplerate of a meta packet, in place. */
+static void meta_update(struct context *ctx, const struct sr_datafeed_meta *meta)
+{
+	struct sr_config *src;
+	uint64_t samplerate;
+	GSList *l;
+
+	for (l = meta->config; l; l = l->next) {
+		src = l->data;
+		if (src->key != SR_CONF_SAMPLERATE)
+			continue;
+		samplerate = g_variant_get_uint64(src->data);
+		g_variant_unref(src->data);
+		src->data = g_variant_ref_sink(
+			g_variant_new_uint64(samplerate / ctx->factor));
+	}
+}
+
+static inline uint64_t sample_load(const uint8_t *p, uint16_t unitsize)
+{
+	uint64_t v;
+
+	v = 0;
+	memcpy(&v, p, unitsize);
+
+	return v;
+}
+
+/* Reduce logic data in place, the output never runs ahead of the input. */
+static size_t logic_reduce(struct context *ctx, uint8_t *data, size_t samples)
+{
+	uint8_t *out, *acc;
+	uint16_t unitsize;
+	uint64_t v, word, skip;
+	size_t i, j, produced;
+
+	unitsize = ctx->unitsize;
+	acc = ctx->logic_acc;
+	out = data;
+	produced = 0;
+	i = 0;
+
+	if (ctx->logic_mode == LOGIC_NTH) {
+		while (i < samples) {
+			if (!ctx->logic_count) {
+				memmove(out, data + i * unitsize, unitsize);
+				out += unitsize;
+				produced++;
+			}
+			/* Skip the rest of the bucket in one step. */
+			skip = MIN(ctx->factor - ctx->logic_count, samples - i);
+			i += skip;
+			ctx->logic_count = (ctx->logic_count + skip) % ctx->factor;
+		}
+		return produced;
+	}
+
+	for (; i < samples; i++) {
+		if (!ctx->logic_count)
+			memcpy(acc, data + i * unitsize, unitsize);
+		else if (unitsize <= sizeof(uint64_t)) {
+			v = sample_load(data + i * unitsize, unitsize);
+			word = sample_load(acc, unitsize);
+			word = (ctx->logic_mode == LOGIC_OR) ? word | v : word & v;
+			memcpy(acc, &word, unitsize);
+		} else {
+			for (j = 0; j < unitsize; j++) {
+				if (ctx->logic_mode == LOGIC_OR)
+					acc[j] |= data[i * unitsize + j];
+				else
+					acc[j] &= data[i * unitsize + j];
+			}
+		}
+		if (++ctx->logic_count == ctx->factor) {
+			memcpy(out, acc, unitsize);
+			out += unitsize;
+			produced++;
+			ctx->logic_count = 0;
+		}
+	}
+
+	return produced;
+}
+
+static int receive_logic(const struct sr_transform *t, struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_logic *logic;
+	uint8_t *data;
+	size_t produced;
+
+	logic = packet_in->payload;
+	if (!logic->unitsize)
+		return SR_OK;
+	if (logic->unitsize != ctx->unitsize) {
+		g_free(ctx->logic_acc);
+		ctx->logic_acc = g_malloc(logic->unitsize);
+		ctx->unitsize = logic->unitsize;
+		ctx->logic_count = 0;
+	}
+
+	/* The reduction overwrites the input with its results. */
+	data = sr_transform_data_writable(t, logic->data,
+		logic->length - logic->length % logic->unitsize);
+	if (!data)
+		return SR_ERR_MALLOC;
+	produced = logic_reduce(ctx, data, logic->length / logic->unitsize);
+	if (!produced) {
+		*packet_out = NULL;
+		return SR_OK;
+	}
+
+	ctx->logic.length = produced * logic->unitsize;
+	ctx->logic.unitsize = logic->unitsize;
+	ctx->logic.data = data;
+	ctx->packet.type = SR_DF_LOGIC;
+	ctx->packet.payload = &ctx->logic;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+/*
+ * Sum, minimum and maximum of a block of values with a stride. Four
+ * independent lanes keep the loop free of a serial dependency, which
+ * lets the compiler vectorize it for the stride of 1.
+ */
+static float block_reduce(int mode, const float *v, size_t n, size_t stride)
+{
+	float lane[4], r;
+	size_t i;
+
+	if (n < 4) {
+		r = v[0];
+		for (i = 1; i < n; i++) {
+			if (mode == ANALOG_MEAN)
+				r += v[i * stride];
+			else if (mode == ANALOG_MIN)
+				r = MIN(r, v[i * stride]);
+			else
+				r = MAX(r, v[i * stride]);
+		}
+		return r;
+	}
+
+	for (i = 0; i < 4; i++)
+		lane[i] = v[i * stride];
+	for (i = 4; i + 4 <= n; i += 4) {
+		if (mode == ANALOG_MEAN) {
+			lane[0] += v[(i + 0) * stride];
+			lane[1] += v[(i + 1) * stride];
+			lane[2] += v[(i + 2) * stride];
+			lane[3] += v[(i + 3) * stride];
+		} else if (mode == ANALOG_MIN) {
+			lane[0] = MIN(lane[0], v[(i + 0) * stride]);
+			lane[1] = MIN(lane[1], v[(i + 1) * stride]);
+			lane[2] = MIN(lane[2], v[(i + 2) * stride]);
+			lane[3] = MIN(lane[3], v[(i + 3) * stride]);
+		} else {
+			lane[0] = MAX(lane[0], v[(i + 0) * stride]);
+			lane[1] = MAX(lane[1], v[(i + 1) * stride]);
+			lane[2] = MAX(lane[2], v[(i + 2) * stride]);
+			lane[3] = MAX(lane[3], v[(i + 3) * stride]);
+		}
+	}
+	for (; i < n; i++) {
+		if (mode == ANALOG_MEAN)
+			lane[0] += v[i * stride];
+		else if (mode == ANALOG_MIN)
+			lane[0] = MIN(lane[0], v[i * stride]);
+		else
+			lane[0] = MAX(lane[0], v[i * stride]);
+	}
+
+	if (mode == ANALOG_MEAN)
+		return (lane[0] + lane[1]) + (lane[2] + lane[3]);
+	if (mode == ANALOG_MIN)
+		return MIN(MIN(lane[0], lane[1]), MIN(lane[2], lane[3]));
+	return MAX(MAX(lane[0], lane[1]), MAX(lane[2], lane[3]));
+}
+
+static float acc_merge(int mode, float acc, float v)
+{
+	if (mode == ANALOG_MEAN)
+		return acc + v;
+	if (mode == ANALOG_MIN)
+		return MIN(acc, v);
+	return MAX(acc, v);
+}
+
+static struct analog_state *analog_state_get(struct context *ctx,
+		const struct sr_datafeed_analog *analog)
+{
+	struct analog_state *state;
+	unsigned int num_channels;
+	void *key;
+
+	key = analog->meaning->channels->data;
+	num_channels = g_slist_length(analog->meaning->channels);
+	state = g_hash_table_lookup(ctx->analog, key);
+	if (state && state->num_channels == num_channels)
+		return state;
+
+	state = g_malloc0(sizeof(*state));
+	state->num_channels = num_channels;
+	state->acc = g_malloc0_n(num_channels, sizeof(float));
+	state->encoding.unitsize = sizeof(float);
+	state->encoding.is_signed = TRUE;
+	state->encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	state->encoding.is_bigendian = TRUE;
+#endif
+	sr_rational_set(&state->encoding.scale, 1, 1);
+	sr_rational_set(&state->encoding.offset, 0, 1);
+	g_hash_table_replace(ctx->analog, key, state);
+
+	return state;
+}
+
+static int receive_analog(const struct sr_transform *t, struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_analog *analog;
+	struct analog_state *state;
+	const float *v;
+	float r, *out;
+	size_t samples, i, len, produced;
+	unsigned int ch, nch;
+	int ret;
+
+	analog = packet_in->payload;
+	if (!analog->meaning || !analog->meaning->channels || !analog->num_samples)
+		return SR_OK;
+
+	state = analog_state_get(ctx, analog);
+	nch = state->num_channels;
+	samples = analog->num_samples;
+	if (state->values_size < samples * nch) {
+		state->values = g_realloc_n(state->values, samples * nch, sizeof(float));
+		state->values_size = samples * nch;
+	}
+	if ((ret = sr_analog_to_float(analog, state->values)) != SR_OK)
+		return ret;
+
+	out = sr_transform_buffer_get(t,
+		(samples / ctx->factor + 1) * nch * sizeof(float));
+	if (!out)
+		return SR_ERR_MALLOC;
+
+	produced = 0;
+	for (i = 0; i < samples; i += len) {
+		len = MIN(ctx->factor - state->count, samples - i);
+		for (ch = 0; ch < nch; ch++) {
+			v = state->values + i * nch + ch;
+			r = block_reduce(ctx->analog_mode, v, len, nch);
+			if (state->count)
+				r = acc_merge(ctx->analog_mode, state->acc[ch], r);
+			state->acc[ch] = r;
+		}
+		state->count += len;
+		if (state->count < ctx->factor)
+			break;
+		for (ch = 0; ch < nch; ch++) {
+			r = state->acc[ch];
+			if (ctx->analog_mode == ANALOG_MEAN)
+				r /= ctx->factor;
+			out[produced * nch + ch] = r;
+		}
+		produced++;
+		state->count = 0;
+	}
+
+	if (!produced) {
+		*packet_out = NULL;
+		return SR_OK;
+	}
+
+	state->encoding.digits = analog->encoding->digits;
+	state->encoding.is_digits_decimal = analog->encoding->is_digits_decimal;
+	state->analog.data = out;
+	state->analog.num_samples = produced;
+	state->analog.encoding = &state->encoding;
+	state->analog.meaning = analog->meaning;
+	state->analog.spec = analog->spec;
+	ctx->packet.type = SR_DF_ANALOG;
+	ctx->packet.payload = &state->analog;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	/* By default pass the packet on unmodified. */
+	*packet_out = packet_in;
+	if (ctx->factor == 1)
+		return SR_OK;
+
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+		reset(ctx);
+		break;
+	case SR_DF_META:
+		meta_update(ctx, packet_in->payload);
+		break;
+	case SR_DF_LOGIC:
+		return receive_logic(t, ctx, packet_in, packet_out);
+	case SR_DF_ANALOG:
+		return receive_analog(t, ctx, packet_in, packet_out);
+	default:
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	g_hash_table_destroy(ctx->analog);
+	g_free(ctx->logic_acc);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "factor", "Factor", "Number of input samples per output sample", NULL, NULL },
+	{ "logic", "Logic mode", "Reduction of logic samples (nth, or, and)", NULL, NULL },
+	{ "analog", "Analog mode", "Reduction of analog samples (mean, min, max)", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	unsigned int i;
+
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_uint64(1));
+		options[1].def = g_variant_ref_sink(g_variant_new_string(logic_modes[0]));
+		for (i = 0; i < ARRAY_SIZE(logic_modes); i++)
+			options[1].values = g_slist_append(options[1].values,
+				g_variant_ref_sink(g_variant_new_string(logic_modes[i])));
+		options[2].def = g_variant_ref_sink(g_variant_new_string(analog_modes[0]));
+		for (i = 0; i < ARRAY_SIZE(analog_modes); i++)
+			options[2].values = g_slist_append(options[2].values,
+				g_variant_ref_sink(g_variant_new_string(analog_modes[i])));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_decimate = {
+	.id = "decimate",
+	.name = "Decimate",
+	.desc = "Reduce the samplerate by an integer factor",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
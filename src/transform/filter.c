@@ -0,0 +1,408 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Digital filters for analog data: a moving average, an FIR filter, or
+ * a cascade of biquad sections. The filter state of each channel is kept
+ * across packets, so the output is the same regardless of how the input
+ * got split into packets. Filtered values are passed on as 32-bit floats.
+ *
+ * The "coefficients" option lists the FIR taps b0,b1,...,bN, or five
+ * values b0,b1,b2,a1,a2 per biquad section (with a0 normalized to 1).
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/filter"
+
+enum {
+	FILTER_MOVING_AVERAGE,
+	FILTER_FIR,
+	FILTER_BIQUAD,
+};
+
+/* Filter state of the analog packets of one set of channels. */
+struct filter_state {
+	unsigned int num_channels;
+	/* The last (taps - 1) input values per channel, oldest first. */
+	float *history;
+	/* Running sum of the moving average, per channel. */
+	double *sum;
+	/* Two delay elements per biquad section and channel. */
+	double *z;
+	float *values;
+	float *work;
+	size_t size;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+};
+
+struct context {
+	int type;
+	/* FIR taps, reversed for the dot product, or biquad coefficients. */
+	float *coeffs;
+	size_t num_coeffs;
+	size_t taps;
+	size_t sections;
+	struct sr_datafeed_packet packet;
+	/* Filter states, keyed by the packet's first channel. */
+	GHashTable *states;
+};
+
+static const char *filter_types[] = { "moving-average", "fir", "biquad", };
+
+static void filter_state_free(void *data)
+{
+	struct filter_state *state;
+
+	state = data;
+	g_free(state->history);
+	g_free(state->sum);
+	g_free(state->z);
+	g_free(state->values);
+	g_free(state->work);
+	g_free(state);
+}
+
+static int coeffs_parse(struct context *ctx, const char *spec)
+{
+	char **items, *end;
+	size_t i, count;
+
+	items = g_strsplit(spec, ",", 0);
+	count = g_strv_length(items);
+	ctx->coeffs = g_malloc0_n(count + 1, sizeof(float));
+	for (i = 0; i < count; i++) {
+		ctx->coeffs[i] = g_ascii_strtod(items[i], &end);
+		while (g_ascii_isspace(*end))
+			end++;
+		if (end == items[i] || *end) {
+			sr_err("Invalid coefficient '%s'.", items[i]);
+			g_strfreev(items);
+			return SR_ERR_ARG;
+		}
+	}
+	g_strfreev(items);
+	ctx->num_coeffs = count;
+
+	return SR_OK;
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	const char *name, *spec;
+	float tmp;
+	size_t i;
+	int type;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	name = g_variant_get_string(g_hash_table_lookup(options, "type"), NULL);
+	for (type = 0; type < (int)ARRAY_SIZE(filter_types); type++) {
+		if (!strcmp(filter_types[type], name))
+			break;
+	}
+	if (type == ARRAY_SIZE(filter_types)) {
+		sr_err("Invalid filter type '%s'.", name);
+		return SR_ERR_ARG;
+	}
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+	ctx->type = type;
+	ctx->states = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+		NULL, filter_state_free);
+
+	spec = g_variant_get_string(g_hash_table_lookup(options, "coefficients"), NULL);
+	switch (type) {
+	case FILTER_MOVING_AVERAGE:
+		ctx->taps = g_variant_get_uint32(g_hash_table_lookup(options, "taps"));
+		if (ctx->taps)
+			break;
+		sr_err("The moving average needs at least one tap.");
+		goto err;
+	case FILTER_FIR:
+		if (coeffs_parse(ctx, spec) != SR_OK)
+			goto err;
+		ctx->taps = ctx->num_coeffs;
+		if (!ctx->taps) {
+			sr_err("The FIR filter needs coefficients.");
+			goto err;
+		}
+		/* Reverse the taps, the oldest value meets the last one. */
+		for (i = 0; i < ctx->taps / 2; i++) {
+			tmp = ctx->coeffs[i];
+			ctx->coeffs[i] = ctx->coeffs[ctx->taps - 1 - i];
+			ctx->coeffs[ctx->taps - 1 - i] = tmp;
+		}
+		break;
+	case FILTER_BIQUAD:
+		if (coeffs_parse(ctx, spec) != SR_OK)
+			goto err;
+		if (!ctx->num_coeffs || ctx->num_coeffs % 5) {
+			sr_err("Biquad sections need five coefficients each.");
+			goto err;
+		}
+		ctx->sections = ctx->num_coeffs / 5;
+		ctx->taps = 1;
+		break;
+	}
+
+	return SR_OK;
+
+err:
+	g_hash_table_destroy(ctx->states);
+	g_free(ctx->coeffs);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_ERR_ARG;
+}
+
+static struct filter_state *filter_state_get(struct context *ctx,
+		const struct sr_datafeed_analog *analog)
+{
+	struct filter_state *state;
+	unsigned int num_channels;
+	void *key;
+
+	key = analog->meaning->channels->data;
+	num_channels = g_slist_length(analog->meaning->channels);
+	state = g_hash_table_lookup(ctx->states, key);
+	if (state && state->num_channels == num_channels)
+		return state;
+
+	state = g_malloc0(sizeof(*state));
+	state->num_channels = num_channels;
+	state->history = g_malloc0_n(num_channels * ctx->taps, sizeof(float));
+	state->sum = g_malloc0_n(num_channels, sizeof(double));
+	state->z = g_malloc0_n(num_channels * 2 * ctx->sections, sizeof(double));
+	state->encoding.unitsize = sizeof(float);
+	state->encoding.is_signed = TRUE;
+	state->encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	state->encoding.is_bigendian = TRUE;
+#endif
+	sr_rational_set(&state->encoding.scale, 1, 1);
+	sr_rational_set(&state->encoding.offset, 0, 1);
+	g_hash_table_replace(ctx->states, key, state);
+
+	return state;
+}
+
+/*
+ * Dot product of the taps with a window of the input. Four independent
+ * lanes let the compiler turn it into SIMD multiply-adds.
+ */
+static inline float dot(const float *a, const float *b, size_t n)
+{
+	float lane[4] = { 0, 0, 0, 0 };
+	size_t i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		lane[0] += a[i + 0] * b[i + 0];
+		lane[1] += a[i + 1] * b[i + 1];
+		lane[2] += a[i + 2] * b[i + 2];
+		lane[3] += a[i + 3] * b[i + 3];
+	}
+	for (; i < n; i++)
+		lane[0] += a[i] * b[i];
+
+	return (lane[0] + lane[1]) + (lane[2] + lane[3]);
+}
+
+/*
+ * Filter one channel. The work buffer holds the channel's history of
+ * (taps - 1) values, followed by the new samples.
+ */
+static void filter_channel(const struct context *ctx, double *sum, double *z,
+		const float *work, size_t samples, float *out, size_t stride)
+{
+	const float *c, *x;
+	double v, y;
+	size_t taps, i, s;
+
+	taps = ctx->taps;
+	x = work + taps - 1;
+
+	switch (ctx->type) {
+	case FILTER_MOVING_AVERAGE:
+		/* The window starts out zero filled, like the FIR history. */
+		for (i = 0; i < samples; i++) {
+			*sum += x[i];
+			out[i * stride] = *sum / taps;
+			*sum -= work[i];
+		}
+		break;
+	case FILTER_FIR:
+		for (i = 0; i < samples; i++)
+			out[i * stride] = dot(ctx->coeffs, work + i, taps);
+		break;
+	case FILTER_BIQUAD:
+		/* Transposed direct form II, one section after the other. */
+		for (i = 0; i < samples; i++) {
+			v = x[i];
+			for (s = 0; s < ctx->sections; s++) {
+				c = ctx->coeffs + 5 * s;
+				y = c[0] * v + z[2 * s];
+				z[2 * s] = c[1] * v - c[3] * y + z[2 * s + 1];
+				z[2 * s + 1] = c[2] * v - c[4] * y;
+				v = y;
+			}
+			out[i * stride] = v;
+		}
+		break;
+	}
+}
+
+static int receive_analog(const struct sr_transform *t, struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_analog *analog;
+	struct filter_state *state;
+	float *hist, *out;
+	size_t samples, hlen, i;
+	unsigned int ch, nch;
+	int ret;
+
+	analog = packet_in->payload;
+	if (!analog->meaning || !analog->meaning->channels || !analog->num_samples)
+		return SR_OK;
+
+	state = filter_state_get(ctx, analog);
+	nch = state->num_channels;
+	samples = analog->num_samples;
+	hlen = ctx->taps - 1;
+	if (state->size < samples) {
+		state->values = g_realloc_n(state->values, samples * nch, sizeof(float));
+		state->work = g_realloc_n(state->work, hlen + samples, sizeof(float));
+		state->size = samples;
+	}
+	if ((ret = sr_analog_to_float(analog, state->values)) != SR_OK)
+		return ret;
+	out = sr_transform_buffer_get(t, samples * nch * sizeof(float));
+	if (!out)
+		return SR_ERR_MALLOC;
+
+	for (ch = 0; ch < nch; ch++) {
+		/* Gather the channel behind its history. */
+		hist = state->history + ch * ctx->taps;
+		memcpy(state->work, hist, hlen * sizeof(float));
+		for (i = 0; i < samples; i++)
+			state->work[hlen + i] = state->values[i * nch + ch];
+		filter_channel(ctx, &state->sum[ch],
+			state->z + ch * 2 * ctx->sections,
+			state->work, samples, out + ch, nch);
+		memcpy(hist, state->work + samples, hlen * sizeof(float));
+	}
+
+	state->encoding.digits = analog->encoding->digits;
+	state->encoding.is_digits_decimal = analog->encoding->is_digits_decimal;
+	state->analog.data = out;
+	state->analog.num_samples = samples;
+	state->analog.encoding = &state->encoding;
+	state->analog.meaning = analog->meaning;
+	state->analog.spec = analog->spec;
+	ctx->packet.type = SR_DF_ANALOG;
+	ctx->packet.payload = &state->analog;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	/* By default pass the packet on unmodified. */
+	*packet_out = packet_in;
+
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+		g_hash_table_remove_all(ctx->states);
+		break;
+	case SR_DF_ANALOG:
+		return receive_analog(t, ctx, packet_in, packet_out);
+	default:
+		sr_spew("Unsupported packet type %d, ignoring.", packet_in->type);
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	g_hash_table_destroy(ctx->states);
+	g_free(ctx->coeffs);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "type", "Type", "Filter type (moving-average, fir, biquad)", NULL, NULL },
+	{ "taps", "Taps", "Window length of the moving average", NULL, NULL },
+	{ "coefficients", "Coefficients", "Comma separated FIR taps, or b0,b1,b2,a1,a2 per biquad section", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	unsigned int i;
+
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_string(filter_types[0]));
+		for (i = 0; i < ARRAY_SIZE(filter_types); i++)
+			options[0].values = g_slist_append(options[0].values,
+				g_variant_ref_sink(g_variant_new_string(filter_types[i])));
+		options[1].def = g_variant_ref_sink(g_variant_new_uint32(8));
+		options[2].def = g_variant_ref_sink(g_variant_new_string(""));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_filter = {
+	.id = "filter",
+	.name = "Filter",
+	.desc = "Filter analog values (moving average, FIR, biquad)",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -24,32 +24,172 @@
 
 #define LOG_PREFIX "transform/invert"
 
+struct context {
+	/* Selected channels, NULL when all channels are inverted. */
+	GSList *channels;
+	/*
+	 * The XOR pattern for logic data, repeating every pattern_len
+	 * bytes, which is a multiple of both the unitsize and of 8.
+	 */
+	uint8_t *pattern;
+	size_t pattern_len;
+	uint16_t unitsize;
+	/* Output for logic data which other packets share. */
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_packet packet;
+};
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	struct sr_channel *ch;
+	const char *spec;
+	char **names;
+	GSList *l;
+	int i;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+
+	spec = g_variant_get_string(g_hash_table_lookup(options, "channels"), NULL);
+	if (!spec || !*spec)
+		return SR_OK;
+
+	names = g_strsplit(spec, ",", 0);
+	for (i = 0; names[i]; i++) {
+		g_strstrip(names[i]);
+		ch = NULL;
+		for (l = t->sdi->channels; l; l = l->next) {
+			if (!strcmp(((struct sr_channel *)l->data)->name, names[i])) {
+				ch = l->data;
+				break;
+			}
+		}
+		if (!ch) {
+			sr_err("Unknown channel '%s'.", names[i]);
+			g_strfreev(names);
+			g_slist_free(ctx->channels);
+			g_free(ctx);
+			t->priv = NULL;
+			return SR_ERR_ARG;
+		}
+		ctx->channels = g_slist_append(ctx->channels, ch);
+	}
+	g_strfreev(names);
+
+	return SR_OK;
+}
+
+/* Build the XOR pattern for logic data of the given unitsize. */
+static void pattern_update(struct context *ctx, uint16_t unitsize)
+{
+	struct sr_channel *ch;
+	GSList *l;
+	size_t len, i;
+
+	len = unitsize;
+	while (len % sizeof(uint64_t))
+		len += unitsize;
+
+	g_free(ctx->pattern);
+	ctx->pattern = g_malloc0(len);
+	ctx->pattern_len = len;
+	ctx->unitsize = unitsize;
+
+	if (!ctx->channels) {
+		memset(ctx->pattern, 0xff, len);
+		return;
+	}
+	for (l = ctx->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_LOGIC || ch->index >= 8 * unitsize)
+			continue;
+		for (i = ch->index / 8; i < len; i += unitsize)
+			ctx->pattern[i] |= 1 << (ch->index % 8);
+	}
+}
+
+/* XOR the data against the pattern, a 64-bit word at a time. */
+static void invert_logic(struct context *ctx, uint8_t *data, size_t length)
+{
+	const uint8_t *pattern;
+	uint64_t word, mask;
+	size_t pos, offset;
+
+	pattern = ctx->pattern;
+	offset = 0;
+	for (pos = 0; pos + sizeof(word) <= length; pos += sizeof(word)) {
+		memcpy(&word, data + pos, sizeof(word));
+		memcpy(&mask, pattern + offset, sizeof(mask));
+		word ^= mask;
+		memcpy(data + pos, &word, sizeof(word));
+		offset += sizeof(word);
+		if (offset == ctx->pattern_len)
+			offset = 0;
+	}
+	for (; pos < length; pos++)
+		data[pos] ^= pattern[offset++];
+}
+
+/* Whether an analog packet carries any of the selected channels. */
+static gboolean analog_selected(const struct context *ctx,
+		const struct sr_datafeed_analog *analog)
+{
+	GSList *l;
+
+	if (!ctx->channels)
+		return TRUE;
+	for (l = analog->meaning->channels; l; l = l->next) {
+		if (g_slist_find(ctx->channels, l->data))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
 static int receive(const struct sr_transform *t,
 		struct sr_datafeed_packet *packet_in,
 		struct sr_datafeed_packet **packet_out)
 {
+	struct context *ctx;
 	const struct sr_datafeed_logic *logic;
 	const struct sr_datafeed_analog *analog;
-	uint8_t *b;
+	uint8_t *data;
+	size_t length;
 	int64_t p;
-	uint64_t i, j, q;
+	uint64_t q;
 
 	if (!t || !t->sdi || !packet_in || !packet_out)
 		return SR_ERR_ARG;
+	ctx = t->priv;
 
 	switch (packet_in->type) {
 	case SR_DF_LOGIC:
 		logic = packet_in->payload;
-		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
-			for (j = 0; j < logic->unitsize; j++) {
-				/* For now invert every bit in every byte. */
-				b = (uint8_t *)logic->data + i + logic->unitsize - 1 - j;
-				*b = ~(*b);
-			}
+		if (!logic->unitsize)
+			break;
+		if (logic->unitsize != ctx->unitsize)
+			pattern_update(ctx, logic->unitsize);
+		length = logic->length - logic->length % logic->unitsize;
+		if (!(data = sr_transform_data_writable(t, logic->data, length)))
+			return SR_ERR_MALLOC;
+		invert_logic(ctx, data, length);
+		if (data != logic->data) {
+			ctx->logic = *logic;
+			ctx->logic.length = length;
+			ctx->logic.data = data;
+			ctx->packet.type = SR_DF_LOGIC;
+			ctx->packet.payload = &ctx->logic;
+			*packet_out = &ctx->packet;
+			return SR_OK;
 		}
 		break;
 	case SR_DF_ANALOG:
 		analog = packet_in->payload;
+		if (!analog_selected(ctx, analog))
+			break;
 		p = analog->encoding->scale.p;
 		q = analog->encoding->scale.q;
 		if (q > INT64_MAX)
@@ -68,12 +208,42 @@ static int receive(const struct sr_transform *t,
 	return SR_OK;
 }
 
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	g_slist_free(ctx->channels);
+	g_free(ctx->pattern);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "channels", "Channels", "Comma separated names of the channels to invert (default: all)", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	/* Default to inverting all channels. */
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_string(""));
+
+	return options;
+}
+
 SR_PRIV struct sr_transform_module transform_invert = {
 	.id = "invert",
 	.name = "Invert",
 	.desc = "Invert values",
-	.options = NULL,
-	.init = NULL,
+	.options = get_options,
+	.init = init,
 	.receive = receive,
-	.cleanup = NULL,
+	.cleanup = cleanup,
 };
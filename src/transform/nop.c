@@ -24,13 +24,45 @@
 
 #define LOG_PREFIX "transform/nop"
 
+/*
+ * Packets pass unmodified, but get measured like in the null output.
+ * The summary is logged at the end of the feed.
+ */
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	(void)options;
+
+	t->priv = g_malloc0(sizeof(struct sr_packet_meter));
+
+	return SR_OK;
+}
+
 static int receive(const struct sr_transform *t,
 		struct sr_datafeed_packet *packet_in,
 		struct sr_datafeed_packet **packet_out)
 {
-	if (!t || !t->sdi || !packet_in || !packet_out)
+	struct sr_packet_meter *meter;
+	GString *summary;
+	gchar **lines, **line;
+
+	if (!t || !t->sdi || !packet_in || !packet_out || !(meter = t->priv))
 		return SR_ERR_ARG;
 
+	if (packet_in->type == SR_DF_HEADER)
+		sr_packet_meter_reset(meter);
+	sr_packet_meter_add(meter, packet_in);
+	if (packet_in->type == SR_DF_END) {
+		summary = sr_packet_meter_summary(meter);
+		lines = g_strsplit(summary->str, "\n", 0);
+		for (line = lines; *line; line++) {
+			if (**line)
+				sr_info("%s", *line);
+		}
+		g_strfreev(lines);
+		g_string_free(summary, TRUE);
+	}
+
 	/* Do nothing, just pass on packets unmodified. */
 	sr_spew("Received packet of type %d, passing on unmodified.", packet_in->type);
 	*packet_out = packet_in;
@@ -38,12 +70,20 @@ static int receive(const struct sr_transform *t,
 	return SR_OK;
 }
 
+static int cleanup(struct sr_transform *t)
+{
+	g_free(t->priv);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
 SR_PRIV struct sr_transform_module transform_nop = {
 	.id = "nop",
 	.name = "NOP",
-	.desc = "Do nothing",
+	.desc = "Pass on data unmodified, log statistics",
 	.options = NULL,
-	.init = NULL,
+	.init = init,
 	.receive = receive,
-	.cleanup = NULL,
+	.cleanup = cleanup,
 };
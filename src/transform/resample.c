@@ -0,0 +1,559 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Convert the data to another samplerate, by a rational factor L/M of
+ * the output and the input samplerate. Analog data goes through a
+ * polyphase FIR filter (a windowed sinc, split into L phases), or gets
+ * interpolated linearly, or holds the most recent input sample. The
+ * result is passed on as 32-bit floats. Logic data always holds the
+ * most recent input sample.
+ *
+ * The filter history and the position of the next output sample are
+ * kept per set of channels across packets, so the output does not
+ * depend on how the input got split into packets. The output samplerate
+ * is sent in a meta packet after the header, and replaces the one in
+ * the device's meta packets.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/resample"
+
+/* Limit of the polyphase filter size, in coefficients. */
+#define RESAMPLE_MAX_COEFFS	(1 << 20)
+
+enum {
+	RESAMPLE_POLYPHASE,
+	RESAMPLE_LINEAR,
+	RESAMPLE_HOLD,
+};
+
+/* Resampler state of the analog packets of one set of channels. */
+struct resample_state {
+	unsigned int num_channels;
+	/*
+	 * Position of the next output sample in 1/L input samples, from
+	 * the start of the work buffer.
+	 */
+	uint64_t next;
+	/* The last (window - 1) input values per channel, oldest first. */
+	float *history;
+	float *values;
+	float *work;
+	size_t size;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+};
+
+struct context {
+	uint64_t out_rate;
+	uint64_t in_rate;
+	int mode;
+	unsigned int taps;
+
+	/* Rate change of the current stream, zero when passing through. */
+	uint64_t up;
+	uint64_t down;
+	int analog_mode;
+	/* Input samples which an output sample depends on. */
+	size_t window;
+	/* The filter phases, each with reversed taps for the dot product. */
+	float *coeffs;
+
+	/* Logic state, see struct resample_state. */
+	uint64_t logic_next;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_packet packet;
+
+	/* Analog states, keyed by the packet's first channel. */
+	GHashTable *states;
+};
+
+static const char *resample_modes[] = { "polyphase", "linear", "hold", };
+
+static void resample_state_free(void *data)
+{
+	struct resample_state *state;
+
+	state = data;
+	g_free(state->history);
+	g_free(state->values);
+	g_free(state->work);
+	g_free(state);
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	const char *name;
+	int mode;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	name = g_variant_get_string(g_hash_table_lookup(options, "mode"), NULL);
+	for (mode = 0; mode < (int)ARRAY_SIZE(resample_modes); mode++) {
+		if (!strcmp(resample_modes[mode], name))
+			break;
+	}
+	if (mode == ARRAY_SIZE(resample_modes)) {
+		sr_err("Invalid resampling mode '%s'.", name);
+		return SR_ERR_ARG;
+	}
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+	ctx->out_rate = g_variant_get_uint64(g_hash_table_lookup(options, "samplerate"));
+	ctx->mode = mode;
+	ctx->taps = g_variant_get_uint32(g_hash_table_lookup(options, "taps"));
+	if (!ctx->taps)
+		ctx->taps = 1;
+	ctx->states = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+		NULL, resample_state_free);
+
+	return SR_OK;
+}
+
+/*
+ * Lowpass prototype of L phases, a Blackman windowed sinc with the
+ * cutoff at the lower one of the two Nyquist frequencies. Phase p gets
+ * the coefficients p, p + L, p + 2L, ... of the prototype, which meet
+ * the input samples from the most recent one on.
+ */
+static void coeffs_build(struct context *ctx)
+{
+	double *h, fc, c, x, w, sum;
+	size_t n, i, j, p;
+
+	n = ctx->up * ctx->window;
+	h = g_malloc_n(n, sizeof(double));
+	fc = 0.5 / MAX(ctx->up, ctx->down);
+	c = (n - 1) / 2.0;
+	sum = 0;
+	for (i = 0; i < n; i++) {
+		x = 2 * fc * (i - c);
+		h[i] = (x == 0) ? 1 : sin(G_PI * x) / (G_PI * x);
+		if (n > 1) {
+			w = 0.42 - 0.5 * cos(2 * G_PI * i / (n - 1))
+				+ 0.08 * cos(4 * G_PI * i / (n - 1));
+			h[i] *= w;
+		}
+		sum += h[i];
+	}
+
+	/* Unity gain per phase, on average. */
+	g_free(ctx->coeffs);
+	ctx->coeffs = g_malloc_n(n, sizeof(float));
+	for (p = 0; p < ctx->up; p++) {
+		for (j = 0; j < ctx->window; j++)
+			ctx->coeffs[p * ctx->window + ctx->window - 1 - j] =
+				h[p + j * ctx->up] * ctx->up / sum;
+	}
+	g_free(h);
+}
+
+/* Set up the rate change from the input to the output samplerate. */
+static void rate_setup(struct context *ctx, uint64_t in_rate)
+{
+	uint64_t a, b, r;
+
+	ctx->in_rate = in_rate;
+	ctx->up = ctx->down = 0;
+	ctx->logic_next = 0;
+	g_hash_table_remove_all(ctx->states);
+	if (!ctx->out_rate || !in_rate || in_rate == ctx->out_rate)
+		return;
+
+	for (a = in_rate, b = ctx->out_rate; b; a = b, b = r)
+		r = a % b;
+	ctx->up = ctx->out_rate / a;
+	ctx->down = in_rate / a;
+
+	ctx->analog_mode = ctx->mode;
+	if (ctx->analog_mode == RESAMPLE_POLYPHASE) {
+		/* More taps for a lower cutoff when reducing the rate. */
+		ctx->window = ctx->taps
+			* MAX(1, (ctx->down + ctx->up - 1) / ctx->up);
+		if (ctx->up * ctx->window > RESAMPLE_MAX_COEFFS) {
+			sr_warn("Rate change %" PRIu64 "/%" PRIu64 " needs too "
+				"many filter phases, interpolating linearly.",
+				ctx->up, ctx->down);
+			ctx->analog_mode = RESAMPLE_LINEAR;
+		}
+	}
+	if (ctx->analog_mode == RESAMPLE_POLYPHASE)
+		coeffs_build(ctx);
+	else
+		ctx->window = (ctx->analog_mode == RESAMPLE_LINEAR) ? 2 : 1;
+
+	sr_dbg("Resampling %" PRIu64 " Hz to %" PRIu64 " Hz (%" PRIu64
+		"/%" PRIu64 ", %s).", in_rate, ctx->out_rate, ctx->up,
+		ctx->down, resample_modes[ctx->analog_mode]);
+}
+
+/* Send the output samplerate after the header. */
+static int receive_header(const struct sr_transform *t, struct context *ctx)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_meta meta;
+	GVariant *gvar;
+	uint64_t in_rate;
+	int ret;
+
+	in_rate = 0;
+	if (sr_config_get(t->sdi->driver, t->sdi, NULL, SR_CONF_SAMPLERATE,
+			&gvar) == SR_OK) {
+		in_rate = g_variant_get_uint64(gvar);
+		g_variant_unref(gvar);
+	}
+	rate_setup(ctx, in_rate);
+	if (!ctx->up)
+		return SR_OK;
+
+	meta.config = g_slist_append(NULL, sr_config_new(SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(ctx->out_rate)));
+	packet.type = SR_DF_META;
+	packet.payload = &meta;
+	ret = sr_transform_emit(t, &packet);
+	g_slist_free_full(meta.config, (GDestroyNotify)sr_config_free);
+
+	return ret;
+}
+
+/* Take the input samplerate, and replace it with the output one. */
+static void receive_meta(struct context *ctx,
+		const struct sr_datafeed_meta *meta)
+{
+	struct sr_config *src;
+	uint64_t samplerate;
+	GSList *l;
+
+	for (l = meta->config; l; l = l->next) {
+		src = l->data;
+		if (src->key != SR_CONF_SAMPLERATE)
+			continue;
+		samplerate = g_variant_get_uint64(src->data);
+		if (samplerate != ctx->in_rate)
+			rate_setup(ctx, samplerate);
+		if (!ctx->up)
+			continue;
+		g_variant_unref(src->data);
+		src->data = g_variant_ref_sink(
+			g_variant_new_uint64(ctx->out_rate));
+	}
+}
+
+/*
+ * Number of output samples from a block of input samples, for the
+ * position of the first one in 1/L input samples.
+ */
+static size_t output_count(const struct context *ctx, uint64_t next,
+		size_t samples)
+{
+	uint64_t end;
+
+	end = samples * ctx->up;
+	if (next >= end)
+		return 0;
+
+	return (end - next + ctx->down - 1) / ctx->down;
+}
+
+static int receive_logic(const struct sr_transform *t, struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_logic *logic;
+	const uint8_t *data;
+	uint8_t *out;
+	uint64_t next;
+	size_t samples, count, i;
+	uint16_t unitsize;
+
+	logic = packet_in->payload;
+	unitsize = logic->unitsize;
+	if (!unitsize)
+		return SR_OK;
+	samples = logic->length / unitsize;
+	count = output_count(ctx, ctx->logic_next, samples);
+	if (!count) {
+		ctx->logic_next -= samples * ctx->up;
+		*packet_out = NULL;
+		return SR_OK;
+	}
+
+	out = sr_transform_buffer_get(t, count * unitsize);
+	if (!out)
+		return SR_ERR_MALLOC;
+	data = logic->data;
+	next = ctx->logic_next;
+	for (i = 0; i < count; i++) {
+		memcpy(out + i * unitsize, data + (next / ctx->up) * unitsize,
+			unitsize);
+		next += ctx->down;
+	}
+	ctx->logic_next = next - samples * ctx->up;
+
+	ctx->logic.length = count * unitsize;
+	ctx->logic.unitsize = unitsize;
+	ctx->logic.data = out;
+	ctx->packet.type = SR_DF_LOGIC;
+	ctx->packet.payload = &ctx->logic;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static struct resample_state *resample_state_get(struct context *ctx,
+		const struct sr_datafeed_analog *analog)
+{
+	struct resample_state *state;
+	unsigned int num_channels;
+	void *key;
+
+	key = analog->meaning->channels->data;
+	num_channels = g_slist_length(analog->meaning->channels);
+	state = g_hash_table_lookup(ctx->states, key);
+	if (state && state->num_channels == num_channels)
+		return state;
+
+	state = g_malloc0(sizeof(*state));
+	state->num_channels = num_channels;
+	state->history = g_malloc0_n(num_channels * ctx->window, sizeof(float));
+	/* Interpolation starts at the first sample, not at the history. */
+	if (ctx->analog_mode == RESAMPLE_LINEAR)
+		state->next = ctx->up;
+	state->encoding.unitsize = sizeof(float);
+	state->encoding.is_signed = TRUE;
+	state->encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	state->encoding.is_bigendian = TRUE;
+#endif
+	sr_rational_set(&state->encoding.scale, 1, 1);
+	sr_rational_set(&state->encoding.offset, 0, 1);
+	g_hash_table_replace(ctx->states, key, state);
+
+	return state;
+}
+
+/*
+ * Dot product of a filter phase with a window of the input. Four
+ * independent lanes let the compiler turn it into SIMD multiply-adds.
+ */
+static inline float dot(const float *a, const float *b, size_t n)
+{
+	float lane[4] = { 0, 0, 0, 0 };
+	size_t i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		lane[0] += a[i + 0] * b[i + 0];
+		lane[1] += a[i + 1] * b[i + 1];
+		lane[2] += a[i + 2] * b[i + 2];
+		lane[3] += a[i + 3] * b[i + 3];
+	}
+	for (; i < n; i++)
+		lane[0] += a[i] * b[i];
+
+	return (lane[0] + lane[1]) + (lane[2] + lane[3]);
+}
+
+/*
+ * Resample one channel. The work buffer holds the channel's history of
+ * (window - 1) values, followed by the new samples.
+ */
+static void resample_channel(const struct context *ctx, const float *work,
+		uint64_t next, size_t count, float *out, size_t stride)
+{
+	const float *x;
+	uint64_t phase;
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		x = work + next / ctx->up;
+		phase = next % ctx->up;
+		switch (ctx->analog_mode) {
+		case RESAMPLE_POLYPHASE:
+			out[i * stride] = dot(ctx->coeffs + phase * ctx->window,
+				x, ctx->window);
+			break;
+		case RESAMPLE_LINEAR:
+			out[i * stride] = x[0]
+				+ (x[1] - x[0]) * ((double)phase / ctx->up);
+			break;
+		case RESAMPLE_HOLD:
+			out[i * stride] = x[0];
+			break;
+		}
+		next += ctx->down;
+	}
+}
+
+static int receive_analog(const struct sr_transform *t, struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_analog *analog;
+	struct resample_state *state;
+	float *hist, *out;
+	size_t samples, hlen, count, i;
+	unsigned int ch, nch;
+	int ret;
+
+	analog = packet_in->payload;
+	if (!analog->meaning || !analog->meaning->channels || !analog->num_samples)
+		return SR_OK;
+
+	state = resample_state_get(ctx, analog);
+	nch = state->num_channels;
+	samples = analog->num_samples;
+	hlen = ctx->window - 1;
+	if (state->size < samples) {
+		state->values = g_realloc_n(state->values, samples * nch, sizeof(float));
+		state->work = g_realloc_n(state->work, hlen + samples, sizeof(float));
+		state->size = samples;
+	}
+	if ((ret = sr_analog_to_float(analog, state->values)) != SR_OK)
+		return ret;
+
+	count = output_count(ctx, state->next, samples);
+	out = NULL;
+	if (count && !(out = sr_transform_buffer_get(t,
+			count * nch * sizeof(float))))
+		return SR_ERR_MALLOC;
+
+	for (ch = 0; ch < nch; ch++) {
+		/* Gather the channel behind its history. */
+		hist = state->history + ch * ctx->window;
+		memcpy(state->work, hist, hlen * sizeof(float));
+		for (i = 0; i < samples; i++)
+			state->work[hlen + i] = state->values[i * nch + ch];
+		if (count)
+			resample_channel(ctx, state->work, state->next, count,
+				out + ch, nch);
+		memcpy(hist, state->work + samples, hlen * sizeof(float));
+	}
+	state->next += count * ctx->down - samples * ctx->up;
+
+	if (!count) {
+		*packet_out = NULL;
+		return SR_OK;
+	}
+
+	state->encoding.digits = analog->encoding->digits;
+	state->encoding.is_digits_decimal = analog->encoding->is_digits_decimal;
+	state->analog.data = out;
+	state->analog.num_samples = count;
+	state->analog.encoding = &state->encoding;
+	state->analog.meaning = analog->meaning;
+	state->analog.spec = analog->spec;
+	ctx->packet.type = SR_DF_ANALOG;
+	ctx->packet.payload = &state->analog;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	/* By default pass the packet on unmodified. */
+	*packet_out = packet_in;
+	if (!ctx->out_rate)
+		return SR_OK;
+
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+		return receive_header(t, ctx);
+	case SR_DF_META:
+		receive_meta(ctx, packet_in->payload);
+		break;
+	case SR_DF_LOGIC:
+		if (ctx->up)
+			return receive_logic(t, ctx, packet_in, packet_out);
+		break;
+	case SR_DF_ANALOG:
+		if (ctx->up)
+			return receive_analog(t, ctx, packet_in, packet_out);
+		break;
+	default:
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	g_hash_table_destroy(ctx->states);
+	g_free(ctx->coeffs);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "samplerate", "Samplerate", "Output samplerate in Hz, 0 to pass the data through", NULL, NULL },
+	{ "mode", "Mode", "Resampling of analog data (polyphase, linear, hold)", NULL, NULL },
+	{ "taps", "Taps", "Filter taps per phase of the polyphase filter", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	unsigned int i;
+
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_uint64(0));
+		options[1].def = g_variant_ref_sink(g_variant_new_string(resample_modes[0]));
+		for (i = 0; i < ARRAY_SIZE(resample_modes); i++)
+			options[1].values = g_slist_append(options[1].values,
+				g_variant_ref_sink(g_variant_new_string(resample_modes[i])));
+		options[2].def = g_variant_ref_sink(g_variant_new_uint32(16));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_resample = {
+	.id = "resample",
+	.name = "Resample",
+	.desc = "Convert the data to another samplerate",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
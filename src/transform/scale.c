@@ -26,6 +26,16 @@
 
 struct context {
 	struct sr_rational factor;
+	/* Scale and offset of the last input, and the scaled ones. */
+	struct sr_rational in_scale;
+	struct sr_rational in_offset;
+	struct sr_rational scale;
+	struct sr_rational offset;
+	gboolean cached;
+	/* The output refers to a copy of the encoding, not the driver's. */
+	struct sr_analog_encoding encoding;
+	struct sr_datafeed_analog analog;
+	struct sr_datafeed_packet packet;
 };
 
 static int init(struct sr_transform *t, GHashTable *options)
@@ -39,16 +49,38 @@ static int init(struct sr_transform *t, GHashTable *options)
 
 	g_variant_get(g_hash_table_lookup(options, "factor"), "(xt)",
 			&ctx->factor.p, &ctx->factor.q);
+	if (!ctx->factor.q) {
+		sr_err("Invalid scaling factor.");
+		g_free(ctx);
+		t->priv = NULL;
+		return SR_ERR_ARG;
+	}
+	sr_rational_reduce(&ctx->factor);
 
 	return SR_OK;
 }
 
+static void scale_rational(struct sr_rational *res,
+		const struct sr_rational *value, const struct sr_rational *factor)
+{
+	struct sr_rational r;
+
+	r = *value;
+	sr_rational_reduce(&r);
+	if (sr_rational_mult(res, &r, factor) != SR_OK) {
+		/* Relatively prime and too large, round the product. */
+		sr_rational_from_double(res, (double)r.p / r.q
+			* factor->p / factor->q);
+	}
+}
+
 static int receive(const struct sr_transform *t,
 		struct sr_datafeed_packet *packet_in,
 		struct sr_datafeed_packet **packet_out)
 {
 	struct context *ctx;
 	const struct sr_datafeed_analog *analog;
+	const struct sr_analog_encoding *enc;
 
 	if (!t || !t->sdi || !packet_in || !packet_out)
 		return SR_ERR_ARG;
@@ -57,15 +89,34 @@ static int receive(const struct sr_transform *t,
 	switch (packet_in->type) {
 	case SR_DF_ANALOG:
 		analog = packet_in->payload;
-		analog->encoding->scale.p *= ctx->factor.p;
-		analog->encoding->scale.q *= ctx->factor.q;
-		break;
+		enc = analog->encoding;
+		/* Streams keep their scale, only compute it once per change. */
+		if (!ctx->cached
+				|| enc->scale.p != ctx->in_scale.p
+				|| enc->scale.q != ctx->in_scale.q
+				|| enc->offset.p != ctx->in_offset.p
+				|| enc->offset.q != ctx->in_offset.q) {
+			ctx->in_scale = enc->scale;
+			ctx->in_offset = enc->offset;
+			scale_rational(&ctx->scale, &enc->scale, &ctx->factor);
+			scale_rational(&ctx->offset, &enc->offset, &ctx->factor);
+			ctx->cached = TRUE;
+		}
+		ctx->encoding = *enc;
+		ctx->encoding.scale = ctx->scale;
+		ctx->encoding.offset = ctx->offset;
+		ctx->analog = *analog;
+		ctx->analog.encoding = &ctx->encoding;
+		ctx->packet.type = SR_DF_ANALOG;
+		ctx->packet.payload = &ctx->analog;
+		*packet_out = &ctx->packet;
+		return SR_OK;
 	default:
 		sr_spew("Unsupported packet type %d, ignoring.", packet_in->type);
 		break;
 	}
 
-	/* Return the in-place-modified packet. */
+	/* Return the unmodified packet. */
 	*packet_out = packet_in;
 
 	return SR_OK;
@@ -0,0 +1,498 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Running statistics of analog data. The minimum, maximum, mean, RMS
+ * and peak-to-peak value of each channel get accumulated, and are sent
+ * as summary packets of one sample per channel, after each interval and
+ * at the end of the stream:
+ *
+ * - Minimum, maximum and mean carry the MIN, MAX and AVG flags.
+ * - The RMS value carries the RMS flag.
+ * - The peak-to-peak value carries both the MIN and MAX flags.
+ *
+ * Optionally a histogram follows, as a packet of SR_MQ_COUNT values
+ * with one sample per bin. Values which are not finite (overloads) are
+ * left out of the statistics, values outside of the histogram's range
+ * count in its outermost bins.
+ *
+ * The analog data itself is dropped, unless pass-through is enabled.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/stats"
+
+enum {
+	STAT_MIN,
+	STAT_MAX,
+	STAT_MEAN,
+	STAT_RMS,
+	STAT_P2P,
+	STAT_COUNT,
+};
+
+static const enum sr_mqflag stat_flags[STAT_COUNT] = {
+	[STAT_MIN] = SR_MQFLAG_MIN,
+	[STAT_MAX] = SR_MQFLAG_MAX,
+	[STAT_MEAN] = SR_MQFLAG_AVG,
+	[STAT_RMS] = SR_MQFLAG_RMS,
+	[STAT_P2P] = SR_MQFLAG_MIN | SR_MQFLAG_MAX,
+};
+
+/* Accumulators of one channel. */
+struct channel_stats {
+	uint64_t count;
+	float min, max;
+	double sum, sum_sq;
+};
+
+/* Statistics of the analog packets of one set of channels. */
+struct stats_state {
+	unsigned int num_channels;
+	GSList *channels;
+	struct channel_stats *stats;
+	/* Histogram bins of all channels, channel after channel. */
+	uint64_t *bins;
+	/* Samples per channel, and start of the current interval. */
+	uint64_t samples;
+	int64_t since_us;
+	float *values;
+	size_t size;
+	/* Summary values, for the histogram one per bin and channel. */
+	float *summary;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct sr_datafeed_analog analog;
+};
+
+struct context {
+	uint64_t interval_samples;
+	int64_t interval_us;
+	gboolean passthrough;
+	unsigned int num_bins;
+	double hist_min, hist_max;
+	struct sr_datafeed_packet packet;
+	/* Statistics, keyed by the packet's first channel. */
+	GHashTable *states;
+};
+
+static void stats_state_free(void *data)
+{
+	struct stats_state *state;
+
+	state = data;
+	g_slist_free(state->channels);
+	g_free(state->stats);
+	g_free(state->bins);
+	g_free(state->values);
+	g_free(state->summary);
+	g_free(state);
+}
+
+static void stats_reset(const struct context *ctx, struct stats_state *state)
+{
+	unsigned int ch;
+
+	for (ch = 0; ch < state->num_channels; ch++) {
+		memset(&state->stats[ch], 0, sizeof(state->stats[ch]));
+		state->stats[ch].min = INFINITY;
+		state->stats[ch].max = -INFINITY;
+	}
+	if (ctx->num_bins)
+		memset(state->bins, 0, state->num_channels * ctx->num_bins
+			* sizeof(state->bins[0]));
+	state->samples = 0;
+	state->since_us = g_get_monotonic_time();
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+	ctx->interval_samples = g_variant_get_uint64(
+		g_hash_table_lookup(options, "samples"));
+	ctx->interval_us = g_variant_get_uint32(
+		g_hash_table_lookup(options, "interval_ms")) * (int64_t)1000;
+	ctx->passthrough = g_variant_get_boolean(
+		g_hash_table_lookup(options, "passthrough"));
+	ctx->num_bins = g_variant_get_uint32(g_hash_table_lookup(options, "bins"));
+	ctx->hist_min = g_variant_get_double(
+		g_hash_table_lookup(options, "histogram_min"));
+	ctx->hist_max = g_variant_get_double(
+		g_hash_table_lookup(options, "histogram_max"));
+	if (ctx->num_bins && !(ctx->hist_max > ctx->hist_min)) {
+		sr_err("The histogram needs a maximum above its minimum.");
+		g_free(ctx);
+		t->priv = NULL;
+		return SR_ERR_ARG;
+	}
+	ctx->states = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+		NULL, stats_state_free);
+
+	return SR_OK;
+}
+
+static struct stats_state *stats_state_get(struct context *ctx,
+		const struct sr_datafeed_analog *analog)
+{
+	struct stats_state *state;
+	unsigned int num_channels;
+	void *key;
+
+	key = analog->meaning->channels->data;
+	num_channels = g_slist_length(analog->meaning->channels);
+	state = g_hash_table_lookup(ctx->states, key);
+	if (state && state->num_channels == num_channels)
+		return state;
+
+	state = g_malloc0(sizeof(*state));
+	state->num_channels = num_channels;
+	state->channels = g_slist_copy(analog->meaning->channels);
+	state->stats = g_malloc0_n(num_channels, sizeof(state->stats[0]));
+	state->bins = g_malloc0_n(MAX(num_channels * ctx->num_bins, 1),
+		sizeof(state->bins[0]));
+	state->summary = g_malloc0_n(num_channels * MAX(ctx->num_bins, 1),
+		sizeof(float));
+	state->encoding.unitsize = sizeof(float);
+	state->encoding.is_signed = TRUE;
+	state->encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	state->encoding.is_bigendian = TRUE;
+#endif
+	sr_rational_set(&state->encoding.scale, 1, 1);
+	sr_rational_set(&state->encoding.offset, 0, 1);
+	state->meaning.channels = state->channels;
+	stats_reset(ctx, state);
+	g_hash_table_replace(ctx->states, key, state);
+
+	return state;
+}
+
+/*
+ * Accumulate the samples of one channel. Four independent lanes let the
+ * compiler keep the sums and extremes in SIMD registers.
+ */
+static void stats_channel(struct channel_stats *st, const float *values,
+		size_t samples, size_t stride)
+{
+	float lo[4], hi[4], v;
+	double sum[4], sum_sq[4];
+	uint64_t count;
+	size_t i, k;
+
+	for (k = 0; k < 4; k++) {
+		lo[k] = st->min;
+		hi[k] = st->max;
+		sum[k] = sum_sq[k] = 0;
+	}
+	count = 0;
+	for (i = 0; i + 4 <= samples; i += 4) {
+		for (k = 0; k < 4; k++) {
+			v = values[(i + k) * stride];
+			if (!isfinite(v))
+				continue;
+			lo[k] = v < lo[k] ? v : lo[k];
+			hi[k] = v > hi[k] ? v : hi[k];
+			sum[k] += v;
+			sum_sq[k] += (double)v * v;
+			count++;
+		}
+	}
+	for (; i < samples; i++) {
+		v = values[i * stride];
+		if (!isfinite(v))
+			continue;
+		lo[0] = v < lo[0] ? v : lo[0];
+		hi[0] = v > hi[0] ? v : hi[0];
+		sum[0] += v;
+		sum_sq[0] += (double)v * v;
+		count++;
+	}
+
+	st->min = MIN(MIN(lo[0], lo[1]), MIN(lo[2], lo[3]));
+	st->max = MAX(MAX(hi[0], hi[1]), MAX(hi[2], hi[3]));
+	st->sum += (sum[0] + sum[1]) + (sum[2] + sum[3]);
+	st->sum_sq += (sum_sq[0] + sum_sq[1]) + (sum_sq[2] + sum_sq[3]);
+	st->count += count;
+}
+
+static void histogram_channel(const struct context *ctx, uint64_t *bins,
+		const float *values, size_t samples, size_t stride)
+{
+	double scale, pos;
+	size_t i;
+	long bin;
+
+	scale = ctx->num_bins / (ctx->hist_max - ctx->hist_min);
+	for (i = 0; i < samples; i++) {
+		if (!isfinite(values[i * stride]))
+			continue;
+		pos = (values[i * stride] - ctx->hist_min) * scale;
+		bin = pos < 0 ? 0 : pos >= ctx->num_bins ? ctx->num_bins - 1 : (long)pos;
+		bins[bin]++;
+	}
+}
+
+static int emit_values(const struct sr_transform *t, struct context *ctx,
+		struct stats_state *state, size_t samples)
+{
+	state->analog.data = state->summary;
+	state->analog.num_samples = samples;
+	state->analog.encoding = &state->encoding;
+	state->analog.meaning = &state->meaning;
+	state->analog.spec = &state->spec;
+	ctx->packet.type = SR_DF_ANALOG;
+	ctx->packet.payload = &state->analog;
+
+	return sr_transform_emit(t, &ctx->packet);
+}
+
+/* Send the summary of the current interval, and start the next one. */
+static int stats_summary(const struct sr_transform *t, struct context *ctx,
+		struct stats_state *state)
+{
+	struct channel_stats *st;
+	enum sr_mq mq;
+	enum sr_unit unit;
+	enum sr_mqflag mqflags;
+	unsigned int ch, b, nch;
+	int stat, ret;
+	float v;
+
+	if (!state->samples)
+		return SR_OK;
+
+	ret = SR_OK;
+	nch = state->num_channels;
+	mq = state->meaning.mq;
+	unit = state->meaning.unit;
+	mqflags = state->meaning.mqflags;
+	for (stat = 0; stat < STAT_COUNT; stat++) {
+		for (ch = 0; ch < nch; ch++) {
+			st = &state->stats[ch];
+			v = NAN;
+			if (st->count) {
+				switch (stat) {
+				case STAT_MIN:
+					v = st->min;
+					break;
+				case STAT_MAX:
+					v = st->max;
+					break;
+				case STAT_MEAN:
+					v = st->sum / st->count;
+					break;
+				case STAT_RMS:
+					v = sqrt(st->sum_sq / st->count);
+					break;
+				case STAT_P2P:
+					v = st->max - st->min;
+					break;
+				}
+			}
+			state->summary[ch] = v;
+		}
+		state->meaning.mqflags = (mqflags
+			& ~(SR_MQFLAG_MIN | SR_MQFLAG_MAX | SR_MQFLAG_AVG))
+			| stat_flags[stat];
+		if ((ret = emit_values(t, ctx, state, 1)) != SR_OK)
+			break;
+	}
+	state->meaning.mqflags = mqflags;
+
+	if (ret == SR_OK && ctx->num_bins) {
+		for (ch = 0; ch < nch; ch++) {
+			for (b = 0; b < ctx->num_bins; b++)
+				state->summary[b * nch + ch] =
+					state->bins[ch * ctx->num_bins + b];
+		}
+		state->meaning.mq = SR_MQ_COUNT;
+		state->meaning.unit = SR_UNIT_UNITLESS;
+		state->meaning.mqflags = 0;
+		state->encoding.digits = 0;
+		ret = emit_values(t, ctx, state, ctx->num_bins);
+		state->meaning.mq = mq;
+		state->meaning.unit = unit;
+		state->meaning.mqflags = mqflags;
+	}
+	stats_reset(ctx, state);
+
+	return ret;
+}
+
+static int receive_analog(const struct sr_transform *t, struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_analog *analog;
+	struct stats_state *state;
+	size_t samples;
+	unsigned int ch, nch;
+	gboolean due;
+	int ret;
+
+	if (!ctx->passthrough)
+		*packet_out = NULL;
+
+	analog = packet_in->payload;
+	if (!analog->meaning || !analog->meaning->channels || !analog->num_samples)
+		return SR_OK;
+
+	state = stats_state_get(ctx, analog);
+	nch = state->num_channels;
+	samples = analog->num_samples;
+	if (state->size < samples) {
+		state->values = g_realloc_n(state->values, samples * nch, sizeof(float));
+		state->size = samples;
+	}
+	if ((ret = sr_analog_to_float(analog, state->values)) != SR_OK)
+		return ret;
+
+	for (ch = 0; ch < nch; ch++) {
+		stats_channel(&state->stats[ch], state->values + ch, samples, nch);
+		if (ctx->num_bins)
+			histogram_channel(ctx, state->bins + ch * ctx->num_bins,
+				state->values + ch, samples, nch);
+	}
+	state->samples += samples;
+
+	/* The summary describes the most recent meaning. */
+	state->meaning.mq = analog->meaning->mq;
+	state->meaning.unit = analog->meaning->unit;
+	state->meaning.mqflags = analog->meaning->mqflags;
+	state->encoding.digits = analog->encoding->digits;
+	state->encoding.is_digits_decimal = analog->encoding->is_digits_decimal;
+	if (analog->spec)
+		state->spec = *analog->spec;
+
+	due = ctx->interval_samples && state->samples >= ctx->interval_samples;
+	due |= ctx->interval_us
+		&& g_get_monotonic_time() - state->since_us >= ctx->interval_us;
+	if (due)
+		return stats_summary(t, ctx, state);
+
+	return SR_OK;
+}
+
+/* Send the summaries of the stream, followed by its end. */
+static int receive_end(const struct sr_transform *t, struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	GHashTableIter iter;
+	void *value;
+	int ret;
+
+	g_hash_table_iter_init(&iter, ctx->states);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		if ((ret = stats_summary(t, ctx, value)) != SR_OK)
+			return ret;
+	}
+	*packet_out = NULL;
+
+	return sr_transform_emit(t, packet_in);
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	/* By default pass the packet on unmodified. */
+	*packet_out = packet_in;
+
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+		g_hash_table_remove_all(ctx->states);
+		break;
+	case SR_DF_ANALOG:
+		return receive_analog(t, ctx, packet_in, packet_out);
+	case SR_DF_END:
+		return receive_end(t, ctx, packet_in, packet_out);
+	default:
+		sr_spew("Unsupported packet type %d, ignoring.", packet_in->type);
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	g_hash_table_destroy(ctx->states);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "interval_ms", "Interval", "Time in ms between summaries, 0 for none", NULL, NULL },
+	{ "samples", "Samples", "Samples per channel between summaries, 0 for no limit", NULL, NULL },
+	{ "passthrough", "Pass-through", "Pass the analog data on, along with the summaries", NULL, NULL },
+	{ "bins", "Histogram bins", "Number of histogram bins, 0 for no histogram", NULL, NULL },
+	{ "histogram_min", "Histogram minimum", "Lower end of the histogram's range", NULL, NULL },
+	{ "histogram_max", "Histogram maximum", "Upper end of the histogram's range", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_uint32(1000));
+		options[1].def = g_variant_ref_sink(g_variant_new_uint64(0));
+		options[2].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+		options[3].def = g_variant_ref_sink(g_variant_new_uint32(0));
+		options[4].def = g_variant_ref_sink(g_variant_new_double(0));
+		options[5].def = g_variant_ref_sink(g_variant_new_double(1));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_stats = {
+	.id = "stats",
+	.name = "Statistics",
+	.desc = "Running statistics and histograms of analog values",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
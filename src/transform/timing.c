@@ -0,0 +1,340 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Pulse timing of logic channels. The edges of the enabled logic
+ * channels get collected, and after each interval and at the end of the
+ * stream their timing is sent as analog packets of one sample per
+ * channel:
+ *
+ * - The frequency in Hz, from the mean period.
+ * - The duty cycle in percent.
+ * - The mean pulse width (high time) in seconds.
+ *
+ * Channels without a complete period in the interval get NaN. Without
+ * a samplerate only the duty cycle is known.
+ *
+ * The logic data itself is dropped, unless pass-through is enabled.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/timing"
+
+/* Edges kept across intervals, so periods spanning them count. */
+#define KEEP_EDGES 2
+
+struct context {
+	uint64_t interval_samples;
+	int64_t interval_us;
+	gboolean passthrough;
+	uint64_t samplerate;
+	/* The enabled logic channels, and their bit positions. */
+	GSList *channels;
+	unsigned int num_channels;
+	struct sr_logic_edges *edges;
+	/* Samples in, and start of, the current interval. */
+	uint64_t samples;
+	int64_t since_us;
+	float *values;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct sr_datafeed_analog analog;
+	struct sr_datafeed_packet packet;
+};
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+	ctx->interval_samples = g_variant_get_uint64(
+		g_hash_table_lookup(options, "samples"));
+	ctx->interval_us = g_variant_get_uint32(
+		g_hash_table_lookup(options, "interval_ms")) * (int64_t)1000;
+	ctx->passthrough = g_variant_get_boolean(
+		g_hash_table_lookup(options, "passthrough"));
+
+	ctx->encoding.unitsize = sizeof(float);
+	ctx->encoding.is_signed = TRUE;
+	ctx->encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	ctx->encoding.is_bigendian = TRUE;
+#endif
+	ctx->encoding.digits = 6;
+	ctx->encoding.is_digits_decimal = FALSE;
+	sr_rational_set(&ctx->encoding.scale, 1, 1);
+	sr_rational_set(&ctx->encoding.offset, 0, 1);
+
+	return SR_OK;
+}
+
+/* Start collecting the edges of a new stream. */
+static int receive_header(const struct sr_transform *t, struct context *ctx)
+{
+	struct sr_channel *ch;
+	GVariant *gvar;
+	GSList *l;
+	unsigned int count;
+	int ret;
+
+	g_slist_free(ctx->channels);
+	ctx->channels = NULL;
+	sr_logic_edges_free(ctx->edges);
+	ctx->edges = NULL;
+
+	count = 0;
+	for (l = t->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_LOGIC || !ch->enabled)
+			continue;
+		ctx->channels = g_slist_append(ctx->channels, ch);
+		count = MAX(count, (unsigned int)ch->index + 1);
+	}
+	ctx->num_channels = g_slist_length(ctx->channels);
+	if (!ctx->num_channels)
+		return SR_OK;
+	if ((ret = sr_logic_edges_new(&ctx->edges, count)) != SR_OK)
+		return ret;
+	ctx->values = g_realloc_n(ctx->values, ctx->num_channels, sizeof(float));
+	ctx->meaning.channels = ctx->channels;
+
+	ctx->samplerate = 0;
+	if (sr_config_get(t->sdi->driver, t->sdi, NULL, SR_CONF_SAMPLERATE,
+			&gvar) == SR_OK) {
+		ctx->samplerate = g_variant_get_uint64(gvar);
+		g_variant_unref(gvar);
+	}
+	ctx->samples = 0;
+	ctx->since_us = g_get_monotonic_time();
+
+	return SR_OK;
+}
+
+static int emit_values(const struct sr_transform *t, struct context *ctx,
+		enum sr_mq mq, enum sr_unit unit)
+{
+	ctx->meaning.mq = mq;
+	ctx->meaning.unit = unit;
+	ctx->meaning.mqflags = 0;
+	ctx->analog.data = ctx->values;
+	ctx->analog.num_samples = 1;
+	ctx->analog.encoding = &ctx->encoding;
+	ctx->analog.meaning = &ctx->meaning;
+	ctx->analog.spec = &ctx->spec;
+	ctx->packet.type = SR_DF_ANALOG;
+	ctx->packet.payload = &ctx->analog;
+
+	return sr_transform_emit(t, &ctx->packet);
+}
+
+/* Send the timing of the current interval, and start the next one. */
+static int timing_summary(const struct sr_transform *t, struct context *ctx)
+{
+	struct sr_channel *ch;
+	struct sr_logic_timing *timing;
+	GSList *l;
+	unsigned int i;
+	int ret;
+
+	if (!ctx->edges || !ctx->samples)
+		return SR_OK;
+
+	timing = g_malloc0_n(ctx->num_channels, sizeof(timing[0]));
+	for (l = ctx->channels, i = 0; l; l = l->next, i++) {
+		ch = l->data;
+		if (sr_logic_edges_timing(ctx->edges, ch->index,
+				&timing[i]) != SR_OK)
+			timing[i].periods = 0;
+	}
+
+	ret = SR_OK;
+	if (ctx->samplerate) {
+		for (i = 0; i < ctx->num_channels; i++)
+			ctx->values[i] = timing[i].periods
+				? ctx->samplerate / timing[i].period : NAN;
+		ret = emit_values(t, ctx, SR_MQ_FREQUENCY, SR_UNIT_HERTZ);
+	}
+	if (ret == SR_OK) {
+		for (i = 0; i < ctx->num_channels; i++)
+			ctx->values[i] = timing[i].periods
+				? timing[i].duty_cycle * 100 : NAN;
+		ret = emit_values(t, ctx, SR_MQ_DUTY_CYCLE, SR_UNIT_PERCENTAGE);
+	}
+	if (ret == SR_OK && ctx->samplerate) {
+		for (i = 0; i < ctx->num_channels; i++)
+			ctx->values[i] = timing[i].periods
+				? timing[i].high / ctx->samplerate : NAN;
+		ret = emit_values(t, ctx, SR_MQ_PULSE_WIDTH, SR_UNIT_SECOND);
+	}
+	g_free(timing);
+
+	sr_logic_edges_clear(ctx->edges, KEEP_EDGES);
+	ctx->samples = 0;
+	ctx->since_us = g_get_monotonic_time();
+
+	return ret;
+}
+
+static int receive_logic(const struct sr_transform *t, struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
+	gboolean due;
+	int ret;
+
+	if (!ctx->passthrough)
+		*packet_out = NULL;
+	if (!ctx->edges)
+		return SR_OK;
+
+	if ((ret = sr_logic_edges_feed(ctx->edges, packet_in)) != SR_OK) {
+		sr_err("Cannot collect the edges of the logic data.");
+		return ret;
+	}
+	if (packet_in->type == SR_DF_LOGIC) {
+		logic = packet_in->payload;
+		ctx->samples += logic->length / logic->unitsize;
+	} else {
+		rle = packet_in->payload;
+		ctx->samples += rle->num_samples;
+	}
+
+	due = ctx->interval_samples && ctx->samples >= ctx->interval_samples;
+	due |= ctx->interval_us
+		&& g_get_monotonic_time() - ctx->since_us >= ctx->interval_us;
+	if (due)
+		return timing_summary(t, ctx);
+
+	return SR_OK;
+}
+
+static void receive_meta(struct context *ctx,
+		const struct sr_datafeed_meta *meta)
+{
+	const struct sr_config *src;
+	GSList *l;
+
+	for (l = meta->config; l; l = l->next) {
+		src = l->data;
+		if (src->key == SR_CONF_SAMPLERATE)
+			ctx->samplerate = g_variant_get_uint64(src->data);
+	}
+}
+
+/* Send the timing of the stream's remainder, followed by its end. */
+static int receive_end(const struct sr_transform *t, struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	int ret;
+
+	if ((ret = timing_summary(t, ctx)) != SR_OK)
+		return ret;
+	*packet_out = NULL;
+
+	return sr_transform_emit(t, packet_in);
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	/* By default pass the packet on unmodified. */
+	*packet_out = packet_in;
+
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+		return receive_header(t, ctx);
+	case SR_DF_META:
+		receive_meta(ctx, packet_in->payload);
+		break;
+	case SR_DF_LOGIC:
+	case SR_DF_LOGIC_RLE:
+		return receive_logic(t, ctx, packet_in, packet_out);
+	case SR_DF_END:
+		return receive_end(t, ctx, packet_in, packet_out);
+	default:
+		sr_spew("Unsupported packet type %d, ignoring.", packet_in->type);
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	sr_logic_edges_free(ctx->edges);
+	g_slist_free(ctx->channels);
+	g_free(ctx->values);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "interval_ms", "Interval", "Time in ms between measurements, 0 for none", NULL, NULL },
+	{ "samples", "Samples", "Samples between measurements, 0 for no limit", NULL, NULL },
+	{ "passthrough", "Pass-through", "Pass the logic data on, along with the measurements", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_uint32(1000));
+		options[1].def = g_variant_ref_sink(g_variant_new_uint64(0));
+		options[2].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_timing = {
+	.id = "timing",
+	.name = "Timing",
+	.desc = "Frequency, duty cycle and pulse width of logic channels",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
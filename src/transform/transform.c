@@ -45,12 +45,24 @@
 extern SR_PRIV struct sr_transform_module transform_nop;
 extern SR_PRIV struct sr_transform_module transform_scale;
 extern SR_PRIV struct sr_transform_module transform_invert;
+extern SR_PRIV struct sr_transform_module transform_decimate;
+extern SR_PRIV struct sr_transform_module transform_filter;
+extern SR_PRIV struct sr_transform_module transform_stats;
+extern SR_PRIV struct sr_transform_module transform_timing;
+extern SR_PRIV struct sr_transform_module transform_compact;
+extern SR_PRIV struct sr_transform_module transform_resample;
 /** @endcond */
 
 static const struct sr_transform_module *transform_module_list[] = {
 	&transform_nop,
 	&transform_scale,
 	&transform_invert,
+	&transform_decimate,
+	&transform_filter,
+	&transform_stats,
+	&transform_timing,
+	&transform_compact,
+	&transform_resample,
 	NULL,
 };
 
@@ -208,9 +220,10 @@ SR_API const struct sr_transform *sr_transform_new(const struct sr_transform_mod
 	gpointer key, value;
 	int i;
 
-	t = g_malloc(sizeof(struct sr_transform));
+	t = g_malloc0(sizeof(struct sr_transform));
 	t->module = tmod;
 	t->sdi = sdi;
+	t->buffers = &sdi->session->transform_buffers;
 
 	new_opts = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
 			(GDestroyNotify)g_variant_unref);
@@ -264,6 +277,40 @@ SR_API const struct sr_transform *sr_transform_new(const struct sr_transform_mod
 	return t;
 }
 
+/**
+ * Run a transform in a pipeline stage of its own.
+ *
+ * A threaded transform gets its own worker thread while the session
+ * runs. It takes packets from a bounded queue, and passes its output on
+ * to the following transforms, which run in the same thread up to the
+ * next threaded transform. Datafeed callbacks get invoked from the last
+ * stage's thread. The packet order is kept, including meta and trigger
+ * packets. Packets get copied between stages.
+ *
+ * @param t The transform instance. Must not be NULL.
+ * @param threaded TRUE to run the transform in its own stage.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_transform_threaded_set(const struct sr_transform *t,
+		gboolean threaded)
+{
+	if (!t)
+		return SR_ERR_ARG;
+
+	if (t->sdi->session->running) {
+		sr_err("Cannot change the stages of a running session.");
+		return SR_ERR;
+	}
+	((struct sr_transform *)t)->threaded = threaded;
+
+	return SR_OK;
+}
+
 /**
  * Free the specified transform instance and all associated resources.
  *
@@ -271,6 +318,7 @@ SR_API const struct sr_transform *sr_transform_new(const struct sr_transform_mod
  */
 SR_API int sr_transform_free(const struct sr_transform *t)
 {
+	struct sr_datafeed_packet *emitted;
 	int ret;
 
 	if (!t)
@@ -279,6 +327,8 @@ SR_API int sr_transform_free(const struct sr_transform *t)
 	ret = SR_OK;
 	if (t->module->cleanup)
 		ret = t->module->cleanup((struct sr_transform *)t);
+	while ((emitted = g_queue_pop_head(&((struct sr_transform *)t)->emitted)))
+		sr_packet_free(emitted);
 	g_free((gpointer)t);
 
 	return ret;
@@ -0,0 +1,424 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Several devices send logic data as "bit planes": a word of samples
+ * for one channel, followed by a word of samples for the next enabled
+ * channel, and so on. The session feed wants one bit per channel in
+ * each sample instead. Converting between the two is a transpose of a
+ * bit matrix, which is done here for up to 16 channels and words of up
+ * to 64 samples, 8x8 bits at a time (or 16x8 bits at a time with SSE2).
+ * The reverse direction, samples to planes, serves output modules which
+ * render each channel on a line of its own.
+ *
+ * The public routines convert whole logic packets to one plane per
+ * channel and back, for consumers which work on one channel at a time.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transpose"
+
+#if !defined(WORDS_BIGENDIAN) && defined(__GNUC__) && defined(__x86_64__)
+#define TRANSPOSE_SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/**
+ * Prepare the conversion of bit planes to samples.
+ *
+ * Each block of input data carries one word per enabled channel, in
+ * the order of ascending channel index. The sample bit which a word
+ * contributes to is the channel's bit position in the mask.
+ *
+ * @param[out] tp The conversion state to fill in. Converts nothing
+ *            when the other arguments are invalid.
+ * @param[in] channel_mask The mask of enabled channels, non-zero.
+ * @param[in] word_size The number of bytes in a word, 1 to 8.
+ * @param[in] msb_first Whether the first sample of a word is in its
+ *            most significant bit (else in the least significant bit).
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ */
+SR_PRIV int sr_transpose_init(struct sr_transpose *tp, uint16_t channel_mask,
+	size_t word_size, gboolean msb_first)
+{
+	size_t bit;
+
+	if (!tp)
+		return SR_ERR_ARG;
+	memset(tp, 0, sizeof(*tp));
+	if (!channel_mask || !word_size || word_size > sizeof(uint64_t))
+		return SR_ERR_ARG;
+
+	tp->word_size = word_size;
+	tp->msb_first = msb_first;
+	for (bit = 0; bit < 16; bit++) {
+		if (!(channel_mask & (1U << bit)))
+			continue;
+		tp->plane_bit[tp->plane_count++] = bit;
+	}
+	tp->block_size = tp->plane_count * word_size;
+	tp->high_channels = channel_mask >= 0x100;
+
+	return SR_OK;
+}
+
+static inline uint64_t read_plane(const uint8_t *p, size_t size)
+{
+	uint64_t word;
+
+	if (size == sizeof(uint64_t))
+		return RL64(p);
+	if (size == sizeof(uint32_t))
+		return RL32(p);
+
+	word = 0;
+	while (size--)
+		word = (word << 8) | p[size];
+
+	return word;
+}
+
+/*
+ * Transpose an 8x8 bit matrix. Bit c of byte r becomes bit r of
+ * byte c. See "Hacker's Delight", section 7-3.
+ */
+static inline uint64_t transpose8x8(uint64_t x)
+{
+	uint64_t t;
+
+	t = (x ^ (x >> 7)) & UINT64_C(0x00aa00aa00aa00aa);
+	x ^= t ^ (t << 7);
+	t = (x ^ (x >> 14)) & UINT64_C(0x0000cccc0000cccc);
+	x ^= t ^ (t << 14);
+	t = (x ^ (x >> 28)) & UINT64_C(0x00000000f0f0f0f0);
+	x ^= t ^ (t << 28);
+
+	return x;
+}
+
+#ifdef TRANSPOSE_SIMD_SSE2
+
+/*
+ * Transpose 16 planes of 8 bytes each. Byte lane j of the result holds
+ * byte j of all planes, byte k in the lane is from plane k. The most
+ * significant bits of the 16 bytes then form one sample.
+ */
+static void transpose_planes(const struct sr_transpose *tp,
+	const uint64_t *planes, uint16_t *dst, ptrdiff_t step)
+{
+	__m128i r[8], t[8], u[8], v[8], x[8];
+	size_t idx, lanes, lane;
+	int bit;
+
+	for (idx = 0; idx < 8; idx++)
+		r[idx] = _mm_set_epi64x(planes[idx + 8], planes[idx]);
+	for (idx = 0; idx < 8; idx += 2) {
+		t[idx + 0] = _mm_unpacklo_epi8(r[idx], r[idx + 1]);
+		t[idx + 1] = _mm_unpackhi_epi8(r[idx], r[idx + 1]);
+	}
+	for (idx = 0; idx < 8; idx += 4) {
+		u[idx + 0] = _mm_unpacklo_epi16(t[idx + 0], t[idx + 2]);
+		u[idx + 1] = _mm_unpackhi_epi16(t[idx + 0], t[idx + 2]);
+		u[idx + 2] = _mm_unpacklo_epi16(t[idx + 1], t[idx + 3]);
+		u[idx + 3] = _mm_unpackhi_epi16(t[idx + 1], t[idx + 3]);
+	}
+	for (idx = 0; idx < 4; idx++) {
+		v[2 * idx + 0] = _mm_unpacklo_epi32(u[idx], u[idx + 4]);
+		v[2 * idx + 1] = _mm_unpackhi_epi32(u[idx], u[idx + 4]);
+	}
+	for (idx = 0; idx < 4; idx++) {
+		x[2 * idx + 0] = _mm_unpacklo_epi64(v[idx], v[idx + 4]);
+		x[2 * idx + 1] = _mm_unpackhi_epi64(v[idx], v[idx + 4]);
+	}
+
+	lanes = tp->word_size;
+	for (lane = 0; lane < lanes; lane++) {
+		for (bit = 7; bit >= 0; bit--) {
+			dst[(ptrdiff_t)(8 * lane + bit) * step] =
+				_mm_movemask_epi8(x[lane]);
+			x[lane] = _mm_add_epi8(x[lane], x[lane]);
+		}
+	}
+}
+
+#else
+
+static inline uint64_t gather_lane(const uint64_t *planes, size_t lane)
+{
+	uint64_t x;
+	size_t row;
+
+	x = 0;
+	for (row = 0; row < 8; row++)
+		x |= ((planes[row] >> (8 * lane)) & 0xff) << (8 * row);
+
+	return x;
+}
+
+static void transpose_planes(const struct sr_transpose *tp,
+	const uint64_t *planes, uint16_t *dst, ptrdiff_t step)
+{
+	uint64_t lo, hi;
+	size_t lane, bit;
+
+	for (lane = 0; lane < tp->word_size; lane++) {
+		lo = transpose8x8(gather_lane(&planes[0], lane));
+		hi = 0;
+		if (tp->high_channels)
+			hi = transpose8x8(gather_lane(&planes[8], lane));
+		for (bit = 0; bit < 8; bit++) {
+			dst[(ptrdiff_t)(8 * lane + bit) * step] =
+				(lo & 0xff) | ((hi & 0xff) << 8);
+			lo >>= 8;
+			hi >>= 8;
+		}
+	}
+}
+
+#endif
+
+/**
+ * Convert blocks of bit planes to samples.
+ *
+ * Every complete block in the input data results in (8 * word_size)
+ * samples of 16 bits each. An incomplete block at the end of the
+ * input data is not converted, callers which receive data in pieces
+ * need to keep it for later.
+ *
+ * @param[in] tp The conversion state, see sr_transpose_init().
+ * @param[in] src The input data.
+ * @param[in] length The number of bytes in the input data.
+ * @param[out] dst The output buffer for the samples.
+ *
+ * @returns The number of samples which were written to the output.
+ */
+SR_PRIV size_t sr_transpose_blocks(const struct sr_transpose *tp,
+	const uint8_t *src, size_t length, uint16_t *dst)
+{
+	uint64_t planes[16];
+	size_t samples, block_samples, idx;
+	uint16_t *block_dst;
+	ptrdiff_t step;
+
+	if (!tp || !tp->block_size || !src || !dst)
+		return 0;
+
+	memset(planes, 0, sizeof(planes));
+	block_samples = 8 * tp->word_size;
+	step = tp->msb_first ? -1 : +1;
+	samples = 0;
+	while (length >= tp->block_size) {
+		for (idx = 0; idx < tp->plane_count; idx++) {
+			planes[tp->plane_bit[idx]] = read_plane(src, tp->word_size);
+			src += tp->word_size;
+		}
+		length -= tp->block_size;
+		block_dst = dst;
+		if (tp->msb_first)
+			block_dst += block_samples - 1;
+		transpose_planes(tp, planes, block_dst, step);
+		dst += block_samples;
+		samples += block_samples;
+	}
+
+	return samples;
+}
+
+/**
+ * Convert up to 8 samples to bit planes.
+ *
+ * Bit i of plane c is channel c of sample i. Sample bits of missing
+ * samples (when count is less than 8) are zero.
+ *
+ * @param[in] src The samples.
+ * @param[in] unitsize The number of bytes per sample.
+ * @param[in] count The number of samples, 1 to 8.
+ * @param[in] bytes The number of sample bytes to convert, at most
+ *            unitsize. Starts at the first byte of the sample.
+ * @param[out] planes The output buffer for (8 * bytes) planes.
+ */
+SR_PRIV void sr_transpose_samples(const uint8_t *src, size_t unitsize,
+	size_t count, size_t bytes, uint8_t *planes)
+{
+	uint64_t x;
+	size_t byte, row, bit;
+
+	for (byte = 0; byte < bytes; byte++) {
+		x = 0;
+		for (row = 0; row < count; row++)
+			x |= (uint64_t)src[row * unitsize + byte] << (8 * row);
+		x = transpose8x8(x);
+		for (bit = 0; bit < 8; bit++) {
+			*planes++ = x & 0xff;
+			x >>= 8;
+		}
+	}
+}
+
+/**
+ * Get the size of a bit plane, see sr_logic_to_planes().
+ *
+ * The size is rounded up to whole 64-bit words, so that consumers can
+ * scan planes a word at a time.
+ *
+ * @param[in] num_samples The number of samples.
+ *
+ * @return The number of bytes per plane.
+ *
+ * @since 0.6.0
+ */
+SR_API size_t sr_logic_plane_size(uint64_t num_samples)
+{
+	return (num_samples + 63) / 64 * sizeof(uint64_t);
+}
+
+/**
+ * Convert logic data to bit planes, one per channel.
+ *
+ * Plane c holds the samples of channel c, the channel in bit c of the
+ * samples. Sample i is bit (i % 8) of byte (i / 8) of its plane, so
+ * that plane bytes read as little endian words have sample i in bit
+ * (i % 64) of word (i / 64). Padding bits at the end of the planes are
+ * zero.
+ *
+ * @param[in] logic The logic data.
+ * @param[out] planes The output buffer for (8 * unitsize) planes of
+ *                    plane_size bytes each.
+ * @param[in] plane_size The number of bytes per plane, at least one bit
+ *                       per sample. See sr_logic_plane_size().
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_to_planes(const struct sr_datafeed_logic *logic,
+	uint8_t *planes, size_t plane_size)
+{
+	const uint8_t *data;
+	uint8_t *out;
+	uint64_t num_samples, x, i;
+	size_t unitsize, byte, row, count, used;
+	int bit;
+
+	if (!logic || !logic->unitsize || !planes)
+		return SR_ERR_ARG;
+	unitsize = logic->unitsize;
+	num_samples = logic->length / unitsize;
+	if (plane_size < (num_samples + 7) / 8)
+		return SR_ERR_ARG;
+
+	data = logic->data;
+	used = (num_samples + 7) / 8;
+	for (byte = 0; byte < unitsize; byte++) {
+		out = planes + 8 * byte * plane_size;
+		i = 0;
+#ifdef TRANSPOSE_SIMD_SSE2
+		/* The most significant bits of 16 sample bytes at a time. */
+		for (; i + 16 <= num_samples; i += 16) {
+			__m128i v;
+			uint8_t column[16];
+			int mask;
+
+			if (unitsize == 1) {
+				v = _mm_loadu_si128((const __m128i *)(data + i));
+			} else {
+				for (row = 0; row < 16; row++)
+					column[row] = data[(i + row) * unitsize + byte];
+				v = _mm_loadu_si128((const __m128i *)column);
+			}
+			for (bit = 7; bit >= 0; bit--) {
+				mask = _mm_movemask_epi8(v);
+				out[bit * plane_size + i / 8] = mask & 0xff;
+				out[bit * plane_size + i / 8 + 1] = mask >> 8;
+				v = _mm_add_epi8(v, v);
+			}
+		}
+#endif
+		for (; i < num_samples; i += 8) {
+			count = MIN(8, num_samples - i);
+			x = 0;
+			for (row = 0; row < count; row++)
+				x |= (uint64_t)data[(i + row) * unitsize + byte]
+					<< (8 * row);
+			x = transpose8x8(x);
+			for (bit = 0; bit < 8; bit++) {
+				out[bit * plane_size + i / 8] = x & 0xff;
+				x >>= 8;
+			}
+		}
+		for (bit = 0; bit < 8; bit++)
+			memset(out + bit * plane_size + used, 0, plane_size - used);
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Convert bit planes to logic data, the reverse of sr_logic_to_planes().
+ *
+ * @param[in] planes The (8 * unitsize) planes of plane_size bytes each.
+ * @param[in] plane_size The number of bytes per plane, at least one bit
+ *                       per sample.
+ * @param[in,out] logic The logic data to fill in. Its unitsize and
+ *                      length select the number of planes and samples,
+ *                      its data receives the samples.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_from_planes(const uint8_t *planes, size_t plane_size,
+	struct sr_datafeed_logic *logic)
+{
+	const uint8_t *in;
+	uint8_t *data;
+	uint64_t num_samples, x, i;
+	size_t unitsize, byte, row, count, bit;
+
+	if (!planes || !logic || !logic->unitsize || !logic->data)
+		return SR_ERR_ARG;
+	unitsize = logic->unitsize;
+	num_samples = logic->length / unitsize;
+	if (plane_size < (num_samples + 7) / 8)
+		return SR_ERR_ARG;
+
+	data = logic->data;
+	for (byte = 0; byte < unitsize; byte++) {
+		in = planes + 8 * byte * plane_size;
+		for (i = 0; i < num_samples; i += 8) {
+			x = 0;
+			for (bit = 0; bit < 8; bit++)
+				x |= (uint64_t)in[bit * plane_size + i / 8] << (8 * bit);
+			x = transpose8x8(x);
+			count = MIN(8, num_samples - i);
+			for (row = 0; row < count; row++)
+				data[(i + row) * unitsize + byte] = x >> (8 * row);
+		}
+	}
+
+	return SR_OK;
+}
@@ -178,4 +178,135 @@ SR_API int sr_trigger_match_add(struct sr_trigger_stage *stage,
 	return SR_OK;
 }
 
+
+/* Check whether the hardware can evaluate a stage on its own. */
+static gboolean stage_fits_hw(const struct sr_trigger_stage *stage,
+		const struct sr_trigger_caps *caps)
+{
+	const struct sr_trigger_match *match;
+	const GSList *l;
+	int edges;
+
+	if (!stage->matches)
+		return FALSE;
+
+	edges = 0;
+	for (l = stage->matches; l; l = l->next) {
+		match = l->data;
+		/* Drivers ignore disabled channels with a trigger. */
+		if (!match->channel->enabled)
+			continue;
+		if (match->channel->type != SR_CHANNEL_LOGIC)
+			return FALSE;
+		if (!(caps->matches & (1 << match->match)))
+			return FALSE;
+		if (match->match == SR_TRIGGER_RISING ||
+				match->match == SR_TRIGGER_FALLING ||
+				match->match == SR_TRIGGER_EDGE)
+			edges++;
+	}
+
+	return caps->max_edges < 0 || edges <= caps->max_edges;
+}
+
+/* Check whether the soft trigger engine can evaluate a trigger. */
+static gboolean trigger_fits_sw(const struct sr_trigger *trigger)
+{
+	const struct sr_trigger_stage *stage;
+	const struct sr_trigger_match *match;
+	const GSList *l, *m;
+
+	for (l = trigger->stages; l; l = l->next) {
+		stage = l->data;
+		if (!stage->matches)
+			return FALSE;
+		for (m = stage->matches; m; m = m->next) {
+			match = m->data;
+			if (match->channel->enabled &&
+					match->channel->type != SR_CHANNEL_LOGIC)
+				return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * Split a trigger into a part for the hardware and one for software.
+ *
+ * The longest prefix of the trigger's stages which the hardware trigger
+ * engine can evaluate (according to its capabilities) goes to the
+ * hardware. When stages remain which the hardware cannot evaluate, the
+ * soft trigger engine checks the trigger as a whole on the data which
+ * follows the match of the hardware prefix. The hardware then skips the
+ * samples which cannot possibly match, and the host only inspects the
+ * few samples around each prefix match. Checking the whole trigger
+ * rather than only the remaining stages keeps the match semantics of
+ * the soft trigger: when the remaining stages fail, the next match
+ * might start in the data which follows.
+ *
+ * @param[in] trigger The trigger to split. Must not be NULL.
+ * @param[in] caps The capabilities of the hardware. Must not be NULL.
+ * @param[out] hw The stages for the hardware, as a new trigger which the
+ *                caller frees with sr_trigger_free(). NULL when the
+ *                hardware cannot evaluate the first stage.
+ * @param[out] sw TRUE when the soft trigger engine needs to check the
+ *                trigger after the hardware prefix matched.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The trigger needs a software check, which the soft
+ *                   trigger engine cannot do (non-logic matches).
+ *
+ * @private
+ */
+SR_PRIV int sr_trigger_plan(const struct sr_trigger *trigger,
+		const struct sr_trigger_caps *caps,
+		struct sr_trigger **hw, gboolean *sw)
+{
+	const struct sr_trigger_stage *stage;
+	const struct sr_trigger_match *match;
+	struct sr_trigger_stage *hw_stage;
+	const GSList *l, *m;
+	int count;
+
+	if (!trigger || !caps || !hw || !sw)
+		return SR_ERR_ARG;
+
+	*hw = NULL;
+	*sw = FALSE;
+
+	count = 0;
+	for (l = trigger->stages; l; l = l->next) {
+		stage = l->data;
+		if (count >= caps->max_stages || !stage_fits_hw(stage, caps))
+			break;
+		if (!*hw)
+			*hw = sr_trigger_new(trigger->name);
+		hw_stage = sr_trigger_stage_add(*hw);
+		for (m = stage->matches; m; m = m->next) {
+			match = m->data;
+			sr_trigger_match_add(hw_stage, match->channel,
+				match->match, match->value);
+		}
+		count++;
+	}
+
+	if (!l)
+		return SR_OK;
+
+	if (!trigger_fits_sw(trigger)) {
+		sr_err("Trigger stage %d is not supported by the hardware, "
+			"nor in software.", count);
+		sr_trigger_free(*hw);
+		*hw = NULL;
+		return SR_ERR_NA;
+	}
+	*sw = TRUE;
+	sr_dbg("Trigger: %d of %d stages in hardware, checking in software.",
+		count, g_slist_length(trigger->stages));
+
+	return SR_OK;
+}
+
 /** @} */
@@ -52,6 +52,9 @@ struct usb_source {
 	GPtrArray *pollfds;
 };
 
+/* USB event sources of sessions which currently exist. */
+static gint usb_sources_active;
+
 /** USB event source prepare() method.
  */
 static gboolean usb_source_prepare(GSource *source, int *timeout)
@@ -138,7 +141,9 @@ static gboolean usb_source_dispatch(GSource *source,
 		sr_err("Callback not set, cannot dispatch event.");
 		return G_SOURCE_REMOVE;
 	}
+	sr_trace(SR_TRACE_USB_DISPATCH, SR_TRACE_BEGIN, revents);
 	keep = (*SR_RECEIVE_DATA_CALLBACK(callback))(-1, revents, user_data);
+	sr_trace(SR_TRACE_USB_DISPATCH, SR_TRACE_END, revents);
 
 	if (G_LIKELY(keep) && G_LIKELY(!g_source_is_destroyed(source))) {
 		if (usource->timeout_us >= 0)
@@ -167,6 +172,7 @@ static void usb_source_finalize(GSource *source)
 
 	sr_session_source_destroyed(usource->session,
 			usource->usb_ctx, source);
+	g_atomic_int_add(&usb_sources_active, -1);
 }
 
 /** Callback invoked when a new libusb FD should be added to the poll set.
@@ -192,6 +198,7 @@ static LIBUSB_CALL void usb_pollfd_added(libusb_os_handle fd,
 
 	g_ptr_array_add(usource->pollfds, pollfd);
 	g_source_add_poll(&usource->base, pollfd);
+	sr_session_poll_sources_changed();
 }
 
 /** Callback invoked when a libusb FD should be removed from the poll set.
@@ -215,6 +222,7 @@ static LIBUSB_CALL void usb_pollfd_removed(libusb_os_handle fd, void *user_data)
 		if ((libusb_os_handle)pollfd->fd == fd) {
 			g_source_remove_poll(&usource->base, pollfd);
 			g_ptr_array_remove_index_fast(usource->pollfds, i - 1);
+			sr_session_poll_sources_changed();
 			return;
 		}
 	}
@@ -292,6 +300,7 @@ static GSource *usb_source_new(struct sr_session *session,
 #endif
 	libusb_set_pollfd_notifiers(usb_ctx,
 		&usb_pollfd_added, &usb_pollfd_removed, usource);
+	g_atomic_int_inc(&usb_sources_active);
 
 	return source;
 }
@@ -379,6 +388,450 @@ SR_PRIV int sr_usb_split_conn(const char *conn,
 	return valid ? SR_OK : SR_ERR_ARG;
 }
 
+/*
+ * Device list snapshots of libusb contexts, which concurrent scans of
+ * several drivers share. The list gets enumerated on first use.
+ */
+struct usb_devlist_cache {
+	libusb_context *usb_ctx;
+	int users;
+	libusb_device **list;
+	ssize_t count;
+};
+
+static GMutex devlist_cache_mutex;
+static GSList *devlist_caches;
+
+static struct usb_devlist_cache *devlist_cache_find(libusb_context *usb_ctx)
+{
+	struct usb_devlist_cache *cache;
+	GSList *l;
+
+	for (l = devlist_caches; l; l = l->next) {
+		cache = l->data;
+		if (cache->usb_ctx == usb_ctx)
+			return cache;
+	}
+
+	return NULL;
+}
+
+/**
+ * Share one device list of a libusb context, until the matching call
+ * to sr_usb_devlist_cache_end(). Calls can nest.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_devlist_cache_begin(libusb_context *usb_ctx)
+{
+	struct usb_devlist_cache *cache;
+
+	g_mutex_lock(&devlist_cache_mutex);
+	if (!(cache = devlist_cache_find(usb_ctx))) {
+		cache = g_malloc0(sizeof(*cache));
+		cache->usb_ctx = usb_ctx;
+		devlist_caches = g_slist_prepend(devlist_caches, cache);
+	}
+	cache->users++;
+	g_mutex_unlock(&devlist_cache_mutex);
+}
+
+/** @private */
+SR_PRIV void sr_usb_devlist_cache_end(libusb_context *usb_ctx)
+{
+	struct usb_devlist_cache *cache;
+
+	g_mutex_lock(&devlist_cache_mutex);
+	cache = devlist_cache_find(usb_ctx);
+	if (cache && !--cache->users) {
+		devlist_caches = g_slist_remove(devlist_caches, cache);
+		if (cache->list)
+			libusb_free_device_list(cache->list, 1);
+		g_free(cache);
+	}
+	g_mutex_unlock(&devlist_cache_mutex);
+}
+
+/*
+ * Registries of the USB devices of libusb contexts, where libusb
+ * supports hotplug events. The registry gets filled once, and hotplug
+ * events keep it up to date, so that scans need not enumerate the bus
+ * over and over again. Lookups by VID:PID and by bus.address are
+ * indexed, each device's descriptor and port path are kept.
+ */
+struct usb_registry_entry {
+	libusb_device *dev;
+	struct libusb_device_descriptor des;
+	uint8_t bus, address;
+	/* The port path, determined on first use. */
+	char *port_path;
+};
+
+struct usb_registry {
+	libusb_context *usb_ctx;
+	libusb_hotplug_callback_handle handle;
+	/* In the order of arrival. */
+	GPtrArray *entries;
+	/* VID << 16 | PID to a GSList of entries, which the table owns. */
+	GHashTable *by_id;
+	/* bus << 8 | address to the entry. */
+	GHashTable *by_addr;
+	/* libusb_device to the entry. */
+	GHashTable *by_dev;
+};
+
+static GMutex registry_mutex;
+static GSList *registries;
+
+#define REGISTRY_ID_KEY(vid, pid) GUINT_TO_POINTER((guint)(vid) << 16 | (pid))
+#define REGISTRY_ADDR_KEY(bus, addr) GUINT_TO_POINTER((guint)(bus) << 8 | (addr))
+
+static struct usb_registry *registry_find(libusb_context *usb_ctx)
+{
+	struct usb_registry *reg;
+	GSList *l;
+
+	for (l = registries; l; l = l->next) {
+		reg = l->data;
+		if (reg->usb_ctx == usb_ctx)
+			return reg;
+	}
+
+	return NULL;
+}
+
+static void registry_entry_free(void *p)
+{
+	struct usb_registry_entry *entry;
+
+	entry = p;
+	libusb_unref_device(entry->dev);
+	g_free(entry->port_path);
+	g_free(entry);
+}
+
+static void registry_destroy(struct usb_registry *reg)
+{
+	GHashTableIter iter;
+	gpointer list;
+
+	g_hash_table_iter_init(&iter, reg->by_id);
+	while (g_hash_table_iter_next(&iter, NULL, &list))
+		g_slist_free(list);
+	g_hash_table_destroy(reg->by_id);
+	g_hash_table_destroy(reg->by_addr);
+	g_hash_table_destroy(reg->by_dev);
+	g_ptr_array_unref(reg->entries);
+	g_free(reg);
+}
+
+/* Called with the registry mutex held. */
+static void registry_add(struct usb_registry *reg, libusb_device *dev)
+{
+	struct usb_registry_entry *entry;
+	GSList *list;
+	gpointer key;
+
+	if (g_hash_table_contains(reg->by_dev, dev))
+		return;
+
+	entry = g_malloc0(sizeof(*entry));
+	if (libusb_get_device_descriptor(dev, &entry->des) != 0) {
+		g_free(entry);
+		return;
+	}
+	entry->dev = libusb_ref_device(dev);
+	entry->bus = libusb_get_bus_number(dev);
+	entry->address = libusb_get_device_address(dev);
+
+	g_ptr_array_add(reg->entries, entry);
+	key = REGISTRY_ID_KEY(entry->des.idVendor, entry->des.idProduct);
+	list = g_hash_table_lookup(reg->by_id, key);
+	g_hash_table_insert(reg->by_id, key, g_slist_append(list, entry));
+	g_hash_table_insert(reg->by_addr,
+		REGISTRY_ADDR_KEY(entry->bus, entry->address), entry);
+	g_hash_table_insert(reg->by_dev, dev, entry);
+}
+
+/* Called with the registry mutex held. */
+static void registry_remove(struct usb_registry *reg, libusb_device *dev)
+{
+	struct usb_registry_entry *entry;
+	GSList *list;
+	gpointer key;
+
+	if (!(entry = g_hash_table_lookup(reg->by_dev, dev)))
+		return;
+
+	g_hash_table_remove(reg->by_dev, dev);
+	key = REGISTRY_ADDR_KEY(entry->bus, entry->address);
+	if (g_hash_table_lookup(reg->by_addr, key) == entry)
+		g_hash_table_remove(reg->by_addr, key);
+	key = REGISTRY_ID_KEY(entry->des.idVendor, entry->des.idProduct);
+	list = g_slist_remove(g_hash_table_lookup(reg->by_id, key), entry);
+	if (list)
+		g_hash_table_insert(reg->by_id, key, list);
+	else
+		g_hash_table_remove(reg->by_id, key);
+	/* Frees the entry. */
+	g_ptr_array_remove(reg->entries, entry);
+}
+
+static int LIBUSB_CALL registry_hotplug_cb(libusb_context *usb_ctx,
+		libusb_device *dev, libusb_hotplug_event event, void *user_data)
+{
+	struct usb_registry *reg;
+
+	(void)usb_ctx;
+
+	reg = user_data;
+	g_mutex_lock(&registry_mutex);
+	if (event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED)
+		registry_add(reg, dev);
+	else if (event == LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT)
+		registry_remove(reg, dev);
+	g_mutex_unlock(&registry_mutex);
+
+	return 0;
+}
+
+/*
+ * Deliver pending hotplug events. While sessions have USB event sources
+ * their event handling does that, and completes their transfers, which
+ * must not happen here.
+ */
+static void registry_update(struct usb_registry *reg)
+{
+	struct timeval tv;
+
+	if (g_atomic_int_get(&usb_sources_active))
+		return;
+
+	tv.tv_sec = 0;
+	tv.tv_usec = 0;
+	libusb_handle_events_timeout_completed(reg->usb_ctx, &tv, NULL);
+}
+
+/*
+ * Get the registry of a libusb context, after delivering pending hotplug
+ * events. Returns with the registry mutex held if there is a registry.
+ */
+static struct usb_registry *registry_get(libusb_context *usb_ctx)
+{
+	struct usb_registry *reg;
+
+	g_mutex_lock(&registry_mutex);
+	reg = registry_find(usb_ctx);
+	g_mutex_unlock(&registry_mutex);
+	if (!reg)
+		return NULL;
+
+	registry_update(reg);
+	g_mutex_lock(&registry_mutex);
+
+	return reg;
+}
+
+/**
+ * Start tracking the USB devices of a libusb context.
+ *
+ * Does nothing where libusb does not support hotplug events, lookups
+ * then enumerate the devices each time.
+ *
+ * @param[in] usb_ctx The libusb context.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_registry_init(libusb_context *usb_ctx)
+{
+	struct usb_registry *reg;
+	int ret;
+
+	if (!libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+		sr_dbg("No hotplug support, enumerating devices on demand.");
+		return;
+	}
+
+	reg = g_malloc0(sizeof(*reg));
+	reg->usb_ctx = usb_ctx;
+	reg->entries = g_ptr_array_new_with_free_func(registry_entry_free);
+	reg->by_id = g_hash_table_new(g_direct_hash, g_direct_equal);
+	reg->by_addr = g_hash_table_new(g_direct_hash, g_direct_equal);
+	reg->by_dev = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	g_mutex_lock(&registry_mutex);
+	registries = g_slist_prepend(registries, reg);
+	g_mutex_unlock(&registry_mutex);
+
+	/* Enumeration runs the callback for the present devices. */
+	ret = libusb_hotplug_register_callback(usb_ctx,
+		LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT,
+		LIBUSB_HOTPLUG_ENUMERATE, LIBUSB_HOTPLUG_MATCH_ANY,
+		LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+		registry_hotplug_cb, reg, &reg->handle);
+	if (ret != LIBUSB_SUCCESS) {
+		sr_warn("Cannot register for hotplug events: %s.",
+			libusb_error_name(ret));
+		g_mutex_lock(&registry_mutex);
+		registries = g_slist_remove(registries, reg);
+		g_mutex_unlock(&registry_mutex);
+		registry_destroy(reg);
+		return;
+	}
+	sr_dbg("Tracking %u USB devices.", reg->entries->len);
+}
+
+/**
+ * Stop tracking the USB devices of a libusb context.
+ *
+ * @param[in] usb_ctx The libusb context.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_registry_free(libusb_context *usb_ctx)
+{
+	struct usb_registry *reg;
+
+	g_mutex_lock(&registry_mutex);
+	reg = registry_find(usb_ctx);
+	g_mutex_unlock(&registry_mutex);
+	if (!reg)
+		return;
+
+	libusb_hotplug_deregister_callback(usb_ctx, reg->handle);
+
+	g_mutex_lock(&registry_mutex);
+	registries = g_slist_remove(registries, reg);
+	g_mutex_unlock(&registry_mutex);
+	registry_destroy(reg);
+}
+
+/* Copy the devices of registry entries to a list, with references. */
+static libusb_device **registry_devlist(GPtrArray *entries)
+{
+	struct usb_registry_entry *entry;
+	libusb_device **list;
+	guint i;
+
+	list = g_malloc((entries->len + 1) * sizeof(*list));
+	for (i = 0; i < entries->len; i++) {
+		entry = entries->pdata[i];
+		list[i] = libusb_ref_device(entry->dev);
+	}
+	list[i] = NULL;
+
+	return list;
+}
+
+/**
+ * Get the list of USB devices, like libusb_get_device_list() does.
+ *
+ * Returns the devices of the context's registry where libusb supports
+ * hotplug events, see sr_usb_registry_init(). Otherwise returns the
+ * shared snapshot while a device list cache is active, see
+ * sr_usb_devlist_cache_begin(). Scans which expect devices to come
+ * back after a firmware upload then need to call libusb directly.
+ *
+ * @param[in] usb_ctx The libusb context.
+ * @param[out] list The NULL terminated list of referenced devices, NULL
+ *            on errors. Release it with sr_usb_free_device_list().
+ *
+ * @return The number of devices, or a negative libusb error code.
+ *
+ * @private
+ */
+SR_PRIV ssize_t sr_usb_get_device_list(libusb_context *usb_ctx,
+	libusb_device ***list)
+{
+	struct usb_devlist_cache *cache;
+	struct usb_registry *reg;
+	libusb_device **devlist;
+	ssize_t count, i;
+
+	if ((reg = registry_get(usb_ctx))) {
+		*list = registry_devlist(reg->entries);
+		count = reg->entries->len;
+		g_mutex_unlock(&registry_mutex);
+		return count;
+	}
+
+	g_mutex_lock(&devlist_cache_mutex);
+	cache = devlist_cache_find(usb_ctx);
+	if (cache && !cache->list) {
+		cache->count = libusb_get_device_list(usb_ctx, &cache->list);
+		if (cache->count < 0)
+			cache->list = NULL;
+	}
+	if (cache && cache->list) {
+		count = cache->count;
+		*list = g_malloc((count + 1) * sizeof(**list));
+		for (i = 0; i < count; i++)
+			(*list)[i] = libusb_ref_device(cache->list[i]);
+		(*list)[count] = NULL;
+		g_mutex_unlock(&devlist_cache_mutex);
+		return count;
+	}
+	g_mutex_unlock(&devlist_cache_mutex);
+
+	count = libusb_get_device_list(usb_ctx, &devlist);
+	if (count < 0) {
+		*list = NULL;
+		return count;
+	}
+	/* Keep the references, in a list which is ours to free. */
+	*list = g_malloc((count + 1) * sizeof(**list));
+	memcpy(*list, devlist, count * sizeof(**list));
+	(*list)[count] = NULL;
+	libusb_free_device_list(devlist, 0);
+
+	return count;
+}
+
+/** @private */
+SR_PRIV void sr_usb_free_device_list(libusb_device **list)
+{
+	size_t i;
+
+	if (!list)
+		return;
+
+	for (i = 0; list[i]; i++)
+		libusb_unref_device(list[i]);
+	g_free(list);
+}
+
+/* Called with the registry mutex held. */
+static GSList *registry_find_conn(struct usb_registry *reg,
+	uint16_t vid, uint16_t pid, uint8_t bus, uint8_t addr)
+{
+	struct usb_registry_entry *entry;
+	GSList *l, *candidates, *devices;
+
+	if (vid && pid) {
+		candidates = g_slist_copy(g_hash_table_lookup(reg->by_id,
+			REGISTRY_ID_KEY(vid, pid)));
+	} else {
+		entry = g_hash_table_lookup(reg->by_addr,
+			REGISTRY_ADDR_KEY(bus, addr));
+		candidates = entry ? g_slist_prepend(NULL, entry) : NULL;
+	}
+
+	devices = NULL;
+	for (l = candidates; l; l = l->next) {
+		entry = l->data;
+		if (bus && addr && (entry->bus != bus || entry->address != addr))
+			continue;
+		sr_dbg("Found USB device (VID:PID = %04x:%04x, bus.address = "
+		       "%d.%d).", entry->des.idVendor, entry->des.idProduct,
+		       entry->bus, entry->address);
+		devices = g_slist_append(devices,
+			sr_usb_dev_inst_new(entry->bus, entry->address, NULL));
+	}
+	g_slist_free(candidates);
+
+	return devices;
+}
+
 /**
  * Find USB devices according to a connection string.
  *
@@ -392,6 +845,7 @@ SR_PRIV int sr_usb_split_conn(const char *conn,
  */
 SR_PRIV GSList *sr_usb_find(libusb_context *usb_ctx, const char *conn)
 {
+	struct usb_registry *reg;
 	struct sr_usb_dev_inst *usb;
 	struct libusb_device **devlist;
 	struct libusb_device_descriptor des;
@@ -411,8 +865,17 @@ SR_PRIV GSList *sr_usb_find(libusb_context *usb_ctx, const char *conn)
 	}
 
 	/* Looks like a valid USB device specification, but is it connected? */
+	if ((reg = registry_get(usb_ctx))) {
+		devices = registry_find_conn(reg, vid, pid, bus, addr);
+		g_mutex_unlock(&registry_mutex);
+		return devices;
+	}
 	devices = NULL;
-	libusb_get_device_list(usb_ctx, &devlist);
+	if ((ret = sr_usb_get_device_list(usb_ctx, &devlist)) < 0) {
+		sr_err("Failed to retrieve device list: %s.",
+		       libusb_error_name(ret));
+		return NULL;
+	}
 	for (i = 0; devlist[i]; i++) {
 		if ((ret = libusb_get_device_descriptor(devlist[i], &des))) {
 			sr_err("Failed to get device descriptor: %s.",
@@ -434,7 +897,7 @@ SR_PRIV GSList *sr_usb_find(libusb_context *usb_ctx, const char *conn)
 		usb = sr_usb_dev_inst_new(b, a, NULL);
 		devices = g_slist_append(devices, usb);
 	}
-	libusb_free_device_list(devlist, 1);
+	sr_usb_free_device_list(devlist);
 
 	/* No log message for #devices found (caller will log that). */
 
@@ -443,12 +906,38 @@ SR_PRIV GSList *sr_usb_find(libusb_context *usb_ctx, const char *conn)
 
 SR_PRIV int sr_usb_open(libusb_context *usb_ctx, struct sr_usb_dev_inst *usb)
 {
+	struct usb_registry *reg;
+	struct usb_registry_entry *entry;
+	libusb_device *dev;
 	struct libusb_device **devlist;
 	struct libusb_device_descriptor des;
 	int ret, r, cnt, i, a, b;
 
 	sr_dbg("Trying to open USB device %d.%d.", usb->bus, usb->address);
 
+	if ((reg = registry_get(usb_ctx))) {
+		entry = g_hash_table_lookup(reg->by_addr,
+			REGISTRY_ADDR_KEY(usb->bus, usb->address));
+		dev = entry ? libusb_ref_device(entry->dev) : NULL;
+		if (entry)
+			des = entry->des;
+		g_mutex_unlock(&registry_mutex);
+		/* Not (yet) known devices take the enumeration below. */
+		if (dev) {
+			r = libusb_open(dev, &usb->devhdl);
+			libusb_unref_device(dev);
+			if (r < 0) {
+				sr_err("Failed to open device: %s.",
+				       libusb_error_name(r));
+				return SR_ERR;
+			}
+			sr_dbg("Opened USB device (VID:PID = %04x:%04x, "
+			       "bus.address = %d.%d).", des.idVendor,
+			       des.idProduct, usb->bus, usb->address);
+			return SR_OK;
+		}
+	}
+
 	if ((cnt = libusb_get_device_list(usb_ctx, &devlist)) < 0) {
 		sr_err("Failed to retrieve device list: %s.",
 		       libusb_error_name(cnt));
@@ -516,7 +1005,7 @@ SR_PRIV int usb_source_remove(struct sr_session *session, struct sr_context *ctx
 	return sr_session_source_remove_internal(session, ctx->libusb_ctx);
 }
 
-SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len)
+static int usb_read_port_path(libusb_device *dev, char *path, int path_len)
 {
 	uint8_t port_numbers[8];
 	int i, n, len;
@@ -555,6 +1044,50 @@ SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len)
 	return SR_OK;
 }
 
+/*
+ * Get the port path of a device, like "usb/1-2.3". The port paths of
+ * registry devices get determined once.
+ */
+SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len)
+{
+	struct usb_registry_entry *entry;
+	struct usb_registry *reg;
+	char buf[64];
+	GSList *l;
+	int ret;
+
+	g_mutex_lock(&registry_mutex);
+	entry = NULL;
+	for (l = registries; l && !entry; l = l->next) {
+		reg = l->data;
+		entry = g_hash_table_lookup(reg->by_dev, dev);
+	}
+	if (entry && entry->port_path) {
+		g_strlcpy(path, entry->port_path, path_len);
+		g_mutex_unlock(&registry_mutex);
+		return SR_OK;
+	}
+	g_mutex_unlock(&registry_mutex);
+	if (!entry)
+		return usb_read_port_path(dev, path, path_len);
+
+	if ((ret = usb_read_port_path(dev, buf, sizeof(buf))) != SR_OK)
+		return ret;
+	g_strlcpy(path, buf, path_len);
+
+	/* The entry might have left meanwhile. */
+	g_mutex_lock(&registry_mutex);
+	for (l = registries; l; l = l->next) {
+		reg = l->data;
+		entry = g_hash_table_lookup(reg->by_dev, dev);
+		if (entry && !entry->port_path)
+			entry->port_path = g_strdup(buf);
+	}
+	g_mutex_unlock(&registry_mutex);
+
+	return SR_OK;
+}
+
 /**
  * Check the USB configuration to determine if this device has a given
  * manufacturer and product string.
@@ -598,3 +1131,664 @@ SR_PRIV gboolean usb_match_manuf_prod(libusb_device *dev,
 
 	return ret;
 }
+
+/*
+ * Identify a device for records of uploaded FPGA bitstreams. USB devices
+ * get a new address when they (re-)enumerate, which they do after power
+ * loss or a firmware upload, and which invalidates all earlier records.
+ */
+static char *fpga_bitstream_key(const struct sr_dev_inst *sdi)
+{
+	const struct sr_usb_dev_inst *usb;
+
+	usb = sdi->conn;
+
+	return g_strdup_printf("%s/%d.%d/%s", sdi->driver->name,
+		usb->bus, usb->address, sdi->serial_num ? sdi->serial_num : "");
+}
+
+/**
+ * Check whether a device still runs an FPGA bitstream which was uploaded
+ * by this libsigrok context before.
+ *
+ * Drivers can skip the upload when the device is opened again, or when
+ * the device's configuration selects the same bitstream again. Records
+ * are kept for the context's lifetime, keyed by driver, USB bus and
+ * address, and serial number. The bitstream content is compared by
+ * checksum.
+ *
+ * @param[in] sdi The device instance. Must not be NULL.
+ * @param[in] bitstream The bitstream content. Must not be NULL.
+ *
+ * @return TRUE if the device's last upload was this bitstream.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_usb_fpga_bitstream_loaded(const struct sr_dev_inst *sdi,
+		GBytes *bitstream)
+{
+	struct drv_context *drvc;
+	struct sr_context *ctx;
+	char *key, *checksum;
+	const char *loaded;
+	gboolean ret;
+
+	drvc = sdi->driver->context;
+	ctx = drvc->sr_ctx;
+
+	key = fpga_bitstream_key(sdi);
+	checksum = g_compute_checksum_for_bytes(G_CHECKSUM_SHA256, bitstream);
+	g_mutex_lock(&ctx->resource_mutex);
+	loaded = g_hash_table_lookup(ctx->fpga_bitstreams, key);
+	ret = loaded && checksum && strcmp(loaded, checksum) == 0;
+	g_mutex_unlock(&ctx->resource_mutex);
+	g_free(checksum);
+	g_free(key);
+
+	return ret;
+}
+
+/**
+ * Keep track of the FPGA bitstream which a device runs.
+ *
+ * Drivers forget the record (pass NULL) before they start an upload,
+ * and register the bitstream after the upload succeeded.
+ *
+ * @param[in] sdi The device instance. Must not be NULL.
+ * @param[in] bitstream The bitstream content, or NULL when unknown.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_fpga_bitstream_set(const struct sr_dev_inst *sdi,
+		GBytes *bitstream)
+{
+	struct drv_context *drvc;
+	struct sr_context *ctx;
+	char *key, *checksum;
+
+	drvc = sdi->driver->context;
+	ctx = drvc->sr_ctx;
+
+	key = fpga_bitstream_key(sdi);
+	checksum = NULL;
+	if (bitstream)
+		checksum = g_compute_checksum_for_bytes(G_CHECKSUM_SHA256,
+			bitstream);
+	g_mutex_lock(&ctx->resource_mutex);
+	if (checksum)
+		g_hash_table_replace(ctx->fpga_bitstreams, key, checksum);
+	else
+		g_hash_table_remove(ctx->fpga_bitstreams, key);
+	g_mutex_unlock(&ctx->resource_mutex);
+	if (!checksum)
+		g_free(key);
+}
+
+/*
+ * Streaming reception of USB bulk data. A queue of transfers is kept
+ * submitted, completed transfers get passed to the driver's receive
+ * callback and get resubmitted right away. The queue must hold the
+ * data which the device produces while the host does not tend to its
+ * completions. That time is measured during acquisition (the largest
+ * gap between completions), and is kept for the next acquisition's
+ * initial sizing.
+ */
+
+/** Default amount of data per transfer, in ms worth of data. */
+#define USB_STREAM_TRANSFER_MS	10
+
+/**
+ * Determine transfer size, queue depth and timeout for an acquisition.
+ *
+ * User specified transfer sizes and queue depths take precedence over
+ * the automatic sizing. The transfer size always is a multiple of the
+ * granularity, the queue depth does not exceed the maximum depth.
+ * Callers may adjust the timeout before sr_usb_stream_submit().
+ *
+ * @param[in,out] st The stream state, zero-initialized by the caller
+ *                before the first use, and kept across acquisitions.
+ * @param[in] bytes_per_second The data rate of the acquisition.
+ * @param[in] granularity The transfer size granularity (e.g. 512).
+ * @param[in] min_queue_ms The minimum amount of data to queue, in ms.
+ * @param[in] max_depth The maximum number of submitted transfers.
+ */
+SR_PRIV void sr_usb_stream_start(struct sr_usb_stream *st,
+	uint64_t bytes_per_second, size_t granularity,
+	unsigned int min_queue_ms, unsigned int max_depth)
+{
+	uint64_t bytes_per_ms, transfer_ms, queue_ms, queue_size;
+	uint64_t size, depth;
+
+	if (!granularity)
+		granularity = 1;
+	if (!max_depth)
+		max_depth = 1;
+	bytes_per_ms = bytes_per_second / 1000;
+	if (!bytes_per_ms)
+		bytes_per_ms = 1;
+
+	/*
+	 * Slow hosts receive larger transfers (less completion overhead),
+	 * and more data gets queued (cover twice the previous worst case
+	 * service latency).
+	 */
+	transfer_ms = MAX(USB_STREAM_TRANSFER_MS, st->latency_us / 4000);
+	queue_ms = MAX(min_queue_ms, 2 * st->latency_us / 1000 + transfer_ms);
+	queue_size = queue_ms * bytes_per_ms;
+
+	size = st->transfer_size;
+	if (!size) {
+		size = transfer_ms * bytes_per_ms;
+		/* Grow transfers when the queue depth is exhausted. */
+		if (size * max_depth < queue_size)
+			size = (queue_size + max_depth - 1) / max_depth;
+	}
+	size = (size + granularity - 1) / granularity * granularity;
+
+	depth = st->queue_depth;
+	if (!depth)
+		depth = (queue_size + size - 1) / size;
+	depth = MIN(MAX(depth, 1), max_depth);
+
+	st->bytes_per_ms = bytes_per_ms;
+	st->size = size;
+	st->depth = depth;
+	st->max_depth = max_depth;
+	st->timeout = size * depth / bytes_per_ms;
+	st->timeout += st->timeout / 4; /* Leave a headroom of 25% percent. */
+
+	st->last_completion_us = 0;
+	st->max_gap_us = 0;
+	st->underruns = 0;
+	st->overruns = 0;
+
+	sr_dbg("USB stream: %u transfers of %zu bytes, timeout %u ms.",
+		st->depth, st->size, st->timeout);
+}
+
+/*
+ * Account for the completion of a transfer. Updates statistics and the
+ * transfer's timeout. Deepens the queue when the host takes longer to
+ * tend to completions than the queue covers, returns TRUE then.
+ */
+static gboolean stream_account(struct sr_usb_stream *st,
+	struct libusb_transfer *transfer, unsigned int pending)
+{
+	int64_t now, gap, queue_us;
+
+	now = g_get_monotonic_time();
+	if (st->last_completion_us) {
+		gap = now - st->last_completion_us;
+		if (gap > st->max_gap_us)
+			st->max_gap_us = gap;
+	}
+	st->last_completion_us = now;
+
+	if ((transfer->status == LIBUSB_TRANSFER_COMPLETED ||
+			transfer->status == LIBUSB_TRANSFER_TIMED_OUT) &&
+			transfer->actual_length < transfer->length)
+		st->underruns++;
+	if (!pending)
+		st->overruns++;
+
+	transfer->timeout = st->timeout;
+
+	if (st->queue_depth || st->depth >= st->max_depth)
+		return FALSE;
+	queue_us = (int64_t)st->size * st->depth * 1000 / st->bytes_per_ms;
+	if (2 * st->max_gap_us <= queue_us)
+		return FALSE;
+
+	st->depth++;
+	st->timeout = st->size * st->depth / st->bytes_per_ms;
+	st->timeout += st->timeout / 4;
+	sr_dbg("USB stream: host latency %" PRIi64 " us, %u transfers.",
+		st->max_gap_us, st->depth);
+
+	return TRUE;
+}
+
+/* All transfers have returned. Keep the latency for the next run. */
+static void stream_finish(struct sr_usb_stream *st)
+{
+	st->latency_us = MAX((uint64_t)st->max_gap_us, st->latency_us / 2);
+
+	if (st->overruns)
+		sr_warn("USB stream: %" PRIu64 " overruns, %" PRIu64
+			" underruns, host latency %" PRIi64 " us.",
+			st->overruns, st->underruns, st->max_gap_us);
+	else
+		sr_dbg("USB stream: %" PRIu64 " underruns, host latency %"
+			PRIi64 " us.", st->underruns, st->max_gap_us);
+
+	g_free(st->transfers);
+	st->transfers = NULL;
+	st->transfer_count = 0;
+	g_free(st->held);
+	st->held = NULL;
+	st->held_count = 0;
+
+	if (st->done_cb)
+		st->done_cb(st->cb_data);
+}
+
+static void stream_free_buffer(struct sr_usb_stream *st, unsigned char *buf)
+{
+#ifdef HAVE_LIBUSB_DEV_MEM_ALLOC
+	if (st->dev_mem) {
+		libusb_dev_mem_free(st->devhdl, buf, st->size);
+		return;
+	}
+#endif
+	sr_aligned_free(buf);
+}
+
+/* Free the transfers which were kept for the next acquisition. */
+static void stream_idle_free(struct sr_usb_stream *st)
+{
+	struct libusb_transfer *transfer;
+
+	while (st->idle_count) {
+		transfer = st->idle[--st->idle_count];
+#ifdef HAVE_LIBUSB_DEV_MEM_ALLOC
+		if (st->idle_dev_mem)
+			libusb_dev_mem_free(transfer->dev_handle,
+				transfer->buffer, transfer->length);
+		else
+#endif
+			sr_aligned_free(transfer->buffer);
+		transfer->buffer = NULL;
+		libusb_free_transfer(transfer);
+	}
+}
+
+/*
+ * Transfers which return keep their buffers, and get reused by the next
+ * acquisition of the same size and device handle. This saves allocating
+ * (and for device memory, mapping) the buffers for each acquisition.
+ */
+static void stream_release(struct sr_usb_stream *st,
+	struct libusb_transfer *transfer)
+{
+	size_t idx;
+
+	for (idx = 0; idx < st->transfer_count; idx++) {
+		if (st->transfers[idx] == transfer) {
+			st->transfers[idx] = NULL;
+			break;
+		}
+	}
+
+	if (st->idle_count && st->idle_dev_mem != st->dev_mem)
+		stream_idle_free(st);
+	if (st->idle_size < st->max_depth) {
+		st->idle = g_realloc_n(st->idle, st->max_depth,
+			sizeof(st->idle[0]));
+		st->idle_size = st->max_depth;
+	}
+	if (st->idle_count < st->idle_size) {
+		st->idle[st->idle_count++] = transfer;
+		st->idle_dev_mem = st->dev_mem;
+	} else {
+		stream_free_buffer(st, transfer->buffer);
+		transfer->buffer = NULL;
+		libusb_free_transfer(transfer);
+	}
+
+	if (--st->submitted == 0)
+		stream_finish(st);
+}
+
+/* Take a kept transfer which matches the current acquisition. */
+static struct libusb_transfer *stream_idle_get(struct sr_usb_stream *st)
+{
+	struct libusb_transfer *transfer;
+
+	if (!st->idle_count)
+		return NULL;
+	transfer = st->idle[st->idle_count - 1];
+	if (transfer->dev_handle != st->devhdl
+			|| (size_t)transfer->length != st->size) {
+		stream_idle_free(st);
+		return NULL;
+	}
+	if (st->transfer_count && st->dev_mem != st->idle_dev_mem)
+		return NULL;
+	st->idle_count--;
+	st->dev_mem = st->idle_dev_mem;
+
+	return transfer;
+}
+
+static int stream_add_transfer(struct sr_usb_stream *st);
+
+static void LIBUSB_CALL stream_transfer_cb(struct libusb_transfer *transfer)
+{
+	struct sr_usb_stream *st;
+	gboolean grow, keep;
+	int ret;
+
+	st = transfer->user_data;
+
+	if (st->stopping || transfer->status == LIBUSB_TRANSFER_CANCELLED) {
+		stream_release(st, transfer);
+		return;
+	}
+
+	grow = stream_account(st, transfer,
+		st->submitted - st->held_count - 1);
+	sr_traffic_record(SR_TRAFFIC_USB_BULK_IN, st->endpoint,
+		transfer->buffer, transfer->actual_length);
+	sr_trace(SR_TRACE_USB_TRANSFER, SR_TRACE_BEGIN, transfer->actual_length);
+	keep = st->receive_cb(transfer, st->cb_data);
+	sr_trace(SR_TRACE_USB_TRANSFER, SR_TRACE_END, transfer->actual_length);
+	if (!keep || st->stopping) {
+		sr_usb_stream_cancel(st);
+		stream_release(st, transfer);
+		return;
+	}
+
+	if (st->hold) {
+		st->held[st->held_count++] = transfer;
+		if (grow)
+			(void)stream_add_transfer(st);
+		return;
+	}
+
+	ret = libusb_submit_transfer(transfer);
+	if (ret != LIBUSB_SUCCESS) {
+		sr_err("Cannot resubmit USB transfer: %s.",
+			libusb_error_name(ret));
+		stream_release(st, transfer);
+		return;
+	}
+
+	if (grow)
+		(void)stream_add_transfer(st);
+}
+
+static int stream_add_transfer(struct sr_usb_stream *st)
+{
+	struct libusb_transfer *transfer;
+	unsigned char *buf;
+	int ret;
+
+	if (st->transfer_count >= st->max_depth)
+		return SR_ERR_BUG;
+
+	if ((transfer = stream_idle_get(st))) {
+		libusb_fill_bulk_transfer(transfer, st->devhdl, st->endpoint,
+			transfer->buffer, st->size, stream_transfer_cb, st,
+			st->timeout);
+		ret = libusb_submit_transfer(transfer);
+		if (ret != LIBUSB_SUCCESS) {
+			sr_err("Failed to submit transfer: %s.",
+				libusb_error_name(ret));
+			stream_free_buffer(st, transfer->buffer);
+			transfer->buffer = NULL;
+			libusb_free_transfer(transfer);
+			return SR_ERR_IO;
+		}
+		st->transfers[st->transfer_count++] = transfer;
+		st->submitted++;
+		return SR_OK;
+	}
+
+	buf = NULL;
+#ifdef HAVE_LIBUSB_DEV_MEM_ALLOC
+	/* Prefer buffers which the host controller can use directly. */
+	if (st->dev_mem || !st->transfer_count)
+		buf = libusb_dev_mem_alloc(st->devhdl, st->size);
+	if (!st->transfer_count)
+		st->dev_mem = buf != NULL;
+	else if (st->dev_mem && !buf)
+		return SR_ERR_MALLOC;
+#endif
+	if (!buf)
+		buf = sr_aligned_alloc(st->size);
+	if (!buf) {
+		sr_err("USB transfer buffer malloc failed.");
+		return SR_ERR_MALLOC;
+	}
+	transfer = libusb_alloc_transfer(0);
+	if (!transfer) {
+		sr_err("USB transfer malloc failed.");
+		stream_free_buffer(st, buf);
+		return SR_ERR_MALLOC;
+	}
+	libusb_fill_bulk_transfer(transfer, st->devhdl, st->endpoint,
+		buf, st->size, stream_transfer_cb, st, st->timeout);
+	ret = libusb_submit_transfer(transfer);
+	if (ret != LIBUSB_SUCCESS) {
+		sr_err("Failed to submit transfer: %s.",
+			libusb_error_name(ret));
+		transfer->buffer = NULL;
+		libusb_free_transfer(transfer);
+		stream_free_buffer(st, buf);
+		return SR_ERR_IO;
+	}
+	st->transfers[st->transfer_count++] = transfer;
+	st->submitted++;
+
+	return SR_OK;
+}
+
+/**
+ * Start the reception of a USB bulk data stream.
+ *
+ * Submits the transfers which sr_usb_stream_start() has determined.
+ * Completed transfers get passed to the receive callback, which
+ * returns FALSE to end the reception. When all transfers have returned
+ * after the end of reception (or sr_usb_stream_cancel()), the done
+ * callback gets invoked. This also happens when this routine fails
+ * after having submitted some of the transfers.
+ *
+ * @param[in,out] st The stream state, see sr_usb_stream_start().
+ * @param[in] devhdl The USB device handle.
+ * @param[in] endpoint The bulk IN endpoint address.
+ * @param[in] receive_cb The routine to process received data.
+ * @param[in] done_cb The routine to call after reception ended, or NULL.
+ * @param[in] cb_data Caller provided data for the callbacks.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or reception still in progress.
+ * @retval other Failed to allocate or submit transfers.
+ */
+SR_PRIV int sr_usb_stream_submit(struct sr_usb_stream *st,
+	libusb_device_handle *devhdl, unsigned char endpoint,
+	sr_usb_stream_receive_cb receive_cb, sr_usb_stream_done_cb done_cb,
+	void *cb_data)
+{
+	unsigned int idx;
+	int ret;
+
+	if (!st || !devhdl || !receive_cb || !st->depth || st->submitted)
+		return SR_ERR_ARG;
+
+	st->devhdl = devhdl;
+	st->endpoint = endpoint;
+	st->receive_cb = receive_cb;
+	st->done_cb = done_cb;
+	st->cb_data = cb_data;
+	st->stopping = FALSE;
+	st->dev_mem = FALSE;
+
+	/* Leave room for transfers which get added during reception. */
+	g_free(st->transfers);
+	g_free(st->held);
+	st->transfers = g_try_malloc0_n(st->max_depth, sizeof(st->transfers[0]));
+	st->held = g_try_malloc0_n(st->max_depth, sizeof(st->held[0]));
+	st->transfer_count = 0;
+	st->held_count = 0;
+	if (!st->transfers || !st->held) {
+		sr_err("USB transfers malloc failed.");
+		g_free(st->transfers);
+		g_free(st->held);
+		st->transfers = NULL;
+		st->held = NULL;
+		return SR_ERR_MALLOC;
+	}
+
+	for (idx = 0; idx < st->depth; idx++) {
+		ret = stream_add_transfer(st);
+		if (ret != SR_OK) {
+			if (st->submitted) {
+				sr_usb_stream_cancel(st);
+			} else {
+				g_free(st->transfers);
+				g_free(st->held);
+				st->transfers = NULL;
+				st->held = NULL;
+			}
+			return ret;
+		}
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Resubmit the transfers which completed while the stream holds them.
+ *
+ * Drivers which set st->hold call this after each round of event
+ * handling, once they are done with the data of the held transfers.
+ * After the end of reception the held transfers get released instead,
+ * which can invoke the done callback.
+ *
+ * @param[in,out] st The stream state.
+ */
+SR_PRIV void sr_usb_stream_resubmit(struct sr_usb_stream *st)
+{
+	struct libusb_transfer *transfer;
+	size_t idx, count;
+	int ret;
+
+	if (!st || !st->held_count)
+		return;
+
+	/* Releasing the last transfer ends the stream, and frees the list. */
+	count = st->held_count;
+	st->held_count = 0;
+	for (idx = 0; idx < count; idx++) {
+		transfer = st->held[idx];
+		if (st->stopping) {
+			stream_release(st, transfer);
+			continue;
+		}
+		ret = libusb_submit_transfer(transfer);
+		if (ret != LIBUSB_SUCCESS) {
+			sr_err("Cannot resubmit USB transfer: %s.",
+				libusb_error_name(ret));
+			stream_release(st, transfer);
+		}
+	}
+}
+
+/**
+ * End the reception of a USB bulk data stream.
+ *
+ * Cancels all submitted transfers. They get released as they return,
+ * the done callback gets invoked after the last of them. Held transfers
+ * get released by the next sr_usb_stream_resubmit().
+ *
+ * @param[in,out] st The stream state.
+ */
+SR_PRIV void sr_usb_stream_cancel(struct sr_usb_stream *st)
+{
+	size_t idx;
+
+	if (!st)
+		return;
+
+	st->stopping = TRUE;
+	for (idx = st->transfer_count; idx-- > 0; ) {
+		if (st->transfers[idx])
+			libusb_cancel_transfer(st->transfers[idx]);
+	}
+}
+
+/**
+ * End the reception of a USB bulk data stream, and wait for it.
+ *
+ * For devices which are served by a libusb context other than the
+ * library's, such as the one of libftdi, whose events no session source
+ * handles. Cancels the transfers, and handles the context's events
+ * until all of them have returned, or the timeout expires.
+ *
+ * @param[in,out] st The stream state.
+ * @param[in] usb_ctx The libusb context of the device handle.
+ * @param[in] timeout_ms The longest time to wait, in ms.
+ */
+SR_PRIV void sr_usb_stream_drain(struct sr_usb_stream *st,
+	libusb_context *usb_ctx, unsigned int timeout_ms)
+{
+	struct timeval tv;
+	int64_t end;
+
+	if (!st || !st->submitted)
+		return;
+
+	sr_usb_stream_cancel(st);
+	end = g_get_monotonic_time() + (int64_t)timeout_ms * 1000;
+	while (st->submitted && g_get_monotonic_time() < end) {
+		tv.tv_sec = 0;
+		tv.tv_usec = 10 * 1000;
+		libusb_handle_events_timeout_completed(usb_ctx, &tv, NULL);
+	}
+	if (st->submitted)
+		sr_warn("USB stream: %u transfers did not return.",
+			st->submitted);
+}
+
+/**
+ * Remove the modem status of FTDI chips from received data.
+ *
+ * FTDI chips start each USB packet with two status bytes. This moves
+ * the payload of all packets of a transfer to its start.
+ *
+ * @param[in,out] buf The received data.
+ * @param[in] length The number of bytes received.
+ * @param[in] packet_size The chip's USB packet size (64 or 512).
+ *
+ * @return The number of payload bytes.
+ */
+SR_PRIV size_t sr_usb_ftdi_payload(uint8_t *buf, size_t length,
+	size_t packet_size)
+{
+	size_t offset, count, used;
+
+	if (packet_size <= 2)
+		return 0;
+
+	used = 0;
+	for (offset = 0; offset < length; offset += packet_size) {
+		count = MIN(packet_size, length - offset);
+		if (count <= 2)
+			continue;
+		count -= 2;
+		memmove(&buf[used], &buf[offset + 2], count);
+		used += count;
+	}
+
+	return used;
+}
+
+/**
+ * Release the transfers which a USB bulk data stream keeps between
+ * acquisitions.
+ *
+ * Must be called before the device handle gets closed, and not while
+ * the reception is in progress.
+ *
+ * @param[in,out] st The stream state.
+ */
+SR_PRIV void sr_usb_stream_free(struct sr_usb_stream *st)
+{
+	if (!st)
+		return;
+
+	stream_idle_free(st);
+	g_free(st->idle);
+	st->idle = NULL;
+	st->idle_size = 0;
+}
@@ -19,6 +19,7 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
@@ -428,6 +429,340 @@ START_TEST(test_analog_to_float_conv)
 }
 END_TEST
 
+/*
+ * Scale a value and add the offset, rounding after each step like the
+ * library does. The volatile product keeps the compiler from fusing the
+ * steps into a multiply-add.
+ */
+static double scale_offset(double value, double scale, double offset)
+{
+	volatile double product;
+
+	product = value * scale;
+
+	return product + offset;
+}
+
+/*
+ * Check longer arrays of integer samples, which take the vectorized
+ * code paths, against the scalar formula. Results must be identical,
+ * including for the remainder which does not fill a vector.
+ */
+START_TEST(test_analog_to_float_long)
+{
+	static const size_t lengths[] = { 1, 7, 8, 9, 31, 100, 1001, };
+	static const size_t units[] = { 1, 2, };
+	uint8_t bytes[2 * 1001];
+	float f_out[1001], want;
+	double value;
+	struct sr_channel ch;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	size_t len_idx, unit_idx, i, n, unit;
+	int is_sign, ret;
+
+	for (i = 0; i < sizeof(bytes); i++)
+		bytes[i] = (i * 37 + 11) ^ (i >> 3);
+
+	for (unit_idx = 0; unit_idx < ARRAY_SIZE(units); unit_idx++)
+	for (is_sign = 0; is_sign <= 1; is_sign++)
+	for (len_idx = 0; len_idx < ARRAY_SIZE(lengths); len_idx++) {
+		unit = units[unit_idx];
+		n = lengths[len_idx];
+		sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+		analog.num_samples = n;
+		analog.data = bytes;
+		encoding.unitsize = unit;
+		encoding.is_float = FALSE;
+		encoding.is_signed = is_sign;
+		encoding.is_bigendian = FALSE;
+		encoding.scale.p = -22;
+		encoding.scale.q = 7;
+		encoding.offset.p = 5;
+		encoding.offset.q = 3;
+		meaning.channels = g_slist_append(NULL, &ch);
+
+		ret = sr_analog_to_float(&analog, f_out);
+		fail_unless(ret == SR_OK, "sr_analog_to_float() failed: %d.", ret);
+		for (i = 0; i < n; i++) {
+			if (unit == 1)
+				value = is_sign ? (int8_t)bytes[i] : bytes[i];
+			else if (is_sign)
+				value = (int16_t)(bytes[2 * i] | bytes[2 * i + 1] << 8);
+			else
+				value = (uint16_t)(bytes[2 * i] | bytes[2 * i + 1] << 8);
+			want = scale_offset(value, -22.0 / 7, 5.0 / 3);
+			fail_unless(memcmp(&want, &f_out[i], sizeof(want)) == 0,
+				"u%zu%s[%zu] of %zu: %f != %f", unit * 8,
+				is_sign ? "s" : "", i, n, want, f_out[i]);
+		}
+		g_slist_free(meaning.channels);
+	}
+}
+END_TEST
+
+/* Check double precision and single channel results against floats. */
+START_TEST(test_analog_to_double_channel)
+{
+	int16_t bytes[3 * 20];
+	float f_all[3 * 20], f_ch[2 * 20];
+	double d_all[3 * 20], d_ch[20];
+	struct sr_channel ch[3];
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	unsigned int c;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < ARRAY_SIZE(bytes); i++)
+		bytes[i] = i * 377 - 10000;
+
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	analog.num_samples = 20;
+	analog.data = bytes;
+	encoding.unitsize = sizeof(int16_t);
+	encoding.is_float = FALSE;
+	encoding.is_signed = TRUE;
+	encoding.is_bigendian = host_be;
+	encoding.scale.p = 3;
+	encoding.scale.q = 7;
+	for (c = 0; c < ARRAY_SIZE(ch); c++)
+		meaning.channels = g_slist_append(meaning.channels, &ch[c]);
+
+	ret = sr_analog_to_float(&analog, f_all);
+	fail_unless(ret == SR_OK, "sr_analog_to_float() failed: %d.", ret);
+	ret = sr_analog_to_double(&analog, d_all);
+	fail_unless(ret == SR_OK, "sr_analog_to_double() failed: %d.", ret);
+	for (i = 0; i < ARRAY_SIZE(bytes); i++)
+		fail_unless((float)d_all[i] == f_all[i], "[%zu]: %f != %f",
+			i, d_all[i], f_all[i]);
+
+	for (c = 0; c < ARRAY_SIZE(ch); c++) {
+		ret = sr_analog_channel_to_float(&analog, c, f_ch, 2);
+		fail_unless(ret == SR_OK, "channel %u: failed: %d.", c, ret);
+		ret = sr_analog_channel_to_double(&analog, c, d_ch, 1);
+		fail_unless(ret == SR_OK, "channel %u: failed: %d.", c, ret);
+		for (i = 0; i < analog.num_samples; i++) {
+			fail_unless(f_ch[2 * i] == f_all[3 * i + c],
+				"channel %u [%zu]: %f != %f", c, i,
+				f_ch[2 * i], f_all[3 * i + c]);
+			fail_unless(d_ch[i] == d_all[3 * i + c],
+				"channel %u [%zu]: %f != %f", c, i,
+				d_ch[i], d_all[3 * i + c]);
+		}
+	}
+
+	ret = sr_analog_channel_to_float(&analog, 3, f_ch, 1);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_analog_channel_to_float(&analog, 0, f_ch, 0);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_analog_channel_to_double(&analog, 0, NULL, 1);
+	fail_unless(ret == SR_ERR_ARG);
+
+	g_slist_free(meaning.channels);
+}
+END_TEST
+
+/*
+ * Check that the single channel conversion of native float input rounds
+ * like sr_analog_to_float() does, which scales in single precision.
+ */
+START_TEST(test_analog_to_float_channel_scaled)
+{
+	float values[3 * 20], f_all[3 * 20], f_ch[20], expected;
+	double d_all[3 * 20], scale, offset;
+	struct sr_channel ch[3];
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	unsigned int c;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < ARRAY_SIZE(values); i++)
+		values[i] = i * 37.77f - 1000.3f;
+
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	analog.num_samples = 20;
+	analog.data = values;
+	encoding.scale.p = 3;
+	encoding.scale.q = 7;
+	encoding.offset.p = 5;
+	encoding.offset.q = 3;
+	for (c = 0; c < ARRAY_SIZE(ch); c++)
+		meaning.channels = g_slist_append(meaning.channels, &ch[c]);
+	scale = 3.0 / 7;
+	offset = 5.0 / 3;
+
+	ret = sr_analog_to_float(&analog, f_all);
+	fail_unless(ret == SR_OK, "sr_analog_to_float() failed: %d.", ret);
+	ret = sr_analog_to_double(&analog, d_all);
+	fail_unless(ret == SR_OK, "sr_analog_to_double() failed: %d.", ret);
+	for (i = 0; i < ARRAY_SIZE(values); i++) {
+		expected = values[i] * scale;
+		expected += offset;
+		fail_unless(f_all[i] == expected, "[%zu]: %f != %f",
+			i, f_all[i], expected);
+		fail_unless(d_all[i] == scale_offset(values[i], scale, offset),
+			"[%zu]: %f != %f", i, d_all[i],
+			scale_offset(values[i], scale, offset));
+	}
+
+	for (c = 0; c < ARRAY_SIZE(ch); c++) {
+		ret = sr_analog_channel_to_float(&analog, c, f_ch, 1);
+		fail_unless(ret == SR_OK, "channel %u: failed: %d.", c, ret);
+		for (i = 0; i < analog.num_samples; i++)
+			fail_unless(f_ch[i] == f_all[3 * i + c],
+				"channel %u [%zu]: %f != %f", c, i,
+				f_ch[i], f_all[3 * i + c]);
+	}
+
+	g_slist_free(meaning.channels);
+}
+END_TEST
+
+/*
+ * Check that a packet can describe two channels of data which has three
+ * values per sample, with a scale and offset of its own for each.
+ */
+START_TEST(test_analog_to_float_strided)
+{
+	static const struct sr_rational scale[] = { { 3, 7 }, { -1, 2 } };
+	static const struct sr_rational offset[] = { { 5, 1 }, { 0, 1 } };
+	int16_t bytes[3 * 20];
+	float f_all[2 * 20];
+	double d_all[2 * 20], expected;
+	struct sr_channel ch[2];
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	unsigned int c;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < ARRAY_SIZE(bytes); i++)
+		bytes[i] = i * 377 - 10000;
+
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	analog.num_samples = 20;
+	analog.data = &bytes[1];
+	encoding.unitsize = sizeof(int16_t);
+	encoding.is_float = FALSE;
+	encoding.is_signed = TRUE;
+	encoding.is_bigendian = host_be;
+	encoding.stride = 3 * sizeof(int16_t);
+	encoding.channel_scale = scale;
+	encoding.channel_offset = offset;
+	encoding.offset.p = 1;
+	for (c = 0; c < ARRAY_SIZE(ch); c++)
+		meaning.channels = g_slist_append(meaning.channels, &ch[c]);
+
+	fail_unless(sr_analog_data_size(&analog) ==
+		(19 * 3 + 2) * sizeof(int16_t));
+
+	ret = sr_analog_to_float(&analog, f_all);
+	fail_unless(ret == SR_OK, "sr_analog_to_float() failed: %d.", ret);
+	ret = sr_analog_to_double(&analog, d_all);
+	fail_unless(ret == SR_OK, "sr_analog_to_double() failed: %d.", ret);
+	for (i = 0; i < analog.num_samples; i++) {
+		for (c = 0; c < ARRAY_SIZE(ch); c++) {
+			expected = bytes[3 * i + 1 + c];
+			expected *= (double)scale[c].p / scale[c].q;
+			expected += (double)offset[c].p / offset[c].q;
+			expected += 1;
+			fail_unless(fabs(d_all[2 * i + c] - expected) < 1e-9,
+				"channel %u [%zu]: %f != %f", c, i,
+				d_all[2 * i + c], expected);
+			fail_unless(f_all[2 * i + c] == (float)d_all[2 * i + c],
+				"channel %u [%zu]: %f != %f", c, i,
+				f_all[2 * i + c], d_all[2 * i + c]);
+		}
+	}
+
+	g_slist_free(meaning.channels);
+}
+END_TEST
+
+/* Check the multi-channel conversion against single channel thresholds. */
+START_TEST(test_analog_to_logic_multi)
+{
+	int16_t bytes[9 * 100];
+	float f_ch[100];
+	struct sr_channel ch[9];
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct sr_datafeed_logic logic;
+	struct sr_a2l_converter *conv;
+	const uint8_t *p;
+	uint8_t state;
+	unsigned int c;
+	size_t i;
+	int ret, bit;
+
+	for (i = 0; i < ARRAY_SIZE(bytes); i++)
+		bytes[i] = (i * 7919) % 2001 - 1000;
+
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	analog.num_samples = 100;
+	analog.data = bytes;
+	encoding.unitsize = sizeof(int16_t);
+	encoding.is_float = FALSE;
+	encoding.is_signed = TRUE;
+	encoding.is_bigendian = host_be;
+	for (c = 0; c < ARRAY_SIZE(ch); c++)
+		meaning.channels = g_slist_append(meaning.channels, &ch[c]);
+
+	ret = sr_a2l_converter_new(&conv, ARRAY_SIZE(ch));
+	fail_unless(ret == SR_OK, "sr_a2l_converter_new() failed: %d.", ret);
+	for (c = 0; c < ARRAY_SIZE(ch); c++) {
+		if (c % 2)
+			ret = sr_a2l_converter_schmitt_set(conv, c, -200, 300, 0);
+		else
+			ret = sr_a2l_converter_threshold_set(conv, c, c * 50.0);
+		fail_unless(ret == SR_OK, "channel %u: failed: %d.", c, ret);
+	}
+	ret = sr_a2l_converter_run(conv, &analog, &logic);
+	fail_unless(ret == SR_OK, "sr_a2l_converter_run() failed: %d.", ret);
+	fail_unless(logic.unitsize == 2 && logic.length == 200);
+
+	p = logic.data;
+	for (c = 0; c < ARRAY_SIZE(ch); c++) {
+		ret = sr_analog_channel_to_float(&analog, c, f_ch, 1);
+		fail_unless(ret == SR_OK, "channel %u: failed: %d.", c, ret);
+		state = 0;
+		for (i = 0; i < analog.num_samples; i++) {
+			if (f_ch[i] < -200)
+				state = 0;
+			else if (f_ch[i] > 300)
+				state = 1;
+			bit = (p[2 * i + c / 8] >> (c % 8)) & 1;
+			if (c % 2)
+				fail_unless(bit == state, "channel %u [%zu]", c, i);
+			else
+				fail_unless(bit == (f_ch[i] >= c * 50.0),
+					"channel %u [%zu]", c, i);
+		}
+	}
+
+	ret = sr_a2l_converter_threshold_set(conv, ARRAY_SIZE(ch), 0);
+	fail_unless(ret == SR_ERR_ARG);
+	meaning.channels = g_slist_remove(meaning.channels, &ch[0]);
+	ret = sr_a2l_converter_run(conv, &analog, &logic);
+	fail_unless(ret == SR_ERR_ARG);
+
+	sr_a2l_converter_free(conv);
+	g_slist_free(meaning.channels);
+}
+END_TEST
+
 START_TEST(test_analog_si_prefix)
 {
 	struct {
@@ -610,6 +945,7 @@ START_TEST(test_mult_rational)
 		/* Test reduction */
 		{ { INT32_MAX, (1ll<<12) }, { (1<<2), 1 }, { INT32_MAX, (1ll<<10) }},
 		{ { INT64_MAX, (1ll<<63) }, { (1<<3), 1 }, { INT64_MAX, (1ll<<60) }},
+		{ { 3ll * 1000000007, 1000000009 }, { 5ll * 1000000009, 3ll * 1000000007 }, { 5, 1 }},
 		/* Test large numbers */
 		{ {  (1ll<<40), (1ll<<10) }, {  (1ll<<30), 1 }, { (1ll<<60), 1 }},
 		{ { -(1ll<<40), (1ll<<10) }, { -(1ll<<30), 1 }, { (1ll<<60), 1 }},
@@ -697,6 +1033,11 @@ Suite *suite_analog(void)
 	tcase_add_test(tc, test_analog_to_float);
 	tcase_add_test(tc, test_analog_to_float_null);
 	tcase_add_test(tc, test_analog_to_float_conv);
+	tcase_add_test(tc, test_analog_to_float_long);
+	tcase_add_test(tc, test_analog_to_double_channel);
+	tcase_add_test(tc, test_analog_to_float_channel_scaled);
+	tcase_add_test(tc, test_analog_to_float_strided);
+	tcase_add_test(tc, test_analog_to_logic_multi);
 	suite_add_tcase(s, tc);
 
 	tc = tcase_create("analog_si_unit");
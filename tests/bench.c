@@ -0,0 +1,369 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Datafeed benchmarks ("make bench"). The demo driver generates data at
+ * a configurable rate and channel count, which passes an optional soft
+ * trigger and transform, and is then fed to each output module in turn.
+ * Every run prints one JSON object per line, for comparisons between
+ * releases.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+
+static gint64 samplerate = SR_MHZ(200);
+static gint64 limit_samples = SR_MHZ(10);
+static int logic_channels = 8;
+static int analog_channels = 0;
+static char *pattern = "sigrok";
+static char *outputs;
+static char *transform;
+static char *trigger;
+static gboolean threaded;
+
+static const GOptionEntry bench_options[] = {
+	{ "samplerate", 'r', 0, G_OPTION_ARG_INT64, &samplerate,
+		"Samplerate of the demo device in Hz", "RATE" },
+	{ "samples", 'n', 0, G_OPTION_ARG_INT64, &limit_samples,
+		"Number of samples per run", "COUNT" },
+	{ "logic", 'l', 0, G_OPTION_ARG_INT, &logic_channels,
+		"Number of logic channels", "COUNT" },
+	{ "analog", 'a', 0, G_OPTION_ARG_INT, &analog_channels,
+		"Number of analog channels", "COUNT" },
+	{ "pattern", 'p', 0, G_OPTION_ARG_STRING, &pattern,
+		"Logic pattern of the demo device", "NAME" },
+	{ "outputs", 'o', 0, G_OPTION_ARG_STRING, &outputs,
+		"Comma separated output modules (default: all)", "IDS" },
+	{ "transform", 't', 0, G_OPTION_ARG_STRING, &transform,
+		"Transform module to run", "ID" },
+	{ "trigger", 'T', 0, G_OPTION_ARG_STRING, &trigger,
+		"Soft trigger on a rising edge of the channel", "NAME" },
+	{ "threaded", 0, 0, G_OPTION_ARG_NONE, &threaded,
+		"Process packets in the session's consumer thread", NULL },
+	{ NULL, 0, 0, 0, NULL, NULL, NULL },
+};
+
+struct bench_run {
+	const struct sr_output *output;
+	/* Time of each sr_output_send() call, in microseconds. */
+	GArray *latencies;
+	uint64_t output_bytes;
+};
+
+static void datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct bench_run *run;
+	GString *out;
+	gint64 start, latency;
+
+	(void)sdi;
+
+	run = cb_data;
+	if (!run->output)
+		return;
+
+	out = NULL;
+	start = g_get_monotonic_time();
+	sr_output_send(run->output, packet, &out);
+	latency = g_get_monotonic_time() - start;
+	g_array_append_val(run->latencies, latency);
+	if (out) {
+		run->output_bytes += out->len;
+		g_string_free(out, TRUE);
+	}
+}
+
+static int compare_latency(const void *a, const void *b)
+{
+	const gint64 *la, *lb;
+
+	la = a;
+	lb = b;
+
+	return (*la > *lb) - (*la < *lb);
+}
+
+static gint64 percentile(GArray *sorted, unsigned int pct)
+{
+	if (!sorted->len)
+		return 0;
+
+	return g_array_index(sorted, gint64, (sorted->len - 1) * pct / 100);
+}
+
+static struct sr_dev_inst *demo_device(struct sr_context *ctx)
+{
+	struct sr_dev_driver **drivers, *driver;
+	struct sr_config cfg_logic, cfg_analog;
+	struct sr_dev_inst *sdi;
+	GSList *options, *devices;
+	int i;
+
+	driver = NULL;
+	drivers = sr_driver_list(ctx);
+	for (i = 0; drivers && drivers[i]; i++) {
+		if (!strcmp(drivers[i]->name, "demo"))
+			driver = drivers[i];
+	}
+	if (!driver || sr_driver_init(ctx, driver) != SR_OK) {
+		fprintf(stderr, "The demo driver is not available.\n");
+		return NULL;
+	}
+
+	cfg_logic.key = SR_CONF_NUM_LOGIC_CHANNELS;
+	cfg_logic.data = g_variant_new_int32(logic_channels);
+	cfg_analog.key = SR_CONF_NUM_ANALOG_CHANNELS;
+	cfg_analog.data = g_variant_new_int32(analog_channels);
+	options = g_slist_append(NULL, &cfg_logic);
+	options = g_slist_append(options, &cfg_analog);
+	devices = sr_driver_scan(driver, options);
+	g_slist_free(options);
+	g_variant_unref(g_variant_ref_sink(cfg_logic.data));
+	g_variant_unref(g_variant_ref_sink(cfg_analog.data));
+	if (!devices) {
+		fprintf(stderr, "No demo device found.\n");
+		return NULL;
+	}
+	sdi = devices->data;
+	g_slist_free(devices);
+
+	if (sr_dev_open(sdi) != SR_OK) {
+		fprintf(stderr, "Cannot open the demo device.\n");
+		return NULL;
+	}
+
+	return sdi;
+}
+
+static int configure(struct sr_dev_inst *sdi)
+{
+	struct sr_channel_group *cg;
+	GSList *l;
+	int ret;
+
+	ret = sr_config_set(sdi, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(samplerate));
+	if (ret == SR_OK)
+		ret = sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+			g_variant_new_uint64(limit_samples));
+	for (l = sr_dev_inst_channel_groups_get(sdi); l && ret == SR_OK; l = l->next) {
+		cg = l->data;
+		if (strcmp(cg->name, "Logic"))
+			continue;
+		ret = sr_config_set(sdi, cg, SR_CONF_PATTERN_MODE,
+			g_variant_new_string(pattern));
+	}
+	if (ret != SR_OK)
+		fprintf(stderr, "Cannot configure the demo device: %s.\n",
+			sr_strerror(ret));
+
+	return ret;
+}
+
+static struct sr_trigger *trigger_new(const struct sr_dev_inst *sdi)
+{
+	struct sr_trigger *trig;
+	struct sr_channel *ch;
+	GSList *l;
+
+	for (l = sr_dev_inst_channels_get(sdi); l; l = l->next) {
+		ch = l->data;
+		if (!strcmp(ch->name, trigger))
+			break;
+	}
+	if (!l) {
+		fprintf(stderr, "Unknown trigger channel '%s'.\n", trigger);
+		return NULL;
+	}
+
+	trig = sr_trigger_new("bench");
+	sr_trigger_match_add(sr_trigger_stage_add(trig), ch,
+		SR_TRIGGER_RISING, 0);
+
+	return trig;
+}
+
+/* Run a session which feeds the output module (if any), and report it. */
+static int bench_run(struct sr_context *ctx, struct sr_dev_inst *sdi,
+	const struct sr_output_module *omod)
+{
+	struct sr_session *session;
+	struct sr_session_stats stats;
+	struct sr_trigger *trig;
+	const struct sr_transform_module *tmod;
+	struct bench_run run;
+	const char *id;
+	char *filename;
+	double seconds;
+	int ret;
+
+	memset(&run, 0, sizeof(run));
+	id = omod ? sr_output_id_get(omod) : "none";
+	filename = NULL;
+	trig = NULL;
+
+	sr_session_new(ctx, &session);
+	sr_session_dev_add(session, sdi);
+	if (threaded)
+		sr_session_threaded_set(session, TRUE, 0, FALSE);
+	if (trigger) {
+		if (!(trig = trigger_new(sdi))) {
+			sr_session_destroy(session);
+			return SR_ERR_ARG;
+		}
+		sr_session_trigger_set(session, trig);
+	}
+	if (transform) {
+		tmod = sr_transform_find(transform);
+		if (!tmod || !sr_transform_new(tmod, NULL, sdi)) {
+			fprintf(stderr, "Cannot use transform '%s'.\n", transform);
+			sr_session_destroy(session);
+			sr_trigger_free(trig);
+			return SR_ERR_ARG;
+		}
+	}
+
+	if (omod) {
+		/* Modules which write files themselves get a temporary one. */
+		if (sr_output_test_flag(omod, SR_OUTPUT_INTERNAL_IO_HANDLING)) {
+			filename = g_strdup_printf("%s/sr-bench-%s.out",
+				g_get_tmp_dir(), id);
+		}
+		run.output = sr_output_new(omod, NULL, sdi, filename);
+		if (!run.output) {
+			fprintf(stderr, "Skipping output '%s'.\n", id);
+			sr_session_destroy(session);
+			sr_trigger_free(trig);
+			g_free(filename);
+			return SR_OK;
+		}
+	}
+	run.latencies = g_array_new(FALSE, FALSE, sizeof(gint64));
+	sr_session_datafeed_callback_add(session, datafeed_in, &run);
+
+	ret = sr_session_start(session);
+	if (ret == SR_OK)
+		ret = sr_session_run(session);
+	sr_session_stats_get(session, &stats);
+	if (run.output)
+		sr_output_free(run.output);
+	sr_session_destroy(session);
+	sr_trigger_free(trig);
+	if (filename)
+		g_remove(filename);
+	g_free(filename);
+
+	if (ret != SR_OK) {
+		fprintf(stderr, "Run with output '%s' failed: %s.\n",
+			id, sr_strerror(ret));
+		g_array_free(run.latencies, TRUE);
+		return ret;
+	}
+
+	g_array_sort(run.latencies, compare_latency);
+	seconds = stats.elapsed_us / 1e6;
+	printf("{\"output\":\"%s\",\"transform\":\"%s\",\"trigger\":%s,"
+		"\"threaded\":%s,\"samplerate\":%" G_GINT64_FORMAT ","
+		"\"logic_channels\":%d,\"analog_channels\":%d,"
+		"\"elapsed_s\":%.6f,\"packets\":%" G_GUINT64_FORMAT ","
+		"\"logic_samples\":%" G_GUINT64_FORMAT ","
+		"\"analog_samples\":%" G_GUINT64_FORMAT ","
+		"\"msps\":%.3f,\"output_bytes\":%" G_GUINT64_FORMAT ","
+		"\"callback_us\":%" G_GUINT64_FORMAT ","
+		"\"transform_us\":%" G_GUINT64_FORMAT ","
+		"\"latency_us\":{\"p50\":%" G_GINT64_FORMAT
+		",\"p90\":%" G_GINT64_FORMAT ",\"p99\":%" G_GINT64_FORMAT
+		",\"max\":%" G_GINT64_FORMAT "}}\n",
+		id, transform ? transform : "none", trigger ? "true" : "false",
+		threaded ? "true" : "false", samplerate,
+		logic_channels, analog_channels, seconds, stats.packets,
+		stats.logic_samples, stats.analog_samples,
+		seconds > 0 ? (stats.logic_samples + stats.analog_samples) /
+			seconds / 1e6 : 0.0,
+		run.output_bytes, stats.callback_us, stats.transform_us,
+		percentile(run.latencies, 50), percentile(run.latencies, 90),
+		percentile(run.latencies, 99), percentile(run.latencies, 100));
+	fflush(stdout);
+	g_array_free(run.latencies, TRUE);
+
+	return SR_OK;
+}
+
+int main(int argc, char **argv)
+{
+	GOptionContext *octx;
+	GError *error;
+	struct sr_context *ctx;
+	struct sr_dev_inst *sdi;
+	const struct sr_output_module **omods, *omod;
+	char **ids;
+	int i, ret;
+
+	error = NULL;
+	octx = g_option_context_new("- libsigrok datafeed benchmarks");
+	g_option_context_add_main_entries(octx, bench_options, NULL);
+	if (!g_option_context_parse(octx, &argc, &argv, &error)) {
+		fprintf(stderr, "%s\n", error->message);
+		g_error_free(error);
+		g_option_context_free(octx);
+		return 1;
+	}
+	g_option_context_free(octx);
+
+	sr_log_loglevel_set(SR_LOG_ERR);
+	if (sr_init(&ctx) != SR_OK)
+		return 1;
+	ret = SR_ERR;
+	if (!(sdi = demo_device(ctx)) || configure(sdi) != SR_OK)
+		goto done;
+
+	/* A run without output module measures the source and the session. */
+	if ((ret = bench_run(ctx, sdi, NULL)) != SR_OK)
+		goto done;
+	if (outputs) {
+		ids = g_strsplit(outputs, ",", 0);
+		for (i = 0; ids[i] && ret == SR_OK; i++) {
+			if (!(omod = sr_output_find(ids[i]))) {
+				fprintf(stderr, "Unknown output '%s'.\n", ids[i]);
+				ret = SR_ERR_ARG;
+				break;
+			}
+			ret = bench_run(ctx, sdi, omod);
+		}
+		g_strfreev(ids);
+	} else {
+		omods = sr_output_list();
+		for (i = 0; omods[i] && ret == SR_OK; i++)
+			ret = bench_run(ctx, sdi, omods[i]);
+	}
+
+done:
+	if (sdi)
+		sr_dev_close(sdi);
+	sr_exit(ctx);
+
+	return ret == SR_OK ? 0 : 1;
+}
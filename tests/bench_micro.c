@@ -0,0 +1,265 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Micro benchmarks of the per-sample primitives (analog conversion,
+ * analog to logic conversion, rational arithmetics and string parsers),
+ * across a range of buffer sizes. Each case prints one JSON object per
+ * line with the time per sample, and the cycles per sample on hosts
+ * which have a user space cycle counter.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_CYCLES 1
+#endif
+
+/* Minimum run time of each case, in microseconds. */
+#define BENCH_MIN_TIME 200000
+
+static const size_t bench_sizes[] = { 64, 1024, 16384, 262144 };
+
+struct bench_buf {
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct sr_channel ch;
+	void *data;
+	float *fout;
+	uint8_t *lout;
+	size_t count;
+};
+
+struct bench_case {
+	const char *name;
+	uint8_t unitsize;
+	gboolean is_signed;
+	gboolean is_float;
+	gboolean is_bigendian;
+	void (*run)(struct bench_buf *buf);
+};
+
+/* Keeps the compiler from dropping the results of the parsers. */
+static volatile uint64_t bench_sink;
+
+/* The TSC counts at a constant reference rate, not the core clock. */
+static uint64_t bench_cycles(void)
+{
+#ifdef HAVE_CYCLES
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static void run_to_float(struct bench_buf *buf)
+{
+	sr_analog_to_float(&buf->analog, buf->fout);
+}
+
+static void run_a2l_threshold(struct bench_buf *buf)
+{
+	sr_a2l_threshold(&buf->analog, 0.5, buf->lout, buf->count);
+}
+
+static void run_rational(struct bench_buf *buf)
+{
+	struct sr_rational a, b, res;
+	size_t i;
+
+	sr_rational_set(&b, 3, 1000000007);
+	sr_rational_set(&res, 0, 1);
+	for (i = 0; i < buf->count; i++) {
+		sr_rational_set(&a, (int64_t)i - 5000, 1000 + i);
+		sr_rational_mult(&res, &a, &b);
+		sr_rational_div(&res, &res, &b);
+		bench_sink += res.q;
+	}
+}
+
+static const char *bench_numbers[] = {
+	"0", "1.5", "-3.300", "1e3", "0.000123", "-2.5e-6", "12345.678", "7",
+};
+
+static void run_parse_rational(struct bench_buf *buf)
+{
+	struct sr_rational r;
+	size_t i;
+
+	for (i = 0; i < buf->count; i++) {
+		sr_parse_rational(bench_numbers[i % G_N_ELEMENTS(bench_numbers)], &r);
+		bench_sink += r.q;
+	}
+}
+
+static const char *bench_sizestrings[] = {
+	"0", "100", "1k", "2.5M", "1G", "300 kHz", "24 MHz", "1.2k",
+};
+
+static void run_parse_sizestring(struct bench_buf *buf)
+{
+	uint64_t size;
+	size_t i;
+
+	for (i = 0; i < buf->count; i++) {
+		sr_parse_sizestring(bench_sizestrings[i % G_N_ELEMENTS(bench_sizestrings)],
+			&size);
+		bench_sink += size;
+	}
+}
+
+static const struct bench_case bench_cases[] = {
+	{ "analog_to_float/u8", 1, FALSE, FALSE, FALSE, run_to_float },
+	{ "analog_to_float/i16le", 2, TRUE, FALSE, FALSE, run_to_float },
+	{ "analog_to_float/i16be", 2, TRUE, FALSE, TRUE, run_to_float },
+	{ "analog_to_float/u32le", 4, FALSE, FALSE, FALSE, run_to_float },
+	{ "analog_to_float/f32le", 4, TRUE, TRUE, FALSE, run_to_float },
+	{ "analog_to_float/f32be", 4, TRUE, TRUE, TRUE, run_to_float },
+	{ "analog_to_float/f64le", 8, TRUE, TRUE, FALSE, run_to_float },
+	{ "a2l_threshold/f32le", 4, TRUE, TRUE, FALSE, run_a2l_threshold },
+	{ "a2l_threshold/i16le", 2, TRUE, FALSE, FALSE, run_a2l_threshold },
+	{ "rational_mult_div", 4, TRUE, TRUE, FALSE, run_rational },
+	{ "parse_rational", 4, TRUE, TRUE, FALSE, run_parse_rational },
+	{ "parse_sizestring", 4, TRUE, TRUE, FALSE, run_parse_sizestring },
+};
+
+static void bench_buf_init(struct bench_buf *buf, const struct bench_case *bc,
+	size_t count)
+{
+	uint8_t *p;
+	size_t i;
+
+	memset(buf, 0, sizeof(*buf));
+	buf->count = count;
+	buf->data = g_malloc(count * bc->unitsize);
+	buf->fout = g_malloc(count * sizeof(float));
+	buf->lout = g_malloc(count);
+
+	/* A sawtooth covering the value range of the encoding, roughly. */
+	p = buf->data;
+	for (i = 0; i < count; i++, p += bc->unitsize) {
+		if (bc->is_float && bc->unitsize == 8) {
+			double d = (double)(i % 100) / 100;
+			memcpy(p, &d, sizeof(d));
+		} else if (bc->is_float) {
+			float f = (float)(i % 100) / 100;
+			memcpy(p, &f, sizeof(f));
+		} else {
+			memset(p, i & 0xff, bc->unitsize);
+		}
+		if (bc->is_bigendian && bc->is_float) {
+			uint8_t tmp[8];
+			unsigned int j;
+			for (j = 0; j < bc->unitsize; j++)
+				tmp[j] = p[bc->unitsize - 1 - j];
+			memcpy(p, tmp, bc->unitsize);
+		}
+	}
+
+	buf->encoding.unitsize = bc->unitsize;
+	buf->encoding.is_signed = bc->is_signed;
+	buf->encoding.is_float = bc->is_float;
+	buf->encoding.is_bigendian = bc->is_bigendian;
+	buf->encoding.digits = 3;
+	buf->encoding.is_digits_decimal = TRUE;
+	sr_rational_set(&buf->encoding.scale, 1, bc->is_float ? 1 : 1000);
+	sr_rational_set(&buf->encoding.offset, 0, 1);
+	buf->meaning.mq = SR_MQ_VOLTAGE;
+	buf->meaning.unit = SR_UNIT_VOLT;
+	buf->meaning.channels = g_slist_append(NULL, &buf->ch);
+	buf->spec.spec_digits = 3;
+	buf->analog.data = buf->data;
+	buf->analog.num_samples = count;
+	buf->analog.encoding = &buf->encoding;
+	buf->analog.meaning = &buf->meaning;
+	buf->analog.spec = &buf->spec;
+}
+
+static void bench_buf_free(struct bench_buf *buf)
+{
+	g_slist_free(buf->meaning.channels);
+	g_free(buf->data);
+	g_free(buf->fout);
+	g_free(buf->lout);
+}
+
+static void bench_case_run(const struct bench_case *bc, size_t count)
+{
+	struct bench_buf buf;
+	uint64_t iterations, cycles;
+	gint64 start, elapsed;
+	double samples;
+
+	bench_buf_init(&buf, bc, count);
+
+	/* Warm up the caches, then run for at least BENCH_MIN_TIME. */
+	bc->run(&buf);
+	iterations = 0;
+	start = g_get_monotonic_time();
+	cycles = bench_cycles();
+	do {
+		bc->run(&buf);
+		iterations++;
+		elapsed = g_get_monotonic_time() - start;
+	} while (elapsed < BENCH_MIN_TIME);
+	cycles = bench_cycles() - cycles;
+	samples = (double)iterations * count;
+
+	printf("{\"case\":\"%s\",\"samples\":%zu,\"iterations\":%" PRIu64 ","
+		"\"ns_per_sample\":%.3f,\"msps\":%.3f,\"cycles_per_sample\":",
+		bc->name, count, iterations, elapsed * 1e3 / samples,
+		samples / elapsed);
+#ifdef HAVE_CYCLES
+	printf("%.3f}\n", cycles / samples);
+#else
+	(void)cycles;
+	printf("null}\n");
+#endif
+	fflush(stdout);
+
+	bench_buf_free(&buf);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < G_N_ELEMENTS(bench_cases); i++) {
+		/* Optional arguments select cases by a prefix of their name. */
+		if (argc > 1) {
+			for (j = 1; j < (unsigned int)argc; j++) {
+				if (g_str_has_prefix(bench_cases[i].name, argv[j]))
+					break;
+			}
+			if (j == (unsigned int)argc)
+				continue;
+		}
+		for (j = 0; j < G_N_ELEMENTS(bench_sizes); j++)
+			bench_case_run(&bench_cases[i], bench_sizes[j]);
+	}
+
+	return 0;
+}
@@ -0,0 +1,179 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Driver benchmarks without hardware. A serial driver receives a traffic
+ * recording (taken with SIGROK_TRAFFIC_RECORD=<file> set) through the
+ * "replay/<file>" port, as fast as it takes the data. This measures the
+ * driver's decoding, and its packet generation. Every run prints one
+ * JSON object per line, like tests/bench.c does.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+
+static char *driver_name;
+static char *recording;
+static gint64 limit_samples = 100000;
+static int runs = 3;
+
+static const GOptionEntry bench_options[] = {
+	{ "driver", 'd', 0, G_OPTION_ARG_STRING, &driver_name,
+		"Driver to run", "NAME" },
+	{ "file", 'f', 0, G_OPTION_ARG_FILENAME, &recording,
+		"Traffic recording to replay", "FILE" },
+	{ "samples", 'n', 0, G_OPTION_ARG_INT64, &limit_samples,
+		"Number of samples per run", "COUNT" },
+	{ "runs", 'r', 0, G_OPTION_ARG_INT, &runs,
+		"Number of runs", "COUNT" },
+	{ NULL, 0, 0, 0, NULL, NULL, NULL },
+};
+
+static struct sr_dev_inst *replay_device(struct sr_context *ctx)
+{
+	struct sr_dev_driver **drivers, *driver;
+	struct sr_config cfg_conn;
+	struct sr_dev_inst *sdi;
+	GSList *options, *devices;
+	char *conn;
+	int i;
+
+	driver = NULL;
+	drivers = sr_driver_list(ctx);
+	for (i = 0; drivers && drivers[i]; i++) {
+		if (!strcmp(drivers[i]->name, driver_name))
+			driver = drivers[i];
+	}
+	if (!driver || sr_driver_init(ctx, driver) != SR_OK) {
+		fprintf(stderr, "The driver '%s' is not available.\n",
+			driver_name);
+		return NULL;
+	}
+
+	conn = g_strdup_printf("replay/%s", recording);
+	cfg_conn.key = SR_CONF_CONN;
+	cfg_conn.data = g_variant_new_string(conn);
+	options = g_slist_append(NULL, &cfg_conn);
+	devices = sr_driver_scan(driver, options);
+	g_slist_free(options);
+	g_variant_unref(g_variant_ref_sink(cfg_conn.data));
+	g_free(conn);
+	if (!devices) {
+		fprintf(stderr, "The driver does not accept the recording.\n");
+		return NULL;
+	}
+	sdi = devices->data;
+	g_slist_free(devices);
+
+	if (sr_dev_open(sdi) != SR_OK) {
+		fprintf(stderr, "Cannot open the device.\n");
+		return NULL;
+	}
+
+	return sdi;
+}
+
+static int bench_run(struct sr_context *ctx, struct sr_dev_inst *sdi,
+	int run)
+{
+	struct sr_session *session;
+	struct sr_session_stats stats;
+	double seconds;
+	uint64_t samples;
+	int ret;
+
+	sr_session_new(ctx, &session);
+	sr_session_dev_add(session, sdi);
+	ret = sr_session_start(session);
+	if (ret == SR_OK)
+		ret = sr_session_run(session);
+	sr_session_stats_get(session, &stats);
+	sr_session_destroy(session);
+	if (ret != SR_OK) {
+		fprintf(stderr, "Run %d failed: %s.\n", run, sr_strerror(ret));
+		return ret;
+	}
+
+	seconds = stats.elapsed_us / 1e6;
+	samples = stats.logic_samples + stats.analog_samples;
+	printf("{\"driver\":\"%s\",\"run\":%d,\"elapsed_s\":%.6f,"
+		"\"packets\":%" G_GUINT64_FORMAT ","
+		"\"logic_samples\":%" G_GUINT64_FORMAT ","
+		"\"analog_samples\":%" G_GUINT64_FORMAT ","
+		"\"ksps\":%.3f,\"callback_us\":%" G_GUINT64_FORMAT "}\n",
+		driver_name, run, seconds, stats.packets,
+		stats.logic_samples, stats.analog_samples,
+		seconds > 0 ? samples / seconds / 1e3 : 0.0,
+		stats.callback_us);
+	fflush(stdout);
+
+	return SR_OK;
+}
+
+int main(int argc, char **argv)
+{
+	GOptionContext *octx;
+	GError *error;
+	struct sr_context *ctx;
+	struct sr_dev_inst *sdi;
+	int i, ret;
+
+	error = NULL;
+	octx = g_option_context_new("- libsigrok driver replay benchmarks");
+	g_option_context_add_main_entries(octx, bench_options, NULL);
+	if (!g_option_context_parse(octx, &argc, &argv, &error)) {
+		fprintf(stderr, "%s\n", error->message);
+		g_error_free(error);
+		g_option_context_free(octx);
+		return 1;
+	}
+	g_option_context_free(octx);
+	if (!driver_name || !recording) {
+		fprintf(stderr, "A driver and a recording are required.\n");
+		return 1;
+	}
+
+	sr_log_loglevel_set(SR_LOG_ERR);
+	if (sr_init(&ctx) != SR_OK)
+		return 1;
+	ret = SR_ERR;
+	if (!(sdi = replay_device(ctx)))
+		goto done;
+	ret = sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(limit_samples));
+	if (ret != SR_OK) {
+		fprintf(stderr, "Cannot set the sample limit: %s.\n",
+			sr_strerror(ret));
+		goto done;
+	}
+
+	for (i = 0; i < runs && ret == SR_OK; i++)
+		ret = bench_run(ctx, sdi, i);
+
+done:
+	if (sdi)
+		sr_dev_close(sdi);
+	sr_exit(ctx);
+
+	return ret == SR_OK ? 0 : 1;
+}
@@ -238,6 +238,242 @@ START_TEST(test_endian_write_inc)
 }
 END_TEST
 
+/* Check bit planes against the sample bits, and the way back. */
+START_TEST(test_logic_planes)
+{
+	struct sr_datafeed_logic logic, back;
+	uint8_t data[3 * 77], copy[3 * 77], *planes;
+	size_t plane_size, i, ch;
+	uint8_t bit;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = g_random_int();
+	logic.data = data;
+	logic.length = sizeof(data);
+	logic.unitsize = 3;
+
+	plane_size = sr_logic_plane_size(77);
+	fail_unless(plane_size == 16);
+	planes = g_malloc(24 * plane_size);
+	memset(planes, 0xff, 24 * plane_size);
+	fail_unless(sr_logic_to_planes(&logic, planes, 9) == SR_ERR_ARG);
+	fail_unless(sr_logic_to_planes(&logic, planes, plane_size) == SR_OK);
+	for (ch = 0; ch < 24; ch++) {
+		for (i = 0; i < 8 * plane_size; i++) {
+			bit = (planes[ch * plane_size + i / 8] >> (i % 8)) & 1;
+			if (i < 77)
+				fail_unless(bit == ((data[i * 3 + ch / 8] >> (ch % 8)) & 1));
+			else
+				fail_unless(bit == 0);
+		}
+	}
+
+	back = logic;
+	back.data = copy;
+	fail_unless(sr_logic_from_planes(planes, plane_size, &back) == SR_OK);
+	fail_unless(memcmp(data, copy, sizeof(data)) == 0);
+
+	g_free(planes);
+}
+END_TEST
+
+/* Samples 0..19 of a 16-bit signal, and its changes as RLE runs. */
+static const uint16_t rle_samples[20] = {
+	0x0101, 0x0101, 0x0101, 0x0202, 0x0202,
+	0x0202, 0x0202, 0x0202, 0x0202, 0x0202,
+	0x0303, 0x0101, 0x0101, 0x0101, 0x0101,
+	0x0101, 0x0404, 0x0404, 0x0404, 0x0404,
+};
+
+/* The same signal as two RLE packets, split in the middle of a run. */
+static const uint64_t rle_offsets1[] = { 0, 3 };
+static const uint16_t rle_values1[] = { 0x0101, 0x0202 };
+static const uint64_t rle_offsets2[] = { 0, 3, 4, 9 };
+static const uint16_t rle_values2[] = { 0x0202, 0x0303, 0x0101, 0x0404 };
+
+static void rle_packets(struct sr_datafeed_logic_rle *rle)
+{
+	rle[0].num_samples = 7;
+	rle[0].unitsize = 2;
+	rle[0].num_changes = ARRAY_SIZE(rle_offsets1);
+	rle[0].offsets = (uint64_t *)rle_offsets1;
+	rle[0].values = (void *)rle_values1;
+	rle[1].num_samples = 13;
+	rle[1].unitsize = 2;
+	rle[1].num_changes = ARRAY_SIZE(rle_offsets2);
+	rle[1].offsets = (uint64_t *)rle_offsets2;
+	rle[1].values = (void *)rle_values2;
+}
+
+/* Check that consecutive RLE packets expand to the original samples. */
+START_TEST(test_logic_rle_expand)
+{
+	struct sr_datafeed_logic_rle rle[2];
+	uint16_t data[20];
+
+	rle_packets(rle);
+	memset(data, 0xaa, sizeof(data));
+	fail_unless(sr_logic_rle_expand(&rle[0], (uint8_t *)&data[0]) == SR_OK);
+	fail_unless(sr_logic_rle_expand(&rle[1], (uint8_t *)&data[7]) == SR_OK);
+	fail_unless(memcmp(data, rle_samples, sizeof(data)) == 0);
+
+	fail_unless(sr_logic_rle_expand(NULL, (uint8_t *)data) == SR_ERR_ARG);
+	fail_unless(sr_logic_rle_expand(&rle[0], NULL) == SR_ERR_ARG);
+}
+END_TEST
+
+/* Check empty packets, and that zero-length runs get rejected. */
+START_TEST(test_logic_rle_empty)
+{
+	struct sr_datafeed_logic_rle rle;
+	uint64_t offsets[3] = { 0, 2, 2 };
+	uint8_t values[3] = { 0x11, 0x22, 0x33 };
+	uint8_t data[4];
+
+	memset(data, 0xaa, sizeof(data));
+	rle.num_samples = 0;
+	rle.unitsize = 1;
+	rle.num_changes = 0;
+	rle.offsets = NULL;
+	rle.values = NULL;
+	fail_unless(sr_logic_rle_expand(&rle, data) == SR_OK);
+	fail_unless(data[0] == 0xaa);
+
+	/* Samples without any run. */
+	rle.num_samples = 4;
+	fail_unless(sr_logic_rle_expand(&rle, data) == SR_ERR_ARG);
+
+	/* A zero-length run in the middle. */
+	rle.num_changes = 3;
+	rle.offsets = offsets;
+	rle.values = values;
+	fail_unless(sr_logic_rle_expand(&rle, data) == SR_ERR_ARG);
+
+	/* A zero-length run at the end. */
+	offsets[2] = 4;
+	fail_unless(sr_logic_rle_expand(&rle, data) == SR_ERR_ARG);
+
+	/* A first run which does not start the packet. */
+	offsets[0] = 1;
+	offsets[2] = 3;
+	fail_unless(sr_logic_rle_expand(&rle, data) == SR_ERR_ARG);
+
+	offsets[0] = 0;
+	fail_unless(sr_logic_rle_expand(&rle, data) == SR_OK);
+	fail_unless(data[0] == 0x11 && data[1] == 0x11);
+	fail_unless(data[2] == 0x22 && data[3] == 0x33);
+
+	rle.unitsize = 0;
+	fail_unless(sr_logic_rle_expand(&rle, data) == SR_ERR_ARG);
+}
+END_TEST
+
+struct change_log {
+	uint64_t base;
+	uint64_t offsets[20];
+	uint16_t values[20];
+	size_t count;
+	size_t stop;
+};
+
+static int log_change(uint64_t offset, const uint8_t *value, void *cb_data)
+{
+	struct change_log *log;
+
+	log = cb_data;
+	if (log->count == log->stop)
+		return SR_ERR_NA;
+	fail_unless(log->count < ARRAY_SIZE(log->offsets));
+	log->offsets[log->count] = log->base + offset;
+	memcpy(&log->values[log->count], value, sizeof(log->values[0]));
+	log->count++;
+
+	return SR_OK;
+}
+
+/*
+ * Check that logic and RLE packets report the same changes, also
+ * when a run continues into the next packet.
+ */
+START_TEST(test_logic_changes_foreach)
+{
+	static const uint64_t offsets[] = { 0, 3, 10, 11, 16 };
+	static const uint16_t values[] = {
+		0x0101, 0x0202, 0x0303, 0x0101, 0x0404,
+	};
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_logic_rle rle[2];
+	struct change_log log;
+	uint16_t last;
+	size_t i;
+
+	/* Logic packets, split in the middle of a run. */
+	memset(&log, 0, sizeof(log));
+	log.stop = SIZE_MAX;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = 2;
+	logic.data = (void *)&rle_samples[0];
+	logic.length = 7 * 2;
+	fail_unless(sr_logic_changes_foreach(&packet, (uint8_t *)&last,
+		TRUE, log_change, &log) == SR_OK);
+	fail_unless(last == 0x0202);
+	log.base = 7;
+	logic.data = (void *)&rle_samples[7];
+	logic.length = 13 * 2;
+	fail_unless(sr_logic_changes_foreach(&packet, (uint8_t *)&last,
+		FALSE, log_change, &log) == SR_OK);
+	fail_unless(last == 0x0404);
+	fail_unless(log.count == ARRAY_SIZE(offsets));
+	for (i = 0; i < log.count; i++) {
+		fail_unless(log.offsets[i] == offsets[i]);
+		fail_unless(log.values[i] == values[i]);
+	}
+
+	/* The same signal as RLE packets. */
+	memset(&log, 0, sizeof(log));
+	log.stop = SIZE_MAX;
+	rle_packets(rle);
+	packet.type = SR_DF_LOGIC_RLE;
+	packet.payload = &rle[0];
+	fail_unless(sr_logic_changes_foreach(&packet, (uint8_t *)&last,
+		TRUE, log_change, &log) == SR_OK);
+	fail_unless(last == 0x0202);
+	log.base = 7;
+	packet.payload = &rle[1];
+	fail_unless(sr_logic_changes_foreach(&packet, (uint8_t *)&last,
+		FALSE, log_change, &log) == SR_OK);
+	fail_unless(last == 0x0404);
+	fail_unless(log.count == ARRAY_SIZE(offsets));
+	for (i = 0; i < log.count; i++) {
+		fail_unless(log.offsets[i] == offsets[i]);
+		fail_unless(log.values[i] == values[i]);
+	}
+
+	/* The initial flag reports the continued run again. */
+	memset(&log, 0, sizeof(log));
+	log.stop = SIZE_MAX;
+	last = 0x0202;
+	fail_unless(sr_logic_changes_foreach(&packet, (uint8_t *)&last,
+		TRUE, log_change, &log) == SR_OK);
+	fail_unless(log.count == 4);
+	fail_unless(log.offsets[0] == 0 && log.values[0] == 0x0202);
+
+	/* The callback's return value stops the iteration. */
+	memset(&log, 0, sizeof(log));
+	log.stop = 2;
+	last = 0;
+	fail_unless(sr_logic_changes_foreach(&packet, (uint8_t *)&last,
+		FALSE, log_change, &log) == SR_ERR_NA);
+	fail_unless(log.count == 2);
+
+	packet.type = SR_DF_ANALOG;
+	fail_unless(sr_logic_changes_foreach(&packet, (uint8_t *)&last,
+		FALSE, log_change, &log) == SR_ERR_ARG);
+}
+END_TEST
+
 Suite *suite_conv(void)
 {
 	Suite *s;
@@ -253,5 +489,15 @@ Suite *suite_conv(void)
 	tcase_add_test(tc, test_endian_write_inc);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("planes");
+	tcase_add_test(tc, test_logic_planes);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("rle");
+	tcase_add_test(tc, test_logic_rle_expand);
+	tcase_add_test(tc, test_logic_rle_empty);
+	tcase_add_test(tc, test_logic_changes_foreach);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
@@ -19,6 +19,8 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
+#include <glib/gstdio.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -136,6 +138,34 @@ START_TEST(test_init_exit_3_reverse)
 }
 END_TEST
 
+/*
+ * Check whether a lazily initialized context works, and hands out the
+ * same driver list as a fully initialized one.
+ */
+START_TEST(test_init_exit_lazy)
+{
+	int ret;
+	struct sr_context *sr_ctx1, *sr_ctx2;
+	struct sr_dev_driver **drivers1, **drivers2;
+	int i;
+
+	ret = sr_init_flags(&sr_ctx1, SR_INIT_LAZY);
+	fail_unless(ret == SR_OK, "sr_init_flags() failed: %d.", ret);
+	ret = sr_init(&sr_ctx2);
+	fail_unless(ret == SR_OK, "sr_init() failed: %d.", ret);
+	drivers1 = sr_driver_list(sr_ctx1);
+	drivers2 = sr_driver_list(sr_ctx2);
+	fail_unless(drivers1 != NULL, "No driver list.");
+	for (i = 0; drivers1[i] && drivers2[i]; i++)
+		fail_unless(drivers1[i] == drivers2[i], "Driver %d differs.", i);
+	fail_unless(!drivers1[i] && !drivers2[i], "Driver lists differ.");
+	ret = sr_exit(sr_ctx2);
+	fail_unless(ret == SR_OK, "sr_exit() failed: %d.", ret);
+	ret = sr_exit(sr_ctx1);
+	fail_unless(ret == SR_OK, "sr_exit() failed: %d.", ret);
+}
+END_TEST
+
 /* Check whether sr_init(NULL) fails as it should. */
 START_TEST(test_init_null)
 {
@@ -162,6 +192,161 @@ START_TEST(test_exit_null)
 }
 END_TEST
 
+/* Check module loglevels, and that they fall back to the global one. */
+START_TEST(test_log_module_loglevel)
+{
+	int ret;
+
+	ret = sr_log_loglevel_set(SR_LOG_WARN);
+	fail_unless(ret == SR_OK, "sr_log_loglevel_set() failed: %d.", ret);
+
+	ret = sr_log_loglevel_set_module("session", SR_LOG_DBG);
+	fail_unless(ret == SR_OK, "sr_log_loglevel_set_module() failed: %d.", ret);
+	ret = sr_log_loglevel_get_module("session");
+	fail_unless(ret == SR_LOG_DBG, "Module loglevel is %d.", ret);
+	ret = sr_log_loglevel_get_module("backend");
+	fail_unless(ret == SR_LOG_WARN, "Other module's loglevel is %d.", ret);
+
+	ret = sr_log_loglevel_set_module("session", -1);
+	fail_unless(ret == SR_OK, "sr_log_loglevel_set_module() failed: %d.", ret);
+	ret = sr_log_loglevel_get_module("session");
+	fail_unless(ret == SR_LOG_WARN, "Reset module loglevel is %d.", ret);
+
+	sr_log_loglevel_set(SR_LOG_NONE);
+	ret = sr_log_loglevel_set_module(NULL, SR_LOG_DBG);
+	fail_unless(ret != SR_OK, "NULL module should have failed.");
+	ret = sr_log_loglevel_set_module("session", SR_LOG_SPEW + 1);
+	fail_unless(ret != SR_OK, "Invalid loglevel should have failed.");
+}
+END_TEST
+
+/* Check that traces export, and not while tracing is active. */
+START_TEST(test_trace_export)
+{
+	char *filename;
+	int ret;
+
+	filename = g_build_filename(g_get_tmp_dir(), "sr-test-trace.json", NULL);
+	sr_log_loglevel_set(SR_LOG_NONE);
+
+	ret = sr_trace_start();
+	fail_unless(ret == SR_OK, "sr_trace_start() failed: %d.", ret);
+	ret = sr_trace_export(filename);
+	fail_unless(ret != SR_OK, "Export while tracing should have failed.");
+	ret = sr_trace_stop();
+	fail_unless(ret == SR_OK, "sr_trace_stop() failed: %d.", ret);
+	ret = sr_trace_export(filename);
+	fail_unless(ret == SR_OK, "sr_trace_export() failed: %d.", ret);
+	fail_unless(g_file_test(filename, G_FILE_TEST_IS_REGULAR),
+		"No trace file.");
+
+	g_remove(filename);
+	g_free(filename);
+}
+END_TEST
+
+/* Check that packet copies get accounted to the session. */
+START_TEST(test_mem_stats)
+{
+	struct sr_mem_stats before, after;
+	struct sr_datafeed_packet packet, *copy;
+	struct sr_datafeed_logic logic;
+	uint8_t data[1000];
+	int ret;
+
+	fail_unless(!strcmp(sr_mem_tag_name(SR_MEM_SESSION), "session"),
+		"Wrong subsystem name.");
+	fail_unless(sr_mem_tag_name(SR_MEM_TAGS) == NULL,
+		"Invalid subsystem has a name.");
+	ret = sr_mem_stats_get(SR_MEM_TAGS, &before);
+	fail_unless(ret == SR_ERR_ARG, "Invalid subsystem accepted.");
+
+	ret = sr_mem_stats_get(SR_MEM_SESSION, &before);
+	if (ret == SR_ERR_NA)
+		return;
+	fail_unless(ret == SR_OK, "sr_mem_stats_get() failed: %d.", ret);
+
+	memset(data, 0, sizeof(data));
+	logic.length = sizeof(data);
+	logic.unitsize = 1;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	ret = sr_packet_copy(&packet, &copy);
+	fail_unless(ret == SR_OK, "sr_packet_copy() failed: %d.", ret);
+
+	sr_mem_stats_get(SR_MEM_SESSION, &after);
+	fail_unless(after.live_bytes == before.live_bytes + sizeof(data),
+		"Copy not accounted.");
+	fail_unless(after.peak_bytes >= after.live_bytes, "Wrong peak.");
+	fail_unless(after.allocations == before.allocations + 1,
+		"Wrong number of allocations.");
+
+	sr_packet_free(copy);
+	sr_mem_stats_get(SR_MEM_SESSION, &after);
+	fail_unless(after.live_bytes == before.live_bytes,
+		"Release not accounted.");
+	fail_unless(after.frees == before.frees + 1, "Wrong number of frees.");
+}
+END_TEST
+
+/* Check that packet copies hold aligned data. */
+START_TEST(test_datafeed_align)
+{
+	struct sr_datafeed_packet packet, *copy;
+	struct sr_datafeed_logic logic;
+	const struct sr_datafeed_logic *logic_copy;
+	uint8_t data[100];
+	int ret;
+
+	memset(data, 0x55, sizeof(data));
+	logic.length = sizeof(data) - 1;
+	logic.unitsize = 1;
+	logic.data = &data[1];
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	fail_unless(!sr_datafeed_data_aligned(logic.data, logic.length),
+		"Data outside of dispatch reported as aligned.");
+
+	ret = sr_packet_copy(&packet, &copy);
+	fail_unless(ret == SR_OK, "sr_packet_copy() failed: %d.", ret);
+	logic_copy = copy->payload;
+	fail_unless((uintptr_t)logic_copy->data % SR_DATAFEED_ALIGN == 0,
+		"Copied data is not aligned.");
+	fail_unless(!memcmp(logic_copy->data, &data[1], logic.length),
+		"Copied data differs.");
+	sr_packet_free(copy);
+}
+END_TEST
+
+static guint serial_list_length(void)
+{
+	GSList *ports;
+	guint count;
+
+	ports = sr_serial_list(NULL);
+	count = g_slist_length(ports);
+	g_slist_free_full(ports, (GDestroyNotify)sr_serial_free);
+
+	return count;
+}
+
+/* Check that kept and fresh serial port lists agree. */
+START_TEST(test_serial_list_cache)
+{
+	guint count;
+
+	sr_serial_list_set_timeout(0);
+	count = serial_list_length();
+	fail_unless(serial_list_length() == count,
+		"Kept port list differs.");
+	sr_serial_list_cache_clear();
+	fail_unless(serial_list_length() == count,
+		"Fresh port list differs.");
+	sr_serial_list_cache_clear();
+}
+END_TEST
+
 Suite *suite_core(void)
 {
 	Suite *s;
@@ -175,9 +360,30 @@ Suite *suite_core(void)
 	tcase_add_test(tc, test_init_exit_2_reverse);
 	tcase_add_test(tc, test_init_exit_3);
 	tcase_add_test(tc, test_init_exit_3_reverse);
+	tcase_add_test(tc, test_init_exit_lazy);
 	tcase_add_test(tc, test_init_null);
 	tcase_add_test(tc, test_exit_null);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("log");
+	tcase_add_test(tc, test_log_module_loglevel);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("trace");
+	tcase_add_test(tc, test_trace_export);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("mem_stats");
+	tcase_add_test(tc, test_mem_stats);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("buffer");
+	tcase_add_test(tc, test_datafeed_align);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("serial");
+	tcase_add_test(tc, test_serial_list_cache);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
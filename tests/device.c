@@ -61,6 +61,126 @@ START_TEST(test_channel_add)
 }
 END_TEST
 
+/* Find, scan and open a demo device, NULL when the driver is not built. */
+static struct sr_dev_inst *demo_open(void)
+{
+	struct sr_dev_driver **drivers;
+	struct sr_dev_inst *sdi;
+	GSList *devices;
+	int i;
+
+	drivers = sr_driver_list(srtest_ctx);
+	for (i = 0; drivers && drivers[i]; i++) {
+		if (!strcmp(drivers[i]->name, "demo"))
+			break;
+	}
+	if (!drivers || !drivers[i])
+		return NULL;
+
+	srtest_driver_init(srtest_ctx, drivers[i]);
+	devices = sr_driver_scan(drivers[i], NULL);
+	fail_unless(devices != NULL, "No demo device found.");
+	sdi = devices->data;
+	g_slist_free(devices);
+	fail_unless(sr_dev_open(sdi) == SR_OK, "Cannot open demo device.");
+
+	return sdi;
+}
+
+START_TEST(test_config_cache)
+{
+	struct sr_dev_driver *driver;
+	struct sr_dev_inst *sdi;
+	GVariant *g1, *g2;
+
+	fail_unless(sr_config_cache_enable(NULL, TRUE) == SR_ERR_ARG);
+	if (!(sdi = demo_open()))
+		return;
+	driver = sr_dev_inst_driver_get(sdi);
+
+	/* Lists are cached, the same immutable variant comes back. */
+	fail_unless(sr_config_list(driver, sdi, NULL,
+		SR_CONF_SAMPLERATE, &g1) == SR_OK);
+	fail_unless(sr_config_list(driver, sdi, NULL,
+		SR_CONF_SAMPLERATE, &g2) == SR_OK);
+	fail_unless(g1 == g2, "Samplerate list not cached.");
+	g_variant_unref(g1);
+	g_variant_unref(g2);
+
+	/* Values are cached once enabled, until something gets set. */
+	fail_unless(sr_config_cache_enable(sdi, TRUE) == SR_OK);
+	fail_unless(sr_config_set(sdi, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(SR_KHZ(200))) == SR_OK);
+	fail_unless(sr_config_get(driver, sdi, NULL,
+		SR_CONF_SAMPLERATE, &g1) == SR_OK);
+	fail_unless(sr_config_get(driver, sdi, NULL,
+		SR_CONF_SAMPLERATE, &g2) == SR_OK);
+	fail_unless(g1 == g2, "Samplerate not cached.");
+	fail_unless(g_variant_get_uint64(g1) == SR_KHZ(200));
+	g_variant_unref(g1);
+	g_variant_unref(g2);
+
+	fail_unless(sr_config_set(sdi, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(SR_KHZ(500))) == SR_OK);
+	fail_unless(sr_config_get(driver, sdi, NULL,
+		SR_CONF_SAMPLERATE, &g1) == SR_OK);
+	fail_unless(g_variant_get_uint64(g1) == SR_KHZ(500),
+		"Cached samplerate not invalidated by sr_config_set().");
+	g_variant_unref(g1);
+
+	sr_dev_close(sdi);
+}
+END_TEST
+
+START_TEST(test_config_typed)
+{
+	struct sr_dev_driver *driver;
+	struct sr_dev_inst *sdi;
+	GVariant *gvar;
+	uint64_t value;
+	gboolean avg;
+
+	if (!(sdi = demo_open()))
+		return;
+	driver = sr_dev_inst_driver_get(sdi);
+
+	fail_unless(sr_config_set_u64(sdi, NULL,
+		SR_CONF_SAMPLERATE, SR_KHZ(250)) == SR_OK);
+	fail_unless(sr_config_get_u64(driver, sdi, NULL,
+		SR_CONF_SAMPLERATE, &value) == SR_OK);
+	fail_unless(value == SR_KHZ(250));
+	fail_unless(sr_config_get(driver, sdi, NULL,
+		SR_CONF_SAMPLERATE, &gvar) == SR_OK);
+	fail_unless(g_variant_get_uint64(gvar) == SR_KHZ(250),
+		"Typed and GVariant paths disagree.");
+	g_variant_unref(gvar);
+
+	/* Same checks as the GVariant path. */
+	fail_unless(sr_config_set_u64(sdi, NULL,
+		SR_CONF_SAMPLERATE, 0) == SR_ERR_ARG);
+	fail_unless(sr_config_get_u64(driver, sdi, NULL,
+		SR_CONF_AVERAGING, &value) == SR_ERR_ARG,
+		"Boolean key read as integer.");
+
+	/* Keys without a typed callback fall back to GVariants. */
+	fail_unless(sr_config_set_bool(sdi, NULL,
+		SR_CONF_AVERAGING, TRUE) == SR_OK);
+	fail_unless(sr_config_get_bool(driver, sdi, NULL,
+		SR_CONF_AVERAGING, &avg) == SR_OK);
+	fail_unless(avg == TRUE);
+
+	/* Values in the config cache get unboxed. */
+	fail_unless(sr_config_cache_enable(sdi, TRUE) == SR_OK);
+	fail_unless(sr_config_get_u64(driver, sdi, NULL,
+		SR_CONF_SAMPLERATE, &value) == SR_OK);
+	fail_unless(sr_config_get_u64(driver, sdi, NULL,
+		SR_CONF_SAMPLERATE, &value) == SR_OK);
+	fail_unless(value == SR_KHZ(250));
+
+	sr_dev_close(sdi);
+}
+END_TEST
+
 Suite *suite_device(void)
 {
 	Suite *s;
@@ -76,5 +196,15 @@ Suite *suite_device(void)
 	tcase_add_test(tc, test_channel_add);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("config_cache");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_config_cache);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("config_typed");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_config_typed);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
@@ -19,6 +19,7 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -40,6 +41,58 @@ START_TEST(test_driver_init_all)
 }
 END_TEST
 
+/* Check the concurrent scan of several drivers, with the demo driver. */
+START_TEST(test_driver_scan_all)
+{
+	struct sr_dev_driver **drivers, *list[2];
+	struct sr_dev_inst *sdi;
+	struct sr_config src;
+	GSList *devices, *options, *l;
+	int i;
+
+	fail_unless(sr_driver_scan_all(NULL, NULL, NULL, 0, 0) == NULL);
+
+	drivers = sr_driver_list(srtest_ctx);
+	for (i = 0; drivers && drivers[i]; i++) {
+		if (!strcmp(drivers[i]->name, "demo"))
+			break;
+	}
+	if (!drivers || !drivers[i])
+		return;
+	list[0] = drivers[i];
+	list[1] = NULL;
+
+	/* Uninitialized drivers get skipped. */
+	fail_unless(sr_driver_scan_all(srtest_ctx, list, NULL, 0, 0) == NULL,
+		"Uninitialized driver got scanned.");
+
+	srtest_driver_init(srtest_ctx, list[0]);
+	devices = sr_driver_scan_all(srtest_ctx, list, NULL, 5000, 0);
+	fail_unless(devices != NULL, "No demo device found.");
+	for (l = devices; l; l = l->next) {
+		sdi = l->data;
+		fail_unless(sr_dev_inst_driver_get(sdi) == list[0]);
+		fail_unless(g_slist_find(sr_dev_list(list[0]), sdi) != NULL,
+			"Device not in the driver's list.");
+	}
+	g_slist_free(devices);
+
+	/* Drivers which do not support all of the options get skipped. */
+	src.key = SR_CONF_CONN;
+	src.data = g_variant_ref_sink(g_variant_new_string("none"));
+	options = g_slist_append(NULL, &src);
+	devices = sr_driver_scan_all(srtest_ctx, list, options, 0,
+		SR_SCAN_CACHE_NEGATIVE);
+	fail_unless(devices == NULL, "Unsupported option got passed.");
+	g_slist_free(options);
+	g_variant_unref(src.data);
+	sr_driver_scan_cache_clear(srtest_ctx);
+
+	fail_unless(sr_dev_clear(list[0]) == SR_OK);
+	fail_unless(sr_dev_list(list[0]) == NULL);
+}
+END_TEST
+
 /*
  * Check whether setting a samplerate works.
  *
@@ -70,6 +123,7 @@ Suite *suite_driver_all(void)
 	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
 	tcase_add_test(tc, test_driver_available);
 	tcase_add_test(tc, test_driver_init_all);
+	tcase_add_test(tc, test_driver_scan_all);
 	// TODO: Currently broken.
 	// tcase_add_test(tc, test_config_get_set_samplerate);
 	suite_add_tcase(s, tc);
@@ -19,6 +19,7 @@
 
 #include <config.h>
 #include <check.h>
+#include <string.h>
 #include <glib/gstdio.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -308,6 +309,69 @@ START_TEST(test_input_binary_hello_world)
 }
 END_TEST
 
+/* Convert binary files to binary output in parallel, which copies them. */
+START_TEST(test_input_binary_batch_convert)
+{
+	struct sr_convert_job jobs[5];
+	char *in_names[4], *out_names[5], *data;
+	gsize len;
+	uint8_t *buf;
+	size_t i, j, size;
+	int ret;
+
+	memset(jobs, 0, sizeof(jobs));
+	for (i = 0; i < G_N_ELEMENTS(jobs); i++) {
+		out_names[i] = g_strdup_printf("%s/sr-test-batch-%zu.out",
+			g_get_tmp_dir(), i);
+		jobs[i].output = sr_output_find("binary");
+		jobs[i].output_filename = out_names[i];
+	}
+	for (i = 0; i < G_N_ELEMENTS(in_names); i++) {
+		in_names[i] = g_strdup_printf("%s/sr-test-batch-%zu.bin",
+			g_get_tmp_dir(), i);
+		size = 1000 + i * 100000;
+		buf = g_malloc(size);
+		for (j = 0; j < size; j++)
+			buf[j] = j * (i + 1);
+		fail_unless(g_file_set_contents(in_names[i], (char *)buf,
+			size, NULL));
+		g_free(buf);
+		jobs[i].input_filename = in_names[i];
+		jobs[i].input = sr_input_find("binary");
+	}
+	/* A missing file fails its job, but not the others. */
+	jobs[4].input_filename = "/nonexistent/sr-test-batch.bin";
+	jobs[4].input = sr_input_find("binary");
+
+	ret = sr_batch_convert(srtest_ctx, jobs, G_N_ELEMENTS(jobs), 2);
+	fail_unless(ret != SR_OK, "A failed job went unnoticed.");
+	fail_unless(jobs[4].result != SR_OK);
+	for (i = 0; i < G_N_ELEMENTS(in_names); i++) {
+		size = 1000 + i * 100000;
+		fail_unless(jobs[i].result == SR_OK, "Job %zu failed: %d.",
+			i, jobs[i].result);
+		fail_unless(jobs[i].bytes_in == size);
+		fail_unless(jobs[i].bytes_out == size);
+		fail_unless(jobs[i].samples == size, "Wrong sample count %"
+			PRIu64 ".", jobs[i].samples);
+		fail_unless(g_file_get_contents(out_names[i], &data, &len, NULL));
+		fail_unless(len == size, "Wrong output size %zu.", (size_t)len);
+		for (j = 0; j < size; j++)
+			fail_unless((uint8_t)data[j] == (uint8_t)(j * (i + 1)));
+		g_free(data);
+		g_remove(in_names[i]);
+		g_free(in_names[i]);
+	}
+	for (i = 0; i < G_N_ELEMENTS(jobs); i++) {
+		g_remove(out_names[i]);
+		g_free(out_names[i]);
+	}
+
+	ret = sr_batch_convert(srtest_ctx, NULL, 1, 0);
+	fail_unless(ret == SR_ERR_ARG, "Converting NULL jobs worked.");
+}
+END_TEST
+
 Suite *suite_input_binary(void)
 {
 	Suite *s;
@@ -321,6 +385,7 @@ Suite *suite_input_binary(void)
 	tcase_add_test(tc, test_input_binary_all_high);
 	tcase_add_loop_test(tc, test_input_binary_all_high_loop, 1, 10);
 	tcase_add_test(tc, test_input_binary_hello_world);
+	tcase_add_test(tc, test_input_binary_batch_convert);
 	suite_add_tcase(s, tc);
 
 	return s;
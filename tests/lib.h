@@ -54,5 +54,9 @@ Suite *suite_device(void);
 Suite *suite_trigger(void);
 Suite *suite_analog(void);
 Suite *suite_conv(void);
+Suite *suite_logic_store(void);
+Suite *suite_logic_edges(void);
+Suite *suite_remote(void);
+Suite *suite_recorder(void);
 
 #endif
@@ -0,0 +1,142 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+
+#define NUM_SAMPLES 1000
+
+/* Channel 0 has a period of 10 samples, high for 3, starting high. */
+static void make_samples(uint8_t *data)
+{
+	size_t i;
+
+	for (i = 0; i < NUM_SAMPLES; i++)
+		data[i] = (i % 10 < 3) | (((i / 50) & 1) << 3);
+}
+
+static void feed(struct sr_logic_edges *edges, uint8_t *data, size_t len)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+
+	logic.data = data;
+	logic.length = len;
+	logic.unitsize = 1;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	fail_unless(sr_logic_edges_feed(edges, &packet) == SR_OK);
+}
+
+/* Check the edges and the timing of packets fed in chunks. */
+START_TEST(test_edges_timing)
+{
+	struct sr_logic_edges *edges;
+	struct sr_logic_timing timing;
+	uint8_t data[NUM_SAMPLES];
+	const uint64_t *pos;
+	size_t count;
+	gboolean rising;
+
+	make_samples(data);
+	fail_unless(sr_logic_edges_new(&edges, 4) == SR_OK);
+	feed(edges, data, 400);
+
+	/* The first sample sets the level, and is no edge. */
+	fail_unless(sr_logic_edges_get(edges, 0, &pos, &count, &rising) == SR_OK);
+	fail_unless(count == 79);
+	fail_unless(pos[0] == 3 && !rising);
+	fail_unless(pos[1] == 10);
+
+	fail_unless(sr_logic_edges_timing(edges, 0, &timing) == SR_OK);
+	fail_unless(timing.periods == 38);
+	fail_unless(timing.period_min == 10 && timing.period_max == 10);
+	fail_unless(timing.high == 3);
+	fail_unless(timing.duty_cycle == 0.3);
+
+	/* Periods across the point of clearing still count. */
+	fail_unless(sr_logic_edges_clear(edges, 2) == SR_OK);
+	feed(edges, data + 400, NUM_SAMPLES - 400);
+	fail_unless(sr_logic_edges_timing(edges, 0, &timing) == SR_OK);
+	fail_unless(timing.edges == 122);
+	fail_unless(timing.periods == 60);
+
+	fail_unless(sr_logic_edges_timing(edges, 3, &timing) == SR_OK);
+	fail_unless(timing.period == 100 && timing.duty_cycle == 0.5);
+
+	/* No edges on a constant channel. */
+	fail_unless(sr_logic_edges_timing(edges, 1, &timing) == SR_ERR_NA);
+	fail_unless(timing.edges == 0);
+
+	sr_logic_edges_free(edges);
+}
+END_TEST
+
+START_TEST(test_edges_invalid)
+{
+	struct sr_logic_edges *edges;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint8_t data[4];
+	const uint64_t *pos;
+	size_t count;
+
+	fail_unless(sr_logic_edges_new(&edges, 0) == SR_ERR_ARG);
+	fail_unless(sr_logic_edges_new(NULL, 1) == SR_ERR_ARG);
+	fail_unless(sr_logic_edges_new(&edges, 8) == SR_OK);
+
+	memset(data, 0, sizeof(data));
+	logic.data = data;
+	logic.length = sizeof(data);
+	logic.unitsize = 2;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	fail_unless(sr_logic_edges_feed(edges, &packet) == SR_OK);
+	/* The unitsize must not change. */
+	logic.unitsize = 1;
+	fail_unless(sr_logic_edges_feed(edges, &packet) == SR_ERR_ARG);
+	packet.type = SR_DF_ANALOG;
+	fail_unless(sr_logic_edges_feed(edges, &packet) == SR_ERR_ARG);
+
+	fail_unless(sr_logic_edges_get(edges, 8, &pos, &count, NULL) == SR_ERR_ARG);
+	fail_unless(sr_logic_edges_get(edges, 7, &pos, &count, NULL) == SR_OK);
+	fail_unless(count == 0);
+
+	sr_logic_edges_free(edges);
+	sr_logic_edges_free(NULL);
+}
+END_TEST
+
+Suite *suite_logic_edges(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("logic_edges");
+
+	tc = tcase_create("edges");
+	tcase_add_test(tc, test_edges_timing);
+	tcase_add_test(tc, test_edges_invalid);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
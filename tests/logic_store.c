@@ -0,0 +1,172 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+
+/* Spans several store blocks, and ends in a partial one. */
+#define NUM_SAMPLES (200 * 1024 + 123)
+#define UNITSIZE 2
+
+/* Quiet lines for the first three quarters, then noise. */
+static uint8_t *make_samples(void)
+{
+	uint8_t *data;
+	size_t i;
+
+	data = g_malloc(NUM_SAMPLES * UNITSIZE);
+	for (i = 0; i < NUM_SAMPLES; i++) {
+		if (i < NUM_SAMPLES / 4 * 3) {
+			data[2 * i] = (i / 1000) & 1;
+			data[2 * i + 1] = 0x80;
+		} else {
+			data[2 * i] = g_random_int();
+			data[2 * i + 1] = g_random_int();
+		}
+	}
+
+	return data;
+}
+
+/* Check that data appended in odd chunks reads back unchanged. */
+START_TEST(test_store_roundtrip)
+{
+	struct sr_logic_store *store;
+	uint8_t *data, *buf;
+	uint64_t pos, len;
+	int ret;
+
+	data = make_samples();
+	ret = sr_logic_store_new(&store, 0);
+	fail_unless(ret == SR_OK);
+
+	for (pos = 0; pos < NUM_SAMPLES; pos += len) {
+		len = MIN(NUM_SAMPLES - pos, 7777);
+		ret = sr_logic_store_append(store, &data[pos * UNITSIZE],
+			len * UNITSIZE, UNITSIZE);
+		fail_unless(ret == SR_OK);
+	}
+	fail_unless(sr_logic_store_samples(store) == NUM_SAMPLES);
+	fail_unless(sr_logic_store_unitsize(store) == UNITSIZE);
+	fail_unless(sr_logic_store_size(store) < NUM_SAMPLES * UNITSIZE);
+
+	buf = g_malloc(NUM_SAMPLES * UNITSIZE);
+	ret = sr_logic_store_read(store, 0, NUM_SAMPLES, buf);
+	fail_unless(ret == SR_OK);
+	fail_unless(memcmp(buf, data, NUM_SAMPLES * UNITSIZE) == 0);
+
+	/* Ranges which straddle block boundaries. */
+	ret = sr_logic_store_read(store, 65530, 70000, buf);
+	fail_unless(ret == SR_OK);
+	fail_unless(memcmp(buf, &data[65530 * UNITSIZE],
+		70000 * UNITSIZE) == 0);
+	ret = sr_logic_store_read(store, NUM_SAMPLES - 200, 200, buf);
+	fail_unless(ret == SR_OK);
+	fail_unless(memcmp(buf, &data[(NUM_SAMPLES - 200) * UNITSIZE],
+		200 * UNITSIZE) == 0);
+
+	sr_logic_store_free(store);
+	g_free(buf);
+	g_free(data);
+}
+END_TEST
+
+/* Check that run-length encoded packets get expanded. */
+START_TEST(test_store_rle_packet)
+{
+	struct sr_logic_store *store;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic_rle rle;
+	uint64_t offsets[] = { 0, 10, 100000 };
+	uint8_t values[] = { 0x01, 0x02, 0x03 };
+	uint8_t buf[4];
+	int ret;
+
+	ret = sr_logic_store_new(&store, 1);
+	fail_unless(ret == SR_OK);
+
+	rle.num_samples = 100002;
+	rle.unitsize = 1;
+	rle.num_changes = 3;
+	rle.offsets = offsets;
+	rle.values = values;
+	packet.type = SR_DF_LOGIC_RLE;
+	packet.payload = &rle;
+	ret = sr_logic_store_append_packet(store, &packet);
+	fail_unless(ret == SR_OK);
+	fail_unless(sr_logic_store_samples(store) == 100002);
+
+	ret = sr_logic_store_read(store, 8, 4, buf);
+	fail_unless(ret == SR_OK);
+	fail_unless(buf[0] == 0x01 && buf[1] == 0x01);
+	fail_unless(buf[2] == 0x02 && buf[3] == 0x02);
+	ret = sr_logic_store_read(store, 99998, 4, buf);
+	fail_unless(ret == SR_OK);
+	fail_unless(buf[0] == 0x02 && buf[1] == 0x02);
+	fail_unless(buf[2] == 0x03 && buf[3] == 0x03);
+
+	sr_logic_store_free(store);
+}
+END_TEST
+
+/* Check that invalid arguments and ranges get rejected. */
+START_TEST(test_store_invalid)
+{
+	struct sr_logic_store *store;
+	uint8_t data[8], buf[8];
+	int ret;
+
+	memset(data, 0, sizeof(data));
+	fail_unless(sr_logic_store_new(NULL, 1) == SR_ERR_ARG);
+	ret = sr_logic_store_new(&store, 2);
+	fail_unless(ret == SR_OK);
+
+	fail_unless(sr_logic_store_append(store, data, 7, 2) == SR_ERR_ARG);
+	fail_unless(sr_logic_store_append(store, data, 8, 4) == SR_ERR_ARG);
+	fail_unless(sr_logic_store_append(store, data, 8, 2) == SR_OK);
+
+	fail_unless(sr_logic_store_read(store, 0, 4, buf) == SR_OK);
+	fail_unless(sr_logic_store_read(store, 1, 4, buf) == SR_ERR_ARG);
+	fail_unless(sr_logic_store_read(store, 5, 0, buf) == SR_ERR_ARG);
+	fail_unless(sr_logic_store_read(NULL, 0, 1, buf) == SR_ERR_ARG);
+
+	sr_logic_store_free(store);
+	sr_logic_store_free(NULL);
+}
+END_TEST
+
+Suite *suite_logic_store(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("logic_store");
+
+	tc = tcase_create("store");
+	tcase_add_test(tc, test_store_roundtrip);
+	tcase_add_test(tc, test_store_rle_packet);
+	tcase_add_test(tc, test_store_invalid);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
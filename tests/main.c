@@ -46,6 +46,10 @@ int main(void)
 	srunner_add_suite(srunner, suite_trigger());
 	srunner_add_suite(srunner, suite_analog());
 	srunner_add_suite(srunner, suite_conv());
+	srunner_add_suite(srunner, suite_logic_store());
+	srunner_add_suite(srunner, suite_logic_edges());
+	srunner_add_suite(srunner, suite_remote());
+	srunner_add_suite(srunner, suite_recorder());
 
 	srunner_run_all(srunner, CK_VERBOSE);
 	ret = srunner_ntests_failed(srunner);
@@ -19,6 +19,8 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -96,6 +98,60 @@ START_TEST(test_output_options)
 }
 END_TEST
 
+/* Check that the generic "compress" option is offered where it applies. */
+START_TEST(test_output_compress_option)
+{
+	const struct sr_option **opts;
+	gboolean found;
+	int i;
+
+	opts = sr_output_options_get(sr_output_find("vcd"));
+	fail_unless(opts != NULL, "Couldn't find 'vcd' options.");
+	for (found = FALSE, i = 0; opts[i]; i++)
+		found |= !strcmp(opts[i]->id, "compress");
+	sr_output_options_free(opts);
+	fail_unless(found, "No 'compress' option for 'vcd'.");
+
+	opts = sr_output_options_get(sr_output_find("srzip"));
+	for (found = FALSE, i = 0; opts && opts[i]; i++)
+		found |= !strcmp(opts[i]->id, "compress");
+	sr_output_options_free(opts);
+	fail_unless(!found, "'srzip' writes its own file, cannot compress.");
+}
+END_TEST
+
+/* Check that disk sinks create their file, and keep statistics. */
+START_TEST(test_output_disk_sink)
+{
+	struct sr_output_sink *sink;
+	struct sr_disk_stats stats;
+	GStatBuf st;
+	char *filename;
+	int fd, ret;
+
+	fd = g_file_open_tmp("sigrok-test-XXXXXX", &filename, NULL);
+	fail_unless(fd >= 0, "Cannot create temporary file.");
+	close(fd);
+
+	sink = sr_output_sink_disk_new(filename, TRUE, SR_DISK_SYNC_CLOSE);
+	fail_unless(sink != NULL, "Cannot create disk sink.");
+	ret = sr_output_sink_disk_stats(sink, &stats);
+	fail_unless(ret == SR_OK, "sr_output_sink_disk_stats() failed: %d.", ret);
+	fail_unless(stats.bytes == 0 && stats.writes == 0, "Wrong statistics.");
+	sr_output_sink_free(sink);
+	fail_unless(g_stat(filename, &st) == 0 && st.st_size == 0,
+		"Wrong file size.");
+
+	sink = sr_output_sink_buffer_new();
+	ret = sr_output_sink_disk_stats(sink, &stats);
+	fail_unless(ret == SR_ERR_ARG, "Buffer sink has disk statistics.");
+	sr_output_sink_free(sink);
+
+	g_unlink(filename);
+	g_free(filename);
+}
+END_TEST
+
 Suite *suite_output_all(void)
 {
 	Suite *s;
@@ -110,6 +166,8 @@ Suite *suite_output_all(void)
 	tcase_add_test(tc, test_output_desc);
 	tcase_add_test(tc, test_output_find);
 	tcase_add_test(tc, test_output_options);
+	tcase_add_test(tc, test_output_compress_option);
+	tcase_add_test(tc, test_output_disk_sink);
 	suite_add_tcase(s, tc);
 
 	return s;
@@ -0,0 +1,300 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+#include "libsigrok-internal.h"
+
+#define PACKET_SAMPLES 1000
+#define NUM_PACKETS 10
+/* Bookkeeping which the recorder accounts for every packet. */
+#define CHUNK_OVERHEAD 64
+
+/* Sent at this sample, the only one which has channel 0 high. */
+#define TRIGGER_SAMPLE 5300
+#define POST_TRIGGER 1500
+
+struct trigger_snapshot {
+	const struct sr_dev_inst *sdi;
+	GString *out;
+	int fired;
+};
+
+static void source_send(struct sr_input *in, const uint8_t *data, size_t len)
+{
+	GString *buf;
+	int ret;
+
+	buf = g_string_new_len((const char *)data, len);
+	ret = sr_input_send(in, buf);
+	fail_unless(ret == SR_OK, "sr_input_send() failed: %d.", ret);
+	g_string_free(buf, TRUE);
+}
+
+/*
+ * A session with a binary input device, which gets recorded. The device
+ * gets ready with the first data, later data gets sent right away.
+ */
+static struct sr_input *source_input(struct sr_session **sess,
+		struct sr_recorder *rec)
+{
+	struct sr_input *in;
+	int ret;
+
+	in = sr_input_new(sr_input_find("binary"), NULL);
+	fail_unless(in != NULL, "Failed to create input instance.");
+	sr_session_new(srtest_ctx, sess);
+	sr_session_dev_add(*sess, sr_input_dev_inst_get(in));
+	ret = sr_recorder_attach(rec, *sess);
+	fail_unless(ret == SR_OK, "sr_recorder_attach() failed: %d.", ret);
+	source_send(in, NULL, 0);
+
+	return in;
+}
+
+/* Sample data which differs from packet to packet. */
+static uint8_t *samples_new(size_t count)
+{
+	uint8_t *data;
+	size_t i;
+
+	data = g_malloc(count);
+	for (i = 0; i < count; i++)
+		data[i] = ((i / PACKET_SAMPLES) << 4 | (i % 7) << 1) & 0xfe;
+
+	return data;
+}
+
+static GString *snapshot(struct sr_recorder *rec,
+		const struct sr_dev_inst *sdi)
+{
+	const struct sr_output *o;
+	GString *out;
+	int ret;
+
+	o = sr_output_new(sr_output_find("binary"), NULL, sdi, NULL);
+	fail_unless(o != NULL, "Failed to create output instance.");
+	out = NULL;
+	ret = sr_recorder_snapshot(rec, o, &out);
+	fail_unless(ret == SR_OK, "sr_recorder_snapshot() failed: %d.", ret);
+	fail_unless(out != NULL, "The snapshot has no output.");
+	sr_output_free(o);
+
+	return out;
+}
+
+/* Check that the recorder keeps the most recent packets only. */
+START_TEST(test_recorder_wrap)
+{
+	struct sr_recorder *rec;
+	struct sr_session *sess;
+	struct sr_input *in;
+	uint8_t *data;
+	GString *out;
+	size_t kept;
+	int ret, i;
+
+	/* Room for four packets. */
+	kept = 4;
+	ret = sr_recorder_new(&rec, kept * (PACKET_SAMPLES + CHUNK_OVERHEAD),
+		FALSE);
+	fail_unless(ret == SR_OK, "sr_recorder_new() failed: %d.", ret);
+	in = source_input(&sess, rec);
+
+	data = samples_new(NUM_PACKETS * PACKET_SAMPLES);
+	for (i = 0; i < NUM_PACKETS; i++) {
+		source_send(in, data + i * PACKET_SAMPLES, PACKET_SAMPLES);
+		if (i != 1)
+			continue;
+		/* Nothing was dropped yet. */
+		out = snapshot(rec, sr_input_dev_inst_get(in));
+		fail_unless(out->len == 2 * PACKET_SAMPLES,
+			"Got %zu bytes before the wrap.", out->len);
+		fail_unless(!memcmp(out->str, data, out->len),
+			"The snapshot differs before the wrap.");
+		g_string_free(out, TRUE);
+	}
+
+	out = snapshot(rec, sr_input_dev_inst_get(in));
+	fail_unless(out->len == kept * PACKET_SAMPLES,
+		"Got %zu bytes after the wrap.", out->len);
+	fail_unless(!memcmp(out->str,
+		data + (NUM_PACKETS - kept) * PACKET_SAMPLES, out->len),
+		"The snapshot doesn't hold the most recent packets.");
+	g_string_free(out, TRUE);
+
+	/* Recording continues after a snapshot. */
+	source_send(in, data, PACKET_SAMPLES);
+	out = snapshot(rec, sr_input_dev_inst_get(in));
+	fail_unless(out->len == kept * PACKET_SAMPLES);
+	fail_unless(!memcmp(out->str + (kept - 1) * PACKET_SAMPLES, data,
+		PACKET_SAMPLES), "The latest packet is missing.");
+	g_string_free(out, TRUE);
+
+	sr_session_destroy(sess);
+	sr_input_free(in);
+	sr_recorder_free(rec);
+	g_free(data);
+}
+END_TEST
+
+static void trigger_cb(struct sr_recorder *rec, void *cb_data)
+{
+	struct trigger_snapshot *snap;
+
+	snap = cb_data;
+	snap->fired++;
+	if (!snap->out)
+		snap->out = snapshot(rec, snap->sdi);
+}
+
+/*
+ * Check that the window which a trigger snapshots holds the samples
+ * before the trigger, and the requested samples after it.
+ */
+START_TEST(test_recorder_trigger)
+{
+	struct sr_recorder *rec;
+	struct sr_session *sess;
+	struct sr_input *in;
+	struct sr_trigger *trig;
+	struct sr_channel *ch;
+	struct trigger_snapshot snap;
+	uint8_t *data;
+	size_t first, last;
+	int ret, i;
+
+	/* Room for three packets, the trigger is in the second to last. */
+	ret = sr_recorder_new(&rec, 3 * (PACKET_SAMPLES + CHUNK_OVERHEAD),
+		FALSE);
+	fail_unless(ret == SR_OK, "sr_recorder_new() failed: %d.", ret);
+	in = source_input(&sess, rec);
+
+	ch = sr_dev_inst_channels_get(sr_input_dev_inst_get(in))->data;
+	trig = sr_trigger_new("T1");
+	sr_trigger_match_add(sr_trigger_stage_add(trig), ch, SR_TRIGGER_ONE, 0);
+	memset(&snap, 0, sizeof(snap));
+	snap.sdi = sr_input_dev_inst_get(in);
+	fail_unless(sr_recorder_trigger_set(rec, trig, POST_TRIGGER,
+		NULL, NULL) == SR_ERR_ARG);
+	ret = sr_recorder_trigger_set(rec, trig, POST_TRIGGER, trigger_cb,
+		&snap);
+	fail_unless(ret == SR_OK, "sr_recorder_trigger_set() failed: %d.", ret);
+
+	data = samples_new(NUM_PACKETS * PACKET_SAMPLES);
+	data[TRIGGER_SAMPLE] |= 1;
+	for (i = 0; i < NUM_PACKETS; i++)
+		source_send(in, data + i * PACKET_SAMPLES, PACKET_SAMPLES);
+	ret = sr_input_end(in);
+	fail_unless(ret == SR_OK, "sr_input_end() failed: %d.", ret);
+
+	/* The post-trigger samples complete in the packet after the trigger. */
+	fail_unless(snap.fired == 1, "The trigger fired %d times.", snap.fired);
+	last = (TRIGGER_SAMPLE / PACKET_SAMPLES + 2) * PACKET_SAMPLES;
+	first = last - 3 * PACKET_SAMPLES;
+	fail_unless(snap.out->len == last - first,
+		"Got %zu bytes in the trigger snapshot.", snap.out->len);
+	fail_unless(!memcmp(snap.out->str, data + first, snap.out->len),
+		"The trigger snapshot differs.");
+	fail_unless(first < TRIGGER_SAMPLE && last >= TRIGGER_SAMPLE + POST_TRIGGER,
+		"The window doesn't span the trigger.");
+	g_string_free(snap.out, TRUE);
+
+	sr_session_destroy(sess);
+	sr_input_free(in);
+	sr_recorder_trigger_set(rec, NULL, 0, NULL, NULL);
+	sr_trigger_free(trig);
+	sr_recorder_free(rec);
+	g_free(data);
+}
+END_TEST
+
+/*
+ * Check that packets in pool buffers which are larger than the whole
+ * memory budget get copied instead of shared. Shared, each of them
+ * would account for the full buffer and evict all older packets.
+ */
+START_TEST(test_recorder_pool_copy)
+{
+	struct sr_recorder *rec;
+	struct sr_session *sess;
+	struct sr_input *in;
+	struct feed_queue_logic *q;
+	uint8_t *data;
+	GString *out;
+	size_t count;
+	int ret, i;
+
+	/* Room for five small packets, the pool buffers are much larger. */
+	count = 100;
+	ret = sr_recorder_new(&rec, 5 * (count + CHUNK_OVERHEAD), FALSE);
+	fail_unless(ret == SR_OK, "sr_recorder_new() failed: %d.", ret);
+	in = source_input(&sess, rec);
+
+	q = feed_queue_logic_alloc(sr_input_dev_inst_get(in), 64 * 1024, 1);
+	fail_unless(q != NULL, "Failed to create feed queue.");
+	ret = feed_queue_logic_use_pool(q, 2);
+	fail_unless(ret == SR_OK, "feed_queue_logic_use_pool() failed: %d.", ret);
+
+	data = samples_new(5 * PACKET_SAMPLES);
+	for (i = 0; i < 5; i++) {
+		feed_queue_logic_submit_many(q, data + i * PACKET_SAMPLES, count);
+		ret = feed_queue_logic_flush(q);
+		fail_unless(ret == SR_OK, "feed_queue_logic_flush() failed: %d.",
+			ret);
+	}
+	/* The queue reuses its buffer, which must not change the recording. */
+	memset(feed_queue_logic_get_buffer(q, NULL), 0xff, count);
+
+	out = snapshot(rec, sr_input_dev_inst_get(in));
+	fail_unless(out->len == 5 * count,
+		"Got %zu of %zu bytes.", out->len, 5 * count);
+	for (i = 0; i < 5; i++)
+		fail_unless(!memcmp(out->str + i * count,
+			data + i * PACKET_SAMPLES, count),
+			"Packet %d differs.", i);
+	g_string_free(out, TRUE);
+
+	feed_queue_logic_free(q);
+	sr_session_destroy(sess);
+	sr_input_free(in);
+	sr_recorder_free(rec);
+	g_free(data);
+}
+END_TEST
+
+Suite *suite_recorder(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("recorder");
+
+	tc = tcase_create("record");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_recorder_wrap);
+	tcase_add_test(tc, test_recorder_trigger);
+	tcase_add_test(tc, test_recorder_pool_copy);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,591 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+#include "libsigrok-internal.h"
+
+#define SERVER_PORT_FIRST 41230
+#define SERVER_PORT_COUNT 50
+#define NUM_SAMPLES (64 * 1024)
+
+struct client_feed {
+	GByteArray *logic;
+	int headers;
+	int ends;
+};
+
+/* A server which sends prepared frames to the remote driver. */
+struct fake_server {
+	int listen_fd;
+	const GByteArray *hello;
+	const GByteArray *data;
+	gboolean hangup;
+};
+
+static struct sr_dev_driver *remote_driver(void)
+{
+	struct sr_dev_driver **drivers;
+	int i;
+
+	drivers = sr_driver_list(srtest_ctx);
+	for (i = 0; drivers && drivers[i]; i++) {
+		if (!strcmp(drivers[i]->name, "remote"))
+			break;
+	}
+	if (!drivers || !drivers[i])
+		return NULL;
+	srtest_driver_init(srtest_ctx, drivers[i]);
+
+	return drivers[i];
+}
+
+/* Listen on a free port of the loopback interface. */
+static struct sr_remote_server *server_new(gboolean compress, char *port,
+		size_t port_size)
+{
+	struct sr_remote_server *server;
+	int i;
+
+	for (i = 0; i < SERVER_PORT_COUNT; i++) {
+		g_snprintf(port, port_size, "%d", SERVER_PORT_FIRST + i);
+		if (sr_remote_server_new(&server, "127.0.0.1", port,
+				compress) == SR_OK)
+			return server;
+	}
+	fail("No free port for the remote server.");
+
+	return NULL;
+}
+
+static struct sr_dev_inst *remote_scan_conn(struct sr_dev_driver *driver,
+		const char *conn)
+{
+	struct sr_config src;
+	struct sr_dev_inst *sdi;
+	GSList *options, *devices;
+
+	src.key = SR_CONF_CONN;
+	src.data = g_variant_ref_sink(g_variant_new_string(conn));
+	options = g_slist_append(NULL, &src);
+	devices = sr_driver_scan(driver, options);
+	g_slist_free(options);
+	g_variant_unref(src.data);
+
+	fail_unless(g_slist_length(devices) == 1, "No remote device at %s.",
+		conn);
+	sdi = devices->data;
+	g_slist_free(devices);
+
+	return sdi;
+}
+
+static struct sr_dev_inst *remote_scan(struct sr_dev_driver *driver,
+		const char *port)
+{
+	struct sr_dev_inst *sdi;
+	char *conn;
+
+	conn = g_strdup_printf("tcp/127.0.0.1/%s", port);
+	sdi = remote_scan_conn(driver, conn);
+	g_free(conn);
+
+	return sdi;
+}
+
+static void client_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+	struct client_feed *feed;
+
+	(void)sdi;
+
+	feed = cb_data;
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		feed->headers++;
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		g_byte_array_append(feed->logic, logic->data, logic->length);
+		break;
+	case SR_DF_END:
+		feed->ends++;
+		break;
+	}
+}
+
+static struct sr_session *client_start(struct sr_dev_inst *sdi,
+		struct client_feed *feed)
+{
+	struct sr_session *sess;
+	int ret;
+
+	memset(feed, 0, sizeof(*feed));
+	feed->logic = g_byte_array_new();
+	sr_session_new(srtest_ctx, &sess);
+	sr_session_dev_add(sess, sdi);
+	sr_session_datafeed_callback_add(sess, client_datafeed, feed);
+	fail_unless(sr_dev_open(sdi) == SR_OK, "Cannot open remote device.");
+	ret = sr_session_start(sess);
+	fail_unless(ret == SR_OK, "Cannot start remote session: %d.", ret);
+
+	return sess;
+}
+
+static void client_finish(struct sr_session *sess, struct sr_dev_inst *sdi,
+		struct client_feed *feed)
+{
+	int ret;
+
+	ret = sr_session_run(sess);
+	fail_unless(ret == SR_OK, "Remote session failed: %d.", ret);
+	fail_unless(feed->headers == 1, "Got %d headers.", feed->headers);
+	fail_unless(feed->ends == 1, "Got %d ends.", feed->ends);
+	sr_session_destroy(sess);
+	sr_dev_close(sdi);
+}
+
+static void source_send(struct sr_input *in, const uint8_t *data, size_t len)
+{
+	GString *buf;
+	int ret;
+
+	buf = g_string_new_len((const char *)data, len);
+	ret = sr_input_send(in, buf);
+	fail_unless(ret == SR_OK, "sr_input_send() failed: %d.", ret);
+	g_string_free(buf, TRUE);
+}
+
+/*
+ * A session with a binary input device, the source of the datafeed.
+ * The device gets ready with the first data, later data gets sent
+ * right away.
+ */
+static struct sr_input *source_input(struct sr_session **sess)
+{
+	struct sr_input *in;
+
+	in = sr_input_new(sr_input_find("binary"), NULL);
+	fail_unless(in != NULL, "Failed to create input instance.");
+	sr_session_new(srtest_ctx, sess);
+	sr_session_dev_add(*sess, sr_input_dev_inst_get(in));
+	source_send(in, NULL, 0);
+
+	return in;
+}
+
+/*
+ * Check that a client gets the datafeed of the server unchanged, with
+ * and without compression.
+ */
+START_TEST(test_remote_loopback)
+{
+	struct sr_dev_driver *driver;
+	struct sr_remote_server *server;
+	struct sr_session *srv_sess, *sess;
+	struct sr_dev_inst *sdi;
+	struct sr_input *in;
+	struct client_feed feed;
+	uint8_t *data;
+	char port[8];
+	int compress, ret;
+	size_t i;
+
+	if (!(driver = remote_driver()))
+		return;
+
+	/* Compresses well, but is not all the same. */
+	data = g_malloc(NUM_SAMPLES);
+	for (i = 0; i < NUM_SAMPLES; i++)
+		data[i] = (i / 100) & 0xff;
+
+	for (compress = 0; compress < 2; compress++) {
+		server = server_new(compress, port, sizeof(port));
+		in = source_input(&srv_sess);
+		fail_unless(sr_remote_server_attach(server, srv_sess) == SR_OK);
+		sdi = remote_scan(driver, port);
+		fail_unless(g_slist_length(sr_dev_inst_channels_get(sdi)) == 8,
+			"The greeting has the wrong channels.");
+
+		sess = client_start(sdi, &feed);
+		fail_unless(sr_remote_server_clients(server) >= 1,
+			"The server lost its client.");
+		source_send(in, data, NUM_SAMPLES);
+		ret = sr_input_end(in);
+		fail_unless(ret == SR_OK, "sr_input_end() failed: %d.", ret);
+		client_finish(sess, sdi, &feed);
+
+		fail_unless(feed.logic->len == NUM_SAMPLES,
+			"Got %u of %d samples.", feed.logic->len, NUM_SAMPLES);
+		fail_unless(!memcmp(feed.logic->data, data, NUM_SAMPLES),
+			"The samples differ.");
+		g_byte_array_free(feed.logic, TRUE);
+
+		sr_input_free(in);
+		sr_session_destroy(srv_sess);
+		sr_remote_server_free(server);
+	}
+
+	g_free(data);
+}
+END_TEST
+
+static int loopback_connect(int port)
+{
+	struct sockaddr_in addr;
+	int fd;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	fail_unless(fd >= 0, "Cannot create a socket.");
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	fail_unless(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0,
+		"Cannot connect to port %d.", port);
+
+	return fd;
+}
+
+static void recv_all(int fd, uint8_t *p, size_t len)
+{
+	ssize_t n;
+
+	while (len) {
+		n = recv(fd, p, len, 0);
+		fail_unless(n > 0, "Connection closed.");
+		p += n;
+		len -= n;
+	}
+}
+
+static void send_all(int fd, const uint8_t *p, size_t len)
+{
+	ssize_t n;
+
+	while (len) {
+		n = send(fd, p, len, 0);
+		fail_unless(n > 0, "Connection closed.");
+		p += n;
+		len -= n;
+	}
+}
+
+/* Take the greeting of a real server, for the fake one to send. */
+static GByteArray *hello_capture(void)
+{
+	struct sr_remote_server *server;
+	struct sr_session *sess;
+	struct sr_input *in;
+	GByteArray *hello;
+	char port[8];
+	int fd;
+
+	server = server_new(FALSE, port, sizeof(port));
+	in = source_input(&sess);
+	fail_unless(sr_remote_server_attach(server, sess) == SR_OK);
+	fd = loopback_connect(atoi(port));
+	hello = g_byte_array_sized_new(SR_REMOTE_HEADER_SIZE);
+	g_byte_array_set_size(hello, SR_REMOTE_HEADER_SIZE);
+	recv_all(fd, hello->data, SR_REMOTE_HEADER_SIZE);
+	fail_unless(RL16(&hello->data[4]) == SR_REMOTE_FRAME_HELLO,
+		"The server did not greet.");
+	g_byte_array_set_size(hello, SR_REMOTE_HEADER_SIZE + RL32(hello->data));
+	recv_all(fd, &hello->data[SR_REMOTE_HEADER_SIZE],
+		hello->len - SR_REMOTE_HEADER_SIZE);
+	close(fd);
+
+	sr_input_free(in);
+	sr_session_destroy(sess);
+	sr_remote_server_free(server);
+
+	return hello;
+}
+
+/*
+ * Greet the scan's connection, then send the data on the acquisition's
+ * connection. Either hang up, or wait for the client to do so.
+ */
+static gpointer fake_server_thread(gpointer data)
+{
+	struct fake_server *fake;
+	uint8_t buf[256];
+	int i, fd;
+
+	fake = data;
+	for (i = 0; i < 2; i++) {
+		fd = accept(fake->listen_fd, NULL, NULL);
+		if (fd < 0)
+			return NULL;
+		send_all(fd, fake->hello->data, fake->hello->len);
+		if (i == 1) {
+			send_all(fd, fake->data->data, fake->data->len);
+			while (!fake->hangup && recv(fd, buf, sizeof(buf), 0) > 0)
+				;
+		}
+		close(fd);
+	}
+
+	return NULL;
+}
+
+/* Append a frame with a logic packet of the given length field. */
+static void logic_frame(GByteArray *frame, uint16_t flags, uint64_t length,
+		const uint8_t *data, size_t size)
+{
+	uint8_t header[SR_REMOTE_HEADER_SIZE + 12];
+
+	WL32(&header[0], 12 + size);
+	WL16(&header[4], SR_REMOTE_FRAME_PACKET);
+	WL16(&header[6], flags);
+	WL16(&header[8], SR_DF_LOGIC);
+	WL16(&header[10], 1);
+	WL64(&header[12], length);
+	g_byte_array_append(frame, header, sizeof(header));
+	g_byte_array_append(frame, data, size);
+}
+
+/*
+ * Check that the client stops on broken frames, after it delivered
+ * the valid packets before them.
+ */
+START_TEST(test_remote_bad_frames)
+{
+	struct sr_dev_driver *driver;
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct client_feed feed;
+	struct fake_server fake;
+	struct sockaddr_in addr;
+	socklen_t addr_len;
+	GByteArray *hello, *frames;
+	GThread *thread;
+	uint8_t good[16], garbage[64];
+	char port[8];
+	int test;
+	size_t i;
+
+	if (!(driver = remote_driver()))
+		return;
+
+	for (i = 0; i < sizeof(good); i++)
+		good[i] = i;
+	/* A block header, and a literal run longer than the block. */
+	for (i = 0; i < sizeof(garbage); i++)
+		garbage[i] = 0xf0 ^ i;
+	WL32(garbage, sizeof(garbage) - 4);
+	hello = hello_capture();
+
+	for (test = 0; test < 3; test++) {
+		frames = g_byte_array_new();
+		logic_frame(frames, 0, sizeof(good), good, sizeof(good));
+		fake.hangup = FALSE;
+		switch (test) {
+		case 0:
+			/* A frame which ends in the middle, and a hang up. */
+			logic_frame(frames, 0, sizeof(good), good, sizeof(good));
+			g_byte_array_set_size(frames, frames->len - 4);
+			fake.hangup = TRUE;
+			break;
+		case 1:
+			/* Less data in the frame than the packet claims. */
+			logic_frame(frames, 0, 1000, good, sizeof(good));
+			break;
+		case 2:
+			/* Compressed data which does not decompress. */
+			logic_frame(frames, SR_REMOTE_FLAG_LZO, 1000,
+				garbage, sizeof(garbage));
+			break;
+		}
+		/* Must never arrive. */
+		if (!fake.hangup)
+			logic_frame(frames, 0, sizeof(good), good, sizeof(good));
+
+		fake.listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr_len = sizeof(addr);
+		fail_unless(bind(fake.listen_fd, (struct sockaddr *)&addr,
+			sizeof(addr)) == 0 && listen(fake.listen_fd, 2) == 0
+			&& getsockname(fake.listen_fd, (struct sockaddr *)&addr,
+			&addr_len) == 0, "Cannot listen.");
+		g_snprintf(port, sizeof(port), "%d", ntohs(addr.sin_port));
+		fake.hello = hello;
+		fake.data = frames;
+		thread = g_thread_new("fake-server", fake_server_thread, &fake);
+
+		sdi = remote_scan(driver, port);
+		sess = client_start(sdi, &feed);
+		client_finish(sess, sdi, &feed);
+		fail_unless(feed.logic->len == sizeof(good),
+			"Test %d: got %u samples.", test, feed.logic->len);
+		fail_unless(!memcmp(feed.logic->data, good, sizeof(good)));
+		g_byte_array_free(feed.logic, TRUE);
+
+		g_thread_join(thread);
+		close(fake.listen_fd);
+		g_byte_array_free(frames, TRUE);
+	}
+
+	g_byte_array_free(hello, TRUE);
+}
+END_TEST
+
+/* Dispatch the reader's session until it has read all ring data. */
+static void ring_catch_up(struct sr_shm_ring *ring, struct sr_session *sess)
+{
+	GPollFD fds[8];
+	uint64_t lag;
+	int i, n, timeout;
+
+	for (i = 0; i < 1000; i++) {
+		fail_unless(sr_shm_ring_reader_lag(ring, NULL, &lag) == SR_OK);
+		if (!lag || !sr_session_is_running(sess))
+			return;
+		n = ARRAY_SIZE(fds);
+		fail_unless(sr_session_poll_prepare(sess, fds, &n,
+			&timeout) == SR_OK);
+		n = MIN(n, (int)ARRAY_SIZE(fds));
+		g_poll(fds, n, timeout);
+		fail_unless(sr_session_poll_dispatch(sess, fds, n) == SR_OK);
+	}
+	fail("The reader does not catch up, %" PRIu64 " bytes behind.", lag);
+}
+
+/*
+ * Check that a reader gets all data while it keeps up, also when the
+ * ring wraps, and that it continues with recent data once the writer
+ * lapped it.
+ */
+START_TEST(test_shm_ring)
+{
+	struct sr_dev_driver *driver;
+	struct sr_shm_ring *ring;
+	struct sr_session *src_sess, *sess;
+	struct sr_dev_inst *sdi;
+	struct sr_input *in;
+	struct client_feed feed;
+	unsigned int readers;
+	uint64_t lag;
+	uint8_t *data;
+	char *path, *conn;
+	size_t i, round, len;
+	int ret;
+
+	if (!(driver = remote_driver()))
+		return;
+
+	path = g_build_filename(g_get_tmp_dir(), "sr-test-ring", NULL);
+	ret = sr_shm_ring_new(&ring, path, 64 * 1024);
+	if (ret == SR_ERR_NA) {
+		g_free(path);
+		return;
+	}
+	fail_unless(ret == SR_OK, "sr_shm_ring_new() failed: %d.", ret);
+	in = source_input(&src_sess);
+	fail_unless(sr_shm_ring_attach(ring, src_sess) == SR_OK);
+	fail_unless(sr_shm_ring_reader_lag(ring, &readers, &lag) == SR_OK);
+	fail_unless(readers == 0 && lag == 0);
+
+	conn = g_strdup_printf("shm/%s", path);
+	sdi = remote_scan_conn(driver, conn);
+	g_free(conn);
+	fail_unless(g_slist_length(sr_dev_inst_channels_get(sdi)) == 8,
+		"The ring describes the wrong channels.");
+	sess = client_start(sdi, &feed);
+	fail_unless(sr_shm_ring_reader_lag(ring, &readers, &lag) == SR_OK);
+	fail_unless(readers == 1 && lag == 0);
+
+	/* Rounds of 24KiB, eight of them wrap the 64KiB ring thrice. */
+	len = 24 * 1024;
+	data = g_malloc(16 * len);
+	for (i = 0; i < 16 * len; i++)
+		data[i] = i ^ (i >> 8);
+	for (round = 0; round < 8; round++) {
+		source_send(in, data + round * len, len);
+		fail_unless(sr_shm_ring_reader_lag(ring, NULL, &lag) == SR_OK);
+		fail_unless(lag > len, "Lag of %" PRIu64 " bytes.", lag);
+		ring_catch_up(ring, sess);
+	}
+	fail_unless(feed.logic->len == 8 * len, "Got %u of %zu samples.",
+		feed.logic->len, 8 * len);
+	fail_unless(!memcmp(feed.logic->data, data, 8 * len));
+
+	/* Lapped by five rounds, the reader skips them. */
+	for (round = 8; round < 13; round++)
+		source_send(in, data + round * len, len);
+	fail_unless(sr_shm_ring_reader_lag(ring, NULL, &lag) == SR_OK);
+	fail_unless(lag > 64 * 1024, "Lag of %" PRIu64 " bytes.", lag);
+	ring_catch_up(ring, sess);
+	fail_unless(feed.logic->len == 8 * len, "Got %u of %zu samples.",
+		feed.logic->len, 8 * len);
+	source_send(in, data + 13 * len, len);
+	ring_catch_up(ring, sess);
+	fail_unless(feed.logic->len == 9 * len, "Got %u of %zu samples.",
+		feed.logic->len, 9 * len);
+	fail_unless(!memcmp(feed.logic->data + 8 * len, data + 13 * len, len));
+
+	ret = sr_input_end(in);
+	fail_unless(ret == SR_OK, "sr_input_end() failed: %d.", ret);
+	client_finish(sess, sdi, &feed);
+	fail_unless(sr_shm_ring_reader_lag(ring, &readers, NULL) == SR_OK);
+	fail_unless(readers == 0, "The reader did not detach.");
+	g_byte_array_free(feed.logic, TRUE);
+
+	sr_input_free(in);
+	sr_session_destroy(src_sess);
+	sr_shm_ring_free(ring);
+	g_remove(path);
+	g_free(path);
+	g_free(data);
+}
+END_TEST
+
+Suite *suite_remote(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("remote");
+
+	tc = tcase_create("loopback");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_remote_loopback);
+	tcase_add_test(tc, test_remote_bad_frames);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("shm_ring");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_shm_ring);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -19,9 +19,12 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
+#include <glib/gstdio.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
+#include "libsigrok-internal.h"
 
 /*
  * Check whether sr_session_new() works.
@@ -185,6 +188,985 @@ START_TEST(test_session_trigger_get_null)
 }
 END_TEST
 
+/*
+ * Check whether the threaded session mode can be configured.
+ * If it doesn't work (or segfaults) this test will fail.
+ */
+START_TEST(test_session_threaded_set)
+{
+	int ret;
+	struct sr_session *sess;
+	struct sr_session_queue_stats stats;
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_threaded_set(sess, TRUE, 100, FALSE);
+	fail_unless(ret == SR_OK, "sr_session_threaded_set() failed: %d.", ret);
+	ret = sr_session_threaded_set(sess, FALSE, 0, FALSE);
+	fail_unless(ret == SR_OK, "sr_session_threaded_set() failed: %d.", ret);
+
+	/* Stats of a session which never ran are all zero. */
+	ret = sr_session_queue_stats_get(sess, &stats);
+	fail_unless(ret == SR_OK, "sr_session_queue_stats_get() failed: %d.", ret);
+	fail_unless(stats.packets_queued == 0);
+	fail_unless(stats.capacity == 0);
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/*
+ * Check whether the threaded mode functions fail for bogus parameters.
+ * If they return SR_OK (or segfault) this test will fail.
+ */
+START_TEST(test_session_threaded_set_bogus)
+{
+	int ret;
+	struct sr_session *sess;
+	struct sr_session_queue_stats stats;
+
+	ret = sr_session_threaded_set(NULL, TRUE, 0, FALSE);
+	fail_unless(ret != SR_OK, "sr_session_threaded_set(NULL) worked.");
+	ret = sr_session_queue_stats_get(NULL, &stats);
+	fail_unless(ret != SR_OK, "sr_session_queue_stats_get(NULL) worked.");
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_queue_stats_get(sess, NULL);
+	fail_unless(ret != SR_OK, "sr_session_queue_stats_get() worked.");
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/* Find, scan and open a demo device, NULL when the driver is not built. */
+static struct sr_dev_inst *demo_open(void)
+{
+	struct sr_dev_driver **drivers;
+	struct sr_dev_inst *sdi;
+	GSList *devices;
+	int i;
+
+	drivers = sr_driver_list(srtest_ctx);
+	for (i = 0; drivers && drivers[i]; i++) {
+		if (!strcmp(drivers[i]->name, "demo"))
+			break;
+	}
+	if (!drivers || !drivers[i])
+		return NULL;
+
+	srtest_driver_init(srtest_ctx, drivers[i]);
+	devices = sr_driver_scan(drivers[i], NULL);
+	fail_unless(devices != NULL, "No demo device found.");
+	sdi = devices->data;
+	g_slist_free(devices);
+	fail_unless(sr_dev_open(sdi) == SR_OK, "Cannot open demo device.");
+
+	return sdi;
+}
+
+struct stats_reader {
+	struct sr_session *sess;
+	gint stop;
+	gint packets;
+	uint64_t reads;
+	int errors;
+};
+
+static void stats_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct stats_reader *reader;
+
+	(void)sdi;
+	(void)packet;
+
+	/* A slow consumer, which makes the acquisition wait for room. */
+	reader = cb_data;
+	g_atomic_int_inc(&reader->packets);
+	g_usleep(50);
+}
+
+/* Read the statistics while the session updates them. */
+static gpointer stats_reader_thread(gpointer data)
+{
+	struct stats_reader *reader;
+	struct sr_session_queue_stats queue, prev;
+	struct sr_session_stats stats;
+
+	reader = data;
+	memset(&prev, 0, sizeof(prev));
+	while (!g_atomic_int_get(&reader->stop)) {
+		if (sr_session_queue_stats_get(reader->sess, &queue) != SR_OK ||
+				sr_session_stats_get(reader->sess, &stats) != SR_OK)
+			reader->errors++;
+		if (queue.packets_queued < prev.packets_queued ||
+				queue.high_water < prev.high_water ||
+				queue.high_water > queue.capacity)
+			reader->errors++;
+		/* Read later, the session statistics can only be ahead. */
+		if (stats.packets_dropped < queue.packets_dropped)
+			reader->errors++;
+		prev = queue;
+		reader->reads++;
+		g_thread_yield();
+	}
+
+	return NULL;
+}
+
+/*
+ * Check that the statistics of a threaded session can be read from
+ * another thread while it runs, and that they add up afterwards.
+ */
+START_TEST(test_session_threaded_stats)
+{
+	struct sr_dev_inst *sdi;
+	struct stats_reader reader;
+	struct sr_session_queue_stats queue;
+	struct sr_session_stats stats;
+	GThread *thread;
+	int ret;
+
+	if (!(sdi = demo_open()))
+		return;
+	ret = sr_config_set(sdi, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(SR_MHZ(1)));
+	fail_unless(ret == SR_OK, "Cannot set the samplerate: %d.", ret);
+	ret = sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(100000));
+	fail_unless(ret == SR_OK, "Cannot set the sample limit: %d.", ret);
+
+	memset(&reader, 0, sizeof(reader));
+	sr_session_new(srtest_ctx, &reader.sess);
+	sr_session_dev_add(reader.sess, sdi);
+	sr_session_datafeed_callback_add(reader.sess, stats_datafeed, &reader);
+	ret = sr_session_threaded_set(reader.sess, TRUE, 4, FALSE);
+	fail_unless(ret == SR_OK, "sr_session_threaded_set() failed: %d.", ret);
+
+	thread = g_thread_new("stats-reader", stats_reader_thread, &reader);
+	ret = sr_session_start(reader.sess);
+	fail_unless(ret == SR_OK, "sr_session_start() failed: %d.", ret);
+	ret = sr_session_run(reader.sess);
+	fail_unless(ret == SR_OK, "sr_session_run() failed: %d.", ret);
+	g_atomic_int_set(&reader.stop, 1);
+	g_thread_join(thread);
+
+	fail_unless(reader.errors == 0, "%d inconsistent statistics in %"
+		PRIu64 " reads.", reader.errors, reader.reads);
+	sr_session_queue_stats_get(reader.sess, &queue);
+	sr_session_stats_get(reader.sess, &stats);
+	fail_unless(queue.capacity == 4);
+	fail_unless(queue.packets_dropped == 0);
+	fail_unless(queue.packets_queued == (uint64_t)reader.packets,
+		"Queued %" PRIu64 " packets, %d arrived.",
+		queue.packets_queued, reader.packets);
+	fail_unless(stats.packets == queue.packets_queued);
+	fail_unless(queue.high_water >= 1 && queue.high_water <= 4);
+
+	sr_session_destroy(reader.sess);
+	sr_dev_close(sdi);
+}
+END_TEST
+
+/*
+ * Check the statistics of a session which never ran, and that the
+ * statistics functions fail for bogus parameters.
+ */
+START_TEST(test_session_stats)
+{
+	int ret;
+	struct sr_session *sess;
+	struct sr_session_stats stats;
+	uint64_t samples;
+
+	ret = sr_session_stats_get(NULL, &stats);
+	fail_unless(ret != SR_OK, "sr_session_stats_get(NULL) worked.");
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_stats_get(sess, NULL);
+	fail_unless(ret != SR_OK, "sr_session_stats_get() worked.");
+	ret = sr_session_stats_channel_get(sess, NULL, &samples, NULL);
+	fail_unless(ret != SR_OK, "sr_session_stats_channel_get() worked.");
+
+	ret = sr_session_stats_get(sess, &stats);
+	fail_unless(ret == SR_OK, "sr_session_stats_get() failed: %d.", ret);
+	fail_unless(stats.elapsed_us == 0);
+	fail_unless(stats.packets == 0);
+	fail_unless(stats.queue_capacity == 0);
+	fail_unless(stats.sched_cpu_mask == 0);
+	fail_unless(stats.sched_policy == SR_SESSION_SCHED_DEFAULT);
+	fail_unless(!stats.memory_locked);
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/*
+ * Check whether the scheduling of the acquisition thread can be set
+ * up, and that invalid settings get rejected.
+ */
+START_TEST(test_session_sched_set)
+{
+	int ret;
+	struct sr_session *sess;
+	struct sr_session_sched sched;
+
+	memset(&sched, 0, sizeof(sched));
+	ret = sr_session_sched_set(NULL, &sched);
+	fail_unless(ret != SR_OK, "sr_session_sched_set(NULL) worked.");
+
+	sr_session_new(srtest_ctx, &sess);
+	sched.cpu_mask = 1;
+	sched.policy = SR_SESSION_SCHED_FIFO;
+	sched.priority = 10;
+	sched.lock_memory = TRUE;
+	ret = sr_session_sched_set(sess, &sched);
+	fail_unless(ret == SR_OK, "sr_session_sched_set() failed: %d.", ret);
+	ret = sr_session_sched_set(sess, NULL);
+	fail_unless(ret == SR_OK, "sr_session_sched_set() failed: %d.", ret);
+
+	/* Real-time policies need a priority. */
+	sched.priority = 0;
+	ret = sr_session_sched_set(sess, &sched);
+	fail_unless(ret != SR_OK, "sr_session_sched_set() worked.");
+	sched.policy = 42;
+	sched.priority = 10;
+	ret = sr_session_sched_set(sess, &sched);
+	fail_unless(ret != SR_OK, "sr_session_sched_set() worked.");
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/*
+ * Check whether packet coalescing can be configured, and that it
+ * fails for bogus parameters.
+ */
+START_TEST(test_session_coalesce_set)
+{
+	int ret;
+	struct sr_session *sess;
+
+	ret = sr_session_coalesce_set(NULL, 65536, 100);
+	fail_unless(ret != SR_OK, "sr_session_coalesce_set(NULL) worked.");
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_coalesce_set(sess, 65536, 100);
+	fail_unless(ret == SR_OK, "sr_session_coalesce_set() failed: %d.", ret);
+	ret = sr_session_coalesce_set(sess, 4096, 0);
+	fail_unless(ret == SR_OK, "sr_session_coalesce_set() failed: %d.", ret);
+	ret = sr_session_coalesce_set(sess, 0, 0);
+	fail_unless(ret == SR_OK, "sr_session_coalesce_set() failed: %d.", ret);
+	/* Left enabled, destroying the session frees it. */
+	ret = sr_session_coalesce_set(sess, 65536, 100);
+	fail_unless(ret == SR_OK, "sr_session_coalesce_set() failed: %d.", ret);
+	sr_session_destroy(sess);
+}
+END_TEST
+
+#define SHARED_PACKETS 8
+#define SHARED_SAMPLES 256
+
+static void shared_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct sr_datafeed_packet *copy;
+	GPtrArray *copies;
+	int ret;
+
+	(void)sdi;
+
+	copies = cb_data;
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	ret = sr_packet_copy(packet, &copy);
+	fail_unless(ret == SR_OK, "sr_packet_copy() failed: %d.", ret);
+	g_ptr_array_add(copies, copy);
+}
+
+/*
+ * Check that a pool buffer which a packet copy shares does not get
+ * reused while the copy holds it, while released buffers do.
+ */
+START_TEST(test_session_shared_buffer)
+{
+	struct sr_session *sess;
+	struct sr_input *in;
+	struct feed_queue_logic *q;
+	struct sr_datafeed_packet *copy;
+	const struct sr_datafeed_logic *logic;
+	GPtrArray *copies;
+	uint8_t value;
+	size_t i;
+	int ret;
+
+	in = sr_input_new(sr_input_find("binary"), NULL);
+	fail_unless(in != NULL, "Failed to create input instance.");
+	sr_session_new(srtest_ctx, &sess);
+	sr_session_dev_add(sess, sr_input_dev_inst_get(in));
+	copies = g_ptr_array_new();
+	sr_session_datafeed_callback_add(sess, shared_datafeed, copies);
+
+	q = feed_queue_logic_alloc(sr_input_dev_inst_get(in),
+		SHARED_SAMPLES, 1);
+	fail_unless(q != NULL, "Failed to create feed queue.");
+	ret = feed_queue_logic_use_pool(q, 2);
+	fail_unless(ret == SR_OK, "feed_queue_logic_use_pool() failed: %d.", ret);
+
+	for (i = 0; i < SHARED_PACKETS; i++) {
+		/* A full queue sends its packet. */
+		value = 0x10 + i;
+		ret = feed_queue_logic_submit(q, &value, SHARED_SAMPLES);
+		fail_unless(ret == SR_OK, "feed_queue_logic_submit() failed: %d.",
+			ret);
+		if (i != 3)
+			continue;
+		/* Idle buffers, which the next packets get sent from. */
+		sr_packet_free(copies->pdata[0]);
+		sr_packet_free(copies->pdata[1]);
+		copies->pdata[0] = copies->pdata[1] = NULL;
+	}
+	fail_unless(copies->len == SHARED_PACKETS,
+		"Got %u of %d packets.", copies->len, SHARED_PACKETS);
+
+	/* The queue's next data must not show up in any copy. */
+	value = 0xff;
+	feed_queue_logic_submit(q, &value, SHARED_SAMPLES - 1);
+
+	for (i = 2; i < SHARED_PACKETS; i++) {
+		copy = copies->pdata[i];
+		logic = copy->payload;
+		fail_unless(logic->length == SHARED_SAMPLES,
+			"Packet %zu has %" PRIu64 " bytes.", i, logic->length);
+		fail_unless(((const uint8_t *)logic->data)[0] == 0x10 + i &&
+			!memcmp(logic->data, (const uint8_t *)logic->data + 1,
+			SHARED_SAMPLES - 1), "Packet %zu was overwritten.", i);
+		sr_packet_free(copy);
+	}
+	g_ptr_array_free(copies, TRUE);
+
+	feed_queue_logic_free(q);
+	sr_session_destroy(sess);
+	sr_input_free(in);
+}
+END_TEST
+
+/* Timestamps without a common factor, the input keeps all samples. */
+static const char rle_vcd[] =
+	"$timescale 1 us $end\n"
+	"$scope module top $end\n"
+	"$var wire 1 ! d0 $end\n"
+	"$var wire 1 \" d1 $end\n"
+	"$upscope $end\n"
+	"$enddefinitions $end\n"
+	"#0\n0!\n0\"\n"
+	"#10\n1!\n"
+	"#25\n1\"\n"
+	"#31\n0!\n"
+	"#40\n0\"\n"
+	"#50\n";
+
+struct rle_feed {
+	GByteArray *data;
+	guint logic, rle;
+};
+
+static void rle_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
+	struct rle_feed *feed;
+	guint len;
+
+	(void)sdi;
+
+	feed = cb_data;
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		g_byte_array_append(feed->data, logic->data, logic->length);
+		feed->logic++;
+	} else if (packet->type == SR_DF_LOGIC_RLE) {
+		rle = packet->payload;
+		len = feed->data->len;
+		g_byte_array_set_size(feed->data,
+			len + rle->num_samples * rle->unitsize);
+		fail_unless(sr_logic_rle_expand(rle,
+			feed->data->data + len) == SR_OK);
+		feed->rle++;
+	}
+}
+
+static void rle_feed_vcd(gboolean accept, struct rle_feed *feed)
+{
+	const struct sr_input_module *imod;
+	struct sr_input *in;
+	struct sr_session *sess;
+	GString *buf;
+	int ret;
+
+	imod = sr_input_find("vcd");
+	fail_unless(imod != NULL, "No VCD input module.");
+	in = sr_input_new(imod, NULL);
+	fail_unless(in != NULL, "Failed to create input instance.");
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_logic_rle_set(sess, accept);
+	fail_unless(ret == SR_OK, "sr_session_logic_rle_set() failed: %d.", ret);
+	sr_session_datafeed_callback_add(sess, rle_datafeed, feed);
+	sr_session_dev_add(sess, sr_input_dev_inst_get(in));
+
+	buf = g_string_new(rle_vcd);
+	ret = sr_input_send(in, buf);
+	fail_unless(ret == SR_OK, "sr_input_send() failed: %d.", ret);
+	ret = sr_input_end(in);
+	fail_unless(ret == SR_OK, "sr_input_end() failed: %d.", ret);
+	g_string_free(buf, TRUE);
+	sr_input_free(in);
+	sr_session_destroy(sess);
+}
+
+/*
+ * Check that a session which accepts RLE logic data gets the same
+ * samples as one which has them expanded.
+ */
+START_TEST(test_session_logic_rle)
+{
+	struct rle_feed expanded, rle;
+	guint i;
+	int ret;
+
+	ret = sr_session_logic_rle_set(NULL, TRUE);
+	fail_unless(ret == SR_ERR_ARG, "sr_session_logic_rle_set(NULL) worked.");
+
+	memset(&expanded, 0, sizeof(expanded));
+	expanded.data = g_byte_array_new();
+	rle_feed_vcd(FALSE, &expanded);
+	fail_unless(expanded.logic > 0 && expanded.rle == 0,
+		"Got %u RLE packets although they were not accepted.",
+		expanded.rle);
+
+	memset(&rle, 0, sizeof(rle));
+	rle.data = g_byte_array_new();
+	rle_feed_vcd(TRUE, &rle);
+	fail_unless(rle.rle > 0 && rle.logic == 0,
+		"Got %u logic packets although RLE was accepted.", rle.logic);
+
+	fail_unless(expanded.data->len >= 50, "Only %u samples.",
+		expanded.data->len);
+	fail_unless(rle.data->len == expanded.data->len,
+		"Got %u RLE samples, %u expanded ones.",
+		rle.data->len, expanded.data->len);
+	fail_unless(!memcmp(rle.data->data, expanded.data->data,
+		rle.data->len), "RLE and expanded samples differ.");
+	for (i = 0; i < 50; i++) {
+		fail_unless((rle.data->data[i] & 1) == (i >= 10 && i < 31));
+		fail_unless(!!(rle.data->data[i] & 2) == (i >= 25 && i < 40));
+	}
+
+	g_byte_array_free(expanded.data, TRUE);
+	g_byte_array_free(rle.data, TRUE);
+}
+END_TEST
+
+/*
+ * Check that the external event loop functions fail for bogus
+ * parameters, and for a session which was not started.
+ */
+START_TEST(test_session_poll_bogus)
+{
+	int ret, n_fds, timeout;
+	struct sr_session *sess;
+	GPollFD fds[4];
+
+	n_fds = G_N_ELEMENTS(fds);
+	ret = sr_session_poll_prepare(NULL, fds, &n_fds, &timeout);
+	fail_unless(ret != SR_OK, "sr_session_poll_prepare(NULL) worked.");
+	ret = sr_session_poll_dispatch(NULL, fds, 0);
+	fail_unless(ret != SR_OK, "sr_session_poll_dispatch(NULL) worked.");
+	ret = sr_session_stop_async(NULL);
+	fail_unless(ret != SR_OK, "sr_session_stop_async(NULL) worked.");
+
+	sr_session_new(srtest_ctx, &sess);
+	n_fds = 1;
+	ret = sr_session_poll_prepare(sess, NULL, &n_fds, &timeout);
+	fail_unless(ret != SR_OK, "sr_session_poll_prepare() worked.");
+	n_fds = G_N_ELEMENTS(fds);
+	ret = sr_session_poll_prepare(sess, fds, &n_fds, &timeout);
+	fail_unless(ret == SR_ERR, "Polling a stopped session worked.");
+	ret = sr_session_poll_dispatch(sess, fds, 0);
+	fail_unless(ret == SR_ERR, "Dispatching a stopped session worked.");
+
+	/* Stopping a session which is not running does nothing. */
+	ret = sr_session_stop_async(sess);
+	fail_unless(ret == SR_OK, "sr_session_stop_async() failed: %d.", ret);
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/*
+ * Check that reading session file data fails for bogus parameters, and
+ * for devices which are not of a loaded session file.
+ */
+START_TEST(test_session_file_read_bogus)
+{
+	int ret;
+	uint64_t samples;
+	struct sr_dev_inst *sdi;
+	uint8_t buf[4];
+
+	ret = sr_session_file_samples(NULL, NULL, &samples);
+	fail_unless(ret == SR_ERR_ARG, "sr_session_file_samples(NULL) worked.");
+	samples = sizeof(buf);
+	ret = sr_session_file_read(NULL, NULL, 0, &samples, buf);
+	fail_unless(ret == SR_ERR_ARG, "sr_session_file_read(NULL) worked.");
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "1.0");
+	ret = sr_session_file_samples(sdi, NULL, &samples);
+	fail_unless(ret == SR_ERR_ARG, "Getting samples of a user device worked.");
+	ret = sr_session_file_read(sdi, NULL, 0, &samples, buf);
+	fail_unless(ret == SR_ERR_ARG, "Reading from a user device worked.");
+	sr_dev_inst_user_free(sdi);
+}
+END_TEST
+
+/*
+ * Write a session file of 8 logic channels with the srzip output.
+ * Channel 0 toggles every 100 samples, the others stay low.
+ */
+static void session_file_write(const char *filename, uint64_t samples,
+		GHashTable *params)
+{
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_meta meta;
+	struct sr_datafeed_logic logic;
+	struct sr_config src;
+	GString *out;
+	uint8_t *data;
+	char name[4];
+	uint64_t i;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "1.0");
+	for (i = 0; i < 8; i++) {
+		g_snprintf(name, sizeof(name), "D%d", i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+	o = sr_output_new(sr_output_find("srzip"), params, sdi, filename);
+	fail_unless(o != NULL, "No srzip output.");
+
+	src.key = SR_CONF_SAMPLERATE;
+	src.data = g_variant_new_uint64(SR_MHZ(1));
+	meta.config = g_slist_append(NULL, &src);
+	packet.type = SR_DF_META;
+	packet.payload = &meta;
+	fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+	g_slist_free(meta.config);
+	g_variant_unref(src.data);
+
+	data = g_malloc0(samples);
+	for (i = 0; i < samples; i++)
+		data[i] = (i / 100) & 1;
+	logic.length = samples;
+	logic.unitsize = 1;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+	g_free(data);
+
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+	sr_output_free(o);
+	sr_dev_inst_user_free(sdi);
+}
+
+/* Check the summary of a session file, with and without its index. */
+START_TEST(test_session_file_info)
+{
+	struct sr_session_file_info info;
+	char *filename, *index;
+	int ret;
+
+	filename = g_build_filename(g_get_tmp_dir(), "sr-test-info.sr", NULL);
+	index = g_strconcat(filename, ".info", NULL);
+	g_remove(index);
+	session_file_write(filename, 1000, NULL);
+
+	ret = sr_session_file_info_get(filename, 0, &info);
+	fail_unless(ret == SR_OK, "sr_session_file_info_get() failed: %d.", ret);
+	fail_unless(info.num_logic_channels == 8);
+	fail_unless(info.num_analog_channels == 0);
+	fail_unless(info.unitsize == 1);
+	fail_unless(info.samplerate == SR_MHZ(1));
+	fail_unless(info.samples == 1000);
+	fail_unless(!g_file_test(index, G_FILE_TEST_EXISTS),
+		"Index written without being asked for.");
+
+	/* The index gets written, and then used. */
+	ret = sr_session_file_info_get(filename, SR_SESSION_FILE_INFO_INDEX, &info);
+	fail_unless(ret == SR_OK, "Getting the info failed: %d.", ret);
+	fail_unless(g_file_test(index, G_FILE_TEST_IS_REGULAR), "No index.");
+	memset(&info, 0, sizeof(info));
+	ret = sr_session_file_info_get(filename, SR_SESSION_FILE_INFO_INDEX, &info);
+	fail_unless(ret == SR_OK, "Getting the indexed info failed: %d.", ret);
+	fail_unless(info.samples == 1000 && info.samplerate == SR_MHZ(1));
+
+	/* An index is no session file. */
+	ret = sr_session_file_info_get(index, 0, &info);
+	fail_unless(ret == SR_ERR, "Getting the info of a non-session file worked.");
+
+	g_remove(index);
+	g_remove(filename);
+	g_free(index);
+	g_free(filename);
+}
+END_TEST
+
+/* Check the summary levels which the srzip output stores on request. */
+START_TEST(test_session_file_summary)
+{
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct sr_channel *ch0, *ch1;
+	struct sr_logic_summary entries[4];
+	GHashTable *params;
+	GSList *devs;
+	char *filename;
+	unsigned int levels, shift;
+	uint64_t count;
+	int ret;
+
+	filename = g_build_filename(g_get_tmp_dir(), "sr-test-summary.sr", NULL);
+	params = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(params, "summary",
+		g_variant_ref_sink(g_variant_new_boolean(TRUE)));
+	session_file_write(filename, 10000, params);
+	g_hash_table_destroy(params);
+
+	ret = sr_session_load(srtest_ctx, filename, &sess);
+	fail_unless(ret == SR_OK, "sr_session_load() failed: %d.", ret);
+	sr_session_dev_list(sess, &devs);
+	sdi = devs->data;
+	g_slist_free(devs);
+	ch0 = g_slist_nth_data(sr_dev_inst_channels_get(sdi), 0);
+	ch1 = g_slist_nth_data(sr_dev_inst_channels_get(sdi), 1);
+
+	/* 10000 samples make 3 entries of 4096, then 2, then 1. */
+	ret = sr_session_file_summary_levels(sdi, NULL, &levels, &shift);
+	fail_unless(ret == SR_OK, "Getting the summary levels failed: %d.", ret);
+	fail_unless(shift == 12 && levels == 3, "Wrong levels %u, %u.",
+		levels, shift);
+
+	count = G_N_ELEMENTS(entries);
+	ret = sr_session_file_summary_read(sdi, ch0, 0, 0, &count, entries);
+	fail_unless(ret == SR_OK, "Reading the summary failed: %d.", ret);
+	fail_unless(count == 3);
+	fail_unless(entries[0].high && entries[0].low);
+	fail_unless(entries[0].transitions == 40);
+	fail_unless(entries[1].transitions == 41);
+	fail_unless(entries[2].transitions == 18);
+
+	count = G_N_ELEMENTS(entries);
+	ret = sr_session_file_summary_read(sdi, ch1, 2, 0, &count, entries);
+	fail_unless(ret == SR_OK && count == 1);
+	fail_unless(!entries[0].high && entries[0].low);
+	fail_unless(entries[0].transitions == 0);
+
+	count = G_N_ELEMENTS(entries);
+	ret = sr_session_file_summary_read(sdi, ch0, 3, 0, &count, entries);
+	fail_unless(ret == SR_ERR_NA, "Reading a missing level worked.");
+	ret = sr_session_file_summary_read(sdi, NULL, 0, 0, &count, entries);
+	fail_unless(ret == SR_ERR_ARG, "Reading without channel worked.");
+
+	sr_session_destroy(sess);
+	g_remove(filename);
+	g_free(filename);
+}
+END_TEST
+
+/* Search a session file for edges, with the given srzip options. */
+static void session_file_edges_check(const char *filename, GHashTable *params)
+{
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct sr_channel *ch0, *ch1;
+	GSList *devs;
+	uint64_t pos;
+	int ret;
+
+	session_file_write(filename, 10000, params);
+	ret = sr_session_load(srtest_ctx, filename, &sess);
+	fail_unless(ret == SR_OK, "sr_session_load() failed: %d.", ret);
+	sr_session_dev_list(sess, &devs);
+	sdi = devs->data;
+	g_slist_free(devs);
+	ch0 = g_slist_nth_data(sr_dev_inst_channels_get(sdi), 0);
+	ch1 = g_slist_nth_data(sr_dev_inst_channels_get(sdi), 1);
+
+	/* Channel 0 rises at odd multiples of 100, and falls at even ones. */
+	ret = sr_session_file_edge_next(sdi, ch0, 0, SR_TRIGGER_EDGE, &pos);
+	fail_unless(ret == SR_OK, "Searching an edge failed: %d.", ret);
+	fail_unless(pos == 100, "Wrong edge %" PRIu64 ".", pos);
+	ret = sr_session_file_edge_next(sdi, ch0, 100, SR_TRIGGER_EDGE, &pos);
+	fail_unless(ret == SR_OK && pos == 200);
+	ret = sr_session_file_edge_next(sdi, ch0, 100, SR_TRIGGER_RISING, &pos);
+	fail_unless(ret == SR_OK && pos == 300);
+	ret = sr_session_file_edge_next(sdi, ch0, 4095, SR_TRIGGER_FALLING, &pos);
+	fail_unless(ret == SR_OK && pos == 4200, "Wrong edge %" PRIu64 ".", pos);
+	ret = sr_session_file_edge_next(sdi, ch0, 9900, SR_TRIGGER_EDGE, &pos);
+	fail_unless(ret == SR_ERR_NA, "Found an edge after the last one.");
+	ret = sr_session_file_edge_next(sdi, ch1, 0, SR_TRIGGER_EDGE, &pos);
+	fail_unless(ret == SR_ERR_NA, "Found an edge of a constant channel.");
+	ret = sr_session_file_edge_next(sdi, ch0, 0, SR_TRIGGER_ONE, &pos);
+	fail_unless(ret == SR_ERR_ARG, "Searching for a level worked.");
+
+	sr_session_destroy(sess);
+}
+
+/* Check edge searches with a stored index, and with one built on demand. */
+START_TEST(test_session_file_edge_next)
+{
+	GHashTable *params;
+	char *filename, *index;
+
+	filename = g_build_filename(g_get_tmp_dir(), "sr-test-edges.sr", NULL);
+	index = g_strconcat(filename, ".edges", NULL);
+	g_remove(index);
+
+	params = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(params, "edge_index",
+		g_variant_ref_sink(g_variant_new_boolean(TRUE)));
+	session_file_edges_check(filename, params);
+	g_hash_table_destroy(params);
+	fail_unless(!g_file_test(index, G_FILE_TEST_EXISTS),
+		"Index built although the file has one.");
+
+	session_file_edges_check(filename, NULL);
+	fail_unless(g_file_test(index, G_FILE_TEST_IS_REGULAR),
+		"No index built.");
+
+	g_remove(index);
+	g_remove(filename);
+	g_free(index);
+	g_free(filename);
+}
+END_TEST
+
+static void merged_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+
+	(void)sdi;
+
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	logic = packet->payload;
+	fail_unless(logic->unitsize == 2, "Wrong merged unitsize %u.",
+		logic->unitsize);
+	g_byte_array_append(cb_data, logic->data, logic->length);
+}
+
+/* Merge two session files, of which the first started 100 samples earlier. */
+START_TEST(test_session_load_files_merge)
+{
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct sr_channel *ch;
+	GByteArray *data;
+	GSList *devs;
+	char *files[3];
+	int64_t start_ns[2];
+	guint i;
+	int ret;
+
+	files[0] = g_build_filename(g_get_tmp_dir(), "sr-test-merge1.sr", NULL);
+	files[1] = g_build_filename(g_get_tmp_dir(), "sr-test-merge2.sr", NULL);
+	files[2] = NULL;
+	session_file_write(files[0], 1000, NULL);
+	session_file_write(files[1], 1000, NULL);
+	start_ns[0] = 0;
+	start_ns[1] = 100000;
+
+	ret = sr_session_load_files(srtest_ctx, (const char *const *)files,
+		start_ns, SR_SESSION_LOAD_MERGE_LOGIC, &sess);
+	fail_unless(ret == SR_OK, "sr_session_load_files() failed: %d.", ret);
+	sr_session_dev_list(sess, &devs);
+	fail_unless(g_slist_length(devs) == 1, "Not one merged device.");
+	sdi = devs->data;
+	g_slist_free(devs);
+	fail_unless(g_slist_length(sr_dev_inst_channels_get(sdi)) == 16);
+	ch = g_slist_nth_data(sr_dev_inst_channels_get(sdi), 8);
+	fail_unless(!strcmp(ch->name, "2:D0") && ch->index == 8,
+		"Wrong merged channel %s (%d).", ch->name, ch->index);
+
+	data = g_byte_array_new();
+	sr_session_datafeed_callback_add(sess, merged_datafeed, data);
+	ret = sr_session_start(sess);
+	if (ret == SR_OK)
+		ret = sr_session_run(sess);
+	fail_unless(ret == SR_OK, "Merged playback failed: %d.", ret);
+	fail_unless(data->len == 2 * 900, "Wrong merged length %u.", data->len);
+	for (i = 0; i < 900; i++) {
+		fail_unless(data->data[2 * i] == (((i + 100) / 100) & 1));
+		fail_unless(data->data[2 * i + 1] == ((i / 100) & 1));
+	}
+	g_byte_array_free(data, TRUE);
+	sr_session_destroy(sess);
+
+	/* Separate devices, each one of them. */
+	ret = sr_session_load_files(srtest_ctx, (const char *const *)files,
+		NULL, 0, &sess);
+	fail_unless(ret == SR_OK, "sr_session_load_files() failed: %d.", ret);
+	sr_session_dev_list(sess, &devs);
+	fail_unless(g_slist_length(devs) == 2, "Not two devices.");
+	g_slist_free(devs);
+	sr_session_destroy(sess);
+
+	g_remove(files[0]);
+	g_remove(files[1]);
+	g_free(files[0]);
+	g_free(files[1]);
+}
+END_TEST
+
+struct logic_merge_feed {
+	GByteArray *data;
+	uint16_t unitsize;
+	int ends;
+};
+
+static void logic_merge_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+	struct logic_merge_feed *feed;
+
+	(void)sdi;
+
+	feed = cb_data;
+	if (packet->type == SR_DF_END)
+		feed->ends++;
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	logic = packet->payload;
+	feed->unitsize = logic->unitsize;
+	g_byte_array_append(feed->data, logic->data, logic->length);
+}
+
+static void logic_merge_send(struct sr_input *in, const uint8_t *data,
+		size_t len)
+{
+	GString *buf;
+	int ret;
+
+	buf = g_string_new_len((const char *)data, len);
+	ret = sr_input_send(in, buf);
+	fail_unless(ret == SR_OK, "sr_input_send() failed: %d.", ret);
+	g_string_free(buf, TRUE);
+}
+
+/*
+ * Merge an 8 channel and a 12 channel device, which send packets of
+ * different lengths, and of which one sends more samples.
+ */
+START_TEST(test_session_logic_merge)
+{
+	struct sr_session *sess;
+	struct sr_logic_merge *merge;
+	struct sr_input *in[2];
+	struct sr_channel *ch;
+	struct logic_merge_feed feed;
+	GHashTable *options;
+	uint8_t a[1000], b[2 * 1010];
+	size_t pos_a, pos_b, len, i;
+	int ret;
+
+	for (i = 0; i < sizeof(a); i++)
+		a[i] = i * 7;
+	for (i = 0; i < sizeof(b) / 2; i++) {
+		b[2 * i] = i * 13;
+		b[2 * i + 1] = ((i * 13) >> 8) & 0x0f;
+	}
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, g_strdup("numchannels"),
+		g_variant_ref_sink(g_variant_new_int32(12)));
+	in[0] = sr_input_new(sr_input_find("binary"), NULL);
+	in[1] = sr_input_new(sr_input_find("binary"), options);
+	g_hash_table_destroy(options);
+	fail_unless(in[0] && in[1], "Failed to create input instances.");
+
+	sr_session_new(srtest_ctx, &sess);
+	sr_session_dev_add(sess, sr_input_dev_inst_get(in[0]));
+	sr_session_dev_add(sess, sr_input_dev_inst_get(in[1]));
+	ret = sr_logic_merge_new(&merge, SR_LOGIC_MERGE_ALIGN_START);
+	fail_unless(ret == SR_OK, "sr_logic_merge_new() failed: %d.", ret);
+	memset(&feed, 0, sizeof(feed));
+	feed.data = g_byte_array_new();
+	ret = sr_logic_merge_attach(merge, sess, logic_merge_datafeed, &feed);
+	fail_unless(ret == SR_OK, "sr_logic_merge_attach() failed: %d.", ret);
+	fail_unless(g_slist_length(sr_dev_inst_channels_get(
+		sr_logic_merge_dev_inst_get(merge))) == 20);
+	ch = g_slist_nth_data(sr_dev_inst_channels_get(
+		sr_logic_merge_dev_inst_get(merge)), 8);
+	fail_unless(!strcmp(ch->name, "1:0") && ch->index == 8,
+		"Wrong merged channel %s (%d).", ch->name, ch->index);
+
+	/* The devices get ready with the first data, then packets of 100
+	 * and 37 samples follow in turns. */
+	logic_merge_send(in[0], NULL, 0);
+	logic_merge_send(in[1], NULL, 0);
+	pos_a = pos_b = 0;
+	while (pos_a < sizeof(a) || pos_b < sizeof(b)) {
+		len = MIN(100, sizeof(a) - pos_a);
+		if (len)
+			logic_merge_send(in[0], a + pos_a, len);
+		pos_a += len;
+		len = MIN(2 * 37, sizeof(b) - pos_b);
+		if (len)
+			logic_merge_send(in[1], b + pos_b, len);
+		pos_b += len;
+	}
+	fail_unless(sr_input_end(in[0]) == SR_OK);
+	fail_unless(feed.ends == 0, "The merge ended with one device.");
+	fail_unless(sr_input_end(in[1]) == SR_OK);
+
+	fail_unless(feed.ends == 1, "Got %d ends.", feed.ends);
+	fail_unless(feed.unitsize == 3, "Wrong merged unitsize %u.",
+		feed.unitsize);
+	fail_unless(feed.data->len == 3 * sizeof(a), "Wrong merged length %u.",
+		feed.data->len);
+	for (i = 0; i < sizeof(a); i++) {
+		fail_unless(feed.data->data[3 * i] == a[i]);
+		fail_unless(feed.data->data[3 * i + 1] == b[2 * i]);
+		fail_unless(feed.data->data[3 * i + 2] == b[2 * i + 1]);
+	}
+
+	g_byte_array_free(feed.data, TRUE);
+	sr_input_free(in[0]);
+	sr_input_free(in[1]);
+	sr_session_destroy(sess);
+	sr_logic_merge_free(merge);
+}
+END_TEST
+
+/* Check that summarizing session files fails for bogus parameters. */
+START_TEST(test_session_file_info_bogus)
+{
+	struct sr_session_file_info info;
+	int ret;
+
+	ret = sr_session_file_info_get(NULL, 0, &info);
+	fail_unless(ret == SR_ERR_ARG, "sr_session_file_info_get(NULL) worked.");
+	ret = sr_session_file_info_get("foo.sr", 0, NULL);
+	fail_unless(ret == SR_ERR_ARG, "Getting the info without struct worked.");
+	ret = sr_session_file_info_get(g_get_tmp_dir(), 0, &info);
+	fail_unless(ret == SR_ERR, "Getting the info of a directory worked.");
+}
+END_TEST
+
 Suite *suite_session(void)
 {
 	Suite *s;
@@ -209,5 +1191,57 @@ Suite *suite_session(void)
 	tcase_add_test(tc, test_session_trigger_get_null);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("threaded");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_threaded_set);
+	tcase_add_test(tc, test_session_threaded_set_bogus);
+	tcase_add_test(tc, test_session_threaded_stats);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("stats");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_stats);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("sched");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_sched_set);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("coalesce");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_coalesce_set);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("buffer");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_shared_buffer);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("merge");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_logic_merge);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("rle");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_logic_rle);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("poll");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_poll_bogus);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("file");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_file_read_bogus);
+	tcase_add_test(tc, test_session_file_info);
+	tcase_add_test(tc, test_session_file_info_bogus);
+	tcase_add_test(tc, test_session_file_summary);
+	tcase_add_test(tc, test_session_file_edge_next);
+	tcase_add_test(tc, test_session_load_files_merge);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
@@ -20,6 +20,7 @@
 #include <config.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -249,6 +250,372 @@ START_TEST(test_trigger_match_add_bogus)
 }
 END_TEST
 
+/* Samples and channels of the data which soft triggers get checked on. */
+#define SOFT_SAMPLES 200
+#define SOFT_CHANNELS 100
+#define SOFT_UNITSIZE ((SOFT_CHANNELS + 7) / 8)
+/* The sample which completes the trigger in the soft trigger data. */
+#define SOFT_TRIGGER 122
+
+struct soft_trigger_feed {
+	const struct sr_dev_inst *sdi;
+	size_t snapshot_len;
+	int fired;
+};
+
+static void sample_bit_set(uint8_t *data, size_t sample, int channel)
+{
+	data[sample * SOFT_UNITSIZE + channel / 8] |= 1 << (channel % 8);
+}
+
+static void sample_bit_clear(uint8_t *data, size_t sample, int channel)
+{
+	data[sample * SOFT_UNITSIZE + channel / 8] &= ~(1 << (channel % 8));
+}
+
+static struct sr_channel *channel_get(const struct sr_dev_inst *sdi, int index)
+{
+	struct sr_channel *ch;
+	GSList *l;
+
+	for (l = sr_dev_inst_channels_get(sdi); l; l = l->next) {
+		ch = l->data;
+		if (ch->index == index)
+			return ch;
+	}
+	fail("No channel %d.", index);
+
+	return NULL;
+}
+
+/*
+ * Data for a trigger which needs a rising edge on channel 70 while
+ * channel 3 is low, then channels 70 and 99 high, then a falling edge
+ * on channel 64. The channels beyond 64 need a second word per sample.
+ * A rising edge while channel 3 is high, and a rising edge which lacks
+ * channel 99 on the next sample must not trigger. The trigger sequence
+ * completes at SOFT_TRIGGER, and only there.
+ */
+static uint8_t *soft_trigger_data(void)
+{
+	uint8_t *data;
+	size_t i;
+
+	data = g_malloc0(SOFT_SAMPLES * SOFT_UNITSIZE);
+	for (i = 0; i < SOFT_SAMPLES; i++) {
+		/* Noise on channels which the trigger doesn't look at. */
+		data[i * SOFT_UNITSIZE + 1] = i * 37;
+		data[i * SOFT_UNITSIZE + 5] = i * 11 + 3;
+		if (i < SOFT_TRIGGER)
+			sample_bit_set(data, i, 64);
+	}
+
+	/* A rising edge, but channel 99 doesn't follow. */
+	sample_bit_set(data, 50, 70);
+	sample_bit_set(data, 51, 70);
+	/* A rising edge, while channel 3 is high. */
+	for (i = 90; i < 95; i++) {
+		sample_bit_set(data, i, 3);
+		sample_bit_set(data, i, 70);
+	}
+	sample_bit_set(data, 96, 99);
+	/* The matching sequence. */
+	for (i = SOFT_TRIGGER - 2; i < SOFT_TRIGGER + 3; i++)
+		sample_bit_set(data, i, 70);
+	sample_bit_set(data, SOFT_TRIGGER - 1, 99);
+	sample_bit_clear(data, SOFT_TRIGGER, 64);
+
+	return data;
+}
+
+static struct sr_trigger *soft_trigger_new(const struct sr_dev_inst *sdi)
+{
+	struct sr_trigger *trig;
+	struct sr_trigger_stage *stage;
+
+	trig = sr_trigger_new("T1");
+	stage = sr_trigger_stage_add(trig);
+	sr_trigger_match_add(stage, channel_get(sdi, 70), SR_TRIGGER_RISING, 0);
+	sr_trigger_match_add(stage, channel_get(sdi, 3), SR_TRIGGER_ZERO, 0);
+	stage = sr_trigger_stage_add(trig);
+	sr_trigger_match_add(stage, channel_get(sdi, 99), SR_TRIGGER_ONE, 0);
+	sr_trigger_match_add(stage, channel_get(sdi, 70), SR_TRIGGER_ONE, 0);
+	stage = sr_trigger_stage_add(trig);
+	sr_trigger_match_add(stage, channel_get(sdi, 64), SR_TRIGGER_FALLING, 0);
+
+	return trig;
+}
+
+static void soft_trigger_cb(struct sr_recorder *rec, void *cb_data)
+{
+	struct soft_trigger_feed *feed;
+	const struct sr_output *o;
+	GString *out;
+
+	feed = cb_data;
+	if (feed->fired++)
+		return;
+	o = sr_output_new(sr_output_find("binary"), NULL, feed->sdi, NULL);
+	fail_unless(o != NULL, "Failed to create output instance.");
+	fail_unless(sr_recorder_snapshot(rec, o, &out) == SR_OK);
+	feed->snapshot_len = out->len;
+	g_string_free(out, TRUE);
+	sr_output_free(o);
+}
+
+/*
+ * Check a multi-stage trigger on data with more than 64 channels, which
+ * arrives in packets of various lengths. The stages and the edges must
+ * match across packet boundaries. The recorder runs the soft trigger,
+ * and records up to the packet which completed the trigger.
+ */
+START_TEST(test_trigger_soft_stages)
+{
+	static const size_t splits[] = {
+		1, 2, 3, 51, 61, SOFT_TRIGGER - 2, SOFT_TRIGGER - 1,
+		SOFT_TRIGGER, SOFT_SAMPLES,
+	};
+	struct sr_recorder *rec;
+	struct sr_session *sess;
+	struct sr_input *in;
+	struct sr_trigger *trig;
+	struct soft_trigger_feed feed;
+	GHashTable *options;
+	GString *buf;
+	uint8_t *data;
+	size_t split, expected, i, pos, len;
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, g_strdup("numchannels"),
+		g_variant_ref_sink(g_variant_new_int32(SOFT_CHANNELS)));
+	data = soft_trigger_data();
+
+	for (i = 0; i < G_N_ELEMENTS(splits); i++) {
+		split = splits[i];
+		in = sr_input_new(sr_input_find("binary"), options);
+		fail_unless(in != NULL, "Failed to create input instance.");
+		sr_session_new(srtest_ctx, &sess);
+		sr_session_dev_add(sess, sr_input_dev_inst_get(in));
+		fail_unless(sr_recorder_new(&rec, 1024 * 1024, FALSE) == SR_OK);
+		fail_unless(sr_recorder_attach(rec, sess) == SR_OK);
+		trig = soft_trigger_new(sr_input_dev_inst_get(in));
+		memset(&feed, 0, sizeof(feed));
+		feed.sdi = sr_input_dev_inst_get(in);
+		fail_unless(sr_recorder_trigger_set(rec, trig, 0,
+			soft_trigger_cb, &feed) == SR_OK);
+
+		/* The input gets ready with the first data. */
+		buf = g_string_new_len(NULL, 0);
+		fail_unless(sr_input_send(in, buf) == SR_OK);
+		g_string_free(buf, TRUE);
+		for (pos = 0; pos < SOFT_SAMPLES; pos += len) {
+			len = MIN(split, SOFT_SAMPLES - pos);
+			buf = g_string_new_len((const char *)data
+				+ pos * SOFT_UNITSIZE, len * SOFT_UNITSIZE);
+			fail_unless(sr_input_send(in, buf) == SR_OK);
+			g_string_free(buf, TRUE);
+		}
+		fail_unless(sr_input_end(in) == SR_OK);
+
+		expected = MIN((SOFT_TRIGGER / split + 1) * split, SOFT_SAMPLES);
+		fail_unless(feed.fired == 1, "Split %zu: fired %d times.",
+			split, feed.fired);
+		fail_unless(feed.snapshot_len == expected * SOFT_UNITSIZE,
+			"Split %zu: triggered in the packet up to sample %zu, "
+			"not %zu.", split, feed.snapshot_len / SOFT_UNITSIZE,
+			expected);
+
+		sr_session_destroy(sess);
+		sr_input_free(in);
+		sr_recorder_free(rec);
+		sr_trigger_free(trig);
+	}
+
+	g_hash_table_destroy(options);
+	g_free(data);
+}
+END_TEST
+
+/* Samples per packet of the demo device, and per acquisition. */
+#define DEMO_PACKET 128
+#define DEMO_LIMIT 4000
+#define DEMO_PRE_TRIGGER (DEMO_LIMIT / 4)
+
+struct demo_feed {
+	GByteArray *pre;
+	GByteArray *post;
+	int triggers;
+	int ends;
+};
+
+static void demo_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+	struct demo_feed *feed;
+
+	(void)sdi;
+
+	feed = cb_data;
+	switch (packet->type) {
+	case SR_DF_TRIGGER:
+		feed->triggers++;
+		break;
+	case SR_DF_END:
+		feed->ends++;
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		fail_unless(logic->unitsize == 2);
+		g_byte_array_append(feed->triggers ? feed->post : feed->pre,
+			logic->data, logic->length);
+		break;
+	default:
+		break;
+	}
+}
+
+/* Open a demo device with 16 logic channels, NULL when not built. */
+static struct sr_dev_inst *demo_open(void)
+{
+	struct sr_dev_driver **drivers;
+	struct sr_config cfg_logic, cfg_analog;
+	struct sr_channel_group *cg;
+	struct sr_dev_inst *sdi;
+	GSList *options, *devices, *l;
+	int i;
+
+	drivers = sr_driver_list(srtest_ctx);
+	for (i = 0; drivers && drivers[i]; i++) {
+		if (!strcmp(drivers[i]->name, "demo"))
+			break;
+	}
+	if (!drivers || !drivers[i])
+		return NULL;
+
+	srtest_driver_init(srtest_ctx, drivers[i]);
+	cfg_logic.key = SR_CONF_NUM_LOGIC_CHANNELS;
+	cfg_logic.data = g_variant_ref_sink(g_variant_new_int32(16));
+	cfg_analog.key = SR_CONF_NUM_ANALOG_CHANNELS;
+	cfg_analog.data = g_variant_ref_sink(g_variant_new_int32(0));
+	options = g_slist_append(NULL, &cfg_logic);
+	options = g_slist_append(options, &cfg_analog);
+	devices = sr_driver_scan(drivers[i], options);
+	g_slist_free(options);
+	g_variant_unref(cfg_logic.data);
+	g_variant_unref(cfg_analog.data);
+	fail_unless(devices != NULL, "No demo device found.");
+	sdi = devices->data;
+	g_slist_free(devices);
+	fail_unless(sr_dev_open(sdi) == SR_OK, "Cannot open demo device.");
+
+	/* A periodic pattern, whose samples are known. */
+	for (l = sr_dev_inst_channel_groups_get(sdi); l; l = l->next) {
+		cg = l->data;
+		if (!strcmp(cg->name, "Logic"))
+			fail_unless(sr_config_set(sdi, cg, SR_CONF_PATTERN_MODE,
+				g_variant_new_string("graycode")) == SR_OK);
+	}
+	fail_unless(sr_config_set(sdi, NULL, SR_CONF_BUFFERSIZE,
+		g_variant_new_uint64(DEMO_PACKET * 2)) == SR_OK);
+	fail_unless(sr_config_set(sdi, NULL, SR_CONF_TEST_MODE,
+		g_variant_new_string("max-rate")) == SR_OK);
+	fail_unless(sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(DEMO_LIMIT)) == SR_OK);
+	fail_unless(sr_config_set(sdi, NULL, SR_CONF_CAPTURE_RATIO,
+		g_variant_new_uint64(25)) == SR_OK);
+
+	return sdi;
+}
+
+static uint16_t gray(uint64_t n)
+{
+	return (n ^ (n >> 1)) & 0xffff;
+}
+
+/* Check that samples continue the demo's gray code from value number n. */
+static void gray_check(const GByteArray *data, uint64_t n, const char *what)
+{
+	uint16_t sample;
+	size_t i;
+
+	for (i = 0; i + 2 <= data->len; i += 2) {
+		sample = data->data[i] | data->data[i + 1] << 8;
+		fail_unless(sample == gray(n + i / 2),
+			"%s sample %zu is 0x%04x, not 0x%04x.", what, i / 2,
+			sample, gray(n + i / 2));
+	}
+}
+
+/*
+ * Check the pre-trigger data which a soft trigger retains from several
+ * packets without copying them. The demo device sends the n-th sample
+ * of its gray code pattern as gray(n + 1), and refers to the pattern's
+ * samples for pre-trigger data. The trigger stages straddle a packet
+ * boundary.
+ */
+START_TEST(test_trigger_soft_pretrigger)
+{
+	static const uint64_t stage_starts[] = {
+		/* Between the first and second stage, then the second and third. */
+		23 * DEMO_PACKET, 23 * DEMO_PACKET - 1,
+	};
+	struct sr_dev_inst *sdi;
+	struct sr_session *sess;
+	struct sr_trigger *trig;
+	struct sr_trigger_stage *stage;
+	struct demo_feed feed;
+	uint64_t n;
+	size_t i;
+	int c, k, ret;
+
+	if (!(sdi = demo_open()))
+		return;
+
+	for (i = 0; i < G_N_ELEMENTS(stage_starts); i++) {
+		/* Stages which match three consecutive pattern values. */
+		n = stage_starts[i];
+		trig = sr_trigger_new("T1");
+		for (k = 0; k < 3; k++) {
+			stage = sr_trigger_stage_add(trig);
+			for (c = 0; c < 16; c++)
+				sr_trigger_match_add(stage, channel_get(sdi, c),
+					gray(n + k) & (1 << c) ?
+					SR_TRIGGER_ONE : SR_TRIGGER_ZERO, 0);
+		}
+
+		memset(&feed, 0, sizeof(feed));
+		feed.pre = g_byte_array_new();
+		feed.post = g_byte_array_new();
+		sr_session_new(srtest_ctx, &sess);
+		sr_session_dev_add(sess, sdi);
+		sr_session_trigger_set(sess, trig);
+		sr_session_datafeed_callback_add(sess, demo_datafeed, &feed);
+		ret = sr_session_start(sess);
+		fail_unless(ret == SR_OK, "sr_session_start() failed: %d.", ret);
+		ret = sr_session_run(sess);
+		fail_unless(ret == SR_OK, "sr_session_run() failed: %d.", ret);
+
+		fail_unless(feed.triggers == 1, "Got %d triggers.", feed.triggers);
+		fail_unless(feed.ends == 1);
+		fail_unless(feed.pre->len == DEMO_PRE_TRIGGER * 2,
+			"Got %u pre-trigger bytes.", feed.pre->len);
+		fail_unless(feed.post->len >= 2, "No samples after the trigger.");
+		/* The pre-trigger data ends with the first two stages' values. */
+		gray_check(feed.pre, n + 2 - DEMO_PRE_TRIGGER, "Pre-trigger");
+		gray_check(feed.post, n + 2, "Post-trigger");
+
+		sr_session_destroy(sess);
+		sr_trigger_free(trig);
+		g_byte_array_free(feed.pre, TRUE);
+		g_byte_array_free(feed.post, TRUE);
+	}
+
+	sr_dev_close(sdi);
+}
+END_TEST
+
 Suite *suite_trigger(void)
 {
 	Suite *s;
@@ -276,5 +643,11 @@ Suite *suite_trigger(void)
 	tcase_add_test(tc, test_trigger_match_add_bogus);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("soft");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_trigger_soft_stages);
+	tcase_add_test(tc, test_trigger_soft_pretrigger);
+	suite_add_tcase(s, tc);
+
 	return s;
 }